@@ -45,6 +45,9 @@ case $1 in
     (metrics)
         cd cov_report
         gen_trace -o cov-metrics.info;;
+    (bench)
+        cd cov_report
+        gen_trace -o cov-bench.info;;
     (*)
         lcov -c -d build/plugins/$1/CMakeFiles/plugin-$1.dir -o cov_report/cov-$1.info;;
 esac
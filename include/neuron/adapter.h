@@ -65,7 +65,22 @@ typedef struct adapter_callbacks {
             void (*update_im)(neu_adapter_t *adapter, const char *group,
                               const char *tag, neu_dvalue_t value,
                               neu_tag_meta_t *metas, int n_meta);
+            // same as calling update on each of the n tags, with the cache,
+            // metrics and log touched once for the whole batch
+            void (*update_batch)(neu_adapter_t *adapter, const char *group,
+                                 int n, const char **tags,
+                                 neu_dvalue_t *values);
+            // the n tags were read again with the values of their last
+            // update, only their timestamps are refreshed
+            void (*touch_batch)(neu_adapter_t *adapter, const char *group,
+                                int n, const char **tags);
         } driver;
+        struct {
+            // stop or resume handing trans data to the plugin, e.g. while
+            // its broker is slow. Pauses nest, each one must be undone, and
+            // they may be called from any thread
+            void (*pause)(neu_adapter_t *adapter, bool paused);
+        } app;
     };
 } adapter_callbacks_t;
 
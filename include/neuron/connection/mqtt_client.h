@@ -35,10 +35,30 @@ extern "C" {
 #define NEU_METRIC_CACHED_MSGS_NUM_TYPE NEU_METRIC_TYPE_GAUAGE
 #define NEU_METRIC_CACHED_MSGS_NUM_HELP "Number of messages cached"
 
+// bytes of messages cached
+#define NEU_METRIC_CACHED_BYTES "cached_bytes"
+#define NEU_METRIC_CACHED_BYTES_TYPE NEU_METRIC_TYPE_GAUAGE
+#define NEU_METRIC_CACHED_BYTES_HELP "Bytes of messages cached"
+
+// seconds to replay the cached messages
+#define NEU_METRIC_CACHE_REPLAY_ETA "cache_replay_eta_seconds"
+#define NEU_METRIC_CACHE_REPLAY_ETA_TYPE NEU_METRIC_TYPE_GAUAGE
+#define NEU_METRIC_CACHE_REPLAY_ETA_HELP \
+    "Seconds to replay the cached messages at the recent pace, 0 if unknown"
+
 #define NEU_MQTT_CACHE_SYNC_INTERVAL_MIN 10
 #define NEU_MQTT_CACHE_SYNC_INTERVAL_MAX 12000
 #define NEU_MQTT_CACHE_SYNC_INTERVAL_DEFAULT 100
 
+#define NEU_MQTT_RECV_CONCURRENCY_DEFAULT 4
+#define NEU_MQTT_RECV_CONCURRENCY_MAX 64
+
+#define NEU_MQTT_RECONNECT_MIN_DEFAULT 1000
+#define NEU_MQTT_RECONNECT_MAX_DEFAULT 60000
+#define NEU_MQTT_RECONNECT_MAX_LIMIT 3600000
+
+#define NEU_MQTT_REPLAY_SHARE_DEFAULT 50
+
 typedef enum {
     NEU_MQTT_VERSION_V31  = 3,
     NEU_MQTT_VERSION_V311 = 4,
@@ -51,9 +71,29 @@ typedef enum {
     NEU_MQTT_QOS2,
 } neu_mqtt_qos_e;
 
+typedef enum {
+    NEU_MQTT_PUBLISH_RETAIN = 1 << 0,
+    // while offline, fail the publish rather than drop older cached messages
+    // to make room for it
+    NEU_MQTT_PUBLISH_NO_EVICT = 1 << 1,
+} neu_mqtt_publish_flag_e;
+
+typedef enum {
+    NEU_MQTT_REPLAY_OLDEST_FIRST = 0,
+    // newest first from memory, then the disk cache in order
+    NEU_MQTT_REPLAY_NEWEST_FIRST = 1,
+} neu_mqtt_replay_order_e;
+
 typedef struct neu_mqtt_client_s neu_mqtt_client_t;
 
 typedef void (*neu_mqtt_client_connection_cb_t)(void *data);
+// milliseconds from a publish request to its delivery to the broker, which is
+// the PUBACK for QoS1 and QoS2
+typedef void (*neu_mqtt_client_latency_cb_t)(int64_t ms, void *data);
+// called with congested set once the in-flight window is full, and with it
+// cleared once the window drains to half. It runs under the client lock, so
+// it must be cheap and must not call into the client
+typedef void (*neu_mqtt_client_inflight_cb_t)(bool congested, void *data);
 typedef void (*neu_mqtt_client_publish_cb_t)(int errcode, neu_mqtt_qos_e qos,
                                              char *topic, uint8_t *payload,
                                              uint32_t len, void *data);
@@ -70,6 +110,15 @@ void               neu_mqtt_client_free(neu_mqtt_client_t *client);
 bool   neu_mqtt_client_is_open(neu_mqtt_client_t *client);
 bool   neu_mqtt_client_is_connected(neu_mqtt_client_t *client);
 size_t neu_mqtt_client_get_cached_msgs_num(neu_mqtt_client_t *client);
+// bytes cached and seconds to replay them at the recent replay pace, or at the
+// replay rate before the replay started, 0 if unknown
+void neu_mqtt_client_get_replay(neu_mqtt_client_t *client, size_t *bytes,
+                                size_t *eta);
+// publishes sent to the broker and not yet delivered
+void neu_mqtt_client_get_inflight(neu_mqtt_client_t *client, size_t *msgs,
+                                  size_t *bytes);
+// whether the in-flight window is full, see neu_mqtt_client_inflight_cb_t
+bool neu_mqtt_client_is_congested(neu_mqtt_client_t *client);
 
 int neu_mqtt_client_set_addr(neu_mqtt_client_t *client, const char *host,
                              uint16_t port);
@@ -85,14 +134,44 @@ int neu_mqtt_client_set_connect_cb(neu_mqtt_client_t *             client,
 int neu_mqtt_client_set_disconnect_cb(neu_mqtt_client_t *             client,
                                       neu_mqtt_client_connection_cb_t cb,
                                       void *                          data);
+int neu_mqtt_client_set_latency_cb(neu_mqtt_client_t *          client,
+                                   neu_mqtt_client_latency_cb_t cb,
+                                   void *                       data);
+// The parsed config is shared by the clients with the same host, CA and
+// certificates, and kept if the same ones are set again.
 int neu_mqtt_client_set_tls(neu_mqtt_client_t *client, bool enabled,
                             const char *ca, const char *cert, const char *key,
                             const char *keypass);
+// Redial a lost connection after a random time below a back-off, which starts
+// at min_ms and doubles up to max_ms. Default to
+// NEU_MQTT_RECONNECT_MIN_DEFAULT and NEU_MQTT_RECONNECT_MAX_DEFAULT.
+int neu_mqtt_client_set_reconnect_backoff(neu_mqtt_client_t *client,
+                                          uint32_t min_ms, uint32_t max_ms);
 int neu_mqtt_client_set_cache_size(neu_mqtt_client_t *client,
                                    size_t mem_size_bytes, size_t db_size_bytes);
 // default to NEU_MQTT_CACHE_SYNC_INTERVAL_DEFAULT if not set
 int neu_mqtt_client_set_cache_sync_interval(neu_mqtt_client_t *client,
                                             uint32_t           interval);
+// Receive up to n messages at once, the handlers of subscriptions then run
+// concurrently and messages may be handled out of order, 1 keeps the order.
+// Default to NEU_MQTT_RECV_CONCURRENCY_DEFAULT, to be set before subscribing.
+int neu_mqtt_client_set_recv_concurrency(neu_mqtt_client_t *client,
+                                         uint16_t           n);
+// Bound the publishes in flight to max_msgs messages and max_bytes payload
+// bytes, 0 for no bound. Publishes over the window go to the offline cache if
+// there is one, and fail otherwise. Replayed cached messages are bounded by
+// the replay share of the window instead.
+int neu_mqtt_client_set_inflight_window(neu_mqtt_client_t *client,
+                                        size_t max_msgs, size_t max_bytes);
+// Replay cached messages at up to `rate` bytes per second, 0 for no bound,
+// taking up to `share` percent of the in-flight window and none while live
+// publishes fill it. Default to no rate bound, NEU_MQTT_REPLAY_SHARE_DEFAULT
+// and NEU_MQTT_REPLAY_OLDEST_FIRST.
+int neu_mqtt_client_set_replay(neu_mqtt_client_t *client, size_t rate,
+                               uint8_t share, neu_mqtt_replay_order_e order);
+int neu_mqtt_client_set_inflight_cb(neu_mqtt_client_t *           client,
+                                    neu_mqtt_client_inflight_cb_t cb,
+                                    void *                        data);
 int neu_mqtt_client_set_zlog_category(neu_mqtt_client_t *client,
                                       zlog_category_t *  cat);
 
@@ -108,17 +187,35 @@ int neu_mqtt_client_close(neu_mqtt_client_t *client);
  * `errcode` is zero if delivery was successful and nonzero otherwise, and
  * the other arguments are exactly the same what you pass into this function.
  * You may set `cb` to NULL if you do not care about the result.
+ *
+ * On MQTT 5 connections a topic published before is sent as a topic alias, as
+ * many topics as the Topic Alias Maximum of the broker allows.
  */
 int neu_mqtt_client_publish(neu_mqtt_client_t *client, neu_mqtt_qos_e qos,
                             char *topic, uint8_t *payload, uint32_t len,
                             void *data, neu_mqtt_client_publish_cb_t cb);
 
+/** Publish a `qos` message with the `len` bytes of `buf` on `topic`.
+ *
+ * Same as `neu_mqtt_client_publish`, except that the bytes are copied into the
+ * `PUBLISH` packet before this function returns, so the caller keeps `buf`
+ * and may reuse it right away, and the callback gets NULL as `payload`.
+ * `topic` is still passed to the callback and must outlive the delivery.
+ * `flags` is a bitwise or of `neu_mqtt_publish_flag_e` values.
+ */
+int neu_mqtt_client_publish_buf(neu_mqtt_client_t *client, neu_mqtt_qos_e qos,
+                                int flags, char *topic, const uint8_t *buf,
+                                uint32_t len, void *data,
+                                neu_mqtt_client_publish_cb_t cb);
+
 /** Subscribe to `topic` with service quality `qos`.
  *
  * This function tries to send a `SUBSCRIBE` packet with the given `qos` and
  * `topic`. If this was successful returns zero and the callback `cb` will be
  * called on each received message with the matching topic, otherwise a nonzero
- * value is returned.
+ * value is returned. `topic` is a filter which may have the `+` and `#`
+ * wildcards, the callback is then passed the topic of each message. A message
+ * matching several filters goes to the most specific one only.
  */
 int neu_mqtt_client_subscribe(neu_mqtt_client_t *client, neu_mqtt_qos_e qos,
                               const char *topic, void *data,
@@ -20,9 +20,12 @@
 #ifndef NEURON_CONNECTION_H
 #define NEURON_CONNECTION_H
 
+#include <stdbool.h>
 #include <stdint.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
+#include "event/event.h"
 #include "utils/protocol_buf.h"
 
 typedef enum neu_conn_type {
@@ -74,11 +77,29 @@ typedef enum neu_conn_tty_flow {
     NEU_CONN_TTYP_FLOW_ENABLE,
 } neu_conn_tty_flow_e;
 
+// priority of a turn on a shared connection, the lower the sooner
+typedef enum neu_conn_prio {
+    NEU_CONN_PRIO_HIGH   = 0,
+    NEU_CONN_PRIO_NORMAL = 1,
+} neu_conn_prio_e;
+
 typedef void (*neu_conn_callback)(void *ctx, int fd);
 
+// options of the tcp sockets, 0 keeps the system default
+typedef struct neu_conn_tcp_opt {
+    bool     nodelay;
+    uint16_t keepalive_idle;     // second, keepalive is on when not 0
+    uint16_t keepalive_interval; // second
+    uint16_t keepalive_count;
+    uint32_t user_timeout; // millisecond, TCP_USER_TIMEOUT
+    int      recv_buf;     // byte, SO_RCVBUF
+    int      send_buf;     // byte, SO_SNDBUF
+} neu_conn_tcp_opt_t;
+
 typedef struct neu_conn_param {
-    zlog_category_t *log;
-    neu_conn_type_e  type;
+    zlog_category_t *  log;
+    neu_conn_type_e    type;
+    neu_conn_tcp_opt_t tcp_opt; // tcp server and tcp client only
 
     union {
         struct {
@@ -160,6 +181,65 @@ neu_conn_t *neu_conn_reconfig(neu_conn_t *conn, neu_conn_param_t *param);
  */
 void neu_conn_destory(neu_conn_t *conn);
 
+/**
+ * @brief Get the connection shared by all the nodes of the same endpoint.
+ * A tcp client connection to an ip:port, or a tty client connection to a
+ * serial device, already used by another node is returned instead of opening
+ * one more, connected and disconnected of every node sharing it are called.
+ * A shared tty keeps the line settings of its first node. The connection
+ * stops once every node sharing it called neu_conn_stop, and must not be
+ * reconfigured, the nodes take turns on it with neu_conn_acquire_prio or
+ * neu_conn_acquire and neu_conn_release. Other connection types are not
+ * shared, the same as neu_conn_new.
+ *
+ * @param[in] param Parameters of the connection.
+ * @param[in] data Passed to connected and disconnected, identifies the node.
+ * @param[in] connected
+ * @param[in] disconnected
+ * @return The shared connection.
+ */
+neu_conn_t *neu_conn_share(neu_conn_param_t *param, void *data,
+                           neu_conn_callback connected,
+                           neu_conn_callback disconnected);
+
+/**
+ * @brief Leave a connection got by neu_conn_share, destroyed with its last
+ * node.
+ *
+ * @param[in] conn
+ * @param[in] data The data given to neu_conn_share.
+ */
+void neu_conn_unshare(neu_conn_t *conn, void *data);
+
+/**
+ * @brief Wait for the turn of the caller on the connection. Turns go to the
+ * highest priority first, then to the earliest deadline, then in the order
+ * of the calls. A request and its response are sent and received between
+ * neu_conn_acquire_prio and neu_conn_release.
+ *
+ * @param[in] conn
+ * @param[in] prio
+ * @param[in] deadline Time in ms(neu_time_ms) the turn is due, 0 for none.
+ */
+void neu_conn_acquire_prio(neu_conn_t *conn, neu_conn_prio_e prio,
+                           int64_t deadline);
+
+/**
+ * @brief Wait for the turn of the caller on the connection, at normal
+ * priority without deadline, granted in the order of the calls so that no
+ * node sharing the connection starves.
+ *
+ * @param[in] conn
+ */
+void neu_conn_acquire(neu_conn_t *conn);
+
+/**
+ * @brief Hand the connection over to the next waiting caller.
+ *
+ * @param[in] conn
+ */
+void neu_conn_release(neu_conn_t *conn);
+
 /**
  * @brief Connect
  *
@@ -280,6 +360,36 @@ ssize_t neu_conn_tcp_server_send(neu_conn_t *conn, int fd, uint8_t *buf,
 ssize_t neu_conn_tcp_server_recv(neu_conn_t *conn, int fd, uint8_t *buf,
                                  ssize_t len);
 
+/**
+ * @brief Receive the data already pending on a client of the tcp server,
+ * without waiting, for clients polled by an event loop.
+ *
+ * @param[in] conn
+ * @param[in] fd Client's file descriptor.
+ * @param[in] buf The received data is stored in buf.
+ * @param[in] len Length of buf.
+ * @return The number of bytes received, 0 if the client closed the
+ * connection, less than 0 if nothing is pending.
+ */
+ssize_t neu_conn_tcp_server_recv_pending(neu_conn_t *conn, int fd,
+                                         uint8_t *buf, ssize_t len);
+
+/**
+ * @brief Change the receive timeout of the connected socket or tty, the
+ * configured timeout is restored on the next connect.
+ *
+ * @param[in] conn
+ * @param[in] fd Client's file descriptor for the tcp server, ignored by the
+ * other connection types.
+ * @param[in] timeout Timeout in milliseconds.
+ */
+void neu_conn_set_timeout(neu_conn_t *conn, int fd, uint16_t timeout);
+
+/** Called on the bytes not yet consumed, protocol_buf starting at the next
+ * frame, until it returns 0 for a partial frame.
+ * @return the bytes of the frame parsed, 0 to wait for more bytes, -1 to
+ *         close the connection.
+ */
 typedef int (*neu_conn_stream_consume_fn)(
     void *context, neu_protocol_unpack_buf_t *protocol_buf);
 
@@ -295,9 +405,99 @@ typedef neu_buf_result_t (*neu_conn_process_msg)(
 int neu_conn_wait_msg(neu_conn_t *conn, void *context, uint16_t n_byte,
                       neu_conn_process_msg fn);
 
+/**
+ * @brief Switch a tcp or tty client connection to the asynchronous mode.
+ * The fd is put in non-blocking mode and polled by events from every
+ * (re)connect on. Received bytes are accumulated and handed to consume on the
+ * events thread, with the same contract as neu_conn_stream_consume, data the
+ * fd does not take at once is queued by neu_conn_sendv and flushed when it
+ * becomes writable. neu_conn_send and neu_conn_recv must not be used on the
+ * connection meanwhile.
+ *
+ * @param[in] conn
+ * @param[in] events Events of the node, runs consume and drained.
+ * @param[in] context Passed to consume and drained.
+ * @param[in] consume Called with the received bytes.
+ * @param[in] drained Called once the send queue is flushed, can be NULL.
+ * @return 0 on success, -1 if the connection type is not supported or the
+ * connection is already asynchronous.
+ */
+int neu_conn_async_start(neu_conn_t *conn, neu_events_t *events,
+                         void *context, neu_conn_stream_consume_fn consume,
+                         neu_conn_callback drained);
+
+/**
+ * @brief Leave the asynchronous mode, the data still queued is dropped.
+ *
+ * @param[in] conn
+ */
+void neu_conn_async_stop(neu_conn_t *conn);
+
+/**
+ * @brief Send the concatenation of iov on an asynchronous connection without
+ * blocking, what the fd does not take at once is queued.
+ *
+ * @param[in] conn
+ * @param[in] iov Buffers to be sent in order, such as a header and a payload.
+ * @param[in] iovcnt Number of buffers in iov.
+ * @return The total length of iov once sent or queued, 0 if the connection is
+ * stopped, not asynchronous or not connected, -1 on error or if the send
+ * queue is full.
+ */
+ssize_t neu_conn_sendv(neu_conn_t *conn, const struct iovec *iov, int iovcnt);
+
 int neu_conn_tcp_server_wait_msg(neu_conn_t *conn, int fd, void *context,
                                  uint16_t n_byte, neu_conn_process_msg fn);
 
+/**
+ * @brief Limit the tcp client connects of all the connections to `rate` per
+ * second, in bursts of up to `rate`, 0 for no limit. A connect over the limit
+ * is deferred to a later send or recv. Independent of the limit, a tcp client
+ * that failed to connect or lost the connection waits a jittered back-off,
+ * doubling up to some seconds until it exchanges data again.
+ *
+ * @param[in] rate Connects per second.
+ */
+void neu_conn_set_reconnect_rate(uint32_t rate);
+
+/**
+ * @brief Total connects deferred by the reconnect rate.
+ */
+uint64_t neu_conn_reconnects_deferred();
+
+#define NEU_CONN_HANDOVER_KEY_LEN 128
+
+// an open fd of a connection and the endpoint it belongs to
+typedef struct {
+    char key[NEU_CONN_HANDOVER_KEY_LEN];
+    int  fd;
+} neu_conn_handover_t;
+
+/**
+ * @brief Duplicate the fds of the tcp listeners, of the connected tcp
+ * clients and of the open serial ports, for a new process to take them over.
+ * The accepted clients of the tcp servers and the udp sockets are left out.
+ *
+ * @param[out] out The keys and the duplicated fds, the caller closes them.
+ * @param[in] max Size of out.
+ * @return Number of entries of out filled.
+ */
+int neu_conn_handover_export(neu_conn_handover_t *out, int max);
+
+/**
+ * @brief Keep an fd received from the previous process, the first connection
+ * of the same endpoint to connect or listen uses it instead of a new one.
+ *
+ * @param[in] key As exported by neu_conn_handover_export.
+ * @param[in] fd
+ */
+void neu_conn_handover_import(const char *key, int fd);
+
+/**
+ * @brief Close the imported fds no connection has taken yet.
+ */
+void neu_conn_handover_drop();
+
 int is_ipv4(const char *ip);
 int is_ipv6(const char *ip);
 
@@ -20,6 +20,30 @@
 #ifndef NEURON_CONNECTION_SMART_LINK_H
 #define NEURON_CONNECTION_SMART_LINK_H
 
+#include <stdbool.h>
+
 int neu_conn_smart_link_auto_set(const char *dev_path);
 
+typedef void (*neu_conn_smart_link_hotplug)(void *ctx, const char *dev_path,
+                                            bool add);
+
+/**
+ * @brief Get told when the serial device is plugged in or out, from the
+ * kernel uevents.
+ *
+ * @param[in] dev_path Path of the serial device.
+ * @param[in] cb Called on the watcher thread, add is false when unplugged.
+ * @param[in] ctx Passed to cb.
+ * @return 0 on success, -1 if the uevents can not be received.
+ */
+int neu_conn_smart_link_watch(const char *                dev_path,
+                              neu_conn_smart_link_hotplug cb, void *ctx);
+
+/**
+ * @brief Stop the watches of ctx, cb is not running anymore on return.
+ *
+ * @param[in] ctx
+ */
+void neu_conn_smart_link_unwatch(void *ctx);
+
 #endif
\ No newline at end of file
@@ -44,7 +44,13 @@
 #define NEU_PLUGIN_DESCRIPTION_LEN 512
 #define NEU_TEMPLATE_NAME_LEN 128
 #define NEU_DRIVER_TAG_CACHE_EXPIRE_TIME 60
+#define NEU_DRIVER_REPORT_TICK_MIN 10
+#define NEU_DRIVER_TIMER_STAGGER 20
+#define NEU_DRIVER_GROUP_CONCURRENCY_MAX 8
 #define NEU_APP_SUBSCRIBE_MSG_SIZE 4
+#define NEU_APP_MSG_Q_SIZE 1024
+#define NEU_APP_MSG_Q_BATCH 16
+#define NEU_APP_CONSUMERS_MAX 8
 #define NEU_TAG_FLOAG_PRECISION_MAX 17
 #define NEU_USER_PASSWORD_MIN_LEN 4
 #define NEU_USER_PASSWORD_MAX_LEN 16
@@ -122,6 +128,13 @@ typedef enum {
 typedef enum {
     NEU_TAG_CACHE_TYPE_INTERVAL = 0,
     NEU_TAG_CACHE_TYPE_NEVER,
+    // values older than the interval window are kept and flagged stale
+    NEU_TAG_CACHE_TYPE_LKV,
+    // values expire after a ttl of their own instead of the interval window
+    NEU_TAG_CACHE_TYPE_TTL,
+    // as interval, but a group without subscribers is not read and its
+    // values are dropped until an app subscribes again
+    NEU_TAG_CACHE_TYPE_SUBSCRIBED,
 } neu_tag_cache_type_e;
 
 // forward declaration for neu_adapter_t
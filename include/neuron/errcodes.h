@@ -47,6 +47,7 @@ typedef enum {
     NEU_ERR_COMMAND_EXECUTION_FAILED = 1014,
     NEU_ERR_IP_ADDRESS_INVALID       = 1015,
     NEU_ERR_IP_ADDRESS_IN_USE        = 1016,
+    NEU_ERR_MEM_BUDGET_EXCEEDED      = 1019,
 
     NEU_ERR_NODE_EXIST               = 2002,
     NEU_ERR_NODE_NOT_EXIST           = 2003,
@@ -83,6 +84,7 @@ typedef enum {
     NEU_ERR_TAG_PRECISION_INVALID      = 2209,
     NEU_ERR_TAG_EXIST                  = 2210,
     NEU_ERR_TAG_VALUE_INVALID          = 2211,
+    NEU_ERR_TAG_HISTORY_DISABLED       = 2212,
 
     NEU_ERR_LIBRARY_NOT_FOUND                 = 2301,
     NEU_ERR_LIBRARY_INFO_INVALID              = 2302,
@@ -136,6 +138,8 @@ typedef enum {
     NEU_ERR_PLUGIN_NOT_SUPPORT_WRITE_TAGS  = 3017,
     NEU_ERR_PLUGIN_NOT_SUPPORT_READ_SYNC   = 3018,
     NEU_ERR_PLUGIN_TYPE_NOT_SUPPORT        = 3019,
+    NEU_ERR_PLUGIN_WRITE_VERIFY_FAILURE    = 3020,
+    NEU_ERR_PLUGIN_WRITE_SUPERSEDED        = 3021,
 
     NEU_ERR_MQTT_FAILURE                        = 4000,
     NEU_ERR_MQTT_NO_CERTFILESET                 = 4001,
@@ -20,6 +20,7 @@
 #ifndef NEURON_EVENT_H
 #define NEURON_EVENT_H
 
+#include <stdbool.h>
 #include <stdint.h>
 
 #ifdef __cplusplus
@@ -27,12 +28,31 @@ extern "C" {
 #endif
 
 typedef struct neu_events neu_events_t;
+struct neu_cpus;
+
+/**
+ * @brief Start the shared event engine.
+ * Once started, events created by neu_event_new no longer get a thread of
+ * their own but are pinned to one of n_worker shared threads, so io_event and
+ * timer_event of one event are still processed serially.
+ *
+ * @param[in] n_worker number of worker threads, the number of online cores if
+ *                     not greater than 0.
+ * @return 0 on success.
+ */
+int neu_event_engine_init(int n_worker);
+
+/**
+ * @brief Stop the shared event engine, after every event is closed.
+ */
+void neu_event_engine_fini(void);
 
 /**
  * @brief Creat a new event.
  * When an event is created, a corresponding thread is created, and both
  * io_event and timer_event in this event are scheduled for processing in this
- * thread.
+ * thread. With the shared event engine started, the thread is one of the
+ * engine workers instead.
  * @return the newly created event.
  */
 neu_events_t *neu_event_new(void);
@@ -45,6 +65,49 @@ neu_events_t *neu_event_new(void);
  */
 int neu_event_close(neu_events_t *events);
 
+/**
+ * @brief Label the thread of the event with the node it runs for and its role
+ * in the node, as seen in thread cpu times and profiles. Events of the shared
+ * event engine share the thread with other events and are not labelled.
+ *
+ * @param[in] events
+ * @param[in] node
+ * @param[in] role
+ */
+void neu_event_label(neu_events_t *events, const char *node,
+                     const char *role);
+
+/**
+ * @brief Pin the thread of the event to cpus, see neu_thread_set_affinity.
+ * Events of the shared event engine are left where the engine runs them.
+ *
+ * @param[in] events
+ * @param[in] cpus NULL to unpin.
+ * @return 0 on success, -1 if the thread was not pinned.
+ */
+int neu_event_set_affinity(neu_events_t *events, const struct neu_cpus *cpus);
+
+/**
+ * @brief Run the thread of the event under a scheduling policy, see
+ * neu_thread_set_sched. Events of the shared event engine keep the policy of
+ * the engine.
+ *
+ * @param[in] events
+ * @param[in] policy SCHED_FIFO, SCHED_RR or SCHED_OTHER.
+ * @param[in] priority
+ * @return 0 on success, -1 if the policy was not set.
+ */
+int neu_event_set_sched(neu_events_t *events, int policy, int priority);
+
+/**
+ * @brief The cpu time the thread of the event has run for.
+ *
+ * @param[in] events
+ * @return Nanoseconds, -1 for events of the shared event engine or where it
+ * cannot be told.
+ */
+int64_t neu_event_cputime(neu_events_t *events);
+
 typedef struct neu_event_timer neu_event_timer_t;
 typedef int (*neu_event_timer_callback)(void *usr_data);
 
@@ -62,6 +125,9 @@ typedef struct neu_event_timer_param {
     // Callback function that fires every time the timer fires
     neu_event_timer_callback cb;
     neu_event_timer_type_e   type;
+    // extra milliseconds before the first trigger, to spread timers of the
+    // same period apart
+    int64_t delay;
 } neu_event_timer_param_t;
 
 /**
@@ -83,10 +149,21 @@ neu_event_timer_t *neu_event_add_timer(neu_events_t *          events,
  */
 int neu_event_del_timer(neu_events_t *events, neu_event_timer_t *timer);
 
+/**
+ * @brief How late the running callback of the timer fired, to be called from
+ * the callback.
+ *
+ * @param[in] timer
+ * @return Nanoseconds after the deadline of the timer, 0 where it cannot be
+ * told.
+ */
+int64_t neu_event_timer_lateness(neu_event_timer_t *timer);
+
 enum neu_event_io_type {
     NEU_EVENT_IO_READ   = 0x1,
     NEU_EVENT_IO_CLOSED = 0x2,
     NEU_EVENT_IO_HUP    = 0x3,
+    NEU_EVENT_IO_WRITE  = 0x4,
 };
 typedef struct neu_event_io neu_event_io_t;
 typedef int (*neu_event_io_callback)(enum neu_event_io_type type, int fd,
@@ -121,6 +198,17 @@ neu_event_io_t *neu_event_add_io(neu_events_t *events, neu_event_io_param_t io);
  */
 int neu_event_del_io(neu_events_t *events, neu_event_io_t *io);
 
+/**
+ * @brief Turn on or off the NEU_EVENT_IO_WRITE notification of io_event, fired
+ * each time the fd can be written without blocking.
+ *
+ * @param[in] events
+ * @param[in] io
+ * @param[in] enable
+ * @return 0 on success.
+ */
+int neu_event_io_write(neu_events_t *events, neu_event_io_t *io, bool enable);
+
 #ifdef __cplusplus
 }
 #endif
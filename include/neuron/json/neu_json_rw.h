@@ -69,9 +69,13 @@ typedef struct {
     char *               tag;
     enum neu_json_type   t;
     union neu_json_value value;
+    bool                 preempt; // see neu_req_write_tag_t
+    bool                 verify;  // see neu_req_write_tag_t
 } neu_json_write_req_t;
 
 int  neu_json_decode_write_req(char *buf, neu_json_write_req_t **result);
+int  neu_json_decode_write_reqb(const char *buf, size_t len,
+                                neu_json_write_req_t **result);
 int  neu_json_decode_write_req_json(void *                 json_obj,
                                     neu_json_write_req_t **result);
 void neu_json_decode_write_req_free(neu_json_write_req_t *req);
@@ -87,9 +91,13 @@ typedef struct {
     char *                      node;
     int                         n_tag;
     neu_json_write_tags_elem_t *tags;
+    bool                        preempt;
+    bool                        verify;
 } neu_json_write_tags_req_t;
 int  neu_json_decode_write_tags_req(char *                      buf,
                                     neu_json_write_tags_req_t **result);
+int  neu_json_decode_write_tags_reqb(const char *buf, size_t len,
+                                     neu_json_write_tags_req_t **result);
 int  neu_json_decode_write_tags_req_json(void *                      json_obj,
                                          neu_json_write_tags_req_t **result);
 void neu_json_decode_write_tags_req_free(neu_json_write_tags_req_t *req);
@@ -104,14 +112,41 @@ typedef struct {
 
     int                          n_group;
     neu_json_write_gtags_elem_t *groups;
+    bool                         preempt;
 } neu_json_write_gtags_req_t;
 
 int  neu_json_decode_write_gtags_req(char *                       buf,
                                      neu_json_write_gtags_req_t **result);
+int  neu_json_decode_write_gtags_reqb(const char *buf, size_t len,
+                                      neu_json_write_gtags_req_t **result);
 int  neu_json_decode_write_gtags_req_json(void *                       json_obj,
                                           neu_json_write_gtags_req_t **result);
 void neu_json_decode_write_gtags_req_free(neu_json_write_gtags_req_t *req);
 
+// writes spanning nodes, one gtags request per node
+typedef struct {
+    bool                        preempt;
+    int                         n_node;
+    neu_json_write_gtags_req_t *nodes;
+} neu_json_write_batch_req_t;
+
+int  neu_json_decode_write_batch_req(char *                       buf,
+                                     neu_json_write_batch_req_t **result);
+void neu_json_decode_write_batch_req_free(neu_json_write_batch_req_t *req);
+
+typedef struct {
+    char *  node;
+    int64_t error;
+} neu_json_write_batch_node_t;
+
+typedef struct {
+    int64_t                      error; // the first error of any node
+    int                          n_node;
+    neu_json_write_batch_node_t *nodes;
+} neu_json_write_batch_resp_t;
+
+int neu_json_encode_write_batch_resp(void *json_object, void *param);
+
 typedef struct {
     union {
         neu_json_write_req_t      single;
@@ -124,18 +159,57 @@ int  neu_json_decode_write(char *buf, neu_json_write_t **result);
 void neu_json_decode_write_free(neu_json_write_t *req);
 
 typedef struct {
-    char *group;
-    char *node;
-    char *name;
-    char *desc;
-    bool  sync;
+    char *   group;
+    char *   node;
+    char *   name;
+    char *   desc;
+    bool     sync;
+    uint32_t max_age; // ms, see neu_req_read_group_t
 } neu_json_read_req_t;
 
 int  neu_json_decode_read_req(char *buf, neu_json_read_req_t **result);
 void neu_json_decode_read_req_free(neu_json_read_req_t *req);
 
+typedef struct {
+    bool                 sync;
+    uint32_t             max_age;
+    int                  n_group;
+    neu_json_read_req_t *groups;
+} neu_json_read_batch_req_t;
+
+int  neu_json_decode_read_batch_req(char *                      buf,
+                                    neu_json_read_batch_req_t **result);
+void neu_json_decode_read_batch_req_free(neu_json_read_batch_req_t *req);
+
+typedef struct {
+    char *                node;
+    char *                group;
+    int64_t               error;
+    neu_json_read_resp_t *resp;
+} neu_json_read_batch_group_t;
+
+int neu_json_encode_read_batch_group(void *json_object, void *param);
+
 int neu_json_encode_read_periodic_resp(void *json_object, void *param);
 
+typedef struct {
+    int64_t timestamp;
+    int64_t count;
+    double  min;
+    double  max;
+    double  avg;
+    double  last; // the value of a sample
+} neu_json_tag_history_point_t;
+
+typedef struct {
+    bool                          downsampled; // points are buckets
+    bool                          truncated;
+    int                           n_point;
+    neu_json_tag_history_point_t *points;
+} neu_json_tag_history_resp_t;
+
+int neu_json_encode_tag_history_resp(void *json_object, void *param);
+
 void neu_json_metas_to_json(neu_tag_meta_t *metas, int n_meta,
                             neu_json_read_resp_tag_t *json_tag);
 
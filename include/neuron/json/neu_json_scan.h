@@ -0,0 +1,85 @@
+/**
+ * NEURON IIoT System for Industry 4.0
+ * Copyright (C) 2020-2023 EMQ Technologies Co., Ltd All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ **/
+
+#ifndef _NEU_JSON_API_NEU_JSON_SCAN_H_
+#define _NEU_JSON_API_NEU_JSON_SCAN_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "json/json.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * A forward only JSON scanner for the request decoders on the hot write and
+ * read paths. It decodes straight from the input buffer without building a
+ * document tree.
+ *
+ * Every function returns -1 when the input is something the scanner does not
+ * handle, which covers both malformed JSON and valid but unusual forms such
+ * as escaped keys, \u0000 or very deep nesting. Callers treat -1 as "decode
+ * this with jansson instead", so the generic decoders stay the reference for
+ * semantics and error reporting.
+ */
+typedef struct {
+    const char *cur;
+    const char *end;
+    int         depth;
+} neu_json_scan_t;
+
+void neu_json_scan_init(neu_json_scan_t *scan, const char *buf, size_t len);
+
+// consume `{`, then call neu_json_scan_key until it returns 0
+int neu_json_scan_object(neu_json_scan_t *scan);
+// 1 with the raw key of the next member, 0 after the closing `}`
+int neu_json_scan_key(neu_json_scan_t *scan, int *index, const char **key,
+                      size_t *len);
+
+// consume `[`, then call neu_json_scan_elem until it returns 0
+int neu_json_scan_array(neu_json_scan_t *scan);
+// 1 if an element follows, 0 after the closing `]`
+int neu_json_scan_elem(neu_json_scan_t *scan, int *index);
+
+int neu_json_scan_str(neu_json_scan_t *scan, char **str);
+int neu_json_scan_bool(neu_json_scan_t *scan, bool *val);
+int neu_json_scan_int(neu_json_scan_t *scan, int64_t *val);
+// infer the type of a NEU_JSON_VALUE element the way neu_json_decode does
+int neu_json_scan_value(neu_json_scan_t *scan, enum neu_json_type *t,
+                        union neu_json_value *val);
+int neu_json_scan_skip(neu_json_scan_t *scan);
+
+// 0 if nothing but whitespace is left
+int neu_json_scan_end(neu_json_scan_t *scan);
+
+static inline bool neu_json_scan_key_is(const char *key, size_t len,
+                                        const char *name)
+{
+    return strlen(name) == len && memcmp(key, name, len) == 0;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,85 @@
+/**
+ * NEURON IIoT System for Industry 4.0
+ * Copyright (C) 2020-2023 EMQ Technologies Co., Ltd All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ **/
+
+#ifndef _NEU_JSON_API_NEU_JSON_STREAM_H_
+#define _NEU_JSON_API_NEU_JSON_STREAM_H_
+
+#include <stddef.h>
+
+#include "utils/utarray.h"
+
+#include "json/neu_json_rw.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Append-only json writer for the data upload path.
+//
+// It writes the same text as building the jansson tree with
+// neu_json_encode_read_periodic_resp and neu_json_encode_read_resp(1) and
+// dumping it with neu_json_encode, straight from the tag values and without
+// allocating per tag. The buffer grows as needed and is kept across
+// messages, reset it before encoding the next one.
+typedef struct {
+    char * buf; // always NUL terminated once anything was written
+    size_t len;
+    size_t cap;
+} neu_json_stream_t;
+
+static inline void neu_json_stream_reset(neu_json_stream_t *stream)
+{
+    stream->len = 0;
+    if (stream->buf != NULL) {
+        stream->buf[0] = '\0';
+    }
+}
+
+void neu_json_stream_fini(neu_json_stream_t *stream);
+
+/**
+ * @brief Append the header and the tags in the `tags` upload format.
+ *
+ * @param[in] tags UT_array of neu_resp_tag_value_meta_t.
+ * @return 0 on success, -1 if the buffer could not grow.
+ */
+int neu_json_stream_read_periodic_resp(neu_json_stream_t *       stream,
+                                       neu_json_read_periodic_t *header,
+                                       UT_array *                tags);
+
+/**
+ * @brief Append the header and the tags in the `values` upload format.
+ *
+ * @param[in] tags UT_array of neu_resp_tag_value_meta_t.
+ * @return 0 on success, -1 if the buffer could not grow.
+ */
+int neu_json_stream_read_periodic_resp1(neu_json_stream_t *       stream,
+                                        neu_json_read_periodic_t *header,
+                                        UT_array *                tags);
+
+// the `values` upload format with other keys for the node and group names
+int neu_json_stream_read_periodic_resp1_keys(
+    neu_json_stream_t *stream, const char *node_key, const char *group_key,
+    neu_json_read_periodic_t *header, UT_array *tags);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -30,6 +30,7 @@ extern "C" {
 
 #include "define.h"
 #include "type.h"
+#include "utils/histogram.h"
 #include "utils/rolling_counter.h"
 #include "utils/utextend.h"
 #include "utils/uthash.h"
@@ -41,6 +42,7 @@ typedef enum {
     NEU_METRIC_TYPE_GAUAGE,
     NEU_METRIC_TYPE_COUNTER_SET,
     NEU_METRIC_TYPE_ROLLING_COUNTER,
+    NEU_METRIC_TYPE_HISTOGRAM, // updates observe the value into buckets
 } neu_metric_type_e;
 
 // node running state
@@ -60,6 +62,11 @@ typedef enum {
     "Last request round trip time in milliseconds"
 #define NEU_METRIC_LAST_RTT_MS_MAX 9999
 
+// round trip times in milliseconds
+#define NEU_METRIC_RTT_MS "rtt_ms"
+#define NEU_METRIC_RTT_MS_TYPE NEU_METRIC_TYPE_HISTOGRAM
+#define NEU_METRIC_RTT_MS_HELP "Request round trip time in milliseconds"
+
 // number of bytes sent
 #define NEU_METRIC_SEND_BYTES "send_bytes"
 #define NEU_METRIC_SEND_BYTES_TYPE NEU_METRIC_TYPE_COUNTER_SET
@@ -89,6 +96,65 @@ typedef enum {
 #define NEU_METRIC_TAGS_TOTAL_TYPE NEU_METRIC_TYPE_GAUAGE
 #define NEU_METRIC_TAGS_TOTAL_HELP "Total number of tags in the node"
 
+// maintained by neuron core
+// cpu time of the threads labelled with the node, see utils/profile.h
+#define NEU_METRIC_CPU_MS_TOTAL "cpu_ms_total"
+#define NEU_METRIC_CPU_MS_TOTAL_TYPE NEU_METRIC_TYPE_COUNTER_SET
+#define NEU_METRIC_CPU_MS_TOTAL_HELP \
+    "Total cpu time in milliseconds of the node threads"
+
+// maintained by neuron core
+// estimate of the memory held by the node, from its tags and queued messages
+#define NEU_METRIC_MEM_BYTES "mem_bytes"
+#define NEU_METRIC_MEM_BYTES_TYPE NEU_METRIC_TYPE_GAUAGE
+#define NEU_METRIC_MEM_BYTES_HELP "Estimated bytes of memory held by the node"
+
+// maintained by neuron core
+// queue of the trans data an app node has received but not yet consumed
+#define NEU_METRIC_TRANS_DATA_QUEUE_DEPTH "trans_data_queue_depth"
+#define NEU_METRIC_TRANS_DATA_QUEUE_DEPTH_TYPE NEU_METRIC_TYPE_GAUAGE
+#define NEU_METRIC_TRANS_DATA_QUEUE_DEPTH_HELP \
+    "Number of trans data messages in the queue"
+#define NEU_METRIC_TRANS_DATA_QUEUE_HIGH_WATER "trans_data_queue_high_water"
+#define NEU_METRIC_TRANS_DATA_QUEUE_HIGH_WATER_TYPE NEU_METRIC_TYPE_GAUAGE
+#define NEU_METRIC_TRANS_DATA_QUEUE_HIGH_WATER_HELP \
+    "Highest number of trans data messages in the queue"
+#define NEU_METRIC_TRANS_DATA_ENQUEUED_TOTAL "trans_data_enqueued_total"
+#define NEU_METRIC_TRANS_DATA_ENQUEUED_TOTAL_TYPE NEU_METRIC_TYPE_COUNTER_SET
+#define NEU_METRIC_TRANS_DATA_ENQUEUED_TOTAL_HELP \
+    "Total number of trans data messages queued"
+#define NEU_METRIC_TRANS_DATA_DEQUEUED_TOTAL "trans_data_dequeued_total"
+#define NEU_METRIC_TRANS_DATA_DEQUEUED_TOTAL_TYPE NEU_METRIC_TYPE_COUNTER_SET
+#define NEU_METRIC_TRANS_DATA_DEQUEUED_TOTAL_HELP \
+    "Total number of trans data messages taken from the queue"
+#define NEU_METRIC_TRANS_DATA_DROPPED_FULL_TOTAL "trans_data_dropped_full_total"
+#define NEU_METRIC_TRANS_DATA_DROPPED_FULL_TOTAL_TYPE \
+    NEU_METRIC_TYPE_COUNTER_SET
+#define NEU_METRIC_TRANS_DATA_DROPPED_FULL_TOTAL_HELP \
+    "Total number of trans data messages dropped on a full queue"
+#define NEU_METRIC_TRANS_DATA_EVICTED_TOTAL "trans_data_evicted_total"
+#define NEU_METRIC_TRANS_DATA_EVICTED_TOTAL_TYPE NEU_METRIC_TYPE_COUNTER_SET
+#define NEU_METRIC_TRANS_DATA_EVICTED_TOTAL_HELP \
+    "Total number of queued trans data messages dropped over the memory budget"
+
+// maintained by neuron core
+// trans data a driver node did not hand to an app, by reason
+#define NEU_METRIC_TRANS_DATA_DROPPED_CONGESTED_TOTAL \
+    "trans_data_dropped_congested_total"
+#define NEU_METRIC_TRANS_DATA_DROPPED_CONGESTED_TOTAL_TYPE \
+    NEU_METRIC_TYPE_COUNTER
+#define NEU_METRIC_TRANS_DATA_DROPPED_CONGESTED_TOTAL_HELP \
+    "Total number of trans data messages skipped for a congested app"
+#define NEU_METRIC_TRANS_DATA_DROPPED_NOBUFS_TOTAL \
+    "trans_data_dropped_nobufs_total"
+#define NEU_METRIC_TRANS_DATA_DROPPED_NOBUFS_TOTAL_TYPE NEU_METRIC_TYPE_COUNTER
+#define NEU_METRIC_TRANS_DATA_DROPPED_NOBUFS_TOTAL_HELP \
+    "Total number of trans data messages dropped on a full app socket"
+#define NEU_METRIC_TRANS_DATA_SEND_ERRORS_TOTAL "trans_data_send_errors_total"
+#define NEU_METRIC_TRANS_DATA_SEND_ERRORS_TOTAL_TYPE NEU_METRIC_TYPE_COUNTER
+#define NEU_METRIC_TRANS_DATA_SEND_ERRORS_TOTAL_HELP \
+    "Total number of trans data messages failed to send for other errors"
+
 // maintained by neuron core
 // number of tags in group
 #define NEU_METRIC_GROUP_TAGS_TOTAL "group_tags_total"
@@ -108,6 +174,75 @@ typedef enum {
 #define NEU_METRIC_GROUP_LAST_TIMER_MS_HELP \
     "Time in milliseconds consumed on last group timer invocation"
 
+// group timer durations in milliseconds
+#define NEU_METRIC_GROUP_TIMER_MS "group_timer_ms"
+#define NEU_METRIC_GROUP_TIMER_MS_TYPE NEU_METRIC_TYPE_HISTOGRAM
+#define NEU_METRIC_GROUP_TIMER_MS_HELP \
+    "Time in milliseconds consumed on group timer invocations"
+
+// maintained by neuron core
+// periods the group timer fell behind its schedule
+#define NEU_METRIC_GROUP_OVERRUNS_TOTAL "group_overruns_total"
+#define NEU_METRIC_GROUP_OVERRUNS_TOTAL_TYPE NEU_METRIC_TYPE_COUNTER
+#define NEU_METRIC_GROUP_OVERRUNS_TOTAL_HELP \
+    "Total number of group timer periods missed or overrun"
+
+// maintained by neuron core
+// milliseconds the last group timer invocation started after its deadline
+#define NEU_METRIC_GROUP_LAST_LAG_MS "group_last_lag_ms"
+#define NEU_METRIC_GROUP_LAST_LAG_MS_TYPE NEU_METRIC_TYPE_GAUAGE
+#define NEU_METRIC_GROUP_LAST_LAG_MS_HELP \
+    "Time in milliseconds the last group timer invocation started late"
+
+// maintained by neuron core
+// milliseconds group timer invocations started after their deadline
+#define NEU_METRIC_GROUP_LAG_MS "group_lag_ms"
+#define NEU_METRIC_GROUP_LAG_MS_TYPE NEU_METRIC_TYPE_HISTOGRAM
+#define NEU_METRIC_GROUP_LAG_MS_HELP \
+    "Time in milliseconds group timer invocations started late"
+
+// maintained by neuron core
+// ticks the overrun policy or the load shedding left without a read
+#define NEU_METRIC_GROUP_SKIPPED_TOTAL "group_skipped_total"
+#define NEU_METRIC_GROUP_SKIPPED_TOTAL_TYPE NEU_METRIC_TYPE_COUNTER
+#define NEU_METRIC_GROUP_SKIPPED_TOTAL_HELP \
+    "Total number of group timer ticks skipped without a read"
+
+// maintained by neuron core
+// microseconds the last expiry of the group timer fired after its deadline
+#define NEU_METRIC_GROUP_TIMER_JITTER_US "group_timer_jitter_us"
+#define NEU_METRIC_GROUP_TIMER_JITTER_US_TYPE NEU_METRIC_TYPE_GAUAGE
+#define NEU_METRIC_GROUP_TIMER_JITTER_US_HELP \
+    "Time in microseconds the last group timer expiry fired late"
+
+// maintained by neuron core
+// the largest group timer jitter since the group was added
+#define NEU_METRIC_GROUP_TIMER_JITTER_MAX_US "group_timer_jitter_max_us"
+#define NEU_METRIC_GROUP_TIMER_JITTER_MAX_US_TYPE NEU_METRIC_TYPE_GAUAGE
+#define NEU_METRIC_GROUP_TIMER_JITTER_MAX_US_HELP \
+    "Time in microseconds the latest group timer expiry fired late"
+
+// maintained by neuron core
+// last group timer invocation time as a percentage of the group interval
+#define NEU_METRIC_GROUP_LOAD_PERCENT "group_load_percent"
+#define NEU_METRIC_GROUP_LOAD_PERCENT_TYPE NEU_METRIC_TYPE_GAUAGE
+#define NEU_METRIC_GROUP_LOAD_PERCENT_HELP \
+    "Last group timer invocation time in percent of the group interval"
+
+// maintained by neuron core
+// load shedding factor, the group reads every so many ticks
+#define NEU_METRIC_GROUP_SHED_FACTOR "group_shed_factor"
+#define NEU_METRIC_GROUP_SHED_FACTOR_TYPE NEU_METRIC_TYPE_GAUAGE
+#define NEU_METRIC_GROUP_SHED_FACTOR_HELP \
+    "Number of group intervals between reads while its apps are congested"
+
+// maintained by neuron core
+// interval the group is read at, stretched by the adapt overrun policy
+#define NEU_METRIC_GROUP_EFFECTIVE_INTERVAL_MS "group_effective_interval_ms"
+#define NEU_METRIC_GROUP_EFFECTIVE_INTERVAL_MS_TYPE NEU_METRIC_TYPE_GAUAGE
+#define NEU_METRIC_GROUP_EFFECTIVE_INTERVAL_MS_HELP \
+    "Time in milliseconds between group reads under the overrun policy"
+
 // maintained by neuron core
 // group last error code
 #define NEU_METRIC_GROUP_LAST_ERROR_CODE "group_last_error_code"
@@ -122,6 +257,12 @@ typedef enum {
 #define NEU_METRIC_GROUP_LAST_ERROR_TS_HELP \
     "Timestamp (ms) of the last encountered error in group data acquisition"
 
+// number of devices the group skips after repeated failures
+#define NEU_METRIC_GROUP_DEVICES_OFFLINE "group_devices_offline"
+#define NEU_METRIC_GROUP_DEVICES_OFFLINE_TYPE NEU_METRIC_TYPE_GAUAGE
+#define NEU_METRIC_GROUP_DEVICES_OFFLINE_HELP \
+    "Number of devices skipped in the group after repeated failures"
+
 // number of messages sent
 #define NEU_METRIC_SEND_MSGS_TOTAL "send_msgs_total"
 #define NEU_METRIC_SEND_MSGS_TOTAL_TYPE NEU_METRIC_TYPE_COUNTER
@@ -133,11 +274,55 @@ typedef enum {
 #define NEU_METRIC_SEND_MSG_ERRORS_TOTAL_HELP \
     "Total number of errors sending messages"
 
+// number of messages dropped as the send queue was full
+#define NEU_METRIC_SEND_MSGS_DROPPED_TOTAL "send_msgs_dropped_total"
+#define NEU_METRIC_SEND_MSGS_DROPPED_TOTAL_TYPE NEU_METRIC_TYPE_COUNTER
+#define NEU_METRIC_SEND_MSGS_DROPPED_TOTAL_HELP \
+    "Total number of messages dropped as the send queue was full"
+
 // number of messages received
 #define NEU_METRIC_RECV_MSGS_TOTAL "recv_msgs_total"
 #define NEU_METRIC_RECV_MSGS_TOTAL_TYPE NEU_METRIC_TYPE_COUNTER
 #define NEU_METRIC_RECV_MSGS_TOTAL_HELP "Total number of messages received"
 
+// time trans data messages waited in the app message queue
+#define NEU_METRIC_TRANS_DATA_QUEUE_MS "trans_data_queue_ms"
+#define NEU_METRIC_TRANS_DATA_QUEUE_MS_TYPE NEU_METRIC_TYPE_HISTOGRAM
+#define NEU_METRIC_TRANS_DATA_QUEUE_MS_HELP \
+    "Time in milliseconds trans data messages waited in the queue"
+
+// time from publishing a message to its acknowledgement
+#define NEU_METRIC_PUBLISH_ACK_MS "publish_ack_ms"
+#define NEU_METRIC_PUBLISH_ACK_MS_TYPE NEU_METRIC_TYPE_HISTOGRAM
+#define NEU_METRIC_PUBLISH_ACK_MS_HELP \
+    "Time in milliseconds from publishing a message to its acknowledgement"
+
+// stage durations of sampled data path traces, see neu_trace_stage_e
+#define NEU_METRIC_TRACE_READ_MS "trace_read_ms"
+#define NEU_METRIC_TRACE_READ_MS_TYPE NEU_METRIC_TYPE_HISTOGRAM
+#define NEU_METRIC_TRACE_READ_MS_HELP \
+    "Traced time in milliseconds reading the device"
+#define NEU_METRIC_TRACE_CACHE_MS "trace_cache_ms"
+#define NEU_METRIC_TRACE_CACHE_MS_TYPE NEU_METRIC_TYPE_HISTOGRAM
+#define NEU_METRIC_TRACE_CACHE_MS_HELP \
+    "Traced time in milliseconds values stayed in the cache until reported"
+#define NEU_METRIC_TRACE_TRANSFER_MS "trace_transfer_ms"
+#define NEU_METRIC_TRACE_TRANSFER_MS_TYPE NEU_METRIC_TYPE_HISTOGRAM
+#define NEU_METRIC_TRACE_TRANSFER_MS_HELP \
+    "Traced time in milliseconds passing reports to the app"
+#define NEU_METRIC_TRACE_QUEUE_MS "trace_queue_ms"
+#define NEU_METRIC_TRACE_QUEUE_MS_TYPE NEU_METRIC_TYPE_HISTOGRAM
+#define NEU_METRIC_TRACE_QUEUE_MS_HELP \
+    "Traced time in milliseconds reports waited in the app queue"
+#define NEU_METRIC_TRACE_DELIVER_MS "trace_deliver_ms"
+#define NEU_METRIC_TRACE_DELIVER_MS_TYPE NEU_METRIC_TYPE_HISTOGRAM
+#define NEU_METRIC_TRACE_DELIVER_MS_HELP \
+    "Traced time in milliseconds the app took to deliver reports"
+#define NEU_METRIC_TRACE_TOTAL_MS "trace_total_ms"
+#define NEU_METRIC_TRACE_TOTAL_MS_TYPE NEU_METRIC_TYPE_HISTOGRAM
+#define NEU_METRIC_TRACE_TOTAL_MS_HELP \
+    "Traced time in milliseconds from device read to delivery"
+
 // number of trans data message within the last 5 seconds
 #define NEU_METRIC_TRANS_DATA_5S "last_5s_trans_data_msgs"
 #define NEU_METRIC_TRANS_DATA_5S_TYPE NEU_METRIC_TYPE_ROLLING_COUNTER
@@ -228,6 +413,23 @@ typedef enum {
 #define NEU_METRIC_DISCONNECTION_1800S_HELP \
     "Number of disconnection within the last 1800 seconds"
 
+// the init of a rolling counter registered with bins of `res` milliseconds
+// over `span` milliseconds, a bare span registers the default resolution
+#define NEU_METRIC_ROLLING(span, res) (((uint64_t)(res) << 32) | (span))
+
+// The metrics turned off with neu_metrics_set_off are never registered, and
+// their updates return before any lock or lookup, see neu_metric_off.
+#define NEU_METRICS_OFF_ROLLING 0x1   // the rolling counters, last_<N>s_*
+#define NEU_METRICS_OFF_HISTOGRAM 0x2 // the histograms
+#define NEU_METRICS_OFF_GROUP 0x4     // the per group series
+#define NEU_METRICS_OFF_WINDOWS 0x8   // the rolling counters of other windows
+
+// most rolling windows neu_metrics_set_windows keeps
+#define NEU_METRICS_WINDOWS_MAX 8
+
+// set once at start, before any node
+extern uint32_t neu_metrics_off;
+
 typedef enum {
     NEU_METRICS_CATEGORY_GLOBAL,
     NEU_METRICS_CATEGORY_DRIVER,
@@ -242,6 +444,7 @@ typedef struct {
     neu_metric_type_e      type;  //
     uint64_t               value; //
     neu_rolling_counter_t *rcnt;  //
+    neu_histogram_t *      hist;  // histogram buckets
     UT_hash_handle         hh;    // ordered by name
 } neu_metric_entry_t;
 
@@ -287,6 +490,10 @@ typedef struct {
     size_t              south_nodes;
     size_t              south_running_nodes;
     size_t              south_disconnected_nodes;
+    size_t              mem_budget_bytes;    // 0 for no budget
+    size_t              mem_accounted_bytes; // by all the nodes
+    uint64_t            reconnects_deferred; // over the reconnect rate
+    uint64_t            log_dropped_lines;   // by the log writer
     neu_node_metrics_t *node_metrics;
     neu_metric_entry_t *registered_metrics;
 } neu_metrics_t;
@@ -298,13 +505,67 @@ int  neu_metrics_register_entry(const char *name, const char *help,
                                 neu_metric_type_e type);
 void neu_metrics_unregister_entry(const char *name);
 
+// `cb` is called with a copy of the metrics, without holding any lock, host
+// stats are those of the last background sample
 typedef void (*neu_metrics_cb_t)(const neu_metrics_t *metrics, void *data);
 void neu_metrics_visist(neu_metrics_cb_t cb, void *data);
 
+/** Push the metrics of the scrape to the Prometheus remote write endpoint at
+ * `url` every `interval` seconds from a background thread, snappy compressed
+ * and labelled with the host name as the instance. The batches the endpoint
+ * fails to take are retried in order on the next rounds, the oldest ones
+ * dropped past a few of them.
+ * @return 0 on success, -1 on an invalid url or if already started.
+ */
+int  neu_metrics_push_start(const char *url, uint32_t interval);
+void neu_metrics_push_stop();
+
+/** Parse a comma separated list of rolling, histogram and group, or none.
+ * @return 0 on success, -1 on an unknown item.
+ */
+int neu_metrics_off_parse(const char *s, uint32_t *off);
+
+/** Parse a comma separated list of window seconds, such as 5,60.
+ * @return the number of windows, -1 on an invalid list.
+ */
+int neu_metrics_windows_parse(const char *s, uint32_t *windows, int max);
+
+// turn the NEU_METRICS_OFF_* categories of `off` off
+void neu_metrics_set_off(uint32_t off);
+// keep only the rolling counters over these windows of seconds, all if n is 0
+void neu_metrics_set_windows(const uint32_t *windows, int n);
+// whether the window of seconds of the rolling counter `name` is not kept
+bool neu_metrics_window_off(const char *name);
+
+// whether updates of the metric are dropped, never registered, ahead of any
+// lock, `group` for the series of a group
+static inline bool neu_metric_off(const char *name, neu_metric_type_e type,
+                                  bool group)
+{
+    uint32_t off = neu_metrics_off;
+
+    if (0 == off) {
+        return false;
+    }
+    if (group && (off & NEU_METRICS_OFF_GROUP)) {
+        return true;
+    }
+    if (NEU_METRIC_TYPE_HISTOGRAM == type) {
+        return off & NEU_METRICS_OFF_HISTOGRAM;
+    }
+    if (NEU_METRIC_TYPE_ROLLING_COUNTER == type) {
+        return (off & NEU_METRICS_OFF_ROLLING) ||
+            ((off & NEU_METRICS_OFF_WINDOWS) && neu_metrics_window_off(name));
+    }
+    return false;
+}
+
 static inline const char *neu_metric_type_str(neu_metric_type_e type)
 {
     if (NEU_METRIC_TYPE_COUNTER == type) {
         return "counter";
+    } else if (NEU_METRIC_TYPE_HISTOGRAM == type) {
+        return "histogram";
     } else {
         return "gauge";
     }
@@ -319,6 +580,7 @@ static inline void neu_metric_entry_free(neu_metric_entry_t *entry)
     if (NEU_METRIC_TYPE_ROLLING_COUNTER == entry->type) {
         neu_rolling_counter_free(entry->rcnt);
     }
+    neu_histogram_free(entry->hist);
     free(entry);
 }
 
@@ -387,6 +649,10 @@ static inline int neu_node_metrics_add(neu_node_metrics_t *node_metrics,
 {
     int rv = 0;
 
+    if (neu_metric_off(name, type, NULL != group_name)) {
+        return 0;
+    }
+
     if (0 > neu_metrics_register_entry(name, help, type)) {
         return -1;
     }
@@ -423,6 +689,51 @@ static inline int neu_node_metrics_add(neu_node_metrics_t *node_metrics,
     return rv;
 }
 
+// entries are updated with relaxed atomics and read with atomic loads, so
+// need no lock
+static inline void neu_metric_entry_update(neu_metric_entry_t *entry,
+                                           uint64_t            n)
+{
+    if (NEU_METRIC_TYPE_COUNTER == entry->type) {
+        __atomic_add_fetch(&entry->value, n, __ATOMIC_RELAXED);
+    } else if (NEU_METRIC_TYPE_HISTOGRAM == entry->type) {
+        neu_histogram_observe(entry->hist, n);
+    } else if (NEU_METRIC_TYPE_ROLLING_COUNTER == entry->type) {
+        // summed up by the snapshot
+        neu_rolling_counter_add(entry->rcnt, global_timestamp, n);
+    } else {
+        __atomic_store_n(&entry->value, n, __ATOMIC_RELAXED);
+    }
+}
+
+/**
+ * @brief Find a node metric entry once, to update it on hot paths with
+ *        neu_node_metrics_update_entry instead of looking it up by name.
+ *
+ * Node entries live as long as the node metrics. Group entries are freed with
+ * their group, so they are only found by name with neu_node_metrics_update.
+ *
+ * @return the entry, NULL if the metric is not registered for the node.
+ */
+static inline neu_metric_entry_t *
+neu_node_metrics_find(neu_node_metrics_t *node_metrics, const char *name)
+{
+    neu_metric_entry_t *entry = NULL;
+
+    pthread_mutex_lock(&node_metrics->lock);
+    HASH_FIND_STR(node_metrics->entries, name, entry);
+    pthread_mutex_unlock(&node_metrics->lock);
+    return entry;
+}
+
+static inline void
+neu_node_metrics_update_entry(neu_node_metrics_t *node_metrics,
+                              neu_metric_entry_t *entry, uint64_t n)
+{
+    (void) node_metrics;
+    neu_metric_entry_update(entry, n);
+}
+
 static inline int neu_node_metrics_update(neu_node_metrics_t *node_metrics,
                                           const char *        group,
                                           const char *metric_name, uint64_t n)
@@ -445,14 +756,7 @@ static inline int neu_node_metrics_update(neu_node_metrics_t *node_metrics,
         return -1;
     }
 
-    if (NEU_METRIC_TYPE_COUNTER == entry->type) {
-        entry->value += n;
-    } else if (NEU_METRIC_TYPE_ROLLING_COUNTER == entry->type) {
-        entry->value =
-            neu_rolling_counter_inc(entry->rcnt, global_timestamp, n);
-    } else {
-        entry->value = n;
-    }
+    neu_metric_entry_update(entry, n);
     pthread_mutex_unlock(&node_metrics->lock);
 
     return 0;
@@ -465,9 +769,11 @@ static inline void neu_node_metrics_reset(neu_node_metrics_t *node_metrics)
     pthread_mutex_lock(&node_metrics->lock);
     HASH_LOOP(hh, node_metrics->entries, entry)
     {
-        entry->value = 0;
+        __atomic_store_n(&entry->value, 0, __ATOMIC_RELAXED);
         if (NEU_METRIC_TYPE_ROLLING_COUNTER == entry->type) {
             neu_rolling_counter_reset(entry->rcnt);
+        } else if (NEU_METRIC_TYPE_HISTOGRAM == entry->type) {
+            neu_histogram_reset(entry->hist);
         }
     }
 
@@ -476,9 +782,11 @@ static inline void neu_node_metrics_reset(neu_node_metrics_t *node_metrics)
     {
         HASH_LOOP(hh, g->entries, entry)
         {
-            entry->value = 0;
+            __atomic_store_n(&entry->value, 0, __ATOMIC_RELAXED);
             if (NEU_METRIC_TYPE_ROLLING_COUNTER == entry->type) {
                 neu_rolling_counter_reset(entry->rcnt);
+            } else if (NEU_METRIC_TYPE_HISTOGRAM == entry->type) {
+                neu_histogram_reset(entry->hist);
             }
         }
     }
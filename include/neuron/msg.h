@@ -28,6 +28,7 @@ extern "C" {
 #include <stdint.h>
 
 #include "json/neu_json_rw.h"
+#include "utils/time.h"
 
 #include "define.h"
 #include "tag.h"
@@ -60,6 +61,7 @@ typedef enum neu_reqresp_type {
     NEU_REQ_NODE_INIT,
     NEU_REQ_NODE_UNINIT,
     NEU_RESP_NODE_UNINIT,
+    NEU_REQ_NODE_RELOAD,
     NEU_REQ_ADD_NODE,
     NEU_REQ_UPDATE_NODE,
     NEU_REQ_DEL_NODE,
@@ -90,11 +92,15 @@ typedef enum neu_reqresp_type {
     NEU_RESP_ADD_TAG,
     NEU_REQ_ADD_GTAG,
     NEU_RESP_ADD_GTAG,
+    NEU_REQ_APPLY_GTAG,
+    NEU_RESP_APPLY_GTAG,
     NEU_REQ_DEL_TAG,
     NEU_REQ_UPDATE_TAG,
     NEU_RESP_UPDATE_TAG,
     NEU_REQ_GET_TAG,
     NEU_RESP_GET_TAG,
+    NEU_REQ_GET_TAG_HISTORY,
+    NEU_RESP_GET_TAG_HISTORY,
 
     NEU_REQ_ADD_PLUGIN,
     NEU_REQ_DEL_PLUGIN,
@@ -109,11 +115,13 @@ typedef enum neu_reqresp_type {
     NEU_REQ_ADD_DRIVERS,
 
     NEU_REQ_UPDATE_LOG_LEVEL,
+    NEU_REQ_UPDATE_LOG_CAPTURE,
 
     NEU_REQ_PRGFILE_UPLOAD,
     NEU_REQ_PRGFILE_PROCESS,
     NEU_RESP_PRGFILE_PROCESS,
 
+    NEU_REQRESP_TRANS_DATA_BATCH,
 } neu_reqresp_type_e;
 
 static const char *neu_reqresp_type_string_t[] = {
@@ -137,6 +145,7 @@ static const char *neu_reqresp_type_string_t[] = {
     [NEU_REQ_NODE_INIT]         = "NEU_REQ_NODE_INIT",
     [NEU_REQ_NODE_UNINIT]       = "NEU_REQ_NODE_UNINIT",
     [NEU_RESP_NODE_UNINIT]      = "NEU_RESP_NODE_UNINIT",
+    [NEU_REQ_NODE_RELOAD]       = "NEU_REQ_NODE_RELOAD",
     [NEU_REQ_ADD_NODE]          = "NEU_REQ_ADD_NODE",
     [NEU_REQ_UPDATE_NODE]       = "NEU_REQ_UPDATE_NODE",
     [NEU_REQ_DEL_NODE]          = "NEU_REQ_DEL_NODE",
@@ -167,12 +176,17 @@ static const char *neu_reqresp_type_string_t[] = {
     [NEU_RESP_ADD_TAG]    = "NEU_RESP_ADD_TAG",
     [NEU_REQ_ADD_GTAG]    = "NEU_REQ_ADD_GTAG",
     [NEU_RESP_ADD_GTAG]   = "NEU_RESP_ADD_GTAG",
+    [NEU_REQ_APPLY_GTAG]  = "NEU_REQ_APPLY_GTAG",
+    [NEU_RESP_APPLY_GTAG] = "NEU_RESP_APPLY_GTAG",
     [NEU_REQ_DEL_TAG]     = "NEU_REQ_DEL_TAG",
     [NEU_REQ_UPDATE_TAG]  = "NEU_REQ_UPDATE_TAG",
     [NEU_RESP_UPDATE_TAG] = "NEU_RESP_UPDATE_TAG",
     [NEU_REQ_GET_TAG]     = "NEU_REQ_GET_TAG",
     [NEU_RESP_GET_TAG]    = "NEU_RESP_GET_TAG",
 
+    [NEU_REQ_GET_TAG_HISTORY]  = "NEU_REQ_GET_TAG_HISTORY",
+    [NEU_RESP_GET_TAG_HISTORY] = "NEU_RESP_GET_TAG_HISTORY",
+
     [NEU_REQ_ADD_PLUGIN]    = "NEU_REQ_ADD_PLUGIN",
     [NEU_REQ_DEL_PLUGIN]    = "NEU_REQ_DEL_PLUGIN",
     [NEU_REQ_UPDATE_PLUGIN] = "NEU_REQ_UPDATE_PLUGIN",
@@ -185,10 +199,13 @@ static const char *neu_reqresp_type_string_t[] = {
 
     [NEU_REQ_ADD_DRIVERS] = "NEU_REQ_ADD_DRIVERS",
 
-    [NEU_REQ_UPDATE_LOG_LEVEL] = "NEU_REQ_UPDATE_LOG_LEVEL",
-    [NEU_REQ_PRGFILE_UPLOAD]   = "NEU_REQ_PRGFILE_UPLOAD",
-    [NEU_REQ_PRGFILE_PROCESS]  = "NEU_REQ_PRGFILE_PROCESS",
-    [NEU_RESP_PRGFILE_PROCESS] = "NEU_RESP_PRGFILE_PROCESS",
+    [NEU_REQ_UPDATE_LOG_LEVEL]   = "NEU_REQ_UPDATE_LOG_LEVEL",
+    [NEU_REQ_UPDATE_LOG_CAPTURE] = "NEU_REQ_UPDATE_LOG_CAPTURE",
+    [NEU_REQ_PRGFILE_UPLOAD]     = "NEU_REQ_PRGFILE_UPLOAD",
+    [NEU_REQ_PRGFILE_PROCESS]    = "NEU_REQ_PRGFILE_PROCESS",
+    [NEU_RESP_PRGFILE_PROCESS]   = "NEU_RESP_PRGFILE_PROCESS",
+
+    [NEU_REQRESP_TRANS_DATA_BATCH] = "NEU_REQRESP_TRANS_DATA_BATCH",
 };
 
 inline static const char *neu_reqresp_type_string(neu_reqresp_type_e type)
@@ -202,6 +219,7 @@ typedef struct neu_reqresp_head {
     char               sender[NEU_NODE_NAME_LEN];
     char               receiver[NEU_NODE_NAME_LEN];
     uint32_t           len;
+    uint16_t           reply_port; // reply port of a direct request sender
 } neu_reqresp_head_t;
 
 typedef struct neu_resp_error {
@@ -213,6 +231,13 @@ typedef struct {
     neu_node_running_state_e state;
 } neu_req_node_init_t, neu_req_node_uninit_t, neu_resp_node_uninit_t;
 
+// swap the plugin of a node for a new build of the same library in place
+typedef struct {
+    char  node[NEU_NODE_NAME_LEN];
+    void *handle; // of the new library, the node owns it once received
+    void *module; // neu_plugin_module_t of the new library
+} neu_req_node_reload_t;
+
 typedef struct neu_req_add_plugin {
     char  library[NEU_PLUGIN_LIBRARY_LEN];
     char *schema_file;
@@ -424,15 +449,39 @@ static inline int neu_req_del_tag_copy(neu_req_del_tag_t *dst,
 }
 
 typedef struct neu_req_get_tag {
-    char driver[NEU_NODE_NAME_LEN];
-    char group[NEU_GROUP_NAME_LEN];
-    char name[NEU_TAG_NAME_LEN];
+    char     driver[NEU_NODE_NAME_LEN];
+    char     group[NEU_GROUP_NAME_LEN];
+    char     name[NEU_TAG_NAME_LEN];
+    uint8_t  type;      // neu_type_e, 0 for any
+    uint8_t  attribute; // every bit set, 0 for any
+    // the last tag of the previous page, empty for the first page
+    char     after[NEU_TAG_NAME_LEN];
+    uint32_t offset;
+    uint32_t limit; // 0 for the whole group
 } neu_req_get_tag_t;
 
 typedef struct neu_resp_get_tag {
-    UT_array *tags; // array neu_datatag_t
+    UT_array *tags;  // array neu_datatag_t
+    uint32_t  total; // tags matching the filters of the request
 } neu_resp_get_tag_t;
 
+// the samples a driver keeps of a tag, see neu_history_query
+typedef struct neu_req_get_tag_history {
+    char     driver[NEU_NODE_NAME_LEN];
+    char     group[NEU_GROUP_NAME_LEN];
+    char     tag[NEU_TAG_NAME_LEN];
+    int64_t  since; // ms, inclusive
+    int64_t  until; // ms, exclusive
+    int64_t  step;  // ms of the buckets, 0 for every sample
+    uint32_t limit; // most points
+} neu_req_get_tag_history_t;
+
+typedef struct neu_resp_get_tag_history {
+    UT_array *points;    // array neu_history_point_t
+    int64_t   step;      // of the request
+    bool      truncated; // limit points were taken before until
+} neu_resp_get_tag_history_t;
+
 typedef struct {
     char     app[NEU_NODE_NAME_LEN];
     char     driver[NEU_NODE_NAME_LEN];
@@ -597,11 +646,13 @@ typedef struct {
 } neu_resp_get_nodes_state_t, neu_reqresp_nodes_state_t;
 
 typedef struct neu_req_read_group {
-    char *driver;
-    char *group;
-    char *name;
-    char *desc;
-    bool  sync;
+    char *   driver;
+    char *   group;
+    char *   name;
+    char *   desc;
+    bool     sync;
+    uint32_t max_age; // ms, a sync read may take a device read this recent
+    int64_t  issued;  // monotonic ms, stamped by the sending adapter
 } neu_req_read_group_t;
 
 static inline void neu_req_read_group_fini(neu_req_read_group_t *req)
@@ -617,6 +668,8 @@ typedef struct neu_req_write_tag {
     char *       group;
     char *       tag;
     neu_dvalue_t value;
+    bool         preempt; // may run between the read commands of a poll
+    bool         verify;  // answered once the device reads the value back
 } neu_req_write_tag_t;
 
 static inline void neu_req_write_tag_fini(neu_req_write_tag_t *req)
@@ -632,7 +685,7 @@ typedef struct neu_resp_tag_value {
 } neu_resp_tag_value_t;
 
 typedef struct neu_resp_tag_value_meta {
-    char           tag[NEU_TAG_NAME_LEN];
+    const char *   tag; // interned, see utils/intern.h
     neu_dvalue_t   value;
     neu_tag_meta_t metas[NEU_TAG_META_SIZE];
 } neu_resp_tag_value_meta_t;
@@ -649,6 +702,8 @@ typedef struct neu_req_write_tags {
 
     int                   n_tag;
     neu_resp_tag_value_t *tags;
+    bool                  preempt; // see neu_req_write_tag_t
+    bool                  verify;  // see neu_req_write_tag_t
 } neu_req_write_tags_t;
 
 static inline void neu_req_write_tags_fini(neu_req_write_tags_t *req)
@@ -676,6 +731,7 @@ typedef struct {
 
     int                   n_group;
     neu_req_gtag_group_t *groups;
+    bool                  preempt; // see neu_req_write_tag_t
 } neu_req_write_gtags_t;
 
 static inline void neu_req_write_gtags_fini(neu_req_write_gtags_t *req)
@@ -699,7 +755,7 @@ static inline void neu_resp_read_free(neu_resp_read_group_t *resp)
     utarray_foreach(resp->tags, neu_resp_tag_value_meta_t *, tag_value)
     {
         if (tag_value->value.type == NEU_TYPE_PTR) {
-            free(tag_value->value.value.ptr.ptr);
+            neu_value_ptr_put(tag_value->value.value.ptr.ptr);
         }
     }
     free(resp->driver);
@@ -707,19 +763,129 @@ static inline void neu_resp_read_free(neu_resp_read_group_t *resp)
     utarray_free(resp->tags);
 }
 
+// the upload payloads apps share through the snapshot they are encoded from
+typedef enum {
+    NEU_TRANS_ENCODED_JSON_TAGS = 1, // neu_json_stream_read_periodic_resp
+    NEU_TRANS_ENCODED_JSON_VALUES,   // neu_json_stream_read_periodic_resp1
+    NEU_TRANS_ENCODED_JSON_EKUIPER,  // with the node_name and group_name keys
+} neu_trans_encoded_format_e;
+
+#define NEU_TRANS_ENCODED_MAX 3
+
+typedef enum {
+    NEU_TRANS_ENCODED_FREE = 0,
+    NEU_TRANS_ENCODED_CLAIMED,
+    NEU_TRANS_ENCODED_READY,
+} neu_trans_encoded_state_e;
+
+// state is only ever touched atomically, the rest is written once by the
+// app that claimed the slot before it turns ready
+typedef struct {
+    uint32_t state;
+    uint32_t format;
+    size_t   len;
+    char *   buf;
+} neu_trans_encoded_t;
+
+// one snapshot of a group is shared read-only by every app it is delivered
+// to, index counts the holders and is only ever touched atomically. The
+// snapshot is a single block, the ctx with its tags array and the room for
+// the tag values, so the last holder releases the whole report at once
 typedef struct {
-    uint16_t        index;
-    pthread_mutex_t mtx;
+    uint16_t            index;
+    neu_trans_encoded_t encoded[NEU_TRANS_ENCODED_MAX];
+    UT_array            tags; // neu_resp_tag_value_meta_t, follow the ctx
 } neu_reqresp_trans_data_ctx_t;
 
+// a snapshot with room for n tag values, the tags must never grow past n as
+// their elements are not a heap block of their own
+static inline neu_reqresp_trans_data_ctx_t *neu_trans_data_ctx_new(uint32_t n)
+{
+    neu_reqresp_trans_data_ctx_t *ctx =
+        (neu_reqresp_trans_data_ctx_t *) malloc(
+            sizeof(neu_reqresp_trans_data_ctx_t) +
+            (size_t) n * sizeof(neu_resp_tag_value_meta_t));
+
+    if (NULL != ctx) {
+        memset(ctx, 0, sizeof(*ctx));
+        ctx->tags.icd = *neu_resp_tag_value_meta_icd();
+        ctx->tags.n   = n;
+        ctx->tags.d   = (char *) &ctx[1];
+    }
+    return ctx;
+}
+
+// free a snapshot with the pointer values of its tags
+static inline void neu_trans_data_ctx_free(neu_reqresp_trans_data_ctx_t *ctx)
+{
+    utarray_foreach(&ctx->tags, neu_resp_tag_value_meta_t *, tag_value)
+    {
+        if (tag_value->value.type == NEU_TYPE_PTR) {
+            neu_value_ptr_put(tag_value->value.value.ptr.ptr);
+        }
+    }
+    for (int i = 0; i < NEU_TRANS_ENCODED_MAX; ++i) {
+        free(ctx->encoded[i].buf);
+    }
+    free(ctx);
+}
+
+static inline void neu_trans_data_ctx_init(neu_reqresp_trans_data_ctx_t *ctx,
+                                           uint16_t                      ref)
+{
+    __atomic_store_n(&ctx->index, ref, __ATOMIC_RELAXED);
+}
+
+// stages of the data path, in order, that a sampled trans data message is
+// stamped at
+typedef enum {
+    NEU_TRACE_READ,    // group read started
+    NEU_TRACE_CACHED,  // group read finished, values are in the cache
+    NEU_TRACE_REPORT,  // report snapshot taken
+    NEU_TRACE_ENQUEUE, // queued for the app
+    NEU_TRACE_DEQUEUE, // handed to the app plugin
+    NEU_TRACE_ACK,     // delivered north bound
+    NEU_TRACE_STAGES,
+} neu_trace_stage_e;
+
+// milliseconds timestamps of the stages, all zero if not sampled
 typedef struct {
-    char *driver;
-    char *group;
+    int64_t ts[NEU_TRACE_STAGES];
+} neu_trace_t;
+
+static inline bool neu_trace_sampled(const neu_trace_t *trace)
+{
+    return 0 != trace->ts[NEU_TRACE_REPORT];
+}
+
+static inline void neu_trace_stamp(neu_trace_t *trace, neu_trace_stage_e stage)
+{
+    if (neu_trace_sampled(trace)) {
+        trace->ts[stage] = neu_time_ms();
+    }
+}
+
+// trace one in every n reports of a driver, 0 disables tracing
+void     neu_trace_set_sample(uint32_t n);
+uint32_t neu_trace_sample();
+
+typedef struct {
+    char *driver; // interned, never freed
+    char *group;  // interned, never freed
 
     neu_reqresp_trans_data_ctx_t *ctx;
-    UT_array *                    tags; // neu_resp_tag_value_meta_t
+    UT_array *                    tags; // &ctx->tags
+
+    neu_trace_t trace; // per message, not shared through ctx
 } neu_reqresp_trans_data_t;
 
+// groups of one driver reported in the same tick, each entry shares its
+// payload with the other apps the group is delivered to through its ctx
+typedef struct {
+    uint16_t                  n_data;
+    neu_reqresp_trans_data_t *datas;
+} neu_reqresp_trans_data_batch_t;
+
 typedef struct {
     char *          node;
     char *          plugin;
@@ -755,35 +921,104 @@ static inline void neu_req_driver_array_fini(neu_req_driver_array_t *req)
     free(req->drivers);
 }
 
-static inline void neu_trans_data_free(neu_reqresp_trans_data_t *data)
+// the payload of format another app encoded the snapshot of data to, NULL if
+// none did yet, it lives as long as the snapshot
+static inline const char *
+neu_trans_data_encoded(const neu_reqresp_trans_data_t *data, uint32_t format,
+                       size_t *len)
 {
-    pthread_mutex_lock(&data->ctx->mtx);
-    if (data->ctx->index > 0) {
-        data->ctx->index -= 1;
+    neu_reqresp_trans_data_ctx_t *ctx = data->ctx;
+
+    // a subset of the snapshot, encoded on its own
+    if (data->tags != &ctx->tags) {
+        return NULL;
     }
 
-    if (data->ctx->index == 0) {
-        utarray_foreach(data->tags, neu_resp_tag_value_meta_t *, tag_value)
-        {
-            if (tag_value->value.type == NEU_TYPE_PTR) {
-                free(tag_value->value.value.ptr.ptr);
-            }
+    for (int i = 0; i < NEU_TRANS_ENCODED_MAX; ++i) {
+        neu_trans_encoded_t *e = &ctx->encoded[i];
+
+        if (NEU_TRANS_ENCODED_READY ==
+                __atomic_load_n(&e->state, __ATOMIC_ACQUIRE) &&
+            e->format == format) {
+            *len = e->len;
+            return e->buf;
+        }
+    }
+    return NULL;
+}
+
+// hand the payload of format encoded from data to the apps the snapshot is
+// still to be delivered to, copied only if there are such apps
+static inline void neu_trans_data_encoded_share(neu_reqresp_trans_data_t *data,
+                                                uint32_t    format,
+                                                const void *buf, size_t len)
+{
+    neu_reqresp_trans_data_ctx_t *ctx = data->ctx;
+    size_t                        n   = 0;
+
+    if (data->tags != &ctx->tags ||
+        __atomic_load_n(&ctx->index, __ATOMIC_RELAXED) < 2 ||
+        NULL != neu_trans_data_encoded(data, format, &n)) {
+        return;
+    }
+
+    for (int i = 0; i < NEU_TRANS_ENCODED_MAX; ++i) {
+        neu_trans_encoded_t *e     = &ctx->encoded[i];
+        uint32_t             state = NEU_TRANS_ENCODED_FREE;
+
+        if (!__atomic_compare_exchange_n(&e->state, &state,
+                                         NEU_TRANS_ENCODED_CLAIMED, false,
+                                         __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            continue;
+        }
+
+        e->buf = (char *) malloc(len);
+        if (NULL == e->buf) {
+            __atomic_store_n(&e->state, NEU_TRANS_ENCODED_FREE,
+                             __ATOMIC_RELAXED);
+            return;
         }
-        utarray_free(data->tags);
-        free(data->group);
-        free(data->driver);
-        pthread_mutex_unlock(&data->ctx->mtx);
-        pthread_mutex_destroy(&data->ctx->mtx);
-        free(data->ctx);
+        memcpy(e->buf, buf, len);
+        e->format = format;
+        e->len    = len;
+        __atomic_store_n(&e->state, NEU_TRANS_ENCODED_READY, __ATOMIC_RELEASE);
+        return;
+    }
+}
+
+static inline void neu_trans_data_free(neu_reqresp_trans_data_t *data)
+{
+    // the last holder releases the snapshot, acq_rel orders every other
+    // holder's reads before the free
+    if (__atomic_sub_fetch(&data->ctx->index, 1, __ATOMIC_ACQ_REL) == 0) {
+        neu_trans_data_ctx_free(data->ctx);
+    }
+}
+
+static inline void
+neu_trans_data_batch_free(neu_reqresp_trans_data_batch_t *batch)
+{
+    for (uint16_t i = 0; i < batch->n_data; ++i) {
+        neu_trans_data_free(&batch->datas[i]);
+    }
+    free(batch->datas);
+}
+
+// free the payload of a NEU_REQRESP_TRANS_DATA(_BATCH) message
+static inline void neu_trans_data_head_free(neu_reqresp_head_t *header)
+{
+    if (header->type == NEU_REQRESP_TRANS_DATA_BATCH) {
+        neu_trans_data_batch_free(
+            (neu_reqresp_trans_data_batch_t *) &header[1]);
     } else {
-        pthread_mutex_unlock(&data->ctx->mtx);
+        neu_trans_data_free((neu_reqresp_trans_data_t *) &header[1]);
     }
 }
 
 static inline void neu_tag_value_to_json(neu_resp_tag_value_meta_t *tag_value,
                                          neu_json_read_resp_tag_t * tag_json)
 {
-    tag_json->name  = tag_value->tag;
+    tag_json->name  = (char *) tag_value->tag;
     tag_json->error = 0;
 
     for (int k = 0; k < NEU_TAG_META_SIZE; k++) {
@@ -886,6 +1121,12 @@ typedef struct neu_req_update_log_level {
     bool core;
 } neu_req_update_log_level_t;
 
+typedef struct neu_req_update_log_capture {
+    char     node[NEU_NODE_NAME_LEN];
+    bool     enable;
+    uint32_t n_packet;
+} neu_req_update_log_capture_t;
+
 void neu_msg_gen(neu_reqresp_head_t *header, void *data);
 
 inline static void neu_msg_exchange(neu_reqresp_head_t *header)
@@ -28,6 +28,7 @@ extern "C" {
 
 #include "adapter_info.h"
 #include "persist/json/persist_json_plugin.h"
+#include "utils/tuning.h"
 
 typedef neu_json_plugin_req_plugin_t neu_persist_plugin_info_t;
 
@@ -43,6 +44,12 @@ typedef struct {
     char *   name;
 } neu_persist_group_info_t;
 
+typedef struct {
+    char *    name;
+    uint32_t  interval;
+    UT_array *tags; // vector of neu_datatag_t
+} neu_persist_group_tags_t;
+
 typedef struct {
     char *driver_name;
     char *group_name;
@@ -54,6 +61,22 @@ typedef struct {
     char *hash;
 } neu_persist_user_info_t;
 
+typedef struct {
+    char *   name;
+    uint64_t changes;
+} neu_persist_tag_profile_t;
+
+// read statistics of a group, see neu_tuning_group_t
+typedef struct {
+    char *    group_name;
+    uint64_t  reads;
+    uint64_t  read_ms;
+    uint64_t  overruns;
+    uint64_t  blocks;
+    uint64_t  latency[NEU_TUNING_LATENCY_N];
+    UT_array *tags; // vector of neu_persist_tag_profile_t
+} neu_persist_group_profile_t;
+
 static inline void neu_persist_plugin_infos_free(UT_array *plugin_infos)
 {
     utarray_free(plugin_infos);
@@ -70,6 +93,14 @@ static inline void neu_persist_group_info_fini(neu_persist_group_info_t *info)
     free(info->name);
 }
 
+static inline void neu_persist_group_tags_fini(neu_persist_group_tags_t *info)
+{
+    free(info->name);
+    if (NULL != info->tags) {
+        utarray_free(info->tags);
+    }
+}
+
 static inline void
 neu_persist_subscription_info_fini(neu_persist_subscription_info_t *info)
 {
@@ -84,15 +115,52 @@ static inline void neu_persist_user_info_fini(neu_persist_user_info_t *info)
     free(info->hash);
 }
 
+static inline void
+neu_persist_tag_profile_fini(neu_persist_tag_profile_t *profile)
+{
+    free(profile->name);
+}
+
+static inline UT_icd *neu_persist_tag_profile_icd()
+{
+    static UT_icd icd = {
+        sizeof(neu_persist_tag_profile_t),
+        NULL,
+        NULL,
+        (dtor_f *) neu_persist_tag_profile_fini,
+    };
+    return &icd;
+}
+
+static inline void
+neu_persist_group_profile_fini(neu_persist_group_profile_t *profile)
+{
+    free(profile->group_name);
+    if (NULL != profile->tags) {
+        utarray_free(profile->tags);
+    }
+}
+
 /**
  * Create persister.
  * @return 0 on success, -1 otherwise.
  */
 int neu_persister_create(const char *schema_dir);
+/**
+ * Create persister on a database in memory, nothing is read from or written
+ * to the persistence directory.
+ * @return 0 on success, -1 otherwise.
+ */
+int neu_persister_create_memory(const char *schema_dir);
 /**
  * Destroy perister.
  */
 void neu_persister_destroy();
+/**
+ * Wait until every write made so far is persisted, writes return once queued.
+ * @return 0 on success, non-zero on failure
+ */
+int neu_persister_flush();
 
 sqlite3 *neu_persister_get_db();
 
@@ -191,6 +259,18 @@ int neu_persister_update_tag_value(const char *         driver_name,
                                    const char *         group_name,
                                    const neu_datatag_t *tag);
 
+/**
+ * Update the values of several node tags of one group.
+ * @param driver_name               name of the driver who owns the tags
+ * @param group_name                name of the group
+ * @param tags                      the tags to update
+ * @param n                         number of tags
+ * @return 0 on success, non-zero otherwise
+ */
+int neu_persister_update_tag_values(const char *         driver_name,
+                                    const char *         group_name,
+                                    const neu_datatag_t *tags, size_t n);
+
 /**
  * Delete node tags.
  * @param driver_name               name of the driver who owns the tags
@@ -274,6 +354,14 @@ int neu_persister_update_group(const char *driver_name, const char *group_name,
  * @return 0 on success, non-zero otherwise
  */
 int neu_persister_load_groups(const char *driver_name, UT_array **group_infos);
+/**
+ * Load all groups under an adapter together with their tags, in one query.
+ * @param driver_name               name of the driver who owns the groups
+ * @param[out] groups               used to return pointer to heap allocated
+ *                                  vector of neu_persist_group_tags_t.
+ * @return 0 on success, non-zero otherwise
+ */
+int neu_persister_load_group_tags(const char *driver_name, UT_array **groups);
 /**
  * Delete group config.
  * @param driver_name               name of the driver who owns the group
@@ -282,6 +370,26 @@ int neu_persister_load_groups(const char *driver_name, UT_array **group_infos);
  */
 int neu_persister_delete_group(const char *driver_name, const char *group_name);
 
+/**
+ * Add the read statistics of a group since the last store to the persisted
+ * ones, which are halved first.
+ * @param driver_name               name of the driver who owns the group
+ * @param profile                   statistics of the group, and the changes
+ *                                  of its tags that changed.
+ * @return 0 on success, none-zero on failure
+ */
+int neu_persister_store_group_profile(
+    const char *driver_name, const neu_persist_group_profile_t *profile);
+/**
+ * Load the read statistics of the groups under an adapter.
+ * @param driver_name               name of the driver who owns the groups
+ * @param[out] profiles             used to return pointer to heap allocated
+ *                                  vector of neu_persist_group_profile_t.
+ * @return 0 on success, non-zero otherwise
+ */
+int neu_persister_load_group_profiles(const char *driver_name,
+                                      UT_array ** profiles);
+
 /**
  * Persist node setting.
  * @param adapter_name              name of the adapter who owns the setting.
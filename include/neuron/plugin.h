@@ -40,9 +40,11 @@ extern "C" {
     plugin->common.adapter_callbacks->register_metric( \
         plugin->common.adapter, name, name##_HELP, name##_TYPE, init)
 
-#define NEU_PLUGIN_UPDATE_METRIC(plugin, name, val, grp)                    \
-    plugin->common.adapter_callbacks->update_metric(plugin->common.adapter, \
-                                                    name, val, grp)
+#define NEU_PLUGIN_UPDATE_METRIC(plugin, name, val, grp)                      \
+    (neu_metric_off(name, name##_TYPE, NULL != (grp))                         \
+         ? 0                                                                  \
+         : plugin->common.adapter_callbacks->update_metric(                   \
+               plugin->common.adapter, name, val, grp))
 
 extern int64_t global_timestamp;
 
@@ -61,6 +63,18 @@ typedef struct neu_plugin_common {
 
 typedef struct neu_plugin neu_plugin_t;
 
+// the tags of a group laid out in columns, for driver plugins that set
+// neu_plugin_module_t.columns. the plugin stores the value read for tags[i]
+// in values[i] and sets filled[i], the adapter commits all the filled values
+// to the cache in one go once group_timer returns
+typedef struct {
+    uint32_t        n_tag;
+    neu_datatag_t **tags;   // in the order of neu_plugin_group_t.tags
+    const char **   names;  // names[i] is tags[i]->name
+    neu_dvalue_t *  values; // written by the plugin
+    uint8_t *       filled; // cleared by the adapter before each call
+} neu_plugin_columns_t;
+
 typedef struct neu_plugin_group neu_plugin_group_t;
 typedef void (*neu_plugin_group_free)(neu_plugin_group_t *pgp);
 struct neu_plugin_group {
@@ -69,8 +83,34 @@ struct neu_plugin_group {
 
     void *                user_data;
     neu_plugin_group_free group_free;
+
+    uint32_t interval; // ms between two reads of the group
+    // NULL unless the module sets columns, rebuilt when the tags change
+    neu_plugin_columns_t *columns;
+    // counts the reads of the group, see poll_divisor
+    uint32_t cycle;
+    // NULL unless a tag sets a poll_divisor, otherwise active[i] tells
+    // whether the i-th of tags is due in this cycle. a plugin may ignore it
+    // and read every tag
+    const uint8_t *active;
+    // NULL outside of group_timer, a plugin may call it between two read
+    // commands to run the queued writes of the group if one preempts the poll
+    void (*preempt)(neu_plugin_group_t *group);
+    // device requests of the last read, set by the plugins that batch the
+    // tags of a group in requests, 0 otherwise
+    uint32_t n_block;
 };
 
+// the tags of neu_plugin_group_t.tags a change of the group adds, removes or
+// reads differently, by address, type, attribute, precision, decimal or
+// poll_divisor, all UT_array of neu_datatag_t pointers. other edits leave a
+// tag out. removed holds the old tags, valid during group_update only
+typedef struct {
+    UT_array *added;
+    UT_array *removed;
+    UT_array *modified; // the new definitions, by the names of the old ones
+} neu_plugin_group_delta_t;
+
 typedef int (*neu_plugin_tag_validator_t)(const neu_datatag_t *tag);
 
 typedef struct {
@@ -78,6 +118,13 @@ typedef struct {
     neu_value_u    value;
 } neu_plugin_tag_value_t;
 
+// the tags of one queued write request
+typedef struct {
+    void *                  req;
+    int                     n_tag;
+    neu_plugin_tag_value_t *tags;
+} neu_plugin_write_t;
+
 typedef struct neu_plugin_intf_funs {
     neu_plugin_t *(*open)(void);
     int (*close)(neu_plugin_t *plugin);
@@ -108,9 +155,32 @@ typedef struct neu_plugin_intf_funs {
                             neu_datatag_t *tags,
                             int            n_tag); // create tags by API
             int (*del_tags)(neu_plugin_t *plugin, int n_tag);
+            // optional, writes all the requests queued in one write cycle, so
+            // that they can share frames. each request is still answered on
+            // its own with write_response
+            int (*write_batch)(neu_plugin_t *plugin, int n,
+                               neu_plugin_write_t *writes);
+            // optional, validates n tags at once as validate_tag would each
+            // of them, setting errors[i] of tags[i]. Returns the number of
+            // invalid tags. When missing, validate_tag is called per tag
+            int (*validate_tags)(neu_plugin_t *plugin, neu_datatag_t **tags,
+                                 int n, int *errors);
+            // optional, brings the user_data of a group up to date with its
+            // new tags, already in group->tags, on the thread of its
+            // group_timer. when missing or not 0, the adapter calls
+            // group_free and the next group_timer starts over
+            int (*group_update)(neu_plugin_t *plugin, neu_plugin_group_t *group,
+                                const neu_plugin_group_delta_t *delta);
         } driver;
     };
 
+    // optional, on a plugin update without a node restart, takes over the
+    // connection and other live state of from, the instance of the previous
+    // build, which is then closed without uninit. anything from still runs
+    // has to be stopped or taken over, its code is unloaded afterwards. when
+    // missing or not 0, from is uninit and plugin is init, set up and started
+    // like a new node. group user_data is always released with the old build
+    int (*migrate)(neu_plugin_t *plugin, neu_plugin_t *from);
 } neu_plugin_intf_funs_t;
 
 typedef struct neu_plugin_module {
@@ -127,6 +197,21 @@ typedef struct neu_plugin_module {
     const char *                  single_name;
     neu_event_timer_type_e        timer_type;
     neu_tag_cache_type_e          cache_type;
+    // app plugin handles NEU_REQRESP_TRANS_DATA_BATCH by itself, otherwise
+    // the adapter unpacks batches into NEU_REQRESP_TRANS_DATA requests
+    bool                          trans_data_batch;
+    // app plugin finishes the traces of trans data with neu_plugin_trace_done
+    // once delivered, otherwise the adapter finishes them once handled
+    bool                          trace_ack;
+    // app plugin takes trans data on several consumer threads at once, those
+    // of a group always on the same one, see neu_plugin_consumer
+    bool                          concurrent_trans_data;
+    // driver plugin handles up to this many group_timer calls at once, for
+    // distinct groups, 0 or 1 runs all the groups of a node one after another
+    uint16_t                      group_concurrency;
+    // driver plugin fills neu_plugin_group_t.columns instead of calling
+    // adapter callbacks for the values of a group
+    bool                          columns;
 } neu_plugin_module_t;
 
 inline static neu_plugin_common_t *
@@ -163,6 +248,35 @@ bool neu_plugin_common_check(neu_plugin_t *plugin);
  */
 int neu_plugin_op(neu_plugin_t *plugin, neu_reqresp_head_t head, void *data);
 
+/**
+ * @brief Finish a sampled data path trace, observe its stage durations into
+ *        the trace metrics of the node and log it.
+ *
+ * @param[in] plugin the app plugin the trans data was delivered by.
+ * @param[in] trace stamped up to NEU_TRACE_ACK.
+ * @param[in] driver the driver of the trans data.
+ * @param[in] group the group of the trans data.
+ */
+void neu_plugin_trace_done(neu_plugin_t *plugin, const neu_trace_t *trace,
+                           const char *driver, const char *group);
+
+/**
+ * @brief The trans data consumer thread of its app the caller runs on, for
+ *        plugins with concurrent_trans_data to keep scratch state per
+ *        consumer.
+ *
+ * @return below NEU_APP_CONSUMERS_MAX, 0 on any other thread.
+ */
+uint16_t neu_plugin_consumer();
+
+/**
+ * @brief Set the index neu_plugin_consumer returns on the calling thread,
+ *        by the adapter as it starts a consumer.
+ *
+ * @param[in] index below NEU_APP_CONSUMERS_MAX.
+ */
+void neu_plugin_set_consumer(uint16_t index);
+
 #ifdef __cplusplus
 }
 #endif
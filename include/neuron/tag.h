@@ -33,6 +33,7 @@ typedef enum {
     NEU_ATTRIBUTE_WRITE     = 2,
     NEU_ATTRIBUTE_SUBSCRIBE = 4,
     NEU_ATTRIBUTE_STATIC    = 8,
+    NEU_ATTRIBUTE_COALESCE  = 16, // newer writes replace the queued ones
 } neu_attribute_e;
 
 typedef enum {
@@ -78,6 +79,15 @@ typedef union {
     } bit;
 } neu_datatag_addr_option_u;
 
+// when a change of a subscribed tag is worth reporting, all zero reports
+// every change as soon as it is read
+typedef struct {
+    double   absolute;     // least difference to the last reported value
+    double   percent;      // least difference relative to the last reported
+    uint32_t min_interval; // ms to hold back a change after a report
+    uint32_t max_interval; // ms after which the value is reported anyway
+} neu_tag_deadband_t;
+
 typedef struct {
     char *                    name;
     char *                    address;
@@ -88,6 +98,10 @@ typedef struct {
     char *                    description;
     neu_datatag_addr_option_u option;
     uint8_t                   meta[NEU_TAG_META_LENGTH];
+    // read in every poll_divisor-th cycle of the group, 0 or 1 in each one
+    uint16_t poll_divisor;
+    // when a change is worth reporting, see neu_tag_deadband_t
+    neu_tag_deadband_t deadband;
 } neu_datatag_t;
 
 typedef struct neu_tag_meta {
@@ -108,6 +122,31 @@ inline static bool neu_tag_attribute_test(const neu_datatag_t *tag,
     return (tag->attribute & attribute) == attribute;
 }
 
+// A computed tag is not read from the device, its address is '=' followed by
+// an expression over other tags of its group evaluated after each read.
+inline static bool neu_tag_is_computed(const neu_datatag_t *tag)
+{
+    return !neu_tag_attribute_test(tag, NEU_ATTRIBUTE_STATIC) &&
+        tag->address != NULL && tag->address[0] == '=';
+}
+
+// whether tag is read in the cycle-th read of its group
+inline static bool neu_tag_poll_due(const neu_datatag_t *tag, uint32_t cycle)
+{
+    return tag->poll_divisor <= 1 || cycle % tag->poll_divisor == 0;
+}
+
+inline static bool neu_tag_deadband_is_set(const neu_tag_deadband_t *band)
+{
+    return band->absolute != 0 || band->percent != 0 ||
+        band->min_interval != 0 || band->max_interval != 0;
+}
+
+// the deadband as text, "absolute,percent,min_interval,max_interval", or
+// NULL if it is not set
+char *neu_tag_dump_deadband(const neu_tag_deadband_t *band);
+int   neu_tag_load_deadband(neu_tag_deadband_t *band, const char *s);
+
 /**
  * @brief Special usage of parsing tag address, e.g. setting length of string
  * type, setting of endian.
@@ -141,4 +180,22 @@ int neu_tag_set_static_value_json(neu_datatag_t *tag, neu_json_type_e t,
 char *neu_tag_dump_static_value(const neu_datatag_t *tag);
 int   neu_tag_load_static_value(neu_datatag_t *tag, const char *s);
 
+// Plugins may keep what their validate_tag parsed from the address in the
+// meta bytes of a non-static tag, which are copied along with the tag, to
+// skip parsing it again. The bytes are bound to the address, type and
+// attribute of the tag, a tag changed since it was compiled misses them.
+#define NEU_TAG_COMPILED_LENGTH (NEU_TAG_META_LENGTH - sizeof(uint32_t))
+
+void neu_tag_set_compiled(neu_datatag_t *tag, const void *data, size_t len);
+// return false if the tag is not compiled, or was changed since
+bool neu_tag_get_compiled(const neu_datatag_t *tag, void *data, size_t len);
+
+// the type of the tag in one byte followed by the value in little endian, or
+// the characters of a string without the terminating NUL
+#define NEU_TAG_STATIC_VALUE_BIN_SIZE (1 + NEU_VALUE_SIZE)
+
+size_t neu_tag_pack_static_value(const neu_datatag_t *tag, uint8_t *buf);
+int    neu_tag_unpack_static_value(neu_datatag_t *tag, const void *data,
+                                   size_t len);
+
 #endif
@@ -58,6 +58,9 @@ typedef bool (*neu_tag_sort_fn)(neu_tag_sort_t *sort, void *tag,
 /**
  * @brief Use sort and cmp to sort and classify tags.
  *
+ * The tags are ordered with cmp first, then every tag is offered to the
+ * sort of the previous tag only, and starts a new sort if it is refused.
+ *
  * @param[in] tags The tags that needs to be processed.
  * @param[in] sort Function for tag sort.
  * @param[in] cmp Function for tags comparison.
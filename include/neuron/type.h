@@ -29,6 +29,8 @@ extern "C" {
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 typedef enum {
     NEU_TYPE_INT8   = 1,
@@ -206,6 +208,229 @@ typedef struct {
     neu_value_u value;
     uint8_t     precision;
 } neu_dvalue_t;
+
+// the data of a pointer value handed out by a store is immutable and shared
+// by every holder of the value, a count of them sits in front of the data.
+// Holders release it with neu_value_ptr_put instead of free
+typedef struct {
+    uint64_t ref; // of the size the data is aligned to
+} neu_value_ptr_head_t;
+
+// a shared copy of length bytes of data, NULL if it cannot be allocated
+static inline uint8_t *neu_value_ptr_new(const void *data, uint16_t length)
+{
+    neu_value_ptr_head_t *head =
+        (neu_value_ptr_head_t *) malloc(sizeof(*head) + length);
+
+    if (NULL == head) {
+        return NULL;
+    }
+    head->ref = 1;
+    if (length > 0) {
+        memcpy(&head[1], data, length);
+    }
+    return (uint8_t *) &head[1];
+}
+
+static inline neu_value_ptr_head_t *neu_value_ptr_head(const uint8_t *ptr)
+{
+    return (neu_value_ptr_head_t *) ptr - 1;
+}
+
+// one more holder of ptr
+static inline uint8_t *neu_value_ptr_get(uint8_t *ptr)
+{
+    if (NULL != ptr) {
+        __atomic_add_fetch(&neu_value_ptr_head(ptr)->ref, 1,
+                           __ATOMIC_RELAXED);
+    }
+    return ptr;
+}
+
+// release ptr, its data is freed with the last holder
+static inline void neu_value_ptr_put(uint8_t *ptr)
+{
+    if (NULL != ptr &&
+        0 == __atomic_sub_fetch(&neu_value_ptr_head(ptr)->ref, 1,
+                                __ATOMIC_ACQ_REL)) {
+        free(neu_value_ptr_head(ptr));
+    }
+}
+
+// whether the data of ptr is held by no one else and may be written
+static inline bool neu_value_ptr_owned(const uint8_t *ptr)
+{
+    return 1 == __atomic_load_n(&neu_value_ptr_head(ptr)->ref,
+                                __ATOMIC_ACQUIRE);
+}
+
+// compact form of neu_dvalue_t for stores that hold many values, scalars
+// stay inline, strings and bytes move to a heap block of their own, pointer
+// values to shared data, see neu_value_ptr_new. Plugins keep exchanging
+// neu_dvalue_t, the helpers below convert.
+typedef struct {
+    uint8_t  type; // neu_type_e
+    uint8_t  precision;
+    uint16_t length;   // bytes in ext
+    uint8_t  ptr_type; // type of a pointer value
+    union {
+        uint64_t u64; // any scalar, zero extended
+        float    f32;
+        double   d64;
+        uint8_t *ext;
+    } value;
+} neu_cvalue_t;
+
+// bytes of a scalar kept inline, 0 for a value kept out of line
+static inline size_t neu_cvalue_inline_size(neu_type_e type)
+{
+    switch (type) {
+    case NEU_TYPE_INT8:
+    case NEU_TYPE_UINT8:
+    case NEU_TYPE_BIT:
+    case NEU_TYPE_BOOL:
+        return 1;
+    case NEU_TYPE_INT16:
+    case NEU_TYPE_UINT16:
+    case NEU_TYPE_WORD:
+        return 2;
+    case NEU_TYPE_INT32:
+    case NEU_TYPE_UINT32:
+    case NEU_TYPE_DWORD:
+    case NEU_TYPE_FLOAT:
+    case NEU_TYPE_ERROR:
+        return 4;
+    case NEU_TYPE_INT64:
+    case NEU_TYPE_UINT64:
+    case NEU_TYPE_DOUBLE:
+    case NEU_TYPE_LWORD:
+        return 8;
+    default:
+        return 0;
+    }
+}
+
+// the inline bits a scalar dvalue takes in a cvalue
+static inline uint64_t neu_cvalue_scalar(const neu_dvalue_t *dv)
+{
+    uint64_t u = 0;
+    memcpy(&u, &dv->value, neu_cvalue_inline_size(dv->type));
+    return u;
+}
+
+// where the out of line data of dv is and how long it is, NULL for a scalar
+static inline const void *neu_dvalue_ext(const neu_dvalue_t *dv,
+                                         uint16_t *          length)
+{
+    switch (dv->type) {
+    case NEU_TYPE_STRING:
+        *length = strnlen(dv->value.str, NEU_VALUE_SIZE);
+        return dv->value.str;
+    case NEU_TYPE_BYTES:
+        *length = dv->value.bytes.length > NEU_VALUE_SIZE
+            ? NEU_VALUE_SIZE
+            : dv->value.bytes.length;
+        return dv->value.bytes.bytes;
+    case NEU_TYPE_PTR:
+        *length = dv->value.ptr.length;
+        return dv->value.ptr.ptr;
+    default:
+        *length = 0;
+        return NULL;
+    }
+}
+
+static inline void neu_cvalue_fini(neu_cvalue_t *cv)
+{
+    if (NEU_TYPE_PTR == cv->type) {
+        neu_value_ptr_put(cv->value.ext);
+    } else if (0 == neu_cvalue_inline_size((neu_type_e) cv->type)) {
+        free(cv->value.ext);
+    }
+    cv->value.u64 = 0;
+    cv->length    = 0;
+}
+
+// store dv in cv, releasing what cv held before, returns -1 and leaves an
+// empty out of line value if its block cannot be allocated
+static inline int neu_cvalue_set(neu_cvalue_t *cv, const neu_dvalue_t *dv)
+{
+    uint16_t    length = 0;
+    const void *ext    = neu_dvalue_ext(dv, &length);
+    // a block of the same length is overwritten in place, shared data only
+    // while no value handed out still holds it
+    bool reuse = NULL != ext &&
+        0 == neu_cvalue_inline_size((neu_type_e) cv->type) &&
+        NULL != cv->value.ext && cv->length == length &&
+        (NEU_TYPE_PTR == cv->type) == (NEU_TYPE_PTR == dv->type) &&
+        (NEU_TYPE_PTR != cv->type || neu_value_ptr_owned(cv->value.ext));
+
+    if (!reuse) {
+        neu_cvalue_fini(cv);
+    }
+
+    cv->type      = dv->type;
+    cv->precision = dv->precision;
+    cv->ptr_type  = NEU_TYPE_PTR == dv->type ? dv->value.ptr.type : 0;
+
+    if (NEU_TYPE_PTR == dv->type && !reuse) {
+        // always allocated, a pointer value with no data is not NULL
+        cv->value.ext = neu_value_ptr_new(ext, length);
+        cv->length    = length;
+        return NULL == cv->value.ext ? -1 : 0;
+    }
+
+    if (NULL == ext) {
+        cv->value.u64 = neu_cvalue_scalar(dv);
+        return 0;
+    }
+
+    if (!reuse && length > 0) {
+        cv->value.ext = (uint8_t *) malloc(length);
+        if (NULL == cv->value.ext) {
+            return -1;
+        }
+    }
+    cv->length = length;
+    if (length > 0) {
+        memcpy(cv->value.ext, ext, length);
+    }
+    return 0;
+}
+
+// expand cv into dv, a pointer value holds the data of cv, release it with
+// neu_value_ptr_put
+static inline void neu_cvalue_get(const neu_cvalue_t *cv, neu_dvalue_t *dv)
+{
+    dv->type      = (neu_type_e) cv->type;
+    dv->precision = cv->precision;
+
+    switch (dv->type) {
+    case NEU_TYPE_STRING:
+        memset(dv->value.str, 0, sizeof(dv->value.str));
+        if (cv->length > 0) {
+            memcpy(dv->value.str, cv->value.ext, cv->length);
+        }
+        break;
+    case NEU_TYPE_BYTES:
+        dv->value.bytes.length = cv->length;
+        if (cv->length > 0) {
+            memcpy(dv->value.bytes.bytes, cv->value.ext, cv->length);
+        }
+        break;
+    case NEU_TYPE_PTR:
+        dv->value.ptr.type   = (neu_type_e) cv->ptr_type;
+        dv->value.ptr.length = cv->length;
+        dv->value.ptr.ptr    = neu_value_ptr_get(cv->value.ext);
+        break;
+    default:
+        memset(&dv->value, 0, sizeof(dv->value));
+        memcpy(&dv->value, &cv->value.u64,
+               neu_cvalue_inline_size(dv->type));
+        break;
+    }
+}
+
 typedef union neu_value8 {
     uint8_t value;
     struct {
@@ -0,0 +1,63 @@
+/**
+ * NEURON IIoT System for Industry 4.0
+ * Copyright (C) 2020-2023 EMQ Technologies Co., Ltd All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ **/
+
+#ifndef _NEU_AFFINITY_H_
+#define _NEU_AFFINITY_H_
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define NEU_CPUS_MAX 1024
+
+// a set of cpus threads may run on, as much as a cpu_set_t of glibc
+typedef struct neu_cpus {
+    uint64_t bits[NEU_CPUS_MAX / 64];
+} neu_cpus_t;
+
+// parse a cpu list as the kernel prints them, "0-3,8", -1 if it is malformed,
+// names a cpu past NEU_CPUS_MAX or no cpu at all
+int neu_cpus_parse(const char *list, neu_cpus_t *cpus);
+// the cpus of a NUMA node, -1 if there is no such node
+int  neu_cpus_numa(int node, neu_cpus_t *cpus);
+bool neu_cpus_empty(const neu_cpus_t *cpus);
+
+// pin thread to cpus, with NULL let it run where the process may again.
+// Returns -1 where threads cannot be pinned
+int neu_thread_set_affinity(pthread_t thread, const neu_cpus_t *cpus);
+
+// the scheduling policy of a name, fifo, rr or other, -1 for another name
+int neu_sched_policy(const char *name);
+// whether priority is valid under policy, 0 is the one of SCHED_OTHER
+bool neu_sched_priority_valid(int policy, int priority);
+// run thread under policy at priority. Returns -1 where the policy cannot be
+// set, a real time one without CAP_SYS_NICE or RLIMIT_RTPRIO
+int neu_thread_set_sched(pthread_t thread, int policy, int priority);
+// the cpu time in ns thread has run for, -1 where it cannot be told
+int64_t neu_thread_cputime(pthread_t thread);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -53,7 +53,8 @@ neu_async_queue_t *neu_async_queue_new(neu_async_queue_key    key_fn,
 void neu_async_queue_destroy(neu_async_queue_t *q);
 
 /**
- * @brief Add element at the end of the queue.
+ * @brief Add element at the end of the queue, the oldest element is released
+ * when the queue is full.
  *
  * @param[in] q the queue that requires an operation.
  * @param[in] elem that needs to be added at the end of the queue.
@@ -61,7 +62,9 @@ void neu_async_queue_destroy(neu_async_queue_t *q);
 void neu_async_queue_push(neu_async_queue_t *q, void *elem);
 
 /**
- * @brief Pop the element corrseponding to key in the queue.
+ * @brief Pop the element corrseponding to key in the queue, the oldest one
+ * if several have the key. Takes constant time, expired elements are left to
+ * neu_async_queue_sweep.
  *
  * @param[in] q the queue that requires an operation.
  * @param[in] key
@@ -70,6 +73,23 @@ void neu_async_queue_push(neu_async_queue_t *q, void *elem);
  */
 int neu_async_queue_pop(neu_async_queue_t *q, uint64_t key, void **elem);
 
+/**
+ * @brief Release the expired elements, to be called from a timer of the
+ * owner. Elements are taken to expire in the order they were pushed, the
+ * walk stops at the first one that has not.
+ *
+ * @param[in] q the queue that requires an operation.
+ * @return the number of elements released.
+ */
+int neu_async_queue_sweep(neu_async_queue_t *q);
+
+/**
+ * @brief The number of elements in the queue.
+ *
+ * @param[in] q the queue.
+ */
+uint16_t neu_async_queue_count(neu_async_queue_t *q);
+
 /**
  * @brief remove some elements from the queue.
  *
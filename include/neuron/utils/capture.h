@@ -0,0 +1,55 @@
+/**
+ * NEURON IIoT System for Industry 4.0
+ * Copyright (C) 2020-2023 EMQ Technologies Co., Ltd All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ **/
+
+#ifndef _NEU_CAPTURE_H_
+#define _NEU_CAPTURE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "utils/zlog.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// protocol capture of a node, the packets sent and received by the node are
+// kept in a ring and dumped as a pcap file of link type USER0, each packet
+// starts with a one byte header that is 1 for sent and 0 for received
+#define NEU_CAPTURE_PACKETS_DEFAULT 4096
+#define NEU_CAPTURE_PACKETS_MAX 65536
+#define NEU_CAPTURE_SNAPLEN 512
+
+// how many nodes are capturing, nothing else is looked at while it is 0
+extern int neu_capture_count;
+
+int  neu_capture_start(const char *node, zlog_category_t *log,
+                       uint32_t n_packet);
+void neu_capture_stop(const char *node);
+void neu_capture_packet(zlog_category_t *log, bool send, const uint8_t *bytes,
+                        uint16_t n_byte);
+// the caller frees data, a node capturing nothing has a file with no packets
+int neu_capture_dump(const char *node, uint8_t **data, size_t *len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,172 @@
+/**
+ * NEURON IIoT System for Industry 4.0
+ * Copyright (C) 2020-2021 EMQ Technologies Co., Ltd All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ **/
+
+#ifndef _NEU_HASH_H_
+#define _NEU_HASH_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * A wyhash of the bytes of a key, the default hash of the uthash tables.
+ *
+ * Keys up to 16 bytes take two multiplications, longer keys 16 or 48 bytes
+ * at a time, where the Jenkins hash of uthash mixes 12 bytes a round. The
+ * value differs between byte orders, it is never persisted.
+ */
+
+static const uint64_t neu_hash_secret[4] = {
+    0xa0761d6478bd642full,
+    0xe7037ed1a0b428dbull,
+    0x8ebc6af09c88c6e3ull,
+    0x589965cc75374cc3ull,
+};
+
+static inline void neu_hash_mum(uint64_t *a, uint64_t *b)
+{
+#ifdef __SIZEOF_INT128__
+    __uint128_t r = (__uint128_t) *a * *b;
+
+    *a = (uint64_t) r;
+    *b = (uint64_t)(r >> 64);
+#else
+    uint64_t ha = *a >> 32, hb = *b >> 32;
+    uint64_t la = (uint32_t) *a, lb = (uint32_t) *b;
+    uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    uint64_t t = rl + (rm0 << 32), lo = t + (rm1 << 32);
+    uint64_t c = (t < rl) + (lo < t);
+
+    *a = lo;
+    *b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+}
+
+static inline uint64_t neu_hash_mix(uint64_t a, uint64_t b)
+{
+    neu_hash_mum(&a, &b);
+    return a ^ b;
+}
+
+static inline uint64_t neu_hash_r8(const uint8_t *p)
+{
+    uint64_t v = 0;
+    memcpy(&v, p, 8);
+    return v;
+}
+
+static inline uint64_t neu_hash_r4(const uint8_t *p)
+{
+    uint32_t v = 0;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+static inline uint64_t neu_hash64(const void *key, size_t len, uint64_t seed)
+{
+    const uint64_t *s = neu_hash_secret;
+    const uint8_t * p = (const uint8_t *) key;
+    uint64_t        a = 0;
+    uint64_t        b = 0;
+
+    seed ^= neu_hash_mix(seed ^ s[0], s[1]);
+    if (len <= 16) {
+        if (len >= 4) {
+            size_t k = (len >> 3) << 2;
+
+            a = (neu_hash_r4(p) << 32) | neu_hash_r4(p + k);
+            b = (neu_hash_r4(p + len - 4) << 32) | neu_hash_r4(p + len - 4 - k);
+        } else if (len > 0) {
+            a = ((uint64_t) p[0] << 16) | ((uint64_t) p[len >> 1] << 8) |
+                p[len - 1];
+        }
+    } else {
+        size_t i = len;
+
+        if (i > 48) {
+            uint64_t see1 = seed, see2 = seed;
+
+            do {
+                seed = neu_hash_mix(neu_hash_r8(p) ^ s[1],
+                                    neu_hash_r8(p + 8) ^ seed);
+                see1 = neu_hash_mix(neu_hash_r8(p + 16) ^ s[2],
+                                    neu_hash_r8(p + 24) ^ see1);
+                see2 = neu_hash_mix(neu_hash_r8(p + 32) ^ s[3],
+                                    neu_hash_r8(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while (i > 48);
+            seed ^= see1 ^ see2;
+        }
+        while (i > 16) {
+            seed =
+                neu_hash_mix(neu_hash_r8(p) ^ s[1], neu_hash_r8(p + 8) ^ seed);
+            i -= 16;
+            p += 16;
+        }
+        a = neu_hash_r8(p + i - 16);
+        b = neu_hash_r8(p + i - 8);
+    }
+
+    a ^= s[1];
+    b ^= seed;
+    neu_hash_mum(&a, &b);
+    return neu_hash_mix(a ^ s[0] ^ len, b ^ s[1]);
+}
+
+static inline uint32_t neu_hash(const void *key, size_t len)
+{
+    uint64_t h = neu_hash64(key, len, 0);
+
+    return (uint32_t)(h ^ (h >> 32));
+}
+
+/**
+ * @brief Pack two names into a key of only their significant bytes.
+ *
+ * A key of fixed name buffers hashes and compares their zero padding on
+ * every lookup, "a\0b" is as unique and only as long as the names.
+ *
+ * @param[out] key at least a_size + b_size bytes.
+ * @param[in] a the first name, truncated to a_size - 1 bytes.
+ * @param[in] b the second name, truncated to b_size - 1 bytes.
+ * @return the length of the key, the terminating zero of b included.
+ */
+static inline size_t neu_hash_key_pair(char *key, const char *a, size_t a_size,
+                                       const char *b, size_t b_size)
+{
+    size_t na = strnlen(a, a_size - 1);
+    size_t nb = strnlen(b, b_size - 1);
+
+    memcpy(key, a, na);
+    key[na] = '\0';
+    memcpy(key + na + 1, b, nb);
+    key[na + 1 + nb] = '\0';
+    return na + nb + 2;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,106 @@
+/**
+ * NEURON IIoT System for Industry 4.0
+ * Copyright (C) 2020-2023 EMQ Technologies Co., Ltd All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ **/
+
+#ifndef NEURON_UTILS_HISTOGRAM_H
+#define NEURON_UTILS_HISTOGRAM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdlib.h>
+
+/** Latency histogram.
+ *
+ * Samples are counted into log-linear buckets with upper bounds of 1, 2 and 5
+ * times every power of ten from 1 to 50000, plus one bucket for larger
+ * samples. Observations are relaxed atomic increments, so they need no lock,
+ * and readers copy the counts with atomic loads.
+ */
+#define NEU_HISTOGRAM_BOUNDS 15
+#define NEU_HISTOGRAM_BUCKETS (NEU_HISTOGRAM_BOUNDS + 1)
+
+typedef struct {
+    uint64_t count;
+    uint64_t sum;
+    uint64_t buckets[NEU_HISTOGRAM_BUCKETS]; // not cumulative
+} neu_histogram_t;
+
+/** Upper bound of bucket `i`, inclusive, UINT64_MAX for the last one.
+ */
+static inline uint64_t neu_histogram_bound(int i)
+{
+    static const uint64_t bounds[NEU_HISTOGRAM_BOUNDS] = {
+        1,    2,    5,    10,    20,    50,    100,   200,
+        500,  1000, 2000, 5000,  10000, 20000, 50000,
+    };
+    return i < NEU_HISTOGRAM_BOUNDS ? bounds[i] : UINT64_MAX;
+}
+
+static inline neu_histogram_t *neu_histogram_new()
+{
+    return (neu_histogram_t *) calloc(1, sizeof(neu_histogram_t));
+}
+
+static inline void neu_histogram_free(neu_histogram_t *histogram)
+{
+    free(histogram);
+}
+
+static inline void neu_histogram_observe(neu_histogram_t *histogram,
+                                         uint64_t         value)
+{
+    int i = 0;
+    while (i < NEU_HISTOGRAM_BOUNDS && value > neu_histogram_bound(i)) {
+        ++i;
+    }
+
+    __atomic_add_fetch(&histogram->buckets[i], 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&histogram->sum, value, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&histogram->count, 1, __ATOMIC_RELAXED);
+}
+
+static inline void neu_histogram_reset(neu_histogram_t *histogram)
+{
+    for (int i = 0; i < NEU_HISTOGRAM_BUCKETS; ++i) {
+        __atomic_store_n(&histogram->buckets[i], 0, __ATOMIC_RELAXED);
+    }
+    __atomic_store_n(&histogram->sum, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&histogram->count, 0, __ATOMIC_RELAXED);
+}
+
+/** Copy the counts of a histogram being observed, the copy may be off by the
+ *  samples observed meanwhile.
+ */
+static inline void neu_histogram_copy(neu_histogram_t *      dst,
+                                      const neu_histogram_t *src)
+{
+    for (int i = 0; i < NEU_HISTOGRAM_BUCKETS; ++i) {
+        dst->buckets[i] = __atomic_load_n(&src->buckets[i], __ATOMIC_RELAXED);
+    }
+    dst->sum   = __atomic_load_n(&src->sum, __ATOMIC_RELAXED);
+    dst->count = __atomic_load_n(&src->count, __ATOMIC_RELAXED);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
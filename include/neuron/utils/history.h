@@ -0,0 +1,80 @@
+/**
+ * NEURON IIoT System for Industry 4.0
+ * Copyright (C) 2020-2023 EMQ Technologies Co., Ltd All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ **/
+
+#ifndef _NEU_HISTORY_H_
+#define _NEU_HISTORY_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "utils/utarray.h"
+
+// bytes of compressed samples in one block of a history
+#define NEU_HISTORY_BLOCK_SIZE 512
+
+// The recent samples of one numeric tag, compressed the way Gorilla does:
+// delta of delta timestamps and values xored with the previous one, so that a
+// sample read at a steady interval without change takes two bits. Blocks are
+// kept in a ring and the oldest is dropped once the size is used up.
+// Not thread safe, the owner serializes appends and queries.
+typedef struct neu_history neu_history_t;
+
+typedef struct {
+    int64_t  timestamp; // ms of the sample, or the start of its bucket
+    uint32_t count;     // samples in the bucket, 1 for a sample
+    double   min;
+    double   max;
+    double   avg;
+    double   last;
+} neu_history_point_t;
+
+// size is the bytes the blocks of the history may take, at least two blocks
+// are kept whatever the size
+neu_history_t *neu_history_new(size_t size);
+void           neu_history_free(neu_history_t *history);
+
+// returns -1 and drops the sample if it is older than the last one or not a
+// finite number
+int neu_history_append(neu_history_t *history, int64_t timestamp,
+                       double value);
+
+// bytes the blocks of the history take now
+size_t neu_history_size(const neu_history_t *history);
+
+// keep at most size bytes of blocks from now on, as neu_history_new does,
+// dropping the oldest samples that do not fit. Returns the bytes freed
+size_t neu_history_shrink(neu_history_t *history, size_t size);
+
+// Appends the points of the samples from since until before until to points,
+// an array of neu_history_point_t, one per sample if step is 0 and otherwise
+// one per non empty bucket of step ms, buckets start at multiples of step.
+// Returns 1 if it stopped at max points, 0 otherwise.
+int neu_history_query(const neu_history_t *history, int64_t since,
+                      int64_t until, int64_t step, uint32_t max,
+                      UT_array *points);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
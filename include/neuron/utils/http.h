@@ -36,6 +36,8 @@ extern "C" {
 ssize_t neu_url_decode(const char *s, size_t len, char *buf, size_t size);
 
 int neu_http_get_body(nng_aio *aio, void **data, size_t *data_size);
+// Alias the body in the nng request, it is not NUL terminated.
+int neu_http_get_body_ref(nng_aio *aio, const char **data, size_t *data_size);
 
 // Find query parameter value of the given name.
 //
@@ -20,6 +20,8 @@
 #ifndef _NEU_HTTP_HANDLER_H_
 #define _NEU_HTTP_HANDLER_H_
 
+#include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
 
 #include <nng/nng.h>
@@ -62,6 +64,41 @@
         NEU_PROCESS_HTTP_REQUEST(aio, req_type, decode_fun, func);             \
     }
 
+// Decode the body where it lies in the nng request, without the NUL
+// terminated copy, with the length aware `b` variant of `decode_fun`.
+#define NEU_PROCESS_HTTP_REQUEST_JSON(aio, req_type, decode_fun, func)      \
+    {                                                                       \
+        const char *req_data      = NULL;                                   \
+        size_t      req_data_size = 0;                                      \
+        req_type *  req           = NULL;                                   \
+                                                                            \
+        if (neu_http_get_body_ref((aio), &req_data, &req_data_size) == 0 && \
+            decode_fun##b(req_data, req_data_size, &req) == 0) {            \
+            { func };                                                       \
+            decode_fun##_free(req);                                         \
+        } else {                                                            \
+            neu_http_bad_request(aio, "{\"error\": 1002}");                 \
+        }                                                                   \
+    }
+
+#define NEU_PROCESS_HTTP_REQUEST_JSON_VALIDATE_JWT(aio, req_type, decode_fun, \
+                                                   func)                      \
+    {                                                                         \
+        if (!disable_jwt) {                                                   \
+            char *jwt =                                                       \
+                (char *) neu_http_get_header(aio, (char *) "Authorization");  \
+                                                                              \
+            NEU_JSON_RESPONSE_ERROR(neu_jwt_validate(jwt), {                  \
+                if (error_code.error != NEU_ERR_SUCCESS) {                    \
+                    neu_http_response(aio, error_code.error, result_error);   \
+                    free(result_error);                                       \
+                    return;                                                   \
+                }                                                             \
+            })                                                                \
+        }                                                                     \
+        NEU_PROCESS_HTTP_REQUEST_JSON(aio, req_type, decode_fun, func);       \
+    }
+
 #define NEU_VALIDATE_JWT(aio)                                                \
     {                                                                        \
         if (!disable_jwt) {                                                  \
@@ -92,6 +129,14 @@ enum neu_http_handler_type {
     NEU_HTTP_HANDLER_REDIRECT,
 };
 
+// Where a function handler runs. The two queues have workers of their own,
+// so that probes and reads are answered while bulk handlers are busy.
+enum neu_http_queue {
+    NEU_HTTP_QUEUE_NNG = 0x0, // on the nng worker that parsed the request
+    NEU_HTTP_QUEUE_LIGHT,     // short handlers, such as ping and read
+    NEU_HTTP_QUEUE_HEAVY,     // handlers that do heavy work before they answer
+};
+
 struct neu_http_handler {
     enum neu_http_method       method;
     char *                     url;
@@ -101,10 +146,44 @@ struct neu_http_handler {
         char *path;
         char *dst_url;
     } value;
+    // Function handlers only. Requests of the handler in flight at once, from
+    // the call until the response, 0 for NEU_HTTP_DEFAULT_MAX_INFLIGHT. More
+    // are answered with 429 straight away.
+    uint32_t max_inflight;
+    // Function handlers only, the queue the handler runs on.
+    enum neu_http_queue queue;
 };
 
+#define NEU_HTTP_DEFAULT_MAX_INFLIGHT 64
+
+#define NEU_HTTP_WORKERS_DEFAULT 2
+#define NEU_HTTP_WORKERS_MAX 16
+
+typedef struct {
+    const char *method;
+    const char *url;
+    uint32_t    inflight;
+    uint64_t    requests;
+    uint64_t    rejected;
+    uint64_t    duration_ms; // total over the answered requests
+    uint64_t    max_duration_ms;
+    uint64_t    queue_ms; // total wait of the requests for a queue worker
+} neu_http_handler_stats_t;
+
+typedef void (*neu_http_handler_stats_cb_t)(
+    const neu_http_handler_stats_t *stats, void *data);
+
 int  neu_http_add_handler(nng_http_server *              server,
                           const struct neu_http_handler *http_handler);
 void neu_http_handle_cors(nng_aio *aio);
 
+// Count the handler request of `aio` as answered. Every function that
+// finishes a handler aio calls it right before nng_aio_finish.
+void neu_http_handler_done(nng_aio *aio);
+// Visit the stats of the function handlers that have been added.
+void neu_http_handler_visit_stats(neu_http_handler_stats_cb_t cb, void *data);
+// Workers of each of the light and heavy queues, up to NEU_HTTP_WORKERS_MAX,
+// before the first handler of the queue is added.
+void neu_http_set_workers(uint32_t n);
+
 #endif
@@ -0,0 +1,63 @@
+/**
+ * NEURON IIoT System for Industry 4.0
+ * Copyright (C) 2020-2023 EMQ Technologies Co., Ltd All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ **/
+
+#ifndef _NEU_INTERN_H_
+#define _NEU_INTERN_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Process wide interning of node, group and tag names.
+ *
+ * The same name always gives the same id and the same pointer, so interned
+ * names compare by id or by pointer. An interned name lives as long as the
+ * process, which bounds the table by the distinct names ever used rather than
+ * the names in use. Lookups of a name already interned take no lock.
+ */
+
+/**
+ * @brief Intern a name.
+ *
+ * @param[in] str the name.
+ * @return the id of the name, 0 for NULL or when out of memory.
+ */
+uint32_t neu_intern(const char *str);
+
+/**
+ * @brief The name of an id.
+ *
+ * @param[in] id an id returned by neu_intern.
+ * @return the interned name, NULL for an unknown id.
+ */
+const char *neu_intern_str(uint32_t id);
+
+/**
+ * @brief Intern a name and return the shared copy, never to be freed.
+ */
+const char *neu_intern_name(const char *str);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -22,7 +22,10 @@ config_ **/
 
 #include <inttypes.h>
 #include <memory.h>
+#include <stdbool.h>
+#include <time.h>
 
+#include "utils/capture.h"
 #include "utils/zlog.h"
 
 #include "define.h"
@@ -51,43 +54,100 @@ inline static const char *log_level_to_str(int level)
 
 #define nlog_level_change(level) zlog_level_switch(neuron, level)
 
-#define nlog_fatal(...)                                    \
-    zlog(neuron, __FILE__, sizeof(__FILE__) - 1, __func__, \
-         sizeof(__func__) - 1, __LINE__, ZLOG_LEVEL_FATAL, __VA_ARGS__)
-#define nlog_error(...)                                    \
-    zlog(neuron, __FILE__, sizeof(__FILE__) - 1, __func__, \
-         sizeof(__func__) - 1, __LINE__, ZLOG_LEVEL_ERROR, __VA_ARGS__)
-#define nlog_warn(...)                                     \
-    zlog(neuron, __FILE__, sizeof(__FILE__) - 1, __func__, \
-         sizeof(__func__) - 1, __LINE__, ZLOG_LEVEL_WARN, __VA_ARGS__)
-#define nlog_notice(...)                                   \
-    zlog(neuron, __FILE__, sizeof(__FILE__) - 1, __func__, \
-         sizeof(__func__) - 1, __LINE__, ZLOG_LEVEL_NOTICE, __VA_ARGS__)
-#define nlog_info(...)                                     \
-    zlog(neuron, __FILE__, sizeof(__FILE__) - 1, __func__, \
-         sizeof(__func__) - 1, __LINE__, ZLOG_LEVEL_INFO, __VA_ARGS__)
-#define nlog_debug(...)                                    \
-    zlog(neuron, __FILE__, sizeof(__FILE__) - 1, __func__, \
-         sizeof(__func__) - 1, __LINE__, ZLOG_LEVEL_DEBUG, __VA_ARGS__)
-
-#define plog_fatal(plugin, ...)                                          \
-    zlog((plugin)->common.log, __FILE__, sizeof(__FILE__) - 1, __func__, \
-         sizeof(__func__) - 1, __LINE__, ZLOG_LEVEL_FATAL, __VA_ARGS__)
-#define plog_error(plugin, ...)                                          \
-    zlog((plugin)->common.log, __FILE__, sizeof(__FILE__) - 1, __func__, \
-         sizeof(__func__) - 1, __LINE__, ZLOG_LEVEL_ERROR, __VA_ARGS__)
-#define plog_warn(plugin, ...)                                           \
-    zlog((plugin)->common.log, __FILE__, sizeof(__FILE__) - 1, __func__, \
-         sizeof(__func__) - 1, __LINE__, ZLOG_LEVEL_WARN, __VA_ARGS__)
-#define plog_notice(plugin, ...)                                         \
-    zlog((plugin)->common.log, __FILE__, sizeof(__FILE__) - 1, __func__, \
-         sizeof(__func__) - 1, __LINE__, ZLOG_LEVEL_NOTICE, __VA_ARGS__)
-#define plog_info(plugin, ...)                                           \
-    zlog((plugin)->common.log, __FILE__, sizeof(__FILE__) - 1, __func__, \
-         sizeof(__func__) - 1, __LINE__, ZLOG_LEVEL_INFO, __VA_ARGS__)
-#define plog_debug(plugin, ...)                                          \
-    zlog((plugin)->common.log, __FILE__, sizeof(__FILE__) - 1, __func__, \
-         sizeof(__func__) - 1, __LINE__, ZLOG_LEVEL_DEBUG, __VA_ARGS__)
+// levels below this are compiled out, e.g. -DNEU_LOG_COMPILE_LEVEL=60 drops
+// every debug and info line from the binary, see LOG_COMPILE_LEVEL of cmake
+#ifndef NEU_LOG_COMPILE_LEVEL
+#define NEU_LOG_COMPILE_LEVEL ZLOG_LEVEL_DEBUG
+#endif
+
+// the arguments are not evaluated at all for a level that is turned off
+#define neu_zlog(cat, level, ...)                                          \
+    do {                                                                   \
+        if ((level) >= NEU_LOG_COMPILE_LEVEL &&                            \
+            zlog_level_enabled((cat), (level))) {                          \
+            zlog((cat), __FILE__, sizeof(__FILE__) - 1, __func__,          \
+                 sizeof(__func__) - 1, __LINE__, (level), __VA_ARGS__);    \
+        }                                                                  \
+    } while (0)
+
+// default ms between two lines of a rate limited call site
+#define NEU_LOG_RATELIMIT_INTERVAL 10000
+
+typedef struct {
+    int64_t  next;
+    uint32_t suppressed;
+} neu_log_ratelimit_t;
+
+// whether a call site may log now, at most once every interval ms, and how
+// many lines it has dropped since it last did
+inline static bool neu_log_ratelimit(neu_log_ratelimit_t *rl, int64_t interval,
+                                     uint32_t *suppressed)
+{
+    struct timespec ts   = { 0 };
+    int64_t         now  = 0;
+    int64_t         next = __atomic_load_n(&rl->next, __ATOMIC_RELAXED);
+
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+    now = (int64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+
+    if (now < next ||
+        !__atomic_compare_exchange_n(&rl->next, &next, now + interval, false,
+                                     __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        __atomic_add_fetch(&rl->suppressed, 1, __ATOMIC_RELAXED);
+        return false;
+    }
+
+    *suppressed = __atomic_exchange_n(&rl->suppressed, 0, __ATOMIC_RELAXED);
+    return true;
+}
+
+// log at most once every interval ms per call site, the next line that gets
+// through tells how many were dropped in between
+#define neu_zlog_ratelimit(cat, level, interval, fmt, ...)                   \
+    do {                                                                     \
+        static neu_log_ratelimit_t neu_rl_         = { 0 };                  \
+        uint32_t                   neu_rl_dropped_ = 0;                      \
+        if ((level) >= NEU_LOG_COMPILE_LEVEL &&                              \
+            zlog_level_enabled((cat), (level)) &&                            \
+            neu_log_ratelimit(&neu_rl_, (interval), &neu_rl_dropped_)) {     \
+            if (neu_rl_dropped_ > 0) {                                       \
+                zlog((cat), __FILE__, sizeof(__FILE__) - 1, __func__,        \
+                     sizeof(__func__) - 1, __LINE__, (level),                \
+                     fmt " (%" PRIu32 " messages suppressed)", ##__VA_ARGS__, \
+                     neu_rl_dropped_);                                       \
+            } else {                                                         \
+                zlog((cat), __FILE__, sizeof(__FILE__) - 1, __func__,        \
+                     sizeof(__func__) - 1, __LINE__, (level), fmt,           \
+                     ##__VA_ARGS__);                                         \
+            }                                                                \
+        }                                                                    \
+    } while (0)
+
+#define nlog_fatal(...) neu_zlog(neuron, ZLOG_LEVEL_FATAL, __VA_ARGS__)
+#define nlog_error(...) neu_zlog(neuron, ZLOG_LEVEL_ERROR, __VA_ARGS__)
+#define nlog_warn(...) neu_zlog(neuron, ZLOG_LEVEL_WARN, __VA_ARGS__)
+#define nlog_notice(...) neu_zlog(neuron, ZLOG_LEVEL_NOTICE, __VA_ARGS__)
+#define nlog_info(...) neu_zlog(neuron, ZLOG_LEVEL_INFO, __VA_ARGS__)
+#define nlog_debug(...) neu_zlog(neuron, ZLOG_LEVEL_DEBUG, __VA_ARGS__)
+
+#define nlog_ratelimit(level, interval, ...) \
+    neu_zlog_ratelimit(neuron, level, interval, __VA_ARGS__)
+
+#define plog_fatal(plugin, ...) \
+    neu_zlog((plugin)->common.log, ZLOG_LEVEL_FATAL, __VA_ARGS__)
+#define plog_error(plugin, ...) \
+    neu_zlog((plugin)->common.log, ZLOG_LEVEL_ERROR, __VA_ARGS__)
+#define plog_warn(plugin, ...) \
+    neu_zlog((plugin)->common.log, ZLOG_LEVEL_WARN, __VA_ARGS__)
+#define plog_notice(plugin, ...) \
+    neu_zlog((plugin)->common.log, ZLOG_LEVEL_NOTICE, __VA_ARGS__)
+#define plog_info(plugin, ...) \
+    neu_zlog((plugin)->common.log, ZLOG_LEVEL_INFO, __VA_ARGS__)
+#define plog_debug(plugin, ...) \
+    neu_zlog((plugin)->common.log, ZLOG_LEVEL_DEBUG, __VA_ARGS__)
+
+#define plog_ratelimit(plugin, level, interval, ...) \
+    neu_zlog_ratelimit((plugin)->common.log, level, interval, __VA_ARGS__)
 
 enum neu_protocol_log_type {
     NEU_PROTOCOL_SEND,
@@ -98,29 +158,33 @@ inline static void zlog_protocol(zlog_category_t *log, uint8_t *bytes,
                                  uint16_t                   n_byte,
                                  enum neu_protocol_log_type type)
 {
+    static const char    hex[]     = "0123456789ABCDEF";
     static __thread char buf[2048] = { 0 };
     int                  offset    = 0;
 
-    memset(buf, 0, sizeof(buf));
+    if (neu_capture_count > 0) {
+        neu_capture_packet(log, type == NEU_PROTOCOL_SEND, bytes, n_byte);
+    }
+
+    // the line would be dropped anyway, do not format it
+    if (!zlog_level_enabled(log, ZLOG_LEVEL_DEBUG)) {
+        return;
+    }
+
     if (type == NEU_PROTOCOL_SEND) {
         offset = snprintf(buf, sizeof(buf) - 1, ">>(%d)", n_byte);
     } else {
         offset = snprintf(buf, sizeof(buf) - 1, "<<(%d)", n_byte);
     }
 
-    for (int i = 0; i < n_byte; i++) {
-        if (sizeof(buf) > (size_t) offset && sizeof(buf) - offset > 10) {
-            int s_ret = snprintf(buf + offset, sizeof(buf) - offset - 1,
-                                 " 0x%02hhX", bytes[i]);
-            if (s_ret > 0) {
-                offset += s_ret;
-            } else {
-                break;
-            }
-        } else {
-            break;
-        }
+    for (int i = 0; i < n_byte && sizeof(buf) - offset > 10; i++) {
+        buf[offset++] = ' ';
+        buf[offset++] = '0';
+        buf[offset++] = 'x';
+        buf[offset++] = hex[bytes[i] >> 4];
+        buf[offset++] = hex[bytes[i] & 0x0F];
     }
+    buf[offset] = '\0';
 
     zlog_debug(log, "%s", buf);
 }
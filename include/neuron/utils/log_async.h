@@ -0,0 +1,68 @@
+/**
+ * NEURON IIoT System for Industry 4.0
+ * Copyright (C) 2020-2023 EMQ Technologies Co., Ltd All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ **/
+#ifndef _NEU_LOG_ASYNC_H_
+#define _NEU_LOG_ASYNC_H_
+
+#include <stdint.h>
+
+#include "utils/zlog.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Log files written by a background thread.
+ *
+ * A zlog rule `$async_file, "%V <path>"; <format>` only copies the line into
+ * a lock free ring, the writer thread appends the lines to the files in
+ * batches and rotates a file at 25MB into "<name>.00.log", like the default
+ * rule of zlog.conf does with `25MB * 1 ~ "<name>.#2r.log"`. A logging thread
+ * never waits for the disk, lines are dropped, and counted, once the ring
+ * fills up.
+ */
+
+typedef enum {
+    // debug and info lines are dropped once the ring is 3/4 full, keeping
+    // the rest of it for the more severe ones
+    NEU_LOG_OVERFLOW_DROP_DEBUG = 0,
+    // any line is dropped only once the ring is full
+    NEU_LOG_OVERFLOW_DROP_NEW,
+} neu_log_overflow_e;
+
+// drop_debug or drop_new, -1 if neither
+int neu_log_overflow_parse(const char *s, neu_log_overflow_e *overflow);
+
+// register the `async_file` record, after zlog_init, and start the writer
+int neu_log_async_init(neu_log_overflow_e overflow);
+// start the writer of this process again after a fork
+void neu_log_async_start();
+// write what is queued and stop the writer
+void neu_log_async_fini();
+
+// the record function, `msg->path` is the level and the file path
+int neu_log_async_record(zlog_msg_t *msg);
+
+// lines dropped since the start
+uint64_t neu_log_async_dropped();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
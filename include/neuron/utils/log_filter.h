@@ -0,0 +1,69 @@
+/**
+ * NEURON IIoT System for Industry 4.0
+ * Copyright (C) 2020-2023 EMQ Technologies Co., Ltd All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ **/
+
+#ifndef _NEU_LOG_FILTER_H_
+#define _NEU_LOG_FILTER_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "utils/utarray.h"
+
+// the "%d:%ms" stamp every line of zlog.conf starts with, e.g.
+// "2024-01-31 08:00:00:123", it sorts like the time it stands for
+#define NEU_LOG_STAMP_LEN 23
+
+// server side filtering of log files, one call per mapped file or per block
+// appended to the file while it is followed. A line without a stamp continues
+// the message above and follows its verdict on level and time.
+typedef struct {
+    int         level;                        // ZLOG_LEVEL_*, 0 for all
+    char        since[NEU_LOG_STAMP_LEN + 1]; // first stamp kept, "" for any
+    char        until[NEU_LOG_STAMP_LEN + 1]; // first stamp cut, "" for none
+    const char *match;                        // in the line, NULL for any
+    bool        matched;                      // verdict of the last stamp
+    bool        done;                         // a stamp past until was seen
+} neu_log_filter_t;
+
+// since and until are ms since the epoch, 0 for an open end
+void neu_log_filter_init(neu_log_filter_t *filter, int level, int64_t since,
+                         int64_t until, const char *match);
+
+// Calls cb with every run of consecutive lines kept, only complete lines are
+// looked at. Returns the bytes of data consumed, so that a partial line at the
+// end is presented again with the rest of it, or -1 if cb failed.
+typedef int (*neu_log_filter_cb_t)(void *arg, const char *data, size_t len);
+ssize_t neu_log_filter(neu_log_filter_t *filter, const char *data, size_t len,
+                       neu_log_filter_cb_t cb, void *arg);
+
+// the paths of the log files of node, the rotated ones first from the oldest,
+// an empty array if there are none
+UT_array *neu_log_files(const char *dir, const char *node);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,58 @@
+/**
+ * NEURON IIoT System for Industry 4.0
+ * Copyright (C) 2020-2023 EMQ Technologies Co., Ltd All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ **/
+#ifndef _NEU_MEM_BUDGET_H_
+#define _NEU_MEM_BUDGET_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// what nodes give up once the memory they account goes over a budget
+#define NEU_MEM_DROP_OLDEST 0x1      // apps drop the oldest queued trans data
+#define NEU_MEM_REJECT_SUBSCRIBE 0x2 // no new subscriptions are taken
+#define NEU_MEM_SHRINK_HISTORY 0x4   // drivers halve the history of tags
+#define NEU_MEM_POLICY_ALL \
+    (NEU_MEM_DROP_OLDEST | NEU_MEM_REJECT_SUBSCRIBE | NEU_MEM_SHRINK_HISTORY)
+
+// parse a comma separated list of drop_oldest, reject_subscribe and
+// shrink_history, or none, -1 if it names another policy
+int neu_mem_policy_parse(const char *s, uint32_t *policies);
+
+// the bytes all nodes together may account, 0 for no budget
+void     neu_mem_budget_set(size_t limit, uint32_t policies);
+size_t   neu_mem_budget_limit();
+uint32_t neu_mem_budget_policies();
+
+// the bytes accounted by all nodes
+size_t neu_mem_budget_used();
+// replace the bytes a node accounts, kept in accounted, with bytes. Pass 0 to
+// give them all back once the node goes
+void neu_mem_budget_account(size_t *accounted, size_t bytes);
+// whether there is a budget and the nodes account more than it
+bool neu_mem_budget_over();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,70 @@
+/**
+ * NEURON IIoT System for Industry 4.0
+ * Copyright (C) 2020-2023 EMQ Technologies Co., Ltd All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ **/
+
+#ifndef _NEU_PROFILE_H_
+#define _NEU_PROFILE_H_
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "define.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// longest sampling profile, in seconds
+#define NEU_PROFILE_SECONDS_MAX 60
+#define NEU_PROFILE_HZ_MAX 1000
+
+typedef struct {
+    char     node[NEU_NODE_NAME_LEN];
+    char     role[32];
+    uint64_t cpu_ms;
+} neu_profile_thread_t;
+
+// label a thread with the node it runs for, samples and cpu times of a thread
+// without a label are reported under its system name. The label of a thread
+// has to be dropped before the thread is joined or cancelled.
+void neu_profile_label_thread(pthread_t thread, const char *node,
+                              const char *role);
+void neu_profile_unlabel_thread(pthread_t thread);
+
+// cpu time of every labelled thread, the caller frees threads, cpu_ms is the
+// cpu time of the whole process
+int neu_profile_threads(neu_profile_thread_t **threads, int *n_thread,
+                        uint64_t *cpu_ms);
+
+// cpu time of the threads labelled with node, threads that exited are not
+// counted, so it only grows as long as the threads of the node live with it
+uint64_t neu_profile_node_cpu_ms(const char *node);
+
+// sample the stacks of the process for seconds at hz with SIGPROF, blocks
+// until done. The result is folded stacks, one line of `thread;outer;...;inner
+// count` per distinct stack, the caller frees folded.
+// Returns NEU_ERR_IS_BUSY if another profile is running.
+int neu_profile_sample(unsigned seconds, unsigned hz, char **folded,
+                       size_t *len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
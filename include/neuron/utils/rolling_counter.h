@@ -33,34 +33,64 @@ extern "C" {
  *
  * This counter is for counting values within some latest time span, like
  * network bytes sent within the last 5 seconds etc.
+ *
+ * The span is cut into bins of `res` milliseconds. Each bin packs the epoch
+ * it counts, the time stamp divided by `res`, in the high 32 bits and its
+ * count in the low 32 bits, so an update is a single compare and swap of the
+ * bin of its epoch that also clears what the bin held for an older epoch.
+ * Updates take no lock and touch no shared head, and readers sum the bins of
+ * the epochs within the span.
  */
+#define NEU_ROLLING_COUNTER_BINS_MAX 64
+
 typedef struct {
-    uint64_t val;      // accumulator
-    uint64_t ts;       // head time stamp in milliseconds
-    uint32_t res : 21; // time resolution in milliseconds
-    uint32_t hd : 5;   // head position
-    uint32_t n : 6;    // number of counters
-    uint32_t counts[]; // bins of counters
+    uint32_t res;    // time resolution in milliseconds
+    uint32_t n;      // number of bins
+    uint64_t bins[]; // epoch << 32 | count
 } neu_rolling_counter_t;
 
-/** Create rolling counter.
+/** Create rolling counter with bins of `res` milliseconds, coarsened to
+ * span at most NEU_ROLLING_COUNTER_BINS_MAX bins.
  *
  * @param   span   time span in milliseconds
+ * @param   res    time resolution in milliseconds, 0 for the default.
  */
-static inline neu_rolling_counter_t *neu_rolling_counter_new(unsigned span)
+static inline neu_rolling_counter_t *neu_rolling_counter_new_res(unsigned span,
+                                                                 unsigned res)
 {
-    unsigned n = span <= 6000 ? 4 : span <= 32000 ? 8 : span <= 64000 ? 16 : 32;
-    assert(span / n < (1 << 22)); // should not overflow ti
+    if (0 == res) {
+        unsigned n =
+            span <= 6000 ? 4 : span <= 32000 ? 8 : span <= 64000 ? 16 : 32;
+        res = span / n;
+    }
+    if (0 == res) {
+        res = 1;
+    }
+    if ((span + res - 1) / res > NEU_ROLLING_COUNTER_BINS_MAX) {
+        res = (span + NEU_ROLLING_COUNTER_BINS_MAX - 1) /
+            NEU_ROLLING_COUNTER_BINS_MAX;
+    }
+
+    unsigned n = span > res ? (span + res - 1) / res : 1;
 
     neu_rolling_counter_t *counter = (neu_rolling_counter_t *) calloc(
-        1, sizeof(*counter) + sizeof(counter->counts[0]) * n);
+        1, sizeof(*counter) + sizeof(counter->bins[0]) * n);
     if (counter) {
-        counter->res = span / n;
+        counter->res = res;
         counter->n   = n;
     }
     return counter;
 }
 
+/** Create rolling counter with the default resolution for the span.
+ *
+ * @param   span   time span in milliseconds
+ */
+static inline neu_rolling_counter_t *neu_rolling_counter_new(unsigned span)
+{
+    return neu_rolling_counter_new_res(span, 0);
+}
+
 /** Destructs the rolling counter.
  */
 static inline void neu_rolling_counter_free(neu_rolling_counter_t *counter)
@@ -70,7 +100,47 @@ static inline void neu_rolling_counter_free(neu_rolling_counter_t *counter)
     }
 }
 
-/** Increment the rolling counter and return the value;
+/** Add to the rolling counter, safe to call from several threads.
+ *
+ * @param   ts    time stamp in milliseconds
+ * @param   dt    delta value to increment by
+ */
+static inline void neu_rolling_counter_add(neu_rolling_counter_t *counter,
+                                           uint64_t ts, unsigned dt)
+{
+    uint32_t  epoch = ts / counter->res;
+    uint64_t *bin   = &counter->bins[epoch % counter->n];
+    uint64_t  old   = __atomic_load_n(bin, __ATOMIC_RELAXED);
+    uint64_t  val   = 0;
+
+    do {
+        uint64_t count = (uint32_t)(old >> 32) == epoch ? (uint32_t) old : 0;
+        count          = count + dt < UINT32_MAX ? count + dt : UINT32_MAX;
+        val            = (uint64_t) epoch << 32 | count;
+    } while (!__atomic_compare_exchange_n(bin, &old, val, true,
+                                          __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+}
+
+/** Return the sum of the bins within the span as of `ts`.
+ */
+static inline uint64_t
+neu_rolling_counter_value_at(const neu_rolling_counter_t *counter, uint64_t ts)
+{
+    uint32_t epoch = ts / counter->res;
+    uint64_t sum   = 0;
+
+    for (unsigned i = 0; i < counter->n; ++i) {
+        uint64_t bin = __atomic_load_n(&counter->bins[i], __ATOMIC_RELAXED);
+        if ((uint32_t)(epoch - (uint32_t)(bin >> 32)) < counter->n) {
+            sum += (uint32_t) bin;
+        }
+    }
+    return sum;
+}
+
+/** Increment the rolling counter and return the value.
+ *
+ * NOTE: sums all the bins, hot paths call neu_rolling_counter_add.
  *
  * @param   ts    time stamp in milliseconds, should be monotonic
  * @param   dt    delta value to increment by
@@ -78,34 +148,36 @@ static inline void neu_rolling_counter_free(neu_rolling_counter_t *counter)
 static inline uint64_t neu_rolling_counter_inc(neu_rolling_counter_t *counter,
                                                uint64_t ts, unsigned dt)
 {
-    uint64_t step = (ts - counter->ts) / counter->res;
-    for (unsigned i = 0; i < step && i < counter->n; ++i) {
-        counter->hd = (counter->hd + 1) & (counter->n - 1);
-        counter->val -= counter->counts[counter->hd];
-        counter->counts[counter->hd] = 0;
-    }
-    counter->val += dt;
-    counter->counts[counter->hd] += dt;
-    counter->ts += step * counter->res;
-    return counter->val;
+    neu_rolling_counter_add(counter, ts, dt);
+    return neu_rolling_counter_value_at(counter, ts);
 }
 
 /** Reset the counter.
  */
 static inline void neu_rolling_counter_reset(neu_rolling_counter_t *counter)
 {
-    counter->val = 0;
-    counter->hd  = 0;
-    memset(counter->counts, 0, counter->n * sizeof(counter->counts[0]));
+    for (unsigned i = 0; i < counter->n; ++i) {
+        __atomic_store_n(&counter->bins[i], 0, __ATOMIC_RELAXED);
+    }
 }
 
-/** Return the counter value.
+/** Return the counter value as of the latest update.
  *
  * NOTE: may return stale value if the counter is not updated frequent enough.
  */
 static inline uint64_t neu_rolling_counter_value(neu_rolling_counter_t *counter)
 {
-    return counter->val;
+    uint32_t latest = 0;
+
+    for (unsigned i = 0; i < counter->n; ++i) {
+        uint32_t epoch =
+            __atomic_load_n(&counter->bins[i], __ATOMIC_RELAXED) >> 32;
+        if ((int32_t)(epoch - latest) > 0) {
+            latest = epoch;
+        }
+    }
+    return neu_rolling_counter_value_at(counter, (uint64_t) latest *
+                                            counter->res);
 }
 
 #ifdef __cplusplus
@@ -0,0 +1,48 @@
+/**
+ * NEURON IIoT System for Industry 4.0
+ * Copyright (C) 2020-2021 EMQ Technologies Co., Ltd All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ **/
+
+#ifndef NEURON_UTILS_SNAPPY_H
+#define NEURON_UTILS_SNAPPY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Largest output of neu_snappy_compress for n bytes of input.
+ */
+static inline size_t neu_snappy_max_len(size_t n)
+{
+    return 32 + n + n / 6;
+}
+
+/** Compress n bytes of in into the snappy block format, as the Prometheus
+ * remote write protocol expects it. out has room for neu_snappy_max_len(n)
+ * bytes.
+ * @return the length of the output.
+ */
+size_t neu_snappy_compress(const uint8_t *in, size_t n, uint8_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -28,11 +28,44 @@ extern "C" {
 #include <sys/time.h>
 #include <time.h>
 
+// The clocks below are read through the vDSO without a system call. The
+// precise ones use the clocksource of the kernel, the TSC on most x86 hosts,
+// the coarse ones return the time of the last kernel tick (1-4 ms old) and
+// are cheaper still, good for scheduling and expiry but not for stamping.
+#ifndef CLOCK_REALTIME_COARSE
+#define CLOCK_REALTIME_COARSE CLOCK_REALTIME
+#endif
+#ifndef CLOCK_MONOTONIC_COARSE
+#define CLOCK_MONOTONIC_COARSE CLOCK_MONOTONIC
+#endif
+
+static inline int64_t neu_clock_ms(clockid_t clock)
+{
+    struct timespec ts = { 0 };
+    clock_gettime(clock, &ts);
+    return (int64_t) ts.tv_sec * 1000 + (int64_t) ts.tv_nsec / 1000000;
+}
+
+// wall clock, for timestamps
 static inline int64_t neu_time_ms()
 {
-    struct timeval tv = { 0 };
-    gettimeofday(&tv, NULL);
-    return (int64_t) tv.tv_sec * 1000 + (int64_t) tv.tv_usec / 1000;
+    return neu_clock_ms(CLOCK_REALTIME);
+}
+
+static inline int64_t neu_time_ms_coarse()
+{
+    return neu_clock_ms(CLOCK_REALTIME_COARSE);
+}
+
+// monotonic clock, for durations such as round trip times
+static inline int64_t neu_mono_ms()
+{
+    return neu_clock_ms(CLOCK_MONOTONIC);
+}
+
+static inline int64_t neu_mono_ms_coarse()
+{
+    return neu_clock_ms(CLOCK_MONOTONIC_COARSE);
 }
 
 static inline void neu_msleep(unsigned msec)
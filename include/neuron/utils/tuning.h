@@ -0,0 +1,118 @@
+/**
+ * NEURON IIoT System for Industry 4.0
+ * Copyright (C) 2020-2021 EMQ Technologies Co., Ltd All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ **/
+
+#ifndef NEURON_UTILS_TUNING_H
+#define NEURON_UTILS_TUNING_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// the reads of a group by duration, up to 1, 4, 16, 64, 256, 1024 ms and
+// longer, see neu_tuning_latency_bucket
+#define NEU_TUNING_LATENCY_N 7
+// a profile of fewer reads recommends nothing
+#define NEU_TUNING_READS_MIN 100
+// most advices for one group
+#define NEU_TUNING_ADVICES_MAX 4
+
+static inline int neu_tuning_latency_bucket(int64_t ms)
+{
+    int i = 0;
+
+    for (int64_t bound = 1; i < NEU_TUNING_LATENCY_N - 1 && ms > bound;
+         bound *= 4) {
+        i += 1;
+    }
+    return i;
+}
+
+/** The read statistics of a group, as persisted by its driver.
+ */
+typedef struct {
+    uint32_t interval; // ms
+    uint64_t reads;
+    uint64_t read_ms;  // the reads took in all
+    uint64_t overruns; // the reads longer than the interval
+    uint64_t blocks;   // device requests of all the reads, 0 if unknown
+    uint64_t latency[NEU_TUNING_LATENCY_N];
+
+    // the changes of each tag over the reads, and the poll divisor it is
+    // read with
+    uint32_t        n_tag;
+    const uint64_t *changes;
+    const uint16_t *poll_divisors;
+} neu_tuning_group_t;
+
+typedef enum {
+    // read the group every value ms
+    NEU_TUNING_INTERVAL,
+    // split the tags of the group over value groups
+    NEU_TUNING_SPLIT,
+    // read the group in fewer device requests than the value it takes now,
+    // with a larger gap between the addresses of one request
+    NEU_TUNING_MERGE_BLOCKS,
+    // move the tags of the advice to a group read every value ms
+    NEU_TUNING_SLOW_TAGS,
+} neu_tuning_kind_e;
+
+typedef struct {
+    neu_tuning_kind_e kind;
+    uint32_t          value;
+    uint32_t          n_tag; // NEU_TUNING_SLOW_TAGS only
+    uint32_t *        tags;  // indexes into neu_tuning_group_t.changes
+} neu_tuning_advice_t;
+
+static inline const char *neu_tuning_kind_str(neu_tuning_kind_e kind)
+{
+    switch (kind) {
+    case NEU_TUNING_INTERVAL:
+        return "interval";
+    case NEU_TUNING_SPLIT:
+        return "split";
+    case NEU_TUNING_MERGE_BLOCKS:
+        return "merge_blocks";
+    case NEU_TUNING_SLOW_TAGS:
+        return "slow_tags";
+    }
+    return "";
+}
+
+/** The ms under which percent of the reads ended, by the upper bound of
+ * their latency bucket, or twice the mean read for the last bucket.
+ */
+uint32_t neu_tuning_latency_ms(const neu_tuning_group_t *group,
+                               uint32_t                  percent);
+
+/** Recommend how to read the group, at most NEU_TUNING_ADVICES_MAX advices,
+ * each to be released with neu_tuning_advice_fini.
+ * @return the number of advices.
+ */
+int  neu_tuning_recommend(const neu_tuning_group_t *group,
+                          neu_tuning_advice_t *     advices);
+void neu_tuning_advice_fini(neu_tuning_advice_t *advice);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -86,7 +86,12 @@ do {
 #endif
 
 #ifndef HASH_FUNCTION
-#define HASH_FUNCTION(keyptr,keylen,hashv) HASH_JEN(keyptr, keylen, hashv)
+/* neuron: wyhash in place of the Jenkins hash, see utils/hash.h */
+#include "hash.h"
+#define HASH_FUNCTION(keyptr,keylen,hashv)                                       \
+  do {                                                                           \
+    (hashv) = neu_hash((keyptr), (size_t)(keylen));                              \
+  } while (0)
 #endif
 
 #ifndef HASH_KEYCMP
@@ -0,0 +1,52 @@
+/**
+ * NEURON IIoT System for Industry 4.0
+ * Copyright (C) 2020-2024 EMQ Technologies Co., Ltd All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ **/
+BEGIN TRANSACTION;
+
+-- the read statistics of a group, halved at each save as the new ones add up
+CREATE TABLE IF NOT EXISTS
+  group_profiles (
+    driver_name TEXT NOT NULL,
+    group_name TEXT NOT NULL,
+    reads INTEGER NOT NULL DEFAULT 0,
+    read_ms INTEGER NOT NULL DEFAULT 0,
+    overruns INTEGER NOT NULL DEFAULT 0,
+    blocks INTEGER NOT NULL DEFAULT 0,
+    le_1_ms INTEGER NOT NULL DEFAULT 0,
+    le_4_ms INTEGER NOT NULL DEFAULT 0,
+    le_16_ms INTEGER NOT NULL DEFAULT 0,
+    le_64_ms INTEGER NOT NULL DEFAULT 0,
+    le_256_ms INTEGER NOT NULL DEFAULT 0,
+    le_1024_ms INTEGER NOT NULL DEFAULT 0,
+    gt_1024_ms INTEGER NOT NULL DEFAULT 0,
+    UNIQUE (driver_name, group_name),
+    FOREIGN KEY (driver_name, group_name) REFERENCES groups (driver_name, name) ON UPDATE CASCADE ON DELETE CASCADE
+  );
+
+-- the value changes of the tags of a group, decaying alike
+CREATE TABLE IF NOT EXISTS
+  tag_profiles (
+    driver_name TEXT NOT NULL,
+    group_name TEXT NOT NULL,
+    tag_name TEXT NOT NULL,
+    changes INTEGER NOT NULL DEFAULT 0,
+    UNIQUE (driver_name, group_name, tag_name),
+    FOREIGN KEY (driver_name, group_name) REFERENCES groups (driver_name, name) ON UPDATE CASCADE ON DELETE CASCADE
+  );
+
+COMMIT;
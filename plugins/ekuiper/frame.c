@@ -0,0 +1,426 @@
+/**
+ * NEURON IIoT System for Industry 4.0
+ * Copyright (C) 2020-2023 EMQ Technologies Co., Ltd All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ **/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "utils/hash.h"
+#include "utils/utextend.h"
+
+#include "frame.h"
+
+#define FRAME_HEADER_SIZE 8
+
+void ekuiper_frame_reset(ekuiper_frame_t *frame)
+{
+    ekuiper_frame_schema_t *e = NULL, *tmp = NULL;
+    HASH_ITER(hh, frame->schemas, e, tmp)
+    {
+        HASH_DEL(frame->schemas, e);
+        free(e->names);
+        free(e);
+    }
+}
+
+void ekuiper_frame_fini(ekuiper_frame_t *frame)
+{
+    ekuiper_frame_reset(frame);
+    free(frame->buf);
+    free(frame->types);
+    memset(frame, 0, sizeof(*frame));
+}
+
+static int reserve(ekuiper_frame_t *frame, size_t n)
+{
+    if (frame->len + n <= frame->cap) {
+        return 0;
+    }
+
+    size_t cap = frame->cap ? frame->cap : 512;
+    while (cap < frame->len + n) {
+        cap *= 2;
+    }
+
+    uint8_t *buf = realloc(frame->buf, cap);
+    if (NULL == buf) {
+        return -1;
+    }
+    frame->buf = buf;
+    frame->cap = cap;
+    return 0;
+}
+
+static int put(ekuiper_frame_t *frame, const void *data, size_t n)
+{
+    if (reserve(frame, n) != 0) {
+        return -1;
+    }
+    memcpy(frame->buf + frame->len, data, n);
+    frame->len += n;
+    return 0;
+}
+
+// `n` bytes of `v` in little endian
+static int put_le(ekuiper_frame_t *frame, uint64_t v, int n)
+{
+    uint8_t b[8] = { 0 };
+
+    for (int i = 0; i < n; i++) {
+        b[i] = v & 0xff;
+        v >>= 8;
+    }
+    return put(frame, b, n);
+}
+
+static int put_raw(ekuiper_frame_t *frame, const void *data, size_t n)
+{
+    return put_le(frame, n, 2) == 0 ? put(frame, data, n) : -1;
+}
+
+static int put_str(ekuiper_frame_t *frame, const char *str, size_t max)
+{
+    return put_raw(frame, str, strnlen(str, max));
+}
+
+// start a frame of `type`, its length is filled in by end_frame
+static size_t begin_frame(ekuiper_frame_t *frame, uint8_t type, int *ret)
+{
+    uint8_t header[FRAME_HEADER_SIZE] = { EKUIPER_FRAME_MAGIC,
+                                          EKUIPER_FRAME_VERSION, type };
+    size_t  start                     = frame->len;
+
+    *ret |= put(frame, header, sizeof(header));
+    return start;
+}
+
+static void end_frame(ekuiper_frame_t *frame, size_t start)
+{
+    uint32_t len = frame->len - start - FRAME_HEADER_SIZE;
+
+    for (int i = 0; i < 4; i++) {
+        frame->buf[start + 4 + i] = (len >> (8 * i)) & 0xff;
+    }
+}
+
+// the type of the block holding `value`, 0 if it can not be encoded
+static uint8_t value_type(const neu_dvalue_t *value)
+{
+    const neu_value_u *v = &value->value;
+
+    switch (value->type) {
+    case NEU_TYPE_INT8:
+    case NEU_TYPE_UINT8:
+    case NEU_TYPE_INT16:
+    case NEU_TYPE_UINT16:
+    case NEU_TYPE_INT32:
+    case NEU_TYPE_UINT32:
+    case NEU_TYPE_INT64:
+    case NEU_TYPE_UINT64:
+    case NEU_TYPE_WORD:
+    case NEU_TYPE_DWORD:
+    case NEU_TYPE_LWORD:
+    case NEU_TYPE_FLOAT:
+    case NEU_TYPE_DOUBLE:
+    case NEU_TYPE_BOOL:
+    case NEU_TYPE_BIT:
+    case NEU_TYPE_STRING:
+    case NEU_TYPE_BYTES:
+    case NEU_TYPE_ERROR:
+        return value->type;
+    case NEU_TYPE_PTR:
+        if (NULL == v->ptr.ptr) {
+            return 0;
+        }
+        return v->ptr.type == NEU_TYPE_BYTES ? NEU_TYPE_BYTES
+                                             : NEU_TYPE_STRING;
+    default:
+        return 0;
+    }
+}
+
+static int put_value(ekuiper_frame_t *frame, const neu_dvalue_t *value)
+{
+    const neu_value_u *v = &value->value;
+    uint32_t           u32 = 0;
+    uint64_t           u64 = 0;
+
+    switch (value->type) {
+    case NEU_TYPE_INT8:
+    case NEU_TYPE_UINT8:
+    case NEU_TYPE_BIT:
+        return put_le(frame, v->u8, 1);
+    case NEU_TYPE_BOOL:
+        return put_le(frame, v->boolean ? 1 : 0, 1);
+    case NEU_TYPE_INT16:
+    case NEU_TYPE_UINT16:
+    case NEU_TYPE_WORD:
+        return put_le(frame, v->u16, 2);
+    case NEU_TYPE_INT32:
+    case NEU_TYPE_UINT32:
+    case NEU_TYPE_DWORD:
+    case NEU_TYPE_ERROR:
+        return put_le(frame, v->u32, 4);
+    case NEU_TYPE_INT64:
+    case NEU_TYPE_UINT64:
+    case NEU_TYPE_LWORD:
+        return put_le(frame, v->u64, 8);
+    case NEU_TYPE_FLOAT:
+        memcpy(&u32, &v->f32, sizeof(u32));
+        return put_le(frame, u32, 4);
+    case NEU_TYPE_DOUBLE:
+        memcpy(&u64, &v->d64, sizeof(u64));
+        return put_le(frame, u64, 8);
+    case NEU_TYPE_STRING:
+        return put_str(frame, v->str, sizeof(v->str));
+    case NEU_TYPE_BYTES:
+        return put_raw(frame, v->bytes.bytes, v->bytes.length);
+    case NEU_TYPE_PTR:
+        if (v->ptr.type == NEU_TYPE_BYTES) {
+            return put_raw(frame, v->ptr.ptr, v->ptr.length);
+        }
+        return put_str(frame, (char *) v->ptr.ptr, v->ptr.length);
+    default:
+        return -1;
+    }
+}
+
+static int tag_n_meta(const neu_resp_tag_value_meta_t *tag)
+{
+    int n = 0;
+
+    for (int k = 0; k < NEU_TAG_META_SIZE && tag->metas[k].name[0] != '\0';
+         k++) {
+        n += value_type(&tag->metas[k].value) != 0;
+    }
+    return n;
+}
+
+static bool schema_match(const ekuiper_frame_schema_t *schema, UT_array *tags)
+{
+    if (schema->n_tag != utarray_len(tags)) {
+        return false;
+    }
+
+    for (uint16_t i = 0; i < schema->n_tag; i++) {
+        neu_resp_tag_value_meta_t *tag = utarray_eltptr(tags, i);
+
+        if (strncmp(schema->names[i], tag->tag, NEU_TAG_NAME_LEN) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// find the schema of the group, or make a new one to be sent if the tags
+// changed, `*sent` tells whether the receiver knows it already
+static ekuiper_frame_schema_t *schema_get(ekuiper_frame_t *frame,
+                                         const char *node, const char *group,
+                                         UT_array *tags, bool *sent)
+{
+    ekuiper_frame_schema_t *schema = NULL;
+    uint16_t                n      = utarray_len(tags);
+
+    char   key[NEU_NODE_NAME_LEN + NEU_GROUP_NAME_LEN];
+    size_t len = neu_hash_key_pair(key, node, NEU_NODE_NAME_LEN, group,
+                                   NEU_GROUP_NAME_LEN);
+
+    HASH_FIND(hh, frame->schemas, key, len, schema);
+    if (NULL != schema && schema_match(schema, tags)) {
+        *sent = true;
+        return schema;
+    }
+
+    if (NULL == schema) {
+        schema = calloc(1, sizeof(*schema));
+        if (NULL == schema) {
+            return NULL;
+        }
+        memcpy(schema->key, key, len);
+        HASH_ADD(hh, frame->schemas, key, len, schema);
+    }
+
+    char(*names)[NEU_TAG_NAME_LEN] =
+        realloc(schema->names, (n ? n : 1) * sizeof(*names));
+    if (NULL == names) {
+        HASH_DEL(frame->schemas, schema);
+        free(schema->names);
+        free(schema);
+        return NULL;
+    }
+
+    for (uint16_t i = 0; i < n; i++) {
+        neu_resp_tag_value_meta_t *tag = utarray_eltptr(tags, i);
+
+        memset(names[i], 0, sizeof(names[i]));
+        strncpy(names[i], tag->tag, sizeof(names[i]) - 1);
+    }
+    schema->names = names;
+    schema->n_tag = n;
+    schema->id    = frame->next_id++;
+    *sent         = false;
+    return schema;
+}
+
+static void put_schema(ekuiper_frame_t *               frame,
+                       const ekuiper_frame_schema_t *schema, const char *node,
+                       const char *group, int *ret)
+{
+    size_t start = begin_frame(frame, EKUIPER_FRAME_SCHEMA, ret);
+
+    *ret |= put_le(frame, schema->id, 4);
+    *ret |= put_str(frame, node, NEU_NODE_NAME_LEN);
+    *ret |= put_str(frame, group, NEU_GROUP_NAME_LEN);
+    *ret |= put_le(frame, schema->n_tag, 2);
+    for (uint16_t i = 0; i < schema->n_tag; i++) {
+        *ret |= put_str(frame, schema->names[i], NEU_TAG_NAME_LEN);
+    }
+    if (0 == *ret) {
+        end_frame(frame, start);
+    }
+}
+
+static void put_metas(ekuiper_frame_t *frame, UT_array *tags, uint16_t count,
+                      int *ret)
+{
+    uint16_t n = utarray_len(tags);
+
+    *ret |= put_le(frame, EKUIPER_FRAME_METAS, 1);
+    *ret |= put_le(frame, count, 2);
+    for (uint16_t i = 0; i < n; i++) {
+        neu_resp_tag_value_meta_t *tag    = utarray_eltptr(tags, i);
+        int                        n_meta = tag_n_meta(tag);
+
+        if (0 == n_meta) {
+            continue;
+        }
+
+        *ret |= put_le(frame, i, 2);
+        *ret |= put_le(frame, n_meta, 1);
+        for (int k = 0; k < NEU_TAG_META_SIZE && tag->metas[k].name[0] != '\0';
+             k++) {
+            const neu_tag_meta_t *meta = &tag->metas[k];
+            uint8_t               type = value_type(&meta->value);
+
+            if (0 != type) {
+                *ret |= put_str(frame, meta->name, sizeof(meta->name));
+                *ret |= put_le(frame, type, 1);
+                *ret |= put_value(frame, &meta->value);
+            }
+        }
+    }
+}
+
+static void put_data(ekuiper_frame_t *               frame,
+                     const ekuiper_frame_schema_t *schema, uint64_t timestamp,
+                     UT_array *tags, int *ret)
+{
+    uint16_t counts[NEU_TYPE_PTR + 1] = { 0 };
+    uint16_t n                        = utarray_len(tags);
+    uint16_t n_block = 0, n_metas = 0;
+    size_t   start = begin_frame(frame, EKUIPER_FRAME_DATA, ret);
+
+    for (uint16_t i = 0; i < n; i++) {
+        neu_resp_tag_value_meta_t *tag = utarray_eltptr(tags, i);
+
+        frame->types[i] = value_type(&tag->value);
+        counts[frame->types[i]] += 1;
+        n_metas += tag_n_meta(tag) > 0;
+    }
+    for (uint8_t type = 1; type <= NEU_TYPE_PTR; type++) {
+        n_block += counts[type] > 0;
+    }
+
+    *ret |= put_le(frame, schema->id, 4);
+    *ret |= put_le(frame, timestamp, 8);
+    *ret |= put_le(frame, n_block + (n_metas > 0), 2);
+
+    for (uint8_t type = 1; type <= NEU_TYPE_PTR; type++) {
+        if (0 == counts[type]) {
+            continue;
+        }
+
+        *ret |= put_le(frame, type, 1);
+        *ret |= put_le(frame, counts[type], 2);
+        for (uint16_t i = 0; i < n; i++) {
+            if (frame->types[i] == type) {
+                *ret |= put_le(frame, i, 2);
+            }
+        }
+        for (uint16_t i = 0; i < n; i++) {
+            if (frame->types[i] == type) {
+                neu_resp_tag_value_meta_t *tag = utarray_eltptr(tags, i);
+
+                *ret |= put_value(frame, &tag->value);
+            }
+        }
+    }
+
+    if (n_metas > 0) {
+        put_metas(frame, tags, n_metas, ret);
+    }
+    if (0 == *ret) {
+        end_frame(frame, start);
+    }
+}
+
+int ekuiper_frame_encode(ekuiper_frame_t *frame, const char *node,
+                         const char *group, uint64_t timestamp,
+                         UT_array *tags)
+{
+    ekuiper_frame_schema_t *schema = NULL;
+    size_t                  n      = utarray_len(tags);
+    bool                    sent   = false;
+    int                     ret    = 0;
+
+    frame->len = 0;
+
+    if (n > UINT16_MAX) {
+        return -1;
+    }
+
+    if (n > frame->n_types) {
+        uint8_t *types = realloc(frame->types, n);
+        if (NULL == types) {
+            return -1;
+        }
+        frame->types   = types;
+        frame->n_types = n;
+    }
+
+    schema = schema_get(frame, node, group, tags, &sent);
+    if (NULL == schema) {
+        return -1;
+    }
+
+    if (!sent) {
+        put_schema(frame, schema, node, group, &ret);
+    }
+    put_data(frame, schema, timestamp, tags, &ret);
+
+    if (0 != ret) {
+        // the receiver may not get this schema, send it again next time
+        if (!sent) {
+            HASH_DEL(frame->schemas, schema);
+            free(schema->names);
+            free(schema);
+        }
+        return -1;
+    }
+    return 0;
+}
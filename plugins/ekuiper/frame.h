@@ -0,0 +1,115 @@
+/**
+ * NEURON IIoT System for Industry 4.0
+ * Copyright (C) 2020-2023 EMQ Technologies Co., Ltd All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ **/
+
+#ifndef NEURON_PLUGIN_EKUIPER_FRAME_H
+#define NEURON_PLUGIN_EKUIPER_FRAME_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "neuron.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Binary frame format of the eKuiper channel.
+//
+// A message holds one or more frames, each starting with an 8 byte header:
+//
+//   u8  magic   0xeb, a json message starts with '{' instead
+//   u8  version 1
+//   u8  type    1 schema, 2 data
+//   u8  reserved
+//   u32 length  of the frame body following the header
+//
+// Integers are little endian, a str is a u16 length followed by the bytes.
+//
+// A schema frame names the tags of one group, so that data frames refer to
+// tags by their index in the schema:
+//
+//   u32 schema id, str node, str group, u16 n_tag, n_tag * str tag name
+//
+// A data frame carries the values of a group as typed columns:
+//
+//   u32 schema id, u64 timestamp in ms, u16 n_block, n_block * block
+//
+// and a block holds the tags of one type:
+//
+//   u8  neu_type_e of the tags, NEU_TYPE_ERROR for tags in error
+//   u16 count
+//   count * u16 tag index
+//   count * value
+//
+// Values are fixed size for numbers, 1 byte for bool and bit, str for
+// strings and bytes, and i32 error codes for errors. Floats are not rounded
+// to the tag precision. A block of type EKUIPER_FRAME_METAS, if present,
+// holds the metas of the tags that have any instead:
+//
+//   u16 count, count * { u16 tag index, u8 n_meta,
+//                        n_meta * { str name, u8 neu_type_e, value } }
+//
+// A schema is sent in the same message as the first data frame using it,
+// and again whenever the tags of the group change. Schema ids are valid for
+// one connection, schemas are sent again after a reconnection.
+#define EKUIPER_FRAME_MAGIC 0xeb
+#define EKUIPER_FRAME_VERSION 1
+#define EKUIPER_FRAME_SCHEMA 1
+#define EKUIPER_FRAME_DATA 2
+#define EKUIPER_FRAME_METAS 0xff
+
+typedef struct ekuiper_frame_schema {
+    // "node\0group"
+    char           key[NEU_NODE_NAME_LEN + NEU_GROUP_NAME_LEN];
+    uint32_t       id;
+    uint16_t       n_tag;
+    char (*names)[NEU_TAG_NAME_LEN];
+    UT_hash_handle hh;
+} ekuiper_frame_schema_t;
+
+typedef struct {
+    ekuiper_frame_schema_t *schemas;
+    uint32_t                next_id;
+    uint8_t *               buf;
+    size_t                  len;
+    size_t                  cap;
+    uint8_t *               types; // the block type of every tag encoded
+    size_t                  n_types;
+} ekuiper_frame_t;
+
+// forget the schemas sent, for a new connection or after a lost message
+void ekuiper_frame_reset(ekuiper_frame_t *frame);
+void ekuiper_frame_fini(ekuiper_frame_t *frame);
+
+/**
+ * @brief Encode a message of the group values into frame->buf, replacing what
+ *        was there, preceded by the group schema if it was not sent yet.
+ *
+ * @param[in] tags UT_array of neu_resp_tag_value_meta_t.
+ * @return 0 on success, -1 if out of memory or the group has too many tags.
+ */
+int ekuiper_frame_encode(ekuiper_frame_t *frame, const char *node,
+                         const char *group, uint64_t timestamp,
+                         UT_array *tags);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -20,158 +20,61 @@
 #include <jansson.h>
 
 #include "neuron.h"
+#include "json/neu_json_scan.h"
 #include "utils/log.h"
 
 #include "json_rw.h"
 #include "plugin_ekuiper.h"
 
-int json_encode_read_resp_header(void *json_object, void *param)
-{
-    int                      ret    = 0;
-    json_read_resp_header_t *header = param;
-
-    neu_json_elem_t resp_elems[] = { {
-                                         .name      = "node_name",
-                                         .t         = NEU_JSON_STR,
-                                         .v.val_str = header->node_name,
-                                     },
-                                     {
-                                         .name      = "group_name",
-                                         .t         = NEU_JSON_STR,
-                                         .v.val_str = header->group_name,
-                                     },
-                                     {
-                                         .name      = "timestamp",
-                                         .t         = NEU_JSON_INT,
-                                         .v.val_int = header->timestamp,
-                                     } };
-    ret = neu_json_encode_field(json_object, resp_elems,
-                                NEU_JSON_ELEM_SIZE(resp_elems));
+#define SCAN_NODE (1u << 0)
+#define SCAN_GROUP (1u << 1)
+#define SCAN_TAG (1u << 2)
+#define SCAN_VALUE (1u << 3)
 
-    return ret;
-}
-
-int json_encode_read_resp_tags(void *json_object, void *param)
+// decode without a document tree, -1 to leave the message to jansson
+static int scan_write_req(const char *buf, size_t len, json_write_req_t *req)
 {
-    int                       ret           = 0;
-    json_read_resp_t *        resp          = param;
-    neu_plugin_t *            plugin        = resp->plugin;
-    neu_reqresp_trans_data_t *trans_data    = resp->trans_data;
-    void *                    values_object = NULL;
-    void *                    errors_object = NULL;
-    void *                    metas_object  = NULL;
-
-    metas_object = neu_json_encode_new();
-    if (NULL == metas_object) {
-        plog_error(plugin, "ekuiper cannot allocate json object");
-        return -1;
-    }
-
-    values_object = neu_json_encode_new();
-    if (NULL == values_object) {
-        plog_error(plugin, "ekuiper cannot allocate json object");
-        json_decref(metas_object);
-        return -1;
-    }
-    errors_object = neu_json_encode_new();
-    if (NULL == errors_object) {
-        plog_error(plugin, "ekuiper cannot allocate json object");
-        json_decref(values_object);
-        json_decref(metas_object);
+    neu_json_scan_t scan  = { 0 };
+    unsigned        seen  = 0;
+    unsigned        bit   = 0;
+    int             index = 0;
+    int             rv    = 0;
+    const char *    key   = NULL;
+    size_t          n     = 0;
+
+    neu_json_scan_init(&scan, buf, len);
+    if (neu_json_scan_object(&scan) != 0) {
         return -1;
     }
-
-    utarray_foreach(trans_data->tags, neu_resp_tag_value_meta_t *, tag_value)
-    {
-        neu_json_read_resp_tag_t json_tag = { 0 };
-
-        neu_tag_value_to_json(tag_value, &json_tag);
-
-        neu_json_elem_t tag_elem = {
-            .name      = json_tag.name,
-            .t         = json_tag.t,
-            .v         = json_tag.value,
-            .precision = tag_value->value.precision,
-        };
-
-        if (json_tag.n_meta > 0) {
-            void *meta = neu_json_encode_new();
-            for (int k = 0; k < json_tag.n_meta; k++) {
-                neu_json_elem_t meta_elem = {
-                    .name = json_tag.metas[k].name,
-                    .t    = json_tag.metas[k].t,
-                    .v    = json_tag.metas[k].value,
-                };
-                neu_json_encode_field(meta, &meta_elem, 1);
-            }
-
-            neu_json_elem_t meta_elem = {
-                .name         = json_tag.name,
-                .t            = NEU_JSON_OBJECT,
-                .v.val_object = meta,
-            };
-            neu_json_encode_field(metas_object, &meta_elem, 1);
-            free(json_tag.metas);
+    while ((rv = neu_json_scan_key(&scan, &index, &key, &n)) > 0) {
+        if (neu_json_scan_key_is(key, n, "node_name")) {
+            bit = SCAN_NODE;
+            rv  = seen & bit ? -1 : neu_json_scan_str(&scan, &req->node_name);
+        } else if (neu_json_scan_key_is(key, n, "group_name")) {
+            bit = SCAN_GROUP;
+            rv  = seen & bit ? -1 : neu_json_scan_str(&scan, &req->group_name);
+        } else if (neu_json_scan_key_is(key, n, "tag_name")) {
+            bit = SCAN_TAG;
+            rv  = seen & bit ? -1 : neu_json_scan_str(&scan, &req->tag_name);
+        } else if (neu_json_scan_key_is(key, n, "value")) {
+            bit = SCAN_VALUE;
+            rv  = seen & bit ? -1
+                            : neu_json_scan_value(&scan, &req->t, &req->value);
+        } else {
+            bit = 0;
+            rv  = neu_json_scan_skip(&scan);
         }
-
-        ret = neu_json_encode_field((0 != json_tag.error) ? errors_object
-                                                          : values_object,
-                                    &tag_elem, 1);
-        if (0 != ret) {
-            json_decref(errors_object);
-            json_decref(values_object);
-            json_decref(metas_object);
-            return ret;
+        if (rv != 0) {
+            return -1;
         }
+        seen |= bit;
     }
 
-    neu_json_elem_t resp_elems[] = {
-        {
-            .name         = "values",
-            .t            = NEU_JSON_OBJECT,
-            .v.val_object = values_object,
-        },
-        {
-            .name         = "errors",
-            .t            = NEU_JSON_OBJECT,
-            .v.val_object = errors_object,
-
-        },
-        {
-            .name         = "metas",
-            .t            = NEU_JSON_OBJECT,
-            .v.val_object = metas_object,
-        },
-    };
-    // steals `values_object` and `errors_object`
-    ret = neu_json_encode_field(json_object, resp_elems,
-                                NEU_JSON_ELEM_SIZE(resp_elems));
-
-    return ret;
-}
-
-int json_encode_read_resp(void *json_object, void *param)
-{
-    int                       ret        = 0;
-    json_read_resp_t *        resp       = param;
-    neu_plugin_t *            plugin     = resp->plugin;
-    neu_reqresp_trans_data_t *trans_data = resp->trans_data;
-
-    json_read_resp_header_t header = { .group_name = trans_data->group,
-                                       .node_name  = trans_data->driver,
-                                       .timestamp  = global_timestamp };
-
-    ret = json_encode_read_resp_header(json_object, &header);
-    if (0 != ret) {
-        plog_error(plugin,
-                   "ekuiper fail encode data header node:%s group:%s, %" PRIu64,
-                   header.node_name, header.group_name, header.timestamp);
-        return ret;
+    if (rv != 0 || neu_json_scan_end(&scan) != 0 ||
+        seen != (SCAN_NODE | SCAN_GROUP | SCAN_TAG | SCAN_VALUE)) {
+        return -1;
     }
-
-    ret = json_encode_read_resp_tags(json_object, param);
-
-    return ret;
+    return 0;
 }
 
 int json_decode_write_req(char *buf, size_t len, json_write_req_t **result)
@@ -183,6 +86,16 @@ int json_decode_write_req(char *buf, size_t len, json_write_req_t **result)
         return -1;
     }
 
+    if (scan_write_req(buf, len, req) == 0) {
+        *result = req;
+        return 0;
+    }
+    json_decode_write_req_free(req);
+    req = calloc(1, sizeof(json_write_req_t));
+    if (req == NULL) {
+        return -1;
+    }
+
     json_obj = neu_json_decode_newb(buf, len);
     if (NULL == json_obj) {
         free(req);
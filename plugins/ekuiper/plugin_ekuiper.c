@@ -18,6 +18,7 @@
  **/
 
 #include <arpa/inet.h>
+#include <errno.h>
 #include <netinet/in.h>
 #include <sys/socket.h>
 
@@ -60,6 +61,8 @@ static void pipe_add_cb(nng_pipe p, nng_pipe_ev ev, void *arg)
     neu_plugin_t *plugin = arg;
     nng_mtx_lock(plugin->mtx);
     plugin->common.link_state = NEU_NODE_LINK_STATE_CONNECTED;
+    // the new peer knows no schema
+    plugin->frame_reset = true;
     nng_mtx_unlock(plugin->mtx);
 }
 
@@ -98,8 +101,10 @@ static int ekuiper_plugin_init(neu_plugin_t *plugin, bool load)
         return rv;
     }
 
-    plugin->recv_aio = recv_aio;
+    plugin->recv_aio   = recv_aio;
+    plugin->send_queue = EKUIPER_SEND_QUEUE_DEFAULT;
 
+    NEU_PLUGIN_REGISTER_METRIC(plugin, NEU_METRIC_SEND_MSGS_DROPPED_TOTAL, 0);
     NEU_PLUGIN_REGISTER_METRIC(plugin, NEU_METRIC_TRANS_DATA_5S, 5000);
     NEU_PLUGIN_REGISTER_METRIC(plugin, NEU_METRIC_TRANS_DATA_30S, 30000);
     NEU_PLUGIN_REGISTER_METRIC(plugin, NEU_METRIC_TRANS_DATA_60S, 60000);
@@ -113,18 +118,66 @@ static int ekuiper_plugin_init(neu_plugin_t *plugin, bool load)
     NEU_PLUGIN_REGISTER_METRIC(plugin, NEU_METRIC_RECV_MSGS_30S, 30000);
     NEU_PLUGIN_REGISTER_METRIC(plugin, NEU_METRIC_RECV_MSGS_60S, 60000);
     NEU_PLUGIN_REGISTER_METRIC(plugin, NEU_METRIC_DISCONNECTION_60S, 60000);
-    NEU_PLUGIN_REGISTER_METRIC(plugin, NEU_METRIC_DISCONNECTION_600S, 600000);
-    NEU_PLUGIN_REGISTER_METRIC(plugin, NEU_METRIC_DISCONNECTION_1800S, 1800000);
+    // disconnections are rare, bins of a minute are fine enough
+    NEU_PLUGIN_REGISTER_METRIC(plugin, NEU_METRIC_DISCONNECTION_600S,
+                               NEU_METRIC_ROLLING(600000, 60000));
+    NEU_PLUGIN_REGISTER_METRIC(plugin, NEU_METRIC_DISCONNECTION_1800S,
+                               NEU_METRIC_ROLLING(1800000, 60000));
 
     plog_notice(plugin, "plugin initialized");
     return rv;
 }
 
+static void send_queue_free(neu_plugin_t *plugin)
+{
+    // waits for the callbacks of messages being sent
+    for (size_t i = 0; i < plugin->n_send_slots; ++i) {
+        nng_aio_free(plugin->send_slots[i].aio);
+    }
+    free(plugin->send_slots);
+    free(plugin->send_idle);
+    plugin->send_slots   = NULL;
+    plugin->send_idle    = NULL;
+    plugin->n_send_idle  = 0;
+    plugin->n_send_slots = 0;
+}
+
+static int send_queue_new(neu_plugin_t *plugin, size_t size)
+{
+    plugin->send_slots = calloc(size, sizeof(*plugin->send_slots));
+    plugin->send_idle  = calloc(size, sizeof(*plugin->send_idle));
+    if (NULL == plugin->send_slots || NULL == plugin->send_idle) {
+        plog_error(plugin, "cannot allocate send queue of %zu", size);
+        send_queue_free(plugin);
+        return -1;
+    }
+
+    for (size_t i = 0; i < size; ++i) {
+        send_slot_t *slot = &plugin->send_slots[i];
+        int          rv   = nng_aio_alloc(&slot->aio, send_data_callback, slot);
+        if (0 != rv) {
+            plog_error(plugin, "cannot allocate send_aio: %s",
+                       nng_strerror(rv));
+            send_queue_free(plugin);
+            return -1;
+        }
+        slot->plugin                             = plugin;
+        plugin->send_idle[plugin->n_send_idle++] = slot;
+        plugin->n_send_slots += 1;
+    }
+
+    return 0;
+}
+
 static int ekuiper_plugin_uninit(neu_plugin_t *plugin)
 {
     int rv = 0;
 
     nng_close(plugin->sock);
+    send_queue_free(plugin);
+    ekuiper_shm_close(plugin->shm);
+    neu_json_stream_fini(&plugin->send_json);
+    ekuiper_frame_fini(&plugin->frame);
     nng_aio_free(plugin->recv_aio);
     nng_mtx_free(plugin->mtx);
     free(plugin->host);
@@ -134,13 +187,41 @@ static int ekuiper_plugin_uninit(neu_plugin_t *plugin)
     return rv;
 }
 
-static inline int start(neu_plugin_t *plugin, const char *url)
+static int shm_open_ring(neu_plugin_t *plugin, uint16_t port, size_t shm_size)
+{
+    char path[64] = { 0 };
+
+    if (0 == shm_size) {
+        return 0;
+    }
+
+    // one ring per listening port, eKuiper finds it by the port it connects
+    snprintf(path, sizeof(path), EKUIPER_SHM_PATH_FMT, port);
+    plugin->shm = ekuiper_shm_open(path, shm_size * 1024);
+    if (NULL == plugin->shm) {
+        plog_error(plugin, "cannot create shm ring %s: %s", path,
+                   strerror(errno));
+        return -1;
+    }
+
+    plog_notice(plugin, "sending data through shm ring %s of %zu KiB", path,
+                shm_size);
+    return 0;
+}
+
+static inline int start(neu_plugin_t *plugin, const char *url,
+                        size_t send_queue, uint16_t port, size_t shm_size)
 {
     int rv = 0;
 
+    if (0 != send_queue_new(plugin, send_queue)) {
+        return NEU_ERR_EINTERNAL;
+    }
+
     rv = nng_pair0_open(&plugin->sock);
     if (rv != 0) {
         plog_error(plugin, "nng_pair0_open: %s", nng_strerror(rv));
+        send_queue_free(plugin);
         return NEU_ERR_EINTERNAL;
     }
 
@@ -152,6 +233,7 @@ static inline int start(neu_plugin_t *plugin, const char *url)
     if ((rv = nng_listen(plugin->sock, url, NULL, 0)) != 0) {
         plog_error(plugin, "nng_listen: %s", nng_strerror(rv));
         nng_close(plugin->sock);
+        send_queue_free(plugin);
         if (NNG_EADDRINVAL == rv) {
             rv = NEU_ERR_IP_ADDRESS_INVALID;
         } else if (NNG_EADDRINUSE == rv) {
@@ -162,6 +244,12 @@ static inline int start(neu_plugin_t *plugin, const char *url)
         return rv;
     }
 
+    if (0 != shm_open_ring(plugin, port, shm_size)) {
+        nng_close(plugin->sock);
+        send_queue_free(plugin);
+        return NEU_ERR_EINTERNAL;
+    }
+
     nng_recv_aio(plugin->sock, plugin->recv_aio);
     return NEU_ERR_SUCCESS;
 }
@@ -171,7 +259,8 @@ static int ekuiper_plugin_start(neu_plugin_t *plugin)
     int   rv  = 0;
     char *url = plugin->url ? plugin->url : EKUIPER_PLUGIN_URL; // default url
 
-    rv = start(plugin, url);
+    rv = start(plugin, url, plugin->send_queue, plugin->port,
+               plugin->shm_size);
     if (rv != 0) {
         return rv;
     }
@@ -185,6 +274,9 @@ static int ekuiper_plugin_start(neu_plugin_t *plugin)
 static inline void stop(neu_plugin_t *plugin)
 {
     nng_close(plugin->sock);
+    send_queue_free(plugin);
+    ekuiper_shm_close(plugin->shm);
+    plugin->shm = NULL;
 }
 
 static int ekuiper_plugin_stop(neu_plugin_t *plugin)
@@ -196,13 +288,34 @@ static int ekuiper_plugin_stop(neu_plugin_t *plugin)
 }
 
 static int parse_config(neu_plugin_t *plugin, const char *setting,
-                        char **host_p, uint16_t *port_p)
+                        char **host_p, uint16_t *port_p, size_t *send_queue_p,
+                        ekuiper_format_e *format_p, size_t *shm_size_p)
 {
-    char *          err_param = NULL;
-    neu_json_elem_t host      = { .name = "host", .t = NEU_JSON_STR };
-    neu_json_elem_t port      = { .name = "port", .t = NEU_JSON_INT };
-
-    if (0 != neu_parse_param(setting, &err_param, 2, &host, &port)) {
+    char *          err_param  = NULL;
+    neu_json_elem_t host       = { .name = "host", .t = NEU_JSON_STR };
+    neu_json_elem_t port       = { .name = "port", .t = NEU_JSON_INT };
+    neu_json_elem_t send_queue = {
+        .name      = "send-queue",
+        .t         = NEU_JSON_INT,
+        .v.val_int = EKUIPER_SEND_QUEUE_DEFAULT,
+        .attribute = NEU_JSON_ATTRIBUTE_OPTIONAL,
+    };
+    neu_json_elem_t format = {
+        .name      = "format",
+        .t         = NEU_JSON_INT,
+        .v.val_int = EKUIPER_FORMAT_JSON,
+        .attribute = NEU_JSON_ATTRIBUTE_OPTIONAL,
+    };
+    neu_json_elem_t shm_size = {
+        .name      = "shm-size",
+        .t         = NEU_JSON_INT,
+        .v.val_int = 0,
+        .attribute = NEU_JSON_ATTRIBUTE_OPTIONAL,
+    };
+
+    if (0 !=
+        neu_parse_param(setting, &err_param, 5, &host, &port, &send_queue,
+                        &format, &shm_size)) {
         plog_error(plugin, "parsing setting fail, key: `%s`", err_param);
         goto error;
     }
@@ -225,10 +338,39 @@ static int parse_config(neu_plugin_t *plugin, const char *setting,
         goto error;
     }
 
-    *host_p = host.v.val_str;
-    *port_p = port.v.val_int;
+    // send queue, optional
+    if (send_queue.v.val_int < 1 ||
+        EKUIPER_SEND_QUEUE_MAX < send_queue.v.val_int) {
+        plog_error(plugin, "setting invalid send queue: %" PRIi64,
+                   send_queue.v.val_int);
+        goto error;
+    }
+
+    // format, optional
+    if (EKUIPER_FORMAT_JSON != format.v.val_int &&
+        EKUIPER_FORMAT_BINARY != format.v.val_int) {
+        plog_error(plugin, "setting invalid format: %" PRIi64,
+                   format.v.val_int);
+        goto error;
+    }
 
-    plog_notice(plugin, "config host:%s port:%" PRIu16, *host_p, *port_p);
+    // shm size, optional
+    if (shm_size.v.val_int < 0 || EKUIPER_SHM_SIZE_MAX < shm_size.v.val_int) {
+        plog_error(plugin, "setting invalid shm size: %" PRIi64,
+                   shm_size.v.val_int);
+        goto error;
+    }
+
+    *host_p       = host.v.val_str;
+    *port_p       = port.v.val_int;
+    *send_queue_p = send_queue.v.val_int;
+    *format_p     = format.v.val_int;
+    *shm_size_p   = shm_size.v.val_int;
+
+    plog_notice(plugin,
+                "config host:%s port:%" PRIu16
+                " send-queue:%zu format:%d shm-size:%zu",
+                *host_p, *port_p, *send_queue_p, *format_p, *shm_size_p);
 
     return 0;
 
@@ -240,12 +382,17 @@ error:
 
 static int ekuiper_plugin_config(neu_plugin_t *plugin, const char *setting)
 {
-    int      rv   = 0;
-    char *   url  = NULL;
-    char *   host = NULL;
-    uint16_t port = 0;
-
-    if (0 != parse_config(plugin, setting, &host, &port)) {
+    int              rv         = 0;
+    char *           url        = NULL;
+    char *           host       = NULL;
+    uint16_t         port       = 0;
+    size_t           send_queue = 0;
+    ekuiper_format_e format     = EKUIPER_FORMAT_JSON;
+    size_t           shm_size   = 0;
+
+    if (0 !=
+        parse_config(plugin, setting, &host, &port, &send_queue, &format,
+                     &shm_size)) {
         rv = NEU_ERR_NODE_SETTING_INVALID;
         goto error;
     }
@@ -262,9 +409,11 @@ static int ekuiper_plugin_config(neu_plugin_t *plugin, const char *setting)
     }
 
     // check we could start the plugin with the new setting
-    if (0 != (rv = start(plugin, url))) {
+    if (0 != (rv = start(plugin, url, send_queue, port, shm_size))) {
         // recover with old setting
-        if (plugin->started && 0 != start(plugin, plugin->url)) {
+        if (plugin->started &&
+            0 != start(plugin, plugin->url, plugin->send_queue, plugin->port,
+                       plugin->shm_size)) {
             plog_warn(plugin, "restart host:%s port:%" PRIu16 " fail",
                       plugin->host, plugin->port);
         }
@@ -279,9 +428,14 @@ static int ekuiper_plugin_config(neu_plugin_t *plugin, const char *setting)
 
     free(plugin->host);
     free(plugin->url);
-    plugin->host = host;
-    plugin->port = port;
-    plugin->url  = url;
+    plugin->host       = host;
+    plugin->port       = port;
+    plugin->url        = url;
+    plugin->send_queue = send_queue;
+    plugin->format     = format;
+    plugin->shm_size   = shm_size;
+    // connections restarted, requests are handled on this thread as well
+    ekuiper_frame_reset(&plugin->frame);
 
     return rv;
 
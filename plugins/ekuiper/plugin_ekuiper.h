@@ -27,17 +27,55 @@
 #include <nng/supplemental/util/platform.h>
 
 #include "neuron.h"
+#include "json/neu_json_stream.h"
+
+#include "frame.h"
+#include "shm_ring.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+#define EKUIPER_SEND_QUEUE_DEFAULT 64
+#define EKUIPER_SEND_QUEUE_MAX 8192
+
+// messages taken off the socket and written by one receive callback
+#define EKUIPER_RECV_BURST 64
+
+// KiB of the shared memory ring, 0 to send on the socket
+#define EKUIPER_SHM_SIZE_MAX (256 * 1024)
+#define EKUIPER_SHM_PATH_FMT "/dev/shm/neuron-ekuiper-%" PRIu16
+
+typedef enum {
+    EKUIPER_FORMAT_JSON   = 0,
+    EKUIPER_FORMAT_BINARY = 1, // see frame.h
+} ekuiper_format_e;
+
+// one message being sent
+typedef struct {
+    neu_plugin_t *plugin;
+    nng_aio *     aio;
+    size_t        len;
+} send_slot_t;
+
 struct neu_plugin {
     neu_plugin_common_t common;
     nng_socket          sock;
     nng_mtx *           mtx;
     bool                started;
     nng_aio *           recv_aio;
+    send_slot_t *       send_slots; // messages being sent
+    send_slot_t **      send_idle;  // slots not in use, guarded by mtx
+    size_t              n_send_idle;
+    size_t              send_queue;   // configured number of slots
+    size_t              n_send_slots; // allocated while started
+    uint64_t            send_dropped; // dropped since the queue filled up
+    neu_json_stream_t   send_json;    // reused by every message
+    ekuiper_format_e    format;
+    ekuiper_frame_t     frame;       // schemas sent on the connection
+    bool                frame_reset; // schemas to be sent again, guarded by mtx
+    size_t              shm_size;    // configured KiB of the ring
+    ekuiper_shm_t *     shm;         // replaces the socket for data if set
     char *              host;
     uint16_t            port;
     char *              url;
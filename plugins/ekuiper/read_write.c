@@ -20,65 +20,354 @@
 #include <nng/nng.h>
 
 #include "neuron.h"
-#include "json/neu_json_fn.h"
 #include "json/neu_json_rw.h"
+#include "json/neu_json_stream.h"
 
 #include "json_rw.h"
 #include "read_write.h"
 
-void send_data(neu_plugin_t *plugin, neu_reqresp_trans_data_t *trans_data)
+void send_data_callback(void *arg)
 {
-    int rv = 0;
+    send_slot_t * slot   = arg;
+    neu_plugin_t *plugin = slot->plugin;
+    int           rv     = nng_aio_result(slot->aio);
+
+    if (0 == rv) {
+        NEU_PLUGIN_UPDATE_METRIC(plugin, NEU_METRIC_SEND_MSGS_TOTAL, 1, NULL);
+        NEU_PLUGIN_UPDATE_METRIC(plugin, NEU_METRIC_SEND_BYTES_5S, slot->len,
+                                 NULL);
+        NEU_PLUGIN_UPDATE_METRIC(plugin, NEU_METRIC_SEND_BYTES_30S, slot->len,
+                                 NULL);
+        NEU_PLUGIN_UPDATE_METRIC(plugin, NEU_METRIC_SEND_BYTES_60S, slot->len,
+                                 NULL);
+    } else {
+        if (NNG_ECLOSED != rv && NNG_ECANCELED != rv) {
+            plog_error(plugin, "nng cannot send msg: %s", nng_strerror(rv));
+        }
+        nng_msg_free(nng_aio_get_msg(slot->aio));
+        nng_aio_set_msg(slot->aio, NULL);
+        NEU_PLUGIN_UPDATE_METRIC(plugin, NEU_METRIC_SEND_MSG_ERRORS_TOTAL, 1,
+                                 NULL);
+    }
 
-    char *           json_str = NULL;
-    json_read_resp_t resp     = {
-        .plugin     = plugin,
-        .trans_data = trans_data,
+    nng_mtx_lock(plugin->mtx);
+    plugin->send_idle[plugin->n_send_idle++] = slot;
+    // the message may have carried a schema
+    plugin->frame_reset |= 0 != rv;
+    nng_mtx_unlock(plugin->mtx);
+}
+
+static int encode_json(neu_plugin_t *            plugin,
+                       neu_reqresp_trans_data_t *trans_data,
+                       const uint8_t **buf, size_t *len)
+{
+    neu_json_stream_t *      stream = &plugin->send_json;
+    neu_json_read_periodic_t header = {
+        .group     = trans_data->group,
+        .node      = trans_data->driver,
+        .timestamp = global_timestamp,
     };
-    rv = neu_json_encode_by_fn(&resp, json_encode_read_resp, &json_str);
-    if (0 != rv) {
+
+    *buf = (const uint8_t *) neu_trans_data_encoded(
+        trans_data, NEU_TRANS_ENCODED_JSON_EKUIPER, len);
+    if (NULL != *buf) {
+        return 0;
+    }
+
+    neu_json_stream_reset(stream);
+    if (0 !=
+        neu_json_stream_read_periodic_resp1_keys(
+            stream, "node_name", "group_name", &header, trans_data->tags)) {
         plog_error(plugin, "fail encode trans data to json");
+        return -1;
+    }
+
+    neu_trans_data_encoded_share(trans_data, NEU_TRANS_ENCODED_JSON_EKUIPER,
+                                 stream->buf, stream->len);
+    plog_debug(plugin, ">> %s", stream->buf);
+    *buf = (const uint8_t *) stream->buf;
+    *len = stream->len; // no null byte
+    return 0;
+}
+
+static int encode_frame(neu_plugin_t *            plugin,
+                        neu_reqresp_trans_data_t *trans_data,
+                        const uint8_t **buf, size_t *len)
+{
+    if (0 !=
+        ekuiper_frame_encode(&plugin->frame, trans_data->driver,
+                             trans_data->group, global_timestamp,
+                             trans_data->tags)) {
+        plog_error(plugin, "fail encode trans data to frame");
+        return -1;
+    }
+
+    plog_debug(plugin, ">> %s:%s frame of %zu bytes", trans_data->driver,
+               trans_data->group, plugin->frame.len);
+    *buf = plugin->frame.buf;
+    *len = plugin->frame.len;
+    return 0;
+}
+
+static int encode(neu_plugin_t *plugin, neu_reqresp_trans_data_t *trans_data,
+                  const uint8_t **buf, size_t *len)
+{
+    if (EKUIPER_FORMAT_BINARY == plugin->format) {
+        return encode_frame(plugin, trans_data, buf, len);
+    }
+    return encode_json(plugin, trans_data, buf, len);
+}
+
+static void send_dropped(neu_plugin_t *plugin, const char *reason)
+{
+    if (0 == plugin->send_dropped++) {
+        plog_warn(plugin, "%s, dropping messages", reason);
+    }
+    NEU_PLUGIN_UPDATE_METRIC(plugin, NEU_METRIC_SEND_MSGS_DROPPED_TOTAL, 1,
+                             NULL);
+}
+
+static void send_resumed(neu_plugin_t *plugin)
+{
+    if (plugin->send_dropped > 0) {
+        plog_notice(plugin, "send queue available, %" PRIu64 " msgs dropped",
+                    plugin->send_dropped);
+        plugin->send_dropped = 0;
+    }
+}
+
+// no slot and no callback, the message is in the ring once pushed
+static void send_shm(neu_plugin_t *            plugin,
+                     neu_reqresp_trans_data_t *trans_data)
+{
+    const uint8_t *buf = NULL;
+    size_t         len = 0;
+
+    if (ekuiper_shm_new_reader(plugin->shm)) {
+        ekuiper_frame_reset(&plugin->frame);
+    }
+
+    if (0 != encode(plugin, trans_data, &buf, &len)) {
+        return;
+    }
+
+    if (0 != ekuiper_shm_push(plugin->shm, buf, len)) {
+        // the message may have carried a schema
+        ekuiper_frame_reset(&plugin->frame);
+        send_dropped(plugin, "shm ring full");
         return;
     }
+    send_resumed(plugin);
 
-    nng_msg *msg      = NULL;
-    size_t   json_len = strlen(json_str);
-    rv                = nng_msg_alloc(&msg, json_len);
+    NEU_PLUGIN_UPDATE_METRIC(plugin, NEU_METRIC_SEND_MSGS_TOTAL, 1, NULL);
+    NEU_PLUGIN_UPDATE_METRIC(plugin, NEU_METRIC_SEND_BYTES_5S, len, NULL);
+    NEU_PLUGIN_UPDATE_METRIC(plugin, NEU_METRIC_SEND_BYTES_30S, len, NULL);
+    NEU_PLUGIN_UPDATE_METRIC(plugin, NEU_METRIC_SEND_BYTES_60S, len, NULL);
+}
+
+void send_data(neu_plugin_t *plugin, neu_reqresp_trans_data_t *trans_data)
+{
+    int            rv          = 0;
+    nng_msg *      msg         = NULL;
+    send_slot_t *  slot        = NULL;
+    const uint8_t *buf         = NULL;
+    size_t         len         = 0;
+    bool           frame_reset = false;
+
+    if (NULL != plugin->shm) {
+        send_shm(plugin, trans_data);
+        return;
+    }
+
+    nng_mtx_lock(plugin->mtx);
+    if (plugin->n_send_idle > 0) {
+        slot = plugin->send_idle[--plugin->n_send_idle];
+    }
+    frame_reset         = plugin->frame_reset;
+    plugin->frame_reset = false;
+    nng_mtx_unlock(plugin->mtx);
+
+    if (frame_reset) {
+        ekuiper_frame_reset(&plugin->frame);
+    }
+
+    if (NULL == slot) {
+        send_dropped(plugin, "send queue full");
+        return;
+    }
+    send_resumed(plugin);
+
+    if (0 != encode(plugin, trans_data, &buf, &len)) {
+        goto error;
+    }
+
+    rv = nng_msg_alloc(&msg, len);
     if (0 != rv) {
         plog_error(plugin, "nng cannot allocate msg");
-        free(json_str);
-        return;
+        goto error;
     }
 
-    memcpy(nng_msg_body(msg), json_str, json_len); // no null byte
-    plog_debug(plugin, ">> %s", json_str);
-    free(json_str);
-    rv = nng_sendmsg(plugin->sock, msg,
-                     NNG_FLAG_NONBLOCK); // TODO: use aio to send message
-    if (0 == rv) {
-        NEU_PLUGIN_UPDATE_METRIC(plugin, NEU_METRIC_SEND_MSGS_TOTAL, 1, NULL);
-        NEU_PLUGIN_UPDATE_METRIC(plugin, NEU_METRIC_SEND_BYTES_5S, json_len,
-                                 NULL);
-        NEU_PLUGIN_UPDATE_METRIC(plugin, NEU_METRIC_SEND_BYTES_30S, json_len,
-                                 NULL);
-        NEU_PLUGIN_UPDATE_METRIC(plugin, NEU_METRIC_SEND_BYTES_60S, json_len,
-                                 NULL);
-    } else {
-        plog_error(plugin, "nng cannot send msg: %s", nng_strerror(rv));
-        nng_msg_free(msg);
-        NEU_PLUGIN_UPDATE_METRIC(plugin, NEU_METRIC_SEND_MSG_ERRORS_TOTAL, 1,
-                                 NULL);
+    memcpy(nng_msg_body(msg), buf, len);
+
+    // completes in send_data_callback, which puts the slot back
+    slot->len = len;
+    nng_aio_set_msg(slot->aio, msg);
+    nng_send_aio(plugin->sock, slot->aio);
+    return;
+
+error:
+    NEU_PLUGIN_UPDATE_METRIC(plugin, NEU_METRIC_SEND_MSG_ERRORS_TOTAL, 1, NULL);
+    nng_mtx_lock(plugin->mtx);
+    plugin->send_idle[plugin->n_send_idle++] = slot;
+    nng_mtx_unlock(plugin->mtx);
+}
+
+// the metrics of a whole burst in one go
+static void recv_metrics(neu_plugin_t *plugin, uint64_t n_msg,
+                         uint64_t n_bytes)
+{
+    NEU_PLUGIN_UPDATE_METRIC(plugin, NEU_METRIC_RECV_MSGS_TOTAL, n_msg, NULL);
+    NEU_PLUGIN_UPDATE_METRIC(plugin, NEU_METRIC_RECV_BYTES_5S, n_bytes, NULL);
+    NEU_PLUGIN_UPDATE_METRIC(plugin, NEU_METRIC_RECV_BYTES_30S, n_bytes, NULL);
+    NEU_PLUGIN_UPDATE_METRIC(plugin, NEU_METRIC_RECV_BYTES_60S, n_bytes, NULL);
+    NEU_PLUGIN_UPDATE_METRIC(plugin, NEU_METRIC_RECV_MSGS_5S, n_msg, NULL);
+    NEU_PLUGIN_UPDATE_METRIC(plugin, NEU_METRIC_RECV_MSGS_30S, n_msg, NULL);
+    NEU_PLUGIN_UPDATE_METRIC(plugin, NEU_METRIC_RECV_MSGS_60S, n_msg, NULL);
+}
+
+static int json_to_value(neu_plugin_t *plugin, json_write_req_t *write_req,
+                         neu_dvalue_t *value)
+{
+    switch (write_req->t) {
+    case NEU_JSON_INT:
+        value->type      = NEU_TYPE_INT64;
+        value->value.u64 = write_req->value.val_int;
+        break;
+    case NEU_JSON_STR:
+        if (strlen(write_req->value.val_str) >= NEU_VALUE_SIZE) {
+            plog_error(plugin, "tag %s string value too long",
+                       write_req->tag_name);
+            return -1;
+        }
+        value->type = NEU_TYPE_STRING;
+        strcpy(value->value.str, write_req->value.val_str);
+        break;
+    case NEU_JSON_DOUBLE:
+        value->type      = NEU_TYPE_DOUBLE;
+        value->value.d64 = write_req->value.val_double;
+        break;
+    case NEU_JSON_BOOL:
+        value->type          = NEU_TYPE_BOOL;
+        value->value.boolean = write_req->value.val_bool;
+        break;
+    case NEU_JSON_BYTES:
+        if (write_req->value.val_bytes.length > NEU_VALUE_SIZE) {
+            plog_error(plugin, "tag %s bytes value too long",
+                       write_req->tag_name);
+            return -1;
+        }
+        value->type               = NEU_TYPE_BYTES;
+        value->value.bytes.length = write_req->value.val_bytes.length;
+        memcpy(value->value.bytes.bytes, write_req->value.val_bytes.bytes,
+               write_req->value.val_bytes.length);
+        break;
+    default:
+        plog_error(plugin, "tag %s invalid value type: %d",
+                   write_req->tag_name, write_req->t);
+        return -1;
+    }
+
+    return 0;
+}
+
+// reqs[1..n] go to the node and group of reqs[0], each tag once
+static int write_tags(neu_plugin_t *plugin, json_write_req_t **reqs, int n)
+{
+    neu_reqresp_head_t   header = { .type = NEU_REQ_WRITE_TAGS };
+    neu_req_write_tags_t cmd    = { 0 };
+
+    cmd.driver = reqs[0]->node_name;
+    cmd.group  = reqs[0]->group_name;
+    cmd.tags   = calloc(n, sizeof(neu_resp_tag_value_t));
+    if (NULL == cmd.tags) {
+        return -1;
+    }
+
+    for (int i = 0; i < n; i++) {
+        neu_resp_tag_value_t *tag = &cmd.tags[cmd.n_tag];
+
+        if (strlen(reqs[i]->tag_name) >= sizeof(tag->tag) ||
+            0 != json_to_value(plugin, reqs[i], &tag->value)) {
+            plog_error(plugin, "drop write of tag %s", reqs[i]->tag_name);
+            continue;
+        }
+        strcpy(tag->tag, reqs[i]->tag_name);
+        cmd.n_tag += 1;
+    }
+
+    if (0 == cmd.n_tag || 0 != neu_plugin_op(plugin, header, &cmd)) {
+        free(cmd.tags);
+        return -1;
+    }
+
+    reqs[0]->node_name  = NULL; // ownership moved
+    reqs[0]->group_name = NULL; // ownership moved
+    return 0;
+}
+
+static bool same_group(const json_write_req_t *a, const json_write_req_t *b)
+{
+    return 0 == strcmp(a->node_name, b->node_name) &&
+        0 == strcmp(a->group_name, b->group_name);
+}
+
+static bool has_tag(json_write_req_t **reqs, int n, const char *tag)
+{
+    for (int i = 0; i < n; i++) {
+        if (0 == strcmp(reqs[i]->tag_name, tag)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// the writes of a burst in order, a run of writes to distinct tags of one
+// group merged into one request; a tag written again starts the next run, so
+// that the writes of each tag keep their order
+static void write_burst(neu_plugin_t *plugin, json_write_req_t **reqs, int n)
+{
+    int i = 0;
+
+    while (i < n) {
+        int j  = i + 1;
+        int rv = 0;
+
+        while (j < n && same_group(reqs[i], reqs[j]) &&
+               !has_tag(reqs + i, j - i, reqs[j]->tag_name)) {
+            j++;
+        }
+
+        if (j - i == 1) {
+            rv = write_data(plugin, reqs[i]);
+        } else {
+            rv = write_tags(plugin, reqs + i, j - i);
+        }
+        if (0 != rv) {
+            plog_error(plugin, "failed to write data");
+        }
+        i = j;
     }
 }
 
 void recv_data_callback(void *arg)
 {
-    int               rv       = 0;
-    neu_plugin_t *    plugin   = arg;
-    nng_msg *         msg      = NULL;
-    size_t            json_len = 0;
-    char *            json_str = NULL;
-    json_write_req_t *req      = NULL;
+    int               rv      = 0;
+    neu_plugin_t *    plugin  = arg;
+    nng_msg *         msg     = NULL;
+    uint64_t          n_msg   = 0;
+    uint64_t          n_bytes = 0;
+    int               n_req   = 0;
+    json_write_req_t *reqs[EKUIPER_RECV_BURST];
 
     rv = nng_aio_result(plugin->recv_aio);
     if (0 != rv) {
@@ -86,32 +375,35 @@ void recv_data_callback(void *arg)
         return;
     }
 
-    msg      = nng_aio_get_msg(plugin->recv_aio);
-    json_str = nng_msg_body(msg);
-    json_len = nng_msg_len(msg);
-    plog_debug(plugin, "<< %.*s", (int) json_len, json_str);
-    NEU_PLUGIN_UPDATE_METRIC(plugin, NEU_METRIC_RECV_MSGS_TOTAL, 1, NULL);
-    NEU_PLUGIN_UPDATE_METRIC(plugin, NEU_METRIC_RECV_BYTES_5S, json_len, NULL);
-    NEU_PLUGIN_UPDATE_METRIC(plugin, NEU_METRIC_RECV_BYTES_30S, json_len, NULL);
-    NEU_PLUGIN_UPDATE_METRIC(plugin, NEU_METRIC_RECV_BYTES_60S, json_len, NULL);
-    NEU_PLUGIN_UPDATE_METRIC(plugin, NEU_METRIC_RECV_MSGS_5S, 1, NULL);
-    NEU_PLUGIN_UPDATE_METRIC(plugin, NEU_METRIC_RECV_MSGS_30S, 1, NULL);
-    NEU_PLUGIN_UPDATE_METRIC(plugin, NEU_METRIC_RECV_MSGS_60S, 1, NULL);
-    if (json_decode_write_req(json_str, json_len, &req) < 0) {
-        plog_error(plugin, "fail decode write request json: %.*s",
-                   (int) nng_msg_len(msg), json_str);
-        goto recv_data_callback_end;
-    }
-
-    rv = write_data(plugin, req);
-    if (0 != rv) {
-        plog_error(plugin, "failed to write data");
-        goto recv_data_callback_end;
+    // the messages queued behind this one come along in the same burst
+    msg = nng_aio_get_msg(plugin->recv_aio);
+    while (NULL != msg) {
+        char * json_str = nng_msg_body(msg);
+        size_t json_len = nng_msg_len(msg);
+
+        plog_debug(plugin, "<< %.*s", (int) json_len, json_str);
+        n_msg += 1;
+        n_bytes += json_len;
+        if (json_decode_write_req(json_str, json_len, &reqs[n_req]) < 0) {
+            plog_error(plugin, "fail decode write request json: %.*s",
+                       (int) json_len, json_str);
+        } else {
+            n_req += 1;
+        }
+        nng_msg_free(msg);
+
+        msg = NULL;
+        if (n_msg < EKUIPER_RECV_BURST) {
+            nng_recvmsg(plugin->sock, &msg, NNG_FLAG_NONBLOCK);
+        }
     }
 
-recv_data_callback_end:
-    nng_msg_free(msg);
-    json_decode_write_req_free(req);
+    recv_metrics(plugin, n_msg, n_bytes);
+    write_burst(plugin, reqs, n_req);
+
+    for (int i = 0; i < n_req; i++) {
+        json_decode_write_req_free(reqs[i]);
+    }
     nng_recv_aio(plugin->sock, plugin->recv_aio);
 }
 
@@ -128,32 +420,8 @@ int write_data(neu_plugin_t *plugin, json_write_req_t *write_req)
     cmd.group  = write_req->group_name;
     cmd.tag    = write_req->tag_name;
 
-    switch (write_req->t) {
-    case NEU_JSON_INT:
-        cmd.value.type      = NEU_TYPE_INT64;
-        cmd.value.value.u64 = write_req->value.val_int;
-        break;
-    case NEU_JSON_STR:
-        cmd.value.type = NEU_TYPE_STRING;
-        strcpy(cmd.value.value.str, write_req->value.val_str);
-        break;
-    case NEU_JSON_DOUBLE:
-        cmd.value.type      = NEU_TYPE_DOUBLE;
-        cmd.value.value.d64 = write_req->value.val_double;
-        break;
-    case NEU_JSON_BOOL:
-        cmd.value.type          = NEU_TYPE_BOOL;
-        cmd.value.value.boolean = write_req->value.val_bool;
-        break;
-    case NEU_JSON_BYTES:
-        cmd.value.type               = NEU_TYPE_BYTES;
-        cmd.value.value.bytes.length = write_req->value.val_bytes.length;
-        memcpy(cmd.value.value.bytes.bytes, write_req->value.val_bytes.bytes,
-               write_req->value.val_bytes.length);
-        break;
-    default:
-        assert(false);
-        break;
+    if (0 != json_to_value(plugin, write_req, &cmd.value)) {
+        return -1;
     }
 
     ret = neu_plugin_op(plugin, header, &cmd);
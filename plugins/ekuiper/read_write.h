@@ -30,6 +30,7 @@ extern "C" {
 #endif
 
 void send_data(neu_plugin_t *plugin, neu_reqresp_trans_data_t *trans_data);
+void send_data_callback(void *arg);
 
 void recv_data_callback(void *arg);
 int  write_data(neu_plugin_t *plugin, json_write_req_t *write_req);
@@ -0,0 +1,170 @@
+/**
+ * NEURON IIoT System for Industry 4.0
+ * Copyright (C) 2020-2023 EMQ Technologies Co., Ltd All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ **/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "shm_ring.h"
+
+#define RECORD_ALIGN 8
+#define RECORD_HEADER sizeof(uint32_t)
+
+struct ekuiper_shm {
+    char *                path;
+    int                   fd;
+    size_t                map_size;
+    ekuiper_shm_header_t *hdr;
+    uint8_t *             data;
+    uint64_t              capacity;
+    uint32_t              attach; // last value seen
+};
+
+static inline size_t align_up(size_t n)
+{
+    return (n + RECORD_ALIGN - 1) & ~(size_t)(RECORD_ALIGN - 1);
+}
+
+ekuiper_shm_t *ekuiper_shm_open(const char *path, size_t capacity)
+{
+    ekuiper_shm_t *shm = NULL;
+    void *         map = MAP_FAILED;
+    int            err = 0;
+
+    capacity &= ~(size_t)(RECORD_ALIGN - 1);
+    if (capacity < RECORD_ALIGN * 2) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    shm = calloc(1, sizeof(*shm));
+    if (NULL == shm || NULL == (shm->path = strdup(path))) {
+        free(shm);
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    unlink(path); // a reader still mapping an old ring keeps it
+    shm->fd = open(path, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0660);
+    if (shm->fd < 0) {
+        goto error;
+    }
+
+    shm->map_size = sizeof(ekuiper_shm_header_t) + capacity;
+    if (0 != ftruncate(shm->fd, shm->map_size)) {
+        goto error;
+    }
+
+    map = mmap(NULL, shm->map_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+               shm->fd, 0);
+    if (MAP_FAILED == map) {
+        goto error;
+    }
+
+    shm->hdr           = map;
+    shm->data          = (uint8_t *) map + sizeof(ekuiper_shm_header_t);
+    shm->capacity      = capacity;
+    shm->hdr->version  = EKUIPER_SHM_VERSION;
+    shm->hdr->capacity = capacity;
+    __atomic_store_n(&shm->hdr->magic, EKUIPER_SHM_MAGIC, __ATOMIC_RELEASE);
+    return shm;
+
+error:
+    err = errno;
+    if (shm->fd >= 0) {
+        close(shm->fd);
+        unlink(path);
+    }
+    free(shm->path);
+    free(shm);
+    errno = err;
+    return NULL;
+}
+
+void ekuiper_shm_close(ekuiper_shm_t *shm)
+{
+    if (NULL == shm) {
+        return;
+    }
+
+    munmap(shm->hdr, shm->map_size);
+    close(shm->fd);
+    unlink(shm->path);
+    free(shm->path);
+    free(shm);
+}
+
+static inline void put_len(ekuiper_shm_t *shm, uint64_t pos, uint32_t len)
+{
+    memcpy(shm->data + pos % shm->capacity, &len, sizeof(len));
+}
+
+int ekuiper_shm_push(ekuiper_shm_t *shm, const void *data, size_t len)
+{
+    ekuiper_shm_header_t *hdr  = shm->hdr;
+    uint64_t              head = hdr->head; // only written here
+    uint64_t              tail = __atomic_load_n(&hdr->tail, __ATOMIC_ACQUIRE);
+    size_t                need = align_up(RECORD_HEADER + len);
+    size_t                off  = head % shm->capacity;
+    size_t                skip = 0;
+
+    if (len >= EKUIPER_SHM_WRAP) {
+        return -1;
+    }
+
+    // records are contiguous, skip the end of the data if too short
+    if (off + need > shm->capacity) {
+        skip = shm->capacity - off;
+    }
+    if (skip + need > shm->capacity - (head - tail)) {
+        return -1;
+    }
+
+    if (skip > 0) {
+        put_len(shm, head, EKUIPER_SHM_WRAP);
+        head += skip;
+    }
+    put_len(shm, head, len);
+    memcpy(shm->data + head % shm->capacity + RECORD_HEADER, data, len);
+    head += need;
+
+    // ordered with the reader setting `waiting` before checking `head`
+    __atomic_store_n(&hdr->head, head, __ATOMIC_SEQ_CST);
+    __atomic_add_fetch(&hdr->seq, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&hdr->waiting, __ATOMIC_SEQ_CST)) {
+        syscall(SYS_futex, &hdr->seq, FUTEX_WAKE, 1, NULL, NULL, 0);
+    }
+    return 0;
+}
+
+bool ekuiper_shm_new_reader(ekuiper_shm_t *shm)
+{
+    uint32_t attach = __atomic_load_n(&shm->hdr->attach, __ATOMIC_ACQUIRE);
+
+    if (attach == shm->attach) {
+        return false;
+    }
+    shm->attach = attach;
+    return true;
+}
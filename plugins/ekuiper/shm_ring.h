@@ -0,0 +1,86 @@
+/**
+ * NEURON IIoT System for Industry 4.0
+ * Copyright (C) 2020-2023 EMQ Technologies Co., Ltd All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ **/
+
+#ifndef NEURON_PLUGIN_EKUIPER_SHM_RING_H
+#define NEURON_PLUGIN_EKUIPER_SHM_RING_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Shared memory ring carrying the messages sent to a co-located eKuiper.
+//
+// The ring is a file in /dev/shm created by Neuron when the node starts and
+// removed when it stops. It is an ekuiper_shm_header_t followed by
+// `capacity` bytes of data. Neuron is the only writer and one reader maps the
+// file; requests from eKuiper still go through the nng socket.
+//
+// Records are a u32 length in host byte order followed by the message, the
+// same bytes as sent on the socket, and are padded to 8 bytes. A length of
+// EKUIPER_SHM_WRAP tells the reader to continue at the start of the data.
+// `head` and `tail` count the bytes written and read since the ring was
+// created, the offset of a record in the data is its position % capacity.
+//
+// The reader bumps `attach` when it maps the ring, so that schemas of the
+// binary format are sent again. When it finds the ring empty, it sets
+// `waiting`, loads `seq`, checks `head` again and then waits on `seq` with
+// FUTEX_WAIT. Neuron bumps `seq` after every record and wakes the futex while
+// `waiting` is set, the reader clears it when woken. Rings are not meant to
+// be shared across hosts, so all fields are in host byte order.
+#define EKUIPER_SHM_MAGIC 0x4b454e53 // "SNEK"
+#define EKUIPER_SHM_VERSION 1
+#define EKUIPER_SHM_WRAP UINT32_MAX
+
+typedef struct {
+    uint32_t magic; // written last once the ring is ready
+    uint32_t version;
+    uint64_t capacity;
+    uint32_t seq;
+    uint32_t waiting;
+    uint32_t attach;
+    uint8_t  pad0[36];
+    uint64_t head; // written by neuron
+    uint8_t  pad1[56];
+    uint64_t tail; // written by the reader
+    uint8_t  pad2[56];
+} ekuiper_shm_header_t;
+
+typedef struct ekuiper_shm ekuiper_shm_t;
+
+// create the ring file at `path` with room for `capacity` bytes of records,
+// an existing file is replaced, return NULL and set errno on failure
+ekuiper_shm_t *ekuiper_shm_open(const char *path, size_t capacity);
+// unmap and remove the ring file
+void ekuiper_shm_close(ekuiper_shm_t *shm);
+
+// append one message, return -1 if it does not fit in the free space
+int ekuiper_shm_push(ekuiper_shm_t *shm, const void *data, size_t len);
+
+// whether a reader attached since the last call
+bool ekuiper_shm_new_reader(ekuiper_shm_t *shm);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
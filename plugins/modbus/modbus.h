@@ -48,6 +48,7 @@ typedef enum modbus_function {
     MODBUS_WRITE_S_HOLD_REG     = 0x06,
     MODBUS_WRITE_M_HOLD_REG     = 0x10,
     MODBUS_WRITE_M_COIL         = 0x0F,
+    MODBUS_READ_WRITE_M_REG     = 0x17,
     MODBUS_READ_COIL_ERR        = 0x81,
     MODBUS_READ_INPUT_ERR       = 0x82,
     MODBUS_READ_HOLD_REG_ERR    = 0x83,
@@ -56,6 +57,7 @@ typedef enum modbus_function {
     MODBUS_WRITE_S_HOLD_REG_ERR = 0x86,
     MODBUS_WRITE_M_HOLD_REG_ERR = 0x90,
     MODBUS_WRITE_M_COIL_ERR     = 0x8F,
+    MODBUS_READ_WRITE_M_REG_ERR = 0x97,
     MODBUS_DEVICE_ERR           = -2
 } modbus_function_e;
 
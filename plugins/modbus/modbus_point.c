@@ -28,14 +28,25 @@ struct modbus_sort_ctx {
 };
 
 static __thread uint16_t modbus_read_max_byte = 250;
+static __thread uint16_t modbus_read_max_gap  = 0;
 
 static int  tag_cmp(neu_tag_sort_elem_t *tag1, neu_tag_sort_elem_t *tag2);
 static bool tag_sort(neu_tag_sort_t *sort, void *tag, void *tag_to_be_sorted);
 static int  tag_cmp_write(neu_tag_sort_elem_t *tag1, neu_tag_sort_elem_t *tag2);
 static bool tag_sort_write(neu_tag_sort_t *sort, void *tag,
                            void *tag_to_be_sorted);
-
-int modbus_tag_to_point(const neu_datatag_t *tag, modbus_point_t *point)
+static void cmd_plan(modbus_read_cmd_t *cmd);
+
+// what is parsed from the address of a tag, kept in the tag once validated
+typedef struct {
+    neu_datatag_addr_option_u option;
+    uint16_t                  start_address;
+    uint16_t                  n_register;
+    uint8_t                   slave_id;
+    uint8_t                   area;
+} modbus_compiled_t;
+
+static int tag_parse_point(const neu_datatag_t *tag, modbus_point_t *point)
 {
     int      ret           = NEU_ERR_SUCCESS;
     uint32_t start_address = 0;
@@ -54,7 +65,8 @@ int modbus_tag_to_point(const neu_datatag_t *tag, modbus_point_t *point)
     point->start_address = (uint16_t) start_address;
 
     point->start_address -= 1;
-    point->type = tag->type;
+    point->type         = tag->type;
+    point->poll_divisor = tag->poll_divisor > 1 ? tag->poll_divisor : 1;
 
     switch (area) {
     case '0':
@@ -180,10 +192,46 @@ int modbus_tag_to_point(const neu_datatag_t *tag, modbus_point_t *point)
         return NEU_ERR_TAG_TYPE_NOT_SUPPORT;
     }
 
-    strncpy(point->name, tag->name, sizeof(point->name));
+    strncpy(point->name, tag->name, sizeof(point->name) - 1);
     return ret;
 }
 
+int modbus_tag_compile(neu_datatag_t *tag, modbus_point_t *point)
+{
+    int ret = tag_parse_point(tag, point);
+
+    if (NEU_ERR_SUCCESS == ret) {
+        modbus_compiled_t c = {
+            .option        = point->option,
+            .start_address = point->start_address,
+            .n_register    = point->n_register,
+            .slave_id      = point->slave_id,
+            .area          = point->area,
+        };
+        neu_tag_set_compiled(tag, &c, sizeof(c));
+    }
+    return ret;
+}
+
+int modbus_tag_to_point(const neu_datatag_t *tag, modbus_point_t *point)
+{
+    modbus_compiled_t c = { 0 };
+
+    if (!neu_tag_get_compiled(tag, &c, sizeof(c))) {
+        return tag_parse_point(tag, point);
+    }
+
+    point->slave_id      = c.slave_id;
+    point->area          = c.area;
+    point->start_address = c.start_address;
+    point->n_register    = c.n_register;
+    point->option        = c.option;
+    point->type          = tag->type;
+    point->poll_divisor  = tag->poll_divisor > 1 ? tag->poll_divisor : 1;
+    strncpy(point->name, tag->name, sizeof(point->name) - 1);
+    return NEU_ERR_SUCCESS;
+}
+
 int modbus_write_tag_to_point(const neu_plugin_tag_value_t *tag,
                               modbus_point_write_t *        point)
 {
@@ -193,9 +241,11 @@ int modbus_write_tag_to_point(const neu_plugin_tag_value_t *tag,
     return ret;
 }
 
-modbus_read_cmd_sort_t *modbus_tag_sort(UT_array *tags, uint16_t max_byte)
+modbus_read_cmd_sort_t *modbus_tag_sort(UT_array *tags, uint16_t max_byte,
+                                        uint16_t max_gap)
 {
     modbus_read_max_byte          = max_byte;
+    modbus_read_max_gap           = max_gap;
     neu_tag_sort_result_t *result = neu_tag_sort(tags, tag_sort, tag_cmp);
 
     modbus_read_cmd_sort_t *sort_result =
@@ -213,6 +263,8 @@ modbus_read_cmd_sort_t *modbus_tag_sort(UT_array *tags, uint16_t max_byte)
         sort_result->cmd[i].area     = tag->area;
         sort_result->cmd[i].start_address = tag->start_address;
         sort_result->cmd[i].n_register    = ctx->end - ctx->start;
+        sort_result->cmd[i].poll_divisor  = tag->poll_divisor;
+        cmd_plan(&sort_result->cmd[i]);
 
         free(result->sorts[i].info.context);
     }
@@ -221,6 +273,213 @@ modbus_read_cmd_sort_t *modbus_tag_sort(UT_array *tags, uint16_t max_byte)
     return sort_result;
 }
 
+void modbus_tag_sort_split(modbus_read_cmd_sort_t *cs)
+{
+    for (uint16_t i = 0; i < cs->n_cmd; i++) {
+        modbus_read_cmd_t cmd   = cs->cmd[i];
+        uint16_t          n_run = 0;
+        uint32_t          end   = 0;
+        uint32_t          half  = 0;
+        uint32_t          k     = 0;
+
+        if (!cmd.rejected) {
+            continue;
+        }
+        cs->cmd[i].rejected = false;
+
+        utarray_foreach(cmd.tags, modbus_point_t **, p_tag)
+        {
+            if (n_run == 0 || (*p_tag)->start_address > end) {
+                n_run += 1;
+            }
+            if ((*p_tag)->start_address + (*p_tag)->n_register > end) {
+                end = (*p_tag)->start_address + (*p_tag)->n_register;
+            }
+        }
+        if (n_run <= 1) {
+            // no unused addresses, the read is likely above the largest one
+            // the device takes, halve it until it is accepted
+            if (utarray_len(cmd.tags) < 2) {
+                continue;
+            }
+            half  = utarray_len(cmd.tags) / 2;
+            n_run = 2;
+        }
+
+        cs->cmd = realloc(cs->cmd,
+                          (cs->n_cmd + n_run - 1) * sizeof(modbus_read_cmd_t));
+        memmove(&cs->cmd[i + n_run], &cs->cmd[i + 1],
+                (cs->n_cmd - i - 1) * sizeof(modbus_read_cmd_t));
+        cs->n_cmd += n_run - 1;
+
+        modbus_read_cmd_t *run = &cs->cmd[i] - 1;
+        end                    = 0;
+        utarray_foreach(cmd.tags, modbus_point_t **, p_tag)
+        {
+            bool start = half > 0 ? k == half : (*p_tag)->start_address > end;
+            k += 1;
+            if (run < &cs->cmd[i] || start) {
+                run += 1;
+                memset(run, 0, sizeof(modbus_read_cmd_t));
+                utarray_new(run->tags, &ut_ptr_icd);
+                run->slave_id      = cmd.slave_id;
+                run->area          = cmd.area;
+                run->poll_divisor  = cmd.poll_divisor;
+                run->start_address = (*p_tag)->start_address;
+            }
+            if (start || (*p_tag)->start_address + (*p_tag)->n_register > end) {
+                end = (*p_tag)->start_address + (*p_tag)->n_register;
+            }
+            run->n_register = end - run->start_address;
+            utarray_push_back(run->tags, p_tag);
+        }
+
+        for (uint16_t j = i; j < i + n_run; j++) {
+            cmd_plan(&cs->cmd[j]);
+        }
+
+        utarray_free(cmd.tags);
+        free(cmd.plan);
+        free(cmd.last);
+        i += n_run - 1;
+    }
+}
+
+static int point_ptr_cmp(const void *a, const void *b)
+{
+    uintptr_t p1 = (uintptr_t) * (modbus_point_t *const *) a;
+    uintptr_t p2 = (uintptr_t) * (modbus_point_t *const *) b;
+
+    return p1 < p2 ? -1 : p1 > p2;
+}
+
+// in the order modbus_tag_sort plans the commands
+static int cmd_cmp(const void *a, const void *b)
+{
+    const modbus_read_cmd_t *c1 = (const modbus_read_cmd_t *) a;
+    const modbus_read_cmd_t *c2 = (const modbus_read_cmd_t *) b;
+
+    if (c1->poll_divisor != c2->poll_divisor) {
+        return c1->poll_divisor < c2->poll_divisor ? -1 : 1;
+    }
+    if (c1->slave_id != c2->slave_id) {
+        return c1->slave_id < c2->slave_id ? -1 : 1;
+    }
+    if (c1->area != c2->area) {
+        return c1->area < c2->area ? -1 : 1;
+    }
+    if (c1->start_address != c2->start_address) {
+        return c1->start_address < c2->start_address ? -1 : 1;
+    }
+    return 0;
+}
+
+// whether the point of another command could share the read of cmd
+static bool cmd_near(const modbus_read_cmd_t *cmd, const modbus_point_t *p,
+                     uint16_t max_gap)
+{
+    uint32_t end = (uint32_t) cmd->start_address + cmd->n_register;
+
+    return cmd->poll_divisor == p->poll_divisor &&
+        cmd->slave_id == p->slave_id && cmd->area == p->area &&
+        p->start_address <= end + max_gap &&
+        (uint32_t) p->start_address + p->n_register + max_gap >=
+        cmd->start_address;
+}
+
+void modbus_tag_sort_update(modbus_read_cmd_sort_t *cs, UT_array *stale,
+                            UT_array *fresh, uint16_t max_byte,
+                            uint16_t max_gap)
+{
+    modbus_point_t **       gone    = NULL;
+    size_t                  n_gone  = utarray_len(stale);
+    bool *                  replan  = calloc(cs->n_cmd, sizeof(bool));
+    UT_array *              loose   = NULL;
+    modbus_read_cmd_sort_t *part    = NULL;
+    uint16_t                n_kept  = 0;
+    modbus_read_cmd_t *     cmds    = NULL;
+    uint32_t                n_total = 0;
+
+    // searched for every point of every command
+    if (n_gone > 0) {
+        gone = malloc(n_gone * sizeof(modbus_point_t *));
+        for (size_t i = 0; i < n_gone; i++) {
+            gone[i] = *(modbus_point_t **) utarray_eltptr(stale, i);
+        }
+        qsort(gone, n_gone, sizeof(modbus_point_t *), point_ptr_cmp);
+    }
+
+    utarray_new(loose, &ut_ptr_icd);
+    for (uint16_t i = 0; i < cs->n_cmd; i++) {
+        modbus_read_cmd_t *cmd = &cs->cmd[i];
+
+        utarray_foreach(cmd->tags, modbus_point_t **, p_tag)
+        {
+            if (n_gone > 0 &&
+                NULL !=
+                    bsearch(p_tag, gone, n_gone, sizeof(modbus_point_t *),
+                            point_ptr_cmp)) {
+                replan[i] = true;
+                break;
+            }
+        }
+        utarray_foreach(fresh, modbus_point_t **, p_tag)
+        {
+            if (replan[i] || cmd_near(cmd, *p_tag, max_gap)) {
+                replan[i] = true;
+                break;
+            }
+        }
+        if (!replan[i]) {
+            n_kept += 1;
+            continue;
+        }
+
+        utarray_foreach(cmd->tags, modbus_point_t **, p_tag)
+        {
+            if (n_gone == 0 ||
+                NULL ==
+                    bsearch(p_tag, gone, n_gone, sizeof(modbus_point_t *),
+                            point_ptr_cmp)) {
+                utarray_push_back(loose, p_tag);
+            }
+        }
+    }
+    utarray_concat(loose, fresh);
+
+    if (utarray_len(loose) > 0) {
+        part = modbus_tag_sort(loose, max_byte, max_gap);
+    }
+
+    n_total = n_kept + (part != NULL ? part->n_cmd : 0);
+    cmds    = calloc(n_total > 0 ? n_total : 1, sizeof(modbus_read_cmd_t));
+    n_total = 0;
+    for (uint16_t i = 0; i < cs->n_cmd; i++) {
+        if (replan[i]) {
+            utarray_free(cs->cmd[i].tags);
+            free(cs->cmd[i].plan);
+            free(cs->cmd[i].last);
+        } else {
+            cmds[n_total++] = cs->cmd[i];
+        }
+    }
+    if (part != NULL) {
+        memcpy(&cmds[n_total], part->cmd, part->n_cmd * sizeof(*cmds));
+        n_total += part->n_cmd;
+        free(part->cmd);
+        free(part);
+    }
+    qsort(cmds, n_total, sizeof(*cmds), cmd_cmp);
+
+    free(cs->cmd);
+    cs->cmd   = cmds;
+    cs->n_cmd = n_total;
+
+    utarray_free(loose);
+    free(replan);
+    free(gone);
+}
+
 int cal_n_byte(int type, neu_value_u *value, neu_datatag_addr_option_u option)
 {
     int n = 0;
@@ -335,6 +594,118 @@ void modbus_tag_sort_free(modbus_read_cmd_sort_t *cs)
 {
     for (uint16_t i = 0; i < cs->n_cmd; i++) {
         utarray_free(cs->cmd[i].tags);
+        free(cs->cmd[i].plan);
+        free(cs->cmd[i].last);
+    }
+
+    free(cs->cmd);
+    free(cs);
+}
+
+static bool register_bit(const modbus_point_t *p)
+{
+    return p->type == NEU_TYPE_BIT && p->area != MODBUS_AREA_COIL &&
+        p->area != MODBUS_AREA_INPUT;
+}
+
+// by address as the tags are sorted, with the bit points of a register next
+// to each other
+static int plan_cmp(const void *a, const void *b)
+{
+    const modbus_point_t *p1 = *(modbus_point_t *const *) a;
+    const modbus_point_t *p2 = *(modbus_point_t *const *) b;
+
+    if (p1->start_address != p2->start_address) {
+        return p1->start_address < p2->start_address ? -1 : 1;
+    }
+    if (register_bit(p1) != register_bit(p2)) {
+        return register_bit(p1) ? 1 : -1;
+    }
+    if (p1->n_register != p2->n_register) {
+        return p1->n_register < p2->n_register ? -1 : 1;
+    }
+    if (register_bit(p1) && p1->option.bit.bit != p2->option.bit.bit) {
+        return p1->option.bit.bit < p2->option.bit.bit ? -1 : 1;
+    }
+    return 0;
+}
+
+static void cmd_plan(modbus_read_cmd_t *cmd)
+{
+    uint32_t         end  = cmd->start_address + cmd->n_register;
+    int              i    = 0;
+    modbus_decode_t *head = NULL;
+
+    utarray_sort(cmd->tags, plan_cmp);
+    cmd->plan = calloc(utarray_len(cmd->tags), sizeof(modbus_decode_t));
+
+    utarray_foreach(cmd->tags, modbus_point_t **, p_tag)
+    {
+        modbus_decode_t *d      = &cmd->plan[i++];
+        uint16_t         offset = (*p_tag)->start_address - cmd->start_address;
+
+        d->name = (*p_tag)->name;
+        d->type = (*p_tag)->type;
+
+        if ((*p_tag)->start_address + (*p_tag)->n_register > end) {
+            d->kernel = MODBUS_DECODE_INVALID;
+            continue;
+        }
+
+        if ((*p_tag)->area == MODBUS_AREA_COIL ||
+            (*p_tag)->area == MODBUS_AREA_INPUT) {
+            d->kernel = MODBUS_DECODE_COIL;
+            d->offset = offset;
+            d->end    = offset / 8 + 1;
+            continue;
+        }
+
+        d->offset = offset * 2;
+        d->width  = (*p_tag)->n_register * 2;
+        d->end    = d->offset + d->width;
+
+        switch ((*p_tag)->type) {
+        case NEU_TYPE_UINT16:
+        case NEU_TYPE_INT16:
+            d->kernel = MODBUS_DECODE_SWAP16;
+            break;
+        case NEU_TYPE_FLOAT:
+        case NEU_TYPE_INT32:
+        case NEU_TYPE_UINT32:
+            d->kernel = MODBUS_DECODE_SWAP32;
+            break;
+        case NEU_TYPE_DOUBLE:
+        case NEU_TYPE_INT64:
+        case NEU_TYPE_UINT64:
+            d->kernel = MODBUS_DECODE_SWAP64;
+            break;
+        case NEU_TYPE_BIT:
+            d->kernel = MODBUS_DECODE_REGISTER_BIT;
+            d->bit    = (*p_tag)->option.bit.bit;
+            if (head == NULL || head->offset != d->offset ||
+                head + head->n_bit != d) {
+                head = d;
+            }
+            head->n_bit += 1;
+            break;
+        case NEU_TYPE_STRING:
+            d->kernel =
+                (*p_tag)->option.string.type == NEU_DATATAG_STRING_TYPE_L
+                ? MODBUS_DECODE_STRING_L
+                : MODBUS_DECODE_STRING;
+            break;
+        default:
+            d->kernel = MODBUS_DECODE_COPY;
+            break;
+        }
+    }
+}
+
+void modbus_write_tags_sort_free(modbus_write_cmd_sort_t *cs)
+{
+    for (uint16_t i = 0; i < cs->n_cmd; i++) {
+        utarray_free(cs->cmd[i].tags);
+        free(cs->cmd[i].bytes);
     }
 
     free(cs->cmd);
@@ -346,6 +717,13 @@ static int tag_cmp(neu_tag_sort_elem_t *tag1, neu_tag_sort_elem_t *tag2)
     modbus_point_t *p_t1 = (modbus_point_t *) tag1->tag;
     modbus_point_t *p_t2 = (modbus_point_t *) tag2->tag;
 
+    // one plan per poll rate
+    if (p_t1->poll_divisor > p_t2->poll_divisor) {
+        return 1;
+    } else if (p_t1->poll_divisor < p_t2->poll_divisor) {
+        return -1;
+    }
+
     if (p_t1->slave_id > p_t2->slave_id) {
         return 1;
     } else if (p_t1->slave_id < p_t2->slave_id) {
@@ -389,7 +767,7 @@ static bool tag_sort(neu_tag_sort_t *sort, void *tag, void *tag_to_be_sorted)
 
     ctx = (struct modbus_sort_ctx *) sort->info.context;
 
-    if (t1->slave_id != t2->slave_id) {
+    if (t1->poll_divisor != t2->poll_divisor || t1->slave_id != t2->slave_id) {
         return false;
     }
 
@@ -397,21 +775,30 @@ static bool tag_sort(neu_tag_sort_t *sort, void *tag, void *tag_to_be_sorted)
         return false;
     }
 
-    if (t2->start_address > ctx->end) {
+    if (t2->start_address > (uint32_t) ctx->end + modbus_read_max_gap) {
         return false;
     }
 
+    uint32_t gap = 0;
+    uint32_t end = ctx->end;
+    if (t2->start_address > ctx->end) {
+        gap = t2->start_address - ctx->end;
+    }
+    if (t2->start_address + t2->n_register > end) {
+        end = t2->start_address + t2->n_register;
+    }
+
     switch (t1->area) {
     case MODBUS_AREA_COIL:
     case MODBUS_AREA_INPUT:
-        if ((ctx->end - ctx->start + 7) / 8 >= modbus_read_max_byte) {
+        if ((ctx->end - ctx->start + gap + 7) / 8 >= modbus_read_max_byte) {
             return false;
         }
         break;
     case MODBUS_AREA_INPUT_REGISTER:
     case MODBUS_AREA_HOLD_REGISTER: {
-        uint16_t now_bytes = (ctx->end - ctx->start) * 2;
-        uint16_t add_now   = now_bytes + t2->n_register * 2;
+        uint32_t now_bytes = (ctx->end - ctx->start + gap) * 2;
+        uint32_t add_now   = now_bytes + t2->n_register * 2;
         if (add_now >= modbus_read_max_byte) {
             return false;
         }
@@ -420,9 +807,7 @@ static bool tag_sort(neu_tag_sort_t *sort, void *tag, void *tag_to_be_sorted)
     }
     }
 
-    if (t2->start_address + t2->n_register > ctx->end) {
-        ctx->end = t2->start_address + t2->n_register;
-    }
+    ctx->end = end;
 
     return true;
 }
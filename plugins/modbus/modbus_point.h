@@ -34,6 +34,7 @@ typedef struct modbus_point {
     modbus_area_e area;
     uint16_t      start_address;
     uint16_t      n_register;
+    uint16_t      poll_divisor; // 1 for a point read in every cycle
 
     neu_type_e                type;
     neu_datatag_addr_option_u option;
@@ -45,17 +46,50 @@ typedef struct modbus_point_write {
     neu_value_u    value;
 } modbus_point_write_t;
 
+// parse the address of tag as modbus_tag_to_point, and keep the result in
+// the tag for modbus_tag_to_point to skip parsing it again
+int modbus_tag_compile(neu_datatag_t *tag, modbus_point_t *point);
 int modbus_tag_to_point(const neu_datatag_t *tag, modbus_point_t *point);
 int modbus_write_tag_to_point(const neu_plugin_tag_value_t *tag,
                               modbus_point_write_t *        point);
 
+typedef enum modbus_decode_kernel {
+    MODBUS_DECODE_INVALID, // the point lies outside of the read command
+    MODBUS_DECODE_COPY,
+    MODBUS_DECODE_SWAP16,
+    MODBUS_DECODE_SWAP32,
+    MODBUS_DECODE_SWAP64,
+    MODBUS_DECODE_COIL,
+    MODBUS_DECODE_REGISTER_BIT,
+    MODBUS_DECODE_STRING,
+    MODBUS_DECODE_STRING_L,
+} modbus_decode_kernel_e;
+
+// how to decode one point from the response of its read command, computed
+// once when the command is built
+typedef struct modbus_decode {
+    const char *name;
+    neu_type_e  type;
+    uint16_t    offset; // byte offset, or bit offset for coils and inputs
+    uint16_t    width;  // bytes to copy, 0 for coils and inputs
+    uint16_t    end;    // response bytes needed to decode the point
+    uint16_t    n_bit;  // bit points of the register, set on the first one
+    uint8_t     bit;
+    uint8_t     kernel; // modbus_decode_kernel_e
+} modbus_decode_t;
+
 typedef struct modbus_read_cmd {
     uint8_t       slave_id;
     modbus_area_e area;
     uint16_t      start_address;
     uint16_t      n_register;
+    uint16_t      poll_divisor; // of all the points of the command
+    bool          rejected;     // the device answered with an exception
 
-    UT_array *tags; // modbus_point_t ptr;
+    UT_array *       tags;   // modbus_point_t ptr;
+    modbus_decode_t *plan;   // one entry per tag, in the same order
+    uint8_t *        last;   // the last response decoded into the cache
+    uint16_t         n_last; // length of last
 } modbus_read_cmd_t;
 
 typedef struct modbus_read_cmd_sort {
@@ -79,10 +113,29 @@ typedef struct modbus_write_cmd_sort {
     modbus_write_cmd_t *cmd;
 } modbus_write_cmd_sort_t;
 
-modbus_read_cmd_sort_t * modbus_tag_sort(UT_array *tags, uint16_t max_byte);
+// points of the same slave, area and poll divisor share a read command as
+// long as it stays below max_byte, up to max_gap unused registers or coils
+// between two points are read along with them
+modbus_read_cmd_sort_t * modbus_tag_sort(UT_array *tags, uint16_t max_byte,
+                                         uint16_t max_gap);
 modbus_write_cmd_sort_t *modbus_write_tags_sort(UT_array *tags);
 void                     modbus_tag_sort_free(modbus_read_cmd_sort_t *cs);
 
+// split the rejected commands that read unused addresses, so that each part
+// only reads the addresses of its points, and halve those that do not, which
+// brings a read within the largest one the device takes in a few cycles
+void modbus_tag_sort_split(modbus_read_cmd_sort_t *cs);
+
+// replan only the commands of cs that read a point of stale, or that a point
+// of fresh could join, along with the points of fresh. the other commands go
+// on with their last responses and splits. stale and fresh hold
+// modbus_point_t pointers, the stale points may be freed afterwards
+void modbus_tag_sort_update(modbus_read_cmd_sort_t *cs, UT_array *stale,
+                            UT_array *fresh, uint16_t max_byte,
+                            uint16_t max_gap);
+
+void modbus_write_tags_sort_free(modbus_write_cmd_sort_t *cs);
+
 #ifdef __cplusplus
 }
 #endif
@@ -16,8 +16,11 @@
  * along with this program; if not, write to the Free Software Foundation,
  * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
  **/
+#include <errno.h>
 #include <time.h>
 
+#include "utils/utlist.h"
+
 #include "modbus_point.h"
 #include "modbus_stack.h"
 
@@ -27,6 +30,8 @@ struct modbus_group_data {
     UT_array *              tags;
     char *                  group;
     modbus_read_cmd_sort_t *cmd_sort;
+    uint32_t                cycle; // of the group read in progress
+    neu_plugin_group_t *    grp;   // NULL outside of the group timer
 };
 
 struct modbus_write_tags_data {
@@ -34,6 +39,43 @@ struct modbus_write_tags_data {
     modbus_write_cmd_sort_t *cmd_sort;
 };
 
+#define MODBUS_TCP_FRAME_MAX 260
+
+// a device connected to the tcp server, frames are reassembled here as the
+// event loop receives them
+struct modbus_client {
+    int             fd;
+    neu_event_io_t *io;
+    uint16_t        offset;
+    uint8_t         buf[MODBUS_TCP_FRAME_MAX];
+
+    struct modbus_client *next;
+};
+
+// a read request of the server mode, sent to one client
+struct modbus_serve_req {
+    uint16_t cmd;
+    uint16_t seq;
+    uint16_t response_size;
+    int      fd;
+    bool     done;
+    uint16_t len;
+    uint8_t  frame[MODBUS_TCP_FRAME_MAX];
+    int64_t  send_tms;
+    int64_t  recv_tms;
+};
+
+struct modbus_serve {
+    struct modbus_serve_req *reqs;
+    uint32_t                 n_req;
+    uint32_t                 n_wait;
+};
+
+static inline bool serve_mode(neu_plugin_t *plugin)
+{
+    return plugin->is_server && plugin->max_link > 1;
+}
+
 static void plugin_group_free(neu_plugin_group_t *pgp);
 static int  process_protocol_buf(neu_plugin_t *plugin, uint8_t slave_id,
                                  uint16_t response_size);
@@ -44,16 +86,80 @@ void modbus_conn_connected(void *data, int fd)
     (void) fd;
 
     plugin->common.link_state = NEU_NODE_LINK_STATE_CONNECTED;
+    plugin->cur_timeout       = plugin->timeout;
+}
+
+static void client_add(neu_plugin_t *plugin, int fd)
+{
+    struct modbus_client *client = calloc(1, sizeof(struct modbus_client));
+    neu_event_io_param_t  param  = {
+        .cb       = modbus_tcp_client_io_callback,
+        .fd       = fd,
+        .usr_data = (void *) plugin,
+    };
+
+    client->fd = fd;
+    client->io = neu_event_add_io(plugin->events, param);
+
+    pthread_mutex_lock(&plugin->server_mtx);
+    LL_PREPEND(plugin->clients, client);
+    pthread_mutex_unlock(&plugin->server_mtx);
+}
+
+// return the number of clients left
+static int client_del(neu_plugin_t *plugin, int fd)
+{
+    struct modbus_client *client = NULL;
+    struct modbus_client *tmp    = NULL;
+    int                   n      = 0;
+
+    pthread_mutex_lock(&plugin->server_mtx);
+    LL_FOREACH_SAFE(plugin->clients, client, tmp)
+    {
+        if (fd < 0 || client->fd == fd) {
+            LL_DELETE(plugin->clients, client);
+            neu_event_del_io(plugin->events, client->io);
+            free(client);
+        }
+    }
+    for (int i = 0; i < 256; i++) {
+        if (fd < 0 || plugin->slave_fd[i] == fd) {
+            plugin->slave_fd[i] = 0;
+        }
+    }
+    LL_COUNT(plugin->clients, client, n);
+    pthread_mutex_unlock(&plugin->server_mtx);
+
+    return n;
 }
 
 void modbus_conn_disconnected(void *data, int fd)
 {
     struct neu_plugin *plugin = (struct neu_plugin *) data;
-    (void) fd;
+
+    if (serve_mode(plugin) && client_del(plugin, fd) > 0) {
+        return;
+    }
 
     plugin->common.link_state = NEU_NODE_LINK_STATE_DISCONNECTED;
 }
 
+// the nodes sharing the connection take turns, one group or write each
+void modbus_conn_acquire(neu_plugin_t *plugin, neu_conn_prio_e prio,
+                         int64_t deadline)
+{
+    if (plugin->conn_share) {
+        neu_conn_acquire_prio(plugin->conn, prio, deadline);
+    }
+}
+
+void modbus_conn_release(neu_plugin_t *plugin)
+{
+    if (plugin->conn_share) {
+        neu_conn_release(plugin->conn);
+    }
+}
+
 void modbus_tcp_server_listen(void *data, int fd)
 {
     struct neu_plugin *  plugin = (struct neu_plugin *) data;
@@ -72,6 +178,9 @@ void modbus_tcp_server_stop(void *data, int fd)
     (void) fd;
 
     neu_event_del_io(plugin->events, plugin->tcp_server_io);
+    if (plugin->clients != NULL) {
+        client_del(plugin, -1);
+    }
 }
 
 int modbus_tcp_server_io_callback(enum neu_event_io_type type, int fd,
@@ -84,6 +193,9 @@ int modbus_tcp_server_io_callback(enum neu_event_io_type type, int fd,
         int client_fd = neu_conn_tcp_server_accept(plugin->conn);
         if (client_fd > 0) {
             plugin->client_fd = client_fd;
+            if (serve_mode(plugin)) {
+                client_add(plugin, client_fd);
+            }
         }
 
         break;
@@ -94,11 +206,99 @@ int modbus_tcp_server_io_callback(enum neu_event_io_type type, int fd,
         neu_event_del_io(plugin->events, plugin->tcp_server_io);
         neu_conn_disconnect(plugin->conn);
         break;
+    case NEU_EVENT_IO_WRITE:
+        break;
     }
 
     return 0;
 }
 
+// must be called with server_mtx held
+static void serve_deliver(neu_plugin_t *plugin, int fd, uint8_t *frame,
+                          uint16_t len)
+{
+    struct modbus_header *header = (struct modbus_header *) frame;
+    struct modbus_serve * serve  = plugin->serve;
+
+    plog_recv_protocol(plugin, frame, len);
+    for (uint32_t i = 0; serve != NULL && i < serve->n_req; i++) {
+        struct modbus_serve_req *req = &serve->reqs[i];
+
+        if (!req->done && req->fd == fd && req->seq == ntohs(header->seq)) {
+            memcpy(req->frame, frame, len);
+            req->len      = len;
+            req->done     = true;
+            req->recv_tms = neu_mono_ms();
+            serve->n_wait -= 1;
+            if (serve->n_wait == 0) {
+                pthread_cond_signal(&plugin->server_cond);
+            }
+            return;
+        }
+    }
+
+    // late responses of a previous round and the responses of writes
+    plog_debug(plugin, "drop modbus response, fd: %d, transaction id: %hu", fd,
+               ntohs(header->seq));
+}
+
+int modbus_tcp_client_io_callback(enum neu_event_io_type type, int fd,
+                                  void *usr_data)
+{
+    neu_plugin_t *        plugin                    = (neu_plugin_t *) usr_data;
+    struct modbus_client *client                    = NULL;
+    uint8_t               buf[MODBUS_TCP_FRAME_MAX] = { 0 };
+    ssize_t               ret                       = 0;
+
+    if (type == NEU_EVENT_IO_READ) {
+        ret = neu_conn_tcp_server_recv_pending(plugin->conn, fd, buf,
+                                               sizeof(buf));
+        if (ret < 0) {
+            return 0;
+        }
+    }
+
+    if (type != NEU_EVENT_IO_READ || ret == 0) {
+        plog_warn(plugin, "tcp client closed: %d, fd: %d", type, fd);
+        neu_conn_tcp_server_close_client(plugin->conn, fd);
+        return 0;
+    }
+
+    pthread_mutex_lock(&plugin->server_mtx);
+    LL_SEARCH_SCALAR(plugin->clients, client, fd, fd);
+    for (ssize_t used = 0; client != NULL && used < ret;) {
+        uint16_t n = sizeof(client->buf) - client->offset;
+
+        if (n > ret - used) {
+            n = ret - used;
+        }
+        memcpy(client->buf + client->offset, buf + used, n);
+        client->offset += n;
+        used += n;
+
+        while (client->offset >= sizeof(struct modbus_header)) {
+            struct modbus_header *header = (struct modbus_header *) client->buf;
+            uint16_t len = sizeof(struct modbus_header) + ntohs(header->len);
+
+            if (len > sizeof(client->buf) || header->protocol != 0) {
+                plog_warn(plugin, "invalid modbus frame, fd: %d, resync", fd);
+                client->offset = 0;
+                break;
+            }
+            if (client->offset < len) {
+                break;
+            }
+
+            serve_deliver(plugin, fd, client->buf, len);
+            memmove(client->buf, client->buf + len, client->offset - len);
+            client->offset -= len;
+        }
+    }
+    pthread_mutex_unlock(&plugin->server_mtx);
+
+    return 0;
+}
+
 int modbus_send_msg(void *ctx, uint16_t n_byte, uint8_t *bytes)
 {
     neu_plugin_t *plugin = (neu_plugin_t *) ctx;
@@ -116,14 +316,68 @@ int modbus_send_msg(void *ctx, uint16_t n_byte, uint8_t *bytes)
     return ret;
 }
 
+// the statistics of the connection stand in for a slave with too few samples
+static uint16_t rtt_timeout(neu_plugin_t *plugin, uint8_t slave_id)
+{
+    const modbus_rtt_t *rtt = &plugin->slave_rtt[slave_id];
+
+    if (rtt->n < MODBUS_RTT_MIN_SAMPLES) {
+        rtt = &plugin->link_rtt;
+    }
+    return modbus_rtt_timeout(rtt, plugin->min_timeout, plugin->timeout);
+}
+
+static void rtt_apply(neu_plugin_t *plugin, uint16_t timeout)
+{
+    if (plugin->min_timeout == 0 || plugin->cur_timeout == timeout) {
+        return;
+    }
+
+    neu_conn_set_timeout(plugin->conn, plugin->client_fd, timeout);
+    plugin->cur_timeout = timeout;
+}
+
+// only responses to requests that were not resent are measured, a late
+// response to the first try would otherwise pass for a fast one to a retry
+static void rtt_sample(neu_plugin_t *plugin, uint8_t slave_id, uint64_t ms)
+{
+    if (plugin->min_timeout > 0) {
+        modbus_rtt_sample(&plugin->slave_rtt[slave_id], ms);
+        modbus_rtt_sample(&plugin->link_rtt, ms);
+    }
+}
+
+static void rtt_miss(neu_plugin_t *plugin, uint8_t slave_id)
+{
+    if (plugin->min_timeout > 0) {
+        modbus_rtt_miss(&plugin->slave_rtt[slave_id]);
+        modbus_rtt_miss(&plugin->link_rtt);
+    }
+}
+
+// wait no longer than a response may take before resending
+static uint16_t rtt_retry_interval(neu_plugin_t *plugin, uint8_t slave_id)
+{
+    uint16_t timeout = rtt_timeout(plugin, slave_id);
+
+    if (plugin->min_timeout == 0 || plugin->retry_interval < timeout) {
+        return plugin->retry_interval;
+    }
+    return timeout;
+}
+
 int modbus_stack_read_retry(neu_plugin_t *plugin, struct modbus_group_data *gd,
                             uint16_t i, uint16_t j, uint16_t *response_size)
 {
-    struct timespec t3 = { .tv_sec = plugin->retry_interval / 1000,
-                           .tv_nsec =
-                               1000 * 1000 * (plugin->retry_interval % 1000) };
-    struct timespec t4 = { 0 };
+    uint8_t         slave_id = gd->cmd_sort->cmd[i].slave_id;
+    uint16_t        delay    = rtt_retry_interval(plugin, slave_id);
+    struct timespec t3       = {
+        .tv_sec  = delay / 1000,
+        .tv_nsec = 1000 * 1000 * (delay % 1000),
+    };
+    struct timespec t4       = { 0 };
     nanosleep(&t3, &t4);
+    rtt_apply(plugin, rtt_timeout(plugin, slave_id));
     plog_notice(plugin, "Resend read req. Times:%hu", j + 1);
     int ret = modbus_stack_read(plugin->stack, gd->cmd_sort->cmd[i].slave_id,
                                 gd->cmd_sort->cmd[i].area,
@@ -132,45 +386,151 @@ int modbus_stack_read_retry(neu_plugin_t *plugin, struct modbus_group_data *gd,
     return ret;
 }
 
-int modbus_group_timer(neu_plugin_t *plugin, neu_plugin_group_t *group,
-                       uint16_t max_byte)
+// a slave that leaves breaker_threshold commands in a row unanswered is
+// skipped for one second, the pause doubles on every further miss up to
+// max_backoff ms
+static void slave_update(neu_plugin_t *plugin, uint8_t slave_id,
+                         bool responded)
 {
-    neu_conn_state_t               state = { 0 };
-    neu_adapter_update_metric_cb_t update_metric =
-        plugin->common.adapter_callbacks->update_metric;
-    struct modbus_group_data *gd  = NULL;
-    int64_t                   rtt = NEU_METRIC_LAST_RTT_MS_MAX;
+    if (plugin->max_backoff == 0) {
+        return;
+    }
 
-    if (group->user_data == NULL) {
-        gd = calloc(1, sizeof(struct modbus_group_data));
+    if (responded) {
+        if (plugin->n_fail[slave_id] >= plugin->breaker_threshold) {
+            plog_notice(plugin, "slave %hhu is back online", slave_id);
+        }
+        plugin->n_fail[slave_id]        = 0;
+        plugin->offline_until[slave_id] = 0;
+        return;
+    }
 
-        group->user_data  = gd;
-        group->group_free = plugin_group_free;
-        utarray_new(gd->tags, &ut_ptr_icd);
+    if (plugin->n_fail[slave_id] < UINT8_MAX) {
+        plugin->n_fail[slave_id] += 1;
+    }
+    if (plugin->n_fail[slave_id] < plugin->breaker_threshold) {
+        return;
+    }
 
-        utarray_foreach(group->tags, neu_datatag_t *, tag)
-        {
-            modbus_point_t *p   = calloc(1, sizeof(modbus_point_t));
-            int             ret = modbus_tag_to_point(tag, p);
-            if (ret != NEU_ERR_SUCCESS) {
-                plog_error(plugin, "invalid tag: %s, address: %s", tag->name,
-                           tag->address);
-            }
+    uint64_t pause = 1000;
+    for (uint8_t i = plugin->breaker_threshold; i < plugin->n_fail[slave_id];
+         i++) {
+        if (pause >= plugin->max_backoff) {
+            break;
+        }
+        pause *= 2;
+    }
+    if (pause > plugin->max_backoff) {
+        pause = plugin->max_backoff;
+    }
+    plugin->offline_until[slave_id] = neu_time_ms() + pause;
+    plog_warn(plugin, "slave %hhu not responding, skip it for %" PRIu64 " ms",
+              slave_id, pause);
+}
 
-            utarray_push_back(gd->tags, &p);
+// once the pause is over, the next command probes the slave without retries
+static uint16_t slave_retries(neu_plugin_t *plugin, uint8_t slave_id)
+{
+    if (plugin->max_backoff > 0 &&
+        plugin->n_fail[slave_id] >= plugin->breaker_threshold) {
+        return 0;
+    }
+    return plugin->max_retries;
+}
+
+static uint16_t slave_offline_count(neu_plugin_t *            plugin,
+                                    struct modbus_group_data *gd)
+{
+    bool     seen[256] = { false };
+    uint16_t n         = 0;
+    int64_t  now       = neu_time_ms();
+
+    if (plugin->max_backoff == 0) {
+        return 0;
+    }
+
+    for (uint16_t i = 0; i < gd->cmd_sort->n_cmd; i++) {
+        uint8_t slave_id = gd->cmd_sort->cmd[i].slave_id;
+
+        if (!seen[slave_id] && plugin->offline_until[slave_id] > now) {
+            n += 1;
         }
+        seen[slave_id] = true;
+    }
+    return n;
+}
 
-        gd->group    = strdup(group->group_name);
-        gd->cmd_sort = modbus_tag_sort(gd->tags, max_byte);
+// skip the command if its slave is backing off
+static bool slave_skip(neu_plugin_t *plugin, struct modbus_group_data *gd,
+                       uint16_t i)
+{
+    uint8_t slave_id = gd->cmd_sort->cmd[i].slave_id;
+
+    if (plugin->max_backoff == 0 ||
+        plugin->offline_until[slave_id] <= (int64_t) neu_time_ms()) {
+        return false;
     }
 
-    gd                        = (struct modbus_group_data *) group->user_data;
-    plugin->plugin_group_data = gd;
+    plugin->cmd_idx = i;
+    modbus_value_handle(plugin, slave_id, 0, NULL,
+                        NEU_ERR_PLUGIN_DEVICE_NOT_RESPONSE);
+    return true;
+}
+
+// skip the command if its points are not due in this cycle, or its slave is
+// backing off
+static bool cmd_skip(neu_plugin_t *plugin, struct modbus_group_data *gd,
+                     uint16_t i)
+{
+    uint16_t divisor = gd->cmd_sort->cmd[i].poll_divisor;
+
+    if (divisor > 1 && gd->cycle % divisor != 0) {
+        return true;
+    }
+    return slave_skip(plugin, gd, i);
+}
+
+// the read command the poll goes on with after the writes preempting it, a
+// write may carry it with read/write multiple registers, see write_read
+static __thread struct modbus_group_data *preempted_gd   = NULL;
+static __thread uint16_t                  preempted_cmd  = 0;
+static __thread bool                      preempted_read = false;
+
+// the connection is idle between two stop and wait reads, a write that
+// preempts the poll goes out there. Returns whether read command i was
+// served along with such a write
+static bool read_preempt(struct modbus_group_data *gd, uint16_t i)
+{
+    if (gd->grp != NULL && gd->grp->preempt != NULL) {
+        preempted_gd   = gd;
+        preempted_cmd  = i;
+        preempted_read = false;
+        gd->grp->preempt(gd->grp);
+        preempted_gd = NULL;
+    }
+    return preempted_read;
+}
+
+// stop and wait, send the next read request after the response of the
+// previous one
+static int64_t modbus_group_read(neu_plugin_t *            plugin,
+                                 struct modbus_group_data *gd)
+{
+    int64_t rtt = NEU_METRIC_LAST_RTT_MS_MAX;
 
     for (uint16_t i = 0; i < gd->cmd_sort->n_cmd; i++) {
+        if (cmd_skip(plugin, gd, i)) {
+            continue;
+        }
+        if (i > 0 && read_preempt(gd, i)) {
+            continue;
+        }
+
+        rtt_apply(plugin, rtt_timeout(plugin, gd->cmd_sort->cmd[i].slave_id));
+
         plugin->cmd_idx        = i;
         uint16_t response_size = 0;
-        uint64_t read_tms      = neu_time_ms();
+        uint64_t read_tms      = neu_mono_ms();
         int      ret_buf       = 0;
         int      ret_r         = modbus_stack_read(
             plugin->stack, gd->cmd_sort->cmd[i].slave_id,
@@ -180,9 +540,14 @@ int modbus_group_timer(neu_plugin_t *plugin, neu_plugin_group_t *group,
             ret_buf = process_protocol_buf(
                 plugin, gd->cmd_sort->cmd[i].slave_id, response_size);
             if (ret_buf > 0) {
-                rtt = neu_time_ms() - read_tms;
+                rtt = neu_mono_ms() - read_tms;
+                rtt_sample(plugin, gd->cmd_sort->cmd[i].slave_id, rtt);
             } else if (ret_buf == 0) {
-                for (uint16_t j = 0; j < plugin->max_retries; j++) {
+                uint16_t retries =
+                    slave_retries(plugin, gd->cmd_sort->cmd[i].slave_id);
+
+                rtt_miss(plugin, gd->cmd_sort->cmd[i].slave_id);
+                for (uint16_t j = 0; j < retries; j++) {
                     ret_r = modbus_stack_read_retry(plugin, gd, i, j,
                                                     &response_size);
                     if (ret_r > 0) {
@@ -190,7 +555,7 @@ int modbus_group_timer(neu_plugin_t *plugin, neu_plugin_group_t *group,
                             plugin, gd->cmd_sort->cmd[i].slave_id,
                             response_size);
                         if (ret_buf > 0) {
-                            rtt = neu_time_ms() - read_tms;
+                            rtt = neu_mono_ms() - read_tms;
                             break;
                         } else if (ret_buf < 0) {
                             if (ret_buf == -1) {
@@ -214,9 +579,10 @@ int modbus_group_timer(neu_plugin_t *plugin, neu_plugin_group_t *group,
                                     gd->cmd_sort->cmd[i].slave_id,
                                     gd->cmd_sort->cmd[i].start_address);
                             }
-                            rtt = neu_time_ms() - read_tms;
+                            rtt = neu_mono_ms() - read_tms;
                             break;
                         }
+                        rtt_miss(plugin, gd->cmd_sort->cmd[i].slave_id);
                     } else {
                         modbus_value_handle(plugin,
                                             gd->cmd_sort->cmd[i].slave_id, 0,
@@ -251,17 +617,20 @@ int modbus_group_timer(neu_plugin_t *plugin, neu_plugin_group_t *group,
                                gd->cmd_sort->cmd[i].slave_id,
                                gd->cmd_sort->cmd[i].start_address);
                 }
-                rtt = neu_time_ms() - read_tms;
+                rtt = neu_mono_ms() - read_tms;
+                rtt_sample(plugin, gd->cmd_sort->cmd[i].slave_id, rtt);
             }
         } else {
-            for (uint16_t j = 0; j < plugin->max_retries; j++) {
+            uint16_t retries =
+                slave_retries(plugin, gd->cmd_sort->cmd[i].slave_id);
+            for (uint16_t j = 0; j < retries; j++) {
                 ret_r =
                     modbus_stack_read_retry(plugin, gd, i, j, &response_size);
                 if (ret_r > 0) {
                     ret_buf = process_protocol_buf(
                         plugin, gd->cmd_sort->cmd[i].slave_id, response_size);
                     if (ret_buf > 0) {
-                        rtt = neu_time_ms() - read_tms;
+                        rtt = neu_mono_ms() - read_tms;
                         break;
                     } else if (ret_buf < 0) {
                         if (ret_buf == -1) {
@@ -282,9 +651,10 @@ int modbus_group_timer(neu_plugin_t *plugin, neu_plugin_group_t *group,
                                        gd->cmd_sort->cmd[i].slave_id,
                                        gd->cmd_sort->cmd[i].start_address);
                         }
-                        rtt = neu_time_ms() - read_tms;
+                        rtt = neu_mono_ms() - read_tms;
                         break;
                     } else if (ret_buf == 0) {
+                        rtt_miss(plugin, gd->cmd_sort->cmd[i].slave_id);
                         modbus_value_handle(
                             plugin, gd->cmd_sort->cmd[i].slave_id, 0, NULL,
                             NEU_ERR_PLUGIN_DEVICE_NOT_RESPONSE);
@@ -304,6 +674,9 @@ int modbus_group_timer(neu_plugin_t *plugin, neu_plugin_group_t *group,
                 break;
             }
         }
+        if (ret_r > 0) {
+            slave_update(plugin, gd->cmd_sort->cmd[i].slave_id, ret_buf != 0);
+        }
         if (plugin->interval > 0) {
             struct timespec t1 = { .tv_sec  = plugin->interval / 1000,
                                    .tv_nsec = 1000 * 1000 *
@@ -313,146 +686,857 @@ int modbus_group_timer(neu_plugin_t *plugin, neu_plugin_group_t *group,
         }
     }
 
+    return rtt;
+}
+
+// a read request of the pipelined mode that is waiting for its response
+struct modbus_inflight {
+    uint16_t cmd;
+    uint16_t seq;
+    uint16_t response_size;
+    uint16_t tries;
+    uint64_t send_tms;
+};
+
+#define MODBUS_PIPELINE_TIMEOUT -1
+#define MODBUS_PIPELINE_BROKEN -2
+#define MODBUS_PIPELINE_STALE -3
+
+static int pipeline_send(neu_plugin_t *plugin, struct modbus_group_data *gd,
+                         struct modbus_inflight *req)
+{
+    modbus_read_cmd_t *cmd = &gd->cmd_sort->cmd[req->cmd];
+
+    plugin->cmd_idx = req->cmd;
+    req->seq        = modbus_stack_read_seq(plugin->stack);
+    req->send_tms   = neu_mono_ms();
+    return modbus_stack_read(plugin->stack, cmd->slave_id, cmd->area,
+                             cmd->start_address, cmd->n_register,
+                             &req->response_size);
+}
+
+// receive one response and hand it to the in-flight request carrying the same
+// transaction id, return the index of that request and the process result in
+// result, or one of the MODBUS_PIPELINE_* codes
+static int pipeline_recv(neu_plugin_t *plugin, struct modbus_group_data *gd,
+                         struct modbus_inflight *reqs, uint16_t n_req,
+                         int *result)
+{
+    uint8_t                   buf[260] = { 0 };
+    struct modbus_header *    header   = (struct modbus_header *) buf;
+    neu_protocol_unpack_buf_t pbuf     = { 0 };
+    ssize_t                   ret      = 0;
+    int                       idx      = MODBUS_PIPELINE_STALE;
+    uint16_t                  len      = 0;
+
+    ret = neu_conn_recv(plugin->conn, buf, sizeof(struct modbus_header));
+    if (ret == 0 || ret == -1) {
+        return MODBUS_PIPELINE_TIMEOUT;
+    }
+
+    len = ntohs(header->len);
+    if (ret != sizeof(struct modbus_header) ||
+        len > sizeof(buf) - sizeof(struct modbus_header)) {
+        return MODBUS_PIPELINE_BROKEN;
+    }
+
+    ret = neu_conn_recv(plugin->conn, buf + sizeof(struct modbus_header), len);
+    if (ret != len) {
+        return MODBUS_PIPELINE_BROKEN;
+    }
+    ret += sizeof(struct modbus_header);
+    plog_recv_protocol(plugin, buf, ret);
+
+    for (uint16_t i = 0; i < n_req; i++) {
+        if (reqs[i].seq == ntohs(header->seq)) {
+            idx = i;
+            break;
+        }
+    }
+    if (idx == MODBUS_PIPELINE_STALE) {
+        plog_warn(plugin, "drop modbus response, unknown transaction id: %hu",
+                  ntohs(header->seq));
+        return idx;
+    }
+
+    if (ret > reqs[idx].response_size) {
+        *result = -1;
+        return idx;
+    }
+
+    plugin->cmd_idx = reqs[idx].cmd;
+    neu_protocol_unpack_buf_init(&pbuf, buf, ret);
+    *result = modbus_stack_recv(
+        plugin->stack, gd->cmd_sort->cmd[reqs[idx].cmd].slave_id, &pbuf);
+    if (*result != MODBUS_DEVICE_ERR && ret != reqs[idx].response_size) {
+        *result = -1;
+    }
+    return idx;
+}
+
+static void pipeline_error(neu_plugin_t *plugin, struct modbus_group_data *gd,
+                           uint16_t cmd, int error)
+{
+    plugin->cmd_idx = cmd;
+    modbus_value_handle(plugin, gd->cmd_sort->cmd[cmd].slave_id, 0, NULL,
+                        error);
+}
+
+// keep up to max_inflight read requests on the wire, responses are matched by
+// the MBAP transaction id, so they may arrive in any order. The send interval
+// is not applied in this mode.
+static int64_t modbus_group_pipeline(neu_plugin_t *             plugin,
+                                     struct modbus_group_data *gd)
+{
+    struct modbus_inflight *reqs =
+        calloc(plugin->max_inflight, sizeof(struct modbus_inflight));
+    int64_t  rtt          = NEU_METRIC_LAST_RTT_MS_MAX;
+    uint16_t n_req        = 0;
+    uint16_t next         = 0;
+    bool     disconnected = false;
+
+    while (!disconnected && (next < gd->cmd_sort->n_cmd || n_req > 0)) {
+        while (n_req < plugin->max_inflight && next < gd->cmd_sort->n_cmd) {
+            if (cmd_skip(plugin, gd, next)) {
+                next += 1;
+                continue;
+            }
+            reqs[n_req].cmd   = next++;
+            reqs[n_req].tries = 0;
+            if (pipeline_send(plugin, gd, &reqs[n_req]) <= 0) {
+                disconnected = true;
+                break;
+            }
+            n_req += 1;
+        }
+        if (disconnected) {
+            break;
+        }
+        if (n_req == 0) {
+            continue;
+        }
+
+        // wait as long as the slowest slave in flight needs
+        uint16_t timeout = 0;
+        for (uint16_t i = 0; i < n_req; i++) {
+            uint16_t t = rtt_timeout(
+                plugin, gd->cmd_sort->cmd[reqs[i].cmd].slave_id);
+            timeout = t > timeout ? t : timeout;
+        }
+        rtt_apply(plugin, timeout);
+
+        int result = 0;
+        int idx    = pipeline_recv(plugin, gd, reqs, n_req, &result);
+
+        if (idx >= 0) {
+            modbus_read_cmd_t *cmd = &gd->cmd_sort->cmd[reqs[idx].cmd];
+
+            if (result == -1) {
+                pipeline_error(plugin, gd, reqs[idx].cmd,
+                               NEU_ERR_PLUGIN_PROTOCOL_DECODE_FAILURE);
+                plog_error(plugin, "modbus message error, skip, %hhu!%hu",
+                           cmd->slave_id, cmd->start_address);
+            } else if (result == MODBUS_DEVICE_ERR) {
+                pipeline_error(plugin, gd, reqs[idx].cmd,
+                               NEU_ERR_PLUGIN_READ_FAILURE);
+                plog_error(plugin,
+                           "modbus device response error, skip, %hhu!%hu",
+                           cmd->slave_id, cmd->start_address);
+            }
+            slave_update(plugin, cmd->slave_id, true);
+            rtt = neu_mono_ms() - reqs[idx].send_tms;
+            if (reqs[idx].tries == 0) {
+                rtt_sample(plugin, cmd->slave_id, rtt);
+            }
+            reqs[idx] = reqs[n_req - 1];
+            n_req -= 1;
+        } else if (idx == MODBUS_PIPELINE_TIMEOUT) {
+            // every in-flight request was sent before the receive started, so
+            // all of them have been waiting longer than the timeout
+            for (uint16_t i = 0; i < n_req;) {
+                modbus_read_cmd_t *cmd = &gd->cmd_sort->cmd[reqs[i].cmd];
+
+                rtt_miss(plugin, cmd->slave_id);
+                if (reqs[i].tries < slave_retries(plugin, cmd->slave_id)) {
+                    reqs[i].tries += 1;
+                    plog_notice(plugin, "Resend read req. Times:%hu",
+                                reqs[i].tries);
+                    if (pipeline_send(plugin, gd, &reqs[i]) <= 0) {
+                        disconnected = true;
+                        break;
+                    }
+                    i += 1;
+                } else {
+                    pipeline_error(plugin, gd, reqs[i].cmd,
+                                   NEU_ERR_PLUGIN_DEVICE_NOT_RESPONSE);
+                    plog_warn(plugin,
+                              "no modbus response received, skip, %hhu!%hu",
+                              cmd->slave_id, cmd->start_address);
+                    slave_update(plugin, cmd->slave_id, false);
+                    reqs[i] = reqs[n_req - 1];
+                    n_req -= 1;
+                }
+            }
+        } else if (idx == MODBUS_PIPELINE_BROKEN) {
+            plog_error(plugin, "modbus message error, reset connection");
+            for (uint16_t i = 0; i < n_req; i++) {
+                pipeline_error(plugin, gd, reqs[i].cmd,
+                               NEU_ERR_PLUGIN_PROTOCOL_DECODE_FAILURE);
+            }
+            disconnected = true;
+        }
+    }
+
+    if (disconnected) {
+        // modbus_stack_read already reported a failed send to the group
+        rtt = NEU_METRIC_LAST_RTT_MS_MAX;
+        neu_conn_disconnect(plugin->conn);
+    }
+
+    free(reqs);
+    return rtt;
+}
+
+// send the pending commands of one round to the clients, a command goes to
+// the client its slave answered on before, or to all of them
+static void serve_send(neu_plugin_t *plugin, struct modbus_group_data *gd,
+                       struct modbus_serve *serve, const bool *pending,
+                       const int *fds, int n_fd)
+{
+    for (uint16_t i = 0; i < gd->cmd_sort->n_cmd; i++) {
+        modbus_read_cmd_t *cmd   = &gd->cmd_sort->cmd[i];
+        int                bound = 0;
+
+        if (!pending[i]) {
+            continue;
+        }
+
+        pthread_mutex_lock(&plugin->server_mtx);
+        bound = plugin->slave_fd[cmd->slave_id];
+        pthread_mutex_unlock(&plugin->server_mtx);
+
+        for (int j = 0; j < n_fd; j++) {
+            struct modbus_serve_req *req = NULL;
+
+            if (bound > 0 && fds[j] != bound) {
+                continue;
+            }
+
+            pthread_mutex_lock(&plugin->server_mtx);
+            req           = &serve->reqs[serve->n_req++];
+            req->cmd      = i;
+            req->fd       = fds[j];
+            req->seq      = modbus_stack_read_seq(plugin->stack);
+            req->send_tms = neu_mono_ms();
+            serve->n_wait += 1;
+            pthread_mutex_unlock(&plugin->server_mtx);
+
+            plugin->cmd_idx   = i;
+            plugin->client_fd = fds[j];
+            if (modbus_stack_read(plugin->stack, cmd->slave_id, cmd->area,
+                                  cmd->start_address, cmd->n_register,
+                                  &req->response_size) <= 0) {
+                pthread_mutex_lock(&plugin->server_mtx);
+                req->done = true;
+                serve->n_wait -= 1;
+                pthread_mutex_unlock(&plugin->server_mtx);
+            }
+        }
+    }
+}
+
+// wait for the responses of a round, return the index of the first response
+// of each command in first, -1 for commands without a response
+static void serve_wait(neu_plugin_t *plugin, struct modbus_serve *serve,
+                       int *first, uint16_t n_cmd)
+{
+    struct timespec deadline = { 0 };
+
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += plugin->timeout / 1000;
+    deadline.tv_nsec += (plugin->timeout % 1000) * 1000 * 1000;
+    if (deadline.tv_nsec >= 1000 * 1000 * 1000) {
+        deadline.tv_sec += 1;
+        deadline.tv_nsec -= 1000 * 1000 * 1000;
+    }
+
+    pthread_mutex_lock(&plugin->server_mtx);
+    while (serve->n_wait > 0) {
+        if (pthread_cond_timedwait(&plugin->server_cond, &plugin->server_mtx,
+                                   &deadline) == ETIMEDOUT) {
+            break;
+        }
+    }
+    plugin->serve = NULL;
+    pthread_mutex_unlock(&plugin->server_mtx);
+
+    for (uint16_t i = 0; i < n_cmd; i++) {
+        first[i] = -1;
+    }
+    for (uint32_t i = 0; i < serve->n_req; i++) {
+        if (serve->reqs[i].len > 0 && first[serve->reqs[i].cmd] < 0) {
+            first[serve->reqs[i].cmd] = i;
+        }
+    }
+}
+
+// tcp server with several devices connected, the read requests of a group are
+// sent to every client at once and the event loop collects the responses, so
+// a cycle takes one response time no matter how many devices are connected
+static int64_t modbus_group_serve(neu_plugin_t *             plugin,
+                                  struct modbus_group_data *gd)
+{
+    uint16_t              n_cmd   = gd->cmd_sort->n_cmd;
+    int64_t               rtt     = NEU_METRIC_LAST_RTT_MS_MAX;
+    bool *                pending = calloc(n_cmd, sizeof(bool));
+    uint16_t *            tries   = calloc(n_cmd, sizeof(uint16_t));
+    int *                 first   = calloc(n_cmd, sizeof(int));
+    int *                 fds     = NULL;
+    int                   n_fd    = 0;
+    bool                  more    = false;
+    struct modbus_serve   serve   = { 0 };
+    struct modbus_client *client  = NULL;
+
+    pthread_mutex_lock(&plugin->server_mtx);
+    LL_COUNT(plugin->clients, client, n_fd);
+    fds  = calloc(n_fd, sizeof(int));
+    n_fd = 0;
+    LL_FOREACH(plugin->clients, client) { fds[n_fd++] = client->fd; }
+    pthread_mutex_unlock(&plugin->server_mtx);
+
+    if (n_fd == 0) {
+        plugin->cmd_idx = 0;
+        modbus_value_handle(plugin, 0, 0, NULL, NEU_ERR_PLUGIN_DISCONNECTED);
+    }
+
+    for (uint16_t i = 0; n_fd > 0 && i < n_cmd; i++) {
+        pending[i] = !cmd_skip(plugin, gd, i);
+        more       = more || pending[i];
+    }
+
+    serve.reqs = calloc((size_t) n_cmd * n_fd + 1,
+                        sizeof(struct modbus_serve_req));
+    while (more) {
+        memset(serve.reqs, 0, serve.n_req * sizeof(struct modbus_serve_req));
+        serve.n_req  = 0;
+        serve.n_wait = 0;
+        pthread_mutex_lock(&plugin->server_mtx);
+        plugin->serve = &serve;
+        pthread_mutex_unlock(&plugin->server_mtx);
+
+        serve_send(plugin, gd, &serve, pending, fds, n_fd);
+        serve_wait(plugin, &serve, first, n_cmd);
+
+        more = false;
+        for (uint16_t i = 0; i < n_cmd; i++) {
+            modbus_read_cmd_t *       cmd    = &gd->cmd_sort->cmd[i];
+            struct modbus_serve_req * req    = NULL;
+            neu_protocol_unpack_buf_t pbuf   = { 0 };
+            int                       result = 0;
+
+            if (!pending[i]) {
+                continue;
+            }
+
+            if (first[i] < 0) {
+                if (tries[i] < slave_retries(plugin, cmd->slave_id)) {
+                    tries[i] += 1;
+                    plog_notice(plugin, "Resend read req. Times:%hu",
+                                tries[i]);
+                    more = true;
+                    continue;
+                }
+
+                plugin->cmd_idx = i;
+                modbus_value_handle(plugin, cmd->slave_id, 0, NULL,
+                                    NEU_ERR_PLUGIN_DEVICE_NOT_RESPONSE);
+                plog_warn(plugin,
+                          "no modbus response received, skip, %hhu!%hu",
+                          cmd->slave_id, cmd->start_address);
+                slave_update(plugin, cmd->slave_id, false);
+                pending[i] = false;
+                continue;
+            }
+
+            req = &serve.reqs[first[i]];
+            pthread_mutex_lock(&plugin->server_mtx);
+            plugin->slave_fd[cmd->slave_id] = req->fd;
+            pthread_mutex_unlock(&plugin->server_mtx);
+
+            plugin->cmd_idx = i;
+            if (req->len > req->response_size) {
+                result = -1;
+            } else {
+                neu_protocol_unpack_buf_init(&pbuf, req->frame, req->len);
+                result = modbus_stack_recv(plugin->stack, cmd->slave_id, &pbuf);
+                if (result != MODBUS_DEVICE_ERR &&
+                    req->len != req->response_size) {
+                    result = -1;
+                }
+            }
+
+            if (result == -1) {
+                modbus_value_handle(plugin, cmd->slave_id, 0, NULL,
+                                    NEU_ERR_PLUGIN_PROTOCOL_DECODE_FAILURE);
+                plog_error(plugin, "modbus message error, skip, %hhu!%hu",
+                           cmd->slave_id, cmd->start_address);
+            } else if (result == MODBUS_DEVICE_ERR) {
+                modbus_value_handle(plugin, cmd->slave_id, 0, NULL,
+                                    NEU_ERR_PLUGIN_READ_FAILURE);
+                plog_error(plugin,
+                           "modbus device response error, skip, %hhu!%hu",
+                           cmd->slave_id, cmd->start_address);
+            }
+            slave_update(plugin, cmd->slave_id, true);
+            rtt        = req->recv_tms - req->send_tms;
+            pending[i] = false;
+        }
+    }
+
+    free(serve.reqs);
+    free(fds);
+    free(first);
+    free(tries);
+    free(pending);
+    return rtt;
+}
+
+int modbus_group_timer(neu_plugin_t *plugin, neu_plugin_group_t *group,
+                       uint16_t max_byte)
+{
+    neu_conn_state_t               state = { 0 };
+    neu_adapter_update_metric_cb_t update_metric =
+        plugin->common.adapter_callbacks->update_metric;
+    struct modbus_group_data *gd  = NULL;
+    int64_t                   rtt = NEU_METRIC_LAST_RTT_MS_MAX;
+
+    if (group->user_data == NULL) {
+        gd = calloc(1, sizeof(struct modbus_group_data));
+
+        group->user_data  = gd;
+        group->group_free = plugin_group_free;
+        utarray_new(gd->tags, &ut_ptr_icd);
+
+        utarray_foreach(group->tags, neu_datatag_t *, tag)
+        {
+            modbus_point_t *p   = calloc(1, sizeof(modbus_point_t));
+            int             ret = modbus_tag_to_point(tag, p);
+            if (ret != NEU_ERR_SUCCESS) {
+                plog_error(plugin, "invalid tag: %s, address: %s", tag->name,
+                           tag->address);
+            }
+
+            utarray_push_back(gd->tags, &p);
+        }
+
+        gd->group    = strdup(group->group_name);
+        gd->cmd_sort = modbus_tag_sort(gd->tags, max_byte, plugin->max_gap);
+    }
+
+    gd                        = (struct modbus_group_data *) group->user_data;
+    plugin->plugin_group_data = gd;
+    // the commands are planned per poll divisor, so the cycle tells which are
+    // due, every one of them is in cycle 0 and outside the group timer
+    gd->cycle = group->active != NULL ? group->cycle : 0;
+    gd->grp   = group;
+
+    if (serve_mode(plugin)) {
+        rtt = modbus_group_serve(plugin, gd);
+    } else if (plugin->max_inflight > 1 &&
+               plugin->protocol == MODBUS_PROTOCOL_TCP && !plugin->is_server) {
+        rtt = modbus_group_pipeline(plugin, gd);
+    } else {
+        rtt = modbus_group_read(plugin, gd);
+    }
+    // learn from the exceptions of this cycle, a device usually rejects
+    // commands that cover addresses it does not map
+    modbus_tag_sort_split(gd->cmd_sort);
+    gd->grp        = NULL;
+    group->n_block = gd->cmd_sort->n_cmd;
+
     state = neu_conn_state(plugin->conn);
     update_metric(plugin->common.adapter, NEU_METRIC_SEND_BYTES,
                   state.send_bytes, NULL);
     update_metric(plugin->common.adapter, NEU_METRIC_RECV_BYTES,
                   state.recv_bytes, NULL);
     update_metric(plugin->common.adapter, NEU_METRIC_LAST_RTT_MS, rtt, NULL);
+    if (NEU_METRIC_LAST_RTT_MS_MAX != rtt &&
+        !neu_metric_off(NEU_METRIC_RTT_MS, NEU_METRIC_RTT_MS_TYPE, false)) {
+        update_metric(plugin->common.adapter, NEU_METRIC_RTT_MS, rtt, NULL);
+    }
     update_metric(plugin->common.adapter, NEU_METRIC_GROUP_LAST_SEND_MSGS,
                   gd->cmd_sort->n_cmd, group->group_name);
+    update_metric(plugin->common.adapter, NEU_METRIC_GROUP_DEVICES_OFFLINE,
+                  slave_offline_count(plugin, gd), group->group_name);
+    return 0;
+}
+
+typedef struct {
+    const char *   name;
+    UT_hash_handle hh;
+} point_name_t;
+
+int modbus_group_update(neu_plugin_t *plugin, neu_plugin_group_t *group,
+                        const neu_plugin_group_delta_t *delta,
+                        uint16_t                        max_byte)
+{
+    struct modbus_group_data *gd      = group->user_data;
+    point_name_t *            names   = NULL, *name = NULL, *tmp = NULL;
+    UT_array *                kept    = NULL;
+    UT_array *                stale   = NULL;
+    UT_array *                fresh   = NULL;
+    UT_array *                gone[2] = { delta->removed, delta->modified };
+    UT_array *                come[2] = { delta->added, delta->modified };
+    unsigned                  n_change = utarray_len(delta->added) +
+        utarray_len(delta->removed) + utarray_len(delta->modified);
+
+    // past half of the points a new plan costs less than the searches
+    if (2 * n_change > utarray_len(gd->tags)) {
+        return -1;
+    }
+
+    for (int i = 0; i < 2; i++) {
+        utarray_foreach(gone[i], neu_datatag_t **, tag)
+        {
+            name = calloc(1, sizeof(point_name_t));
+            if (NULL == name) {
+                HASH_ITER(hh, names, name, tmp)
+                {
+                    HASH_DEL(names, name);
+                    free(name);
+                }
+                return -1;
+            }
+            name->name = (*tag)->name;
+            HASH_ADD_KEYPTR(hh, names, name->name, strlen(name->name), name);
+        }
+    }
+
+    utarray_new(kept, &ut_ptr_icd);
+    utarray_new(stale, &ut_ptr_icd);
+    utarray_new(fresh, &ut_ptr_icd);
+    utarray_foreach(gd->tags, modbus_point_t **, p_tag)
+    {
+        HASH_FIND_STR(names, (*p_tag)->name, name);
+        utarray_push_back(NULL == name ? kept : stale, p_tag);
+    }
+
+    for (int i = 0; i < 2; i++) {
+        utarray_foreach(come[i], neu_datatag_t **, tag)
+        {
+            modbus_point_t *p   = calloc(1, sizeof(modbus_point_t));
+            int             ret = modbus_tag_to_point(*tag, p);
+            if (ret != NEU_ERR_SUCCESS) {
+                plog_error(plugin, "invalid tag: %s, address: %s",
+                           (*tag)->name, (*tag)->address);
+            }
+
+            utarray_push_back(kept, &p);
+            utarray_push_back(fresh, &p);
+        }
+    }
+
+    modbus_tag_sort_update(gd->cmd_sort, stale, fresh, max_byte,
+                           plugin->max_gap);
+    plog_notice(plugin,
+                "group: %s, %u points replanned in place, %u read commands",
+                group->group_name, n_change, gd->cmd_sort->n_cmd);
+
+    utarray_foreach(stale, modbus_point_t **, p_tag) { free(*p_tag); }
+    HASH_ITER(hh, names, name, tmp)
+    {
+        HASH_DEL(names, name);
+        free(name);
+    }
+    utarray_free(gd->tags);
+    utarray_free(stale);
+    utarray_free(fresh);
+    gd->tags = kept;
     return 0;
 }
 
+static void forget_last(modbus_read_cmd_t *cmd)
+{
+    free(cmd->last);
+    cmd->last   = NULL;
+    cmd->n_last = 0;
+}
+
+static bool decode_unchanged(const modbus_decode_t *d, const uint8_t *last,
+                             const uint8_t *bytes, uint16_t n_byte)
+{
+    uint16_t start = d->kernel == MODBUS_DECODE_COIL ? d->end - 1 : d->offset;
+
+    // a point beyond a short response decodes to the same empty value
+    if (n_byte < d->end) {
+        return true;
+    }
+    return memcmp(last + start, bytes + start, d->end - start) == 0;
+}
+
+// the bit points of a register from one load of the word, the bits the same
+// as in the last response only have their timestamps refreshed
+static void decode_bits(const modbus_decode_t *d, const uint8_t *last,
+                        const uint8_t *bytes, uint16_t n_byte,
+                        const char **names, neu_dvalue_t *dvalues, int *n_tag,
+                        const char **same, int *n_same)
+{
+    neu_value16_u v16  = { 0 };
+    neu_value16_u prev = { 0 };
+    uint16_t      word = 0;
+
+    if (n_byte >= d->end) {
+        memcpy(&word, bytes + d->offset, sizeof(word));
+        v16.value = ntohs(word);
+    } else {
+        last = NULL;
+    }
+    if (last != NULL) {
+        memcpy(&word, last + d->offset, sizeof(word));
+        prev.value = ntohs(word);
+    }
+
+    for (uint16_t k = 0; k < d->n_bit; k++) {
+        uint8_t bit = neu_value16_get_bit(v16, d[k].bit);
+
+        if (last != NULL && bit == neu_value16_get_bit(prev, d[k].bit)) {
+            same[(*n_same)++] = d[k].name;
+            continue;
+        }
+        names[*n_tag]            = d[k].name;
+        dvalues[*n_tag].type     = d[k].type;
+        dvalues[*n_tag].value.u8 = bit;
+        *n_tag += 1;
+    }
+}
+
 int modbus_value_handle(void *ctx, uint8_t slave_id, uint16_t n_byte,
                         uint8_t *bytes, int error)
 {
     neu_plugin_t *            plugin = (neu_plugin_t *) ctx;
     struct modbus_group_data *gd =
         (struct modbus_group_data *) plugin->plugin_group_data;
-    uint16_t start_address = gd->cmd_sort->cmd[plugin->cmd_idx].start_address;
-    uint16_t n_register    = gd->cmd_sort->cmd[plugin->cmd_idx].n_register;
+    modbus_read_cmd_t *cmd     = &gd->cmd_sort->cmd[plugin->cmd_idx];
+    UT_array *         tags    = cmd->tags;
+    int                n_tag   = 0;
+    int                n_same  = 0;
+    const char **      names   = NULL;
+    const char **      same    = NULL;
+    neu_dvalue_t *     dvalues = NULL;
+    bool               cmp     = false;
+    bool               equal   = false;
 
     if (error == NEU_ERR_PLUGIN_DISCONNECTED) {
         neu_dvalue_t dvalue = { 0 };
 
+        for (uint16_t i = 0; i < gd->cmd_sort->n_cmd; i++) {
+            forget_last(&gd->cmd_sort->cmd[i]);
+        }
+
         dvalue.type      = NEU_TYPE_ERROR;
         dvalue.value.i32 = error;
         plugin->common.adapter_callbacks->driver.update(
             plugin->common.adapter, gd->group, NULL, dvalue);
         return 0;
-    } else if (error != NEU_ERR_SUCCESS) {
-        utarray_foreach(gd->cmd_sort->cmd[plugin->cmd_idx].tags,
-                        modbus_point_t **, p_tag)
+    }
+
+    names   = calloc(utarray_len(tags), sizeof(char *));
+    dvalues = calloc(utarray_len(tags), sizeof(neu_dvalue_t));
+
+    if (error == NEU_ERR_PLUGIN_READ_FAILURE) {
+        cmd->rejected = true;
+    }
+
+    if (error != NEU_ERR_SUCCESS) {
+        forget_last(cmd);
+        utarray_foreach(tags, modbus_point_t **, p_tag)
         {
-            neu_dvalue_t dvalue = { 0 };
-            dvalue.type         = NEU_TYPE_ERROR;
-            dvalue.value.i32    = error;
-            plugin->common.adapter_callbacks->driver.update(
-                plugin->common.adapter, gd->group, (*p_tag)->name, dvalue);
+            names[n_tag]             = (*p_tag)->name;
+            dvalues[n_tag].type      = NEU_TYPE_ERROR;
+            dvalues[n_tag].value.i32 = error;
+            n_tag += 1;
         }
+        plugin->common.adapter_callbacks->driver.update_batch(
+            plugin->common.adapter, gd->group, n_tag, names, dvalues);
+        free(names);
+        free(dvalues);
         return 0;
     }
 
-    utarray_foreach(gd->cmd_sort->cmd[plugin->cmd_idx].tags, modbus_point_t **,
-                    p_tag)
-    {
-        neu_dvalue_t dvalue = { 0 };
-
-        if ((*p_tag)->start_address + (*p_tag)->n_register >
-                start_address + n_register ||
-            slave_id != (*p_tag)->slave_id) {
-            dvalue.type      = NEU_TYPE_ERROR;
-            dvalue.value.i32 = NEU_ERR_PLUGIN_READ_FAILURE;
-        } else {
-            switch ((*p_tag)->area) {
-            case MODBUS_AREA_HOLD_REGISTER:
-            case MODBUS_AREA_INPUT_REGISTER:
-                if (n_byte >= ((*p_tag)->start_address - start_address) * 2 +
-                        (*p_tag)->n_register * 2) {
-                    memcpy(dvalue.value.bytes.bytes,
-                           bytes +
-                               ((*p_tag)->start_address - start_address) * 2,
-                           (*p_tag)->n_register * 2);
-                    dvalue.value.bytes.length = (*p_tag)->n_register * 2;
-                }
-                break;
-            case MODBUS_AREA_COIL:
-            case MODBUS_AREA_INPUT: {
-                uint16_t offset = (*p_tag)->start_address - start_address;
-                if (n_byte > offset / 8) {
-                    neu_value8_u u8 = { .value = bytes[offset / 8] };
+    // points whose bytes are the same as in the last response keep their
+    // cached values, only their timestamps are refreshed
+    same  = calloc(utarray_len(tags), sizeof(char *));
+    cmp   = cmd->last != NULL && n_byte == cmd->n_last;
+    equal = cmp && memcmp(cmd->last, bytes, n_byte) == 0;
+
+    for (unsigned i = 0; i < utarray_len(tags); i++) {
+        const modbus_decode_t *d      = &cmd->plan[i];
+        neu_dvalue_t           dvalue = { 0 };
+        uint16_t               n_bit  = 0;
+
+        if (d->kernel == MODBUS_DECODE_INVALID || slave_id != cmd->slave_id) {
+            names[n_tag]             = d->name;
+            dvalues[n_tag].type      = NEU_TYPE_ERROR;
+            dvalues[n_tag].value.i32 = NEU_ERR_PLUGIN_READ_FAILURE;
+            n_tag += 1;
+            continue;
+        }
 
-                    dvalue.value.u8 = neu_value8_get_bit(u8, offset % 8);
-                }
-                break;
-            }
+        // the bit points of a register follow the first one, decoded as one
+        n_bit = d->kernel == MODBUS_DECODE_REGISTER_BIT ? d->n_bit : 1;
+        if (equal || (cmp && decode_unchanged(d, cmd->last, bytes, n_byte))) {
+            for (uint16_t k = 0; k < n_bit; k++) {
+                same[n_same++] = d[k].name;
             }
+            i += n_bit - 1;
+            continue;
+        }
+        if (d->kernel == MODBUS_DECODE_REGISTER_BIT) {
+            decode_bits(d, cmp ? cmd->last : NULL, bytes, n_byte, names,
+                        dvalues, &n_tag, same, &n_same);
+            i += n_bit - 1;
+            continue;
+        }
 
-            dvalue.type = (*p_tag)->type;
-            switch ((*p_tag)->type) {
-            case NEU_TYPE_UINT16:
-            case NEU_TYPE_INT16:
-                dvalue.value.u16 = ntohs(dvalue.value.u16);
-                break;
-            case NEU_TYPE_FLOAT:
-            case NEU_TYPE_INT32:
-            case NEU_TYPE_UINT32:
-                dvalue.value.u32 = ntohl(dvalue.value.u32);
-                break;
-            case NEU_TYPE_DOUBLE:
-            case NEU_TYPE_INT64:
-            case NEU_TYPE_UINT64:
-                dvalue.value.u64 = neu_ntohll(dvalue.value.u64);
-                break;
-            case NEU_TYPE_BIT: {
-                switch ((*p_tag)->area) {
-                case MODBUS_AREA_HOLD_REGISTER:
-                case MODBUS_AREA_INPUT_REGISTER: {
-                    neu_value16_u v16 = { 0 };
-                    v16.value = htons(*(uint16_t *) dvalue.value.bytes.bytes);
-                    dvalue.value.u8 =
-                        neu_value16_get_bit(v16, (*p_tag)->option.bit.bit);
-                    break;
-                }
-                case MODBUS_AREA_COIL:
-                case MODBUS_AREA_INPUT:
-                    break;
-                }
-                break;
+        dvalue.type = d->type;
+        if (n_byte >= d->end) {
+            if (d->kernel == MODBUS_DECODE_COIL) {
+                neu_value8_u u8 = { .value = bytes[d->offset / 8] };
+
+                dvalue.value.u8 = neu_value8_get_bit(u8, d->offset % 8);
+            } else {
+                memcpy(dvalue.value.bytes.bytes, bytes + d->offset, d->width);
+                dvalue.value.bytes.length = d->width;
             }
-            case NEU_TYPE_STRING: {
-                switch ((*p_tag)->option.string.type) {
-                case NEU_DATATAG_STRING_TYPE_H:
-                    break;
-                case NEU_DATATAG_STRING_TYPE_L:
-                    neu_datatag_string_ltoh(dvalue.value.str,
-                                            strlen(dvalue.value.str));
-                    break;
-                case NEU_DATATAG_STRING_TYPE_D:
-                    break;
-                case NEU_DATATAG_STRING_TYPE_E:
-                    break;
-                }
+        }
 
-                if (!neu_datatag_string_is_utf8(dvalue.value.str,
-                                                strlen(dvalue.value.str))) {
-                    dvalue.value.str[0] = '?';
-                    dvalue.value.str[1] = 0;
-                }
-                break;
+        switch (d->kernel) {
+        case MODBUS_DECODE_SWAP16:
+            dvalue.value.u16 = ntohs(dvalue.value.u16);
+            break;
+        case MODBUS_DECODE_SWAP32:
+            dvalue.value.u32 = ntohl(dvalue.value.u32);
+            break;
+        case MODBUS_DECODE_SWAP64:
+            dvalue.value.u64 = neu_ntohll(dvalue.value.u64);
+            break;
+        case MODBUS_DECODE_STRING_L:
+        case MODBUS_DECODE_STRING: {
+            int len = strlen(dvalue.value.str);
+
+            if (d->kernel == MODBUS_DECODE_STRING_L) {
+                neu_datatag_string_ltoh(dvalue.value.str, len);
             }
-            default:
-                break;
+            if (!neu_datatag_string_is_utf8(dvalue.value.str, len)) {
+                dvalue.value.str[0] = '?';
+                dvalue.value.str[1] = 0;
             }
+            break;
+        }
+        default:
+            break;
         }
 
-        plugin->common.adapter_callbacks->driver.update(
-            plugin->common.adapter, gd->group, (*p_tag)->name, dvalue);
+        names[n_tag]   = d->name;
+        dvalues[n_tag] = dvalue;
+        n_tag += 1;
+    }
+
+    if (slave_id == cmd->slave_id && n_byte > 0) {
+        if (!equal) {
+            cmd->last   = realloc(cmd->last, n_byte);
+            cmd->n_last = n_byte;
+            memcpy(cmd->last, bytes, n_byte);
+        }
+    } else {
+        forget_last(cmd);
+    }
+
+    if (n_tag > 0) {
+        plugin->common.adapter_callbacks->driver.update_batch(
+            plugin->common.adapter, gd->group, n_tag, names, dvalues);
     }
+    if (n_same > 0) {
+        plugin->common.adapter_callbacks->driver.touch_batch(
+            plugin->common.adapter, gd->group, n_same, same);
+    }
+    free(names);
+    free(same);
+    free(dvalues);
     return 0;
 }
 
+// send the writes for a slave to the client it answered reads on
+static void serve_route(neu_plugin_t *plugin, uint8_t slave_id)
+{
+    if (serve_mode(plugin)) {
+        pthread_mutex_lock(&plugin->server_mtx);
+        if (plugin->slave_fd[slave_id] > 0) {
+            plugin->client_fd = plugin->slave_fd[slave_id];
+        }
+        pthread_mutex_unlock(&plugin->server_mtx);
+    }
+}
+
+// Write holding registers along with the read command the preempted poll
+// goes on with, if the device takes read/write multiple registers and the
+// two overlap or adjoin, so that both cost one round trip. Returns whether
+// the write went out that way, the caller writes on its own otherwise. A
+// device answering with an exception did neither, it is not asked again.
+static bool write_read(neu_plugin_t *plugin, uint8_t slave_id,
+                       modbus_area_e area, uint16_t start_address,
+                       uint16_t n_register, uint8_t *bytes, uint8_t n_byte)
+{
+    struct modbus_group_data *gd            = preempted_gd;
+    modbus_read_cmd_t *       cmd           = NULL;
+    uint16_t                  response_size = 0;
+    uint64_t                  tms           = 0;
+    int                       ret           = 0;
+
+    if (!plugin->write_read || NULL == gd || preempted_read ||
+        serve_mode(plugin) || area != MODBUS_AREA_HOLD_REGISTER ||
+        n_register > MODBUS_WRITE_READ_MAX_WRITE ||
+        n_byte != n_register * 2) {
+        return false;
+    }
+
+    cmd = &gd->cmd_sort->cmd[preempted_cmd];
+    if (cmd->slave_id != slave_id || cmd->area != MODBUS_AREA_HOLD_REGISTER ||
+        cmd->n_register > MODBUS_WRITE_READ_MAX_READ ||
+        start_address > cmd->start_address + cmd->n_register ||
+        cmd->start_address > start_address + n_register) {
+        return false;
+    }
+
+    rtt_apply(plugin, rtt_timeout(plugin, slave_id));
+    plugin->cmd_idx = preempted_cmd;
+    tms             = neu_mono_ms();
+    ret             = modbus_stack_write_read(
+        plugin->stack, slave_id, start_address, n_register, bytes, n_byte,
+        cmd->start_address, cmd->n_register, &response_size);
+    if (ret <= 0) {
+        return false;
+    }
+
+    ret = process_protocol_buf(plugin, slave_id, response_size);
+    if (ret == MODBUS_DEVICE_ERR) {
+        plog_warn(plugin,
+                  "slave %hhu rejects read/write multiple registers, "
+                  "write and read apart",
+                  slave_id);
+        plugin->write_read = false;
+        return false;
+    } else if (ret <= 0) {
+        // the write may or may not have been done, it is written again
+        rtt_miss(plugin, slave_id);
+        return false;
+    }
+
+    rtt_sample(plugin, slave_id, neu_mono_ms() - tms);
+    preempted_read = true;
+    return true;
+}
+
 int modbus_write(neu_plugin_t *plugin, void *req, neu_datatag_t *tag,
                  neu_value_u value, bool response)
 {
@@ -509,9 +1593,20 @@ int modbus_write(neu_plugin_t *plugin, void *req, neu_datatag_t *tag,
     }
 
     uint16_t response_size = 0;
-    ret                    = modbus_stack_write(
-        plugin->stack, req, point.slave_id, point.area, point.start_address,
-        point.n_register, value.bytes.bytes, n_byte, &response_size, response);
+    if (write_read(plugin, point.slave_id, point.area, point.start_address,
+                   point.n_register, value.bytes.bytes, n_byte)) {
+        if (response) {
+            plugin->common.adapter_callbacks->driver.write_response(
+                plugin->common.adapter, req, NEU_ERR_SUCCESS);
+        }
+        return 1;
+    }
+
+    serve_route(plugin, point.slave_id);
+    ret = modbus_stack_write(plugin->stack, req, point.slave_id, point.area,
+                             point.start_address, point.n_register,
+                             value.bytes.bytes, n_byte, &response_size,
+                             response);
     if (ret > 0) {
         process_protocol_buf(plugin, point.slave_id, response_size);
     }
@@ -548,6 +1643,16 @@ int modbus_write_tags(neu_plugin_t *plugin, void *req, UT_array *tags)
     for (uint16_t i = 0; i < gtags->cmd_sort->n_cmd; i++) {
         uint16_t response_size = 0;
 
+        if (write_read(plugin, gtags->cmd_sort->cmd[i].slave_id,
+                       gtags->cmd_sort->cmd[i].area,
+                       gtags->cmd_sort->cmd[i].start_address,
+                       gtags->cmd_sort->cmd[i].n_register,
+                       gtags->cmd_sort->cmd[i].bytes,
+                       gtags->cmd_sort->cmd[i].n_byte)) {
+            continue;
+        }
+
+        serve_route(plugin, gtags->cmd_sort->cmd[i].slave_id);
         ret = modbus_stack_write(
             plugin->stack, req, gtags->cmd_sort->cmd[i].slave_id,
             gtags->cmd_sort->cmd[i].area, gtags->cmd_sort->cmd[i].start_address,
@@ -578,18 +1683,133 @@ int modbus_write_tags(neu_plugin_t *plugin, void *req, UT_array *tags)
             plugin->common.adapter, req, NEU_ERR_PLUGIN_DISCONNECTED);
     }
 
-    for (uint16_t i = 0; i < gtags->cmd_sort->n_cmd; i++) {
-        utarray_free(gtags->cmd_sort->cmd[i].tags);
-        free(gtags->cmd_sort->cmd[i].bytes);
-    }
-    free(gtags->cmd_sort->cmd);
-    free(gtags->cmd_sort);
+    modbus_write_tags_sort_free(gtags->cmd_sort);
     utarray_foreach(gtags->tags, modbus_point_write_t **, tag) { free(*tag); }
     utarray_free(gtags->tags);
     free(gtags);
     return ret;
 }
 
+// a point of a write batch, remembers the request it comes from
+struct modbus_batch_point {
+    modbus_point_write_t point; // must stay first, sorted as a write point
+    int                  write;
+};
+
+static bool batch_overlap(UT_array *points, const modbus_point_t *p)
+{
+    utarray_foreach(points, struct modbus_batch_point **, bp)
+    {
+        const modbus_point_t *q = &(*bp)->point.point;
+
+        if (q->slave_id == p->slave_id && q->area == p->area &&
+            q->start_address < p->start_address + p->n_register &&
+            p->start_address < q->start_address + q->n_register) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// write the points of the requests from..to-1 and answer each of them
+static void batch_flush(neu_plugin_t *plugin, neu_plugin_write_t *writes,
+                        int from, int to, UT_array *points)
+{
+    modbus_write_cmd_sort_t *cs     = NULL;
+    bool *                   failed = NULL;
+
+    if (from == to) {
+        return;
+    }
+
+    failed = calloc(to - from, sizeof(bool));
+    cs     = modbus_write_tags_sort(points);
+    for (uint16_t i = 0; i < cs->n_cmd; i++) {
+        struct modbus_batch_point *first =
+            *(struct modbus_batch_point **) utarray_front(cs->cmd[i].tags);
+        uint16_t response_size = 0;
+        int      ret           = 0;
+
+        if (write_read(plugin, cs->cmd[i].slave_id, cs->cmd[i].area,
+                       cs->cmd[i].start_address, cs->cmd[i].n_register,
+                       cs->cmd[i].bytes, cs->cmd[i].n_byte)) {
+            continue;
+        }
+
+        serve_route(plugin, cs->cmd[i].slave_id);
+        ret = modbus_stack_write(plugin->stack, writes[first->write].req,
+                                 cs->cmd[i].slave_id, cs->cmd[i].area,
+                                 cs->cmd[i].start_address,
+                                 cs->cmd[i].n_register, cs->cmd[i].bytes,
+                                 cs->cmd[i].n_byte, &response_size, false);
+        if (ret > 0) {
+            process_protocol_buf(plugin, cs->cmd[i].slave_id, response_size);
+        } else {
+            utarray_foreach(cs->cmd[i].tags, struct modbus_batch_point **, bp)
+            {
+                failed[(*bp)->write - from] = true;
+            }
+        }
+
+        if (plugin->interval > 0) {
+            struct timespec t1 = { .tv_sec  = plugin->interval / 1000,
+                                   .tv_nsec = 1000 * 1000 *
+                                       (plugin->interval % 1000) };
+            struct timespec t2 = { 0 };
+            nanosleep(&t1, &t2);
+        }
+    }
+
+    plog_notice(plugin, "write batch, requests: %d, frames: %hu", to - from,
+                cs->n_cmd);
+    for (int i = from; i < to; i++) {
+        plugin->common.adapter_callbacks->driver.write_response(
+            plugin->common.adapter, writes[i].req,
+            failed[i - from] ? NEU_ERR_PLUGIN_DISCONNECTED : NEU_ERR_SUCCESS);
+    }
+
+    modbus_write_tags_sort_free(cs);
+    utarray_foreach(points, struct modbus_batch_point **, bp) { free(*bp); }
+    utarray_clear(points);
+    free(failed);
+}
+
+int modbus_write_batch(neu_plugin_t *plugin, int n, neu_plugin_write_t *writes)
+{
+    UT_array *points = NULL;
+    int       from   = 0;
+
+    utarray_new(points, &ut_ptr_icd);
+    for (int i = 0; i < n; i++) {
+        // a request that writes an address already in the batch starts a new
+        // one, the writes of an address must reach the device in order
+        for (int j = 0; j < writes[i].n_tag; j++) {
+            modbus_point_t point = { 0 };
+
+            modbus_tag_to_point(writes[i].tags[j].tag, &point);
+            if (batch_overlap(points, &point)) {
+                batch_flush(plugin, writes, from, i, points);
+                from = i;
+                break;
+            }
+        }
+
+        for (int j = 0; j < writes[i].n_tag; j++) {
+            struct modbus_batch_point *bp =
+                calloc(1, sizeof(struct modbus_batch_point));
+            int ret = modbus_write_tag_to_point(&writes[i].tags[j], &bp->point);
+            assert(ret == 0);
+
+            bp->write = i;
+            utarray_push_back(points, &bp);
+        }
+    }
+
+    batch_flush(plugin, writes, from, n, points);
+    utarray_free(points);
+    return 0;
+}
+
 int modbus_write_resp(void *ctx, void *req, int error)
 {
     neu_plugin_t *plugin = (neu_plugin_t *) ctx;
@@ -616,6 +1836,11 @@ static void plugin_group_free(neu_plugin_group_t *pgp)
 static int process_protocol_buf(neu_plugin_t *plugin, uint8_t slave_id,
                                 uint16_t response_size)
 {
+    if (serve_mode(plugin)) {
+        // the event loop owns the receive side of the clients
+        return 1;
+    }
+
     uint8_t *                 recv_buf = calloc(response_size, 1);
     neu_protocol_unpack_buf_t pbuf     = { 0 };
     ssize_t                   ret      = 0;
@@ -713,4 +1938,4 @@ static int process_protocol_buf(neu_plugin_t *plugin, uint8_t slave_id,
     }
     free(recv_buf);
     return ret;
-}
\ No newline at end of file
+}
@@ -19,14 +19,21 @@
 #ifndef _NEU_M_PLUGIN_MODBUS_REQ_H_
 #define _NEU_M_PLUGIN_MODBUS_REQ_H_
 
+#include <pthread.h>
+
 #include <neuron.h>
 
+#include "modbus_rtt.h"
 #include "modbus_stack.h"
 
+struct modbus_client;
+struct modbus_serve;
+
 struct neu_plugin {
     neu_plugin_common_t common;
 
     neu_conn_t *    conn;
+    bool            conn_share; // conn is shared with the nodes of the endpoint
     modbus_stack_t *stack;
 
     void *   plugin_group_data;
@@ -43,17 +50,53 @@ struct neu_plugin {
     uint16_t interval;
     uint16_t retry_interval;
     uint16_t max_retries;
+    uint16_t max_inflight;
+    uint16_t max_gap;
+    bool     write_read; // read/write multiple registers, see write_read
+
+    // slaves that stopped responding are skipped until offline_until
+    uint8_t  breaker_threshold;
+    uint32_t max_backoff;
+    uint8_t  n_fail[256];
+    int64_t  offline_until[256];
+
+    // tcp server mode with more than one link, every client is read by the
+    // event loop on its own and the groups are polled on all of them at once
+    uint16_t              max_link;
+    struct modbus_client *clients;
+    struct modbus_serve * serve; // the reads waiting for their responses
+    pthread_mutex_t       server_mtx;
+    pthread_cond_t        server_cond;
+    int                   slave_fd[256]; // the client a slave answered on
+
+    // with min_timeout set, the receive timeout of a slave follows its
+    // measured response times within [min_timeout, timeout]
+    uint16_t     timeout;
+    uint16_t     min_timeout;
+    uint16_t     cur_timeout; // the timeout currently set on the connection
+    modbus_rtt_t link_rtt;
+    modbus_rtt_t slave_rtt[256];
 };
 
 void modbus_conn_connected(void *data, int fd);
 void modbus_conn_disconnected(void *data, int fd);
+void modbus_conn_acquire(neu_plugin_t *plugin, neu_conn_prio_e prio,
+                         int64_t deadline);
+void modbus_conn_release(neu_plugin_t *plugin);
 void modbus_tcp_server_listen(void *data, int fd);
 void modbus_tcp_server_stop(void *data, int fd);
 int  modbus_tcp_server_io_callback(enum neu_event_io_type type, int fd,
                                    void *usr_data);
+int  modbus_tcp_client_io_callback(enum neu_event_io_type type, int fd,
+                                   void *usr_data);
 
 int modbus_group_timer(neu_plugin_t *plugin, neu_plugin_group_t *group,
                        uint16_t max_byte);
+// replace the points of the changed tags and replan the read commands they
+// touch, -1 when a new plan is due instead
+int modbus_group_update(neu_plugin_t *plugin, neu_plugin_group_t *group,
+                        const neu_plugin_group_delta_t *delta,
+                        uint16_t                        max_byte);
 int modbus_send_msg(void *ctx, uint16_t n_byte, uint8_t *bytes);
 int modbus_value_handle(void *ctx, uint8_t slave_id, uint16_t n_byte,
                         uint8_t *bytes, int error);
@@ -62,6 +105,7 @@ int modbus_write(neu_plugin_t *plugin, void *req, neu_datatag_t *tag,
 int modbus_write_tag(neu_plugin_t *plugin, void *req, neu_datatag_t *tag,
                      neu_value_u value);
 int modbus_write_tags(neu_plugin_t *plugin, void *req, UT_array *tags);
+int modbus_write_batch(neu_plugin_t *plugin, int n, neu_plugin_write_t *writes);
 int modbus_write_resp(void *ctx, void *req, int error);
 
 #endif
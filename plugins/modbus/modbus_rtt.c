@@ -0,0 +1,131 @@
+/**
+ * NEURON IIoT System for Industry 4.0
+ * Copyright (C) 2020-2023 EMQ Technologies Co., Ltd All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ **/
+#include "modbus_rtt.h"
+
+// the histogram counts are halved once this many samples have been added, so
+// old samples fade out and the percentile follows the device
+#define MODBUS_RTT_WINDOW 1024
+
+static uint16_t bucket_of(uint32_t ms)
+{
+    if (ms > UINT16_MAX) {
+        ms = UINT16_MAX;
+    }
+    if (ms < 8) {
+        return ms;
+    }
+
+    uint32_t e = 31 - __builtin_clz(ms);
+    return 8 + (e - 3) * 4 + ((ms >> (e - 2)) & 3);
+}
+
+static uint32_t bucket_upper(uint16_t idx)
+{
+    if (idx < 8) {
+        return idx + 1;
+    }
+
+    uint32_t e = (idx - 8) / 4 + 3;
+    return (4 + (idx - 8) % 4 + 1) << (e - 2);
+}
+
+// RFC 6298 smoothing, srtt gains 1/8 and rttvar 1/4 of every difference
+void modbus_rtt_sample(modbus_rtt_t *rtt, uint32_t ms)
+{
+    if (ms > UINT16_MAX) {
+        ms = UINT16_MAX;
+    }
+
+    if (rtt->n == 0 && rtt->srtt == 0) {
+        rtt->srtt   = ms << 3;
+        rtt->rttvar = ms << 1;
+    } else {
+        int32_t m = (int32_t) ms - (int32_t)(rtt->srtt >> 3);
+
+        rtt->srtt += m;
+        if (m < 0) {
+            m = -m;
+        }
+        m -= rtt->rttvar >> 2;
+        rtt->rttvar += m;
+    }
+
+    if (rtt->n >= MODBUS_RTT_WINDOW) {
+        rtt->n = 0;
+        for (int i = 0; i < MODBUS_RTT_BUCKETS; i++) {
+            rtt->bucket[i] /= 2;
+            rtt->n += rtt->bucket[i];
+        }
+    }
+    rtt->bucket[bucket_of(ms)] += 1;
+    rtt->n += 1;
+    rtt->miss = 0;
+}
+
+void modbus_rtt_miss(modbus_rtt_t *rtt)
+{
+    if (rtt->miss < UINT8_MAX) {
+        rtt->miss += 1;
+    }
+}
+
+uint32_t modbus_rtt_p99(const modbus_rtt_t *rtt)
+{
+    uint32_t target = ((uint32_t) rtt->n * 99 + 99) / 100;
+    uint32_t sum    = 0;
+
+    if (rtt->n == 0) {
+        return 0;
+    }
+
+    for (uint16_t i = 0; i < MODBUS_RTT_BUCKETS; i++) {
+        sum += rtt->bucket[i];
+        if (sum >= target) {
+            return bucket_upper(i);
+        }
+    }
+    return bucket_upper(MODBUS_RTT_BUCKETS - 1);
+}
+
+uint16_t modbus_rtt_timeout(const modbus_rtt_t *rtt, uint16_t min,
+                            uint16_t max)
+{
+    uint32_t timeout = 0;
+
+    if (rtt->n < MODBUS_RTT_MIN_SAMPLES) {
+        return max;
+    }
+
+    timeout = (rtt->srtt >> 3) + rtt->rttvar;
+    if (timeout < modbus_rtt_p99(rtt)) {
+        timeout = modbus_rtt_p99(rtt);
+    }
+    timeout *= 2;
+    for (uint8_t i = 0; i < rtt->miss && timeout < max; i++) {
+        timeout *= 2;
+    }
+
+    if (timeout < min) {
+        timeout = min;
+    }
+    if (timeout > max) {
+        timeout = max;
+    }
+    return timeout;
+}
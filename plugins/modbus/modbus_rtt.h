@@ -0,0 +1,62 @@
+/**
+ * NEURON IIoT System for Industry 4.0
+ * Copyright (C) 2020-2023 EMQ Technologies Co., Ltd All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ **/
+#ifndef _NEU_PLUGIN_MODBUS_RTT_H_
+#define _NEU_PLUGIN_MODBUS_RTT_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+// 8 one millisecond buckets, then 4 buckets per power of two up to 65535 ms
+#define MODBUS_RTT_BUCKETS 60
+// the estimate is not used before this many samples
+#define MODBUS_RTT_MIN_SAMPLES 16
+
+// response time statistics of one slave or one connection
+typedef struct modbus_rtt {
+    uint32_t srtt;   // smoothed rtt, ms * 8
+    uint32_t rttvar; // smoothed mean deviation, ms * 4
+    uint16_t n;      // samples in the histogram
+    uint16_t bucket[MODBUS_RTT_BUCKETS];
+    uint8_t  miss; // timeouts since the last response
+} modbus_rtt_t;
+
+void modbus_rtt_sample(modbus_rtt_t *rtt, uint32_t ms);
+void modbus_rtt_miss(modbus_rtt_t *rtt);
+
+// upper bound of the histogram bucket holding the 99th percentile
+uint32_t modbus_rtt_p99(const modbus_rtt_t *rtt);
+
+/**
+ * @brief Derive a receive timeout from the statistics.
+ *
+ * Twice the larger one of p99 and srtt + 4 * rttvar, doubled once more per
+ * timeout since the last response, bounded to [min, max]. Returns max until
+ * MODBUS_RTT_MIN_SAMPLES responses have been seen.
+ */
+uint16_t modbus_rtt_timeout(const modbus_rtt_t *rtt, uint16_t min,
+                            uint16_t max);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
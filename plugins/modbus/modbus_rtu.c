@@ -39,10 +39,16 @@ static int driver_request(neu_plugin_t *plugin, neu_reqresp_head_t *head,
 
 static int driver_tag_validator(const neu_datatag_t *tag);
 static int driver_validate_tag(neu_plugin_t *plugin, neu_datatag_t *tag);
+static int driver_validate_tags(neu_plugin_t *plugin, neu_datatag_t **tags,
+                                int n, int *errors);
 static int driver_group_timer(neu_plugin_t *plugin, neu_plugin_group_t *group);
+static int driver_group_update(neu_plugin_t *plugin, neu_plugin_group_t *group,
+                               const neu_plugin_group_delta_t *delta);
 static int driver_write(neu_plugin_t *plugin, void *req, neu_datatag_t *tag,
                         neu_value_u value);
 static int driver_write_tags(neu_plugin_t *plugin, void *req, UT_array *tags);
+static int driver_write_batch(neu_plugin_t *plugin, int n,
+                              neu_plugin_write_t *writes);
 
 static const neu_plugin_intf_funs_t plugin_intf_funs = {
     .open    = driver_open,
@@ -55,10 +61,13 @@ static const neu_plugin_intf_funs_t plugin_intf_funs = {
     .request = driver_request,
 
     .driver.validate_tag  = driver_validate_tag,
+    .driver.validate_tags = driver_validate_tags,
     .driver.group_timer   = driver_group_timer,
+    .driver.group_update  = driver_group_update,
     .driver.write_tag     = driver_write,
     .driver.tag_validator = driver_tag_validator,
     .driver.write_tags    = driver_write_tags,
+    .driver.write_batch   = driver_write_batch,
     .driver.add_tags      = NULL,
     .driver.load_tags     = NULL,
     .driver.del_tags      = NULL,
@@ -115,7 +124,11 @@ static int driver_uninit(neu_plugin_t *plugin)
 {
     plog_notice(plugin, "%s uninit start", plugin->common.name);
     if (plugin->conn != NULL) {
-        neu_conn_destory(plugin->conn);
+        if (plugin->conn_share) {
+            neu_conn_unshare(plugin->conn, plugin);
+        } else {
+            neu_conn_destory(plugin->conn);
+        }
     }
 
     if (plugin->stack) {
@@ -166,6 +179,17 @@ static int driver_config(neu_plugin_t *plugin, const char *config)
     neu_json_elem_t max_retries = { .name = "max_retries", .t = NEU_JSON_INT };
     neu_json_elem_t retry_interval = { .name = "retry_interval",
                                        .t    = NEU_JSON_INT };
+    neu_json_elem_t max_gap        = { .name = "max_gap", .t = NEU_JSON_INT };
+    neu_json_elem_t max_backoff    = { .name = "max_backoff",
+                                       .t    = NEU_JSON_INT };
+    neu_json_elem_t breaker        = { .name = "breaker_threshold",
+                                       .t    = NEU_JSON_INT };
+    neu_json_elem_t min_timeout    = { .name = "min_timeout",
+                                       .t    = NEU_JSON_INT };
+    neu_json_elem_t share          = { .name = "connection_share",
+                                       .t    = NEU_JSON_BOOL };
+    neu_json_elem_t write_read     = { .name = "read_write_multiple",
+                                       .t    = NEU_JSON_BOOL };
 
     ret = neu_parse_param((char *) config, &err_param, 3, &link, &timeout,
                           &interval);
@@ -206,9 +230,72 @@ static int driver_config(neu_plugin_t *plugin, const char *config)
         retry_interval.v.val_int = 0;
     }
 
-    param.log              = plugin->common.log;
-    plugin->max_retries    = max_retries.v.val_int;
-    plugin->retry_interval = retry_interval.v.val_int;
+    ret = neu_parse_param((char *) config, &err_param, 1, &max_gap);
+    if (ret != 0) {
+        free(err_param);
+        max_gap.v.val_int = 0;
+    }
+    if (max_gap.v.val_int < 0 || max_gap.v.val_int > 120) {
+        plog_warn(plugin, "invalid max_gap: %" PRId64 ", use 0",
+                  max_gap.v.val_int);
+        max_gap.v.val_int = 0;
+    }
+
+    ret = neu_parse_param((char *) config, &err_param, 1, &max_backoff);
+    if (ret != 0) {
+        free(err_param);
+        max_backoff.v.val_int = 0;
+    }
+    if (max_backoff.v.val_int < 0 || max_backoff.v.val_int > 3600000) {
+        plog_warn(plugin, "invalid max_backoff: %" PRId64 ", use 0",
+                  max_backoff.v.val_int);
+        max_backoff.v.val_int = 0;
+    }
+
+    ret = neu_parse_param((char *) config, &err_param, 1, &breaker);
+    if (ret != 0) {
+        free(err_param);
+        breaker.v.val_int = 1;
+    }
+    if (breaker.v.val_int < 1 || breaker.v.val_int > 10) {
+        plog_warn(plugin, "invalid breaker_threshold: %" PRId64 ", use 1",
+                  breaker.v.val_int);
+        breaker.v.val_int = 1;
+    }
+
+    ret = neu_parse_param((char *) config, &err_param, 1, &min_timeout);
+    if (ret != 0) {
+        free(err_param);
+        min_timeout.v.val_int = 0;
+    }
+    if (min_timeout.v.val_int < 0 ||
+        min_timeout.v.val_int > timeout.v.val_int) {
+        plog_warn(plugin, "invalid min_timeout: %" PRId64 ", use 0",
+                  min_timeout.v.val_int);
+        min_timeout.v.val_int = 0;
+    }
+
+    ret = neu_parse_param((char *) config, &err_param, 1, &share);
+    if (ret != 0) {
+        free(err_param);
+        share.v.val_bool = false;
+    }
+
+    ret = neu_parse_param((char *) config, &err_param, 1, &write_read);
+    if (ret != 0) {
+        free(err_param);
+        write_read.v.val_bool = false;
+    }
+
+    param.log                 = plugin->common.log;
+    plugin->max_retries       = max_retries.v.val_int;
+    plugin->retry_interval    = retry_interval.v.val_int;
+    plugin->max_gap           = max_gap.v.val_int;
+    plugin->max_backoff       = max_backoff.v.val_int;
+    plugin->breaker_threshold = breaker.v.val_int;
+    plugin->timeout           = timeout.v.val_int;
+    plugin->min_timeout       = min_timeout.v.val_int;
+    plugin->write_read        = write_read.v.val_bool;
 
     if (link.v.val_int == 0) {
         param.type = NEU_CONN_TTY_CLIENT;
@@ -250,8 +337,24 @@ static int driver_config(neu_plugin_t *plugin, const char *config)
                     host.v.val_str, port.v.val_int, mode.v.val_int);
     }
 
+    // a shared connection is left for the one of the new endpoint
+    if (plugin->conn != NULL && (plugin->conn_share || share.v.val_bool)) {
+        if (plugin->conn_share) {
+            neu_conn_unshare(plugin->conn, plugin);
+        } else {
+            neu_conn_destory(plugin->conn);
+        }
+        plugin->conn = NULL;
+    }
+    plugin->conn_share = share.v.val_bool && !plugin->is_server;
+
     if (plugin->conn != NULL) {
         plugin->conn = neu_conn_reconfig(plugin->conn, &param);
+    } else if (plugin->conn_share) {
+        plugin->common.link_state = NEU_NODE_LINK_STATE_DISCONNECTED;
+        plugin->conn =
+            neu_conn_share(&param, (void *) plugin, modbus_conn_connected,
+                           modbus_conn_disconnected);
     } else {
         plugin->common.link_state = NEU_NODE_LINK_STATE_DISCONNECTED;
         plugin->conn =
@@ -287,7 +390,7 @@ static int driver_validate_tag(neu_plugin_t *plugin, neu_datatag_t *tag)
 {
     modbus_point_t point = { 0 };
 
-    int ret = modbus_tag_to_point(tag, &point);
+    int ret = modbus_tag_compile(tag, &point);
     if (ret == 0) {
         plog_notice(plugin,
                     "validate tag success, name: %s, address: %s, type: %d, "
@@ -309,18 +412,68 @@ static int driver_validate_tag(neu_plugin_t *plugin, neu_datatag_t *tag)
     return ret;
 }
 
+// logs the invalid tags only, the valid ones are counted
+static int driver_validate_tags(neu_plugin_t *plugin, neu_datatag_t **tags,
+                                int n, int *errors)
+{
+    int invalid = 0;
+
+    for (int i = 0; i < n; ++i) {
+        modbus_point_t point = { 0 };
+
+        errors[i] = modbus_tag_compile(tags[i], &point);
+        if (errors[i] != 0) {
+            invalid += 1;
+            plog_error(plugin,
+                       "validate tag error, name: %s, address: %s, type: %d, "
+                       "error: %d",
+                       tags[i]->name, tags[i]->address, tags[i]->type,
+                       errors[i]);
+        }
+    }
+
+    plog_notice(plugin, "validate %d tags, %d invalid", n, invalid);
+    return invalid;
+}
+
 static int driver_group_timer(neu_plugin_t *plugin, neu_plugin_group_t *group)
 {
-    return modbus_group_timer(plugin, group, 0xfa);
+    // reads are due before the next tick of their group
+    modbus_conn_acquire(plugin, NEU_CONN_PRIO_NORMAL,
+                        neu_time_ms() + group->interval);
+    int ret = modbus_group_timer(plugin, group, 0xfa);
+    modbus_conn_release(plugin);
+    return ret;
+}
+
+static int driver_group_update(neu_plugin_t *plugin, neu_plugin_group_t *group,
+                               const neu_plugin_group_delta_t *delta)
+{
+    return modbus_group_update(plugin, group, delta, 0xfa);
 }
 
 static int driver_write(neu_plugin_t *plugin, void *req, neu_datatag_t *tag,
                         neu_value_u value)
 {
-    return modbus_write_tag(plugin, req, tag, value);
+    modbus_conn_acquire(plugin, NEU_CONN_PRIO_HIGH, neu_time_ms());
+    int ret = modbus_write_tag(plugin, req, tag, value);
+    modbus_conn_release(plugin);
+    return ret;
 }
 
 static int driver_write_tags(neu_plugin_t *plugin, void *req, UT_array *tags)
 {
-    return modbus_write_tags(plugin, req, tags);
-}
\ No newline at end of file
+    modbus_conn_acquire(plugin, NEU_CONN_PRIO_HIGH, neu_time_ms());
+    int ret = modbus_write_tags(plugin, req, tags);
+    modbus_conn_release(plugin);
+    return ret;
+}
+
+static int driver_write_batch(neu_plugin_t *plugin, int n,
+                              neu_plugin_write_t *writes)
+{
+    modbus_conn_acquire(plugin, NEU_CONN_PRIO_HIGH, neu_time_ms());
+    int ret = modbus_write_batch(plugin, n, writes);
+    modbus_conn_release(plugin);
+    return ret;
+}
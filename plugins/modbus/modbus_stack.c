@@ -50,7 +50,8 @@ modbus_stack_t *modbus_stack_create(void *ctx, modbus_protocol_e protocol,
     stack->write_resp = write_resp;
     stack->protocol   = protocol;
 
-    stack->buf_size = 256;
+    // the largest modbus tcp frame, a full read/write multiple registers
+    stack->buf_size = 260;
     stack->buf      = calloc(stack->buf_size, 1);
 
     return stack;
@@ -94,7 +95,8 @@ int modbus_stack_recv(modbus_stack_t *stack, uint8_t slave_id,
     case MODBUS_READ_COIL:
     case MODBUS_READ_INPUT:
     case MODBUS_READ_HOLD_REG:
-    case MODBUS_READ_INPUT_REG: {
+    case MODBUS_READ_INPUT_REG:
+    case MODBUS_READ_WRITE_M_REG: {
         struct modbus_data data  = { 0 };
         uint8_t *          bytes = NULL;
         ret                      = modbus_data_unwrap(buf, &data);
@@ -144,6 +146,8 @@ int modbus_stack_recv(modbus_stack_t *stack, uint8_t slave_id,
         return MODBUS_DEVICE_ERR;
     case MODBUS_WRITE_M_COIL_ERR:
         return MODBUS_DEVICE_ERR;
+    case MODBUS_READ_WRITE_M_REG_ERR:
+        return MODBUS_DEVICE_ERR;
     case MODBUS_WRITE_S_HOLD_REG:
         break;
     default:
@@ -298,7 +302,64 @@ int modbus_stack_write(modbus_stack_t *stack, void *req, uint8_t slave_id,
     return ret;
 }
 
+int modbus_stack_write_read(modbus_stack_t *stack, uint8_t slave_id,
+                            uint16_t write_address, uint16_t n_write,
+                            uint8_t *bytes, uint8_t n_byte,
+                            uint16_t read_address, uint16_t n_read,
+                            uint16_t *response_size)
+{
+    static __thread neu_protocol_pack_buf_t pbuf = { 0 };
+
+    *response_size = 0;
+    if (n_write == 0 || n_write > MODBUS_WRITE_READ_MAX_WRITE ||
+        n_byte != n_write * 2 || n_read == 0 ||
+        n_read > MODBUS_WRITE_READ_MAX_READ) {
+        return -1;
+    }
+
+    memset(stack->buf, 0, stack->buf_size);
+    neu_protocol_pack_buf_init(&pbuf, stack->buf, stack->buf_size);
+
+    if (stack->protocol == MODBUS_PROTOCOL_RTU) {
+        modbus_crc_wrap(&pbuf);
+    }
+    // the write is carried out before the read by the device
+    modbus_data_wrap(&pbuf, n_byte, bytes, MODBUS_ACTION_DEFAULT);
+    modbus_address_wrap(&pbuf, write_address, n_write, MODBUS_ACTION_DEFAULT);
+    modbus_address_wrap(&pbuf, read_address, n_read, MODBUS_ACTION_DEFAULT);
+    modbus_code_wrap(&pbuf, slave_id, MODBUS_READ_WRITE_M_REG);
+
+    *response_size += n_read * 2;
+    *response_size += sizeof(struct modbus_code);
+    *response_size += sizeof(struct modbus_data);
+
+    switch (stack->protocol) {
+    case MODBUS_PROTOCOL_TCP:
+        modbus_header_wrap(&pbuf, stack->read_seq++);
+        *response_size += sizeof(struct modbus_header);
+        break;
+    case MODBUS_PROTOCOL_RTU:
+        modbus_crc_set(&pbuf);
+        *response_size += 2;
+        break;
+    }
+
+    int ret = stack->send_fn(stack->ctx, neu_protocol_pack_buf_used_size(&pbuf),
+                             neu_protocol_pack_buf_get(&pbuf));
+    if (ret <= 0) {
+        plog_warn((neu_plugin_t *) stack->ctx,
+                  "send write read req fail, %hhu!%hu", slave_id,
+                  write_address);
+    }
+    return ret;
+}
+
 bool modbus_stack_is_rtu(modbus_stack_t *stack)
 {
     return stack->protocol == MODBUS_PROTOCOL_RTU;
-}
\ No newline at end of file
+}
+
+uint16_t modbus_stack_read_seq(modbus_stack_t *stack)
+{
+    return stack->read_seq;
+}
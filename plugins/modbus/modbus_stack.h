@@ -27,6 +27,10 @@
 
 typedef struct modbus_stack modbus_stack_t;
 
+// the most registers one read/write multiple registers request may carry
+#define MODBUS_WRITE_READ_MAX_WRITE 121
+#define MODBUS_WRITE_READ_MAX_READ 125
+
 typedef int (*modbus_stack_send)(void *ctx, uint16_t n_byte, uint8_t *bytes);
 typedef int (*modbus_stack_value)(void *ctx, uint8_t slave_id, uint16_t n_byte,
                                   uint8_t *bytes, int error);
@@ -53,6 +57,15 @@ int  modbus_stack_write(modbus_stack_t *stack, void *req, uint8_t slave_id,
                         enum modbus_area area, uint16_t start_address,
                         uint16_t n_reg, uint8_t *bytes, uint8_t n_byte,
                         uint16_t *response_size, bool response);
+// read/write multiple registers, the response is handed to value_fn as the
+// one of a read of n_read holding registers at read_address
+int  modbus_stack_write_read(modbus_stack_t *stack, uint8_t slave_id,
+                             uint16_t write_address, uint16_t n_write,
+                             uint8_t *bytes, uint8_t n_byte,
+                             uint16_t read_address, uint16_t n_read,
+                             uint16_t *response_size);
 bool modbus_stack_is_rtu(modbus_stack_t *stack);
+// transaction id the next modbus tcp read request will carry
+uint16_t modbus_stack_read_seq(modbus_stack_t *stack);
 
 #endif
\ No newline at end of file
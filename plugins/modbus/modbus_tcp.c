@@ -39,10 +39,16 @@ static int driver_request(neu_plugin_t *plugin, neu_reqresp_head_t *head,
 
 static int driver_tag_validator(const neu_datatag_t *tag);
 static int driver_validate_tag(neu_plugin_t *plugin, neu_datatag_t *tag);
+static int driver_validate_tags(neu_plugin_t *plugin, neu_datatag_t **tags,
+                                int n, int *errors);
 static int driver_group_timer(neu_plugin_t *plugin, neu_plugin_group_t *group);
+static int driver_group_update(neu_plugin_t *plugin, neu_plugin_group_t *group,
+                               const neu_plugin_group_delta_t *delta);
 static int driver_write(neu_plugin_t *plugin, void *req, neu_datatag_t *tag,
                         neu_value_u value);
 static int driver_write_tags(neu_plugin_t *plugin, void *req, UT_array *tags);
+static int driver_write_batch(neu_plugin_t *plugin, int n,
+                              neu_plugin_write_t *writes);
 
 static const neu_plugin_intf_funs_t plugin_intf_funs = {
     .open    = driver_open,
@@ -55,10 +61,13 @@ static const neu_plugin_intf_funs_t plugin_intf_funs = {
     .request = driver_request,
 
     .driver.validate_tag  = driver_validate_tag,
+    .driver.validate_tags = driver_validate_tags,
     .driver.group_timer   = driver_group_timer,
+    .driver.group_update  = driver_group_update,
     .driver.write_tag     = driver_write,
     .driver.tag_validator = driver_tag_validator,
     .driver.write_tags    = driver_write_tags,
+    .driver.write_batch   = driver_write_batch,
     .driver.add_tags      = NULL,
     .driver.load_tags     = NULL,
     .driver.del_tags      = NULL,
@@ -103,6 +112,8 @@ static int driver_init(neu_plugin_t *plugin, bool load)
     (void) load;
     plugin->protocol = MODBUS_PROTOCOL_TCP;
     plugin->events   = neu_event_new();
+    pthread_mutex_init(&plugin->server_mtx, NULL);
+    pthread_cond_init(&plugin->server_cond, NULL);
     plugin->stack    = modbus_stack_create((void *) plugin, MODBUS_PROTOCOL_TCP,
                                         modbus_send_msg, modbus_value_handle,
                                         modbus_write_resp);
@@ -115,7 +126,11 @@ static int driver_uninit(neu_plugin_t *plugin)
 {
     plog_notice(plugin, "%s uninit start", plugin->common.name);
     if (plugin->conn != NULL) {
-        neu_conn_destory(plugin->conn);
+        if (plugin->conn_share) {
+            neu_conn_unshare(plugin->conn, plugin);
+        } else {
+            neu_conn_destory(plugin->conn);
+        }
     }
 
     if (plugin->stack) {
@@ -123,6 +138,8 @@ static int driver_uninit(neu_plugin_t *plugin)
     }
 
     neu_event_close(plugin->events);
+    pthread_cond_destroy(&plugin->server_cond);
+    pthread_mutex_destroy(&plugin->server_mtx);
 
     plog_notice(plugin, "%s uninit success", plugin->common.name);
 
@@ -143,6 +160,52 @@ static int driver_stop(neu_plugin_t *plugin)
     return 0;
 }
 
+static int64_t optional_int(neu_plugin_t *plugin, const char *config,
+                            char *name, int64_t min, int64_t max)
+{
+    char *          err_param = NULL;
+    neu_json_elem_t elem      = { .name = name, .t = NEU_JSON_INT };
+
+    if (neu_parse_param((char *) config, &err_param, 1, &elem) != 0) {
+        free(err_param);
+        return 0;
+    }
+
+    if (elem.v.val_int < min || elem.v.val_int > max) {
+        plog_warn(plugin, "invalid %s: %" PRId64 ", use 0", name,
+                  elem.v.val_int);
+        return 0;
+    }
+
+    return elem.v.val_int;
+}
+
+static void tcp_opt_config(neu_plugin_t *plugin, const char *config,
+                           neu_conn_tcp_opt_t *opt)
+{
+    char *          err_param = NULL;
+    neu_json_elem_t nodelay   = { .name = "tcp_nodelay", .t = NEU_JSON_BOOL };
+
+    if (neu_parse_param((char *) config, &err_param, 1, &nodelay) != 0) {
+        free(err_param);
+        nodelay.v.val_bool = false;
+    }
+
+    opt->nodelay = nodelay.v.val_bool;
+    opt->keepalive_idle =
+        optional_int(plugin, config, "keepalive_idle", 0, 7200);
+    opt->keepalive_interval =
+        optional_int(plugin, config, "keepalive_interval", 0, 600);
+    opt->keepalive_count =
+        optional_int(plugin, config, "keepalive_count", 0, 100);
+    opt->user_timeout =
+        optional_int(plugin, config, "tcp_user_timeout", 0, 600000);
+    opt->recv_buf =
+        optional_int(plugin, config, "recv_buffer_size", 0, 16 * 1024 * 1024);
+    opt->send_buf =
+        optional_int(plugin, config, "send_buffer_size", 0, 16 * 1024 * 1024);
+}
+
 static int driver_config(neu_plugin_t *plugin, const char *config)
 {
     int              ret       = 0;
@@ -158,6 +221,20 @@ static int driver_config(neu_plugin_t *plugin, const char *config)
     neu_json_elem_t  max_retries = { .name = "max_retries", .t = NEU_JSON_INT };
     neu_json_elem_t  retry_interval = { .name = "retry_interval",
                                        .t    = NEU_JSON_INT };
+    neu_json_elem_t  max_gap        = { .name = "max_gap", .t = NEU_JSON_INT };
+    neu_json_elem_t  max_backoff    = { .name = "max_backoff",
+                                        .t    = NEU_JSON_INT };
+    neu_json_elem_t  breaker        = { .name = "breaker_threshold",
+                                        .t    = NEU_JSON_INT };
+    neu_json_elem_t  max_inflight   = { .name = "max_inflight",
+                                        .t    = NEU_JSON_INT };
+    neu_json_elem_t  max_link       = { .name = "max_link", .t = NEU_JSON_INT };
+    neu_json_elem_t  min_timeout    = { .name = "min_timeout",
+                                        .t    = NEU_JSON_INT };
+    neu_json_elem_t  share          = { .name = "connection_share",
+                                        .t    = NEU_JSON_BOOL };
+    neu_json_elem_t  write_read     = { .name = "read_write_multiple",
+                                        .t    = NEU_JSON_BOOL };
 
     ret = neu_parse_param((char *) config, &err_param, 5, &port, &host, &mode,
                           &timeout, &interval);
@@ -186,10 +263,99 @@ static int driver_config(neu_plugin_t *plugin, const char *config)
         retry_interval.v.val_int = 0;
     }
 
-    param.log              = plugin->common.log;
-    plugin->interval       = interval.v.val_int;
-    plugin->max_retries    = max_retries.v.val_int;
-    plugin->retry_interval = retry_interval.v.val_int;
+    ret = neu_parse_param((char *) config, &err_param, 1, &max_gap);
+    if (ret != 0) {
+        free(err_param);
+        max_gap.v.val_int = 0;
+    }
+    if (max_gap.v.val_int < 0 || max_gap.v.val_int > 120) {
+        plog_warn(plugin, "invalid max_gap: %" PRId64 ", use 0",
+                  max_gap.v.val_int);
+        max_gap.v.val_int = 0;
+    }
+
+    ret = neu_parse_param((char *) config, &err_param, 1, &max_backoff);
+    if (ret != 0) {
+        free(err_param);
+        max_backoff.v.val_int = 0;
+    }
+    if (max_backoff.v.val_int < 0 || max_backoff.v.val_int > 3600000) {
+        plog_warn(plugin, "invalid max_backoff: %" PRId64 ", use 0",
+                  max_backoff.v.val_int);
+        max_backoff.v.val_int = 0;
+    }
+
+    ret = neu_parse_param((char *) config, &err_param, 1, &breaker);
+    if (ret != 0) {
+        free(err_param);
+        breaker.v.val_int = 1;
+    }
+    if (breaker.v.val_int < 1 || breaker.v.val_int > 10) {
+        plog_warn(plugin, "invalid breaker_threshold: %" PRId64 ", use 1",
+                  breaker.v.val_int);
+        breaker.v.val_int = 1;
+    }
+
+    ret = neu_parse_param((char *) config, &err_param, 1, &max_inflight);
+    if (ret != 0) {
+        free(err_param);
+        max_inflight.v.val_int = 1;
+    }
+    if (max_inflight.v.val_int < 1 || max_inflight.v.val_int > 16) {
+        plog_warn(plugin, "invalid max_inflight: %" PRId64 ", use 1",
+                  max_inflight.v.val_int);
+        max_inflight.v.val_int = 1;
+    }
+
+    ret = neu_parse_param((char *) config, &err_param, 1, &max_link);
+    if (ret != 0) {
+        free(err_param);
+        max_link.v.val_int = 1;
+    }
+    if (max_link.v.val_int < 1 || max_link.v.val_int > 1024) {
+        plog_warn(plugin, "invalid max_link: %" PRId64 ", use 1",
+                  max_link.v.val_int);
+        max_link.v.val_int = 1;
+    }
+
+    ret = neu_parse_param((char *) config, &err_param, 1, &min_timeout);
+    if (ret != 0) {
+        free(err_param);
+        min_timeout.v.val_int = 0;
+    }
+    if (min_timeout.v.val_int < 0 ||
+        min_timeout.v.val_int > timeout.v.val_int) {
+        plog_warn(plugin, "invalid min_timeout: %" PRId64 ", use 0",
+                  min_timeout.v.val_int);
+        min_timeout.v.val_int = 0;
+    }
+
+    ret = neu_parse_param((char *) config, &err_param, 1, &share);
+    if (ret != 0) {
+        free(err_param);
+        share.v.val_bool = false;
+    }
+
+    ret = neu_parse_param((char *) config, &err_param, 1, &write_read);
+    if (ret != 0) {
+        free(err_param);
+        write_read.v.val_bool = false;
+    }
+
+    tcp_opt_config(plugin, config, &param.tcp_opt);
+
+    param.log                 = plugin->common.log;
+    plugin->interval          = interval.v.val_int;
+    plugin->max_retries       = max_retries.v.val_int;
+    plugin->retry_interval    = retry_interval.v.val_int;
+    plugin->max_gap           = max_gap.v.val_int;
+    plugin->max_backoff       = max_backoff.v.val_int;
+    plugin->breaker_threshold = breaker.v.val_int;
+    plugin->max_inflight      = max_inflight.v.val_int;
+    plugin->max_link          = max_link.v.val_int;
+    plugin->timeout           = timeout.v.val_int;
+    plugin->min_timeout       = min_timeout.v.val_int;
+    plugin->write_read        = write_read.v.val_bool;
 
     if (mode.v.val_int == 1) {
         param.type                           = NEU_CONN_TCP_SERVER;
@@ -198,7 +364,7 @@ static int driver_config(neu_plugin_t *plugin, const char *config)
         param.params.tcp_server.start_listen = modbus_tcp_server_listen;
         param.params.tcp_server.stop_listen  = modbus_tcp_server_stop;
         param.params.tcp_server.timeout      = timeout.v.val_int;
-        param.params.tcp_server.max_link     = 1;
+        param.params.tcp_server.max_link     = max_link.v.val_int;
         plugin->is_server                    = true;
     }
     if (mode.v.val_int == 0) {
@@ -213,8 +379,24 @@ static int driver_config(neu_plugin_t *plugin, const char *config)
                 "config: host: %s, port: %" PRId64 ", mode: %" PRId64 "",
                 host.v.val_str, port.v.val_int, mode.v.val_int);
 
+    // a shared connection is left for the one of the new endpoint
+    if (plugin->conn != NULL && (plugin->conn_share || share.v.val_bool)) {
+        if (plugin->conn_share) {
+            neu_conn_unshare(plugin->conn, plugin);
+        } else {
+            neu_conn_destory(plugin->conn);
+        }
+        plugin->conn = NULL;
+    }
+    plugin->conn_share = share.v.val_bool && !plugin->is_server;
+
     if (plugin->conn != NULL) {
         plugin->conn = neu_conn_reconfig(plugin->conn, &param);
+    } else if (plugin->conn_share) {
+        plugin->common.link_state = NEU_NODE_LINK_STATE_DISCONNECTED;
+        plugin->conn =
+            neu_conn_share(&param, (void *) plugin, modbus_conn_connected,
+                           modbus_conn_disconnected);
     } else {
         plugin->common.link_state = NEU_NODE_LINK_STATE_DISCONNECTED;
         plugin->conn =
@@ -245,7 +427,7 @@ static int driver_validate_tag(neu_plugin_t *plugin, neu_datatag_t *tag)
 {
     modbus_point_t point = { 0 };
 
-    int ret = modbus_tag_to_point(tag, &point);
+    int ret = modbus_tag_compile(tag, &point);
     if (ret == 0) {
         plog_notice(
             plugin,
@@ -266,18 +448,68 @@ static int driver_validate_tag(neu_plugin_t *plugin, neu_datatag_t *tag)
     return ret;
 }
 
+// logs the invalid tags only, the valid ones are counted
+static int driver_validate_tags(neu_plugin_t *plugin, neu_datatag_t **tags,
+                                int n, int *errors)
+{
+    int invalid = 0;
+
+    for (int i = 0; i < n; ++i) {
+        modbus_point_t point = { 0 };
+
+        errors[i] = modbus_tag_compile(tags[i], &point);
+        if (errors[i] != 0) {
+            invalid += 1;
+            plog_error(plugin,
+                       "validate tag error, name: %s, address: %s, type: %d, "
+                       "error: %d",
+                       tags[i]->name, tags[i]->address, tags[i]->type,
+                       errors[i]);
+        }
+    }
+
+    plog_notice(plugin, "validate %d tags, %d invalid", n, invalid);
+    return invalid;
+}
+
 static int driver_group_timer(neu_plugin_t *plugin, neu_plugin_group_t *group)
 {
-    return modbus_group_timer(plugin, group, 0xfa);
+    // reads are due before the next tick of their group
+    modbus_conn_acquire(plugin, NEU_CONN_PRIO_NORMAL,
+                        neu_time_ms() + group->interval);
+    int ret = modbus_group_timer(plugin, group, 0xfa);
+    modbus_conn_release(plugin);
+    return ret;
+}
+
+static int driver_group_update(neu_plugin_t *plugin, neu_plugin_group_t *group,
+                               const neu_plugin_group_delta_t *delta)
+{
+    return modbus_group_update(plugin, group, delta, 0xfa);
 }
 
 static int driver_write(neu_plugin_t *plugin, void *req, neu_datatag_t *tag,
                         neu_value_u value)
 {
-    return modbus_write_tag(plugin, req, tag, value);
+    modbus_conn_acquire(plugin, NEU_CONN_PRIO_HIGH, neu_time_ms());
+    int ret = modbus_write_tag(plugin, req, tag, value);
+    modbus_conn_release(plugin);
+    return ret;
 }
 
 static int driver_write_tags(neu_plugin_t *plugin, void *req, UT_array *tags)
 {
-    return modbus_write_tags(plugin, req, tags);
-}
\ No newline at end of file
+    modbus_conn_acquire(plugin, NEU_CONN_PRIO_HIGH, neu_time_ms());
+    int ret = modbus_write_tags(plugin, req, tags);
+    modbus_conn_release(plugin);
+    return ret;
+}
+
+static int driver_write_batch(neu_plugin_t *plugin, int n,
+                              neu_plugin_write_t *writes)
+{
+    modbus_conn_acquire(plugin, NEU_CONN_PRIO_HIGH, neu_time_ms());
+    int ret = modbus_write_batch(plugin, n, writes);
+    modbus_conn_release(plugin);
+    return ret;
+}
@@ -0,0 +1,134 @@
+/**
+ * NEURON IIoT System for Industry 4.0
+ * Copyright (C) 2020-2023 EMQ Technologies Co., Ltd All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ **/
+
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "mqtt_batch.h"
+
+// array32 marker and count of the MessagePack payload, patched on take
+#define MSGPACK_ARRAY_HEADER_LEN 5
+
+mqtt_batch_t *mqtt_batch_get(mqtt_batch_t **tbl, const char *topic)
+{
+    mqtt_batch_t *batch = NULL;
+
+    HASH_FIND_STR(*tbl, topic, batch);
+    if (NULL != batch) {
+        return batch;
+    }
+
+    batch = calloc(1, sizeof(*batch));
+    if (NULL == batch) {
+        return NULL;
+    }
+    batch->topic = strdup(topic);
+    if (NULL == batch->topic) {
+        free(batch);
+        return NULL;
+    }
+    HASH_ADD_KEYPTR(hh, *tbl, batch->topic, strlen(batch->topic), batch);
+    return batch;
+}
+
+static int reserve(mqtt_batch_t *batch, size_t n)
+{
+    if (batch->len + n <= batch->cap) {
+        return 0;
+    }
+
+    size_t cap = batch->cap ? batch->cap : 4096;
+    while (cap < batch->len + n) {
+        cap *= 2;
+    }
+
+    uint8_t *buf = realloc(batch->buf, cap);
+    if (NULL == buf) {
+        return -1;
+    }
+    batch->buf = buf;
+    batch->cap = cap;
+    return 0;
+}
+
+int mqtt_batch_append(mqtt_batch_t *batch, bool msgpack, const void *msg,
+                      size_t len, int64_t now)
+{
+    // room for the opening or separator, and for the closing bracket
+    if (0 != reserve(batch, len + MSGPACK_ARRAY_HEADER_LEN)) {
+        return -1;
+    }
+
+    if (0 == batch->count) {
+        batch->len      = 0;
+        batch->first_ts = now;
+        batch->qos      = 0;
+        batch->flags    = 0;
+        if (msgpack) {
+            batch->len = MSGPACK_ARRAY_HEADER_LEN;
+        } else {
+            batch->buf[batch->len++] = '[';
+        }
+    } else if (!msgpack) {
+        batch->buf[batch->len++] = ',';
+        batch->buf[batch->len++] = ' ';
+    }
+
+    memcpy(batch->buf + batch->len, msg, len);
+    batch->len += len;
+    batch->count += 1;
+    return 0;
+}
+
+const uint8_t *mqtt_batch_finish(mqtt_batch_t *batch, bool msgpack,
+                                 size_t *len)
+{
+    if (0 == batch->count) {
+        return NULL;
+    }
+
+    if (msgpack) {
+        batch->buf[0] = 0xdd;
+        batch->buf[1] = batch->count >> 24;
+        batch->buf[2] = batch->count >> 16;
+        batch->buf[3] = batch->count >> 8;
+        batch->buf[4] = batch->count;
+    } else {
+        batch->buf[batch->len++] = ']';
+    }
+
+    *len         = batch->len;
+    batch->len   = 0;
+    batch->count = 0;
+    return batch->buf;
+}
+
+void mqtt_batch_tbl_free(mqtt_batch_t *tbl)
+{
+    mqtt_batch_t *batch = NULL, *tmp = NULL;
+    HASH_ITER(hh, tbl, batch, tmp)
+    {
+        HASH_DEL(tbl, batch);
+        free(batch->topic);
+        free(batch->buf);
+        free(batch->trace);
+        free(batch);
+    }
+}
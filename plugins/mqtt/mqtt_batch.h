@@ -0,0 +1,83 @@
+/**
+ * NEURON IIoT System for Industry 4.0
+ * Copyright (C) 2020-2023 EMQ Technologies Co., Ltd All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ **/
+
+
+#ifndef NEURON_PLUGIN_MQTT_BATCH_H
+#define NEURON_PLUGIN_MQTT_BATCH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "utils/uthash.h"
+
+// Upload messages collected for one topic.
+//
+// A batch payload is an array of the upload messages added to it: a json
+// array when `msgpack` is false, a MessagePack array otherwise.
+typedef struct mqtt_batch {
+    char *         topic; // kept until the plugin is uninitialized, as the
+                          // mqtt client refers to it until publish completes
+    uint8_t *      buf;
+    size_t         len;
+    size_t         cap;
+    uint32_t       count;
+    int64_t        first_ts; // when the first message was added, ms
+    int            qos;      // highest QoS of the messages added
+    int            flags;    // publish flags of the messages added
+    bool           lost;     // a flush failed since the flag was cleared
+    void *         trace;    // sampled trace of a message added, malloc'ed
+    UT_hash_handle hh;
+} mqtt_batch_t;
+
+// find the batch of `topic` or add an empty one, NULL if out of memory
+mqtt_batch_t *mqtt_batch_get(mqtt_batch_t **tbl, const char *topic);
+
+int mqtt_batch_append(mqtt_batch_t *batch, bool msgpack, const void *msg,
+                      size_t len, int64_t now);
+
+/**
+ * @brief Complete the batch payload and empty the batch.
+ *
+ * @param[out] len Payload length.
+ * @return The payload in the batch buffer, valid until the next append, NULL
+ *         if the batch is empty.
+ */
+const uint8_t *mqtt_batch_finish(mqtt_batch_t *batch, bool msgpack,
+                                 size_t *len);
+
+// payload size once `len` more bytes are appended
+static inline size_t mqtt_batch_size_with(const mqtt_batch_t *batch,
+                                          size_t              len)
+{
+    // separator and closing bracket, or the array header
+    return batch->len + len + 5;
+}
+
+void mqtt_batch_tbl_free(mqtt_batch_t *tbl);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
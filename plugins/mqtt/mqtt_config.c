@@ -24,6 +24,7 @@
 #include "mqtt_config.h"
 #include "mqtt_plugin.h"
 
+#define KB 1000
 #define MB 1000000
 
 static inline int decode_b64_param(neu_plugin_t *plugin, neu_json_elem_t *el)
@@ -226,6 +227,60 @@ int mqtt_config_parse(neu_plugin_t *plugin, const char *setting,
         .attribute = NEU_JSON_ATTRIBUTE_OPTIONAL, // for backward compatibility
     };
     neu_json_elem_t format          = { .name = "format", .t = NEU_JSON_INT };
+    neu_json_elem_t batch_size      = {
+        .name      = "batch-size",
+        .t         = NEU_JSON_INT,
+        .v.val_int = 0, // default to no batching
+        .attribute = NEU_JSON_ATTRIBUTE_OPTIONAL,
+    };
+    neu_json_elem_t batch_linger = {
+        .name      = "batch-linger",
+        .t         = NEU_JSON_INT,
+        .v.val_int = MQTT_BATCH_LINGER_DEFAULT,
+        .attribute = NEU_JSON_ATTRIBUTE_OPTIONAL,
+    };
+    neu_json_elem_t connections = {
+        .name      = "connections",
+        .t         = NEU_JSON_INT,
+        .v.val_int = 1,
+        .attribute = NEU_JSON_ATTRIBUTE_OPTIONAL,
+    };
+    neu_json_elem_t max_inflight = {
+        .name      = "max-inflight",
+        .t         = NEU_JSON_INT,
+        .v.val_int = MQTT_MAX_INFLIGHT_DEFAULT,
+        .attribute = NEU_JSON_ATTRIBUTE_OPTIONAL,
+    };
+    neu_json_elem_t max_inflight_size = {
+        .name      = "max-inflight-size",
+        .t         = NEU_JSON_INT,
+        .v.val_int = 0, // default to no byte bound
+        .attribute = NEU_JSON_ATTRIBUTE_OPTIONAL,
+    };
+    neu_json_elem_t replay_rate = {
+        .name      = "replay-rate",
+        .t         = NEU_JSON_INT,
+        .v.val_int = 0, // default to no rate bound
+        .attribute = NEU_JSON_ATTRIBUTE_OPTIONAL,
+    };
+    neu_json_elem_t replay_share = {
+        .name      = "replay-share",
+        .t         = NEU_JSON_INT,
+        .v.val_int = NEU_MQTT_REPLAY_SHARE_DEFAULT,
+        .attribute = NEU_JSON_ATTRIBUTE_OPTIONAL,
+    };
+    neu_json_elem_t replay_order = {
+        .name      = "replay-order",
+        .t         = NEU_JSON_INT,
+        .v.val_int = NEU_MQTT_REPLAY_OLDEST_FIRST,
+        .attribute = NEU_JSON_ATTRIBUTE_OPTIONAL,
+    };
+    neu_json_elem_t sparkplug_group_id = {
+        .name      = "sparkplug-group-id",
+        .t         = NEU_JSON_STR,
+        .v.val_str = NULL,
+        .attribute = NEU_JSON_ATTRIBUTE_OPTIONAL,
+    };
     neu_json_elem_t write_req_topic = {
         .name      = "write-req-topic",
         .t         = NEU_JSON_STR,
@@ -238,6 +293,12 @@ int mqtt_config_parse(neu_plugin_t *plugin, const char *setting,
         .v.val_str = NULL,
         .attribute = NEU_JSON_ATTRIBUTE_OPTIONAL, // for backward compatibility
     };
+    neu_json_elem_t write_linger = {
+        .name      = "write-linger",
+        .t         = NEU_JSON_INT,
+        .v.val_int = 0, // default to no coalescing
+        .attribute = NEU_JSON_ATTRIBUTE_OPTIONAL,
+    };
     neu_json_elem_t offline_cache       = { .name = "offline-cache",
                                       .t    = NEU_JSON_BOOL };
     neu_json_elem_t cache_mem_size      = { .name = "cache-mem-size",
@@ -282,12 +343,68 @@ int mqtt_config_parse(neu_plugin_t *plugin, const char *setting,
 
     // format, required
     if (MQTT_UPLOAD_FORMAT_VALUES != format.v.val_int &&
-        MQTT_UPLOAD_FORMAT_TAGS != format.v.val_int) {
+        MQTT_UPLOAD_FORMAT_TAGS != format.v.val_int &&
+        MQTT_UPLOAD_FORMAT_MSGPACK != format.v.val_int &&
+        MQTT_UPLOAD_FORMAT_SPARKPLUG_B != format.v.val_int) {
         plog_error(plugin, "setting invalid format: %" PRIi64,
                    format.v.val_int);
         goto error;
     }
 
+    // sparkplug group id, optional, it is a topic level
+    neu_parse_param(setting, NULL, 1, &sparkplug_group_id);
+    if (NULL == sparkplug_group_id.v.val_str &&
+        NULL == (sparkplug_group_id.v.val_str = strdup("neuron"))) {
+        goto error;
+    }
+    if (0 == strlen(sparkplug_group_id.v.val_str) ||
+        NULL != strpbrk(sparkplug_group_id.v.val_str, "/+#")) {
+        plog_error(plugin, "setting invalid sparkplug group id: `%s`",
+                   sparkplug_group_id.v.val_str);
+        goto error;
+    }
+
+    // batch size and linger, optional
+    neu_parse_param(setting, NULL, 1, &batch_size);
+    neu_parse_param(setting, NULL, 1, &batch_linger);
+    if (batch_size.v.val_int < 0 ||
+        MQTT_BATCH_SIZE_MAX < batch_size.v.val_int) {
+        plog_error(plugin, "setting invalid batch size: %" PRIi64,
+                   batch_size.v.val_int);
+        goto error;
+    }
+    if (batch_linger.v.val_int < 1 ||
+        MQTT_BATCH_LINGER_MAX < batch_linger.v.val_int) {
+        plog_error(plugin, "setting invalid batch linger: %" PRIi64,
+                   batch_linger.v.val_int);
+        goto error;
+    }
+
+    // connections, optional, default to one
+    neu_parse_param(setting, NULL, 1, &connections);
+    if (connections.v.val_int < 1 ||
+        MQTT_CONNECTIONS_MAX < connections.v.val_int) {
+        plog_error(plugin, "setting invalid connections: %" PRIi64,
+                   connections.v.val_int);
+        goto error;
+    }
+
+    // in-flight window of a connection, optional
+    neu_parse_param(setting, NULL, 1, &max_inflight);
+    if (max_inflight.v.val_int < 0 ||
+        MQTT_MAX_INFLIGHT_MAX < max_inflight.v.val_int) {
+        plog_error(plugin, "setting invalid max inflight: %" PRIi64,
+                   max_inflight.v.val_int);
+        goto error;
+    }
+    neu_parse_param(setting, NULL, 1, &max_inflight_size);
+    if (max_inflight_size.v.val_int < 0 ||
+        MQTT_MAX_INFLIGHT_SIZE_MAX < max_inflight_size.v.val_int) {
+        plog_error(plugin, "setting invalid max inflight size: %" PRIi64,
+                   max_inflight_size.v.val_int);
+        goto error;
+    }
+
     // write request topic
     if (NULL == write_req_topic.v.val_str &&
         0 > neu_asprintf(&write_req_topic.v.val_str, "/neuron/%s/write/req",
@@ -304,6 +421,15 @@ int mqtt_config_parse(neu_plugin_t *plugin, const char *setting,
         goto error;
     }
 
+    // write linger, optional
+    neu_parse_param(setting, NULL, 1, &write_linger);
+    if (write_linger.v.val_int < 0 ||
+        MQTT_WRITE_LINGER_MAX < write_linger.v.val_int) {
+        plog_error(plugin, "setting invalid write linger: %" PRIi64,
+                   write_linger.v.val_int);
+        goto error;
+    }
+
     // offline cache
     ret = parse_cache_params(plugin, setting, &offline_cache, &cache_mem_size,
                              &cache_disk_size, &cache_sync_interval);
@@ -311,6 +437,28 @@ int mqtt_config_parse(neu_plugin_t *plugin, const char *setting,
         goto error;
     }
 
+    // pacing of the cache replay, optional
+    neu_parse_param(setting, NULL, 1, &replay_rate);
+    if (replay_rate.v.val_int < 0 ||
+        MQTT_REPLAY_RATE_MAX < replay_rate.v.val_int) {
+        plog_error(plugin, "setting invalid replay rate: %" PRIi64,
+                   replay_rate.v.val_int);
+        goto error;
+    }
+    neu_parse_param(setting, NULL, 1, &replay_share);
+    if (replay_share.v.val_int < 1 || 100 < replay_share.v.val_int) {
+        plog_error(plugin, "setting invalid replay share: %" PRIi64,
+                   replay_share.v.val_int);
+        goto error;
+    }
+    neu_parse_param(setting, NULL, 1, &replay_order);
+    if (NEU_MQTT_REPLAY_OLDEST_FIRST != replay_order.v.val_int &&
+        NEU_MQTT_REPLAY_NEWEST_FIRST != replay_order.v.val_int) {
+        plog_error(plugin, "setting invalid replay order: %" PRIi64,
+                   replay_order.v.val_int);
+        goto error;
+    }
+
     // host, required
     if (0 == strlen(host.v.val_str)) {
         plog_error(plugin, "setting invalid host: `%s`", host.v.val_str);
@@ -343,12 +491,22 @@ int mqtt_config_parse(neu_plugin_t *plugin, const char *setting,
     config->client_id           = client_id.v.val_str;
     config->qos                 = qos.v.val_int;
     config->format              = format.v.val_int;
+    config->batch_size          = batch_size.v.val_int;
+    config->batch_linger        = batch_linger.v.val_int;
+    config->connections         = connections.v.val_int;
+    config->max_inflight        = max_inflight.v.val_int;
+    config->max_inflight_size   = max_inflight_size.v.val_int * KB;
+    config->sparkplug_group_id  = sparkplug_group_id.v.val_str;
     config->write_req_topic     = write_req_topic.v.val_str;
     config->write_resp_topic    = write_resp_topic.v.val_str;
+    config->write_linger        = write_linger.v.val_int;
     config->cache               = offline_cache.v.val_bool;
     config->cache_mem_size      = cache_mem_size.v.val_int * MB;
     config->cache_disk_size     = cache_disk_size.v.val_int * MB;
     config->cache_sync_interval = cache_sync_interval.v.val_int;
+    config->replay_rate         = replay_rate.v.val_int * KB;
+    config->replay_share        = replay_share.v.val_int;
+    config->replay_order        = replay_order.v.val_int;
     config->host                = host.v.val_str;
     config->port                = port.v.val_int;
     config->username            = username.v.val_str;
@@ -363,15 +521,29 @@ int mqtt_config_parse(neu_plugin_t *plugin, const char *setting,
     plog_notice(plugin, "config qos             : %d", config->qos);
     plog_notice(plugin, "config format          : %s",
                 mqtt_upload_format_str(config->format));
+    plog_notice(plugin, "config batch-size      : %zu", config->batch_size);
+    plog_notice(plugin, "config batch-linger    : %zu", config->batch_linger);
+    plog_notice(plugin, "config connections     : %zu", config->connections);
+    plog_notice(plugin, "config max-inflight    : %zu", config->max_inflight);
+    plog_notice(plugin, "config max-inflight-size : %zu",
+                config->max_inflight_size);
+    if (MQTT_UPLOAD_FORMAT_SPARKPLUG_B == config->format) {
+        plog_notice(plugin, "config sparkplug-group-id : %s",
+                    config->sparkplug_group_id);
+    }
     plog_notice(plugin, "config write-req-topic : %s", config->write_req_topic);
     plog_notice(plugin, "config write-resp-topic: %s",
                 config->write_resp_topic);
+    plog_notice(plugin, "config write-linger    : %zu", config->write_linger);
     plog_notice(plugin, "config cache           : %zu", config->cache);
     plog_notice(plugin, "config cache-mem-size  : %zu", config->cache_mem_size);
     plog_notice(plugin, "config cache-disk-size : %zu",
                 config->cache_disk_size);
     plog_notice(plugin, "config cache-sync-interval : %zu",
                 config->cache_sync_interval);
+    plog_notice(plugin, "config replay-rate     : %zu", config->replay_rate);
+    plog_notice(plugin, "config replay-share    : %zu", config->replay_share);
+    plog_notice(plugin, "config replay-order    : %zu", config->replay_order);
     plog_notice(plugin, "config host            : %s", config->host);
     plog_notice(plugin, "config port            : %" PRIu16, config->port);
 
@@ -402,6 +574,7 @@ int mqtt_config_parse(neu_plugin_t *plugin, const char *setting,
 error:
     free(err_param);
     free(client_id.v.val_str);
+    free(sparkplug_group_id.v.val_str);
     free(write_req_topic.v.val_str);
     free(write_resp_topic.v.val_str);
     free(host.v.val_str);
@@ -417,6 +590,7 @@ error:
 void mqtt_config_fini(mqtt_config_t *config)
 {
     free(config->client_id);
+    free(config->sparkplug_group_id);
     free(config->write_req_topic);
     free(config->write_resp_topic);
     free(config->host);
@@ -30,9 +30,21 @@ extern "C" {
 #include "connection/mqtt_client.h"
 #include "plugin.h"
 
+#define MQTT_BATCH_SIZE_MAX (4 * 1024 * 1024)
+#define MQTT_BATCH_LINGER_DEFAULT 100
+#define MQTT_BATCH_LINGER_MAX 60000
+#define MQTT_CONNECTIONS_MAX 16
+#define MQTT_WRITE_LINGER_MAX 1000
+#define MQTT_MAX_INFLIGHT_DEFAULT 512
+#define MQTT_MAX_INFLIGHT_MAX 1024               // the task limit of the client
+#define MQTT_MAX_INFLIGHT_SIZE_MAX (1024 * 1024) // KB
+#define MQTT_REPLAY_RATE_MAX (1024 * 1024)       // KB per second
+
 typedef enum {
-    MQTT_UPLOAD_FORMAT_VALUES = 0,
-    MQTT_UPLOAD_FORMAT_TAGS   = 1,
+    MQTT_UPLOAD_FORMAT_VALUES      = 0,
+    MQTT_UPLOAD_FORMAT_TAGS        = 1,
+    MQTT_UPLOAD_FORMAT_MSGPACK     = 2,
+    MQTT_UPLOAD_FORMAT_SPARKPLUG_B = 3,
 } mqtt_upload_format_e;
 
 static inline const char *mqtt_upload_format_str(mqtt_upload_format_e f)
@@ -42,6 +54,10 @@ static inline const char *mqtt_upload_format_str(mqtt_upload_format_e f)
         return "format-values";
     case MQTT_UPLOAD_FORMAT_TAGS:
         return "format-tags";
+    case MQTT_UPLOAD_FORMAT_MSGPACK:
+        return "format-msgpack";
+    case MQTT_UPLOAD_FORMAT_SPARKPLUG_B:
+        return "format-sparkplug-b";
     default:
         return NULL;
     }
@@ -51,12 +67,22 @@ typedef struct {
     char *               client_id;           // client id
     neu_mqtt_qos_e       qos;                 // message QoS
     mqtt_upload_format_e format;              // upload format
+    size_t               batch_size;          // batch bytes, 0 to disable
+    size_t               batch_linger;        // batch linger time in ms
+    size_t               connections;         // broker connections
+    size_t               max_inflight;        // msgs of a connection, 0 off
+    size_t               max_inflight_size;   // bytes of a connection, 0 off
+    char *               sparkplug_group_id;  // Sparkplug B group id
     char *               write_req_topic;     // write request topic
     char *               write_resp_topic;    // write response topic
+    size_t               write_linger;        // write coalescing ms, 0 off
     size_t               cache;               // cache enable flag
     size_t               cache_mem_size;      // cache memory size in bytes
     size_t               cache_disk_size;     // cache disk size in bytes
     size_t               cache_sync_interval; // cache sync interval
+    size_t               replay_rate;         // bytes per second, 0 off
+    size_t               replay_share;        // percent of in-flight window
+    size_t               replay_order;        // neu_mqtt_replay_order_e
     char *               host;                // broker host
     uint16_t             port;                // broker port
     char *               username;            // user name
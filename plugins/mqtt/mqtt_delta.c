@@ -0,0 +1,153 @@
+/**
+ * NEURON IIoT System for Industry 4.0
+ * Copyright (C) 2020-2023 EMQ Technologies Co., Ltd All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ **/
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mqtt_delta.h"
+
+void mqtt_delta_clear(mqtt_delta_t *delta)
+{
+    mqtt_delta_tag_t *t = NULL, *tmp = NULL;
+    HASH_ITER(hh, delta->tags, t, tmp)
+    {
+        HASH_DEL(delta->tags, t);
+        free(t);
+    }
+    delta->keyframe_ts = 0;
+}
+
+void mqtt_delta_fini(mqtt_delta_t *delta)
+{
+    mqtt_delta_clear(delta);
+    if (delta->changed) {
+        utarray_free(delta->changed);
+        delta->changed = NULL;
+    }
+}
+
+static bool real_changed(double last, double cur, double deadband)
+{
+    if (isnan(last) || isnan(cur)) {
+        return isnan(last) != isnan(cur);
+    }
+    return fabs(cur - last) > deadband;
+}
+
+static bool value_changed(const neu_dvalue_t *last, const neu_dvalue_t *cur,
+                          double deadband)
+{
+    if (last->type != cur->type) {
+        return true;
+    }
+
+    switch (cur->type) {
+    case NEU_TYPE_INT8:
+    case NEU_TYPE_UINT8:
+    case NEU_TYPE_BIT:
+        return last->value.u8 != cur->value.u8;
+    case NEU_TYPE_BOOL:
+        return last->value.boolean != cur->value.boolean;
+    case NEU_TYPE_INT16:
+    case NEU_TYPE_UINT16:
+    case NEU_TYPE_WORD:
+        return last->value.u16 != cur->value.u16;
+    case NEU_TYPE_INT32:
+    case NEU_TYPE_UINT32:
+    case NEU_TYPE_DWORD:
+    case NEU_TYPE_ERROR:
+        return last->value.u32 != cur->value.u32;
+    case NEU_TYPE_INT64:
+    case NEU_TYPE_UINT64:
+    case NEU_TYPE_LWORD:
+        return last->value.u64 != cur->value.u64;
+    case NEU_TYPE_FLOAT:
+        return real_changed(last->value.f32, cur->value.f32, deadband);
+    case NEU_TYPE_DOUBLE:
+        return real_changed(last->value.d64, cur->value.d64, deadband);
+    case NEU_TYPE_STRING:
+        return 0 != strncmp(last->value.str, cur->value.str, NEU_VALUE_SIZE);
+    case NEU_TYPE_BYTES:
+        return last->value.bytes.length != cur->value.bytes.length ||
+            0 !=
+            memcmp(last->value.bytes.bytes, cur->value.bytes.bytes,
+                   cur->value.bytes.length);
+    default:
+        return true;
+    }
+}
+
+// remember the value of `tv` if it changed, return -1 if out of memory
+static int update_tag(mqtt_delta_t *delta, const neu_resp_tag_value_meta_t *tv,
+                      bool *changed)
+{
+    mqtt_delta_tag_t *t = NULL;
+
+    HASH_FIND_STR(delta->tags, tv->tag, t);
+    if (NULL == t) {
+        t = calloc(1, sizeof(*t));
+        if (NULL == t) {
+            return -1;
+        }
+        strncpy(t->name, tv->tag, sizeof(t->name) - 1);
+        HASH_ADD_STR(delta->tags, name, t);
+        *changed = true;
+    } else {
+        *changed = value_changed(&t->value, &tv->value, delta->config.deadband);
+    }
+
+    if (*changed) {
+        t->value = tv->value;
+    }
+    return 0;
+}
+
+UT_array *mqtt_delta_filter(mqtt_delta_t *delta, UT_array *tags, int64_t now)
+{
+    static UT_icd icd = { sizeof(neu_resp_tag_value_meta_t), NULL, NULL, NULL };
+    bool          full =
+        0 == delta->keyframe_ts ||
+        (delta->config.keyframe > 0 &&
+         now - delta->keyframe_ts >= delta->config.keyframe);
+
+    if (NULL == delta->changed) {
+        utarray_new(delta->changed, &icd);
+    }
+    utarray_clear(delta->changed);
+
+    utarray_foreach(tags, neu_resp_tag_value_meta_t *, tv)
+    {
+        bool changed = false;
+        if (0 != update_tag(delta, tv, &changed)) {
+            // values may be half updated, start over with a full snapshot
+            mqtt_delta_clear(delta);
+            return NULL;
+        }
+        if (changed && !full) {
+            utarray_push_back(delta->changed, tv);
+        }
+    }
+
+    if (full) {
+        delta->keyframe_ts = now;
+        return tags;
+    }
+    return delta->changed;
+}
@@ -0,0 +1,76 @@
+/**
+ * NEURON IIoT System for Industry 4.0
+ * Copyright (C) 2020-2023 EMQ Technologies Co., Ltd All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ **/
+
+#ifndef NEURON_PLUGIN_MQTT_DELTA_H
+#define NEURON_PLUGIN_MQTT_DELTA_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "neuron.h"
+
+// Changed-only upload policy of a route.
+//
+// An upload then carries only the tags whose value differs from the value
+// last uploaded, and is skipped when no tag changed. A float or double tag
+// changes when it moves by more than `deadband`. Every `keyframe` ms, and
+// after an upload is lost, all tags are uploaded again. Only values are
+// compared, a change of tag metas alone is not uploaded.
+typedef struct {
+    bool    changed_only;
+    double  deadband;
+    int64_t keyframe; // full snapshot interval in ms, 0 for none
+} mqtt_delta_config_t;
+
+typedef struct mqtt_delta_tag {
+    char           name[NEU_TAG_NAME_LEN];
+    neu_dvalue_t   value; // last uploaded
+    UT_hash_handle hh;
+} mqtt_delta_tag_t;
+
+typedef struct {
+    mqtt_delta_config_t config;
+    mqtt_delta_tag_t *  tags;
+    int64_t             keyframe_ts; // last full snapshot, 0 for none yet
+    UT_array *          changed;     // neu_resp_tag_value_meta_t, reused
+} mqtt_delta_t;
+
+// forget the uploaded values, the next upload is a full snapshot
+void mqtt_delta_clear(mqtt_delta_t *delta);
+void mqtt_delta_fini(mqtt_delta_t *delta);
+
+/**
+ * @brief Select the tags to upload and take them as uploaded.
+ *
+ * @param[in] tags UT_array of neu_resp_tag_value_meta_t.
+ * @return `tags` itself for a full snapshot, otherwise an array owned by the
+ *         delta holding copies of the changed tags, valid until the next call,
+ *         NULL if out of memory.
+ */
+UT_array *mqtt_delta_filter(mqtt_delta_t *delta, UT_array *tags, int64_t now);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -20,9 +20,11 @@
 #include "connection/mqtt_client.h"
 #include "errcodes.h"
 #include "utils/asprintf.h"
+#include "utils/time.h"
 #include "version.h"
 #include "json/neu_json_mqtt.h"
 #include "json/neu_json_rw.h"
+#include "json/neu_json_stream.h"
 
 #include "mqtt_handle.h"
 #include "mqtt_plugin.h"
@@ -51,43 +53,64 @@ static int tag_values_to_json(UT_array *tags, neu_json_read_resp_t *json)
     return 0;
 }
 
-static char *generate_upload_json(neu_plugin_t *            plugin,
-                                  neu_reqresp_trans_data_t *data,
-                                  mqtt_upload_format_e      format)
+// encode into the buffers kept by the plugin, `buf` points into them and
+// stays valid until the next upload is encoded, so uploads are published
+// without copying the payload in between
+static int encode_upload(neu_plugin_t *plugin, route_entry_t *route,
+                         neu_reqresp_trans_data_t *data, const void **buf,
+                         size_t *len)
 {
-    char *                   json_str = NULL;
+    uint16_t                 consumer = neu_plugin_consumer();
+    mqtt_upload_format_e     format   = plugin->config.format;
+    neu_json_stream_t *      stream   = &plugin->upload_json[consumer];
+    mqtt_msgpack_t *         mp       = &plugin->upload_msgpack[consumer];
+    uint64_t                 session  = 0;
+    int                      ret      = 0;
     neu_json_read_periodic_t header   = { .group     = (char *) data->group,
                                         .node      = (char *) data->driver,
                                         .timestamp = global_timestamp };
-    neu_json_read_resp_t     json     = { 0 };
 
-    if (0 != tag_values_to_json(data->tags, &json)) {
-        plog_error(plugin, "tag_values_to_json fail");
-        return NULL;
+    if (MQTT_UPLOAD_FORMAT_MSGPACK == format) {
+        session = __atomic_load_n(&plugin->session, __ATOMIC_RELAXED);
+        ret     = mqtt_msgpack_encode_upload(mp, &route->dict, session,
+                                         data->driver, data->group,
+                                         global_timestamp, data->tags);
+        if (0 != ret) {
+            plog_error(plugin, "encode upload msgpack fail");
+            return -1;
+        }
+        *buf = mp->buf;
+        *len = mp->len;
+        return 0;
     }
 
+    // the json depends on the snapshot only, the apps mirroring a group to
+    // other brokers encode it once
+    uint32_t shared = MQTT_UPLOAD_FORMAT_VALUES == format
+        ? NEU_TRANS_ENCODED_JSON_VALUES
+        : NEU_TRANS_ENCODED_JSON_TAGS;
+    if (NULL != (*buf = neu_trans_data_encoded(data, shared, len))) {
+        return 0;
+    }
+
+    neu_json_stream_reset(stream);
     if (MQTT_UPLOAD_FORMAT_VALUES == format) { // values
-        neu_json_encode_with_mqtt(&json, neu_json_encode_read_resp1, &header,
-                                  neu_json_encode_read_periodic_resp,
-                                  &json_str);
+        ret = neu_json_stream_read_periodic_resp1(stream, &header, data->tags);
     } else if (MQTT_UPLOAD_FORMAT_TAGS == format) { // tags
-        neu_json_encode_with_mqtt(&json, neu_json_encode_read_resp, &header,
-                                  neu_json_encode_read_periodic_resp,
-                                  &json_str);
+        ret = neu_json_stream_read_periodic_resp(stream, &header, data->tags);
     } else {
         plog_warn(plugin, "invalid upload format: %d", format);
+        return -1;
     }
 
-    for (int i = 0; i < json.n_tag; i++) {
-        if (json.tags[i].n_meta > 0) {
-            free(json.tags[i].metas);
-        }
-    }
-
-    if (json.tags) {
-        free(json.tags);
+    if (0 != ret) {
+        plog_error(plugin, "encode upload json fail");
+        return -1;
     }
-    return json_str;
+    neu_trans_data_encoded_share(data, shared, stream->buf, stream->len);
+    *buf = stream->buf;
+    *len = stream->len;
+    return 0;
 }
 
 static char *generate_read_resp_json(neu_plugin_t *         plugin,
@@ -141,6 +164,7 @@ static inline int send_read_req(neu_plugin_t *plugin, neu_json_mqtt_t *mqtt,
     cmd.driver                = req->node;
     cmd.group                 = req->group;
     cmd.sync                  = req->sync;
+    cmd.max_age               = req->max_age;
     req->node                 = NULL; // ownership moved
     req->group                = NULL; // ownership moved
     if (0 != neu_plugin_op(plugin, header, &cmd)) {
@@ -196,9 +220,11 @@ static int send_write_tag_req(neu_plugin_t *plugin, neu_json_mqtt_t *mqtt,
     header.ctx  = mqtt;
     header.type = NEU_REQ_WRITE_TAG;
 
-    cmd.driver = req->node;
-    cmd.group  = req->group;
-    cmd.tag    = req->tag;
+    cmd.driver  = req->node;
+    cmd.group   = req->group;
+    cmd.tag     = req->tag;
+    cmd.preempt = req->preempt;
+    cmd.verify  = req->verify;
 
     if (0 != json_value_to_tag_value(&req->value, req->t, &cmd.value)) {
         plog_error(plugin, "invalid tag value type: %d", req->t);
@@ -240,6 +266,8 @@ static int send_write_tags_req(neu_plugin_t *plugin, neu_json_mqtt_t *mqtt,
     cmd.group                = req->group;
     cmd.n_tag                = req->n_tag;
     cmd.tags                 = calloc(cmd.n_tag, sizeof(neu_resp_tag_value_t));
+    cmd.preempt              = req->preempt;
+    cmd.verify               = req->verify;
     if (NULL == cmd.tags) {
         return -1;
     }
@@ -267,6 +295,181 @@ static int send_write_tags_req(neu_plugin_t *plugin, neu_json_mqtt_t *mqtt,
     return 0;
 }
 
+static mqtt_write_req_t *write_req_new(neu_plugin_t *    plugin,
+                                       neu_json_write_t *req)
+{
+    mqtt_write_req_t *wr = calloc(1, sizeof(*wr));
+    if (NULL == wr) {
+        return NULL;
+    }
+
+    wr->n_tag = req->singular ? 1 : req->plural.n_tag;
+    if (wr->n_tag <= 0 ||
+        NULL == (wr->tags = calloc(wr->n_tag, sizeof(*wr->tags)))) {
+        free(wr);
+        return NULL;
+    }
+
+    for (int i = 0; i < wr->n_tag; i++) {
+        const char *          tag   = NULL;
+        enum neu_json_type    t     = NEU_JSON_UNDEFINE;
+        union neu_json_value *value = NULL;
+
+        if (req->singular) {
+            tag   = req->single.tag;
+            t     = req->single.t;
+            value = &req->single.value;
+        } else {
+            tag   = req->plural.tags[i].tag;
+            t     = req->plural.tags[i].t;
+            value = &req->plural.tags[i].value;
+        }
+
+        if ((NEU_JSON_STR == t && strlen(value->val_str) >= NEU_VALUE_SIZE) ||
+            0 != json_value_to_tag_value(value, t, &wr->tags[i].value)) {
+            plog_error(plugin, "invalid tag value type: %d", t);
+            mqtt_write_req_free(wr);
+            return NULL;
+        }
+        strncpy(wr->tags[i].tag, tag, sizeof(wr->tags[i].tag) - 1);
+    }
+
+    if (req->singular) {
+        wr->group         = req->single.group;
+        req->single.group = NULL; // ownership moved
+    } else {
+        wr->group         = req->plural.group;
+        req->plural.group = NULL; // ownership moved
+    }
+    return wr;
+}
+
+// send one request on its own, NOTE: we take ownership of `req`
+static int send_write_req(neu_plugin_t *plugin, const char *driver,
+                          mqtt_write_req_t *req)
+{
+    neu_reqresp_head_t header = {
+        .ctx  = req->mqtt,
+        .type = NEU_REQ_WRITE_TAGS,
+    };
+
+    neu_req_write_tags_t cmd = { 0 };
+    cmd.driver               = strdup(driver);
+    cmd.group                = req->group;
+    cmd.n_tag                = req->n_tag;
+    cmd.tags                 = req->tags;
+    if (NULL == cmd.driver || 0 != neu_plugin_op(plugin, header, &cmd)) {
+        plog_error(plugin, "neu_plugin_op(NEU_REQ_WRITE_TAGS) fail");
+        free(cmd.driver);
+        mqtt_write_req_free(req);
+        return -1;
+    }
+
+    req->mqtt  = NULL; // ownership moved
+    req->group = NULL; // ownership moved
+    req->tags  = NULL; // ownership moved
+    mqtt_write_req_free(req);
+    return 0;
+}
+
+// NOTE: write_mtx should be held
+static int flush_write_batch(neu_plugin_t *plugin, mqtt_write_batch_t *batch)
+{
+    if (1 == batch->n_req) {
+        // nothing to coalesce
+        mqtt_write_req_t *req = batch->head;
+        batch->head           = NULL;
+        batch->tail           = NULL;
+        batch->n_req          = 0;
+        batch->n_tag          = 0;
+        return send_write_req(plugin, batch->driver, req);
+    }
+
+    neu_req_write_gtags_t cmd = { 0 };
+    mqtt_write_ctx_t *    ctx = mqtt_write_batch_take(batch, &cmd);
+    if (NULL == ctx) {
+        // kept in the batch for the next flush
+        plog_error(plugin, "no memory for coalesced write of node:%s",
+                   batch->driver);
+        return -1;
+    }
+
+    plog_notice(plugin, "write %" PRIu32 " coalesced requests, node:%s",
+                ctx->n_req, ctx->driver);
+
+    neu_reqresp_head_t header = {
+        .ctx  = ctx,
+        .type = NEU_REQ_WRITE_GTAGS,
+    };
+
+    // before sending, as the response may come from another thread
+    HASH_ADD_PTR(plugin->write_ctxs, key, ctx);
+    if (0 != neu_plugin_op(plugin, header, &cmd)) {
+        plog_error(plugin, "neu_plugin_op(NEU_REQ_WRITE_GTAGS) fail");
+        HASH_DEL(plugin->write_ctxs, ctx);
+        neu_req_write_gtags_fini(&cmd);
+        mqtt_write_ctx_free(ctx);
+        return -1;
+    }
+
+    return 0;
+}
+
+static int coalesce_write_req(neu_plugin_t *plugin, neu_json_mqtt_t *mqtt,
+                              neu_json_write_t *req)
+{
+    const char *driver = req->singular ? req->single.node : req->plural.node;
+
+    plog_notice(plugin, "coalesce write uuid:%s, group:%s, node:%s",
+                mqtt->uuid,
+                req->singular ? req->single.group : req->plural.group, driver);
+
+    mqtt_write_req_t *wr = write_req_new(plugin, req);
+    if (NULL == wr) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&plugin->write_mtx);
+    mqtt_write_batch_t *batch = mqtt_write_batch_get(&plugin->writes, driver);
+    if (NULL == batch) {
+        pthread_mutex_unlock(&plugin->write_mtx);
+        plog_error(plugin, "no memory for write batch of node:%s", driver);
+        mqtt_write_req_free(wr);
+        return -1;
+    }
+
+    wr->mqtt = mqtt; // ownership moved
+    mqtt_write_batch_add(batch, wr, neu_time_ms());
+    if (batch->n_tag >= MQTT_WRITE_BATCH_TAGS_MAX) {
+        flush_write_batch(plugin, batch);
+    }
+    pthread_mutex_unlock(&plugin->write_mtx);
+
+    return 0;
+}
+
+int handle_flush_writes(neu_plugin_t *plugin, bool all)
+{
+    int                 rv    = 0;
+    int64_t             now   = neu_time_ms();
+    mqtt_write_batch_t *batch = NULL, *tmp = NULL;
+
+    pthread_mutex_lock(&plugin->write_mtx);
+    HASH_ITER(hh, plugin->writes, batch, tmp)
+    {
+        if (batch->n_req > 0 &&
+            (all ||
+             now - batch->first_ts >= (int64_t) plugin->config.write_linger)) {
+            if (0 != flush_write_batch(plugin, batch)) {
+                rv = NEU_ERR_EINTERNAL;
+            }
+        }
+    }
+    pthread_mutex_unlock(&plugin->write_mtx);
+
+    return rv;
+}
+
 static void publish_cb(int errcode, neu_mqtt_qos_e qos, char *topic,
                        uint8_t *payload, uint32_t len, void *data)
 {
@@ -307,6 +510,81 @@ static inline int publish(neu_plugin_t *plugin, neu_mqtt_qos_e qos, char *topic,
     return rv;
 }
 
+// a sampled trace of an upload, finished once the broker acknowledges it
+typedef struct {
+    neu_plugin_t *plugin;
+    neu_trace_t   trace;
+    char          driver[NEU_NODE_NAME_LEN];
+    char          group[NEU_GROUP_NAME_LEN];
+} upload_trace_t;
+
+static inline upload_trace_t *upload_trace_new(neu_plugin_t *            plugin,
+                                               neu_reqresp_trans_data_t *data)
+{
+    upload_trace_t *trace = NULL;
+
+    if (!neu_trace_sampled(&data->trace) ||
+        NULL == (trace = calloc(1, sizeof(*trace)))) {
+        return NULL;
+    }
+
+    trace->plugin = plugin;
+    trace->trace  = data->trace;
+    strncpy(trace->driver, data->driver, sizeof(trace->driver) - 1);
+    strncpy(trace->group, data->group, sizeof(trace->group) - 1);
+    return trace;
+}
+
+static void publish_trace_cb(int errcode, neu_mqtt_qos_e qos, char *topic,
+                             uint8_t *payload, uint32_t len, void *data)
+{
+    upload_trace_t *trace = data;
+
+    publish_cb(errcode, qos, topic, payload, len, trace->plugin);
+    if (0 == errcode) {
+        neu_trace_stamp(&trace->trace, NEU_TRACE_ACK);
+        neu_plugin_trace_done(trace->plugin, &trace->trace, trace->driver,
+                              trace->group);
+    }
+    free(trace);
+}
+
+// the client copies `buf`, the caller keeps it, `trace` is taken over and may
+// be NULL
+static inline int publish_buf_traced(neu_plugin_t *     plugin,
+                                     neu_mqtt_client_t *client,
+                                     neu_mqtt_qos_e     qos,
+                                     int                flags,
+                                     char *             topic,
+                                     const void *       buf,
+                                     size_t             len,
+                                     upload_trace_t *   trace)
+{
+    int rv = NULL == trace
+        ? neu_mqtt_client_publish_buf(client, qos, flags, topic, buf,
+                                      (uint32_t) len, plugin, publish_cb)
+        : neu_mqtt_client_publish_buf(client, qos, flags, topic, buf,
+                                      (uint32_t) len, trace, publish_trace_cb);
+    if (0 != rv) {
+        plog_error(plugin, "pub [%s, QoS%d] fail", topic, qos);
+        NEU_PLUGIN_UPDATE_METRIC(plugin, NEU_METRIC_SEND_MSG_ERRORS_TOTAL, 1,
+                                 NULL);
+        free(trace);
+        rv = NEU_ERR_MQTT_PUBLISH_FAILURE;
+    }
+
+    return rv;
+}
+
+// the client copies `buf`, the caller keeps it
+static inline int publish_buf(neu_plugin_t *plugin, neu_mqtt_client_t *client,
+                              neu_mqtt_qos_e qos, int flags, char *topic,
+                              const void *buf, size_t len)
+{
+    return publish_buf_traced(plugin, client, qos, flags, topic, buf, len,
+                              NULL);
+}
+
 void handle_write_req(neu_mqtt_qos_e qos, const char *topic,
                       const uint8_t *payload, uint32_t len, void *data)
 {
@@ -349,7 +627,9 @@ void handle_write_req(neu_mqtt_qos_e qos, const char *topic,
         return;
     }
 
-    if (req->singular) {
+    if (plugin->config.write_linger > 0) {
+        rv = coalesce_write_req(plugin, mqtt, req);
+    } else if (req->singular) {
         rv = send_write_tag_req(plugin, mqtt, &req->single);
     } else {
         rv = send_write_tags_req(plugin, mqtt, &req->plural);
@@ -362,7 +642,7 @@ void handle_write_req(neu_mqtt_qos_e qos, const char *topic,
     free(json_str);
 }
 
-int handle_write_response(neu_plugin_t *plugin, neu_json_mqtt_t *mqtt_json,
+static int write_response(neu_plugin_t *plugin, neu_json_mqtt_t *mqtt_json,
                           neu_resp_error_t *data)
 {
     int   rv       = 0;
@@ -398,6 +678,72 @@ end:
     return rv;
 }
 
+static int coalesced_write_response(neu_plugin_t *plugin, mqtt_write_ctx_t *ctx,
+                                    neu_resp_error_t *data)
+{
+    int rv = 0;
+
+    if (NEU_ERR_GROUP_NOT_EXIST == data->error ||
+        NEU_ERR_TAG_NOT_EXIST == data->error) {
+        // the driver rejects the whole write before writing anything, so send
+        // the requests again one by one to tell which of them are invalid
+        plog_notice(plugin, "coalesced write of node:%s fail, error:%d, retry "
+                    "%" PRIu32 " requests one by one",
+                    ctx->driver, data->error, ctx->n_req);
+        for (mqtt_write_req_t *req = ctx->reqs, *next = NULL; req; req = next) {
+            next = req->next;
+            if (0 != send_write_req(plugin, ctx->driver, req)) {
+                rv = NEU_ERR_EINTERNAL;
+            }
+        }
+        ctx->reqs = NULL;
+    } else {
+        for (mqtt_write_req_t *req = ctx->reqs; req; req = req->next) {
+            int ret   = write_response(plugin, req->mqtt, data);
+            req->mqtt = NULL; // freed by write_response
+            if (0 != ret) {
+                rv = ret;
+            }
+        }
+    }
+
+    mqtt_write_ctx_free(ctx);
+    return rv;
+}
+
+int handle_write_response(neu_plugin_t *plugin, void *ctx,
+                          neu_resp_error_t *data)
+{
+    mqtt_write_ctx_t *wctx = NULL;
+
+    pthread_mutex_lock(&plugin->write_mtx);
+    HASH_FIND_PTR(plugin->write_ctxs, &ctx, wctx);
+    if (NULL != wctx) {
+        HASH_DEL(plugin->write_ctxs, wctx);
+    }
+    pthread_mutex_unlock(&plugin->write_mtx);
+
+    if (NULL != wctx) {
+        return coalesced_write_response(plugin, wctx, data);
+    }
+    return write_response(plugin, ctx, data);
+}
+
+void handle_sparkplug_ncmd(neu_mqtt_qos_e qos, const char *topic,
+                           const uint8_t *payload, uint32_t len, void *data)
+{
+    (void) qos;
+
+    neu_plugin_t *plugin = data;
+
+    NEU_PLUGIN_UPDATE_METRIC(plugin, NEU_METRIC_RECV_MSGS_TOTAL, 1, NULL);
+    if (mqtt_sparkplug_is_rebirth(payload, len)) {
+        // births are published along with the next upload
+        plog_notice(plugin, "sparkplug rebirth requested on %s", topic);
+        __atomic_store_n(&plugin->sparkplug.rebirth, 1, __ATOMIC_RELAXED);
+    }
+}
+
 void handle_read_req(neu_mqtt_qos_e qos, const char *topic,
                      const uint8_t *payload, uint32_t len, void *data)
 {
@@ -484,40 +830,352 @@ end:
     return rv;
 }
 
-int handle_trans_data(neu_plugin_t *            plugin,
-                      neu_reqresp_trans_data_t *trans_data)
+// the route or batch hash always maps to the same connection, so that the
+// uploads of a group keep their order
+static inline neu_mqtt_client_t *upload_client(neu_plugin_t *plugin,
+                                               unsigned      hashv)
 {
-    int rv = 0;
+    size_t i = hashv % (plugin->pool_size + 1);
+    return 0 == i ? plugin->client : plugin->pool[i - 1];
+}
+
+static inline neu_mqtt_qos_e route_qos(neu_plugin_t * plugin,
+                                       route_entry_t *route)
+{
+    return route->qos < 0 ? plugin->config.qos : (neu_mqtt_qos_e) route->qos;
+}
+
+// messages of the topic were lost and may have carried new msgpack tag names
+// or changed values, send them again
+static void upload_lost(neu_plugin_t *plugin, const char *topic)
+{
+    route_entry_t *e = NULL, *tmp = NULL;
+
+    HASH_ITER(hh, plugin->route_tbl, e, tmp)
+    {
+        if (0 == strcmp(e->topic, topic)) {
+            mqtt_tag_dict_clear(&e->dict);
+            mqtt_delta_clear(&e->delta);
+        }
+    }
+}
+
+// keep the tags a changed-only route uploads in `out`, return 1 if no tag
+// changed
+static int delta_trans_data(neu_plugin_t *plugin, route_entry_t *route,
+                            neu_reqresp_trans_data_t **data,
+                            neu_reqresp_trans_data_t * out)
+{
+    if (!route->delta.config.changed_only) {
+        return 0;
+    }
+
+    UT_array *tags =
+        mqtt_delta_filter(&route->delta, (*data)->tags, global_timestamp);
+    if (NULL == tags) {
+        plog_error(plugin, "no memory for changed tags of topic:%s",
+                   route->topic);
+        return -1;
+    }
+    if (0 == utarray_len(tags)) {
+        return 1;
+    }
+
+    *out      = **data;
+    out->tags = tags;
+    *data     = out;
+    return 0;
+}
+
+// must be called with batch_mtx held
+static int flush_batch(neu_plugin_t *plugin, mqtt_batch_t *batch)
+{
+    mqtt_upload_format_e format  = plugin->config.format;
+    size_t               len     = 0;
+    const uint8_t *      payload = mqtt_batch_finish(
+        batch, MQTT_UPLOAD_FORMAT_MSGPACK == format, &len);
+    if (NULL == payload) {
+        return 0;
+    }
+
+    // the trace rides on the publish of the batch
+    upload_trace_t *trace = batch->trace;
+    batch->trace          = NULL;
+
+    int rv = publish_buf_traced(plugin, upload_client(plugin, batch->hh.hashv),
+                                batch->qos, batch->flags, batch->topic,
+                                payload, len, trace);
+    if (0 != rv) {
+        batch->lost = true;
+    }
+    return rv;
+}
+
+int handle_flush_batches(neu_plugin_t *plugin, bool all)
+{
+    int           rv    = 0;
+    int64_t       now   = neu_time_ms();
+    mqtt_batch_t *batch = NULL, *tmp = NULL;
 
     if (NULL == plugin->client) {
         return NEU_ERR_MQTT_IS_NULL;
     }
 
-    if (0 == plugin->config.cache &&
-        !neu_mqtt_client_is_connected(plugin->client)) {
-        // cache disable and we are disconnected
-        return NEU_ERR_MQTT_FAILURE;
+    pthread_mutex_lock(&plugin->batch_mtx);
+    HASH_ITER(hh, plugin->batches, batch, tmp)
+    {
+        if (batch->count > 0 &&
+            (all ||
+             now - batch->first_ts >= (int64_t) plugin->config.batch_linger)) {
+            int ret = flush_batch(plugin, batch);
+            if (0 != ret) {
+                rv = ret;
+            }
+        }
+    }
+    pthread_mutex_unlock(&plugin->batch_mtx);
+
+    return rv;
+}
+
+static int batch_trans_data(neu_plugin_t *plugin, route_entry_t *route,
+                            neu_reqresp_trans_data_t *trans_data)
+{
+    int           rv      = 0;
+    const void *  buf     = NULL;
+    size_t        len     = 0;
+    size_t        limit   = plugin->config.batch_size;
+    bool          msgpack = MQTT_UPLOAD_FORMAT_MSGPACK == plugin->config.format;
+    mqtt_batch_t *batch   = NULL;
+
+    neu_reqresp_trans_data_t delta_data = { 0 };
+
+    pthread_mutex_lock(&plugin->batch_mtx);
+
+    batch = mqtt_batch_get(&plugin->batches, route->topic);
+    if (NULL == batch) {
+        plog_error(plugin, "no memory for batch of topic:%s", route->topic);
+        rv = NEU_ERR_EINTERNAL;
+        goto end;
+    }
+    if (batch->lost) {
+        // before encoding, so this message defines the names again
+        upload_lost(plugin, batch->topic);
+        batch->lost = false;
+    }
+
+    rv = delta_trans_data(plugin, route, &trans_data, &delta_data);
+    if (0 != rv) {
+        rv = rv > 0 ? 0 : NEU_ERR_EINTERNAL;
+        goto end;
+    }
+
+    if (0 != encode_upload(plugin, route, trans_data, &buf, &len)) {
+        plog_error(plugin, "generate upload data fail");
+        rv = NEU_ERR_EINTERNAL;
+        goto end;
+    }
+
+    if (batch->count > 0 && mqtt_batch_size_with(batch, len) > limit) {
+        rv = flush_batch(plugin, batch);
+    }
+
+    if (0 != mqtt_batch_append(batch, msgpack, buf, len, neu_time_ms())) {
+        plog_error(plugin, "no memory for batch of topic:%s", batch->topic);
+        upload_lost(plugin, batch->topic);
+        rv = NEU_ERR_EINTERNAL;
+        goto end;
+    }
+    if (NULL == batch->trace) {
+        batch->trace = upload_trace_new(plugin, trans_data);
+    }
+    // a batch is delivered as reliably as its most demanding route asks for
+    if (batch->qos < (int) route_qos(plugin, route)) {
+        batch->qos = route_qos(plugin, route);
+    }
+    batch->flags |= route->flags;
+
+    if (batch->len >= limit) {
+        int ret = flush_batch(plugin, batch);
+        if (0 != ret) {
+            rv = ret;
+        }
+    }
+
+end:
+    pthread_mutex_unlock(&plugin->batch_mtx);
+    return rv;
+}
+
+// sparkplug messages are QoS 0, as the specification requires, must be called
+// with sparkplug_mtx held
+static int sparkplug_trans_data(neu_plugin_t *            plugin,
+                                neu_reqresp_trans_data_t *trans_data)
+{
+    mqtt_sparkplug_t *  sp    = &plugin->sparkplug;
+    sparkplug_device_t *dev   = NULL;
+    bool                birth = false;
+    int                 rv    = 0;
+
+    if (__atomic_exchange_n(&sp->rebirth, 0, __ATOMIC_RELAXED) ||
+        !sp->node_born) {
+        if (0 != mqtt_sparkplug_encode_nbirth(sp, global_timestamp)) {
+            plog_error(plugin, "encode sparkplug NBIRTH fail");
+            return NEU_ERR_EINTERNAL;
+        }
+        rv = publish_buf(plugin, plugin->client, NEU_MQTT_QOS0, 0,
+                         sp->nbirth_topic, sp->payload.buf, sp->payload.len);
+        if (0 != rv) {
+            sp->node_born = false;
+            return rv;
+        }
+    }
+
+    dev = mqtt_sparkplug_device(sp, trans_data->driver, true);
+    if (NULL == dev) {
+        plog_error(plugin, "no memory for sparkplug device %s",
+                   trans_data->driver);
+        return NEU_ERR_EINTERNAL;
+    }
+
+    if (0 !=
+        mqtt_sparkplug_encode_group(sp, dev, trans_data->group,
+                                    global_timestamp, trans_data->tags,
+                                    &birth)) {
+        plog_error(plugin, "encode sparkplug data fail");
+        return NEU_ERR_EINTERNAL;
+    }
+    if (0 == sp->payload.len) {
+        return 0; // nothing changed
+    }
+
+    rv = publish_buf_traced(plugin, plugin->client, NEU_MQTT_QOS0, 0,
+                            birth ? dev->birth_topic : dev->data_topic,
+                            sp->payload.buf, sp->payload.len,
+                            upload_trace_new(plugin, trans_data));
+    if (0 != rv) {
+        // changes are lost, report all metrics again
+        dev->born = false;
+    }
+    return rv;
+}
+
+// drop metrics of a group, or of the whole driver if `group` is NULL
+static void sparkplug_drop(neu_plugin_t *plugin, const char *driver,
+                           const char *group)
+{
+    mqtt_sparkplug_t *  sp  = &plugin->sparkplug;
+    sparkplug_device_t *dev = NULL;
+
+    if (MQTT_UPLOAD_FORMAT_SPARKPLUG_B != plugin->config.format) {
+        return;
     }
 
-    const route_entry_t *route = route_tbl_get(
-        &plugin->route_tbl, trans_data->driver, trans_data->group);
+    pthread_mutex_lock(&plugin->sparkplug_mtx);
+    if (NULL != (dev = mqtt_sparkplug_device(sp, driver, false)) &&
+        mqtt_sparkplug_drop(sp, dev, group) && NULL != plugin->client &&
+        0 == mqtt_sparkplug_encode_ddeath(sp, dev, global_timestamp)) {
+        publish_buf(plugin, plugin->client, NEU_MQTT_QOS0, 0, dev->death_topic,
+                    sp->payload.buf, sp->payload.len);
+    }
+    pthread_mutex_unlock(&plugin->sparkplug_mtx);
+}
+
+static int publish_trans_data(neu_plugin_t *            plugin,
+                              neu_reqresp_trans_data_t *trans_data)
+{
+    int                      rv         = 0;
+    const void *             buf        = NULL;
+    size_t                   len        = 0;
+    neu_reqresp_trans_data_t delta_data = { 0 };
+
+    route_entry_t *route = route_tbl_get(&plugin->route_tbl, trans_data->driver,
+                                         trans_data->group);
     if (NULL == route) {
         plog_error(plugin, "no route for driver:%s group:%s",
                    trans_data->driver, trans_data->group);
         return NEU_ERR_GROUP_NOT_SUBSCRIBE;
     }
 
-    char *json_str =
-        generate_upload_json(plugin, trans_data, plugin->config.format);
-    if (NULL == json_str) {
-        plog_error(plugin, "generate upload json fail");
+    if (MQTT_UPLOAD_FORMAT_SPARKPLUG_B == plugin->config.format) {
+        pthread_mutex_lock(&plugin->sparkplug_mtx);
+        rv = sparkplug_trans_data(plugin, trans_data);
+        pthread_mutex_unlock(&plugin->sparkplug_mtx);
+        return rv;
+    }
+
+    if (plugin->config.batch_size > 0) {
+        return batch_trans_data(plugin, route, trans_data);
+    }
+
+    rv = delta_trans_data(plugin, route, &trans_data, &delta_data);
+    if (0 != rv) {
+        return rv > 0 ? 0 : NEU_ERR_EINTERNAL;
+    }
+
+    if (0 != encode_upload(plugin, route, trans_data, &buf, &len)) {
+        plog_error(plugin, "generate upload data fail");
         return NEU_ERR_EINTERNAL;
     }
 
-    char *         topic = route->topic;
-    neu_mqtt_qos_e qos   = plugin->config.qos;
-    rv       = publish(plugin, qos, topic, json_str, strlen(json_str));
-    json_str = NULL;
+    rv = publish_buf_traced(plugin, upload_client(plugin, route->hh.hashv),
+                            route_qos(plugin, route), route->flags,
+                            route->topic, buf, len,
+                            upload_trace_new(plugin, trans_data));
+    if (0 != rv) {
+        // the message may have carried new msgpack tag names or changed values
+        mqtt_tag_dict_clear(&route->dict);
+        mqtt_delta_clear(&route->delta);
+    }
+
+    return rv;
+}
+
+// n is the number of messages dropped if the trans data can not be published
+static int check_trans_data(neu_plugin_t *plugin, uint16_t n)
+{
+    if (NULL == plugin->client) {
+        NEU_PLUGIN_UPDATE_METRIC(plugin, NEU_METRIC_SEND_MSGS_DROPPED_TOTAL, n,
+                                 NULL);
+        return NEU_ERR_MQTT_IS_NULL;
+    }
+
+    if (0 == plugin->config.cache &&
+        !neu_mqtt_client_is_connected(plugin->client)) {
+        // cache disable and we are disconnected
+        NEU_PLUGIN_UPDATE_METRIC(plugin, NEU_METRIC_SEND_MSGS_DROPPED_TOTAL, n,
+                                 NULL);
+        return NEU_ERR_MQTT_FAILURE;
+    }
+
+    return 0;
+}
+
+int handle_trans_data(neu_plugin_t *            plugin,
+                      neu_reqresp_trans_data_t *trans_data)
+{
+    int rv = check_trans_data(plugin, 1);
+    if (0 != rv) {
+        return rv;
+    }
+
+    return publish_trans_data(plugin, trans_data);
+}
+
+int handle_trans_data_batch(neu_plugin_t *                  plugin,
+                            neu_reqresp_trans_data_batch_t *batch)
+{
+    int rv = check_trans_data(plugin, batch->n_data);
+    if (0 != rv) {
+        return rv;
+    }
+
+    for (uint16_t i = 0; i < batch->n_data; ++i) {
+        int ret = publish_trans_data(plugin, &batch->datas[i]);
+        if (0 != ret) {
+            rv = ret;
+        }
+    }
 
     return rv;
 }
@@ -529,9 +1187,99 @@ static inline char *default_upload_topic(neu_req_subscribe_t *info)
     return t;
 }
 
+// the optional delivery settings of a route, besides the topic
+//   `{"topic": "...", "qos": 1, "retain": false, "policy": "drop-oldest",
+//     "changed-only": true, "deadband": 0.5, "keyframe-interval": 60000}`
+// a route without qos follows the plugin setting, and the policy decides what
+// happens to its uploads while offline with the cache full: "drop-oldest"
+// makes room by dropping the oldest cached messages, "block" keeps them and
+// fails the upload instead. see mqtt_delta.h for the changed-only settings
+static int parse_route_params(neu_plugin_t *plugin, const char *params,
+                              int *qos, int *flags, mqtt_delta_config_t *delta)
+{
+    int             rv           = 0;
+    neu_json_elem_t qos_elem     = {
+        .name      = "qos",
+        .t         = NEU_JSON_INT,
+        .v.val_int = -1,
+        .attribute = NEU_JSON_ATTRIBUTE_OPTIONAL,
+    };
+    neu_json_elem_t retain       = {
+        .name       = "retain",
+        .t          = NEU_JSON_BOOL,
+        .v.val_bool = false,
+        .attribute  = NEU_JSON_ATTRIBUTE_OPTIONAL,
+    };
+    neu_json_elem_t policy       = {
+        .name      = "policy",
+        .t         = NEU_JSON_STR,
+        .v.val_str = NULL,
+        .attribute = NEU_JSON_ATTRIBUTE_OPTIONAL,
+    };
+    neu_json_elem_t changed_only = {
+        .name       = "changed-only",
+        .t          = NEU_JSON_BOOL,
+        .v.val_bool = false,
+        .attribute  = NEU_JSON_ATTRIBUTE_OPTIONAL,
+    };
+    neu_json_elem_t deadband     = {
+        .name         = "deadband",
+        .t            = NEU_JSON_DOUBLE,
+        .v.val_double = 0,
+        .attribute    = NEU_JSON_ATTRIBUTE_OPTIONAL,
+    };
+    neu_json_elem_t keyframe     = {
+        .name      = "keyframe-interval",
+        .t         = NEU_JSON_INT,
+        .v.val_int = 0,
+        .attribute = NEU_JSON_ATTRIBUTE_OPTIONAL,
+    };
+
+    if (0 !=
+        neu_parse_param(params, NULL, 6, &qos_elem, &retain, &policy,
+                        &changed_only, &deadband, &keyframe)) {
+        plog_error(plugin, "parse `%s` for delivery settings fail", params);
+        return NEU_ERR_GROUP_PARAMETER_INVALID;
+    }
+
+    if (qos_elem.v.val_int < -1 || NEU_MQTT_QOS2 < qos_elem.v.val_int) {
+        plog_error(plugin, "invalid route qos: %" PRIi64, qos_elem.v.val_int);
+        rv = NEU_ERR_GROUP_PARAMETER_INVALID;
+        goto end;
+    }
+
+    if (!(deadband.v.val_double >= 0) || keyframe.v.val_int < 0) {
+        plog_error(plugin, "invalid route deadband: %f or keyframe: %" PRIi64,
+                   deadband.v.val_double, keyframe.v.val_int);
+        rv = NEU_ERR_GROUP_PARAMETER_INVALID;
+        goto end;
+    }
+
+    *qos                = (int) qos_elem.v.val_int;
+    *flags              = retain.v.val_bool ? NEU_MQTT_PUBLISH_RETAIN : 0;
+    delta->changed_only = changed_only.v.val_bool;
+    delta->deadband     = deadband.v.val_double;
+    delta->keyframe     = keyframe.v.val_int;
+
+    if (NULL != policy.v.val_str && 0 == strcmp(policy.v.val_str, "block")) {
+        *flags |= NEU_MQTT_PUBLISH_NO_EVICT;
+    } else if (NULL != policy.v.val_str &&
+               0 != strcmp(policy.v.val_str, "drop-oldest")) {
+        plog_error(plugin, "invalid route policy: %s", policy.v.val_str);
+        rv = NEU_ERR_GROUP_PARAMETER_INVALID;
+    }
+
+end:
+    free(policy.v.val_str);
+    return rv;
+}
+
 int handle_subscribe_group(neu_plugin_t *plugin, neu_req_subscribe_t *sub_info)
 {
-    int rv = 0;
+    int                 rv    = 0;
+    int                 qos   = -1;
+    int                 flags = 0;
+    mqtt_delta_config_t delta = { 0 };
 
     neu_json_elem_t topic = { .name = "topic", .t = NEU_JSON_STR };
     if (NULL == sub_info->params) {
@@ -545,10 +1293,16 @@ int handle_subscribe_group(neu_plugin_t *plugin, neu_req_subscribe_t *sub_info)
         plog_error(plugin, "parse `%s` for topic fail", sub_info->params);
         rv = NEU_ERR_GROUP_PARAMETER_INVALID;
         goto end;
+    } else if (0 !=
+               (rv = parse_route_params(plugin, sub_info->params, &qos,
+                                        &flags, &delta))) {
+        free(topic.v.val_str);
+        goto end;
     }
 
     rv = route_tbl_add_new(&plugin->route_tbl, sub_info->driver,
-                           sub_info->group, topic.v.val_str);
+                           sub_info->group, topic.v.val_str, qos, flags,
+                           &delta);
     // topic.v.val_str ownership moved
     if (0 != rv) {
         plog_error(plugin, "route driver:%s group:%s fail, `%s`",
@@ -566,7 +1320,10 @@ end:
 
 int handle_update_subscribe(neu_plugin_t *plugin, neu_req_subscribe_t *sub_info)
 {
-    int rv = 0;
+    int                 rv    = 0;
+    int                 qos   = -1;
+    int                 flags = 0;
+    mqtt_delta_config_t delta = { 0 };
 
     if (NULL == sub_info->params) {
         rv = NEU_ERR_GROUP_PARAMETER_INVALID;
@@ -580,8 +1337,14 @@ int handle_update_subscribe(neu_plugin_t *plugin, neu_req_subscribe_t *sub_info)
         goto end;
     }
 
+    rv = parse_route_params(plugin, sub_info->params, &qos, &flags, &delta);
+    if (0 != rv) {
+        free(topic.v.val_str);
+        goto end;
+    }
+
     rv = route_tbl_update(&plugin->route_tbl, sub_info->driver, sub_info->group,
-                          topic.v.val_str);
+                          topic.v.val_str, qos, flags, &delta);
     // topic.v.val_str ownership moved
     if (0 != rv) {
         plog_error(plugin, "route driver:%s group:%s fail, `%s`",
@@ -601,6 +1364,7 @@ int handle_unsubscribe_group(neu_plugin_t *         plugin,
                              neu_req_unsubscribe_t *unsub_info)
 {
     route_tbl_del(&plugin->route_tbl, unsub_info->driver, unsub_info->group);
+    sparkplug_drop(plugin, unsub_info->driver, unsub_info->group);
     plog_notice(plugin, "del route driver:%s group:%s", unsub_info->driver,
                 unsub_info->group);
     return 0;
@@ -609,6 +1373,7 @@ int handle_unsubscribe_group(neu_plugin_t *         plugin,
 int handle_del_group(neu_plugin_t *plugin, neu_req_del_group_t *req)
 {
     route_tbl_del(&plugin->route_tbl, req->driver, req->group);
+    sparkplug_drop(plugin, req->driver, req->group);
     plog_notice(plugin, "del route driver:%s group:%s", req->driver,
                 req->group);
     return 0;
@@ -618,6 +1383,8 @@ int handle_update_group(neu_plugin_t *plugin, neu_req_update_group_t *req)
 {
     route_tbl_update_group(&plugin->route_tbl, req->driver, req->group,
                            req->new_name);
+    // metrics are named after the group, they are born again with the new name
+    sparkplug_drop(plugin, req->driver, req->group);
     plog_notice(plugin, "update route driver:%s group:%s to %s", req->driver,
                 req->group, req->new_name);
     return 0;
@@ -626,6 +1393,8 @@ int handle_update_group(neu_plugin_t *plugin, neu_req_update_group_t *req)
 int handle_update_driver(neu_plugin_t *plugin, neu_req_update_node_t *req)
 {
     route_tbl_update_driver(&plugin->route_tbl, req->node, req->new_name);
+    // the device of the old name is gone
+    sparkplug_drop(plugin, req->node, NULL);
     plog_notice(plugin, "update route driver:%s to %s", req->node,
                 req->new_name);
     return 0;
@@ -634,6 +1403,7 @@ int handle_update_driver(neu_plugin_t *plugin, neu_req_update_node_t *req)
 int handle_del_driver(neu_plugin_t *plugin, neu_reqresp_node_deleted_t *req)
 {
     route_tbl_del_driver(&plugin->route_tbl, req->node);
+    sparkplug_drop(plugin, req->node, NULL);
     plog_notice(plugin, "delete route driver:%s", req->node);
     return 0;
 }
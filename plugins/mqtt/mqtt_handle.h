@@ -30,17 +30,27 @@ extern "C" {
 void handle_write_req(neu_mqtt_qos_e qos, const char *topic,
                       const uint8_t *payload, uint32_t len, void *data);
 
-int handle_write_response(neu_plugin_t *plugin, neu_json_mqtt_t *mqtt_json,
+// `ctx` is the context of the write request the response belongs to
+int handle_write_response(neu_plugin_t *plugin, void *ctx,
                           neu_resp_error_t *data);
+// send coalesced writes that lingered long enough, or all pending ones
+int handle_flush_writes(neu_plugin_t *plugin, bool all);
 
 void handle_read_req(neu_mqtt_qos_e qos, const char *topic,
                      const uint8_t *payload, uint32_t len, void *data);
 
+void handle_sparkplug_ncmd(neu_mqtt_qos_e qos, const char *topic,
+                           const uint8_t *payload, uint32_t len, void *data);
+
 int handle_read_response(neu_plugin_t *plugin, neu_json_mqtt_t *mqtt_json,
                          neu_resp_read_group_t *data);
 
 int handle_trans_data(neu_plugin_t *            plugin,
                       neu_reqresp_trans_data_t *trans_data);
+int handle_trans_data_batch(neu_plugin_t *                  plugin,
+                            neu_reqresp_trans_data_batch_t *batch);
+// publish batches that lingered long enough, or all nonempty ones
+int handle_flush_batches(neu_plugin_t *plugin, bool all);
 
 int handle_subscribe_group(neu_plugin_t *plugin, neu_req_subscribe_t *sub_info);
 int handle_update_subscribe(neu_plugin_t *       plugin,
@@ -0,0 +1,424 @@
+/**
+ * NEURON IIoT System for Industry 4.0
+ * Copyright (C) 2020-2023 EMQ Technologies Co., Ltd All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ **/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "utils/utextend.h"
+
+#include "mqtt_msgpack.h"
+
+void mqtt_tag_dict_clear(mqtt_tag_dict_t *dict)
+{
+    mqtt_tag_id_t *e = NULL, *tmp = NULL;
+    HASH_ITER(hh, dict->ids, e, tmp)
+    {
+        HASH_DEL(dict->ids, e);
+        free(e);
+    }
+    dict->next    = 0;
+    dict->session = 0;
+}
+
+void mqtt_msgpack_fini(mqtt_msgpack_t *mp)
+{
+    free(mp->buf);
+    free(mp->ids);
+    memset(mp, 0, sizeof(*mp));
+}
+
+static int reserve(mqtt_msgpack_t *mp, size_t n)
+{
+    if (mp->len + n <= mp->cap) {
+        return 0;
+    }
+
+    size_t cap = mp->cap ? mp->cap : 512;
+    while (cap < mp->len + n) {
+        cap *= 2;
+    }
+
+    uint8_t *buf = realloc(mp->buf, cap);
+    if (NULL == buf) {
+        return -1;
+    }
+    mp->buf = buf;
+    mp->cap = cap;
+    return 0;
+}
+
+static int put(mqtt_msgpack_t *mp, const void *data, size_t n)
+{
+    if (reserve(mp, n) != 0) {
+        return -1;
+    }
+    memcpy(mp->buf + mp->len, data, n);
+    mp->len += n;
+    return 0;
+}
+
+// marker followed by `n` bytes of `v` in big endian
+static int put_be(mqtt_msgpack_t *mp, uint8_t marker, uint64_t v, int n)
+{
+    uint8_t b[9] = { marker };
+
+    for (int i = n; i > 0; i--) {
+        b[i] = v & 0xff;
+        v >>= 8;
+    }
+    return put(mp, b, n + 1);
+}
+
+static int put_uint(mqtt_msgpack_t *mp, uint64_t v)
+{
+    if (v < 0x80) {
+        uint8_t b = v;
+        return put(mp, &b, 1);
+    } else if (v <= UINT8_MAX) {
+        return put_be(mp, 0xcc, v, 1);
+    } else if (v <= UINT16_MAX) {
+        return put_be(mp, 0xcd, v, 2);
+    } else if (v <= UINT32_MAX) {
+        return put_be(mp, 0xce, v, 4);
+    } else {
+        return put_be(mp, 0xcf, v, 8);
+    }
+}
+
+static int put_int(mqtt_msgpack_t *mp, int64_t v)
+{
+    if (v >= 0) {
+        return put_uint(mp, v);
+    } else if (v >= -32) {
+        uint8_t b = (uint8_t) v;
+        return put(mp, &b, 1);
+    } else if (v >= INT8_MIN) {
+        return put_be(mp, 0xd0, (uint64_t) v, 1);
+    } else if (v >= INT16_MIN) {
+        return put_be(mp, 0xd1, (uint64_t) v, 2);
+    } else if (v >= INT32_MIN) {
+        return put_be(mp, 0xd2, (uint64_t) v, 4);
+    } else {
+        return put_be(mp, 0xd3, (uint64_t) v, 8);
+    }
+}
+
+static int put_float(mqtt_msgpack_t *mp, float v)
+{
+    uint32_t u = 0;
+    memcpy(&u, &v, sizeof(u));
+    return put_be(mp, 0xca, u, 4);
+}
+
+static int put_double(mqtt_msgpack_t *mp, double v)
+{
+    uint64_t u = 0;
+    memcpy(&u, &v, sizeof(u));
+    return put_be(mp, 0xcb, u, 8);
+}
+
+static int put_bool(mqtt_msgpack_t *mp, bool v)
+{
+    uint8_t b = v ? 0xc3 : 0xc2;
+    return put(mp, &b, 1);
+}
+
+// str when `marker` is 0xd9, bin when it is 0xc4
+static int put_raw(mqtt_msgpack_t *mp, uint8_t marker, const void *data,
+                   size_t n)
+{
+    int ret = 0;
+
+    if (marker == 0xd9 && n < 32) {
+        uint8_t b = 0xa0 | n;
+        ret       = put(mp, &b, 1);
+    } else if (n <= UINT8_MAX) {
+        ret = put_be(mp, marker, n, 1);
+    } else if (n <= UINT16_MAX) {
+        ret = put_be(mp, marker + 1, n, 2);
+    } else {
+        ret = put_be(mp, marker + 2, n, 4);
+    }
+    return ret == 0 ? put(mp, data, n) : -1;
+}
+
+static int put_str(mqtt_msgpack_t *mp, const char *str, size_t max)
+{
+    return put_raw(mp, 0xd9, str, strnlen(str, max));
+}
+
+static int put_map(mqtt_msgpack_t *mp, uint32_t n)
+{
+    if (n < 16) {
+        uint8_t b = 0x80 | n;
+        return put(mp, &b, 1);
+    } else if (n <= UINT16_MAX) {
+        return put_be(mp, 0xde, n, 2);
+    } else {
+        return put_be(mp, 0xdf, n, 4);
+    }
+}
+
+static int put_key(mqtt_msgpack_t *mp, const char *key)
+{
+    return put_raw(mp, 0xd9, key, strlen(key));
+}
+
+static bool value_known(const neu_dvalue_t *value)
+{
+    switch (value->type) {
+    case NEU_TYPE_INT8:
+    case NEU_TYPE_UINT8:
+    case NEU_TYPE_INT16:
+    case NEU_TYPE_UINT16:
+    case NEU_TYPE_INT32:
+    case NEU_TYPE_UINT32:
+    case NEU_TYPE_INT64:
+    case NEU_TYPE_UINT64:
+    case NEU_TYPE_WORD:
+    case NEU_TYPE_DWORD:
+    case NEU_TYPE_LWORD:
+    case NEU_TYPE_FLOAT:
+    case NEU_TYPE_DOUBLE:
+    case NEU_TYPE_BOOL:
+    case NEU_TYPE_BIT:
+    case NEU_TYPE_STRING:
+    case NEU_TYPE_BYTES:
+        return true;
+    case NEU_TYPE_PTR:
+        return value->value.ptr.ptr != NULL;
+    default:
+        return false;
+    }
+}
+
+static int put_value(mqtt_msgpack_t *mp, const neu_dvalue_t *value)
+{
+    const neu_value_u *v = &value->value;
+
+    switch (value->type) {
+    case NEU_TYPE_INT8:
+        return put_int(mp, v->i8);
+    case NEU_TYPE_INT16:
+        return put_int(mp, v->i16);
+    case NEU_TYPE_INT32:
+        return put_int(mp, v->i32);
+    case NEU_TYPE_INT64:
+        return put_int(mp, v->i64);
+    case NEU_TYPE_BIT:
+    case NEU_TYPE_UINT8:
+        return put_uint(mp, v->u8);
+    case NEU_TYPE_WORD:
+    case NEU_TYPE_UINT16:
+        return put_uint(mp, v->u16);
+    case NEU_TYPE_DWORD:
+    case NEU_TYPE_UINT32:
+        return put_uint(mp, v->u32);
+    case NEU_TYPE_LWORD:
+    case NEU_TYPE_UINT64:
+        return put_uint(mp, v->u64);
+    case NEU_TYPE_FLOAT:
+        return put_float(mp, v->f32);
+    case NEU_TYPE_DOUBLE:
+        return put_double(mp, v->d64);
+    case NEU_TYPE_BOOL:
+        return put_bool(mp, v->boolean);
+    case NEU_TYPE_STRING:
+        return put_str(mp, v->str, sizeof(v->str));
+    case NEU_TYPE_BYTES:
+        return put_raw(mp, 0xc4, v->bytes.bytes, v->bytes.length);
+    case NEU_TYPE_PTR:
+        if (v->ptr.type == NEU_TYPE_BYTES) {
+            return put_raw(mp, 0xc4, v->ptr.ptr, v->ptr.length);
+        }
+        return put_str(mp, (char *) v->ptr.ptr, v->ptr.length);
+    default:
+        return -1;
+    }
+}
+
+static inline bool tag_is_error(const neu_resp_tag_value_meta_t *tag)
+{
+    return tag->value.type == NEU_TYPE_ERROR;
+}
+
+static uint32_t tag_n_meta(const neu_resp_tag_value_meta_t *tag)
+{
+    uint32_t n = 0;
+
+    for (int k = 0; k < NEU_TAG_META_SIZE && tag->metas[k].name[0] != '\0';
+         k++) {
+        n += value_known(&tag->metas[k].value);
+    }
+    return n;
+}
+
+// look up or assign the id of every tag, returns the first newly assigned id
+static int assign_ids(mqtt_msgpack_t *mp, mqtt_tag_dict_t *dict,
+                      UT_array *tags, uint32_t *first_new)
+{
+    size_t n = utarray_len(tags);
+
+    if (n > mp->n_ids) {
+        uint32_t *ids = realloc(mp->ids, n * sizeof(*ids));
+        if (NULL == ids) {
+            return -1;
+        }
+        mp->ids   = ids;
+        mp->n_ids = n;
+    }
+
+    *first_new = dict->next;
+    for (size_t i = 0; i < n; i++) {
+        neu_resp_tag_value_meta_t *tag = utarray_eltptr(tags, i);
+        mqtt_tag_id_t *            e   = NULL;
+
+        HASH_FIND_STR(dict->ids, tag->tag, e);
+        if (NULL == e) {
+            e = calloc(1, sizeof(*e));
+            if (NULL == e) {
+                return -1;
+            }
+            strncpy(e->name, tag->tag, sizeof(e->name) - 1);
+            e->id = dict->next++;
+            HASH_ADD_STR(dict->ids, name, e);
+        }
+        mp->ids[i] = e->id;
+    }
+    return 0;
+}
+
+int mqtt_msgpack_encode_upload(mqtt_msgpack_t *mp, mqtt_tag_dict_t *dict,
+                               uint64_t session, const char *node,
+                               const char *group, uint64_t timestamp,
+                               UT_array *tags)
+{
+    uint32_t first_new = 0;
+    uint32_t n_values = 0, n_errors = 0, n_metas = 0;
+    size_t   n = utarray_len(tags);
+    int      ret = 0;
+
+    mp->len = 0;
+
+    if (dict->session != session) {
+        mqtt_tag_dict_clear(dict);
+        dict->session = session;
+    }
+    if (assign_ids(mp, dict, tags, &first_new) != 0) {
+        goto error;
+    }
+
+    utarray_foreach(tags, neu_resp_tag_value_meta_t *, tag)
+    {
+        if (!tag_is_error(tag)) {
+            n_values += value_known(&tag->value);
+        } else if (tag->value.value.i32 != 0) {
+            n_errors += 1;
+        } else {
+            n_values += 1;
+        }
+        n_metas += tag_n_meta(tag) > 0;
+    }
+
+    ret |= put_map(mp, 6 + (dict->next > first_new) + (n_metas > 0));
+    ret |= put_key(mp, "node");
+    ret |= put_str(mp, node, NEU_NODE_NAME_LEN);
+    ret |= put_key(mp, "group");
+    ret |= put_str(mp, group, NEU_GROUP_NAME_LEN);
+    ret |= put_key(mp, "timestamp");
+    ret |= put_uint(mp, timestamp);
+    ret |= put_key(mp, "session");
+    ret |= put_uint(mp, session);
+
+    if (dict->next > first_new) {
+        // new ids are consecutive and in tag order, a name repeated in the
+        // tags is only sent once
+        uint32_t next = first_new;
+
+        ret |= put_key(mp, "dict");
+        ret |= put_map(mp, dict->next - first_new);
+        for (size_t i = 0; i < n && next < dict->next; i++) {
+            if (mp->ids[i] == next) {
+                neu_resp_tag_value_meta_t *tag = utarray_eltptr(tags, i);
+
+                ret |= put_uint(mp, next++);
+                ret |= put_str(mp, tag->tag, NEU_TAG_NAME_LEN);
+            }
+        }
+    }
+
+    ret |= put_key(mp, "values");
+    ret |= put_map(mp, n_values);
+    for (size_t i = 0; i < n; i++) {
+        neu_resp_tag_value_meta_t *tag = utarray_eltptr(tags, i);
+
+        if (!tag_is_error(tag)) {
+            if (value_known(&tag->value)) {
+                ret |= put_uint(mp, mp->ids[i]);
+                ret |= put_value(mp, &tag->value);
+            }
+        } else if (tag->value.value.i32 == 0) {
+            ret |= put_uint(mp, mp->ids[i]);
+            ret |= put_uint(mp, 0);
+        }
+    }
+
+    ret |= put_key(mp, "errors");
+    ret |= put_map(mp, n_errors);
+    for (size_t i = 0; i < n; i++) {
+        neu_resp_tag_value_meta_t *tag = utarray_eltptr(tags, i);
+
+        if (tag_is_error(tag) && tag->value.value.i32 != 0) {
+            ret |= put_uint(mp, mp->ids[i]);
+            ret |= put_int(mp, tag->value.value.i32);
+        }
+    }
+
+    if (n_metas > 0) {
+        ret |= put_key(mp, "metas");
+        ret |= put_map(mp, n_metas);
+        for (size_t i = 0; i < n; i++) {
+            neu_resp_tag_value_meta_t *tag    = utarray_eltptr(tags, i);
+            uint32_t                   n_meta = tag_n_meta(tag);
+
+            if (n_meta == 0) {
+                continue;
+            }
+            ret |= put_uint(mp, mp->ids[i]);
+            ret |= put_map(mp, n_meta);
+            for (int k = 0;
+                 k < NEU_TAG_META_SIZE && tag->metas[k].name[0] != '\0'; k++) {
+                if (value_known(&tag->metas[k].value)) {
+                    ret |= put_str(mp, tag->metas[k].name, NEU_TAG_NAME_LEN);
+                    ret |= put_value(mp, &tag->metas[k].value);
+                }
+            }
+        }
+    }
+
+    if (ret == 0) {
+        return 0;
+    }
+
+error:
+    // ids may have been assigned without the names being sent
+    mqtt_tag_dict_clear(dict);
+    dict->session = session;
+    return -1;
+}
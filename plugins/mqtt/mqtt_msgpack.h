@@ -0,0 +1,100 @@
+/**
+ * NEURON IIoT System for Industry 4.0
+ * Copyright (C) 2020-2023 EMQ Technologies Co., Ltd All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ **/
+
+#ifndef NEURON_PLUGIN_MQTT_MSGPACK_H
+#define NEURON_PLUGIN_MQTT_MSGPACK_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "neuron.h"
+
+// MessagePack upload format.
+//
+// Every upload message is one map with string keys:
+//
+//   "node"      str     driver node name
+//   "group"     str     group name
+//   "timestamp" uint    milliseconds since the epoch
+//   "session"   uint    dictionary session, see below
+//   "dict"      map     uint id => str tag name, only present when new ids
+//                       are used by this message
+//   "values"    map     uint id => tag value
+//   "errors"    map     uint id => int error code
+//   "metas"     map     uint id => map str => meta value, only present when
+//                       a tag carries metas
+//
+// Tag names are sent once, in the "dict" of the first message that uses
+// them, and data messages refer to tags by id afterwards. Ids are assigned
+// per driver and group starting from 0 and are valid for one session. The
+// session is the time the broker connection was established, so it starts
+// over with a new dictionary on every reconnect; messages replayed from the
+// offline cache keep the session they were encoded in.
+//
+// Integers use the smallest MessagePack int or uint type holding them, float
+// tags are float 32, double tags float 64 without precision rounding, bool
+// tags bool, bit tags uint, string tags str and byte tags bin.
+
+typedef struct mqtt_tag_id {
+    char           name[NEU_TAG_NAME_LEN];
+    uint32_t       id;
+    UT_hash_handle hh;
+} mqtt_tag_id_t;
+
+typedef struct {
+    mqtt_tag_id_t *ids;
+    uint32_t       next;
+    uint64_t       session;
+} mqtt_tag_dict_t;
+
+void mqtt_tag_dict_clear(mqtt_tag_dict_t *dict);
+
+// reusable output buffer
+typedef struct {
+    uint8_t * buf;
+    size_t    len;
+    size_t    cap;
+    uint32_t *ids; // the id of every tag of the message being encoded
+    size_t    n_ids;
+} mqtt_msgpack_t;
+
+void mqtt_msgpack_fini(mqtt_msgpack_t *mp);
+
+/**
+ * @brief Encode one upload message into mp->buf, replacing what was there.
+ *
+ * @param[in] dict Dictionary of the driver and group the tags belong to, it
+ *                 is cleared first if it belongs to another session.
+ * @param[in] tags UT_array of neu_resp_tag_value_meta_t.
+ * @return 0 on success, -1 if out of memory.
+ */
+int mqtt_msgpack_encode_upload(mqtt_msgpack_t *mp, mqtt_tag_dict_t *dict,
+                               uint64_t session, const char *node,
+                               const char *group, uint64_t timestamp,
+                               UT_array *tags);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -26,10 +26,17 @@
 
 const neu_plugin_module_t neu_plugin_module;
 
+static void pool_free(neu_plugin_t *plugin);
+
 static void connect_cb(void *data)
 {
     neu_plugin_t *plugin      = data;
     plugin->common.link_state = NEU_NODE_LINK_STATE_CONNECTED;
+    // a new connection starts a new tag dictionary session
+    __atomic_store_n(&plugin->session, (uint64_t) neu_time_ms(),
+                     __ATOMIC_RELAXED);
+    // and needs the sparkplug births again
+    __atomic_store_n(&plugin->sparkplug.rebirth, 1, __ATOMIC_RELAXED);
     plog_notice(plugin, "plugin `%s` connected", neu_plugin_module.module_name);
 }
 
@@ -44,6 +51,120 @@ static void disconnect_cb(void *data)
                 neu_plugin_module.module_name);
 }
 
+// extra upload connections leave the link state to the first one
+static void pool_connect_cb(void *data)
+{
+    neu_plugin_t *plugin = data;
+    __atomic_store_n(&plugin->session, (uint64_t) neu_time_ms(),
+                     __ATOMIC_RELAXED);
+    plog_notice(plugin, "plugin `%s` upload connection connected",
+                neu_plugin_module.module_name);
+}
+
+static void pool_disconnect_cb(void *data)
+{
+    neu_plugin_t *plugin = data;
+    plog_notice(plugin, "plugin `%s` upload connection disconnected",
+                neu_plugin_module.module_name);
+}
+
+static void latency_cb(int64_t ms, void *data)
+{
+    neu_plugin_t *plugin = data;
+    NEU_PLUGIN_UPDATE_METRIC(plugin, NEU_METRIC_PUBLISH_ACK_MS, ms, NULL);
+}
+
+// the app queue holds upload data while a connection is congested, so the
+// pauses of the connections nest
+static void inflight_cb(bool congested, void *data)
+{
+    neu_plugin_t *plugin = data;
+    plugin->common.adapter_callbacks->app.pause(plugin->common.adapter,
+                                                congested);
+}
+
+static int batch_timer_cb(void *data)
+{
+    neu_plugin_t *plugin = data;
+    handle_flush_batches(plugin, false);
+    return 0;
+}
+
+// publish what is pending and stop lingering
+static void batch_timer_stop(neu_plugin_t *plugin)
+{
+    if (plugin->batch_timer) {
+        neu_event_del_timer(plugin->events, plugin->batch_timer);
+        plugin->batch_timer = NULL;
+    }
+    handle_flush_batches(plugin, true);
+}
+
+static int batch_timer_start(neu_plugin_t *plugin)
+{
+    // check twice per linger time, a batch waits at most 1.5 times as long
+    int64_t                 period = plugin->config.batch_linger / 2;
+    neu_event_timer_param_t param  = {
+        .second      = period / 1000,
+        .millisecond = period > 0 ? period % 1000 : 1,
+        .usr_data    = plugin,
+        .cb          = batch_timer_cb,
+        .type        = NEU_EVENT_TIMER_NOBLOCK,
+    };
+
+    if (0 == plugin->config.batch_size || NULL != plugin->batch_timer) {
+        return 0;
+    }
+
+    plugin->batch_timer = neu_event_add_timer(plugin->events, param);
+    if (NULL == plugin->batch_timer) {
+        plog_error(plugin, "add batch timer fail");
+        return -1;
+    }
+    return 0;
+}
+
+static int write_timer_cb(void *data)
+{
+    neu_plugin_t *plugin = data;
+    handle_flush_writes(plugin, false);
+    return 0;
+}
+
+// send what is pending and stop coalescing
+static void write_timer_stop(neu_plugin_t *plugin)
+{
+    if (plugin->write_timer) {
+        neu_event_del_timer(plugin->events, plugin->write_timer);
+        plugin->write_timer = NULL;
+    }
+    handle_flush_writes(plugin, true);
+}
+
+static int write_timer_start(neu_plugin_t *plugin)
+{
+    // check twice per linger time, like the batch timer
+    int64_t                 period = plugin->config.write_linger / 2;
+    neu_event_timer_param_t param  = {
+        .second      = period / 1000,
+        .millisecond = period > 0 ? period % 1000 : 1,
+        .usr_data    = plugin,
+        .cb          = write_timer_cb,
+        .type        = NEU_EVENT_TIMER_NOBLOCK,
+    };
+
+    if (0 == plugin->config.write_linger || NULL != plugin->write_timer) {
+        return 0;
+    }
+
+    plugin->write_timer = neu_event_add_timer(plugin->events, param);
+    if (NULL == plugin->write_timer) {
+        plog_error(plugin, "add write timer fail");
+        return -1;
+    }
+    return 0;
+}
+
 static neu_plugin_t *mqtt_plugin_open(void)
 {
     neu_plugin_t *plugin = (neu_plugin_t *) calloc(1, sizeof(neu_plugin_t));
@@ -65,6 +186,9 @@ static int mqtt_plugin_init(neu_plugin_t *plugin, bool load)
     (void) load;
 
     NEU_PLUGIN_REGISTER_METRIC(plugin, NEU_METRIC_CACHED_MSGS_NUM, 0);
+    NEU_PLUGIN_REGISTER_METRIC(plugin, NEU_METRIC_CACHED_BYTES, 0);
+    NEU_PLUGIN_REGISTER_METRIC(plugin, NEU_METRIC_CACHE_REPLAY_ETA, 0);
+    NEU_PLUGIN_REGISTER_METRIC(plugin, NEU_METRIC_SEND_MSGS_DROPPED_TOTAL, 0);
     NEU_PLUGIN_REGISTER_METRIC(plugin, NEU_METRIC_TRANS_DATA_5S, 5000);
     NEU_PLUGIN_REGISTER_METRIC(plugin, NEU_METRIC_TRANS_DATA_30S, 30000);
     NEU_PLUGIN_REGISTER_METRIC(plugin, NEU_METRIC_TRANS_DATA_60S, 60000);
@@ -78,8 +202,17 @@ static int mqtt_plugin_init(neu_plugin_t *plugin, bool load)
     NEU_PLUGIN_REGISTER_METRIC(plugin, NEU_METRIC_RECV_MSGS_30S, 30000);
     NEU_PLUGIN_REGISTER_METRIC(plugin, NEU_METRIC_RECV_MSGS_60S, 60000);
     NEU_PLUGIN_REGISTER_METRIC(plugin, NEU_METRIC_DISCONNECTION_60S, 60000);
-    NEU_PLUGIN_REGISTER_METRIC(plugin, NEU_METRIC_DISCONNECTION_600S, 600000);
-    NEU_PLUGIN_REGISTER_METRIC(plugin, NEU_METRIC_DISCONNECTION_1800S, 1800000);
+    // disconnections are rare, bins of a minute are fine enough
+    NEU_PLUGIN_REGISTER_METRIC(plugin, NEU_METRIC_DISCONNECTION_600S,
+                               NEU_METRIC_ROLLING(600000, 60000));
+    NEU_PLUGIN_REGISTER_METRIC(plugin, NEU_METRIC_DISCONNECTION_1800S,
+                               NEU_METRIC_ROLLING(1800000, 60000));
+    NEU_PLUGIN_REGISTER_METRIC(plugin, NEU_METRIC_PUBLISH_ACK_MS, 0);
+
+    plugin->events = neu_event_new();
+    pthread_mutex_init(&plugin->batch_mtx, NULL);
+    pthread_mutex_init(&plugin->write_mtx, NULL);
+    pthread_mutex_init(&plugin->sparkplug_mtx, NULL);
 
     plog_notice(plugin, "initialize plugin `%s` success",
                 neu_plugin_module.module_name);
@@ -88,12 +221,17 @@ static int mqtt_plugin_init(neu_plugin_t *plugin, bool load)
 
 static int mqtt_plugin_uninit(neu_plugin_t *plugin)
 {
+    batch_timer_stop(plugin);
+    write_timer_stop(plugin);
+    neu_event_close(plugin->events);
+
     mqtt_config_fini(&plugin->config);
     if (plugin->client) {
         neu_mqtt_client_close(plugin->client);
         neu_mqtt_client_free(plugin->client);
         plugin->client = NULL;
     }
+    pool_free(plugin);
 
     free(plugin->read_req_topic);
     plugin->read_req_topic = NULL;
@@ -101,16 +239,59 @@ static int mqtt_plugin_uninit(neu_plugin_t *plugin)
     plugin->read_resp_topic = NULL;
 
     route_tbl_free(plugin->route_tbl);
+    mqtt_batch_tbl_free(plugin->batches);
+    mqtt_sparkplug_fini(&plugin->sparkplug);
+    pthread_mutex_destroy(&plugin->sparkplug_mtx);
+    pthread_mutex_destroy(&plugin->batch_mtx);
+    mqtt_write_batch_tbl_free(plugin->writes);
+    mqtt_write_ctx_tbl_free(plugin->write_ctxs);
+    pthread_mutex_destroy(&plugin->write_mtx);
+    for (int i = 0; i < NEU_APP_CONSUMERS_MAX; ++i) {
+        neu_json_stream_fini(&plugin->upload_json[i]);
+        mqtt_msgpack_fini(&plugin->upload_msgpack[i]);
+    }
 
     plog_notice(plugin, "uninitialize plugin `%s` success",
                 neu_plugin_module.module_name);
     return NEU_ERR_SUCCESS;
 }
 
+static int config_sparkplug(neu_plugin_t *plugin, neu_mqtt_client_t *client,
+                            const mqtt_config_t *config)
+{
+    mqtt_sparkplug_t *sp = &plugin->sparkplug;
+    int               rv = 0;
+
+    pthread_mutex_lock(&plugin->sparkplug_mtx);
+    if (0 !=
+            mqtt_sparkplug_reset(sp, config->sparkplug_group_id,
+                                 plugin->common.name) ||
+        0 != mqtt_sparkplug_encode_ndeath(sp)) {
+        plog_error(plugin, "sparkplug reset fail");
+        rv = -1;
+    } else if (0 !=
+               neu_mqtt_client_set_will_msg(client, sp->ndeath_topic,
+                                            sp->payload.buf, sp->payload.len,
+                                            false, NEU_MQTT_QOS1)) {
+        // NDEATH is QoS 1 and not retained
+        plog_error(plugin, "neu_mqtt_client_set_will_msg fail");
+        rv = -1;
+    } else {
+        plog_notice(plugin, "sparkplug edge node %s/%s, bdSeq %" PRIu64,
+                    sp->group_id, sp->node_id, sp->bd_seq);
+    }
+    pthread_mutex_unlock(&plugin->sparkplug_mtx);
+
+    return rv;
+}
+
+// `index` 0 is the connection for requests and uploads, the others are
+// extra upload connections
 static int config_mqtt_client(neu_plugin_t *plugin, neu_mqtt_client_t *client,
-                              const mqtt_config_t *config)
+                              const mqtt_config_t *config, size_t index)
 {
-    int rv = 0;
+    int   rv        = 0;
+    char *client_id = config->client_id;
 
     if (NULL == client) {
         return 0;
@@ -129,26 +310,63 @@ static int config_mqtt_client(neu_plugin_t *plugin, neu_mqtt_client_t *client,
         return -1;
     }
 
-    rv = neu_mqtt_client_set_id(client, config->client_id);
+    // broker client ids must be unique
+    if (index > 0 &&
+        0 > neu_asprintf(&client_id, "%s-%zu", config->client_id, index)) {
+        plog_error(plugin, "neu_asprintf client id fail");
+        return -1;
+    }
+    rv = neu_mqtt_client_set_id(client, client_id);
+    if (client_id != config->client_id) {
+        free(client_id);
+    }
     if (0 != rv) {
         plog_error(plugin, "neu_mqtt_client_set_id fail");
         return -1;
     }
 
-    rv = neu_mqtt_client_set_connect_cb(client, connect_cb, plugin);
+    rv = neu_mqtt_client_set_connect_cb(
+        client, 0 == index ? connect_cb : pool_connect_cb, plugin);
     if (0 != rv) {
         plog_error(plugin, "neu_mqtt_client_set_connect_cb fail");
         return -1;
     }
 
-    rv = neu_mqtt_client_set_disconnect_cb(client, disconnect_cb, plugin);
+    rv = neu_mqtt_client_set_disconnect_cb(
+        client, 0 == index ? disconnect_cb : pool_disconnect_cb, plugin);
     if (0 != rv) {
         plog_error(plugin, "neu_mqtt_client_set_disconnect_cb fail");
         return -1;
     }
 
-    rv = neu_mqtt_client_set_cache_size(client, config->cache_mem_size,
-                                        config->cache_disk_size);
+    rv = neu_mqtt_client_set_latency_cb(client, latency_cb, plugin);
+    if (0 != rv) {
+        plog_error(plugin, "neu_mqtt_client_set_latency_cb fail");
+        return -1;
+    }
+
+    rv = neu_mqtt_client_set_inflight_window(client, config->max_inflight,
+                                             config->max_inflight_size);
+    if (0 != rv) {
+        plog_error(plugin, "neu_mqtt_client_set_inflight_window fail");
+        return -1;
+    }
+
+    rv = neu_mqtt_client_set_inflight_cb(client, inflight_cb, plugin);
+    if (0 != rv) {
+        plog_error(plugin, "neu_mqtt_client_set_inflight_cb fail");
+        return -1;
+    }
+
+    if (0 == index && MQTT_UPLOAD_FORMAT_SPARKPLUG_B == config->format &&
+        0 != config_sparkplug(plugin, client, config)) {
+        return -1;
+    }
+
+    // the connections share the configured cache sizes
+    rv = neu_mqtt_client_set_cache_size(
+        client, config->cache_mem_size / config->connections,
+        config->cache_disk_size / config->connections);
     if (0 != rv) {
         plog_error(plugin, "neu_mqtt_client_set_msg_cache_limit fail");
         return -1;
@@ -161,6 +379,14 @@ static int config_mqtt_client(neu_plugin_t *plugin, neu_mqtt_client_t *client,
         return -1;
     }
 
+    rv = neu_mqtt_client_set_replay(
+        client, config->replay_rate / config->connections,
+        config->replay_share, config->replay_order);
+    if (0 != rv) {
+        plog_error(plugin, "neu_mqtt_client_set_replay fail");
+        return -1;
+    }
+
     if (NULL != config->username) {
         rv = neu_mqtt_client_set_user(client, config->username,
                                       config->password);
@@ -179,6 +405,67 @@ static int config_mqtt_client(neu_plugin_t *plugin, neu_mqtt_client_t *client,
     return rv;
 }
 
+static void pool_close(neu_plugin_t *plugin)
+{
+    for (size_t i = 0; i < plugin->pool_size; ++i) {
+        neu_mqtt_client_close(plugin->pool[i]);
+    }
+}
+
+static void pool_free(neu_plugin_t *plugin)
+{
+    pool_close(plugin);
+    for (size_t i = 0; i < plugin->pool_size; ++i) {
+        neu_mqtt_client_free(plugin->pool[i]);
+    }
+    free(plugin->pool);
+    plugin->pool      = NULL;
+    plugin->pool_size = 0;
+}
+
+static int pool_new(neu_plugin_t *plugin, const mqtt_config_t *config)
+{
+    size_t n = config->connections - 1;
+
+    if (0 == n) {
+        return 0;
+    }
+
+    plugin->pool = calloc(n, sizeof(*plugin->pool));
+    if (NULL == plugin->pool) {
+        return -1;
+    }
+
+    for (; plugin->pool_size < n; ++plugin->pool_size) {
+        neu_mqtt_client_t *client = neu_mqtt_client_new(NEU_MQTT_VERSION_V311);
+        if (NULL == client) {
+            plog_error(plugin, "neu_mqtt_client_new fail");
+            pool_free(plugin);
+            return -1;
+        }
+        plugin->pool[plugin->pool_size] = client;
+        if (0 != config_mqtt_client(plugin, client, config,
+                                    plugin->pool_size + 1)) {
+            plugin->pool_size += 1; // free it as well
+            pool_free(plugin);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static int pool_open(neu_plugin_t *plugin)
+{
+    for (size_t i = 0; i < plugin->pool_size; ++i) {
+        if (0 != neu_mqtt_client_open(plugin->pool[i])) {
+            plog_error(plugin, "open upload connection %zu fail", i + 1);
+            return -1;
+        }
+    }
+    return 0;
+}
+
 static int create_topic(neu_plugin_t *plugin)
 {
     if (plugin->read_req_topic) {
@@ -227,6 +514,15 @@ static int subscribe(neu_plugin_t *plugin, const mqtt_config_t *config)
         return NEU_ERR_MQTT_SUBSCRIBE_FAILURE;
     }
 
+    if (MQTT_UPLOAD_FORMAT_SPARKPLUG_B == config->format &&
+        0 !=
+            neu_mqtt_client_subscribe(plugin->client, config->qos,
+                                      plugin->sparkplug.ncmd_topic, plugin,
+                                      handle_sparkplug_ncmd)) {
+        plog_error(plugin, "subscribe [%s] fail", plugin->sparkplug.ncmd_topic);
+        return NEU_ERR_MQTT_SUBSCRIBE_FAILURE;
+    }
+
     return 0;
 }
 
@@ -234,6 +530,10 @@ static int unsubscribe(neu_plugin_t *plugin, const mqtt_config_t *config)
 {
     neu_mqtt_client_unsubscribe(plugin->client, plugin->read_req_topic);
     neu_mqtt_client_unsubscribe(plugin->client, config->write_req_topic);
+    if (MQTT_UPLOAD_FORMAT_SPARKPLUG_B == config->format) {
+        neu_mqtt_client_unsubscribe(plugin->client,
+                                    plugin->sparkplug.ncmd_topic);
+    }
     neu_msleep(100); // wait for message completion
     return 0;
 }
@@ -251,6 +551,11 @@ static int mqtt_plugin_config(neu_plugin_t *plugin, const char *setting)
         return NEU_ERR_NODE_SETTING_INVALID;
     }
 
+    // publish what is pending with the old settings, and keep the batch timer
+    // off the connections while they are replaced
+    batch_timer_stop(plugin);
+    write_timer_stop(plugin);
+
     if (NULL == plugin->client) {
         plugin->client = neu_mqtt_client_new(NEU_MQTT_VERSION_V311);
         if (NULL == plugin->client) {
@@ -269,14 +574,21 @@ static int mqtt_plugin_config(neu_plugin_t *plugin, const char *setting)
         }
     }
 
-    rv = config_mqtt_client(plugin, plugin->client, &config);
+    rv = config_mqtt_client(plugin, plugin->client, &config, 0);
     if (0 != rv) {
         rv = NEU_ERR_MQTT_INIT_FAILURE;
         goto error;
     }
 
+    pool_free(plugin);
+    if (0 != pool_new(plugin, &config)) {
+        rv = NEU_ERR_MQTT_INIT_FAILURE;
+        goto error;
+    }
+
     if (started) {
-        if (0 != neu_mqtt_client_open(plugin->client)) {
+        if (0 != neu_mqtt_client_open(plugin->client) ||
+            0 != pool_open(plugin)) {
             plog_error(plugin, "neu_mqtt_client_open fail");
             rv = NEU_ERR_MQTT_CONNECT_FAILURE;
             goto error;
@@ -291,6 +603,8 @@ static int mqtt_plugin_config(neu_plugin_t *plugin, const char *setting)
         mqtt_config_fini(&plugin->config);
     }
     memmove(&plugin->config, &config, sizeof(config));
+    batch_timer_start(plugin);
+    write_timer_start(plugin);
 
     plog_notice(plugin, "config plugin `%s` success", plugin_name);
     return 0;
@@ -298,6 +612,8 @@ static int mqtt_plugin_config(neu_plugin_t *plugin, const char *setting)
 error:
     plog_error(plugin, "config plugin `%s` fail", plugin_name);
     mqtt_config_fini(&config);
+    batch_timer_start(plugin);
+    write_timer_start(plugin);
     return rv;
 }
 
@@ -312,7 +628,7 @@ static int mqtt_plugin_start(neu_plugin_t *plugin)
         goto end;
     }
 
-    if (0 != neu_mqtt_client_open(plugin->client)) {
+    if (0 != neu_mqtt_client_open(plugin->client) || 0 != pool_open(plugin)) {
         plog_error(plugin, "neu_mqtt_client_open fail");
         rv = NEU_ERR_MQTT_CONNECT_FAILURE;
         goto end;
@@ -327,6 +643,7 @@ end:
         plog_error(plugin, "start plugin `%s` failed, error %d", plugin_name,
                    rv);
         neu_mqtt_client_close(plugin->client);
+        pool_close(plugin);
     }
     return rv;
 }
@@ -334,8 +651,10 @@ end:
 static int mqtt_plugin_stop(neu_plugin_t *plugin)
 {
     if (plugin->client) {
+        handle_flush_batches(plugin, true);
         unsubscribe(plugin, &plugin->config);
         neu_mqtt_client_close(plugin->client);
+        pool_close(plugin);
         plog_notice(plugin, "mqtt client closed");
     }
 
@@ -352,9 +671,21 @@ static int mqtt_plugin_request(neu_plugin_t *plugin, neu_reqresp_head_t *head,
     // update cached messages number per seconds
     if (NULL != plugin->client &&
         (global_timestamp - plugin->cache_metric_update_ts) >= 1000) {
-        NEU_PLUGIN_UPDATE_METRIC(
-            plugin, NEU_METRIC_CACHED_MSGS_NUM,
-            neu_mqtt_client_get_cached_msgs_num(plugin->client), NULL);
+        size_t cached = neu_mqtt_client_get_cached_msgs_num(plugin->client);
+        size_t bytes = 0, eta = 0, n = 0, t = 0;
+        neu_mqtt_client_get_replay(plugin->client, &bytes, &eta);
+        for (size_t i = 0; i < plugin->pool_size; ++i) {
+            cached += neu_mqtt_client_get_cached_msgs_num(plugin->pool[i]);
+            // the connections replay side by side
+            neu_mqtt_client_get_replay(plugin->pool[i], &n, &t);
+            bytes += n;
+            eta = eta > t ? eta : t;
+        }
+        NEU_PLUGIN_UPDATE_METRIC(plugin, NEU_METRIC_CACHED_MSGS_NUM, cached,
+                                 NULL);
+        NEU_PLUGIN_UPDATE_METRIC(plugin, NEU_METRIC_CACHED_BYTES, bytes, NULL);
+        NEU_PLUGIN_UPDATE_METRIC(plugin, NEU_METRIC_CACHE_REPLAY_ETA, eta,
+                                 NULL);
         plugin->cache_metric_update_ts = global_timestamp;
     }
 
@@ -372,6 +703,17 @@ static int mqtt_plugin_request(neu_plugin_t *plugin, neu_reqresp_head_t *head,
         error = handle_trans_data(plugin, data);
         break;
     }
+    case NEU_REQRESP_TRANS_DATA_BATCH: {
+        neu_reqresp_trans_data_batch_t *batch = data;
+        NEU_PLUGIN_UPDATE_METRIC(plugin, NEU_METRIC_TRANS_DATA_5S,
+                                 batch->n_data, NULL);
+        NEU_PLUGIN_UPDATE_METRIC(plugin, NEU_METRIC_TRANS_DATA_30S,
+                                 batch->n_data, NULL);
+        NEU_PLUGIN_UPDATE_METRIC(plugin, NEU_METRIC_TRANS_DATA_60S,
+                                 batch->n_data, NULL);
+        error = handle_trans_data_batch(plugin, batch);
+        break;
+    }
     case NEU_REQ_SUBSCRIBE_GROUP:
         error = handle_subscribe_group(plugin, data);
         break;
@@ -416,14 +758,17 @@ static const neu_plugin_intf_funs_t plugin_intf_funs = {
 #define DESCRIPTION_ZH "基于 NanoSDK 的北向应用 MQTT 插件"
 
 const neu_plugin_module_t neu_plugin_module = {
-    .version         = NEURON_PLUGIN_VER_1_0,
-    .schema          = "mqtt",
-    .module_name     = "MQTT",
-    .module_descr    = DESCRIPTION,
-    .module_descr_zh = DESCRIPTION_ZH,
-    .intf_funs       = &plugin_intf_funs,
-    .kind            = NEU_PLUGIN_KIND_SYSTEM,
-    .type            = NEU_NA_TYPE_APP,
-    .display         = true,
-    .single          = false,
+    .version               = NEURON_PLUGIN_VER_1_0,
+    .schema                = "mqtt",
+    .module_name           = "MQTT",
+    .module_descr          = DESCRIPTION,
+    .module_descr_zh       = DESCRIPTION_ZH,
+    .intf_funs             = &plugin_intf_funs,
+    .kind                  = NEU_PLUGIN_KIND_SYSTEM,
+    .type                  = NEU_NA_TYPE_APP,
+    .display               = true,
+    .single                = false,
+    .trans_data_batch      = true,
+    .trace_ack             = true,
+    .concurrent_trans_data = true,
 };
@@ -24,10 +24,18 @@
 extern "C" {
 #endif
 
+#include <pthread.h>
+
 #include "connection/mqtt_client.h"
+#include "json/neu_json_stream.h"
 #include "neuron.h"
 
+#include "mqtt_batch.h"
 #include "mqtt_config.h"
+#include "mqtt_delta.h"
+#include "mqtt_msgpack.h"
+#include "mqtt_sparkplug.h"
+#include "mqtt_write.h"
 
 typedef struct {
     char driver[NEU_NODE_NAME_LEN];
@@ -37,7 +45,11 @@ typedef struct {
 typedef struct {
     route_key_t key;
 
-    char *topic;
+    char *          topic;
+    int             qos;   // negative to follow the plugin qos setting
+    int             flags; // neu_mqtt_publish_flag_e
+    mqtt_tag_dict_t dict;  // tag ids of the msgpack upload format
+    mqtt_delta_t    delta; // changed-only upload state
 
     UT_hash_handle hh;
 } route_entry_t;
@@ -46,14 +58,32 @@ struct neu_plugin {
     neu_plugin_common_t common;
     mqtt_config_t       config;
     neu_mqtt_client_t * client;
+    neu_mqtt_client_t **pool; // extra upload connections
+    size_t              pool_size;
     int64_t             cache_metric_update_ts;
     char *              read_req_topic;
     char *              read_resp_topic;
     route_entry_t *     route_tbl;
+    // reused by the uploads of each trans data consumer
+    neu_json_stream_t   upload_json[NEU_APP_CONSUMERS_MAX];
+    mqtt_msgpack_t      upload_msgpack[NEU_APP_CONSUMERS_MAX];
+    uint64_t            session; // time of the last connection, in ms
+    neu_events_t *      events;
+    neu_event_timer_t * batch_timer;
+    pthread_mutex_t     batch_mtx; // guards the batches
+    mqtt_batch_t *      batches;
+    neu_event_timer_t * write_timer;
+    pthread_mutex_t     write_mtx; // guards the write batches and contexts
+    mqtt_write_batch_t *writes;
+    mqtt_write_ctx_t *  write_ctxs; // coalesced writes in flight
+    pthread_mutex_t     sparkplug_mtx; // guards the sparkplug state
+    mqtt_sparkplug_t    sparkplug;
 };
 
 static inline void route_entry_free(route_entry_t *e)
 {
+    mqtt_tag_dict_clear(&e->dict);
+    mqtt_delta_fini(&e->delta);
     free(e->topic);
     free(e);
 }
@@ -74,8 +104,8 @@ route_tbl_get(route_entry_t **tbl, const char *driver, const char *group)
     route_entry_t *find = NULL;
     route_key_t    key  = { 0 };
 
-    strncpy(key.driver, driver, sizeof(key.driver));
-    strncpy(key.group, group, sizeof(key.group));
+    strncpy(key.driver, driver, sizeof(key.driver) - 1);
+    strncpy(key.group, group, sizeof(key.group) - 1);
 
     HASH_FIND(hh, *tbl, &key, sizeof(key), find);
     return find;
@@ -83,7 +113,8 @@ route_tbl_get(route_entry_t **tbl, const char *driver, const char *group)
 
 // NOTE: we take ownership of `topic`
 static inline int route_tbl_add_new(route_entry_t **tbl, const char *driver,
-                                    const char *group, char *topic)
+                                    const char *group, char *topic, int qos,
+                                    int flags, const mqtt_delta_config_t *delta)
 {
     route_entry_t *find = NULL;
 
@@ -101,7 +132,10 @@ static inline int route_tbl_add_new(route_entry_t **tbl, const char *driver,
 
     strncpy(find->key.driver, driver, sizeof(find->key.driver));
     strncpy(find->key.group, group, sizeof(find->key.group));
-    find->topic = topic;
+    find->topic        = topic;
+    find->qos          = qos;
+    find->flags        = flags;
+    find->delta.config = *delta;
     HASH_ADD(hh, *tbl, key, sizeof(find->key), find);
 
     return 0;
@@ -109,7 +143,8 @@ static inline int route_tbl_add_new(route_entry_t **tbl, const char *driver,
 
 // NOTE: we take ownership of `topic`
 static inline int route_tbl_update(route_entry_t **tbl, const char *driver,
-                                   const char *group, char *topic)
+                                   const char *group, char *topic, int qos,
+                                   int flags, const mqtt_delta_config_t *delta)
 {
     route_entry_t *find = NULL;
 
@@ -120,7 +155,11 @@ static inline int route_tbl_update(route_entry_t **tbl, const char *driver,
     }
 
     free(find->topic);
-    find->topic = topic;
+    find->topic        = topic;
+    find->qos          = qos;
+    find->flags        = flags;
+    find->delta.config = *delta;
+    mqtt_delta_clear(&find->delta);
 
     return 0;
 }
@@ -135,6 +174,8 @@ static inline void route_tbl_update_driver(route_entry_t **tbl,
         if (0 == strcmp(e->key.driver, driver)) {
             HASH_DEL(*tbl, e);
             strncpy(e->key.driver, new_name, sizeof(e->key.driver));
+            mqtt_tag_dict_clear(&e->dict);
+            mqtt_delta_clear(&e->delta);
             HASH_ADD(hh, *tbl, key, sizeof(e->key), e);
         }
     }
@@ -148,6 +189,8 @@ static inline void route_tbl_update_group(route_entry_t **tbl,
     if (e) {
         HASH_DEL(*tbl, e);
         strncpy(e->key.group, new_name, sizeof(e->key.group));
+        mqtt_tag_dict_clear(&e->dict);
+        mqtt_delta_clear(&e->delta);
         HASH_ADD(hh, *tbl, key, sizeof(e->key), e);
     }
 }
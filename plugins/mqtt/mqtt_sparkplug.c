@@ -0,0 +1,690 @@
+/**
+ * NEURON IIoT System for Industry 4.0
+ * Copyright (C) 2020-2023 EMQ Technologies Co., Ltd All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ **/
+
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "utils/asprintf.h"
+#include "utils/utextend.h"
+
+#include "mqtt_sparkplug.h"
+
+// Sparkplug B datatypes
+enum {
+    SP_INT8    = 1,
+    SP_INT16   = 2,
+    SP_INT32   = 3,
+    SP_INT64   = 4,
+    SP_UINT8   = 5,
+    SP_UINT16  = 6,
+    SP_UINT32  = 7,
+    SP_UINT64  = 8,
+    SP_FLOAT   = 9,
+    SP_DOUBLE  = 10,
+    SP_BOOLEAN = 11,
+    SP_STRING  = 12,
+    SP_BYTES   = 17,
+};
+
+// protobuf wire types
+enum {
+    WT_VARINT  = 0,
+    WT_FIXED64 = 1,
+    WT_LEN     = 2,
+    WT_FIXED32 = 5,
+};
+
+// fields of the Payload and Metric messages
+enum {
+    PAYLOAD_TIMESTAMP = 1,
+    PAYLOAD_METRICS   = 2,
+    PAYLOAD_SEQ       = 3,
+
+    METRIC_NAME     = 1,
+    METRIC_ALIAS    = 2,
+    METRIC_DATATYPE = 4,
+    METRIC_IS_NULL  = 7,
+    METRIC_INT      = 10,
+    METRIC_LONG     = 11,
+    METRIC_FLOAT    = 12,
+    METRIC_DOUBLE   = 13,
+    METRIC_BOOLEAN  = 14,
+    METRIC_STRING   = 15,
+    METRIC_BYTES    = 16,
+};
+
+static int reserve(sparkplug_buf_t *b, size_t n)
+{
+    if (b->len + n <= b->cap) {
+        return 0;
+    }
+
+    size_t cap = b->cap ? b->cap : 1024;
+    while (cap < b->len + n) {
+        cap *= 2;
+    }
+
+    uint8_t *buf = realloc(b->buf, cap);
+    if (NULL == buf) {
+        return -1;
+    }
+    b->buf = buf;
+    b->cap = cap;
+    return 0;
+}
+
+static int put(sparkplug_buf_t *b, const void *data, size_t n)
+{
+    if (reserve(b, n) != 0) {
+        return -1;
+    }
+    memcpy(b->buf + b->len, data, n);
+    b->len += n;
+    return 0;
+}
+
+static int put_varint(sparkplug_buf_t *b, uint64_t v)
+{
+    uint8_t tmp[10];
+    int     n = 0;
+
+    do {
+        tmp[n++] = (v & 0x7f) | (v > 0x7f ? 0x80 : 0);
+        v >>= 7;
+    } while (v);
+    return put(b, tmp, n);
+}
+
+static inline int put_key(sparkplug_buf_t *b, uint32_t field, int wt)
+{
+    return put_varint(b, (field << 3) | wt);
+}
+
+static int put_uint_field(sparkplug_buf_t *b, uint32_t field, uint64_t v)
+{
+    return put_key(b, field, WT_VARINT) || put_varint(b, v);
+}
+
+static int put_len_field(sparkplug_buf_t *b, uint32_t field, const void *data,
+                         size_t n)
+{
+    return put_key(b, field, WT_LEN) || put_varint(b, n) || put(b, data, n);
+}
+
+static int put_fixed(sparkplug_buf_t *b, uint32_t field, uint64_t v, int n)
+{
+    uint8_t tmp[8];
+
+    for (int i = 0; i < n; i++) {
+        tmp[i] = v & 0xff; // little endian
+        v >>= 8;
+    }
+    return put_key(b, field, n == 4 ? WT_FIXED32 : WT_FIXED64) ||
+        put(b, tmp, n);
+}
+
+static uint32_t datatype_of(const neu_dvalue_t *value)
+{
+    switch (value->type) {
+    case NEU_TYPE_INT8:
+        return SP_INT8;
+    case NEU_TYPE_INT16:
+        return SP_INT16;
+    case NEU_TYPE_INT32:
+        return SP_INT32;
+    case NEU_TYPE_INT64:
+        return SP_INT64;
+    case NEU_TYPE_UINT8:
+        return SP_UINT8;
+    case NEU_TYPE_WORD:
+    case NEU_TYPE_UINT16:
+        return SP_UINT16;
+    case NEU_TYPE_DWORD:
+    case NEU_TYPE_UINT32:
+        return SP_UINT32;
+    case NEU_TYPE_LWORD:
+    case NEU_TYPE_UINT64:
+        return SP_UINT64;
+    case NEU_TYPE_FLOAT:
+        return SP_FLOAT;
+    case NEU_TYPE_DOUBLE:
+        return SP_DOUBLE;
+    case NEU_TYPE_BIT:
+    case NEU_TYPE_BOOL:
+        return SP_BOOLEAN;
+    case NEU_TYPE_STRING:
+        return SP_STRING;
+    case NEU_TYPE_BYTES:
+        return SP_BYTES;
+    case NEU_TYPE_PTR:
+        if (NULL == value->value.ptr.ptr) {
+            return 0;
+        }
+        return NEU_TYPE_BYTES == value->value.ptr.type ? SP_BYTES : SP_STRING;
+    default:
+        return 0;
+    }
+}
+
+static int put_value(sparkplug_buf_t *b, const neu_dvalue_t *value)
+{
+    const neu_value_u *v = &value->value;
+
+    switch (value->type) {
+    // signed values are sent as their two's complement, as Tahu does
+    case NEU_TYPE_INT8:
+        return put_uint_field(b, METRIC_INT, (uint32_t) v->i8);
+    case NEU_TYPE_INT16:
+        return put_uint_field(b, METRIC_INT, (uint32_t) v->i16);
+    case NEU_TYPE_INT32:
+        return put_uint_field(b, METRIC_INT, (uint32_t) v->i32);
+    case NEU_TYPE_INT64:
+        return put_uint_field(b, METRIC_LONG, (uint64_t) v->i64);
+    case NEU_TYPE_UINT8:
+        return put_uint_field(b, METRIC_INT, v->u8);
+    case NEU_TYPE_WORD:
+    case NEU_TYPE_UINT16:
+        return put_uint_field(b, METRIC_INT, v->u16);
+    case NEU_TYPE_DWORD:
+    case NEU_TYPE_UINT32:
+        return put_uint_field(b, METRIC_INT, v->u32);
+    case NEU_TYPE_LWORD:
+    case NEU_TYPE_UINT64:
+        return put_uint_field(b, METRIC_LONG, v->u64);
+    case NEU_TYPE_FLOAT: {
+        uint32_t u = 0;
+        memcpy(&u, &v->f32, sizeof(u));
+        return put_fixed(b, METRIC_FLOAT, u, 4);
+    }
+    case NEU_TYPE_DOUBLE: {
+        uint64_t u = 0;
+        memcpy(&u, &v->d64, sizeof(u));
+        return put_fixed(b, METRIC_DOUBLE, u, 8);
+    }
+    case NEU_TYPE_BIT:
+        return put_uint_field(b, METRIC_BOOLEAN, v->u8 != 0);
+    case NEU_TYPE_BOOL:
+        return put_uint_field(b, METRIC_BOOLEAN, v->boolean);
+    case NEU_TYPE_STRING:
+        return put_len_field(b, METRIC_STRING, v->str,
+                             strnlen(v->str, sizeof(v->str)));
+    case NEU_TYPE_BYTES:
+        return put_len_field(b, METRIC_BYTES, v->bytes.bytes, v->bytes.length);
+    case NEU_TYPE_PTR:
+        if (NEU_TYPE_BYTES == v->ptr.type) {
+            return put_len_field(b, METRIC_BYTES, v->ptr.ptr, v->ptr.length);
+        }
+        return put_len_field(b, METRIC_STRING, v->ptr.ptr,
+                             strnlen((char *) v->ptr.ptr, v->ptr.length));
+    default:
+        return -1;
+    }
+}
+
+static bool value_equal(const neu_dvalue_t *a, const neu_dvalue_t *b)
+{
+    if (a->type != b->type) {
+        return false;
+    }
+
+    switch (a->type) {
+    case NEU_TYPE_INT8:
+    case NEU_TYPE_UINT8:
+    case NEU_TYPE_BIT:
+        return a->value.u8 == b->value.u8;
+    case NEU_TYPE_INT16:
+    case NEU_TYPE_UINT16:
+    case NEU_TYPE_WORD:
+        return a->value.u16 == b->value.u16;
+    case NEU_TYPE_INT32:
+    case NEU_TYPE_UINT32:
+    case NEU_TYPE_DWORD:
+    case NEU_TYPE_FLOAT: // bitwise, so that NaN does not go unreported
+        return a->value.u32 == b->value.u32;
+    case NEU_TYPE_INT64:
+    case NEU_TYPE_UINT64:
+    case NEU_TYPE_LWORD:
+    case NEU_TYPE_DOUBLE:
+        return a->value.u64 == b->value.u64;
+    case NEU_TYPE_BOOL:
+        return a->value.boolean == b->value.boolean;
+    case NEU_TYPE_STRING:
+        return 0 == strncmp(a->value.str, b->value.str, sizeof(a->value.str));
+    case NEU_TYPE_BYTES:
+        return a->value.bytes.length == b->value.bytes.length &&
+            0 == memcmp(a->value.bytes.bytes, b->value.bytes.bytes,
+                        a->value.bytes.length);
+    default:
+        return false; // pointer values are not kept
+    }
+}
+
+// append the metric in sp->metric to the payload
+static int put_metric(mqtt_sparkplug_t *sp)
+{
+    return put_len_field(&sp->payload, PAYLOAD_METRICS, sp->metric.buf,
+                         sp->metric.len);
+}
+
+static int put_named_metric(mqtt_sparkplug_t *sp, const char *name,
+                            uint32_t datatype, const neu_dvalue_t *value)
+{
+    sparkplug_buf_t *m = &sp->metric;
+
+    m->len = 0;
+    return put_len_field(m, METRIC_NAME, name, strlen(name)) ||
+        put_uint_field(m, METRIC_DATATYPE, datatype) || put_value(m, value) ||
+        put_metric(sp);
+}
+
+// `birth` metrics carry name and datatype, data metrics only the alias
+static int put_tag_metric(mqtt_sparkplug_t *sp, sparkplug_metric_t *metric,
+                          const neu_dvalue_t *value, bool birth)
+{
+    sparkplug_buf_t *m   = &sp->metric;
+    int              ret = 0;
+
+    m->len = 0;
+    if (birth) {
+        ret |= put_len_field(m, METRIC_NAME, metric->name,
+                             strlen(metric->name));
+    }
+    ret |= put_uint_field(m, METRIC_ALIAS, metric->alias);
+    if (birth) {
+        ret |= put_uint_field(m, METRIC_DATATYPE, metric->datatype);
+    }
+    if (metric->is_null || NULL == value) {
+        ret |= put_uint_field(m, METRIC_IS_NULL, 1);
+    } else {
+        ret |= put_value(m, value);
+    }
+    return ret | put_metric(sp);
+}
+
+static int begin_payload(mqtt_sparkplug_t *sp, uint64_t timestamp)
+{
+    sp->payload.len = 0;
+    return put_uint_field(&sp->payload, PAYLOAD_TIMESTAMP, timestamp);
+}
+
+static int end_payload(mqtt_sparkplug_t *sp)
+{
+    return put_uint_field(&sp->payload, PAYLOAD_SEQ, sp->seq++);
+}
+
+static void device_free(sparkplug_device_t *dev)
+{
+    sparkplug_metric_t *m = NULL, *tmp = NULL;
+    HASH_ITER(hh, dev->metrics, m, tmp)
+    {
+        HASH_DEL(dev->metrics, m);
+        free(m);
+    }
+    free(dev->birth_topic);
+    free(dev->data_topic);
+    free(dev->death_topic);
+    free(dev);
+}
+
+static void free_state(mqtt_sparkplug_t *sp)
+{
+    sparkplug_device_t *dev = NULL, *tmp = NULL;
+    HASH_ITER(hh, sp->devices, dev, tmp)
+    {
+        HASH_DEL(sp->devices, dev);
+        device_free(dev);
+    }
+    free(sp->nbirth_topic);
+    free(sp->ndeath_topic);
+    free(sp->ncmd_topic);
+    free(sp->group_id);
+    free(sp->node_id);
+    sp->nbirth_topic = NULL;
+    sp->ndeath_topic = NULL;
+    sp->ncmd_topic   = NULL;
+    sp->group_id     = NULL;
+    sp->node_id      = NULL;
+}
+
+int mqtt_sparkplug_reset(mqtt_sparkplug_t *sp, const char *group_id,
+                         const char *node_id)
+{
+    free_state(sp);
+    sp->seq        = 0;
+    sp->next_alias = 0;
+    sp->node_born  = false;
+
+    sp->group_id = strdup(group_id);
+    sp->node_id  = strdup(node_id);
+    neu_asprintf(&sp->nbirth_topic, SPARKPLUG_NAMESPACE "/%s/NBIRTH/%s",
+                 group_id, node_id);
+    neu_asprintf(&sp->ndeath_topic, SPARKPLUG_NAMESPACE "/%s/NDEATH/%s",
+                 group_id, node_id);
+    neu_asprintf(&sp->ncmd_topic, SPARKPLUG_NAMESPACE "/%s/NCMD/%s", group_id,
+                 node_id);
+    if (NULL == sp->group_id || NULL == sp->node_id ||
+        NULL == sp->nbirth_topic || NULL == sp->ndeath_topic ||
+        NULL == sp->ncmd_topic) {
+        free_state(sp);
+        return -1;
+    }
+    return 0;
+}
+
+void mqtt_sparkplug_fini(mqtt_sparkplug_t *sp)
+{
+    free_state(sp);
+    free(sp->payload.buf);
+    free(sp->metric.buf);
+    memset(sp, 0, sizeof(*sp));
+}
+
+int mqtt_sparkplug_encode_ndeath(mqtt_sparkplug_t *sp)
+{
+    neu_dvalue_t bd_seq = { .type = NEU_TYPE_UINT64, .value.u64 = 0 };
+
+    // bdSeq ranges over 0 to 255 like seq
+    sp->bd_seq       = sp->n_death++ & 0xff;
+    bd_seq.value.u64 = sp->bd_seq;
+
+    sp->payload.len = 0;
+    return put_named_metric(sp, "bdSeq", SP_UINT64, &bd_seq);
+}
+
+int mqtt_sparkplug_encode_nbirth(mqtt_sparkplug_t *sp, uint64_t timestamp)
+{
+    neu_dvalue_t bd_seq  = { .type = NEU_TYPE_UINT64, .value.u64 = sp->bd_seq };
+    neu_dvalue_t rebirth = { .type = NEU_TYPE_BOOL, .value.boolean = false };
+    sparkplug_device_t *dev = NULL, *tmp = NULL;
+
+    HASH_ITER(hh, sp->devices, dev, tmp)
+    {
+        dev->born = false;
+    }
+
+    sp->seq       = 0;
+    sp->node_born = true;
+    if (begin_payload(sp, timestamp) ||
+        put_named_metric(sp, "bdSeq", SP_UINT64, &bd_seq) ||
+        put_named_metric(sp, SPARKPLUG_REBIRTH, SP_BOOLEAN, &rebirth) ||
+        end_payload(sp)) {
+        sp->node_born = false;
+        return -1;
+    }
+    return 0;
+}
+
+sparkplug_device_t *mqtt_sparkplug_device(mqtt_sparkplug_t *sp,
+                                          const char *driver, bool add)
+{
+    sparkplug_device_t *dev = NULL;
+
+    HASH_FIND_STR(sp->devices, driver, dev);
+    if (NULL != dev || !add) {
+        return dev;
+    }
+
+    dev = calloc(1, sizeof(*dev));
+    if (NULL == dev) {
+        return NULL;
+    }
+    strncpy(dev->name, driver, sizeof(dev->name) - 1);
+    neu_asprintf(&dev->birth_topic, SPARKPLUG_NAMESPACE "/%s/DBIRTH/%s/%s",
+                 sp->group_id, sp->node_id, driver);
+    neu_asprintf(&dev->data_topic, SPARKPLUG_NAMESPACE "/%s/DDATA/%s/%s",
+                 sp->group_id, sp->node_id, driver);
+    neu_asprintf(&dev->death_topic, SPARKPLUG_NAMESPACE "/%s/DDEATH/%s/%s",
+                 sp->group_id, sp->node_id, driver);
+    if (NULL == dev->birth_topic || NULL == dev->data_topic ||
+        NULL == dev->death_topic) {
+        device_free(dev);
+        return NULL;
+    }
+    HASH_ADD_STR(sp->devices, name, dev);
+    return dev;
+}
+
+// update one metric, returns whether it has to be reported
+static bool update_metric(mqtt_sparkplug_t *sp, sparkplug_device_t *dev,
+                          const char *group, neu_resp_tag_value_meta_t *tag,
+                          sparkplug_metric_t **out, bool *oom)
+{
+    char                name[NEU_GROUP_NAME_LEN + NEU_TAG_NAME_LEN] = { 0 };
+    sparkplug_metric_t *m                                           = NULL;
+    bool                error    = NEU_TYPE_ERROR == tag->value.type;
+    uint32_t            datatype = error ? 0 : datatype_of(&tag->value);
+
+    snprintf(name, sizeof(name), "%s/%s", group, tag->tag);
+    HASH_FIND_STR(dev->metrics, name, m);
+    *out = m;
+
+    if (NULL == m) {
+        if (0 == datatype) {
+            return false; // no datatype for the birth yet
+        }
+        m = calloc(1, sizeof(*m));
+        if (NULL == m) {
+            *oom = true;
+            return false;
+        }
+        strcpy(m->name, name);
+        m->alias    = sp->next_alias++;
+        m->datatype = datatype;
+        m->value    = tag->value;
+        HASH_ADD_STR(dev->metrics, name, m);
+        dev->born = false; // new metric, so a new birth
+        *out      = m;
+        return true;
+    }
+
+    if (error) {
+        bool changed = !m->is_null;
+        m->is_null   = true;
+        return changed;
+    }
+    if (0 == datatype) {
+        return false;
+    }
+    if (datatype != m->datatype) {
+        m->datatype = datatype;
+        dev->born   = false;
+    }
+
+    bool changed = m->is_null || !value_equal(&m->value, &tag->value);
+    m->is_null   = false;
+    m->value     = tag->value;
+    return changed;
+}
+
+int mqtt_sparkplug_encode_group(mqtt_sparkplug_t *sp, sparkplug_device_t *dev,
+                                const char *group, uint64_t timestamp,
+                                UT_array *tags, bool *birth)
+{
+    sparkplug_metric_t *m   = NULL;
+    bool                oom = false;
+    size_t              n   = 0;
+    int                 ret = 0;
+
+    sp->payload.len = 0;
+    ret |= begin_payload(sp, timestamp);
+
+    // changed metrics are encoded as data right away, and dropped if a birth
+    // turns out to be needed
+    utarray_foreach(tags, neu_resp_tag_value_meta_t *, tag)
+    {
+        if (update_metric(sp, dev, group, tag, &m, &oom) && dev->born) {
+            ret |= put_tag_metric(sp, m, &tag->value, false);
+            n += 1;
+        }
+    }
+    if (oom) {
+        // some metric is missing, make sure the next message is a birth
+        dev->born = false;
+        return -1;
+    }
+
+    *birth = !dev->born;
+    if (*birth) {
+        sparkplug_metric_t *tmp = NULL;
+
+        sp->payload.len = 0;
+        ret |= begin_payload(sp, timestamp);
+        HASH_ITER(hh, dev->metrics, m, tmp)
+        {
+            // pointer values are not kept, they are null until reported
+            bool known = !m->is_null && NEU_TYPE_PTR != m->value.type;
+            ret |= put_tag_metric(sp, m, known ? &m->value : NULL, true);
+        }
+        dev->born = true;
+    } else if (0 == n) {
+        sp->payload.len = 0; // nothing changed
+        return ret == 0 ? 0 : -1;
+    }
+
+    ret |= end_payload(sp);
+    if (0 != ret) {
+        dev->born = false;
+        return -1;
+    }
+    return 0;
+}
+
+bool mqtt_sparkplug_drop(mqtt_sparkplug_t *sp, sparkplug_device_t *dev,
+                         const char *group)
+{
+    sparkplug_metric_t *m = NULL, *tmp = NULL;
+    size_t              n = group ? strlen(group) : 0;
+    bool                dropped = false;
+
+    (void) sp;
+    HASH_ITER(hh, dev->metrics, m, tmp)
+    {
+        if (NULL == group ||
+            (0 == strncmp(m->name, group, n) && '/' == m->name[n])) {
+            HASH_DEL(dev->metrics, m);
+            free(m);
+            dropped = true;
+        }
+    }
+
+    if (!dropped) {
+        return false;
+    }
+    if (NULL == dev->metrics) {
+        bool born = dev->born;
+        dev->born = false;
+        return born;
+    }
+    dev->born = false; // the remaining metrics need a new birth
+    return false;
+}
+
+int mqtt_sparkplug_encode_ddeath(mqtt_sparkplug_t *  sp,
+                                 sparkplug_device_t *dev, uint64_t timestamp)
+{
+    (void) dev;
+    return begin_payload(sp, timestamp) || end_payload(sp) ? -1 : 0;
+}
+
+static bool get_varint(const uint8_t **p, const uint8_t *end, uint64_t *v)
+{
+    *v = 0;
+    for (int shift = 0; *p < end && shift < 64; shift += 7) {
+        uint8_t b = *(*p)++;
+        *v |= (uint64_t)(b & 0x7f) << shift;
+        if (!(b & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// skip over a field of wire type `wt`, `*len` is the length of WT_LEN ones
+static bool skip_field(const uint8_t **p, const uint8_t *end, int wt,
+                       uint64_t *len)
+{
+    uint64_t v = 0;
+
+    *len = 0;
+    switch (wt) {
+    case WT_VARINT:
+        return get_varint(p, end, &v);
+    case WT_FIXED64:
+        v = 8;
+        break;
+    case WT_FIXED32:
+        v = 4;
+        break;
+    case WT_LEN:
+        if (!get_varint(p, end, &v)) {
+            return false;
+        }
+        *len = v;
+        break;
+    default:
+        return false;
+    }
+    if (v > (uint64_t)(end - *p)) {
+        return false;
+    }
+    *p += v;
+    return true;
+}
+
+static bool metric_is_rebirth(const uint8_t *p, const uint8_t *end)
+{
+    bool     named = false, value = false;
+    uint64_t key = 0, v = 0;
+
+    while (p < end && get_varint(&p, end, &key)) {
+        int wt = key & 7;
+
+        if (METRIC_BOOLEAN == key >> 3 && WT_VARINT == wt) {
+            if (!get_varint(&p, end, &v)) {
+                return false;
+            }
+            value = v != 0;
+        } else if (!skip_field(&p, end, wt, &v)) {
+            return false;
+        } else if (METRIC_NAME == key >> 3 && WT_LEN == wt) {
+            named = v == strlen(SPARKPLUG_REBIRTH) &&
+                0 == memcmp(p - v, SPARKPLUG_REBIRTH, v);
+        }
+    }
+    return named && value;
+}
+
+bool mqtt_sparkplug_is_rebirth(const uint8_t *payload, uint32_t len)
+{
+    const uint8_t *p   = payload;
+    const uint8_t *end = payload + len;
+    uint64_t       key = 0, n = 0;
+
+    while (p < end && get_varint(&p, end, &key)) {
+        if (!skip_field(&p, end, key & 7, &n)) {
+            return false;
+        }
+        if (PAYLOAD_METRICS == key >> 3 && WT_LEN == (key & 7) &&
+            metric_is_rebirth(p - n, p)) {
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,145 @@
+/**
+ * NEURON IIoT System for Industry 4.0
+ * Copyright (C) 2020-2023 EMQ Technologies Co., Ltd All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ **/
+
+
+#ifndef NEURON_PLUGIN_MQTT_SPARKPLUG_H
+#define NEURON_PLUGIN_MQTT_SPARKPLUG_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "neuron.h"
+
+// Sparkplug B upload format.
+//
+// The plugin node is the Sparkplug edge node, every driver is a device and
+// every tag a metric named `group/tag`. Payloads are the Sparkplug B protobuf
+// `Payload` message, encoded here without a protobuf library.
+//
+// NBIRTH is published before any data after every connection and on a
+// `Node Control/Rebirth` NCMD. A DBIRTH carrying all metrics of a device is
+// published before its first DDATA and whenever a metric appears, changes its
+// datatype or goes away; DDATA carries only the metrics which changed since
+// the last message, referred to by alias. NDEATH is registered as the will
+// message of the connection and DDEATH is published when a driver is gone.
+// Tags first reported with an error are left out until they have a value,
+// as a birth needs the datatype.
+
+#define SPARKPLUG_NAMESPACE "spBv1.0"
+#define SPARKPLUG_REBIRTH "Node Control/Rebirth"
+
+typedef struct {
+    uint8_t *buf;
+    size_t   len;
+    size_t   cap;
+} sparkplug_buf_t;
+
+typedef struct sparkplug_metric {
+    char           name[NEU_GROUP_NAME_LEN + NEU_TAG_NAME_LEN]; // group/tag
+    uint64_t       alias;
+    uint32_t       datatype;
+    bool           is_null;
+    neu_dvalue_t   value; // last value, pointer values are not kept
+    UT_hash_handle hh;
+} sparkplug_metric_t;
+
+typedef struct sparkplug_device {
+    char                name[NEU_NODE_NAME_LEN];
+    char *              birth_topic;
+    char *              data_topic;
+    char *              death_topic;
+    bool                born;
+    sparkplug_metric_t *metrics;
+    UT_hash_handle      hh;
+} sparkplug_device_t;
+
+typedef struct {
+    char *              nbirth_topic;
+    char *              ndeath_topic;
+    char *              ncmd_topic;
+    char *              group_id;
+    char *              node_id;
+    uint64_t            bd_seq;  // of the NDEATH registered as will message
+    uint64_t            n_death; // NDEATH encoded so far
+    uint8_t             seq;
+    uint64_t            next_alias;
+    bool                node_born;
+    int                 rebirth; // set from client threads, atomic access
+    sparkplug_device_t *devices;
+    sparkplug_buf_t     payload; // the message last encoded
+    sparkplug_buf_t     metric;  // scratch for one metric
+} mqtt_sparkplug_t;
+
+/**
+ * @brief Start over for a new configuration.
+ *
+ * Drops all devices and metrics and builds the node topics, the bdSeq keeps
+ * counting. Device topics are kept until the next reset or fini, as the mqtt
+ * client refers to them until publish completes, so the client must not be
+ * publishing when this is called.
+ */
+int  mqtt_sparkplug_reset(mqtt_sparkplug_t *sp, const char *group_id,
+                          const char *node_id);
+void mqtt_sparkplug_fini(mqtt_sparkplug_t *sp);
+
+// the NDEATH of the next connection, with the next bdSeq
+int mqtt_sparkplug_encode_ndeath(mqtt_sparkplug_t *sp);
+// NBIRTH with seq 0, every device needs a DBIRTH again afterwards
+int mqtt_sparkplug_encode_nbirth(mqtt_sparkplug_t *sp, uint64_t timestamp);
+
+// find the device of a driver, optionally adding it, NULL if out of memory
+sparkplug_device_t *mqtt_sparkplug_device(mqtt_sparkplug_t *sp,
+                                          const char *driver, bool add);
+
+/**
+ * @brief Update the metrics of one group and encode what has to be sent.
+ *
+ * @param[in] tags UT_array of neu_resp_tag_value_meta_t.
+ * @param[out] birth Whether the payload is a DBIRTH rather than a DDATA.
+ * @return 0 on success, -1 if out of memory. The payload is empty if there is
+ *         nothing to report.
+ */
+int mqtt_sparkplug_encode_group(mqtt_sparkplug_t *sp, sparkplug_device_t *dev,
+                                const char *group, uint64_t timestamp,
+                                UT_array *tags, bool *birth);
+
+/**
+ * @brief Remove the metrics of `group`, or all of them if it is NULL.
+ *
+ * @return true if the device was born and has no metrics left, so a DDEATH
+ *         should be sent.
+ */
+bool mqtt_sparkplug_drop(mqtt_sparkplug_t *sp, sparkplug_device_t *dev,
+                         const char *group);
+int  mqtt_sparkplug_encode_ddeath(mqtt_sparkplug_t *  sp,
+                                  sparkplug_device_t *dev, uint64_t timestamp);
+
+// whether an NCMD payload requests a rebirth
+bool mqtt_sparkplug_is_rebirth(const uint8_t *payload, uint32_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
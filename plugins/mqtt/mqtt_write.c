@@ -0,0 +1,196 @@
+/**
+ * NEURON IIoT System for Industry 4.0
+ * Copyright (C) 2020-2023 EMQ Technologies Co., Ltd All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ **/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "mqtt_write.h"
+
+void mqtt_write_req_free(mqtt_write_req_t *req)
+{
+    if (req->mqtt) {
+        neu_json_decode_mqtt_req_free(req->mqtt);
+    }
+    free(req->group);
+    free(req->tags);
+    free(req);
+}
+
+static void req_list_free(mqtt_write_req_t *head)
+{
+    while (head) {
+        mqtt_write_req_t *next = head->next;
+        mqtt_write_req_free(head);
+        head = next;
+    }
+}
+
+void mqtt_write_ctx_free(mqtt_write_ctx_t *ctx)
+{
+    req_list_free(ctx->reqs);
+    free(ctx->driver);
+    free(ctx);
+}
+
+mqtt_write_batch_t *mqtt_write_batch_get(mqtt_write_batch_t **tbl,
+                                         const char *         driver)
+{
+    mqtt_write_batch_t *batch = NULL;
+
+    HASH_FIND_STR(*tbl, driver, batch);
+    if (NULL != batch) {
+        return batch;
+    }
+
+    batch = calloc(1, sizeof(*batch));
+    if (NULL == batch) {
+        return NULL;
+    }
+    batch->driver = strdup(driver);
+    if (NULL == batch->driver) {
+        free(batch);
+        return NULL;
+    }
+    HASH_ADD_KEYPTR(hh, *tbl, batch->driver, strlen(batch->driver), batch);
+    return batch;
+}
+
+void mqtt_write_batch_add(mqtt_write_batch_t *batch, mqtt_write_req_t *req,
+                          int64_t now)
+{
+    req->next = NULL;
+    if (NULL == batch->tail) {
+        batch->head     = req;
+        batch->first_ts = now;
+    } else {
+        batch->tail->next = req;
+    }
+    batch->tail = req;
+    batch->n_req += 1;
+    batch->n_tag += req->n_tag;
+}
+
+static neu_req_gtag_group_t *find_group(neu_req_gtag_group_t *groups, int n,
+                                        const char *name)
+{
+    for (int i = 0; i < n; ++i) {
+        if (0 == strcmp(groups[i].group, name)) {
+            return &groups[i];
+        }
+    }
+    return NULL;
+}
+
+mqtt_write_ctx_t *mqtt_write_batch_take(mqtt_write_batch_t *   batch,
+                                        neu_req_write_gtags_t *cmd)
+{
+    int                   n_group = 0;
+    int                   n_ready = 0;
+    neu_req_gtag_group_t *groups  = NULL;
+    mqtt_write_ctx_t *    ctx     = NULL;
+    char *                driver  = NULL;
+
+    if (0 == batch->n_req) {
+        return NULL;
+    }
+
+    ctx    = calloc(1, sizeof(*ctx));
+    groups = calloc(batch->n_req, sizeof(*groups));
+    driver = strdup(batch->driver);
+    if (NULL == ctx || NULL == groups || NULL == driver ||
+        NULL == (ctx->driver = strdup(batch->driver))) {
+        goto error;
+    }
+
+    // count the tags of every group, naming groups after the first request
+    for (mqtt_write_req_t *req = batch->head; req; req = req->next) {
+        neu_req_gtag_group_t *g = find_group(groups, n_group, req->group);
+        if (NULL == g) {
+            g        = &groups[n_group++];
+            g->group = req->group;
+        }
+        g->n_tag += req->n_tag;
+    }
+
+    for (; n_ready < n_group; ++n_ready) {
+        neu_req_gtag_group_t *g    = &groups[n_ready];
+        char *                name = strdup(g->group);
+        g->tags                    = calloc(g->n_tag, sizeof(*g->tags));
+        if (NULL == name || NULL == g->tags) {
+            free(name);
+            free(g->tags);
+            goto error;
+        }
+        g->group = name;
+        g->n_tag = 0;
+    }
+
+    for (mqtt_write_req_t *req = batch->head; req; req = req->next) {
+        neu_req_gtag_group_t *g = find_group(groups, n_group, req->group);
+        memcpy(&g->tags[g->n_tag], req->tags, req->n_tag * sizeof(*req->tags));
+        g->n_tag += req->n_tag;
+    }
+
+    cmd->driver  = driver;
+    cmd->n_group = n_group;
+    cmd->groups  = groups;
+
+    ctx->key     = ctx;
+    ctx->reqs    = batch->head;
+    ctx->n_req   = batch->n_req;
+    batch->head  = NULL;
+    batch->tail  = NULL;
+    batch->n_req = 0;
+    batch->n_tag = 0;
+    return ctx;
+
+error:
+    for (int i = 0; i < n_ready; ++i) {
+        neu_req_gtag_group_fini(&groups[i]);
+    }
+    free(groups);
+    free(driver);
+    if (ctx) {
+        free(ctx->driver);
+        free(ctx);
+    }
+    return NULL;
+}
+
+void mqtt_write_batch_tbl_free(mqtt_write_batch_t *tbl)
+{
+    mqtt_write_batch_t *batch = NULL, *tmp = NULL;
+    HASH_ITER(hh, tbl, batch, tmp)
+    {
+        HASH_DEL(tbl, batch);
+        req_list_free(batch->head);
+        free(batch->driver);
+        free(batch);
+    }
+}
+
+void mqtt_write_ctx_tbl_free(mqtt_write_ctx_t *tbl)
+{
+    mqtt_write_ctx_t *ctx = NULL, *tmp = NULL;
+    HASH_ITER(hh, tbl, ctx, tmp)
+    {
+        HASH_DEL(tbl, ctx);
+        mqtt_write_ctx_free(ctx);
+    }
+}
@@ -0,0 +1,95 @@
+/**
+ * NEURON IIoT System for Industry 4.0
+ * Copyright (C) 2020-2023 EMQ Technologies Co., Ltd All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ **/
+
+#ifndef NEURON_PLUGIN_MQTT_WRITE_H
+#define NEURON_PLUGIN_MQTT_WRITE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#include "neuron.h"
+#include "json/neu_json_mqtt.h"
+
+// a driver is sent what was collected once it holds that many tags
+#define MQTT_WRITE_BATCH_TAGS_MAX 1024
+
+// One write request of the write request topic.
+typedef struct mqtt_write_req {
+    neu_json_mqtt_t *      mqtt; // response context, owned until answered
+    char *                 group;
+    int                    n_tag;
+    neu_resp_tag_value_t * tags;
+    struct mqtt_write_req *next;
+} mqtt_write_req_t;
+
+void mqtt_write_req_free(mqtt_write_req_t *req);
+
+// Write requests to one driver collected within the write linger time.
+typedef struct mqtt_write_batch {
+    char *            driver;
+    mqtt_write_req_t *head;
+    mqtt_write_req_t *tail;
+    uint32_t          n_req;
+    uint32_t          n_tag;
+    int64_t           first_ts; // when the first request was added, ms
+    UT_hash_handle    hh;
+} mqtt_write_batch_t;
+
+// Context of one coalesced write, in flight until the driver responds.
+typedef struct mqtt_write_ctx {
+    struct mqtt_write_ctx *key; // the context itself, to find it by address
+    char *                 driver;
+    mqtt_write_req_t *     reqs;
+    uint32_t               n_req;
+    UT_hash_handle         hh;
+} mqtt_write_ctx_t;
+
+void mqtt_write_ctx_free(mqtt_write_ctx_t *ctx);
+
+// find the batch of `driver` or add an empty one, NULL if out of memory
+mqtt_write_batch_t *mqtt_write_batch_get(mqtt_write_batch_t **tbl,
+                                         const char *         driver);
+
+// NOTE: we take ownership of `req`
+void mqtt_write_batch_add(mqtt_write_batch_t *batch, mqtt_write_req_t *req,
+                          int64_t now);
+
+/**
+ * @brief Move the requests of the batch into a new context and empty the
+ *        batch.
+ *
+ * @param[out] cmd The tags of all requests merged by group, in the order the
+ *                 requests were added, so later writes of a tag win.
+ * @return The context, NULL if the batch is empty or out of memory, in which
+ *         case the batch is left as it was.
+ */
+mqtt_write_ctx_t *mqtt_write_batch_take(mqtt_write_batch_t *   batch,
+                                        neu_req_write_gtags_t *cmd);
+
+void mqtt_write_batch_tbl_free(mqtt_write_batch_t *tbl);
+void mqtt_write_ctx_tbl_free(mqtt_write_ctx_t *tbl);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
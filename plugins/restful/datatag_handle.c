@@ -16,25 +16,30 @@
  * along with this program; if not, write to the Free Software Foundation,
  * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
  **/
+#include <pthread.h>
 #include <stdlib.h>
 
 #include "parser/neu_json_tag.h"
+#include "utils/history.h"
+#include "persist/persist.h"
 #include "plugin.h"
 #include "utils/log.h"
 #include "json/neu_json_error.h"
 #include "json/neu_json_fn.h"
+#include "json/neu_json_rw.h"
 
 #include "handle.h"
 #include "tag.h"
 #include "utils/http.h"
 
 #include "datatag_handle.h"
+#include "stream.h"
 
 void handle_add_tags(nng_aio *aio)
 {
     neu_plugin_t *plugin = neu_rest_get_plugin();
 
-    NEU_PROCESS_HTTP_REQUEST_VALIDATE_JWT(
+    NEU_PROCESS_HTTP_REQUEST_JSON_VALIDATE_JWT(
         aio, neu_json_add_tags_req_t, neu_json_decode_add_tags_req, {
             if (strlen(req->node) >= NEU_NODE_NAME_LEN) {
                 CHECK_NODE_NAME_LENGTH_ERR;
@@ -53,12 +58,14 @@ void handle_add_tags(nng_aio *aio)
                 cmd.tags  = calloc(req->n_tag, sizeof(neu_datatag_t));
 
                 for (int i = 0; i < req->n_tag; i++) {
-                    cmd.tags[i].attribute = req->tags[i].attribute;
-                    cmd.tags[i].type      = req->tags[i].type;
-                    cmd.tags[i].precision = req->tags[i].precision;
-                    cmd.tags[i].decimal   = req->tags[i].decimal;
-                    cmd.tags[i].address   = strdup(req->tags[i].address);
-                    cmd.tags[i].name      = strdup(req->tags[i].name);
+                    cmd.tags[i].attribute    = req->tags[i].attribute;
+                    cmd.tags[i].type         = req->tags[i].type;
+                    cmd.tags[i].precision    = req->tags[i].precision;
+                    cmd.tags[i].decimal      = req->tags[i].decimal;
+                    cmd.tags[i].deadband     = req->tags[i].deadband;
+                    cmd.tags[i].poll_divisor = req->tags[i].poll_divisor;
+                    cmd.tags[i].address      = strdup(req->tags[i].address);
+                    cmd.tags[i].name         = strdup(req->tags[i].name);
                     if (req->tags[i].description != NULL) {
                         cmd.tags[i].description =
                             strdup(req->tags[i].description);
@@ -96,18 +103,18 @@ void handle_add_tags_resp(nng_aio *aio, neu_resp_add_tag_t *resp)
     free(result);
 }
 
-void handle_add_gtags(nng_aio *aio)
+static void send_gtags(nng_aio *aio, neu_reqresp_type_e type)
 {
     neu_plugin_t *plugin = neu_rest_get_plugin();
 
-    NEU_PROCESS_HTTP_REQUEST_VALIDATE_JWT(
+    NEU_PROCESS_HTTP_REQUEST_JSON_VALIDATE_JWT(
         aio, neu_json_add_gtags_req_t, neu_json_decode_add_gtags_req, {
             int                ret    = 0;
             neu_reqresp_head_t header = { 0 };
             neu_req_add_gtag_t cmd    = { 0 };
             int                err_type;
             header.ctx  = aio;
-            header.type = NEU_REQ_ADD_GTAG;
+            header.type = type;
 
             if (strlen(req->node) >= NEU_NODE_NAME_LEN) {
                 err_type = NEU_ERR_NODE_NAME_TOO_LONG;
@@ -144,6 +151,10 @@ void handle_add_gtags(nng_aio *aio)
                         req->groups[i].tags[j].precision;
                     cmd.groups[i].tags[j].decimal =
                         req->groups[i].tags[j].decimal;
+                    cmd.groups[i].tags[j].deadband =
+                        req->groups[i].tags[j].deadband;
+                    cmd.groups[i].tags[j].poll_divisor =
+                        req->groups[i].tags[j].poll_divisor;
                     cmd.groups[i].tags[j].address =
                         strdup(req->groups[i].tags[j].address);
                     cmd.groups[i].tags[j].name =
@@ -177,6 +188,18 @@ void handle_add_gtags(nng_aio *aio)
         })
 }
 
+void handle_add_gtags(nng_aio *aio)
+{
+    send_gtags(aio, NEU_REQ_ADD_GTAG);
+}
+
+// the listed groups end up with exactly the tags in the request, unchanged
+// tags keep their values and the others are added, updated or deleted
+void handle_apply_gtags(nng_aio *aio)
+{
+    send_gtags(aio, NEU_REQ_APPLY_GTAG);
+}
+
 void handle_add_gtags_resp(nng_aio *aio, neu_resp_add_tag_t *resp)
 {
     neu_json_add_gtag_res_t res    = { 0 };
@@ -225,9 +248,9 @@ void handle_del_tags(nng_aio *aio)
                 }
             }
 
-            cmd.tags = calloc(req->n_tags, sizeof(char *));
+            cmd.tags = calloc(cmd.n_tag, sizeof(char *));
 
-            for (int i = 0; i < req->n_tags; i++) {
+            for (int i = 0; i < cmd.n_tag; i++) {
                 cmd.tags[i] = strdup(req->tags[i]);
             }
 
@@ -265,12 +288,14 @@ void handle_update_tags(nng_aio *aio)
             cmd.tags  = calloc(req->n_tag, sizeof(neu_datatag_t));
 
             for (int i = 0; i < req->n_tag; i++) {
-                cmd.tags[i].attribute = req->tags[i].attribute;
-                cmd.tags[i].type      = req->tags[i].type;
-                cmd.tags[i].precision = req->tags[i].precision;
-                cmd.tags[i].decimal   = req->tags[i].decimal;
-                cmd.tags[i].address   = strdup(req->tags[i].address);
-                cmd.tags[i].name      = strdup(req->tags[i].name);
+                cmd.tags[i].attribute    = req->tags[i].attribute;
+                cmd.tags[i].type         = req->tags[i].type;
+                cmd.tags[i].precision    = req->tags[i].precision;
+                cmd.tags[i].decimal      = req->tags[i].decimal;
+                cmd.tags[i].deadband     = req->tags[i].deadband;
+                cmd.tags[i].poll_divisor = req->tags[i].poll_divisor;
+                cmd.tags[i].address      = strdup(req->tags[i].address);
+                cmd.tags[i].name         = strdup(req->tags[i].name);
                 if (req->tags[i].description != NULL) {
                     cmd.tags[i].description = strdup(req->tags[i].description);
                 } else {
@@ -296,6 +321,44 @@ void handle_update_tags_resp(nng_aio *aio, neu_resp_update_tag_t *resp)
     handle_add_tags_resp(aio, resp);
 }
 
+static int get_tags_param(nng_aio *aio, const char *name, uintmax_t max,
+                          uintmax_t *value)
+{
+    size_t len = 0;
+
+    *value = 0;
+    if (neu_http_get_param(aio, name, &len) != NULL &&
+        neu_http_get_param_uintmax(aio, name, value) != 0) {
+        return -1;
+    }
+
+    return *value > max ? -1 : 0;
+}
+
+static int get_tags_page(nng_aio *aio, neu_req_get_tag_t *cmd)
+{
+    uintmax_t type = 0, attribute = 0, offset = 0, limit = 0;
+    ssize_t   len  = 0;
+
+    if (get_tags_param(aio, "type", NEU_TYPE_ERROR, &type) != 0 ||
+        get_tags_param(aio, "attribute", UINT8_MAX, &attribute) != 0 ||
+        get_tags_param(aio, "offset", UINT32_MAX, &offset) != 0 ||
+        get_tags_param(aio, "limit", UINT32_MAX, &limit) != 0) {
+        return -1;
+    }
+
+    len = neu_http_get_param_str(aio, "after", cmd->after, sizeof(cmd->after));
+    if (len == -1 || len >= (ssize_t) sizeof(cmd->after)) {
+        return -1;
+    }
+
+    cmd->type      = type;
+    cmd->attribute = attribute;
+    cmd->offset    = offset;
+    cmd->limit     = limit;
+    return 0;
+}
+
 void handle_get_tags(nng_aio *aio)
 {
     neu_plugin_t *     plugin                     = neu_rest_get_plugin();
@@ -328,6 +391,14 @@ void handle_get_tags(nng_aio *aio)
         strcpy(cmd.name, tag_name);
     }
 
+    // filters and paging are done by the driver, only the page comes back
+    if (get_tags_page(aio, &cmd) != 0) {
+        NEU_JSON_RESPONSE_ERROR(NEU_ERR_PARAM_IS_WRONG, {
+            neu_http_response(aio, NEU_ERR_PARAM_IS_WRONG, result_error);
+        })
+        return;
+    }
+
     strcpy(cmd.driver, node);
     strcpy(cmd.group, group);
 
@@ -345,19 +416,22 @@ void handle_get_tags_resp(nng_aio *aio, neu_resp_get_tag_t *tags)
     char *                   result   = NULL;
 
     tags_res.n_tag = utarray_len(tags->tags);
+    tags_res.total = tags->total;
     tags_res.tags  = calloc(tags_res.n_tag, sizeof(neu_json_tag_t));
 
     utarray_foreach(tags->tags, neu_datatag_t *, tag)
     {
         int index = utarray_eltidx(tags->tags, tag);
 
-        tags_res.tags[index].name        = tag->name;
-        tags_res.tags[index].address     = tag->address;
-        tags_res.tags[index].description = tag->description;
-        tags_res.tags[index].type        = tag->type;
-        tags_res.tags[index].attribute   = tag->attribute;
-        tags_res.tags[index].precision   = tag->precision;
-        tags_res.tags[index].decimal     = tag->decimal;
+        tags_res.tags[index].name         = tag->name;
+        tags_res.tags[index].address      = tag->address;
+        tags_res.tags[index].description  = tag->description;
+        tags_res.tags[index].type         = tag->type;
+        tags_res.tags[index].attribute    = tag->attribute;
+        tags_res.tags[index].precision    = tag->precision;
+        tags_res.tags[index].decimal      = tag->decimal;
+        tags_res.tags[index].deadband     = tag->deadband;
+        tags_res.tags[index].poll_divisor = tag->poll_divisor;
         if (neu_tag_attribute_test(tag, NEU_ATTRIBUTE_STATIC)) {
             neu_tag_get_static_value_json(tag, &tags_res.tags[index].t,
                                           &tags_res.tags[index].value);
@@ -373,4 +447,606 @@ void handle_get_tags_resp(nng_aio *aio, neu_resp_get_tag_t *tags)
     free(result);
     free(tags_res.tags);
     utarray_free(tags->tags);
-}
\ No newline at end of file
+}
+
+// points of one history query, by default and at most
+#define TAG_HISTORY_LIMIT 1000
+#define TAG_HISTORY_LIMIT_MAX 10000
+
+static int get_tag_history_name(nng_aio *aio, const char *name, char *buf,
+                                size_t size)
+{
+    ssize_t len = neu_http_get_param_str(aio, name, buf, size);
+
+    return len > 0 && len < (ssize_t) size ? 0 : -1;
+}
+
+static int get_tag_history_range(nng_aio *aio, neu_req_get_tag_history_t *cmd)
+{
+    uintmax_t since = 0, until = 0, step = 0, limit = 0;
+
+    if (get_tags_param(aio, "since", INT64_MAX, &since) != 0 ||
+        get_tags_param(aio, "until", INT64_MAX, &until) != 0 ||
+        get_tags_param(aio, "step", INT64_MAX, &step) != 0 ||
+        get_tags_param(aio, "limit", TAG_HISTORY_LIMIT_MAX, &limit) != 0) {
+        return -1;
+    }
+
+    cmd->since = since;
+    cmd->until = until > 0 ? (int64_t) until : INT64_MAX;
+    cmd->step  = step;
+    cmd->limit = limit > 0 ? limit : TAG_HISTORY_LIMIT;
+    return cmd->since < cmd->until ? 0 : -1;
+}
+
+void handle_get_tag_history(nng_aio *aio)
+{
+    neu_plugin_t *            plugin = neu_rest_get_plugin();
+    int                       ret    = 0;
+    neu_req_get_tag_history_t cmd    = { 0 };
+    neu_reqresp_head_t        header = {
+        .ctx  = aio,
+        .type = NEU_REQ_GET_TAG_HISTORY,
+    };
+
+    NEU_VALIDATE_JWT(aio);
+
+    if (get_tag_history_name(aio, "node", cmd.driver, sizeof(cmd.driver)) !=
+            0 ||
+        get_tag_history_name(aio, "group", cmd.group, sizeof(cmd.group)) !=
+            0 ||
+        get_tag_history_name(aio, "tag", cmd.tag, sizeof(cmd.tag)) != 0 ||
+        get_tag_history_range(aio, &cmd) != 0) {
+        NEU_JSON_RESPONSE_ERROR(NEU_ERR_PARAM_IS_WRONG, {
+            neu_http_response(aio, NEU_ERR_PARAM_IS_WRONG, result_error);
+        })
+        return;
+    }
+
+    ret = neu_plugin_op(plugin, header, &cmd);
+    if (ret != 0) {
+        NEU_JSON_RESPONSE_ERROR(NEU_ERR_IS_BUSY, {
+            neu_http_response(aio, NEU_ERR_IS_BUSY, result_error);
+        });
+    }
+}
+
+void handle_get_tag_history_resp(nng_aio *                   aio,
+                                 neu_resp_get_tag_history_t *resp)
+{
+    neu_json_tag_history_resp_t json   = { 0 };
+    char *                      result = NULL;
+
+    json.downsampled = resp->step > 0;
+    json.truncated   = resp->truncated;
+    json.n_point     = utarray_len(resp->points);
+    json.points = calloc(json.n_point, sizeof(neu_json_tag_history_point_t));
+
+    utarray_foreach(resp->points, neu_history_point_t *, p)
+    {
+        neu_json_tag_history_point_t *point =
+            &json.points[utarray_eltidx(resp->points, p)];
+
+        point->timestamp = p->timestamp;
+        point->count     = p->count;
+        point->min       = p->min;
+        point->max       = p->max;
+        point->avg       = p->avg;
+        point->last      = p->last;
+    }
+
+    neu_json_encode_by_fn(&json, neu_json_encode_tag_history_resp, &result);
+
+    neu_http_ok(aio, result);
+
+    free(result);
+    free(json.points);
+    utarray_free(resp->points);
+}
+#define GTAGS_STREAM_HTTP_HEAD                                      \
+    "HTTP/1.1 200 OK\r\n"                                           \
+    "Content-Type: application/x-ndjson\r\n"                        \
+    "Transfer-Encoding: chunked\r\n"                                \
+    "Access-Control-Allow-Origin: *\r\n"                            \
+    "Access-Control-Allow-Methods: POST,GET,PUT,DELETE,OPTIONS\r\n" \
+    "Access-Control-Allow-Headers: *\r\n"                           \
+    "Connection: close\r\n\r\n"
+
+// tags sent to the driver by one add request of an import
+#define GTAGS_IMPORT_CHUNK 1000
+
+// Write one ndjson line as one http chunk.
+static int gtags_stream_line(neu_rest_stream_t *stream, const char *line)
+{
+    char   size[32] = { 0 };
+    size_t len      = strlen(line);
+
+    snprintf(size, sizeof(size), "%zx\r\n", len + 1);
+    if (neu_rest_stream_write(stream, size, strlen(size)) != 0 ||
+        neu_rest_stream_write(stream, line, len) != 0 ||
+        neu_rest_stream_write(stream, "\n\r\n", 3) != 0) {
+        return -1;
+    }
+
+    return 0;
+}
+
+static void gtags_stream_end(neu_rest_stream_t *stream)
+{
+    neu_rest_stream_write(stream, "0\r\n\r\n", 5);
+    neu_rest_stream_close(stream);
+}
+
+static char *gtags_line_encode(const char *group, uint32_t interval,
+                               neu_datatag_t *tag)
+{
+    char *          line     = NULL;
+    void *          json_obj = neu_json_encode_new();
+    neu_json_tag_t  json_tag = {
+        .name         = tag->name,
+        .address      = tag->address,
+        .description  = tag->description,
+        .type         = tag->type,
+        .attribute    = tag->attribute,
+        .precision    = tag->precision,
+        .decimal      = tag->decimal,
+        .deadband     = tag->deadband,
+        .poll_divisor = tag->poll_divisor,
+        .t            = NEU_JSON_UNDEFINE,
+    };
+    neu_json_elem_t elems[]  = {
+        {
+            .name      = "group",
+            .t         = NEU_JSON_STR,
+            .v.val_str = (char *) group,
+        },
+        {
+            .name      = "interval",
+            .t         = NEU_JSON_INT,
+            .v.val_int = interval,
+        },
+    };
+
+    if (json_obj == NULL) {
+        return NULL;
+    }
+
+    if (neu_tag_attribute_test(tag, NEU_ATTRIBUTE_STATIC)) {
+        neu_tag_get_static_value_json(tag, &json_tag.t, &json_tag.value);
+    }
+
+    if (neu_json_encode_field(json_obj, elems, NEU_JSON_ELEM_SIZE(elems)) ==
+            0 &&
+        neu_json_encode_tag(json_obj, &json_tag) == 0) {
+        neu_json_encode(json_obj, &line);
+    }
+
+    neu_json_encode_free(json_obj);
+    return line;
+}
+
+// Export every tag of a node as one line of ndjson per tag, in the group
+// order of the persisted config, so a 100k tag node never becomes one json
+// document in memory.
+void handle_gtags_export(nng_aio *aio)
+{
+    char               node[NEU_NODE_NAME_LEN] = { 0 };
+    UT_array *         groups                  = NULL;
+    neu_rest_stream_t *stream                  = NULL;
+    int                n_tag                   = 0;
+
+    NEU_VALIDATE_JWT(aio);
+
+    if (neu_http_get_param_str(aio, "node", node, sizeof(node)) <= 0) {
+        NEU_JSON_RESPONSE_ERROR(NEU_ERR_PARAM_IS_WRONG, {
+            neu_http_response(aio, NEU_ERR_PARAM_IS_WRONG, result_error);
+        })
+        return;
+    }
+
+    if (neu_persister_load_group_tags(node, &groups) != 0) {
+        NEU_JSON_RESPONSE_ERROR(NEU_ERR_EINTERNAL, {
+            neu_http_response(aio, NEU_ERR_EINTERNAL, result_error);
+        })
+        return;
+    }
+
+    stream = neu_rest_stream_new(aio);
+    if (stream == NULL) {
+        utarray_free(groups);
+        NEU_JSON_RESPONSE_ERROR(NEU_ERR_EINTERNAL, {
+            neu_http_response(aio, NEU_ERR_EINTERNAL, result_error);
+        })
+        return;
+    }
+
+    neu_rest_stream_write(stream, GTAGS_STREAM_HTTP_HEAD,
+                          strlen(GTAGS_STREAM_HTTP_HEAD));
+
+    utarray_foreach(groups, neu_persist_group_tags_t *, group)
+    {
+        utarray_foreach(group->tags, neu_datatag_t *, tag)
+        {
+            char *line = gtags_line_encode(group->name, group->interval, tag);
+            int   ret  = -1;
+
+            if (line != NULL) {
+                ret = gtags_stream_line(stream, line);
+                free(line);
+            }
+
+            if (ret != 0) {
+                nlog_warn("export %s tags stop after %d tags", node, n_tag);
+                goto end;
+            }
+            n_tag += 1;
+        }
+    }
+
+end:
+    gtags_stream_end(stream);
+    utarray_free(groups);
+}
+
+// An import walks the body one line at a time and hands the driver at most
+// GTAGS_IMPORT_CHUNK tags per add request, the next chunk is only parsed
+// once the driver answered the previous one. A line of progress is streamed
+// back per chunk, the last line carries the error.
+typedef struct gtags_import {
+    pthread_mutex_t      mtx;
+    neu_rest_stream_t *  stream;
+    char                 driver[NEU_NODE_NAME_LEN];
+    char *               body;
+    size_t               len;
+    size_t               pos;      // offset of the first line not parsed
+    int                  line;     // number of the last line parsed
+    int                  err_line; // first line of the chunk in flight
+    int                  n_chunk;  // tags of the chunk in flight
+    int                  n_tag;    // tags imported
+    struct gtags_import *next;
+} gtags_import_t;
+
+static pthread_mutex_t imports_mtx = PTHREAD_MUTEX_INITIALIZER;
+static gtags_import_t *imports     = NULL;
+
+static void gtags_import_free(gtags_import_t *imp)
+{
+    pthread_mutex_destroy(&imp->mtx);
+    free(imp->body);
+    free(imp);
+}
+
+static gtags_import_t *gtags_import_find(void *ctx)
+{
+    gtags_import_t *imp = NULL;
+
+    pthread_mutex_lock(&imports_mtx);
+    for (imp = imports; imp != NULL; imp = imp->next) {
+        if (imp == ctx) {
+            break;
+        }
+    }
+    pthread_mutex_unlock(&imports_mtx);
+
+    return imp;
+}
+
+static void gtags_import_remove(gtags_import_t *imp)
+{
+    pthread_mutex_lock(&imports_mtx);
+    for (gtags_import_t **pp = &imports; *pp != NULL; pp = &(*pp)->next) {
+        if (*pp == imp) {
+            *pp = imp->next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&imports_mtx);
+}
+
+static void gtags_cmd_fini(neu_req_add_gtag_t *cmd)
+{
+    for (int i = 0; i < cmd->n_group; i++) {
+        for (int j = 0; j < cmd->groups[i].n_tag; j++) {
+            neu_tag_fini(&cmd->groups[i].tags[j]);
+        }
+        free(cmd->groups[i].tags);
+    }
+    free(cmd->groups);
+}
+
+static int gtags_cmd_append(neu_req_add_gtag_t *cmd, const char *group,
+                            int interval, neu_json_tag_t *json_tag)
+{
+    neu_gdatatag_t *gtag = NULL;
+    neu_datatag_t * tag  = NULL;
+
+    // consecutive lines of a group share one group of the request
+    if (cmd->n_group > 0 &&
+        strcmp(cmd->groups[cmd->n_group - 1].group, group) == 0) {
+        gtag = &cmd->groups[cmd->n_group - 1];
+    } else {
+        gtag = realloc(cmd->groups, (cmd->n_group + 1) * sizeof(*gtag));
+        if (gtag == NULL) {
+            return NEU_ERR_EINTERNAL;
+        }
+        cmd->groups = gtag;
+        gtag        = &cmd->groups[cmd->n_group++];
+        memset(gtag, 0, sizeof(*gtag));
+        strcpy(gtag->group, group);
+        gtag->interval = interval;
+    }
+
+    tag = realloc(gtag->tags, (gtag->n_tag + 1) * sizeof(*tag));
+    if (tag == NULL) {
+        return NEU_ERR_EINTERNAL;
+    }
+    gtag->tags = tag;
+    tag        = &gtag->tags[gtag->n_tag++];
+    memset(tag, 0, sizeof(*tag));
+
+    tag->attribute    = json_tag->attribute;
+    tag->type         = json_tag->type;
+    tag->precision    = json_tag->precision;
+    tag->decimal      = json_tag->decimal;
+    tag->deadband     = json_tag->deadband;
+    tag->poll_divisor = json_tag->poll_divisor;
+    tag->address      = strdup(json_tag->address);
+    tag->name         = strdup(json_tag->name);
+    tag->description  = strdup(
+        json_tag->description != NULL ? json_tag->description : "");
+    if (NEU_ATTRIBUTE_STATIC & json_tag->attribute) {
+        neu_tag_set_static_value_json(tag, json_tag->t, &json_tag->value);
+    }
+
+    return NEU_ERR_SUCCESS;
+}
+
+static int gtags_line_decode(char *buf, size_t len, neu_req_add_gtag_t *cmd)
+{
+    int             ret      = NEU_ERR_BODY_IS_WRONG;
+    void *          json_obj = neu_json_decode_newb(buf, len);
+    neu_json_tag_t  tag      = { 0 };
+    neu_json_elem_t elems[]  = {
+        {
+            .name = "group",
+            .t    = NEU_JSON_STR,
+        },
+        {
+            .name = "interval",
+            .t    = NEU_JSON_INT,
+        },
+    };
+
+    if (json_obj == NULL) {
+        return ret;
+    }
+
+    if (neu_json_decode_by_json(json_obj, NEU_JSON_ELEM_SIZE(elems), elems) !=
+            0 ||
+        neu_json_decode_tag_json(json_obj, &tag) != 0) {
+        goto end;
+    }
+
+    if (strlen(elems[0].v.val_str) >= NEU_GROUP_NAME_LEN) {
+        ret = NEU_ERR_GROUP_NAME_TOO_LONG;
+    } else if (elems[1].v.val_int < NEU_DEFAULT_GROUP_INTERVAL) {
+        ret = NEU_ERR_GROUP_PARAMETER_INVALID;
+    } else if (strlen(tag.name) >= NEU_TAG_NAME_LEN) {
+        ret = NEU_ERR_TAG_NAME_TOO_LONG;
+    } else {
+        ret = gtags_cmd_append(cmd, elems[0].v.val_str, elems[1].v.val_int,
+                               &tag);
+    }
+    neu_json_decode_tag_fini(&tag);
+
+end:
+    free(elems[0].v.val_str);
+    neu_json_decode_free(json_obj);
+    return ret;
+}
+
+static bool gtags_line_blank(const char *line, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        if (line[i] != ' ' && line[i] != '\t' && line[i] != '\r') {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Parse the lines of the next chunk into `cmd`, which has no group once the
+// body is exhausted.
+static int gtags_import_parse(gtags_import_t *imp, neu_req_add_gtag_t *cmd)
+{
+    strcpy(cmd->driver, imp->driver);
+    imp->n_chunk = 0;
+
+    while (imp->pos < imp->len && imp->n_chunk < GTAGS_IMPORT_CHUNK) {
+        char * line = imp->body + imp->pos;
+        char * eol  = memchr(line, '\n', imp->len - imp->pos);
+        size_t len  = eol != NULL ? (size_t)(eol - line) : imp->len - imp->pos;
+
+        imp->pos += eol != NULL ? len + 1 : len;
+        imp->line += 1;
+        if (gtags_line_blank(line, len)) {
+            continue;
+        }
+
+        if (imp->n_chunk == 0) {
+            imp->err_line = imp->line;
+        }
+
+        int ret = gtags_line_decode(line, len, cmd);
+        if (ret != NEU_ERR_SUCCESS) {
+            imp->err_line = imp->line;
+            return ret;
+        }
+        imp->n_chunk += 1;
+    }
+
+    return NEU_ERR_SUCCESS;
+}
+
+// Stream the last line, returns true for the caller to release the import.
+static bool gtags_import_end(gtags_import_t *imp, int error)
+{
+    char line[128] = { 0 };
+
+    if (error == NEU_ERR_SUCCESS) {
+        snprintf(line, sizeof(line), "{\"error\": 0, \"tags\": %d}",
+                 imp->n_tag);
+        nlog_notice("import %d tags into %s", imp->n_tag, imp->driver);
+    } else {
+        snprintf(line, sizeof(line),
+                 "{\"error\": %d, \"line\": %d, \"tags\": %d}", error,
+                 imp->err_line, imp->n_tag);
+        nlog_warn("import into %s fail at line %d, error: %d", imp->driver,
+                  imp->err_line, error);
+    }
+
+    gtags_stream_line(imp->stream, line);
+    gtags_stream_end(imp->stream);
+    imp->stream = NULL;
+    return true;
+}
+
+static bool gtags_import_next(neu_plugin_t *plugin, gtags_import_t *imp)
+{
+    neu_reqresp_head_t header = {
+        .ctx  = imp,
+        .type = NEU_REQ_ADD_GTAG,
+    };
+    neu_req_add_gtag_t cmd = { 0 };
+    int                ret = gtags_import_parse(imp, &cmd);
+
+    if (ret == NEU_ERR_SUCCESS && cmd.n_group == 0) {
+        return gtags_import_end(imp, NEU_ERR_SUCCESS);
+    }
+
+    if (ret == NEU_ERR_SUCCESS && neu_plugin_op(plugin, header, &cmd) != 0) {
+        ret = NEU_ERR_IS_BUSY;
+    }
+
+    if (ret != NEU_ERR_SUCCESS) {
+        gtags_cmd_fini(&cmd);
+        return gtags_import_end(imp, ret);
+    }
+
+    return false;
+}
+
+// Import the ndjson lines of the body, in the format of the export, into
+// node `node`. Tags of the chunks already answered stay imported when a
+// later chunk fails.
+void handle_gtags_import(nng_aio *aio)
+{
+    neu_plugin_t *  plugin   = neu_rest_get_plugin();
+    gtags_import_t *imp      = NULL;
+    void *          body     = NULL;
+    size_t          len      = 0;
+    int             err_type = NEU_ERR_SUCCESS;
+    bool            complete = false;
+
+    NEU_VALIDATE_JWT(aio);
+
+    imp = calloc(1, sizeof(gtags_import_t));
+    if (imp == NULL) {
+        err_type = NEU_ERR_EINTERNAL;
+        goto error;
+    }
+    pthread_mutex_init(&imp->mtx, NULL);
+
+    if (neu_http_get_param_str(aio, "node", imp->driver,
+                               sizeof(imp->driver)) <= 0) {
+        err_type = NEU_ERR_PARAM_IS_WRONG;
+        goto error;
+    }
+
+    if (neu_http_get_body(aio, &body, &len) != 0) {
+        err_type = NEU_ERR_BODY_IS_WRONG;
+        goto error;
+    }
+    imp->body = body;
+    imp->len  = len;
+
+    imp->stream = neu_rest_stream_new(aio);
+    if (imp->stream == NULL) {
+        err_type = NEU_ERR_EINTERNAL;
+        goto error;
+    }
+
+    pthread_mutex_lock(&imp->mtx);
+
+    pthread_mutex_lock(&imports_mtx);
+    imp->next = imports;
+    imports   = imp;
+    pthread_mutex_unlock(&imports_mtx);
+
+    neu_rest_stream_write(imp->stream, GTAGS_STREAM_HTTP_HEAD,
+                          strlen(GTAGS_STREAM_HTTP_HEAD));
+    complete = gtags_import_next(plugin, imp);
+
+    pthread_mutex_unlock(&imp->mtx);
+
+    if (complete) {
+        gtags_import_remove(imp);
+        gtags_import_free(imp);
+    }
+    return;
+
+error:
+    if (imp != NULL) {
+        gtags_import_free(imp);
+    }
+    NEU_JSON_RESPONSE_ERROR(
+        err_type, { neu_http_response(aio, err_type, result_error); });
+}
+
+bool handle_gtags_import_resp(neu_reqresp_head_t *header, void *data)
+{
+    neu_plugin_t *  plugin   = neu_rest_get_plugin();
+    gtags_import_t *imp      = gtags_import_find(header->ctx);
+    bool            complete = false;
+    int             error    = NEU_ERR_SUCCESS;
+    char            line[64] = { 0 };
+
+    if (imp == NULL) {
+        return false;
+    }
+
+    if (header->type == NEU_RESP_ADD_GTAG) {
+        error = ((neu_resp_add_tag_t *) data)->error;
+    } else if (header->type == NEU_RESP_ERROR) {
+        error = ((neu_resp_error_t *) data)->error;
+    } else {
+        error = NEU_ERR_EINTERNAL;
+    }
+
+    pthread_mutex_lock(&imp->mtx);
+    if (error != NEU_ERR_SUCCESS) {
+        complete = gtags_import_end(imp, error);
+    } else {
+        imp->n_tag += imp->n_chunk;
+        snprintf(line, sizeof(line), "{\"line\": %d, \"tags\": %d}",
+                 imp->line, imp->n_tag);
+        if (gtags_stream_line(imp->stream, line) != 0) {
+            // nobody left to report to, stop after this chunk
+            nlog_warn("import into %s stop, peer gone", imp->driver);
+            gtags_stream_end(imp->stream);
+            imp->stream = NULL;
+            complete    = true;
+        } else {
+            complete = gtags_import_next(plugin, imp);
+        }
+    }
+    pthread_mutex_unlock(&imp->mtx);
+
+    if (complete) {
+        gtags_import_remove(imp);
+        gtags_import_free(imp);
+    }
+
+    return true;
+}
@@ -27,11 +27,19 @@
 void handle_add_tags(nng_aio *aio);
 void handle_add_tags_resp(nng_aio *aio, neu_resp_add_tag_t *resp);
 void handle_add_gtags(nng_aio *aio);
+void handle_apply_gtags(nng_aio *aio);
 void handle_add_gtags_resp(nng_aio *aio, neu_resp_add_tag_t *resp);
 void handle_del_tags(nng_aio *aio);
 void handle_update_tags(nng_aio *aio);
 void handle_update_tags_resp(nng_aio *aio, neu_resp_update_tag_t *resp);
 void handle_get_tags(nng_aio *aio);
 void handle_get_tags_resp(nng_aio *aio, neu_resp_get_tag_t *tags);
+void handle_get_tag_history(nng_aio *aio);
+void handle_get_tag_history_resp(nng_aio *                   aio,
+                                 neu_resp_get_tag_history_t *resp);
+void handle_gtags_export(nng_aio *aio);
+void handle_gtags_import(nng_aio *aio);
+// returns true if the response belongs to a tag import and was consumed
+bool handle_gtags_import_resp(neu_reqresp_head_t *header, void *data);
 
 #endif
\ No newline at end of file
@@ -17,7 +17,9 @@
  * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
  **/
 
+#include <pthread.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <jansson.h>
 
@@ -28,6 +30,7 @@
 #include "parser/neu_json_group_config.h"
 #include "parser/neu_json_node.h"
 #include "parser/neu_json_tag.h"
+#include "persist/persist.h"
 #include "plugin.h"
 #include "json/neu_json_error.h"
 #include "json/neu_json_fn.h"
@@ -35,33 +38,23 @@
 #include "handle.h"
 #include "tag.h"
 #include "utils/http.h"
+#include "utils/log.h"
 #include "utils/set.h"
 #include "utils/utarray.h"
 
 #include "group_config_handle.h"
+#include "stream.h"
 
 typedef enum {
-    GET_GLOBAL,
-    PUT_GLOBAL,
     GET_DRIVERS,
 } context_type_e;
 
 typedef enum {
     STATE_START,
-    STATE_GET_APP,
     STATE_GET_DRIVER,
     STATE_GET_GROUP,
     STATE_GET_TAG,
-    STATE_GET_SUBSCRIPTION,
-    STATE_GET_APP_SETTING,
     STATE_GET_DRIVER_SETTING,
-    STATE_DEL_APP,
-    STATE_DEL_DRIVER,
-    STATE_ADD_NODE,
-    STATE_ADD_GROUP,
-    STATE_ADD_TAG,
-    STATE_ADD_SUBSCRIPTION,
-    STATE_ADD_SETTING,
     STATE_END,
 } context_state_e;
 
@@ -70,53 +63,32 @@ typedef struct {
     context_type_e  type;
     context_state_e state;
     int             error;
-    union {
-        // get
-        struct {
-            void *                  json;
-            UT_array *              apps;
-            UT_array *              drivers;
-            UT_array *              groups;
-            void *                  iter;
-            neu_json_driver_array_t jdrivers; // get drivers
-            char *                  names;    //
-            neu_strset_t            filter;   //
-        };
-        // put
-        struct {
-            neu_json_global_config_req_t *req;
-            UT_array *                    nodes;
-            size_t                        idx;
-        };
-    };
+    void *                  json;
+    UT_array *              drivers;
+    UT_array *              groups;
+    void *                  iter;
+    neu_json_driver_array_t jdrivers; // get drivers
+    char *                  names;    //
+    neu_strset_t            filter;   //
 } context_t;
 
 static int get_nodes(context_t *ctx, neu_node_type_e type);
-static int get_nodes_resp(context_t *ctx, neu_resp_get_node_t *nodes);
 static int get_drivers_resp(context_t *ctx, neu_resp_get_node_t *nodes);
 static int get_groups(context_t *ctx, int unused);
-static int get_groups_resp(context_t *ctx, neu_resp_get_driver_group_t *groups);
 static int get_driver_groups_resp(context_t *                  ctx,
                                   neu_resp_get_driver_group_t *groups);
 static int get_tags(context_t *ctx, neu_resp_driver_group_info_t *info);
-static int get_tags_resp(context_t *ctx, neu_resp_get_tag_t *tags);
 static int get_driver_tags_resp(context_t *ctx, neu_resp_get_tag_t *tags);
-static int get_subscriptions(context_t *ctx, neu_resp_node_info_t *info);
-static int get_subscriptions_resp(context_t *                     ctx,
-                                  neu_resp_get_subscribe_group_t *groups);
 static int get_setting(context_t *ctx, neu_resp_node_info_t *info);
-static int get_setting_resp(context_t *                  ctx,
-                            neu_resp_get_node_setting_t *setting);
 static int get_driver_setting_resp(context_t *                  ctx,
                                    neu_resp_get_node_setting_t *setting);
 
-static int del_node(context_t *ctx, neu_resp_node_info_t *info);
-static int add_node(context_t *ctx, neu_json_get_nodes_resp_node_t *req);
-static int add_group(context_t *                             ctx,
-                     neu_json_get_driver_group_resp_group_t *data);
-static int add_tag(context_t *ctx, neu_json_add_tags_req_t *data);
-static int add_subscription(context_t *ctx, neu_json_subscribe_req_t *data);
-static int add_setting(context_t *ctx, neu_json_node_setting_req_t *data);
+static int del_node(void *ctx, neu_resp_node_info_t *info);
+static int add_node(void *ctx, neu_json_get_nodes_resp_node_t *req);
+static int add_group(void *ctx, neu_json_get_driver_group_resp_group_t *data);
+static int add_tag(void *ctx, neu_json_add_tags_req_t *data);
+static int add_subscription(void *ctx, neu_json_subscribe_req_t *data);
+static int add_setting(void *ctx, neu_json_node_setting_req_t *data);
 
 static inline bool is_static_node(const char *name, const char *plugin)
 {
@@ -136,7 +108,7 @@ static context_t *context_new(nng_aio *aio, context_type_e t)
     ctx->type  = t;
     ctx->state = STATE_START;
 
-    if (PUT_GLOBAL != ctx->type && !(ctx->json = neu_json_encode_new())) {
+    if (!(ctx->json = neu_json_encode_new())) {
         free(ctx);
         return NULL;
     }
@@ -150,45 +122,27 @@ static void context_free(context_t *ctx)
         return;
     }
 
-    if (GET_GLOBAL == ctx->type) {
-        neu_json_encode_free(ctx->json);
-        if (ctx->apps) {
-            utarray_free(ctx->apps);
-        }
-        if (ctx->drivers) {
-            utarray_free(ctx->drivers);
-        }
-        if (ctx->groups) {
-            utarray_free(ctx->groups);
-        }
-    } else if (PUT_GLOBAL == ctx->type) {
-        if (ctx->nodes) {
-            utarray_free(ctx->nodes);
-        }
-        neu_json_decode_global_config_req_free(ctx->req);
-    } else {
-        neu_json_encode_free(ctx->json);
-        if (ctx->drivers) {
-            utarray_free(ctx->drivers);
-        }
-        if (ctx->groups) {
-            utarray_free(ctx->groups);
-        }
-        free(ctx->names);
-        neu_strset_free(&ctx->filter);
-        for (int i = 0; i < ctx->jdrivers.n_driver; ++i) {
-            neu_json_driver_t *driver = &ctx->jdrivers.drivers[i];
-            free(driver->node.setting);
-            for (int j = 0; j < driver->gtags.len; ++j) {
-                for (int k = 0; k < driver->gtags.gtags[j].n_tag; k++) {
-                    neu_json_decode_tag_fini(&(driver->gtags.gtags[j].tags[k]));
-                }
-                free(driver->gtags.gtags[j].tags);
+    neu_json_encode_free(ctx->json);
+    if (ctx->drivers) {
+        utarray_free(ctx->drivers);
+    }
+    if (ctx->groups) {
+        utarray_free(ctx->groups);
+    }
+    free(ctx->names);
+    neu_strset_free(&ctx->filter);
+    for (int i = 0; i < ctx->jdrivers.n_driver; ++i) {
+        neu_json_driver_t *driver = &ctx->jdrivers.drivers[i];
+        free(driver->node.setting);
+        for (int j = 0; j < driver->gtags.len; ++j) {
+            for (int k = 0; k < driver->gtags.gtags[j].n_tag; k++) {
+                neu_json_decode_tag_fini(&(driver->gtags.gtags[j].tags[k]));
             }
-            free(driver->gtags.gtags);
+            free(driver->gtags.gtags[j].tags);
         }
-        free(ctx->jdrivers.drivers);
+        free(driver->gtags.gtags);
     }
+    free(ctx->jdrivers.drivers);
 
     nng_aio_set_input(ctx->aio, 3, NULL);
     free(ctx);
@@ -203,296 +157,6 @@ static void context_free(context_t *ctx)
         }                                          \
     }
 
-static void get_global_context_next(context_t *ctx, neu_reqresp_type_e type,
-                                    void *data)
-{
-    char *result = NULL;
-
-    switch (ctx->state) {
-    case STATE_START:
-        NEXT(ctx, get_nodes, NEU_NA_TYPE_APP);
-        ctx->state = STATE_GET_APP;
-        break;
-    case STATE_GET_APP:
-        NEXT(ctx, get_nodes_resp, data);
-        NEXT(ctx, get_nodes, NEU_NA_TYPE_DRIVER);
-        ctx->state = STATE_GET_DRIVER;
-        break;
-    case STATE_GET_DRIVER:
-        NEXT(ctx, get_nodes_resp, data);
-        NEXT(ctx, get_groups, 0);
-        ctx->state = STATE_GET_GROUP;
-        break;
-    case STATE_GET_GROUP:
-        NEXT(ctx, get_groups_resp, data);
-        ctx->iter  = NULL;
-        ctx->state = STATE_GET_TAG;
-        // fall through
-    case STATE_GET_TAG:
-        if (NULL == ctx->iter) {
-            // generate empty array on fall through
-            NEXT(ctx, get_tags_resp, NULL);
-        } else if (NEU_RESP_ERROR != type) {
-            NEXT(ctx, get_tags_resp, data);
-        }
-        // ignore error response message, keep going
-        ctx->iter = utarray_next(ctx->groups, ctx->iter);
-        if (ctx->iter) {
-            NEXT(ctx, get_tags, ctx->iter);
-            break;
-        }
-        ctx->state = STATE_GET_SUBSCRIPTION;
-        // fall through
-    case STATE_GET_SUBSCRIPTION:
-        // generate empty array on fall through
-        NEXT(ctx, get_subscriptions_resp, ctx->iter ? data : NULL);
-        ctx->iter = utarray_next(ctx->apps, ctx->iter);
-        if (ctx->iter) {
-            NEXT(ctx, get_subscriptions, ctx->iter);
-            break;
-        }
-        ctx->state = STATE_GET_APP_SETTING;
-        // fall through
-    case STATE_GET_APP_SETTING:
-        if (NULL == ctx->iter) {
-            // generate empty array on fall through
-            NEXT(ctx, get_setting_resp, NULL);
-        } else if (NEU_RESP_ERROR != type) {
-            NEXT(ctx, get_setting_resp, data);
-        }
-        // ignore error response message, keep going
-        ctx->iter = utarray_next(ctx->apps, ctx->iter);
-        if (ctx->iter) {
-            NEXT(ctx, get_setting, ctx->iter);
-            break;
-        }
-        ctx->state = STATE_GET_DRIVER_SETTING;
-        // fall through
-    case STATE_GET_DRIVER_SETTING:
-        if (NULL == ctx->iter) {
-            // generate empty array on fall through
-            NEXT(ctx, get_setting_resp, NULL);
-        } else if (NEU_RESP_ERROR != type) {
-            NEXT(ctx, get_setting_resp, data);
-        }
-        ctx->iter = utarray_next(ctx->drivers, ctx->iter);
-        if (ctx->iter) {
-            NEXT(ctx, get_setting, ctx->iter);
-            break;
-        }
-        ctx->state = STATE_END;
-        break;
-    default:
-        ctx->error = NEU_ERR_EINTERNAL;
-        ctx->state = STATE_END;
-        break;
-    }
-
-    if (STATE_END == ctx->state) {
-        if (ctx->error) {
-            NEU_JSON_RESPONSE_ERROR(ctx->error, {
-                neu_http_response(ctx->aio, ctx->error, result_error);
-            });
-        } else {
-            neu_json_encode(ctx->json, &result);
-            neu_http_ok(ctx->aio, result);
-            free(result);
-        }
-        context_free(ctx);
-    }
-}
-
-static void put_global_context_next(context_t *ctx, neu_reqresp_type_e type,
-                                    void *data)
-{
-    (void) type;
-
-    switch (ctx->state) {
-    case STATE_START:
-        NEXT(ctx, get_nodes, NEU_NA_TYPE_APP);
-        ctx->state = STATE_GET_APP;
-        break;
-
-    case STATE_GET_APP:
-    case STATE_GET_DRIVER:
-        ctx->nodes = ((neu_resp_get_node_t *) data)->nodes;
-        ctx->idx   = 0;
-        ctx->state =
-            STATE_GET_APP == ctx->state ? STATE_DEL_APP : STATE_DEL_DRIVER;
-        // fall through
-
-    case STATE_DEL_APP:
-    case STATE_DEL_DRIVER: {
-        neu_resp_error_t *    err  = data;
-        neu_resp_node_info_t *info = NULL;
-
-        if (ctx->idx > 0 && 0 != err->error) {
-            // received error response
-            ctx->error = err->error;
-            ctx->state = STATE_END;
-            break;
-        }
-
-        // skip static nodes
-        for (; ctx->idx < utarray_len(ctx->nodes); ++ctx->idx, info = NULL) {
-            info = utarray_eltptr(ctx->nodes, ctx->idx);
-            if (!is_static_node(info->node, info->plugin)) {
-                break;
-            }
-        }
-
-        if (info) {
-            NEXT(ctx, del_node, info);
-            ++ctx->idx;
-            break;
-        }
-
-        utarray_free(ctx->nodes);
-        ctx->nodes = NULL;
-
-        if (STATE_DEL_APP == ctx->state) {
-            NEXT(ctx, get_nodes, NEU_NA_TYPE_DRIVER);
-            ctx->state = STATE_GET_DRIVER;
-            break;
-        }
-
-        ctx->idx   = 0;
-        ctx->state = STATE_ADD_NODE;
-    }
-        // fall through
-
-    case STATE_ADD_NODE: {
-        neu_resp_error_t *         err   = data;
-        neu_json_get_nodes_resp_t *nodes = ctx->req->nodes;
-
-        if (ctx->idx > 0 && 0 != err->error) {
-            // received error response
-            ctx->error = err->error;
-            ctx->state = STATE_END;
-            break;
-        }
-
-        // skip static nodes
-        for (; ctx->idx < (size_t) nodes->n_node; ++ctx->idx) {
-            if (!is_static_node(nodes->nodes[ctx->idx].name,
-                                nodes->nodes[ctx->idx].plugin)) {
-                break;
-            }
-        }
-
-        if (ctx->idx < (size_t) nodes->n_node) {
-            NEXT(ctx, add_node, &nodes->nodes[ctx->idx]);
-            ++ctx->idx;
-            break;
-        }
-
-        ctx->idx   = 0;
-        ctx->state = STATE_ADD_GROUP;
-    }
-        // fall through
-
-    case STATE_ADD_GROUP: {
-        neu_resp_error_t *                err    = data;
-        neu_json_get_driver_group_resp_t *groups = ctx->req->groups;
-
-        if (ctx->idx > 0 && 0 != err->error) {
-            // received error response
-            ctx->error = err->error;
-            ctx->state = STATE_END;
-            break;
-        }
-
-        if (ctx->idx < (size_t) groups->n_group) {
-            NEXT(ctx, add_group, &groups->groups[ctx->idx]);
-            ++ctx->idx;
-            break;
-        }
-
-        ctx->idx   = 0;
-        ctx->state = STATE_ADD_TAG;
-    }
-        // fall through
-
-    case STATE_ADD_TAG: {
-        neu_resp_add_tag_t *               resp = data;
-        neu_json_global_config_req_tags_t *tags = ctx->req->tags;
-
-        if (ctx->idx > 0 && 0 != resp->error) {
-            // received error response
-            ctx->error = resp->error;
-            ctx->state = STATE_END;
-            break;
-        }
-
-        if (ctx->idx < (size_t) tags->n_tag) {
-            NEXT(ctx, add_tag, &tags->tags[ctx->idx]);
-            ++ctx->idx;
-            break;
-        }
-
-        ctx->idx   = 0;
-        ctx->state = STATE_ADD_SUBSCRIPTION;
-    }
-        // fall through
-
-    case STATE_ADD_SUBSCRIPTION: {
-        neu_resp_error_t *                          err = data;
-        neu_json_global_config_req_subscriptions_t *subs =
-            ctx->req->subscriptions;
-
-        if (ctx->idx > 0 && 0 != err->error) {
-            // received error response
-            ctx->error = err->error;
-            ctx->state = STATE_END;
-            break;
-        }
-
-        if (ctx->idx < (size_t) subs->n_subscription) {
-            NEXT(ctx, add_subscription, &subs->subscriptions[ctx->idx]);
-            ++ctx->idx;
-            break;
-        }
-
-        ctx->idx   = 0;
-        ctx->state = STATE_ADD_SETTING;
-    }
-        // fall through
-
-    case STATE_ADD_SETTING: {
-        neu_resp_error_t *                     err      = data;
-        neu_json_global_config_req_settings_t *settings = ctx->req->settings;
-
-        if (ctx->idx > 0 && 0 != err->error) {
-            // received error response
-            ctx->error = err->error;
-            ctx->state = STATE_END;
-            break;
-        }
-
-        if (ctx->idx < (size_t) settings->n_setting) {
-            NEXT(ctx, add_setting, &settings->settings[ctx->idx]);
-            ++ctx->idx;
-            break;
-        }
-
-        ctx->state = STATE_END;
-        break;
-    }
-
-    default:
-        ctx->error = NEU_ERR_EINTERNAL;
-        ctx->state = STATE_END;
-        break;
-    }
-
-    if (STATE_END == ctx->state) {
-        NEU_JSON_RESPONSE_ERROR(ctx->error, {
-            neu_http_response(ctx->aio, ctx->error, result_error);
-        });
-        context_free(ctx);
-    }
-}
-
 static void get_drivers_context_next(context_t *ctx, neu_reqresp_type_e type,
                                      void *data)
 {
@@ -562,13 +226,7 @@ static void get_drivers_context_next(context_t *ctx, neu_reqresp_type_e type,
 
 static void context_next(context_t *ctx, neu_reqresp_type_e type, void *data)
 {
-    if (GET_GLOBAL == ctx->type) {
-        get_global_context_next(ctx, type, data);
-    } else if (PUT_GLOBAL == ctx->type) {
-        put_global_context_next(ctx, type, data);
-    } else {
-        get_drivers_context_next(ctx, type, data);
-    }
+    get_drivers_context_next(ctx, type, data);
 }
 
 static int get_nodes(context_t *ctx, neu_node_type_e type)
@@ -591,42 +249,6 @@ static int get_nodes(context_t *ctx, neu_node_type_e type)
     return 0;
 }
 
-static int get_nodes_resp(context_t *ctx, neu_resp_get_node_t *nodes)
-{
-    int                       rv        = 0;
-    neu_json_get_nodes_resp_t nodes_res = { 0 };
-
-    nodes_res.n_node = utarray_len(nodes->nodes);
-    nodes_res.nodes =
-        calloc(nodes_res.n_node, sizeof(neu_json_get_nodes_resp_node_t));
-    if (NULL == nodes_res.nodes) {
-        rv = NEU_ERR_EINTERNAL;
-        goto end;
-    }
-
-    utarray_foreach(nodes->nodes, neu_resp_node_info_t *, info)
-    {
-        int index = utarray_eltidx(nodes->nodes, info);
-
-        nodes_res.nodes[index].name   = info->node;
-        nodes_res.nodes[index].plugin = info->plugin;
-    }
-
-    if (0 != neu_json_encode_get_nodes_resp(ctx->json, &nodes_res)) {
-        rv = NEU_ERR_EINTERNAL;
-    }
-
-end:
-    if (STATE_GET_APP == ctx->state) {
-        ctx->apps = nodes->nodes;
-    } else {
-        ctx->drivers = nodes->nodes;
-    }
-
-    free(nodes_res.nodes);
-    return rv;
-}
-
 static int get_drivers_resp(context_t *ctx, neu_resp_get_node_t *resp)
 {
     int                     rv      = 0;
@@ -682,38 +304,6 @@ static int get_groups(context_t *ctx, int unused)
     return 0;
 }
 
-static int get_groups_resp(context_t *ctx, neu_resp_get_driver_group_t *groups)
-{
-    int                              rv          = 0;
-    neu_json_get_driver_group_resp_t gconfig_res = { 0 };
-
-    gconfig_res.n_group = utarray_len(groups->groups);
-    gconfig_res.groups  = calloc(gconfig_res.n_group,
-                                sizeof(neu_json_get_driver_group_resp_group_t));
-    if (NULL == gconfig_res.groups) {
-        rv = NEU_ERR_EINTERNAL;
-        goto end;
-    }
-
-    utarray_foreach(groups->groups, neu_resp_driver_group_info_t *, group)
-    {
-        int index = utarray_eltidx(groups->groups, group);
-        gconfig_res.groups[index].driver    = group->driver;
-        gconfig_res.groups[index].group     = group->group;
-        gconfig_res.groups[index].interval  = group->interval;
-        gconfig_res.groups[index].tag_count = group->tag_count;
-    }
-
-    if (0 != neu_json_encode_get_driver_group_resp(ctx->json, &gconfig_res)) {
-        rv = NEU_ERR_EINTERNAL;
-    }
-
-end:
-    free(gconfig_res.groups);
-    ctx->groups = groups->groups;
-    return rv;
-}
-
 static int get_driver_groups_resp(context_t *                  ctx,
                                   neu_resp_get_driver_group_t *resp)
 {
@@ -780,83 +370,6 @@ static int get_tags(context_t *ctx, neu_resp_driver_group_info_t *info)
     return rv;
 }
 
-static int get_tags_resp(context_t *ctx, neu_resp_get_tag_t *tags)
-{
-    int                      rv       = 0;
-    neu_json_get_tags_resp_t tags_res = { 0 };
-    json_t *                 tag_obj  = NULL;
-    void *                   tag_arr  = NULL;
-
-    // allocate `tags` array if none
-    if (NULL == (tag_arr = json_object_get(ctx->json, "tags")) &&
-        (NULL == (tag_arr = json_array()) ||
-         // tag array ownership moved
-         0 != json_object_set_new(ctx->json, "tags", tag_arr))) {
-        rv = NEU_ERR_EINTERNAL;
-        goto end;
-    }
-
-    if (NULL == tags || 0 == utarray_len(tags->tags)) {
-        // empty tags array, all done
-        goto end;
-    }
-
-    tags_res.n_tag = utarray_len(tags->tags);
-    tags_res.tags  = calloc(tags_res.n_tag, sizeof(neu_json_tag_t));
-    if (NULL == tags_res.tags) {
-        rv = NEU_ERR_EINTERNAL;
-        goto end;
-    }
-
-    utarray_foreach(tags->tags, neu_datatag_t *, tag)
-    {
-        int index = utarray_eltidx(tags->tags, tag);
-
-        tags_res.tags[index].name        = tag->name;
-        tags_res.tags[index].address     = tag->address;
-        tags_res.tags[index].description = tag->description;
-        tags_res.tags[index].type        = tag->type;
-        tags_res.tags[index].attribute   = tag->attribute;
-        tags_res.tags[index].precision   = tag->precision;
-        tags_res.tags[index].decimal     = tag->decimal;
-        if (neu_tag_attribute_test(tag, NEU_ATTRIBUTE_STATIC)) {
-            neu_tag_get_static_value_json(tag, &tags_res.tags[index].t,
-                                          &tags_res.tags[index].value);
-        } else {
-            tags_res.tags[index].t = NEU_JSON_UNDEFINE;
-        }
-    }
-
-    // accumulate tag object in `tags` array
-    if (NULL == (tag_obj = json_object()) ||
-        // tag object ownership moved
-        0 != json_array_append_new(tag_arr, tag_obj)) {
-        rv = NEU_ERR_EINTERNAL;
-        goto end;
-    }
-
-    // encode `tags` data
-    if (0 != neu_json_encode_get_tags_resp(tag_obj, &tags_res)) {
-        rv = NEU_ERR_EINTERNAL;
-        goto end;
-    }
-
-    neu_resp_driver_group_info_t *info = ctx->iter;
-    // encode `driver` and `group`
-    if (0 !=
-            json_object_set_new(tag_obj, "driver", json_string(info->driver)) ||
-        0 != json_object_set_new(tag_obj, "group", json_string(info->group))) {
-        rv = NEU_ERR_EINTERNAL;
-    }
-
-end:
-    free(tags_res.tags);
-    if (tags && tags->tags) {
-        utarray_free(tags->tags);
-    }
-    return rv;
-}
-
 static int get_driver_tags_resp(context_t *ctx, neu_resp_get_tag_t *tags)
 {
     int rv = 0;
@@ -896,13 +409,15 @@ static int get_driver_tags_resp(context_t *ctx, neu_resp_get_tag_t *tags)
     {
         int index = utarray_eltidx(tags->tags, tag);
 
-        gtag->tags[index].name        = tag->name;
-        gtag->tags[index].address     = tag->address;
-        gtag->tags[index].description = tag->description;
-        gtag->tags[index].type        = tag->type;
-        gtag->tags[index].attribute   = tag->attribute;
-        gtag->tags[index].precision   = tag->precision;
-        gtag->tags[index].decimal     = tag->decimal;
+        gtag->tags[index].name         = tag->name;
+        gtag->tags[index].address      = tag->address;
+        gtag->tags[index].description  = tag->description;
+        gtag->tags[index].type         = tag->type;
+        gtag->tags[index].attribute    = tag->attribute;
+        gtag->tags[index].precision    = tag->precision;
+        gtag->tags[index].decimal      = tag->decimal;
+        gtag->tags[index].deadband     = tag->deadband;
+        gtag->tags[index].poll_divisor = tag->poll_divisor;
         if (neu_tag_attribute_test(tag, NEU_ATTRIBUTE_STATIC)) {
             neu_tag_get_static_value_json(tag, &gtag->tags[index].t,
                                           &gtag->tags[index].value);
@@ -921,96 +436,13 @@ end:
     return rv;
 }
 
-static int get_subscriptions(context_t *ctx, neu_resp_node_info_t *info)
+static int get_setting(context_t *ctx, neu_resp_node_info_t *info)
 {
     neu_plugin_t *plugin = neu_rest_get_plugin();
 
     neu_reqresp_head_t header = {
         .ctx  = ctx->aio,
-        .type = NEU_REQ_GET_SUBSCRIBE_GROUP,
-    };
-
-    neu_req_get_subscribe_group_t cmd = { 0 };
-    strcpy(cmd.app, info->node);
-
-    if (0 != neu_plugin_op(plugin, header, &cmd)) {
-        return NEU_ERR_IS_BUSY;
-    }
-
-    return 0;
-}
-
-static int get_subscriptions_resp(context_t *                     ctx,
-                                  neu_resp_get_subscribe_group_t *groups)
-{
-    int                           rv              = 0;
-    neu_json_get_subscribe_resp_t sub_grp_configs = { 0 };
-    json_t *                      sub_obj         = NULL;
-    json_t *                      sub_arr         = NULL;
-
-    // allocate `subscriptions` array if none
-    if (NULL == (sub_arr = json_object_get(ctx->json, "subscriptions")) &&
-        (NULL == (sub_arr = json_array()) ||
-         // tag array ownership moved
-         0 != json_object_set_new(ctx->json, "subscriptions", sub_arr))) {
-        rv = NEU_ERR_EINTERNAL;
-        goto end;
-    }
-
-    if (NULL == groups || 0 == utarray_len(groups->groups)) {
-        // empty subscriptions array, all done
-        goto end;
-    }
-
-    sub_grp_configs.n_group = utarray_len(groups->groups);
-    sub_grp_configs.groups  = calloc(
-        sub_grp_configs.n_group, sizeof(neu_json_get_subscribe_resp_group_t));
-    if (NULL == sub_grp_configs.groups) {
-        rv = NEU_ERR_EINTERNAL;
-        goto end;
-    }
-
-    utarray_foreach(groups->groups, neu_resp_subscribe_info_t *, group)
-    {
-        int index = utarray_eltidx(groups->groups, group);
-        sub_grp_configs.groups[index].driver = group->driver;
-        sub_grp_configs.groups[index].group  = group->group;
-        sub_grp_configs.groups[index].params = group->params;
-    }
-
-    // accumulate subscription object in `subscriptions` array
-    if (NULL == (sub_obj = json_object()) ||
-        // subscription object ownership moved
-        0 != json_array_append_new(sub_arr, sub_obj)) {
-        rv = NEU_ERR_EINTERNAL;
-        goto end;
-    }
-
-    if (0 != neu_json_encode_get_subscribe_resp(sub_obj, &sub_grp_configs)) {
-        rv = NEU_ERR_EINTERNAL;
-        goto end;
-    }
-
-    neu_resp_node_info_t *info = ctx->iter;
-    if (0 != json_object_set_new(sub_obj, "app", json_string(info->node))) {
-        rv = NEU_ERR_EINTERNAL;
-    }
-
-end:
-    free(sub_grp_configs.groups);
-    if (groups && groups->groups) {
-        utarray_free(groups->groups);
-    }
-    return rv;
-}
-
-static int get_setting(context_t *ctx, neu_resp_node_info_t *info)
-{
-    neu_plugin_t *plugin = neu_rest_get_plugin();
-
-    neu_reqresp_head_t header = {
-        .ctx  = ctx->aio,
-        .type = NEU_REQ_GET_NODE_SETTING,
+        .type = NEU_REQ_GET_NODE_SETTING,
     };
 
     neu_req_get_node_setting_t cmd = { 0 };
@@ -1023,51 +455,6 @@ static int get_setting(context_t *ctx, neu_resp_node_info_t *info)
     return 0;
 }
 
-static int get_setting_resp(context_t *                  ctx,
-                            neu_resp_get_node_setting_t *setting)
-{
-    int     rv          = 0;
-    json_t *setting_obj = NULL;
-    json_t *setting_arr = NULL;
-
-    // allocate `settings` array if none
-    if (NULL == (setting_arr = json_object_get(ctx->json, "settings")) &&
-        (NULL == (setting_arr = json_array()) ||
-         // tag array ownership moved
-         0 != json_object_set_new(ctx->json, "settings", setting_arr))) {
-        rv = NEU_ERR_EINTERNAL;
-        goto end;
-    }
-
-    if (NULL == setting) {
-        // empty subscriptions array, all done
-        goto end;
-    }
-
-    // accumulate setting object in `settings` array
-    if (NULL == (setting_obj = json_object()) ||
-        // setting object ownership moved
-        0 != json_array_append_new(setting_arr, setting_obj)) {
-        rv = NEU_ERR_EINTERNAL;
-        goto end;
-    }
-
-    neu_json_get_node_setting_resp_t resp = {
-        .node    = setting->node,
-        .setting = setting->setting,
-    };
-
-    if (0 != neu_json_encode_get_node_setting_resp(setting_obj, &resp)) {
-        rv = NEU_ERR_EINTERNAL;
-    }
-
-end:
-    if (setting) {
-        free(setting->setting);
-    }
-    return rv;
-}
-
 static int get_driver_setting_resp(context_t *                  ctx,
                                    neu_resp_get_node_setting_t *setting)
 {
@@ -1084,11 +471,11 @@ static int get_driver_setting_resp(context_t *                  ctx,
     return 0;
 }
 
-static int del_node(context_t *ctx, neu_resp_node_info_t *info)
+static int del_node(void *ctx, neu_resp_node_info_t *info)
 {
     neu_plugin_t *     plugin = neu_rest_get_plugin();
     neu_reqresp_head_t header = {
-        .ctx  = ctx->aio,
+        .ctx  = ctx,
         .type = NEU_REQ_DEL_NODE,
     };
 
@@ -1102,13 +489,13 @@ static int del_node(context_t *ctx, neu_resp_node_info_t *info)
     return 0;
 }
 
-static int add_node(context_t *ctx, neu_json_get_nodes_resp_node_t *req)
+static int add_node(void *ctx, neu_json_get_nodes_resp_node_t *req)
 {
     neu_plugin_t *plugin = neu_rest_get_plugin();
 
     neu_reqresp_head_t header = {
         .type = NEU_REQ_ADD_NODE,
-        .ctx  = ctx->aio,
+        .ctx  = ctx,
     };
 
     neu_req_add_node_t cmd = { 0 };
@@ -1122,14 +509,13 @@ static int add_node(context_t *ctx, neu_json_get_nodes_resp_node_t *req)
     return 0;
 }
 
-static int add_group(context_t *                             ctx,
-                     neu_json_get_driver_group_resp_group_t *data)
+static int add_group(void *ctx, neu_json_get_driver_group_resp_group_t *data)
 {
     neu_plugin_t *plugin = neu_rest_get_plugin();
 
     neu_reqresp_head_t header = {
         .type = NEU_REQ_ADD_GROUP,
-        .ctx  = ctx->aio,
+        .ctx  = ctx,
     };
 
     neu_req_add_group_t cmd = { 0 };
@@ -1144,14 +530,14 @@ static int add_group(context_t *                             ctx,
     return 0;
 }
 
-static int add_tag(context_t *ctx, neu_json_add_tags_req_t *data)
+static int add_tag(void *ctx, neu_json_add_tags_req_t *data)
 {
     int           ret    = 0;
     neu_plugin_t *plugin = neu_rest_get_plugin();
 
     neu_reqresp_head_t header = {
         .type = NEU_REQ_ADD_TAG,
-        .ctx  = ctx->aio,
+        .ctx  = ctx,
     };
 
     neu_req_add_tag_t cmd = { 0 };
@@ -1165,12 +551,14 @@ static int add_tag(context_t *ctx, neu_json_add_tags_req_t *data)
 
     int i = 0;
     for (; i < data->n_tag; i++) {
-        cmd.tags[i].attribute = data->tags[i].attribute;
-        cmd.tags[i].type      = data->tags[i].type;
-        cmd.tags[i].precision = data->tags[i].precision;
-        cmd.tags[i].decimal   = data->tags[i].decimal;
-        cmd.tags[i].address   = strdup(data->tags[i].address);
-        cmd.tags[i].name      = strdup(data->tags[i].name);
+        cmd.tags[i].attribute    = data->tags[i].attribute;
+        cmd.tags[i].type         = data->tags[i].type;
+        cmd.tags[i].precision    = data->tags[i].precision;
+        cmd.tags[i].decimal      = data->tags[i].decimal;
+        cmd.tags[i].deadband     = data->tags[i].deadband;
+        cmd.tags[i].poll_divisor = data->tags[i].poll_divisor;
+        cmd.tags[i].address      = strdup(data->tags[i].address);
+        cmd.tags[i].name         = strdup(data->tags[i].name);
         cmd.tags[i].description =
             strdup(data->tags[i].description ? data->tags[i].description : "");
 
@@ -1201,12 +589,12 @@ error:
     return ret;
 }
 
-static int add_subscription(context_t *ctx, neu_json_subscribe_req_t *data)
+static int add_subscription(void *ctx, neu_json_subscribe_req_t *data)
 {
     neu_plugin_t *plugin = neu_rest_get_plugin();
 
     neu_reqresp_head_t header = {
-        .ctx  = ctx->aio,
+        .ctx  = ctx,
         .type = NEU_REQ_SUBSCRIBE_GROUP,
     };
 
@@ -1224,12 +612,12 @@ static int add_subscription(context_t *ctx, neu_json_subscribe_req_t *data)
     return 0;
 }
 
-static int add_setting(context_t *ctx, neu_json_node_setting_req_t *data)
+static int add_setting(void *ctx, neu_json_node_setting_req_t *data)
 {
     neu_plugin_t *plugin = neu_rest_get_plugin();
 
     neu_reqresp_head_t header = {
-        .ctx  = ctx->aio,
+        .ctx  = ctx,
         .type = NEU_REQ_NODE_SETTING,
     };
 
@@ -1245,37 +633,879 @@ static int add_setting(context_t *ctx, neu_json_node_setting_req_t *data)
     return 0;
 }
 
+#define GLOBAL_CONFIG_HTTP_HEAD                                     \
+    "HTTP/1.1 200 OK\r\n"                                           \
+    "Content-Type: application/json\r\n"                            \
+    "Transfer-Encoding: chunked\r\n"                                \
+    "Access-Control-Allow-Origin: *\r\n"                            \
+    "Access-Control-Allow-Methods: POST,GET,PUT,DELETE,OPTIONS\r\n" \
+    "Access-Control-Allow-Headers: *\r\n"                           \
+    "Connection: close\r\n\r\n"
+
+typedef struct {
+    neu_persist_node_info_t *info;
+    char *                   setting;
+    UT_array *               groups; // neu_persist_group_tags_t, drivers only
+    UT_array *               subs;   // neu_persist_subscription_info_t, apps
+} config_node_t;
+
+// The global config as persisted, apps first and drivers after.
+typedef struct {
+    UT_array *     infos; // neu_persist_node_info_t
+    int            n_node;
+    config_node_t *nodes;
+} config_snapshot_t;
+
+static void config_snapshot_free(config_snapshot_t *snap)
+{
+    for (int i = 0; i < snap->n_node; ++i) {
+        free(snap->nodes[i].setting);
+        if (snap->nodes[i].groups) {
+            utarray_free(snap->nodes[i].groups);
+        }
+        if (snap->nodes[i].subs) {
+            utarray_free(snap->nodes[i].subs);
+        }
+    }
+    free(snap->nodes);
+    if (snap->infos) {
+        utarray_free(snap->infos);
+    }
+}
+
+// Read the whole config from the persister in one pass instead of asking the
+// manager and every driver in turn, the persister flushes queued writes
+// before it loads.
+static int config_snapshot_load(config_snapshot_t *snap)
+{
+    static const int types[] = { NEU_NA_TYPE_APP, NEU_NA_TYPE_DRIVER };
+
+    if (0 != neu_persister_load_nodes(&snap->infos)) {
+        snap->infos = NULL;
+        return NEU_ERR_EINTERNAL;
+    }
+
+    snap->nodes = calloc(utarray_len(snap->infos) + 1, sizeof(config_node_t));
+    if (NULL == snap->nodes) {
+        return NEU_ERR_EINTERNAL;
+    }
+
+    for (size_t i = 0; i < sizeof(types) / sizeof(types[0]); ++i) {
+        utarray_foreach(snap->infos, neu_persist_node_info_t *, info)
+        {
+            if (types[i] != info->type) {
+                continue;
+            }
+
+            config_node_t *node = &snap->nodes[snap->n_node++];
+            int            rv   = 0;
+
+            node->info = info;
+            if (0 !=
+                neu_persister_load_node_setting(
+                    info->name, (const char **) &node->setting)) {
+                node->setting = NULL; // a node without setting
+            }
+
+            if (NEU_NA_TYPE_DRIVER == info->type) {
+                rv = neu_persister_load_group_tags(info->name, &node->groups);
+            } else {
+                rv = neu_persister_load_subscriptions(info->name, &node->subs);
+            }
+            if (0 != rv) {
+                nlog_error("load config of node `%s` fail", info->name);
+                return NEU_ERR_EINTERNAL;
+            }
+        }
+    }
+
+    return 0;
+}
+
+// `{"nodes":[...],"groups":[...]}`
+static char *config_nodes_encode(config_snapshot_t *snap)
+{
+    neu_json_get_nodes_resp_t        nodes  = { 0 };
+    neu_json_get_driver_group_resp_t groups = { 0 };
+    void *                           json   = NULL;
+    char *                           result = NULL;
+
+    for (int i = 0; i < snap->n_node; ++i) {
+        if (snap->nodes[i].groups) {
+            groups.n_group += utarray_len(snap->nodes[i].groups);
+        }
+    }
+
+    json          = neu_json_encode_new();
+    nodes.nodes   = calloc(snap->n_node + 1, sizeof(*nodes.nodes));
+    groups.groups = calloc(groups.n_group + 1, sizeof(*groups.groups));
+    if (NULL == json || NULL == nodes.nodes || NULL == groups.groups) {
+        goto end;
+    }
+
+    for (int i = 0, j = 0; i < snap->n_node; ++i) {
+        config_node_t *node = &snap->nodes[i];
+
+        nodes.nodes[i].name   = node->info->name;
+        nodes.nodes[i].plugin = node->info->plugin_name;
+        if (NULL == node->groups) {
+            continue;
+        }
+        utarray_foreach(node->groups, neu_persist_group_tags_t *, group)
+        {
+            groups.groups[j].driver    = node->info->name;
+            groups.groups[j].group     = group->name;
+            groups.groups[j].interval  = group->interval;
+            groups.groups[j].tag_count = utarray_len(group->tags);
+            ++j;
+        }
+    }
+    nodes.n_node = snap->n_node;
+
+    if (0 == neu_json_encode_get_nodes_resp(json, &nodes) &&
+        0 == neu_json_encode_get_driver_group_resp(json, &groups)) {
+        neu_json_encode(json, &result);
+    }
+
+end:
+    if (json) {
+        neu_json_encode_free(json);
+    }
+    free(nodes.nodes);
+    free(groups.groups);
+    return result;
+}
+
+// `{"tags":[...],"driver":...,"group":...}`
+static char *config_tags_encode(const char *              driver,
+                                neu_persist_group_tags_t *group)
+{
+    neu_json_get_tags_resp_t tags   = { 0 };
+    void *                   json   = NULL;
+    char *                   result = NULL;
+
+    json      = neu_json_encode_new();
+    tags.tags = calloc(utarray_len(group->tags), sizeof(neu_json_tag_t));
+    if (NULL == json || NULL == tags.tags) {
+        goto end;
+    }
+
+    utarray_foreach(group->tags, neu_datatag_t *, tag)
+    {
+        neu_json_tag_t *t = &tags.tags[tags.n_tag++];
+
+        t->name         = tag->name;
+        t->address      = tag->address;
+        t->description  = tag->description;
+        t->type         = tag->type;
+        t->attribute    = tag->attribute;
+        t->precision    = tag->precision;
+        t->decimal      = tag->decimal;
+        t->deadband     = tag->deadband;
+        t->poll_divisor = tag->poll_divisor;
+        if (neu_tag_attribute_test(tag, NEU_ATTRIBUTE_STATIC)) {
+            neu_tag_get_static_value_json(tag, &t->t, &t->value);
+        } else {
+            t->t = NEU_JSON_UNDEFINE;
+        }
+    }
+
+    if (0 == neu_json_encode_get_tags_resp(json, &tags) &&
+        0 == json_object_set_new(json, "driver", json_string(driver)) &&
+        0 == json_object_set_new(json, "group", json_string(group->name))) {
+        neu_json_encode(json, &result);
+    }
+
+end:
+    if (json) {
+        neu_json_encode_free(json);
+    }
+    free(tags.tags);
+    return result;
+}
+
+static int config_subscriptions_encode(json_t *sub_arr, config_node_t *node)
+{
+    neu_json_get_subscribe_resp_t subs    = { 0 };
+    json_t *                      sub_obj = NULL;
+    int                           rv      = 0;
+
+    if (0 == utarray_len(node->subs)) {
+        return 0;
+    }
+
+    subs.groups = calloc(utarray_len(node->subs), sizeof(*subs.groups));
+    if (NULL == subs.groups) {
+        return NEU_ERR_EINTERNAL;
+    }
+
+    utarray_foreach(node->subs, neu_persist_subscription_info_t *, sub)
+    {
+        subs.groups[subs.n_group].driver = sub->driver_name;
+        subs.groups[subs.n_group].group  = sub->group_name;
+        subs.groups[subs.n_group].params = sub->params;
+        ++subs.n_group;
+    }
+
+    if (NULL == (sub_obj = json_object()) ||
+        // subscription object ownership moved
+        0 != json_array_append_new(sub_arr, sub_obj) ||
+        0 != neu_json_encode_get_subscribe_resp(sub_obj, &subs) ||
+        0 != json_object_set_new(sub_obj, "app",
+                                 json_string(node->info->name))) {
+        rv = NEU_ERR_EINTERNAL;
+    }
+
+    free(subs.groups);
+    return rv;
+}
+
+// `{"subscriptions":[...],"settings":[...]}`
+static char *config_settings_encode(config_snapshot_t *snap)
+{
+    json_t *json        = json_object();
+    json_t *sub_arr     = json_array();
+    json_t *setting_arr = json_array();
+    char *  result      = NULL;
+    int     rv          = 0;
+
+    if (NULL == json || NULL == sub_arr || NULL == setting_arr) {
+        json_decref(sub_arr);
+        json_decref(setting_arr);
+        goto end;
+    }
+
+    // arrays ownership moved
+    json_object_set_new(json, "subscriptions", sub_arr);
+    json_object_set_new(json, "settings", setting_arr);
+
+    for (int i = 0; 0 == rv && i < snap->n_node; ++i) {
+        if (snap->nodes[i].subs) {
+            rv = config_subscriptions_encode(sub_arr, &snap->nodes[i]);
+        }
+    }
+
+    for (int i = 0; 0 == rv && i < snap->n_node; ++i) {
+        neu_json_get_node_setting_resp_t resp = {
+            .node    = snap->nodes[i].info->name,
+            .setting = snap->nodes[i].setting,
+        };
+        json_t *setting_obj = NULL;
+
+        if (NULL == resp.setting) {
+            continue;
+        }
+
+        if (NULL == (setting_obj = json_object()) ||
+            // setting object ownership moved
+            0 != json_array_append_new(setting_arr, setting_obj) ||
+            0 != neu_json_encode_get_node_setting_resp(setting_obj, &resp)) {
+            rv = NEU_ERR_EINTERNAL;
+        }
+    }
+
+    if (0 == rv) {
+        neu_json_encode(json, &result);
+    }
+
+end:
+    json_decref(json);
+    return result;
+}
+
+// Write `sep` and `len` bytes of `data` as one http chunk.
+static int config_chunk(neu_rest_stream_t *stream, const char *sep,
+                        const char *data, size_t len)
+{
+    char size[32] = { 0 };
+
+    snprintf(size, sizeof(size), "%zx\r\n", strlen(sep) + len);
+    if (neu_rest_stream_write(stream, size, strlen(size)) != 0 ||
+        neu_rest_stream_write(stream, sep, strlen(sep)) != 0 ||
+        neu_rest_stream_write(stream, data, len) != 0 ||
+        neu_rest_stream_write(stream, "\r\n", 2) != 0) {
+        return -1;
+    }
+
+    return 0;
+}
+
+// Stream the document as it is encoded, one chunk per group of tags, so the
+// tags of all drivers never become one json document in memory. The nodes
+// chunk leaves the document open and the settings chunk closes it.
+static void config_stream(neu_rest_stream_t *stream, config_snapshot_t *snap,
+                          char *head, char *tail)
+{
+    const char *sep = "";
+
+    neu_rest_stream_write(stream, GLOBAL_CONFIG_HTTP_HEAD,
+                          strlen(GLOBAL_CONFIG_HTTP_HEAD));
+
+    if (0 != config_chunk(stream, "", head, strlen(head) - 1) ||
+        0 != config_chunk(stream, ",\"tags\":[", "", 0)) {
+        goto end;
+    }
+
+    for (int i = 0; i < snap->n_node; ++i) {
+        if (NULL == snap->nodes[i].groups) {
+            continue;
+        }
+        utarray_foreach(snap->nodes[i].groups, neu_persist_group_tags_t *,
+                        group)
+        {
+            char *tags = NULL;
+            int   rv   = -1;
+
+            if (0 == utarray_len(group->tags)) {
+                continue;
+            }
+
+            tags = config_tags_encode(snap->nodes[i].info->name, group);
+            if (NULL != tags) {
+                rv = config_chunk(stream, sep, tags, strlen(tags));
+                free(tags);
+            }
+            if (0 != rv) {
+                nlog_warn("global config stream stop at %s:%s",
+                          snap->nodes[i].info->name, group->name);
+                goto end;
+            }
+            sep = ",";
+        }
+    }
+
+    config_chunk(stream, "],", tail + 1, strlen(tail + 1));
+
+end:
+    neu_rest_stream_write(stream, "0\r\n\r\n", 5);
+    neu_rest_stream_close(stream);
+}
+
 void handle_get_global_config(nng_aio *aio)
 {
+    config_snapshot_t  snap   = { 0 };
+    neu_rest_stream_t *stream = NULL;
+    char *             head   = NULL;
+    char *             tail   = NULL;
+    int                rv     = 0;
+
     NEU_VALIDATE_JWT(aio);
 
-    context_t *ctx = context_new(aio, GET_GLOBAL);
-    if (NULL == ctx) {
+    rv = config_snapshot_load(&snap);
+    if (0 == rv &&
+        (NULL == (head = config_nodes_encode(&snap)) ||
+         NULL == (tail = config_settings_encode(&snap)) ||
+         NULL == (stream = neu_rest_stream_new(aio)))) {
+        rv = NEU_ERR_EINTERNAL;
+    }
+
+    if (0 != rv) {
+        NEU_JSON_RESPONSE_ERROR(rv, {
+            neu_http_response(aio, rv, result_error);
+        });
+    } else {
+        config_stream(stream, &snap, head, tail);
+    }
+
+    free(head);
+    free(tail);
+    config_snapshot_free(&snap);
+}
+
+// An import checks the whole config before it touches the running one, then
+// replaces it in stages: drop the nodes, add the nodes, groups, tags,
+// subscriptions and settings. Every object of a stage is requested at once
+// and the next stage starts once all of them answered, a stage with failed
+// objects ends the import and each failure is reported.
+typedef enum {
+    IMPORT_CHECK,
+    IMPORT_GET_NODE,
+    IMPORT_DEL_NODE,
+    IMPORT_ADD_NODE,
+    IMPORT_ADD_GROUP,
+    IMPORT_ADD_TAG,
+    IMPORT_ADD_SUBSCRIPTION,
+    IMPORT_ADD_SETTING,
+    IMPORT_END,
+} import_stage_e;
+
+typedef struct {
+    const char *type; // of the object
+    const char *node;
+    const char *group;
+} import_item_t;
+
+typedef struct config_import {
+    pthread_mutex_t               mtx;
+    nng_aio *                     aio;
+    neu_json_global_config_req_t *req;
+    import_stage_e                stage;
+    UT_array *                    nodes; // running nodes
+    import_item_t *               items; // of the stage
+    size_t                        n_item;
+    size_t                        cap;
+    size_t                        n_pending;
+    json_t *                      failures;
+    int                           error; // of the first failure
+    struct config_import *        next;
+} config_import_t;
+
+static pthread_mutex_t  imports_mtx = PTHREAD_MUTEX_INITIALIZER;
+static config_import_t *imports     = NULL;
+
+static void import_free(config_import_t *imp)
+{
+    if (imp->nodes) {
+        utarray_free(imp->nodes);
+    }
+    json_decref(imp->failures);
+    neu_json_decode_global_config_req_free(imp->req);
+    pthread_mutex_destroy(&imp->mtx);
+    free(imp->items);
+    free(imp);
+}
+
+// requests of a stage carry one of its items as context
+static config_import_t *import_find(void *ctx)
+{
+    config_import_t *imp = NULL;
+    uintptr_t        p   = (uintptr_t) ctx;
+
+    pthread_mutex_lock(&imports_mtx);
+    for (imp = imports; imp != NULL; imp = imp->next) {
+        if (p >= (uintptr_t) imp->items &&
+            p < (uintptr_t)(imp->items + imp->n_item)) {
+            break;
+        }
+    }
+    pthread_mutex_unlock(&imports_mtx);
+
+    return imp;
+}
+
+static void import_remove(config_import_t *imp)
+{
+    pthread_mutex_lock(&imports_mtx);
+    for (config_import_t **pp = &imports; *pp != NULL; pp = &(*pp)->next) {
+        if (*pp == imp) {
+            *pp = imp->next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&imports_mtx);
+}
+
+static void import_fail(config_import_t *imp, const char *type,
+                        const char *node, const char *group, int error)
+{
+    json_t *failure = json_object();
+
+    if (0 == imp->error) {
+        imp->error = error;
+    }
+
+    if (NULL == failure) {
+        return;
+    }
+    json_object_set_new(failure, "type", json_string(type));
+    if (node) {
+        json_object_set_new(failure, "node", json_string(node));
+    }
+    if (group) {
+        json_object_set_new(failure, "group", json_string(group));
+    }
+    json_object_set_new(failure, "error", json_integer(error));
+    json_array_append_new(imp->failures, failure);
+}
+
+static bool import_has_node(neu_strset_t *nodes, const char *name)
+{
+    return NULL != name && neu_strset_test(nodes, name);
+}
+
+static bool import_has_group(neu_json_get_driver_group_resp_t *groups, int n,
+                             const char *driver, const char *group)
+{
+    for (int i = 0; i < n && driver && group; ++i) {
+        if (0 == strcmp(groups->groups[i].driver, driver) &&
+            0 == strcmp(groups->groups[i].group, group)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void import_check_tags(config_import_t *imp, neu_strset_t *nodes,
+                              neu_json_add_tags_req_t *tags)
+{
+    neu_json_get_driver_group_resp_t *groups = imp->req->groups;
+
+    if (!import_has_node(nodes, tags->node)) {
+        import_fail(imp, "tags", tags->node, tags->group,
+                    NEU_ERR_NODE_NOT_EXIST);
+        return;
+    }
+    if (!import_has_group(groups, groups->n_group, tags->node, tags->group)) {
+        import_fail(imp, "tags", tags->node, tags->group,
+                    NEU_ERR_GROUP_NOT_EXIST);
+        return;
+    }
+
+    for (int i = 0; i < tags->n_tag; ++i) {
+        neu_json_tag_t *tag   = &tags->tags[i];
+        int             error = 0;
+
+        if (NULL == tag->name || 0 == strlen(tag->name) ||
+            strlen(tag->name) >= NEU_TAG_NAME_LEN) {
+            error = NEU_ERR_TAG_NAME_TOO_LONG;
+        } else if (NULL == tag->address ||
+                   strlen(tag->address) >= NEU_TAG_ADDRESS_LEN) {
+            error = NEU_ERR_TAG_ADDRESS_TOO_LONG;
+        } else if (tag->description &&
+                   strlen(tag->description) >= NEU_TAG_DESCRIPTION_LEN) {
+            error = NEU_ERR_TAG_DESCRIPTION_TOO_LONG;
+        }
+
+        if (0 != error) {
+            import_fail(imp, "tag", tags->node, tag->name, error);
+        }
+    }
+}
+
+// Check the references and limits of every object, so a config that can not
+// be applied is refused before the running nodes are deleted.
+static void import_check(config_import_t *imp)
+{
+    neu_json_global_config_req_t *req   = imp->req;
+    neu_strset_t                  nodes = NULL;
+
+    for (int i = 0; i < req->nodes->n_node; ++i) {
+        neu_json_get_nodes_resp_node_t *node  = &req->nodes->nodes[i];
+        int                             error = 0;
+
+        if (NULL == node->name || 0 == strlen(node->name) ||
+            strlen(node->name) >= NEU_NODE_NAME_LEN) {
+            error = NEU_ERR_NODE_NAME_TOO_LONG;
+        } else if (NULL == node->plugin ||
+                   strlen(node->plugin) >= NEU_PLUGIN_NAME_LEN) {
+            error = NEU_ERR_PLUGIN_NAME_TOO_LONG;
+        } else if (1 != neu_strset_add(&nodes, node->name)) {
+            error = NEU_ERR_NODE_EXIST;
+        }
+
+        if (0 != error) {
+            import_fail(imp, "node", node->name, NULL, error);
+        }
+    }
+
+    for (int i = 0; i < req->groups->n_group; ++i) {
+        neu_json_get_driver_group_resp_group_t *group = &req->groups->groups[i];
+        int                                     error = 0;
+
+        if (!import_has_node(&nodes, group->driver)) {
+            error = NEU_ERR_NODE_NOT_EXIST;
+        } else if (NULL == group->group || 0 == strlen(group->group) ||
+                   strlen(group->group) >= NEU_GROUP_NAME_LEN) {
+            error = NEU_ERR_GROUP_NAME_TOO_LONG;
+        } else if (group->interval < NEU_GROUP_INTERVAL_LIMIT) {
+            error = NEU_ERR_GROUP_PARAMETER_INVALID;
+        } else if (import_has_group(req->groups, i, group->driver,
+                                    group->group)) {
+            error = NEU_ERR_GROUP_EXIST;
+        }
+
+        if (0 != error) {
+            import_fail(imp, "group", group->driver, group->group, error);
+        }
+    }
+
+    for (int i = 0; i < req->tags->n_tag; ++i) {
+        import_check_tags(imp, &nodes, &req->tags->tags[i]);
+    }
+
+    for (int i = 0; i < req->subscriptions->n_subscription; ++i) {
+        neu_json_subscribe_req_t *sub = &req->subscriptions->subscriptions[i];
+
+        if (!import_has_node(&nodes, sub->app)) {
+            import_fail(imp, "subscription", sub->app, sub->group,
+                        NEU_ERR_NODE_NOT_EXIST);
+        } else if (!import_has_group(req->groups, req->groups->n_group,
+                                     sub->driver, sub->group)) {
+            import_fail(imp, "subscription", sub->app, sub->group,
+                        NEU_ERR_GROUP_NOT_EXIST);
+        }
+    }
+
+    for (int i = 0; i < req->settings->n_setting; ++i) {
+        neu_json_node_setting_req_t *setting = &req->settings->settings[i];
+
+        if (!import_has_node(&nodes, setting->node)) {
+            import_fail(imp, "setting", setting->node, NULL,
+                        NEU_ERR_NODE_NOT_EXIST);
+        }
+    }
+
+    neu_strset_free(&nodes);
+}
+
+static size_t import_stage_size(config_import_t *imp)
+{
+    neu_json_global_config_req_t *req = imp->req;
+
+    switch (imp->stage) {
+    case IMPORT_GET_NODE:
+        return 1;
+    case IMPORT_DEL_NODE:
+        return utarray_len(imp->nodes);
+    case IMPORT_ADD_NODE:
+        return req->nodes->n_node;
+    case IMPORT_ADD_GROUP:
+        return req->groups->n_group;
+    case IMPORT_ADD_TAG:
+        return req->tags->n_tag;
+    case IMPORT_ADD_SUBSCRIPTION:
+        return req->subscriptions->n_subscription;
+    case IMPORT_ADD_SETTING:
+        return req->settings->n_setting;
+    default:
+        return 0;
+    }
+}
+
+static int import_get_nodes(void *ctx)
+{
+    neu_plugin_t *plugin = neu_rest_get_plugin();
+
+    neu_reqresp_head_t header = {
+        .ctx  = ctx,
+        .type = NEU_REQ_GET_NODE,
+    };
+
+    neu_req_get_node_t cmd = {
+        .type = NEU_NA_TYPE_APP | NEU_NA_TYPE_DRIVER,
+    };
+
+    if (0 != neu_plugin_op(plugin, header, &cmd)) {
+        return NEU_ERR_IS_BUSY;
+    }
+
+    return 0;
+}
+
+// Request every object of the stage, returns -1 if out of memory.
+static int import_issue(config_import_t *imp)
+{
+    neu_json_global_config_req_t *req  = imp->req;
+    size_t                        size = import_stage_size(imp);
+
+    if (size > imp->cap) {
+        import_item_t *items = realloc(imp->items, size * sizeof(*items));
+        if (NULL == items) {
+            return -1;
+        }
+        imp->items = items;
+        imp->cap   = size;
+    }
+
+    // items reference the request, which outlives the import
+    memset(imp->items, 0, size * sizeof(*imp->items));
+    imp->n_item = size;
+    for (size_t i = 0; i < size; ++i) {
+        import_item_t *item  = &imp->items[i];
+        int            error = 0;
+
+        switch (imp->stage) {
+        case IMPORT_GET_NODE:
+            item->type = "node";
+            error      = import_get_nodes(item);
+            break;
+        case IMPORT_DEL_NODE: {
+            neu_resp_node_info_t *info = utarray_eltptr(imp->nodes, i);
+
+            item->type = "node";
+            item->node = info->node;
+            if (is_static_node(info->node, info->plugin)) {
+                continue;
+            }
+            error = del_node(item, info);
+            break;
+        }
+        case IMPORT_ADD_NODE: {
+            neu_json_get_nodes_resp_node_t *node = &req->nodes->nodes[i];
+
+            item->type = "node";
+            item->node = node->name;
+            if (is_static_node(node->name, node->plugin)) {
+                continue;
+            }
+            error = add_node(item, node);
+            break;
+        }
+        case IMPORT_ADD_GROUP:
+            item->type  = "group";
+            item->node  = req->groups->groups[i].driver;
+            item->group = req->groups->groups[i].group;
+            error       = add_group(item, &req->groups->groups[i]);
+            break;
+        case IMPORT_ADD_TAG:
+            item->type  = "tags";
+            item->node  = req->tags->tags[i].node;
+            item->group = req->tags->tags[i].group;
+            error       = add_tag(item, &req->tags->tags[i]);
+            break;
+        case IMPORT_ADD_SUBSCRIPTION: {
+            neu_json_subscribe_req_t *sub =
+                &req->subscriptions->subscriptions[i];
+
+            item->type  = "subscription";
+            item->node  = sub->app;
+            item->group = sub->group;
+            error       = add_subscription(item, sub);
+            break;
+        }
+        case IMPORT_ADD_SETTING:
+            item->type = "setting";
+            item->node = req->settings->settings[i].node;
+            error      = add_setting(item, &req->settings->settings[i]);
+            break;
+        default:
+            break;
+        }
+
+        if (0 != error) {
+            import_fail(imp, item->type, item->node, item->group, error);
+        } else {
+            imp->n_pending += 1;
+        }
+    }
+
+    return 0;
+}
+
+static void import_respond(config_import_t *imp)
+{
+    json_t *result = json_object();
+    char *  body   = NULL;
+
+    if (NULL != result) {
+        json_object_set_new(result, "error", json_integer(imp->error));
+        if (0 != imp->error) {
+            json_object_set(result, "failures", imp->failures);
+        }
+        body = json_dumps(result, 0);
+        json_decref(result);
+    }
+
+    if (NULL != body) {
+        neu_http_response(imp->aio, imp->error, body);
+        free(body);
+    } else {
+        NEU_JSON_RESPONSE_ERROR(NEU_ERR_EINTERNAL, {
+            neu_http_response(imp->aio, NEU_ERR_EINTERNAL, result_error);
+        });
+    }
+}
+
+// Move on to the next stage with objects to request once the current one is
+// answered, returns true once the import is done, it is then the caller's to
+// free.
+static bool import_next(config_import_t *imp)
+{
+    while (0 == imp->n_pending) {
+        if (0 != imp->error || IMPORT_END == ++imp->stage) {
+            nlog_notice("global config import end at stage %d, error %d",
+                        imp->stage, imp->error);
+            import_respond(imp);
+            return true;
+        }
+        if (0 != import_issue(imp)) {
+            import_fail(imp, "config", NULL, NULL, NEU_ERR_EINTERNAL);
+        }
+    }
+
+    return false;
+}
+
+bool handle_global_config_import_resp(neu_reqresp_head_t *header, void *data)
+{
+    config_import_t *imp      = import_find(header->ctx);
+    import_item_t *  item     = header->ctx;
+    bool             complete = false;
+    int              error    = NEU_ERR_SUCCESS;
+
+    if (NULL == imp) {
+        return false;
+    }
+
+    pthread_mutex_lock(&imp->mtx);
+    if (NEU_RESP_GET_NODE == header->type) {
+        imp->nodes = ((neu_resp_get_node_t *) data)->nodes;
+    } else if (NEU_RESP_ADD_TAG == header->type) {
+        error = ((neu_resp_add_tag_t *) data)->error;
+    } else if (NEU_RESP_ERROR == header->type) {
+        error = ((neu_resp_error_t *) data)->error;
+    } else {
+        error = NEU_ERR_EINTERNAL;
+    }
+
+    if (NEU_ERR_SUCCESS != error) {
+        import_fail(imp, item->type, item->node, item->group, error);
+    }
+
+    imp->n_pending -= 1;
+    complete = import_next(imp);
+    pthread_mutex_unlock(&imp->mtx);
+
+    if (complete) {
+        import_remove(imp);
+        import_free(imp);
+    }
+
+    return true;
+}
+
+static void import_start(nng_aio *aio, neu_json_global_config_req_t *req)
+{
+    config_import_t *imp      = calloc(1, sizeof(config_import_t));
+    bool             complete = false;
+
+    if (NULL == imp || NULL == (imp->failures = json_array())) {
+        free(imp);
+        neu_json_decode_global_config_req_free(req);
         NEU_JSON_RESPONSE_ERROR(NEU_ERR_EINTERNAL, {
             neu_http_response(aio, NEU_ERR_EINTERNAL, result_error);
         });
         return;
     }
 
-    nng_aio_set_input(aio, 3, ctx);
-    context_next(ctx, NEU_REQ_GET_NODE, NULL);
+    pthread_mutex_init(&imp->mtx, NULL);
+    imp->aio   = aio;
+    imp->req   = req;
+    imp->stage = IMPORT_CHECK;
+
+    pthread_mutex_lock(&imp->mtx);
+
+    pthread_mutex_lock(&imports_mtx);
+    imp->next = imports;
+    imports   = imp;
+    pthread_mutex_unlock(&imports_mtx);
+
+    import_check(imp);
+    complete = import_next(imp);
+    pthread_mutex_unlock(&imp->mtx);
+
+    if (complete) {
+        import_remove(imp);
+        import_free(imp);
+    }
 }
 
 void handle_put_global_config(nng_aio *aio)
 {
-    NEU_PROCESS_HTTP_REQUEST_VALIDATE_JWT(
+    NEU_PROCESS_HTTP_REQUEST_JSON_VALIDATE_JWT(
         aio, neu_json_global_config_req_t, neu_json_decode_global_config_req, {
-            context_t *ctx = context_new(aio, PUT_GLOBAL);
-            if (NULL == ctx) {
-                NEU_JSON_RESPONSE_ERROR(NEU_ERR_EINTERNAL, {
-                    neu_http_response(aio, NEU_ERR_EINTERNAL, result_error);
-                });
-            } else {
-                nng_aio_set_input(aio, 3, ctx);
-                context_next(ctx, NEU_REQ_GET_NODE, NULL);
-                ctx->req = req;
-                req      = NULL;
-            }
+            import_start(aio, req);
+            req = NULL; // ownership moved
         });
 }
 
@@ -31,4 +31,7 @@ void handle_get_drivers(nng_aio *aio);
 void handle_global_config_resp(nng_aio *aio, neu_reqresp_type_e type,
                                void *data);
 
+// returns true if the response belongs to a config import and was consumed
+bool handle_global_config_import_resp(neu_reqresp_head_t *header, void *data);
+
 #endif
@@ -20,7 +20,9 @@
 #include <stdlib.h>
 
 #include "parser/neu_json_group_config.h"
+#include "persist/persist.h"
 #include "plugin.h"
+#include "utils/tuning.h"
 #include "json/neu_json_error.h"
 #include "json/neu_json_fn.h"
 
@@ -182,6 +184,223 @@ void handle_get_group_config(nng_aio *aio)
     }
 }
 
+static int tag_profile_cmp(const void *a, const void *b)
+{
+    return strcmp(((const neu_persist_tag_profile_t *) a)->name,
+                  ((const neu_persist_tag_profile_t *) b)->name);
+}
+
+static neu_persist_group_profile_t *find_group_profile(UT_array *  profiles,
+                                                       const char *group)
+{
+    utarray_foreach(profiles, neu_persist_group_profile_t *, profile)
+    {
+        if (0 == strcmp(profile->group_name, group)) {
+            return profile;
+        }
+    }
+    return NULL;
+}
+
+// the tags of the config of a group read from the device, the others never
+// change by a read
+static bool tag_profiled(const neu_datatag_t *tag)
+{
+    return !neu_tag_attribute_test(tag, NEU_ATTRIBUTE_STATIC) &&
+        !neu_tag_is_computed(tag) &&
+        (neu_tag_attribute_test(tag, NEU_ATTRIBUTE_READ) ||
+         neu_tag_attribute_test(tag, NEU_ATTRIBUTE_SUBSCRIBE));
+}
+
+static void group_profile_free(neu_json_group_profile_t *json)
+{
+    for (int i = 0; i < json->n_advice; i++) {
+        free(json->advices[i].tags);
+    }
+    free(json->advices);
+}
+
+// the statistics and advices of the persisted profile of a group, the names in
+// json point into config
+static int group_profile_fill(const neu_persist_group_tags_t *config,
+                              neu_persist_group_profile_t *   profile,
+                              neu_json_group_profile_t *      json)
+{
+    neu_tuning_advice_t advices[NEU_TUNING_ADVICES_MAX] = { 0 };
+
+    neu_tuning_group_t tuning   = { .interval = config->interval };
+    uint32_t           n_tag    = utarray_len(config->tags);
+    const char **      names    = calloc(n_tag + 1, sizeof(char *));
+    uint64_t *         changes  = calloc(n_tag + 1, sizeof(uint64_t));
+    uint16_t *         divisors = calloc(n_tag + 1, sizeof(uint16_t));
+    int                n        = 0;
+    int                ret      = -1;
+
+    json->group    = config->name;
+    json->interval = config->interval;
+    if (NULL == names || NULL == changes || NULL == divisors) {
+        goto end;
+    }
+    if (NULL == profile) {
+        ret = 0;
+        goto end;
+    }
+
+    utarray_sort(profile->tags, tag_profile_cmp);
+    utarray_foreach(config->tags, neu_datatag_t *, tag)
+    {
+        neu_persist_tag_profile_t  key   = { .name = tag->name };
+        neu_persist_tag_profile_t *found = NULL;
+
+        if (!tag_profiled(tag)) {
+            continue;
+        }
+        found = utarray_find(profile->tags, &key, tag_profile_cmp);
+        names[tuning.n_tag]    = tag->name;
+        changes[tuning.n_tag]  = NULL != found ? found->changes : 0;
+        divisors[tuning.n_tag] = tag->poll_divisor;
+        tuning.n_tag += 1;
+    }
+
+    tuning.reads         = profile->reads;
+    tuning.read_ms       = profile->read_ms;
+    tuning.overruns      = profile->overruns;
+    tuning.blocks        = profile->blocks;
+    tuning.changes       = changes;
+    tuning.poll_divisors = divisors;
+    memcpy(tuning.latency, profile->latency, sizeof(tuning.latency));
+
+    json->reads  = profile->reads;
+    json->p50_ms = neu_tuning_latency_ms(&tuning, 50);
+    json->p90_ms = neu_tuning_latency_ms(&tuning, 90);
+    if (profile->reads > 0) {
+        json->read_ms  = (double) profile->read_ms / profile->reads;
+        json->overruns = (double) profile->overruns / profile->reads;
+        json->blocks   = (double) profile->blocks / profile->reads;
+    }
+    if (profile->blocks > 0) {
+        json->block_ms = (double) profile->read_ms / profile->blocks;
+    }
+
+    n             = neu_tuning_recommend(&tuning, advices);
+    json->advices = calloc(n + 1, sizeof(neu_json_group_profile_advice_t));
+    if (NULL == json->advices) {
+        goto advices_end;
+    }
+    for (int i = 0; i < n; i++) {
+        neu_json_group_profile_advice_t *advice = &json->advices[i];
+
+        advice->kind  = neu_tuning_kind_str(advices[i].kind);
+        advice->value = advices[i].value;
+        advice->tags  = calloc(advices[i].n_tag + 1, sizeof(char *));
+        json->n_advice += 1;
+        if (NULL == advice->tags) {
+            goto advices_end;
+        }
+        for (uint32_t k = 0; k < advices[i].n_tag; k++) {
+            advice->tags[advice->n_tag++] = names[advices[i].tags[k]];
+        }
+    }
+    ret = 0;
+
+advices_end:
+    for (int i = 0; i < n; i++) {
+        neu_tuning_advice_fini(&advices[i]);
+    }
+end:
+    free(names);
+    free(changes);
+    free(divisors);
+    return ret;
+}
+
+// Recommendations come from the read statistics the drivers persist, see
+// --profile_interval, so they survive restarts and need no running node.
+void handle_get_group_profile(nng_aio *aio)
+{
+    char                              node[NEU_NODE_NAME_LEN]   = { 0 };
+    char                              group[NEU_GROUP_NAME_LEN] = { 0 };
+    UT_array *                        configs                   = NULL;
+    UT_array *                        profiles                  = NULL;
+    neu_json_get_group_profile_resp_t resp                      = { 0 };
+    char *                            result                    = NULL;
+    int                               error                     = 0;
+    ssize_t                           ret                       = 0;
+
+    NEU_VALIDATE_JWT(aio);
+
+    ret = neu_http_get_param_str(aio, "node", node, sizeof(node));
+    if (ret <= 0 || (size_t) ret == sizeof(node)) {
+        NEU_JSON_RESPONSE_ERROR(NEU_ERR_PARAM_IS_WRONG, {
+            neu_http_response(aio, error_code.error, result_error);
+        })
+        return;
+    }
+
+    // optional parameter
+    ret = neu_http_get_param_str(aio, "group", group, sizeof(group));
+    if (-1 == ret || (size_t) ret == sizeof(group)) {
+        NEU_JSON_RESPONSE_ERROR(NEU_ERR_PARAM_IS_WRONG, {
+            neu_http_response(aio, error_code.error, result_error);
+        })
+        return;
+    }
+
+    if (0 != neu_persister_load_group_tags(node, &configs) ||
+        0 != neu_persister_load_group_profiles(node, &profiles)) {
+        error = NEU_ERR_EINTERNAL;
+        goto end;
+    }
+
+    resp.groups = calloc(utarray_len(configs) + 1, sizeof(*resp.groups));
+    if (NULL == resp.groups) {
+        error = NEU_ERR_EINTERNAL;
+        goto end;
+    }
+
+    utarray_foreach(configs, neu_persist_group_tags_t *, config)
+    {
+        neu_persist_group_profile_t *profile = NULL;
+
+        if ('\0' != group[0] && 0 != strcmp(group, config->name)) {
+            continue;
+        }
+        profile = find_group_profile(profiles, config->name);
+        if (0 !=
+            group_profile_fill(config, profile,
+                               &resp.groups[resp.n_group++])) {
+            error = NEU_ERR_EINTERNAL;
+            goto end;
+        }
+    }
+    if ('\0' != group[0] && 0 == resp.n_group) {
+        error = NEU_ERR_GROUP_NOT_EXIST;
+        goto end;
+    }
+
+    neu_json_encode_by_fn(&resp, neu_json_encode_get_group_profile_resp,
+                          &result);
+    neu_http_ok(aio, result);
+    free(result);
+
+end:
+    if (0 != error) {
+        NEU_JSON_RESPONSE_ERROR(error, {
+            neu_http_response(aio, error_code.error, result_error);
+        })
+    }
+    for (int i = 0; i < resp.n_group; i++) {
+        group_profile_free(&resp.groups[i]);
+    }
+    free(resp.groups);
+    if (NULL != configs) {
+        utarray_free(configs);
+    }
+    if (NULL != profiles) {
+        utarray_free(profiles);
+    }
+}
+
 void handle_get_group_resp(nng_aio *aio, neu_resp_get_group_t *groups)
 {
     neu_json_get_group_config_resp_t gconfig_res = { 0 };
@@ -27,6 +27,7 @@ void handle_add_group_config(nng_aio *aio);
 void handle_update_group(nng_aio *aio);
 void handle_del_group_config(nng_aio *aio);
 void handle_get_group_config(nng_aio *aio);
+void handle_get_group_profile(nng_aio *aio);
 void handle_get_group_resp(nng_aio *aio, neu_resp_get_group_t *groups);
 void handle_get_driver_group_resp(nng_aio *                    aio,
                                   neu_resp_get_driver_group_t *groups);
@@ -30,9 +30,11 @@
 #include "group_config_handle.h"
 #include "log_handle.h"
 #include "metric_handle.h"
+#include "profile_handle.h"
 #include "normal_handle.h"
 #include "plugin_handle.h"
 #include "rw_handle.h"
+#include "sse_handle.h"
 #include "utils/http.h"
 #include "version_handle.h"
 
@@ -54,12 +56,24 @@ static struct neu_http_handler cors_handler[] = {
     {
         .url = "/api/v2/tags",
     },
+    {
+        .url = "/api/v2/tags/history",
+    },
     {
         .url = "/api/v2/gtags",
     },
+    {
+        .url = "/api/v2/gtags/export",
+    },
+    {
+        .url = "/api/v2/gtags/import",
+    },
     {
         .url = "/api/v2/group",
     },
+    {
+        .url = "/api/v2/group/profile",
+    },
     {
         .url = "/api/v2/node",
     },
@@ -72,6 +86,12 @@ static struct neu_http_handler cors_handler[] = {
     {
         .url = "/api/v2/read",
     },
+    {
+        .url = "/api/v2/read/batch",
+    },
+    {
+        .url = "/api/v2/sse/subscribe",
+    },
     {
         .url = "/api/v2/write",
     },
@@ -81,6 +101,9 @@ static struct neu_http_handler cors_handler[] = {
     {
         .url = "/api/v2/write/gtags",
     },
+    {
+        .url = "/api/v2/write/batch",
+    },
     {
         .url = "/api/v2/subscribe",
     },
@@ -108,6 +131,12 @@ static struct neu_http_handler cors_handler[] = {
     {
         .url = "/api/v2/log/level",
     },
+    {
+        .url = "/api/v2/log/capture",
+    },
+    {
+        .url = "/api/v2/log/stream",
+    },
     {
         .url = "/api/v2/global/config",
     },
@@ -117,6 +146,12 @@ static struct neu_http_handler cors_handler[] = {
     {
         .url = "/api/v2/metrics",
     },
+    {
+        .url = "/api/v2/profile",
+    },
+    {
+        .url = "/api/v2/profile/threads",
+    },
 };
 
 static struct neu_http_handler rest_handlers[] = {
@@ -137,6 +172,7 @@ static struct neu_http_handler rest_handlers[] = {
         .type          = NEU_HTTP_HANDLER_FUNCTION,
         .url           = "/api/v2/ping",
         .value.handler = handle_ping,
+        .queue         = NEU_HTTP_QUEUE_LIGHT,
     },
     {
         .method        = NEU_HTTP_METHOD_POST,
@@ -163,6 +199,27 @@ static struct neu_http_handler rest_handlers[] = {
         .url           = "/api/v2/gtags",
         .value.handler = handle_add_gtags,
     },
+    {
+        .method        = NEU_HTTP_METHOD_PUT,
+        .type          = NEU_HTTP_HANDLER_FUNCTION,
+        .url           = "/api/v2/gtags",
+        .value.handler = handle_apply_gtags,
+    },
+    {
+        .method        = NEU_HTTP_METHOD_GET,
+        .type          = NEU_HTTP_HANDLER_FUNCTION,
+        .url           = "/api/v2/gtags/export",
+        .value.handler = handle_gtags_export,
+        .max_inflight  = 2,
+        .queue         = NEU_HTTP_QUEUE_HEAVY,
+    },
+    {
+        .method        = NEU_HTTP_METHOD_POST,
+        .type          = NEU_HTTP_HANDLER_FUNCTION,
+        .url           = "/api/v2/gtags/import",
+        .value.handler = handle_gtags_import,
+        .max_inflight  = 1,
+    },
     {
         .method        = NEU_HTTP_METHOD_PUT,
         .type          = NEU_HTTP_HANDLER_FUNCTION,
@@ -175,6 +232,12 @@ static struct neu_http_handler rest_handlers[] = {
         .url           = "/api/v2/tags",
         .value.handler = handle_get_tags,
     },
+    {
+        .method        = NEU_HTTP_METHOD_GET,
+        .type          = NEU_HTTP_HANDLER_FUNCTION,
+        .url           = "/api/v2/tags/history",
+        .value.handler = handle_get_tag_history,
+    },
     {
         .method        = NEU_HTTP_METHOD_DELETE,
         .type          = NEU_HTTP_HANDLER_FUNCTION,
@@ -205,6 +268,13 @@ static struct neu_http_handler rest_handlers[] = {
         .url           = "/api/v2/group",
         .value.handler = handle_get_group_config,
     },
+    {
+        .method        = NEU_HTTP_METHOD_GET,
+        .type          = NEU_HTTP_HANDLER_FUNCTION,
+        .url           = "/api/v2/group/profile",
+        .value.handler = handle_get_group_profile,
+        .queue         = NEU_HTTP_QUEUE_HEAVY,
+    },
     {
         .method        = NEU_HTTP_METHOD_POST,
         .type          = NEU_HTTP_HANDLER_FUNCTION,
@@ -258,12 +328,27 @@ static struct neu_http_handler rest_handlers[] = {
         .type          = NEU_HTTP_HANDLER_FUNCTION,
         .url           = "/api/v2/read",
         .value.handler = handle_read,
+        .queue         = NEU_HTTP_QUEUE_LIGHT,
+    },
+    {
+        .method        = NEU_HTTP_METHOD_POST,
+        .type          = NEU_HTTP_HANDLER_FUNCTION,
+        .url           = "/api/v2/read/batch",
+        .value.handler = handle_read_batch,
+        .max_inflight  = 8,
+    },
+    {
+        .method        = NEU_HTTP_METHOD_GET,
+        .type          = NEU_HTTP_HANDLER_FUNCTION,
+        .url           = "/api/v2/sse/subscribe",
+        .value.handler = handle_sse_subscribe,
     },
     {
         .method        = NEU_HTTP_METHOD_POST,
         .type          = NEU_HTTP_HANDLER_FUNCTION,
         .url           = "/api/v2/write",
         .value.handler = handle_write,
+        .queue         = NEU_HTTP_QUEUE_LIGHT,
     },
     {
         .method        = NEU_HTTP_METHOD_POST,
@@ -277,6 +362,13 @@ static struct neu_http_handler rest_handlers[] = {
         .url           = "/api/v2/write/gtags",
         .value.handler = handle_write_gtags,
     },
+    {
+        .method        = NEU_HTTP_METHOD_POST,
+        .type          = NEU_HTTP_HANDLER_FUNCTION,
+        .url           = "/api/v2/write/batch",
+        .value.handler = handle_write_batch,
+        .max_inflight  = 8,
+    },
     {
         .method        = NEU_HTTP_METHOD_POST,
         .type          = NEU_HTTP_HANDLER_FUNCTION,
@@ -336,6 +428,7 @@ static struct neu_http_handler rest_handlers[] = {
         .type          = NEU_HTTP_HANDLER_FUNCTION,
         .url           = "/api/v2/node/state",
         .value.handler = handle_get_node_state,
+        .queue         = NEU_HTTP_QUEUE_LIGHT,
     },
     {
         .method        = NEU_HTTP_METHOD_PUT,
@@ -343,41 +436,80 @@ static struct neu_http_handler rest_handlers[] = {
         .url           = "/api/v2/log/level",
         .value.handler = handle_log_level,
     },
+    {
+        .method        = NEU_HTTP_METHOD_PUT,
+        .type          = NEU_HTTP_HANDLER_FUNCTION,
+        .url           = "/api/v2/log/capture",
+        .value.handler = handle_log_capture,
+    },
+    {
+        .method        = NEU_HTTP_METHOD_GET,
+        .type          = NEU_HTTP_HANDLER_FUNCTION,
+        .url           = "/api/v2/log/capture",
+        .value.handler = handle_log_capture_dump,
+    },
+    {
+        .method        = NEU_HTTP_METHOD_GET,
+        .type          = NEU_HTTP_HANDLER_FUNCTION,
+        .url           = "/api/v2/log/stream",
+        .value.handler = handle_log_stream,
+    },
     {
         .method        = NEU_HTTP_METHOD_GET,
         .type          = NEU_HTTP_HANDLER_FUNCTION,
         .url           = "/api/v2/version",
         .value.handler = handle_get_version,
+        .queue         = NEU_HTTP_QUEUE_LIGHT,
     },
     {
         .method        = NEU_HTTP_METHOD_GET,
         .type          = NEU_HTTP_HANDLER_FUNCTION,
         .url           = "/api/v2/global/config",
         .value.handler = handle_get_global_config,
+        .max_inflight  = 2,
+        .queue         = NEU_HTTP_QUEUE_HEAVY,
     },
     {
         .method        = NEU_HTTP_METHOD_PUT,
         .type          = NEU_HTTP_HANDLER_FUNCTION,
         .url           = "/api/v2/global/config",
         .value.handler = handle_put_global_config,
+        .max_inflight  = 1,
     },
     {
         .method        = NEU_HTTP_METHOD_PUT,
         .type          = NEU_HTTP_HANDLER_FUNCTION,
         .url           = "/api/v2/global/drivers",
         .value.handler = handle_put_drivers,
+        .max_inflight  = 1,
     },
     {
         .method        = NEU_HTTP_METHOD_GET,
         .type          = NEU_HTTP_HANDLER_FUNCTION,
         .url           = "/api/v2/global/drivers",
         .value.handler = handle_get_drivers,
+        .max_inflight  = 2,
     },
     {
         .method        = NEU_HTTP_METHOD_GET,
         .type          = NEU_HTTP_HANDLER_FUNCTION,
         .url           = "/api/v2/metrics",
         .value.handler = handle_get_metric,
+        .max_inflight  = 4,
+        .queue         = NEU_HTTP_QUEUE_HEAVY,
+    },
+    {
+        .method        = NEU_HTTP_METHOD_GET,
+        .type          = NEU_HTTP_HANDLER_FUNCTION,
+        .url           = "/api/v2/profile",
+        .value.handler = handle_get_profile,
+        .max_inflight  = 1,
+    },
+    {
+        .method        = NEU_HTTP_METHOD_GET,
+        .type          = NEU_HTTP_HANDLER_FUNCTION,
+        .url           = "/api/v2/profile/threads",
+        .value.handler = handle_get_profile_threads,
     },
 };
 
@@ -19,12 +19,16 @@
 
 #include <dirent.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <strings.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <time.h>
 #include <unistd.h>
 
 #include <nng/nng.h>
@@ -34,14 +38,36 @@
 #include "errcodes.h"
 #include "handle.h"
 #include "parser/neu_json_log.h"
+#include "utils/capture.h"
 #include "utils/http.h"
 #include "utils/log.h"
+#include "utils/log_filter.h"
 #include "utils/neu_jwt.h"
 #include "json/neu_json_fn.h"
 
 #include "log_handle.h"
+#include "stream.h"
 #include "utils/utarray.h"
 
+static int log_level_of(const char *name)
+{
+    if (0 == strcmp(name, NEU_LOG_LEVEL_DEBUG)) {
+        return ZLOG_LEVEL_DEBUG;
+    } else if (0 == strcmp(name, NEU_LOG_LEVEL_INFO)) {
+        return ZLOG_LEVEL_INFO;
+    } else if (0 == strcmp(name, NEU_LOG_LEVEL_NOTICE)) {
+        return ZLOG_LEVEL_NOTICE;
+    } else if (0 == strcmp(name, NEU_LOG_LEVEL_WARN)) {
+        return ZLOG_LEVEL_WARN;
+    } else if (0 == strcmp(name, NEU_LOG_LEVEL_ERROR)) {
+        return ZLOG_LEVEL_ERROR;
+    } else if (0 == strcmp(name, NEU_LOG_LEVEL_FATAL)) {
+        return ZLOG_LEVEL_FATAL;
+    }
+
+    return -1;
+}
+
 void handle_log_level(nng_aio *aio)
 {
     neu_plugin_t *plugin = neu_rest_get_plugin();
@@ -57,25 +83,11 @@ void handle_log_level(nng_aio *aio)
                 neu_req_update_log_level_t cmd       = { 0 };
                 int                        log_level = -1;
 
-                if (0 == strcmp(req->log_level, NEU_LOG_LEVEL_DEBUG)) {
-                    log_level = ZLOG_LEVEL_DEBUG;
-                } else if (0 == strcmp(req->log_level, NEU_LOG_LEVEL_INFO)) {
-                    log_level = ZLOG_LEVEL_INFO;
-                } else if (0 == strcmp(req->log_level, NEU_LOG_LEVEL_NOTICE)) {
-                    log_level = ZLOG_LEVEL_NOTICE;
-                } else if (0 == strcmp(req->log_level, NEU_LOG_LEVEL_WARN)) {
-                    log_level = ZLOG_LEVEL_WARN;
-                } else if (0 == strcmp(req->log_level, NEU_LOG_LEVEL_ERROR)) {
-                    log_level = ZLOG_LEVEL_ERROR;
-                } else if (0 == strcmp(req->log_level, NEU_LOG_LEVEL_FATAL)) {
-                    log_level = ZLOG_LEVEL_FATAL;
-                } else {
+                log_level = log_level_of(req->log_level);
+                if (log_level == -1) {
                     nlog_error("Failed to modify log_level of the node, "
                                "node_name:%s, log_level: %s",
                                req->node_name, req->log_level);
-                }
-
-                if (log_level == -1) {
                     NEU_JSON_RESPONSE_ERROR(NEU_ERR_PARAM_IS_WRONG, {
                         neu_http_response(aio, error_code.error, result_error);
                     });
@@ -98,4 +110,326 @@ void handle_log_level(nng_aio *aio)
                 }
             }
         })
-}
\ No newline at end of file
+}
+
+void handle_log_capture(nng_aio *aio)
+{
+    neu_plugin_t *plugin = neu_rest_get_plugin();
+
+    NEU_PROCESS_HTTP_REQUEST_VALIDATE_JWT(
+        aio, neu_json_update_log_capture_req_t,
+        neu_json_decode_update_log_capture_req, {
+            if (strlen(req->node_name) >= NEU_NODE_NAME_LEN) {
+                CHECK_NODE_NAME_LENGTH_ERR;
+            } else if (req->packets < 0 ||
+                       req->packets > NEU_CAPTURE_PACKETS_MAX) {
+                NEU_JSON_RESPONSE_ERROR(NEU_ERR_PARAM_IS_WRONG, {
+                    neu_http_response(aio, error_code.error, result_error);
+                });
+            } else {
+                neu_reqresp_head_t           header = { 0 };
+                neu_req_update_log_capture_t cmd    = { 0 };
+
+                header.ctx   = aio;
+                header.type  = NEU_REQ_UPDATE_LOG_CAPTURE;
+                cmd.enable   = req->enable;
+                cmd.n_packet = (uint32_t) req->packets;
+                strcpy(cmd.node, req->node_name);
+
+                int ret = neu_plugin_op(plugin, header, &cmd);
+                if (ret != 0) {
+                    NEU_JSON_RESPONSE_ERROR(NEU_ERR_IS_BUSY, {
+                        neu_http_response(aio, NEU_ERR_IS_BUSY, result_error);
+                    });
+                }
+            }
+        })
+}
+
+void handle_log_capture_dump(nng_aio *aio)
+{
+    char     node[NEU_NODE_NAME_LEN]             = { 0 };
+    char     disposition[NEU_NODE_NAME_LEN + 32] = { 0 };
+    uint8_t *data                                = NULL;
+    size_t   len                                 = 0;
+
+    NEU_VALIDATE_JWT(aio);
+
+    if (neu_http_get_param_str(aio, "node", node, sizeof(node)) <= 0) {
+        NEU_JSON_RESPONSE_ERROR(NEU_ERR_PARAM_IS_WRONG, {
+            neu_http_response(aio, NEU_ERR_PARAM_IS_WRONG, result_error);
+        })
+        return;
+    }
+
+    if (neu_capture_dump(node, &data, &len) != 0) {
+        NEU_JSON_RESPONSE_ERROR(NEU_ERR_EINTERNAL, {
+            neu_http_response(aio, NEU_ERR_EINTERNAL, result_error);
+        })
+        return;
+    }
+
+    snprintf(disposition, sizeof(disposition), "attachment; filename=%s.pcap",
+             node);
+    neu_http_response_file(aio, data, len, disposition);
+    free(data);
+}
+
+#define LOG_STREAM_HTTP_HEAD                                        \
+    "HTTP/1.1 200 OK\r\n"                                           \
+    "Content-Type: text/plain; charset=utf-8\r\n"                   \
+    "Transfer-Encoding: chunked\r\n"                                \
+    "Access-Control-Allow-Origin: *\r\n"                            \
+    "Access-Control-Allow-Methods: POST,GET,PUT,DELETE,OPTIONS\r\n" \
+    "Access-Control-Allow-Headers: *\r\n"                           \
+    "Connection: close\r\n\r\n"
+
+// every stream holds a thread reading the files
+#define LOG_STREAM_MAX 2
+// a slow peer makes the reader wait once this much is queued for it
+#define LOG_STREAM_WINDOW (256 * 1024)
+#define LOG_STREAM_CHUNK (64 * 1024)
+#define LOG_STREAM_FOLLOW_MAX 3600 // s
+#define LOG_STREAM_POLL 500        // ms between two looks at a followed file
+#define LOG_STREAM_STALL 30000      // ms a peer may take no data at all
+
+typedef struct {
+    neu_rest_stream_t *stream;
+    neu_log_filter_t   filter;
+    char               match[256];
+    UT_array *         files;
+    uint32_t           follow; // s
+} log_stream_t;
+
+static uint32_t log_streams = 0;
+
+static int log_stream_send(void *arg, const char *data, size_t len)
+{
+    log_stream_t *ls       = (log_stream_t *) arg;
+    char          size[32] = { 0 };
+
+    while (len > 0) {
+        size_t  n       = len < LOG_STREAM_CHUNK ? len : LOG_STREAM_CHUNK;
+        ssize_t pending = 0;
+        int     waited  = 0;
+
+        while ((pending = neu_rest_stream_pending(ls->stream)) >
+               LOG_STREAM_WINDOW) {
+            if (waited >= LOG_STREAM_STALL) {
+                nlog_warn("<%p> log stream stalled", (void *) ls);
+                return -1;
+            }
+            usleep(10 * 1000);
+            waited += 10;
+        }
+
+        snprintf(size, sizeof(size), "%zx\r\n", n);
+        if (pending < 0 ||
+            neu_rest_stream_write(ls->stream, size, strlen(size)) != 0 ||
+            neu_rest_stream_write(ls->stream, data, n) != 0 ||
+            neu_rest_stream_write(ls->stream, "\r\n", 2) != 0) {
+            return -1;
+        }
+
+        data += n;
+        len -= n;
+    }
+
+    return 0;
+}
+
+// filters the file from offset on, and returns where the next look starts or
+// -1 once the peer is gone
+static off_t log_stream_file(log_stream_t *ls, const char *path, off_t offset)
+{
+    struct stat st = { 0 };
+    int         fd = open(path, O_RDONLY);
+
+    if (fd < 0) {
+        return offset;
+    }
+
+    if (fstat(fd, &st) == 0) {
+        // the live file shrinks when it is rotated, the new one starts over
+        if (st.st_size < offset) {
+            offset = 0;
+        }
+
+        if (st.st_size > offset) {
+            char *data =
+                mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data != MAP_FAILED) {
+                madvise(data, st.st_size, MADV_SEQUENTIAL);
+                ssize_t n =
+                    neu_log_filter(&ls->filter, data + offset,
+                                   st.st_size - offset, log_stream_send, ls);
+                munmap(data, st.st_size);
+                offset = n < 0 ? -1 : offset + n;
+            }
+        }
+    }
+
+    close(fd);
+    return offset;
+}
+
+static int64_t log_stream_now()
+{
+    struct timespec ts = { 0 };
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void *log_stream_run(void *arg)
+{
+    log_stream_t *ls     = (log_stream_t *) arg;
+    off_t         offset = 0;
+    const char *  live   = NULL;
+
+    utarray_foreach(ls->files, char **, path)
+    {
+        live   = *path;
+        offset = log_stream_file(ls, live, 0);
+        if (offset < 0 || ls->filter.done) {
+            break;
+        }
+    }
+
+    // the live file is the last one, it is polled for lines appended to it
+    if (ls->follow > 0 && offset >= 0 && !ls->filter.done) {
+        int64_t deadline = log_stream_now() + (int64_t) ls->follow * 1000;
+
+        while (log_stream_now() < deadline && offset >= 0 &&
+               !ls->filter.done) {
+            usleep(LOG_STREAM_POLL * 1000);
+            if (neu_rest_stream_pending(ls->stream) < 0) {
+                break;
+            }
+            offset = log_stream_file(ls, live, offset);
+        }
+    }
+
+    neu_rest_stream_write(ls->stream, "0\r\n\r\n", 5);
+    neu_rest_stream_close(ls->stream);
+    utarray_free(ls->files);
+    free(ls);
+    __atomic_sub_fetch(&log_streams, 1, __ATOMIC_RELAXED);
+    return NULL;
+}
+
+static int log_stream_param(nng_aio *aio, const char *name, uintmax_t max,
+                            uintmax_t *value)
+{
+    size_t len = 0;
+
+    *value = 0;
+    if (neu_http_get_param(aio, name, &len) != NULL &&
+        neu_http_get_param_uintmax(aio, name, value) != 0) {
+        return -1;
+    }
+
+    return *value > max ? -1 : 0;
+}
+
+static int log_stream_parse(nng_aio *aio, log_stream_t *ls, char *node,
+                            size_t size)
+{
+    char      level[NEU_LOG_LEVEL_LEN] = { 0 };
+    int       log_level                = 0;
+    uintmax_t since = 0, until = 0, follow = 0;
+    ssize_t   n = 0;
+
+    n = neu_http_get_param_str(aio, "node", node, size);
+    if (n == -2) {
+        strcpy(node, "neuron");
+    } else if (n <= 0 || (size_t) n >= size) {
+        return -1;
+    }
+
+    n = neu_http_get_param_str(aio, "level", level, sizeof(level));
+    if (n >= (ssize_t) sizeof(level) || n == -1 ||
+        (n >= 0 && (log_level = log_level_of(level)) < 0)) {
+        return -1;
+    }
+
+    n = neu_http_get_param_str(aio, "match", ls->match, sizeof(ls->match));
+    if (n >= (ssize_t) sizeof(ls->match) || n == -1) {
+        return -1;
+    }
+
+    if (log_stream_param(aio, "since", INT64_MAX, &since) != 0 ||
+        log_stream_param(aio, "until", INT64_MAX, &until) != 0 ||
+        log_stream_param(aio, "follow", LOG_STREAM_FOLLOW_MAX, &follow) != 0) {
+        return -1;
+    }
+
+    neu_log_filter_init(&ls->filter, log_level, since, until, ls->match);
+    ls->follow = follow;
+    return 0;
+}
+
+void handle_log_stream(nng_aio *aio)
+{
+    char          node[NEU_NODE_NAME_LEN] = { 0 };
+    int           error                   = NEU_ERR_SUCCESS;
+    log_stream_t *ls                      = NULL;
+    pthread_t     tid;
+
+    NEU_VALIDATE_JWT(aio);
+
+    ls = calloc(1, sizeof(log_stream_t));
+    if (ls == NULL) {
+        error = NEU_ERR_EINTERNAL;
+        goto error;
+    }
+
+    if (log_stream_parse(aio, ls, node, sizeof(node)) != 0) {
+        error = NEU_ERR_PARAM_IS_WRONG;
+        goto error;
+    }
+
+    ls->files = neu_log_files("./logs", node);
+    if (utarray_len(ls->files) == 0) {
+        error = NEU_ERR_FILE_NOT_EXIST;
+        goto error;
+    }
+
+    if (__atomic_add_fetch(&log_streams, 1, __ATOMIC_RELAXED) >
+        LOG_STREAM_MAX) {
+        __atomic_sub_fetch(&log_streams, 1, __ATOMIC_RELAXED);
+        error = NEU_ERR_IS_BUSY;
+        goto error;
+    }
+
+    ls->stream = neu_rest_stream_new(aio);
+    if (ls->stream == NULL) {
+        __atomic_sub_fetch(&log_streams, 1, __ATOMIC_RELAXED);
+        error = NEU_ERR_EINTERNAL;
+        goto error;
+    }
+
+    nlog_notice("<%p> log stream of %s, follow %" PRIu32 "s", (void *) ls,
+                node, ls->follow);
+    neu_rest_stream_write(ls->stream, LOG_STREAM_HTTP_HEAD,
+                          strlen(LOG_STREAM_HTTP_HEAD));
+    if (pthread_create(&tid, NULL, log_stream_run, ls) != 0) {
+        neu_rest_stream_close(ls->stream);
+        utarray_free(ls->files);
+        free(ls);
+        __atomic_sub_fetch(&log_streams, 1, __ATOMIC_RELAXED);
+        return;
+    }
+    pthread_detach(tid);
+    return;
+
+error:
+    if (ls != NULL) {
+        if (ls->files != NULL) {
+            utarray_free(ls->files);
+        }
+        free(ls);
+    }
+    NEU_JSON_RESPONSE_ERROR(
+        error, { neu_http_response(aio, error, result_error); });
+}
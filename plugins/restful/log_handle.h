@@ -24,5 +24,8 @@
 
 // void handle_get_log(nng_aio *aio);
 void handle_log_level(nng_aio *aio);
+void handle_log_capture(nng_aio *aio);
+void handle_log_capture_dump(nng_aio *aio);
+void handle_log_stream(nng_aio *aio);
 
 #endif
@@ -19,8 +19,6 @@
 
 #include <stdio.h>
 
-#include <pthread.h>
-
 #include "define.h"
 #include "metrics.h"
 #include "plugin.h"
@@ -94,7 +92,19 @@
     "south_running_nodes_total %zu\n"                                            \
     "# HELP south_disconnected_nodes_total Number of south nodes disconnected\n" \
     "# TYPE south_disconnected_nodes_total gauge\n"                              \
-    "south_disconnected_nodes_total %zu\n"
+    "south_disconnected_nodes_total %zu\n"                                       \
+    "# HELP mem_budget_bytes Bytes all the nodes may account, 0 for no budget\n" \
+    "# TYPE mem_budget_bytes gauge\n"                                            \
+    "mem_budget_bytes %zu\n"                                                     \
+    "# HELP mem_accounted_bytes Bytes accounted by all the nodes\n"              \
+    "# TYPE mem_accounted_bytes gauge\n"                                         \
+    "mem_accounted_bytes %zu\n"                                                  \
+    "# HELP reconnects_deferred Driver connects over the reconnect rate\n"       \
+    "# TYPE reconnects_deferred counter\n"                                       \
+    "reconnects_deferred %" PRIu64 "\n"                                          \
+    "# HELP log_dropped_lines Log lines dropped while the disk fell behind\n"    \
+    "# TYPE log_dropped_lines counter\n"                                         \
+    "log_dropped_lines %" PRIu64 "\n"
 // clang-format on
 
 static int response(nng_aio *aio, char *content, enum nng_http_status status)
@@ -121,6 +131,7 @@ static int response(nng_aio *aio, char *content, enum nng_http_status status)
     nlog_info("%s %s [%d]", nng_http_req_get_method(nng_req),
               nng_http_req_get_uri(nng_req), status);
 
+    neu_http_handler_done(aio);
     nng_aio_set_output(aio, 0, res);
     nng_aio_finish(aio, 0);
 
@@ -164,7 +175,49 @@ static inline void gen_global_metrics(const neu_metrics_t *metrics,
             metrics->license_max_tags, metrics->license_used_tags,
             metrics->north_nodes, metrics->north_running_nodes,
             metrics->north_disconnected_nodes, metrics->south_nodes,
-            metrics->south_running_nodes, metrics->south_disconnected_nodes);
+            metrics->south_running_nodes, metrics->south_disconnected_nodes,
+            metrics->mem_budget_bytes, metrics->mem_accounted_bytes,
+            metrics->reconnects_deferred, metrics->log_dropped_lines);
+}
+
+#define LABELS_LEN (NEU_NODE_NAME_LEN + NEU_GROUP_NAME_LEN + 16)
+
+static inline void gen_labels(char *labels, const char *node,
+                              const char *group)
+{
+    if (NULL == group) {
+        snprintf(labels, LABELS_LEN, "node=\"%s\"", node);
+    } else {
+        snprintf(labels, LABELS_LEN, "node=\"%s\",group=\"%s\"", node,
+                 group);
+    }
+}
+
+// the samples of an entry, histograms have cumulative buckets, a sum and a
+// count
+static void gen_entry_samples(const neu_metric_entry_t *e, const char *node,
+                              const char *group, FILE *stream)
+{
+    char labels[LABELS_LEN] = { 0 };
+
+    gen_labels(labels, node, group);
+    if (NEU_METRIC_TYPE_HISTOGRAM != e->type || NULL == e->hist) {
+        fprintf(stream, "%s{%s} %" PRIu64 "\n", e->name, labels, e->value);
+        return;
+    }
+
+    uint64_t n = 0;
+    for (int i = 0; i < NEU_HISTOGRAM_BOUNDS; ++i) {
+        n += e->hist->buckets[i];
+        fprintf(stream, "%s_bucket{%s,le=\"%" PRIu64 "\"} %" PRIu64 "\n",
+                e->name, labels, neu_histogram_bound(i), n);
+    }
+    fprintf(stream, "%s_bucket{%s,le=\"+Inf\"} %" PRIu64 "\n", e->name,
+            labels, e->hist->count);
+    fprintf(stream, "%s_sum{%s} %" PRIu64 "\n", e->name, labels,
+            e->hist->sum);
+    fprintf(stream, "%s_count{%s} %" PRIu64 "\n", e->name, labels,
+            e->hist->count);
 }
 
 static inline void gen_single_node_metrics(neu_node_metrics_t *node_metrics,
@@ -178,17 +231,11 @@ static inline void gen_single_node_metrics(neu_node_metrics_t *node_metrics,
 
     neu_metric_entry_t *e = NULL;
 
-    pthread_mutex_lock(&node_metrics->lock);
     HASH_LOOP(hh, node_metrics->entries, e)
     {
-        if (NEU_METRIC_TYPE_ROLLING_COUNTER == e->type) {
-            // force clean stale value
-            e->value = neu_rolling_counter_inc(e->rcnt, global_timestamp, 0);
-        }
-        fprintf(stream,
-                "# HELP %s %s\n# TYPE %s %s\n%s{node=\"%s\"} %" PRIu64 "\n",
-                e->name, e->help, e->name, neu_metric_type_str(e->type),
-                e->name, node_metrics->name, e->value);
+        fprintf(stream, "# HELP %s %s\n# TYPE %s %s\n", e->name, e->help,
+                e->name, neu_metric_type_str(e->type));
+        gen_entry_samples(e, node_metrics->name, NULL, stream);
     }
 
     neu_group_metrics_t *g = NULL;
@@ -196,19 +243,11 @@ static inline void gen_single_node_metrics(neu_node_metrics_t *node_metrics,
     {
         HASH_LOOP(hh, g->entries, e)
         {
-            if (NEU_METRIC_TYPE_ROLLING_COUNTER == e->type) {
-                // force clean stale value
-                e->value =
-                    neu_rolling_counter_inc(e->rcnt, global_timestamp, 0);
-            }
-            fprintf(stream,
-                    "# HELP %s %s\n# TYPE %s %s\n%s{node=\"%s\",group=\"%s\"} "
-                    "%" PRIu64 "\n",
-                    e->name, e->help, e->name, neu_metric_type_str(e->type),
-                    e->name, node_metrics->name, g->name, e->value);
+            fprintf(stream, "# HELP %s %s\n# TYPE %s %s\n", e->name, e->help,
+                    e->name, neu_metric_type_str(e->type));
+            gen_entry_samples(e, node_metrics->name, g->name, stream);
         }
     }
-    pthread_mutex_unlock(&node_metrics->lock);
 }
 
 static inline bool has_entry(neu_node_metrics_t *node_metrics, const char *name)
@@ -275,18 +314,9 @@ static void gen_all_node_metrics(neu_metrics_t *metrics, int type_filter,
                         r->help, r->name, neu_metric_type_str(r->type));
             }
 
-            pthread_mutex_lock(&n->lock);
             HASH_FIND_STR(n->entries, r->name, e);
             if (e) {
-                if (NEU_METRIC_TYPE_ROLLING_COUNTER == e->type) {
-                    // force clean stale value
-                    e->value =
-                        neu_rolling_counter_inc(e->rcnt, global_timestamp, 0);
-                }
-                fprintf(stream, "%s{node=\"%s\"} %" PRIu64 "\n", e->name,
-                        n->name, e->value);
-
-                pthread_mutex_unlock(&n->lock);
+                gen_entry_samples(e, n->name, NULL, stream);
                 continue;
             }
 
@@ -294,17 +324,9 @@ static void gen_all_node_metrics(neu_metrics_t *metrics, int type_filter,
             {
                 HASH_FIND_STR(g->entries, r->name, e);
                 if (e) {
-                    if (NEU_METRIC_TYPE_ROLLING_COUNTER == e->type) {
-                        // force clean stale value
-                        e->value = neu_rolling_counter_inc(e->rcnt,
-                                                           global_timestamp, 0);
-                    }
-                    fprintf(stream,
-                            "%s{node=\"%s\",group=\"%s\"} %" PRIu64 "\n",
-                            e->name, n->name, g->name, e->value);
+                    gen_entry_samples(e, n->name, g->name, stream);
                 }
             }
-            pthread_mutex_unlock(&n->lock);
         }
     }
 }
@@ -331,6 +353,73 @@ static void gen_node_metrics(neu_metrics_t *metrics, struct context *ctx)
     }
 }
 
+static const struct {
+    const char *name;
+    const char *type;
+    const char *help;
+} http_metrics[] = {
+    { "rest_requests_total", "counter", "REST requests admitted" },
+    { "rest_rejected_total", "counter",
+      "REST requests answered 429 for the in flight limit" },
+    { "rest_inflight_requests", "gauge", "REST requests in flight" },
+    { "rest_request_duration_ms_total", "counter",
+      "Total time of the answered REST requests in milliseconds" },
+    { "rest_request_max_duration_ms", "gauge",
+      "Longest answered REST request in milliseconds" },
+    { "rest_request_queue_ms_total", "counter",
+      "Total wait of the REST requests for a worker in milliseconds" },
+};
+
+struct http_metric_ctx {
+    FILE *stream;
+    int   index;
+};
+
+static void gen_http_metric(const neu_http_handler_stats_t *stats,
+                            struct http_metric_ctx *        ctx)
+{
+    uint64_t value = 0;
+
+    switch (ctx->index) {
+    case 0:
+        value = stats->requests;
+        break;
+    case 1:
+        value = stats->rejected;
+        break;
+    case 2:
+        value = stats->inflight;
+        break;
+    case 3:
+        value = stats->duration_ms;
+        break;
+    case 4:
+        value = stats->max_duration_ms;
+        break;
+    default:
+        value = stats->queue_ms;
+        break;
+    }
+
+    fprintf(ctx->stream, "%s{method=\"%s\",url=\"%s\"} %" PRIu64 "\n",
+            http_metrics[ctx->index].name, stats->method, stats->url, value);
+}
+
+static void gen_http_metrics(FILE *stream)
+{
+    struct http_metric_ctx ctx = { .stream = stream };
+
+    for (ctx.index = 0;
+         ctx.index < (int) (sizeof(http_metrics) / sizeof(http_metrics[0]));
+         ctx.index++) {
+        fprintf(stream, "# HELP %s %s\n# TYPE %s %s\n",
+                http_metrics[ctx.index].name, http_metrics[ctx.index].help,
+                http_metrics[ctx.index].name, http_metrics[ctx.index].type);
+        neu_http_handler_visit_stats(
+            (neu_http_handler_stats_cb_t) gen_http_metric, &ctx);
+    }
+}
+
 void handle_get_metric(nng_aio *aio)
 {
     int    status = NNG_HTTP_STATUS_OK;
@@ -373,6 +462,7 @@ void handle_get_metric(nng_aio *aio)
     switch (cat) {
     case NEU_METRICS_CATEGORY_GLOBAL:
         neu_metrics_visist((neu_metrics_cb_t) gen_global_metrics, stream);
+        gen_http_metrics(stream);
         break;
     case NEU_METRICS_CATEGORY_DRIVER:
         ctx.filter = NEU_NA_TYPE_DRIVER;
@@ -385,6 +475,7 @@ void handle_get_metric(nng_aio *aio)
     case NEU_METRICS_CATEGORY_ALL:
         ctx.filter = NEU_NA_TYPE_DRIVER | NEU_NA_TYPE_APP;
         neu_metrics_visist((neu_metrics_cb_t) gen_global_metrics, stream);
+        gen_http_metrics(stream);
         neu_metrics_visist((neu_metrics_cb_t) gen_node_metrics, &ctx);
         break;
     }
@@ -0,0 +1,163 @@
+/**
+ * NEURON IIoT System for Industry 4.0
+ * Copyright (C) 2020-2023 EMQ Technologies Co., Ltd All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ **/
+
+#include <pthread.h>
+#include <stdlib.h>
+
+#include "errcodes.h"
+#include "parser/neu_json_log.h"
+#include "utils/http.h"
+#include "utils/log.h"
+#include "utils/profile.h"
+#include "json/neu_json_fn.h"
+
+#include "handle.h"
+#include "profile_handle.h"
+
+#define PROFILE_SECONDS_DEFAULT 10
+#define PROFILE_HZ_DEFAULT 99
+
+struct profile_ctx {
+    nng_aio *aio;
+    unsigned seconds;
+    unsigned hz;
+};
+
+static int get_param(nng_aio *aio, const char *name, uintmax_t def,
+                     uintmax_t max, unsigned *value)
+{
+    uintmax_t v   = def;
+    size_t    len = 0;
+
+    if (neu_http_get_param(aio, name, &len) != NULL &&
+        neu_http_get_param_uintmax(aio, name, &v) != 0) {
+        return -1;
+    }
+    if (v == 0 || v > max) {
+        return -1;
+    }
+
+    *value = (unsigned) v;
+    return 0;
+}
+
+// the sampling takes seconds, the http thread is not held meanwhile
+static void *profile_run(void *arg)
+{
+    struct profile_ctx *ctx    = (struct profile_ctx *) arg;
+    char *              folded = NULL;
+    size_t              len    = 0;
+    int                 ret    = 0;
+
+    ret = neu_profile_sample(ctx->seconds, ctx->hz, &folded, &len);
+    if (ret != 0) {
+        NEU_JSON_RESPONSE_ERROR(ret, {
+            neu_http_response(ctx->aio, error_code.error, result_error);
+        });
+    } else {
+        neu_http_response_file(ctx->aio, folded, len,
+                               "attachment; filename=neuron.folded");
+    }
+
+    free(folded);
+    free(ctx);
+    return NULL;
+}
+
+void handle_get_profile(nng_aio *aio)
+{
+    struct profile_ctx *ctx = NULL;
+    pthread_t           tid;
+    pthread_attr_t      attr;
+
+    NEU_VALIDATE_JWT(aio);
+
+    ctx = calloc(1, sizeof(struct profile_ctx));
+    if (ctx == NULL) {
+        NEU_JSON_RESPONSE_ERROR(NEU_ERR_EINTERNAL, {
+            neu_http_response(aio, error_code.error, result_error);
+        });
+        return;
+    }
+
+    ctx->aio = aio;
+    if (get_param(aio, "seconds", PROFILE_SECONDS_DEFAULT,
+                  NEU_PROFILE_SECONDS_MAX, &ctx->seconds) != 0 ||
+        get_param(aio, "hz", PROFILE_HZ_DEFAULT, NEU_PROFILE_HZ_MAX,
+                  &ctx->hz) != 0) {
+        free(ctx);
+        NEU_JSON_RESPONSE_ERROR(NEU_ERR_PARAM_IS_WRONG, {
+            neu_http_response(aio, error_code.error, result_error);
+        });
+        return;
+    }
+
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    if (pthread_create(&tid, &attr, profile_run, ctx) != 0) {
+        nlog_error("create profile thread fail");
+        free(ctx);
+        NEU_JSON_RESPONSE_ERROR(NEU_ERR_EINTERNAL, {
+            neu_http_response(aio, error_code.error, result_error);
+        });
+    }
+    pthread_attr_destroy(&attr);
+}
+
+void handle_get_profile_threads(nng_aio *aio)
+{
+    neu_profile_thread_t *              threads  = NULL;
+    int                                 n_thread = 0;
+    uint64_t                            cpu_ms   = 0;
+    char *                              result   = NULL;
+    neu_json_get_profile_threads_resp_t resp     = { 0 };
+
+    NEU_VALIDATE_JWT(aio);
+
+    if (neu_profile_threads(&threads, &n_thread, &cpu_ms) != 0) {
+        NEU_JSON_RESPONSE_ERROR(NEU_ERR_EINTERNAL, {
+            neu_http_response(aio, error_code.error, result_error);
+        });
+        return;
+    }
+
+    resp.cpu_ms   = (int64_t) cpu_ms;
+    resp.n_thread = n_thread;
+    resp.threads  = calloc(n_thread > 0 ? n_thread : 1,
+                          sizeof(neu_json_get_profile_threads_resp_thread_t));
+    for (int i = 0; resp.threads != NULL && i < n_thread; i++) {
+        resp.threads[i].node   = threads[i].node;
+        resp.threads[i].role   = threads[i].role;
+        resp.threads[i].cpu_ms = (int64_t) threads[i].cpu_ms;
+    }
+
+    if (resp.threads == NULL ||
+        neu_json_encode_by_fn(&resp, neu_json_encode_get_profile_threads_resp,
+                              &result) != 0) {
+        NEU_JSON_RESPONSE_ERROR(NEU_ERR_EINTERNAL, {
+            neu_http_response(aio, error_code.error, result_error);
+        });
+    } else {
+        neu_http_ok(aio, result);
+    }
+
+    free(result);
+    free(resp.threads);
+    free(threads);
+}
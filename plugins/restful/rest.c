@@ -34,6 +34,7 @@
 #include "plugin_handle.h"
 #include "rest.h"
 #include "rw_handle.h"
+#include "sse_handle.h"
 #include "utils/http.h"
 #include "utils/log.h"
 #include "utils/neu_jwt.h"
@@ -163,7 +164,13 @@ static int dashb_plugin_config(neu_plugin_t *plugin, const char *configs)
 static int dashb_plugin_request(neu_plugin_t *      plugin,
                                 neu_reqresp_head_t *header, void *data)
 {
-    (void) plugin;
+    if (handle_read_batch_resp(header, data) ||
+        handle_write_batch_resp(header, data) ||
+        handle_gtags_import_resp(header, data) ||
+        handle_global_config_import_resp(header, data) ||
+        handle_sse_msg(plugin, header, data)) {
+        return 0;
+    }
 
     if (header->ctx && nng_aio_get_input(header->ctx, 3)) {
         // catch all response messages for global config request
@@ -196,6 +203,7 @@ static int dashb_plugin_request(neu_plugin_t *      plugin,
         handle_add_tags_resp(header->ctx, (neu_resp_add_tag_t *) data);
         break;
     case NEU_RESP_ADD_GTAG:
+    case NEU_RESP_APPLY_GTAG:
         handle_add_gtags_resp(header->ctx, (neu_resp_add_tag_t *) data);
         break;
     case NEU_RESP_UPDATE_TAG:
@@ -204,6 +212,10 @@ static int dashb_plugin_request(neu_plugin_t *      plugin,
     case NEU_RESP_GET_TAG:
         handle_get_tags_resp(header->ctx, (neu_resp_get_tag_t *) data);
         break;
+    case NEU_RESP_GET_TAG_HISTORY:
+        handle_get_tag_history_resp(header->ctx,
+                                    (neu_resp_get_tag_history_t *) data);
+        break;
     case NEU_RESP_GET_SUBSCRIBE_GROUP:
         handle_grp_get_subscribe_resp(header->ctx,
                                       (neu_resp_get_subscribe_group_t *) data);
@@ -16,6 +16,7 @@
  * along with this program; if not, write to the Free Software Foundation,
  * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
  **/
+#include <pthread.h>
 #include <stdlib.h>
 
 #include "plugin.h"
@@ -27,6 +28,7 @@
 #include "utils/http.h"
 
 #include "rw_handle.h"
+#include "stream.h"
 
 void handle_read(nng_aio *aio)
 {
@@ -56,14 +58,15 @@ void handle_read(nng_aio *aio)
                 goto error;
             }
 
-            cmd.driver = req->node;
-            cmd.group  = req->group;
-            cmd.name   = req->name;
-            cmd.desc   = req->desc;
-            cmd.sync   = req->sync;
-            req->node  = NULL;
-            req->group = NULL;
-            ret        = neu_plugin_op(plugin, header, &cmd);
+            cmd.driver  = req->node;
+            cmd.group   = req->group;
+            cmd.name    = req->name;
+            cmd.desc    = req->desc;
+            cmd.sync    = req->sync;
+            cmd.max_age = req->max_age;
+            req->node   = NULL;
+            req->group  = NULL;
+            ret         = neu_plugin_op(plugin, header, &cmd);
             if (ret != 0) {
                 neu_req_read_group_fini(&cmd);
                 NEU_JSON_RESPONSE_ERROR(NEU_ERR_IS_BUSY, {
@@ -84,7 +87,7 @@ void handle_write(nng_aio *aio)
 {
     neu_plugin_t *plugin = neu_rest_get_plugin();
 
-    NEU_PROCESS_HTTP_REQUEST_VALIDATE_JWT(
+    NEU_PROCESS_HTTP_REQUEST_JSON_VALIDATE_JWT(
         aio, neu_json_write_req_t, neu_json_decode_write_req, {
             neu_reqresp_head_t  header = { 0 };
             neu_req_write_tag_t cmd    = { 0 };
@@ -130,10 +133,12 @@ void handle_write(nng_aio *aio)
                 goto error;
             }
 
-            cmd.driver = req->node;
-            cmd.group  = req->group;
-            cmd.tag    = req->tag;
-            req->node  = NULL; // ownership moved
+            cmd.driver  = req->node;
+            cmd.group   = req->group;
+            cmd.tag     = req->tag;
+            cmd.preempt = req->preempt;
+            cmd.verify  = req->verify;
+            req->node   = NULL; // ownership moved
             req->group = NULL; // ownership moved
             req->tag   = NULL; // ownership moved
 
@@ -186,7 +191,7 @@ void handle_write_tags(nng_aio *aio)
 {
     neu_plugin_t *plugin = neu_rest_get_plugin();
 
-    NEU_PROCESS_HTTP_REQUEST_VALIDATE_JWT(
+    NEU_PROCESS_HTTP_REQUEST_JSON_VALIDATE_JWT(
         aio, neu_json_write_tags_req_t, neu_json_decode_write_tags_req, {
             neu_reqresp_head_t   header = { 0 };
             neu_req_write_tags_t cmd    = { 0 };
@@ -220,12 +225,14 @@ void handle_write_tags(nng_aio *aio)
                 goto error;
             }
 
-            cmd.driver = req->node;
-            cmd.group  = req->group;
-            cmd.n_tag  = req->n_tag;
-            cmd.tags   = calloc(cmd.n_tag, sizeof(neu_resp_tag_value_t));
-            req->node  = NULL; // ownership moved
-            req->group = NULL; // ownership moved
+            cmd.driver  = req->node;
+            cmd.group   = req->group;
+            cmd.n_tag   = req->n_tag;
+            cmd.tags    = calloc(cmd.n_tag, sizeof(neu_resp_tag_value_t));
+            cmd.preempt = req->preempt;
+            cmd.verify  = req->verify;
+            req->node   = NULL; // ownership moved
+            req->group  = NULL; // ownership moved
 
             for (int i = 0; i < cmd.n_tag; i++) {
                 strcpy(cmd.tags[i].tag, req->tags[i].tag);
@@ -283,6 +290,7 @@ static void trans(neu_json_write_gtags_req_t *req, neu_req_write_gtags_t *cmd)
 {
     cmd->driver  = req->node;
     req->node    = NULL; // ownership moved
+    cmd->preempt = req->preempt;
     cmd->n_group = req->n_group;
     cmd->groups  = calloc(cmd->n_group, sizeof(neu_req_gtag_group_t));
     for (int i = 0; i < cmd->n_group; i++) {
@@ -336,7 +344,7 @@ void handle_write_gtags(nng_aio *aio)
 {
     neu_plugin_t *plugin = neu_rest_get_plugin();
 
-    NEU_PROCESS_HTTP_REQUEST_VALIDATE_JWT(
+    NEU_PROCESS_HTTP_REQUEST_JSON_VALIDATE_JWT(
         aio, neu_json_write_gtags_req_t, neu_json_decode_write_gtags_req, {
             neu_reqresp_head_t    header = { 0 };
             neu_req_write_gtags_t cmd    = { 0 };
@@ -359,28 +367,586 @@ void handle_write_gtags(nng_aio *aio)
         })
 }
 
-void handle_read_resp(nng_aio *aio, neu_resp_read_group_t *resp)
+typedef struct {
+    char *  driver;
+    int64_t error;
+    bool    done;
+} write_batch_item_t;
+
+// A batch write hands the writes of every node to its driver at once, so the
+// drivers work in parallel, and answers once the last one is done. As with a
+// batch read, a response belongs to the oldest unanswered node of its sender.
+typedef struct write_batch {
+    pthread_mutex_t     mtx;
+    nng_aio *           aio;
+    int                 n_item;
+    write_batch_item_t *items;
+    int                 n_pending;
+    struct write_batch *next;
+} write_batch_t;
+
+static pthread_mutex_t write_batches_mtx = PTHREAD_MUTEX_INITIALIZER;
+static write_batch_t * write_batches     = NULL;
+
+static void write_batch_free(write_batch_t *batch)
 {
-    neu_json_read_resp_t api_res = { 0 };
-    char *               result  = NULL;
-    int                  index   = 0;
+    for (int i = 0; i < batch->n_item; i++) {
+        free(batch->items[i].driver);
+    }
+    pthread_mutex_destroy(&batch->mtx);
+    free(batch->items);
+    free(batch);
+}
+
+static write_batch_t *write_batch_find(void *ctx)
+{
+    write_batch_t *batch = NULL;
+
+    pthread_mutex_lock(&write_batches_mtx);
+    for (batch = write_batches; batch != NULL; batch = batch->next) {
+        if (batch == ctx) {
+            break;
+        }
+    }
+    pthread_mutex_unlock(&write_batches_mtx);
+
+    return batch;
+}
+
+static void write_batch_remove(write_batch_t *batch)
+{
+    pthread_mutex_lock(&write_batches_mtx);
+    for (write_batch_t **pp = &write_batches; *pp != NULL; pp = &(*pp)->next) {
+        if (*pp == batch) {
+            *pp = batch->next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&write_batches_mtx);
+}
+
+// returns true once every node is answered
+static bool write_batch_done(write_batch_t *batch, write_batch_item_t *item,
+                             int64_t error)
+{
+    item->done  = true;
+    item->error = error;
+    batch->n_pending -= 1;
+    return batch->n_pending == 0;
+}
+
+// answers the aggregated result and frees the batch
+static void write_batch_reply(write_batch_t *batch)
+{
+    neu_json_write_batch_resp_t resp   = { 0 };
+    char *                      result = NULL;
+
+    write_batch_remove(batch);
+
+    resp.n_node = batch->n_item;
+    resp.nodes  = calloc(batch->n_item, sizeof(neu_json_write_batch_node_t));
+    if (resp.nodes != NULL) {
+        for (int i = 0; i < batch->n_item; i++) {
+            resp.nodes[i].node  = batch->items[i].driver;
+            resp.nodes[i].error = batch->items[i].error;
+            if (resp.error == NEU_ERR_SUCCESS) {
+                resp.error = batch->items[i].error;
+            }
+        }
+        neu_json_encode_by_fn(&resp, neu_json_encode_write_batch_resp,
+                              &result);
+        free(resp.nodes);
+    }
+
+    if (result == NULL) {
+        NEU_JSON_RESPONSE_ERROR(NEU_ERR_EINTERNAL, {
+            neu_http_response(batch->aio, NEU_ERR_EINTERNAL, result_error);
+        });
+    } else {
+        neu_http_response(batch->aio, resp.error, result);
+        free(result);
+    }
+
+    write_batch_free(batch);
+}
+
+static int write_batch_check(neu_json_write_batch_req_t *req)
+{
+    for (int i = 0; i < req->n_node; i++) {
+        if (strlen(req->nodes[i].node) >= NEU_NODE_NAME_LEN) {
+            return NEU_ERR_NODE_NAME_TOO_LONG;
+        }
+
+        for (int k = 0; k < req->nodes[i].n_group; k++) {
+            if (strlen(req->nodes[i].groups[k].group) >= NEU_GROUP_NAME_LEN) {
+                return NEU_ERR_GROUP_NAME_TOO_LONG;
+            }
+        }
+    }
+
+    return NEU_ERR_SUCCESS;
+}
+
+static write_batch_t *write_batch_new(nng_aio *                   aio,
+                                      neu_json_write_batch_req_t *req)
+{
+    write_batch_t *batch = calloc(1, sizeof(write_batch_t));
+    if (batch == NULL) {
+        return NULL;
+    }
+
+    batch->items = calloc(req->n_node, sizeof(write_batch_item_t));
+    if (batch->items == NULL) {
+        free(batch);
+        return NULL;
+    }
+
+    pthread_mutex_init(&batch->mtx, NULL);
+    batch->aio       = aio;
+    batch->n_item    = req->n_node;
+    batch->n_pending = req->n_node;
+    for (int i = 0; i < req->n_node; i++) {
+        batch->items[i].driver = strdup(req->nodes[i].node);
+    }
+
+    return batch;
+}
+
+static void write_batch_start(neu_plugin_t *plugin, write_batch_t *batch,
+                              neu_json_write_batch_req_t *req)
+{
+    bool complete = false;
+
+    pthread_mutex_lock(&batch->mtx);
+
+    pthread_mutex_lock(&write_batches_mtx);
+    batch->next   = write_batches;
+    write_batches = batch;
+    pthread_mutex_unlock(&write_batches_mtx);
+
+    for (int i = 0; i < batch->n_item; i++) {
+        neu_reqresp_head_t    header = { 0 };
+        neu_req_write_gtags_t cmd    = { 0 };
+
+        header.ctx  = batch;
+        header.type = NEU_REQ_WRITE_GTAGS;
+        trans(&req->nodes[i], &cmd);
+
+        if (neu_plugin_op(plugin, header, &cmd) != 0) {
+            neu_req_write_gtags_fini(&cmd);
+            complete =
+                write_batch_done(batch, &batch->items[i], NEU_ERR_IS_BUSY);
+        }
+    }
+
+    pthread_mutex_unlock(&batch->mtx);
+
+    if (complete) {
+        write_batch_reply(batch);
+    }
+}
+
+void handle_write_batch(nng_aio *aio)
+{
+    neu_plugin_t *plugin = neu_rest_get_plugin();
+
+    NEU_PROCESS_HTTP_REQUEST_VALIDATE_JWT(
+        aio, neu_json_write_batch_req_t, neu_json_decode_write_batch_req, {
+            int            err_type = write_batch_check(req);
+            write_batch_t *batch    = NULL;
+
+            nng_http_req *nng_req = nng_aio_get_input(aio, 0);
+            nlog_notice("<%p> req %s %s, %d nodes", aio,
+                        nng_http_req_get_method(nng_req),
+                        nng_http_req_get_uri(nng_req), req->n_node);
+
+            if (err_type != NEU_ERR_SUCCESS) {
+                NEU_JSON_RESPONSE_ERROR(err_type, {
+                    neu_http_response(aio, err_type, result_error);
+                });
+            } else if ((batch = write_batch_new(aio, req)) == NULL) {
+                NEU_JSON_RESPONSE_ERROR(NEU_ERR_EINTERNAL, {
+                    neu_http_response(aio, NEU_ERR_EINTERNAL, result_error);
+                });
+            } else {
+                write_batch_start(plugin, batch, req);
+            }
+        })
+}
 
-    api_res.n_tag = utarray_len(resp->tags);
-    api_res.tags  = calloc(api_res.n_tag, sizeof(neu_json_read_resp_tag_t));
+bool handle_write_batch_resp(neu_reqresp_head_t *header, void *data)
+{
+    write_batch_t *     batch    = write_batch_find(header->ctx);
+    write_batch_item_t *item     = NULL;
+    bool                complete = false;
+
+    if (batch == NULL) {
+        return false;
+    }
+
+    pthread_mutex_lock(&batch->mtx);
+    for (int i = 0; i < batch->n_item; i++) {
+        if (!batch->items[i].done &&
+            strcmp(batch->items[i].driver, header->sender) == 0) {
+            item = &batch->items[i];
+            break;
+        }
+    }
+
+    if (item == NULL) {
+        nlog_warn("<%p> batch write unexpected %s from %s", (void *) batch,
+                  neu_reqresp_type_string(header->type), header->sender);
+    } else if (header->type == NEU_RESP_ERROR) {
+        complete = write_batch_done(batch, item,
+                                    ((neu_resp_error_t *) data)->error);
+    } else {
+        complete = write_batch_done(batch, item, NEU_ERR_EINTERNAL);
+    }
+    pthread_mutex_unlock(&batch->mtx);
+
+    if (complete) {
+        write_batch_reply(batch);
+    }
+
+    return true;
+}
+
+static void read_resp_to_json(neu_resp_read_group_t *resp,
+                              neu_json_read_resp_t * api_res)
+{
+    int index = 0;
+
+    api_res->n_tag = utarray_len(resp->tags);
+    api_res->tags  = calloc(api_res->n_tag, sizeof(neu_json_read_resp_tag_t));
 
     utarray_foreach(resp->tags, neu_resp_tag_value_meta_t *, tag_value)
     {
-        neu_tag_value_to_json(tag_value, &api_res.tags[index]);
+        neu_tag_value_to_json(tag_value, &api_res->tags[index]);
         index += 1;
     }
+}
 
-    neu_json_encode_by_fn(&api_res, neu_json_encode_read_resp, &result);
-    for (int i = 0; i < api_res.n_tag; i++) {
-        if (api_res.tags[i].n_meta > 0) {
-            free(api_res.tags[i].metas);
+static void read_resp_json_fini(neu_json_read_resp_t *api_res)
+{
+    for (int i = 0; i < api_res->n_tag; i++) {
+        if (api_res->tags[i].n_meta > 0) {
+            free(api_res->tags[i].metas);
         }
     }
+    free(api_res->tags);
+}
+
+void handle_read_resp(nng_aio *aio, neu_resp_read_group_t *resp)
+{
+    neu_json_read_resp_t api_res = { 0 };
+    char *               result  = NULL;
+
+    read_resp_to_json(resp, &api_res);
+    neu_json_encode_by_fn(&api_res, neu_json_encode_read_resp, &result);
+    read_resp_json_fini(&api_res);
     neu_http_ok(aio, result);
-    free(api_res.tags);
     free(result);
 }
+
+#define READ_BATCH_HTTP_HEAD                                        \
+    "HTTP/1.1 200 OK\r\n"                                           \
+    "Content-Type: application/json\r\n"                            \
+    "Transfer-Encoding: chunked\r\n"                                \
+    "Access-Control-Allow-Origin: *\r\n"                            \
+    "Access-Control-Allow-Methods: POST,GET,PUT,DELETE,OPTIONS\r\n" \
+    "Access-Control-Allow-Headers: *\r\n"                           \
+    "Connection: close\r\n\r\n"
+
+typedef struct {
+    char *driver;
+    char *group;
+    char *name;
+    char *desc;
+    bool  done;
+} read_batch_item_t;
+
+// A batch read fans every group out to its driver at once and streams each
+// group back as one http chunk when it answers. Drivers answer in request
+// order, so a response belongs to the oldest unanswered group of its sender.
+typedef struct read_batch {
+    pthread_mutex_t    mtx;
+    neu_rest_stream_t *stream;
+    bool               sync;
+    uint32_t           max_age;
+    int                n_item;
+    read_batch_item_t *items;
+    int                n_pending;
+    int                n_sent;
+    struct read_batch *next;
+} read_batch_t;
+
+static pthread_mutex_t batches_mtx = PTHREAD_MUTEX_INITIALIZER;
+static read_batch_t *  batches     = NULL;
+
+static void read_batch_free(read_batch_t *batch)
+{
+    for (int i = 0; i < batch->n_item; i++) {
+        free(batch->items[i].driver);
+        free(batch->items[i].group);
+        free(batch->items[i].name);
+        free(batch->items[i].desc);
+    }
+    pthread_mutex_destroy(&batch->mtx);
+    free(batch->items);
+    free(batch);
+}
+
+static read_batch_t *read_batch_find(void *ctx)
+{
+    read_batch_t *batch = NULL;
+
+    pthread_mutex_lock(&batches_mtx);
+    for (batch = batches; batch != NULL; batch = batch->next) {
+        if (batch == ctx) {
+            break;
+        }
+    }
+    pthread_mutex_unlock(&batches_mtx);
+
+    return batch;
+}
+
+static void read_batch_remove(read_batch_t *batch)
+{
+    pthread_mutex_lock(&batches_mtx);
+    for (read_batch_t **pp = &batches; *pp != NULL; pp = &(*pp)->next) {
+        if (*pp == batch) {
+            *pp = batch->next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&batches_mtx);
+}
+
+static void read_batch_chunk(read_batch_t *batch, const char *sep,
+                             const char *data)
+{
+    char size[32] = { 0 };
+
+    snprintf(size, sizeof(size), "%zx\r\n", strlen(sep) + strlen(data));
+    neu_rest_stream_write(batch->stream, size, strlen(size));
+    neu_rest_stream_write(batch->stream, sep, strlen(sep));
+    neu_rest_stream_write(batch->stream, data, strlen(data));
+    neu_rest_stream_write(batch->stream, "\r\n", 2);
+}
+
+// returns true once every group is answered, the batch is then the caller's
+// to free
+static bool read_batch_done(read_batch_t *batch, read_batch_item_t *item,
+                            int64_t error, neu_resp_read_group_t *resp)
+{
+    neu_json_read_resp_t        api_res = { 0 };
+    neu_json_read_batch_group_t group   = { 0 };
+    char *                      result  = NULL;
+
+    group.node  = item->driver;
+    group.group = item->group;
+    group.error = error;
+    if (resp != NULL) {
+        read_resp_to_json(resp, &api_res);
+        group.resp = &api_res;
+    }
+
+    neu_json_encode_by_fn(&group, neu_json_encode_read_batch_group, &result);
+    if (resp != NULL) {
+        read_resp_json_fini(&api_res);
+    }
+
+    item->done = true;
+    batch->n_pending -= 1;
+    if (result != NULL) {
+        read_batch_chunk(batch, batch->n_sent > 0 ? "," : "", result);
+        batch->n_sent += 1;
+        free(result);
+    }
+
+    if (batch->n_pending > 0) {
+        return false;
+    }
+
+    read_batch_chunk(batch, "", "]}");
+    neu_rest_stream_write(batch->stream, "0\r\n\r\n", 5);
+    neu_rest_stream_close(batch->stream);
+    batch->stream = NULL;
+    return true;
+}
+
+static read_batch_t *read_batch_new(neu_json_read_batch_req_t *req)
+{
+    read_batch_t *batch = calloc(1, sizeof(read_batch_t));
+    if (batch == NULL) {
+        return NULL;
+    }
+
+    batch->items = calloc(req->n_group, sizeof(read_batch_item_t));
+    if (batch->items == NULL) {
+        free(batch);
+        return NULL;
+    }
+
+    pthread_mutex_init(&batch->mtx, NULL);
+    batch->sync      = req->sync;
+    batch->max_age   = req->max_age;
+    batch->n_item    = req->n_group;
+    batch->n_pending = req->n_group;
+    for (int i = 0; i < req->n_group; i++) {
+        batch->items[i].driver = req->groups[i].node;
+        batch->items[i].group  = req->groups[i].group;
+        batch->items[i].name   = req->groups[i].name;
+        batch->items[i].desc   = req->groups[i].desc;
+        req->groups[i].node    = NULL; // ownership moved
+        req->groups[i].group   = NULL; // ownership moved
+        req->groups[i].name    = NULL; // ownership moved
+        req->groups[i].desc    = NULL; // ownership moved
+    }
+
+    return batch;
+}
+
+static char *dup_str(const char *str)
+{
+    return str != NULL ? strdup(str) : NULL;
+}
+
+static void read_batch_start(neu_plugin_t *plugin, read_batch_t *batch)
+{
+    bool complete = false;
+
+    pthread_mutex_lock(&batch->mtx);
+
+    pthread_mutex_lock(&batches_mtx);
+    batch->next = batches;
+    batches     = batch;
+    pthread_mutex_unlock(&batches_mtx);
+
+    neu_rest_stream_write(batch->stream, READ_BATCH_HTTP_HEAD,
+                          strlen(READ_BATCH_HTTP_HEAD));
+    read_batch_chunk(batch, "", "{\"groups\":[");
+
+    for (int i = 0; i < batch->n_item; i++) {
+        read_batch_item_t *  item   = &batch->items[i];
+        neu_reqresp_head_t   header = { 0 };
+        neu_req_read_group_t cmd    = { 0 };
+
+        header.ctx  = batch;
+        header.type = NEU_REQ_READ_GROUP;
+        cmd.driver  = strdup(item->driver);
+        cmd.group   = strdup(item->group);
+        cmd.name    = dup_str(item->name);
+        cmd.desc    = dup_str(item->desc);
+        cmd.sync    = batch->sync;
+        cmd.max_age = batch->max_age;
+
+        if (neu_plugin_op(plugin, header, &cmd) != 0) {
+            neu_req_read_group_fini(&cmd);
+            complete = read_batch_done(batch, item, NEU_ERR_IS_BUSY, NULL);
+        }
+    }
+
+    pthread_mutex_unlock(&batch->mtx);
+
+    if (complete) {
+        read_batch_remove(batch);
+        read_batch_free(batch);
+    }
+}
+
+static int read_batch_check(neu_json_read_batch_req_t *req)
+{
+    for (int i = 0; i < req->n_group; i++) {
+        if (strlen(req->groups[i].node) >= NEU_NODE_NAME_LEN) {
+            return NEU_ERR_NODE_NAME_TOO_LONG;
+        }
+
+        if (strlen(req->groups[i].group) >= NEU_GROUP_NAME_LEN) {
+            return NEU_ERR_GROUP_NAME_TOO_LONG;
+        }
+
+        if (req->groups[i].name != NULL &&
+            strlen(req->groups[i].name) >= NEU_TAG_NAME_LEN) {
+            return NEU_ERR_TAG_NAME_TOO_LONG;
+        }
+    }
+
+    return NEU_ERR_SUCCESS;
+}
+
+void handle_read_batch(nng_aio *aio)
+{
+    neu_plugin_t *plugin = neu_rest_get_plugin();
+
+    NEU_PROCESS_HTTP_REQUEST_VALIDATE_JWT(
+        aio, neu_json_read_batch_req_t, neu_json_decode_read_batch_req, {
+            int           err_type = read_batch_check(req);
+            read_batch_t *batch    = NULL;
+
+            if (err_type != NEU_ERR_SUCCESS) {
+                goto error;
+            }
+
+            batch = read_batch_new(req);
+            if (batch == NULL ||
+                (batch->stream = neu_rest_stream_new(aio)) == NULL) {
+                err_type = NEU_ERR_EINTERNAL;
+                goto error;
+            }
+
+            read_batch_start(plugin, batch);
+            goto success;
+
+        error:
+            if (batch != NULL) {
+                read_batch_free(batch);
+            }
+            NEU_JSON_RESPONSE_ERROR(
+                err_type, { neu_http_response(aio, err_type, result_error); });
+
+        success:;
+        })
+}
+
+bool handle_read_batch_resp(neu_reqresp_head_t *header, void *data)
+{
+    read_batch_t *     batch    = read_batch_find(header->ctx);
+    read_batch_item_t *item     = NULL;
+    bool               complete = false;
+
+    if (batch == NULL) {
+        return false;
+    }
+
+    pthread_mutex_lock(&batch->mtx);
+    for (int i = 0; i < batch->n_item; i++) {
+        if (!batch->items[i].done &&
+            strcmp(batch->items[i].driver, header->sender) == 0) {
+            item = &batch->items[i];
+            break;
+        }
+    }
+
+    if (item == NULL) {
+        nlog_warn("<%p> batch read unexpected %s from %s", (void *) batch,
+                  neu_reqresp_type_string(header->type), header->sender);
+    } else if (header->type == NEU_RESP_READ_GROUP) {
+        complete =
+            read_batch_done(batch, item, 0, (neu_resp_read_group_t *) data);
+    } else if (header->type == NEU_RESP_ERROR) {
+        complete = read_batch_done(
+            batch, item, ((neu_resp_error_t *) data)->error, NULL);
+    } else {
+        complete = read_batch_done(batch, item, NEU_ERR_EINTERNAL, NULL);
+    }
+    pthread_mutex_unlock(&batch->mtx);
+
+    if (complete) {
+        read_batch_remove(batch);
+        read_batch_free(batch);
+    }
+
+    return true;
+}
@@ -30,6 +30,12 @@ void handle_read(nng_aio *aio);
 void handle_write(nng_aio *aio);
 void handle_write_tags(nng_aio *aio);
 void handle_write_gtags(nng_aio *aio);
+void handle_write_batch(nng_aio *aio);
+// returns true if the response belongs to a batch write and was consumed
+bool handle_write_batch_resp(neu_reqresp_head_t *header, void *data);
 void handle_read_resp(nng_aio *aio, neu_resp_read_group_t *resp);
+void handle_read_batch(nng_aio *aio);
+// returns true if the response belongs to a batch read and was consumed
+bool handle_read_batch_resp(neu_reqresp_head_t *header, void *data);
 
 #endif
\ No newline at end of file
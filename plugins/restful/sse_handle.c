@@ -0,0 +1,542 @@
+/**
+ * NEURON IIoT System for Industry 4.0
+ * Copyright (C) 2020-2023 EMQ Technologies Co., Ltd All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ **/
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "plugin.h"
+#include "utils/http.h"
+#include "utils/http_handler.h"
+#include "utils/log.h"
+#include "utils/time.h"
+#include "utils/uthash.h"
+#include "json/neu_json_fn.h"
+#include "json/neu_json_stream.h"
+
+#include "handle.h"
+#include "stream.h"
+
+#include "sse_handle.h"
+
+#define SSE_HTTP_HEAD                      \
+    "HTTP/1.1 200 OK\r\n"                  \
+    "Content-Type: text/event-stream\r\n"  \
+    "Cache-Control: no-cache\r\n"          \
+    "Access-Control-Allow-Origin: *\r\n"   \
+    "Access-Control-Allow-Headers: *\r\n"  \
+    "Connection: close\r\n\r\n"
+
+// idle clients get a comment at most this often, which is also how clients
+// that went away are noticed while their group does not change
+#define SSE_KEEPALIVE_MS 15000
+
+typedef struct {
+    neu_resp_tag_value_meta_t value; // keyed by value.tag
+    UT_hash_handle            hh;
+} sse_tag_t;
+
+typedef struct sse_client {
+    neu_rest_stream_t *stream;
+    int64_t            ts; // last write
+    struct sse_client *next;
+} sse_client_t;
+
+// The rest node subscribes a group for as long as it has clients, each
+// update is pushed to them with only the tags that changed since the last
+// one. A new client starts from the last known values of the group.
+typedef struct sse_group {
+    char              driver[NEU_NODE_NAME_LEN];
+    char              group[NEU_GROUP_NAME_LEN];
+    sse_client_t *    clients;
+    sse_tag_t *       tags;
+    int64_t           ts; // of the last update
+    struct sse_group *next;
+} sse_group_t;
+
+// the manager answers (un)subscribe requests in order and without naming the
+// group, so they wait for their answer in a fifo
+typedef struct sse_pending {
+    neu_reqresp_type_e  type;
+    char                driver[NEU_NODE_NAME_LEN];
+    char                group[NEU_GROUP_NAME_LEN];
+    struct sse_pending *next;
+} sse_pending_t;
+
+static pthread_mutex_t   sse_mtx      = PTHREAD_MUTEX_INITIALIZER;
+static sse_group_t *     sse_groups   = NULL;
+static sse_pending_t *   pending_head = NULL;
+static sse_pending_t *   pending_tail = NULL;
+static neu_json_stream_t sse_json     = { 0 };
+static int               sse_ctx      = 0; // ctx of the (un)subscribe requests
+
+static sse_group_t *find_group(const char *driver, const char *group)
+{
+    for (sse_group_t *g = sse_groups; g != NULL; g = g->next) {
+        if (strcmp(g->driver, driver) == 0 &&
+            (group == NULL || strcmp(g->group, group) == 0)) {
+            return g;
+        }
+    }
+    return NULL;
+}
+
+static bool pending_has(neu_reqresp_type_e type, const char *driver,
+                        const char *group)
+{
+    for (sse_pending_t *p = pending_head; p != NULL; p = p->next) {
+        if (p->type == type && strcmp(p->driver, driver) == 0 &&
+            strcmp(p->group, group) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static int send_subscribe(neu_plugin_t *plugin, neu_reqresp_type_e type,
+                          const char *driver, const char *group)
+{
+    neu_reqresp_head_t    header  = { .ctx = &sse_ctx, .type = type };
+    neu_req_subscribe_t   sub     = { 0 };
+    neu_req_unsubscribe_t unsub   = { 0 };
+    sse_pending_t *       pending = calloc(1, sizeof(sse_pending_t));
+    int                   ret     = 0;
+
+    if (pending == NULL) {
+        return NEU_ERR_EINTERNAL;
+    }
+
+    pending->type = type;
+    strcpy(pending->driver, driver);
+    strcpy(pending->group, group);
+
+    if (type == NEU_REQ_SUBSCRIBE_GROUP) {
+        strcpy(sub.app, neu_plugin_to_plugin_common(plugin)->name);
+        strcpy(sub.driver, driver);
+        strcpy(sub.group, group);
+        ret = neu_plugin_op(plugin, header, &sub);
+    } else {
+        strcpy(unsub.app, neu_plugin_to_plugin_common(plugin)->name);
+        strcpy(unsub.driver, driver);
+        strcpy(unsub.group, group);
+        ret = neu_plugin_op(plugin, header, &unsub);
+    }
+
+    if (ret != 0) {
+        free(pending);
+        return NEU_ERR_IS_BUSY;
+    }
+
+    if (pending_tail == NULL) {
+        pending_head = pending;
+    } else {
+        pending_tail->next = pending;
+    }
+    pending_tail = pending;
+    return NEU_ERR_SUCCESS;
+}
+
+static void send_error(neu_rest_stream_t *stream, int error)
+{
+    char event[64] = { 0 };
+
+    snprintf(event, sizeof(event), "event: error\ndata: {\"error\":%d}\n\n",
+             error);
+    neu_rest_stream_write(stream, event, strlen(event));
+}
+
+static void close_client(sse_client_t *client, int error)
+{
+    if (error != NEU_ERR_SUCCESS) {
+        send_error(client->stream, error);
+    }
+    neu_rest_stream_close(client->stream);
+    free(client);
+}
+
+// json text has no raw newlines, so an event is a single data line
+static int send_event(neu_rest_stream_t *stream, const char *json, size_t len)
+{
+    if (neu_rest_stream_write(stream, "data: ", 6) != 0 ||
+        neu_rest_stream_write(stream, json, len) != 0 ||
+        neu_rest_stream_write(stream, "\n\n", 2) != 0) {
+        return -1;
+    }
+    return 0;
+}
+
+static void free_group(sse_group_t *group, int error)
+{
+    sse_tag_t *tag = NULL;
+    sse_tag_t *tmp = NULL;
+
+    for (sse_group_t **pp = &sse_groups; *pp != NULL; pp = &(*pp)->next) {
+        if (*pp == group) {
+            *pp = group->next;
+            break;
+        }
+    }
+
+    while (group->clients != NULL) {
+        sse_client_t *client = group->clients;
+        group->clients       = client->next;
+        close_client(client, error);
+    }
+
+    HASH_ITER(hh, group->tags, tag, tmp)
+    {
+        HASH_DEL(group->tags, tag);
+        free(tag);
+    }
+    free(group);
+}
+
+// send the event in `sse_json` to every client of the group, or keep idle
+// clients alive if `event` is false, and drop the clients that went away.
+// The group is unsubscribed and freed once none is left.
+static void broadcast(neu_plugin_t *plugin, sse_group_t *group, bool event,
+                      int64_t now)
+{
+    sse_client_t **pp = &group->clients;
+
+    while (*pp != NULL) {
+        sse_client_t *client = *pp;
+        int           ret    = 0;
+
+        if (event) {
+            ret = send_event(client->stream, sse_json.buf, sse_json.len);
+        } else if (now - client->ts >= SSE_KEEPALIVE_MS) {
+            ret = neu_rest_stream_write(client->stream, ":\n\n", 3);
+        } else {
+            pp = &client->next;
+            continue;
+        }
+
+        if (ret != 0) {
+            *pp = client->next;
+            close_client(client, NEU_ERR_SUCCESS);
+        } else {
+            client->ts = now;
+            pp         = &client->next;
+        }
+    }
+
+    if (group->clients == NULL) {
+        send_subscribe(plugin, NEU_REQ_UNSUBSCRIBE_GROUP, group->driver,
+                       group->group);
+        free_group(group, NEU_ERR_SUCCESS);
+    }
+}
+
+static int encode_event(sse_group_t *group, UT_array *tags)
+{
+    neu_json_read_periodic_t header = { .node      = group->driver,
+                                        .group     = group->group,
+                                        .timestamp = group->ts };
+
+    neu_json_stream_reset(&sse_json);
+    return neu_json_stream_read_periodic_resp1(&sse_json, &header, tags);
+}
+
+static bool value_equal(const neu_dvalue_t *a, const neu_dvalue_t *b)
+{
+    if (a->type != b->type) {
+        return false;
+    }
+
+    switch (a->type) {
+    case NEU_TYPE_BOOL:
+        return a->value.boolean == b->value.boolean;
+    case NEU_TYPE_INT8:
+    case NEU_TYPE_UINT8:
+    case NEU_TYPE_BIT:
+        return a->value.u8 == b->value.u8;
+    case NEU_TYPE_INT16:
+    case NEU_TYPE_UINT16:
+    case NEU_TYPE_WORD:
+        return a->value.u16 == b->value.u16;
+    case NEU_TYPE_INT32:
+    case NEU_TYPE_UINT32:
+    case NEU_TYPE_DWORD:
+    case NEU_TYPE_ERROR:
+        return a->value.u32 == b->value.u32;
+    case NEU_TYPE_FLOAT:
+        return a->value.f32 == b->value.f32 && a->precision == b->precision;
+    case NEU_TYPE_INT64:
+    case NEU_TYPE_UINT64:
+    case NEU_TYPE_LWORD:
+        return a->value.u64 == b->value.u64;
+    case NEU_TYPE_DOUBLE:
+        return a->value.d64 == b->value.d64 && a->precision == b->precision;
+    case NEU_TYPE_STRING:
+        return strcmp(a->value.str, b->value.str) == 0;
+    case NEU_TYPE_BYTES:
+        return a->value.bytes.length == b->value.bytes.length &&
+            memcmp(a->value.bytes.bytes, b->value.bytes.bytes,
+                   a->value.bytes.length) == 0;
+    case NEU_TYPE_PTR:
+        // owned by the message, never kept
+        return false;
+    }
+
+    return false;
+}
+
+static void handle_trans_data(neu_plugin_t *            plugin,
+                              neu_reqresp_trans_data_t *data)
+{
+    UT_array *   changed = NULL;
+    int64_t      now     = neu_time_ms();
+    sse_group_t *group   = find_group(data->driver, data->group);
+
+    if (group == NULL) {
+        // left over from a subscription that outlived its clients
+        if (!pending_has(NEU_REQ_UNSUBSCRIBE_GROUP, data->driver,
+                         data->group)) {
+            send_subscribe(plugin, NEU_REQ_UNSUBSCRIBE_GROUP, data->driver,
+                           data->group);
+        }
+        return;
+    }
+
+    utarray_new(changed, neu_resp_tag_value_meta_icd());
+    utarray_foreach(data->tags, neu_resp_tag_value_meta_t *, tag_value)
+    {
+        sse_tag_t *tag = NULL;
+
+        HASH_FIND_STR(group->tags, tag_value->tag, tag);
+        if (tag != NULL && value_equal(&tag->value.value, &tag_value->value)) {
+            continue;
+        }
+
+        if (tag == NULL && (tag = calloc(1, sizeof(sse_tag_t))) != NULL) {
+            tag->value.tag = tag_value->tag;
+            HASH_ADD_KEYPTR(hh, group->tags, tag->value.tag,
+                            strlen(tag->value.tag), tag);
+        }
+        if (tag != NULL) {
+            tag->value = *tag_value;
+        }
+        utarray_push_back(changed, tag_value);
+    }
+
+    group->ts = now;
+    broadcast(plugin, group,
+              utarray_len(changed) > 0 && encode_event(group, changed) == 0,
+              now);
+    utarray_free(changed);
+}
+
+static void handle_subscribe_resp(neu_resp_error_t *error)
+{
+    sse_pending_t *pending = pending_head;
+
+    if (pending == NULL) {
+        nlog_warn("sse unexpected subscribe response: %d",
+                  (int) error->error);
+        return;
+    }
+
+    pending_head = pending->next;
+    if (pending_head == NULL) {
+        pending_tail = NULL;
+    }
+
+    if (pending->type == NEU_REQ_SUBSCRIBE_GROUP &&
+        error->error != NEU_ERR_SUCCESS &&
+        error->error != NEU_ERR_GROUP_ALREADY_SUBSCRIBED) {
+        sse_group_t *group = find_group(pending->driver, pending->group);
+        nlog_warn("sse subscribe %s:%s fail: %d", pending->driver,
+                  pending->group, (int) error->error);
+        if (group != NULL) {
+            free_group(group, error->error);
+        }
+    }
+    free(pending);
+}
+
+// the group or driver is gone or renamed, its clients have to subscribe again
+static void close_groups(const char *driver, const char *group)
+{
+    sse_group_t *g = NULL;
+
+    while ((g = find_group(driver, group)) != NULL) {
+        free_group(g, NEU_ERR_SUCCESS);
+    }
+}
+
+bool handle_sse_msg(neu_plugin_t *plugin, neu_reqresp_head_t *header,
+                    void *data)
+{
+    bool consumed = true;
+
+    pthread_mutex_lock(&sse_mtx);
+    switch (header->type) {
+    case NEU_RESP_ERROR:
+        if (header->ctx == &sse_ctx) {
+            handle_subscribe_resp((neu_resp_error_t *) data);
+        } else {
+            consumed = false;
+        }
+        break;
+    case NEU_REQRESP_TRANS_DATA:
+        handle_trans_data(plugin, (neu_reqresp_trans_data_t *) data);
+        break;
+    case NEU_REQ_SUBSCRIBE_GROUP:
+    case NEU_REQ_UPDATE_SUBSCRIBE_GROUP:
+        free(((neu_req_subscribe_t *) data)->params);
+        break;
+    case NEU_REQ_UNSUBSCRIBE_GROUP: {
+        neu_req_unsubscribe_t *cmd = (neu_req_unsubscribe_t *) data;
+        close_groups(cmd->driver, cmd->group);
+        break;
+    }
+    case NEU_REQ_UPDATE_GROUP: {
+        neu_req_update_group_t *cmd = (neu_req_update_group_t *) data;
+        if (strcmp(cmd->group, cmd->new_name) != 0) {
+            close_groups(cmd->driver, cmd->group);
+        }
+        break;
+    }
+    case NEU_REQ_DEL_GROUP: {
+        neu_req_del_group_t *cmd = (neu_req_del_group_t *) data;
+        close_groups(cmd->driver, cmd->group);
+        break;
+    }
+    case NEU_REQ_UPDATE_NODE: {
+        neu_req_update_node_t *cmd = (neu_req_update_node_t *) data;
+        close_groups(cmd->node, NULL);
+        break;
+    }
+    case NEU_REQRESP_NODE_DELETED: {
+        neu_reqresp_node_deleted_t *cmd = (neu_reqresp_node_deleted_t *) data;
+        close_groups(cmd->node, NULL);
+        break;
+    }
+    default:
+        consumed = false;
+        break;
+    }
+    pthread_mutex_unlock(&sse_mtx);
+
+    return consumed;
+}
+
+static int sse_add_client(neu_plugin_t *plugin, const char *driver,
+                          const char *group_name, neu_rest_stream_t *stream)
+{
+    sse_group_t * group  = find_group(driver, group_name);
+    sse_client_t *client = calloc(1, sizeof(sse_client_t));
+    int           ret    = NEU_ERR_SUCCESS;
+
+    if (client == NULL) {
+        return NEU_ERR_EINTERNAL;
+    }
+
+    if (group == NULL) {
+        group = calloc(1, sizeof(sse_group_t));
+        if (group == NULL) {
+            free(client);
+            return NEU_ERR_EINTERNAL;
+        }
+        strcpy(group->driver, driver);
+        strcpy(group->group, group_name);
+
+        ret = send_subscribe(plugin, NEU_REQ_SUBSCRIBE_GROUP, driver,
+                             group_name);
+        if (ret != NEU_ERR_SUCCESS) {
+            free(group);
+            free(client);
+            return ret;
+        }
+        group->next = sse_groups;
+        sse_groups  = group;
+    } else if (group->tags != NULL) {
+        UT_array * tags = NULL;
+        sse_tag_t *tag  = NULL;
+        sse_tag_t *tmp  = NULL;
+
+        utarray_new(tags, neu_resp_tag_value_meta_icd());
+        HASH_ITER(hh, group->tags, tag, tmp)
+        {
+            if (tag->value.value.type != NEU_TYPE_PTR) {
+                utarray_push_back(tags, &tag->value);
+            }
+        }
+        if (encode_event(group, tags) == 0) {
+            send_event(stream, sse_json.buf, sse_json.len);
+        }
+        utarray_free(tags);
+    }
+
+    client->stream = stream;
+    client->ts     = neu_time_ms();
+    client->next   = group->clients;
+    group->clients = client;
+    return NEU_ERR_SUCCESS;
+}
+
+void handle_sse_subscribe(nng_aio *aio)
+{
+    neu_plugin_t *     plugin                    = neu_rest_get_plugin();
+    char               driver[NEU_NODE_NAME_LEN] = { 0 };
+    char               group[NEU_GROUP_NAME_LEN] = { 0 };
+    neu_rest_stream_t *stream                    = NULL;
+    ssize_t            ret                       = 0;
+    int                error                     = NEU_ERR_SUCCESS;
+
+    NEU_VALIDATE_JWT(aio);
+
+    ret = neu_http_get_param_str(aio, "node", driver, sizeof(driver));
+    if (ret <= 0 || (size_t) ret == sizeof(driver)) {
+        NEU_JSON_RESPONSE_ERROR(NEU_ERR_PARAM_IS_WRONG, {
+            neu_http_response(aio, error_code.error, result_error);
+        })
+        return;
+    }
+
+    ret = neu_http_get_param_str(aio, "group", group, sizeof(group));
+    if (ret <= 0 || (size_t) ret == sizeof(group)) {
+        NEU_JSON_RESPONSE_ERROR(NEU_ERR_PARAM_IS_WRONG, {
+            neu_http_response(aio, error_code.error, result_error);
+        })
+        return;
+    }
+
+    stream = neu_rest_stream_new(aio);
+    if (stream == NULL) {
+        NEU_JSON_RESPONSE_ERROR(NEU_ERR_EINTERNAL, {
+            neu_http_response(aio, error_code.error, result_error);
+        })
+        return;
+    }
+
+    nlog_notice("<%p> sse subscribe %s:%s", (void *) stream, driver, group);
+    neu_rest_stream_write(stream, SSE_HTTP_HEAD, strlen(SSE_HTTP_HEAD));
+
+    pthread_mutex_lock(&sse_mtx);
+    error = sse_add_client(plugin, driver, group, stream);
+    pthread_mutex_unlock(&sse_mtx);
+
+    if (error != NEU_ERR_SUCCESS) {
+        send_error(stream, error);
+        neu_rest_stream_close(stream);
+    }
+}
@@ -0,0 +1,209 @@
+/**
+ * NEURON IIoT System for Industry 4.0
+ * Copyright (C) 2020-2023 EMQ Technologies Co., Ltd All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ **/
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <nng/supplemental/http/http.h>
+
+#include "utils/http_handler.h"
+#include "utils/log.h"
+
+#include "stream.h"
+
+struct neu_rest_stream {
+    pthread_mutex_t mtx;
+    nng_http_conn * conn;
+    nng_aio *       aio;
+    char *          buf;  // data waiting for the connection
+    size_t          len;
+    size_t          cap;
+    char *          wbuf; // data being written
+    bool            writing;
+    bool            broken;
+    bool            closing;
+    bool            finished;
+
+    struct neu_rest_stream *next;
+};
+
+// a stream can not free its write aio from the aio's own callback, finished
+// streams are reclaimed here by the next new stream instead
+static pthread_mutex_t    streams_mtx = PTHREAD_MUTEX_INITIALIZER;
+static neu_rest_stream_t *streams     = NULL;
+
+static void stream_free(neu_rest_stream_t *stream)
+{
+    if (stream->aio != NULL) {
+        nng_aio_free(stream->aio);
+    }
+    pthread_mutex_destroy(&stream->mtx);
+    free(stream->buf);
+    free(stream->wbuf);
+    free(stream);
+}
+
+static void stream_reap()
+{
+    neu_rest_stream_t **pp = &streams;
+
+    while (*pp != NULL) {
+        neu_rest_stream_t *stream = *pp;
+
+        pthread_mutex_lock(&stream->mtx);
+        bool finished = stream->finished;
+        pthread_mutex_unlock(&stream->mtx);
+
+        if (finished) {
+            *pp = stream->next;
+            stream_free(stream);
+        } else {
+            pp = &stream->next;
+        }
+    }
+}
+
+static void stream_flush(neu_rest_stream_t *stream)
+{
+    nng_iov iov = { 0 };
+
+    if (stream->writing || stream->broken || stream->len == 0) {
+        return;
+    }
+
+    iov.iov_buf     = stream->buf;
+    iov.iov_len     = stream->len;
+    stream->wbuf    = stream->buf;
+    stream->buf     = NULL;
+    stream->len     = 0;
+    stream->cap     = 0;
+    stream->writing = true;
+
+    nng_aio_set_iov(stream->aio, 1, &iov);
+    nng_http_conn_write_all(stream->conn, stream->aio);
+}
+
+static void stream_try_finish(neu_rest_stream_t *stream)
+{
+    if (stream->closing && !stream->writing && !stream->finished) {
+        nng_http_conn_close(stream->conn);
+        stream->conn     = NULL;
+        stream->finished = true;
+    }
+}
+
+static void stream_write_cb(void *arg)
+{
+    neu_rest_stream_t *stream = (neu_rest_stream_t *) arg;
+
+    pthread_mutex_lock(&stream->mtx);
+    free(stream->wbuf);
+    stream->wbuf    = NULL;
+    stream->writing = false;
+    if (nng_aio_result(stream->aio) != 0) {
+        nlog_warn("<%p> stream connection lost", (void *) stream);
+        stream->broken = true;
+    }
+
+    stream_flush(stream);
+    stream_try_finish(stream);
+    pthread_mutex_unlock(&stream->mtx);
+}
+
+neu_rest_stream_t *neu_rest_stream_new(nng_aio *aio)
+{
+    nng_http_conn *    conn   = nng_aio_get_input(aio, 2);
+    neu_rest_stream_t *stream = calloc(1, sizeof(neu_rest_stream_t));
+    if (stream == NULL) {
+        return NULL;
+    }
+
+    pthread_mutex_init(&stream->mtx, NULL);
+    if (nng_aio_alloc(&stream->aio, stream_write_cb, stream) != 0 ||
+        nng_http_hijack(conn) != 0) {
+        stream_free(stream);
+        return NULL;
+    }
+
+    stream->conn = conn;
+    neu_http_handler_done(aio);
+    nng_aio_finish(aio, 0);
+
+    pthread_mutex_lock(&streams_mtx);
+    stream_reap();
+    stream->next = streams;
+    streams      = stream;
+    pthread_mutex_unlock(&streams_mtx);
+
+    return stream;
+}
+
+int neu_rest_stream_write(neu_rest_stream_t *stream, const char *data,
+                          size_t len)
+{
+    int ret = 0;
+
+    pthread_mutex_lock(&stream->mtx);
+    if (stream->broken) {
+        ret = -1;
+    } else if (stream->len + len > stream->cap) {
+        size_t cap = stream->cap > 0 ? stream->cap : 1024;
+        while (cap < stream->len + len) {
+            cap *= 2;
+        }
+
+        char *buf = realloc(stream->buf, cap);
+        if (buf == NULL) {
+            stream->broken = true;
+            ret            = -1;
+        } else {
+            stream->buf = buf;
+            stream->cap = cap;
+        }
+    }
+
+    if (ret == 0) {
+        memcpy(stream->buf + stream->len, data, len);
+        stream->len += len;
+        stream_flush(stream);
+    }
+    pthread_mutex_unlock(&stream->mtx);
+
+    return ret;
+}
+
+ssize_t neu_rest_stream_pending(neu_rest_stream_t *stream)
+{
+    ssize_t pending = 0;
+
+    pthread_mutex_lock(&stream->mtx);
+    pending = stream->broken ? -1 : (ssize_t) stream->len;
+    pthread_mutex_unlock(&stream->mtx);
+
+    return pending;
+}
+
+void neu_rest_stream_close(neu_rest_stream_t *stream)
+{
+    pthread_mutex_lock(&stream->mtx);
+    stream->closing = true;
+    stream_try_finish(stream);
+    pthread_mutex_unlock(&stream->mtx);
+}
@@ -0,0 +1,51 @@
+/**
+ * NEURON IIoT System for Industry 4.0
+ * Copyright (C) 2020-2023 EMQ Technologies Co., Ltd All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ **/
+
+#ifndef _NEU_PLUGIN_REST_STREAM_H_
+#define _NEU_PLUGIN_REST_STREAM_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+#include <nng/nng.h>
+
+// A response written straight to the connection of a request, for handlers
+// that answer over time instead of with one nng_http_res. The caller writes
+// the http head itself.
+typedef struct neu_rest_stream neu_rest_stream_t;
+
+// Take over the connection of handler `aio` and finish the aio.
+// Returns NULL on failure, the aio is then still the caller's to answer.
+neu_rest_stream_t *neu_rest_stream_new(nng_aio *aio);
+
+// Queue `data` behind what is being written, never blocks.
+// Returns -1 once the peer is gone, the stream still has to be closed.
+int neu_rest_stream_write(neu_rest_stream_t *stream, const char *data,
+                          size_t len);
+
+// Bytes queued behind the write in progress, for writers that pace
+// themselves to the peer. Returns -1 once the peer is gone.
+ssize_t neu_rest_stream_pending(neu_rest_stream_t *stream);
+
+// Close the connection once queued data is written, the stream is released
+// afterwards and must not be used again.
+void neu_rest_stream_close(neu_rest_stream_t *stream);
+
+#endif
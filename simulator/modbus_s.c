@@ -392,9 +392,9 @@ static void modbus_write(struct modbus_register *reg, uint8_t function,
         reg->hold_register[ntohs(address->start_address)].value = 0;
 
         reg->hold_register[ntohs(address->start_address)].value |=
-            *(uint8_t *) &((struct modbus_data *) &address->n_reg)[0] << 8;
+            ((uint8_t *) &address->n_reg)[0] << 8;
         reg->hold_register[ntohs(address->start_address)].value |=
-            *(uint8_t *) &((struct modbus_data *) &address->n_reg)[1];
+            ((uint8_t *) &address->n_reg)[1];
         break;
     case MODBUS_WRITE_M_HOLD_REG:
         for (int i = 0; i < data->n_byte; i++) {
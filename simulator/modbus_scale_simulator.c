@@ -0,0 +1,1086 @@
+/**
+ * NEURON IIoT System for Industry 4.0
+ * Copyright (C) 2020-2023 EMQ Technologies Co., Ltd All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ **/
+
+/*
+ * A modbus simulator for scale tests: many ports, each with many slave ids,
+ * served by several event threads, with configurable response delay, lost
+ * requests, exceptions and register changes. With --gateway, every port
+ * behaves like an RTU-over-TCP gateway in front of a serial bus, so requests
+ * to one port are answered one after another at the bus speed.
+ *
+ * With --pty, every port is a pseudo terminal instead, an RTU bus at --baud
+ * that the modbus rtu plugin opens as a serial device. Responses can be
+ * corrupted or cut short to test the serial framing, and the bus
+ * utilization, cycles per second and latency of every slave are reported,
+ * to benchmark the serial path without hardware.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "neuron.h"
+
+zlog_category_t *neuron = NULL;
+
+#define FRAME_MAX 260
+
+struct options {
+    bool     rtu;
+    bool     pty;
+    char *   ip;
+    uint16_t port;
+    int      n_port;
+    int      n_slave;
+    int      n_register;
+    int      n_thread;
+    int      rtt;
+    int      jitter;
+    double   timeout_rate;
+    double   exception_rate;
+    double   crc_rate;
+    double   partial_rate;
+    int      change_rate;
+    int      gateway;
+    int      stats;
+};
+
+// one slave id behind one port
+struct device {
+    pthread_mutex_t mtx;
+    int64_t         changed; // time in ms register changes are applied up to
+    uint8_t *       coil;
+    uint8_t *       input;
+    uint16_t *      hold_register;
+    uint16_t *      input_register;
+    uint64_t        n_answer;
+    uint64_t        latency_sum; // ms from request to response sent
+    int64_t         latency_max;
+};
+
+struct worker;
+
+struct conn;
+
+struct port {
+    uint16_t        port;
+    int             fd;
+    neu_event_io_t *io;
+    struct worker * worker;
+    pthread_mutex_t mtx;
+    int64_t         bus_free; // time in ms the gateway serial bus is idle at
+    int64_t         bus_busy; // ms the bus carried frames in total
+    struct device * devices;
+    // with --pty, the terminal is served through a single connection, the
+    // slave side is kept open so that the master never hangs up
+    char         tty[64];
+    int          tty_fd;
+    struct conn *conn;
+};
+
+struct conn {
+    int             fd;
+    neu_event_io_t *io;
+    struct worker * worker;
+    struct port *   port;
+    bool            closed;
+    int             n_pending;
+    int64_t         last_due;
+    uint16_t        len;
+    uint8_t         buf[4 * FRAME_MAX];
+};
+
+// a response waiting for its due time
+struct pending {
+    int64_t      due;
+    struct conn *conn;
+    uint16_t     len;
+    uint8_t      buf[FRAME_MAX];
+};
+
+struct worker {
+    neu_events_t *     events;
+    neu_event_timer_t *timer;
+    unsigned int       seed;
+    uint32_t           n_pending;
+    uint32_t           cap;
+    struct pending **  heap; // min heap on due
+};
+
+static struct {
+    uint64_t conn;
+    uint64_t request;
+    uint64_t response;
+    uint64_t timeout;
+    uint64_t exception;
+    uint64_t crc;
+    uint64_t partial;
+    uint64_t error;
+} stats = { 0 };
+
+static struct options opts = {
+    .rtu            = false,
+    .pty            = false,
+    .ip             = "0.0.0.0",
+    .port           = 1502,
+    .n_port         = 1,
+    .n_slave        = 1,
+    .n_register     = 10000,
+    .n_thread       = 4,
+    .rtt            = 0,
+    .jitter         = 0,
+    .timeout_rate   = 0,
+    .exception_rate = 0,
+    .crc_rate       = 0,
+    .partial_rate   = 0,
+    .change_rate    = 0,
+    .gateway        = 0,
+    .stats          = 10,
+};
+
+static struct port *  ports     = NULL;
+static struct worker *workers   = NULL;
+static volatile bool  exiting   = false;
+static uint32_t       next_conn = 0;
+
+static inline uint16_t get16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] << 8 | p[1]);
+}
+
+static inline void put16(uint8_t *p, uint16_t v)
+{
+    p[0] = v >> 8;
+    p[1] = v & 0xff;
+}
+
+static uint16_t crc16(const uint8_t *p, int len)
+{
+    uint16_t crc = 0xffff;
+
+    for (int i = 0; i < len; i++) {
+        crc ^= p[i];
+        for (int k = 0; k < 8; k++) {
+            crc = crc & 1 ? (crc >> 1) ^ 0xa001 : crc >> 1;
+        }
+    }
+
+    return crc;
+}
+
+static bool chance(struct worker *w, double percent)
+{
+    return percent > 0 && rand_r(&w->seed) % 10000 < percent * 100;
+}
+
+static void heap_push(struct worker *w, struct pending *p)
+{
+    if (w->n_pending == w->cap) {
+        w->cap  = w->cap == 0 ? 64 : w->cap * 2;
+        w->heap = realloc(w->heap, w->cap * sizeof(struct pending *));
+    }
+
+    uint32_t i = w->n_pending++;
+    while (i > 0 && w->heap[(i - 1) / 2]->due > p->due) {
+        w->heap[i] = w->heap[(i - 1) / 2];
+        i          = (i - 1) / 2;
+    }
+    w->heap[i] = p;
+}
+
+static struct pending *heap_pop(struct worker *w)
+{
+    struct pending *top  = w->heap[0];
+    struct pending *last = w->heap[--w->n_pending];
+    uint32_t        i    = 0;
+
+    while (2 * i + 1 < w->n_pending) {
+        uint32_t c = 2 * i + 1;
+        if (c + 1 < w->n_pending && w->heap[c + 1]->due < w->heap[c]->due) {
+            c += 1;
+        }
+        if (last->due <= w->heap[c]->due) {
+            break;
+        }
+        w->heap[i] = w->heap[c];
+        i          = c;
+    }
+    if (w->n_pending > 0) {
+        w->heap[i] = last;
+    }
+
+    return top;
+}
+
+// apply the register changes due since the last access, at change_rate
+// registers per second, called with the device locked
+static void device_change(struct worker *w, struct device *dev, int64_t now)
+{
+    int64_t n = (now - dev->changed) * opts.change_rate / 1000;
+
+    if (n <= 0) {
+        return;
+    }
+
+    dev->changed += n * 1000 / opts.change_rate;
+    if (n > opts.n_register) {
+        n = opts.n_register;
+    }
+    for (int64_t i = 0; i < n; i++) {
+        int k = rand_r(&w->seed) % opts.n_register;
+
+        dev->hold_register[k] += 1;
+        dev->input_register[k] += 1;
+        dev->coil[k] ^= 1;
+        dev->input[k] ^= 1;
+    }
+}
+
+static int exception(const uint8_t *pdu, uint8_t code, uint8_t *res)
+{
+    res[0] = pdu[0] | 0x80;
+    res[1] = code;
+    return 2;
+}
+
+// serve one request pdu, returns the length of the response pdu
+static int device_serve(struct worker *w, struct device *dev,
+                        const uint8_t *pdu, int len, uint8_t *res)
+{
+    uint16_t address = len >= 5 ? get16(pdu + 1) : 0;
+    uint16_t n       = len >= 5 ? get16(pdu + 3) : 0;
+    int      ret     = 0;
+
+    if (len < 5) {
+        return exception(pdu, 0x03, res);
+    }
+
+    pthread_mutex_lock(&dev->mtx);
+    if (opts.change_rate > 0) {
+        device_change(w, dev, neu_time_ms());
+    }
+
+    switch (pdu[0]) {
+    case 0x01:
+    case 0x02: {
+        const uint8_t *bits = pdu[0] == 0x01 ? dev->coil : dev->input;
+
+        if (n == 0 || n > 2000) {
+            ret = exception(pdu, 0x03, res);
+            break;
+        }
+        if (address + n > opts.n_register) {
+            ret = exception(pdu, 0x02, res);
+            break;
+        }
+        res[0] = pdu[0];
+        res[1] = (n + 7) / 8;
+        memset(res + 2, 0, res[1]);
+        for (int i = 0; i < n; i++) {
+            res[2 + i / 8] |= bits[address + i] << (i % 8);
+        }
+        ret = 2 + res[1];
+        break;
+    }
+    case 0x03:
+    case 0x04: {
+        const uint16_t *regs =
+            pdu[0] == 0x03 ? dev->hold_register : dev->input_register;
+
+        if (n == 0 || n > 125) {
+            ret = exception(pdu, 0x03, res);
+            break;
+        }
+        if (address + n > opts.n_register) {
+            ret = exception(pdu, 0x02, res);
+            break;
+        }
+        res[0] = pdu[0];
+        res[1] = n * 2;
+        for (int i = 0; i < n; i++) {
+            put16(res + 2 + i * 2, regs[address + i]);
+        }
+        ret = 2 + res[1];
+        break;
+    }
+    case 0x05:
+    case 0x06:
+        if (address >= opts.n_register) {
+            ret = exception(pdu, 0x02, res);
+            break;
+        }
+        if (pdu[0] == 0x05) {
+            dev->coil[address] = n == 0xff00;
+        } else {
+            dev->hold_register[address] = n;
+        }
+        memcpy(res, pdu, 5);
+        ret = 5;
+        break;
+    case 0x0f:
+    case 0x10:
+        if (len < 6 || len < 6 + pdu[5] || n == 0 ||
+            pdu[5] != (pdu[0] == 0x0f ? (n + 7) / 8 : n * 2)) {
+            ret = exception(pdu, 0x03, res);
+            break;
+        }
+        if (address + n > opts.n_register) {
+            ret = exception(pdu, 0x02, res);
+            break;
+        }
+        for (int i = 0; i < n; i++) {
+            if (pdu[0] == 0x0f) {
+                dev->coil[address + i] = (pdu[6 + i / 8] >> (i % 8)) & 1;
+            } else {
+                dev->hold_register[address + i] = get16(pdu + 6 + i * 2);
+            }
+        }
+        memcpy(res, pdu, 5);
+        ret = 5;
+        break;
+    default:
+        ret = exception(pdu, 0x01, res);
+        break;
+    }
+    pthread_mutex_unlock(&dev->mtx);
+
+    if (res[0] & 0x80) {
+        __atomic_add_fetch(&stats.exception, 1, __ATOMIC_RELAXED);
+    }
+
+    return ret;
+}
+
+static void conn_free(struct conn *conn)
+{
+    if (!conn->closed) {
+        conn->closed = true;
+        neu_event_del_io(conn->worker->events, conn->io);
+        close(conn->fd);
+        __atomic_sub_fetch(&stats.conn, 1, __ATOMIC_RELAXED);
+        if (conn->port->conn == conn) {
+            conn->port->conn = NULL;
+        }
+    }
+    if (conn->n_pending == 0) {
+        free(conn);
+    }
+}
+
+static void conn_send(struct conn *conn, const uint8_t *buf, uint16_t len)
+{
+    ssize_t n = opts.pty ? write(conn->fd, buf, len)
+                         : send(conn->fd, buf, len, MSG_NOSIGNAL);
+
+    if (n != len) {
+        __atomic_add_fetch(&stats.error, 1, __ATOMIC_RELAXED);
+    } else {
+        __atomic_add_fetch(&stats.response, 1, __ATOMIC_RELAXED);
+    }
+}
+
+// time in ms a request and its response take on the gateway serial bus,
+// 11 bits per byte
+static int64_t bus_time(int req_len, int res_len)
+{
+    return ((int64_t)(req_len + res_len) * 11 * 1000 + opts.gateway - 1) /
+        opts.gateway;
+}
+
+// queue the response, returns the ms it is due in
+static int64_t schedule(struct conn *conn, int req_len, const uint8_t *res,
+                        uint16_t res_len)
+{
+    struct worker *w   = conn->worker;
+    int64_t        now = neu_time_ms();
+    int64_t        due = now + opts.rtt;
+
+    if (opts.jitter > 0) {
+        due += rand_r(&w->seed) % (opts.jitter + 1);
+    }
+
+    if (opts.gateway > 0) {
+        int64_t start = 0;
+
+        pthread_mutex_lock(&conn->port->mtx);
+        start = conn->port->bus_free > now ? conn->port->bus_free : now;
+        conn->port->bus_free = start + bus_time(req_len, res_len);
+        conn->port->bus_busy += bus_time(req_len, res_len);
+        pthread_mutex_unlock(&conn->port->mtx);
+
+        due += start + bus_time(req_len, res_len) - now;
+    }
+
+    // answer the requests of one connection in order
+    if (due < conn->last_due) {
+        due = conn->last_due;
+    }
+    conn->last_due = due;
+
+    if (due <= now && w->n_pending == 0) {
+        conn_send(conn, res, res_len);
+        return 0;
+    }
+
+    struct pending *p = calloc(1, sizeof(struct pending));
+
+    p->due  = due;
+    p->conn = conn;
+    p->len  = res_len;
+    memcpy(p->buf, res, res_len);
+    conn->n_pending += 1;
+    heap_push(w, p);
+    return due - now;
+}
+
+static void latency_add(struct port *port, uint8_t slave, int64_t latency)
+{
+    struct device *dev = NULL;
+
+    if (slave == 0 || slave > opts.n_slave) {
+        return;
+    }
+
+    dev = &port->devices[slave - 1];
+    pthread_mutex_lock(&dev->mtx);
+    dev->n_answer += 1;
+    dev->latency_sum += latency;
+    if (latency > dev->latency_max) {
+        dev->latency_max = latency;
+    }
+    pthread_mutex_unlock(&dev->mtx);
+}
+
+// serve one request of slave to res, returns the response length, 0 if the
+// request is not answered
+static int serve(struct conn *conn, uint8_t slave, const uint8_t *pdu,
+                 int pdu_len, uint8_t *res)
+{
+    struct worker *w = conn->worker;
+
+    __atomic_add_fetch(&stats.request, 1, __ATOMIC_RELAXED);
+
+    if (slave == 0 || slave > opts.n_slave) {
+        // an RTU device that does not exist stays silent, a TCP gateway
+        // reports the missing target
+        if (opts.rtu) {
+            __atomic_add_fetch(&stats.timeout, 1, __ATOMIC_RELAXED);
+            return 0;
+        }
+        __atomic_add_fetch(&stats.exception, 1, __ATOMIC_RELAXED);
+        return exception(pdu, 0x0b, res);
+    }
+
+    if (chance(w, opts.timeout_rate)) {
+        __atomic_add_fetch(&stats.timeout, 1, __ATOMIC_RELAXED);
+        return 0;
+    }
+
+    if (chance(w, opts.exception_rate)) {
+        __atomic_add_fetch(&stats.exception, 1, __ATOMIC_RELAXED);
+        return exception(pdu, 0x04, res);
+    }
+
+    return device_serve(w, &conn->port->devices[slave - 1], pdu, pdu_len, res);
+}
+
+// parse one tcp frame from buf, returns the bytes used, 0 if incomplete,
+// -1 on a broken stream
+static int tcp_frame(struct conn *conn, const uint8_t *buf, uint16_t len)
+{
+    uint8_t  res[FRAME_MAX] = { 0 };
+    uint16_t n              = 0;
+    int      res_len        = 0;
+
+    if (len < 8) {
+        return 0;
+    }
+
+    n = get16(buf + 4);
+    if (get16(buf + 2) != 0 || n < 2 || n > FRAME_MAX - 6) {
+        return -1;
+    }
+    if (len < 6 + n) {
+        return 0;
+    }
+
+    res_len = serve(conn, buf[6], buf + 7, n - 1, res + 7);
+    if (res_len > 0) {
+        memcpy(res, buf, 4);
+        put16(res + 4, res_len + 1);
+        res[6] = buf[6];
+        latency_add(conn->port, buf[6],
+                    schedule(conn, 6 + n, res, 7 + res_len));
+    }
+
+    return 6 + n;
+}
+
+// the length of the rtu request frame in buf, 0 if not known yet
+static int rtu_frame_len(const uint8_t *buf, uint16_t len)
+{
+    if (len < 2) {
+        return 0;
+    }
+
+    switch (buf[1]) {
+    case 0x01:
+    case 0x02:
+    case 0x03:
+    case 0x04:
+    case 0x05:
+    case 0x06:
+        return 8;
+    case 0x0f:
+    case 0x10:
+        return len < 7 ? 0 : 9 + buf[6];
+    default:
+        return -1;
+    }
+}
+
+static int rtu_frame(struct conn *conn, const uint8_t *buf, uint16_t len)
+{
+    struct worker *w              = conn->worker;
+    uint8_t        res[FRAME_MAX] = { 0 };
+    int            n              = rtu_frame_len(buf, len);
+    int            res_len        = 0;
+
+    if (n <= 0 || len < n) {
+        return n;
+    }
+
+    if (crc16(buf, n - 2) != (buf[n - 2] | buf[n - 1] << 8)) {
+        __atomic_add_fetch(&stats.error, 1, __ATOMIC_RELAXED);
+        return n;
+    }
+
+    res_len = serve(conn, buf[0], buf + 1, n - 3, res + 1);
+    if (res_len > 0) {
+        uint16_t crc = 0;
+
+        res[0]           = buf[0];
+        crc              = crc16(res, 1 + res_len);
+        res[1 + res_len] = crc & 0xff;
+        res[2 + res_len] = crc >> 8;
+        res_len += 3;
+
+        if (chance(w, opts.crc_rate)) {
+            __atomic_add_fetch(&stats.crc, 1, __ATOMIC_RELAXED);
+            res[res_len - 1] ^= 0xff;
+        } else if (chance(w, opts.partial_rate)) {
+            // the rest of the frame is lost, the master has to time out
+            __atomic_add_fetch(&stats.partial, 1, __ATOMIC_RELAXED);
+            res_len /= 2;
+        }
+        latency_add(conn->port, buf[0], schedule(conn, n, res, res_len));
+    }
+
+    return n;
+}
+
+static int conn_recv(enum neu_event_io_type type, int fd, void *usr_data)
+{
+    struct conn *conn = (struct conn *) usr_data;
+    ssize_t      len  = 0;
+    int          used = 0;
+
+    (void) fd;
+    if (type != NEU_EVENT_IO_READ) {
+        conn_free(conn);
+        return 0;
+    }
+
+    len = read(conn->fd, conn->buf + conn->len, sizeof(conn->buf) - conn->len);
+    if (len <= 0 && opts.pty) {
+        return 0;
+    }
+    if (len <= 0) {
+        conn_free(conn);
+        return 0;
+    }
+    conn->len += len;
+
+    // serve every complete request, clients may pipeline
+    while (used < conn->len) {
+        int n = opts.rtu ? rtu_frame(conn, conn->buf + used, conn->len - used)
+                         : tcp_frame(conn, conn->buf + used, conn->len - used);
+        if (n < 0 && opts.pty) {
+            // a terminal is never closed, the noise on the bus is dropped
+            __atomic_add_fetch(&stats.error, 1, __ATOMIC_RELAXED);
+            used = conn->len;
+            break;
+        }
+        if (n < 0) {
+            __atomic_add_fetch(&stats.error, 1, __ATOMIC_RELAXED);
+            conn_free(conn);
+            return 0;
+        }
+        if (n == 0) {
+            break;
+        }
+        used += n;
+    }
+
+    memmove(conn->buf, conn->buf + used, conn->len - used);
+    conn->len -= used;
+
+    return 0;
+}
+
+static int port_accept(enum neu_event_io_type type, int fd, void *usr_data)
+{
+    struct port *port = (struct port *) usr_data;
+    int          one  = 1;
+
+    if (type != NEU_EVENT_IO_READ) {
+        return 0;
+    }
+
+    int client = accept(fd, NULL, NULL);
+    if (client < 0) {
+        return 0;
+    }
+    setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    // spread the connections of every port over the workers
+    struct conn *conn = calloc(1, sizeof(struct conn));
+    uint32_t     i    = __atomic_fetch_add(&next_conn, 1, __ATOMIC_RELAXED);
+
+    conn->fd     = client;
+    conn->port   = port;
+    conn->worker = &workers[i % opts.n_thread];
+
+    neu_event_io_param_t io = {
+        .fd       = client,
+        .usr_data = conn,
+        .cb       = conn_recv,
+    };
+    conn->io = neu_event_add_io(conn->worker->events, io);
+    __atomic_add_fetch(&stats.conn, 1, __ATOMIC_RELAXED);
+
+    return 0;
+}
+
+static int worker_flush(void *usr_data)
+{
+    struct worker *w   = (struct worker *) usr_data;
+    int64_t        now = neu_time_ms();
+
+    while (w->n_pending > 0 && w->heap[0]->due <= now) {
+        struct pending *p    = heap_pop(w);
+        struct conn *   conn = p->conn;
+
+        conn->n_pending -= 1;
+        if (!conn->closed) {
+            conn_send(conn, p->buf, p->len);
+        } else if (conn->n_pending == 0) {
+            free(conn);
+        }
+        free(p);
+    }
+
+    return 0;
+}
+
+static int port_listen(struct port *port)
+{
+    struct sockaddr_in addr = { 0 };
+    int                one  = 1;
+
+    port->fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (port->fd < 0) {
+        return -1;
+    }
+
+    addr.sin_family      = AF_INET;
+    addr.sin_port        = htons(port->port);
+    addr.sin_addr.s_addr = inet_addr(opts.ip);
+    setsockopt(port->fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (bind(port->fd, (struct sockaddr *) &addr, sizeof(addr)) != 0 ||
+        listen(port->fd, 1024) != 0) {
+        close(port->fd);
+        return -1;
+    }
+
+    neu_event_io_param_t io = {
+        .fd       = port->fd,
+        .usr_data = port,
+        .cb       = port_accept,
+    };
+    port->io = neu_event_add_io(port->worker->events, io);
+
+    return 0;
+}
+
+static int port_pty(struct port *port)
+{
+    struct termios tio  = { 0 };
+    struct conn *  conn = NULL;
+    const char *   name = NULL;
+
+    port->fd = posix_openpt(O_RDWR | O_NOCTTY);
+    if (port->fd < 0 || grantpt(port->fd) != 0 || unlockpt(port->fd) != 0 ||
+        (name = ptsname(port->fd)) == NULL) {
+        return -1;
+    }
+    strncpy(port->tty, name, sizeof(port->tty) - 1);
+
+    port->tty_fd = open(port->tty, O_RDWR | O_NOCTTY);
+    if (port->tty_fd < 0 || tcgetattr(port->tty_fd, &tio) != 0) {
+        return -1;
+    }
+    cfmakeraw(&tio);
+    tcsetattr(port->tty_fd, TCSANOW, &tio);
+
+    conn         = calloc(1, sizeof(struct conn));
+    conn->fd     = port->fd;
+    conn->port   = port;
+    conn->worker = port->worker;
+    port->conn   = conn;
+
+    neu_event_io_param_t io = {
+        .fd       = port->fd,
+        .usr_data = conn,
+        .cb       = conn_recv,
+    };
+    conn->io = neu_event_add_io(conn->worker->events, io);
+    __atomic_add_fetch(&stats.conn, 1, __ATOMIC_RELAXED);
+
+    return 0;
+}
+
+static void devices_init(struct port *port, int64_t now)
+{
+    port->devices = calloc(opts.n_slave, sizeof(struct device));
+    for (int i = 0; i < opts.n_slave; i++) {
+        struct device *dev = &port->devices[i];
+
+        pthread_mutex_init(&dev->mtx, NULL);
+        dev->changed        = now;
+        dev->coil           = calloc(opts.n_register, sizeof(uint8_t));
+        dev->input          = calloc(opts.n_register, sizeof(uint8_t));
+        dev->hold_register  = calloc(opts.n_register, sizeof(uint16_t));
+        dev->input_register = calloc(opts.n_register, sizeof(uint16_t));
+    }
+}
+
+static void sig_handler(int sig)
+{
+    (void) sig;
+    exiting = true;
+}
+
+static void stats_print(void)
+{
+    printf("conn: %" PRIu64 ", request: %" PRIu64 ", response: %" PRIu64
+           ", timeout: %" PRIu64 ", exception: %" PRIu64 ", crc: %" PRIu64
+           ", partial: %" PRIu64 ", error: %" PRIu64 "\n",
+           __atomic_load_n(&stats.conn, __ATOMIC_RELAXED),
+           __atomic_load_n(&stats.request, __ATOMIC_RELAXED),
+           __atomic_load_n(&stats.response, __ATOMIC_RELAXED),
+           __atomic_load_n(&stats.timeout, __ATOMIC_RELAXED),
+           __atomic_load_n(&stats.exception, __ATOMIC_RELAXED),
+           __atomic_load_n(&stats.crc, __ATOMIC_RELAXED),
+           __atomic_load_n(&stats.partial, __ATOMIC_RELAXED),
+           __atomic_load_n(&stats.error, __ATOMIC_RELAXED));
+}
+
+// the bus of every port and the slaves behind it over the whole run
+static void summary_print(int64_t elapsed)
+{
+    uint64_t cycles = __atomic_load_n(&stats.response, __ATOMIC_RELAXED);
+
+    elapsed = elapsed > 0 ? elapsed : 1;
+    printf("cycles: %" PRIu64 ", %.1f/s\n", cycles,
+           cycles * 1000.0 / elapsed);
+
+    for (int i = 0; i < opts.n_port; i++) {
+        struct port *port = &ports[i];
+
+        if (opts.gateway > 0) {
+            pthread_mutex_lock(&port->mtx);
+            printf("port %d bus utilization: %.1f%%\n", i,
+                   port->bus_busy * 100.0 / elapsed);
+            pthread_mutex_unlock(&port->mtx);
+        }
+
+        for (int k = 0; k < opts.n_slave; k++) {
+            struct device *dev = &port->devices[k];
+
+            pthread_mutex_lock(&dev->mtx);
+            printf("port %d slave %d latency: answers %" PRIu64
+                   ", avg %.1f ms, max %" PRId64 " ms\n",
+                   i, k + 1, dev->n_answer,
+                   dev->n_answer ? (double) dev->latency_sum / dev->n_answer
+                                 : 0.0,
+                   dev->latency_max);
+            pthread_mutex_unlock(&dev->mtx);
+        }
+    }
+}
+
+static void usage(const char *name)
+{
+    printf("%s [options]\n"
+           "  --rtu                 RTU frames over TCP instead of modbus "
+           "TCP\n"
+           "  --pty                 RTU buses on pseudo terminals, one per "
+           "port\n"
+           "  --baud BAUD           bus speed of --pty, default 9600\n"
+           "  --ip IP               listen address, default 0.0.0.0\n"
+           "  --port PORT           first port, default 1502\n"
+           "  --ports N             number of consecutive ports, default 1\n"
+           "  --slaves N            slave ids 1 to N on every port, "
+           "default 1\n"
+           "  --registers N         registers of every area, default 10000\n"
+           "  --threads N           event threads, default 4\n"
+           "  --rtt MS              response delay\n"
+           "  --jitter MS           extra random response delay, up to MS\n"
+           "  --timeout-rate PCT    requests left unanswered\n"
+           "  --exception-rate PCT  requests answered with an exception\n"
+           "  --crc-rate PCT        rtu responses sent with a bad crc\n"
+           "  --partial-rate PCT    rtu responses cut short\n"
+           "  --change-rate N       register changes per second per slave\n"
+           "  --gateway BAUD        serialize every port on a bus of BAUD\n"
+           "  --stats SEC           statistics interval, default 10\n",
+           name);
+}
+
+static int parse_args(int argc, char *argv[])
+{
+    struct option long_options[] = {
+        { "rtu", no_argument, NULL, 'r' },
+        { "pty", no_argument, NULL, 'y' },
+        { "baud", required_argument, NULL, 'b' },
+        { "ip", required_argument, NULL, 'i' },
+        { "port", required_argument, NULL, 'p' },
+        { "ports", required_argument, NULL, 'P' },
+        { "slaves", required_argument, NULL, 's' },
+        { "registers", required_argument, NULL, 'R' },
+        { "threads", required_argument, NULL, 't' },
+        { "rtt", required_argument, NULL, 'd' },
+        { "jitter", required_argument, NULL, 'j' },
+        { "timeout-rate", required_argument, NULL, 'T' },
+        { "exception-rate", required_argument, NULL, 'E' },
+        { "crc-rate", required_argument, NULL, 'C' },
+        { "partial-rate", required_argument, NULL, 'Q' },
+        { "change-rate", required_argument, NULL, 'c' },
+        { "gateway", required_argument, NULL, 'g' },
+        { "stats", required_argument, NULL, 'S' },
+        { "help", no_argument, NULL, 'h' },
+        { NULL, 0, NULL, 0 },
+    };
+    int c = 0;
+
+    while ((c = getopt_long(argc, argv, "h", long_options, NULL)) != -1) {
+        switch (c) {
+        case 'r':
+            opts.rtu = true;
+            break;
+        case 'y':
+            opts.pty = true;
+            break;
+        case 'b':
+            opts.gateway = atoi(optarg);
+            break;
+        case 'i':
+            opts.ip = optarg;
+            break;
+        case 'p':
+            opts.port = atoi(optarg);
+            break;
+        case 'P':
+            opts.n_port = atoi(optarg);
+            break;
+        case 's':
+            opts.n_slave = atoi(optarg);
+            break;
+        case 'R':
+            opts.n_register = atoi(optarg);
+            break;
+        case 't':
+            opts.n_thread = atoi(optarg);
+            break;
+        case 'd':
+            opts.rtt = atoi(optarg);
+            break;
+        case 'j':
+            opts.jitter = atoi(optarg);
+            break;
+        case 'T':
+            opts.timeout_rate = atof(optarg);
+            break;
+        case 'E':
+            opts.exception_rate = atof(optarg);
+            break;
+        case 'C':
+            opts.crc_rate = atof(optarg);
+            break;
+        case 'Q':
+            opts.partial_rate = atof(optarg);
+            break;
+        case 'c':
+            opts.change_rate = atoi(optarg);
+            break;
+        case 'g':
+            opts.gateway = atoi(optarg);
+            break;
+        case 'S':
+            opts.stats = atoi(optarg);
+            break;
+        default:
+            usage(argv[0]);
+            return -1;
+        }
+    }
+
+    // a pty is a serial bus, --baud defaults to 9600
+    if (opts.pty) {
+        opts.rtu     = true;
+        opts.gateway = opts.gateway > 0 ? opts.gateway : 9600;
+    }
+
+    if (opts.port <= 1024 || opts.n_port <= 0 ||
+        opts.port + opts.n_port > 65536) {
+        printf("ports must be within 1025 to 65535\n");
+        return -1;
+    }
+    if (opts.n_slave <= 0 || opts.n_slave > 247) {
+        printf("slaves must be within 1 to 247\n");
+        return -1;
+    }
+    if (opts.n_register <= 0 || opts.n_register > 65536 ||
+        opts.n_thread <= 0 || opts.rtt < 0 || opts.jitter < 0 ||
+        opts.change_rate < 0 || opts.gateway < 0 || opts.stats <= 0) {
+        usage(argv[0]);
+        return -1;
+    }
+
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    int64_t now = 0;
+
+    if (parse_args(argc, argv) != 0) {
+        return -1;
+    }
+
+    zlog_init("./config/dev.conf");
+    neuron = zlog_get_category("neuron");
+
+    workers = calloc(opts.n_thread, sizeof(struct worker));
+    for (int i = 0; i < opts.n_thread; i++) {
+        neu_event_timer_param_t param = {
+            .second      = 0,
+            .millisecond = 1,
+            .usr_data    = &workers[i],
+            .cb          = worker_flush,
+            .type        = NEU_EVENT_TIMER_NOBLOCK,
+        };
+
+        workers[i].seed   = (unsigned int) i + 1;
+        workers[i].events = neu_event_new();
+        workers[i].timer  = neu_event_add_timer(workers[i].events, param);
+    }
+
+    now   = neu_time_ms();
+    ports = calloc(opts.n_port, sizeof(struct port));
+    for (int i = 0; i < opts.n_port; i++) {
+        ports[i].port   = opts.port + i;
+        ports[i].worker = &workers[i % opts.n_thread];
+        pthread_mutex_init(&ports[i].mtx, NULL);
+        devices_init(&ports[i], now);
+
+        if (opts.pty) {
+            if (port_pty(&ports[i]) != 0) {
+                printf("open pty fail, %s\n", strerror(errno));
+                return -1;
+            }
+            // one line per bus for the scripts driving the simulator
+            printf("pty: %s\n", ports[i].tty);
+        } else if (port_listen(&ports[i]) != 0) {
+            printf("listen on %s:%u fail, %s\n", opts.ip, ports[i].port,
+                   strerror(errno));
+            return -1;
+        }
+    }
+
+    if (opts.pty) {
+        printf("rtu on %d pty, %d slaves, %d baud, %d threads\n",
+               opts.n_port, opts.n_slave, opts.gateway, opts.n_thread);
+    } else {
+        printf("%s on %s:%u-%u, %d slaves, %d threads\n",
+               opts.rtu ? "rtu over tcp" : "modbus tcp", opts.ip, opts.port,
+               opts.port + opts.n_port - 1, opts.n_slave, opts.n_thread);
+    }
+    fflush(stdout);
+
+    signal(SIGINT, sig_handler);
+    signal(SIGTERM, sig_handler);
+
+    for (int tick = 1; !exiting; tick++) {
+        sleep(1);
+        if (tick % opts.stats == 0) {
+            stats_print();
+            fflush(stdout);
+        }
+    }
+
+    stats_print();
+    summary_print(neu_time_ms() - now);
+    fflush(stdout);
+
+    for (int i = 0; i < opts.n_port; i++) {
+        if (opts.pty) {
+            if (ports[i].conn != NULL) {
+                conn_free(ports[i].conn);
+            }
+            close(ports[i].tty_fd);
+            continue;
+        }
+        neu_event_del_io(ports[i].worker->events, ports[i].io);
+        close(ports[i].fd);
+    }
+    for (int i = 0; i < opts.n_thread; i++) {
+        neu_event_del_timer(workers[i].events, workers[i].timer);
+        neu_event_close(workers[i].events);
+    }
+
+    return 0;
+}
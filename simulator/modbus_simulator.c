@@ -226,6 +226,8 @@ static int new_client(enum neu_event_io_type type, int fd, void *usr_data)
         close(fd);
         break;
     }
+    case NEU_EVENT_IO_WRITE:
+        break;
     }
     return 0;
 }
@@ -300,6 +302,8 @@ static int recv_msg(enum neu_event_io_type type, int fd, void *usr_data)
         neu_conn_tcp_server_close_client(conn, fd);
         break;
     }
+    case NEU_EVENT_IO_WRITE:
+        break;
     }
 
     return 0;
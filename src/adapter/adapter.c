@@ -17,11 +17,16 @@
  * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
  **/
 
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
 #include <assert.h>
 #include <dlfcn.h>
 #include <errno.h>
 #include <inttypes.h>
 #include <pthread.h>
+#include <sched.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -29,20 +34,51 @@
 #include <sys/un.h>
 #include <unistd.h>
 
+#include "utils/capture.h"
+#include "utils/hash.h"
 #include "utils/log.h"
+#include "utils/mem_budget.h"
+#include "utils/profile.h"
+#include "utils/time.h"
 
 #include "adapter.h"
 #include "adapter_internal.h"
 #include "base/msg_internal.h"
+#include "core/node_manager.h"
 #include "driver/driver_internal.h"
 #include "errcodes.h"
+#include "json/neu_json_param.h"
 #include "persist/persist.h"
 #include "plugin.h"
 #include "storage.h"
 
+// where and how the setting of a node asks its threads to run
+typedef struct {
+    bool       pinned;
+    bool       automatic;
+    neu_cpus_t cpus;
+    int        policy; // of the driver loops
+    int        priority;
+} adapter_place_t;
+
+// how often a node accounts its memory against the budget
+#define ADAPTER_MEM_INTERVAL_MS 1000
+
 static void *adapter_consumer(void *arg);
+static void  adapter_reload(neu_adapter_t *adapter, void *handle,
+                            neu_plugin_module_t *module);
 static int   adapter_trans_data(enum neu_event_io_type type, int fd,
                                 void *usr_data);
+static int   adapter_driver_data(enum neu_event_io_type type, int fd,
+                                 void *usr_data);
+static int   adapter_reply(enum neu_event_io_type type, int fd, void *usr_data);
+static int   adapter_socket(int *fd);
+static uint16_t adapter_bind_lane(neu_adapter_t *adapter, int fd,
+                                  neu_event_io_callback cb,
+                                  neu_event_io_t **     io,
+                                  neu_event_io_t **     bus_io);
+static bool  adapter_send_direct(neu_adapter_t *     adapter,
+                                 neu_reqresp_head_t *header);
 static int   adapter_loop(enum neu_event_io_type type, int fd, void *usr_data);
 static int   adapter_command(neu_adapter_t *adapter, neu_reqresp_head_t header,
                              void *data);
@@ -57,6 +93,17 @@ static int adapter_register_metric(neu_adapter_t *adapter, const char *name,
 static int adapter_update_metric(neu_adapter_t *adapter,
                                  const char *metric_name, uint64_t n,
                                  const char *group);
+static void adapter_sample_metrics(neu_adapter_t *adapter);
+static int  adapter_parse_place(const char *setting, adapter_place_t *place);
+static int  adapter_parse_mem_limit(const char *setting, size_t *limit);
+static int  adapter_parse_retentions(neu_adapter_t *              adapter,
+                                     const char *                 setting,
+                                     neu_json_cache_retentions_t *retentions);
+static void adapter_apply_retentions(neu_adapter_t *              adapter,
+                                     neu_json_cache_retentions_t *retentions);
+static int  adapter_mem_check(void *usr_data);
+static void adapter_apply_place(neu_adapter_t *        adapter,
+                                const adapter_place_t *place);
 inline static void reply(neu_adapter_t *adapter, neu_reqresp_head_t *header,
                          void *data);
 
@@ -70,30 +117,61 @@ static const adapter_callbacks_t callback_funs = {
 
 static __thread int create_adapter_error = 0;
 
+// one bit per trans data port of the apps with a msg q above its high water
+// mark, drivers stop sending to them until the consumers catch up
+static uint32_t congested_ports[(UINT16_MAX + 1) / 32] = { 0 };
+
+static uint16_t app_consumers = 1;
+
 #define REGISTER_METRIC(adapter, name, init) \
     adapter_register_metric(adapter, name, name##_HELP, name##_TYPE, init);
 
-#define REGISTER_DRIVER_METRICS(adapter)                     \
-    REGISTER_METRIC(adapter, NEU_METRIC_LINK_STATE,          \
-                    NEU_NODE_LINK_STATE_DISCONNECTED);       \
-    REGISTER_METRIC(adapter, NEU_METRIC_RUNNING_STATE,       \
-                    NEU_NODE_RUNNING_STATE_INIT);            \
-    REGISTER_METRIC(adapter, NEU_METRIC_LAST_RTT_MS,         \
-                    NEU_METRIC_LAST_RTT_MS_MAX);             \
-    REGISTER_METRIC(adapter, NEU_METRIC_SEND_BYTES, 0);      \
-    REGISTER_METRIC(adapter, NEU_METRIC_RECV_BYTES, 0);      \
-    REGISTER_METRIC(adapter, NEU_METRIC_TAGS_TOTAL, 0);      \
-    REGISTER_METRIC(adapter, NEU_METRIC_TAG_READS_TOTAL, 0); \
-    REGISTER_METRIC(adapter, NEU_METRIC_TAG_READ_ERRORS_TOTAL, 0);
-
-#define REGISTER_APP_METRICS(adapter)                              \
-    REGISTER_METRIC(adapter, NEU_METRIC_LINK_STATE,                \
-                    NEU_NODE_LINK_STATE_DISCONNECTED);             \
-    REGISTER_METRIC(adapter, NEU_METRIC_RUNNING_STATE,             \
-                    NEU_NODE_RUNNING_STATE_INIT);                  \
-    REGISTER_METRIC(adapter, NEU_METRIC_SEND_MSGS_TOTAL, 0);       \
-    REGISTER_METRIC(adapter, NEU_METRIC_SEND_MSG_ERRORS_TOTAL, 0); \
-    REGISTER_METRIC(adapter, NEU_METRIC_RECV_MSGS_TOTAL, 0);
+#define REGISTER_DRIVER_METRICS(adapter)                                    \
+    REGISTER_METRIC(adapter, NEU_METRIC_LINK_STATE,                         \
+                    NEU_NODE_LINK_STATE_DISCONNECTED);                      \
+    REGISTER_METRIC(adapter, NEU_METRIC_RUNNING_STATE,                      \
+                    NEU_NODE_RUNNING_STATE_INIT);                           \
+    REGISTER_METRIC(adapter, NEU_METRIC_LAST_RTT_MS,                        \
+                    NEU_METRIC_LAST_RTT_MS_MAX);                            \
+    REGISTER_METRIC(adapter, NEU_METRIC_RTT_MS, 0);                         \
+    REGISTER_METRIC(adapter, NEU_METRIC_SEND_BYTES, 0);                     \
+    REGISTER_METRIC(adapter, NEU_METRIC_RECV_BYTES, 0);                     \
+    REGISTER_METRIC(adapter, NEU_METRIC_TAGS_TOTAL, 0);                     \
+    REGISTER_METRIC(adapter, NEU_METRIC_TAG_READS_TOTAL, 0);                \
+    REGISTER_METRIC(adapter, NEU_METRIC_TAG_READ_ERRORS_TOTAL, 0);          \
+    REGISTER_METRIC(adapter, NEU_METRIC_CPU_MS_TOTAL, 0);                   \
+    REGISTER_METRIC(adapter, NEU_METRIC_MEM_BYTES, 0);                      \
+    REGISTER_METRIC(adapter, NEU_METRIC_TRANS_DATA_DROPPED_CONGESTED_TOTAL, \
+                    0);                                                     \
+    REGISTER_METRIC(adapter, NEU_METRIC_TRANS_DATA_DROPPED_NOBUFS_TOTAL,    \
+                    0);                                                     \
+    REGISTER_METRIC(adapter, NEU_METRIC_TRANS_DATA_SEND_ERRORS_TOTAL, 0);
+
+#define REGISTER_APP_METRICS(adapter)                                    \
+    REGISTER_METRIC(adapter, NEU_METRIC_LINK_STATE,                      \
+                    NEU_NODE_LINK_STATE_DISCONNECTED);                   \
+    REGISTER_METRIC(adapter, NEU_METRIC_RUNNING_STATE,                   \
+                    NEU_NODE_RUNNING_STATE_INIT);                        \
+    REGISTER_METRIC(adapter, NEU_METRIC_SEND_MSGS_TOTAL, 0);             \
+    REGISTER_METRIC(adapter, NEU_METRIC_SEND_MSG_ERRORS_TOTAL, 0);       \
+    REGISTER_METRIC(adapter, NEU_METRIC_RECV_MSGS_TOTAL, 0);             \
+    REGISTER_METRIC(adapter, NEU_METRIC_TRANS_DATA_QUEUE_MS, 0);         \
+    REGISTER_METRIC(adapter, NEU_METRIC_CPU_MS_TOTAL, 0);                \
+    REGISTER_METRIC(adapter, NEU_METRIC_MEM_BYTES, 0);                   \
+    REGISTER_METRIC(adapter, NEU_METRIC_TRANS_DATA_QUEUE_DEPTH, 0);      \
+    REGISTER_METRIC(adapter, NEU_METRIC_TRANS_DATA_QUEUE_HIGH_WATER, 0); \
+    REGISTER_METRIC(adapter, NEU_METRIC_TRANS_DATA_ENQUEUED_TOTAL, 0);   \
+    REGISTER_METRIC(adapter, NEU_METRIC_TRANS_DATA_DEQUEUED_TOTAL, 0);   \
+    REGISTER_METRIC(adapter, NEU_METRIC_TRANS_DATA_DROPPED_FULL_TOTAL, 0); \
+    REGISTER_METRIC(adapter, NEU_METRIC_TRANS_DATA_EVICTED_TOTAL, 0);
+
+#define REGISTER_TRACE_METRICS(adapter)                      \
+    REGISTER_METRIC(adapter, NEU_METRIC_TRACE_READ_MS, 0);     \
+    REGISTER_METRIC(adapter, NEU_METRIC_TRACE_CACHE_MS, 0);    \
+    REGISTER_METRIC(adapter, NEU_METRIC_TRACE_TRANSFER_MS, 0); \
+    REGISTER_METRIC(adapter, NEU_METRIC_TRACE_QUEUE_MS, 0);    \
+    REGISTER_METRIC(adapter, NEU_METRIC_TRACE_DELIVER_MS, 0);  \
+    REGISTER_METRIC(adapter, NEU_METRIC_TRACE_TOTAL_MS, 0);
 
 int neu_adapter_error()
 {
@@ -105,22 +183,195 @@ void neu_adapter_set_error(int error)
     create_adapter_error = error;
 }
 
+// stamp the sampled traces of a NEU_REQRESP_TRANS_DATA(_BATCH) message, and
+// finish them if delivered
+static void trace_stamp(neu_adapter_t *adapter, neu_reqresp_head_t *header,
+                        neu_trace_stage_e stage)
+{
+    neu_reqresp_trans_data_t *datas  = (neu_reqresp_trans_data_t *) &header[1];
+    uint16_t                  n_data = 1;
+
+    if (NEU_REQRESP_TRANS_DATA_BATCH == header->type) {
+        neu_reqresp_trans_data_batch_t *batch =
+            (neu_reqresp_trans_data_batch_t *) &header[1];
+        datas  = batch->datas;
+        n_data = batch->n_data;
+    } else if (NEU_REQRESP_TRANS_DATA != header->type) {
+        return;
+    }
+
+    for (uint16_t i = 0; i < n_data; ++i) {
+        neu_reqresp_trans_data_t *data = &datas[i];
+
+        if (!neu_trace_sampled(&data->trace)) {
+            continue;
+        }
+        neu_trace_stamp(&data->trace, stage);
+        if (NEU_TRACE_ACK == stage) {
+            neu_plugin_trace_done(adapter->plugin, &data->trace, data->driver,
+                                  data->group);
+        }
+    }
+}
+
+// deliver the groups of a batch one by one to plugins that only handle
+// NEU_REQRESP_TRANS_DATA
+static void consume_trans_data_batch(neu_adapter_t *     adapter,
+                                     neu_reqresp_head_t *header)
+{
+    neu_reqresp_trans_data_batch_t *batch =
+        (neu_reqresp_trans_data_batch_t *) &header[1];
+    neu_reqresp_head_t head = *header;
+
+    head.type = NEU_REQRESP_TRANS_DATA;
+    for (uint16_t i = 0; i < batch->n_data; ++i) {
+        adapter->module->intf_funs->request(adapter->plugin, &head,
+                                            &batch->datas[i]);
+    }
+}
+
+static void app_set_congested(neu_adapter_t *adapter, bool congested)
+{
+    uint16_t port = adapter->trans_data_port;
+    uint32_t bit  = 1u << (port % 32);
+
+    if (congested) {
+        __atomic_fetch_or(&congested_ports[port / 32], bit, __ATOMIC_RELEASE);
+    } else {
+        __atomic_fetch_and(&congested_ports[port / 32], ~bit,
+                           __ATOMIC_RELEASE);
+    }
+}
+
+// drivers back off while the queue of any consumer is congested, the one a
+// group hashes to is not known on their side
+static void app_msg_q_watermark(void *arg, bool congested)
+{
+    adapter_consumer_t *consumer = (adapter_consumer_t *) arg;
+    neu_adapter_t *     adapter  = consumer->adapter;
+
+    if (congested) {
+        nlog_warn("app: %s msg q %" PRIu16
+                  " reach high water mark, drivers back off",
+                  adapter->name, consumer->index);
+        if (1 == __atomic_add_fetch(&adapter->n_congested, 1,
+                                    __ATOMIC_ACQ_REL)) {
+            app_set_congested(adapter, true);
+        }
+    } else if (0 ==
+               __atomic_sub_fetch(&adapter->n_congested, 1,
+                                  __ATOMIC_ACQ_REL)) {
+        app_set_congested(adapter, false);
+    }
+}
+
+// the queues fill up while paused, then drivers back off at their high water
+// mark
+static void app_pause(neu_adapter_t *adapter, bool paused)
+{
+    nlog_debug("app: %s %s trans data", adapter->name,
+               paused ? "pause" : "resume");
+    for (uint16_t i = 0; i < adapter->n_consumer; ++i) {
+        adapter_msg_q_pause(adapter->consumers[i].msg_q, paused);
+    }
+}
+
+void neu_adapter_set_app_consumers(uint16_t n)
+{
+    app_consumers = n < 1 ? 1 : n;
+    if (app_consumers > NEU_APP_CONSUMERS_MAX) {
+        app_consumers = NEU_APP_CONSUMERS_MAX;
+    }
+}
+
+// the consumer of the driver and group of the message, the groups of a batch
+// are of one driver, so all the messages of a group keep their order
+static adapter_msg_q_t *app_msg_q(neu_adapter_t *     adapter,
+                                  neu_reqresp_head_t *header)
+{
+    const char *key[2] = { NULL, NULL };
+
+    if (1 == adapter->n_consumer) {
+        return adapter->consumers[0].msg_q;
+    }
+
+    if (header->type == NEU_REQRESP_TRANS_DATA) {
+        neu_reqresp_trans_data_t *data =
+            (neu_reqresp_trans_data_t *) &header[1];
+
+        key[0] = data->driver;
+        key[1] = data->group;
+    } else {
+        neu_reqresp_trans_data_batch_t *batch =
+            (neu_reqresp_trans_data_batch_t *) &header[1];
+
+        key[0] = batch->n_data > 0 ? batch->datas[0].driver : NULL;
+    }
+
+    // the names are interned, equal names are the same pointers
+    return adapter->consumers[neu_hash(key, sizeof(key)) % adapter->n_consumer]
+        .msg_q;
+}
+
+bool neu_adapter_app_congested(const struct sockaddr_un *addr)
+{
+    uint16_t port = 0;
+
+    if (sscanf(addr->sun_path + 1, "neuron-%" SCNu16, &port) != 1) {
+        return false;
+    }
+    return __atomic_load_n(&congested_ports[port / 32], __ATOMIC_ACQUIRE) &
+        (1u << (port % 32));
+}
+
 static void *adapter_consumer(void *arg)
 {
-    neu_adapter_t *adapter = (neu_adapter_t *) arg;
+    adapter_consumer_t *consumer = (adapter_consumer_t *) arg;
+    neu_adapter_t *     adapter  = consumer->adapter;
+    neu_msg_t *         msgs[NEU_APP_MSG_Q_BATCH];
+    int64_t             pushed[NEU_APP_MSG_Q_BATCH];
 
+    neu_plugin_set_consumer(consumer->index);
     while (1) {
-        neu_msg_t *         msg    = NULL;
-        uint32_t            n      = adapter_msg_q_pop(adapter->msg_q, &msg);
-        neu_reqresp_head_t *header = neu_msg_get_header(msg);
+        uint32_t n = adapter_msg_q_pop_batch(consumer->msg_q, msgs, pushed,
+                                             NEU_APP_MSG_Q_BATCH);
+        neu_metric_entry_t *queue_ms =
+            __atomic_load_n(&adapter->queue_ms, __ATOMIC_ACQUIRE);
+        int64_t now = neu_time_ms();
+
+        // a lone consumer keeps the plugin to itself, as before
+        if (adapter->n_consumer > 1) {
+            pthread_rwlock_rdlock(&adapter->plugin_mtx);
+        } else {
+            pthread_rwlock_wrlock(&adapter->plugin_mtx);
+        }
+        for (uint32_t i = 0; i < n; ++i) {
+            neu_reqresp_head_t *header = neu_msg_get_header(msgs[i]);
 
-        nlog_debug("adapter(%s) recv msg from: %s %p, type: %s, %u",
-                   adapter->name, header->sender, header->ctx,
-                   neu_reqresp_type_string(header->type), n);
-        adapter->module->intf_funs->request(
-            adapter->plugin, (neu_reqresp_head_t *) header, &header[1]);
-        neu_trans_data_free((neu_reqresp_trans_data_t *) &header[1]);
-        neu_msg_free(msg);
+            if (NULL != queue_ms) {
+                neu_node_metrics_update_entry(adapter->metrics, queue_ms,
+                                              now - pushed[i]);
+            }
+            trace_stamp(adapter, header, NEU_TRACE_DEQUEUE);
+
+            nlog_debug("adapter(%s) recv msg from: %s %p, type: %s, %u/%u",
+                       adapter->name, header->sender, header->ctx,
+                       neu_reqresp_type_string(header->type), i + 1, n);
+            if (header->type == NEU_REQRESP_TRANS_DATA_BATCH &&
+                !adapter->module->trans_data_batch) {
+                consume_trans_data_batch(adapter, header);
+            } else {
+                adapter->module->intf_funs->request(
+                    adapter->plugin, (neu_reqresp_head_t *) header,
+                    &header[1]);
+            }
+            if (!adapter->module->trace_ack) {
+                trace_stamp(adapter, header, NEU_TRACE_ACK);
+            }
+            neu_trans_data_head_free(header);
+            neu_msg_free(msgs[i]);
+        }
+        pthread_rwlock_unlock(&adapter->plugin_mtx);
     }
 
     return NULL;
@@ -136,12 +387,31 @@ static inline zlog_category_t *get_log_category(const char *node)
     return zlog_get_category(name);
 }
 
+static neu_plugin_t *adapter_plugin_open(neu_adapter_t *            adapter,
+                                         const neu_plugin_module_t *module)
+{
+    neu_plugin_t *plugin = module->intf_funs->open();
+    assert(plugin != NULL);
+    assert(neu_plugin_common_check(plugin));
+    neu_plugin_common_t *common = neu_plugin_to_plugin_common(plugin);
+    common->adapter             = adapter;
+    common->adapter_callbacks   = &adapter->cb_funs;
+    common->link_state          = NEU_NODE_LINK_STATE_DISCONNECTED;
+    common->log                 = get_log_category(adapter->name);
+    strcpy(common->name, adapter->name);
+
+    return plugin;
+}
+
 neu_adapter_t *neu_adapter_create(neu_adapter_info_t *info, bool load)
 {
-    int                  rv      = 0;
-    int                  init_rv = 0;
-    neu_adapter_t *      adapter = NULL;
-    neu_event_io_param_t param   = { 0 };
+    int                         rv         = 0;
+    int                         init_rv    = 0;
+    neu_adapter_t *             adapter    = NULL;
+    neu_event_io_param_t        param      = { 0 };
+    adapter_place_t             place      = { 0 };
+    size_t                      mem_limit  = 0;
+    neu_json_cache_retentions_t retentions = { 0 };
 
     switch (info->module->type) {
     case NEU_NA_TYPE_DRIVER:
@@ -152,34 +422,23 @@ neu_adapter_t *neu_adapter_create(neu_adapter_info_t *info, bool load)
         break;
     }
 
-    adapter->control_fd = socket(AF_UNIX, SOCK_DGRAM, 0);
-    if (adapter->control_fd <= 0) {
-        free(adapter);
-        return NULL;
-    }
-
-    adapter->trans_data_fd = socket(AF_UNIX, SOCK_DGRAM, 0);
-    if (adapter->trans_data_fd <= 0) {
-        close(adapter->control_fd);
-        free(adapter);
-        return NULL;
-    }
-
-    struct timeval sock_timeout = {
-        .tv_sec  = 1,
-        .tv_usec = 0,
-    };
-    if (setsockopt(adapter->control_fd, SOL_SOCKET, SO_SNDTIMEO, &sock_timeout,
-                   sizeof(sock_timeout)) < 0 ||
-        setsockopt(adapter->control_fd, SOL_SOCKET, SO_RCVTIMEO, &sock_timeout,
-                   sizeof(sock_timeout)) < 0 ||
-        setsockopt(adapter->trans_data_fd, SOL_SOCKET, SO_SNDTIMEO,
-                   &sock_timeout, sizeof(sock_timeout)) < 0 ||
-        setsockopt(adapter->trans_data_fd, SOL_SOCKET, SO_RCVTIMEO,
-                   &sock_timeout, sizeof(sock_timeout)) < 0) {
-        nlog_error("fail to set sock timeout for adapter:%s", info->name);
-        close(adapter->trans_data_fd);
-        close(adapter->control_fd);
+    adapter->control_fd    = -1;
+    adapter->trans_data_fd = -1;
+    adapter->reply_fd      = -1;
+    if (adapter_socket(&adapter->control_fd) != 0 ||
+        adapter_socket(&adapter->trans_data_fd) != 0 ||
+        (info->module->type == NEU_NA_TYPE_APP &&
+         adapter_socket(&adapter->reply_fd) != 0)) {
+        nlog_error("fail to create sockets for adapter:%s", info->name);
+        if (adapter->reply_fd >= 0) {
+            close(adapter->reply_fd);
+        }
+        if (adapter->trans_data_fd >= 0) {
+            close(adapter->trans_data_fd);
+        }
+        if (adapter->control_fd >= 0) {
+            close(adapter->control_fd);
+        }
         free(adapter);
         return NULL;
     }
@@ -193,10 +452,21 @@ neu_adapter_t *neu_adapter_create(neu_adapter_info_t *info, bool load)
     adapter->cb_funs.responseto      = callback_funs.responseto;
     adapter->cb_funs.register_metric = callback_funs.register_metric;
     adapter->cb_funs.update_metric   = callback_funs.update_metric;
+    adapter->sample_metrics          = adapter_sample_metrics;
     adapter->module                  = info->module;
     adapter->timestamp_lev           = 0;
     adapter->trans_data_port         = 0;
+    adapter->reply_port              = 0;
     adapter->log_level               = ZLOG_LEVEL_NOTICE;
+    // a reload waits for the consumers in hand only, not for those to come
+    pthread_rwlockattr_t plugin_attr;
+    pthread_rwlockattr_init(&plugin_attr);
+    pthread_rwlockattr_setkind_np(&plugin_attr,
+                                  PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+    pthread_rwlock_init(&adapter->plugin_mtx, &plugin_attr);
+    pthread_rwlockattr_destroy(&plugin_attr);
+    pthread_mutex_init(&adapter->place_mtx, NULL);
+    neu_event_label(adapter->events, adapter->name, "adapter");
 
     // use port number to distinguish each Linux abstract domain socket
     uint16_t           port  = neu_manager_get_port();
@@ -208,6 +478,7 @@ neu_adapter_t *neu_adapter_create(neu_adapter_info_t *info, bool load)
     rv = bind(adapter->control_fd, (struct sockaddr *) &local,
               sizeof(struct sockaddr_un));
     assert(rv == 0);
+    int control_efd = neu_msg_bus_bind(adapter->control_fd, &local);
 
     struct sockaddr_un remote = {
         .sun_family = AF_UNIX,
@@ -217,6 +488,7 @@ neu_adapter_t *neu_adapter_create(neu_adapter_info_t *info, bool load)
     rv = connect(adapter->control_fd, (struct sockaddr *) &remote,
                  sizeof(struct sockaddr_un));
     assert(rv == 0);
+    neu_msg_bus_connect(adapter->control_fd, &remote);
 
     switch (info->module->type) {
     case NEU_NA_TYPE_DRIVER:
@@ -224,48 +496,56 @@ neu_adapter_t *neu_adapter_create(neu_adapter_info_t *info, bool load)
             REGISTER_DRIVER_METRICS(adapter);
         }
         neu_adapter_driver_init((neu_adapter_driver_t *) adapter);
+        adapter->trans_data_port = adapter_bind_lane(
+            adapter, adapter->trans_data_fd, adapter_driver_data,
+            &adapter->trans_data_io, &adapter->trans_data_bus_io);
         break;
     case NEU_NA_TYPE_APP: {
-        adapter->msg_q = adapter_msg_q_new(adapter->name, 1024);
-        pthread_create(&adapter->consumer_tid, NULL, adapter_consumer,
-                       (void *) adapter);
-        while (true) {
-            // use port number to distinguish each Linux abstract domain socket
-            port = neu_manager_get_port();
-            snprintf(local.sun_path, sizeof(local.sun_path),
-                     "%cneuron-%" PRIu16, '\0', port);
-            if (bind(adapter->trans_data_fd, (struct sockaddr *) &local,
-                     sizeof(struct sockaddr_un)) == 0) {
-                adapter->trans_data_port = port;
-                break;
-            }
+        // the consumers share the room of one queue
+        adapter->n_consumer =
+            adapter->module->concurrent_trans_data ? app_consumers : 1;
+        uint32_t size = NEU_APP_MSG_Q_SIZE / adapter->n_consumer;
+        for (uint16_t i = 0; i < adapter->n_consumer; ++i) {
+            adapter_consumer_t *consumer = &adapter->consumers[i];
+
+            consumer->adapter = adapter;
+            consumer->index   = i;
+            consumer->msg_q   = adapter_msg_q_new(adapter->name, size);
+            adapter_msg_q_set_watermark(consumer->msg_q, size / 4 * 3,
+                                        size / 2, app_msg_q_watermark,
+                                        consumer);
+            pthread_create(&consumer->tid, NULL, adapter_consumer,
+                           (void *) consumer);
+            neu_profile_label_thread(consumer->tid, adapter->name,
+                                     "consumer");
         }
-
-        param.usr_data = (void *) adapter;
-        param.cb       = adapter_trans_data;
-        param.fd       = adapter->trans_data_fd;
-
-        adapter->trans_data_io = neu_event_add_io(adapter->events, param);
+        adapter->cb_funs.app.pause = app_pause;
+        adapter->trans_data_port = adapter_bind_lane(
+            adapter, adapter->trans_data_fd, adapter_trans_data,
+            &adapter->trans_data_io, &adapter->trans_data_bus_io);
+        adapter->reply_port =
+            adapter_bind_lane(adapter, adapter->reply_fd, adapter_reply,
+                              &adapter->reply_io, &adapter->reply_bus_io);
 
         if (adapter->module->display) {
             REGISTER_APP_METRICS(adapter);
+            if (neu_trace_sample() > 0) {
+                REGISTER_TRACE_METRICS(adapter);
+            }
+            __atomic_store_n(
+                &adapter->queue_ms,
+                neu_node_metrics_find(adapter->metrics,
+                                      NEU_METRIC_TRANS_DATA_QUEUE_MS),
+                __ATOMIC_RELEASE);
         }
 
         break;
     }
     }
 
-    adapter->plugin = adapter->module->intf_funs->open();
-    assert(adapter->plugin != NULL);
-    assert(neu_plugin_common_check(adapter->plugin));
-    neu_plugin_common_t *common = neu_plugin_to_plugin_common(adapter->plugin);
-    common->adapter             = adapter;
-    common->adapter_callbacks   = &adapter->cb_funs;
-    common->link_state          = NEU_NODE_LINK_STATE_DISCONNECTED;
-    common->log                 = get_log_category(adapter->name);
-    strcpy(common->name, adapter->name);
-
-    zlog_level_switch(common->log, default_log_level);
+    adapter->plugin = adapter_plugin_open(adapter, adapter->module);
+    zlog_level_switch(neu_plugin_to_plugin_common(adapter->plugin)->log,
+                      default_log_level);
 
     init_rv = adapter->module->intf_funs->init(adapter->plugin, load);
 
@@ -273,6 +553,24 @@ neu_adapter_t *neu_adapter_create(neu_adapter_info_t *info, bool load)
         if (adapter->module->intf_funs->setting(adapter->plugin,
                                                 adapter->setting) == 0) {
             adapter->state = NEU_NODE_RUNNING_STATE_READY;
+            if (adapter_parse_place(adapter->setting, &place) == 0) {
+                adapter_apply_place(adapter, &place);
+            } else {
+                nlog_warn("adapter:%s invalid cpu_affinity, numa_node or "
+                          "sched_policy",
+                          adapter->name);
+            }
+            if (adapter_parse_mem_limit(adapter->setting, &mem_limit) == 0) {
+                adapter->mem_limit = mem_limit;
+            } else {
+                nlog_warn("adapter:%s invalid mem_limit", adapter->name);
+            }
+            if (adapter_parse_retentions(adapter, adapter->setting,
+                                         &retentions) == 0) {
+                adapter_apply_retentions(adapter, &retentions);
+            } else {
+                nlog_warn("adapter:%s invalid cache_retention", adapter->name);
+            }
         } else {
             free(adapter->setting);
             adapter->setting = NULL;
@@ -288,6 +586,18 @@ neu_adapter_t *neu_adapter_create(neu_adapter_info_t *info, bool load)
     param.cb       = adapter_loop;
 
     adapter->control_io = neu_event_add_io(adapter->events, param);
+    if (control_efd >= 0) {
+        param.fd                = control_efd;
+        adapter->control_bus_io = neu_event_add_io(adapter->events, param);
+    }
+
+    neu_event_timer_param_t mem = {
+        .millisecond = ADAPTER_MEM_INTERVAL_MS,
+        .usr_data    = (void *) adapter,
+        .type        = NEU_EVENT_TIMER_NOBLOCK,
+        .cb          = adapter_mem_check,
+    };
+    adapter->timer_mem = neu_event_add_timer(adapter->events, mem);
 
     adapter_storage_state(adapter->name, adapter->state);
 
@@ -295,12 +605,16 @@ neu_adapter_t *neu_adapter_create(neu_adapter_info_t *info, bool load)
         nlog_warn("Failed to init adapter: %s", adapter->name);
         neu_adapter_set_error(init_rv);
 
+        neu_event_del_timer(adapter->events, adapter->timer_mem);
+        neu_event_del_io(adapter->events, adapter->trans_data_io);
+        neu_event_del_io(adapter->events, adapter->trans_data_bus_io);
+        neu_event_del_io(adapter->events, adapter->reply_io);
+        neu_event_del_io(adapter->events, adapter->reply_bus_io);
         if (adapter->module->type == NEU_NA_TYPE_DRIVER) {
             neu_adapter_driver_destroy((neu_adapter_driver_t *) adapter);
-        } else {
-            neu_event_del_io(adapter->events, adapter->trans_data_io);
         }
         neu_event_del_io(adapter->events, adapter->control_io);
+        neu_event_del_io(adapter->events, adapter->control_bus_io);
 
         neu_adapter_destroy(adapter);
         return NULL;
@@ -310,6 +624,67 @@ neu_adapter_t *neu_adapter_create(neu_adapter_info_t *info, bool load)
     }
 }
 
+static int adapter_socket(int *fd)
+{
+    struct timeval sock_timeout = {
+        .tv_sec  = 1,
+        .tv_usec = 0,
+    };
+
+    *fd = socket(AF_UNIX, SOCK_DGRAM, 0);
+    if (*fd <= 0) {
+        return -1;
+    }
+
+    if (setsockopt(*fd, SOL_SOCKET, SO_SNDTIMEO, &sock_timeout,
+                   sizeof(sock_timeout)) < 0 ||
+        setsockopt(*fd, SOL_SOCKET, SO_RCVTIMEO, &sock_timeout,
+                   sizeof(sock_timeout)) < 0) {
+        return -1;
+    }
+
+    return 0;
+}
+
+// Bind an unconnected lane socket to a free port and poll it, see the lanes
+// of neu_adapter_t. Every lane has its own socket buffer and bus ring, so a
+// full lane does not hold up the others.
+static uint16_t adapter_bind_lane(neu_adapter_t *adapter, int fd,
+                                  neu_event_io_callback cb,
+                                  neu_event_io_t **     io,
+                                  neu_event_io_t **     bus_io)
+{
+    neu_event_io_param_t param = { 0 };
+    uint16_t             port  = 0;
+    struct sockaddr_un   local = {
+        .sun_family = AF_UNIX,
+    };
+
+    while (true) {
+        // use port number to distinguish each Linux abstract domain socket
+        port = neu_manager_get_port();
+        snprintf(local.sun_path, sizeof(local.sun_path), "%cneuron-%" PRIu16,
+                 '\0', port);
+        if (bind(fd, (struct sockaddr *) &local, sizeof(struct sockaddr_un)) ==
+            0) {
+            break;
+        }
+    }
+
+    param.usr_data = (void *) adapter;
+    param.cb       = cb;
+    param.fd       = fd;
+
+    *io = neu_event_add_io(adapter->events, param);
+
+    param.fd = neu_msg_bus_bind(fd, &local);
+    if (param.fd >= 0) {
+        *bus_io = neu_event_add_io(adapter->events, param);
+    }
+
+    return port;
+}
+
 uint16_t neu_adapter_trans_data_port(neu_adapter_t *adapter)
 {
     return adapter->trans_data_port;
@@ -351,10 +726,20 @@ int neu_adapter_rename(neu_adapter_t *adapter, const char *new_name)
     strcpy(common->name, adapter->name);
     zlog_level_switch(common->log, default_log_level);
 
+    neu_event_label(adapter->events, adapter->name, "adapter");
+    for (uint16_t i = 0; i < adapter->n_consumer; ++i) {
+        neu_profile_label_thread(adapter->consumers[i].tid, adapter->name,
+                                 "consumer");
+    }
+    if (NEU_NA_TYPE_DRIVER == adapter->module->type) {
+        neu_adapter_driver_label((neu_adapter_driver_t *) adapter);
+    }
+
     if (NEU_NA_TYPE_DRIVER == adapter->module->type) {
         neu_adapter_driver_start_group_timer((neu_adapter_driver_t *) adapter);
     }
 
+    neu_capture_stop(old_name);
     remove_logs(old_name);
     free(old_name);
 
@@ -423,9 +808,124 @@ static int adapter_update_metric(neu_adapter_t *adapter,
         return -1;
     }
 
+    if (NULL != group && (neu_metrics_off & NEU_METRICS_OFF_GROUP)) {
+        return 0;
+    }
+
     return neu_node_metrics_update(adapter->metrics, group, metric_name, n);
 }
 
+static size_t adapter_mem_bytes(neu_adapter_t *adapter)
+{
+    size_t bytes = sizeof(neu_adapter_t);
+
+    if (adapter->module->type == NEU_NA_TYPE_DRIVER) {
+        bytes = neu_adapter_driver_mem_bytes((neu_adapter_driver_t *) adapter);
+    }
+    for (uint16_t i = 0; i < adapter->n_consumer; ++i) {
+        bytes += adapter_msg_q_bytes(adapter->consumers[i].msg_q);
+    }
+
+    return bytes;
+}
+
+// what the node gives up over its limit or the budget of all nodes, the
+// oldest half of the queues of an app and half the history of a driver
+static void adapter_mem_degrade(neu_adapter_t *adapter)
+{
+    uint32_t policies = neu_mem_budget_policies();
+
+    for (uint16_t i = 0;
+         i < adapter->n_consumer && (policies & NEU_MEM_DROP_OLDEST); ++i) {
+        adapter_msg_q_t *     q     = adapter->consumers[i].msg_q;
+        adapter_msg_q_stats_t stats = { 0 };
+
+        adapter_msg_q_stats(q, &stats);
+        adapter_msg_q_evict(q, (stats.depth + 1) / 2);
+    }
+
+    if (adapter->module->type == NEU_NA_TYPE_DRIVER &&
+        (policies & NEU_MEM_SHRINK_HISTORY)) {
+        size_t freed = neu_adapter_driver_shrink_history(
+            (neu_adapter_driver_t *) adapter);
+        if (freed > 0) {
+            nlog_warn("adapter:%s shrink history, %zu bytes freed",
+                      adapter->name, freed);
+        }
+    }
+}
+
+// account the memory of the node and give some up every tick it stays over,
+// on the node thread, the only one accounting for the node
+static int adapter_mem_check(void *usr_data)
+{
+    neu_adapter_t *adapter = (neu_adapter_t *) usr_data;
+    size_t         bytes   = adapter_mem_bytes(adapter);
+    size_t         limit   = adapter->mem_limit;
+    bool           over    = false;
+
+    neu_mem_budget_account(&adapter->mem_bytes, bytes);
+    over = (limit > 0 && bytes > limit) || neu_mem_budget_over();
+    if (over != adapter->mem_over) {
+        adapter->mem_over = over;
+        if (over) {
+            nlog_warn("adapter:%s %zu bytes, over mem_limit %zu or budget "
+                      "%zu/%zu",
+                      adapter->name, bytes, limit, neu_mem_budget_used(),
+                      neu_mem_budget_limit());
+        } else {
+            nlog_notice("adapter:%s %zu bytes, back under budget",
+                        adapter->name, bytes);
+        }
+    }
+    if (over) {
+        adapter_mem_degrade(adapter);
+    }
+
+    return 0;
+}
+
+static void adapter_sample_metrics(neu_adapter_t *adapter)
+{
+    adapter_update_metric(adapter, NEU_METRIC_CPU_MS_TOTAL,
+                          neu_profile_node_cpu_ms(adapter->name), NULL);
+    adapter_update_metric(adapter, NEU_METRIC_MEM_BYTES,
+                          __atomic_load_n(&adapter->mem_bytes,
+                                          __ATOMIC_RELAXED),
+                          NULL);
+
+    if (adapter->n_consumer > 0) {
+        adapter_msg_q_stats_t stats = { 0 };
+
+        // the queues of the consumers add up, but for the highest depth
+        for (uint16_t i = 0; i < adapter->n_consumer; ++i) {
+            adapter_msg_q_stats_t q = { 0 };
+
+            adapter_msg_q_stats(adapter->consumers[i].msg_q, &q);
+            stats.depth += q.depth;
+            stats.high_water =
+                q.high_water > stats.high_water ? q.high_water
+                                                : stats.high_water;
+            stats.enqueued += q.enqueued;
+            stats.dequeued += q.dequeued;
+            stats.dropped += q.dropped;
+            stats.evicted += q.evicted;
+        }
+        adapter_update_metric(adapter, NEU_METRIC_TRANS_DATA_QUEUE_DEPTH,
+                              stats.depth, NULL);
+        adapter_update_metric(adapter, NEU_METRIC_TRANS_DATA_QUEUE_HIGH_WATER,
+                              stats.high_water, NULL);
+        adapter_update_metric(adapter, NEU_METRIC_TRANS_DATA_ENQUEUED_TOTAL,
+                              stats.enqueued, NULL);
+        adapter_update_metric(adapter, NEU_METRIC_TRANS_DATA_DEQUEUED_TOTAL,
+                              stats.dequeued, NULL);
+        adapter_update_metric(adapter, NEU_METRIC_TRANS_DATA_DROPPED_FULL_TOTAL,
+                              stats.dropped, NULL);
+        adapter_update_metric(adapter, NEU_METRIC_TRANS_DATA_EVICTED_TOTAL,
+                              stats.evicted, NULL);
+    }
+}
+
 static inline void adapter_reset_metrics(neu_adapter_t *adapter)
 {
     if (NULL != adapter->metrics) {
@@ -433,6 +933,81 @@ static inline void adapter_reset_metrics(neu_adapter_t *adapter)
     }
 }
 
+// Reads and writes of an app go straight to the trans data socket of a driver
+// with a route, the response comes back to the reply socket of the app, ahead
+// of any trans data queued for the app. Without a route, the request goes
+// through the manager.
+static bool adapter_send_direct(neu_adapter_t *     adapter,
+                                neu_reqresp_head_t *header)
+{
+    struct sockaddr_un dst = { 0 };
+
+    if (adapter->module->type != NEU_NA_TYPE_APP || adapter->reply_port == 0) {
+        return false;
+    }
+
+    switch (header->type) {
+    case NEU_REQ_READ_GROUP:
+    case NEU_REQ_WRITE_TAG:
+    case NEU_REQ_WRITE_TAGS:
+    case NEU_REQ_WRITE_GTAGS:
+        break;
+    default:
+        return false;
+    }
+
+    if (!neu_node_manager_find_route(header->receiver, &dst)) {
+        return false;
+    }
+
+    header->reply_port = adapter->reply_port;
+    if (0 != neu_send_msg_to(adapter->control_fd, &dst, (neu_msg_t *) header)) {
+        nlog_warn("adapter: %s send %s to %s directly failed, errno: %s(%d)",
+                  adapter->name, neu_reqresp_type_string(header->type),
+                  header->receiver, strerror(errno), errno);
+        header->reply_port = 0;
+        return false;
+    }
+
+    return true;
+}
+
+// The nodes state is answered from the snapshot of the manager, back to the
+// reply socket of the app, so a busy manager does not hold it up.
+static bool adapter_nodes_state_local(neu_adapter_t *     adapter,
+                                      neu_reqresp_head_t *header)
+{
+    neu_resp_get_nodes_state_t resp = { 0 };
+    struct sockaddr_un         dst  = {
+        .sun_family = AF_UNIX,
+    };
+
+    if (header->type != NEU_REQ_GET_NODES_STATE ||
+        adapter->module->type != NEU_NA_TYPE_APP || adapter->reply_port == 0 ||
+        !neu_node_manager_find_state(&resp.states, &resp.core_level)) {
+        return false;
+    }
+
+    header->type = NEU_RESP_GET_NODES_STATE;
+    strcpy(header->receiver, adapter->name);
+    strcpy(header->sender, "manager");
+    neu_msg_gen(header, &resp);
+
+    snprintf(dst.sun_path, sizeof(dst.sun_path), "%cneuron-%" PRIu16, '\0',
+             adapter->reply_port);
+    if (0 != neu_send_msg_to(adapter->control_fd, &dst, (neu_msg_t *) header)) {
+        nlog_warn("adapter: %s answer nodes state failed, errno: %s(%d)",
+                  adapter->name, strerror(errno), errno);
+        utarray_free(resp.states);
+        header->type = NEU_REQ_GET_NODES_STATE;
+        strcpy(header->receiver, "");
+        strcpy(header->sender, adapter->name);
+        return false;
+    }
+
+    return true;
+}
+
 static int adapter_command(neu_adapter_t *adapter, neu_reqresp_head_t header,
                            void *data)
 {
@@ -449,6 +1024,7 @@ static int adapter_command(neu_adapter_t *adapter, neu_reqresp_head_t header,
     case NEU_REQ_READ_GROUP: {
         neu_req_read_group_t *cmd = (neu_req_read_group_t *) data;
         strcpy(pheader->receiver, cmd->driver);
+        ((neu_req_read_group_t *) &pheader[1])->issued = neu_mono_ms();
         break;
     }
     case NEU_REQ_WRITE_TAG: {
@@ -487,6 +1063,12 @@ static int adapter_command(neu_adapter_t *adapter, neu_reqresp_head_t header,
         strcpy(pheader->receiver, cmd->driver);
         break;
     }
+    case NEU_REQ_GET_TAG_HISTORY: {
+        neu_req_get_tag_history_t *cmd = (neu_req_get_tag_history_t *) data;
+        strcpy(pheader->receiver, cmd->driver);
+        break;
+    }
+    case NEU_REQ_APPLY_GTAG:
     case NEU_REQ_ADD_GTAG: {
         neu_req_add_gtag_t *cmd = (neu_req_add_gtag_t *) data;
         strcpy(pheader->receiver, cmd->driver);
@@ -516,6 +1098,12 @@ static int adapter_command(neu_adapter_t *adapter, neu_reqresp_head_t header,
         strcpy(pheader->receiver, cmd->node);
         break;
     }
+    case NEU_REQ_UPDATE_LOG_CAPTURE: {
+        neu_req_update_log_capture_t *cmd =
+            (neu_req_update_log_capture_t *) data;
+        strcpy(pheader->receiver, cmd->node);
+        break;
+    }
     case NEU_REQ_PRGFILE_UPLOAD: {
         neu_req_prgfile_upload_t *cmd = (neu_req_prgfile_upload_t *) data;
         strcpy(pheader->receiver, cmd->driver);
@@ -534,6 +1122,11 @@ static int adapter_command(neu_adapter_t *adapter, neu_reqresp_head_t header,
         break;
     }
 
+    if (adapter_send_direct(adapter, pheader) ||
+        adapter_nodes_state_local(adapter, pheader)) {
+        return 0;
+    }
+
     ret = neu_send_msg(adapter->control_fd, msg);
     if (0 != ret) {
         nlog_error(
@@ -556,7 +1149,18 @@ static int adapter_response(neu_adapter_t *adapter, neu_reqresp_head_t *header,
 
     neu_msg_gen(header, data);
     neu_msg_t *msg = (neu_msg_t *) header;
-    int        ret = neu_send_msg(adapter->control_fd, msg);
+    int        ret = 0;
+    if (header->reply_port != 0) {
+        // a direct request, see adapter_send_direct
+        struct sockaddr_un dst = {
+            .sun_family = AF_UNIX,
+        };
+        snprintf(dst.sun_path, sizeof(dst.sun_path), "%cneuron-%" PRIu16,
+                 '\0', header->reply_port);
+        ret = neu_send_msg_to(adapter->control_fd, &dst, msg);
+    } else {
+        ret = neu_send_msg(adapter->control_fd, msg);
+    }
     if (0 != ret) {
         nlog_error("adapter: %s send response %s failed, ret: %d, errno: %d",
                    adapter->name, neu_reqresp_type_string(header->type), ret,
@@ -571,7 +1175,17 @@ static int adapter_responseto(neu_adapter_t *     adapter,
                               neu_reqresp_head_t *header, void *data,
                               struct sockaddr_un dst)
 {
-    assert(header->type == NEU_REQRESP_TRANS_DATA);
+    assert(header->type == NEU_REQRESP_TRANS_DATA ||
+           header->type == NEU_REQRESP_TRANS_DATA_BATCH);
+
+    if (neu_adapter_app_congested(&dst)) {
+        nlog_debug("adapter: %s skip %s, %s is congested", adapter->name,
+                   neu_reqresp_type_string(header->type), dst.sun_path + 1);
+        adapter_update_metric(adapter,
+                              NEU_METRIC_TRANS_DATA_DROPPED_CONGESTED_TOTAL, 1,
+                              NULL);
+        return NEU_ERR_IS_BUSY;
+    }
 
     neu_msg_t *msg = neu_msg_new(header->type, header->ctx, data);
     if (NULL == msg) {
@@ -582,9 +1196,15 @@ static int adapter_responseto(neu_adapter_t *     adapter,
 
     int ret = neu_send_msg_to(adapter->control_fd, &dst, msg);
     if (0 != ret) {
+        int err = errno;
+        adapter_update_metric(adapter,
+                              ENOBUFS == err
+                                  ? NEU_METRIC_TRANS_DATA_DROPPED_NOBUFS_TOTAL
+                                  : NEU_METRIC_TRANS_DATA_SEND_ERRORS_TOTAL,
+                              1, NULL);
         nlog_error("adapter: %s send responseto %s failed, ret: %d, errno: %d",
                    adapter->name, neu_reqresp_type_string(header->type), ret,
-                   errno);
+                   err);
         neu_msg_free(msg);
     }
 
@@ -616,29 +1236,112 @@ static int adapter_trans_data(enum neu_event_io_type type, int fd,
                neu_reqresp_type_string(header->type));
 
     if (header->type != NEU_REQRESP_TRANS_DATA &&
-        header->type != NEU_RESP_ERROR) {
+        header->type != NEU_REQRESP_TRANS_DATA_BATCH) {
         nlog_warn("adapter: %s recv msg type error, type: %s", adapter->name,
                   neu_reqresp_type_string(header->type));
         neu_msg_free(msg);
         return 0;
     }
 
-    if (header->type == NEU_REQRESP_TRANS_DATA) {
-        if (adapter_msg_q_push(adapter->msg_q, msg) < 0) {
-            nlog_warn("adapter: %s trans data msg q is full, drop msg",
-                      adapter->name);
-            neu_trans_data_free((neu_reqresp_trans_data_t *) &header[1]);
-            neu_msg_free(msg);
-        }
+    trace_stamp(adapter, header, NEU_TRACE_ENQUEUE);
+    if (adapter_msg_q_push(app_msg_q(adapter, header), msg) < 0) {
+        nlog_warn("adapter: %s trans data msg q is full, drop msg",
+                  adapter->name);
+        neu_trans_data_head_free(header);
+        neu_msg_free(msg);
+    }
+    return 0;
+}
+
+static int adapter_reply(enum neu_event_io_type type, int fd, void *usr_data)
+{
+    neu_adapter_t *adapter = (neu_adapter_t *) usr_data;
+    if (type != NEU_EVENT_IO_READ) {
+        nlog_warn("adapter: %s recv close, exit loop, fd: %d", adapter->name,
+                  fd);
+        return 0;
+    }
+
+    neu_msg_t *msg = NULL;
+    int        rv  = neu_recv_msg(adapter->reply_fd, &msg);
+    if (0 != rv) {
+        nlog_warn("adapter: %s recv reply failed, ret: %d, errno: %s(%d)",
+                  adapter->name, rv, strerror(errno), errno);
+        return 0;
+    }
+
+    neu_reqresp_head_t *header = neu_msg_get_header(msg);
+
+    nlog_debug("adapter(%s) recv reply from: %s %p, type: %s", adapter->name,
+               header->sender, header->ctx,
+               neu_reqresp_type_string(header->type));
+
+    if (header->type != NEU_RESP_ERROR &&
+        header->type != NEU_RESP_READ_GROUP &&
+        header->type != NEU_RESP_GET_NODES_STATE) {
+        nlog_warn("adapter: %s recv msg type error, type: %s", adapter->name,
+                  neu_reqresp_type_string(header->type));
+        neu_msg_free(msg);
         return 0;
     }
 
     adapter->module->intf_funs->request(
         adapter->plugin, (neu_reqresp_head_t *) header, &header[1]);
+    if (header->type == NEU_RESP_READ_GROUP) {
+        neu_resp_read_free((neu_resp_read_group_t *) &header[1]);
+    }
     neu_msg_free(msg);
     return 0;
 }
 
+static int adapter_driver_data(enum neu_event_io_type type, int fd,
+                               void *usr_data)
+{
+    neu_adapter_t *       adapter = (neu_adapter_t *) usr_data;
+    neu_adapter_driver_t *driver  = (neu_adapter_driver_t *) usr_data;
+    if (type != NEU_EVENT_IO_READ) {
+        nlog_warn("adapter: %s recv close, exit loop, fd: %d", adapter->name,
+                  fd);
+        return 0;
+    }
+
+    neu_msg_t *msg = NULL;
+    int        rv  = neu_recv_msg(adapter->trans_data_fd, &msg);
+    if (0 != rv) {
+        nlog_warn("adapter: %s recv data failed, ret: %d, errno: %s(%d)",
+                  adapter->name, rv, strerror(errno), errno);
+        return 0;
+    }
+
+    neu_reqresp_head_t *header = neu_msg_get_header(msg);
+
+    nlog_debug("adapter(%s) recv direct msg from: %s %p, type: %s",
+               adapter->name, header->sender, header->ctx,
+               neu_reqresp_type_string(header->type));
+
+    switch (header->type) {
+    case NEU_REQ_READ_GROUP:
+        neu_adapter_driver_read_group(driver, header);
+        break;
+    case NEU_REQ_WRITE_TAG:
+        neu_adapter_driver_write_tag(driver, header);
+        break;
+    case NEU_REQ_WRITE_TAGS:
+        neu_adapter_driver_write_tags(driver, header);
+        break;
+    case NEU_REQ_WRITE_GTAGS:
+        neu_adapter_driver_write_gtags(driver, header);
+        break;
+    default:
+        nlog_warn("adapter: %s recv msg type error, type: %s", adapter->name,
+                  neu_reqresp_type_string(header->type));
+        neu_msg_free(msg);
+        break;
+    }
+
+    return 0;
+}
+
 static int adapter_loop(enum neu_event_io_type type, int fd, void *usr_data)
 {
     neu_adapter_t *adapter = (neu_adapter_t *) usr_data;
@@ -699,8 +1402,10 @@ static int adapter_loop(enum neu_event_io_type type, int fd, void *usr_data)
     case NEU_RESP_GET_SUBSCRIBE_GROUP:
     case NEU_RESP_ADD_TAG:
     case NEU_RESP_ADD_GTAG:
+    case NEU_RESP_APPLY_GTAG:
     case NEU_RESP_UPDATE_TAG:
     case NEU_RESP_GET_TAG:
+    case NEU_RESP_GET_TAG_HISTORY:
     case NEU_RESP_GET_NODE:
     case NEU_RESP_GET_PLUGIN:
     case NEU_RESP_GET_GROUP:
@@ -821,7 +1526,8 @@ static int adapter_loop(enum neu_event_io_type type, int fd, void *usr_data)
             pthread_mutex_lock(&adapter->metrics->lock);
             neu_metric_entry_t *e = NULL;
             HASH_FIND_STR(adapter->metrics->entries, NEU_METRIC_LAST_RTT_MS, e);
-            resp->rtt = NULL != e ? e->value : 0;
+            resp->rtt =
+                NULL != e ? __atomic_load_n(&e->value, __ATOMIC_RELAXED) : 0;
             pthread_mutex_unlock(&adapter->metrics->lock);
         }
         resp->state  = neu_adapter_get_state(adapter);
@@ -852,20 +1558,24 @@ static int adapter_loop(enum neu_event_io_type type, int fd, void *usr_data)
         neu_req_get_tag_t *cmd   = (neu_req_get_tag_t *) &header[1];
         neu_resp_error_t   error = { .error = 0 };
         UT_array *         tags  = NULL;
+        uint32_t           total = 0;
 
         if (adapter->module->type == NEU_NA_TYPE_DRIVER) {
             error.error = neu_adapter_driver_query_tag(
-                (neu_adapter_driver_t *) adapter, cmd->group, cmd->name, &tags);
+                (neu_adapter_driver_t *) adapter, cmd, &tags, &total);
         } else {
             error.error = NEU_ERR_GROUP_NOT_ALLOW;
         }
 
         neu_msg_exchange(header);
         if (error.error != NEU_ERR_SUCCESS) {
+            if (tags != NULL) {
+                utarray_free(tags);
+            }
             header->type = NEU_RESP_ERROR;
             reply(adapter, header, &error);
         } else {
-            neu_resp_get_tag_t resp = { .tags = tags };
+            neu_resp_get_tag_t resp = { .tags = tags, .total = total };
 
             header->type = NEU_RESP_GET_TAG;
             reply(adapter, header, &resp);
@@ -873,6 +1583,30 @@ static int adapter_loop(enum neu_event_io_type type, int fd, void *usr_data)
 
         break;
     }
+    case NEU_REQ_GET_TAG_HISTORY: {
+        neu_req_get_tag_history_t *cmd =
+            (neu_req_get_tag_history_t *) &header[1];
+        neu_resp_error_t           error = { .error = 0 };
+        neu_resp_get_tag_history_t resp  = { 0 };
+
+        if (adapter->module->type == NEU_NA_TYPE_DRIVER) {
+            error.error = neu_adapter_driver_tag_history(
+                (neu_adapter_driver_t *) adapter, cmd, &resp);
+        } else {
+            error.error = NEU_ERR_GROUP_NOT_ALLOW;
+        }
+
+        neu_msg_exchange(header);
+        if (error.error != NEU_ERR_SUCCESS) {
+            header->type = NEU_RESP_ERROR;
+            reply(adapter, header, &error);
+        } else {
+            header->type = NEU_RESP_GET_TAG_HISTORY;
+            reply(adapter, header, &resp);
+        }
+
+        break;
+    }
     case NEU_REQ_ADD_GROUP: {
         neu_req_add_group_t *cmd   = (neu_req_add_group_t *) &header[1];
         neu_resp_error_t     error = { 0 };
@@ -1011,17 +1745,11 @@ static int adapter_loop(enum neu_event_io_type type, int fd, void *usr_data)
         neu_resp_add_tag_t resp = { 0 };
 
         if (adapter->module->type == NEU_NA_TYPE_DRIVER) {
-            for (int i = 0; i < cmd->n_tag; i++) {
-                int ret = neu_adapter_driver_validate_tag(
-                    (neu_adapter_driver_t *) adapter, cmd->group,
-                    &cmd->tags[i]);
-                if (ret == 0) {
-                    resp.index += 1;
-                } else {
-                    resp.error = ret;
-                    break;
-                }
-            }
+            int n_valid = 0;
+            resp.error  = neu_adapter_driver_validate_tags(
+                (neu_adapter_driver_t *) adapter, cmd->group, cmd->tags,
+                cmd->n_tag, &n_valid);
+            resp.index = n_valid;
         } else {
             resp.error = NEU_ERR_GROUP_NOT_ALLOW;
         }
@@ -1102,6 +1830,36 @@ static int adapter_loop(enum neu_event_io_type type, int fd, void *usr_data)
         reply(adapter, header, &resp);
         break;
     }
+    case NEU_REQ_APPLY_GTAG: {
+        neu_req_add_gtag_t *cmd  = (neu_req_add_gtag_t *) &header[1];
+        neu_resp_add_tag_t  resp = { 0 };
+
+        if (adapter->module->type != NEU_NA_TYPE_DRIVER) {
+            resp.error = NEU_ERR_GROUP_NOT_ALLOW;
+        } else if (neu_adapter_driver_new_group_count(
+                       (neu_adapter_driver_t *) adapter, cmd) +
+                       neu_adapter_driver_group_count(
+                           (neu_adapter_driver_t *) adapter) >
+                   NEU_GROUP_MAX_PER_NODE) {
+            resp.error = NEU_ERR_GROUP_MAX_GROUPS;
+        } else if (neu_adapter_validate_gtags(adapter, cmd, &resp) == 0) {
+            neu_adapter_driver_apply_gtags((neu_adapter_driver_t *) adapter,
+                                           cmd, &resp);
+        }
+
+        for (int i = 0; i < cmd->n_group; i++) {
+            for (int j = 0; j < cmd->groups[i].n_tag; j++) {
+                neu_tag_fini(&cmd->groups[i].tags[j]);
+            }
+            free(cmd->groups[i].tags);
+        }
+        free(cmd->groups);
+
+        neu_msg_exchange(header);
+        header->type = NEU_RESP_APPLY_GTAG;
+        reply(adapter, header, &resp);
+        break;
+    }
     case NEU_REQ_UPDATE_TAG: {
         neu_req_update_tag_t *cmd  = (neu_req_update_tag_t *) &header[1];
         neu_resp_update_tag_t resp = { 0 };
@@ -1144,6 +1902,14 @@ static int adapter_loop(enum neu_event_io_type type, int fd, void *usr_data)
         reply(adapter, header, &resp);
         break;
     }
+    case NEU_REQ_NODE_RELOAD: {
+        neu_req_node_reload_t *cmd = (neu_req_node_reload_t *) &header[1];
+
+        adapter_reload(adapter, cmd->handle,
+                       (neu_plugin_module_t *) cmd->module);
+        neu_msg_free(msg);
+        break;
+    }
     case NEU_REQ_NODE_UNINIT: {
         neu_req_node_uninit_t *cmd = (neu_req_node_uninit_t *) &header[1];
         char                   name[NEU_NODE_NAME_LEN]     = { 0 };
@@ -1189,6 +1955,25 @@ static int adapter_loop(enum neu_event_io_type type, int fd, void *usr_data)
 
         break;
     }
+    case NEU_REQ_UPDATE_LOG_CAPTURE: {
+        neu_req_update_log_capture_t *cmd =
+            (neu_req_update_log_capture_t *) &header[1];
+        neu_resp_error_t error = { 0 };
+
+        if (cmd->enable) {
+            error.error = neu_capture_start(
+                adapter->name,
+                neu_plugin_to_plugin_common(adapter->plugin)->log,
+                cmd->n_packet);
+        } else {
+            neu_capture_stop(adapter->name);
+        }
+
+        neu_msg_exchange(header);
+        header->type = NEU_RESP_ERROR;
+        reply(adapter, header, &error);
+        break;
+    }
     case NEU_REQ_PRGFILE_UPLOAD: {
         adapter->module->intf_funs->request(
             adapter->plugin, (neu_reqresp_head_t *) header, &header[1]);
@@ -1208,19 +1993,17 @@ int neu_adapter_validate_gtags(neu_adapter_t *adapter, neu_req_add_gtag_t *cmd,
                                neu_resp_add_tag_t *resp)
 {
     for (int group_index = 0; group_index < cmd->n_group; group_index++) {
-        for (int tag_index = 0; tag_index < cmd->groups[group_index].n_tag;
-             tag_index++) {
-            int validation_result = neu_adapter_driver_validate_tag(
-                (neu_adapter_driver_t *) adapter,
-                cmd->groups[group_index].group,
-                &cmd->groups[group_index].tags[tag_index]);
-            if (validation_result == 0) {
-                resp->index += 1;
-            } else {
-                resp->error = validation_result;
-                resp->index = 0;
-                return validation_result;
-            }
+        int n_valid           = 0;
+        int validation_result = neu_adapter_driver_validate_tags(
+            (neu_adapter_driver_t *) adapter, cmd->groups[group_index].group,
+            cmd->groups[group_index].tags, cmd->groups[group_index].n_tag,
+            &n_valid);
+        if (validation_result == 0) {
+            resp->index += n_valid;
+        } else {
+            resp->error = validation_result;
+            resp->index = 0;
+            return validation_result;
         }
     }
     return 0;
@@ -1310,8 +2093,14 @@ int neu_adapter_add_gtags(neu_adapter_t *adapter, neu_req_add_gtag_t *cmd,
 void neu_adapter_destroy(neu_adapter_t *adapter)
 {
     nlog_notice("adapter %s destroy", adapter->name);
+    neu_msg_bus_unbind(adapter->control_fd);
+    neu_msg_bus_unbind(adapter->trans_data_fd);
     close(adapter->control_fd);
     close(adapter->trans_data_fd);
+    if (adapter->reply_fd >= 0) {
+        neu_msg_bus_unbind(adapter->reply_fd);
+        close(adapter->reply_fd);
+    }
 
     adapter->module->intf_funs->close(adapter->plugin);
 
@@ -1320,13 +2109,19 @@ void neu_adapter_destroy(neu_adapter_t *adapter)
         neu_node_metrics_free(adapter->metrics);
     }
 
-    if (adapter->consumer_tid != 0) {
-        pthread_cancel(adapter->consumer_tid);
+    for (uint16_t i = 0; i < adapter->n_consumer; ++i) {
+        neu_profile_unlabel_thread(adapter->consumers[i].tid);
+        pthread_cancel(adapter->consumers[i].tid);
+    }
+    for (uint16_t i = 0; i < adapter->n_consumer; ++i) {
+        adapter_msg_q_free(adapter->consumers[i].msg_q);
     }
-    if (adapter->msg_q != NULL) {
-        adapter_msg_q_free(adapter->msg_q);
+    if (adapter->n_consumer > 0) {
+        app_set_congested(adapter, false);
     }
 
+    neu_capture_stop(adapter->name);
+
     char *setting = NULL;
     if (adapter_load_setting(adapter->name, &setting) != 0) {
         remove_logs(adapter->name);
@@ -1342,17 +2137,105 @@ void neu_adapter_destroy(neu_adapter_t *adapter)
     }
 
     neu_event_close(adapter->events);
+    pthread_rwlock_destroy(&adapter->plugin_mtx);
+    pthread_mutex_destroy(&adapter->place_mtx);
     free(adapter);
 }
 
+// runs on the adapter thread, so no request reaches the plugin meanwhile, the
+// group timers and the app consumers are held off while the plugin is swapped
+static void adapter_reload(neu_adapter_t *adapter, void *handle,
+                           neu_plugin_module_t *module)
+{
+    neu_plugin_module_t * old_module = adapter->module;
+    neu_plugin_t *        old        = adapter->plugin;
+    void *                old_handle = adapter->handle;
+    neu_plugin_t *        plugin     = NULL;
+    neu_node_link_state_e link_state = NEU_NODE_LINK_STATE_DISCONNECTED;
+    bool                  migrated   = false;
+    int                   rv         = 0;
+
+    if (module->type != old_module->type ||
+        strcmp(module->module_name, old_module->module_name) != 0) {
+        nlog_error("adapter: %s, can not reload %s on plugin %s",
+                   adapter->name, module->module_name,
+                   old_module->module_name);
+        dlclose(handle);
+        return;
+    }
+
+    pthread_rwlock_wrlock(&adapter->plugin_mtx);
+    link_state = neu_plugin_to_plugin_common(old)->link_state;
+    if (old_module->type == NEU_NA_TYPE_DRIVER) {
+        neu_adapter_driver_detach_plugin((neu_adapter_driver_t *) adapter);
+    }
+
+    plugin = adapter_plugin_open(adapter, module);
+    if (module->intf_funs->migrate != NULL) {
+        migrated = module->intf_funs->migrate(plugin, old) == 0;
+    }
+    if (!migrated) {
+        if (adapter->state == NEU_NODE_RUNNING_STATE_RUNNING) {
+            old_module->intf_funs->stop(old);
+        }
+        old_module->intf_funs->uninit(old);
+    }
+    old_module->intf_funs->close(old);
+
+    adapter->plugin = plugin;
+    adapter->module = module;
+    adapter->handle = handle;
+
+    if (migrated) {
+        neu_plugin_to_plugin_common(plugin)->link_state = link_state;
+    } else {
+        rv = module->intf_funs->init(plugin, false);
+        if (rv == 0 && adapter->setting != NULL) {
+            rv = module->intf_funs->setting(plugin, adapter->setting);
+        }
+        if (rv == 0 && adapter->state == NEU_NODE_RUNNING_STATE_RUNNING) {
+            rv = module->intf_funs->start(plugin);
+        }
+    }
+
+    if (module->type == NEU_NA_TYPE_DRIVER) {
+        neu_adapter_driver_attach_plugin((neu_adapter_driver_t *) adapter,
+                                         !migrated);
+    }
+    pthread_rwlock_unlock(&adapter->plugin_mtx);
+
+    if (old_handle != NULL) {
+        dlclose(old_handle);
+    }
+
+    if (rv != 0) {
+        nlog_error("adapter: %s, plugin %s reloaded, restart error: %d",
+                   adapter->name, module->module_name, rv);
+    } else {
+        nlog_notice("adapter: %s, plugin %s reloaded, %s", adapter->name,
+                    module->module_name,
+                    migrated ? "state migrated" : "reconnected");
+    }
+}
+
 int neu_adapter_uninit(neu_adapter_t *adapter)
 {
+    // before the cache it looks at goes
+    neu_event_del_timer(adapter->events, adapter->timer_mem);
+    adapter->timer_mem = NULL;
+    neu_mem_budget_account(&adapter->mem_bytes, 0);
+
     if (adapter->module->type == NEU_NA_TYPE_DRIVER) {
         neu_adapter_driver_uninit((neu_adapter_driver_t *) adapter);
     }
     adapter->module->intf_funs->uninit(adapter->plugin);
 
     neu_event_del_io(adapter->events, adapter->control_io);
+    neu_event_del_io(adapter->events, adapter->control_bus_io);
+    neu_event_del_io(adapter->events, adapter->trans_data_io);
+    neu_event_del_io(adapter->events, adapter->trans_data_bus_io);
+    neu_event_del_io(adapter->events, adapter->reply_io);
+    neu_event_del_io(adapter->events, adapter->reply_bus_io);
 
     if (adapter->module->type == NEU_NA_TYPE_DRIVER) {
         neu_adapter_driver_destroy((neu_adapter_driver_t *) adapter);
@@ -1431,15 +2314,222 @@ int neu_adapter_stop(neu_adapter_t *adapter)
     return error;
 }
 
+int neu_adapter_suspend(neu_adapter_t *adapter)
+{
+    const neu_plugin_intf_funs_t *intf_funs = adapter->module->intf_funs;
+    neu_err_code_e                error     = NEU_ERR_SUCCESS;
+
+    if (adapter->state != NEU_NODE_RUNNING_STATE_RUNNING) {
+        return NEU_ERR_NODE_NOT_RUNNING;
+    }
+
+    error = intf_funs->stop(adapter->plugin);
+    if (error == NEU_ERR_SUCCESS) {
+        adapter->state = NEU_NODE_RUNNING_STATE_READY;
+        adapter_reset_metrics(adapter);
+    }
+
+    return error;
+}
+
+// the scheduling policy in the params of a node setting, -1 if it is
+// malformed. sched_policy is fifo, rr or other, sched_priority defaults to
+// the lowest of the policy
+static int adapter_parse_sched(const char *setting, adapter_place_t *place)
+{
+    neu_json_elem_t policy   = { .name = "sched_policy", .t = NEU_JSON_STR };
+    neu_json_elem_t priority = { .name = "sched_priority", .t = NEU_JSON_INT };
+
+    place->policy   = SCHED_OTHER;
+    place->priority = 0;
+    if (neu_parse_param(setting, NULL, 1, &policy) != 0) {
+        return 0;
+    }
+
+    place->policy = neu_sched_policy(policy.v.val_str);
+    free(policy.v.val_str);
+    if (place->policy < 0) {
+        return -1;
+    }
+
+    if (place->policy != SCHED_OTHER) {
+        place->priority = sched_get_priority_min(place->policy);
+    }
+    if (neu_parse_param(setting, NULL, 1, &priority) == 0) {
+        if (priority.v.val_int < INT32_MIN || priority.v.val_int > INT32_MAX) {
+            return -1;
+        }
+        place->priority = (int) priority.v.val_int;
+    }
+
+    return neu_sched_priority_valid(place->policy, place->priority) ? 0 : -1;
+}
+
+// the bytes the node may account, mem_limit KiB in the params of a node
+// setting, 0 for no limit, -1 if it is malformed
+static int adapter_parse_mem_limit(const char *setting, size_t *limit)
+{
+    neu_json_elem_t elem = { .name = "mem_limit", .t = NEU_JSON_INT };
+
+    *limit = 0;
+    if (setting == NULL || neu_parse_param(setting, NULL, 1, &elem) != 0) {
+        return 0;
+    }
+    if (elem.v.val_int < 0 || elem.v.val_int > (int64_t)(SIZE_MAX / 1024)) {
+        return -1;
+    }
+
+    *limit = (size_t) elem.v.val_int * 1024;
+    return 0;
+}
+
+// the cache retentions in the params of the setting of a driver, none for an
+// app, -1 if they are malformed
+static int adapter_parse_retentions(neu_adapter_t *adapter, const char *setting,
+                                    neu_json_cache_retentions_t *retentions)
+{
+    memset(retentions, 0, sizeof(*retentions));
+    if (adapter->module->type != NEU_NA_TYPE_DRIVER) {
+        return 0;
+    }
+    return neu_json_decode_cache_retentions(setting, retentions);
+}
+
+static void adapter_apply_retentions(neu_adapter_t *              adapter,
+                                     neu_json_cache_retentions_t *retentions)
+{
+    if (adapter->module->type == NEU_NA_TYPE_DRIVER) {
+        neu_adapter_driver_set_retentions((neu_adapter_driver_t *) adapter,
+                                          retentions);
+    }
+    neu_json_decode_cache_retentions_fini(retentions);
+}
+
+// the placement in the params of a node setting, -1 if it is malformed.
+// cpu_affinity is a cpu list or auto, and goes before numa_node
+static int adapter_parse_place(const char *setting, adapter_place_t *place)
+{
+    neu_json_elem_t affinity = { .name = "cpu_affinity", .t = NEU_JSON_STR };
+    neu_json_elem_t numa     = { .name = "numa_node", .t = NEU_JSON_INT };
+    int             rv       = 0;
+
+    memset(place, 0, sizeof(*place));
+    place->policy = SCHED_OTHER;
+    if (setting == NULL) {
+        return 0;
+    }
+    if (adapter_parse_sched(setting, place) != 0) {
+        return -1;
+    }
+
+    if (neu_parse_param(setting, NULL, 1, &affinity) == 0) {
+        if (strcmp(affinity.v.val_str, "auto") == 0) {
+            place->automatic = true;
+        } else if (neu_cpus_parse(affinity.v.val_str, &place->cpus) == 0) {
+            place->pinned = true;
+        } else {
+            rv = -1;
+        }
+        free(affinity.v.val_str);
+        return rv;
+    }
+
+    if (neu_parse_param(setting, NULL, 1, &numa) == 0) {
+        if (numa.v.val_int > INT32_MAX ||
+            neu_cpus_numa((int) numa.v.val_int, &place->cpus) != 0) {
+            return -1;
+        }
+        place->pinned = true;
+    }
+
+    return 0;
+}
+
+// a node placed automatically stays where it is until the manager places it
+static void adapter_apply_place(neu_adapter_t *        adapter,
+                                const adapter_place_t *place)
+{
+    __atomic_store_n(&adapter->auto_place, place->automatic,
+                     __ATOMIC_RELAXED);
+    if (place->pinned) {
+        neu_adapter_place(adapter, &place->cpus);
+    } else if (!place->automatic) {
+        neu_adapter_place(adapter, NULL);
+    }
+
+    if (adapter->module->type == NEU_NA_TYPE_DRIVER) {
+        neu_adapter_driver_set_sched((neu_adapter_driver_t *) adapter,
+                                     place->policy, place->priority);
+    }
+}
+
+void neu_adapter_place(neu_adapter_t *adapter, const neu_cpus_t *cpus)
+{
+    pthread_mutex_lock(&adapter->place_mtx);
+    if (cpus == NULL && !adapter->pinned) {
+        pthread_mutex_unlock(&adapter->place_mtx);
+        return;
+    }
+
+    neu_event_set_affinity(adapter->events, cpus);
+    for (uint16_t i = 0; i < adapter->n_consumer; ++i) {
+        neu_thread_set_affinity(adapter->consumers[i].tid, cpus);
+    }
+    if (adapter->module->type == NEU_NA_TYPE_DRIVER) {
+        neu_adapter_driver_set_affinity((neu_adapter_driver_t *) adapter,
+                                        cpus);
+    }
+
+    adapter->pinned = cpus != NULL;
+    if (cpus != NULL) {
+        adapter->cpus = *cpus;
+    }
+    pthread_mutex_unlock(&adapter->place_mtx);
+
+    nlog_notice("adapter:%s %s", adapter->name,
+                cpus != NULL ? "pinned" : "unpinned");
+}
+
+bool neu_adapter_get_cpus(neu_adapter_t *adapter, neu_cpus_t *cpus)
+{
+    bool pinned = false;
+
+    pthread_mutex_lock(&adapter->place_mtx);
+    pinned = adapter->pinned;
+    if (pinned) {
+        *cpus = adapter->cpus;
+    }
+    pthread_mutex_unlock(&adapter->place_mtx);
+
+    return pinned;
+}
+
+bool neu_adapter_auto_place(neu_adapter_t *adapter)
+{
+    return __atomic_load_n(&adapter->auto_place, __ATOMIC_RELAXED);
+}
+
 int neu_adapter_set_setting(neu_adapter_t *adapter, const char *setting)
 {
-    int rv = -1;
+    int                         rv         = -1;
+    adapter_place_t             place      = { 0 };
+    size_t                      mem_limit  = 0;
+    neu_json_cache_retentions_t retentions = { 0 };
 
     const neu_plugin_intf_funs_t *intf_funs;
 
+    if (adapter_parse_place(setting, &place) != 0 ||
+        adapter_parse_mem_limit(setting, &mem_limit) != 0 ||
+        adapter_parse_retentions(adapter, setting, &retentions) != 0) {
+        return NEU_ERR_NODE_SETTING_INVALID;
+    }
+
     intf_funs = adapter->module->intf_funs;
     rv        = intf_funs->setting(adapter->plugin, setting);
     if (rv == 0) {
+        adapter_apply_place(adapter, &place);
+        adapter->mem_limit = mem_limit;
+        adapter_apply_retentions(adapter, &retentions);
         if (adapter->setting != NULL) {
             free(adapter->setting);
         }
@@ -1450,6 +2540,7 @@ int neu_adapter_set_setting(neu_adapter_t *adapter, const char *setting)
             neu_adapter_start(adapter);
         }
     } else {
+        neu_json_decode_cache_retentions_fini(&retentions);
         rv = NEU_ERR_NODE_SETTING_INVALID;
     }
 
@@ -1510,6 +2601,10 @@ int neu_adapter_update_group_metric(neu_adapter_t *adapter,
         return -1;
     }
 
+    if (neu_metrics_off & NEU_METRICS_OFF_GROUP) {
+        return 0;
+    }
+
     return neu_node_metrics_update(adapter->metrics, group_name, metric_name,
                                    n);
 }
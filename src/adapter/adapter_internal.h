@@ -23,11 +23,20 @@
 #include "define.h"
 #include "event/event.h"
 #include "plugin.h"
+#include "utils/affinity.h"
 
 #include "adapter_info.h"
 #include "core/manager.h"
 #include "msg_q.h"
 
+// a trans data consumer thread of an app, popping from a queue of its own
+typedef struct {
+    neu_adapter_t *  adapter;
+    uint16_t         index;
+    adapter_msg_q_t *msg_q;
+    pthread_t        tid;
+} adapter_consumer_t;
+
 struct neu_adapter {
     char *name;
     char *setting;
@@ -40,25 +49,64 @@ struct neu_adapter {
     neu_plugin_module_t *module;
     neu_plugin_t *       plugin;
 
+    // Each adapter has its own lane per kind of traffic, so one kind can not
+    // queue up behind another:
+    //  - control: commands and responses of the manager, on control_fd
+    //  - data: trans data for apps, direct reads and writes for drivers, on
+    //    trans_data_fd, an app queues trans data into the msg_q of one of
+    //    its consumers, by the hash of the driver and group
+    //  - reply: responses of the direct reads and writes of an app, on
+    //    reply_fd, apps only
     neu_event_io_t *control_io;
     neu_event_io_t *trans_data_io;
+    neu_event_io_t *reply_io;
+    neu_event_io_t *control_bus_io;
+    neu_event_io_t *trans_data_bus_io;
+    neu_event_io_t *reply_bus_io;
 
     int control_fd;
     int trans_data_fd;
+    int reply_fd;
 
-    adapter_msg_q_t *msg_q;
-    pthread_t        consumer_tid;
+    // more than one only for plugins with concurrent_trans_data, see
+    // neu_adapter_set_app_consumers
+    adapter_consumer_t consumers[NEU_APP_CONSUMERS_MAX];
+    uint16_t           n_consumer; // fixed at creation, a reload keeps it
+    uint16_t           n_congested; // consumers above their high water mark
+    // read by the consumers, written by a plugin reload
+    pthread_rwlock_t plugin_mtx;
 
     uint16_t trans_data_port;
+    uint16_t reply_port;
 
     neu_events_t *events;
 
+    // the cpus the threads of the node run on, from cpu_affinity or
+    // numa_node in the params of its setting, see neu_adapter_place
+    pthread_mutex_t place_mtx;
+    bool            pinned;
+    bool            auto_place; // where the app it reports to most runs
+    neu_cpus_t      cpus;
+
     neu_event_timer_t *timer_lev;
     int64_t            timestamp_lev;
 
+    // the memory the node accounts against the budget, see mem_budget.h,
+    // refreshed by timer_mem, and the limit of the node alone, mem_limit in
+    // the params of its setting
+    neu_event_timer_t *timer_mem;
+    size_t             mem_bytes;
+    size_t             mem_limit;
+    bool               mem_over;
+
     // metrics
     neu_node_metrics_t *metrics;
+    neu_metric_entry_t *queue_ms; // msg_q dwell time, set after registration
     int                 log_level;
+
+    // refresh the metrics the node does not update as it goes, called by the
+    // metrics of neuron-base on a visit, which can not call into the adapter
+    void (*sample_metrics)(neu_adapter_t *adapter);
 };
 
 typedef void (*adapter_handler)(neu_adapter_t *     adapter,
@@ -72,6 +120,12 @@ int  neu_adapter_error();
 void neu_adapter_set_error(int error);
 
 uint16_t neu_adapter_trans_data_port(neu_adapter_t *adapter);
+// whether the app at addr has its trans data queue above the high water mark
+bool neu_adapter_app_congested(const struct sockaddr_un *addr);
+// trans data consumer threads of the apps created from now on, from 1 up to
+// NEU_APP_CONSUMERS_MAX, the apps whose plugins do not set
+// concurrent_trans_data have one
+void neu_adapter_set_app_consumers(uint16_t n);
 
 neu_adapter_t *neu_adapter_create(neu_adapter_info_t *info, bool load);
 void neu_adapter_init(neu_adapter_t *adapter, neu_node_running_state_e state);
@@ -81,6 +135,8 @@ int neu_adapter_rename(neu_adapter_t *adapter, const char *new_name);
 int neu_adapter_start(neu_adapter_t *adapter);
 int neu_adapter_start_single(neu_adapter_t *adapter);
 int neu_adapter_stop(neu_adapter_t *adapter);
+// stop a running node without recording it, the node is ready again
+int neu_adapter_suspend(neu_adapter_t *adapter);
 
 neu_node_type_e      neu_adapter_get_type(neu_adapter_t *adapter);
 neu_tag_cache_type_e neu_adapter_get_tag_cache_type(neu_adapter_t *adapter);
@@ -93,6 +149,12 @@ neu_event_timer_t *neu_adapter_add_timer(neu_adapter_t *         adapter,
 void neu_adapter_del_timer(neu_adapter_t *adapter, neu_event_timer_t *timer);
 
 int neu_adapter_set_setting(neu_adapter_t *adapter, const char *config);
+// pin every thread of the node to cpus, NULL to unpin them
+void neu_adapter_place(neu_adapter_t *adapter, const neu_cpus_t *cpus);
+// the cpus the node is pinned to, false if it is not
+bool neu_adapter_get_cpus(neu_adapter_t *adapter, neu_cpus_t *cpus);
+// whether the node is placed where its main subscriber runs
+bool neu_adapter_auto_place(neu_adapter_t *adapter);
 int neu_adapter_get_setting(neu_adapter_t *adapter, char **config);
 neu_node_state_t neu_adapter_get_state(neu_adapter_t *adapter);
 
@@ -18,115 +18,846 @@
  **/
 
 #include <assert.h>
+#include <limits.h>
 #include <math.h>
 #include <pthread.h>
+#include <stdio.h>
 #include <string.h>
 
+#include "utils/history.h"
 #include "utils/uthash.h"
+#include "utils/utlist.h"
 
 #include "define.h"
+#include "errcodes.h"
 #include "tag.h"
 
 #include "cache.h"
 
+// how the values a plugin writes for a tag become the values reported
 typedef struct {
-    char group[NEU_GROUP_NAME_LEN];
-    char tag[NEU_TAG_NAME_LEN];
-} tkey_t;
+    uint8_t type;   // of the tag, 0 to store values as written
+    uint8_t endian; // neu_datatag_endian_e of the option fitting type
+    double  decimal;
+} elem_conv_t;
+
+// the deadband of a tag and what it is measured against, the times are
+// those of the samples so that a quiet device holds nothing back
+typedef struct {
+    neu_tag_deadband_t config;
+    bool               has_ref;
+    double             ref;       // the last value let through
+    int64_t            report_ts; // sample time of the last report
+} elem_band_t;
 
 struct elem {
     int64_t timestamp;
     bool    changed;
 
-    neu_dvalue_t value;
+    elem_conv_t  conv;
+    neu_cvalue_t value;
+    // NEU_TAG_META_SIZE slots, NULL while the plugin reports no meta
+    neu_tag_meta_t *metas;
+    // NULL for a tag reporting every change
+    elem_band_t *band;
+    // the recent numeric values, NULL unless the cache keeps history
+    neu_history_t *history;
+    // of the tag definition, 0 for values cached without one
+    uint8_t  attribute;
+    uint16_t poll_divisor;
+    // value changes stored since neu_driver_cache_take_changes
+    uint32_t n_change;
 
-    neu_tag_meta_t metas[NEU_TAG_META_SIZE];
+    // the sequence number of the group at the last change, 0 before any
+    uint64_t     seq;
+    struct elem *prev, *next; // in the change list of the group
+    // whether the band reports on intervals, see elem_report_due
+    bool         timed;
+    struct elem *timed_prev, *timed_next;
+    // stale once the value aged out, read as NEU_ERR_PLUGIN_TAG_VALUE_EXPIRED
+    // until the next read of the tag, see neu_driver_cache_expire, or held,
+    // read as it is with a stale meta, see neu_driver_cache_hold
+    bool         stale;
+    bool         held;
+    bool         aging;
+    struct elem *aging_prev, *aging_next;
 
-    tkey_t         key;
+    struct group * grp;
+    char           tag[NEU_TAG_NAME_LEN];
     UT_hash_handle hh;
 };
 
-struct neu_driver_cache {
+// the tags of one group, updated by the plugin and read by the report timer
+// of that group only, so each group carries its own lock
+struct group {
+    char            name[NEU_GROUP_NAME_LEN];
     pthread_mutex_t mtx;
+    struct elem *   tags;
+    // every change takes the next sequence number and moves the tag to the
+    // end of the change list, so the changes after a cursor are a walk back
+    // from the end
+    uint64_t     seq;
+    struct elem *changes;
+    // the tags reported on the intervals of their band, which a cursor does
+    // not capture, looked at on every walk of the reporter
+    struct elem *timed;
+    // the tags that may go stale, least recently read first
+    struct elem *  aging;
+    UT_hash_handle hh;
+};
 
-    struct elem *table;
+#define LKV_MAGIC "NEULKV"
+// 2: values are saved normalized as they are reported
+#define LKV_FORMAT 2
+
+typedef struct {
+    char     magic[8];
+    uint32_t format;
+    uint32_t n_record;
+} lkv_header_t;
+
+typedef struct {
+    char         group[NEU_GROUP_NAME_LEN];
+    char         tag[NEU_TAG_NAME_LEN];
+    int64_t      timestamp;
+    neu_dvalue_t value;
+} lkv_record_t;
+
+struct neu_driver_cache {
+    // write locked only when a group is added or removed
+    pthread_rwlock_t rwlock;
+    // bumped under the write lock whenever an elem is added or freed
+    uint64_t gen;
+    // bytes of history kept per tag, 0 for none
+    size_t history_size;
+    // the highest sequence number of the groups freed, a group added again
+    // counts on from it so that the cursors of its consumers stay valid
+    uint64_t seq;
+
+    struct group *groups;
 };
 
-// static void update_tag_error(neu_driver_cache_t *cache, const char *group,
-// const char *tag, int64_t timestamp, int error);
+size_t neu_driver_cache_elem_size()
+{
+    return sizeof(struct elem);
+}
+
+static inline void elem_free(struct elem *elem)
+{
+    neu_cvalue_fini(&elem->value);
+    free(elem->metas);
+    free(elem->band);
+    neu_history_free(elem->history);
+    free(elem);
+}
+
+static void group_free(struct group *grp)
+{
+    struct elem *elem = NULL;
+    struct elem *tmp  = NULL;
+
+    HASH_ITER(hh, grp->tags, elem, tmp)
+    {
+        HASH_DEL(grp->tags, elem);
+        elem_free(elem);
+    }
+    pthread_mutex_destroy(&grp->mtx);
+    free(grp);
+}
+
+// must be called with the cache write locked
+static void cache_group_free(neu_driver_cache_t *cache, struct group *grp)
+{
+    HASH_DEL(cache->groups, grp);
+    if (grp->seq > cache->seq) {
+        cache->seq = grp->seq;
+    }
+    group_free(grp);
+}
+
+static void elem_unlink(struct elem *elem)
+{
+    if (elem->seq > 0) {
+        DL_DELETE2(elem->grp->changes, elem, prev, next);
+    }
+    if (elem->timed) {
+        DL_DELETE2(elem->grp->timed, elem, timed_prev, timed_next);
+    }
+    if (elem->aging) {
+        DL_DELETE2(elem->grp->aging, elem, aging_prev, aging_next);
+    }
+}
+
+static void elem_stamp(struct elem *elem)
+{
+    struct group *grp = elem->grp;
+
+    if (elem->seq > 0) {
+        DL_DELETE2(grp->changes, elem, prev, next);
+    }
+    grp->seq += 1;
+    elem->seq = grp->seq;
+    DL_APPEND2(grp->changes, elem, prev, next);
+}
+
+// the tag was read at timestamp, it moves to the end of the aging list of its
+// group unless it never expires. Returns whether the tag was stale or held
+static bool elem_touch(struct elem *elem, int64_t timestamp)
+{
+    struct group *grp   = elem->grp;
+    bool          stale = elem->stale || elem->held;
+
+    elem->timestamp = timestamp;
+    elem->stale     = false;
+    elem->held      = false;
+    if (elem->aging) {
+        DL_DELETE2(grp->aging, elem, aging_prev, aging_next);
+    }
+    elem->aging = (elem->attribute & NEU_ATTRIBUTE_STATIC) == 0;
+    if (elem->aging) {
+        DL_APPEND2(grp->aging, elem, aging_prev, aging_next);
+    }
+
+    return stale;
+}
+
+static void elem_set_timed(struct elem *elem)
+{
+    bool timed = elem->band != NULL &&
+        (elem->band->config.min_interval > 0 ||
+         elem->band->config.max_interval > 0);
+
+    if (timed && !elem->timed) {
+        DL_APPEND2(elem->grp->timed, elem, timed_prev, timed_next);
+    } else if (!timed && elem->timed) {
+        DL_DELETE2(elem->grp->timed, elem, timed_prev, timed_next);
+    }
+    elem->timed = timed;
+}
+
+// must be called with the cache rwlock held, returns with the group locked
+static struct elem *find_elem(neu_driver_cache_t *cache, const char *group,
+                              const char *tag, struct group **grp_p)
+{
+    struct group *grp  = NULL;
+    struct elem * elem = NULL;
+
+    HASH_FIND_STR(cache->groups, group, grp);
+    if (grp == NULL) {
+        return NULL;
+    }
+
+    pthread_mutex_lock(&grp->mtx);
+    HASH_FIND_STR(grp->tags, tag, elem);
+    if (elem == NULL) {
+        pthread_mutex_unlock(&grp->mtx);
+        return NULL;
+    }
+
+    *grp_p = grp;
+    return elem;
+}
+
+static void elem_copy(struct elem *elem, neu_driver_cache_value_t *value,
+                      neu_tag_meta_t *metas, int n_meta)
+{
+    value->timestamp = elem->timestamp;
+    if (elem->stale) {
+        value->value.type      = NEU_TYPE_ERROR;
+        value->value.value.i32 = NEU_ERR_PLUGIN_TAG_VALUE_EXPIRED;
+    } else {
+        neu_cvalue_get(&elem->value, &value->value);
+    }
+
+    assert(n_meta <= NEU_TAG_META_SIZE);
+    if (elem->metas == NULL) {
+        memset(metas, 0, sizeof(neu_tag_meta_t) * NEU_TAG_META_SIZE);
+        return;
+    }
+
+    memcpy(metas, elem->metas, sizeof(neu_tag_meta_t) * NEU_TAG_META_SIZE);
+    for (int i = 0; i < NEU_TAG_META_SIZE; i++) {
+        if (strlen(elem->metas[i].name) > 0) {
+            memcpy(&value->metas[i], &elem->metas[i],
+                   sizeof(neu_tag_meta_t));
+        }
+    }
+}
+
+// a held value carries the time it was read at in a stale meta, in the first
+// free slot unless the value is restored and has one already
+static void elem_get(struct elem *elem, neu_driver_cache_value_t *value,
+                     neu_tag_meta_t *metas, int n_meta)
+{
+    int slot = -1;
+
+    elem_copy(elem, value, metas, n_meta);
+    if (!elem->held) {
+        return;
+    }
+
+    for (int i = NEU_TAG_META_SIZE - 1; i >= 0; i--) {
+        if (strcmp(metas[i].name, NEU_DRIVER_CACHE_META_STALE) == 0) {
+            return;
+        }
+        if (strlen(metas[i].name) == 0) {
+            slot = i;
+        }
+    }
+
+    if (slot >= 0) {
+        memset(&metas[slot], 0, sizeof(neu_tag_meta_t));
+        strcpy(metas[slot].name, NEU_DRIVER_CACHE_META_STALE);
+        metas[slot].value.type      = NEU_TYPE_INT64;
+        metas[slot].value.value.i64 = elem->timestamp;
+        memcpy(&value->metas[slot], &metas[slot], sizeof(neu_tag_meta_t));
+    }
+}
+
+static void conv_init(elem_conv_t *conv, const neu_datatag_t *def)
+{
+    memset(conv, 0, sizeof(*conv));
+    if (def == NULL) {
+        return;
+    }
+
+    conv->type    = def->type;
+    conv->decimal = def->decimal;
+    switch (def->type) {
+    case NEU_TYPE_UINT16:
+    case NEU_TYPE_INT16:
+        conv->endian = def->option.value16.endian;
+        break;
+    case NEU_TYPE_FLOAT:
+    case NEU_TYPE_UINT32:
+    case NEU_TYPE_INT32:
+        conv->endian = def->option.value32.endian;
+        break;
+    case NEU_TYPE_DOUBLE:
+    case NEU_TYPE_INT64:
+    case NEU_TYPE_UINT64:
+        conv->endian = def->option.value64.endian;
+        break;
+    default:
+        break;
+    }
+}
+
+static void conv_endian(const elem_conv_t *conv, neu_value_u *value)
+{
+    switch (conv->type) {
+    case NEU_TYPE_UINT16:
+    case NEU_TYPE_INT16:
+        if (conv->endian == NEU_DATATAG_ENDIAN_B16) {
+            value->u16 = htons(value->u16);
+        }
+        break;
+    case NEU_TYPE_FLOAT:
+    case NEU_TYPE_UINT32:
+    case NEU_TYPE_INT32:
+        switch (conv->endian) {
+        case NEU_DATATAG_ENDIAN_BL32:
+            value->u32 = htonl(value->u32);
+            /* fallthrough */
+        case NEU_DATATAG_ENDIAN_LB32:
+            neu_htons_p((uint16_t *) value->bytes.bytes);
+            neu_htons_p((uint16_t *) (value->bytes.bytes + 2));
+            break;
+        case NEU_DATATAG_ENDIAN_BB32:
+            value->u32 = htonl(value->u32);
+            break;
+        default:
+            break;
+        }
+        break;
+    case NEU_TYPE_DOUBLE:
+    case NEU_TYPE_INT64:
+    case NEU_TYPE_UINT64:
+        if (conv->endian == NEU_DATATAG_ENDIAN_B64) {
+            value->u64 = neu_htonll(value->u64);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+static void conv_decimal(const elem_conv_t *conv, neu_dvalue_t *value)
+{
+    neu_value_u *v = &value->value;
+
+    value->type = NEU_TYPE_DOUBLE;
+    switch (conv->type) {
+    case NEU_TYPE_INT8:
+        v->d64 = (double) v->i8 * conv->decimal;
+        break;
+    case NEU_TYPE_UINT8:
+        v->d64 = (double) v->u8 * conv->decimal;
+        break;
+    case NEU_TYPE_INT16:
+        v->d64 = (double) v->i16 * conv->decimal;
+        break;
+    case NEU_TYPE_UINT16:
+        v->d64 = (double) v->u16 * conv->decimal;
+        break;
+    case NEU_TYPE_INT32:
+        v->d64 = (double) v->i32 * conv->decimal;
+        break;
+    case NEU_TYPE_UINT32:
+        v->d64 = (double) v->u32 * conv->decimal;
+        break;
+    case NEU_TYPE_INT64:
+        v->d64 = (double) v->i64 * conv->decimal;
+        break;
+    case NEU_TYPE_UINT64:
+        v->d64 = (double) v->u64 * conv->decimal;
+        break;
+    case NEU_TYPE_FLOAT:
+        v->d64 = (double) v->f32 * conv->decimal;
+        break;
+    case NEU_TYPE_DOUBLE:
+        v->d64 = v->d64 * conv->decimal;
+        break;
+    default:
+        value->type = conv->type;
+        break;
+    }
+}
+
+// turn a value as the plugin wrote it into the value reported, done once
+// here instead of on every read of the cache
+static void conv_apply(const elem_conv_t *conv, neu_dvalue_t *value)
+{
+    if (conv->type == 0 || value->type == NEU_TYPE_ERROR ||
+        value->type == NEU_TYPE_PTR) {
+        return;
+    }
+
+    conv_endian(conv, &value->value);
+    if (conv->decimal != 0) {
+        conv_decimal(conv, value);
+    }
+}
+
+static bool elem_value_changed(const neu_cvalue_t *old,
+                               const neu_dvalue_t *value)
+{
+    uint16_t    length = 0;
+    const void *ext    = NULL;
+
+    if (old->type != value->type) {
+        return true;
+    }
+
+    switch (value->type) {
+    case NEU_TYPE_STRING:
+    case NEU_TYPE_BYTES:
+    case NEU_TYPE_PTR:
+        ext = neu_dvalue_ext(value, &length);
+        return old->length != length ||
+            (length > 0 && memcmp(old->value.ext, ext, length) != 0);
+    case NEU_TYPE_FLOAT:
+        if (old->precision == 0) {
+            return old->value.f32 != value->value.f32;
+        }
+        return fabs(old->value.f32 - value->value.f32) >
+            pow(0.1, old->precision);
+    case NEU_TYPE_DOUBLE:
+        if (old->precision == 0) {
+            return old->value.d64 != value->value.d64;
+        }
+        return fabs(old->value.d64 - value->value.d64) >
+            pow(0.1, old->precision);
+    case NEU_TYPE_ERROR:
+        return true;
+    default:
+        return old->value.u64 != neu_cvalue_scalar(value);
+    }
+}
+
+static bool value_number(const neu_dvalue_t *value, double *number)
+{
+    const neu_value_u *v = &value->value;
+
+    switch (value->type) {
+    case NEU_TYPE_INT8:
+        *number = v->i8;
+        return true;
+    case NEU_TYPE_UINT8:
+        *number = v->u8;
+        return true;
+    case NEU_TYPE_INT16:
+        *number = v->i16;
+        return true;
+    case NEU_TYPE_UINT16:
+    case NEU_TYPE_WORD:
+        *number = v->u16;
+        return true;
+    case NEU_TYPE_INT32:
+        *number = v->i32;
+        return true;
+    case NEU_TYPE_UINT32:
+    case NEU_TYPE_DWORD:
+        *number = v->u32;
+        return true;
+    case NEU_TYPE_INT64:
+        *number = v->i64;
+        return true;
+    case NEU_TYPE_UINT64:
+    case NEU_TYPE_LWORD:
+        *number = v->u64;
+        return true;
+    case NEU_TYPE_FLOAT:
+        *number = v->f32;
+        return true;
+    case NEU_TYPE_DOUBLE:
+        *number = v->d64;
+        return true;
+    default:
+        return false;
+    }
+}
+
+// whether value left the deadband around the last value let through, a value
+// that is no number passes on any change
+static bool elem_band_changed(struct elem *elem, const neu_dvalue_t *value)
+{
+    const neu_tag_deadband_t *config = &elem->band->config;
+    double                    number = 0;
+    double                    delta  = 0;
+
+    if ((config->absolute == 0 && config->percent == 0) ||
+        !elem->band->has_ref || !value_number(value, &number)) {
+        return elem_value_changed(&elem->value, value);
+    }
+
+    delta = fabs(number - elem->band->ref);
+    return (config->absolute > 0 && delta >= config->absolute) ||
+        (config->percent > 0 &&
+         delta >= fabs(elem->band->ref) * config->percent / 100);
+}
+
+static void elem_band_ref(struct elem *elem, const neu_dvalue_t *value)
+{
+    elem->band->has_ref = value_number(value, &elem->band->ref);
+}
+
+// whether the value is to be reported now: a change once min_interval passed
+// since the last report, an unchanged value once max_interval passed
+static bool elem_report_due(const struct elem *elem)
+{
+    const elem_band_t *band  = elem->band;
+    int64_t            since = 0;
+
+    if (band == NULL || elem->value.type == NEU_TYPE_ERROR) {
+        return elem->changed;
+    }
+
+    since = elem->timestamp - band->report_ts;
+    if (elem->changed) {
+        return since >= band->config.min_interval;
+    }
+    return band->config.max_interval > 0 &&
+        since >= band->config.max_interval;
+}
 
-inline static tkey_t to_key(const char *group, const char *tag)
+// the value was taken by the report, an error is reported until it clears
+static void elem_reported(struct elem *elem)
 {
-    tkey_t key = { 0 };
+    if (elem->value.type != NEU_TYPE_ERROR) {
+        elem->changed = false;
+        if (elem->band != NULL) {
+            elem->band->report_ts = elem->timestamp;
+        }
+    }
+}
 
-    strcpy(key.group, group);
-    strcpy(key.tag, tag);
+static void elem_set_band(struct elem *elem, const neu_tag_deadband_t *config)
+{
+    if (config == NULL || !neu_tag_deadband_is_set(config)) {
+        free(elem->band);
+        elem->band = NULL;
+    } else if (elem->band == NULL) {
+        elem->band = calloc(1, sizeof(elem_band_t));
+        if (elem->band != NULL) {
+            elem->band->config = *config;
+        }
+    } else if (memcmp(&elem->band->config, config, sizeof(*config)) != 0) {
+        elem->band->config = *config;
+    }
 
-    return key;
+    elem_set_timed(elem);
+}
+
+static void elem_set_metas(struct elem *elem, neu_tag_meta_t *metas,
+                           int n_meta)
+{
+    if (n_meta == 0) {
+        free(elem->metas);
+        elem->metas = NULL;
+        return;
+    }
+
+    if (elem->metas == NULL) {
+        elem->metas = malloc(sizeof(neu_tag_meta_t) * NEU_TAG_META_SIZE);
+        if (elem->metas == NULL) {
+            return;
+        }
+    }
+
+    memset(elem->metas, 0, sizeof(neu_tag_meta_t) * NEU_TAG_META_SIZE);
+    for (int i = 0; i < n_meta; i++) {
+        memcpy(&elem->metas[i], &metas[i], sizeof(neu_tag_meta_t));
+    }
+}
+
+static bool elem_written(const struct elem *elem)
+{
+    for (int i = 0; elem->metas != NULL && i < NEU_TAG_META_SIZE; i++) {
+        if (strcmp(elem->metas[i].name, NEU_DRIVER_CACHE_META_WRITTEN) == 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// store a value that is already normalized
+static void elem_store(struct elem *elem, int64_t timestamp,
+                       const neu_dvalue_t *value, neu_tag_meta_t *metas,
+                       int n_meta, bool change)
+{
+    // the precision is the tag's, set once when the tag was added
+    uint8_t precision = elem->value.precision;
+    double  number    = 0;
+
+    // a value back from stale is a change whatever it is
+    change = elem_touch(elem, timestamp) || change;
+    if (elem->band != NULL) {
+        if (change || elem_band_changed(elem, value)) {
+            elem->changed = true;
+            elem->n_change += 1;
+            elem_band_ref(elem, value);
+            elem_stamp(elem);
+        }
+    } else if (change || elem_value_changed(&elem->value, value)) {
+        elem->changed = true;
+        elem->n_change += 1;
+        elem_stamp(elem);
+    }
+
+    neu_cvalue_set(&elem->value, value);
+    elem->value.precision = precision;
+
+    // every sample is kept, an unchanged one takes two bits
+    if (elem->history != NULL && value_number(value, &number)) {
+        neu_history_append(elem->history, timestamp, number);
+    }
+
+    elem_set_metas(elem, metas, n_meta);
+}
+
+static void elem_update(struct elem *elem, int64_t timestamp,
+                        neu_dvalue_t value, neu_tag_meta_t *metas, int n_meta,
+                        bool change)
+{
+    conv_apply(&elem->conv, &value);
+    elem_store(elem, timestamp, &value, metas, n_meta, change);
 }
 
 neu_driver_cache_t *neu_driver_cache_new()
 {
     neu_driver_cache_t *cache = calloc(1, sizeof(neu_driver_cache_t));
 
-    pthread_mutex_init(&cache->mtx, NULL);
+    pthread_rwlock_init(&cache->rwlock, NULL);
 
     return cache;
 }
 
 void neu_driver_cache_destroy(neu_driver_cache_t *cache)
 {
-    struct elem *elem = NULL;
-    struct elem *tmp  = NULL;
+    struct group *grp = NULL;
+    struct group *tmp = NULL;
 
-    pthread_mutex_lock(&cache->mtx);
-    HASH_ITER(hh, cache->table, elem, tmp)
+    pthread_rwlock_wrlock(&cache->rwlock);
+    HASH_ITER(hh, cache->groups, grp, tmp)
     {
-        HASH_DEL(cache->table, elem);
-        if (elem->value.type == NEU_TYPE_PTR) {
-            if (elem->value.value.ptr.ptr != NULL) {
-                free(elem->value.value.ptr.ptr);
-                elem->value.value.ptr.ptr = NULL;
-            }
-        }
-        free(elem);
+        HASH_DEL(cache->groups, grp);
+        group_free(grp);
     }
-    pthread_mutex_unlock(&cache->mtx);
+    pthread_rwlock_unlock(&cache->rwlock);
 
-    pthread_mutex_destroy(&cache->mtx);
+    pthread_rwlock_destroy(&cache->rwlock);
 
     free(cache);
 }
 
-// void neu_driver_cache_error(neu_driver_cache_t *cache, const char *group,
-// const char *tag, int64_t timestamp, int32_t error)
-//{
-// update_tag_error(cache, group, tag, timestamp, error);
-//}
-
 void neu_driver_cache_add(neu_driver_cache_t *cache, const char *group,
-                          const char *tag, neu_dvalue_t value)
+                          const char *tag, const neu_datatag_t *def,
+                          neu_dvalue_t value)
 {
-    struct elem *elem = NULL;
-    tkey_t       key  = to_key(group, tag);
+    struct group *grp  = NULL;
+    struct elem * elem = NULL;
 
-    pthread_mutex_lock(&cache->mtx);
-    HASH_FIND(hh, cache->table, &key, sizeof(tkey_t), elem);
+    pthread_rwlock_wrlock(&cache->rwlock);
+    HASH_FIND_STR(cache->groups, group, grp);
+    if (grp == NULL) {
+        grp = calloc(1, sizeof(struct group));
 
+        strcpy(grp->name, group);
+        pthread_mutex_init(&grp->mtx, NULL);
+        grp->seq = cache->seq;
+
+        HASH_ADD_STR(cache->groups, name, grp);
+    }
+
+    HASH_FIND_STR(grp->tags, tag, elem);
     if (elem == NULL) {
         elem = calloc(1, sizeof(struct elem));
 
-        strcpy(elem->key.group, group);
-        strcpy(elem->key.tag, tag);
+        strcpy(elem->tag, tag);
+        elem->grp = grp;
+        if (cache->history_size > 0) {
+            elem->history = neu_history_new(cache->history_size);
+        }
 
-        HASH_ADD(hh, cache->table, key, sizeof(tkey_t), elem);
+        HASH_ADD_STR(grp->tags, tag, elem);
+        cache->gen += 1;
     }
 
-    elem->timestamp = 0;
-    elem->changed   = false;
-    elem->value     = value;
+    conv_init(&elem->conv, def);
+    elem->attribute    = def != NULL ? def->attribute : 0;
+    elem->poll_divisor = def != NULL ? def->poll_divisor : 0;
+    elem_set_band(elem, def != NULL ? &def->deadband : NULL);
+    conv_apply(&elem->conv, &value);
+    elem->changed = false;
+    neu_cvalue_set(&elem->value, &value);
+
+    // never read, first in line to go stale
+    elem_touch(elem, 0);
+    if (elem->aging) {
+        DL_DELETE2(grp->aging, elem, aging_prev, aging_next);
+        DL_PREPEND2(grp->aging, elem, aging_prev, aging_next);
+    }
+
+    pthread_rwlock_unlock(&cache->rwlock);
+}
+
+void neu_driver_cache_set_history(neu_driver_cache_t *cache, size_t size)
+{
+    pthread_rwlock_wrlock(&cache->rwlock);
+    cache->history_size = size;
+    pthread_rwlock_unlock(&cache->rwlock);
+}
+
+size_t neu_driver_cache_shrink_history(neu_driver_cache_t *cache)
+{
+    struct group *grp   = NULL;
+    struct group *tmp   = NULL;
+    size_t        freed = 0;
+
+    pthread_rwlock_wrlock(&cache->rwlock);
+    cache->history_size /= 2;
+    HASH_ITER(hh, cache->groups, grp, tmp)
+    {
+        struct elem *elem = NULL;
+        struct elem *etmp = NULL;
+
+        HASH_ITER(hh, grp->tags, elem, etmp)
+        {
+            if (elem->history != NULL) {
+                freed += neu_history_shrink(elem->history, cache->history_size);
+            }
+        }
+    }
+    pthread_rwlock_unlock(&cache->rwlock);
 
-    pthread_mutex_unlock(&cache->mtx);
+    return freed;
+}
+
+static size_t elem_mem_bytes(const struct elem *elem)
+{
+    size_t bytes = sizeof(*elem);
+
+    if (neu_cvalue_inline_size((neu_type_e) elem->value.type) == 0) {
+        bytes += elem->value.length;
+    }
+    if (elem->metas != NULL) {
+        bytes += NEU_TAG_META_SIZE * sizeof(neu_tag_meta_t);
+    }
+    if (elem->band != NULL) {
+        bytes += sizeof(elem_band_t);
+    }
+    if (elem->history != NULL) {
+        bytes += neu_history_size(elem->history);
+    }
+
+    return bytes;
+}
+
+size_t neu_driver_cache_mem_bytes(neu_driver_cache_t *cache)
+{
+    struct group *grp   = NULL;
+    struct group *tmp   = NULL;
+    size_t        bytes = sizeof(*cache);
+
+    pthread_rwlock_rdlock(&cache->rwlock);
+    HASH_ITER(hh, cache->groups, grp, tmp)
+    {
+        struct elem *elem = NULL;
+        struct elem *etmp = NULL;
+
+        bytes += sizeof(*grp);
+        pthread_mutex_lock(&grp->mtx);
+        HASH_ITER(hh, grp->tags, elem, etmp)
+        {
+            bytes += elem_mem_bytes(elem);
+        }
+        pthread_mutex_unlock(&grp->mtx);
+    }
+    pthread_rwlock_unlock(&cache->rwlock);
+
+    return bytes;
+}
+
+int neu_driver_cache_history(neu_driver_cache_t *cache, const char *group,
+                             const char *tag, int64_t since, int64_t until,
+                             int64_t step, uint32_t max, UT_array *points)
+{
+    struct group *grp  = NULL;
+    struct elem * elem = NULL;
+    int           ret  = -1;
+
+    pthread_rwlock_rdlock(&cache->rwlock);
+    elem = find_elem(cache, group, tag, &grp);
+    if (elem != NULL) {
+        if (elem->history != NULL) {
+            ret = neu_history_query(elem->history, since, until, step, max,
+                                    points);
+        }
+        pthread_mutex_unlock(&grp->mtx);
+    }
+
+    pthread_rwlock_unlock(&cache->rwlock);
+
+    return ret;
+}
+
+void neu_driver_cache_set_deadband(neu_driver_cache_t *cache, const char *group,
+                                   const char *              tag,
+                                   const neu_tag_deadband_t *band)
+{
+    struct group *grp  = NULL;
+    struct elem * elem = NULL;
+
+    pthread_rwlock_rdlock(&cache->rwlock);
+    elem = find_elem(cache, group, tag, &grp);
+    if (elem != NULL) {
+        elem_set_band(elem, band);
+        pthread_mutex_unlock(&grp->mtx);
+    }
+
+    pthread_rwlock_unlock(&cache->rwlock);
 }
 
 void neu_driver_cache_update_change(neu_driver_cache_t *cache,
@@ -135,112 +866,148 @@ void neu_driver_cache_update_change(neu_driver_cache_t *cache,
                                     neu_tag_meta_t *metas, int n_meta,
                                     bool change)
 {
-    struct elem *elem = NULL;
-    tkey_t       key  = to_key(group, tag);
+    struct group *grp  = NULL;
+    struct elem * elem = NULL;
 
-    pthread_mutex_lock(&cache->mtx);
-    HASH_FIND(hh, cache->table, &key, sizeof(tkey_t), elem);
+    pthread_rwlock_rdlock(&cache->rwlock);
+    elem = find_elem(cache, group, tag, &grp);
     if (elem != NULL) {
-        elem->timestamp = timestamp;
-        if (elem->value.type != value.type) {
-            elem->changed = true;
-        } else {
-            switch (value.type) {
-            case NEU_TYPE_INT8:
-            case NEU_TYPE_UINT8:
-            case NEU_TYPE_INT16:
-            case NEU_TYPE_UINT16:
-            case NEU_TYPE_INT32:
-            case NEU_TYPE_UINT32:
-            case NEU_TYPE_INT64:
-            case NEU_TYPE_UINT64:
-            case NEU_TYPE_BIT:
-            case NEU_TYPE_BOOL:
-            case NEU_TYPE_STRING:
-            case NEU_TYPE_WORD:
-            case NEU_TYPE_DWORD:
-            case NEU_TYPE_LWORD:
-                if (memcmp(&elem->value.value, &value.value,
-                           sizeof(value.value)) != 0) {
-                    elem->changed = true;
-                }
-                break;
-            case NEU_TYPE_BYTES:
-                if (elem->value.value.bytes.length !=
-                    value.value.bytes.length) {
-                    elem->changed = true;
-                } else {
-                    if (memcpy(elem->value.value.bytes.bytes,
-                               value.value.bytes.bytes,
-                               value.value.bytes.length) != 0) {
-                        elem->changed = true;
-                    }
-                }
-                break;
-            case NEU_TYPE_PTR: {
-                if (elem->value.value.ptr.length != value.value.ptr.length) {
-                    elem->changed = true;
-                } else {
-                    if (memcmp(elem->value.value.ptr.ptr, value.value.ptr.ptr,
-                               value.value.ptr.length) != 0) {
-                        elem->changed = true;
-                    }
-                }
-
-                break;
-            }
-            case NEU_TYPE_FLOAT:
-                if (elem->value.precision == 0) {
-                    elem->changed = elem->value.value.f32 != value.value.f32;
-                } else {
-                    if (fabs(elem->value.value.f32 - value.value.f32) >
-                        pow(0.1, elem->value.precision)) {
-                        elem->changed = true;
-                    }
-                }
-                break;
-            case NEU_TYPE_DOUBLE:
-                if (elem->value.precision == 0) {
-                    elem->changed = elem->value.value.d64 != value.value.d64;
-                } else {
-                    if (fabs(elem->value.value.d64 - value.value.d64) >
-                        pow(0.1, elem->value.precision)) {
-                        elem->changed = true;
-                    }
-                }
-
-                break;
-            case NEU_TYPE_ERROR:
-                elem->changed = true;
-                break;
+        elem_update(elem, timestamp, value, metas, n_meta, change);
+        pthread_mutex_unlock(&grp->mtx);
+    }
+
+    pthread_rwlock_unlock(&cache->rwlock);
+}
+
+void neu_driver_cache_restore(neu_driver_cache_t *cache, const char *group,
+                              const char *tag, int64_t timestamp,
+                              neu_dvalue_t value, neu_tag_meta_t *metas,
+                              int n_meta)
+{
+    struct group *grp  = NULL;
+    struct elem * elem = NULL;
+
+    pthread_rwlock_rdlock(&cache->rwlock);
+    elem = find_elem(cache, group, tag, &grp);
+    if (elem != NULL) {
+        elem_store(elem, timestamp, &value, metas, n_meta, true);
+        pthread_mutex_unlock(&grp->mtx);
+    }
+
+    pthread_rwlock_unlock(&cache->rwlock);
+}
+
+void neu_driver_cache_update_batch(neu_driver_cache_t *cache,
+                                   const char *group, int64_t timestamp, int n,
+                                   const char **tags, neu_dvalue_t *values)
+{
+    struct group *grp  = NULL;
+    struct elem * elem = NULL;
+
+    pthread_rwlock_rdlock(&cache->rwlock);
+    HASH_FIND_STR(cache->groups, group, grp);
+    if (grp != NULL) {
+        pthread_mutex_lock(&grp->mtx);
+        for (int i = 0; i < n; i++) {
+            HASH_FIND_STR(grp->tags, tags[i], elem);
+            if (elem != NULL) {
+                elem_update(elem, timestamp, values[i], NULL, 0, false);
             }
         }
+        pthread_mutex_unlock(&grp->mtx);
+    }
 
-        if (change) {
-            elem->changed = true;
+    pthread_rwlock_unlock(&cache->rwlock);
+}
+
+uint64_t neu_driver_cache_bind(neu_driver_cache_t *cache, const char *group,
+                               int n, const char **tags,
+                               neu_driver_cache_slot_t **slots)
+{
+    struct group *grp  = NULL;
+    struct elem * elem = NULL;
+    uint64_t      gen  = 0;
+
+    pthread_rwlock_rdlock(&cache->rwlock);
+    gen = cache->gen;
+    HASH_FIND_STR(cache->groups, group, grp);
+    for (int i = 0; i < n; i++) {
+        elem = NULL;
+        if (grp != NULL) {
+            HASH_FIND_STR(grp->tags, tags[i], elem);
         }
+        slots[i] = (neu_driver_cache_slot_t *) elem;
+    }
+    pthread_rwlock_unlock(&cache->rwlock);
 
-        elem->value.type = value.type;
-        if (elem->value.type == NEU_TYPE_PTR) {
-            elem->value.value.ptr.length = value.value.ptr.length;
-            elem->value.value.ptr.type   = value.value.ptr.type;
-            if (elem->value.value.ptr.ptr != NULL) {
-                free(elem->value.value.ptr.ptr);
+    return gen;
+}
+
+int neu_driver_cache_update_slots(neu_driver_cache_t *cache, const char *group,
+                                  uint64_t gen, int64_t timestamp, int n,
+                                  neu_driver_cache_slot_t **slots,
+                                  const neu_dvalue_t *      values,
+                                  const uint8_t *           filled)
+{
+    struct group *grp = NULL;
+    int           ret = -1;
+
+    pthread_rwlock_rdlock(&cache->rwlock);
+    // the elems a slot points to are only freed under the write lock, which
+    // bumps gen, so matching gens mean every bound slot is still alive
+    if (cache->gen == gen) {
+        HASH_FIND_STR(cache->groups, group, grp);
+    }
+    if (grp != NULL) {
+        pthread_mutex_lock(&grp->mtx);
+        for (int i = 0; i < n; i++) {
+            if (filled[i] && slots[i] != NULL) {
+                elem_update((struct elem *) slots[i], timestamp, values[i],
+                            NULL, 0, false);
             }
-            elem->value.value.ptr.ptr = calloc(1, value.value.ptr.length);
-            memcpy(elem->value.value.ptr.ptr, value.value.ptr.ptr,
-                   value.value.ptr.length);
-        } else {
-            elem->value.value = value.value;
         }
+        pthread_mutex_unlock(&grp->mtx);
+        ret = 0;
+    }
 
-        memset(elem->metas, 0, sizeof(neu_tag_meta_t) * NEU_TAG_META_SIZE);
-        for (int i = 0; i < n_meta; i++) {
-            memcpy(&elem->metas[i], &metas[i], sizeof(neu_tag_meta_t));
+    pthread_rwlock_unlock(&cache->rwlock);
+
+    return ret;
+}
+
+void neu_driver_cache_touch_batch(neu_driver_cache_t *cache,
+                                  const char *group, int64_t timestamp, int n,
+                                  const char **tags)
+{
+    struct group *grp  = NULL;
+    struct elem * elem = NULL;
+
+    pthread_rwlock_rdlock(&cache->rwlock);
+    HASH_FIND_STR(cache->groups, group, grp);
+    if (grp != NULL) {
+        pthread_mutex_lock(&grp->mtx);
+        for (int i = 0; i < n; i++) {
+            HASH_FIND_STR(grp->tags, tags[i], elem);
+            // the plugin compares with what it read before the write, the
+            // written value ages out unless a read tells it apart
+            if (elem != NULL && !elem_written(elem) &&
+                elem_touch(elem, timestamp)) {
+                elem->changed = true;
+                elem_stamp(elem);
+            }
         }
+        pthread_mutex_unlock(&grp->mtx);
     }
 
-    pthread_mutex_unlock(&cache->mtx);
+    pthread_rwlock_unlock(&cache->rwlock);
+}
+
+void neu_driver_cache_normalize(const neu_datatag_t *tag, neu_dvalue_t *value)
+{
+    elem_conv_t conv;
+
+    conv_init(&conv, tag);
+    conv_apply(&conv, value);
 }
 
 void neu_driver_cache_update(neu_driver_cache_t *cache, const char *group,
@@ -256,79 +1023,19 @@ int neu_driver_cache_meta_get(neu_driver_cache_t *cache, const char *group,
                               const char *tag, neu_driver_cache_value_t *value,
                               neu_tag_meta_t *metas, int n_meta)
 {
-    struct elem *elem = NULL;
-    int          ret  = -1;
-    tkey_t       key  = to_key(group, tag);
-
-    pthread_mutex_lock(&cache->mtx);
-    HASH_FIND(hh, cache->table, &key, sizeof(tkey_t), elem);
+    struct group *grp  = NULL;
+    struct elem * elem = NULL;
+    int           ret  = -1;
 
+    pthread_rwlock_rdlock(&cache->rwlock);
+    elem = find_elem(cache, group, tag, &grp);
     if (elem != NULL) {
-        value->timestamp       = elem->timestamp;
-        value->value.type      = elem->value.type;
-        value->value.precision = elem->value.precision;
-
-        assert(n_meta <= NEU_TAG_META_SIZE);
-        memcpy(metas, elem->metas, sizeof(neu_tag_meta_t) * NEU_TAG_META_SIZE);
-
-        switch (elem->value.type) {
-        case NEU_TYPE_INT8:
-        case NEU_TYPE_UINT8:
-        case NEU_TYPE_BIT:
-            value->value.value.u8 = elem->value.value.u8;
-            break;
-        case NEU_TYPE_INT16:
-        case NEU_TYPE_UINT16:
-        case NEU_TYPE_WORD:
-            value->value.value.u16 = elem->value.value.u16;
-            break;
-        case NEU_TYPE_INT32:
-        case NEU_TYPE_UINT32:
-        case NEU_TYPE_DWORD:
-        case NEU_TYPE_FLOAT:
-        case NEU_TYPE_ERROR:
-            value->value.value.u32 = elem->value.value.u32;
-            break;
-        case NEU_TYPE_INT64:
-        case NEU_TYPE_UINT64:
-        case NEU_TYPE_DOUBLE:
-        case NEU_TYPE_LWORD:
-            value->value.value.u64 = elem->value.value.u64;
-            break;
-        case NEU_TYPE_BOOL:
-            value->value.value.boolean = elem->value.value.boolean;
-            break;
-        case NEU_TYPE_STRING:
-            memcpy(value->value.value.str, elem->value.value.str,
-                   sizeof(elem->value.value.str));
-            break;
-        case NEU_TYPE_BYTES:
-            value->value.value.bytes.length = elem->value.value.bytes.length;
-            memcpy(value->value.value.bytes.bytes,
-                   elem->value.value.bytes.bytes,
-                   elem->value.value.bytes.length);
-            break;
-        case NEU_TYPE_PTR:
-            value->value.value.ptr.length = elem->value.value.ptr.length;
-            value->value.value.ptr.type   = elem->value.value.ptr.type;
-            value->value.value.ptr.ptr =
-                calloc(1, elem->value.value.ptr.length);
-            memcpy(value->value.value.ptr.ptr, elem->value.value.ptr.ptr,
-                   elem->value.value.ptr.length);
-            break;
-        }
-
-        for (int i = 0; i < NEU_TAG_META_SIZE; i++) {
-            if (strlen(elem->metas[i].name) > 0) {
-                memcpy(&value->metas[i], &elem->metas[i],
-                       sizeof(neu_tag_meta_t));
-            }
-        }
-
+        elem_get(elem, value, metas, n_meta);
+        pthread_mutex_unlock(&grp->mtx);
         ret = 0;
     }
 
-    pthread_mutex_unlock(&cache->mtx);
+    pthread_rwlock_unlock(&cache->rwlock);
 
     return ret;
 }
@@ -338,105 +1045,509 @@ int neu_driver_cache_meta_get_changed(neu_driver_cache_t *cache,
                                       neu_driver_cache_value_t *value,
                                       neu_tag_meta_t *metas, int n_meta)
 {
-    struct elem *elem = NULL;
-    int          ret  = -1;
-    tkey_t       key  = to_key(group, tag);
+    struct group *grp  = NULL;
+    struct elem * elem = NULL;
+    int           ret  = -1;
+
+    pthread_rwlock_rdlock(&cache->rwlock);
+    elem = find_elem(cache, group, tag, &grp);
+    if (elem != NULL) {
+        if (elem_report_due(elem)) {
+            elem_get(elem, value, metas, n_meta);
+            elem_reported(elem);
+            ret = 0;
+        }
+        pthread_mutex_unlock(&grp->mtx);
+    }
 
-    pthread_mutex_lock(&cache->mtx);
-    HASH_FIND(hh, cache->table, &key, sizeof(tkey_t), elem);
+    pthread_rwlock_unlock(&cache->rwlock);
 
-    if (elem != NULL && elem->changed) {
-        value->timestamp       = elem->timestamp;
-        value->value.type      = elem->value.type;
-        value->value.precision = elem->value.precision;
+    return ret;
+}
 
-        assert(n_meta <= NEU_TAG_META_SIZE);
-        memcpy(metas, elem->metas, sizeof(neu_tag_meta_t) * NEU_TAG_META_SIZE);
+static void elem_change(struct elem *elem, neu_driver_cache_change_t *change)
+{
+    memset(change, 0, sizeof(*change));
+    change->tag          = elem->tag;
+    change->attribute    = elem->attribute;
+    change->poll_divisor = elem->poll_divisor;
+    elem_get(elem, &change->value, change->value.metas, NEU_TAG_META_SIZE);
+}
 
-        switch (elem->value.type) {
-        case NEU_TYPE_INT8:
-        case NEU_TYPE_UINT8:
-        case NEU_TYPE_BIT:
-            value->value.value.u8 = elem->value.value.u8;
-            break;
-        case NEU_TYPE_INT16:
-        case NEU_TYPE_UINT16:
-        case NEU_TYPE_WORD:
-            value->value.value.u16 = elem->value.value.u16;
-            break;
-        case NEU_TYPE_INT32:
-        case NEU_TYPE_UINT32:
-        case NEU_TYPE_FLOAT:
-        case NEU_TYPE_ERROR:
-        case NEU_TYPE_DWORD:
-            value->value.value.u32 = elem->value.value.u32;
-            break;
-        case NEU_TYPE_INT64:
-        case NEU_TYPE_UINT64:
-        case NEU_TYPE_DOUBLE:
-        case NEU_TYPE_LWORD:
-            value->value.value.u64 = elem->value.value.u64;
-            break;
-        case NEU_TYPE_BOOL:
-            value->value.value.boolean = elem->value.value.boolean;
-            break;
-        case NEU_TYPE_STRING:
-            memcpy(value->value.value.str, elem->value.value.str,
-                   sizeof(elem->value.value.str));
-            break;
-        case NEU_TYPE_BYTES:
-            value->value.value.bytes.length = elem->value.value.bytes.length;
-            memcpy(value->value.value.bytes.bytes,
-                   elem->value.value.bytes.bytes,
-                   elem->value.value.bytes.length);
-            break;
-        case NEU_TYPE_PTR:
-            value->value.value.ptr.length = elem->value.value.ptr.length;
-            value->value.value.ptr.type   = elem->value.value.ptr.type;
-            value->value.value.ptr.ptr =
-                calloc(1, elem->value.value.ptr.length);
-            memcpy(value->value.value.ptr.ptr, elem->value.value.ptr.ptr,
-                   elem->value.value.ptr.length);
-            break;
+int neu_driver_cache_changes(neu_driver_cache_t *cache, const char *group,
+                             uint8_t attribute, bool timed, uint64_t *cursor,
+                             neu_driver_cache_change_cb_t cb, void *arg)
+{
+    struct group *            grp    = NULL;
+    struct elem *             elem   = NULL;
+    struct elem *             first  = NULL;
+    neu_driver_cache_change_t change = { 0 };
+    int                       n      = 0;
+
+    pthread_rwlock_rdlock(&cache->rwlock);
+    HASH_FIND_STR(cache->groups, group, grp);
+    if (grp == NULL) {
+        pthread_rwlock_unlock(&cache->rwlock);
+        return -1;
+    }
+
+    pthread_mutex_lock(&grp->mtx);
+    if (*cursor > grp->seq) {
+        *cursor = 0;
+    }
+
+    // the head of the list links back to its tail
+    elem = grp->changes != NULL ? grp->changes->prev : NULL;
+    while (elem != NULL && elem->seq > *cursor) {
+        first = elem;
+        elem  = elem == grp->changes ? NULL : elem->prev;
+    }
+
+    for (elem = first; elem != NULL; elem = elem->next) {
+        if (!elem->timed && (elem->attribute & attribute) == attribute) {
+            elem_change(elem, &change);
+            cb(arg, &change);
+            n += 1;
         }
+    }
+    *cursor = grp->seq;
 
-        for (int i = 0; i < NEU_TAG_META_SIZE; i++) {
-            if (strlen(elem->metas[i].name) > 0) {
-                memcpy(&value->metas[i], &elem->metas[i],
-                       sizeof(neu_tag_meta_t));
-            }
+    for (elem = timed ? grp->timed : NULL; elem != NULL;
+         elem = elem->timed_next) {
+        if ((elem->attribute & attribute) == attribute &&
+            elem_report_due(elem)) {
+            elem_change(elem, &change);
+            elem_reported(elem);
+            cb(arg, &change);
+            n += 1;
         }
+    }
+
+    pthread_mutex_unlock(&grp->mtx);
+    pthread_rwlock_unlock(&cache->rwlock);
 
-        if (elem->value.type != NEU_TYPE_ERROR) {
-            elem->changed = false;
+    return n;
+}
+
+int neu_driver_cache_take_changes(neu_driver_cache_t *cache, const char *group,
+                                  neu_driver_cache_count_cb_t cb, void *arg)
+{
+    struct group *grp  = NULL;
+    struct elem * elem = NULL;
+    struct elem * tmp  = NULL;
+
+    pthread_rwlock_rdlock(&cache->rwlock);
+    HASH_FIND_STR(cache->groups, group, grp);
+    if (grp == NULL) {
+        pthread_rwlock_unlock(&cache->rwlock);
+        return -1;
+    }
+
+    pthread_mutex_lock(&grp->mtx);
+    HASH_ITER(hh, grp->tags, elem, tmp)
+    {
+        if (elem->n_change > 0) {
+            cb(arg, elem->tag, elem->n_change);
+            elem->n_change = 0;
         }
-        ret = 0;
     }
+    pthread_mutex_unlock(&grp->mtx);
+    pthread_rwlock_unlock(&cache->rwlock);
 
-    pthread_mutex_unlock(&cache->mtx);
+    return 0;
+}
 
-    return ret;
+static int cache_expire(neu_driver_cache_t *cache, const char *group,
+                        int64_t timestamp, int64_t timeout, bool hold)
+{
+    struct group *grp  = NULL;
+    struct elem * elem = NULL;
+    struct elem * tmp  = NULL;
+    int           n    = 0;
+
+    pthread_rwlock_rdlock(&cache->rwlock);
+    HASH_FIND_STR(cache->groups, group, grp);
+    if (grp == NULL) {
+        pthread_rwlock_unlock(&cache->rwlock);
+        return -1;
+    }
+
+    pthread_mutex_lock(&grp->mtx);
+    DL_FOREACH_SAFE2(grp->aging, elem, tmp, aging_next)
+    {
+        int64_t  age     = timestamp - elem->timestamp;
+        uint16_t divisor = elem->poll_divisor > 1 ? elem->poll_divisor : 1;
+
+        // the rest was read more recently
+        if (age <= timeout) {
+            break;
+        }
+        // a tag read every few cycles only expires after as many intervals
+        if (age <= timeout * divisor) {
+            continue;
+        }
+
+        DL_DELETE2(grp->aging, elem, aging_prev, aging_next);
+        elem->aging = false;
+        // an error is kept until the plugin reports something else
+        if (elem->value.type == NEU_TYPE_ERROR) {
+            continue;
+        }
+        elem->stale = !hold;
+        elem->held  = hold;
+        // a tag never read has nothing to take back
+        if (elem->timestamp > 0) {
+            elem->changed = true;
+            elem_stamp(elem);
+            n += 1;
+        }
+    }
+    pthread_mutex_unlock(&grp->mtx);
+    pthread_rwlock_unlock(&cache->rwlock);
+
+    return n;
+}
+
+int neu_driver_cache_expire(neu_driver_cache_t *cache, const char *group,
+                            int64_t timestamp, int64_t timeout)
+{
+    return cache_expire(cache, group, timestamp, timeout, false);
+}
+
+int neu_driver_cache_hold(neu_driver_cache_t *cache, const char *group,
+                          int64_t timestamp, int64_t timeout)
+{
+    return cache_expire(cache, group, timestamp, timeout, true);
+}
+
+void neu_driver_cache_evict(neu_driver_cache_t *cache, const char *group)
+{
+    struct group *grp  = NULL;
+    struct elem * elem = NULL;
+    struct elem * tmp  = NULL;
+    neu_dvalue_t  none = {
+        .type      = NEU_TYPE_ERROR,
+        .value.i32 = NEU_ERR_PLUGIN_TAG_NOT_READY,
+    };
+
+    pthread_rwlock_rdlock(&cache->rwlock);
+    HASH_FIND_STR(cache->groups, group, grp);
+    if (grp == NULL) {
+        pthread_rwlock_unlock(&cache->rwlock);
+        return;
+    }
+
+    pthread_mutex_lock(&grp->mtx);
+    HASH_ITER(hh, grp->tags, elem, tmp)
+    {
+        uint8_t precision = elem->value.precision;
+
+        if ((elem->attribute & NEU_ATTRIBUTE_STATIC) != 0) {
+            continue;
+        }
+
+        neu_cvalue_set(&elem->value, &none);
+        elem->value.precision = precision;
+        elem_set_metas(elem, NULL, 0);
+        if (elem->band != NULL) {
+            elem->band->has_ref = false;
+        }
+        if (elem->history != NULL) {
+            neu_history_free(elem->history);
+            elem->history = neu_history_new(cache->history_size);
+        }
+        elem->changed = false;
+
+        // as if never read, first in line to go stale
+        elem_touch(elem, 0);
+        DL_DELETE2(grp->aging, elem, aging_prev, aging_next);
+        DL_PREPEND2(grp->aging, elem, aging_prev, aging_next);
+    }
+    pthread_mutex_unlock(&grp->mtx);
+    pthread_rwlock_unlock(&cache->rwlock);
 }
 
 void neu_driver_cache_del(neu_driver_cache_t *cache, const char *group,
                           const char *tag)
 {
-    struct elem *elem = NULL;
-    tkey_t       key  = to_key(group, tag);
+    struct group *grp  = NULL;
+    struct elem * elem = NULL;
+
+    pthread_rwlock_wrlock(&cache->rwlock);
+    HASH_FIND_STR(cache->groups, group, grp);
+    if (grp != NULL) {
+        HASH_FIND_STR(grp->tags, tag, elem);
+        if (elem != NULL) {
+            elem_unlink(elem);
+            HASH_DEL(grp->tags, elem);
+            elem_free(elem);
+            cache->gen += 1;
+        }
 
-    pthread_mutex_lock(&cache->mtx);
-    HASH_FIND(hh, cache->table, &key, sizeof(tkey_t), elem);
+        if (HASH_COUNT(grp->tags) == 0) {
+            cache_group_free(cache, grp);
+        }
+    }
 
-    if (elem != NULL) {
-        HASH_DEL(cache->table, elem);
-        if (elem->value.type == NEU_TYPE_PTR) {
-            if (elem->value.value.ptr.ptr != NULL) {
-                free(elem->value.value.ptr.ptr);
-                elem->value.value.ptr.ptr = NULL;
+    pthread_rwlock_unlock(&cache->rwlock);
+}
+
+bool neu_driver_cache_exist(neu_driver_cache_t *cache, const char *group,
+                            const char *tag)
+{
+    struct group *grp  = NULL;
+    struct elem * elem = NULL;
+
+    pthread_rwlock_rdlock(&cache->rwlock);
+    HASH_FIND_STR(cache->groups, group, grp);
+    if (grp != NULL) {
+        HASH_FIND_STR(grp->tags, tag, elem);
+    }
+    pthread_rwlock_unlock(&cache->rwlock);
+
+    return elem != NULL;
+}
+
+void neu_driver_cache_del_group(neu_driver_cache_t *cache, const char *group)
+{
+    struct group *grp = NULL;
+
+    pthread_rwlock_wrlock(&cache->rwlock);
+    HASH_FIND_STR(cache->groups, group, grp);
+    if (grp != NULL) {
+        cache_group_free(cache, grp);
+        cache->gen += 1;
+    }
+
+    pthread_rwlock_unlock(&cache->rwlock);
+}
+
+int neu_driver_cache_rename_group(neu_driver_cache_t *cache, const char *group,
+                                  const char *new_name)
+{
+    struct group *grp   = NULL;
+    struct group *stale = NULL;
+
+    if (strlen(new_name) >= NEU_GROUP_NAME_LEN) {
+        return -1;
+    }
+
+    pthread_rwlock_wrlock(&cache->rwlock);
+    HASH_FIND_STR(cache->groups, group, grp);
+    if (grp == NULL) {
+        pthread_rwlock_unlock(&cache->rwlock);
+        return -1;
+    }
+
+    // left over by a group of the new name gone before, never to be read
+    HASH_FIND_STR(cache->groups, new_name, stale);
+    if (stale != NULL && stale != grp) {
+        cache_group_free(cache, stale);
+        cache->gen += 1;
+    }
+
+    // the elems stay where they are, so do the slots bound to them
+    HASH_DEL(cache->groups, grp);
+    memset(grp->name, 0, sizeof(grp->name));
+    strcpy(grp->name, new_name);
+    HASH_ADD_STR(cache->groups, name, grp);
+    pthread_rwlock_unlock(&cache->rwlock);
+
+    return 0;
+}
+
+int neu_driver_cache_take(neu_driver_cache_t *cache, const char *group,
+                          const char *tag, neu_driver_cache_value_t *value)
+{
+    struct group *grp  = NULL;
+    struct elem * elem = NULL;
+    int           ret  = -1;
+
+    pthread_rwlock_wrlock(&cache->rwlock);
+    HASH_FIND_STR(cache->groups, group, grp);
+    if (grp != NULL) {
+        HASH_FIND_STR(grp->tags, tag, elem);
+        if (elem != NULL) {
+            value->timestamp = elem->timestamp;
+            neu_cvalue_get(&elem->value, &value->value);
+
+            elem_unlink(elem);
+            HASH_DEL(grp->tags, elem);
+            elem_free(elem);
+            cache->gen += 1;
+            ret = 0;
+        }
+
+        if (HASH_COUNT(grp->tags) == 0) {
+            cache_group_free(cache, grp);
+        }
+    }
+
+    pthread_rwlock_unlock(&cache->rwlock);
+
+    return ret;
+}
+
+// when the value was sampled, a restored value keeps its original time
+static int64_t elem_sample_time(struct elem *elem)
+{
+    for (int i = 0; elem->metas != NULL && i < NEU_TAG_META_SIZE; i++) {
+        if (strcmp(elem->metas[i].name, NEU_DRIVER_CACHE_META_STALE) == 0) {
+            return elem->metas[i].value.value.i64;
+        }
+    }
+
+    return elem->timestamp;
+}
+
+static int write_group(FILE *fp, struct group *grp, neu_driver_cache_t *skip,
+                       uint32_t *n_record)
+{
+    struct elem * elem     = NULL;
+    struct elem * tmp      = NULL;
+    struct group *skip_grp = NULL;
+
+    if (skip != NULL) {
+        HASH_FIND_STR(skip->groups, grp->name, skip_grp);
+    }
+
+    HASH_ITER(hh, grp->tags, elem, tmp)
+    {
+        lkv_record_t record = { 0 };
+
+        if (elem->timestamp == 0 || elem->value.type == NEU_TYPE_ERROR ||
+            elem->value.type == NEU_TYPE_PTR) {
+            continue;
+        }
+
+        if (skip_grp != NULL) {
+            struct elem *found = NULL;
+
+            HASH_FIND_STR(skip_grp->tags, elem->tag, found);
+            if (found != NULL) {
+                continue;
+            }
+        }
+
+        strcpy(record.group, grp->name);
+        strcpy(record.tag, elem->tag);
+        record.timestamp = elem_sample_time(elem);
+        neu_cvalue_get(&elem->value, &record.value);
+
+        if (fwrite(&record, sizeof(record), 1, fp) != 1) {
+            return -1;
+        }
+        *n_record += 1;
+    }
+
+    return 0;
+}
+
+int neu_driver_cache_save(neu_driver_cache_t *cache,
+                          neu_driver_cache_t *pending, const char *path)
+{
+    char          tmp_path[PATH_MAX] = { 0 };
+    lkv_header_t  header             = { 0 };
+    struct group *grp                = NULL;
+    struct group *tmp                = NULL;
+    int           ret                = 0;
+
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    FILE *fp = fopen(tmp_path, "wb");
+    if (fp == NULL) {
+        return -1;
+    }
+
+    strcpy(header.magic, LKV_MAGIC);
+    header.format = LKV_FORMAT;
+    if (fwrite(&header, sizeof(header), 1, fp) != 1) {
+        ret = -1;
+    }
+
+    pthread_rwlock_rdlock(&cache->rwlock);
+    HASH_ITER(hh, cache->groups, grp, tmp)
+    {
+        if (ret == 0) {
+            pthread_mutex_lock(&grp->mtx);
+            ret = write_group(fp, grp, NULL, &header.n_record);
+            pthread_mutex_unlock(&grp->mtx);
+        }
+    }
+
+    // values restored at start that no group has claimed yet
+    if (pending != NULL) {
+        pthread_rwlock_rdlock(&pending->rwlock);
+        HASH_ITER(hh, pending->groups, grp, tmp)
+        {
+            if (ret == 0) {
+                ret = write_group(fp, grp, cache, &header.n_record);
             }
         }
-        free(elem);
+        pthread_rwlock_unlock(&pending->rwlock);
+    }
+    pthread_rwlock_unlock(&cache->rwlock);
+
+    if (ret == 0) {
+        if (fseek(fp, 0, SEEK_SET) != 0 ||
+            fwrite(&header, sizeof(header), 1, fp) != 1) {
+            ret = -1;
+        }
+    }
+
+    if (fclose(fp) != 0) {
+        ret = -1;
     }
 
-    pthread_mutex_unlock(&cache->mtx);
+    if (ret == 0 && rename(tmp_path, path) != 0) {
+        ret = -1;
+    }
+
+    if (ret != 0) {
+        remove(tmp_path);
+    }
+
+    return ret;
+}
+
+int neu_driver_cache_load(neu_driver_cache_t *cache, const char *path)
+{
+    lkv_header_t header = { 0 };
+    int          n      = 0;
+
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL) {
+        return -1;
+    }
+
+    if (fread(&header, sizeof(header), 1, fp) != 1 ||
+        strncmp(header.magic, LKV_MAGIC, sizeof(header.magic)) != 0 ||
+        header.format != LKV_FORMAT) {
+        fclose(fp);
+        return -1;
+    }
+
+    for (uint32_t i = 0; i < header.n_record; i++) {
+        lkv_record_t record = { 0 };
+
+        if (fread(&record, sizeof(record), 1, fp) != 1) {
+            break;
+        }
+
+        record.group[sizeof(record.group) - 1] = '\0';
+        record.tag[sizeof(record.tag) - 1]     = '\0';
+        if (record.value.type == NEU_TYPE_PTR ||
+            record.value.type == NEU_TYPE_ERROR) {
+            continue;
+        }
+
+        neu_driver_cache_add(cache, record.group, record.tag, NULL,
+                             record.value);
+        neu_driver_cache_update(cache, record.group, record.tag,
+                                record.timestamp, record.value, NULL, 0);
+        n += 1;
+    }
+
+    fclose(fp);
+
+    return n;
 }
@@ -22,15 +22,51 @@
 
 #include <stdint.h>
 
+#include "tag.h"
 #include "type.h"
+#include "utils/utarray.h"
 
-typedef struct neu_driver_cache neu_driver_cache_t;
+// meta of a value restored from the last known value file, holds the int64
+// time in ms the value was originally sampled at
+#define NEU_DRIVER_CACHE_META_STALE "stale"
+// meta of the value of a confirmed write, cached before the tag is read back,
+// holds the int64 time in ms of the write
+#define NEU_DRIVER_CACHE_META_WRITTEN "written"
+
+typedef struct neu_driver_cache      neu_driver_cache_t;
+typedef struct neu_driver_cache_slot neu_driver_cache_slot_t;
 
 neu_driver_cache_t *neu_driver_cache_new();
 void                neu_driver_cache_destroy(neu_driver_cache_t *cache);
+// bytes a cached tag takes, without the data of a pointer value
+size_t neu_driver_cache_elem_size();
 
+// def is the tag the values written are normalized for, its byte order and
+// decimal, so that the cache holds the values as they are reported. NULL
+// keeps the values as written.
 void neu_driver_cache_add(neu_driver_cache_t *cache, const char *group,
-                          const char *tag, neu_dvalue_t value);
+                          const char *tag, const neu_datatag_t *def,
+                          neu_dvalue_t value);
+// keep up to size bytes of the recent numeric values of every tag added from
+// now on, 0 for none
+void neu_driver_cache_set_history(neu_driver_cache_t *cache, size_t size);
+// halve the bytes of history kept per tag, dropping the oldest samples of
+// every tag that holds more. Returns the bytes freed
+size_t neu_driver_cache_shrink_history(neu_driver_cache_t *cache);
+// bytes the cached tags take, with their out of line values, metas and history
+size_t neu_driver_cache_mem_bytes(neu_driver_cache_t *cache);
+// append the history of tag in the range to points, see neu_history_query,
+// returns -1 if the tag is not cached or keeps no history
+int neu_driver_cache_history(neu_driver_cache_t *cache, const char *group,
+                             const char *tag, int64_t since, int64_t until,
+                             int64_t step, uint32_t max, UT_array *points);
+// change the deadband the changes of tag are filtered with, keeping its value
+void neu_driver_cache_set_deadband(neu_driver_cache_t *cache, const char *group,
+                                   const char *              tag,
+                                   const neu_tag_deadband_t *band);
+// turn a value in the order of the device into the value the cache keeps
+// for tag, as an update does
+void neu_driver_cache_normalize(const neu_datatag_t *tag, neu_dvalue_t *value);
 void neu_driver_cache_update(neu_driver_cache_t *cache, const char *group,
                              const char *tag, int64_t timestamp,
                              neu_dvalue_t value, neu_tag_meta_t *metas,
@@ -40,9 +76,38 @@ void neu_driver_cache_update_change(neu_driver_cache_t *cache,
                                     int64_t timestamp, neu_dvalue_t value,
                                     neu_tag_meta_t *metas, int n_meta,
                                     bool change);
+// put back a value saved by neu_driver_cache_save, it is normalized already
+// and reported as changed
+void neu_driver_cache_restore(neu_driver_cache_t *cache, const char *group,
+                              const char *tag, int64_t timestamp,
+                              neu_dvalue_t value, neu_tag_meta_t *metas,
+                              int n_meta);
+// update several tags of one group with a single lock round trip
+void neu_driver_cache_update_batch(neu_driver_cache_t *cache,
+                                   const char *group, int64_t timestamp, int n,
+                                   const char **tags, neu_dvalue_t *values);
+// resolve n tags of one group to slots, NULL for a tag not in the cache,
+// returns the generation of the cache the slots stay valid for
+uint64_t neu_driver_cache_bind(neu_driver_cache_t *cache, const char *group,
+                               int n, const char **tags,
+                               neu_driver_cache_slot_t **slots);
+// update the slots whose filled flag is set without looking the tags up,
+// returns -1 if tags were added or removed since the slots were bound
+int neu_driver_cache_update_slots(neu_driver_cache_t *cache, const char *group,
+                                  uint64_t gen, int64_t timestamp, int n,
+                                  neu_driver_cache_slot_t **slots,
+                                  const neu_dvalue_t *      values,
+                                  const uint8_t *           filled);
+// refresh the timestamp of n tags of one group whose values did not change,
+// except for written values, an unchanged read does not confirm them
+void neu_driver_cache_touch_batch(neu_driver_cache_t *cache,
+                                  const char *group, int64_t timestamp, int n,
+                                  const char **tags);
 
 void neu_driver_cache_del(neu_driver_cache_t *cache, const char *group,
                           const char *tag);
+bool neu_driver_cache_exist(neu_driver_cache_t *cache, const char *group,
+                            const char *tag);
 
 typedef struct {
     neu_dvalue_t   value;
@@ -58,4 +123,67 @@ int neu_driver_cache_meta_get_changed(neu_driver_cache_t *cache,
                                       neu_driver_cache_value_t *value,
                                       neu_tag_meta_t *metas, int n_meta);
 
+typedef struct {
+    const char *             tag;
+    uint8_t                  attribute;    // of the tag definition
+    uint16_t                 poll_divisor; // of the tag definition
+    neu_driver_cache_value_t value;
+} neu_driver_cache_change_t;
+
+typedef void (*neu_driver_cache_change_cb_t)(void *                     arg,
+                                             neu_driver_cache_change_t *change);
+
+// Every change of a tag takes the next sequence number of its group. Calls cb
+// with the tags of group having every bit of attribute set that changed after
+// *cursor, oldest change first, and moves *cursor past them, so that each
+// consumer keeping a cursor of its own, starting at 0, sees every change once.
+// Tags whose band reports on intervals are left out unless timed is set, then
+// they are passed when due as with neu_driver_cache_meta_get_changed, which
+// only the reporter of the group is to do. cb owns the pointer data of the
+// value and must not call into the cache. Returns the number of tags passed
+// to cb, -1 if the group is not cached.
+int neu_driver_cache_changes(neu_driver_cache_t *cache, const char *group,
+                             uint8_t attribute, bool timed, uint64_t *cursor,
+                             neu_driver_cache_change_cb_t cb, void *arg);
+
+typedef void (*neu_driver_cache_count_cb_t)(void *arg, const char *tag,
+                                            uint32_t n);
+
+// Calls cb with the tags of group whose value changed since the last call and
+// how many times, and starts counting anew. cb must not call into the cache.
+// Returns -1 if the group is not cached.
+int neu_driver_cache_take_changes(neu_driver_cache_t *cache, const char *group,
+                                  neu_driver_cache_count_cb_t cb, void *arg);
+
+// Marks the tags of group not read for timeout ms, or as many timeouts as
+// their poll divisor, stale, so that they read as expired until the next
+// value, which is a change of each tag that held one. Tags are kept in the
+// order they were read, the sweep stops at the first one read within timeout
+// and never looks at static tags or errors. Returns the number of tags gone
+// stale with a change, -1 if the group is not cached.
+int neu_driver_cache_expire(neu_driver_cache_t *cache, const char *group,
+                            int64_t timestamp, int64_t timeout);
+// as neu_driver_cache_expire, but the tags aged out keep their values, read
+// with a NEU_DRIVER_CACHE_META_STALE meta of the time they were read at
+int neu_driver_cache_hold(neu_driver_cache_t *cache, const char *group,
+                          int64_t timestamp, int64_t timeout);
+// drop the values of the group, but its static tags, as if its tags were
+// never read, the memory they take out of line goes with them
+void neu_driver_cache_evict(neu_driver_cache_t *cache, const char *group);
+
+void neu_driver_cache_del_group(neu_driver_cache_t *cache, const char *group);
+// rekey the cached tags of group under new_name keeping their values,
+// -1 if the group is not cached
+int neu_driver_cache_rename_group(neu_driver_cache_t *cache, const char *group,
+                                  const char *new_name);
+// remove one value from a cache filled by neu_driver_cache_load
+int neu_driver_cache_take(neu_driver_cache_t *cache, const char *group,
+                          const char *tag, neu_driver_cache_value_t *value);
+
+// write the valid values of cache, and those of pending not in cache, to path
+int neu_driver_cache_save(neu_driver_cache_t *cache,
+                          neu_driver_cache_t *pending, const char *path);
+// add the values saved in path to cache, returns how many or -1
+int neu_driver_cache_load(neu_driver_cache_t *cache, const char *path);
+
 #endif
@@ -20,10 +20,15 @@
 #include <math.h>
 #include <netinet/in.h>
 #include <pthread.h>
+#include <sched.h>
+#include <stddef.h>
 #include <stdlib.h>
 
 #include "event/event.h"
+#include "utils/history.h"
+#include "utils/intern.h"
 #include "utils/log.h"
+#include "utils/tuning.h"
 #include "utils/utextend.h"
 
 #include "adapter.h"
@@ -33,6 +38,8 @@
 #include "cache.h"
 #include "driver_internal.h"
 #include "errcodes.h"
+#include "expr.h"
+#include "parser/neu_json_node.h"
 #include "tag.h"
 
 typedef struct to_be_write_tag {
@@ -41,13 +48,66 @@ typedef struct to_be_write_tag {
     neu_value_u    value;
     UT_array *     tvs;
     void *         req;
+    bool           preempt;
 } to_be_write_tag_t;
 
+// a sync read parked until the group loop reads the device, see sync_run
+typedef struct {
+    neu_reqresp_head_t *req;
+    UT_array *          tags; // of the request
+} sync_read_t;
+
+static const UT_icd sync_read_icd = { sizeof(sync_read_t), NULL, NULL, NULL };
+
+// a verified write fails if its values are not read back within this many
+// intervals of its group
+#define NEU_DRIVER_VERIFY_INTERVALS 3
+
+// reads in a row that fit a shorter stride before the adapt overrun policy
+// shrinks the interval of a group, see read_stretch
+#define STRETCH_FIT 4
+
+typedef struct {
+    char         tag[NEU_TAG_NAME_LEN];
+    neu_dvalue_t expect; // as the cache keeps the value read back
+} verify_tag_t;
+
+// a write answered once the device reads its values back, see verify_run
+typedef struct {
+    neu_reqresp_head_t *req;
+    bool                written;  // the device accepted the write
+    bool                synced;   // a sync read ran since armed
+    int64_t             armed;    // ms the read back counts from, 0 before
+    int64_t             deadline; // ms the values must be read back by
+    int                 n_tag;
+    verify_tag_t        tags[];
+} verify_t;
+
+static const UT_icd verify_icd = { sizeof(verify_t *), NULL, NULL, NULL };
+
 typedef struct {
     char               app[NEU_NODE_NAME_LEN];
     struct sockaddr_un addr;
 } sub_app_t;
 
+// The apps subscribing a group. A vector is never changed once published, a
+// subscription change publishes a new one, and a report holds a reference to
+// the vector it sends to instead of a lock.
+typedef struct {
+    uint32_t  ref;
+    uint16_t  n_app;
+    sub_app_t apps[];
+} sub_apps_t;
+
+// read statistics of a group since its last save, see profile_save_callback
+typedef struct {
+    uint64_t reads;
+    uint64_t read_ms;
+    uint64_t overruns;
+    uint64_t blocks;
+    uint64_t latency[NEU_TUNING_LATENCY_N];
+} group_profile_t;
+
 typedef struct group {
     char *name;
 
@@ -56,43 +116,217 @@ typedef struct group {
     UT_array *      static_tags;
     UT_array *      wt_tags;
     pthread_mutex_t wt_mtx;
+    uint32_t        n_preempt; // of wt_tags, see write_preempt
 
     neu_event_timer_t *report;
     neu_event_timer_t *read;
     neu_event_timer_t *write;
-
-    UT_array *      apps; // sub_app_t array
-    pthread_mutex_t apps_mtx;
+    int64_t            next_report; // batch report mode only
+    bool               reload_read; // restore read once the plugin is swapped
+
+    // runs the read and write timers, so they never overlap for one group
+    neu_events_t *events;
+
+    // schedule of the read timer on the monotonic clock, see read_schedule
+    int64_t  deadline; // the next read is due, 0 before the first read
+    uint32_t stride;   // degrade or adapt overrun policy, reads every stride
+    uint32_t n_tick;   // ticks, and the ticks left before the next read
+    uint32_t n_fit;    // adapt, reads in a row that fit a shorter stride
+    bool     late;     // the last read started a period late
+    uint32_t shed;     // load shedding, reads every shed ticks, 0 or 1 if not
+    uint32_t n_shed;   // ticks left before the next shed read
+
+    // last group read, stamped only while tracing
+    int64_t read_start;
+    int64_t read_end;
+
+    // us the read timer fired after its deadline at most, see read_schedule
+    int64_t jitter_max;
+
+    // monotonic end of the last sync read, and of the last read of every tag
+    // by a sync read or the timer, see sync_coalesce
+    int64_t sync_end;
+    int64_t fresh;
+
+    // sync reads waiting for the group loop, see sync_run, and verified
+    // writes waiting for the read back, see verify_run
+    UT_array *      sync_reqs;
+    UT_array *      verifies;
+    pthread_mutex_t sync_mtx;
+
+    sub_apps_t *    apps;
+    pthread_mutex_t apps_mtx; // guards the swap of apps
 
     neu_plugin_group_t    grp;
     neu_adapter_driver_t *driver;
 
+    // columns module only, handed to the plugin through grp.columns, slots
+    // are the cache entries of the tags, bound for the slots_gen generation
+    neu_plugin_columns_t      columns;
+    neu_driver_cache_slot_t **slots;
+    uint64_t                  slots_gen;
+
+    // groups with a tag read less often than each cycle, see grp.active
+    uint8_t *active;
+    uint32_t cycle;
+
+    // where the reports of the group are in the changes of its subscribed
+    // tags, shared by the timer and update_im, see neu_driver_cache_changes
+    uint64_t report_seq;
+
+    // tags evaluated from other tags of the group after each read, kept out
+    // of grp.tags, with the compiled expression of each, see computed_build
+    UT_array *   computed_tags;
+    neu_expr_t **exprs;
+
+    // neu_tag_cache_type_e of the cached values and the ttl of a ttl
+    // retention, set on the adapter thread and read by the group loop, and
+    // whether the values are evicted while nothing subscribes the group
+    uint8_t retention;
+    int64_t ttl;
+    bool    evicted;
+
+    // monotonic, the last read of the group by a request or while an app
+    // subscribes it, and whether its polling is paused, see group_cold
+    int64_t demand;
+    bool    cold;
+
+    // added by the group loop, taken by the profile timer of the adapter
+    group_profile_t profile;
+
     UT_hash_handle hh;
 } group_t;
 
+// how long the values of a group stay in the cache and what becomes of them
+// once they age out, see neu_tag_cache_type_e
+typedef struct {
+    neu_tag_cache_type_e type;
+    int64_t              timeout; // ms, 0 to never expire
+} cache_policy_t;
+
 struct neu_adapter_driver {
     neu_adapter_t adapter;
 
     neu_driver_cache_t *cache;
     neu_events_t *      driver_events;
 
+    // group timer loops, the first one is driver_events, see
+    // neu_plugin_module_t.group_concurrency
+    neu_events_t **group_events;
+    uint16_t       n_group_events;
+
     size_t        tag_cnt;
     struct group *groups;
+
+    // batch report mode, one timer reports all the groups that are due
+    neu_event_timer_t *report_tick;
+    uint32_t           report_tick_ms;
+
+    // updated on every tag update, resolved once at init
+    neu_metric_entry_t *tag_reads;
+    neu_metric_entry_t *tag_read_errors;
+
+    uint32_t n_report; // reports since start, to sample traces
+
+    // last known values restored at start, until the groups claim them
+    neu_driver_cache_t *lkv;
+    neu_event_timer_t * lkv_timer;
+
+    neu_event_timer_t *profile_timer;
+
+    // scheduling policy of the loops, and the cpu time of each loop at the
+    // last tick of the watchdog of a real time policy, see sched_watchdog
+    int                sched_policy;
+    int                sched_priority;
+    neu_event_timer_t *sched_watchdog;
+    int64_t            sched_tick;
+    int64_t            sched_cpu[NEU_DRIVER_GROUP_CONCURRENCY_MAX];
+    uint32_t           sched_demoted; // one bit per loop
+
+    // of the node setting, for the groups added later
+    neu_json_cache_retentions_t retentions;
 };
 
+static inline void update_tag_reads(neu_adapter_driver_t *driver, uint64_t n,
+                                    uint64_t n_error)
+{
+    if (NULL != driver->tag_reads) {
+        neu_node_metrics_update_entry(driver->adapter.metrics,
+                                      driver->tag_reads, n);
+    }
+    if (NULL != driver->tag_read_errors && n_error > 0) {
+        neu_node_metrics_update_entry(driver->adapter.metrics,
+                                      driver->tag_read_errors, n_error);
+    }
+}
+
+// report all due groups of a driver in one message per app
+static bool batch_report = false;
+// seconds between two saves of the last known values, 0 disables them
+static uint32_t lkv_interval = 0;
+// save the values at stop and load them at start for an upgrade
+static bool handover = false;
+// what groups do when their reads fall behind
+static neu_group_overrun_e overrun_policy = NEU_GROUP_OVERRUN_COALESCE;
+// most ticks between two reads of a group while its apps are congested
+static uint32_t shed_max = 1;
+// most ticks between the reads of a group under the adapt overrun policy
+static uint32_t stretch_max = NEU_GROUP_STRETCH_MAX_DEFAULT;
+// cache the values of confirmed writes, see write_through
+static bool write_through = false;
+// KiB of samples kept per tag, 0 for none
+static uint32_t history_kib = 0;
+// intervals a group nothing subscribes nor reads is polled for, 0 for ever
+static uint32_t cold_groups = 0;
+// seconds between two saves of the read statistics of the groups, 0 disables
+static uint32_t profile_interval = 0;
+
+// start the data path trace of one in every neu_trace_sample() reports
+static void trace_report(group_t *group, neu_trace_t *trace)
+{
+    uint32_t sample = neu_trace_sample();
+    uint32_t n      = 0;
+
+    if (0 == sample) {
+        return;
+    }
+    n = __atomic_fetch_add(&group->driver->n_report, 1, __ATOMIC_RELAXED);
+    if (0 != n % sample) {
+        return;
+    }
+
+    trace->ts[NEU_TRACE_READ] =
+        __atomic_load_n(&group->read_start, __ATOMIC_RELAXED);
+    trace->ts[NEU_TRACE_CACHED] =
+        __atomic_load_n(&group->read_end, __ATOMIC_RELAXED);
+    trace->ts[NEU_TRACE_REPORT] = neu_time_ms();
+}
+
+static sub_apps_t *sub_apps_new(uint16_t n_app);
+static sub_apps_t *sub_apps_get(group_t *group);
+static void        sub_apps_put(sub_apps_t *apps);
+static void        sub_apps_swap(group_t *group, sub_apps_t *apps);
+
 static void report_to_app(neu_adapter_driver_t *driver, group_t *group,
                           struct sockaddr_un dst);
+static bool report_to_apps(neu_adapter_driver_t *    driver,
+                           neu_reqresp_trans_data_t *data, sub_apps_t *apps);
 static int  report_callback(void *usr_data);
+static int  report_tick_callback(void *usr_data);
+static void add_report_timer(neu_adapter_driver_t *driver, group_t *group,
+                             uint32_t interval, int64_t delay);
+static void del_report_timer(neu_adapter_driver_t *driver, group_t *group);
+static void update_report_tick(neu_adapter_driver_t *driver);
 static int  read_callback(void *usr_data);
 static int  write_callback(void *usr_data);
-static void read_group(int64_t timestamp, int64_t timeout,
-                       neu_tag_cache_type_e cache_type,
+static void read_group(int64_t timestamp, cache_policy_t policy,
                        neu_driver_cache_t *cache, const char *group,
                        UT_array *tags, UT_array *tag_values);
-static void read_report_group(int64_t timestamp, int64_t timeout,
-                              neu_tag_cache_type_e cache_type,
+static void read_report_group(int64_t timestamp, cache_policy_t policy,
                               neu_driver_cache_t *cache, const char *group,
-                              UT_array *tags, UT_array *tag_values);
+                              uint32_t n, const char *const *names,
+                              const uint8_t *attributes, uint64_t *cursor,
+                              UT_array *tag_values);
 static void update(neu_adapter_t *adapter, const char *group, const char *tag,
                    neu_dvalue_t value);
 static void update_im(neu_adapter_t *adapter, const char *group,
@@ -101,237 +335,1196 @@ static void update_im(neu_adapter_t *adapter, const char *group,
 static void update_with_meta(neu_adapter_t *adapter, const char *group,
                              const char *tag, neu_dvalue_t value,
                              neu_tag_meta_t *metas, int n_meta);
+static void update_batch(neu_adapter_t *adapter, const char *group, int n,
+                         const char **tags, neu_dvalue_t *values);
+static void touch_batch(neu_adapter_t *adapter, const char *group, int n,
+                        const char **tags);
 static void write_response(neu_adapter_t *adapter, void *r, neu_error error);
 static group_t *find_group(neu_adapter_driver_t *driver, const char *name);
 static void     store_write_tag(group_t *group, to_be_write_tag_t *tag);
+static int      queue_callback(void *usr_data);
+static void     sync_drop(group_t *group, int error);
+static bool     verify_written(neu_adapter_driver_t *driver,
+                               neu_reqresp_head_t *req, int error);
+static void     verify_run(group_t *group);
+static void     verify_drop(group_t *group, int error);
 
-static void write_response(neu_adapter_t *adapter, void *r, neu_error error)
-{
-    neu_reqresp_head_t *req    = (neu_reqresp_head_t *) r;
-    neu_resp_error_t    nerror = { .error = error };
+typedef struct {
+    neu_datatag_t *tag;
+    UT_hash_handle hh;
+} tag_ref_t;
 
-    if (NEU_REQ_WRITE_TAG == req->type) {
-        neu_req_write_tag_fini((neu_req_write_tag_t *) &req[1]);
-    } else if (NEU_REQ_WRITE_TAGS == req->type) {
-        neu_req_write_tags_fini((neu_req_write_tags_t *) &req[1]);
-    } else if (NEU_REQ_WRITE_GTAGS == req->type) {
-        neu_req_write_gtags_fini((neu_req_write_gtags_t *) &req[1]);
+// the type the values of a tag are reported and cached as
+static neu_type_e report_type(const neu_datatag_t *tag)
+{
+    if (tag->decimal != 0) {
+        switch (tag->type) {
+        case NEU_TYPE_INT8:
+        case NEU_TYPE_UINT8:
+        case NEU_TYPE_INT16:
+        case NEU_TYPE_UINT16:
+        case NEU_TYPE_INT32:
+        case NEU_TYPE_UINT32:
+        case NEU_TYPE_INT64:
+        case NEU_TYPE_UINT64:
+        case NEU_TYPE_FLOAT:
+            return NEU_TYPE_DOUBLE;
+        default:
+            break;
+        }
     }
+    return tag->type;
+}
 
-    req->type = NEU_RESP_ERROR;
-
-    nlog_notice("write tag response <%p>", req->ctx);
+// whether a tag reads the same point of the device as before
+static bool tag_same_point(const neu_datatag_t *a, const neu_datatag_t *b)
+{
+    return a->type == b->type && a->attribute == b->attribute &&
+        a->precision == b->precision && a->decimal == b->decimal &&
+        0 == strcmp(a->address, b->address);
+}
 
-    adapter->cb_funs.response(adapter, req, &nerror);
+static void columns_free(group_t *group)
+{
+    free(group->columns.tags);
+    free(group->columns.names);
+    free(group->columns.values);
+    free(group->columns.filled);
+    free(group->slots);
+    free(group->active);
+    memset(&group->columns, 0, sizeof(group->columns));
+    group->slots       = NULL;
+    group->grp.columns = NULL;
+    group->active      = NULL;
+    group->grp.active  = NULL;
 }
 
-static void update_with_meta(neu_adapter_t *adapter, const char *group,
-                             const char *tag, neu_dvalue_t value,
-                             neu_tag_meta_t *metas, int n_meta)
+// the mask of the tags due in a cycle, only for a group that has tags with a
+// poll divisor
+static void active_build(group_t *group)
 {
-    neu_adapter_driver_t *         driver = (neu_adapter_driver_t *) adapter;
-    neu_adapter_update_metric_cb_t update_metric =
-        driver->adapter.cb_funs.update_metric;
+    bool multi_rate = false;
 
-    if (value.type == NEU_TYPE_ERROR) {
-        update_metric(&driver->adapter, NEU_METRIC_GROUP_LAST_ERROR_CODE,
-                      value.value.i32, group);
-        update_metric(&driver->adapter, NEU_METRIC_GROUP_LAST_ERROR_TS,
-                      global_timestamp, group);
+    utarray_foreach(group->grp.tags, neu_datatag_t *, tag)
+    {
+        multi_rate = multi_rate || tag->poll_divisor > 1;
     }
 
-    if (value.type == NEU_TYPE_ERROR && tag == NULL) {
-        group_t *g = find_group(driver, group);
-        if (g != NULL) {
-            UT_array *tags      = neu_group_get_read_tag(g->group);
-            uint64_t  err_count = 0;
-
-            utarray_foreach(tags, neu_datatag_t *, t)
-            {
-                if (neu_tag_attribute_test(t, NEU_ATTRIBUTE_STATIC)) {
-                    continue;
-                }
-                neu_driver_cache_update(driver->cache, group, t->name,
-                                        global_timestamp, value, NULL, 0);
-                ++err_count;
-            }
-            update_metric(&driver->adapter, NEU_METRIC_TAG_READS_TOTAL,
-                          err_count, NULL);
-            update_metric(&driver->adapter, NEU_METRIC_TAG_READ_ERRORS_TOTAL,
-                          err_count, NULL);
-            utarray_free(tags);
-        }
-    } else {
-        neu_driver_cache_update(driver->cache, group, tag, global_timestamp,
-                                value, metas, n_meta);
-        update_metric(&driver->adapter, NEU_METRIC_TAG_READS_TOTAL, 1, NULL);
-        update_metric(&driver->adapter, NEU_METRIC_TAG_READ_ERRORS_TOTAL,
-                      NEU_TYPE_ERROR == value.type, NULL);
+    if (multi_rate) {
+        group->active = calloc(utarray_len(group->grp.tags), sizeof(uint8_t));
     }
-    nlog_info(
-        "update driver: %s, group: %s, tag: %s, type: %s, timestamp: %" PRId64
-        " n_meta: %d",
-        driver->adapter.name, group, tag, neu_type_string(value.type),
-        global_timestamp, n_meta);
 }
 
-static void update_im(neu_adapter_t *adapter, const char *group,
-                      const char *tag, neu_dvalue_t value,
-                      neu_tag_meta_t *metas, int n_meta)
+static void active_update(group_t *group)
 {
-    neu_adapter_driver_t *driver = (neu_adapter_driver_t *) adapter;
+    uint32_t i = 0;
 
-    if (tag == NULL || value.type == NEU_TYPE_ERROR) {
-        nlog_warn("update_im tag is null or value is error %d",
-                  value.value.i32);
+    group->grp.cycle  = group->cycle++;
+    group->grp.active = group->active;
+    if (group->active == NULL) {
         return;
     }
 
-    UT_array *tags = neu_adapter_driver_get_ptag(driver, group, tag);
-    if (tags == NULL) {
-        return;
+    utarray_foreach(group->grp.tags, neu_datatag_t *, tag)
+    {
+        group->active[i++] = neu_tag_poll_due(tag, group->grp.cycle);
     }
+}
 
-    neu_driver_cache_update_change(driver->cache, group, tag, global_timestamp,
-                                   value, metas, n_meta, true);
-    driver->adapter.cb_funs.update_metric(&driver->adapter,
-                                          NEU_METRIC_TAG_READS_TOTAL, 1, NULL);
-    neu_datatag_t *first = utarray_front(tags);
+// lay the tags of grp out in columns, once per change of the group
+static void columns_build(group_t *group)
+{
+    neu_plugin_columns_t *c = &group->columns;
+    uint32_t              n = 0;
 
-    if (first == NULL ||
-        !neu_tag_attribute_test(first, NEU_ATTRIBUTE_SUBSCRIBE)) {
-        utarray_free(tags);
-        nlog_info("update immediately, driver: %s, "
-                  "group: %s, tag: %s, type: %s, "
-                  "timestamp: %" PRId64,
-                  driver->adapter.name, group, tag, neu_type_string(value.type),
-                  global_timestamp);
+    columns_free(group);
+    if (group->grp.tags != NULL) {
+        active_build(group);
+    }
+    if (!group->driver->adapter.module->columns || group->grp.tags == NULL ||
+        utarray_len(group->grp.tags) == 0) {
         return;
     }
 
-    nlog_info("update and report immediately, driver: %s, "
-              "group: %s, tag: %s, type: %s, "
-              "timestamp: %" PRId64,
-              driver->adapter.name, group, tag, neu_type_string(value.type),
-              global_timestamp);
+    n            = utarray_len(group->grp.tags);
+    c->tags      = calloc(n, sizeof(neu_datatag_t *));
+    c->names     = calloc(n, sizeof(char *));
+    c->values    = calloc(n, sizeof(neu_dvalue_t));
+    c->filled    = calloc(n, sizeof(uint8_t));
+    group->slots = calloc(n, sizeof(neu_driver_cache_slot_t *));
+    if (c->tags == NULL || c->names == NULL || c->values == NULL ||
+        c->filled == NULL || group->slots == NULL) {
+        nlog_error("group: %s, no memory for %" PRIu32 " columns", group->name,
+                   n);
+        columns_free(group);
+        return;
+    }
 
-    neu_reqresp_head_t header = {
-        .type = NEU_REQRESP_TRANS_DATA,
-    };
-    neu_reqresp_trans_data_t *data =
-        calloc(1, sizeof(neu_reqresp_trans_data_t));
+    utarray_foreach(group->grp.tags, neu_datatag_t *, tag)
+    {
+        c->tags[c->n_tag]  = tag;
+        c->names[c->n_tag] = tag->name;
+        c->n_tag += 1;
+    }
 
-    data->driver = strdup(driver->adapter.name);
-    data->group  = strdup(group);
-    utarray_new(data->tags, neu_resp_tag_value_meta_icd());
+    group->slots_gen = neu_driver_cache_bind(
+        group->driver->cache, group->name, c->n_tag, c->names, group->slots);
+    group->grp.columns = c;
+}
 
-    read_report_group(global_timestamp, 0,
-                      neu_adapter_get_tag_cache_type(&driver->adapter),
-                      driver->cache, group, tags, data->tags);
+// commit the values the plugin filled in during group_timer
+static void columns_commit(group_t *group)
+{
+    neu_adapter_driver_t *         driver = group->driver;
+    neu_plugin_columns_t *         c      = group->grp.columns;
+    neu_adapter_update_metric_cb_t update_metric =
+        driver->adapter.cb_funs.update_metric;
+    uint64_t n_error    = 0;
+    uint64_t n_filled   = 0;
+    int32_t  last_error = 0;
+    int64_t  now        = neu_time_ms();
 
-    if (utarray_len(data->tags) > 0) {
-        group_t *find = NULL;
-        HASH_FIND_STR(driver->groups, group, find);
-        if (find != NULL) {
-            pthread_mutex_lock(&find->apps_mtx);
+    for (uint32_t i = 0; i < c->n_tag; i++) {
+        if (!c->filled[i]) {
+            continue;
+        }
+        n_filled += 1;
+        if (c->values[i].type == NEU_TYPE_ERROR) {
+            last_error = c->values[i].value.i32;
+            n_error += 1;
+        }
+    }
 
-            if (utarray_len(find->apps) > 0) {
-                data->ctx = calloc(1, sizeof(neu_reqresp_trans_data_ctx_t));
-                data->ctx->index = utarray_len(find->apps);
-                pthread_mutex_init(&data->ctx->mtx, NULL);
+    if (n_filled == 0) {
+        return;
+    }
 
-                utarray_foreach(find->apps, sub_app_t *, app)
-                {
-                    if (driver->adapter.cb_funs.responseto(
-                            &driver->adapter, &header, data, app->addr) != 0) {
-                        neu_trans_data_free(data);
-                    }
-                }
-            } else {
-                utarray_foreach(data->tags, neu_resp_tag_value_meta_t *,
-                                tag_value)
-                {
-                    if (tag_value->value.type == NEU_TYPE_PTR) {
-                        free(tag_value->value.value.ptr.ptr);
-                    }
-                }
-                utarray_free(data->tags);
-                free(data->group);
-                free(data->driver);
-            }
+    if (n_error > 0) {
+        update_metric(&driver->adapter, NEU_METRIC_GROUP_LAST_ERROR_CODE,
+                      last_error, group->name);
+        update_metric(&driver->adapter, NEU_METRIC_GROUP_LAST_ERROR_TS, now,
+                      group->name);
+    }
 
-            pthread_mutex_unlock(&find->apps_mtx);
-        } else {
-            utarray_foreach(data->tags, neu_resp_tag_value_meta_t *, tag_value)
-            {
-                if (tag_value->value.type == NEU_TYPE_PTR) {
-                    free(tag_value->value.value.ptr.ptr);
-                }
-            }
-            utarray_free(data->tags);
-            free(data->group);
-            free(data->driver);
-        }
-    } else {
-        utarray_free(data->tags);
-        free(data->group);
-        free(data->driver);
+    if (0 !=
+        neu_driver_cache_update_slots(driver->cache, group->name,
+                                      group->slots_gen, now, c->n_tag,
+                                      group->slots, c->values, c->filled)) {
+        // tags of another group came or went, look ours up again
+        group->slots_gen =
+            neu_driver_cache_bind(driver->cache, group->name, c->n_tag,
+                                  c->names, group->slots);
+        neu_driver_cache_update_slots(driver->cache, group->name,
+                                      group->slots_gen, now, c->n_tag,
+                                      group->slots, c->values, c->filled);
     }
 
-    utarray_free(tags);
-    free(data);
+    update_tag_reads(driver, n_filled, n_error);
+    nlog_debug("update driver: %s, group: %s, columns: %" PRIu64
+               ", errors: %" PRIu64 ", timestamp: %" PRId64,
+               driver->adapter.name, group->name, n_filled, n_error, now);
 }
 
-static void update(neu_adapter_t *adapter, const char *group, const char *tag,
-                   neu_dvalue_t value)
+static void computed_free(group_t *group)
 {
-    update_with_meta(adapter, group, tag, value, NULL, 0);
+    if (group->computed_tags != NULL) {
+        for (unsigned i = 0; i < utarray_len(group->computed_tags); i++) {
+            neu_expr_free(group->exprs[i]);
+        }
+        utarray_free(group->computed_tags);
+    }
+    free(group->exprs);
+    group->computed_tags = NULL;
+    group->exprs         = NULL;
 }
 
-neu_adapter_driver_t *neu_adapter_driver_create()
+// move the computed tags out of tags, which the plugin reads, and compile
+// them once for all the reads until the next change of the group
+static void computed_build(group_t *group, UT_array *tags)
 {
-    neu_adapter_driver_t *driver = calloc(1, sizeof(neu_adapter_driver_t));
+    UT_array *computed = NULL;
+    unsigned  i        = 0;
+
+    computed_free(group);
+    utarray_new(computed, neu_tag_get_icd());
+    while (i < utarray_len(tags)) {
+        neu_datatag_t *tag = utarray_eltptr(tags, i);
+        if (neu_tag_is_computed(tag)) {
+            utarray_push_back(computed, tag);
+            utarray_erase(tags, i, 1);
+        } else {
+            i += 1;
+        }
+    }
 
-    driver->cache                                   = neu_driver_cache_new();
-    driver->driver_events                           = neu_event_new();
-    driver->adapter.cb_funs.driver.update           = update;
-    driver->adapter.cb_funs.driver.write_response   = write_response;
-    driver->adapter.cb_funs.driver.update_im        = update_im;
-    driver->adapter.cb_funs.driver.update_with_meta = update_with_meta;
+    if (utarray_len(computed) == 0) {
+        utarray_free(computed);
+        return;
+    }
 
-    return driver;
+    group->exprs         = calloc(utarray_len(computed), sizeof(neu_expr_t *));
+    group->computed_tags = computed;
+    i                    = 0;
+    utarray_foreach(computed, neu_datatag_t *, tag)
+    {
+        group->exprs[i] = neu_expr_compile(tag->address + 1);
+        if (group->exprs[i] == NULL) {
+            nlog_warn("group: %s, tag: %s, invalid expression: %s",
+                      group->name, tag->name, tag->address + 1);
+        }
+        i += 1;
+    }
 }
 
-void neu_adapter_driver_destroy(neu_adapter_driver_t *driver)
+static bool computed_operand(const neu_dvalue_t *value, double *number)
 {
-    neu_event_close(driver->driver_events);
-    neu_driver_cache_destroy(driver->cache);
+    const neu_value_u *v = &value->value;
+
+    switch (value->type) {
+    case NEU_TYPE_INT8:
+        *number = v->i8;
+        return true;
+    case NEU_TYPE_UINT8:
+    case NEU_TYPE_BIT:
+        *number = v->u8;
+        return true;
+    case NEU_TYPE_BOOL:
+        *number = v->boolean;
+        return true;
+    case NEU_TYPE_INT16:
+        *number = v->i16;
+        return true;
+    case NEU_TYPE_UINT16:
+    case NEU_TYPE_WORD:
+        *number = v->u16;
+        return true;
+    case NEU_TYPE_INT32:
+        *number = v->i32;
+        return true;
+    case NEU_TYPE_UINT32:
+    case NEU_TYPE_DWORD:
+        *number = v->u32;
+        return true;
+    case NEU_TYPE_INT64:
+        *number = v->i64;
+        return true;
+    case NEU_TYPE_UINT64:
+    case NEU_TYPE_LWORD:
+        *number = v->u64;
+        return true;
+    case NEU_TYPE_FLOAT:
+        *number = v->f32;
+        return true;
+    case NEU_TYPE_DOUBLE:
+        *number = v->d64;
+        return true;
+    default:
+        return false;
+    }
 }
 
-int neu_adapter_driver_init(neu_adapter_driver_t *driver)
+// the result in the type of tag, integers are rounded to the nearest
+static int computed_result(const neu_datatag_t *tag, double number,
+                           neu_dvalue_t *value)
 {
-    (void) driver;
+    // the upper limits are exclusive, those of 64 bits are no doubles
+    static const struct {
+        double min;
+        double end;
+    } ranges[] = {
+        [NEU_TYPE_INT8]   = { INT8_MIN, INT8_MAX + 1.0 },
+        [NEU_TYPE_UINT8]  = { 0, UINT8_MAX + 1.0 },
+        [NEU_TYPE_INT16]  = { INT16_MIN, INT16_MAX + 1.0 },
+        [NEU_TYPE_UINT16] = { 0, UINT16_MAX + 1.0 },
+        [NEU_TYPE_INT32]  = { INT32_MIN, INT32_MAX + 1.0 },
+        [NEU_TYPE_UINT32] = { 0, UINT32_MAX + 1.0 },
+        [NEU_TYPE_INT64]  = { INT64_MIN, 9223372036854775808.0 },
+        [NEU_TYPE_UINT64] = { 0, 18446744073709551616.0 },
+    };
+    neu_value_u *v = &value->value;
 
-    return 0;
+    value->type = tag->type;
+    if (tag->type >= NEU_TYPE_INT8 && tag->type <= NEU_TYPE_UINT64) {
+        number = round(number);
+        if (number < ranges[tag->type].min || number >= ranges[tag->type].end) {
+            return NEU_ERR_TAG_VALUE_INVALID;
+        }
+    }
+
+    switch (tag->type) {
+    case NEU_TYPE_INT8:
+        v->i8 = (int8_t) number;
+        break;
+    case NEU_TYPE_UINT8:
+        v->u8 = (uint8_t) number;
+        break;
+    case NEU_TYPE_INT16:
+        v->i16 = (int16_t) number;
+        break;
+    case NEU_TYPE_UINT16:
+        v->u16 = (uint16_t) number;
+        break;
+    case NEU_TYPE_INT32:
+        v->i32 = (int32_t) number;
+        break;
+    case NEU_TYPE_UINT32:
+        v->u32 = (uint32_t) number;
+        break;
+    case NEU_TYPE_INT64:
+        v->i64 = (int64_t) number;
+        break;
+    case NEU_TYPE_UINT64:
+        v->u64 = (uint64_t) number;
+        break;
+    case NEU_TYPE_FLOAT:
+        v->f32 = (float) number;
+        break;
+    case NEU_TYPE_DOUBLE:
+        v->d64 = number;
+        break;
+    case NEU_TYPE_BIT:
+        v->u8 = number != 0;
+        break;
+    case NEU_TYPE_BOOL:
+        v->boolean = number != 0;
+        break;
+    default:
+        return NEU_ERR_TAG_TYPE_NOT_SUPPORT;
+    }
+
+    return NEU_ERR_SUCCESS;
 }
 
-int neu_adapter_driver_uninit(neu_adapter_driver_t *driver)
+// Evaluate the computed tags of group from the values just cached, in the
+// order they are defined in, so that one reading a computed tag defined after
+// it sees the value of the previous read. A value the plugin updates later on
+// its own, as asynchronous plugins do, is taken at the next read. An operand
+// in error makes the result that error.
+static void computed_eval(group_t *group)
 {
-    group_t *el = NULL, *tmp = NULL;
+    neu_driver_cache_t *cache  = group->driver->cache;
+    uint32_t            n      = utarray_len(group->computed_tags);
+    const char **       names  = calloc(n, sizeof(char *));
+    neu_dvalue_t *      values = calloc(n, sizeof(neu_dvalue_t));
+    uint32_t            i      = 0;
+
+    if (names == NULL || values == NULL) {
+        free(names);
+        free(values);
+        return;
+    }
 
-    HASH_ITER(hh, driver->groups, el, tmp)
+    utarray_foreach(group->computed_tags, neu_datatag_t *, tag)
     {
-        HASH_DEL(driver->groups, el);
+        neu_expr_t *   expr   = group->exprs[i];
+        neu_dvalue_t * value  = &values[i];
+        double         number = 0;
+        int32_t        error  = NEU_ERR_SUCCESS;
+        double         operands[NEU_EXPR_OPERANDS_MAX];
+        neu_tag_meta_t metas[NEU_TAG_META_SIZE];
+
+        names[i++]       = tag->name;
+        value->precision = tag->precision;
+        if (expr == NULL) {
+            error = NEU_ERR_TAG_ADDRESS_FORMAT_INVALID;
+        }
 
-        neu_adapter_driver_try_del_tag(driver, neu_group_tag_size(el->group));
-        neu_adapter_del_timer((neu_adapter_t *) driver, el->report);
-        neu_event_del_timer(driver->driver_events, el->read);
-        neu_event_del_timer(driver->driver_events, el->write);
+        for (uint16_t k = 0;
+             error == NEU_ERR_SUCCESS && k < neu_expr_n_operand(expr); k++) {
+            neu_driver_cache_value_t operand = { 0 };
+
+            if (0 !=
+                neu_driver_cache_meta_get(cache, group->name,
+                                          neu_expr_operand(expr, k), &operand,
+                                          metas, NEU_TAG_META_SIZE)) {
+                error = NEU_ERR_TAG_NOT_EXIST;
+            } else if (operand.value.type == NEU_TYPE_ERROR) {
+                error = operand.value.value.i32;
+            } else if (!computed_operand(&operand.value, &operands[k])) {
+                error = NEU_ERR_PLUGIN_TAG_TYPE_MISMATCH;
+            }
+        }
+
+        if (error == NEU_ERR_SUCCESS &&
+            0 != neu_expr_eval(expr, operands, &number)) {
+            error = NEU_ERR_TAG_VALUE_INVALID;
+        }
+        if (error == NEU_ERR_SUCCESS) {
+            error = computed_result(tag, number, value);
+        }
+        if (error != NEU_ERR_SUCCESS) {
+            value->type      = NEU_TYPE_ERROR;
+            value->value.i32 = error;
+        }
+    }
+
+    neu_driver_cache_update_batch(cache, group->name, neu_time_ms(), n, names,
+                                  values);
+    free(names);
+    free(values);
+}
+
+// The values of a write request are converted to the layout of the device,
+// which the cache turns back into reported values as for a read. A written
+// tag keeps the written meta until it is read again.
+static void write_cache_tag(neu_adapter_driver_t *driver, const char *group,
+                            const char *tag, neu_dvalue_t value)
+{
+    UT_array *tags = neu_adapter_driver_get_ptag(driver, group, tag);
+    if (tags == NULL) {
+        return;
+    }
+
+    neu_datatag_t *t = utarray_front(tags);
+    if (neu_tag_attribute_test(t, NEU_ATTRIBUTE_READ) &&
+        !neu_tag_attribute_test(t, NEU_ATTRIBUTE_STATIC)) {
+        neu_tag_meta_t written = { 0 };
+
+        strcpy(written.name, NEU_DRIVER_CACHE_META_WRITTEN);
+        written.value.type      = NEU_TYPE_INT64;
+        written.value.value.i64 = neu_time_ms();
+        value.type              = t->type;
+        update_im(&driver->adapter, group, tag, value, &written, 1);
+    }
+    utarray_free(tags);
+}
+
+static void write_cache(neu_adapter_driver_t *driver, neu_reqresp_head_t *req)
+{
+    if (NEU_REQ_WRITE_TAG == req->type) {
+        neu_req_write_tag_t *cmd = (neu_req_write_tag_t *) &req[1];
+
+        write_cache_tag(driver, cmd->group, cmd->tag, cmd->value);
+    } else if (NEU_REQ_WRITE_TAGS == req->type) {
+        neu_req_write_tags_t *cmd = (neu_req_write_tags_t *) &req[1];
+
+        for (int i = 0; i < cmd->n_tag; i++) {
+            write_cache_tag(driver, cmd->group, cmd->tags[i].tag,
+                            cmd->tags[i].value);
+        }
+    } else if (NEU_REQ_WRITE_GTAGS == req->type) {
+        neu_req_write_gtags_t *cmd = (neu_req_write_gtags_t *) &req[1];
+
+        for (int i = 0; i < cmd->n_group; i++) {
+            for (int k = 0; k < cmd->groups[i].n_tag; k++) {
+                write_cache_tag(driver, cmd->groups[i].group,
+                                cmd->groups[i].tags[k].tag,
+                                cmd->groups[i].tags[k].value);
+            }
+        }
+    }
+}
+
+static void write_reply(neu_adapter_t *adapter, neu_reqresp_head_t *req,
+                        neu_error error)
+{
+    neu_resp_error_t nerror = { .error = error };
+
+    if (write_through && NEU_ERR_SUCCESS == error) {
+        write_cache((neu_adapter_driver_t *) adapter, req);
+    }
+
+    if (NEU_REQ_WRITE_TAG == req->type) {
+        neu_req_write_tag_fini((neu_req_write_tag_t *) &req[1]);
+    } else if (NEU_REQ_WRITE_TAGS == req->type) {
+        neu_req_write_tags_fini((neu_req_write_tags_t *) &req[1]);
+    } else if (NEU_REQ_WRITE_GTAGS == req->type) {
+        neu_req_write_gtags_fini((neu_req_write_gtags_t *) &req[1]);
+    }
+
+    req->type = NEU_RESP_ERROR;
+
+    nlog_notice("write tag response <%p>", req->ctx);
+
+    adapter->cb_funs.response(adapter, req, &nerror);
+}
+
+static void write_response(neu_adapter_t *adapter, void *r, neu_error error)
+{
+    neu_reqresp_head_t *req = (neu_reqresp_head_t *) r;
+
+    if (!verify_written((neu_adapter_driver_t *) adapter, req, error)) {
+        write_reply(adapter, req, error);
+    }
+}
+
+static void update_with_meta(neu_adapter_t *adapter, const char *group,
+                             const char *tag, neu_dvalue_t value,
+                             neu_tag_meta_t *metas, int n_meta)
+{
+    neu_adapter_driver_t *         driver = (neu_adapter_driver_t *) adapter;
+    neu_adapter_update_metric_cb_t update_metric =
+        driver->adapter.cb_funs.update_metric;
+    // stamp the value when the plugin hands it over, at device response time
+    int64_t now = neu_time_ms();
+
+    if (value.type == NEU_TYPE_ERROR) {
+        update_metric(&driver->adapter, NEU_METRIC_GROUP_LAST_ERROR_CODE,
+                      value.value.i32, group);
+        update_metric(&driver->adapter, NEU_METRIC_GROUP_LAST_ERROR_TS, now,
+                      group);
+    }
+
+    if (value.type == NEU_TYPE_ERROR && tag == NULL) {
+        group_t *g = find_group(driver, group);
+        if (g != NULL) {
+            neu_group_tag_view_t *view      = neu_group_get_read_view(g->group);
+            uint64_t              err_count = 0;
+
+            utarray_foreach(view->tags, neu_datatag_t *, t)
+            {
+                if (neu_tag_attribute_test(t, NEU_ATTRIBUTE_STATIC)) {
+                    continue;
+                }
+                neu_driver_cache_update(driver->cache, group, t->name, now,
+                                        value, NULL, 0);
+                ++err_count;
+            }
+            update_tag_reads(driver, err_count, err_count);
+            neu_group_put_read_view(view);
+        }
+    } else {
+        neu_driver_cache_update(driver->cache, group, tag, now, value, metas,
+                                n_meta);
+        update_tag_reads(driver, 1, NEU_TYPE_ERROR == value.type);
+    }
+    nlog_debug(
+        "update driver: %s, group: %s, tag: %s, type: %s, timestamp: %" PRId64
+        " n_meta: %d",
+        driver->adapter.name, group, tag, neu_type_string(value.type), now,
+        n_meta);
+}
+
+static void update_batch(neu_adapter_t *adapter, const char *group, int n,
+                         const char **tags, neu_dvalue_t *values)
+{
+    neu_adapter_driver_t *         driver = (neu_adapter_driver_t *) adapter;
+    neu_adapter_update_metric_cb_t update_metric =
+        driver->adapter.cb_funs.update_metric;
+    uint64_t n_error    = 0;
+    int32_t  last_error = 0;
+    int64_t  now        = neu_time_ms();
+
+    for (int i = 0; i < n; i++) {
+        if (values[i].type == NEU_TYPE_ERROR) {
+            last_error = values[i].value.i32;
+            n_error += 1;
+        }
+    }
+
+    if (n_error > 0) {
+        update_metric(&driver->adapter, NEU_METRIC_GROUP_LAST_ERROR_CODE,
+                      last_error, group);
+        update_metric(&driver->adapter, NEU_METRIC_GROUP_LAST_ERROR_TS, now,
+                      group);
+    }
+
+    neu_driver_cache_update_batch(driver->cache, group, now, n, tags, values);
+    update_tag_reads(driver, n, n_error);
+    nlog_debug("update driver: %s, group: %s, tags: %d, errors: %" PRIu64
+               ", timestamp: %" PRId64,
+               driver->adapter.name, group, n, n_error, now);
+}
+
+static void touch_batch(neu_adapter_t *adapter, const char *group, int n,
+                        const char **tags)
+{
+    neu_adapter_driver_t *driver = (neu_adapter_driver_t *) adapter;
+    int64_t               now    = neu_time_ms();
+
+    neu_driver_cache_touch_batch(driver->cache, group, now, n, tags);
+    update_tag_reads(driver, n, 0);
+    nlog_debug("touch driver: %s, group: %s, tags: %d, timestamp: %" PRId64,
+               driver->adapter.name, group, n, now);
+}
+
+static void update_im(neu_adapter_t *adapter, const char *group,
+                      const char *tag, neu_dvalue_t value,
+                      neu_tag_meta_t *metas, int n_meta)
+{
+    neu_adapter_driver_t *driver = (neu_adapter_driver_t *) adapter;
+    int64_t               now    = neu_time_ms();
+
+    if (tag == NULL || value.type == NEU_TYPE_ERROR) {
+        nlog_warn("update_im tag is null or value is error %d",
+                  value.value.i32);
+        return;
+    }
+
+    UT_array *tags = neu_adapter_driver_get_ptag(driver, group, tag);
+    if (tags == NULL) {
+        return;
+    }
+
+    neu_driver_cache_update_change(driver->cache, group, tag, now, value, metas,
+                                   n_meta, true);
+    update_tag_reads(driver, 1, 0);
+    neu_datatag_t *first = utarray_front(tags);
+
+    if (first == NULL ||
+        !neu_tag_attribute_test(first, NEU_ATTRIBUTE_SUBSCRIBE)) {
+        utarray_free(tags);
+        nlog_debug("update immediately, driver: %s, "
+                   "group: %s, tag: %s, type: %s, "
+                   "timestamp: %" PRId64,
+                   driver->adapter.name, group, tag,
+                   neu_type_string(value.type), now);
+        return;
+    }
+
+    nlog_debug("update and report immediately, driver: %s, "
+               "group: %s, tag: %s, type: %s, "
+               "timestamp: %" PRId64,
+               driver->adapter.name, group, tag, neu_type_string(value.type),
+               now);
+
+    const char *             name = neu_intern_name(first->name);
+    uint8_t                  attr = first->attribute;
+    neu_reqresp_trans_data_t data = {
+        .driver = (char *) neu_intern_name(driver->adapter.name),
+        .group  = (char *) neu_intern_name(group),
+        .ctx    = neu_trans_data_ctx_new(1),
+    };
+    data.tags = &data.ctx->tags;
+
+    bool     sent = false;
+    group_t *find = NULL;
+    HASH_FIND_STR(driver->groups, group, find);
+
+    // goes on from the last report of the group, so that the other changes
+    // pending go along and none of them is reported twice
+    read_report_group(now, (cache_policy_t) { .timeout = 0 }, driver->cache,
+                      group, 1, &name, &attr,
+                      find != NULL ? &find->report_seq : NULL, data.tags);
+
+    if (utarray_len(data.tags) > 0 && find != NULL) {
+        sub_apps_t *apps = sub_apps_get(find);
+        sent             = report_to_apps(driver, &data, apps);
+        sub_apps_put(apps);
+    }
+    if (!sent) {
+        neu_trans_data_ctx_free(data.ctx);
+    }
+
+    utarray_free(tags);
+}
+
+static void update(neu_adapter_t *adapter, const char *group, const char *tag,
+                   neu_dvalue_t value)
+{
+    update_with_meta(adapter, group, tag, value, NULL, 0);
+}
+
+neu_adapter_driver_t *neu_adapter_driver_create()
+{
+    neu_adapter_driver_t *driver = calloc(1, sizeof(neu_adapter_driver_t));
+
+    driver->cache                                   = neu_driver_cache_new();
+    neu_driver_cache_set_history(driver->cache, (size_t) history_kib * 1024);
+    driver->driver_events                           = neu_event_new();
+    driver->sched_policy                            = SCHED_OTHER;
+    driver->adapter.cb_funs.driver.update           = update;
+    driver->adapter.cb_funs.driver.write_response   = write_response;
+    driver->adapter.cb_funs.driver.update_im        = update_im;
+    driver->adapter.cb_funs.driver.update_with_meta = update_with_meta;
+    driver->adapter.cb_funs.driver.update_batch     = update_batch;
+    driver->adapter.cb_funs.driver.touch_batch      = touch_batch;
+
+    return driver;
+}
+
+void neu_adapter_driver_destroy(neu_adapter_driver_t *driver)
+{
+    for (uint16_t i = 1; i < driver->n_group_events; ++i) {
+        neu_event_close(driver->group_events[i]);
+    }
+    free(driver->group_events);
+    neu_event_close(driver->driver_events);
+    neu_driver_cache_destroy(driver->cache);
+    if (NULL != driver->lkv) {
+        neu_driver_cache_destroy(driver->lkv);
+    }
+    neu_json_decode_cache_retentions_fini(&driver->retentions);
+}
+
+// the retention of the group in the node setting, or of the node, or the
+// one the plugin caches with
+static void group_retain(neu_adapter_driver_t *driver, group_t *g)
+{
+    const neu_json_cache_retention_t *found = NULL;
+    uint8_t                           type  = 0;
+    int64_t                           ttl   = 0;
+
+    for (int i = 0; i < driver->retentions.n_retention; ++i) {
+        const neu_json_cache_retention_t *r = &driver->retentions.retentions[i];
+
+        if (NULL == r->group && NULL == found) {
+            found = r;
+        } else if (NULL != r->group && 0 == strcmp(r->group, g->name)) {
+            found = r;
+            break;
+        }
+    }
+    if (NULL != found) {
+        type = found->type;
+        ttl  = found->ttl;
+    } else {
+        type = neu_adapter_get_tag_cache_type(&driver->adapter);
+    }
+
+    __atomic_store_n(&g->ttl, ttl, __ATOMIC_RELAXED);
+    __atomic_store_n(&g->retention, type, __ATOMIC_RELAXED);
+}
+
+void neu_adapter_driver_set_retentions(neu_adapter_driver_t *       driver,
+                                       neu_json_cache_retentions_t *retentions)
+{
+    group_t *el = NULL, *tmp = NULL;
+
+    neu_json_decode_cache_retentions_fini(&driver->retentions);
+    driver->retentions = *retentions;
+    memset(retentions, 0, sizeof(*retentions));
+
+    HASH_ITER(hh, driver->groups, el, tmp)
+    {
+        group_retain(driver, el);
+    }
+}
+
+static cache_policy_t group_policy(group_t *g)
+{
+    cache_policy_t policy = {
+        .type    = __atomic_load_n(&g->retention, __ATOMIC_RELAXED),
+        .timeout = (int64_t) neu_group_get_interval(g->group) *
+            NEU_DRIVER_TAG_CACHE_EXPIRE_TIME,
+    };
+
+    if (NEU_TAG_CACHE_TYPE_TTL == policy.type) {
+        policy.timeout = __atomic_load_n(&g->ttl, __ATOMIC_RELAXED);
+    } else if (NEU_TAG_CACHE_TYPE_NEVER == policy.type) {
+        policy.timeout = 0;
+    }
+    return policy;
+}
+
+static void group_warm(group_t *g)
+{
+    if (__atomic_exchange_n(&g->cold, false, __ATOMIC_RELAXED)) {
+        nlog_notice("%s-%s polling resumed", g->driver->adapter.name, g->name);
+    }
+}
+
+// With cold_groups, a group nothing subscribes stops polling once nothing
+// read it for cold_groups intervals, and keeps its cached values. A
+// subscription or a read wakes it, returns whether the poll is skipped.
+static bool group_cold(group_t *g, int64_t now, uint32_t interval)
+{
+    if (0 == cold_groups) {
+        return false;
+    }
+
+    sub_apps_t *apps  = sub_apps_get(g);
+    uint16_t    n_app = apps->n_app;
+    sub_apps_put(apps);
+
+    if (n_app > 0) {
+        __atomic_store_n(&g->demand, now, __ATOMIC_RELAXED);
+    } else if (now - __atomic_load_n(&g->demand, __ATOMIC_RELAXED) >=
+               (int64_t) cold_groups * interval) {
+        if (!__atomic_exchange_n(&g->cold, true, __ATOMIC_RELAXED)) {
+            nlog_notice("%s-%s not subscribed nor read, polling paused",
+                        g->driver->adapter.name, g->name);
+        }
+        return true;
+    }
+
+    group_warm(g);
+    return false;
+}
+
+// a subscribed retention drops the values of a group nothing subscribes and
+// skips its reads, returns whether the group is to be read
+static bool group_retained(group_t *g)
+{
+    if (NEU_TAG_CACHE_TYPE_SUBSCRIBED !=
+        __atomic_load_n(&g->retention, __ATOMIC_RELAXED)) {
+        g->evicted = false;
+        return true;
+    }
+
+    sub_apps_t *apps  = sub_apps_get(g);
+    uint16_t    n_app = apps->n_app;
+    sub_apps_put(apps);
+
+    if (n_app > 0) {
+        g->evicted = false;
+        return true;
+    }
+    if (!g->evicted) {
+        nlog_notice("%s-%s not subscribed, cached values dropped",
+                    g->driver->adapter.name, g->name);
+        neu_driver_cache_evict(g->driver->cache, g->name);
+        g->evicted = true;
+    }
+    return false;
+}
+
+size_t neu_adapter_driver_mem_bytes(neu_adapter_driver_t *driver)
+{
+    size_t tag_cnt = __atomic_load_n(&driver->tag_cnt, __ATOMIC_RELAXED);
+
+    return sizeof(*driver) + tag_cnt * sizeof(neu_datatag_t) +
+        neu_driver_cache_mem_bytes(driver->cache);
+}
+
+size_t neu_adapter_driver_shrink_history(neu_adapter_driver_t *driver)
+{
+    return neu_driver_cache_shrink_history(driver->cache);
+}
+
+static int lkv_save_callback(void *usr_data)
+{
+    neu_adapter_driver_t *driver = (neu_adapter_driver_t *) usr_data;
+
+    adapter_storage_lkv(driver->adapter.name, driver->cache, driver->lkv);
+    return 0;
+}
+
+static void profile_read(group_t *group, int64_t spend, uint32_t interval)
+{
+    group_profile_t *p = &group->profile;
+
+    __atomic_add_fetch(&p->reads, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&p->read_ms, spend, __ATOMIC_RELAXED);
+    if (spend > interval) {
+        __atomic_add_fetch(&p->overruns, 1, __ATOMIC_RELAXED);
+    }
+    __atomic_add_fetch(&p->blocks, group->grp.n_block, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&p->latency[neu_tuning_latency_bucket(spend)], 1,
+                       __ATOMIC_RELAXED);
+}
+
+static void profile_tag(void *arg, const char *tag, uint32_t n)
+{
+    neu_persist_tag_profile_t profile = { .name = strdup(tag), .changes = n };
+
+    if (NULL != profile.name) {
+        utarray_push_back((UT_array *) arg, &profile);
+    }
+}
+
+// on the adapter loop, as the groups are added and deleted
+static int profile_save_callback(void *usr_data)
+{
+    neu_adapter_driver_t *driver = (neu_adapter_driver_t *) usr_data;
+    group_t *             el = NULL, *tmp = NULL;
+
+    HASH_ITER(hh, driver->groups, el, tmp)
+    {
+        group_profile_t *           p       = &el->profile;
+        neu_persist_group_profile_t profile = { .group_name = el->name };
+
+        profile.reads = __atomic_exchange_n(&p->reads, 0, __ATOMIC_RELAXED);
+        if (0 == profile.reads) {
+            // a paused or stopped group keeps the profile it has
+            continue;
+        }
+        profile.read_ms = __atomic_exchange_n(&p->read_ms, 0, __ATOMIC_RELAXED);
+        profile.overruns =
+            __atomic_exchange_n(&p->overruns, 0, __ATOMIC_RELAXED);
+        profile.blocks = __atomic_exchange_n(&p->blocks, 0, __ATOMIC_RELAXED);
+        for (int i = 0; i < NEU_TUNING_LATENCY_N; ++i) {
+            profile.latency[i] =
+                __atomic_exchange_n(&p->latency[i], 0, __ATOMIC_RELAXED);
+        }
+
+        utarray_new(profile.tags, neu_persist_tag_profile_icd());
+        neu_driver_cache_take_changes(driver->cache, el->name, profile_tag,
+                                      profile.tags);
+        adapter_storage_group_profile(driver->adapter.name, &profile);
+        utarray_free(profile.tags);
+    }
+
+    return 0;
+}
+
+// Groups are spread over the loops a plugin asks for, each group stays on one
+// loop, so a slow group only holds up the groups sharing its loop.
+static int group_events_init(neu_adapter_driver_t *driver)
+{
+    uint16_t n = driver->adapter.module->group_concurrency;
+
+    if (n < 1) {
+        n = 1;
+    } else if (n > NEU_DRIVER_GROUP_CONCURRENCY_MAX) {
+        n = NEU_DRIVER_GROUP_CONCURRENCY_MAX;
+    }
+
+    driver->group_events = calloc(n, sizeof(neu_events_t *));
+    if (NULL == driver->group_events) {
+        return -1;
+    }
+
+    driver->group_events[0] = driver->driver_events;
+    driver->n_group_events  = 1;
+    for (uint16_t i = 1; i < n; ++i) {
+        driver->group_events[i] = neu_event_new();
+        if (NULL == driver->group_events[i]) {
+            nlog_warn("driver: %s runs %" PRIu16 " group loops instead of "
+                      "%" PRIu16,
+                      driver->adapter.name, driver->n_group_events, n);
+            break;
+        }
+        driver->n_group_events += 1;
+    }
+
+    neu_adapter_driver_label(driver);
+    return 0;
+}
+
+void neu_adapter_driver_label(neu_adapter_driver_t *driver)
+{
+    char role[32] = { 0 };
+
+    neu_event_label(driver->driver_events, driver->adapter.name, "driver");
+    for (uint16_t i = 1; i < driver->n_group_events; ++i) {
+        snprintf(role, sizeof(role), "group loop %" PRIu16, i);
+        neu_event_label(driver->group_events[i], driver->adapter.name, role);
+    }
+}
+
+void neu_adapter_driver_set_affinity(neu_adapter_driver_t *driver,
+                                     const neu_cpus_t *    cpus)
+{
+    neu_event_set_affinity(driver->driver_events, cpus);
+    for (uint16_t i = 1; i < driver->n_group_events; ++i) {
+        neu_event_set_affinity(driver->group_events[i], cpus);
+    }
+}
+
+// a real time loop busy for this much of the cpu between two ticks of the
+// watchdog runs away, and goes back to SCHED_OTHER so the rest of the system
+// keeps running
+#define SCHED_WATCHDOG_MS 1000
+#define SCHED_WATCHDOG_PERCENT 90
+
+static inline neu_events_t *driver_loop(neu_adapter_driver_t *driver,
+                                        uint16_t              i)
+{
+    return 0 == i ? driver->driver_events : driver->group_events[i];
+}
+
+static inline uint16_t driver_n_loop(neu_adapter_driver_t *driver)
+{
+    return driver->n_group_events > 0 ? driver->n_group_events : 1;
+}
+
+static void sched_sample(neu_adapter_driver_t *driver)
+{
+    driver->sched_tick = neu_mono_ms();
+    for (uint16_t i = 0; i < driver_n_loop(driver); ++i) {
+        driver->sched_cpu[i] = neu_event_cputime(driver_loop(driver, i));
+    }
+}
+
+static int sched_watchdog(void *usr_data)
+{
+    neu_adapter_driver_t *driver  = (neu_adapter_driver_t *) usr_data;
+    int64_t               now     = neu_mono_ms();
+    int64_t               elapsed = (now - driver->sched_tick) * 1000 * 1000;
+
+    driver->sched_tick = now;
+    for (uint16_t i = 0; i < driver_n_loop(driver); ++i) {
+        neu_events_t *events = driver_loop(driver, i);
+        int64_t       cpu    = neu_event_cputime(events);
+        int64_t       busy   = cpu - driver->sched_cpu[i];
+
+        driver->sched_cpu[i] = cpu;
+        if (cpu < 0 || elapsed <= 0 || (driver->sched_demoted & (1U << i)) ||
+            busy * 100 < elapsed * SCHED_WATCHDOG_PERCENT) {
+            continue;
+        }
+
+        if (neu_event_set_sched(events, SCHED_OTHER, 0) == 0) {
+            driver->sched_demoted |= 1U << i;
+            nlog_warn("driver: %s loop %" PRIu16 " busy %" PRId64
+                      "%% of the cpu, back to SCHED_OTHER",
+                      driver->adapter.name, i, busy * 100 / elapsed);
+        }
+    }
+
+    return 0;
+}
+
+void neu_adapter_driver_set_sched(neu_adapter_driver_t *driver, int policy,
+                                  int priority)
+{
+    bool rt = SCHED_OTHER != policy;
+    int  rv = 0;
+
+    if (!rt && SCHED_OTHER == driver->sched_policy) {
+        return;
+    }
+
+    for (uint16_t i = 0; i < driver_n_loop(driver); ++i) {
+        if (neu_event_set_sched(driver_loop(driver, i), policy, priority) !=
+            0) {
+            rv = -1;
+        }
+    }
+    if (rt && 0 != rv) {
+        nlog_warn("driver: %s loops cannot run under a real time policy, "
+                  "needs CAP_SYS_NICE",
+                  driver->adapter.name);
+        for (uint16_t i = 0; i < driver_n_loop(driver); ++i) {
+            neu_event_set_sched(driver_loop(driver, i), SCHED_OTHER, 0);
+        }
+        policy = SCHED_OTHER;
+        rt     = false;
+    }
+
+    driver->sched_policy   = policy;
+    driver->sched_priority = priority;
+    driver->sched_demoted  = 0;
+    sched_sample(driver);
+
+    if (rt && NULL == driver->sched_watchdog) {
+        neu_event_timer_param_t param = {
+            .second      = 0,
+            .millisecond = SCHED_WATCHDOG_MS,
+            .usr_data    = (void *) driver,
+            .type        = NEU_EVENT_TIMER_NOBLOCK,
+            .cb          = sched_watchdog,
+        };
+
+        driver->sched_watchdog =
+            neu_adapter_add_timer((neu_adapter_t *) driver, param);
+    } else if (!rt && NULL != driver->sched_watchdog) {
+        neu_adapter_del_timer((neu_adapter_t *) driver, driver->sched_watchdog);
+        driver->sched_watchdog = NULL;
+    }
+
+    nlog_notice("driver: %s loops run under policy %d, priority %d",
+                driver->adapter.name, policy, rt ? priority : 0);
+}
+
+// the loop with the fewest groups
+static neu_events_t *group_events_pick(neu_adapter_driver_t *driver)
+{
+    group_t *el   = NULL, *tmp = NULL;
+    uint16_t pick = 0;
+
+    uint32_t n_group[NEU_DRIVER_GROUP_CONCURRENCY_MAX] = { 0 };
+
+    if (driver->n_group_events <= 1) {
+        return driver->driver_events;
+    }
+
+    HASH_ITER(hh, driver->groups, el, tmp)
+    {
+        for (uint16_t i = 0; i < driver->n_group_events; ++i) {
+            if (el->events == driver->group_events[i]) {
+                n_group[i] += 1;
+                break;
+            }
+        }
+    }
+
+    for (uint16_t i = 1; i < driver->n_group_events; ++i) {
+        if (n_group[i] < n_group[pick]) {
+            pick = i;
+        }
+    }
+
+    return driver->group_events[pick];
+}
+
+int neu_adapter_driver_init(neu_adapter_driver_t *driver)
+{
+    neu_node_metrics_t *metrics = driver->adapter.metrics;
+
+    if (0 != group_events_init(driver)) {
+        return -1;
+    }
+
+    if (NULL != metrics) {
+        driver->tag_reads = neu_node_metrics_find(metrics,
+                                                  NEU_METRIC_TAG_READS_TOTAL);
+        driver->tag_read_errors =
+            neu_node_metrics_find(metrics, NEU_METRIC_TAG_READ_ERRORS_TOTAL);
+    }
+
+    if (lkv_interval > 0 || handover) {
+        driver->lkv = neu_driver_cache_new();
+        adapter_load_lkv(driver->adapter.name, driver->lkv);
+    }
+
+    if (lkv_interval > 0) {
+        neu_event_timer_param_t param = {
+            .second      = lkv_interval,
+            .millisecond = 0,
+            .usr_data    = (void *) driver,
+            .type        = NEU_EVENT_TIMER_NOBLOCK,
+            .cb          = lkv_save_callback,
+        };
+
+        driver->lkv_timer =
+            neu_adapter_add_timer((neu_adapter_t *) driver, param);
+    }
+
+    if (profile_interval > 0) {
+        neu_event_timer_param_t param = {
+            .second      = profile_interval,
+            .millisecond = 0,
+            .usr_data    = (void *) driver,
+            .type        = NEU_EVENT_TIMER_NOBLOCK,
+            .cb          = profile_save_callback,
+        };
+
+        driver->profile_timer =
+            neu_adapter_add_timer((neu_adapter_t *) driver, param);
+    }
+
+    return 0;
+}
+
+int neu_adapter_driver_uninit(neu_adapter_driver_t *driver)
+{
+    group_t *el = NULL, *tmp = NULL;
+
+    if (NULL != driver->lkv_timer) {
+        neu_adapter_del_timer((neu_adapter_t *) driver, driver->lkv_timer);
+        driver->lkv_timer = NULL;
+    }
+    if (NULL != driver->profile_timer) {
+        neu_adapter_del_timer((neu_adapter_t *) driver, driver->profile_timer);
+        driver->profile_timer = NULL;
+    }
+    if (handover) {
+        adapter_storage_lkv(driver->adapter.name, driver->cache, driver->lkv);
+    }
+    if (NULL != driver->sched_watchdog) {
+        neu_adapter_del_timer((neu_adapter_t *) driver, driver->sched_watchdog);
+        driver->sched_watchdog = NULL;
+    }
+
+    HASH_ITER(hh, driver->groups, el, tmp)
+    {
+        HASH_DEL(driver->groups, el);
+
+        neu_adapter_driver_try_del_tag(driver, neu_group_tag_size(el->group));
+        del_report_timer(driver, el);
+        neu_event_del_timer(el->events, el->read);
+        neu_event_del_timer(el->events, el->write);
+        sync_drop(el, NEU_ERR_GROUP_NOT_EXIST);
+        verify_drop(el, NEU_ERR_GROUP_NOT_EXIST);
         if (el->grp.group_free != NULL) {
             el->grp.group_free(&el->grp);
         }
         free(el->grp.group_name);
         free(el->name);
+        columns_free(el);
+        computed_free(el);
         utarray_free(el->grp.tags);
 
         utarray_foreach(el->wt_tags, to_be_write_tag_t *, tag)
@@ -341,18 +1534,25 @@ int neu_adapter_driver_uninit(neu_adapter_driver_t *driver)
 
         utarray_free(el->static_tags);
         utarray_free(el->wt_tags);
-        utarray_free(el->apps);
+        utarray_free(el->sync_reqs);
+        utarray_free(el->verifies);
+        sub_apps_put(el->apps);
         neu_group_destroy(el->group);
+        pthread_mutex_destroy(&el->sync_mtx);
         free(el);
     }
+    update_report_tick(driver);
 
     return 0;
 }
 
 void neu_adapter_driver_start_group_timer(neu_adapter_driver_t *driver)
 {
-    group_t *el = NULL, *tmp = NULL;
+    group_t *el     = NULL, *tmp = NULL;
+    int64_t  offset = 0;
 
+    // spread the groups over their period instead of firing all at once, and
+    // report each group shortly after it is read
     HASH_ITER(hh, driver->groups, el, tmp)
     {
         uint32_t                interval = neu_group_get_interval(el->group);
@@ -361,22 +1561,19 @@ void neu_adapter_driver_start_group_timer(neu_adapter_driver_t *driver)
             .millisecond = interval % 1000,
             .usr_data    = el,
             .type        = NEU_EVENT_TIMER_NOBLOCK,
+            .delay       = interval > 0 ? offset % interval : 0,
         };
 
-        param.type = driver->adapter.module->timer_type;
-        param.cb   = read_callback;
-        el->read   = neu_event_add_timer(driver->driver_events, param);
-
-        struct timespec t1 = {
-            .tv_sec  = 0,
-            .tv_nsec = 1000 * 1000 * 20,
-        };
-        struct timespec t2 = { 0 };
-        nanosleep(&t1, &t2);
+        param.type   = driver->adapter.module->timer_type;
+        param.cb     = read_callback;
+        el->deadline = 0;
+        el->n_tick   = 0;
+        el->n_shed   = 0;
+        el->read     = neu_event_add_timer(el->events, param);
 
-        param.type = NEU_EVENT_TIMER_NOBLOCK;
-        param.cb   = report_callback;
-        el->report = neu_adapter_add_timer((neu_adapter_t *) driver, param);
+        add_report_timer(driver, el, interval,
+                         param.delay + NEU_DRIVER_TIMER_STAGGER);
+        offset += NEU_DRIVER_TIMER_STAGGER;
     }
 }
 
@@ -386,84 +1583,515 @@ void neu_adapter_driver_stop_group_timer(neu_adapter_driver_t *driver)
 
     HASH_ITER(hh, driver->groups, el, tmp)
     {
-        neu_adapter_del_timer((neu_adapter_t *) driver, el->report);
-        el->report = NULL;
-        neu_event_del_timer(driver->driver_events, el->read);
+        del_report_timer(driver, el);
+        neu_event_del_timer(el->events, el->read);
         el->read = NULL;
     }
+
+    if (NULL != driver->report_tick) {
+        neu_adapter_del_timer((neu_adapter_t *) driver, driver->report_tick);
+        driver->report_tick    = NULL;
+        driver->report_tick_ms = 0;
+    }
 }
 
-void neu_adapter_driver_read_group(neu_adapter_driver_t *driver,
-                                   neu_reqresp_head_t *  req)
+void neu_adapter_driver_detach_plugin(neu_adapter_driver_t *driver)
 {
-    neu_req_read_group_t *cmd = (neu_req_read_group_t *) &req[1];
-    group_t *             g   = find_group(driver, cmd->group);
-    if (g == NULL) {
-        neu_resp_error_t error = { .error = NEU_ERR_GROUP_NOT_EXIST };
-        req->type              = NEU_RESP_ERROR;
-        neu_req_read_group_fini(cmd);
-        driver->adapter.cb_funs.response(&driver->adapter, req, &error);
-        return;
+    group_t *el = NULL, *tmp = NULL;
+
+    // deleting a timer waits for its running callback, the report timers only
+    // read the cache and keep going
+    HASH_ITER(hh, driver->groups, el, tmp)
+    {
+        el->reload_read = el->read != NULL;
+        neu_event_del_timer(el->events, el->read);
+        neu_event_del_timer(el->events, el->write);
+        el->read  = NULL;
+        el->write = NULL;
+
+        // released by the code of the plugin that made it
+        if (el->grp.group_free != NULL) {
+            el->grp.group_free(&el->grp);
+        }
+        el->grp.group_free = NULL;
+        el->grp.user_data  = NULL;
     }
+}
+
+void neu_adapter_driver_attach_plugin(neu_adapter_driver_t *driver, bool fresh)
+{
+    group_t *el = NULL, *tmp = NULL;
 
-    neu_resp_read_group_t resp  = { 0 };
-    neu_group_t *         group = g->group;
-    UT_array *tags = neu_group_query_read_tag(group, cmd->name, cmd->desc);
+    HASH_ITER(hh, driver->groups, el, tmp)
+    {
+        uint32_t                interval = neu_group_get_interval(el->group);
+        neu_event_timer_param_t param    = {
+            .second      = 0,
+            .millisecond = 3,
+            .usr_data    = el,
+            .type        = NEU_EVENT_TIMER_NOBLOCK,
+            .cb          = queue_callback,
+        };
 
-    utarray_new(resp.tags, neu_resp_tag_value_meta_icd());
+        if (fresh && utarray_len(el->static_tags) > 0) {
+            neu_adapter_driver_load_tag(driver, el->name,
+                                        utarray_front(el->static_tags),
+                                        utarray_len(el->static_tags));
+        }
+        if (fresh && utarray_len(el->grp.tags) > 0) {
+            neu_adapter_driver_load_tag(driver, el->name,
+                                        utarray_front(el->grp.tags),
+                                        utarray_len(el->grp.tags));
+        }
+        columns_build(el);
+
+        el->write = neu_event_add_timer(el->events, param);
+        if (el->reload_read) {
+            param.second      = interval / 1000;
+            param.millisecond = interval % 1000;
+            param.type        = driver->adapter.module->timer_type;
+            param.cb          = read_callback;
+            el->deadline      = 0;
+            el->n_tick        = 0;
+            el->n_shed        = 0;
+            el->read          = neu_event_add_timer(el->events, param);
+            el->reload_read   = false;
+        }
+    }
+}
 
-    if (driver->adapter.state != NEU_NODE_RUNNING_STATE_RUNNING) {
-        utarray_foreach(tags, neu_datatag_t *, tag)
-        {
-            neu_resp_tag_value_meta_t tag_value = { 0 };
-            strcpy(tag_value.tag, tag->name);
-            tag_value.value.type      = NEU_TYPE_ERROR;
-            tag_value.value.value.i32 = NEU_ERR_PLUGIN_NOT_RUNNING;
+// Sync reads of a group are parked and run on the group loop, between two
+// polls of the group, so the device round trip never holds up the adapter
+// thread. The requests parked while a sync read is in flight or the group is
+// polled are answered together by the next sync read. Those issued before
+// the last sync read ended take its result rather than reading the device
+// again, as do requests allowing a read younger than max_age.
+static bool sync_coalesce(group_t *g, const neu_req_read_group_t *cmd)
+{
+    int64_t sync_end = __atomic_load_n(&g->sync_end, __ATOMIC_RELAXED);
+    if (cmd->issued != 0 && sync_end != 0 && cmd->issued <= sync_end) {
+        return true;
+    }
+
+    int64_t fresh = __atomic_load_n(&g->fresh, __ATOMIC_RELAXED);
+    return cmd->max_age > 0 && fresh != 0 &&
+        neu_mono_ms() - fresh <= (int64_t) cmd->max_age;
+}
+
+static void read_group_error(UT_array *tags, UT_array *tag_values, int error)
+{
+    utarray_foreach(tags, neu_datatag_t *, tag)
+    {
+        neu_resp_tag_value_meta_t tag_value = { 0 };
+        tag_value.tag             = neu_intern_name(tag->name);
+        tag_value.value.type      = NEU_TYPE_ERROR;
+        tag_value.value.value.i32 = error;
+
+        utarray_push_back(tag_values, &tag_value);
+    }
+}
+
+static void read_group_cached(neu_adapter_driver_t *driver, group_t *g,
+                              UT_array *tags, UT_array *tag_values)
+{
+    read_group(neu_time_ms_coarse(), group_policy(g), driver->cache, g->name,
+               tags, tag_values);
+}
+
+// takes tags and tag_values, and answers req with them
+static void read_group_reply(neu_adapter_driver_t *driver,
+                             neu_reqresp_head_t *req, UT_array *tags,
+                             UT_array *tag_values)
+{
+    neu_req_read_group_t *cmd  = (neu_req_read_group_t *) &req[1];
+    neu_resp_read_group_t resp = { 0 };
+
+    resp.driver = cmd->driver;
+    resp.group  = cmd->group;
+    resp.tags   = tag_values;
+    cmd->driver = NULL; // ownership moved
+    cmd->group  = NULL; // ownership moved
+
+    utarray_free(tags);
+    neu_req_read_group_fini(cmd);
+
+    req->type = NEU_RESP_READ_GROUP;
+    driver->adapter.cb_funs.response(&driver->adapter, req, &resp);
+}
 
-            utarray_push_back(resp.tags, &tag_value);
+// answers the parked requests with the error of each tag, or from the cache
+// if error is 0
+static void sync_reply(group_t *g, UT_array *reqs, int error)
+{
+    utarray_foreach(reqs, sync_read_t *, r)
+    {
+        UT_array *tag_values = NULL;
+
+        utarray_new(tag_values, neu_resp_tag_value_meta_icd());
+        if (0 == error) {
+            read_group_cached(g->driver, g, r->tags, tag_values);
+        } else {
+            read_group_error(r->tags, tag_values, error);
         }
-    } else if (cmd->sync) {
-        if (NULL == driver->adapter.module->intf_funs->driver.group_sync) {
-            // plugin does not support sync read
-            utarray_foreach(tags, neu_datatag_t *, tag)
-            {
-                neu_resp_tag_value_meta_t tag_value = { 0 };
-                strcpy(tag_value.tag, tag->name);
-                tag_value.value.type = NEU_TYPE_ERROR;
-                tag_value.value.value.i32 =
-                    NEU_ERR_PLUGIN_NOT_SUPPORT_READ_SYNC;
+        read_group_reply(g->driver, r->req, r->tags, tag_values);
+    }
+}
+
+static UT_array *sync_take(group_t *g)
+{
+    UT_array *reqs = NULL;
+
+    pthread_mutex_lock(&g->sync_mtx);
+    if (utarray_len(g->sync_reqs) > 0) {
+        reqs = g->sync_reqs;
+        utarray_new(g->sync_reqs, &sync_read_icd);
+    }
+    pthread_mutex_unlock(&g->sync_mtx);
+
+    return reqs;
+}
+
+// on the group loop, one device read for all the parked requests
+static void sync_run(group_t *g)
+{
+    neu_adapter_driver_t *driver = g->driver;
+    UT_array *            reqs   = sync_take(g);
+    int                   error  = 0;
+
+    if (NULL == reqs) {
+        return;
+    }
+
+    if (driver->adapter.state != NEU_NODE_RUNNING_STATE_RUNNING) {
+        error = NEU_ERR_PLUGIN_NOT_RUNNING;
+    } else {
+        driver->adapter.module->intf_funs->driver.group_sync(
+            driver->adapter.plugin, &g->grp);
+
+        int64_t end = neu_mono_ms();
+        __atomic_store_n(&g->sync_end, end, __ATOMIC_RELAXED);
+        __atomic_store_n(&g->fresh, end, __ATOMIC_RELAXED);
+        nlog_debug("%s-%s sync read for %u requests", driver->adapter.name,
+                   g->name, utarray_len(reqs));
+        group_warm(g);
+    }
+
+    sync_reply(g, reqs, error);
+    utarray_free(reqs);
+}
+
+// once the group loop is gone, answers the parked requests with error
+static void sync_drop(group_t *g, int error)
+{
+    UT_array *reqs = sync_take(g);
+
+    if (NULL != reqs) {
+        sync_reply(g, reqs, error);
+        utarray_free(reqs);
+    }
+}
+
+// Verified writes are answered once the values are read back from the
+// device. A write parks its expected values before it is queued, and once
+// the device accepted it the group loop arms it after the write slot. All
+// the writes armed in a slot are read back by one sync read if the plugin
+// has one, otherwise by the next poll of the group. The cache is updated by
+// the read back as by any read, and the write fails with the read error or
+// if a value differs from the one written.
+static verify_t *verify_new(neu_reqresp_head_t *req, int n_tag)
+{
+    verify_t *v = calloc(1, sizeof(verify_t) + n_tag * sizeof(verify_tag_t));
+    if (NULL != v) {
+        v->req = req;
+    }
+    return v;
+}
+
+// value as handed to the plugin
+static void verify_add(verify_t *v, const neu_datatag_t *tag,
+                       neu_value_u value)
+{
+    verify_tag_t *t = &v->tags[v->n_tag++];
+
+    snprintf(t->tag, sizeof(t->tag), "%s", tag->name);
+    t->expect.type  = tag->type;
+    t->expect.value = value;
+    neu_driver_cache_normalize(tag, &t->expect);
+}
+
+static void verify_park(group_t *g, verify_t *v)
+{
+    pthread_mutex_lock(&g->sync_mtx);
+    utarray_push_back(g->verifies, &v);
+    pthread_mutex_unlock(&g->sync_mtx);
+}
 
-                utarray_push_back(resp.tags, &tag_value);
+// whether the answer to req waits for the read back, given the result of
+// the write
+static bool verify_written(neu_adapter_driver_t *driver,
+                          neu_reqresp_head_t *req, int error)
+{
+    const char *group  = NULL;
+    bool        parked = false;
+
+    if (NEU_REQ_WRITE_TAG == req->type &&
+        ((neu_req_write_tag_t *) &req[1])->verify) {
+        group = ((neu_req_write_tag_t *) &req[1])->group;
+    } else if (NEU_REQ_WRITE_TAGS == req->type &&
+               ((neu_req_write_tags_t *) &req[1])->verify) {
+        group = ((neu_req_write_tags_t *) &req[1])->group;
+    }
+
+    group_t *g = NULL == group ? NULL : find_group(driver, group);
+    if (NULL == g) {
+        return false;
+    }
+
+    pthread_mutex_lock(&g->sync_mtx);
+    for (unsigned i = 0; i < utarray_len(g->verifies); ++i) {
+        verify_t *v = *(verify_t **) utarray_eltptr(g->verifies, i);
+
+        if (v->req == req) {
+            if (NEU_ERR_SUCCESS == error) {
+                v->written = true;
+                parked     = true;
+            } else {
+                utarray_erase(g->verifies, i, 1);
+                free(v);
             }
+            break;
+        }
+    }
+    pthread_mutex_unlock(&g->sync_mtx);
+
+    return parked;
+}
+
+static bool verify_same(const neu_dvalue_t *expect, const neu_dvalue_t *read)
+{
+    const neu_value_u *a = &expect->value;
+    const neu_value_u *b = &read->value;
+
+    switch (expect->type) {
+    case NEU_TYPE_BOOL:
+        return a->boolean == b->boolean;
+    case NEU_TYPE_BIT:
+    case NEU_TYPE_INT8:
+    case NEU_TYPE_UINT8:
+        return a->u8 == b->u8;
+    case NEU_TYPE_INT16:
+    case NEU_TYPE_UINT16:
+    case NEU_TYPE_WORD:
+        return a->u16 == b->u16;
+    case NEU_TYPE_INT32:
+    case NEU_TYPE_UINT32:
+    case NEU_TYPE_DWORD:
+    case NEU_TYPE_FLOAT:
+        return a->u32 == b->u32;
+    case NEU_TYPE_INT64:
+    case NEU_TYPE_UINT64:
+    case NEU_TYPE_LWORD:
+    case NEU_TYPE_DOUBLE:
+        return a->u64 == b->u64;
+    case NEU_TYPE_STRING:
+        return strncmp(a->str, b->str, sizeof(a->str)) == 0;
+    case NEU_TYPE_BYTES:
+        return a->bytes.length == b->bytes.length &&
+            memcmp(a->bytes.bytes, b->bytes.bytes, a->bytes.length) == 0;
+    default:
+        // arrays are not compared
+        return true;
+    }
+}
+
+// the result of v, -1 while a value is still to be read back
+static int verify_check(group_t *g, verify_t *v, int64_t now)
+{
+    for (int i = 0; i < v->n_tag; ++i) {
+        verify_tag_t *           t     = &v->tags[i];
+        neu_driver_cache_value_t value = { 0 };
+        neu_tag_meta_t           metas[NEU_TAG_META_SIZE];
+        int                      error = NEU_ERR_SUCCESS;
+
+        if (0 !=
+            neu_driver_cache_meta_get(g->driver->cache, g->name, t->tag,
+                                      &value, metas, NEU_TAG_META_SIZE)) {
+            return NEU_ERR_TAG_NOT_EXIST;
+        }
+
+        if (!v->synced && value.timestamp <= v->armed) {
+            error = now > v->deadline ? NEU_ERR_PLUGIN_TAG_NOT_READY : -1;
+        } else if (NEU_TYPE_ERROR == value.value.type) {
+            error = value.value.value.i32;
+        } else if (!verify_same(&t->expect, &value.value)) {
+            nlog_warn("%s-%s tag %s read back another value than written",
+                      g->driver->adapter.name, g->name, t->tag);
+            error = NEU_ERR_PLUGIN_WRITE_VERIFY_FAILURE;
+        }
+
+        if (NEU_TYPE_PTR == value.value.type) {
+            neu_value_ptr_put(value.value.value.ptr.ptr);
+        }
+        if (NEU_ERR_SUCCESS != error) {
+            return error;
+        }
+    }
+
+    return NEU_ERR_SUCCESS;
+}
+
+// answers the verified writes that are done, -1 in results for the others
+static void verify_reply(group_t *g, UT_array *done, UT_array *results)
+{
+    for (unsigned i = 0; i < utarray_len(done); ++i) {
+        verify_t *v     = *(verify_t **) utarray_eltptr(done, i);
+        int       error = *(int *) utarray_eltptr(results, i);
+
+        write_reply(&g->driver->adapter, v->req, error);
+        free(v);
+    }
+}
+
+// on the group loop, after the write slot
+static void verify_run(group_t *g)
+{
+    neu_adapter_driver_t *driver = g->driver;
+    int64_t               now    = neu_time_ms();
+    int64_t               span   = (int64_t) neu_group_get_interval(g->group) *
+        NEU_DRIVER_VERIFY_INTERVALS;
+    bool      armed   = false;
+    bool      synced  = false;
+    UT_array *done    = NULL;
+    UT_array *results = NULL;
+
+    pthread_mutex_lock(&g->sync_mtx);
+    utarray_foreach(g->verifies, verify_t **, v)
+    {
+        if ((*v)->written && 0 == (*v)->armed) {
+            (*v)->armed    = now;
+            (*v)->deadline = now + span;
+            armed          = true;
+        }
+    }
+    pthread_mutex_unlock(&g->sync_mtx);
+
+    // one read back for all the writes of the slot
+    if (armed && driver->adapter.state == NEU_NODE_RUNNING_STATE_RUNNING &&
+        NULL != driver->adapter.module->intf_funs->driver.group_sync) {
+        driver->adapter.module->intf_funs->driver.group_sync(
+            driver->adapter.plugin, &g->grp);
+
+        int64_t end = neu_mono_ms();
+        __atomic_store_n(&g->sync_end, end, __ATOMIC_RELAXED);
+        __atomic_store_n(&g->fresh, end, __ATOMIC_RELAXED);
+        synced = true;
+    }
+
+    // the writes the plugin is still to confirm are not checked
+    pthread_mutex_lock(&g->sync_mtx);
+    for (unsigned i = 0; i < utarray_len(g->verifies);) {
+        verify_t *v = *(verify_t **) utarray_eltptr(g->verifies, i);
+
+        v->synced |= synced && v->armed == now;
+        int error = v->armed > 0 ? verify_check(g, v, now) : -1;
+
+        if (error < 0) {
+            ++i;
+            continue;
+        }
+        if (NULL == done) {
+            utarray_new(done, &verify_icd);
+            utarray_new(results, &ut_int_icd);
+        }
+        utarray_push_back(done, &v);
+        utarray_push_back(results, &error);
+        utarray_erase(g->verifies, i, 1);
+    }
+    pthread_mutex_unlock(&g->sync_mtx);
+
+    if (NULL != done) {
+        verify_reply(g, done, results);
+        utarray_free(done);
+        utarray_free(results);
+    }
+}
+
+// once the group loop is gone, answers the writes waiting for the read back
+// with error, those the plugin is still to confirm are answered as usual
+static void verify_drop(group_t *g, int error)
+{
+    UT_array *done    = NULL;
+    UT_array *results = NULL;
+
+    utarray_new(done, &verify_icd);
+    utarray_new(results, &ut_int_icd);
+
+    pthread_mutex_lock(&g->sync_mtx);
+    utarray_foreach(g->verifies, verify_t **, v)
+    {
+        if ((*v)->written) {
+            utarray_push_back(done, v);
+            utarray_push_back(results, &error);
         } else {
-            // sync read to update cache
-            driver->adapter.module->intf_funs->driver.group_sync(
-                driver->adapter.plugin, &g->grp);
-            // fetch updated data from cache
-            read_group(global_timestamp,
-                       neu_group_get_interval(group) *
-                           NEU_DRIVER_TAG_CACHE_EXPIRE_TIME,
-                       neu_adapter_get_tag_cache_type(&driver->adapter),
-                       driver->cache, cmd->group, tags, resp.tags);
+            free(*v);
         }
-    } else {
-        read_group(global_timestamp,
-                   neu_group_get_interval(group) *
-                       NEU_DRIVER_TAG_CACHE_EXPIRE_TIME,
-                   neu_adapter_get_tag_cache_type(&driver->adapter),
-                   driver->cache, cmd->group, tags, resp.tags);
+    }
+    utarray_clear(g->verifies);
+    pthread_mutex_unlock(&g->sync_mtx);
+
+    verify_reply(g, done, results);
+    utarray_free(done);
+    utarray_free(results);
+}
+
+void neu_adapter_driver_read_group(neu_adapter_driver_t *driver,
+                                   neu_reqresp_head_t *  req)
+{
+    neu_req_read_group_t *cmd = (neu_req_read_group_t *) &req[1];
+    group_t *             g   = find_group(driver, cmd->group);
+    if (g == NULL) {
+        neu_resp_error_t error = { .error = NEU_ERR_GROUP_NOT_EXIST };
+        req->type              = NEU_RESP_ERROR;
+        neu_req_read_group_fini(cmd);
+        driver->adapter.cb_funs.response(&driver->adapter, req, &error);
+        return;
     }
 
-    resp.driver = cmd->driver;
-    resp.group  = cmd->group;
-    cmd->driver = NULL; // ownership moved
-    cmd->group  = NULL; // ownership moved
+    UT_array *tag_values = NULL;
+    UT_array *tags = neu_group_query_read_tag(g->group, cmd->name, cmd->desc);
+    // the values of a cold group are as old as its last poll, the first read
+    // wakes it with a sync read, the ones parked meanwhile share it
+    bool cold = __atomic_load_n(&g->cold, __ATOMIC_RELAXED) &&
+        NULL != driver->adapter.module->intf_funs->driver.group_sync;
 
-    utarray_free(tags);
-    neu_req_read_group_fini(cmd);
+    __atomic_store_n(&g->demand, neu_mono_ms(), __ATOMIC_RELAXED);
+    if (driver->adapter.state != NEU_NODE_RUNNING_STATE_RUNNING) {
+        utarray_new(tag_values, neu_resp_tag_value_meta_icd());
+        read_group_error(tags, tag_values, NEU_ERR_PLUGIN_NOT_RUNNING);
+    } else if (cmd->sync &&
+               NULL == driver->adapter.module->intf_funs->driver.group_sync) {
+        // plugin does not support sync read
+        utarray_new(tag_values, neu_resp_tag_value_meta_icd());
+        read_group_error(tags, tag_values,
+                         NEU_ERR_PLUGIN_NOT_SUPPORT_READ_SYNC);
+    } else if (cold || (cmd->sync && !sync_coalesce(g, cmd))) {
+        sync_read_t r = { .req = req, .tags = tags };
+
+        // answered by sync_run
+        pthread_mutex_lock(&g->sync_mtx);
+        utarray_push_back(g->sync_reqs, &r);
+        pthread_mutex_unlock(&g->sync_mtx);
+        return;
+    } else {
+        if (cmd->sync) {
+            nlog_debug("%s-%s sync read coalesced", driver->adapter.name,
+                       g->name);
+        }
+        utarray_new(tag_values, neu_resp_tag_value_meta_icd());
+        read_group_cached(driver, g, tags, tag_values);
+    }
 
-    req->type = NEU_RESP_READ_GROUP;
-    driver->adapter.cb_funs.response(&driver->adapter, req, &resp);
+    read_group_reply(driver, req, tags, tag_values);
 }
 
 static void fix_value(neu_datatag_t *tag, neu_type_e value_type,
@@ -682,13 +2310,18 @@ void neu_adapter_driver_write_tags(neu_adapter_driver_t *driver,
         return;
     }
 
-    UT_array *tags = NULL;
-    UT_icd    icd  = { sizeof(neu_plugin_tag_value_t), NULL, NULL, NULL };
+    UT_array *tags          = NULL;
+    UT_array *static_tags   = NULL;
+    UT_array *static_values = NULL;
+
+    UT_icd icd  = { sizeof(neu_plugin_tag_value_t), NULL, NULL, NULL };
+    UT_icd dicd = { sizeof(neu_dvalue_t), NULL, NULL, NULL };
     utarray_new(tags, &icd);
+    utarray_new(static_tags, neu_tag_get_icd());
+    utarray_new(static_values, &dicd);
     for (int i = 0; i < cmd->n_tag; i++) {
         neu_datatag_t *tag = neu_group_find_tag(g->group, cmd->tags[i].tag);
         if (tag != NULL && neu_tag_attribute_test(tag, NEU_ATTRIBUTE_WRITE) &&
-            neu_tag_attribute_test(tag, NEU_ATTRIBUTE_STATIC) == false &&
             is_value_in_range(tag->type, cmd->tags[i].value.value.i64)) {
             if (tag->type == NEU_TYPE_FLOAT || tag->type == NEU_TYPE_DOUBLE) {
                 if (cmd->tags[i].value.type == NEU_TYPE_INT64) {
@@ -702,18 +2335,26 @@ void neu_adapter_driver_write_tags(neu_adapter_driver_t *driver,
             }
             fix_value(tag, cmd->tags[i].value.type, &cmd->tags[i].value);
 
-            neu_plugin_tag_value_t tv = {
-                .tag   = neu_tag_dup(tag),
-                .value = cmd->tags[i].value.value,
-            };
-            utarray_push_back(tags, &tv);
+            if (neu_tag_attribute_test(tag, NEU_ATTRIBUTE_STATIC)) {
+                // applied all at once below, after all the tags are checked
+                neu_tag_set_static_value(tag, &cmd->tags[i].value.value);
+                utarray_push_back(static_tags, tag);
+                utarray_push_back(static_values, &cmd->tags[i].value);
+            } else {
+                neu_plugin_tag_value_t tv = {
+                    .tag   = neu_tag_dup(tag),
+                    .value = cmd->tags[i].value.value,
+                };
+                utarray_push_back(tags, &tv);
+            }
         }
         if (tag != NULL) {
             neu_tag_free(tag);
         }
     }
 
-    if (utarray_len(tags) != (unsigned int) cmd->n_tag) {
+    if (utarray_len(tags) + utarray_len(static_tags) !=
+        (unsigned int) cmd->n_tag) {
         driver->adapter.cb_funs.driver.write_response(&driver->adapter, req,
                                                       NEU_ERR_TAG_NOT_EXIST);
         utarray_foreach(tags, neu_plugin_tag_value_t *, tv)
@@ -721,13 +2362,50 @@ void neu_adapter_driver_write_tags(neu_adapter_driver_t *driver,
             neu_tag_free(tv->tag);
         }
         utarray_free(tags);
+        utarray_free(static_tags);
+        utarray_free(static_values);
+        return;
+    }
+
+    // static tags are only stored, with one write for all of them
+    if (utarray_len(static_tags) > 0) {
+        neu_datatag_t *statics = utarray_front(static_tags);
+        neu_dvalue_t * values  = utarray_front(static_values);
+        size_t         n       = utarray_len(static_tags);
+
+        for (size_t i = 0; i < n; i++) {
+            neu_driver_cache_update(g->driver->cache, g->name,
+                                    statics[i].name, neu_time_ms_coarse(),
+                                    values[i], NULL, 0);
+            neu_group_update_tag(g->group, &statics[i]);
+        }
+        adapter_storage_update_tag_values(cmd->driver, cmd->group, statics,
+                                          n);
+    }
+    utarray_free(static_tags);
+    utarray_free(static_values);
+
+    if (utarray_len(tags) == 0) {
+        driver->adapter.cb_funs.driver.write_response(&driver->adapter, req,
+                                                      NEU_ERR_SUCCESS);
+        utarray_free(tags);
         return;
     }
 
+    verify_t *v = cmd->verify ? verify_new(req, utarray_len(tags)) : NULL;
+    if (NULL != v) {
+        utarray_foreach(tags, neu_plugin_tag_value_t *, tv)
+        {
+            verify_add(v, tv->tag, tv->value);
+        }
+        verify_park(g, v);
+    }
+
     to_be_write_tag_t wtag = { 0 };
     wtag.single            = false;
     wtag.req               = (void *) req;
     wtag.tvs               = tags;
+    wtag.preempt           = cmd->preempt;
 
     store_write_tag(g, &wtag);
 }
@@ -827,6 +2505,7 @@ void neu_adapter_driver_write_gtags(neu_adapter_driver_t *driver,
     wtag.single            = false;
     wtag.req               = (void *) req;
     wtag.tvs               = tags;
+    wtag.preempt           = cmd->preempt;
 
     store_write_tag(first_g, &wtag);
 }
@@ -881,18 +2560,25 @@ void neu_adapter_driver_write_tag(neu_adapter_driver_t *driver,
 
         if (neu_tag_attribute_test(tag, NEU_ATTRIBUTE_STATIC)) {
             neu_driver_cache_update(g->driver->cache, g->name, tag->name,
-                                    global_timestamp, cmd->value, NULL, 0);
+                                    neu_time_ms_coarse(), cmd->value, NULL, 0);
             neu_tag_set_static_value(tag, &cmd->value.value);
             neu_group_update_tag(g->group, tag);
             adapter_storage_update_tag_value(cmd->driver, cmd->group, tag);
             driver->adapter.cb_funs.driver.write_response(&driver->adapter, req,
                                                           NEU_ERR_SUCCESS);
         } else {
+            verify_t *v = cmd->verify ? verify_new(req, 1) : NULL;
+            if (NULL != v) {
+                verify_add(v, tag, cmd->value.value);
+                verify_park(g, v);
+            }
+
             to_be_write_tag_t wtag = { 0 };
             wtag.single            = true;
             wtag.req               = (void *) req;
             wtag.value             = cmd->value.value;
             wtag.tag               = neu_tag_dup(tag);
+            wtag.preempt           = cmd->preempt;
 
             store_write_tag(g, &wtag);
         }
@@ -908,10 +2594,9 @@ void neu_adapter_driver_write_tag(neu_adapter_driver_t *driver,
 int neu_adapter_driver_add_group(neu_adapter_driver_t *driver, const char *name,
                                  uint32_t interval)
 {
-    UT_icd   icd     = { sizeof(to_be_write_tag_t), NULL, NULL, NULL };
-    UT_icd   sub_icd = { sizeof(sub_app_t), NULL, NULL, NULL };
-    group_t *find    = NULL;
-    int      ret     = NEU_ERR_GROUP_EXIST;
+    UT_icd   icd  = { sizeof(to_be_write_tag_t), NULL, NULL, NULL };
+    group_t *find = NULL;
+    int      ret  = NEU_ERR_GROUP_EXIST;
 
     HASH_FIND_STR(driver->groups, name, find);
     if (find == NULL) {
@@ -926,36 +2611,31 @@ int neu_adapter_driver_add_group(neu_adapter_driver_t *driver, const char *name,
 
         pthread_mutex_init(&find->wt_mtx, NULL);
         pthread_mutex_init(&find->apps_mtx, NULL);
+        pthread_mutex_init(&find->sync_mtx, NULL);
 
         utarray_new(find->wt_tags, &icd);
-        utarray_new(find->apps, &sub_icd);
+        utarray_new(find->sync_reqs, &sync_read_icd);
+        utarray_new(find->verifies, &verify_icd);
+        find->apps = sub_apps_new(0);
 
+        find->demand         = neu_mono_ms();
         find->driver         = driver;
         find->name           = strdup(name);
         find->group          = neu_group_new(name, interval);
         find->grp.group_name = strdup(name);
+        find->events         = group_events_pick(driver);
         neu_group_split_static_tags(find->group, &find->static_tags,
                                     &find->grp.tags);
 
         param.type = driver->adapter.module->timer_type;
         param.cb   = read_callback;
-        find->read = neu_event_add_timer(driver->driver_events, param);
-
-        struct timespec t1 = {
-            .tv_sec  = 0,
-            .tv_nsec = 1000 * 1000 * 20,
-        };
-        struct timespec t2 = { 0 };
-        nanosleep(&t1, &t2);
-
-        param.type   = NEU_EVENT_TIMER_NOBLOCK;
-        param.cb     = report_callback;
-        find->report = neu_adapter_add_timer((neu_adapter_t *) driver, param);
+        find->read = neu_event_add_timer(find->events, param);
 
+        param.type        = NEU_EVENT_TIMER_NOBLOCK;
         param.second      = 0;
         param.millisecond = 3;
-        param.cb          = write_callback;
-        find->write       = neu_event_add_timer(driver->driver_events, param);
+        param.cb          = queue_callback;
+        find->write       = neu_event_add_timer(find->events, param);
 
         REGISTER_GROUP_METRIC(&driver->adapter, find->name,
                               NEU_METRIC_GROUP_TAGS_TOTAL,
@@ -964,12 +2644,37 @@ int neu_adapter_driver_add_group(neu_adapter_driver_t *driver, const char *name,
                               NEU_METRIC_GROUP_LAST_SEND_MSGS, 0);
         REGISTER_GROUP_METRIC(&driver->adapter, find->name,
                               NEU_METRIC_GROUP_LAST_TIMER_MS, 0);
+        REGISTER_GROUP_METRIC(&driver->adapter, find->name,
+                              NEU_METRIC_GROUP_TIMER_MS, 0);
+        REGISTER_GROUP_METRIC(&driver->adapter, find->name,
+                              NEU_METRIC_GROUP_OVERRUNS_TOTAL, 0);
+        REGISTER_GROUP_METRIC(&driver->adapter, find->name,
+                              NEU_METRIC_GROUP_LAST_LAG_MS, 0);
+        REGISTER_GROUP_METRIC(&driver->adapter, find->name,
+                              NEU_METRIC_GROUP_LAG_MS, 0);
+        REGISTER_GROUP_METRIC(&driver->adapter, find->name,
+                              NEU_METRIC_GROUP_SKIPPED_TOTAL, 0);
+        REGISTER_GROUP_METRIC(&driver->adapter, find->name,
+                              NEU_METRIC_GROUP_TIMER_JITTER_US, 0);
+        REGISTER_GROUP_METRIC(&driver->adapter, find->name,
+                              NEU_METRIC_GROUP_TIMER_JITTER_MAX_US, 0);
+        REGISTER_GROUP_METRIC(&driver->adapter, find->name,
+                              NEU_METRIC_GROUP_LOAD_PERCENT, 0);
+        REGISTER_GROUP_METRIC(&driver->adapter, find->name,
+                              NEU_METRIC_GROUP_SHED_FACTOR, 1);
+        REGISTER_GROUP_METRIC(&driver->adapter, find->name,
+                              NEU_METRIC_GROUP_EFFECTIVE_INTERVAL_MS,
+                              interval);
         REGISTER_GROUP_METRIC(&driver->adapter, find->name,
                               NEU_METRIC_GROUP_LAST_ERROR_CODE, 0);
         REGISTER_GROUP_METRIC(&driver->adapter, find->name,
                               NEU_METRIC_GROUP_LAST_ERROR_TS, 0);
+        REGISTER_GROUP_METRIC(&driver->adapter, find->name,
+                              NEU_METRIC_GROUP_DEVICES_OFFLINE, 0);
 
+        group_retain(driver, find);
         HASH_ADD_STR(driver->groups, name, find);
+        add_report_timer(driver, find, interval, NEU_DRIVER_TIMER_STAGGER);
         ret = NEU_ERR_SUCCESS;
     }
 
@@ -1002,8 +2707,8 @@ int neu_adapter_driver_update_group(neu_adapter_driver_t *driver,
     }
 
     // stop the timer first to avoid race condition
-    neu_adapter_del_timer((neu_adapter_t *) driver, find->report);
-    neu_event_del_timer(driver->driver_events, find->read);
+    del_report_timer(driver, find);
+    neu_event_del_timer(find->events, find->read);
 
     // a diminutive value should keep the interval untouched
     if (interval < NEU_GROUP_INTERVAL_LIMIT) {
@@ -1023,8 +2728,14 @@ int neu_adapter_driver_update_group(neu_adapter_driver_t *driver,
             find->grp.group_name = new_name_cp2;
             neu_adapter_metric_update_group_name((neu_adapter_t *) driver, name,
                                                  new_name);
-            find->timestamp = global_timestamp; // trigger group_change
+            // the values carry over, the group reports on without a gap
+            neu_driver_cache_rename_group(driver->cache, name, new_name);
+            if (NULL != driver->lkv) {
+                neu_driver_cache_rename_group(driver->lkv, name, new_name);
+            }
+            find->timestamp = neu_time_ms_coarse(); // trigger group_change
             HASH_ADD_STR(driver->groups, name, find);
+            group_retain(driver, find);
         } else {
             free(new_name_cp1);
             free(new_name_cp2);
@@ -1040,23 +2751,22 @@ int neu_adapter_driver_update_group(neu_adapter_driver_t *driver,
     };
 
     neu_group_set_interval(find->group, interval);
+    find->deadline = 0;
+    find->stride   = 0;
+    find->n_tick   = 0;
+    find->n_fit    = 0;
+    find->n_shed   = 0;
+    neu_adapter_update_group_metric(&driver->adapter, find->name,
+                                    NEU_METRIC_GROUP_EFFECTIVE_INTERVAL_MS,
+                                    interval);
 
     // restore the timers
 
     param.type = driver->adapter.module->timer_type;
     param.cb   = read_callback;
-    find->read = neu_event_add_timer(driver->driver_events, param);
-
-    struct timespec t1 = {
-        .tv_sec  = 0,
-        .tv_nsec = 1000 * 1000 * 20,
-    };
-    struct timespec t2 = { 0 };
-    nanosleep(&t1, &t2);
+    find->read = neu_event_add_timer(find->events, param);
 
-    param.type   = NEU_EVENT_TIMER_NOBLOCK;
-    param.cb     = report_callback;
-    find->report = neu_adapter_add_timer((neu_adapter_t *) driver, param);
+    add_report_timer(driver, find, interval, NEU_DRIVER_TIMER_STAGGER);
 
     return ret;
 }
@@ -1072,9 +2782,12 @@ int neu_adapter_driver_del_group(neu_adapter_driver_t *driver, const char *name)
 
         neu_adapter_driver_try_del_tag(driver, neu_group_tag_size(find->group));
 
-        neu_adapter_del_timer((neu_adapter_t *) driver, find->report);
-        neu_event_del_timer(driver->driver_events, find->read);
-        neu_event_del_timer(driver->driver_events, find->write);
+        del_report_timer(driver, find);
+        update_report_tick(driver);
+        neu_event_del_timer(find->events, find->read);
+        neu_event_del_timer(find->events, find->write);
+        sync_drop(find, NEU_ERR_GROUP_NOT_EXIST);
+        verify_drop(find, NEU_ERR_GROUP_NOT_EXIST);
         if (find->grp.group_free != NULL) {
             find->grp.group_free(&find->grp);
         }
@@ -1091,6 +2804,16 @@ int neu_adapter_driver_del_group(neu_adapter_driver_t *driver, const char *name)
             neu_driver_cache_del(driver->cache, name, tag->name);
         }
 
+        if (find->computed_tags != NULL) {
+            utarray_foreach(find->computed_tags, neu_datatag_t *, tag)
+            {
+                neu_driver_cache_del(driver->cache, name, tag->name);
+            }
+        }
+        if (NULL != driver->lkv) {
+            neu_driver_cache_del_group(driver->lkv, name);
+        }
+
         utarray_foreach(find->wt_tags, to_be_write_tag_t *, tag)
         {
             if (tag->single) {
@@ -1108,13 +2831,18 @@ int neu_adapter_driver_del_group(neu_adapter_driver_t *driver, const char *name)
         driver->adapter.cb_funs.update_metric(
             &driver->adapter, NEU_METRIC_TAGS_TOTAL, driver->tag_cnt, NULL);
 
+        columns_free(find);
+        computed_free(find);
         utarray_free(find->static_tags);
         utarray_free(find->grp.tags);
         utarray_free(find->wt_tags);
-        utarray_free(find->apps);
+        utarray_free(find->sync_reqs);
+        utarray_free(find->verifies);
+        sub_apps_put(find->apps);
         neu_group_destroy(find->group);
         pthread_mutex_destroy(&find->wt_mtx);
         pthread_mutex_destroy(&find->apps_mtx);
+        pthread_mutex_destroy(&find->sync_mtx);
         free(find);
 
         neu_adapter_del_group_metrics(&driver->adapter, name);
@@ -1183,7 +2911,7 @@ UT_array *neu_adapter_driver_get_group(neu_adapter_driver_t *driver)
 
         info.interval  = neu_group_get_interval(el->group);
         info.tag_count = neu_group_tag_size(el->group);
-        strncpy(info.name, el->name, sizeof(info.name));
+        strncpy(info.name, el->name, sizeof(info.name) - 1);
 
         utarray_push_back(groups, &info);
     }
@@ -1224,11 +2952,55 @@ int neu_adapter_driver_try_del_tag(neu_adapter_driver_t *driver, int n_tag)
     return ret;
 }
 
-int neu_adapter_driver_validate_tag(neu_adapter_driver_t *driver,
-                                    const char *group, neu_datatag_t *tag)
+// a computed tag is only read, as a number, with an expression that compiles
+static int validate_computed_tag(const neu_datatag_t *tag)
 {
-    (void) group;
+    neu_expr_t *expr = NULL;
+
+    if (neu_tag_attribute_test(tag, NEU_ATTRIBUTE_WRITE)) {
+        return NEU_ERR_TAG_ATTRIBUTE_NOT_SUPPORT;
+    }
+
+    if (tag->type < NEU_TYPE_INT8 || tag->type > NEU_TYPE_BOOL) {
+        return NEU_ERR_TAG_TYPE_NOT_SUPPORT;
+    }
+
+    expr = neu_expr_compile(tag->address + 1);
+    if (expr == NULL) {
+        return NEU_ERR_TAG_ADDRESS_FORMAT_INVALID;
+    }
+    neu_expr_free(expr);
+
+    return NEU_ERR_SUCCESS;
+}
+
+// run the validator of the plugin on n tags, in one call if it validates
+// batches
+static int plugin_validate_tags(neu_adapter_driver_t *driver,
+                                neu_datatag_t **tags, int n, int *errors)
+{
+    const neu_plugin_intf_funs_t *funs    = driver->adapter.module->intf_funs;
+    int                           invalid = 0;
+
+    if (0 == n) {
+        return 0;
+    }
 
+    if (NULL != funs->driver.validate_tags) {
+        return funs->driver.validate_tags(driver->adapter.plugin, tags, n,
+                                          errors);
+    }
+
+    for (int i = 0; i < n; ++i) {
+        errors[i] = funs->driver.validate_tag(driver->adapter.plugin, tags[i]);
+        invalid += NEU_ERR_SUCCESS != errors[i];
+    }
+    return invalid;
+}
+
+// the checks of the driver, those of the plugin are left to the caller
+static int validate_tag_driver(const neu_datatag_t *tag)
+{
     if (strlen(tag->name) >= NEU_TAG_NAME_LEN) {
         return NEU_ERR_TAG_NAME_TOO_LONG;
     }
@@ -1250,17 +3022,78 @@ int neu_adapter_driver_validate_tag(neu_adapter_driver_t *driver,
         return NEU_ERR_TAG_ATTRIBUTE_NOT_SUPPORT;
     }
 
-    if (!neu_tag_attribute_test(tag, NEU_ATTRIBUTE_STATIC)) {
-        int ret = driver->adapter.module->intf_funs->driver.validate_tag(
-            driver->adapter.plugin, tag);
-        if (ret != NEU_ERR_SUCCESS) {
-            return ret;
+    if (neu_tag_is_computed(tag)) {
+        return validate_computed_tag(tag);
+    }
+
+    return NEU_ERR_SUCCESS;
+}
+
+static inline bool tag_validated_by_plugin(const neu_datatag_t *tag)
+{
+    return !neu_tag_is_computed(tag) &&
+        !neu_tag_attribute_test(tag, NEU_ATTRIBUTE_STATIC);
+}
+
+int neu_adapter_driver_validate_tag(neu_adapter_driver_t *driver,
+                                    const char *group, neu_datatag_t *tag)
+{
+    int n_valid = 0;
+    return neu_adapter_driver_validate_tags(driver, group, tag, 1, &n_valid);
+}
+
+int neu_adapter_driver_validate_tags(neu_adapter_driver_t *driver,
+                                     const char *group, neu_datatag_t *tags,
+                                     int n_tag, int *n_valid)
+{
+    int             ret      = NEU_ERR_SUCCESS;
+    int             n        = 0;
+    int             n_plugin = 0;
+    neu_datatag_t **ptags    = NULL;
+    int *           errors   = NULL;
+    (void) group;
+
+    // the plugin only sees the tags before the first one the driver rejects
+    for (n = 0; n < n_tag; ++n) {
+        if (NEU_ERR_SUCCESS != (ret = validate_tag_driver(&tags[n]))) {
+            break;
         }
     }
 
-    neu_datatag_parse_addr_option(tag, &tag->option);
+    ptags  = calloc(n > 0 ? n : 1, sizeof(*ptags));
+    errors = calloc(n > 0 ? n : 1, sizeof(*errors));
+    if (NULL == ptags || NULL == errors) {
+        free(ptags);
+        free(errors);
+        *n_valid = 0;
+        return NEU_ERR_EINTERNAL;
+    }
 
-    return NEU_ERR_SUCCESS;
+    for (int i = 0; i < n; ++i) {
+        if (tag_validated_by_plugin(&tags[i])) {
+            ptags[n_plugin++] = &tags[i];
+        }
+    }
+
+    if (0 != plugin_validate_tags(driver, ptags, n_plugin, errors)) {
+        // stop at the first tag the plugin rejects
+        for (int i = 0; i < n_plugin; ++i) {
+            if (NEU_ERR_SUCCESS != errors[i]) {
+                n   = ptags[i] - tags;
+                ret = errors[i];
+                break;
+            }
+        }
+    }
+
+    for (int i = 0; i < n; ++i) {
+        neu_datatag_parse_addr_option(&tags[i], &tags[i].option);
+    }
+
+    free(ptags);
+    free(errors);
+    *n_valid = n;
+    return ret;
 }
 
 int neu_adapter_driver_add_tag(neu_adapter_driver_t *driver, const char *group,
@@ -1269,9 +3102,8 @@ int neu_adapter_driver_add_tag(neu_adapter_driver_t *driver, const char *group,
     int      ret  = NEU_ERR_SUCCESS;
     group_t *find = NULL;
 
+    // the callers validate the tags first, in batches
     neu_datatag_parse_addr_option(tag, &tag->option);
-    driver->adapter.module->intf_funs->driver.validate_tag(
-        driver->adapter.plugin, tag);
 
     HASH_FIND_STR(driver->groups, group, find);
     if (find == NULL) {
@@ -1294,6 +3126,47 @@ int neu_adapter_driver_add_tag(neu_adapter_driver_t *driver, const char *group,
     return ret;
 }
 
+// add a group with its stored tags at once, the tags are moved into the group
+int neu_adapter_driver_load_group(neu_adapter_driver_t *driver,
+                                  const char *group, uint32_t interval,
+                                  neu_datatag_t *tags, int n_tag)
+{
+    group_t *find = NULL;
+
+    neu_adapter_driver_add_group(driver, group, interval);
+    HASH_FIND_STR(driver->groups, group, find);
+    if (find == NULL) {
+        return NEU_ERR_GROUP_NOT_EXIST;
+    }
+
+    // stored tags were valid once, they are validated so that the plugin
+    // compiles them
+    neu_datatag_t **ptags    = calloc(n_tag > 0 ? n_tag : 1, sizeof(*ptags));
+    int *           errors   = calloc(n_tag > 0 ? n_tag : 1, sizeof(*errors));
+    int             n_plugin = 0;
+    for (int i = 0; i < n_tag; ++i) {
+        neu_datatag_parse_addr_option(&tags[i], &tags[i].option);
+        if (NULL != ptags && !neu_tag_is_computed(&tags[i])) {
+            ptags[n_plugin++] = &tags[i];
+        }
+    }
+    if (NULL != ptags && NULL != errors) {
+        plugin_validate_tags(driver, ptags, n_plugin, errors);
+    }
+    free(ptags);
+    free(errors);
+    neu_adapter_driver_load_tag(driver, group, tags, n_tag);
+
+    driver->tag_cnt += neu_group_move_tags(find->group, tags, n_tag);
+    driver->adapter.cb_funs.update_metric(
+        &driver->adapter, NEU_METRIC_TAGS_TOTAL, driver->tag_cnt, NULL);
+    neu_adapter_update_group_metric(&driver->adapter, group,
+                                    NEU_METRIC_GROUP_TAGS_TOTAL,
+                                    neu_group_tag_size(find->group));
+
+    return NEU_ERR_SUCCESS;
+}
+
 int neu_adapter_driver_del_tag(neu_adapter_driver_t *driver, const char *group,
                                const char *tag)
 {
@@ -1342,7 +3215,12 @@ int neu_adapter_driver_update_tag(neu_adapter_driver_t *driver,
         return NEU_ERR_TAG_PRECISION_INVALID;
     }
 
-    if (!neu_tag_attribute_test(tag, NEU_ATTRIBUTE_STATIC)) {
+    if (neu_tag_is_computed(tag)) {
+        ret = validate_computed_tag(tag);
+        if (ret != NEU_ERR_SUCCESS) {
+            return ret;
+        }
+    } else if (!neu_tag_attribute_test(tag, NEU_ATTRIBUTE_STATIC)) {
         ret = driver->adapter.module->intf_funs->driver.validate_tag(
             driver->adapter.plugin, tag);
         if (ret != NEU_ERR_SUCCESS) {
@@ -1377,24 +3255,278 @@ int neu_adapter_driver_get_tag(neu_adapter_driver_t *driver, const char *group,
     return ret;
 }
 
-int neu_adapter_driver_query_tag(neu_adapter_driver_t *driver,
-                                 const char *group, const char *name,
-                                 UT_array **tags)
+int neu_adapter_driver_query_tag(neu_adapter_driver_t *   driver,
+                                 const neu_req_get_tag_t *cmd, UT_array **tags,
+                                 uint32_t *total)
 {
-    int      ret  = NEU_ERR_SUCCESS;
-    group_t *find = NULL;
+    group_t *            find = NULL;
+    neu_group_tag_page_t page = {
+        .name      = strlen(cmd->name) > 0 ? cmd->name : NULL,
+        .type      = cmd->type,
+        .attribute = cmd->attribute,
+        .after     = cmd->after,
+        .offset    = cmd->offset,
+        .limit     = cmd->limit,
+    };
 
-    HASH_FIND_STR(driver->groups, group, find);
-    if (find != NULL) {
-        if (strlen(name) > 0) {
-            *tags = neu_group_query_tag(find->group, name);
+    HASH_FIND_STR(driver->groups, cmd->group, find);
+    if (find == NULL) {
+        return NEU_ERR_GROUP_NOT_EXIST;
+    }
+
+    // filtered and paged on the shared search view, only the page is copied
+    return neu_group_query_tag_page(find->group, &page, tags, total);
+}
+
+int neu_adapter_driver_tag_history(neu_adapter_driver_t *           driver,
+                                   const neu_req_get_tag_history_t *cmd,
+                                   neu_resp_get_tag_history_t *     resp)
+{
+    UT_icd   point_icd = { sizeof(neu_history_point_t), NULL, NULL, NULL };
+    group_t *find      = NULL;
+    int      ret       = 0;
+
+    if (history_kib == 0) {
+        return NEU_ERR_TAG_HISTORY_DISABLED;
+    }
+
+    HASH_FIND_STR(driver->groups, cmd->group, find);
+    if (find == NULL) {
+        return NEU_ERR_GROUP_NOT_EXIST;
+    }
+
+    utarray_new(resp->points, &point_icd);
+    ret = neu_driver_cache_history(driver->cache, cmd->group, cmd->tag,
+                                   cmd->since, cmd->until, cmd->step,
+                                   cmd->limit, resp->points);
+    if (ret < 0) {
+        utarray_free(resp->points);
+        resp->points = NULL;
+        return NEU_ERR_TAG_NOT_EXIST;
+    }
+
+    resp->step      = cmd->step;
+    resp->truncated = ret > 0;
+    return NEU_ERR_SUCCESS;
+}
+
+static bool tag_changed(const neu_datatag_t *old, const neu_datatag_t *tag)
+{
+    uint8_t     a[NEU_TAG_STATIC_VALUE_BIN_SIZE] = { 0 };
+    uint8_t     b[NEU_TAG_STATIC_VALUE_BIN_SIZE] = { 0 };
+    const char *old_desc = old->description ? old->description : "";
+    const char *desc     = tag->description ? tag->description : "";
+    size_t      n        = 0;
+
+    if (!tag_same_point(old, tag) || 0 != strcmp(old_desc, desc) ||
+        0 != memcmp(&old->deadband, &tag->deadband, sizeof(tag->deadband)) ||
+        old->poll_divisor != tag->poll_divisor) {
+        return true;
+    }
+
+    if (!neu_tag_attribute_test(tag, NEU_ATTRIBUTE_STATIC)) {
+        return false;
+    }
+
+    n = neu_tag_pack_static_value(old, a);
+    return n != neu_tag_pack_static_value(tag, b) || 0 != memcmp(a, b, n);
+}
+
+static void free_tag_refs(tag_ref_t **refs)
+{
+    tag_ref_t *ref = NULL, *tmp = NULL;
+
+    HASH_ITER(hh, *refs, ref, tmp)
+    {
+        HASH_DEL(*refs, ref);
+        free(ref);
+    }
+}
+
+static int ref_tags(tag_ref_t **refs, neu_datatag_t *tags, int n_tag)
+{
+    for (int i = 0; i < n_tag; i++) {
+        tag_ref_t *ref = NULL;
+
+        HASH_FIND_STR(*refs, tags[i].name, ref);
+        if (NULL != ref) {
+            return NEU_ERR_TAG_NAME_CONFLICT;
+        }
+
+        ref = calloc(1, sizeof(tag_ref_t));
+        if (NULL == ref) {
+            return NEU_ERR_EINTERNAL;
+        }
+        ref->tag = &tags[i];
+        HASH_ADD_KEYPTR(hh, *refs, ref->tag->name, strlen(ref->tag->name),
+                        ref);
+    }
+
+    return NEU_ERR_SUCCESS;
+}
+
+// move the tags the group does not have yet to the front, returns how many
+static int front_new_tags(group_t *group, neu_datatag_t *tags, int n_tag)
+{
+    int n_new = 0;
+
+    for (int i = 0; i < n_tag; i++) {
+        neu_datatag_t *old = NULL;
+
+        if (NULL != group) {
+            old = neu_group_find_tag(group->group, tags[i].name);
+        }
+
+        if (NULL == old) {
+            neu_datatag_t tmp = tags[n_new];
+            tags[n_new]       = tags[i];
+            tags[i]           = tmp;
+            n_new += 1;
         } else {
-            *tags = neu_group_get_tag(find->group);
+            neu_tag_free(old);
+        }
+    }
+
+    return n_new;
+}
+
+static int apply_group_tags(neu_adapter_driver_t *driver, neu_gdatatag_t *gt,
+                            int n_new)
+{
+    const char *node = driver->adapter.name;
+    group_t *   find = find_group(driver, gt->group);
+    tag_ref_t * refs = NULL;
+    UT_array *  tags = NULL;
+    int         ret  = NEU_ERR_SUCCESS;
+
+    if (NULL == find) {
+        neu_adapter_driver_add_group(driver, gt->group, gt->interval);
+        adapter_storage_add_group(node, gt->group, gt->interval);
+    } else if (neu_group_get_interval(find->group) !=
+               (uint32_t) gt->interval) {
+        neu_adapter_driver_update_group(driver, gt->group, NULL, gt->interval);
+        adapter_storage_update_group(node, gt->group, gt->group, gt->interval);
+    }
+    find = find_group(driver, gt->group);
+    if (NULL == find) {
+        neu_adapter_driver_try_del_tag(driver, n_new);
+        return NEU_ERR_GROUP_NOT_EXIST;
+    }
+
+    ret = ref_tags(&refs, gt->tags, gt->n_tag);
+    if (NEU_ERR_SUCCESS != ret) {
+        free_tag_refs(&refs);
+        neu_adapter_driver_try_del_tag(driver, n_new);
+        return ret;
+    }
+
+    tags = neu_group_get_tag(find->group);
+    utarray_foreach(tags, neu_datatag_t *, tag)
+    {
+        tag_ref_t *ref = NULL;
+
+        HASH_FIND_STR(refs, tag->name, ref);
+        if (NULL == ref &&
+            NEU_ERR_SUCCESS ==
+                neu_adapter_driver_del_tag(driver, gt->group, tag->name)) {
+            adapter_storage_del_tag(node, gt->group, tag->name);
+        }
+    }
+    utarray_free(tags);
+    free_tag_refs(&refs);
+
+    for (int i = n_new; i < gt->n_tag; i++) {
+        neu_datatag_t *old = neu_group_find_tag(find->group, gt->tags[i].name);
+
+        if (NULL != old && tag_changed(old, &gt->tags[i])) {
+            ret = neu_adapter_driver_update_tag(driver, gt->group,
+                                                &gt->tags[i]);
+            if (NEU_ERR_SUCCESS == ret) {
+                adapter_storage_update_tag(node, gt->group, &gt->tags[i]);
+            }
+        }
+        neu_tag_free(old);
+        if (NEU_ERR_SUCCESS != ret) {
+            neu_adapter_driver_try_del_tag(driver, n_new);
+            return ret;
         }
-    } else {
-        ret = NEU_ERR_GROUP_NOT_EXIST;
     }
 
+    for (int i = 0; i < n_new; i++) {
+        ret = neu_adapter_driver_add_tag(driver, gt->group, &gt->tags[i],
+                                         gt->interval);
+        if (NEU_ERR_SUCCESS != ret) {
+            // release the plugin quota of the tags left unadded
+            neu_adapter_driver_try_del_tag(driver, n_new - i);
+            adapter_storage_add_tags(node, gt->group, gt->tags, i);
+            return ret;
+        }
+    }
+    adapter_storage_add_tags(node, gt->group, gt->tags, n_new);
+
+    return NEU_ERR_SUCCESS;
+}
+
+int neu_adapter_driver_apply_gtags(neu_adapter_driver_t *driver,
+                                   neu_req_add_gtag_t *  cmd,
+                                   neu_resp_add_tag_t *  resp)
+{
+    int  ret   = NEU_ERR_SUCCESS;
+    int  tried = 0;
+    int *n_new = calloc(cmd->n_group ? cmd->n_group : 1, sizeof(int));
+
+    if (NULL == n_new) {
+        resp->index = 0;
+        resp->error = NEU_ERR_EINTERNAL;
+        return NEU_ERR_EINTERNAL;
+    }
+
+    // reject the whole request before touching anything
+    for (int i = 0; i < cmd->n_group && NEU_ERR_SUCCESS == ret; i++) {
+        neu_gdatatag_t *gt   = &cmd->groups[i];
+        tag_ref_t *     refs = NULL;
+
+        ret = ref_tags(&refs, gt->tags, gt->n_tag);
+        free_tag_refs(&refs);
+        for (int j = 0; j < i && NEU_ERR_SUCCESS == ret; j++) {
+            if (0 == strcmp(cmd->groups[j].group, gt->group)) {
+                ret = NEU_ERR_GROUP_EXIST;
+            }
+        }
+        if (NEU_ERR_SUCCESS != ret) {
+            break;
+        }
+
+        n_new[i] = front_new_tags(find_group(driver, gt->group), gt->tags,
+                                  gt->n_tag);
+        ret = neu_adapter_driver_try_add_tag(driver, gt->group, gt->tags,
+                                             n_new[i]);
+        if (NEU_ERR_SUCCESS == ret) {
+            tried += 1;
+        }
+    }
+
+    if (NEU_ERR_SUCCESS != ret) {
+        for (int i = 0; i < tried; i++) {
+            neu_adapter_driver_try_del_tag(driver, n_new[i]);
+        }
+    }
+
+    for (int i = 0; i < cmd->n_group && NEU_ERR_SUCCESS == ret; i++) {
+        ret = apply_group_tags(driver, &cmd->groups[i], n_new[i]);
+        if (NEU_ERR_SUCCESS != ret) {
+            for (int j = i + 1; j < cmd->n_group; j++) {
+                neu_adapter_driver_try_del_tag(driver, n_new[j]);
+            }
+        }
+    }
+
+    if (NEU_ERR_SUCCESS != ret) {
+        resp->index = 0;
+        resp->error = ret;
+    }
+
+    free(n_new);
     return ret;
 }
 
@@ -1404,39 +3536,14 @@ void neu_adapter_driver_get_value_tag(neu_adapter_driver_t *driver,
     int ret = neu_adapter_driver_get_tag(driver, group, tags);
     if (ret == NEU_ERR_SUCCESS) {
         utarray_foreach(*tags, neu_datatag_t *, tag)
-        {
-            if (tag->decimal != 0) {
-                if (tag->type == NEU_TYPE_UINT8 || tag->type == NEU_TYPE_INT8 ||
-                    tag->type == NEU_TYPE_INT16 ||
-                    tag->type == NEU_TYPE_UINT16 ||
-                    tag->type == NEU_TYPE_INT32 ||
-                    tag->type == NEU_TYPE_UINT32 ||
-                    tag->type == NEU_TYPE_INT64 ||
-                    tag->type == NEU_TYPE_UINT64 ||
-                    tag->type == NEU_TYPE_FLOAT) {
-                    tag->type = NEU_TYPE_DOUBLE;
-                }
-            }
+        {
+            tag->type = report_type(tag);
         }
     } else {
         utarray_new(*tags, neu_tag_get_icd());
     }
 }
 
-UT_array *neu_adapter_driver_get_read_tag(neu_adapter_driver_t *driver,
-                                          const char *          group)
-{
-    group_t * find = NULL;
-    UT_array *tags = NULL;
-
-    HASH_FIND_STR(driver->groups, group, find);
-    if (find != NULL) {
-        tags = neu_group_get_read_tag(find->group);
-    }
-
-    return tags;
-}
-
 UT_array *neu_adapter_driver_get_ptag(neu_adapter_driver_t *driver,
                                       const char *group, const char *tag)
 {
@@ -1463,45 +3570,118 @@ static void report_to_app(neu_adapter_driver_t *driver, group_t *group,
         .type = NEU_REQRESP_TRANS_DATA,
     };
 
-    UT_array *tags =
-        neu_adapter_driver_get_read_tag(group->driver, group->name);
-
-    neu_reqresp_trans_data_t *data =
-        calloc(1, sizeof(neu_reqresp_trans_data_t));
-
-    data->driver = strdup(group->driver->adapter.name);
-    data->group  = strdup(group->name);
-    utarray_new(data->tags, neu_resp_tag_value_meta_icd());
+    neu_group_tag_view_t *   view = neu_group_get_read_view(group->group);
+    UT_array *               tags = view->tags;
+    neu_reqresp_trans_data_t data = {
+        .driver = (char *) neu_intern_name(group->driver->adapter.name),
+        .group  = (char *) neu_intern_name(group->name),
+        .ctx    = neu_trans_data_ctx_new(utarray_len(tags)),
+    };
+    data.tags = &data.ctx->tags;
 
-    read_group(global_timestamp,
-               neu_group_get_interval(group->group) *
-                   NEU_DRIVER_TAG_CACHE_EXPIRE_TIME,
-               neu_adapter_get_tag_cache_type(&driver->adapter), driver->cache,
-               group->name, tags, data->tags);
+    read_group(neu_time_ms_coarse(), group_policy(group), driver->cache,
+               group->name, tags, data.tags);
+    trace_report(group, &data.trace);
 
-    nlog_info("report group: %s, all tags: %d, report tags: %d", group->name,
-              utarray_len(tags), utarray_len(data->tags));
-    if (utarray_len(data->tags) > 0) {
-        pthread_mutex_lock(&group->apps_mtx);
+    nlog_ratelimit(ZLOG_LEVEL_INFO, NEU_LOG_RATELIMIT_INTERVAL,
+                   "report group: %s, all tags: %d, report tags: %d",
+                   group->name, utarray_len(tags), utarray_len(data.tags));
+    if (utarray_len(data.tags) > 0) {
+        neu_trans_data_ctx_init(data.ctx, 1);
 
-        data->ctx        = calloc(1, sizeof(neu_reqresp_trans_data_ctx_t));
-        data->ctx->index = 1;
+        if (driver->adapter.cb_funs.responseto(&driver->adapter, &header,
+                                               &data, dst) != 0) {
+            neu_trans_data_free(&data);
+        }
+    } else {
+        neu_trans_data_ctx_free(data.ctx);
+    }
+    neu_group_put_read_view(view);
+}
 
-        pthread_mutex_init(&data->ctx->mtx, NULL);
+// hand a snapshot set up for every app to each of them, the last of them
+// releases it
+static void send_to_apps(neu_adapter_driver_t *    driver,
+                         neu_reqresp_trans_data_t *data, sub_apps_t *apps,
+                         void *arg)
+{
+    neu_reqresp_head_t header = {
+        .type = NEU_REQRESP_TRANS_DATA,
+    };
 
+    (void) arg;
+    for (uint16_t i = 0; i < apps->n_app; ++i) {
         if (driver->adapter.cb_funs.responseto(&driver->adapter, &header, data,
-                                               dst) != 0) {
+                                               apps->apps[i].addr) != 0) {
             neu_trans_data_free(data);
         }
+    }
+}
+
+// hand a snapshot to every app, the last of them releases it, returns false
+// if there is no app and the snapshot is still the caller's
+static bool report_to_apps(neu_adapter_driver_t *    driver,
+                           neu_reqresp_trans_data_t *data, sub_apps_t *apps)
+{
+    if (0 == apps->n_app) {
+        return false;
+    }
+
+    neu_trans_data_ctx_init(data->ctx, apps->n_app);
+    send_to_apps(driver, data, apps, NULL);
+    return true;
+}
+
+// read the tag values of a group to report, false if there is nothing to send
+static bool collect_report(group_t *group, neu_reqresp_trans_data_t *data)
+{
+    neu_group_tag_view_t *view = neu_group_get_read_view(group->group);
+    UT_array *            tags = view->tags;
+
+    data->driver = (char *) neu_intern_name(group->driver->adapter.name);
+    data->group  = (char *) neu_intern_name(group->name);
+    data->ctx    = neu_trans_data_ctx_new(utarray_len(tags));
+    data->tags   = &data->ctx->tags;
+
+    read_report_group(neu_time_ms_coarse(), group_policy(group),
+                      group->driver->cache, group->name, utarray_len(tags),
+                      view->names, view->attributes, &group->report_seq,
+                      data->tags);
+    neu_group_put_read_view(view);
+
+    if (utarray_len(data->tags) == 0) {
+        neu_trans_data_ctx_free(data->ctx);
+        return false;
+    }
+
+    trace_report(group, &data->trace);
+    return true;
+}
+
+// takes a snapshot set up for every app of apps
+typedef void (*report_send_t)(neu_adapter_driver_t *    driver,
+                              neu_reqresp_trans_data_t *data, sub_apps_t *apps,
+                              void *arg);
+
+// the report of a group, for the timer of the group and the batch report
+// tick alike, send decides how the snapshot reaches the apps
+static void report_group(group_t *group, report_send_t send, void *arg)
+{
+    neu_reqresp_trans_data_t data = { 0 };
+    sub_apps_t *             apps = NULL;
+
+    if (!collect_report(group, &data)) {
+        return;
+    }
 
-        pthread_mutex_unlock(&group->apps_mtx);
+    apps = sub_apps_get(group);
+    if (apps->n_app > 0) {
+        neu_trans_data_ctx_init(data.ctx, apps->n_app);
+        send(group->driver, &data, apps, arg);
     } else {
-        utarray_free(data->tags);
-        free(data->group);
-        free(data->driver);
+        neu_trans_data_ctx_free(data.ctx);
     }
-    utarray_free(tags);
-    free(data);
+    sub_apps_put(apps);
 }
 
 static int report_callback(void *usr_data)
@@ -1512,73 +3692,339 @@ static int report_callback(void *usr_data)
         return 0;
     }
 
+    report_group(group, send_to_apps, NULL);
+    return 0;
+}
+
+typedef struct {
+    struct sockaddr_un             addr;
+    neu_reqresp_trans_data_batch_t batch;
+} app_batch_t;
+
+// the reports of one tick, one batch per app
+typedef struct {
+    app_batch_t *batches;
+    uint16_t     n_batch;
+    uint16_t     n_group;
+} report_batches_t;
+
+// add the snapshot to the batch of every app
+static void send_to_batches(neu_adapter_driver_t *    driver,
+                            neu_reqresp_trans_data_t *data, sub_apps_t *apps,
+                            void *arg)
+{
+    report_batches_t *b = (report_batches_t *) arg;
+
+    (void) driver;
+    for (uint16_t j = 0; j < apps->n_app; ++j) {
+        sub_app_t *  app   = &apps->apps[j];
+        app_batch_t *batch = NULL;
+        for (uint16_t i = 0; i < b->n_batch; ++i) {
+            if (0 ==
+                memcmp(&b->batches[i].addr, &app->addr, sizeof(app->addr))) {
+                batch = &b->batches[i];
+                break;
+            }
+        }
+
+        if (NULL == batch) {
+            size_t size = (b->n_batch + 1) * sizeof(app_batch_t);
+
+            b->batches = realloc(b->batches, size);
+            batch      = &b->batches[b->n_batch++];
+
+            batch->addr         = app->addr;
+            batch->batch.n_data = 0;
+            batch->batch.datas  = calloc(b->n_group, sizeof(*data));
+        }
+
+        batch->batch.datas[batch->batch.n_data++] = *data;
+    }
+}
+
+static int report_tick_callback(void *usr_data)
+{
+    neu_adapter_driver_t *driver  = (neu_adapter_driver_t *) usr_data;
+    group_t *             el      = NULL;
+    group_t *             tmp     = NULL;
+    report_batches_t      batches = { .n_group = HASH_COUNT(driver->groups) };
+    int64_t               now     = neu_time_ms_coarse();
+
+    if (driver->adapter.state != NEU_NODE_RUNNING_STATE_RUNNING) {
+        return 0;
+    }
+
+    HASH_ITER(hh, driver->groups, el, tmp)
+    {
+        uint32_t interval = neu_group_get_interval(el->group);
+
+        // the tick is the gcd of the intervals, allow half a tick of jitter
+        if (el->next_report - driver->report_tick_ms / 2 > now) {
+            continue;
+        }
+        el->next_report += interval;
+        if (el->next_report <= now) {
+            el->next_report = now + interval;
+        }
+
+        report_group(el, send_to_batches, &batches);
+    }
+
     neu_reqresp_head_t header = {
-        .type = NEU_REQRESP_TRANS_DATA,
+        .type = NEU_REQRESP_TRANS_DATA_BATCH,
     };
 
-    UT_array *tags =
-        neu_adapter_driver_get_read_tag(group->driver, group->name);
+    for (uint16_t i = 0; i < batches.n_batch; ++i) {
+        app_batch_t *batch = &batches.batches[i];
 
-    neu_reqresp_trans_data_t *data =
-        calloc(1, sizeof(neu_reqresp_trans_data_t));
+        nlog_debug("report batch, driver: %s, groups: %" PRIu16,
+                   driver->adapter.name, batch->batch.n_data);
+        if (driver->adapter.cb_funs.responseto(&driver->adapter, &header,
+                                               &batch->batch,
+                                               batch->addr) != 0) {
+            neu_trans_data_batch_free(&batch->batch);
+        }
+    }
 
-    data->driver = strdup(group->driver->adapter.name);
-    data->group  = strdup(group->name);
-    utarray_new(data->tags, neu_resp_tag_value_meta_icd());
+    free(batches.batches);
+    return 0;
+}
 
-    read_report_group(global_timestamp,
-                      neu_group_get_interval(group->group) *
-                          NEU_DRIVER_TAG_CACHE_EXPIRE_TIME,
-                      neu_adapter_get_tag_cache_type(&group->driver->adapter),
-                      group->driver->cache, group->name, tags, data->tags);
+static uint32_t gcd(uint32_t a, uint32_t b)
+{
+    while (b != 0) {
+        uint32_t t = a % b;
+        a          = b;
+        b          = t;
+    }
+    return a;
+}
 
-    if (utarray_len(data->tags) > 0) {
-        pthread_mutex_lock(&group->apps_mtx);
+static void update_report_tick(neu_adapter_driver_t *driver)
+{
+    group_t *el   = NULL;
+    group_t *tmp  = NULL;
+    uint32_t tick = 0;
 
-        if (utarray_len(group->apps) > 0) {
-            data->ctx        = calloc(1, sizeof(neu_reqresp_trans_data_ctx_t));
-            data->ctx->index = utarray_len(group->apps);
-            pthread_mutex_init(&data->ctx->mtx, NULL);
+    if (!batch_report) {
+        return;
+    }
 
-            utarray_foreach(group->apps, sub_app_t *, app)
-            {
-                if (group->driver->adapter.cb_funs.responseto(
-                        &group->driver->adapter, &header, data, app->addr) !=
-                    0) {
-                    neu_trans_data_free(data);
-                }
-            }
-        } else {
-            utarray_foreach(data->tags, neu_resp_tag_value_meta_t *, tag_value)
-            {
-                if (tag_value->value.type == NEU_TYPE_PTR) {
-                    free(tag_value->value.value.ptr.ptr);
-                }
-            }
-            utarray_free(data->tags);
-            free(data->group);
-            free(data->driver);
+    HASH_ITER(hh, driver->groups, el, tmp)
+    {
+        tick = gcd(tick, neu_group_get_interval(el->group));
+    }
+    if (tick > 0 && tick < NEU_DRIVER_REPORT_TICK_MIN) {
+        tick = NEU_DRIVER_REPORT_TICK_MIN;
+    }
+
+    if (tick == driver->report_tick_ms &&
+        (0 == tick || NULL != driver->report_tick)) {
+        return;
+    }
+
+    if (NULL != driver->report_tick) {
+        neu_adapter_del_timer((neu_adapter_t *) driver, driver->report_tick);
+        driver->report_tick = NULL;
+    }
+
+    driver->report_tick_ms = tick;
+    if (0 == tick) {
+        return;
+    }
+
+    neu_event_timer_param_t param = {
+        .second      = tick / 1000,
+        .millisecond = tick % 1000,
+        .usr_data    = (void *) driver,
+        .type        = NEU_EVENT_TIMER_NOBLOCK,
+        .cb          = report_tick_callback,
+    };
+    driver->report_tick =
+        neu_adapter_add_timer((neu_adapter_t *) driver, param);
+    nlog_notice("driver: %s, batch report tick: %" PRIu32 "ms",
+                driver->adapter.name, tick);
+}
+
+static void add_report_timer(neu_adapter_driver_t *driver, group_t *group,
+                             uint32_t interval, int64_t delay)
+{
+    if (batch_report) {
+        group->report      = NULL;
+        group->next_report = neu_time_ms_coarse() + interval + delay;
+        update_report_tick(driver);
+        return;
+    }
+
+    neu_event_timer_param_t param = {
+        .second      = interval / 1000,
+        .millisecond = interval % 1000,
+        .usr_data    = (void *) group,
+        .type        = NEU_EVENT_TIMER_NOBLOCK,
+        .cb          = report_callback,
+        .delay       = delay,
+    };
+    group->report = neu_adapter_add_timer((neu_adapter_t *) driver, param);
+}
+
+static void del_report_timer(neu_adapter_driver_t *driver, group_t *group)
+{
+    if (NULL != group->report) {
+        neu_adapter_del_timer((neu_adapter_t *) driver, group->report);
+        group->report = NULL;
+    }
+}
+
+void neu_adapter_driver_set_batch_report(bool enable)
+{
+    batch_report = enable;
+}
+
+void neu_adapter_driver_set_lkv_interval(uint32_t seconds)
+{
+    lkv_interval = seconds;
+}
+
+void neu_adapter_driver_set_handover(bool enable)
+{
+    handover = enable;
+}
+
+void neu_adapter_driver_set_overrun(neu_group_overrun_e policy)
+{
+    overrun_policy = policy;
+}
+
+void neu_adapter_driver_set_shed_max(uint32_t max)
+{
+    shed_max = max > 0 ? max : 1;
+}
+
+void neu_adapter_driver_set_stretch_max(uint32_t max)
+{
+    stretch_max = max > 0 ? max : 1;
+}
+
+void neu_adapter_driver_set_cold_groups(uint32_t n)
+{
+    cold_groups = n;
+}
+
+void neu_adapter_driver_set_profile_interval(uint32_t seconds)
+{
+    profile_interval = seconds;
+}
+
+void neu_adapter_driver_set_write_through(bool enable)
+{
+    write_through = enable;
+}
+
+void neu_adapter_driver_set_history(uint32_t kib)
+{
+    history_kib = kib;
+}
+
+// serve the value saved before the restart until the tag is first read
+static void restore_tag(group_t *group, neu_datatag_t *tag)
+{
+    neu_adapter_driver_t *   driver = group->driver;
+    neu_driver_cache_value_t value  = { 0 };
+    neu_tag_meta_t           stale  = { 0 };
+
+    if (NULL == driver->lkv ||
+        neu_driver_cache_take(driver->lkv, group->name, tag->name, &value) !=
+            0) {
+        return;
+    }
+
+    // the tag has been redefined since
+    if (value.value.type != report_type(tag)) {
+        return;
+    }
+
+    strcpy(stale.name, NEU_DRIVER_CACHE_META_STALE);
+    stale.value.type      = NEU_TYPE_INT64;
+    stale.value.value.i64 = value.timestamp;
+
+    neu_driver_cache_restore(driver->cache, group->name, tag->name,
+                             neu_time_ms_coarse(), value.value, &stale, 1);
+}
+
+// the plugin reads a tag the same way, see neu_plugin_group_delta_t
+static bool tag_same_read(const neu_datatag_t *a, const neu_datatag_t *b)
+{
+    return tag_same_point(a, b) && a->poll_divisor == b->poll_divisor;
+}
+
+static void group_delta_free(neu_plugin_group_delta_t *delta)
+{
+    utarray_free(delta->added);
+    utarray_free(delta->removed);
+    utarray_free(delta->modified);
+}
+
+// what tags changes of the old ones for the plugin, -1 without memory
+static int group_delta(UT_array *old, UT_array *tags,
+                       neu_plugin_group_delta_t *delta)
+{
+    tag_ref_t *refs = NULL, *ref = NULL, *tmp = NULL;
+
+    utarray_foreach(old, neu_datatag_t *, tag)
+    {
+        if (NULL == (ref = calloc(1, sizeof(tag_ref_t)))) {
+            free_tag_refs(&refs);
+            return -1;
         }
+        ref->tag = tag;
+        HASH_ADD_KEYPTR(hh, refs, tag->name, strlen(tag->name), ref);
+    }
 
-        pthread_mutex_unlock(&group->apps_mtx);
-    } else {
-        utarray_free(data->tags);
-        free(data->group);
-        free(data->driver);
+    utarray_new(delta->added, &ut_ptr_icd);
+    utarray_new(delta->removed, &ut_ptr_icd);
+    utarray_new(delta->modified, &ut_ptr_icd);
+    utarray_foreach(tags, neu_datatag_t *, tag)
+    {
+        HASH_FIND_STR(refs, tag->name, ref);
+        if (NULL == ref) {
+            utarray_push_back(delta->added, &tag);
+            continue;
+        }
+        if (!tag_same_read(ref->tag, tag)) {
+            utarray_push_back(delta->modified, &tag);
+        }
+        HASH_DEL(refs, ref);
+        free(ref);
     }
-    utarray_free(tags);
-    free(data);
+    HASH_ITER(hh, refs, ref, tmp)
+    {
+        utarray_push_back(delta->removed, &ref->tag);
+        HASH_DEL(refs, ref);
+        free(ref);
+    }
+
     return 0;
 }
 
 static void group_change(void *arg, int64_t timestamp, UT_array *static_tags,
                          UT_array *other_tags, uint32_t interval)
 {
-    group_t *group   = (group_t *) arg;
+    group_t *                     group  = (group_t *) arg;
+    tag_ref_t *                   refs   = NULL, *ref = NULL, *tmp = NULL;
+    UT_array *                    old    = group->grp.tags;
+    neu_plugin_group_delta_t      delta  = { 0 };
+    bool                          update = false;
+    const neu_plugin_intf_funs_t *intf =
+        group->driver->adapter.module->intf_funs;
     group->timestamp = timestamp;
     (void) interval;
 
-    if (group->grp.group_free != NULL)
+    // a plugin that updates its state keeps polling the unchanged tags the
+    // way it planned them
+    update = NULL != group->grp.user_data &&
+        NULL != intf->driver.group_update && NULL != old &&
+        0 == group_delta(old, other_tags, &delta);
+    if (!update && group->grp.group_free != NULL)
         group->grp.group_free(&group->grp);
 
     utarray_foreach(group->static_tags, neu_datatag_t *, tag)
@@ -1586,36 +4032,82 @@ static void group_change(void *arg, int64_t timestamp, UT_array *static_tags,
         neu_driver_cache_del(group->driver->cache, group->name, tag->name);
     }
 
+    // keep the cached values of the tags that did not change, so that a small
+    // edit does not reset the whole group
     utarray_foreach(group->grp.tags, neu_datatag_t *, tag)
     {
-        neu_driver_cache_del(group->driver->cache, group->name, tag->name);
+        ref = calloc(1, sizeof(tag_ref_t));
+        if (NULL == ref) {
+            neu_driver_cache_del(group->driver->cache, group->name, tag->name);
+            continue;
+        }
+        ref->tag = tag;
+        HASH_ADD_KEYPTR(hh, refs, tag->name, strlen(tag->name), ref);
+    }
+    if (group->computed_tags != NULL) {
+        utarray_foreach(group->computed_tags, neu_datatag_t *, tag)
+        {
+            ref = calloc(1, sizeof(tag_ref_t));
+            if (NULL == ref) {
+                neu_driver_cache_del(group->driver->cache, group->name,
+                                     tag->name);
+                continue;
+            }
+            ref->tag = tag;
+            HASH_ADD_KEYPTR(hh, refs, tag->name, strlen(tag->name), ref);
+        }
     }
 
-    utarray_foreach(static_tags, neu_datatag_t *, tag)
+    utarray_foreach(other_tags, neu_datatag_t *, tag)
     {
         neu_dvalue_t value = { 0 };
 
-        value.precision = tag->precision;
-        value.type      = tag->type;
-        if (0 != neu_tag_get_static_value(tag, &value.value)) {
-            value.type      = NEU_TYPE_ERROR;
-            value.value.i32 = NEU_ERR_EINTERNAL;
+        HASH_FIND_STR(refs, tag->name, ref);
+        if (NULL != ref) {
+            bool same = tag_same_point(ref->tag, tag);
+            HASH_DEL(refs, ref);
+            free(ref);
+            if (same &&
+                neu_driver_cache_exist(group->driver->cache, group->name,
+                                       tag->name)) {
+                neu_driver_cache_set_deadband(group->driver->cache,
+                                              group->name, tag->name,
+                                              &tag->deadband);
+                continue;
+            }
+            neu_driver_cache_del(group->driver->cache, group->name, tag->name);
         }
 
+        value.precision = tag->precision;
+        value.type      = NEU_TYPE_ERROR;
+        value.value.i32 = NEU_ERR_PLUGIN_TAG_NOT_READY;
+
         neu_driver_cache_add(group->driver->cache, group->name, tag->name,
-                             value);
+                             tag, value);
+        restore_tag(group, tag);
     }
 
-    utarray_foreach(other_tags, neu_datatag_t *, tag)
+    HASH_ITER(hh, refs, ref, tmp)
+    {
+        neu_driver_cache_del(group->driver->cache, group->name, ref->tag->name);
+        HASH_DEL(refs, ref);
+        free(ref);
+    }
+    computed_build(group, other_tags);
+
+    utarray_foreach(static_tags, neu_datatag_t *, tag)
     {
         neu_dvalue_t value = { 0 };
 
         value.precision = tag->precision;
-        value.type      = NEU_TYPE_ERROR;
-        value.value.i32 = NEU_ERR_PLUGIN_TAG_NOT_READY;
+        value.type      = tag->type;
+        if (0 != neu_tag_get_static_value(tag, &value.value)) {
+            value.type      = NEU_TYPE_ERROR;
+            value.value.i32 = NEU_ERR_EINTERNAL;
+        }
 
         neu_driver_cache_add(group->driver->cache, group->name, tag->name,
-                             value);
+                             tag, value);
     }
 
     neu_plugin_group_t grp = {
@@ -1626,18 +4118,84 @@ static void group_change(void *arg, int64_t timestamp, UT_array *static_tags,
     };
 
     grp.tags = other_tags;
+    if (update) {
+        grp.user_data  = group->grp.user_data;
+        grp.group_free = group->grp.group_free;
+    }
     free(group->grp.group_name);
     if (group->static_tags != NULL) {
         utarray_free(group->static_tags);
     }
-    if (group->grp.tags != NULL) {
-        utarray_free(group->grp.tags);
+
+    group->static_tags = static_tags;
+    group->grp         = grp;
+    columns_build(group);
+
+    // before the old tags go, the removed ones are among them
+    if (update) {
+        nlog_notice("group: %s update plugin state, added: %u, removed: %u, "
+                    "modified: %u",
+                    group->name, utarray_len(delta.added),
+                    utarray_len(delta.removed), utarray_len(delta.modified));
+        if (0 !=
+            intf->driver.group_update(group->driver->adapter.plugin,
+                                      &group->grp, &delta)) {
+            if (group->grp.group_free != NULL) {
+                group->grp.group_free(&group->grp);
+            }
+            group->grp.user_data  = NULL;
+            group->grp.group_free = NULL;
+        }
+        group_delta_free(&delta);
+    }
+    if (old != NULL) {
+        utarray_free(old);
+    }
+    nlog_notice("group: %s changed, timestamp: %" PRIi64, group->name,
+                timestamp);
+}
+
+// must be called with wt_mtx held
+static void write_batch(group_t *group)
+{
+    int                     n      = utarray_len(group->wt_tags);
+    int                     i      = 0;
+    neu_plugin_write_t *    writes = calloc(n, sizeof(neu_plugin_write_t));
+    neu_plugin_tag_value_t *single = calloc(n, sizeof(neu_plugin_tag_value_t));
+
+    utarray_foreach(group->wt_tags, to_be_write_tag_t *, wtag)
+    {
+        writes[i].req = wtag->req;
+        if (wtag->single) {
+            single[i].tag   = wtag->tag;
+            single[i].value = wtag->value;
+            writes[i].n_tag = 1;
+            writes[i].tags  = &single[i];
+        } else {
+            writes[i].n_tag = utarray_len(wtag->tvs);
+            writes[i].tags  = utarray_front(wtag->tvs);
+        }
+        i += 1;
+    }
+
+    group->driver->adapter.module->intf_funs->driver.write_batch(
+        group->driver->adapter.plugin, n, writes);
+
+    utarray_foreach(group->wt_tags, to_be_write_tag_t *, wtag)
+    {
+        if (wtag->single) {
+            neu_tag_free(wtag->tag);
+        } else {
+            utarray_foreach(wtag->tvs, neu_plugin_tag_value_t *, tv)
+            {
+                neu_tag_free(tv->tag);
+            }
+            utarray_free(wtag->tvs);
+        }
     }
 
-    group->static_tags = static_tags;
-    group->grp         = grp;
-    nlog_notice("group: %s changed, timestamp: %" PRIi64, group->name,
-                timestamp);
+    free(single);
+    free(writes);
 }
 
 static int write_callback(void *usr_data)
@@ -1649,6 +4207,15 @@ static int write_callback(void *usr_data)
     }
 
     pthread_mutex_lock(&group->wt_mtx);
+    if (group->driver->adapter.module->intf_funs->driver.write_batch != NULL &&
+        utarray_len(group->wt_tags) > 1) {
+        write_batch(group);
+        utarray_clear(group->wt_tags);
+        __atomic_store_n(&group->n_preempt, 0, __ATOMIC_RELAXED);
+        pthread_mutex_unlock(&group->wt_mtx);
+        return 0;
+    }
+
     utarray_foreach(group->wt_tags, to_be_write_tag_t *, wtag)
     {
         if (wtag->single) {
@@ -1667,11 +4234,238 @@ static int write_callback(void *usr_data)
         }
     }
     utarray_clear(group->wt_tags);
+    __atomic_store_n(&group->n_preempt, 0, __ATOMIC_RELAXED);
     pthread_mutex_unlock(&group->wt_mtx);
 
     return 0;
 }
 
+// The timer of the queued writes and sync reads, on the group loop. Sync
+// reads run first, they are after the freshest values, and the written
+// values are read back last.
+static int queue_callback(void *usr_data)
+{
+    sync_run((group_t *) usr_data);
+    write_callback(usr_data);
+    verify_run((group_t *) usr_data);
+    return 0;
+}
+
+// The write timer shares the event loop of the group with the read timer, so
+// writes queued during a poll wait for its end. A write that preempts the
+// poll has the plugin run the queue, in order, between two read commands.
+static void write_preempt(neu_plugin_group_t *grp)
+{
+    group_t *group = (group_t *) ((char *) grp - offsetof(group_t, grp));
+
+    if (__atomic_load_n(&group->n_preempt, __ATOMIC_RELAXED) > 0) {
+        write_callback(group);
+    }
+}
+
+// whether every app the group reports to has its queue above the high water
+// mark, reports to them are skipped until they catch up
+static bool group_pressure(group_t *group)
+{
+    sub_apps_t *apps     = sub_apps_get(group);
+    bool        pressure = apps->n_app > 0;
+
+    for (uint16_t i = 0; pressure && i < apps->n_app; ++i) {
+        pressure = neu_adapter_app_congested(&apps->apps[i].addr);
+    }
+    sub_apps_put(apps);
+
+    return pressure;
+}
+
+// Shed the load of a group whose apps can not keep up, returns whether the
+// read should run. The reads of the group back off, twice as many ticks apart
+// on each read under pressure up to shed_max, and come back the same way
+// once the pressure is gone, so a congested north side stops costing the
+// device reads nobody consumes.
+static bool read_shed(group_t *group)
+{
+    neu_adapter_t *adapter = &group->driver->adapter;
+    uint32_t       shed    = group->shed > 1 ? group->shed : 1;
+
+    if (group->n_shed > 0) {
+        group->n_shed -= 1;
+        return false;
+    }
+
+    if (shed_max > 1 && group_pressure(group)) {
+        shed = shed * 2 < shed_max ? shed * 2 : shed_max;
+    } else if (shed > 1) {
+        shed /= 2;
+    }
+
+    if (shed != group->shed && (shed > 1 || group->shed > 1)) {
+        nlog_notice("%s-%s %s, reads every %" PRIu32 " ticks", adapter->name,
+                    group->name,
+                    shed > group->shed ? "apps congested" : "apps recovering",
+                    shed);
+        neu_adapter_update_group_metric(adapter, group->name,
+                                        NEU_METRIC_GROUP_SHED_FACTOR, shed);
+    }
+    group->shed   = shed;
+    group->n_shed = shed - 1;
+
+    return true;
+}
+
+// Track the deadline of a read against the interval of its group, returns
+// whether the read should run under the overrun policy.
+//
+// A NOBLOCK timer fires on a fixed grid, so the next read is due one interval
+// after the current deadline, and a read longer than the interval shows up
+// as missed periods on the next tick. A BLOCK timer rearms once the read
+// returns, so the next read is due one interval after the read ends, and its
+// overruns are counted from the read time, see read_scheduled.
+static bool read_schedule(group_t *group, int64_t now, uint32_t interval)
+{
+    neu_adapter_t *adapter = &group->driver->adapter;
+    int64_t        lag     = 0;
+    uint64_t       missed  = 0;
+
+    if (0 == interval) {
+        return true;
+    }
+    if (0 == group->deadline) {
+        group->deadline = now;
+    }
+
+    // the timer itself, apart from the reads that went before
+    if (NULL != group->read) {
+        int64_t jitter = neu_event_timer_lateness(group->read) / 1000;
+
+        neu_adapter_update_group_metric(
+            adapter, group->name, NEU_METRIC_GROUP_TIMER_JITTER_US, jitter);
+        if (jitter > group->jitter_max) {
+            group->jitter_max = jitter;
+            neu_adapter_update_group_metric(
+                adapter, group->name, NEU_METRIC_GROUP_TIMER_JITTER_MAX_US,
+                jitter);
+        }
+    }
+
+    lag = now - group->deadline;
+    if (lag < 0) {
+        lag = 0;
+    }
+    missed = lag / interval;
+
+    neu_adapter_update_group_metric(adapter, group->name,
+                                    NEU_METRIC_GROUP_LAST_LAG_MS, lag);
+    neu_adapter_update_group_metric(adapter, group->name,
+                                    NEU_METRIC_GROUP_LAG_MS, lag);
+    if (missed > 0) {
+        neu_adapter_update_group_metric(adapter, group->name,
+                                        NEU_METRIC_GROUP_OVERRUNS_TOTAL,
+                                        missed);
+    }
+
+    if (NEU_EVENT_TIMER_BLOCK == adapter->module->timer_type) {
+        group->deadline = now + interval;
+    } else {
+        // back on the grid of the period
+        group->deadline += (int64_t)(missed + 1) * interval;
+    }
+    group->late = missed > 0;
+
+    if (NEU_GROUP_OVERRUN_SKIP == overrun_policy && missed > 0) {
+        nlog_debug("%s-%s skip a read %" PRId64 " ms late", adapter->name,
+                   group->name, lag);
+        return false;
+    }
+
+    if ((NEU_GROUP_OVERRUN_DEGRADE == overrun_policy ||
+         NEU_GROUP_OVERRUN_ADAPT == overrun_policy) &&
+        group->n_tick > 0) {
+        group->n_tick -= 1;
+        return false;
+    }
+
+    return read_shed(group);
+}
+
+// Stretch the reads of a group apart under the adapt overrun policy, returns
+// the ticks between them. While a read overruns the stretched interval or
+// starts late behind the other groups of its loop, the stride grows to what
+// the read took and at least by one, up to stretch_max. It shrinks by one
+// once STRETCH_FIT reads in a row would fit the shorter stride with half of
+// it to spare, so a group settles at an interval it can keep.
+static uint32_t read_stretch(group_t *group, int64_t spend, uint32_t interval)
+{
+    uint32_t stride = group->stride > 1 ? group->stride : 1;
+    int64_t  need   = (spend + interval - 1) / interval;
+
+    if (spend >= (int64_t) stride * interval || group->late) {
+        stride = need > stride ? (uint32_t) need : stride + 1;
+        stride = stride < stretch_max ? stride : stretch_max;
+        group->n_fit = 0;
+    } else if (stride > 1 && spend * 2 <= (int64_t)(stride - 1) * interval) {
+        if (++group->n_fit >= STRETCH_FIT) {
+            stride -= 1;
+            group->n_fit = 0;
+        }
+    } else {
+        group->n_fit = 0;
+    }
+
+    if (stride != group->stride && (stride > 1 || group->stride > 1)) {
+        nlog_notice("%s-%s %s, reads every %" PRIu32 " ms",
+                    group->driver->adapter.name, group->name,
+                    stride > group->stride ? "overrun" : "recovering",
+                    stride * interval);
+    }
+    return stride;
+}
+
+static void read_scheduled(group_t *group, int64_t end, int64_t spend,
+                           uint32_t interval)
+{
+    neu_adapter_t *adapter = &group->driver->adapter;
+    uint32_t       stride  = 1;
+
+    if (0 == interval) {
+        return;
+    }
+
+    neu_adapter_update_group_metric(adapter, group->name,
+                                    NEU_METRIC_GROUP_LOAD_PERCENT,
+                                    spend * 100 / interval);
+
+    if (NEU_EVENT_TIMER_BLOCK == adapter->module->timer_type) {
+        group->deadline = end + interval;
+        if (spend >= interval) {
+            neu_adapter_update_group_metric(adapter, group->name,
+                                            NEU_METRIC_GROUP_OVERRUNS_TOTAL,
+                                            spend / interval);
+        }
+    }
+
+    if (NEU_GROUP_OVERRUN_DEGRADE == overrun_policy) {
+        stride = (spend + interval - 1) / interval;
+        if (stride < 1) {
+            stride = 1;
+        }
+        if (stride != group->stride && (stride > 1 || group->stride > 1)) {
+            nlog_notice("%s-%s reads every %" PRIu32 " ticks of %" PRIu32 " ms",
+                        adapter->name, group->name, stride, interval);
+        }
+        group->stride = stride;
+        group->n_tick = stride - 1;
+    } else if (NEU_GROUP_OVERRUN_ADAPT == overrun_policy) {
+        stride        = read_stretch(group, spend, interval);
+        group->stride = stride;
+        group->n_tick = stride - 1;
+    }
+
+    neu_adapter_update_group_metric(adapter, group->name,
+                                    NEU_METRIC_GROUP_EFFECTIVE_INTERVAL_MS,
+                                    (uint64_t) stride * interval);
+}
+
 static int read_callback(void *usr_data)
 {
     group_t *                group = (group_t *) usr_data;
@@ -1685,45 +4479,143 @@ static int read_callback(void *usr_data)
                               group_change);
     }
 
+    if (!group_retained(group)) {
+        return 0;
+    }
+
     if (group->grp.tags != NULL && utarray_len(group->grp.tags) > 0) {
-        int64_t spend = global_timestamp;
+        int64_t  spend    = neu_mono_ms();
+        bool     tracing  = neu_trace_sample() > 0;
+        uint32_t interval = neu_group_get_interval(group->group);
+
+        if (group_cold(group, spend, interval)) {
+            return 0;
+        }
+        if (!read_schedule(group, spend, interval)) {
+            neu_adapter_update_group_metric(&group->driver->adapter,
+                                            group->name,
+                                            NEU_METRIC_GROUP_SKIPPED_TOTAL, 1);
+            return 0;
+        }
 
+        if (tracing) {
+            __atomic_store_n(&group->read_start, neu_time_ms(),
+                             __ATOMIC_RELAXED);
+        }
+        group->grp.interval = interval;
+        group->grp.preempt  = write_preempt;
+        group->grp.n_block  = 0;
+        active_update(group);
+        if (group->grp.columns != NULL) {
+            memset(group->grp.columns->filled, 0, group->grp.columns->n_tag);
+        }
         group->driver->adapter.module->intf_funs->driver.group_timer(
             group->driver->adapter.plugin, &group->grp);
+        if (group->grp.active == NULL) {
+            __atomic_store_n(&group->fresh, neu_mono_ms(), __ATOMIC_RELAXED);
+        }
+        // a sync read between two cycles reads every tag
+        group->grp.active  = NULL;
+        group->grp.preempt = NULL;
+        if (group->grp.columns != NULL) {
+            columns_commit(group);
+        }
+        if (group->computed_tags != NULL) {
+            computed_eval(group);
+        }
+        if (tracing) {
+            __atomic_store_n(&group->read_end, neu_time_ms(),
+                             __ATOMIC_RELAXED);
+        }
 
-        spend = global_timestamp - spend;
+        int64_t end = neu_mono_ms();
+        spend       = end - spend;
+        read_scheduled(group, end, spend, interval);
+        if (profile_interval > 0) {
+            profile_read(group, spend, interval);
+        }
         nlog_debug("%s-%s timer: %" PRId64, group->driver->adapter.name,
                    group->name, spend);
 
         neu_adapter_update_group_metric(&group->driver->adapter, group->name,
                                         NEU_METRIC_GROUP_LAST_TIMER_MS, spend);
+        neu_adapter_update_group_metric(&group->driver->adapter, group->name,
+                                        NEU_METRIC_GROUP_TIMER_MS, spend);
+    } else if (group->computed_tags != NULL) {
+        // computed from static tags only
+        computed_eval(group);
     }
 
     return 0;
 }
 
-static void read_report_group(int64_t timestamp, int64_t timeout,
-                              neu_tag_cache_type_e cache_type,
+// the tags of group read longer than the timeout of policy ago go stale in
+// the cache once, or are held with a stale meta, reads of it take the values
+// as they are
+static void expire_group(int64_t timestamp, cache_policy_t policy,
+                         neu_driver_cache_t *cache, const char *group)
+{
+    if (policy.timeout <= 0) {
+        return;
+    }
+
+    if (NEU_TAG_CACHE_TYPE_LKV == policy.type) {
+        neu_driver_cache_hold(cache, group, timestamp, policy.timeout);
+    } else {
+        neu_driver_cache_expire(cache, group, timestamp, policy.timeout);
+    }
+}
+
+static void report_change(void *arg, neu_driver_cache_change_t *change)
+{
+    UT_array *                tag_values = arg;
+    neu_resp_tag_value_meta_t tag_value  = { 0 };
+
+    tag_value.tag = neu_intern_name(change->tag);
+    memcpy(tag_value.metas, change->value.metas, sizeof(tag_value.metas));
+    // the cache holds the values normalized as they are reported
+    tag_value.value = change->value.value;
+
+    utarray_push_back(tag_values, &tag_value);
+}
+
+// with a cursor, the subscribed tags are taken from the changes of the group
+// after it instead of testing each of them, see neu_driver_cache_changes
+static void read_report_group(int64_t timestamp, cache_policy_t policy,
                               neu_driver_cache_t *cache, const char *group,
-                              UT_array *tags, UT_array *tag_values)
+                              uint32_t n, const char *const *names,
+                              const uint8_t *attributes, uint64_t *cursor,
+                              UT_array *tag_values)
 {
-    utarray_foreach(tags, neu_datatag_t *, tag)
-    {
+    // every element is a few hundred bytes, size the snapshot once instead of
+    // moving it around on each growth
+    utarray_reserve(tag_values, n);
+    expire_group(timestamp, policy, cache, group);
+
+    // walk the packed name/attribute columns of the view, the full tag
+    // definitions are not needed to build a report
+    for (uint32_t i = 0; i < n; i++) {
         neu_driver_cache_value_t  value     = { 0 };
         neu_resp_tag_value_meta_t tag_value = { 0 };
+        const char *              name      = names[i];
+
+        if ((attributes[i] & NEU_ATTRIBUTE_SUBSCRIBE) != 0) {
+            if (cursor != NULL) {
+                // taken from the changes of the group below
+                continue;
+            }
 
-        if (neu_tag_attribute_test(tag, NEU_ATTRIBUTE_SUBSCRIBE)) {
-            if (neu_driver_cache_meta_get_changed(cache, group, tag->name,
-                                                  &value, tag_value.metas,
+            if (neu_driver_cache_meta_get_changed(cache, group, name, &value,
+                                                  tag_value.metas,
                                                   NEU_TAG_META_SIZE) != 0) {
-                nlog_info("tag: %s not changed", tag->name);
+                nlog_debug("tag: %s not changed", name);
                 continue;
             }
         } else {
-            if (neu_driver_cache_meta_get(cache, group, tag->name, &value,
+            if (neu_driver_cache_meta_get(cache, group, name, &value,
                                           tag_value.metas,
                                           NEU_TAG_META_SIZE) != 0) {
-                strcpy(tag_value.tag, tag->name);
+                tag_value.tag             = name;
                 tag_value.value.type      = NEU_TYPE_ERROR;
                 tag_value.value.value.i32 = NEU_ERR_PLUGIN_TAG_NOT_READY;
 
@@ -1731,153 +4623,31 @@ static void read_report_group(int64_t timestamp, int64_t timeout,
                 continue;
             }
         }
-        strcpy(tag_value.tag, tag->name);
-
-        if (value.value.type == NEU_TYPE_ERROR) {
-            tag_value.value = value.value;
-
-            utarray_push_back(tag_values, &tag_value);
-            continue;
-        }
-
-        switch (tag->type) {
-        case NEU_TYPE_UINT16:
-        case NEU_TYPE_INT16:
-            switch (tag->option.value16.endian) {
-            case NEU_DATATAG_ENDIAN_B16:
-                value.value.value.u16 = htons(value.value.value.u16);
-                break;
-            case NEU_DATATAG_ENDIAN_L16:
-            default:
-                break;
-            }
-            break;
-        case NEU_TYPE_FLOAT:
-        case NEU_TYPE_UINT32:
-        case NEU_TYPE_INT32:
-            switch (tag->option.value32.endian) {
-            case NEU_DATATAG_ENDIAN_LB32: {
-                uint16_t *v1 = (uint16_t *) value.value.value.bytes.bytes;
-                uint16_t *v2 = (uint16_t *) (value.value.value.bytes.bytes + 2);
-
-                neu_htons_p(v1);
-                neu_htons_p(v2);
-                break;
-            }
-            case NEU_DATATAG_ENDIAN_BB32:
-                value.value.value.u32 = htonl(value.value.value.u32);
-                break;
-            case NEU_DATATAG_ENDIAN_BL32:
-                value.value.value.u32 = htonl(value.value.value.u32);
-                uint16_t *v1 = (uint16_t *) value.value.value.bytes.bytes;
-                uint16_t *v2 = (uint16_t *) (value.value.value.bytes.bytes + 2);
-
-                neu_htons_p(v1);
-                neu_htons_p(v2);
-                break;
-            case NEU_DATATAG_ENDIAN_LL32:
-            default:
-                break;
-            }
-            break;
-        case NEU_TYPE_DOUBLE:
-        case NEU_TYPE_INT64:
-        case NEU_TYPE_UINT64:
-            switch (tag->option.value64.endian) {
-            case NEU_DATATAG_ENDIAN_B64:
-                value.value.value.u64 = neu_htonll(value.value.value.u64);
-                break;
-            case NEU_DATATAG_ENDIAN_L64:
-            default:
-                break;
-            }
-            break;
-        default:
-            break;
-        }
-
-        if (cache_type != NEU_TAG_CACHE_TYPE_NEVER &&
-            !neu_tag_attribute_test(tag, NEU_ATTRIBUTE_STATIC) &&
-            (timestamp - value.timestamp) > timeout && timeout > 0) {
-            if (value.value.type == NEU_TYPE_PTR) {
-                free(value.value.value.ptr.ptr);
-            }
-            tag_value.value.type      = NEU_TYPE_ERROR;
-            tag_value.value.value.i32 = NEU_ERR_PLUGIN_TAG_VALUE_EXPIRED;
-        } else {
-            if (value.value.type == NEU_TYPE_PTR) {
-                tag_value.value.type             = NEU_TYPE_PTR;
-                tag_value.value.value.ptr.length = value.value.value.ptr.length;
-                tag_value.value.value.ptr.type   = value.value.value.ptr.type;
-                tag_value.value.value.ptr.ptr    = value.value.value.ptr.ptr;
-            } else {
-                tag_value.value = value.value;
-            }
-            if (tag->decimal != 0) {
-                tag_value.value.type = NEU_TYPE_DOUBLE;
-                switch (tag->type) {
-                case NEU_TYPE_INT8:
-                    tag_value.value.value.d64 =
-                        (double) tag_value.value.value.i8 * tag->decimal;
-                    break;
-                case NEU_TYPE_UINT8:
-                    tag_value.value.value.d64 =
-                        (double) tag_value.value.value.u8 * tag->decimal;
-                    break;
-                case NEU_TYPE_INT16:
-                    tag_value.value.value.d64 =
-                        (double) tag_value.value.value.i16 * tag->decimal;
-                    break;
-                case NEU_TYPE_UINT16:
-                    tag_value.value.value.d64 =
-                        (double) tag_value.value.value.u16 * tag->decimal;
-                    break;
-                case NEU_TYPE_INT32:
-                    tag_value.value.value.d64 =
-                        (double) tag_value.value.value.i32 * tag->decimal;
-                    break;
-                case NEU_TYPE_UINT32:
-                    tag_value.value.value.d64 =
-                        (double) tag_value.value.value.u32 * tag->decimal;
-                    break;
-                case NEU_TYPE_INT64:
-                    tag_value.value.value.d64 =
-                        (double) tag_value.value.value.i64 * tag->decimal;
-                    break;
-                case NEU_TYPE_UINT64:
-                    tag_value.value.value.d64 =
-                        (double) tag_value.value.value.u64 * tag->decimal;
-                    break;
-                case NEU_TYPE_FLOAT:
-                    tag_value.value.value.d64 =
-                        (double) tag_value.value.value.f32 * tag->decimal;
-                    break;
-                case NEU_TYPE_DOUBLE:
-                    tag_value.value.value.d64 =
-                        (double) tag_value.value.value.d64 * tag->decimal;
-                    break;
-                default:
-                    tag_value.value.type = tag->type;
-                    break;
-                }
-            }
-        }
+        tag_value.tag = name;
+        // the cache holds the values normalized as they are reported
+        tag_value.value = value.value;
 
         utarray_push_back(tag_values, &tag_value);
     }
+
+    if (cursor != NULL) {
+        neu_driver_cache_changes(cache, group, NEU_ATTRIBUTE_SUBSCRIBE, true,
+                                 cursor, report_change, tag_values);
+    }
 }
 
-static void read_group(int64_t timestamp, int64_t timeout,
-                       neu_tag_cache_type_e cache_type,
+static void read_group(int64_t timestamp, cache_policy_t policy,
                        neu_driver_cache_t *cache, const char *group,
                        UT_array *tags, UT_array *tag_values)
 {
+    expire_group(timestamp, policy, cache, group);
+
     utarray_foreach(tags, neu_datatag_t *, tag)
     {
         neu_resp_tag_value_meta_t tag_value = { 0 };
         neu_driver_cache_value_t  value     = { 0 };
 
-        strcpy(tag_value.tag, tag->name);
+        tag_value.tag = neu_intern_name(tag->name);
 
         if (neu_driver_cache_meta_get(cache, group, tag->name, &value,
                                       tag_value.metas,
@@ -1889,150 +4659,174 @@ static void read_group(int64_t timestamp, int64_t timeout,
             continue;
         }
 
-        if (value.value.type == NEU_TYPE_ERROR) {
-            tag_value.value = value.value;
-            utarray_push_back(tag_values, &tag_value);
-            continue;
+        // the cache holds the values normalized as they are reported
+        tag_value.value = value.value;
+        utarray_push_back(tag_values, &tag_value);
+    }
+}
+
+static bool write_has_tag(const to_be_write_tag_t *w, const char *name)
+{
+    if (w->single) {
+        return strcmp(w->tag->name, name) == 0;
+    }
+
+    utarray_foreach(w->tvs, neu_plugin_tag_value_t *, tv)
+    {
+        if (strcmp(tv->tag->name, name) == 0) {
+            return true;
         }
+    }
+    return false;
+}
 
-        switch (tag->type) {
-        case NEU_TYPE_UINT16:
-        case NEU_TYPE_INT16:
-            switch (tag->option.value16.endian) {
-            case NEU_DATATAG_ENDIAN_B16:
-                value.value.value.u16 = htons(value.value.value.u16);
-                break;
-            case NEU_DATATAG_ENDIAN_L16:
-            default:
-                break;
-            }
-            break;
-        case NEU_TYPE_FLOAT:
-        case NEU_TYPE_UINT32:
-        case NEU_TYPE_INT32:
-            switch (tag->option.value32.endian) {
-            case NEU_DATATAG_ENDIAN_LB32: {
-                uint16_t *v1 = (uint16_t *) value.value.value.bytes.bytes;
-                uint16_t *v2 = (uint16_t *) (value.value.value.bytes.bytes + 2);
+// whether every tag of the write coalesces, writes of several groups never
+static bool write_coalesces(const to_be_write_tag_t *w)
+{
+    neu_reqresp_type_e type = ((neu_reqresp_head_t *) w->req)->type;
 
-                neu_htons_p(v1);
-                neu_htons_p(v2);
-                break;
-            }
-            case NEU_DATATAG_ENDIAN_BB32:
-                value.value.value.u32 = htonl(value.value.value.u32);
-                break;
-            case NEU_DATATAG_ENDIAN_BL32:
-                value.value.value.u32 = htonl(value.value.value.u32);
-                uint16_t *v1 = (uint16_t *) value.value.value.bytes.bytes;
-                uint16_t *v2 = (uint16_t *) (value.value.value.bytes.bytes + 2);
+    if (w->single) {
+        return neu_tag_attribute_test(w->tag, NEU_ATTRIBUTE_COALESCE);
+    }
+    if (NEU_REQ_WRITE_TAGS != type) {
+        return false;
+    }
 
-                neu_htons_p(v1);
-                neu_htons_p(v2);
-                break;
-            case NEU_DATATAG_ENDIAN_LL32:
-            default:
-                break;
-            }
-            break;
-        case NEU_TYPE_DOUBLE:
-        case NEU_TYPE_INT64:
-        case NEU_TYPE_UINT64:
-            switch (tag->option.value64.endian) {
-            case NEU_DATATAG_ENDIAN_B64:
-                value.value.value.u64 = neu_htonll(value.value.value.u64);
-                break;
-            case NEU_DATATAG_ENDIAN_L64:
-            default:
-                break;
-            }
-            break;
-        default:
-            break;
+    utarray_foreach(w->tvs, neu_plugin_tag_value_t *, tv)
+    {
+        if (!neu_tag_attribute_test(tv->tag, NEU_ATTRIBUTE_COALESCE)) {
+            return false;
         }
+    }
+    return true;
+}
 
-        if (cache_type != NEU_TAG_CACHE_TYPE_NEVER &&
-            !neu_tag_attribute_test(tag, NEU_ATTRIBUTE_STATIC) &&
-            (timestamp - value.timestamp) > timeout) {
-            if (value.value.type == NEU_TYPE_PTR) {
-                free(value.value.value.ptr.ptr);
-            }
-            tag_value.value.type      = NEU_TYPE_ERROR;
-            tag_value.value.value.i32 = NEU_ERR_PLUGIN_TAG_VALUE_EXPIRED;
-        } else {
-            if (value.value.type == NEU_TYPE_PTR) {
-                tag_value.value.type             = NEU_TYPE_PTR;
-                tag_value.value.value.ptr.length = value.value.value.ptr.length;
-                tag_value.value.value.ptr.type   = value.value.value.ptr.type;
-                tag_value.value.value.ptr.ptr    = value.value.value.ptr.ptr;
-            } else {
-                tag_value.value = value.value;
-            }
-            if (tag->decimal != 0) {
-                tag_value.value.type = NEU_TYPE_DOUBLE;
-                switch (tag->type) {
-                case NEU_TYPE_INT8:
-                    tag_value.value.value.d64 =
-                        (double) tag_value.value.value.i8 * tag->decimal;
-                    break;
-                case NEU_TYPE_UINT8:
-                    tag_value.value.value.d64 =
-                        (double) tag_value.value.value.u8 * tag->decimal;
-                    break;
-                case NEU_TYPE_INT16:
-                    tag_value.value.value.d64 =
-                        (double) tag_value.value.value.i16 * tag->decimal;
-                    break;
-                case NEU_TYPE_UINT16:
-                    tag_value.value.value.d64 =
-                        (double) tag_value.value.value.u16 * tag->decimal;
-                    break;
-                case NEU_TYPE_INT32:
-                    tag_value.value.value.d64 =
-                        (double) tag_value.value.value.i32 * tag->decimal;
-                    break;
-                case NEU_TYPE_UINT32:
-                    tag_value.value.value.d64 =
-                        (double) tag_value.value.value.u32 * tag->decimal;
-                    break;
-                case NEU_TYPE_INT64:
-                    tag_value.value.value.d64 =
-                        (double) tag_value.value.value.i64 * tag->decimal;
-                    break;
-                case NEU_TYPE_UINT64:
-                    tag_value.value.value.d64 =
-                        (double) tag_value.value.value.u64 * tag->decimal;
-                    break;
-                case NEU_TYPE_FLOAT:
-                    tag_value.value.value.d64 =
-                        (double) tag_value.value.value.f32 * tag->decimal;
-                    break;
-                case NEU_TYPE_DOUBLE:
-                    tag_value.value.value.d64 =
-                        (double) tag_value.value.value.d64 * tag->decimal;
-                    break;
-                default:
-                    tag_value.value.type = tag->type;
-                    break;
-                }
-            }
+// whether newer writes every tag of older
+static bool write_covers(const to_be_write_tag_t *newer,
+                         const to_be_write_tag_t *older)
+{
+    if (older->single) {
+        return write_has_tag(newer, older->tag->name);
+    }
+
+    utarray_foreach(older->tvs, neu_plugin_tag_value_t *, tv)
+    {
+        if (!write_has_tag(newer, tv->tag->name)) {
+            return false;
         }
-        utarray_push_back(tag_values, &tag_value);
     }
+    return true;
+}
+
+static void write_free(to_be_write_tag_t *w)
+{
+    if (w->single) {
+        neu_tag_free(w->tag);
+        return;
+    }
+
+    utarray_foreach(w->tvs, neu_plugin_tag_value_t *, tv)
+    {
+        neu_tag_free(tv->tag);
+    }
+    utarray_free(w->tvs);
 }
 
+// A write of coalescing tags takes the place of the queued writes it
+// covers, the last value wins and goes out no later than the first one
+// queued. Every write superseded is answered on its own, so the queue holds
+// at most one write of a coalescing tag.
 static void store_write_tag(group_t *group, to_be_write_tag_t *tag)
 {
+    bool      coalesce   = write_coalesces(tag);
+    UT_array *superseded = NULL;
+    int       slot       = -1;
+
+    utarray_new(superseded, &ut_ptr_icd);
+
     pthread_mutex_lock(&group->wt_mtx);
-    utarray_push_back(group->wt_tags, tag);
+    for (unsigned i = 0; coalesce && i < utarray_len(group->wt_tags);) {
+        to_be_write_tag_t *old = utarray_eltptr(group->wt_tags, i);
+
+        if (!write_coalesces(old) || !write_covers(tag, old)) {
+            i += 1;
+            continue;
+        }
+
+        utarray_push_back(superseded, &old->req);
+        if (old->preempt) {
+            __atomic_sub_fetch(&group->n_preempt, 1, __ATOMIC_RELAXED);
+        }
+        write_free(old);
+        if (slot < 0) {
+            slot = i;
+            *old = *tag;
+            i += 1;
+        } else {
+            utarray_erase(group->wt_tags, i, 1);
+        }
+    }
+    if (slot < 0) {
+        utarray_push_back(group->wt_tags, tag);
+    }
+    if (tag->preempt) {
+        __atomic_add_fetch(&group->n_preempt, 1, __ATOMIC_RELAXED);
+    }
     pthread_mutex_unlock(&group->wt_mtx);
+
+    utarray_foreach(superseded, void **, req)
+    {
+        nlog_debug("%s-%s write <%p> superseded", group->driver->adapter.name,
+                   group->name, ((neu_reqresp_head_t *) *req)->ctx);
+        group->driver->adapter.cb_funs.driver.write_response(
+            &group->driver->adapter, *req, NEU_ERR_PLUGIN_WRITE_SUPERSEDED);
+    }
+    utarray_free(superseded);
+}
+
+static sub_apps_t *sub_apps_new(uint16_t n_app)
+{
+    sub_apps_t *apps =
+        calloc(1, sizeof(sub_apps_t) + n_app * sizeof(sub_app_t));
+
+    apps->ref   = 1;
+    apps->n_app = n_app;
+    return apps;
+}
+
+static sub_apps_t *sub_apps_get(group_t *group)
+{
+    pthread_mutex_lock(&group->apps_mtx);
+    sub_apps_t *apps = group->apps;
+    __atomic_add_fetch(&apps->ref, 1, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&group->apps_mtx);
+
+    return apps;
+}
+
+static void sub_apps_put(sub_apps_t *apps)
+{
+    if (__atomic_sub_fetch(&apps->ref, 1, __ATOMIC_ACQ_REL) == 0) {
+        free(apps);
+    }
+}
+
+// publishes apps, the reports still sending to the old vector keep it alive
+static void sub_apps_swap(group_t *group, sub_apps_t *apps)
+{
+    pthread_mutex_lock(&group->apps_mtx);
+    sub_apps_t *old = group->apps;
+    group->apps     = apps;
+    pthread_mutex_unlock(&group->apps_mtx);
+
+    sub_apps_put(old);
 }
 
 void neu_adapter_driver_subscribe(neu_adapter_driver_t *driver,
                                   neu_req_subscribe_t * req)
 {
-    sub_app_t sub_app = { 0 };
-    group_t * find    = NULL;
+    group_t *   find = NULL;
+    sub_apps_t *apps = NULL;
 
     HASH_FIND_STR(driver->groups, req->group, find);
     if (find == NULL) {
@@ -2041,32 +4835,35 @@ void neu_adapter_driver_subscribe(neu_adapter_driver_t *driver,
         return;
     }
 
-    pthread_mutex_lock(&find->apps_mtx);
-    utarray_foreach(find->apps, sub_app_t *, app)
-    {
-        if (strcmp(app->app, req->app) == 0) {
+    // only the adapter thread changes the subscriptions
+    for (uint16_t i = 0; i < find->apps->n_app; ++i) {
+        if (strcmp(find->apps->apps[i].app, req->app) == 0) {
             nlog_warn("%s sub group: %s app: %s already exist",
                       driver->adapter.name, req->group, req->app);
-            pthread_mutex_unlock(&find->apps_mtx);
             return;
         }
     }
 
-    strcpy(sub_app.app, req->app);
-    sub_app.addr.sun_family = AF_UNIX;
-    snprintf(sub_app.addr.sun_path, sizeof(sub_app.addr.sun_path),
+    apps = sub_apps_new(find->apps->n_app + 1);
+    memcpy(apps->apps, find->apps->apps, find->apps->n_app * sizeof(sub_app_t));
+
+    sub_app_t *sub_app = &apps->apps[apps->n_app - 1];
+    strcpy(sub_app->app, req->app);
+    sub_app->addr.sun_family = AF_UNIX;
+    snprintf(sub_app->addr.sun_path, sizeof(sub_app->addr.sun_path),
              "%cneuron-%" PRIu16, '\0', req->port);
 
-    utarray_push_back(find->apps, &sub_app);
-    pthread_mutex_unlock(&find->apps_mtx);
+    struct sockaddr_un addr = sub_app->addr;
+    sub_apps_swap(find, apps);
 
-    report_to_app(driver, find, sub_app.addr);
+    report_to_app(driver, find, addr);
 }
 
 void neu_adapter_driver_unsubscribe(neu_adapter_driver_t * driver,
                                     neu_req_unsubscribe_t *req)
 {
-    group_t *find = NULL;
+    group_t *   find = NULL;
+    sub_apps_t *apps = NULL;
 
     HASH_FIND_STR(driver->groups, req->group, find);
     if (find == NULL) {
@@ -2075,14 +4872,14 @@ void neu_adapter_driver_unsubscribe(neu_adapter_driver_t * driver,
         return;
     }
 
-    pthread_mutex_lock(&find->apps_mtx);
-    utarray_foreach(find->apps, sub_app_t *, app)
-    {
-        if (strcmp(app->app, req->app) == 0) {
-            utarray_erase(find->apps, utarray_eltidx(find->apps, app), 1);
-            pthread_mutex_unlock(&find->apps_mtx);
+    for (uint16_t i = 0; i < find->apps->n_app; ++i) {
+        if (strcmp(find->apps->apps[i].app, req->app) == 0) {
+            apps = sub_apps_new(find->apps->n_app - 1);
+            memcpy(apps->apps, find->apps->apps, i * sizeof(sub_app_t));
+            memcpy(&apps->apps[i], &find->apps->apps[i + 1],
+                   (apps->n_app - i) * sizeof(sub_app_t));
+            sub_apps_swap(find, apps);
             return;
         }
     }
-    pthread_mutex_unlock(&find->apps_mtx);
-}
\ No newline at end of file
+}
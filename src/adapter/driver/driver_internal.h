@@ -21,15 +21,85 @@
 #define _NEU_ADAPTER_DRIVER_INTERNAL_H_
 
 #include "adapter.h"
+#include "parser/neu_json_node.h"
+#include "utils/affinity.h"
 
 neu_adapter_driver_t *neu_adapter_driver_create();
 
 void neu_adapter_driver_destroy(neu_adapter_driver_t *driver);
 int  neu_adapter_driver_init(neu_adapter_driver_t *driver);
 int  neu_adapter_driver_uninit(neu_adapter_driver_t *driver);
+// label the group loop threads with the node name, again after a rename
+void neu_adapter_driver_label(neu_adapter_driver_t *driver);
+// pin the driver and group loop threads, NULL to unpin them
+void neu_adapter_driver_set_affinity(neu_adapter_driver_t *driver,
+                                     const neu_cpus_t *    cpus);
+// run the loops of the driver under a scheduling policy, a real time one is
+// watched and dropped for loops that take the cpu for themselves
+void neu_adapter_driver_set_sched(neu_adapter_driver_t *driver, int policy,
+                                  int priority);
+// how long the groups keep their cached values, see
+// neu_json_decode_cache_retentions, takes the retentions
+void neu_adapter_driver_set_retentions(neu_adapter_driver_t *       driver,
+                                       neu_json_cache_retentions_t *retentions);
+// estimate of the memory held by the node, each tag with its cached value
+// and history, until the node is uninit
+size_t neu_adapter_driver_mem_bytes(neu_adapter_driver_t *driver);
+// halve the history kept per tag, return the bytes freed
+size_t neu_adapter_driver_shrink_history(neu_adapter_driver_t *driver);
+
+// report all the groups due in the same tick in one message per app
+void neu_adapter_driver_set_batch_report(bool enable);
+// save the cached values every so many seconds and serve them, flagged stale,
+// after a restart until the tags are read again, 0 disables
+void neu_adapter_driver_set_lkv_interval(uint32_t seconds);
+// the values are handed between two processes of an upgrade, saved by the
+// drivers stopping and loaded by the drivers starting, whatever the interval
+void neu_adapter_driver_set_handover(bool enable);
+
+// what a group does when its reads fall behind the interval
+typedef enum {
+    // run a late read at once, folding the missed periods into it
+    NEU_GROUP_OVERRUN_COALESCE = 0,
+    // drop a read that starts a whole period late, back on schedule next tick
+    NEU_GROUP_OVERRUN_SKIP,
+    // read every N-th tick while a read takes N intervals, back when it fits
+    NEU_GROUP_OVERRUN_DEGRADE,
+    // stretch the interval while reads overrun or start late, up to the
+    // stretch max, and shrink it back gradually once they fit
+    NEU_GROUP_OVERRUN_ADAPT,
+} neu_group_overrun_e;
+
+#define NEU_GROUP_STRETCH_MAX_DEFAULT 8
+
+void neu_adapter_driver_set_overrun(neu_group_overrun_e policy);
+// the adapt overrun policy reads a group up to max times its interval apart
+void neu_adapter_driver_set_stretch_max(uint32_t max);
+// while every app a group reports to is congested, read the group up to max
+// times as many ticks apart, 1 disables it
+void neu_adapter_driver_set_shed_max(uint32_t max);
+// put the value of a write the device confirmed in the cache and report it at
+// once, flagged written until the next read confirms or corrects it
+void neu_adapter_driver_set_write_through(bool enable);
+// stop polling the groups nothing subscribes nor read in the last n
+// intervals, until they are read or subscribed again, 0 disables it
+void neu_adapter_driver_set_cold_groups(uint32_t n);
+// save the read statistics of every group every so many seconds, for the
+// tuning recommendations of the group profile api, 0 disables
+void neu_adapter_driver_set_profile_interval(uint32_t seconds);
+// keep up to kib KiB of compressed samples of every numeric tag of drivers
+// created from now on, 0 disables it
+void neu_adapter_driver_set_history(uint32_t kib);
 
 void neu_adapter_driver_start_group_timer(neu_adapter_driver_t *driver);
 void neu_adapter_driver_stop_group_timer(neu_adapter_driver_t *driver);
+// stop the timers that run the plugin and release its group data, before the
+// plugin of the node is swapped
+void neu_adapter_driver_detach_plugin(neu_adapter_driver_t *driver);
+// restart them on the new plugin, fresh if it was not migrated and has to be
+// told the tags of the node again
+void neu_adapter_driver_attach_plugin(neu_adapter_driver_t *driver,
+                                      bool                  fresh);
 
 void neu_adapter_driver_read_group(neu_adapter_driver_t *driver,
                                    neu_reqresp_head_t *  req);
@@ -54,6 +124,10 @@ UT_array *neu_adapter_driver_get_group(neu_adapter_driver_t *driver);
 uint16_t  neu_adapter_driver_group_count(neu_adapter_driver_t *driver);
 uint16_t  neu_adapter_driver_new_group_count(neu_adapter_driver_t *driver,
                                              neu_req_add_gtag_t *  cmd);
+// make the listed groups hold exactly the requested tags, and persist the diff
+int neu_adapter_driver_apply_gtags(neu_adapter_driver_t *driver,
+                                   neu_req_add_gtag_t *  cmd,
+                                   neu_resp_add_tag_t *  resp);
 
 int neu_adapter_driver_try_del_tag(neu_adapter_driver_t *driver, int n_tag);
 int neu_adapter_driver_try_add_tag(neu_adapter_driver_t *driver,
@@ -64,9 +138,17 @@ int neu_adapter_driver_load_tag(neu_adapter_driver_t *driver, const char *group,
 
 int neu_adapter_driver_validate_tag(neu_adapter_driver_t *driver,
                                     const char *group, neu_datatag_t *tag);
+// validate the tags up to the first invalid one, whose error is returned,
+// with n_valid set to the number of tags before it
+int neu_adapter_driver_validate_tags(neu_adapter_driver_t *driver,
+                                     const char *group, neu_datatag_t *tags,
+                                     int n_tag, int *n_valid);
 
 int neu_adapter_driver_add_tag(neu_adapter_driver_t *driver, const char *group,
                                neu_datatag_t *tag, uint16_t interval);
+int neu_adapter_driver_load_group(neu_adapter_driver_t *driver,
+                                  const char *group, uint32_t interval,
+                                  neu_datatag_t *tags, int n_tag);
 int neu_adapter_driver_del_tag(neu_adapter_driver_t *driver, const char *group,
                                const char *tag);
 int neu_adapter_driver_update_tag(neu_adapter_driver_t *driver,
@@ -75,13 +157,15 @@ int neu_adapter_driver_get_tag(neu_adapter_driver_t *driver, const char *group,
                                UT_array **tags);
 UT_array *neu_adapter_driver_get_ptag(neu_adapter_driver_t *driver,
                                       const char *group, const char *tag);
-int       neu_adapter_driver_query_tag(neu_adapter_driver_t *driver,
-                                       const char *group, const char *name,
-                                       UT_array **tags);
+int       neu_adapter_driver_query_tag(neu_adapter_driver_t *   driver,
+                                       const neu_req_get_tag_t *cmd,
+                                       UT_array **tags, uint32_t *total);
 void      neu_adapter_driver_get_value_tag(neu_adapter_driver_t *driver,
                                            const char *group, UT_array **tags);
-UT_array *neu_adapter_driver_get_read_tag(neu_adapter_driver_t *driver,
-                                          const char *          group);
+// the samples kept of a tag, resp->points is set on success only
+int neu_adapter_driver_tag_history(neu_adapter_driver_t *           driver,
+                                   const neu_req_get_tag_history_t *cmd,
+                                   neu_resp_get_tag_history_t *     resp);
 
 void neu_adapter_driver_subscribe(neu_adapter_driver_t *driver,
                                   neu_req_subscribe_t * req);
@@ -0,0 +1,536 @@
+/**
+ * NEURON IIoT System for Industry 4.0
+ * Copyright (C) 2020-2023 EMQ Technologies Co., Ltd All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ **/
+
+#include <ctype.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "expr.h"
+
+#define EXPR_OPS_MAX 256
+#define EXPR_DEPTH_MAX 32
+
+typedef enum {
+    OP_NUM,
+    OP_TAG,
+    OP_NEG,
+    OP_NOT,
+    OP_ADD,
+    OP_SUB,
+    OP_MUL,
+    OP_DIV,
+    OP_MOD,
+    OP_SHL,
+    OP_SHR,
+    OP_AND,
+    OP_OR,
+    OP_XOR,
+    OP_ABS,
+    OP_MIN,
+    OP_MAX,
+    OP_BIT,
+} op_code_e;
+
+typedef struct {
+    uint8_t  code;
+    uint16_t idx; // OP_TAG only
+    double   num; // OP_NUM only
+} op_t;
+
+struct neu_expr {
+    op_t *   ops;
+    uint16_t n_op;
+    uint16_t n_operand;
+    char **  operands;
+};
+
+typedef struct {
+    const char *s;
+    neu_expr_t *expr;
+    bool        error;
+} parser_t;
+
+typedef struct {
+    const char *name;
+    uint8_t     code;
+    uint8_t     n_arg;
+} func_t;
+
+static const func_t funcs[] = {
+    { "abs", OP_ABS, 1 },
+    { "min", OP_MIN, 2 },
+    { "max", OP_MAX, 2 },
+    { "bit", OP_BIT, 2 },
+};
+
+static void parse_or(parser_t *p);
+
+static void skip_space(parser_t *p)
+{
+    while (isspace((unsigned char) *p->s)) {
+        p->s += 1;
+    }
+}
+
+static bool accept(parser_t *p, const char *token)
+{
+    size_t n = strlen(token);
+
+    skip_space(p);
+    if (strncmp(p->s, token, n) != 0) {
+        return false;
+    }
+    p->s += n;
+    return true;
+}
+
+static void emit(parser_t *p, uint8_t code, uint16_t idx, double num)
+{
+    neu_expr_t *e = p->expr;
+
+    if (p->error || e->n_op >= EXPR_OPS_MAX) {
+        p->error = true;
+        return;
+    }
+
+    e->ops[e->n_op].code = code;
+    e->ops[e->n_op].idx  = idx;
+    e->ops[e->n_op].num  = num;
+    e->n_op += 1;
+}
+
+static void emit_tag(parser_t *p, const char *name, size_t len)
+{
+    neu_expr_t *e = p->expr;
+
+    if (len == 0) {
+        p->error = true;
+        return;
+    }
+
+    for (uint16_t i = 0; i < e->n_operand; i++) {
+        if (strlen(e->operands[i]) == len &&
+            strncmp(e->operands[i], name, len) == 0) {
+            emit(p, OP_TAG, i, 0);
+            return;
+        }
+    }
+
+    if (e->n_operand >= NEU_EXPR_OPERANDS_MAX) {
+        p->error = true;
+        return;
+    }
+
+    e->operands[e->n_operand] = strndup(name, len);
+    if (e->operands[e->n_operand] == NULL) {
+        p->error = true;
+        return;
+    }
+    emit(p, OP_TAG, e->n_operand, 0);
+    e->n_operand += 1;
+}
+
+static bool ident_char(char c, bool first)
+{
+    return isalpha((unsigned char) c) || c == '_' ||
+        (!first && (isdigit((unsigned char) c) || c == '.'));
+}
+
+static void parse_call(parser_t *p, const char *name, size_t len)
+{
+    const func_t *f = NULL;
+
+    for (size_t i = 0; i < sizeof(funcs) / sizeof(funcs[0]); i++) {
+        if (strlen(funcs[i].name) == len &&
+            strncmp(funcs[i].name, name, len) == 0) {
+            f = &funcs[i];
+        }
+    }
+    if (f == NULL) {
+        p->error = true;
+        return;
+    }
+
+    for (uint8_t i = 0; i < f->n_arg && !p->error; i++) {
+        if (i > 0 && !accept(p, ",")) {
+            p->error = true;
+            return;
+        }
+        parse_or(p);
+    }
+    if (!accept(p, ")")) {
+        p->error = true;
+        return;
+    }
+    emit(p, f->code, 0, 0);
+}
+
+static void parse_primary(parser_t *p)
+{
+    skip_space(p);
+
+    if (accept(p, "(")) {
+        parse_or(p);
+        if (!accept(p, ")")) {
+            p->error = true;
+        }
+    } else if (*p->s == '\'' || *p->s == '"') {
+        const char *end = strchr(p->s + 1, *p->s);
+        if (end == NULL) {
+            p->error = true;
+            return;
+        }
+        emit_tag(p, p->s + 1, end - p->s - 1);
+        p->s = end + 1;
+    } else if (ident_char(*p->s, true)) {
+        const char *name = p->s;
+        while (ident_char(*p->s, false)) {
+            p->s += 1;
+        }
+        size_t len = p->s - name;
+        if (accept(p, "(")) {
+            parse_call(p, name, len);
+        } else {
+            emit_tag(p, name, len);
+        }
+    } else if (isdigit((unsigned char) *p->s) || *p->s == '.') {
+        char * end = NULL;
+        double num = strtod(p->s, &end);
+        if (end == p->s || !isfinite(num)) {
+            p->error = true;
+            return;
+        }
+        emit(p, OP_NUM, 0, num);
+        p->s = end;
+    } else {
+        p->error = true;
+    }
+}
+
+static void parse_unary(parser_t *p)
+{
+    if (p->error) {
+        return;
+    }
+
+    if (accept(p, "-")) {
+        parse_unary(p);
+        emit(p, OP_NEG, 0, 0);
+    } else if (accept(p, "~")) {
+        parse_unary(p);
+        emit(p, OP_NOT, 0, 0);
+    } else if (accept(p, "+")) {
+        parse_unary(p);
+    } else {
+        parse_primary(p);
+    }
+}
+
+static void parse_mul(parser_t *p)
+{
+    parse_unary(p);
+    while (!p->error) {
+        if (accept(p, "*")) {
+            parse_unary(p);
+            emit(p, OP_MUL, 0, 0);
+        } else if (accept(p, "/")) {
+            parse_unary(p);
+            emit(p, OP_DIV, 0, 0);
+        } else if (accept(p, "%")) {
+            parse_unary(p);
+            emit(p, OP_MOD, 0, 0);
+        } else {
+            break;
+        }
+    }
+}
+
+static void parse_add(parser_t *p)
+{
+    parse_mul(p);
+    while (!p->error) {
+        if (accept(p, "+")) {
+            parse_mul(p);
+            emit(p, OP_ADD, 0, 0);
+        } else if (accept(p, "-")) {
+            parse_mul(p);
+            emit(p, OP_SUB, 0, 0);
+        } else {
+            break;
+        }
+    }
+}
+
+static void parse_shift(parser_t *p)
+{
+    parse_add(p);
+    while (!p->error) {
+        if (accept(p, "<<")) {
+            parse_add(p);
+            emit(p, OP_SHL, 0, 0);
+        } else if (accept(p, ">>")) {
+            parse_add(p);
+            emit(p, OP_SHR, 0, 0);
+        } else {
+            break;
+        }
+    }
+}
+
+static void parse_and(parser_t *p)
+{
+    parse_shift(p);
+    while (!p->error && accept(p, "&")) {
+        parse_shift(p);
+        emit(p, OP_AND, 0, 0);
+    }
+}
+
+static void parse_xor(parser_t *p)
+{
+    parse_and(p);
+    while (!p->error && accept(p, "^")) {
+        parse_and(p);
+        emit(p, OP_XOR, 0, 0);
+    }
+}
+
+static void parse_or(parser_t *p)
+{
+    parse_xor(p);
+    while (!p->error && accept(p, "|")) {
+        parse_xor(p);
+        emit(p, OP_OR, 0, 0);
+    }
+}
+
+// the stack the program needs, -1 if it is deeper than EXPR_DEPTH_MAX
+static int program_depth(const neu_expr_t *expr)
+{
+    int depth = 0, max = 0;
+
+    for (uint16_t i = 0; i < expr->n_op; i++) {
+        switch (expr->ops[i].code) {
+        case OP_NUM:
+        case OP_TAG:
+            depth += 1;
+            break;
+        case OP_NEG:
+        case OP_NOT:
+        case OP_ABS:
+            break;
+        default:
+            depth -= 1;
+            break;
+        }
+        max = depth > max ? depth : max;
+    }
+
+    return max > EXPR_DEPTH_MAX || depth != 1 ? -1 : max;
+}
+
+neu_expr_t *neu_expr_compile(const char *src)
+{
+    neu_expr_t *expr = calloc(1, sizeof(neu_expr_t));
+    parser_t    p    = { .s = src, .expr = expr };
+
+    if (expr == NULL) {
+        return NULL;
+    }
+
+    expr->ops      = calloc(EXPR_OPS_MAX, sizeof(op_t));
+    expr->operands = calloc(NEU_EXPR_OPERANDS_MAX, sizeof(char *));
+    if (expr->ops == NULL || expr->operands == NULL) {
+        neu_expr_free(expr);
+        return NULL;
+    }
+
+    parse_or(&p);
+    skip_space(&p);
+    if (p.error || *p.s != '\0' || program_depth(expr) < 0) {
+        neu_expr_free(expr);
+        return NULL;
+    }
+
+    return expr;
+}
+
+void neu_expr_free(neu_expr_t *expr)
+{
+    if (expr == NULL) {
+        return;
+    }
+
+    for (uint16_t i = 0; i < expr->n_operand; i++) {
+        free(expr->operands[i]);
+    }
+    free(expr->operands);
+    free(expr->ops);
+    free(expr);
+}
+
+uint16_t neu_expr_n_operand(const neu_expr_t *expr)
+{
+    return expr->n_operand;
+}
+
+const char *neu_expr_operand(const neu_expr_t *expr, uint16_t i)
+{
+    return i < expr->n_operand ? expr->operands[i] : NULL;
+}
+
+// the bitwise operators take the values truncated to int64
+static bool to_int(double v, int64_t *i)
+{
+    if (!(v > -9223372036854775808.0 && v < 9223372036854775808.0)) {
+        return false;
+    }
+    *i = (int64_t) v;
+    return true;
+}
+
+static int eval_int(uint8_t code, double a, double b, double *r)
+{
+    int64_t x = 0, y = 0;
+
+    if (!to_int(a, &x) || !to_int(b, &y)) {
+        return -1;
+    }
+
+    switch (code) {
+    case OP_NOT:
+        *r = (double) ~y;
+        break;
+    case OP_SHL:
+    case OP_SHR:
+    case OP_BIT:
+        if (y < 0 || y >= 64) {
+            return -1;
+        }
+        if (code == OP_SHL) {
+            *r = (double) (int64_t)((uint64_t) x << y);
+        } else if (code == OP_SHR) {
+            *r = (double) (x >> y);
+        } else {
+            *r = (double) ((x >> y) & 1);
+        }
+        break;
+    case OP_AND:
+        *r = (double) (x & y);
+        break;
+    case OP_OR:
+        *r = (double) (x | y);
+        break;
+    case OP_XOR:
+        *r = (double) (x ^ y);
+        break;
+    }
+
+    return 0;
+}
+
+int neu_expr_eval(const neu_expr_t *expr, const double *operands,
+                  double *result)
+{
+    double stack[EXPR_DEPTH_MAX];
+    int    top = -1;
+
+    for (uint16_t i = 0; i < expr->n_op; i++) {
+        const op_t *op = &expr->ops[i];
+        double      a  = 0;
+        double      b  = 0;
+
+        if (op->code == OP_NUM) {
+            stack[++top] = op->num;
+            continue;
+        }
+        if (op->code == OP_TAG) {
+            stack[++top] = operands[op->idx];
+            continue;
+        }
+
+        b = stack[top];
+        switch (op->code) {
+        case OP_NEG:
+            stack[top] = -b;
+            continue;
+        case OP_NOT:
+            if (eval_int(op->code, 0, b, &stack[top]) != 0) {
+                return -1;
+            }
+            continue;
+        case OP_ABS:
+            stack[top] = fabs(b);
+            continue;
+        default:
+            break;
+        }
+
+        a = stack[--top];
+        switch (op->code) {
+        case OP_ADD:
+            a += b;
+            break;
+        case OP_SUB:
+            a -= b;
+            break;
+        case OP_MUL:
+            a *= b;
+            break;
+        case OP_DIV:
+            if (b == 0) {
+                return -1;
+            }
+            a /= b;
+            break;
+        case OP_MOD:
+            if (b == 0) {
+                return -1;
+            }
+            a = fmod(a, b);
+            break;
+        case OP_SHL:
+        case OP_SHR:
+        case OP_BIT:
+        case OP_AND:
+        case OP_OR:
+        case OP_XOR:
+            if (eval_int(op->code, a, b, &a) != 0) {
+                return -1;
+            }
+            break;
+        case OP_MIN:
+            a = b < a ? b : a;
+            break;
+        case OP_MAX:
+            a = b > a ? b : a;
+            break;
+        }
+        stack[top] = a;
+    }
+
+    if (!isfinite(stack[0])) {
+        return -1;
+    }
+
+    *result = stack[0];
+    return 0;
+}
@@ -0,0 +1,49 @@
+/**
+ * NEURON IIoT System for Industry 4.0
+ * Copyright (C) 2020-2022 EMQ Technologies Co., Ltd All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ **/
+
+#ifndef _NEU_DRIVER_EXPR_H_
+#define _NEU_DRIVER_EXPR_H_
+
+#include <stdint.h>
+
+// Expressions of computed tags, compiled once to a postfix program over
+// doubles. Operands are numbers and the names of tags of the same group,
+// written as is when they are made of letters, digits, '_' and '.', quoted
+// with ' or " otherwise. Operators are those of C for + - * / % ~ & | ^ << >>
+// with C precedence, and the functions abs(x), min(a, b), max(a, b) and
+// bit(x, n). The bitwise operators work on the values truncated to int64.
+typedef struct neu_expr neu_expr_t;
+
+#define NEU_EXPR_OPERANDS_MAX 64
+
+// NULL if src is not a valid expression
+neu_expr_t *neu_expr_compile(const char *src);
+void        neu_expr_free(neu_expr_t *expr);
+
+// the distinct tags the expression reads, in the order neu_expr_eval takes
+// their values
+uint16_t    neu_expr_n_operand(const neu_expr_t *expr);
+const char *neu_expr_operand(const neu_expr_t *expr, uint16_t i);
+
+// 0 and the value in *result, -1 if it is not a finite number, on a division
+// by zero, a shift out of range or a bitwise operand out of int64
+int neu_expr_eval(const neu_expr_t *expr, const double *operands,
+                  double *result);
+
+#endif
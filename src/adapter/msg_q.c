@@ -19,20 +19,26 @@
 #include <pthread.h>
 
 #include "utils/log.h"
-#include "utils/utextend.h"
+#include "utils/time.h"
 
 #include "msg_q.h"
 
-struct item {
-    neu_msg_t *  msg;
-    struct item *prev, *next;
-};
-
 struct adapter_msg_q {
-    struct item *list;
-    uint32_t     max;
-    uint32_t     current;
-    char *       name;
+    neu_msg_t **ring;
+    int64_t *   pushed; // push time of each slot, in milliseconds
+    uint32_t    max;
+    uint32_t    head;
+    uint32_t    current;
+    char *      name;
+
+    adapter_msg_q_stats_t stats;
+
+    uint32_t                   high;
+    uint32_t                   low;
+    bool                       congested;
+    adapter_msg_q_watermark_cb watermark_cb;
+    void *                     watermark_arg;
+    uint32_t                   paused; // nesting of adapter_msg_q_pause
 
     pthread_mutex_t mtx;
     pthread_cond_t  cond;
@@ -44,73 +50,188 @@ adapter_msg_q_t *adapter_msg_q_new(const char *name, uint32_t size)
 
     pthread_mutex_init(&q->mtx, NULL);
     pthread_cond_init(&q->cond, NULL);
+    q->ring    = calloc(size, sizeof(neu_msg_t *));
+    q->pushed  = calloc(size, sizeof(int64_t));
     q->max     = size;
     q->name    = strdup(name);
+    q->head    = 0;
     q->current = 0;
+    q->high    = size;
+    q->low     = size;
 
     return q;
 }
 
 void adapter_msg_q_free(adapter_msg_q_t *q)
 {
-    struct item *tmp = NULL, *elt = NULL;
     nlog_warn("app: %s, drop %u msg", q->name, q->current);
     pthread_mutex_destroy(&q->mtx);
     pthread_cond_destroy(&q->cond);
 
-    DL_FOREACH_SAFE(q->list, elt, tmp)
-    {
-        DL_DELETE(q->list, elt);
-        neu_reqresp_head_t *header = neu_msg_get_header(elt->msg);
-        neu_trans_data_free((neu_reqresp_trans_data_t *) &header[1]);
-        neu_msg_free(elt->msg);
-        free(elt);
+    for (uint32_t i = 0; i < q->current; ++i) {
+        neu_msg_t *         msg    = q->ring[(q->head + i) % q->max];
+        neu_reqresp_head_t *header = neu_msg_get_header(msg);
+        neu_trans_data_head_free(header);
+        neu_msg_free(msg);
     }
+    free(q->ring);
+    free(q->pushed);
     free(q->name);
     free(q);
 }
 
+void adapter_msg_q_set_watermark(adapter_msg_q_t *q, uint32_t high,
+                                 uint32_t low, adapter_msg_q_watermark_cb cb,
+                                 void *arg)
+{
+    pthread_mutex_lock(&q->mtx);
+    q->high          = high;
+    q->low           = low < high ? low : high;
+    q->watermark_cb  = cb;
+    q->watermark_arg = arg;
+    pthread_mutex_unlock(&q->mtx);
+}
+
 int adapter_msg_q_push(adapter_msg_q_t *q, neu_msg_t *msg)
 {
-    int ret = -1;
+    int     ret    = -1;
+    bool    signal = false;
+    int64_t now    = neu_time_ms();
+
     pthread_mutex_lock(&q->mtx);
     if (q->current < q->max) {
+        q->ring[(q->head + q->current) % q->max]   = msg;
+        q->pushed[(q->head + q->current) % q->max] = now;
+        // the consumer only waits on an empty or paused queue
+        signal = q->current == 0 && q->paused == 0;
         q->current += 1;
-        struct item *elt = calloc(1, sizeof(struct item));
-        elt->msg         = msg;
-        DL_APPEND(q->list, elt);
         ret = 0;
+
+        q->stats.enqueued += 1;
+        if (q->current > q->stats.high_water) {
+            q->stats.high_water = q->current;
+        }
+
+        if (!q->congested && q->current >= q->high) {
+            q->congested = true;
+            if (q->watermark_cb != NULL) {
+                q->watermark_cb(q->watermark_arg, true);
+            }
+        }
+    } else {
+        q->stats.dropped += 1;
     }
     pthread_mutex_unlock(&q->mtx);
 
     if (ret == -1) {
         nlog_warn("app: %s, msg q is full, %u(%u)", q->name, q->current,
                   q->max);
-    } else {
+    } else if (signal) {
         pthread_cond_signal(&q->cond);
     }
 
     return ret;
 }
 
-uint32_t adapter_msg_q_pop(adapter_msg_q_t *q, neu_msg_t **p_data)
+uint32_t adapter_msg_q_pop_batch(adapter_msg_q_t *q, neu_msg_t **msgs,
+                                 int64_t *pushed, uint32_t n)
 {
     uint32_t ret = 0;
 
     pthread_mutex_lock(&q->mtx);
-    while (q->current == 0) {
+    while (q->current == 0 || q->paused > 0) {
         pthread_cond_wait(&q->cond, &q->mtx);
     }
-    struct item *elt = DL_LAST(q->list);
-
-    if (elt != NULL) {
-        DL_DELETE(q->list, elt);
-        *p_data = elt->msg;
-        free(elt);
-        q->current -= 1;
-        ret = q->current;
+
+    ret = q->current < n ? q->current : n;
+    for (uint32_t i = 0; i < ret; ++i) {
+        msgs[i] = q->ring[q->head];
+        if (pushed != NULL) {
+            pushed[i] = q->pushed[q->head];
+        }
+        q->head = (q->head + 1) % q->max;
+    }
+    q->current -= ret;
+    q->stats.dequeued += ret;
+
+    if (q->congested && q->current <= q->low) {
+        q->congested = false;
+        if (q->watermark_cb != NULL) {
+            q->watermark_cb(q->watermark_arg, false);
+        }
     }
+    pthread_mutex_unlock(&q->mtx);
+
+    return ret;
+}
+
+void adapter_msg_q_pause(adapter_msg_q_t *q, bool paused)
+{
+    bool signal = false;
 
+    pthread_mutex_lock(&q->mtx);
+    if (paused) {
+        q->paused += 1;
+    } else if (q->paused > 0) {
+        q->paused -= 1;
+        signal = q->paused == 0 && q->current > 0;
+    }
     pthread_mutex_unlock(&q->mtx);
+
+    if (signal) {
+        pthread_cond_signal(&q->cond);
+    }
+}
+
+uint32_t adapter_msg_q_evict(adapter_msg_q_t *q, uint32_t n)
+{
+    uint32_t ret = 0;
+
+    pthread_mutex_lock(&q->mtx);
+    ret = q->current < n ? q->current : n;
+    for (uint32_t i = 0; i < ret; ++i) {
+        neu_msg_t *         msg    = q->ring[q->head];
+        neu_reqresp_head_t *header = neu_msg_get_header(msg);
+
+        neu_trans_data_head_free(header);
+        neu_msg_free(msg);
+        q->head = (q->head + 1) % q->max;
+    }
+    q->current -= ret;
+    q->stats.evicted += ret;
+
+    if (q->congested && q->current <= q->low) {
+        q->congested = false;
+        if (q->watermark_cb != NULL) {
+            q->watermark_cb(q->watermark_arg, false);
+        }
+    }
+    pthread_mutex_unlock(&q->mtx);
+
+    if (ret > 0) {
+        nlog_warn("app: %s, evict %u msg, %u left", q->name, ret, q->current);
+    }
+
     return ret;
 }
+
+void adapter_msg_q_stats(adapter_msg_q_t *q, adapter_msg_q_stats_t *stats)
+{
+    pthread_mutex_lock(&q->mtx);
+    *stats       = q->stats;
+    stats->depth = q->current;
+    pthread_mutex_unlock(&q->mtx);
+}
+
+size_t adapter_msg_q_bytes(adapter_msg_q_t *q)
+{
+    size_t bytes = q->max * (sizeof(neu_msg_t *) + sizeof(int64_t));
+
+    pthread_mutex_lock(&q->mtx);
+    for (uint32_t i = 0; i < q->current; ++i) {
+        bytes += neu_msg_size(q->ring[(q->head + i) % q->max]);
+    }
+    pthread_mutex_unlock(&q->mtx);
+
+    return bytes;
+}
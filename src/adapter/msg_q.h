@@ -20,17 +20,57 @@
 #ifndef ADAPTER_MSG_Q_H
 #define ADAPTER_MSG_Q_H
 
+#include <stdbool.h>
 #include <stdint.h>
 
 #include "base/msg_internal.h"
 #include "msg.h"
 
+// A bounded FIFO of trans data messages, preallocated as a ring of `size`
+// slots. Messages are popped in the order they were pushed.
 typedef struct adapter_msg_q adapter_msg_q_t;
 
+// called with congested set when the queue length reaches the high water
+// mark, and with congested cleared once it falls back to the low water mark.
+// It runs under the queue lock, so it must be cheap and must not touch q.
+typedef void (*adapter_msg_q_watermark_cb)(void *arg, bool congested);
+
 adapter_msg_q_t *adapter_msg_q_new(const char *name, uint32_t size);
 void             adapter_msg_q_free(adapter_msg_q_t *q);
 
-int      adapter_msg_q_push(adapter_msg_q_t *q, neu_msg_t *msg);
-uint32_t adapter_msg_q_pop(adapter_msg_q_t *q, neu_msg_t **p_data);
+void adapter_msg_q_set_watermark(adapter_msg_q_t *q, uint32_t high,
+                                 uint32_t low, adapter_msg_q_watermark_cb cb,
+                                 void *arg);
+
+// return -1 if the queue is full
+int adapter_msg_q_push(adapter_msg_q_t *q, neu_msg_t *msg);
+// block until the queue is not empty, then pop up to n messages into msgs,
+// and their push times in milliseconds into pushed unless it is NULL,
+// return the number of popped messages
+uint32_t adapter_msg_q_pop_batch(adapter_msg_q_t *q, neu_msg_t **msgs,
+                                 int64_t *pushed, uint32_t n);
+
+// stop popping while paused, pushes go on until the queue is full.
+// Pauses nest, popping resumes once each of them is undone.
+void adapter_msg_q_pause(adapter_msg_q_t *q, bool paused);
+
+typedef struct {
+    uint32_t depth;      // messages in the queue
+    uint32_t high_water; // highest depth since the queue was created
+    uint64_t enqueued;
+    uint64_t dequeued;
+    uint64_t dropped; // pushes failed on a full queue
+    uint64_t evicted; // queued messages dropped by adapter_msg_q_evict
+} adapter_msg_q_stats_t;
+
+void adapter_msg_q_stats(adapter_msg_q_t *q, adapter_msg_q_stats_t *stats);
+
+// drop up to n of the oldest queued messages to free their memory, return the
+// number dropped
+uint32_t adapter_msg_q_evict(adapter_msg_q_t *q, uint32_t n);
+
+// bytes of the ring and of the queued messages, the tags a trans data message
+// points to are not counted
+size_t adapter_msg_q_bytes(adapter_msg_q_t *q);
 
 #endif
\ No newline at end of file
@@ -17,12 +17,25 @@
  * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
  **/
 
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <sys/stat.h>
+
 #include "utils/log.h"
 
 #include "adapter_internal.h"
+#include "driver/cache.h"
 #include "driver/driver_internal.h"
 #include "storage.h"
 
+#define LKV_DIR "persistence/lkv"
+
+static inline void lkv_path(const char *node, char *path, size_t size)
+{
+    snprintf(path, size, LKV_DIR "/%s.lkv", node);
+}
+
 void adapter_storage_state(const char *node, neu_node_running_state_e state)
 {
     neu_persister_update_node_state(node, state);
@@ -112,6 +125,16 @@ void adapter_storage_update_tag_value(const char *node, const char *group,
     }
 }
 
+void adapter_storage_update_tag_values(const char *node, const char *group,
+                                       const neu_datatag_t *tags, size_t n)
+{
+    int rv = neu_persister_update_tag_values(node, group, tags, n);
+    if (0 != rv) {
+        nlog_error("fail update value of %zu tags adapter:%s grp:%s", n, node,
+                   group);
+    }
+}
+
 void adapter_storage_del_tag(const char *node, const char *group,
                              const char *name)
 {
@@ -121,6 +144,69 @@ void adapter_storage_del_tag(const char *node, const char *group,
     }
 }
 
+void adapter_storage_group_profile(const char *                       node,
+                                   const neu_persist_group_profile_t *profile)
+{
+    int rv = neu_persister_store_group_profile(node, profile);
+    if (0 != rv) {
+        nlog_error("fail store profile adapter:%s grp:%s", node,
+                   profile->group_name);
+    }
+}
+
+void adapter_storage_lkv(const char *node, neu_driver_cache_t *cache,
+                         neu_driver_cache_t *pending)
+{
+    char path[PATH_MAX] = { 0 };
+
+    if (0 != mkdir(LKV_DIR, 0755) && EEXIST != errno) {
+        nlog_error("fail create %s, errno: %d", LKV_DIR, errno);
+        return;
+    }
+
+    lkv_path(node, path, sizeof(path));
+    if (0 != neu_driver_cache_save(cache, pending, path)) {
+        nlog_error("fail store last known values of adapter:%s", node);
+    }
+}
+
+void adapter_storage_update_lkv(const char *node, const char *new_name)
+{
+    char path[PATH_MAX]     = { 0 };
+    char new_path[PATH_MAX] = { 0 };
+
+    lkv_path(node, path, sizeof(path));
+    lkv_path(new_name, new_path, sizeof(new_path));
+    if (0 != rename(path, new_path) && ENOENT != errno) {
+        nlog_error("fail rename %s to %s, errno: %d", path, new_path, errno);
+    }
+}
+
+void adapter_storage_del_lkv(const char *node)
+{
+    char path[PATH_MAX] = { 0 };
+
+    lkv_path(node, path, sizeof(path));
+    if (0 != remove(path) && ENOENT != errno) {
+        nlog_error("fail remove %s, errno: %d", path, errno);
+    }
+}
+
+int adapter_load_lkv(const char *node, neu_driver_cache_t *cache)
+{
+    char path[PATH_MAX] = { 0 };
+
+    lkv_path(node, path, sizeof(path));
+    int n = neu_driver_cache_load(cache, path);
+    if (n < 0) {
+        nlog_warn("load %s last known values fail", node);
+        return -1;
+    }
+
+    nlog_notice("load %s last known values: %d", node, n);
+    return 0;
+}
+
 int adapter_load_setting(const char *node, char **setting)
 {
     int rv = neu_persister_load_node_setting(node, (const char **) setting);
@@ -134,35 +220,24 @@ int adapter_load_setting(const char *node, char **setting)
 
 int adapter_load_group_and_tag(neu_adapter_driver_t *driver)
 {
-    UT_array *     group_infos = NULL;
-    neu_adapter_t *adapter     = (neu_adapter_t *) driver;
+    UT_array *     groups  = NULL;
+    neu_adapter_t *adapter = (neu_adapter_t *) driver;
 
-    int rv = neu_persister_load_groups(adapter->name, &group_infos);
+    // one query for all groups and tags of the node, the tags are then moved
+    // into the groups a group at a time
+    int rv = neu_persister_load_group_tags(adapter->name, &groups);
     if (0 != rv) {
         nlog_warn("load %s group fail", adapter->name);
         return rv;
     }
 
-    utarray_foreach(group_infos, neu_persist_group_info_t *, p)
+    utarray_foreach(groups, neu_persist_group_tags_t *, p)
     {
-        UT_array *tags = NULL;
-        neu_adapter_driver_add_group(driver, p->name, p->interval);
-
-        rv = neu_persister_load_tags(adapter->name, p->name, &tags);
-        if (0 != rv) {
-            nlog_warn("load %s:%s tags fail", adapter->name, p->name);
-            continue;
-        }
-
-        utarray_foreach(tags, neu_datatag_t *, tag)
-        {
-            neu_adapter_driver_add_tag(driver, p->name, tag, -1);
-            neu_adapter_driver_load_tag(driver, p->name, tag, 1);
-        }
-
-        utarray_free(tags);
+        neu_adapter_driver_load_group(driver, p->name, p->interval,
+                                      utarray_front(p->tags),
+                                      utarray_len(p->tags));
     }
 
-    utarray_free(group_infos);
+    utarray_free(groups);
     return rv;
 }
\ No newline at end of file
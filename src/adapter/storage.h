@@ -23,6 +23,7 @@
 #include "persist/persist.h"
 
 #include "adapter_internal.h"
+#include "driver/cache.h"
 
 void adapter_storage_state(const char *node, neu_node_running_state_e state);
 void adapter_storage_setting(const char *node, const char *setting);
@@ -39,10 +40,20 @@ void adapter_storage_update_tag(const char *node, const char *group,
                                 const neu_datatag_t *tag);
 void adapter_storage_update_tag_value(const char *node, const char *group,
                                       const neu_datatag_t *tag);
+void adapter_storage_update_tag_values(const char *node, const char *group,
+                                       const neu_datatag_t *tags, size_t n);
 void adapter_storage_del_tag(const char *node, const char *group,
                              const char *name);
+void adapter_storage_group_profile(const char *                       node,
+                                   const neu_persist_group_profile_t *profile);
+// last known values of a driver, kept in a file of their own
+void adapter_storage_lkv(const char *node, neu_driver_cache_t *cache,
+                         neu_driver_cache_t *pending);
+void adapter_storage_update_lkv(const char *node, const char *new_name);
+void adapter_storage_del_lkv(const char *node);
 
 int adapter_load_setting(const char *node, char **setting);
+int adapter_load_lkv(const char *node, neu_driver_cache_t *cache);
 int adapter_load_group_and_tag(neu_adapter_driver_t *driver);
 
 #endif
@@ -30,9 +30,14 @@
 
 #include <zlog.h>
 
+#include "adapter/driver/driver_internal.h"
 #include "argparse.h"
+#include "bench.h"
 #include "persist/persist.h"
+#include "utils/http_handler.h"
 #include "utils/log.h"
+#include "utils/log_async.h"
+#include "utils/mem_budget.h"
 #include "version.h"
 #include "json/json.h"
 #include "json/neu_json_param.h"
@@ -65,8 +70,17 @@ const char *usage_text =
 "    -d, --daemon         run as daemon process\n"
 "    -h, --help           show this help message\n"
 "    stop                 stop running neuron\n"
+"    takeover             start the nodes of a running neuron in standby\n"
+"    handover             start in place of a running neuron, taking over\n"
+"                         its device connections and last known values\n"
 "    --log                log to the stdout\n"
 "    --log_level <LEVEL>  default log level(DEBUG,NOTICE)\n"
+"    --log_overflow <POLICY>\n"
+"                         what the log files written in the background drop\n"
+"                         while the disk falls behind,\n"
+"                           - drop_debug, debug and info lines first\n"
+"                                         (default)\n"
+"                           - drop_new,   any new line\n"
 "    --reset-password     reset dashboard to use default password\n"
 "    --restart <POLICY>   restart policy to apply when neuron daemon terminates,\n"
 "                           - never,      never restart (default)\n"
@@ -80,6 +94,106 @@ const char *usage_text =
 "    --plugin_dir <DIR>   directory from which neuron loads plugin lib files\n"
 "    --syslog_host <HOST> syslog server host to which neuron will send logs\n"
 "    --syslog_port <PORT> syslog server port (default 541 if not provided)\n"
+"    --msg_bus            pass messages between nodes through in-process\n"
+"                         ring buffers instead of unix domain sockets\n"
+"    --batch_report       drivers report all groups due in the same tick\n"
+"                         in one message per app\n"
+"    --event_workers <N>  serve the events of all nodes from a pool of\n"
+"                         shared threads instead of threads per node,\n"
+"                           - auto,       one thread per core\n"
+"                           - NUMBER,     NUMBER of threads\n"
+"    --app_consumers <N>  spread the trans data of each app over N threads\n"
+"                         by driver and group, for the plugins that allow\n"
+"                         it, 1 by default, up to 8\n"
+"    --trace_sample <N>   trace the data path of one in every N reports of\n"
+"                         each driver, 0 to disable (default)\n"
+"    --lazy_drivers <N>   start running drivers on their first subscription,\n"
+"                         read or write instead of at boot, and stop them\n"
+"                         after N seconds without any, 0 to disable (default)\n"
+"    --lkv_interval <N>   save the last known tag values of drivers every N\n"
+"                         seconds and serve them after a restart until the\n"
+"                         tags are read again, 0 to disable (default)\n"
+"    --overrun <POLICY>   what a group does when its reads fall behind,\n"
+"                           - coalesce,   run a late read at once (default)\n"
+"                           - skip,       drop reads a period late\n"
+"                           - degrade,    stretch the interval while the\n"
+"                                         reads take longer than it\n"
+"                           - adapt,      stretch the interval while the\n"
+"                                         reads overrun or start late, and\n"
+"                                         shrink it back gradually\n"
+"    --stretch_max <N>    read a group up to N times its interval apart\n"
+"                         under the adapt overrun policy, default 8\n"
+"    --shed_max <N>       read a group up to N times its interval apart\n"
+"                         while all the apps it reports to are congested,\n"
+"                         backing off and recovering gradually, 1 to\n"
+"                         disable (default)\n"
+"    --cold_groups <N>    stop polling a group nothing subscribes nor read in\n"
+"                         the last N intervals, the next read wakes it with\n"
+"                         one device read for all the waiting requests, 0\n"
+"                         to disable (default)\n"
+"    --profile_interval <N>\n"
+"                         save the read statistics of every group every N\n"
+"                         seconds, for the tuning recommendations of the\n"
+"                         group profile api, 0 to disable (default)\n"
+"    --write_through      drivers cache and report the value of a write the\n"
+"                         device confirmed at once, flagged written until\n"
+"                         the next read of the tag\n"
+"    --history_size <N>   drivers keep up to N KiB of compressed recent\n"
+"                         samples of every numeric tag for range queries,\n"
+"                         0 to disable (default)\n"
+"    --mlock              lock all the memory of neuron in RAM, so that\n"
+"                         nodes under sched_policy fifo or rr do not stall\n"
+"                         on page faults\n"
+"    --standby            load the nodes without starting them, until the\n"
+"                         instance takes over from the active one with\n"
+"                         `neuron takeover` or SIGUSR2\n"
+"    --mem_budget <N>     the MiB the caches, queues and history of all the\n"
+"                         nodes may take, 0 for no budget (default)\n"
+"    --mem_policy <LIST>  what the nodes give up over the budget, or over\n"
+"                         the mem_limit KiB of their setting, a comma\n"
+"                         separated list of, all by default,\n"
+"                           - drop_oldest,      apps drop the older half\n"
+"                                               of their queued data\n"
+"                           - reject_subscribe, no new subscriptions\n"
+"                           - shrink_history,   drivers halve the history\n"
+"                                               of their tags\n"
+"                         or none\n"
+"    --reconnect_rate <N> tcp connects of all the drivers per second, those\n"
+"                         over it wait for a later poll, 0 for no limit\n"
+"                         (default)\n"
+"    --shutdown_timeout <N>\n"
+"                         seconds a stop waits for the nodes to close,\n"
+"                         then exits without the ones still closing, 0 to\n"
+"                         wait for all of them (default)\n"
+"    --bench[=<SPEC>]     run a self benchmark with synthetic driver and app\n"
+"                         nodes on a database in memory, print throughput,\n"
+"                         latency and cpu per stage, then exit. SPEC is a\n"
+"                         comma separated list of, by default,\n"
+"                           - drivers=1,     driver nodes\n"
+"                           - groups=1,      groups of each driver\n"
+"                           - tags=1000,     tags of each group\n"
+"                           - interval=100,  ms between reads of a group\n"
+"                           - apps=1,        apps subscribing every group\n"
+"                           - seconds=10,    length of the measurement\n"
+"    --metrics_push <URL> push the metrics to the prometheus remote write\n"
+"                         endpoint at the http or https URL\n"
+"    --metrics_push_interval <N>\n"
+"                         seconds between two pushes of the metrics, 15 by\n"
+"                         default\n"
+"    --metrics_off <LIST> the metrics never registered nor updated, a comma\n"
+"                         separated list of\n"
+"                           - rolling,   the last_<N>s_ rolling counters\n"
+"                           - histogram, the histograms\n"
+"                           - group,     the series of every group, only\n"
+"                                        what the nodes aggregate remains\n"
+"                         or none (default)\n"
+"    --metrics_windows <LIST>\n"
+"                         the seconds of the rolling counters kept, a comma\n"
+"                         separated list such as 5,60, all by default\n"
+"    --http_workers <N>   threads of each of the two queues the REST server\n"
+"                         runs its handlers on, one for short requests such\n"
+"                         as ping and read, one for bulk requests such as\n"
+"                         the config export, 2 by default, up to 16\n"
 "\n";
 // clang-format on
 
@@ -94,6 +208,196 @@ static inline void version()
            NEURON_GIT_REV NEURON_GIT_DIFF, NEURON_BUILD_DATE);
 }
 
+static inline int parse_event_workers(const char *s, int *out)
+{
+    char *end = NULL;
+    long  n   = 0;
+
+    if (0 == strcmp(s, "auto")) {
+        *out = NEU_EVENT_WORKERS_AUTO;
+        return 0;
+    }
+
+    errno = 0;
+    n     = strtol(s, &end, 10);
+    if (0 != errno || '\0' != *end || n < 0 || n > 1024) {
+        return -1;
+    }
+
+    *out = n;
+    return 0;
+}
+
+static inline int parse_app_consumers(const char *s, uint16_t *out)
+{
+    char *end = NULL;
+    long  n   = 0;
+
+    errno = 0;
+    n     = strtol(s, &end, 10);
+    if (0 != errno || '\0' == *s || '\0' != *end || n < 1 ||
+        n > NEU_APP_CONSUMERS_MAX) {
+        return -1;
+    }
+
+    *out = n;
+    return 0;
+}
+
+static inline int parse_trace_sample(const char *s, uint32_t *out)
+{
+    char *end = NULL;
+    long  n   = 0;
+
+    errno = 0;
+    n     = strtol(s, &end, 10);
+    if (0 != errno || '\0' == *s || '\0' != *end || n < 0 || n > UINT32_MAX) {
+        return -1;
+    }
+
+    *out = n;
+    return 0;
+}
+
+static inline int parse_seconds(const char *s, uint32_t *out)
+{
+    char *end = NULL;
+    long  n   = 0;
+
+    errno = 0;
+    n     = strtol(s, &end, 10);
+    if (0 != errno || '\0' == *s || '\0' != *end || n < 0 ||
+        n > UINT32_MAX / 1000) {
+        return -1;
+    }
+
+    *out = n;
+    return 0;
+}
+
+static inline int parse_shed_max(const char *s, uint32_t *out)
+{
+    char *end = NULL;
+    long  n   = 0;
+
+    errno = 0;
+    n     = strtol(s, &end, 10);
+    if (0 != errno || '\0' == *s || '\0' != *end || n < 1 || n > 1024) {
+        return -1;
+    }
+
+    *out = n;
+    return 0;
+}
+
+static inline int parse_stretch_max(const char *s, uint32_t *out)
+{
+    return parse_shed_max(s, out);
+}
+
+static inline int parse_push_url(const char *s)
+{
+    if (0 == strncmp(s, "http://", 7) || 0 == strncmp(s, "https://", 8)) {
+        return 0;
+    }
+    return -1;
+}
+
+static inline int parse_push_interval(const char *s, uint32_t *out)
+{
+    char *end = NULL;
+    long  n   = 0;
+
+    errno = 0;
+    n     = strtol(s, &end, 10);
+    if (0 != errno || '\0' == *s || '\0' != *end || n < 1 || n > 86400) {
+        return -1;
+    }
+
+    *out = n;
+    return 0;
+}
+
+static inline int parse_http_workers(const char *s, uint32_t *out)
+{
+    char *end = NULL;
+    long  n   = 0;
+
+    errno = 0;
+    n     = strtol(s, &end, 10);
+    if (0 != errno || '\0' == *s || '\0' != *end || n < 1 ||
+        n > NEU_HTTP_WORKERS_MAX) {
+        return -1;
+    }
+
+    *out = n;
+    return 0;
+}
+
+static inline int parse_history_size(const char *s, uint32_t *out)
+{
+    char *end = NULL;
+    long  n   = 0;
+
+    errno = 0;
+    n     = strtol(s, &end, 10);
+    if (0 != errno || '\0' == *s || '\0' != *end || n < 0 || n > 65536) {
+        return -1;
+    }
+
+    *out = n;
+    return 0;
+}
+
+static inline int parse_cold_groups(const char *s, uint32_t *out)
+{
+    return parse_history_size(s, out);
+}
+
+static inline int parse_mem_budget(const char *s, uint32_t *out)
+{
+    char *end = NULL;
+    long  n   = 0;
+
+    errno = 0;
+    n     = strtol(s, &end, 10);
+    if (0 != errno || '\0' == *s || '\0' != *end || n < 0 || n > 1048576) {
+        return -1;
+    }
+
+    *out = n;
+    return 0;
+}
+
+static inline int parse_overrun(const char *s, int *out)
+{
+    if (0 == strcmp(s, "coalesce")) {
+        *out = NEU_GROUP_OVERRUN_COALESCE;
+    } else if (0 == strcmp(s, "skip")) {
+        *out = NEU_GROUP_OVERRUN_SKIP;
+    } else if (0 == strcmp(s, "degrade")) {
+        *out = NEU_GROUP_OVERRUN_DEGRADE;
+    } else if (0 == strcmp(s, "adapt")) {
+        *out = NEU_GROUP_OVERRUN_ADAPT;
+    } else {
+        return -1;
+    }
+
+    return 0;
+}
+
+static inline int parse_log_overflow(const char *s, int *out)
+{
+    neu_log_overflow_e overflow = NEU_LOG_OVERFLOW_DROP_DEBUG;
+
+    if (0 != neu_log_overflow_parse(s, &overflow)) {
+        return -1;
+    }
+
+    *out = overflow;
+    return 0;
+}
+
 static inline int reset_password()
 {
     neu_persist_user_info_t info = {
@@ -146,6 +450,12 @@ static inline int load_spec_arg(int argc, char *argv[], neu_cli_args_t *args)
     if (argc > 1 && strcmp(argv[1], "stop") == 0) {
         args->stop = true;
     }
+    if (argc > 1 && strcmp(argv[1], "takeover") == 0) {
+        args->takeover = true;
+    }
+    if (argc > 1 && strcmp(argv[1], "handover") == 0) {
+        args->handover = true;
+    }
     return ret;
 }
 
@@ -212,6 +522,266 @@ static inline int load_env(neu_cli_args_t *args, char **log_level_out,
             }
         }
 
+        char *msg_bus = getenv(NEU_ENV_MSG_BUS);
+        if (msg_bus != NULL) {
+            if (strcmp(msg_bus, "1") == 0) {
+                args->msg_bus = true;
+            } else if (strcmp(msg_bus, "0") == 0) {
+                args->msg_bus = false;
+            } else {
+                printf("neuron NEURON_MSG_BUS setting error!\n");
+                ret = -1;
+                break;
+            }
+        }
+
+        char *batch_report = getenv(NEU_ENV_BATCH_REPORT);
+        if (batch_report != NULL) {
+            if (strcmp(batch_report, "1") == 0) {
+                args->batch_report = true;
+            } else if (strcmp(batch_report, "0") == 0) {
+                args->batch_report = false;
+            } else {
+                printf("neuron NEURON_BATCH_REPORT setting error!\n");
+                ret = -1;
+                break;
+            }
+        }
+
+        char *event_workers = getenv(NEU_ENV_EVENT_WORKERS);
+        if (event_workers != NULL) {
+            if (parse_event_workers(event_workers, &args->event_workers) < 0) {
+                printf("neuron NEURON_EVENT_WORKERS setting error!\n");
+                ret = -1;
+                break;
+            }
+        }
+
+        char *app_consumers = getenv(NEU_ENV_APP_CONSUMERS);
+        if (app_consumers != NULL) {
+            if (parse_app_consumers(app_consumers, &args->app_consumers) < 0) {
+                printf("neuron NEURON_APP_CONSUMERS setting error!\n");
+                ret = -1;
+                break;
+            }
+        }
+
+        char *trace_sample = getenv(NEU_ENV_TRACE_SAMPLE);
+        if (trace_sample != NULL) {
+            if (parse_trace_sample(trace_sample, &args->trace_sample) < 0) {
+                printf("neuron NEURON_TRACE_SAMPLE setting error!\n");
+                ret = -1;
+                break;
+            }
+        }
+
+        char *lazy_drivers = getenv(NEU_ENV_LAZY_DRIVERS);
+        if (lazy_drivers != NULL) {
+            if (parse_seconds(lazy_drivers, &args->lazy_drivers) < 0) {
+                printf("neuron NEURON_LAZY_DRIVERS setting error!\n");
+                ret = -1;
+                break;
+            }
+        }
+
+        char *lkv_interval = getenv(NEU_ENV_LKV_INTERVAL);
+        if (lkv_interval != NULL) {
+            if (parse_seconds(lkv_interval, &args->lkv_interval) < 0) {
+                printf("neuron NEURON_LKV_INTERVAL setting error!\n");
+                ret = -1;
+                break;
+            }
+        }
+
+        char *overrun = getenv(NEU_ENV_OVERRUN);
+        if (overrun != NULL) {
+            if (parse_overrun(overrun, &args->overrun) < 0) {
+                printf("neuron NEURON_OVERRUN setting error!\n");
+                ret = -1;
+                break;
+            }
+        }
+
+        char *shed_max = getenv(NEU_ENV_SHED_MAX);
+        if (shed_max != NULL) {
+            if (parse_shed_max(shed_max, &args->shed_max) < 0) {
+                printf("neuron NEURON_SHED_MAX setting error!\n");
+                ret = -1;
+                break;
+            }
+        }
+
+        char *stretch_max = getenv(NEU_ENV_STRETCH_MAX);
+        if (stretch_max != NULL) {
+            if (parse_stretch_max(stretch_max, &args->stretch_max) < 0) {
+                printf("neuron NEURON_STRETCH_MAX setting error!\n");
+                ret = -1;
+                break;
+            }
+        }
+
+        char *cold_groups = getenv(NEU_ENV_COLD_GROUPS);
+        if (cold_groups != NULL) {
+            if (parse_cold_groups(cold_groups, &args->cold_groups) < 0) {
+                printf("neuron NEURON_COLD_GROUPS setting error!\n");
+                ret = -1;
+                break;
+            }
+        }
+
+        char *profile_interval = getenv(NEU_ENV_PROFILE_INTERVAL);
+        if (profile_interval != NULL) {
+            if (parse_seconds(profile_interval, &args->profile_interval) < 0) {
+                printf("neuron NEURON_PROFILE_INTERVAL setting error!\n");
+                ret = -1;
+                break;
+            }
+        }
+
+        char *write_through = getenv(NEU_ENV_WRITE_THROUGH);
+        if (write_through != NULL) {
+            if (strcmp(write_through, "1") == 0) {
+                args->write_through = true;
+            } else if (strcmp(write_through, "0") == 0) {
+                args->write_through = false;
+            } else {
+                printf("neuron NEURON_WRITE_THROUGH setting error!\n");
+                ret = -1;
+                break;
+            }
+        }
+
+        char *mlock = getenv(NEU_ENV_MLOCK);
+        if (mlock != NULL) {
+            if (strcmp(mlock, "1") == 0) {
+                args->mlock = true;
+            } else if (strcmp(mlock, "0") == 0) {
+                args->mlock = false;
+            } else {
+                printf("neuron NEURON_MLOCK setting error!\n");
+                ret = -1;
+                break;
+            }
+        }
+
+        char *standby = getenv(NEU_ENV_STANDBY);
+        if (standby != NULL) {
+            if (strcmp(standby, "1") == 0) {
+                args->standby = true;
+            } else if (strcmp(standby, "0") == 0) {
+                args->standby = false;
+            } else {
+                printf("neuron NEURON_STANDBY setting error!\n");
+                ret = -1;
+                break;
+            }
+        }
+
+        char *history_size = getenv(NEU_ENV_HISTORY_SIZE);
+        if (history_size != NULL) {
+            if (parse_history_size(history_size, &args->history_size) < 0) {
+                printf("neuron NEURON_HISTORY_SIZE setting error!\n");
+                ret = -1;
+                break;
+            }
+        }
+
+        char *mem_budget = getenv(NEU_ENV_MEM_BUDGET);
+        if (mem_budget != NULL) {
+            if (parse_mem_budget(mem_budget, &args->mem_budget) < 0) {
+                printf("neuron NEURON_MEM_BUDGET setting error!\n");
+                ret = -1;
+                break;
+            }
+        }
+
+        char *mem_policy = getenv(NEU_ENV_MEM_POLICY);
+        if (mem_policy != NULL) {
+            if (neu_mem_policy_parse(mem_policy, &args->mem_policy) < 0) {
+                printf("neuron NEURON_MEM_POLICY setting error!\n");
+                ret = -1;
+                break;
+            }
+        }
+
+        char *log_overflow = getenv(NEU_ENV_LOG_OVERFLOW);
+        if (log_overflow != NULL) {
+            if (parse_log_overflow(log_overflow, &args->log_overflow) < 0) {
+                printf("neuron NEURON_LOG_OVERFLOW setting error!\n");
+                ret = -1;
+                break;
+            }
+        }
+
+        char *reconnect_rate = getenv(NEU_ENV_RECONNECT_RATE);
+        if (reconnect_rate != NULL) {
+            if (parse_seconds(reconnect_rate, &args->reconnect_rate) < 0) {
+                printf("neuron NEURON_RECONNECT_RATE setting error!\n");
+                ret = -1;
+                break;
+            }
+        }
+
+        char *shutdown_timeout = getenv(NEU_ENV_SHUTDOWN_TIMEOUT);
+        if (shutdown_timeout != NULL) {
+            if (parse_seconds(shutdown_timeout, &args->shutdown_timeout) < 0) {
+                printf("neuron NEURON_SHUTDOWN_TIMEOUT setting error!\n");
+                ret = -1;
+                break;
+            }
+        }
+
+        char *metrics_push = getenv(NEU_ENV_METRICS_PUSH);
+        if (metrics_push != NULL) {
+            if (parse_push_url(metrics_push) < 0) {
+                printf("neuron NEURON_METRICS_PUSH setting error!\n");
+                ret = -1;
+                break;
+            }
+            free(args->metrics_push);
+            args->metrics_push = strdup(metrics_push);
+        }
+
+        char *push_interval = getenv(NEU_ENV_METRICS_PUSH_INTERVAL);
+        if (push_interval != NULL) {
+            if (parse_push_interval(push_interval,
+                                    &args->metrics_push_interval) < 0) {
+                printf("neuron NEURON_METRICS_PUSH_INTERVAL setting error!\n");
+                ret = -1;
+                break;
+            }
+        }
+
+        char *metrics_off = getenv(NEU_ENV_METRICS_OFF);
+        if (metrics_off != NULL) {
+            if (neu_metrics_off_parse(metrics_off, &args->metrics_off) < 0) {
+                printf("neuron NEURON_METRICS_OFF setting error!\n");
+                ret = -1;
+                break;
+            }
+        }
+
+        char *metrics_windows = getenv(NEU_ENV_METRICS_WINDOWS);
+        if (metrics_windows != NULL) {
+            args->n_metrics_windows = neu_metrics_windows_parse(
+                metrics_windows, args->metrics_windows,
+                NEU_METRICS_WINDOWS_MAX);
+            if (args->n_metrics_windows < 0) {
+                printf("neuron NEURON_METRICS_WINDOWS setting error!\n");
+                ret = -1;
+                break;
+            }
+        }
+
+        char *http_workers = getenv(NEU_ENV_HTTP_WORKERS);
+        if (http_workers != NULL) {
+            if (parse_http_workers(http_workers, &args->http_workers) < 0) {
+                printf("neuron NEURON_HTTP_WORKERS setting error!\n");
+                ret = -1;
+                break;
+            }
+        }
+
         char *config_dir = getenv(NEU_ENV_CONFIG_DIR);
         if (config_dir != NULL) {
             if (*config_dir_out != NULL) {
@@ -424,10 +994,41 @@ void neu_cli_args_init(neu_cli_args_t *args, int argc, char *argv[])
         { "stop", no_argument, NULL, 's' },
         { "syslog_host", required_argument, NULL, 'S' },
         { "syslog_port", required_argument, NULL, 'P' },
+        { "msg_bus", no_argument, NULL, 'm' },
+        { "batch_report", no_argument, NULL, 'b' },
+        { "event_workers", required_argument, NULL, 'w' },
+        { "app_consumers", required_argument, NULL, 'A' },
+        { "trace_sample", required_argument, NULL, 't' },
+        { "lazy_drivers", required_argument, NULL, 'L' },
+        { "lkv_interval", required_argument, NULL, 'k' },
+        { "overrun", required_argument, NULL, 'O' },
+        { "shed_max", required_argument, NULL, 'D' },
+        { "stretch_max", required_argument, NULL, 'E' },
+        { "cold_groups", required_argument, NULL, 'Q' },
+        { "profile_interval", required_argument, NULL, 'X' },
+        { "write_through", no_argument, NULL, 'W' },
+        { "history_size", required_argument, NULL, 'H' },
+        { "mlock", no_argument, NULL, 'M' },
+        { "standby", no_argument, NULL, 'y' },
+        { "mem_budget", required_argument, NULL, 'B' },
+        { "mem_policy", required_argument, NULL, 'G' },
+        { "reconnect_rate", required_argument, NULL, 'R' },
+        { "log_overflow", required_argument, NULL, 'F' },
+        { "shutdown_timeout", required_argument, NULL, 'T' },
+        { "bench", optional_argument, NULL, 'x' },
+        { "metrics_push", required_argument, NULL, 'U' },
+        { "metrics_push_interval", required_argument, NULL, 'I' },
+        { "http_workers", required_argument, NULL, 'J' },
+        { "metrics_off", required_argument, NULL, 'K' },
+        { "metrics_windows", required_argument, NULL, 'N' },
         { NULL, 0, NULL, 0 },
     };
 
     memset(args, 0, sizeof(*args));
+    args->mem_policy            = NEU_MEM_POLICY_ALL;
+    args->metrics_push_interval = NEU_METRICS_PUSH_INTERVAL_DEFAULT;
+    args->stretch_max           = NEU_GROUP_STRETCH_MAX_DEFAULT;
+    args->http_workers          = NEU_HTTP_WORKERS_DEFAULT;
 
     int c            = 0;
     int option_index = 0;
@@ -487,6 +1088,226 @@ void neu_cli_args_init(neu_cli_args_t *args, int argc, char *argv[])
         case 'a':
             args->disable_auth = true;
             break;
+        case 'm':
+            args->msg_bus = true;
+            break;
+        case 'b':
+            args->batch_report = true;
+            break;
+        case 'W':
+            args->write_through = true;
+            break;
+        case 'M':
+            args->mlock = true;
+            break;
+        case 'y':
+            args->standby = true;
+            break;
+        case 'w':
+            if (0 != parse_event_workers(optarg, &args->event_workers)) {
+                fprintf(stderr,
+                        "%s: option '--event_workers' invalid value: `%s`\n",
+                        argv[0], optarg);
+                ret = 1;
+                goto quit;
+            }
+            break;
+        case 'A':
+            if (0 != parse_app_consumers(optarg, &args->app_consumers)) {
+                fprintf(stderr,
+                        "%s: option '--app_consumers' invalid value: `%s`\n",
+                        argv[0], optarg);
+                ret = 1;
+                goto quit;
+            }
+            break;
+        case 't':
+            if (0 != parse_trace_sample(optarg, &args->trace_sample)) {
+                fprintf(stderr,
+                        "%s: option '--trace_sample' invalid value: `%s`\n",
+                        argv[0], optarg);
+                ret = 1;
+                goto quit;
+            }
+            break;
+        case 'L':
+            if (0 != parse_seconds(optarg, &args->lazy_drivers)) {
+                fprintf(stderr,
+                        "%s: option '--lazy_drivers' invalid value: `%s`\n",
+                        argv[0], optarg);
+                ret = 1;
+                goto quit;
+            }
+            break;
+        case 'k':
+            if (0 != parse_seconds(optarg, &args->lkv_interval)) {
+                fprintf(stderr,
+                        "%s: option '--lkv_interval' invalid value: `%s`\n",
+                        argv[0], optarg);
+                ret = 1;
+                goto quit;
+            }
+            break;
+        case 'O':
+            if (0 != parse_overrun(optarg, &args->overrun)) {
+                fprintf(stderr, "%s: option '--overrun' invalid value: `%s`\n",
+                        argv[0], optarg);
+                ret = 1;
+                goto quit;
+            }
+            break;
+        case 'D':
+            if (0 != parse_shed_max(optarg, &args->shed_max)) {
+                fprintf(stderr, "%s: option '--shed_max' invalid value: `%s`\n",
+                        argv[0], optarg);
+                ret = 1;
+                goto quit;
+            }
+            break;
+        case 'E':
+            if (0 != parse_stretch_max(optarg, &args->stretch_max)) {
+                fprintf(stderr,
+                        "%s: option '--stretch_max' invalid value: `%s`\n",
+                        argv[0], optarg);
+                ret = 1;
+                goto quit;
+            }
+            break;
+        case 'Q':
+            if (0 != parse_cold_groups(optarg, &args->cold_groups)) {
+                fprintf(stderr,
+                        "%s: option '--cold_groups' invalid value: `%s`\n",
+                        argv[0], optarg);
+                ret = 1;
+                goto quit;
+            }
+            break;
+        case 'X':
+            if (0 != parse_seconds(optarg, &args->profile_interval)) {
+                fprintf(stderr,
+                        "%s: option '--profile_interval' invalid value: `%s`\n",
+                        argv[0], optarg);
+                ret = 1;
+                goto quit;
+            }
+            break;
+        case 'H':
+            if (0 != parse_history_size(optarg, &args->history_size)) {
+                fprintf(stderr,
+                        "%s: option '--history_size' invalid value: `%s`\n",
+                        argv[0], optarg);
+                ret = 1;
+                goto quit;
+            }
+            break;
+        case 'B':
+            if (0 != parse_mem_budget(optarg, &args->mem_budget)) {
+                fprintf(stderr,
+                        "%s: option '--mem_budget' invalid value: `%s`\n",
+                        argv[0], optarg);
+                ret = 1;
+                goto quit;
+            }
+            break;
+        case 'G':
+            if (0 != neu_mem_policy_parse(optarg, &args->mem_policy)) {
+                fprintf(stderr,
+                        "%s: option '--mem_policy' invalid value: `%s`\n",
+                        argv[0], optarg);
+                ret = 1;
+                goto quit;
+            }
+            break;
+        case 'F':
+            if (0 != parse_log_overflow(optarg, &args->log_overflow)) {
+                fprintf(stderr,
+                        "%s: option '--log_overflow' invalid value: `%s`\n",
+                        argv[0], optarg);
+                ret = 1;
+                goto quit;
+            }
+            break;
+        case 'R':
+            if (0 != parse_seconds(optarg, &args->reconnect_rate)) {
+                fprintf(stderr,
+                        "%s: option '--reconnect_rate' invalid value: `%s`\n",
+                        argv[0], optarg);
+                ret = 1;
+                goto quit;
+            }
+            break;
+        case 'T':
+            if (0 != parse_seconds(optarg, &args->shutdown_timeout)) {
+                fprintf(stderr,
+                        "%s: option '--shutdown_timeout' invalid value: `%s`\n",
+                        argv[0], optarg);
+                ret = 1;
+                goto quit;
+            }
+            break;
+        case 'x': {
+            neu_bench_conf_t conf = { 0 };
+            if (0 != neu_bench_parse(optarg, &conf)) {
+                fprintf(stderr, "%s: option '--bench' invalid value: `%s`\n",
+                        argv[0], optarg);
+                ret = 1;
+                goto quit;
+            }
+            free(args->bench);
+            args->bench = strdup(optarg ? optarg : "");
+            break;
+        }
+        case 'U':
+            if (0 != parse_push_url(optarg)) {
+                fprintf(stderr,
+                        "%s: option '--metrics_push' invalid value: `%s`\n",
+                        argv[0], optarg);
+                ret = 1;
+                goto quit;
+            }
+            free(args->metrics_push);
+            args->metrics_push = strdup(optarg);
+            break;
+        case 'I':
+            if (0 !=
+                parse_push_interval(optarg, &args->metrics_push_interval)) {
+                fprintf(stderr,
+                        "%s: option '--metrics_push_interval' invalid value: "
+                        "`%s`\n",
+                        argv[0], optarg);
+                ret = 1;
+                goto quit;
+            }
+            break;
+        case 'K':
+            if (0 != neu_metrics_off_parse(optarg, &args->metrics_off)) {
+                fprintf(stderr,
+                        "%s: option '--metrics_off' invalid value: `%s`\n",
+                        argv[0], optarg);
+                ret = 1;
+                goto quit;
+            }
+            break;
+        case 'N':
+            args->n_metrics_windows = neu_metrics_windows_parse(
+                optarg, args->metrics_windows, NEU_METRICS_WINDOWS_MAX);
+            if (args->n_metrics_windows < 0) {
+                fprintf(stderr,
+                        "%s: option '--metrics_windows' invalid value: `%s`\n",
+                        argv[0], optarg);
+                ret = 1;
+                goto quit;
+            }
+            break;
+        case 'J':
+            if (0 != parse_http_workers(optarg, &args->http_workers)) {
+                fprintf(stderr,
+                        "%s: option '--http_workers' invalid value: `%s`\n",
+                        argv[0], optarg);
+                ret = 1;
+                goto quit;
+            }
+            break;
         case 'c':
             if (0 == strcmp("config_dir", long_options[option_index].name)) {
                 if (config_dir != NULL) {
@@ -532,6 +1353,13 @@ void neu_cli_args_init(neu_cli_args_t *args, int argc, char *argv[])
         args->restart = NEU_RESTART_NEVER;
     }
 
+    if (args->bench && args->daemonized) {
+        fprintf(stderr, "%s: option '--bench' does not run with '--daemon'\n",
+                argv[0]);
+        ret = 1;
+        goto quit;
+    }
+
     args->config_dir = config_dir ? config_dir : strdup("./config");
     if (!file_exists(args->config_dir)) {
         fprintf(stderr, "configuration directory `%s` not exists\n",
@@ -592,5 +1420,7 @@ void neu_cli_args_fini(neu_cli_args_t *args)
         free(args->plugin_dir);
         free(args->ip);
         free(args->syslog_host);
+        free(args->bench);
+        free(args->metrics_push);
     }
 }
@@ -35,6 +35,37 @@
 #define NEU_ENV_PLUGIN_DIR "NEURON_PLUGIN_DIR"
 #define NEU_ENV_SYSLOG_HOST "NEURON_SYSLOG_HOST"
 #define NEU_ENV_SYSLOG_PORT "NEURON_SYSLOG_PORT"
+#define NEU_ENV_MSG_BUS "NEURON_MSG_BUS"
+#define NEU_ENV_BATCH_REPORT "NEURON_BATCH_REPORT"
+#define NEU_ENV_EVENT_WORKERS "NEURON_EVENT_WORKERS"
+#define NEU_ENV_APP_CONSUMERS "NEURON_APP_CONSUMERS"
+#define NEU_ENV_TRACE_SAMPLE "NEURON_TRACE_SAMPLE"
+#define NEU_ENV_LAZY_DRIVERS "NEURON_LAZY_DRIVERS"
+#define NEU_ENV_LKV_INTERVAL "NEURON_LKV_INTERVAL"
+#define NEU_ENV_OVERRUN "NEURON_OVERRUN"
+#define NEU_ENV_SHED_MAX "NEURON_SHED_MAX"
+#define NEU_ENV_STRETCH_MAX "NEURON_STRETCH_MAX"
+#define NEU_ENV_COLD_GROUPS "NEURON_COLD_GROUPS"
+#define NEU_ENV_PROFILE_INTERVAL "NEURON_PROFILE_INTERVAL"
+#define NEU_ENV_WRITE_THROUGH "NEURON_WRITE_THROUGH"
+#define NEU_ENV_HISTORY_SIZE "NEURON_HISTORY_SIZE"
+#define NEU_ENV_MLOCK "NEURON_MLOCK"
+#define NEU_ENV_STANDBY "NEURON_STANDBY"
+#define NEU_ENV_MEM_BUDGET "NEURON_MEM_BUDGET"
+#define NEU_ENV_MEM_POLICY "NEURON_MEM_POLICY"
+#define NEU_ENV_RECONNECT_RATE "NEURON_RECONNECT_RATE"
+#define NEU_ENV_LOG_OVERFLOW "NEURON_LOG_OVERFLOW"
+#define NEU_ENV_SHUTDOWN_TIMEOUT "NEURON_SHUTDOWN_TIMEOUT"
+#define NEU_ENV_METRICS_PUSH "NEURON_METRICS_PUSH"
+#define NEU_ENV_METRICS_PUSH_INTERVAL "NEURON_METRICS_PUSH_INTERVAL"
+#define NEU_ENV_HTTP_WORKERS "NEURON_HTTP_WORKERS"
+#define NEU_ENV_METRICS_OFF "NEURON_METRICS_OFF"
+#define NEU_ENV_METRICS_WINDOWS "NEURON_METRICS_WINDOWS"
+
+#define NEU_METRICS_PUSH_INTERVAL_DEFAULT 15
+
+#define NEU_EVENT_WORKERS_PER_NODE 0
+#define NEU_EVENT_WORKERS_AUTO (-1)
 
 #define NEURON_CONFIG_FNAME "./config/neuron.json"
 
@@ -46,6 +77,8 @@ extern "C" {
 #include <stdint.h>
 #include <stdlib.h>
 
+#include "metrics.h"
+
 extern const char *g_config_dir;
 extern const char *g_plugin_dir;
 
@@ -60,10 +93,46 @@ typedef struct {
     char *   config_dir;
     char *   plugin_dir;
     bool     stop;
+    bool     takeover;
+    bool     handover;
     char *   ip;
     int      port;
     char *   syslog_host;
     uint16_t syslog_port;
+    bool     msg_bus;       // pass messages through in-process rings
+    bool     batch_report;  // report due groups in one message per app
+    int      event_workers; // shared event threads, 0 for one per node
+    uint16_t app_consumers; // trans data threads per app, 0 or 1 for one
+    uint32_t trace_sample;  // trace one in every N reports, 0 disables
+    uint32_t lazy_drivers;  // idle seconds of drivers started on demand
+    uint32_t lkv_interval;  // seconds between saves of last known values
+    int      overrun;       // group overrun policy, see neu_group_overrun_e
+    uint32_t shed_max;      // most ticks between reads of congested groups
+    uint32_t stretch_max;   // most ticks between reads of adapting groups
+    uint32_t cold_groups;   // intervals unread groups are polled, 0 always
+    bool     write_through; // cache the values of confirmed writes at once
+    uint32_t history_size;  // KiB of recent samples kept per tag, 0 for none
+    bool     mlock;         // lock the memory of the process in RAM
+    bool     standby;       // hold the nodes until a takeover
+    uint32_t mem_budget;    // MiB all the nodes may account, 0 for no budget
+    uint32_t mem_policy;    // what nodes give up over it, see mem_budget.h
+    int      log_overflow;  // see neu_log_overflow_e
+    // tcp connects of all the drivers per second, 0 for no limit
+    uint32_t reconnect_rate;
+    // seconds a stop waits for the nodes to close, 0 for all of them
+    uint32_t shutdown_timeout;
+    // spec of the self benchmark to run instead, NULL to run normally
+    char *bench;
+    // prometheus remote write url to push the metrics to, NULL for none
+    char *   metrics_push;
+    uint32_t metrics_push_interval; // seconds between two pushes
+    uint32_t http_workers;          // of each of the http handler queues
+    uint32_t metrics_off;           // see NEU_METRICS_OFF_*
+    // the rolling windows of seconds kept, all of them if none
+    uint32_t metrics_windows[NEU_METRICS_WINDOWS_MAX];
+    int      n_metrics_windows;
+    // seconds between two saves of the read statistics of the groups
+    uint32_t profile_interval;
 } neu_cli_args_t;
 
 /** Parse command line arguments.
@@ -17,36 +17,92 @@
  * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
  **/
 #include <pthread.h>
+#include <stdlib.h>
 #include <string.h>
 #include <sys/time.h>
 
 #include "define.h"
 #include "errcodes.h"
+#include "utils/intern.h"
 
 #include "group.h"
 
+// a tag definition shared by the identical tags of every group, so that the
+// many nodes made from one template hold a single copy of their definitions
+typedef struct tag_def {
+    neu_datatag_t tag;
+
+    void *   key; // the definition as bytes, NULL for a tag not shared
+    size_t   key_len;
+    uint32_t ref;
+
+    UT_hash_handle hh;
+} tag_def_t;
+
+// the scalar fields of a definition, ahead of its strings in the key
+typedef struct {
+    neu_attribute_e           attribute;
+    neu_type_e                type;
+    uint8_t                   precision;
+    double                    decimal;
+    neu_datatag_addr_option_u option;
+    neu_tag_deadband_t        deadband;
+    uint16_t                  poll_divisor;
+    uint8_t                   meta[NEU_TAG_META_LENGTH];
+} tag_def_head_t;
+
+static pthread_mutex_t tag_defs_mtx = PTHREAD_MUTEX_INITIALIZER;
+static tag_def_t *     tag_defs     = NULL;
+
 typedef struct tag_elem {
-    char *name;
+    const char *name; // interned
 
-    neu_datatag_t *tag;
+    neu_datatag_t *tag; // the tag of def
+    tag_def_t *    def;
 
     UT_hash_handle hh;
 } tag_elem_t;
 
+typedef struct {
+    uint32_t gram;  // three bytes of a name or description
+    uint32_t index; // of the tag in the view
+} tag_gram_t;
+
+// every tag of a group with a trigram index over the names and descriptions,
+// built by the first query after a change and shared until the next one, so
+// that a query neither scans the group nor holds its lock
+typedef struct {
+    UT_array *  tags;  // neu_datatag_t
+    tag_gram_t *grams; // sorted by gram, then by index
+    size_t      n_gram;
+    uint32_t    ref;
+} search_view_t;
+
 struct neu_group {
     char *name;
 
     tag_elem_t *tags;
     uint32_t    interval;
 
+    // bumped on every change, written under mtx and read without it
     int64_t         timestamp;
     pthread_mutex_t mtx;
+
+    // the latest read view, possibly of an older timestamp, swapped under
+    // view_mtx which is only ever held for a pointer and a reference count so
+    // the data path never waits behind a tag edit holding mtx
+    pthread_mutex_t       view_mtx;
+    neu_group_tag_view_t *read_view;
+    search_view_t *       search_view;
 };
 
 static UT_array *to_array(tag_elem_t *tags);
 static void      split_static_array(tag_elem_t *tags, UT_array **static_tags,
                                     UT_array **other_tags);
 static void      update_timestamp(neu_group_t *group);
+static void      search_view_put(search_view_t *view);
+static tag_def_t *tag_def_get(neu_datatag_t *tag, bool move);
+static void       tag_def_put(tag_def_t *def);
 
 neu_group_t *neu_group_new(const char *name, uint32_t interval)
 {
@@ -55,6 +111,7 @@ neu_group_t *neu_group_new(const char *name, uint32_t interval)
     group->name     = strdup(name);
     group->interval = interval;
     pthread_mutex_init(&group->mtx, NULL);
+    pthread_mutex_init(&group->view_mtx, NULL);
 
     return group;
 }
@@ -67,13 +124,21 @@ void neu_group_destroy(neu_group_t *group)
     HASH_ITER(hh, group->tags, el, tmp)
     {
         HASH_DEL(group->tags, el);
-        free(el->name);
-        neu_tag_free(el->tag);
+        tag_def_put(el->def);
         free(el);
     }
+    if (group->read_view != NULL) {
+        neu_group_put_read_view(group->read_view);
+        group->read_view = NULL;
+    }
+    if (group->search_view != NULL) {
+        search_view_put(group->search_view);
+        group->search_view = NULL;
+    }
     pthread_mutex_unlock(&group->mtx);
 
     pthread_mutex_destroy(&group->mtx);
+    pthread_mutex_destroy(&group->view_mtx);
     free(group->name);
     free(group);
 }
@@ -112,8 +177,10 @@ void neu_group_set_interval(neu_group_t *group, uint32_t interval)
 int neu_group_update(neu_group_t *group, uint32_t interval)
 {
     if (group->interval != interval) {
+        pthread_mutex_lock(&group->mtx);
         group->interval = interval;
         update_timestamp(group);
+        pthread_mutex_unlock(&group->mtx);
     }
 
     return 0;
@@ -130,9 +197,16 @@ int neu_group_add_tag(neu_group_t *group, const neu_datatag_t *tag)
         return NEU_ERR_TAG_NAME_CONFLICT;
     }
 
-    el       = calloc(1, sizeof(tag_elem_t));
-    el->name = strdup(tag->name);
-    el->tag  = neu_tag_dup(tag);
+    const char *name = neu_intern_name(tag->name);
+    el               = calloc(1, sizeof(tag_elem_t));
+    if (NULL == name || NULL == el ||
+        NULL == (el->def = tag_def_get((neu_datatag_t *) tag, false))) {
+        pthread_mutex_unlock(&group->mtx);
+        free(el);
+        return NEU_ERR_EINTERNAL;
+    }
+    el->name = name;
+    el->tag  = &el->def->tag;
 
     HASH_ADD_STR(group->tags, name, el);
     update_timestamp(group);
@@ -141,6 +215,41 @@ int neu_group_add_tag(neu_group_t *group, const neu_datatag_t *tag)
     return 0;
 }
 
+// add the tags by taking over their contents, the moved ones are left zeroed
+// and the conflicting ones untouched, returns the number of tags added
+int neu_group_move_tags(neu_group_t *group, neu_datatag_t *tags, int n)
+{
+    tag_elem_t *el    = NULL;
+    int         added = 0;
+
+    pthread_mutex_lock(&group->mtx);
+    for (int i = 0; i < n; ++i) {
+        HASH_FIND_STR(group->tags, tags[i].name, el);
+        if (el != NULL) {
+            continue;
+        }
+
+        const char *name = neu_intern_name(tags[i].name);
+        el               = calloc(1, sizeof(tag_elem_t));
+        if (NULL == name || NULL == el ||
+            NULL == (el->def = tag_def_get(&tags[i], true))) {
+            free(el);
+            continue;
+        }
+        el->name = name;
+        el->tag  = &el->def->tag;
+
+        HASH_ADD_STR(group->tags, name, el);
+        ++added;
+    }
+    if (added > 0) {
+        update_timestamp(group);
+    }
+    pthread_mutex_unlock(&group->mtx);
+
+    return added;
+}
+
 int neu_group_update_tag(neu_group_t *group, const neu_datatag_t *tag)
 {
     tag_elem_t *el  = NULL;
@@ -149,10 +258,17 @@ int neu_group_update_tag(neu_group_t *group, const neu_datatag_t *tag)
     pthread_mutex_lock(&group->mtx);
     HASH_FIND_STR(group->tags, tag->name, el);
     if (el != NULL) {
-        neu_tag_copy(el->tag, tag);
-
-        update_timestamp(group);
-        ret = NEU_ERR_SUCCESS;
+        tag_def_t *def = tag_def_get((neu_datatag_t *) tag, false);
+        if (def != NULL) {
+            tag_def_put(el->def);
+            el->def = def;
+            el->tag = &def->tag;
+
+            update_timestamp(group);
+            ret = NEU_ERR_SUCCESS;
+        } else {
+            ret = NEU_ERR_EINTERNAL;
+        }
     }
     pthread_mutex_unlock(&group->mtx);
 
@@ -168,8 +284,7 @@ int neu_group_del_tag(neu_group_t *group, const char *tag_name)
     HASH_FIND_STR(group->tags, tag_name, el);
     if (el != NULL) {
         HASH_DEL(group->tags, el);
-        free(el->name);
-        neu_tag_free(el->tag);
+        tag_def_put(el->def);
         free(el);
 
         update_timestamp(group);
@@ -248,31 +363,297 @@ static inline bool is_readable_and_match_query(const neu_datatag_t *tag,
     return is_readable(tag, NULL) && match_query(tag, data);
 }
 
-UT_array *neu_group_query_tag(neu_group_t *group, const char *name)
+static int gram_cmp(const void *a, const void *b)
 {
-    UT_array *array = NULL;
+    const tag_gram_t *x = a;
+    const tag_gram_t *y = b;
+
+    if (x->gram != y->gram) {
+        return x->gram < y->gram ? -1 : 1;
+    }
+    return x->index < y->index ? -1 : x->index > y->index;
+}
+
+static inline uint32_t gram_at(const char *s)
+{
+    return (uint32_t)(uint8_t) s[0] << 16 | (uint32_t)(uint8_t) s[1] << 8 |
+        (uint8_t) s[2];
+}
+
+static size_t add_grams(tag_gram_t *grams, const char *s, uint32_t index)
+{
+    size_t n   = 0;
+    size_t len = s == NULL ? 0 : strlen(s);
+
+    for (size_t i = 0; i + 3 <= len; ++i) {
+        grams[n].gram  = gram_at(s + i);
+        grams[n].index = index;
+        ++n;
+    }
+    return n;
+}
+
+static search_view_t *search_view_new(UT_array *tags)
+{
+    search_view_t *view  = calloc(1, sizeof(search_view_t));
+    size_t         total = 0;
+
+    if (view == NULL) {
+        utarray_free(tags);
+        return NULL;
+    }
+
+    view->tags = tags;
+    view->ref  = 1;
+
+    utarray_foreach(tags, neu_datatag_t *, tag)
+    {
+        total += strlen(tag->name);
+        total += tag->description == NULL ? 0 : strlen(tag->description);
+    }
+
+    // without an index every query scans the view
+    view->grams = total > 0 ? malloc(total * sizeof(tag_gram_t)) : NULL;
+    if (view->grams == NULL) {
+        return view;
+    }
+
+    uint32_t index = 0;
+    utarray_foreach(tags, neu_datatag_t *, tag)
+    {
+        view->n_gram += add_grams(view->grams + view->n_gram, tag->name, index);
+        view->n_gram +=
+            add_grams(view->grams + view->n_gram, tag->description, index);
+        ++index;
+    }
+
+    qsort(view->grams, view->n_gram, sizeof(tag_gram_t), gram_cmp);
+
+    // a tag is listed once per gram however often the gram occurs in it
+    size_t n = 0;
+    for (size_t i = 0; i < view->n_gram; ++i) {
+        if (n == 0 || view->grams[n - 1].gram != view->grams[i].gram ||
+            view->grams[n - 1].index != view->grams[i].index) {
+            view->grams[n++] = view->grams[i];
+        }
+    }
+    view->n_gram = n;
+
+    return view;
+}
+
+static void search_view_put(search_view_t *view)
+{
+    if (__atomic_sub_fetch(&view->ref, 1, __ATOMIC_ACQ_REL) == 0) {
+        utarray_free(view->tags);
+        free(view->grams);
+        free(view);
+    }
+}
+
+static search_view_t *search_view_get(neu_group_t *group)
+{
+    search_view_t *view      = NULL;
+    UT_array *     tags      = NULL;
+    int64_t        timestamp = 0;
 
     pthread_mutex_lock(&group->mtx);
-    array = filter_tags(group->tags, name_contains, (void *) name);
+    view = group->search_view;
+    if (view != NULL) {
+        __atomic_add_fetch(&view->ref, 1, __ATOMIC_RELAXED);
+        pthread_mutex_unlock(&group->mtx);
+        return view;
+    }
+    tags      = to_array(group->tags);
+    timestamp = group->timestamp;
     pthread_mutex_unlock(&group->mtx);
 
+    // indexing takes a while on a large group, keep the lock free meanwhile
+    view = search_view_new(tags);
+    if (view == NULL) {
+        return NULL;
+    }
+
+    pthread_mutex_lock(&group->mtx);
+    // share the view unless the group changed while it was built
+    if (group->search_view == NULL && group->timestamp == timestamp) {
+        group->search_view = view;
+        __atomic_add_fetch(&view->ref, 1, __ATOMIC_RELAXED);
+    }
+    pthread_mutex_unlock(&group->mtx);
+
+    return view;
+}
+
+// the tags holding every gram of key, as a range of view->grams, false if
+// key is too short to narrow the search
+static bool search_candidates(const search_view_t *view, const char *key,
+                              size_t *lo_p, size_t *hi_p)
+{
+    size_t len  = strlen(key);
+    bool   hit  = false;
+    size_t best = 0;
+
+    if (view->grams == NULL || len < 3) {
+        return false;
+    }
+
+    // the rarest gram of the key gives the fewest candidates
+    for (size_t i = 0; i + 3 <= len; ++i) {
+        uint32_t gram = gram_at(key + i);
+        size_t   lo = 0, hi = view->n_gram;
+
+        while (lo < hi) {
+            size_t mid = lo + (hi - lo) / 2;
+            if (view->grams[mid].gram < gram) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+
+        size_t end = lo;
+        while (end < view->n_gram && view->grams[end].gram == gram) {
+            ++end;
+        }
+
+        if (!hit || end - lo < best) {
+            hit   = true;
+            best  = end - lo;
+            *lo_p = lo;
+            *hi_p = end;
+        }
+        if (best == 0) {
+            break;
+        }
+    }
+
+    return hit;
+}
+
+static UT_array *search_tags(neu_group_t *group, const char *key,
+                             bool (*predicate)(const neu_datatag_t *, void *),
+                             void *data)
+{
+    UT_array *     array = NULL;
+    search_view_t *view  = search_view_get(group);
+    size_t         lo = 0, hi = 0;
+
+    utarray_new(array, neu_tag_get_icd());
+    if (view == NULL) {
+        return array;
+    }
+
+    if (key != NULL && search_candidates(view, key, &lo, &hi)) {
+        for (size_t i = lo; i < hi; ++i) {
+            neu_datatag_t *tag =
+                utarray_eltptr(view->tags, view->grams[i].index);
+            if (predicate(tag, data)) {
+                utarray_push_back(array, tag);
+            }
+        }
+    } else {
+        utarray_foreach(view->tags, neu_datatag_t *, tag)
+        {
+            if (predicate(tag, data)) {
+                utarray_push_back(array, tag);
+            }
+        }
+    }
+
+    search_view_put(view);
     return array;
 }
 
+UT_array *neu_group_query_tag(neu_group_t *group, const char *name)
+{
+    return search_tags(group, name, name_contains, (void *) name);
+}
+
+static inline bool page_match(const neu_datatag_t *      tag,
+                              const neu_group_tag_page_t *page)
+{
+    return (page->name == NULL || name_contains(tag, (void *) page->name)) &&
+        (page->type == 0 || tag->type == page->type) &&
+        (tag->attribute & page->attribute) == page->attribute;
+}
+
+int neu_group_query_tag_page(neu_group_t *               group,
+                             const neu_group_tag_page_t *page, UT_array **tags,
+                             uint32_t *total)
+{
+    search_view_t *view   = search_view_get(group);
+    size_t         lo     = 0;
+    size_t         hi     = 0;
+    size_t         n      = 0;
+    size_t         start  = 0;
+    uint32_t       skip   = page->offset;
+    bool           narrow = false;
+
+    utarray_new(*tags, neu_tag_get_icd());
+    *total = 0;
+    if (view == NULL) {
+        return NEU_ERR_SUCCESS;
+    }
+
+    if (page->after != NULL && page->after[0] != '\0') {
+        for (start = 0; start < utarray_len(view->tags); ++start) {
+            neu_datatag_t *tag = utarray_eltptr(view->tags, start);
+            if (strcmp(tag->name, page->after) == 0) {
+                break;
+            }
+        }
+        if (start == utarray_len(view->tags)) {
+            search_view_put(view);
+            return NEU_ERR_TAG_NOT_EXIST;
+        }
+        ++start;
+    }
+
+    // candidates of a gram are in the order of the group as well
+    narrow =
+        page->name != NULL && search_candidates(view, page->name, &lo, &hi);
+    n      = narrow ? hi - lo : utarray_len(view->tags);
+    for (size_t i = 0; i < n; ++i) {
+        size_t         index = narrow ? view->grams[lo + i].index : i;
+        neu_datatag_t *tag   = utarray_eltptr(view->tags, index);
+
+        if (!page_match(tag, page)) {
+            continue;
+        }
+
+        ++*total;
+        if (index < start) {
+            continue;
+        }
+        if (skip > 0) {
+            --skip;
+            continue;
+        }
+        if (page->limit == 0 || utarray_len(*tags) < page->limit) {
+            utarray_push_back(*tags, tag);
+        }
+    }
+
+    search_view_put(view);
+    return NEU_ERR_SUCCESS;
+}
+
 UT_array *neu_group_query_read_tag(neu_group_t *group, const char *name,
                                    const char *desc)
 {
-    UT_array *   array = NULL;
-    struct query q     = {
+    struct query q = {
         .name = (char *) name,
         .desc = (char *) desc,
     };
 
-    pthread_mutex_lock(&group->mtx);
-    array = filter_tags(group->tags, is_readable_and_match_query, &q);
-    pthread_mutex_unlock(&group->mtx);
+    // both keys have to match, narrowing by the longer one is enough
+    const char *key = name;
+    if (key == NULL || (desc != NULL && strlen(desc) > strlen(key))) {
+        key = desc;
+    }
 
-    return array;
+    return search_tags(group, key, is_readable_and_match_query, &q);
 }
 
 UT_array *neu_group_get_read_tag(neu_group_t *group)
@@ -286,6 +667,111 @@ UT_array *neu_group_get_read_tag(neu_group_t *group)
     return array;
 }
 
+static int read_view_columns(neu_group_tag_view_t *view)
+{
+    size_t n = utarray_len(view->tags);
+
+    view->names      = calloc(n > 0 ? n : 1, sizeof(*view->names));
+    view->attributes = calloc(n > 0 ? n : 1, sizeof(*view->attributes));
+    if (view->names == NULL || view->attributes == NULL) {
+        return -1;
+    }
+
+    size_t i = 0;
+    utarray_foreach(view->tags, neu_datatag_t *, tag)
+    {
+        view->names[i]      = neu_intern_name(tag->name);
+        view->attributes[i] = tag->attribute;
+        if (view->names[i] == NULL) {
+            return -1;
+        }
+        ++i;
+    }
+    return 0;
+}
+
+static neu_group_tag_view_t *read_view_ref(neu_group_t *group)
+{
+    neu_group_tag_view_t *view = NULL;
+
+    pthread_mutex_lock(&group->view_mtx);
+    view = group->read_view;
+    if (view != NULL) {
+        __atomic_add_fetch(&view->ref, 1, __ATOMIC_RELAXED);
+    }
+    pthread_mutex_unlock(&group->view_mtx);
+
+    return view;
+}
+
+neu_group_tag_view_t *neu_group_get_read_view(neu_group_t *group)
+{
+    int64_t               now   = 0;
+    neu_group_tag_view_t *view  = read_view_ref(group);
+    neu_group_tag_view_t *fresh = NULL;
+    neu_group_tag_view_t *old   = NULL;
+
+    now = __atomic_load_n(&group->timestamp, __ATOMIC_ACQUIRE);
+    if (view != NULL && view->timestamp == now) {
+        return view;
+    }
+
+    if (view != NULL) {
+        // an edit is running, keep serving the tags from before it
+        if (pthread_mutex_trylock(&group->mtx) != 0) {
+            return view;
+        }
+    } else {
+        pthread_mutex_lock(&group->mtx);
+    }
+
+    fresh = calloc(1, sizeof(neu_group_tag_view_t));
+    if (fresh == NULL) {
+        pthread_mutex_unlock(&group->mtx);
+        return view;
+    }
+    fresh->tags      = filter_tags(group->tags, is_readable, NULL);
+    fresh->timestamp = group->timestamp;
+    fresh->ref       = 1;
+    pthread_mutex_unlock(&group->mtx);
+
+    if (read_view_columns(fresh) != 0) {
+        neu_group_put_read_view(fresh);
+        return view;
+    }
+    fresh->ref = 2; // the group's and the caller's
+
+    pthread_mutex_lock(&group->view_mtx);
+    old = group->read_view;
+    if (old != NULL && old->timestamp >= fresh->timestamp) {
+        // another reader published one at least as new meanwhile
+        old   = NULL;
+        fresh->ref -= 1;
+    } else {
+        group->read_view = fresh;
+    }
+    pthread_mutex_unlock(&group->view_mtx);
+
+    if (old != NULL) {
+        neu_group_put_read_view(old);
+    }
+    if (view != NULL) {
+        neu_group_put_read_view(view);
+    }
+
+    return fresh;
+}
+
+void neu_group_put_read_view(neu_group_tag_view_t *view)
+{
+    if (__atomic_sub_fetch(&view->ref, 1, __ATOMIC_ACQ_REL) == 0) {
+        utarray_free(view->tags);
+        free(view->names);
+        free(view->attributes);
+        free(view);
+    }
+}
+
 uint16_t neu_group_tag_size(const neu_group_t *group)
 {
     uint16_t size = 0;
@@ -313,35 +799,60 @@ neu_datatag_t *neu_group_find_tag(neu_group_t *group, const char *tag)
 void neu_group_split_static_tags(neu_group_t *group, UT_array **static_tags,
                                  UT_array **other_tags)
 {
-    return split_static_array(group->tags, static_tags, other_tags);
+    pthread_mutex_lock(&group->mtx);
+    split_static_array(group->tags, static_tags, other_tags);
+    pthread_mutex_unlock(&group->mtx);
 }
 
 void neu_group_change_test(neu_group_t *group, int64_t timestamp, void *arg,
                            neu_group_change_fn fn)
 {
-    if (group->timestamp != timestamp) {
-        UT_array *static_tags = NULL, *other_tags = NULL;
+    UT_array *static_tags = NULL, *other_tags = NULL;
+    int64_t   now         = 0;
+    uint32_t  interval    = 0;
+
+    // called from the data path, an edit in progress is picked up by a later
+    // call once it is done
+    if (pthread_mutex_trylock(&group->mtx) != 0) {
+        return;
+    }
+    now      = group->timestamp;
+    interval = group->interval;
+    if (now != timestamp) {
         split_static_array(group->tags, &static_tags, &other_tags);
-        fn(arg, group->timestamp, static_tags, other_tags, group->interval);
+    }
+    pthread_mutex_unlock(&group->mtx);
+
+    if (static_tags != NULL) {
+        fn(arg, now, static_tags, other_tags, interval);
     }
 }
 
 bool neu_group_is_change(neu_group_t *group, int64_t timestamp)
 {
-    bool change = false;
-
-    change = group->timestamp != timestamp;
-
-    return change;
+    return __atomic_load_n(&group->timestamp, __ATOMIC_ACQUIRE) != timestamp;
 }
 
+// must be called with the group locked
 static void update_timestamp(neu_group_t *group)
 {
     struct timeval tv = { 0 };
 
     gettimeofday(&tv, NULL);
 
-    group->timestamp = (int64_t) tv.tv_sec * 1000 * 1000 + (int64_t) tv.tv_usec;
+    // strictly increasing, it tells the views and the driver apart
+    int64_t timestamp =
+        (int64_t) tv.tv_sec * 1000 * 1000 + (int64_t) tv.tv_usec;
+    if (timestamp <= group->timestamp) {
+        timestamp = group->timestamp + 1;
+    }
+    __atomic_store_n(&group->timestamp, timestamp, __ATOMIC_RELEASE);
+
+    // the read view goes stale by its timestamp, the next getter replaces it
+    if (group->search_view != NULL) {
+        search_view_put(group->search_view);
+        group->search_view = NULL;
+    }
 }
 
 static UT_array *to_array(tag_elem_t *tags)
@@ -372,3 +883,118 @@ static void split_static_array(tag_elem_t *tags, UT_array **static_tags,
         }
     }
 }
+
+static void *tag_def_key(const neu_datatag_t *tag, size_t *len)
+{
+    const char *strs[] = { tag->name, tag->address, tag->description };
+    size_t      lens[3] = { 0 };
+    size_t      n       = sizeof(tag_def_head_t);
+
+    for (int i = 0; i < 3; ++i) {
+        lens[i] = (strs[i] ? strlen(strs[i]) : 0) + 1;
+        n += lens[i];
+    }
+
+    uint8_t *key = calloc(1, n);
+    if (NULL == key) {
+        return NULL;
+    }
+
+    // zeroed first so that the padding compares equal
+    tag_def_head_t head;
+    memset(&head, 0, sizeof(head));
+    head.attribute    = tag->attribute;
+    head.type         = tag->type;
+    head.precision    = tag->precision;
+    head.decimal      = tag->decimal;
+    head.option       = tag->option;
+    head.deadband     = tag->deadband;
+    head.poll_divisor = tag->poll_divisor;
+    // the meta of a driver, such as a compiled address, is only ever shared
+    // by tags with the same one
+    memcpy(head.meta, tag->meta, sizeof(head.meta));
+    memcpy(key, &head, sizeof(head));
+
+    size_t off = sizeof(head);
+    for (int i = 0; i < 3; ++i) {
+        if (strs[i]) {
+            memcpy(key + off, strs[i], lens[i]);
+        }
+        off += lens[i];
+    }
+
+    *len = n;
+    return key;
+}
+
+// the definition of the tag, its contents taken over and the tag left zeroed
+// if move, otherwise copied, untouched on failure
+static tag_def_t *tag_def_get(neu_datatag_t *tag, bool move)
+{
+    tag_def_t *def = NULL;
+    void *     key = NULL;
+    size_t     len = 0;
+
+    // the value of a static tag lives in its meta, it is never shared
+    if (!neu_tag_attribute_test(tag, NEU_ATTRIBUTE_STATIC)) {
+        if (NULL == (key = tag_def_key(tag, &len))) {
+            return NULL;
+        }
+
+        pthread_mutex_lock(&tag_defs_mtx);
+        HASH_FIND(hh, tag_defs, key, len, def);
+        if (def != NULL) {
+            def->ref += 1;
+            pthread_mutex_unlock(&tag_defs_mtx);
+            free(key);
+            if (move) {
+                neu_tag_fini(tag);
+                memset(tag, 0, sizeof(neu_datatag_t));
+            }
+            return def;
+        }
+    }
+
+    def = calloc(1, sizeof(tag_def_t));
+    if (NULL == def) {
+        if (key != NULL) {
+            pthread_mutex_unlock(&tag_defs_mtx);
+            free(key);
+        }
+        return NULL;
+    }
+
+    if (move) {
+        memcpy(&def->tag, tag, sizeof(neu_datatag_t));
+        memset(tag, 0, sizeof(neu_datatag_t));
+    } else {
+        neu_tag_copy(&def->tag, tag);
+    }
+    def->key     = key;
+    def->key_len = len;
+    def->ref     = 1;
+
+    if (key != NULL) {
+        HASH_ADD_KEYPTR(hh, tag_defs, def->key, def->key_len, def);
+        pthread_mutex_unlock(&tag_defs_mtx);
+    }
+
+    return def;
+}
+
+static void tag_def_put(tag_def_t *def)
+{
+    if (def->key != NULL) {
+        pthread_mutex_lock(&tag_defs_mtx);
+        if (--def->ref > 0) {
+            pthread_mutex_unlock(&tag_defs_mtx);
+            return;
+        }
+        HASH_DEL(tag_defs, def);
+        pthread_mutex_unlock(&tag_defs_mtx);
+    }
+
+    neu_tag_fini(&def->tag);
+    free(def->key);
+    free(def);
+}
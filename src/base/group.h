@@ -28,6 +28,19 @@
 
 typedef struct neu_group neu_group_t;
 
+// immutable snapshot of the readable tags of a group, shared by every caller
+// until a tag of the group changes
+typedef struct {
+    UT_array *tags;      // neu_datatag_t
+    int64_t   timestamp; // of the group when the snapshot was taken
+    uint32_t  ref;
+
+    // the fields the report path scans, one per element of tags, packed so
+    // that a pass over a large group does not walk the tag records
+    const char **names;      // interned
+    uint8_t *    attributes; // neu_attribute_e
+} neu_group_tag_view_t;
+
 neu_group_t *neu_group_new(const char *name, uint32_t interval);
 const char * neu_group_get_name(const neu_group_t *group);
 int          neu_group_set_name(neu_group_t *group, const char *name);
@@ -36,14 +49,37 @@ void         neu_group_set_interval(neu_group_t *group, uint32_t interval);
 void         neu_group_destroy(neu_group_t *group);
 int          neu_group_update(neu_group_t *group, uint32_t interval);
 int          neu_group_add_tag(neu_group_t *group, const neu_datatag_t *tag);
+int          neu_group_move_tags(neu_group_t *group, neu_datatag_t *tags,
+                                 int n);
 int          neu_group_update_tag(neu_group_t *group, const neu_datatag_t *tag);
 int          neu_group_del_tag(neu_group_t *group, const char *tag_name);
 UT_array *   neu_group_get_tag(neu_group_t *group);
 UT_array *   neu_group_query_tag(neu_group_t *group, const char *name);
 UT_array *   neu_group_get_read_tag(neu_group_t *group);
+
+// one page of the tags matching every filter set, in the order of the group
+typedef struct {
+    const char *name;      // in the name or description, NULL for any
+    uint8_t     type;      // neu_type_e, 0 for any
+    uint8_t     attribute; // every bit set, 0 for any
+    const char *after;     // the last tag of the previous page, NULL for none
+    uint32_t    offset;    // matches skipped after the cursor
+    uint32_t    limit;     // 0 for no limit
+} neu_group_tag_page_t;
+
+// only the tags of the page are copied, total counts every match
+int neu_group_query_tag_page(neu_group_t *               group,
+                             const neu_group_tag_page_t *page, UT_array **tags,
+                             uint32_t *total);
 UT_array *   neu_group_query_read_tag(neu_group_t *group, const char *name,
                                       const char *desc);
 uint16_t     neu_group_tag_size(const neu_group_t *group);
+
+// never waits for a tag edit in progress, the snapshot from before the edit
+// is served until the edit is done
+neu_group_tag_view_t *neu_group_get_read_view(neu_group_t *group);
+void                  neu_group_put_read_view(neu_group_tag_view_t *view);
+
 neu_datatag_t *neu_group_find_tag(neu_group_t *group, const char *tag);
 void neu_group_split_static_tags(neu_group_t *group, UT_array **static_tags,
                                  UT_array **other_tags);
@@ -18,9 +18,11 @@
  **/
 
 #include <dirent.h>
+#include <errno.h>
 #include <pthread.h>
 #include <sys/statvfs.h>
 #include <sys/sysinfo.h>
+#include <sys/utsname.h>
 #include <unistd.h>
 
 #ifndef NEU_CLIB
@@ -29,129 +31,161 @@
 
 #include "adapter.h"
 #include "adapter/adapter_internal.h"
+#include "connection/neu_connection.h"
 #include "metrics.h"
 #include "utils/log.h"
+#include "utils/log_async.h"
+#include "utils/mem_budget.h"
 #include "utils/time.h"
 
+// host stats are sampled in the background, scrapes only copy them
+#define HOST_SAMPLE_INTERVAL_MS 1000
+
 pthread_rwlock_t g_metrics_mtx_ = PTHREAD_RWLOCK_INITIALIZER;
 neu_metrics_t    g_metrics_;
 static uint64_t  g_start_ts_;
 
-static void find_os_info()
+uint32_t        neu_metrics_off = 0;
+static uint32_t g_windows_[NEU_METRICS_WINDOWS_MAX];
+static int      g_n_windows_ = 0;
+
+typedef struct {
+    unsigned           cpu_percent;
+    unsigned           cpu_cores;
+    size_t             mem_total_bytes;
+    size_t             mem_used_bytes;
+    size_t             mem_cache_bytes;
+    size_t             disk_size_gibibytes;
+    size_t             disk_used_gibibytes;
+    size_t             disk_avail_gibibytes;
+    bool               core_dumped;
+    unsigned long long cpu_work; // /proc/stat of the previous sample
+    unsigned long long cpu_total;
+} host_stats_t;
+
+static void copy_str(char *dst, size_t size, const char *src)
 {
-    const char *cmd =
-        "if [ -f /etc/os-release ]; then . /etc/os-release;"
-        "echo $NAME $VERSION_ID; else uname -s; fi; uname -r; uname -m";
-    FILE *f = popen(cmd, "r");
+    size_t len = strnlen(src, size - 1);
 
-    if (NULL == f) {
-        nlog_error("popen command fail");
-        return;
+    memcpy(dst, src, len);
+    dst[len] = 0;
+}
+
+// copy an os-release value without its quotes
+static void copy_value(char *dst, size_t size, const char *src)
+{
+    if ('"' == *src || '\'' == *src) {
+        ++src;
     }
+    copy_str(dst, size, src);
+    dst[strcspn(dst, "\"'")] = 0;
+}
 
-    char buf[64] = {};
+// NAME and VERSION_ID of /etc/os-release
+static bool read_os_release(char *buf, size_t size)
+{
+    char  line[128]   = { 0 };
+    char  name[64]    = { 0 };
+    char  version[32] = { 0 };
+    FILE *f           = fopen("/etc/os-release", "r");
 
-    if (NULL == fgets(buf, sizeof(buf), f)) {
-        nlog_error("no command output");
-        pclose(f);
-        return;
+    if (NULL == f) {
+        return false;
     }
-    buf[strcspn(buf, "\n")] = 0;
-    strncpy(g_metrics_.distro, buf, sizeof(g_metrics_.distro));
-    g_metrics_.distro[sizeof(g_metrics_.distro) - 1] = 0;
 
-    if (NULL == fgets(buf, sizeof(buf), f)) {
-        nlog_error("no command output");
-        pclose(f);
-        return;
+    while (NULL != fgets(line, sizeof(line), f)) {
+        line[strcspn(line, "\n")] = 0;
+        if (0 == strncmp(line, "NAME=", 5)) {
+            copy_value(name, sizeof(name), line + 5);
+        } else if (0 == strncmp(line, "VERSION_ID=", 11)) {
+            copy_value(version, sizeof(version), line + 11);
+        }
+    }
+    fclose(f);
+
+    if (0 == name[0]) {
+        return false;
     }
-    buf[strcspn(buf, "\n")] = 0;
-    strncpy(g_metrics_.kernel, buf, sizeof(g_metrics_.kernel));
-    g_metrics_.kernel[sizeof(g_metrics_.kernel) - 1] = 0;
+    snprintf(buf, size, version[0] ? "%s %s" : "%s", name, version);
+    return true;
+}
 
-    if (NULL == fgets(buf, sizeof(buf), f)) {
-        nlog_error("no command output");
-        pclose(f);
+static void find_os_info()
+{
+    struct utsname uts = { 0 };
+
+    if (0 != uname(&uts)) {
+        nlog_error("uname fail");
         return;
     }
-    buf[strcspn(buf, "\n")] = 0;
-    strncpy(g_metrics_.machine, buf, sizeof(g_metrics_.machine));
-    g_metrics_.kernel[sizeof(g_metrics_.machine) - 1] = 0;
 
-    pclose(f);
+    if (!read_os_release(g_metrics_.distro, sizeof(g_metrics_.distro))) {
+        copy_str(g_metrics_.distro, sizeof(g_metrics_.distro), uts.sysname);
+    }
+    copy_str(g_metrics_.kernel, sizeof(g_metrics_.kernel), uts.release);
+    copy_str(g_metrics_.machine, sizeof(g_metrics_.machine), uts.machine);
 
 #ifdef NEU_CLIB
-    strncpy(g_metrics_.clib, NEU_CLIB, sizeof(g_metrics_.clib));
-    strncpy(g_metrics_.clib_version, "unknow", sizeof(g_metrics_.clib_version));
+    strncpy(g_metrics_.clib, NEU_CLIB, sizeof(g_metrics_.clib) - 1);
+    strncpy(g_metrics_.clib_version, "unknow",
+            sizeof(g_metrics_.clib_version) - 1);
 #else
-    strncpy(g_metrics_.clib, "glibc", sizeof(g_metrics_.clib));
+    strncpy(g_metrics_.clib, "glibc", sizeof(g_metrics_.clib) - 1);
     strncpy(g_metrics_.clib_version, gnu_get_libc_version(),
-            sizeof(g_metrics_.clib_version));
+            sizeof(g_metrics_.clib_version) - 1);
 #endif
 }
 
-static size_t parse_memory_fields(int col)
+static inline size_t memory_total()
 {
-    FILE * f       = NULL;
-    char   buf[64] = {};
-    size_t val     = 0;
+    struct sysinfo info = { 0 };
+
+    if (0 != sysinfo(&info)) {
+        return 0;
+    }
+    return (size_t) info.totalram * info.mem_unit;
+}
 
-    sprintf(buf, "free -b | awk 'NR==2 {print $%i}'", col);
+// buff/cache as reported by free
+static size_t memory_cache()
+{
+    char   line[128] = { 0 };
+    size_t val       = 0, kb = 0;
+    FILE * f         = fopen("/proc/meminfo", "r");
 
-    f = popen(buf, "r");
     if (NULL == f) {
-        nlog_error("popen command fail");
+        nlog_error("open /proc/meminfo fail");
         return 0;
     }
 
-    if (NULL != fgets(buf, sizeof(buf), f)) {
-        val = atoll(buf);
-    } else {
-        nlog_error("no command output");
+    while (NULL != fgets(line, sizeof(line), f)) {
+        if (1 == sscanf(line, "Buffers: %zu kB", &kb) ||
+            1 == sscanf(line, "Cached: %zu kB", &kb) ||
+            1 == sscanf(line, "SReclaimable: %zu kB", &kb)) {
+            val += kb * 1024;
+        }
     }
 
-    pclose(f);
+    fclose(f);
     return val;
 }
 
-static inline size_t memory_total()
-{
-    return parse_memory_fields(2);
-}
-
-static inline size_t memory_used()
-{
-    return parse_memory_fields(3);
-}
-
 static inline size_t neuron_memory_used()
 {
-    FILE * f       = NULL;
-    char   buf[32] = {};
-    size_t val     = 0;
-    pid_t  pid     = getpid();
+    size_t size = 0, resident = 0;
+    FILE * f    = fopen("/proc/self/statm", "r");
 
-    sprintf(buf, "ps -o rss= %ld", (long) pid);
-
-    f = popen(buf, "r");
     if (NULL == f) {
-        nlog_error("popen command fail");
+        nlog_error("open /proc/self/statm fail");
         return 0;
     }
 
-    if (NULL != fgets(buf, sizeof(buf), f)) {
-        val = atoll(buf);
-    } else {
-        nlog_error("no command output");
+    if (2 != fscanf(f, "%zu %zu", &size, &resident)) {
+        resident = 0;
     }
 
-    pclose(f);
-    return val * 1024;
-}
-
-static inline size_t memory_cache()
-{
-    return parse_memory_fields(6);
+    fclose(f);
+    return resident * sysconf(_SC_PAGESIZE);
 }
 
 static inline int disk_usage(size_t *size_p, size_t *used_p, size_t *avail_p)
@@ -167,19 +201,15 @@ static inline int disk_usage(size_t *size_p, size_t *used_p, size_t *avail_p)
     return 0;
 }
 
-static unsigned cpu_usage()
+// usage since the previous sample, 0 on the first one
+static unsigned cpu_usage(host_stats_t *stats)
 {
-    int                ret   = 0;
-    unsigned long long user1 = 0, nice1 = 0, sys1 = 0, idle1 = 0, iowait1 = 0,
-                       irq1 = 0, softirq1 = 0;
-    unsigned long long user2 = 0, nice2 = 0, sys2 = 0, idle2 = 0, iowait2 = 0,
-                       irq2 = 0, softirq2 = 0;
-    unsigned long long work = 0, total = 0;
-    struct timespec    tv = {
-        .tv_sec  = 0,
-        .tv_nsec = 50000000,
-    };
-    FILE *f = NULL;
+    int                ret  = 0;
+    unsigned long long user = 0, nice = 0, sys = 0, idle = 0, iowait = 0,
+                       irq = 0, softirq = 0;
+    unsigned long long work  = 0, total = 0;
+    unsigned           usage = 0;
+    FILE *             f     = NULL;
 
     f = fopen("/proc/stat", "r");
     if (NULL == f) {
@@ -187,29 +217,23 @@ static unsigned cpu_usage()
         return 0;
     }
 
-    ret = fscanf(f, "cpu %llu %llu %llu %llu %llu %llu %llu", &user1, &nice1,
-                 &sys1, &idle1, &iowait1, &irq1, &softirq1);
+    ret = fscanf(f, "cpu %llu %llu %llu %llu %llu %llu %llu", &user, &nice,
+                 &sys, &idle, &iowait, &irq, &softirq);
+    fclose(f);
     if (7 != ret) {
-        fclose(f);
         return 0;
     }
 
-    nanosleep(&tv, NULL);
+    work  = user + nice + sys;
+    total = work + idle + iowait + irq + softirq;
 
-    rewind(f);
-    ret = fscanf(f, "cpu %llu %llu %llu %llu %llu %llu %llu", &user2, &nice2,
-                 &sys2, &idle2, &iowait2, &irq2, &softirq2);
-    if (7 != ret) {
-        fclose(f);
-        return 0;
+    if (0 != stats->cpu_total && total > stats->cpu_total) {
+        usage = (double) (work - stats->cpu_work) /
+            (total - stats->cpu_total) * 100.0 * sysconf(_SC_NPROCESSORS_CONF);
     }
-    fclose(f);
-
-    work  = (user2 - user1) + (nice2 - nice1) + (sys2 - sys1);
-    total = work + (idle2 - idle1) + (iowait2 - iowait1) + (irq2 - irq1) +
-        (softirq2 - softirq1);
-
-    return (double) work / total * 100.0 * sysconf(_SC_NPROCESSORS_CONF);
+    stats->cpu_work  = work;
+    stats->cpu_total = total;
+    return usage;
 }
 
 static bool has_core_dumps()
@@ -231,6 +255,45 @@ static bool has_core_dumps()
     return found;
 }
 
+static void host_sample(host_stats_t *stats)
+{
+    stats->cpu_percent     = cpu_usage(stats);
+    stats->cpu_cores       = get_nprocs();
+    stats->mem_total_bytes = memory_total();
+    stats->mem_used_bytes  = neuron_memory_used();
+    stats->mem_cache_bytes = memory_cache();
+    disk_usage(&stats->disk_size_gibibytes, &stats->disk_used_gibibytes,
+               &stats->disk_avail_gibibytes);
+    stats->core_dumped = has_core_dumps();
+
+    pthread_rwlock_wrlock(&g_metrics_mtx_);
+    g_metrics_.cpu_percent          = stats->cpu_percent;
+    g_metrics_.cpu_cores            = stats->cpu_cores;
+    g_metrics_.mem_total_bytes      = stats->mem_total_bytes;
+    g_metrics_.mem_used_bytes       = stats->mem_used_bytes;
+    g_metrics_.mem_cache_bytes      = stats->mem_cache_bytes;
+    g_metrics_.disk_size_gibibytes  = stats->disk_size_gibibytes;
+    g_metrics_.disk_used_gibibytes  = stats->disk_used_gibibytes;
+    g_metrics_.disk_avail_gibibytes = stats->disk_avail_gibibytes;
+    g_metrics_.core_dumped          = stats->core_dumped;
+    pthread_rwlock_unlock(&g_metrics_mtx_);
+}
+
+static void *host_sampler(void *arg)
+{
+    host_stats_t *  stats = arg;
+    struct timespec tv    = {
+        .tv_sec  = HOST_SAMPLE_INTERVAL_MS / 1000,
+        .tv_nsec = HOST_SAMPLE_INTERVAL_MS % 1000 * 1000000,
+    };
+
+    while (true) {
+        nanosleep(&tv, NULL);
+        host_sample(stats);
+    }
+    return NULL;
+}
+
 static inline void metrics_unregister_entry(const char *name)
 {
     neu_metric_entry_t *e = NULL;
@@ -264,7 +327,15 @@ int neu_metric_entries_add(neu_metric_entry_t **entries, const char *name,
 
     if (NEU_METRIC_TYPE_ROLLING_COUNTER == type) {
         // only allocate rolling counter for nonzero time span
-        if (init > 0 && NULL == (entry->rcnt = neu_rolling_counter_new(init))) {
+        unsigned span = init & UINT32_MAX;
+        unsigned res  = init >> 32;
+        if (span > 0 &&
+            NULL == (entry->rcnt = neu_rolling_counter_new_res(span, res))) {
+            free(entry);
+            return -1;
+        }
+    } else if (NEU_METRIC_TYPE_HISTOGRAM == type) {
+        if (NULL == (entry->hist = neu_histogram_new())) {
             free(entry);
             return -1;
         }
@@ -281,13 +352,26 @@ int neu_metric_entries_add(neu_metric_entry_t **entries, const char *name,
 
 void neu_metrics_init()
 {
+    static host_stats_t stats = { 0 };
+    pthread_t           tid;
+    bool                first = false;
+
     pthread_rwlock_wrlock(&g_metrics_mtx_);
     if (0 == g_start_ts_) {
         g_start_ts_ = neu_time_ms();
         find_os_info();
-        g_metrics_.mem_total_bytes = memory_total();
+        first = true;
     }
     pthread_rwlock_unlock(&g_metrics_mtx_);
+
+    if (first) {
+        host_sample(&stats);
+        if (0 != pthread_create(&tid, NULL, host_sampler, &stats)) {
+            nlog_error("create host metrics sampler fail");
+            return;
+        }
+        pthread_detach(tid);
+    }
 }
 
 void neu_metrics_add_node(const neu_adapter_t *adapter)
@@ -331,32 +415,220 @@ void neu_metrics_unregister_entry(const char *name)
     pthread_rwlock_unlock(&g_metrics_mtx_);
 }
 
+int neu_metrics_off_parse(const char *s, uint32_t *off)
+{
+    uint32_t all = 0;
+
+    if (strcmp(s, "none") == 0) {
+        *off = 0;
+        return 0;
+    }
+
+    while (true) {
+        const char *end = strchr(s, ',');
+        size_t      len = end != NULL ? (size_t)(end - s) : strlen(s);
+
+        if (len == 7 && strncmp(s, "rolling", len) == 0) {
+            all |= NEU_METRICS_OFF_ROLLING;
+        } else if (len == 9 && strncmp(s, "histogram", len) == 0) {
+            all |= NEU_METRICS_OFF_HISTOGRAM;
+        } else if (len == 5 && strncmp(s, "group", len) == 0) {
+            all |= NEU_METRICS_OFF_GROUP;
+        } else {
+            return -1;
+        }
+
+        if (end == NULL) {
+            break;
+        }
+        s = end + 1;
+    }
+
+    *off = all;
+    return 0;
+}
+
+int neu_metrics_windows_parse(const char *s, uint32_t *windows, int max)
+{
+    int n = 0;
+
+    while (true) {
+        char *end    = NULL;
+        long  window = 0;
+
+        errno  = 0;
+        window = strtol(s, &end, 10);
+        if (0 != errno || end == s || window < 1 || window > 86400 ||
+            (*end != ',' && *end != '\0') || n >= max) {
+            return -1;
+        }
+        windows[n++] = window;
+
+        if (*end == '\0') {
+            break;
+        }
+        s = end + 1;
+    }
+
+    return n;
+}
+
+void neu_metrics_set_off(uint32_t off)
+{
+    neu_metrics_off = (neu_metrics_off & NEU_METRICS_OFF_WINDOWS) |
+        (off & ~NEU_METRICS_OFF_WINDOWS);
+}
+
+void neu_metrics_set_windows(const uint32_t *windows, int n)
+{
+    if (n > NEU_METRICS_WINDOWS_MAX) {
+        n = NEU_METRICS_WINDOWS_MAX;
+    }
+
+    memcpy(g_windows_, windows, n * sizeof(uint32_t));
+    g_n_windows_ = n;
+    if (n > 0) {
+        neu_metrics_off |= NEU_METRICS_OFF_WINDOWS;
+    } else {
+        neu_metrics_off &= ~NEU_METRICS_OFF_WINDOWS;
+    }
+}
+
+bool neu_metrics_window_off(const char *name)
+{
+    unsigned long window = 0;
+
+    // the span is in the name, the update of a rolling counter only has that
+    if (strncmp(name, "last_", 5) != 0) {
+        return false;
+    }
+    for (name += 5; *name >= '0' && *name <= '9'; ++name) {
+        window = window * 10 + (*name - '0');
+    }
+    if (*name != 's') {
+        return false;
+    }
+
+    for (int i = 0; i < g_n_windows_; ++i) {
+        if (g_windows_[i] == window) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void snapshot_entries_free(neu_metric_entry_t **entries)
+{
+    neu_metric_entry_t *e = NULL, *tmp = NULL;
+    HASH_ITER(hh, *entries, e, tmp)
+    {
+        HASH_DEL(*entries, e);
+        neu_histogram_free(e->hist);
+        free(e);
+    }
+}
+
+// plain copies of the entries, rolling counters resolved to their value
+static neu_metric_entry_t *snapshot_entries(neu_metric_entry_t *entries)
+{
+    neu_metric_entry_t *copy = NULL, *e = NULL;
+
+    HASH_LOOP(hh, entries, e)
+    {
+        neu_metric_entry_t *c = calloc(1, sizeof(*c));
+        if (NULL == c) {
+            break;
+        }
+        if (NULL != e->hist) {
+            if (NULL == (c->hist = neu_histogram_new())) {
+                free(c);
+                break;
+            }
+            neu_histogram_copy(c->hist, e->hist);
+        }
+
+        c->name  = e->name;
+        c->help  = e->help;
+        c->type  = e->type;
+        c->value = __atomic_load_n(&e->value, __ATOMIC_RELAXED);
+        if (NEU_METRIC_TYPE_ROLLING_COUNTER == e->type && NULL != e->rcnt) {
+            // the bins of the span as of now, stale ones left out
+            c->value = neu_rolling_counter_value_at(e->rcnt, global_timestamp);
+        }
+        HASH_ADD_STR(copy, name, c);
+    }
+    return copy;
+}
+
+static void snapshot_node_free(neu_node_metrics_t *node)
+{
+    neu_group_metrics_t *g = NULL, *tmp = NULL;
+    HASH_ITER(hh, node->group_metrics, g, tmp)
+    {
+        HASH_DEL(node->group_metrics, g);
+        snapshot_entries_free(&g->entries);
+        free(g->name);
+        free(g);
+    }
+    snapshot_entries_free(&node->entries);
+    free(node->name);
+    free(node);
+}
+
+static neu_node_metrics_t *snapshot_node(neu_node_metrics_t *node)
+{
+    neu_node_metrics_t * copy = calloc(1, sizeof(*copy));
+    neu_group_metrics_t *g    = NULL;
+
+    if (NULL == copy || NULL == (copy->name = strdup(node->name))) {
+        free(copy);
+        return NULL;
+    }
+    copy->type = node->type;
+
+    pthread_mutex_lock(&node->lock);
+    copy->entries = snapshot_entries(node->entries);
+    HASH_LOOP(hh, node->group_metrics, g)
+    {
+        neu_group_metrics_t *c = calloc(1, sizeof(*c));
+        if (NULL == c || NULL == (c->name = strdup(g->name))) {
+            free(c);
+            break;
+        }
+        c->entries = snapshot_entries(g->entries);
+        HASH_ADD_STR(copy->group_metrics, name, c);
+    }
+    pthread_mutex_unlock(&node->lock);
+
+    return copy;
+}
+
+static void snapshot_fini(neu_metrics_t *snapshot)
+{
+    neu_node_metrics_t *n = NULL, *tmp = NULL;
+    HASH_ITER(hh, snapshot->node_metrics, n, tmp)
+    {
+        HASH_DEL(snapshot->node_metrics, n);
+        snapshot_node_free(n);
+    }
+    snapshot_entries_free(&snapshot->registered_metrics);
+}
+
+// the callback formats a copy, so that scrapes do not hold the metrics lock
+// and node locks while writing their output
 void neu_metrics_visist(neu_metrics_cb_t cb, void *data)
 {
-    unsigned cpu       = cpu_usage();
-    size_t   mem_used  = neuron_memory_used();
-    size_t   mem_cache = memory_cache();
-    size_t   disk_size = 0, disk_used = 0, disk_avail = 0;
-    disk_usage(&disk_size, &disk_used, &disk_avail);
-    bool     core_dumped    = has_core_dumps();
-    uint64_t uptime_seconds = (neu_time_ms() - g_start_ts_) / 1000;
+    neu_metrics_t snapshot = { 0 };
+
     pthread_rwlock_rdlock(&g_metrics_mtx_);
-    g_metrics_.cpu_percent          = cpu;
-    g_metrics_.cpu_cores            = get_nprocs();
-    g_metrics_.mem_used_bytes       = mem_used;
-    g_metrics_.mem_cache_bytes      = mem_cache;
-    g_metrics_.disk_size_gibibytes  = disk_size;
-    g_metrics_.disk_used_gibibytes  = disk_used;
-    g_metrics_.disk_avail_gibibytes = disk_avail;
-    g_metrics_.core_dumped          = core_dumped;
-    g_metrics_.uptime_seconds       = uptime_seconds;
-
-    g_metrics_.north_nodes              = 0;
-    g_metrics_.north_running_nodes      = 0;
-    g_metrics_.north_disconnected_nodes = 0;
-    g_metrics_.south_nodes              = 0;
-    g_metrics_.south_running_nodes      = 0;
-    g_metrics_.south_disconnected_nodes = 0;
+    snapshot                     = g_metrics_;
+    snapshot.uptime_seconds      = (neu_time_ms() - g_start_ts_) / 1000;
+    snapshot.mem_budget_bytes    = neu_mem_budget_limit();
+    snapshot.mem_accounted_bytes = neu_mem_budget_used();
+    snapshot.reconnects_deferred = neu_conn_reconnects_deferred();
+    snapshot.log_dropped_lines   = neu_log_async_dropped();
+    snapshot.node_metrics        = NULL;
+    snapshot.registered_metrics  = NULL;
 
     neu_node_metrics_t *n;
     HASH_LOOP(hh, g_metrics_.node_metrics, n)
@@ -368,26 +640,35 @@ void neu_metrics_visist(neu_metrics_cb_t cb, void *data)
                                           n->adapter->state, NULL);
         n->adapter->cb_funs.update_metric(n->adapter, NEU_METRIC_LINK_STATE,
                                           common->link_state, NULL);
+        n->adapter->sample_metrics(n->adapter);
 
         if (NEU_NA_TYPE_DRIVER == n->adapter->module->type) {
-            ++g_metrics_.south_nodes;
+            ++snapshot.south_nodes;
             if (NEU_NODE_RUNNING_STATE_RUNNING == n->adapter->state) {
-                ++g_metrics_.south_running_nodes;
+                ++snapshot.south_running_nodes;
             }
             if (NEU_NODE_LINK_STATE_DISCONNECTED == common->link_state) {
-                ++g_metrics_.south_disconnected_nodes;
+                ++snapshot.south_disconnected_nodes;
             }
         } else if (NEU_NA_TYPE_APP == n->adapter->module->type) {
-            ++g_metrics_.north_nodes;
+            ++snapshot.north_nodes;
             if (NEU_NODE_RUNNING_STATE_RUNNING == n->adapter->state) {
-                ++g_metrics_.north_running_nodes;
+                ++snapshot.north_running_nodes;
             }
             if (NEU_NODE_LINK_STATE_DISCONNECTED == common->link_state) {
-                ++g_metrics_.north_disconnected_nodes;
+                ++snapshot.north_disconnected_nodes;
             }
         }
-    }
 
-    cb(&g_metrics_, data);
+        neu_node_metrics_t *copy = snapshot_node(n);
+        if (NULL != copy) {
+            HASH_ADD_STR(snapshot.node_metrics, name, copy);
+        }
+    }
+    snapshot.registered_metrics =
+        snapshot_entries(g_metrics_.registered_metrics);
     pthread_rwlock_unlock(&g_metrics_mtx_);
+
+    cb(&snapshot, data);
+    snapshot_fini(&snapshot);
 }
@@ -0,0 +1,540 @@
+/**
+ * NEURON IIoT System for Industry 4.0
+ * Copyright (C) 2020-2021 EMQ Technologies Co., Ltd All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ **/
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <nng/nng.h>
+#include <nng/supplemental/http/http.h>
+#include <nng/supplemental/tls/tls.h>
+
+#include "metrics.h"
+#include "utils/log.h"
+#include "utils/snappy.h"
+#include "utils/time.h"
+
+// batches kept while the endpoint is down, the oldest ones are dropped first
+#define PUSH_PENDING_MAX 10
+#define PUSH_TIMEOUT_MS 10000
+#define PUSH_CA_FILE "/etc/ssl/certs/ca-certificates.crt"
+
+// protobuf wire types
+enum {
+    WT_VARINT  = 0,
+    WT_FIXED64 = 1,
+    WT_LEN     = 2,
+};
+
+// fields of the WriteRequest, TimeSeries, Label and Sample messages
+enum {
+    REQUEST_TIMESERIES = 1,
+
+    SERIES_LABELS  = 1,
+    SERIES_SAMPLES = 2,
+
+    LABEL_NAME  = 1,
+    LABEL_VALUE = 2,
+
+    SAMPLE_VALUE     = 1,
+    SAMPLE_TIMESTAMP = 2,
+};
+
+typedef struct {
+    uint8_t *buf;
+    size_t   len;
+    size_t   cap;
+} pb_buf_t;
+
+typedef struct {
+    pb_buf_t req;    // the WriteRequest
+    pb_buf_t series; // one TimeSeries at a time
+    int64_t  timestamp;
+    int      rv;
+} push_ctx_t;
+
+static struct {
+    pthread_t       tid;
+    pthread_mutex_t mtx;
+    pthread_cond_t  cond;
+    bool            running;
+
+    uint32_t         interval; // seconds
+    char             instance[64];
+    nng_url *        url;
+    nng_http_client *client;
+    nng_tls_config * tls;
+    nng_aio *        aio;
+
+    pb_buf_t pending[PUSH_PENDING_MAX]; // compressed, oldest first
+    int      n_pending;
+    uint64_t dropped;
+} push = {
+    .mtx  = PTHREAD_MUTEX_INITIALIZER,
+    .cond = PTHREAD_COND_INITIALIZER,
+};
+
+static int reserve(pb_buf_t *b, size_t n)
+{
+    if (b->len + n <= b->cap) {
+        return 0;
+    }
+
+    size_t cap = b->cap ? b->cap : 4096;
+    while (cap < b->len + n) {
+        cap *= 2;
+    }
+
+    uint8_t *buf = realloc(b->buf, cap);
+    if (NULL == buf) {
+        return -1;
+    }
+    b->buf = buf;
+    b->cap = cap;
+    return 0;
+}
+
+static int put(pb_buf_t *b, const void *data, size_t n)
+{
+    if (reserve(b, n) != 0) {
+        return -1;
+    }
+    memcpy(b->buf + b->len, data, n);
+    b->len += n;
+    return 0;
+}
+
+static inline size_t varint_len(uint64_t v)
+{
+    size_t n = 1;
+
+    while (v > 0x7f) {
+        v >>= 7;
+        ++n;
+    }
+    return n;
+}
+
+static int put_varint(pb_buf_t *b, uint64_t v)
+{
+    uint8_t tmp[10];
+    int     n = 0;
+
+    do {
+        tmp[n++] = (v & 0x7f) | (v > 0x7f ? 0x80 : 0);
+        v >>= 7;
+    } while (v);
+    return put(b, tmp, n);
+}
+
+static inline int put_key(pb_buf_t *b, uint32_t field, int wt)
+{
+    return put_varint(b, (field << 3) | wt);
+}
+
+static int put_len_field(pb_buf_t *b, uint32_t field, const void *data,
+                         size_t n)
+{
+    return put_key(b, field, WT_LEN) || put_varint(b, n) || put(b, data, n);
+}
+
+static int put_label(pb_buf_t *b, const char *name, const char *value)
+{
+    size_t nlen = strlen(name);
+    size_t vlen = strlen(value);
+    size_t len  = 2 + varint_len(nlen) + nlen + varint_len(vlen) + vlen;
+
+    return put_key(b, SERIES_LABELS, WT_LEN) || put_varint(b, len) ||
+        put_len_field(b, LABEL_NAME, name, nlen) ||
+        put_len_field(b, LABEL_VALUE, value, vlen);
+}
+
+static int put_sample(pb_buf_t *b, double value, int64_t timestamp)
+{
+    uint8_t  tmp[8];
+    uint64_t bits = 0;
+
+    memcpy(&bits, &value, sizeof(bits));
+    for (int i = 0; i < 8; i++) {
+        tmp[i] = bits & 0xff; // little endian
+        bits >>= 8;
+    }
+
+    return put_key(b, SERIES_SAMPLES, WT_LEN) ||
+        put_varint(b, 10 + varint_len(timestamp)) ||
+        put_key(b, SAMPLE_VALUE, WT_FIXED64) || put(b, tmp, 8) ||
+        put_key(b, SAMPLE_TIMESTAMP, WT_VARINT) || put_varint(b, timestamp);
+}
+
+// one series with a single sample, labels in the sorted order the remote
+// write protocol expects, node, group and le NULL if not set
+static void put_series(push_ctx_t *ctx, const char *name, const char *suffix,
+                       const char *node, const char *group, const char *le,
+                       double value)
+{
+    char      full[128] = { 0 };
+    pb_buf_t *s         = &ctx->series;
+
+    snprintf(full, sizeof(full), "%s%s", name, suffix);
+    s->len = 0;
+
+    int rv = put_label(s, "__name__", full);
+    if (NULL != group) {
+        rv = rv || put_label(s, "group", group);
+    }
+    rv = rv || put_label(s, "instance", push.instance);
+    if (NULL != le) {
+        rv = rv || put_label(s, "le", le);
+    }
+    if (NULL != node) {
+        rv = rv || put_label(s, "node", node);
+    }
+    rv = rv || put_sample(s, value, ctx->timestamp);
+    rv = rv || put_len_field(&ctx->req, REQUEST_TIMESERIES, s->buf, s->len);
+
+    ctx->rv = ctx->rv || rv;
+}
+
+static void put_entry(push_ctx_t *ctx, const neu_metric_entry_t *e,
+                      const char *node, const char *group)
+{
+    if (NEU_METRIC_TYPE_HISTOGRAM != e->type || NULL == e->hist) {
+        put_series(ctx, e->name, "", node, group, NULL, e->value);
+        return;
+    }
+
+    char     le[24] = { 0 };
+    uint64_t n      = 0;
+    for (int i = 0; i < NEU_HISTOGRAM_BOUNDS; ++i) {
+        n += e->hist->buckets[i];
+        snprintf(le, sizeof(le), "%" PRIu64, neu_histogram_bound(i));
+        put_series(ctx, e->name, "_bucket", node, group, le, n);
+    }
+    put_series(ctx, e->name, "_bucket", node, group, "+Inf", e->hist->count);
+    put_series(ctx, e->name, "_sum", node, group, NULL, e->hist->sum);
+    put_series(ctx, e->name, "_count", node, group, NULL, e->hist->count);
+}
+
+// the same series as the /api/v2/metrics scrape, labelled by the instance
+static void encode_metrics(const neu_metrics_t *metrics, void *data)
+{
+    push_ctx_t *ctx = data;
+
+    struct {
+        const char *name;
+        double      value;
+    } globals[] = {
+        { "cpu_percent", metrics->cpu_percent },
+        { "cpu_cores", metrics->cpu_cores },
+        { "mem_total_bytes", metrics->mem_total_bytes },
+        { "mem_used_bytes", metrics->mem_used_bytes },
+        { "mem_cache_bytes", metrics->mem_cache_bytes },
+        { "disk_size_gibibytes", metrics->disk_size_gibibytes },
+        { "disk_used_gibibytes", metrics->disk_used_gibibytes },
+        { "disk_avail_gibibytes", metrics->disk_avail_gibibytes },
+        { "core_dumped", metrics->core_dumped },
+        { "uptime_seconds", metrics->uptime_seconds },
+        { "license_max_tags", metrics->license_max_tags },
+        { "license_used_tags", metrics->license_used_tags },
+        { "north_nodes_total", metrics->north_nodes },
+        { "north_running_nodes_total", metrics->north_running_nodes },
+        { "north_disconnected_nodes_total",
+          metrics->north_disconnected_nodes },
+        { "south_nodes_total", metrics->south_nodes },
+        { "south_running_nodes_total", metrics->south_running_nodes },
+        { "south_disconnected_nodes_total",
+          metrics->south_disconnected_nodes },
+        { "mem_budget_bytes", metrics->mem_budget_bytes },
+        { "mem_accounted_bytes", metrics->mem_accounted_bytes },
+        { "reconnects_deferred", metrics->reconnects_deferred },
+        { "log_dropped_lines", metrics->log_dropped_lines },
+    };
+
+    for (size_t i = 0; i < sizeof(globals) / sizeof(globals[0]); ++i) {
+        put_series(ctx, globals[i].name, "", NULL, NULL, NULL,
+                   globals[i].value);
+    }
+
+    neu_node_metrics_t *n = NULL;
+    HASH_LOOP(hh, metrics->node_metrics, n)
+    {
+        put_series(ctx, "node_type", "", n->name, NULL, NULL, n->type);
+
+        neu_metric_entry_t *e = NULL;
+        HASH_LOOP(hh, n->entries, e)
+        {
+            put_entry(ctx, e, n->name, NULL);
+        }
+
+        neu_group_metrics_t *g = NULL;
+        HASH_LOOP(hh, n->group_metrics, g)
+        {
+            HASH_LOOP(hh, g->entries, e)
+            {
+                put_entry(ctx, e, n->name, g->name);
+            }
+        }
+    }
+}
+
+// 0 if accepted, 1 if rejected for good, -1 to retry it later
+static int post(const pb_buf_t *batch)
+{
+    nng_http_req *req = NULL;
+    nng_http_res *res = NULL;
+    int           rv  = -1;
+
+    if (0 != nng_http_req_alloc(&req, push.url) ||
+        0 != nng_http_res_alloc(&res)) {
+        nlog_error("metrics push alloc request fail");
+        goto end;
+    }
+
+    nng_http_req_set_method(req, "POST");
+    nng_http_req_set_header(req, "Content-Encoding", "snappy");
+    nng_http_req_set_header(req, "Content-Type", "application/x-protobuf");
+    nng_http_req_set_header(req, "User-Agent", "neuron");
+    nng_http_req_set_header(req, "X-Prometheus-Remote-Write-Version",
+                            "0.1.0");
+    nng_http_req_set_data(req, batch->buf, batch->len);
+
+    nng_aio_set_timeout(push.aio, PUSH_TIMEOUT_MS);
+    nng_http_client_transact(push.client, req, res, push.aio);
+    nng_aio_wait(push.aio);
+
+    int err = nng_aio_result(push.aio);
+    if (0 != err) {
+        nlog_warn("metrics push to %s fail: %s", push.url->u_rawurl,
+                  nng_strerror(err));
+        goto end;
+    }
+
+    uint16_t status = nng_http_res_get_status(res);
+    if (2 == status / 100) {
+        rv = 0;
+    } else if (4 == status / 100 &&
+               NNG_HTTP_STATUS_TOO_MANY_REQUESTS != status) {
+        nlog_warn("metrics push to %s rejected, status: %" PRIu16
+                  ", drop the batch",
+                  push.url->u_rawurl, status);
+        rv = 1;
+    } else {
+        nlog_warn("metrics push to %s fail, status: %" PRIu16,
+                  push.url->u_rawurl, status);
+    }
+
+end:
+    nng_http_res_free(res);
+    nng_http_req_free(req);
+    return rv;
+}
+
+static void collect()
+{
+    push_ctx_t ctx   = { .timestamp = neu_time_ms() };
+    pb_buf_t   batch = { 0 };
+
+    neu_metrics_visist(encode_metrics, &ctx);
+    if (0 != ctx.rv || 0 != reserve(&batch, neu_snappy_max_len(ctx.req.len))) {
+        nlog_error("metrics push encode fail");
+        goto end;
+    }
+    batch.len = neu_snappy_compress(ctx.req.buf, ctx.req.len, batch.buf);
+
+    if (PUSH_PENDING_MAX == push.n_pending) {
+        free(push.pending[0].buf);
+        memmove(&push.pending[0], &push.pending[1],
+                (PUSH_PENDING_MAX - 1) * sizeof(push.pending[0]));
+        --push.n_pending;
+        ++push.dropped;
+        nlog_warn("metrics push drop the oldest batch, dropped: %" PRIu64,
+                  push.dropped);
+    }
+    push.pending[push.n_pending++] = batch;
+    batch.buf                      = NULL;
+
+end:
+    free(batch.buf);
+    free(ctx.series.buf);
+    free(ctx.req.buf);
+}
+
+// in order, the batches after a failure wait for the next round
+static void flush()
+{
+    int i = 0;
+
+    while (i < push.n_pending && post(&push.pending[i]) >= 0) {
+        free(push.pending[i].buf);
+        ++i;
+    }
+
+    push.n_pending -= i;
+    memmove(&push.pending[0], &push.pending[i],
+            push.n_pending * sizeof(push.pending[0]));
+}
+
+static void *push_worker(void *arg)
+{
+    int64_t due = neu_time_ms();
+
+    (void) arg;
+
+    pthread_mutex_lock(&push.mtx);
+    while (push.running) {
+        int64_t now = neu_time_ms();
+        if (now < due) {
+            struct timespec ts = {
+                .tv_sec  = due / 1000,
+                .tv_nsec = (due % 1000) * 1000 * 1000,
+            };
+            pthread_cond_timedwait(&push.cond, &push.mtx, &ts);
+            continue;
+        }
+
+        // a push slower than the interval skips the rounds it overran
+        due += push.interval * 1000;
+        if (due <= now) {
+            due = now + push.interval * 1000;
+        }
+
+        pthread_mutex_unlock(&push.mtx);
+        collect();
+        flush();
+        pthread_mutex_lock(&push.mtx);
+    }
+    pthread_mutex_unlock(&push.mtx);
+
+    return NULL;
+}
+
+static void push_free()
+{
+    for (int i = 0; i < push.n_pending; ++i) {
+        free(push.pending[i].buf);
+    }
+    push.n_pending = 0;
+
+    if (NULL != push.aio) {
+        nng_aio_free(push.aio);
+        push.aio = NULL;
+    }
+    if (NULL != push.client) {
+        nng_http_client_free(push.client);
+        push.client = NULL;
+    }
+    if (NULL != push.tls) {
+        nng_tls_config_free(push.tls);
+        push.tls = NULL;
+    }
+    if (NULL != push.url) {
+        nng_url_free(push.url);
+        push.url = NULL;
+    }
+}
+
+// the server is verified against the system CA bundle when there is one
+static int alloc_tls_config()
+{
+    const char *host = push.url->u_hostname;
+    int         rv   = 0;
+
+    if (0 != (rv = nng_tls_config_alloc(&push.tls, NNG_TLS_MODE_CLIENT)) ||
+        0 != (rv = nng_tls_config_server_name(push.tls, host))) {
+        nlog_error("metrics push tls config fail: %s", nng_strerror(rv));
+        return -1;
+    }
+
+    if (0 == access(PUSH_CA_FILE, R_OK)) {
+        rv = nng_tls_config_auth_mode(push.tls, NNG_TLS_AUTH_MODE_REQUIRED);
+        rv = rv ? rv : nng_tls_config_ca_file(push.tls, PUSH_CA_FILE);
+    } else {
+        nlog_warn("metrics push no %s, the server is not verified",
+                  PUSH_CA_FILE);
+        rv = nng_tls_config_auth_mode(push.tls, NNG_TLS_AUTH_MODE_NONE);
+    }
+    if (0 != rv) {
+        nlog_error("metrics push tls config fail: %s", nng_strerror(rv));
+        return -1;
+    }
+    return 0;
+}
+
+int neu_metrics_push_start(const char *url, uint32_t interval)
+{
+    int rv = 0;
+
+    if (push.running) {
+        return -1;
+    }
+
+    if (0 != (rv = nng_url_parse(&push.url, url))) {
+        nlog_error("metrics push url `%s` invalid: %s", url, nng_strerror(rv));
+        return -1;
+    }
+
+    if (0 == strcmp(push.url->u_scheme, "https") && 0 != alloc_tls_config()) {
+        goto error;
+    }
+
+    if (0 != (rv = nng_http_client_alloc(&push.client, push.url)) ||
+        (NULL != push.tls &&
+         0 != (rv = nng_http_client_set_tls(push.client, push.tls))) ||
+        0 != (rv = nng_aio_alloc(&push.aio, NULL, NULL))) {
+        nlog_error("metrics push client alloc fail: %s", nng_strerror(rv));
+        goto error;
+    }
+
+    if (0 != gethostname(push.instance, sizeof(push.instance) - 1)) {
+        strcpy(push.instance, "neuron");
+    }
+    push.interval = interval;
+    push.running  = true;
+    if (0 != pthread_create(&push.tid, NULL, push_worker, NULL)) {
+        nlog_error("metrics push thread create fail");
+        push.running = false;
+        goto error;
+    }
+
+    nlog_notice("metrics push to %s every %" PRIu32 "s", url, interval);
+    return 0;
+
+error:
+    push_free();
+    return -1;
+}
+
+void neu_metrics_push_stop()
+{
+    pthread_mutex_lock(&push.mtx);
+    if (!push.running) {
+        pthread_mutex_unlock(&push.mtx);
+        return;
+    }
+    push.running = false;
+    pthread_cond_signal(&push.cond);
+    pthread_mutex_unlock(&push.mtx);
+
+    // aborts a push in flight, and the ones of the batches left
+    nng_aio_stop(push.aio);
+    pthread_join(push.tid, NULL);
+    push_free();
+}
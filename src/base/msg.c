@@ -17,14 +17,197 @@
  * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
  **/
 
+#include <pthread.h>
+
 #include "msg.h"
 #include "utils/log.h"
 
 #include "msg_internal.h"
 
+static uint32_t trace_sample = 0;
+
+void neu_trace_set_sample(uint32_t n)
+{
+    trace_sample = n;
+}
+
+uint32_t neu_trace_sample()
+{
+    return trace_sample;
+}
+
 void neu_msg_gen(neu_reqresp_head_t *header, void *data)
 {
     size_t data_size = neu_reqresp_size(header->type);
     assert(header->len >= sizeof(neu_reqresp_head_t) + data_size);
     memcpy((uint8_t *) &header[1], data, data_size);
-}
\ No newline at end of file
+}
+
+// blocks a thread keeps per class, moved to or from the depot in batches
+#define MSG_POOL_CACHE 64
+#define MSG_POOL_BATCH 32
+// blocks the depot keeps per class, the rest go back to malloc
+#define MSG_POOL_DEPOT 1024
+
+// most requests and the trans data fit the first class, writes and the
+// larger responses the second, the last holds any message type
+static const size_t msg_pool_class[] = {
+    384,
+    512,
+    sizeof(neu_msg_t) + NEU_REQRESP_MAX_SIZE,
+};
+#define MSG_POOL_N_CLASS (sizeof(msg_pool_class) / sizeof(msg_pool_class[0]))
+
+// in front of every message, remembers the class it goes back to, sized so
+// that the message keeps the alignment malloc gave the block
+typedef union {
+    uint32_t cls;
+    uint8_t  pad[16];
+} msg_block_t;
+
+typedef struct msg_free {
+    struct msg_free *next;
+} msg_free_t;
+
+typedef struct {
+    msg_free_t *head;
+    uint32_t    n;
+} msg_list_t;
+
+static struct {
+    pthread_mutex_t mtx;
+    msg_list_t      list;
+} msg_depot[MSG_POOL_N_CLASS] = {
+    { .mtx = PTHREAD_MUTEX_INITIALIZER },
+    { .mtx = PTHREAD_MUTEX_INITIALIZER },
+    { .mtx = PTHREAD_MUTEX_INITIALIZER },
+};
+
+static __thread msg_list_t msg_cache[MSG_POOL_N_CLASS];
+static __thread bool       msg_cache_used = false;
+static pthread_key_t       msg_cache_key;
+static pthread_once_t      msg_cache_once = PTHREAD_ONCE_INIT;
+
+static inline void msg_list_push(msg_list_t *list, msg_free_t *f)
+{
+    f->next    = list->head;
+    list->head = f;
+    list->n += 1;
+}
+
+static inline msg_free_t *msg_list_pop(msg_list_t *list)
+{
+    msg_free_t *f = list->head;
+    if (NULL != f) {
+        list->head = f->next;
+        list->n -= 1;
+    }
+    return f;
+}
+
+// move up to n blocks from src to dst, blocks that dst has no room for are
+// released
+static void msg_list_move(msg_list_t *dst, msg_list_t *src, uint32_t n,
+                          uint32_t cap)
+{
+    msg_free_t *f = NULL;
+
+    while (n-- > 0 && NULL != (f = msg_list_pop(src))) {
+        if (dst->n < cap) {
+            msg_list_push(dst, f);
+        } else {
+            free((msg_block_t *) f - 1);
+        }
+    }
+}
+
+// a leaving thread hands its cache to the depot
+static void msg_cache_flush(void *arg)
+{
+    (void) arg;
+    for (uint32_t cls = 0; cls < MSG_POOL_N_CLASS; ++cls) {
+        pthread_mutex_lock(&msg_depot[cls].mtx);
+        msg_list_move(&msg_depot[cls].list, &msg_cache[cls],
+                      msg_cache[cls].n, MSG_POOL_DEPOT);
+        pthread_mutex_unlock(&msg_depot[cls].mtx);
+    }
+}
+
+static void msg_cache_key_init()
+{
+    pthread_key_create(&msg_cache_key, msg_cache_flush);
+}
+
+static inline uint32_t msg_pool_class_of(size_t size)
+{
+#if defined(__SANITIZE_ADDRESS__)
+    // every message straight from malloc so that use after free is caught
+    (void) size;
+    return MSG_POOL_N_CLASS;
+#else
+    uint32_t cls = 0;
+    while (cls < MSG_POOL_N_CLASS && size > msg_pool_class[cls]) {
+        cls += 1;
+    }
+    return cls;
+#endif
+}
+
+void *neu_msg_alloc(size_t size)
+{
+    uint32_t     cls   = msg_pool_class_of(size);
+    msg_block_t *block = NULL;
+
+    if (cls == MSG_POOL_N_CLASS) {
+        block = malloc(sizeof(msg_block_t) + size);
+    } else {
+        msg_list_t *cache = &msg_cache[cls];
+
+        if (0 == cache->n) {
+            pthread_mutex_lock(&msg_depot[cls].mtx);
+            msg_list_move(cache, &msg_depot[cls].list, MSG_POOL_BATCH,
+                          MSG_POOL_CACHE);
+            pthread_mutex_unlock(&msg_depot[cls].mtx);
+        }
+
+        msg_free_t *f = msg_list_pop(cache);
+        block         = NULL != f
+                    ? (msg_block_t *) f - 1
+                    : malloc(sizeof(msg_block_t) + msg_pool_class[cls]);
+    }
+
+    if (NULL == block) {
+        return NULL;
+    }
+
+    block->cls = cls;
+    memset(&block[1], 0, size);
+    return &block[1];
+}
+
+void neu_msg_dealloc(void *p)
+{
+    msg_block_t *block = (msg_block_t *) p - 1;
+    uint32_t     cls   = block->cls;
+
+    if (cls >= MSG_POOL_N_CLASS) {
+        free(block);
+        return;
+    }
+
+    if (!msg_cache_used) {
+        // only a thread that caches needs flushing when it leaves
+        pthread_once(&msg_cache_once, msg_cache_key_init);
+        pthread_setspecific(msg_cache_key, msg_cache);
+        msg_cache_used = true;
+    }
+
+    msg_list_t *cache = &msg_cache[cls];
+    if (cache->n >= MSG_POOL_CACHE) {
+        pthread_mutex_lock(&msg_depot[cls].mtx);
+        msg_list_move(&msg_depot[cls].list, cache, MSG_POOL_BATCH,
+                      MSG_POOL_DEPOT);
+        pthread_mutex_unlock(&msg_depot[cls].mtx);
+    }
+    msg_list_push(cache, (msg_free_t *) &block[1]);
+}
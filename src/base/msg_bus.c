@@ -0,0 +1,319 @@
+/**
+ * NEURON IIoT System for Industry 4.0
+ * Copyright (C) 2020-2023 EMQ Technologies Co., Ltd All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ **/
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include "utils/log.h"
+#include "utils/uthash.h"
+
+#include "msg_bus.h"
+#include "msg_internal.h"
+
+#define RING_MASK (NEU_MSG_BUS_RING_SIZE - 1)
+
+typedef struct {
+    size_t     seq;
+    neu_msg_t *msg;
+    char       src[NEU_MSG_BUS_ADDR_LEN];
+} cell_t;
+
+typedef struct {
+    int  fd;
+    int  efd;
+    char addr[NEU_MSG_BUS_ADDR_LEN];
+    char peer[NEU_MSG_BUS_ADDR_LEN];
+    bool connected;
+
+    size_t head; // shared by producers
+    size_t tail; // owned by the consumer
+    cell_t cells[NEU_MSG_BUS_RING_SIZE];
+
+    UT_hash_handle hh_fd;
+    UT_hash_handle hh_addr;
+} endpoint_t;
+
+static bool             bus_enabled  = false;
+static endpoint_t *     by_fd        = NULL;
+static endpoint_t *     by_addr      = NULL;
+static pthread_rwlock_t registry_lck = PTHREAD_RWLOCK_INITIALIZER;
+
+// only addresses whose tail is zero padded fit into a ring cell, the
+// `\0neuron-xxx` abstract names used by the adapters and the manager do.
+static inline bool addr_to_key(const struct sockaddr_un *addr, char *key)
+{
+    for (size_t i = NEU_MSG_BUS_ADDR_LEN; i < sizeof(addr->sun_path); ++i) {
+        if (addr->sun_path[i] != '\0') {
+            return false;
+        }
+    }
+    memcpy(key, addr->sun_path, NEU_MSG_BUS_ADDR_LEN);
+    return true;
+}
+
+static inline void key_to_addr(const char *key, struct sockaddr_un *addr)
+{
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    memcpy(addr->sun_path, key, NEU_MSG_BUS_ADDR_LEN);
+}
+
+static int ring_push(endpoint_t *ep, const char *src, neu_msg_t *msg)
+{
+    cell_t *cell = NULL;
+    size_t  pos  = __atomic_load_n(&ep->head, __ATOMIC_RELAXED);
+
+    while (true) {
+        cell         = &ep->cells[pos & RING_MASK];
+        size_t   seq = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+        intptr_t dif = (intptr_t) seq - (intptr_t) pos;
+
+        if (dif == 0) {
+            if (__atomic_compare_exchange_n(&ep->head, &pos, pos + 1, true,
+                                            __ATOMIC_RELAXED,
+                                            __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (dif < 0) {
+            return -1;
+        } else {
+            pos = __atomic_load_n(&ep->head, __ATOMIC_RELAXED);
+        }
+    }
+
+    cell->msg = msg;
+    memcpy(cell->src, src, NEU_MSG_BUS_ADDR_LEN);
+    __atomic_store_n(&cell->seq, pos + 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+static int ring_pop(endpoint_t *ep, char *src, neu_msg_t **msg_p)
+{
+    size_t  pos  = ep->tail;
+    cell_t *cell = &ep->cells[pos & RING_MASK];
+    size_t  seq  = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+
+    if ((intptr_t) seq - (intptr_t)(pos + 1) < 0) {
+        return -1;
+    }
+
+    *msg_p = cell->msg;
+    if (NULL != src) {
+        memcpy(src, cell->src, NEU_MSG_BUS_ADDR_LEN);
+    }
+    ep->tail = pos + 1;
+    __atomic_store_n(&cell->seq, pos + NEU_MSG_BUS_RING_SIZE,
+                     __ATOMIC_RELEASE);
+    return 0;
+}
+
+void neu_msg_bus_enable(void)
+{
+    bus_enabled = true;
+    nlog_notice("in-process msg bus enabled, ring size: %d",
+                NEU_MSG_BUS_RING_SIZE);
+}
+
+bool neu_msg_bus_enabled(void)
+{
+    return bus_enabled;
+}
+
+int neu_msg_bus_bind(int fd, const struct sockaddr_un *addr)
+{
+    endpoint_t *ep = NULL;
+
+    if (!bus_enabled) {
+        return -1;
+    }
+
+    ep = calloc(1, sizeof(endpoint_t));
+    if (NULL == ep) {
+        return -1;
+    }
+
+    if (!addr_to_key(addr, ep->addr)) {
+        nlog_warn("msg bus skip fd: %d, address too long", fd);
+        free(ep);
+        return -1;
+    }
+
+    ep->efd = eventfd(0, EFD_NONBLOCK | EFD_SEMAPHORE | EFD_CLOEXEC);
+    if (ep->efd < 0) {
+        nlog_error("msg bus eventfd fail, %s(%d)", strerror(errno), errno);
+        free(ep);
+        return -1;
+    }
+
+    ep->fd = fd;
+    for (size_t i = 0; i < NEU_MSG_BUS_RING_SIZE; ++i) {
+        ep->cells[i].seq = i;
+    }
+
+    pthread_rwlock_wrlock(&registry_lck);
+    HASH_ADD(hh_fd, by_fd, fd, sizeof(int), ep);
+    HASH_ADD(hh_addr, by_addr, addr, NEU_MSG_BUS_ADDR_LEN, ep);
+    pthread_rwlock_unlock(&registry_lck);
+
+    return ep->efd;
+}
+
+void neu_msg_bus_connect(int fd, const struct sockaddr_un *peer)
+{
+    endpoint_t *ep = NULL;
+
+    if (!bus_enabled) {
+        return;
+    }
+
+    pthread_rwlock_wrlock(&registry_lck);
+    HASH_FIND(hh_fd, by_fd, &fd, sizeof(int), ep);
+    if (NULL != ep) {
+        ep->connected = addr_to_key(peer, ep->peer);
+    }
+    pthread_rwlock_unlock(&registry_lck);
+}
+
+void neu_msg_bus_unbind(int fd)
+{
+    endpoint_t *ep  = NULL;
+    neu_msg_t * msg = NULL;
+    int         n   = 0;
+
+    if (!bus_enabled) {
+        return;
+    }
+
+    pthread_rwlock_wrlock(&registry_lck);
+    HASH_FIND(hh_fd, by_fd, &fd, sizeof(int), ep);
+    if (NULL != ep) {
+        HASH_DELETE(hh_fd, by_fd, ep);
+        HASH_DELETE(hh_addr, by_addr, ep);
+    }
+    pthread_rwlock_unlock(&registry_lck);
+
+    if (NULL == ep) {
+        return;
+    }
+
+    while (ring_pop(ep, NULL, &msg) == 0) {
+        neu_msg_free(msg);
+        n += 1;
+    }
+    if (n > 0) {
+        nlog_warn("msg bus fd: %d, drop %d msg", fd, n);
+    }
+
+    close(ep->efd);
+    free(ep);
+}
+
+static int send_to_key(int fd, const char *dst, neu_msg_t *msg)
+{
+    endpoint_t *src_ep = NULL;
+    endpoint_t *dst_ep = NULL;
+    uint64_t    token  = 1;
+    int         ret    = NEU_MSG_BUS_NO_ROUTE;
+
+    pthread_rwlock_rdlock(&registry_lck);
+    HASH_FIND(hh_fd, by_fd, &fd, sizeof(int), src_ep);
+    if (NULL != src_ep) {
+        if (NULL == dst) {
+            dst = src_ep->connected ? src_ep->peer : NULL;
+        }
+        if (NULL != dst) {
+            HASH_FIND(hh_addr, by_addr, dst, NEU_MSG_BUS_ADDR_LEN, dst_ep);
+        }
+    }
+
+    if (NULL != dst_ep) {
+        if (ring_push(dst_ep, src_ep->addr, msg) == 0) {
+            // the token is written after the push, so a reader that consumes
+            // a token always finds a claimed cell to pop
+            if (write(dst_ep->efd, &token, sizeof(token)) != sizeof(token)) {
+                // only on counter overflow, the message stays queued and is
+                // popped along with the next token
+                nlog_error("msg bus wake fd: %d fail, %s(%d)", dst_ep->efd,
+                           strerror(errno), errno);
+            }
+            ret = 0;
+        } else {
+            errno = ENOBUFS;
+            ret   = -1;
+        }
+    }
+    pthread_rwlock_unlock(&registry_lck);
+
+    return ret;
+}
+
+int neu_msg_bus_send(int fd, neu_msg_t *msg)
+{
+    if (!bus_enabled) {
+        return NEU_MSG_BUS_NO_ROUTE;
+    }
+
+    return send_to_key(fd, NULL, msg);
+}
+
+int neu_msg_bus_send_to(int fd, const struct sockaddr_un *addr, neu_msg_t *msg)
+{
+    char key[NEU_MSG_BUS_ADDR_LEN] = { 0 };
+
+    if (!bus_enabled || !addr_to_key(addr, key)) {
+        return NEU_MSG_BUS_NO_ROUTE;
+    }
+
+    return send_to_key(fd, key, msg);
+}
+
+int neu_msg_bus_recv_from(int fd, struct sockaddr_un *addr, neu_msg_t **msg_p)
+{
+    endpoint_t *ep                        = NULL;
+    uint64_t    token                     = 0;
+    char        src[NEU_MSG_BUS_ADDR_LEN] = { 0 };
+    int         ret                       = -1;
+
+    if (!bus_enabled) {
+        return -1;
+    }
+
+    pthread_rwlock_rdlock(&registry_lck);
+    HASH_FIND(hh_fd, by_fd, &fd, sizeof(int), ep);
+    if (NULL != ep && read(ep->efd, &token, sizeof(token)) == sizeof(token)) {
+        // a producer may hold an earlier cell it has claimed but not yet
+        // published, it is never blocked in between so just wait for it
+        while (ring_pop(ep, src, msg_p) != 0) {
+            sched_yield();
+        }
+        if (NULL != addr) {
+            key_to_addr(src, addr);
+        }
+        ret = 0;
+    }
+    pthread_rwlock_unlock(&registry_lck);
+
+    return ret;
+}
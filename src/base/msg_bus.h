@@ -0,0 +1,81 @@
+/**
+ * NEURON IIoT System for Industry 4.0
+ * Copyright (C) 2020-2023 EMQ Technologies Co., Ltd All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ **/
+
+#ifndef NEURON_MSG_BUS_H
+#define NEURON_MSG_BUS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <sys/un.h>
+
+// In-process transport for neu_msg_t pointers.
+//
+// Every bound socket gets a bounded MPSC ring and an eventfd. Sending to an
+// address that owns a ring pushes the message pointer into it instead of
+// calling sendto(), so no kernel socket buffer is involved and ENOBUFS can no
+// longer happen. The eventfd works in semaphore mode and holds one token per
+// queued message, so it can be polled next to the socket fd in the same
+// event loop with the same callback.
+//
+// The bus is disabled by default, in which case every function below is a
+// no-op and the socket path is used untouched.
+
+#define NEU_MSG_BUS_RING_SIZE 1024
+#define NEU_MSG_BUS_ADDR_LEN 32
+
+// returned by neu_msg_bus_send* when the destination is not on the bus
+#define NEU_MSG_BUS_NO_ROUTE 1
+
+struct neu_msg_s;
+
+void neu_msg_bus_enable(void);
+bool neu_msg_bus_enabled(void);
+
+/**
+ * Attach a ring to the socket fd bound to addr.
+ *
+ * @return the eventfd to poll for incoming bus messages, -1 if the bus is
+ *         disabled or the ring could not be created.
+ */
+int  neu_msg_bus_bind(int fd, const struct sockaddr_un *addr);
+void neu_msg_bus_connect(int fd, const struct sockaddr_un *peer);
+void neu_msg_bus_unbind(int fd);
+
+/**
+ * @return 0 on success, NEU_MSG_BUS_NO_ROUTE if the message must go through
+ *         the socket, -1 with errno set to ENOBUFS if the peer ring is full.
+ */
+int neu_msg_bus_send(int fd, struct neu_msg_s *msg);
+int neu_msg_bus_send_to(int fd, const struct sockaddr_un *addr,
+                        struct neu_msg_s *msg);
+
+/**
+ * @return 0 if a bus message was dequeued, -1 if none is pending.
+ */
+int neu_msg_bus_recv_from(int fd, struct sockaddr_un *addr,
+                          struct neu_msg_s **msg_p);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
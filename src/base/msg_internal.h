@@ -29,6 +29,7 @@ extern "C" {
 #include <sys/un.h>
 
 #include "msg.h"
+#include "msg_bus.h"
 
 #define NEU_REQRESP_TYPE_MAP(XX)                                     \
     XX(NEU_RESP_ERROR, neu_resp_error_t)                             \
@@ -48,6 +49,7 @@ extern "C" {
     XX(NEU_REQ_NODE_INIT, neu_req_node_init_t)                       \
     XX(NEU_REQ_NODE_UNINIT, neu_req_node_uninit_t)                   \
     XX(NEU_RESP_NODE_UNINIT, neu_resp_node_uninit_t)                 \
+    XX(NEU_REQ_NODE_RELOAD, neu_req_node_reload_t)                   \
     XX(NEU_REQ_ADD_NODE, neu_req_add_node_t)                         \
     XX(NEU_REQ_UPDATE_NODE, neu_req_update_node_t)                   \
     XX(NEU_REQ_DEL_NODE, neu_req_del_node_t)                         \
@@ -76,11 +78,15 @@ extern "C" {
     XX(NEU_RESP_ADD_TAG, neu_resp_add_tag_t)                         \
     XX(NEU_REQ_ADD_GTAG, neu_req_add_gtag_t)                         \
     XX(NEU_RESP_ADD_GTAG, neu_resp_add_tag_t)                        \
+    XX(NEU_REQ_APPLY_GTAG, neu_req_add_gtag_t)                       \
+    XX(NEU_RESP_APPLY_GTAG, neu_resp_add_tag_t)                      \
     XX(NEU_REQ_DEL_TAG, neu_req_del_tag_t)                           \
     XX(NEU_REQ_UPDATE_TAG, neu_req_update_tag_t)                     \
     XX(NEU_RESP_UPDATE_TAG, neu_resp_update_tag_t)                   \
     XX(NEU_REQ_GET_TAG, neu_req_get_tag_t)                           \
     XX(NEU_RESP_GET_TAG, neu_resp_get_tag_t)                         \
+    XX(NEU_REQ_GET_TAG_HISTORY, neu_req_get_tag_history_t)           \
+    XX(NEU_RESP_GET_TAG_HISTORY, neu_resp_get_tag_history_t)         \
     XX(NEU_REQ_ADD_PLUGIN, neu_req_add_plugin_t)                     \
     XX(NEU_REQ_DEL_PLUGIN, neu_req_del_plugin_t)                     \
     XX(NEU_REQ_UPDATE_PLUGIN, neu_req_update_plugin_t)               \
@@ -91,9 +97,11 @@ extern "C" {
     XX(NEU_REQRESP_NODE_DELETED, neu_reqresp_node_deleted_t)         \
     XX(NEU_REQ_ADD_DRIVERS, neu_req_driver_array_t)                  \
     XX(NEU_REQ_UPDATE_LOG_LEVEL, neu_req_update_log_level_t)         \
+    XX(NEU_REQ_UPDATE_LOG_CAPTURE, neu_req_update_log_capture_t)     \
     XX(NEU_REQ_PRGFILE_UPLOAD, neu_req_prgfile_upload_t)             \
     XX(NEU_REQ_PRGFILE_PROCESS, neu_req_prgfile_process_t)           \
-    XX(NEU_RESP_PRGFILE_PROCESS, neu_resp_prgfile_process_t)
+    XX(NEU_RESP_PRGFILE_PROCESS, neu_resp_prgfile_process_t)         \
+    XX(NEU_REQRESP_TRANS_DATA_BATCH, neu_reqresp_trans_data_batch_t)
 
 static inline size_t neu_reqresp_size(neu_reqresp_type_e t)
 {
@@ -126,6 +134,13 @@ struct neu_msg_s {
 
 typedef struct neu_msg_s neu_msg_t;
 
+// zeroed storage for messages, served from per-thread caches of a few size
+// classes that cover every message type, a thread that frees more than it
+// allocates, like an app freeing what its driver sent, hands the surplus
+// back through a shared depot. Sizes above the largest class are malloced.
+void *neu_msg_alloc(size_t size);
+void  neu_msg_dealloc(void *p);
+
 static inline neu_msg_t *neu_msg_new(neu_reqresp_type_e t, void *ctx,
                                      void *data)
 {
@@ -159,7 +174,7 @@ static inline neu_msg_t *neu_msg_new(neu_reqresp_type_e t, void *ctx,
     }
 
     size_t     total = sizeof(neu_msg_t) + body_size;
-    neu_msg_t *msg   = calloc(1, total);
+    neu_msg_t *msg   = neu_msg_alloc(total);
     if (msg) {
         msg->head.type = t;
         msg->head.len  = total;
@@ -173,7 +188,7 @@ static inline neu_msg_t *neu_msg_new(neu_reqresp_type_e t, void *ctx,
 
 static inline neu_msg_t *neu_msg_copy(const neu_msg_t *other)
 {
-    neu_msg_t *msg = calloc(1, other->head.len);
+    neu_msg_t *msg = neu_msg_alloc(other->head.len);
     if (msg) {
         memcpy(msg, other, other->head.len);
     }
@@ -183,7 +198,7 @@ static inline neu_msg_t *neu_msg_copy(const neu_msg_t *other)
 static inline void neu_msg_free(neu_msg_t *msg)
 {
     if (msg) {
-        free(msg);
+        neu_msg_dealloc(msg);
     }
 }
 
@@ -209,14 +224,23 @@ static inline void *neu_msg_get_body(neu_msg_t *msg)
 
 inline static int neu_send_msg(int fd, neu_msg_t *msg)
 {
-    int ret = send(fd, &msg, sizeof(neu_msg_t *), 0);
+    int ret = neu_msg_bus_send(fd, msg);
+    if (NEU_MSG_BUS_NO_ROUTE != ret) {
+        return ret;
+    }
+
+    ret = send(fd, &msg, sizeof(neu_msg_t *), 0);
     return sizeof(neu_msg_t *) == ret ? 0 : ret;
 }
 
 inline static int neu_recv_msg(int fd, neu_msg_t **msg_p)
 {
     neu_msg_t *msg = NULL;
-    int        ret = recv(fd, &msg, sizeof(neu_msg_t *), 0);
+    if (0 == neu_msg_bus_recv_from(fd, NULL, msg_p)) {
+        return 0;
+    }
+
+    int ret = recv(fd, &msg, sizeof(neu_msg_t *), 0);
     if (sizeof(neu_msg_t *) != ret) {
         // recv may return 0 bytes
         return 0 == ret ? -1 : ret;
@@ -228,8 +252,13 @@ inline static int neu_recv_msg(int fd, neu_msg_t **msg_p)
 inline static int neu_send_msg_to(int fd, struct sockaddr_un *addr,
                                   neu_msg_t *msg)
 {
-    int ret = sendto(fd, &msg, sizeof(neu_msg_t *), 0, (struct sockaddr *) addr,
-                     sizeof(*addr));
+    int ret = neu_msg_bus_send_to(fd, addr, msg);
+    if (NEU_MSG_BUS_NO_ROUTE != ret) {
+        return ret;
+    }
+
+    ret = sendto(fd, &msg, sizeof(neu_msg_t *), 0, (struct sockaddr *) addr,
+                 sizeof(*addr));
     return sizeof(neu_msg_t *) == ret ? 0 : ret;
 }
 
@@ -238,7 +267,11 @@ inline static int neu_recv_msg_from(int fd, struct sockaddr_un *addr,
 {
     neu_msg_t *msg      = NULL;
     socklen_t  addr_len = sizeof(struct sockaddr_un);
-    int        ret      = recvfrom(fd, &msg, sizeof(neu_msg_t *), 0,
+    if (0 == neu_msg_bus_recv_from(fd, addr, msg_p)) {
+        return 0;
+    }
+
+    int ret = recvfrom(fd, &msg, sizeof(neu_msg_t *), 0,
                        (struct sockaddr *) addr, &addr_len);
     if (sizeof(neu_msg_t *) != ret) {
         // recvfrom may return 0 bytes
@@ -18,6 +18,8 @@
  **/
 
 #include <assert.h>
+#include <inttypes.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
@@ -27,6 +29,8 @@
 
 #define NEU_PLUGIN_MAGIC_NUMBER 0x43474d50 // a string "PMGC"
 
+static __thread uint16_t consumer_index = 0;
+
 void neu_plugin_common_init(neu_plugin_common_t *common)
 {
     common->magic      = NEU_PLUGIN_MAGIC_NUMBER;
@@ -47,3 +51,76 @@ int neu_plugin_op(neu_plugin_t *plugin, neu_reqresp_head_t head, void *data)
     return plugin_common->adapter_callbacks->command(plugin_common->adapter,
                                                      head, data);
 }
+
+// the metric and log name of the duration ending at each stage
+static const char *trace_metrics[NEU_TRACE_STAGES] = {
+    [NEU_TRACE_CACHED]  = NEU_METRIC_TRACE_READ_MS,
+    [NEU_TRACE_REPORT]  = NEU_METRIC_TRACE_CACHE_MS,
+    [NEU_TRACE_ENQUEUE] = NEU_METRIC_TRACE_TRANSFER_MS,
+    [NEU_TRACE_DEQUEUE] = NEU_METRIC_TRACE_QUEUE_MS,
+    [NEU_TRACE_ACK]     = NEU_METRIC_TRACE_DELIVER_MS,
+};
+
+static const char *trace_names[NEU_TRACE_STAGES] = {
+    [NEU_TRACE_CACHED]  = "read",
+    [NEU_TRACE_REPORT]  = "cache",
+    [NEU_TRACE_ENQUEUE] = "transfer",
+    [NEU_TRACE_DEQUEUE] = "queue",
+    [NEU_TRACE_ACK]     = "deliver",
+};
+
+void neu_plugin_trace_done(neu_plugin_t *plugin, const neu_trace_t *trace,
+                           const char *driver, const char *group)
+{
+    neu_plugin_common_t *common   = neu_plugin_to_plugin_common(plugin);
+    char                 buf[160] = { 0 };
+    int                  off      = 0;
+    int64_t              first    = 0;
+    int64_t              last     = 0;
+    bool                 hist_off = neu_metric_off(
+        NEU_METRIC_TRACE_TOTAL_MS, NEU_METRIC_TRACE_TOTAL_MS_TYPE, false);
+
+    for (int i = NEU_TRACE_READ; i < NEU_TRACE_STAGES; ++i) {
+        const int64_t *ts = trace->ts;
+
+        if (0 != ts[i]) {
+            first = 0 == first ? ts[i] : first;
+            last  = ts[i];
+        }
+        if (NEU_TRACE_READ == i) {
+            continue;
+        }
+
+        // stages of drivers that do not read by group timers are missing
+        if (0 == ts[i] || 0 == ts[i - 1]) {
+            off += snprintf(buf + off, sizeof(buf) - off, " %s -",
+                            trace_names[i]);
+            continue;
+        }
+
+        int64_t spend = ts[i] > ts[i - 1] ? ts[i] - ts[i - 1] : 0;
+        if (!hist_off) {
+            common->adapter_callbacks->update_metric(
+                common->adapter, trace_metrics[i], spend, NULL);
+        }
+        off += snprintf(buf + off, sizeof(buf) - off, " %s %" PRId64,
+                        trace_names[i], spend);
+    }
+
+    if (!hist_off) {
+        common->adapter_callbacks->update_metric(
+            common->adapter, NEU_METRIC_TRACE_TOTAL_MS, last - first, NULL);
+    }
+    zlog_notice(common->log, "trace %s/%s ms:%s, total %" PRId64, driver,
+                group, buf, last - first);
+}
+
+uint16_t neu_plugin_consumer()
+{
+    return consumer_index;
+}
+
+void neu_plugin_set_consumer(uint16_t index)
+{
+    consumer_index = index;
+}
@@ -18,6 +18,7 @@
 config_ **/
 
 #include <assert.h>
+#include <inttypes.h>
 #include <stdio.h>
 #include <string.h>
 
@@ -25,6 +26,7 @@ config_ **/
 
 #include "errcodes.h"
 #include "tag.h"
+#include "utils/asprintf.h"
 
 #define GET_STATIC_VALUE_PTR(tag, out)                      \
     do {                                                    \
@@ -41,14 +43,16 @@ static void tag_array_copy(void *_dst, const void *_src)
     neu_datatag_t *dst = (neu_datatag_t *) _dst;
     neu_datatag_t *src = (neu_datatag_t *) _src;
 
-    dst->type        = src->type;
-    dst->attribute   = src->attribute;
-    dst->precision   = src->precision;
-    dst->decimal     = src->decimal;
-    dst->option      = src->option;
-    dst->address     = strdup(src->address);
-    dst->name        = strdup(src->name);
-    dst->description = strdup(src->description);
+    dst->type         = src->type;
+    dst->attribute    = src->attribute;
+    dst->precision    = src->precision;
+    dst->decimal      = src->decimal;
+    dst->option       = src->option;
+    dst->deadband     = src->deadband;
+    dst->poll_divisor = src->poll_divisor;
+    dst->address      = strdup(src->address);
+    dst->name         = strdup(src->name);
+    dst->description  = strdup(src->description);
 
     if (NEU_ATTRIBUTE_STATIC & src->attribute) {
         neu_value_u *dst_val = NULL, *src_val = NULL;
@@ -282,40 +286,44 @@ int neu_datatag_parse_addr_option(const neu_datatag_t *      datatag,
     return ret;
 }
 
+// the leading one bits of byte
 static int pre_num(unsigned char byte)
 {
-    unsigned char mask = 0x80;
-    int           num  = 0;
-    for (int i = 0; i < 8; i++) {
-        if ((byte & mask) == mask) {
-            mask = mask >> 1;
-            num++;
-        } else {
-            break;
-        }
-    }
-    return num;
+    return __builtin_clz(((unsigned) (unsigned char) ~byte << 24) | 0xffffff);
 }
 
+#define STRING_WORD_HIGH 0x8080808080808080ULL
+#define STRING_WORD_LOW 0x00ff00ff00ff00ffULL
+
 bool neu_datatag_string_is_utf8(char *data, int len)
 {
     int num = 0;
     int i   = 0;
 
     while (i < len) {
+        // ascii, eight bytes at a time
+        if (len - i >= 8) {
+            uint64_t word = 0;
+
+            memcpy(&word, data + i, sizeof(word));
+            if ((word & STRING_WORD_HIGH) == 0) {
+                i += 8;
+                continue;
+            }
+        }
+
         if ((data[i] & 0x80) == 0x00) {
             // 0XXX_XXXX
             i++;
             continue;
         } else if ((num = pre_num(data[i])) > 2) {
-            // 110X_XXXX 10XX_XXXX
             // 1110_XXXX 10XX_XXXX 10XX_XXXX
             // 1111_0XXX 10XX_XXXX 10XX_XXXX 10XX_XXXX
             // 1111_10XX 10XX_XXXX 10XX_XXXX 10XX_XXXX 10XX_XXXX
             // 1111_110X 10XX_XXXX 10XX_XXXX 10XX_XXXX 10XX_XXXX 10XX_XXXX
             i++;
             for (int j = 0; j < num - 1; j++) {
-                if ((data[i] & 0xc0) != 0x80) {
+                if (i >= len || (data[i] & 0xc0) != 0x80) {
                     return false;
                 }
                 i++;
@@ -329,8 +337,20 @@ bool neu_datatag_string_is_utf8(char *data, int len)
 
 int neu_datatag_string_htol(char *str, int len)
 {
+    int i = 0;
 
-    for (int i = 0; i < len; i += 2) {
+    // swapping the bytes of each 16 bits lane is the same on either host
+    // byte order
+    for (; i + 8 <= len; i += 8) {
+        uint64_t word = 0;
+
+        memcpy(&word, str + i, sizeof(word));
+        word =
+            ((word & STRING_WORD_LOW) << 8) | ((word >> 8) & STRING_WORD_LOW);
+        memcpy(str + i, &word, sizeof(word));
+    }
+
+    for (; i < len; i += 2) {
         char t = str[i];
 
         str[i]     = str[i + 1];
@@ -347,7 +367,19 @@ int neu_datatag_string_ltoh(char *str, int len)
 
 int neu_datatag_string_etod(char *str, int len)
 {
-    for (int i = 0; i < len; i += 2) {
+    int i = 0;
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    for (; i + 8 <= len; i += 8) {
+        uint64_t word = 0;
+
+        memcpy(&word, str + i, sizeof(word));
+        word = (word & STRING_WORD_LOW) << 8;
+        memcpy(str + i, &word, sizeof(word));
+    }
+#endif
+
+    for (; i < len; i += 2) {
         str[i + 1] = str[i];
         str[i]     = 0;
     }
@@ -357,7 +389,19 @@ int neu_datatag_string_etod(char *str, int len)
 
 int neu_datatag_string_dtoe(char *str, int len)
 {
-    for (int i = 0; i < len; i += 2) {
+    int i = 0;
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    for (; i + 8 <= len; i += 8) {
+        uint64_t word = 0;
+
+        memcpy(&word, str + i, sizeof(word));
+        word = (word >> 8) & STRING_WORD_LOW;
+        memcpy(str + i, &word, sizeof(word));
+    }
+#endif
+
+    for (; i < len; i += 2) {
         str[i]     = str[i + 1];
         str[i + 1] = 0;
     }
@@ -734,3 +778,196 @@ int neu_tag_load_static_value(neu_datatag_t *tag, const char *s)
 
     return rv;
 }
+
+char *neu_tag_dump_deadband(const neu_tag_deadband_t *band)
+{
+    char *s = NULL;
+
+    if (!neu_tag_deadband_is_set(band)) {
+        return NULL;
+    }
+
+    if (neu_asprintf(&s, "%.17g,%.17g,%" PRIu32 ",%" PRIu32, band->absolute,
+                     band->percent, band->min_interval,
+                     band->max_interval) < 0) {
+        return NULL;
+    }
+    return s;
+}
+
+int neu_tag_load_deadband(neu_tag_deadband_t *band, const char *s)
+{
+    neu_tag_deadband_t tmp = { 0 };
+
+    memset(band, 0, sizeof(*band));
+    if (NULL == s) {
+        return 0;
+    }
+
+    if (4 !=
+            sscanf(s, "%lf,%lf,%" SCNu32 ",%" SCNu32, &tmp.absolute,
+                   &tmp.percent, &tmp.min_interval, &tmp.max_interval) ||
+        tmp.absolute < 0 || tmp.percent < 0) {
+        return -1;
+    }
+
+    *band = tmp;
+    return 0;
+}
+
+// bytes taken by a value of `type`, 0 for a string, -1 if not packable
+static int static_value_width(neu_type_e type)
+{
+    switch (type) {
+    case NEU_TYPE_BIT:
+    case NEU_TYPE_BOOL:
+    case NEU_TYPE_INT8:
+    case NEU_TYPE_UINT8:
+        return 1;
+    case NEU_TYPE_INT16:
+    case NEU_TYPE_UINT16:
+    case NEU_TYPE_WORD:
+        return 2;
+    case NEU_TYPE_INT32:
+    case NEU_TYPE_UINT32:
+    case NEU_TYPE_DWORD:
+    case NEU_TYPE_FLOAT:
+        return 4;
+    case NEU_TYPE_INT64:
+    case NEU_TYPE_UINT64:
+    case NEU_TYPE_LWORD:
+    case NEU_TYPE_DOUBLE:
+        return 8;
+    case NEU_TYPE_STRING:
+        return 0;
+    default:
+        return -1;
+    }
+}
+
+size_t neu_tag_pack_static_value(const neu_datatag_t *tag, uint8_t *buf)
+{
+    neu_value_u value = { 0 };
+    uint64_t    bits  = 0;
+    int         width = static_value_width(tag->type);
+
+    if (width < 0 || 0 != neu_tag_get_static_value(tag, &value)) {
+        return 0;
+    }
+
+    buf[0] = tag->type;
+    switch (width) {
+    case 0: {
+        size_t len = strnlen(value.str, sizeof(value.str) - 1);
+        memcpy(&buf[1], value.str, len);
+        return 1 + len;
+    }
+    case 1:
+        bits = value.u8;
+        break;
+    case 2:
+        bits = value.u16;
+        break;
+    case 4:
+        bits = value.u32;
+        break;
+    default:
+        bits = value.u64;
+        break;
+    }
+
+    for (int i = 0; i < width; ++i) {
+        buf[1 + i] = (uint8_t)(bits >> (8 * i));
+    }
+
+    return 1 + width;
+}
+
+int neu_tag_unpack_static_value(neu_datatag_t *tag, const void *data,
+                                size_t len)
+{
+    const uint8_t *p     = data;
+    neu_value_u    value = { 0 };
+    uint64_t       bits  = 0;
+    int            width = static_value_width(tag->type);
+
+    if (!neu_tag_attribute_test(tag, NEU_ATTRIBUTE_STATIC) || NULL == p ||
+        width < 0 || len < 1 || p[0] != tag->type) {
+        return -1;
+    }
+
+    if (0 == width) {
+        if (len - 1 >= sizeof(value.str)) {
+            return -1;
+        }
+        memcpy(value.str, &p[1], len - 1);
+        return neu_tag_set_static_value(tag, &value);
+    }
+
+    if (len != (size_t) 1 + width) {
+        return -1;
+    }
+
+    for (int i = 0; i < width; ++i) {
+        bits |= (uint64_t) p[1 + i] << (8 * i);
+    }
+
+    switch (width) {
+    case 1:
+        value.u8 = bits;
+        break;
+    case 2:
+        value.u16 = bits;
+        break;
+    case 4:
+        value.u32 = bits;
+        break;
+    default:
+        value.u64 = bits;
+        break;
+    }
+
+    return neu_tag_set_static_value(tag, &value);
+}
+
+// never 0, so that tags with zeroed meta bytes are not compiled
+static uint32_t tag_compiled_stamp(const neu_datatag_t *tag)
+{
+    uint32_t h = 2166136261u;
+    for (const char *p = tag->address; p && *p; ++p) {
+        h = (h ^ (uint8_t) *p) * 16777619u;
+    }
+    h ^= ((uint32_t) tag->type << 24) ^ (uint32_t) tag->attribute;
+    return h | 1;
+}
+
+void neu_tag_set_compiled(neu_datatag_t *tag, const void *data, size_t len)
+{
+    uint32_t stamp = tag_compiled_stamp(tag);
+
+    if (NEU_ATTRIBUTE_STATIC & tag->attribute ||
+        len > NEU_TAG_COMPILED_LENGTH) {
+        return;
+    }
+
+    memcpy(tag->meta, &stamp, sizeof(stamp));
+    memcpy(tag->meta + sizeof(stamp), data, len);
+}
+
+bool neu_tag_get_compiled(const neu_datatag_t *tag, void *data, size_t len)
+{
+    uint32_t stamp = 0;
+
+    if (NEU_ATTRIBUTE_STATIC & tag->attribute ||
+        len > NEU_TAG_COMPILED_LENGTH) {
+        return false;
+    }
+
+    memcpy(&stamp, tag->meta, sizeof(stamp));
+    if (stamp != tag_compiled_stamp(tag)) {
+        return false;
+    }
+
+    memcpy(data, tag->meta + sizeof(stamp), len);
+    return true;
+}
@@ -20,25 +20,39 @@
 
 #include "tag_sort.h"
 
-static neu_tag_sort_elem_t *array_to_list(UT_array *tags);
-static void                 tag_sort(neu_tag_sort_result_t *result, void *tag,
-                                     neu_tag_sort_fn fn, UT_icd icd);
+typedef struct {
+    neu_tag_sort_elem_t elem;
+    size_t              index;
+} sort_item_t;
+
+static __thread neu_tag_sort_cmp item_cmp_fn = NULL;
+
+static int  item_cmp(const void *a, const void *b);
+static void result_add(neu_tag_sort_result_t *result, void *tag,
+                       neu_tag_sort_fn fn, const UT_icd *icd,
+                       uint32_t *capacity);
 
 neu_tag_sort_result_t *neu_tag_sort(UT_array *tags, neu_tag_sort_fn sort,
                                     neu_tag_sort_cmp cmp)
 {
-    neu_tag_sort_result_t *result = calloc(1, sizeof(neu_tag_sort_result_t));
-    neu_tag_sort_elem_t *  elt = NULL, *tmp = NULL;
-    neu_tag_sort_elem_t *  head = array_to_list(tags);
-
-    DL_SORT(head, cmp);
-    DL_FOREACH_SAFE(head, elt, tmp)
-    {
-        tag_sort(result, elt->tag, sort, tags->icd);
-        DL_DELETE(head, elt);
-        free(elt);
+    neu_tag_sort_result_t *result   = calloc(1, sizeof(neu_tag_sort_result_t));
+    size_t                 n_tag    = utarray_len(tags);
+    sort_item_t *          items    = calloc(n_tag, sizeof(sort_item_t));
+    uint32_t               capacity = 0;
+
+    for (size_t i = 0; i < n_tag; i++) {
+        items[i].elem.tag = *(void **) utarray_eltptr(tags, i);
+        items[i].index    = i;
     }
 
+    item_cmp_fn = cmp;
+    qsort(items, n_tag, sizeof(sort_item_t), item_cmp);
+
+    for (size_t i = 0; i < n_tag; i++) {
+        result_add(result, items[i].elem.tag, sort, &tags->icd, &capacity);
+    }
+
+    free(items);
     return result;
 }
 
@@ -52,46 +66,48 @@ void neu_tag_sort_free(neu_tag_sort_result_t *result)
     free(result);
 }
 
-static neu_tag_sort_elem_t *array_to_list(UT_array *tags)
+// keep equal tags in their original order, as the list merge sort did
+static int item_cmp(const void *a, const void *b)
 {
-    neu_tag_sort_elem_t *head = NULL, *tmp = NULL;
+    sort_item_t *item1 = (sort_item_t *) a;
+    sort_item_t *item2 = (sort_item_t *) b;
+    int          ret   = item_cmp_fn(&item1->elem, &item2->elem);
 
-    for (void **tag = utarray_front(tags); tag != NULL;
-         tag        = utarray_next(tags, tag)) {
-        tmp      = calloc(1, sizeof(neu_tag_sort_elem_t));
-        tmp->tag = *tag;
-        DL_APPEND(head, tmp);
+    if (ret == 0) {
+        ret = item1->index < item2->index ? -1 : 1;
     }
 
-    return head;
+    return ret;
 }
 
-static void tag_sort(neu_tag_sort_result_t *result, void *tag,
-                     neu_tag_sort_fn fn, UT_icd icd)
+// the tags arrive in order, so a tag either joins the bucket of the previous
+// tag or starts a new one
+static void result_add(neu_tag_sort_result_t *result, void *tag,
+                       neu_tag_sort_fn fn, const UT_icd *icd,
+                       uint32_t *capacity)
 {
-    bool sorted = false;
+    neu_tag_sort_t *last = NULL;
 
-    for (uint16_t i = 0; i < result->n_sort; i++) {
-        if (fn(&result->sorts[i],
-               *(void **) utarray_back(result->sorts[i].tags), tag)) {
-            utarray_push_back(result->sorts[i].tags, &tag);
-            result->sorts[i].info.size += 1;
-            sorted = true;
-            break;
+    if (result->n_sort > 0) {
+        last = &result->sorts[result->n_sort - 1];
+        if (fn(last, *(void **) utarray_back(last->tags), tag)) {
+            utarray_push_back(last->tags, &tag);
+            last->info.size += 1;
+            return;
         }
     }
 
-    if (!sorted) {
-        result->n_sort += 1;
+    if (result->n_sort == *capacity) {
+        *capacity = *capacity == 0 ? 8 : *capacity * 2;
         result->sorts =
-            realloc(result->sorts, sizeof(neu_tag_sort_t) * result->n_sort);
-
-        memset(&result->sorts[result->n_sort - 1], 0, sizeof(neu_tag_sort_t));
-        utarray_new(result->sorts[result->n_sort - 1].tags, &icd);
-        utarray_push_back(result->sorts[result->n_sort - 1].tags, &tag);
-        result->sorts[result->n_sort - 1].info.size = 1;
-        fn(&result->sorts[result->n_sort - 1],
-           *(void **) utarray_back(result->sorts[result->n_sort - 1].tags),
-           tag);
+            realloc(result->sorts, sizeof(neu_tag_sort_t) * *capacity);
     }
-}
\ No newline at end of file
+
+    result->n_sort += 1;
+    last = &result->sorts[result->n_sort - 1];
+    memset(last, 0, sizeof(neu_tag_sort_t));
+    utarray_new(last->tags, icd);
+    utarray_push_back(last->tags, &tag);
+    last->info.size = 1;
+    fn(last, *(void **) utarray_back(last->tags), tag);
+}
@@ -0,0 +1,619 @@
+/**
+ * NEURON IIoT System for Industry 4.0
+ * Copyright (C) 2020-2022 EMQ Technologies Co., Ltd All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ **/
+
+#include <inttypes.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "core/manager.h"
+#include "errcodes.h"
+#include "msg.h"
+#include "persist/persist.h"
+#include "plugin.h"
+#include "utils/log.h"
+#include "utils/profile.h"
+#include "utils/time.h"
+
+#include "bench.h"
+#include "version.h"
+
+#define BENCH_DRIVER_PLUGIN "Bench Driver"
+#define BENCH_APP_PLUGIN "Bench App"
+#define BENCH_DRIVER_PREFIX "bench-driver-"
+#define BENCH_APP_PREFIX "bench-app-"
+
+// seconds the nodes run before the measurement starts
+#define BENCH_WARMUP_S 2
+// latencies are counted per ms up to BENCH_HIST_MS, longer ones in the last
+#define BENCH_HIST_MS 1000
+
+// the stages a trace is split into, and the whole path
+typedef enum {
+    BENCH_READ,
+    BENCH_CACHE,
+    BENCH_TRANSFER,
+    BENCH_QUEUE,
+    BENCH_DELIVER,
+    BENCH_TOTAL,
+    BENCH_STAGES,
+} bench_stage_e;
+
+static const char *stage_names[BENCH_STAGES] = {
+    [BENCH_READ]     = "read",
+    [BENCH_CACHE]    = "cache",
+    [BENCH_TRANSFER] = "transfer",
+    [BENCH_QUEUE]    = "queue",
+    [BENCH_DELIVER]  = "deliver",
+    [BENCH_TOTAL]    = "total",
+};
+
+// updated by the nodes of the bench, zeroed when the measurement starts
+static struct {
+    uint64_t reads;    // group reads of the drivers
+    uint64_t messages; // trans data handed to the apps
+    uint64_t tags;     // tag values handed to the apps
+    uint64_t hist[BENCH_STAGES][BENCH_HIST_MS + 1];
+    uint64_t max[BENCH_STAGES];
+} stats;
+
+struct neu_plugin {
+    neu_plugin_common_t common;
+};
+
+static neu_plugin_t *bench_open(void)
+{
+    neu_plugin_t *plugin = calloc(1, sizeof(neu_plugin_t));
+
+    neu_plugin_common_init(&plugin->common);
+    return plugin;
+}
+
+static int bench_close(neu_plugin_t *plugin)
+{
+    free(plugin);
+    return 0;
+}
+
+static int bench_init(neu_plugin_t *plugin, bool load)
+{
+    (void) plugin;
+    (void) load;
+    return 0;
+}
+
+static int bench_uninit(neu_plugin_t *plugin)
+{
+    (void) plugin;
+    return 0;
+}
+
+static int bench_start(neu_plugin_t *plugin)
+{
+    plugin->common.link_state = NEU_NODE_LINK_STATE_CONNECTED;
+    return 0;
+}
+
+static int bench_stop(neu_plugin_t *plugin)
+{
+    plugin->common.link_state = NEU_NODE_LINK_STATE_DISCONNECTED;
+    return 0;
+}
+
+static int bench_setting(neu_plugin_t *plugin, const char *setting)
+{
+    (void) plugin;
+    (void) setting;
+    return 0;
+}
+
+static int driver_request(neu_plugin_t *plugin, neu_reqresp_head_t *head,
+                          void *data)
+{
+    (void) plugin;
+    (void) head;
+    (void) data;
+    return 0;
+}
+
+static int driver_validate_tag(neu_plugin_t *plugin, neu_datatag_t *tag)
+{
+    (void) plugin;
+    (void) tag;
+    return 0;
+}
+
+// every tag changes on every read, so that all of them are reported
+static int driver_group_timer(neu_plugin_t *plugin, neu_plugin_group_t *group)
+{
+    neu_plugin_columns_t *c = group->columns;
+
+    (void) plugin;
+    for (uint32_t i = 0; i < c->n_tag; ++i) {
+        c->values[i].type      = NEU_TYPE_INT32;
+        c->values[i].value.i32 = (int32_t)(group->cycle + i);
+        c->values[i].precision = 0;
+        c->filled[i]           = 1;
+    }
+    __atomic_fetch_add(&stats.reads, 1, __ATOMIC_RELAXED);
+    return 0;
+}
+
+static int driver_write_tag(neu_plugin_t *plugin, void *req,
+                            neu_datatag_t *tag, neu_value_u value)
+{
+    (void) tag;
+    (void) value;
+    plugin->common.adapter_callbacks->driver.write_response(
+        plugin->common.adapter, req, NEU_ERR_PLUGIN_TAG_NOT_ALLOW_WRITE);
+    return 0;
+}
+
+static int driver_write_tags(neu_plugin_t *plugin, void *req,
+                             UT_array *tag_values)
+{
+    (void) tag_values;
+    plugin->common.adapter_callbacks->driver.write_response(
+        plugin->common.adapter, req, NEU_ERR_PLUGIN_TAG_NOT_ALLOW_WRITE);
+    return 0;
+}
+
+static void observe(bench_stage_e stage, int64_t from, int64_t to)
+{
+    uint64_t ms   = to > from ? (uint64_t)(to - from) : 0;
+    uint64_t slot = ms < BENCH_HIST_MS ? ms : BENCH_HIST_MS;
+    uint64_t max  = __atomic_load_n(&stats.max[stage], __ATOMIC_RELAXED);
+
+    __atomic_fetch_add(&stats.hist[stage][slot], 1, __ATOMIC_RELAXED);
+    while (ms > max &&
+           !__atomic_compare_exchange_n(&stats.max[stage], &max, ms, true,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+// the stages of the trace in the order of neu_trace_stage_e
+static void observe_trace(const neu_trace_t *trace)
+{
+    const int64_t *ts = trace->ts;
+
+    observe(BENCH_READ, ts[NEU_TRACE_READ], ts[NEU_TRACE_CACHED]);
+    observe(BENCH_CACHE, ts[NEU_TRACE_CACHED], ts[NEU_TRACE_REPORT]);
+    observe(BENCH_TRANSFER, ts[NEU_TRACE_REPORT], ts[NEU_TRACE_ENQUEUE]);
+    observe(BENCH_QUEUE, ts[NEU_TRACE_ENQUEUE], ts[NEU_TRACE_DEQUEUE]);
+    observe(BENCH_DELIVER, ts[NEU_TRACE_DEQUEUE], ts[NEU_TRACE_ACK]);
+    observe(BENCH_TOTAL, ts[NEU_TRACE_READ], ts[NEU_TRACE_ACK]);
+}
+
+static int app_request(neu_plugin_t *plugin, neu_reqresp_head_t *head,
+                       void *data)
+{
+    (void) plugin;
+
+    switch (head->type) {
+    case NEU_REQRESP_TRANS_DATA: {
+        neu_reqresp_trans_data_t *trans = data;
+
+        __atomic_fetch_add(&stats.messages, 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&stats.tags, utarray_len(trans->tags),
+                           __ATOMIC_RELAXED);
+        if (neu_trace_sampled(&trans->trace)) {
+            neu_trace_stamp(&trans->trace, NEU_TRACE_ACK);
+            observe_trace(&trans->trace);
+        }
+        break;
+    }
+    case NEU_REQ_SUBSCRIBE_GROUP:
+    case NEU_REQ_UPDATE_SUBSCRIBE_GROUP: {
+        neu_req_subscribe_t *sub = data;
+        free(sub->params);
+        break;
+    }
+    default:
+        break;
+    }
+
+    return 0;
+}
+
+static const neu_plugin_intf_funs_t driver_intf_funs = {
+    .open    = bench_open,
+    .close   = bench_close,
+    .init    = bench_init,
+    .uninit  = bench_uninit,
+    .start   = bench_start,
+    .stop    = bench_stop,
+    .setting = bench_setting,
+    .request = driver_request,
+
+    .driver.validate_tag = driver_validate_tag,
+    .driver.group_timer  = driver_group_timer,
+    .driver.write_tag    = driver_write_tag,
+    .driver.write_tags   = driver_write_tags,
+};
+
+static const neu_plugin_intf_funs_t app_intf_funs = {
+    .open    = bench_open,
+    .close   = bench_close,
+    .init    = bench_init,
+    .uninit  = bench_uninit,
+    .start   = bench_start,
+    .stop    = bench_stop,
+    .setting = bench_setting,
+    .request = app_request,
+};
+
+static const neu_plugin_module_t bench_driver_module = {
+    .version         = NEURON_PLUGIN_VER_1_0,
+    .schema          = "bench-driver",
+    .module_name     = BENCH_DRIVER_PLUGIN,
+    .module_descr    = "Synthetic driver of the self benchmark",
+    .module_descr_zh = "自测基准的模拟南向插件",
+    .intf_funs       = &driver_intf_funs,
+    .kind            = NEU_PLUGIN_KIND_SYSTEM,
+    .type            = NEU_NA_TYPE_DRIVER,
+    .display         = false,
+    .single          = false,
+    .columns         = true,
+};
+
+// finishes the traces by itself, without a log line for each, and counts
+// with atomics, so it runs on as many consumers as --app_consumers asks for
+static const neu_plugin_module_t bench_app_module = {
+    .version               = NEURON_PLUGIN_VER_1_0,
+    .schema                = "bench-app",
+    .module_name           = BENCH_APP_PLUGIN,
+    .module_descr          = "Synthetic app of the self benchmark",
+    .module_descr_zh       = "自测基准的模拟北向插件",
+    .intf_funs             = &app_intf_funs,
+    .kind                  = NEU_PLUGIN_KIND_SYSTEM,
+    .type                  = NEU_NA_TYPE_APP,
+    .display               = false,
+    .single                = false,
+    .trace_ack             = true,
+    .concurrent_trans_data = true,
+};
+
+static int parse_key(const char *key, size_t len, uint32_t value,
+                     neu_bench_conf_t *conf)
+{
+    static const struct {
+        const char *key;
+        size_t      offset;
+        uint32_t    min;
+        uint32_t    max;
+    } keys[] = {
+        { "drivers", offsetof(neu_bench_conf_t, drivers), 1, 64 },
+        { "groups", offsetof(neu_bench_conf_t, groups), 1, 64 },
+        { "tags", offsetof(neu_bench_conf_t, tags), 1, 100000 },
+        { "interval", offsetof(neu_bench_conf_t, interval), 10, 3600000 },
+        { "apps", offsetof(neu_bench_conf_t, apps), 1, 64 },
+        { "seconds", offsetof(neu_bench_conf_t, seconds), 1, 3600 },
+    };
+
+    for (size_t i = 0; i < sizeof(keys) / sizeof(keys[0]); ++i) {
+        if (strlen(keys[i].key) != len || strncmp(keys[i].key, key, len)) {
+            continue;
+        }
+        if (value < keys[i].min || value > keys[i].max) {
+            return -1;
+        }
+        *(uint32_t *) ((char *) conf + keys[i].offset) = value;
+        return 0;
+    }
+    return -1;
+}
+
+int neu_bench_parse(const char *spec, neu_bench_conf_t *conf)
+{
+    conf->drivers  = 1;
+    conf->groups   = 1;
+    conf->tags     = 1000;
+    conf->interval = 100;
+    conf->apps     = 1;
+    conf->seconds  = 10;
+
+    for (const char *s = spec; NULL != s && '\0' != *s;) {
+        const char *eq  = strchr(s, '=');
+        char *      end = NULL;
+
+        if (NULL == eq || eq == s || eq[1] < '0' || eq[1] > '9') {
+            return -1;
+        }
+        unsigned long value = strtoul(eq + 1, &end, 10);
+        if (('\0' != *end && ',' != *end) || value > UINT32_MAX ||
+            0 != parse_key(s, eq - s, (uint32_t) value, conf)) {
+            return -1;
+        }
+        s = ',' == *end ? end + 1 : end;
+    }
+
+    return 0;
+}
+
+typedef struct {
+    char name[32];
+    char address[16];
+} tag_name_t;
+
+static int setup_driver(const neu_bench_conf_t *conf, const char *name)
+{
+    neu_datatag_t *         tags  = calloc(conf->tags, sizeof(neu_datatag_t));
+    tag_name_t *            names = calloc(conf->tags, sizeof(tag_name_t));
+    char                    group[NEU_GROUP_NAME_LEN] = { 0 };
+    neu_persist_node_info_t node                      = {
+        .name        = (char *) name,
+        .type        = NEU_NA_TYPE_DRIVER,
+        .plugin_name = BENCH_DRIVER_PLUGIN,
+        .state       = NEU_NODE_RUNNING_STATE_RUNNING,
+    };
+    int rv = -1;
+
+    if (NULL == tags || NULL == names) {
+        goto end;
+    }
+    for (uint32_t i = 0; i < conf->tags; ++i) {
+        snprintf(names[i].name, sizeof(names[i].name), "tag-%" PRIu32, i);
+        snprintf(names[i].address, sizeof(names[i].address), "%" PRIu32, i);
+        tags[i].name        = names[i].name;
+        tags[i].address     = names[i].address;
+        tags[i].description = "";
+        tags[i].attribute   = NEU_ATTRIBUTE_READ;
+        tags[i].type        = NEU_TYPE_INT32;
+    }
+
+    if (0 != neu_persister_store_node(&node) ||
+        0 != neu_persister_store_node_setting(name, "{}")) {
+        goto end;
+    }
+    for (uint32_t g = 0; g < conf->groups; ++g) {
+        neu_persist_group_info_t info = {
+            .interval = conf->interval,
+            .name     = group,
+        };
+
+        snprintf(group, sizeof(group), "group-%" PRIu32, g);
+        if (0 != neu_persister_store_group(name, &info) ||
+            0 != neu_persister_store_tags(name, group, tags, conf->tags)) {
+            goto end;
+        }
+    }
+    rv = 0;
+
+end:
+    free(tags);
+    free(names);
+    return rv;
+}
+
+static int setup_app(const neu_bench_conf_t *conf, const char *name)
+{
+    char                    driver[NEU_NODE_NAME_LEN] = { 0 };
+    char                    group[NEU_GROUP_NAME_LEN] = { 0 };
+    neu_persist_node_info_t node                      = {
+        .name        = (char *) name,
+        .type        = NEU_NA_TYPE_APP,
+        .plugin_name = BENCH_APP_PLUGIN,
+        .state       = NEU_NODE_RUNNING_STATE_RUNNING,
+    };
+
+    if (0 != neu_persister_store_node(&node) ||
+        0 != neu_persister_store_node_setting(name, "{}")) {
+        return -1;
+    }
+    for (uint32_t d = 0; d < conf->drivers; ++d) {
+        snprintf(driver, sizeof(driver), BENCH_DRIVER_PREFIX "%" PRIu32, d);
+        for (uint32_t g = 0; g < conf->groups; ++g) {
+            snprintf(group, sizeof(group), "group-%" PRIu32, g);
+            if (0 !=
+                neu_persister_store_subscription(name, driver, group, NULL)) {
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+int neu_bench_setup(const neu_bench_conf_t *conf, const char *schema_dir)
+{
+    char name[NEU_NODE_NAME_LEN] = { 0 };
+
+    if (0 != neu_persister_create_memory(schema_dir)) {
+        nlog_error("bench persister create fail");
+        return -1;
+    }
+
+    for (uint32_t d = 0; d < conf->drivers; ++d) {
+        snprintf(name, sizeof(name), BENCH_DRIVER_PREFIX "%" PRIu32, d);
+        if (0 != setup_driver(conf, name)) {
+            nlog_error("bench setup of driver %s fail", name);
+            return -1;
+        }
+    }
+    for (uint32_t a = 0; a < conf->apps; ++a) {
+        snprintf(name, sizeof(name), BENCH_APP_PREFIX "%" PRIu32, a);
+        if (0 != setup_app(conf, name)) {
+            nlog_error("bench setup of app %s fail", name);
+            return -1;
+        }
+    }
+
+    neu_manager_add_builtin_plugin(&bench_driver_module);
+    neu_manager_add_builtin_plugin(&bench_app_module);
+    nlog_notice("bench setup, drivers: %" PRIu32 ", groups: %" PRIu32
+                ", tags: %" PRIu32 ", interval: %" PRIu32 ", apps: %" PRIu32,
+                conf->drivers, conf->groups, conf->tags, conf->interval,
+                conf->apps);
+    return 0;
+}
+
+typedef enum {
+    CPU_DRIVER_READ,
+    CPU_DRIVER_ADAPTER,
+    CPU_APP_ADAPTER,
+    CPU_APP_CONSUMER,
+    CPU_MANAGER,
+    CPU_EVENT_WORKERS,
+    CPU_OTHER,
+    CPU_STAGES,
+} cpu_stage_e;
+
+static const char *cpu_names[CPU_STAGES] = {
+    [CPU_DRIVER_READ]    = "driver read",
+    [CPU_DRIVER_ADAPTER] = "driver adapter",
+    [CPU_APP_ADAPTER]    = "app adapter",
+    [CPU_APP_CONSUMER]   = "app consumer",
+    [CPU_MANAGER]        = "manager",
+    [CPU_EVENT_WORKERS]  = "event workers",
+    [CPU_OTHER]          = "other",
+};
+
+static bool has_prefix(const char *s, const char *prefix)
+{
+    return 0 == strncmp(s, prefix, strlen(prefix));
+}
+
+static cpu_stage_e cpu_stage(const neu_profile_thread_t *t)
+{
+    if (has_prefix(t->node, BENCH_DRIVER_PREFIX)) {
+        return 0 == strcmp(t->role, "adapter") ? CPU_DRIVER_ADAPTER
+                                               : CPU_DRIVER_READ;
+    }
+    if (has_prefix(t->node, BENCH_APP_PREFIX)) {
+        return 0 == strcmp(t->role, "consumer") ? CPU_APP_CONSUMER
+                                                : CPU_APP_ADAPTER;
+    }
+    if (0 == strcmp(t->node, "neuron")) {
+        if (0 == strcmp(t->role, "manager")) {
+            return CPU_MANAGER;
+        }
+        if (has_prefix(t->role, "event worker")) {
+            return CPU_EVENT_WORKERS;
+        }
+    }
+    return CPU_OTHER;
+}
+
+// cpu ms of the labelled threads per stage, the unlabelled ones go to other
+static int cpu_snapshot(uint64_t cpu[CPU_STAGES])
+{
+    neu_profile_thread_t *threads = NULL;
+    int                   n       = 0;
+    uint64_t              total   = 0;
+    uint64_t              sum     = 0;
+
+    if (0 != neu_profile_threads(&threads, &n, &total)) {
+        return -1;
+    }
+    memset(cpu, 0, sizeof(uint64_t) * CPU_STAGES);
+    for (int i = 0; i < n; ++i) {
+        cpu[cpu_stage(&threads[i])] += threads[i].cpu_ms;
+    }
+    for (int i = 0; i < CPU_OTHER; ++i) {
+        sum += cpu[i];
+    }
+    cpu[CPU_OTHER] = total > sum ? total - sum : 0;
+    free(threads);
+    return 0;
+}
+
+static uint64_t percentile(const uint64_t *hist, uint64_t n, double p)
+{
+    uint64_t rank = (uint64_t)(n * p);
+    uint64_t seen = 0;
+
+    for (uint64_t ms = 0; ms <= BENCH_HIST_MS; ++ms) {
+        seen += hist[ms];
+        if (seen > rank) {
+            return ms;
+        }
+    }
+    return BENCH_HIST_MS;
+}
+
+static void report(const neu_bench_conf_t *conf, int64_t ms,
+                   const uint64_t cpu_from[CPU_STAGES],
+                   const uint64_t cpu_to[CPU_STAGES])
+{
+    double   s     = ms / 1000.0;
+    uint64_t total = 0;
+
+    printf("neuron bench %s: %" PRIu32 " driver(s) x %" PRIu32
+           " group(s) x %" PRIu32 " tag(s) every %" PRIu32
+           " ms, %" PRIu32 " app(s), %.1f s\n",
+           NEURON_VERSION, conf->drivers, conf->groups, conf->tags,
+           conf->interval, conf->apps, s);
+    printf("throughput: %.0f tag values/s, %.0f messages/s, %.0f group "
+           "reads/s\n",
+           stats.tags / s, stats.messages / s, stats.reads / s);
+
+    printf("%-16s %8s %8s %8s %8s\n", "latency ms", "p50", "p90", "p99",
+           "max");
+    for (int i = 0; i < BENCH_STAGES; ++i) {
+        uint64_t n = 0;
+
+        for (int ms = 0; ms <= BENCH_HIST_MS; ++ms) {
+            n += stats.hist[i][ms];
+        }
+        printf("  %-14s %8" PRIu64 " %8" PRIu64 " %8" PRIu64 " %8" PRIu64
+               "\n",
+               stage_names[i], percentile(stats.hist[i], n, 0.5),
+               percentile(stats.hist[i], n, 0.9),
+               percentile(stats.hist[i], n, 0.99), stats.max[i]);
+    }
+
+    printf("%-16s %8s %8s\n", "cpu", "ms", "% core");
+    for (int i = 0; i < CPU_STAGES; ++i) {
+        uint64_t spent = cpu_to[i] > cpu_from[i] ? cpu_to[i] - cpu_from[i] : 0;
+
+        total += spent;
+        printf("  %-14s %8" PRIu64 " %8.1f\n", cpu_names[i], spent,
+               spent * 100.0 / ms);
+    }
+    printf("  %-14s %8" PRIu64 " %8.1f\n", "process", total,
+           total * 100.0 / ms);
+    fflush(stdout);
+}
+
+int neu_bench_run(const neu_bench_conf_t *conf)
+{
+    uint64_t cpu_from[CPU_STAGES] = { 0 };
+    uint64_t cpu_to[CPU_STAGES]   = { 0 };
+
+    sleep(BENCH_WARMUP_S);
+
+    // the counters are reset while the nodes run, a few updates of the first
+    // and last ms may fall on either side
+    memset(&stats, 0, sizeof(stats));
+    int64_t from = neu_time_ms();
+    if (0 != cpu_snapshot(cpu_from)) {
+        return -1;
+    }
+
+    sleep(conf->seconds);
+
+    int64_t to = neu_time_ms();
+    if (0 != cpu_snapshot(cpu_to)) {
+        return -1;
+    }
+
+    report(conf, to > from ? to - from : 1, cpu_from, cpu_to);
+    return 0;
+}
@@ -0,0 +1,60 @@
+/**
+ * NEURON IIoT System for Industry 4.0
+ * Copyright (C) 2020-2022 EMQ Technologies Co., Ltd All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ **/
+
+#ifndef NEURON_BENCH_H
+#define NEURON_BENCH_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    uint32_t drivers;  // synthetic driver nodes
+    uint32_t groups;   // groups of each driver
+    uint32_t tags;     // tags of each group
+    uint32_t interval; // ms between two reads of a group
+    uint32_t apps;     // app nodes, each subscribes every group
+    uint32_t seconds;  // length of the measurement
+} neu_bench_conf_t;
+
+/** Parse a comma separated list of key=value, any of drivers, groups, tags,
+ * interval, apps and seconds. Keys left out keep their defaults, NULL or an
+ * empty spec is all defaults.
+ * @return 0 on success, -1 on an unknown key or a value out of range.
+ */
+int neu_bench_parse(const char *spec, neu_bench_conf_t *conf);
+
+/** Create the persister on a database in memory holding the nodes, groups,
+ * tags and subscriptions of the bench, and add the synthetic plugins, before
+ * the manager is created and loads them.
+ */
+int neu_bench_setup(const neu_bench_conf_t *conf, const char *schema_dir);
+
+/** Let the bench warm up, measure it for conf->seconds and print throughput,
+ * latency per stage and cpu per stage to the stdout. Blocks until done.
+ */
+int neu_bench_run(const neu_bench_conf_t *conf);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
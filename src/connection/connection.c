@@ -17,31 +17,111 @@
  * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
  **/
 
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
 #include <arpa/inet.h>
 #include <assert.h>
 #include <errno.h>
+#include <poll.h>
 #include <pthread.h>
 #include <stdbool.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
 #include <sys/time.h>
+#include <sys/uio.h>
 
 #include <fcntl.h>
+#include <linux/serial.h>
+#include <netinet/tcp.h>
 #include <termios.h>
 
 #include "utils/log.h"
+#include "utils/uthash.h"
+#include "utils/utlist.h"
 
 #include "connection/neu_connection.h"
+#ifdef NEU_SMART_LINK
+#include "connection/neu_smart_link.h"
+#endif
 
 #ifndef CMSPAR
 #define CMSPAR 010000000000 /* mark or space (stick) parity */
 #endif
 
+// max bytes queued by neu_conn_sendv while the fd is not writable
+#define NEU_CONN_ASYNC_QUEUE_MAX (64 * 1024)
+
+// the back-off of a tcp client doubles from the min to the max ms
+#define NEU_CONN_BACKOFF_MIN_MS 250
+#define NEU_CONN_BACKOFF_MAX_MS 8000
+
+// the least silence ending a tty frame, as the uart driver hands the bytes
+// over in bursts: about a ms in low latency mode, up to 16 ms without it
+#define NEU_CONN_TTY_END_MIN_US 2000
+#define NEU_CONN_TTY_END_SLOW_US 20000
+
 struct tcp_client {
     int                fd;
     struct sockaddr_in client;
 };
 
+// a caller of neu_conn_acquire_prio waiting for its turn
+struct conn_waiter {
+    neu_conn_prio_e     prio;
+    int64_t             deadline;
+    uint64_t            seq;
+    struct conn_waiter *next;
+};
+
+struct conn_user {
+    void *            data;
+    neu_conn_callback connected;
+    neu_conn_callback disconnected;
+    struct conn_user *next;
+};
+
+// the connection of one endpoint, shared by the nodes polling it
+struct conn_share {
+    char *            key;
+    neu_conn_t *      conn;
+    int               n_user;
+    int               n_stop;
+    struct conn_user *users;
+    UT_hash_handle    hh;
+};
+
+static pthread_mutex_t    share_mtx = PTHREAD_MUTEX_INITIALIZER;
+static struct conn_share *shares    = NULL;
+
+// all the connections, for a new process to take their fds over
+static pthread_mutex_t conns_mtx = PTHREAD_MUTEX_INITIALIZER;
+static neu_conn_t *    conns     = NULL;
+
+// an fd received from the previous process, not taken by a connection yet
+struct conn_handover {
+    char           key[NEU_CONN_HANDOVER_KEY_LEN];
+    int            fd;
+    UT_hash_handle hh;
+};
+
+static pthread_mutex_t       handover_mtx = PTHREAD_MUTEX_INITIALIZER;
+static struct conn_handover *handovers    = NULL;
+
+// tokens for the tcp client connects of all the connections, so that the
+// drivers of a recovered network do not all dial at once
+static struct {
+    pthread_mutex_t mtx;
+    uint32_t        rate; // per second, 0 for no limit
+    double          tokens;
+    int64_t         at_us; // of the last refill
+    uint64_t        deferred;
+} reconnect = { .mtx = PTHREAD_MUTEX_INITIALIZER };
+
 struct neu_conn {
     neu_conn_param_t param;
     void *           data;
@@ -69,6 +149,47 @@ struct neu_conn {
     uint8_t *buf;
     uint16_t buf_size;
     uint16_t offset;
+
+    struct {
+        neu_events_t *             events;
+        neu_event_io_t *           io;
+        void *                     context;
+        neu_conn_stream_consume_fn consume;
+        neu_conn_callback          drained;
+        bool                       want_write;
+
+        uint8_t *out;
+        size_t   out_len;
+        size_t   out_cap;
+    } async;
+
+    struct conn_share *share;
+    neu_conn_t *       prev;
+    neu_conn_t *       next;
+    // transactions on the connection run one at a time, the most urgent first
+    pthread_mutex_t     turn_mtx;
+    pthread_cond_t      turn_cond;
+    bool                turn_busy;
+    uint64_t            turn_seq;
+    struct conn_waiter *waiters;
+
+    // a tty line stays silent for 3.5 chars between two frames, a frame
+    // received ends once the line stayed silent for end_us
+    struct {
+        int64_t char_us;
+        int64_t gap_us;
+        int64_t end_us;
+        int64_t idle_at;
+        int64_t timeout_us;
+    } tty;
+
+    // tcp client connects failed or lost in a row, and the time the next
+    // may be tried at
+    struct {
+        uint32_t fails;
+        int64_t  retry_at;
+        unsigned seed;
+    } backoff;
 };
 
 static void conn_tcp_server_add_client(neu_conn_t *conn, int fd,
@@ -85,6 +206,25 @@ static void conn_disconnect(neu_conn_t *conn);
 
 static void conn_free_param(neu_conn_t *conn);
 static void conn_init_param(neu_conn_t *conn, neu_conn_param_t *param);
+static void conn_tcp_opt(neu_conn_t *conn, int fd);
+
+static bool conn_handover_key(neu_conn_param_t *param, char *key, size_t len);
+static int  conn_handover_take(neu_conn_t *conn);
+
+static int64_t conn_now_us(void);
+static bool    conn_reconnect_take(int64_t now);
+static void    conn_backoff(neu_conn_t *conn, int64_t now);
+static void    conn_tty_frame_gap(neu_conn_t *conn);
+static void    conn_tty_wait_idle(neu_conn_t *conn);
+static void    conn_tty_low_latency(neu_conn_t *conn, int fd);
+static ssize_t conn_tty_read(neu_conn_t *conn, uint8_t *buf, ssize_t len);
+
+#ifdef NEU_SMART_LINK
+static void conn_tty_watch(neu_conn_t *conn);
+#endif
+static void conn_async_watch(neu_conn_t *conn);
+static void conn_async_unwatch(neu_conn_t *conn);
+static int  conn_async_io(enum neu_event_io_type type, int fd, void *usr_data);
 
 neu_conn_t *neu_conn_new(neu_conn_param_t *param, void *data,
                          neu_conn_callback connected,
@@ -104,15 +244,236 @@ neu_conn_t *neu_conn_new(neu_conn_param_t *param, void *data,
     conn->offset   = 0;
     conn->stop     = false;
 
+    conn->backoff.seed = (unsigned) (uintptr_t) conn ^ (unsigned) conn_now_us();
+
     conn_tcp_server_listen(conn);
 
     pthread_mutex_init(&conn->mtx, NULL);
+    pthread_mutex_init(&conn->turn_mtx, NULL);
+    pthread_cond_init(&conn->turn_cond, NULL);
+
+    pthread_mutex_lock(&conns_mtx);
+    DL_APPEND(conns, conn);
+    pthread_mutex_unlock(&conns_mtx);
+
+#ifdef NEU_SMART_LINK
+    conn_tty_watch(conn);
+#endif
 
     return conn;
 }
 
+static void share_connected(void *data, int fd)
+{
+    struct conn_share *share = (struct conn_share *) data;
+    struct conn_user * user  = NULL;
+
+    pthread_mutex_lock(&share_mtx);
+    LL_FOREACH(share->users, user)
+    {
+        user->connected(user->data, fd);
+    }
+    pthread_mutex_unlock(&share_mtx);
+}
+
+static void share_disconnected(void *data, int fd)
+{
+    struct conn_share *share = (struct conn_share *) data;
+    struct conn_user * user  = NULL;
+
+    pthread_mutex_lock(&share_mtx);
+    LL_FOREACH(share->users, user)
+    {
+        user->disconnected(user->data, fd);
+    }
+    pthread_mutex_unlock(&share_mtx);
+}
+
+static bool tty_same_line(const neu_conn_param_t *a,
+                          const neu_conn_param_t *b)
+{
+    return a->params.tty_client.baud == b->params.tty_client.baud &&
+        a->params.tty_client.data == b->params.tty_client.data &&
+        a->params.tty_client.parity == b->params.tty_client.parity &&
+        a->params.tty_client.stop == b->params.tty_client.stop;
+}
+
+neu_conn_t *neu_conn_share(neu_conn_param_t *param, void *data,
+                           neu_conn_callback connected,
+                           neu_conn_callback disconnected)
+{
+    struct conn_share *share    = NULL;
+    struct conn_user * user     = NULL;
+    char               key[128] = { 0 };
+    bool               trigger  = false;
+
+    switch (param->type) {
+    case NEU_CONN_TCP_CLIENT:
+        snprintf(key, sizeof(key), "%s:%hu", param->params.tcp_client.ip,
+                 param->params.tcp_client.port);
+        break;
+    case NEU_CONN_TTY_CLIENT:
+        // the nodes of one rs-485 line, the serial port has a single owner
+        snprintf(key, sizeof(key), "%s", param->params.tty_client.device);
+        break;
+    default:
+        return neu_conn_new(param, data, connected, disconnected);
+    }
+
+    user               = calloc(1, sizeof(struct conn_user));
+    user->data         = data;
+    user->connected    = connected;
+    user->disconnected = disconnected;
+
+    pthread_mutex_lock(&share_mtx);
+    HASH_FIND_STR(shares, key, share);
+    if (share == NULL) {
+        share      = calloc(1, sizeof(struct conn_share));
+        share->key = strdup(key);
+        share->conn =
+            neu_conn_new(param, share, share_connected, share_disconnected);
+        share->conn->share = share;
+        HASH_ADD_STR(shares, key, share);
+        zlog_notice(param->log, "new shared connection: %s", key);
+    } else if (param->type == NEU_CONN_TTY_CLIENT &&
+               !tty_same_line(&share->conn->param, param)) {
+        zlog_warn(param->log,
+                  "shared tty %s keeps the line settings of its first node",
+                  key);
+    }
+
+    LL_PREPEND(share->users, user);
+    share->n_user += 1;
+    pthread_mutex_unlock(&share_mtx);
+
+    zlog_notice(param->log, "share connection: %s, users: %d", key,
+                share->n_user);
+
+    // the connection may be up already, the node would never learn it
+    pthread_mutex_lock(&share->conn->mtx);
+    trigger = share->conn->callback_trigger;
+    pthread_mutex_unlock(&share->conn->mtx);
+    if (trigger) {
+        connected(data, neu_conn_fd(share->conn));
+    }
+
+    return share->conn;
+}
+
+void neu_conn_unshare(neu_conn_t *conn, void *data)
+{
+    struct conn_share *share = conn->share;
+    struct conn_user * user  = NULL;
+    struct conn_user * tmp   = NULL;
+    bool               last  = false;
+
+    if (share == NULL) {
+        neu_conn_destory(conn);
+        return;
+    }
+
+    pthread_mutex_lock(&share_mtx);
+    LL_FOREACH_SAFE(share->users, user, tmp)
+    {
+        if (user->data == data) {
+            LL_DELETE(share->users, user);
+            free(user);
+            share->n_user -= 1;
+            break;
+        }
+    }
+
+    if (share->n_stop > share->n_user) {
+        share->n_stop = share->n_user;
+    }
+
+    last = share->n_user == 0;
+    if (last) {
+        HASH_DEL(shares, share);
+    }
+    pthread_mutex_unlock(&share_mtx);
+
+    if (last) {
+        zlog_notice(conn->param.log, "close shared connection: %s",
+                    share->key);
+        neu_conn_destory(conn);
+        free(share->key);
+        free(share);
+    }
+}
+
+static bool waiter_before(const struct conn_waiter *a,
+                          const struct conn_waiter *b)
+{
+    if (a->prio != b->prio) {
+        return a->prio < b->prio;
+    }
+    if (a->deadline != b->deadline) {
+        return a->deadline < b->deadline;
+    }
+    return a->seq < b->seq;
+}
+
+void neu_conn_acquire_prio(neu_conn_t *conn, neu_conn_prio_e prio,
+                           int64_t deadline)
+{
+    struct conn_waiter  waiter = {
+        .prio     = prio,
+        .deadline = deadline > 0 ? deadline : INT64_MAX,
+    };
+    struct conn_waiter **pos   = NULL;
+
+    pthread_mutex_lock(&conn->turn_mtx);
+    waiter.seq = conn->turn_seq++;
+
+    // the queue is kept sorted, the head is the next to go
+    pos = &conn->waiters;
+    while (*pos != NULL && waiter_before(*pos, &waiter)) {
+        pos = &(*pos)->next;
+    }
+    waiter.next = *pos;
+    *pos        = &waiter;
+
+    while (conn->turn_busy || conn->waiters != &waiter) {
+        pthread_cond_wait(&conn->turn_cond, &conn->turn_mtx);
+    }
+
+    conn->waiters   = waiter.next;
+    conn->turn_busy = true;
+    pthread_mutex_unlock(&conn->turn_mtx);
+}
+
+void neu_conn_acquire(neu_conn_t *conn)
+{
+    neu_conn_acquire_prio(conn, NEU_CONN_PRIO_NORMAL, 0);
+}
+
+void neu_conn_release(neu_conn_t *conn)
+{
+    pthread_mutex_lock(&conn->turn_mtx);
+    conn->turn_busy = false;
+    pthread_cond_broadcast(&conn->turn_cond);
+    pthread_mutex_unlock(&conn->turn_mtx);
+}
+
 void neu_conn_stop(neu_conn_t *conn)
 {
+    if (conn->share != NULL) {
+        bool all = false;
+
+        pthread_mutex_lock(&share_mtx);
+        if (conn->share->n_stop < conn->share->n_user) {
+            conn->share->n_stop += 1;
+        }
+        all = conn->share->n_stop == conn->share->n_user;
+        pthread_mutex_unlock(&share_mtx);
+
+        // still polled by other nodes
+        if (!all) {
+            return;
+        }
+    }
+
     pthread_mutex_lock(&conn->mtx);
     if (conn->tcp_server.is_listen) {
         conn_tcp_server_stop(conn);
@@ -124,6 +485,14 @@ void neu_conn_stop(neu_conn_t *conn)
 
 void neu_conn_start(neu_conn_t *conn)
 {
+    if (conn->share != NULL) {
+        pthread_mutex_lock(&share_mtx);
+        if (conn->share->n_stop > 0) {
+            conn->share->n_stop -= 1;
+        }
+        pthread_mutex_unlock(&share_mtx);
+    }
+
     pthread_mutex_lock(&conn->mtx);
     conn->stop = false;
     pthread_mutex_unlock(&conn->mtx);
@@ -131,6 +500,10 @@ void neu_conn_start(neu_conn_t *conn)
 
 neu_conn_t *neu_conn_reconfig(neu_conn_t *conn, neu_conn_param_t *param)
 {
+#ifdef NEU_SMART_LINK
+    neu_conn_smart_link_unwatch(conn);
+#endif
+
     pthread_mutex_lock(&conn->mtx);
 
     conn_disconnect(conn);
@@ -145,11 +518,23 @@ neu_conn_t *neu_conn_reconfig(neu_conn_t *conn, neu_conn_param_t *param)
 
     pthread_mutex_unlock(&conn->mtx);
 
+#ifdef NEU_SMART_LINK
+    conn_tty_watch(conn);
+#endif
+
     return conn;
 }
 
 void neu_conn_destory(neu_conn_t *conn)
 {
+#ifdef NEU_SMART_LINK
+    neu_conn_smart_link_unwatch(conn);
+#endif
+
+    pthread_mutex_lock(&conns_mtx);
+    DL_DELETE(conns, conn);
+    pthread_mutex_unlock(&conns_mtx);
+
     pthread_mutex_lock(&conn->mtx);
 
     conn_tcp_server_stop(conn);
@@ -159,7 +544,10 @@ void neu_conn_destory(neu_conn_t *conn)
     pthread_mutex_unlock(&conn->mtx);
 
     pthread_mutex_destroy(&conn->mtx);
+    pthread_mutex_destroy(&conn->turn_mtx);
+    pthread_cond_destroy(&conn->turn_cond);
 
+    free(conn->async.out);
     free(conn->buf);
     free(conn);
 }
@@ -198,6 +586,7 @@ int neu_conn_tcp_server_accept(neu_conn_t *conn)
         setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
         setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
     }
+    conn_tcp_opt(conn, fd);
 
     if (conn->tcp_server.n_client >= conn->param.params.tcp_server.max_link) {
         int free_fd = conn_tcp_server_replace_client(conn, fd, client);
@@ -308,6 +697,61 @@ ssize_t neu_conn_tcp_server_recv(neu_conn_t *conn, int fd, uint8_t *buf,
     return ret;
 }
 
+ssize_t neu_conn_tcp_server_recv_pending(neu_conn_t *conn, int fd,
+                                         uint8_t *buf, ssize_t len)
+{
+    ssize_t ret = -1;
+
+    pthread_mutex_lock(&conn->mtx);
+    if (conn->stop) {
+        pthread_mutex_unlock(&conn->mtx);
+        return ret;
+    }
+
+    ret = recv(fd, buf, len, MSG_DONTWAIT);
+    if (ret > 0) {
+        conn->state.recv_bytes += ret;
+    } else if (ret < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+        zlog_error(conn->param.log, "conn fd: %d, recv error, errno: %s(%d)",
+                   fd, strerror(errno), errno);
+        ret = 0;
+    }
+
+    pthread_mutex_unlock(&conn->mtx);
+
+    return ret;
+}
+
+void neu_conn_set_timeout(neu_conn_t *conn, int fd, uint16_t timeout)
+{
+    struct timeval tv = {
+        .tv_sec  = timeout / 1000,
+        .tv_usec = (timeout % 1000) * 1000,
+    };
+
+    pthread_mutex_lock(&conn->mtx);
+    switch (conn->param.type) {
+    case NEU_CONN_TCP_SERVER:
+        if (fd > 0) {
+            setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        }
+        break;
+    case NEU_CONN_TCP_CLIENT:
+    case NEU_CONN_UDP:
+    case NEU_CONN_UDP_TO:
+        if (conn->is_connected) {
+            setsockopt(conn->fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        }
+        break;
+    case NEU_CONN_TTY_CLIENT:
+        if (conn->is_connected) {
+            conn->tty.timeout_us = (int64_t) timeout * 1000;
+        }
+        break;
+    }
+    pthread_mutex_unlock(&conn->mtx);
+}
+
 ssize_t neu_conn_send(neu_conn_t *conn, uint8_t *buf, ssize_t len)
 {
     ssize_t ret = 0;
@@ -324,6 +768,11 @@ ssize_t neu_conn_send(neu_conn_t *conn, uint8_t *buf, ssize_t len)
 
     if (conn->is_connected) {
         int retry = 0;
+
+        if (conn->param.type == NEU_CONN_TTY_CLIENT) {
+            conn_tty_wait_idle(conn);
+        }
+
         while (ret < len) {
             int rc = 0;
 
@@ -343,6 +792,10 @@ ssize_t neu_conn_send(neu_conn_t *conn, uint8_t *buf, ssize_t len)
                 break;
             case NEU_CONN_TTY_CLIENT:
                 rc = write(conn->fd, buf + ret, len - ret);
+                if (rc > 0) {
+                    // the frame ends once the uart shifted it out
+                    conn->tty.idle_at = conn_now_us() + rc * conn->tty.char_us;
+                }
                 break;
             }
 
@@ -398,6 +851,7 @@ ssize_t neu_conn_send(neu_conn_t *conn, uint8_t *buf, ssize_t len)
     if (ret > 0) {
         conn->state.send_bytes += ret;
         conn->connection_ok = true;
+        conn->backoff.fails = 0;
     }
 
     pthread_mutex_unlock(&conn->mtx);
@@ -432,15 +886,9 @@ ssize_t neu_conn_recv(neu_conn_t *conn, uint8_t *buf, ssize_t len)
         ret = recv(conn->fd, buf, len, 0);
         break;
     case NEU_CONN_TTY_CLIENT:
-        ret = read(conn->fd, buf, len);
-        while (ret > 0 && ret < len) {
-            ssize_t rv = read(conn->fd, buf + ret, len - ret);
-            if (rv <= 0) {
-                ret = rv;
-                break;
-            }
-
-            ret += rv;
+        ret = conn_tty_read(conn, buf, len);
+        if (ret > 0) {
+            conn->tty.idle_at = conn_now_us();
         }
         break;
     }
@@ -608,6 +1056,226 @@ void neu_conn_disconnect(neu_conn_t *conn)
     pthread_mutex_unlock(&conn->mtx);
 }
 
+int neu_conn_async_start(neu_conn_t *conn, neu_events_t *events,
+                         void *context, neu_conn_stream_consume_fn consume,
+                         neu_conn_callback drained)
+{
+    if (conn->param.type != NEU_CONN_TCP_CLIENT &&
+        conn->param.type != NEU_CONN_TTY_CLIENT) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&conn->mtx);
+    if (conn->async.events != NULL) {
+        pthread_mutex_unlock(&conn->mtx);
+        return -1;
+    }
+
+    conn->async.events  = events;
+    conn->async.context = context;
+    conn->async.consume = consume;
+    conn->async.drained = drained;
+
+    if (!conn->stop) {
+        if (conn->is_connected) {
+            conn_async_watch(conn);
+        } else {
+            conn_connect(conn);
+        }
+    }
+    pthread_mutex_unlock(&conn->mtx);
+
+    return 0;
+}
+
+void neu_conn_async_stop(neu_conn_t *conn)
+{
+    pthread_mutex_lock(&conn->mtx);
+    if (conn->async.events == NULL) {
+        pthread_mutex_unlock(&conn->mtx);
+        return;
+    }
+
+    if (conn->async.out_len > 0) {
+        zlog_warn(conn->param.log, "conn fd: %d, drop %zu queued bytes",
+                  conn->fd, conn->async.out_len);
+    }
+
+    conn_async_unwatch(conn);
+    conn->async.events = NULL;
+
+    if (conn->is_connected && conn->block) {
+        fcntl(conn->fd, F_SETFL, fcntl(conn->fd, F_GETFL) & ~O_NONBLOCK);
+    }
+    pthread_mutex_unlock(&conn->mtx);
+}
+
+// Frames of a burst are parsed in place, each from a window past the ones
+// before it, and the bytes of all of them are dropped with one move at the
+// end, so a burst costs its bytes rather than its bytes times its frames.
+// -1 if fn failed on a frame, the frames before it are dropped.
+static int stream_parse(neu_conn_t *conn, void *context,
+                        neu_conn_stream_consume_fn fn, bool lock)
+{
+    neu_protocol_unpack_buf_t protocol_buf = { 0 };
+    uint16_t                  head         = 0;
+    int                       rv           = 0;
+
+    while (head < conn->offset) {
+        neu_protocol_unpack_buf_init(&protocol_buf, conn->buf + head,
+                                     conn->offset - head);
+        int used = fn(context, &protocol_buf);
+
+        zlog_debug(conn->param.log, "buf used: %d offset: %d", used,
+                   conn->offset - head);
+        if (used == 0) {
+            break;
+        } else if (used < 0) {
+            rv = -1;
+            break;
+        }
+        head += used;
+    }
+
+    if (head > 0) {
+        if (lock) {
+            pthread_mutex_lock(&conn->mtx);
+        }
+        conn->offset -= head;
+        memmove(conn->buf, conn->buf + head, conn->offset);
+        if (lock) {
+            pthread_mutex_unlock(&conn->mtx);
+        }
+    }
+
+    return rv;
+}
+
+static inline bool would_block(int err)
+{
+    // a non-blocking tcp connect still in progress reports EAGAIN
+    return err == EAGAIN || err == EWOULDBLOCK || err == EINPROGRESS;
+}
+
+static ssize_t conn_writev(neu_conn_t *conn, const struct iovec *iov,
+                           int iovcnt)
+{
+    if (conn->param.type == NEU_CONN_TTY_CLIENT) {
+        return writev(conn->fd, iov, iovcnt);
+    } else {
+        struct msghdr msg = {
+            .msg_iov    = (struct iovec *) iov,
+            .msg_iovlen = iovcnt,
+        };
+
+        return sendmsg(conn->fd, &msg, MSG_NOSIGNAL);
+    }
+}
+
+static void conn_async_sent(neu_conn_t *conn, ssize_t n)
+{
+    conn->state.send_bytes += n;
+    conn->connection_ok = true;
+    conn->backoff.fails = 0;
+
+    if (conn->callback_trigger == false) {
+        conn->connected(conn->data, conn->fd);
+        conn->callback_trigger = true;
+    }
+}
+
+static void conn_async_want_write(neu_conn_t *conn, bool enable)
+{
+    if (conn->async.want_write != enable) {
+        neu_event_io_write(conn->async.events, conn->async.io, enable);
+        conn->async.want_write = enable;
+    }
+}
+
+ssize_t neu_conn_sendv(neu_conn_t *conn, const struct iovec *iov, int iovcnt)
+{
+    size_t  total = 0;
+    ssize_t rc    = 0;
+
+    for (int i = 0; i < iovcnt; i++) {
+        total += iov[i].iov_len;
+    }
+
+    pthread_mutex_lock(&conn->mtx);
+    if (conn->stop || conn->async.events == NULL) {
+        pthread_mutex_unlock(&conn->mtx);
+        return 0;
+    }
+
+    if (!conn->is_connected) {
+        conn_connect(conn);
+    }
+
+    if (!conn->is_connected) {
+        pthread_mutex_unlock(&conn->mtx);
+        return 0;
+    }
+
+    // never send part of a frame that can not be queued entirely
+    if (conn->async.out_len + total > NEU_CONN_ASYNC_QUEUE_MAX) {
+        zlog_error(conn->param.log,
+                   "conn fd: %d, send queue full, queued: %zu, len: %zu",
+                   conn->fd, conn->async.out_len, total);
+        pthread_mutex_unlock(&conn->mtx);
+        return -1;
+    }
+
+    // keep the order behind the data already queued
+    if (conn->async.out_len == 0) {
+        rc = conn_writev(conn, iov, iovcnt);
+        if (rc < 0) {
+            if (!would_block(errno)) {
+                zlog_error(conn->param.log,
+                           "conn fd: %d, send len: %zu, errno: %s(%d)",
+                           conn->fd, total, strerror(errno), errno);
+                conn_disconnect(conn);
+                pthread_mutex_unlock(&conn->mtx);
+                return -1;
+            }
+            rc = 0;
+        } else if (rc > 0) {
+            conn_async_sent(conn, rc);
+        }
+    }
+
+    if ((size_t) rc < total) {
+        size_t need = conn->async.out_len + total - rc;
+
+        if (need > conn->async.out_cap) {
+            size_t cap = conn->async.out_cap > 0 ? conn->async.out_cap : 2048;
+            while (cap < need) {
+                cap *= 2;
+            }
+            conn->async.out     = realloc(conn->async.out, cap);
+            conn->async.out_cap = cap;
+        }
+
+        size_t skip = rc;
+        for (int i = 0; i < iovcnt; i++) {
+            if (skip >= iov[i].iov_len) {
+                skip -= iov[i].iov_len;
+                continue;
+            }
+
+            memcpy(conn->async.out + conn->async.out_len,
+                   (uint8_t *) iov[i].iov_base + skip, iov[i].iov_len - skip);
+            conn->async.out_len += iov[i].iov_len - skip;
+            skip = 0;
+        }
+
+        conn_async_want_write(conn, true);
+    }
+
+    pthread_mutex_unlock(&conn->mtx);
+
+    return total;
+}
+
 static void conn_free_param(neu_conn_t *conn)
 {
     switch (conn->param.type) {
@@ -632,10 +1300,292 @@ static void conn_free_param(neu_conn_t *conn)
     }
 }
 
+static int64_t conn_now_us(void)
+{
+    struct timespec ts = { 0 };
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+void neu_conn_set_reconnect_rate(uint32_t rate)
+{
+    pthread_mutex_lock(&reconnect.mtx);
+    reconnect.rate   = rate;
+    reconnect.tokens = rate;
+    reconnect.at_us  = conn_now_us();
+    pthread_mutex_unlock(&reconnect.mtx);
+}
+
+uint64_t neu_conn_reconnects_deferred()
+{
+    uint64_t deferred = 0;
+
+    pthread_mutex_lock(&reconnect.mtx);
+    deferred = reconnect.deferred;
+    pthread_mutex_unlock(&reconnect.mtx);
+
+    return deferred;
+}
+
+static bool conn_handover_key(neu_conn_param_t *param, char *key, size_t len)
+{
+    switch (param->type) {
+    case NEU_CONN_TCP_SERVER:
+        snprintf(key, len, "tcp-listen:%s:%hu", param->params.tcp_server.ip,
+                 param->params.tcp_server.port);
+        return true;
+    case NEU_CONN_TCP_CLIENT:
+        snprintf(key, len, "tcp:%s:%hu", param->params.tcp_client.ip,
+                 param->params.tcp_client.port);
+        return true;
+    case NEU_CONN_TTY_CLIENT:
+        snprintf(key, len, "tty:%s", param->params.tty_client.device);
+        return true;
+    default:
+        return false;
+    }
+}
+
+int neu_conn_handover_export(neu_conn_handover_t *out, int max)
+{
+    neu_conn_t *conn = NULL;
+    int         n    = 0;
+
+    pthread_mutex_lock(&conns_mtx);
+    DL_FOREACH(conns, conn)
+    {
+        if (n >= max) {
+            break;
+        }
+
+        pthread_mutex_lock(&conn->mtx);
+        bool up = conn->param.type == NEU_CONN_TCP_SERVER
+            ? conn->tcp_server.is_listen
+            : conn->is_connected;
+        if (up && conn->fd > 0 &&
+            conn_handover_key(&conn->param, out[n].key, sizeof(out[n].key))) {
+            out[n].fd = fcntl(conn->fd, F_DUPFD_CLOEXEC, 0);
+            if (out[n].fd >= 0) {
+                n += 1;
+            }
+        }
+        pthread_mutex_unlock(&conn->mtx);
+    }
+    pthread_mutex_unlock(&conns_mtx);
+
+    return n;
+}
+
+void neu_conn_handover_import(const char *key, int fd)
+{
+    struct conn_handover *handover = NULL;
+
+    pthread_mutex_lock(&handover_mtx);
+    HASH_FIND_STR(handovers, key, handover);
+    if (handover != NULL) {
+        pthread_mutex_unlock(&handover_mtx);
+        close(fd);
+        return;
+    }
+
+    handover     = calloc(1, sizeof(struct conn_handover));
+    handover->fd = fd;
+    snprintf(handover->key, sizeof(handover->key), "%s", key);
+    HASH_ADD_STR(handovers, key, handover);
+    pthread_mutex_unlock(&handover_mtx);
+}
+
+void neu_conn_handover_drop()
+{
+    struct conn_handover *handover = NULL, *tmp = NULL;
+
+    pthread_mutex_lock(&handover_mtx);
+    HASH_ITER(hh, handovers, handover, tmp)
+    {
+        HASH_DEL(handovers, handover);
+        close(handover->fd);
+        free(handover);
+    }
+    pthread_mutex_unlock(&handover_mtx);
+}
+
+// the fd the previous process handed over for the endpoint of conn, or -1
+static int conn_handover_take(neu_conn_t *conn)
+{
+    struct conn_handover *handover                       = NULL;
+    char                  key[NEU_CONN_HANDOVER_KEY_LEN] = { 0 };
+    int                   fd                             = -1;
+
+    if (!conn_handover_key(&conn->param, key, sizeof(key))) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&handover_mtx);
+    HASH_FIND_STR(handovers, key, handover);
+    if (handover != NULL) {
+        HASH_DEL(handovers, handover);
+        fd = handover->fd;
+        free(handover);
+    }
+    pthread_mutex_unlock(&handover_mtx);
+
+    return fd;
+}
+
+static bool conn_reconnect_take(int64_t now)
+{
+    bool taken = true;
+
+    pthread_mutex_lock(&reconnect.mtx);
+    if (reconnect.rate > 0) {
+        reconnect.tokens += (double) (now - reconnect.at_us) / 1000000 *
+            reconnect.rate;
+        if (reconnect.tokens > reconnect.rate) {
+            reconnect.tokens = reconnect.rate;
+        }
+        reconnect.at_us = now;
+
+        if (reconnect.tokens >= 1) {
+            reconnect.tokens -= 1;
+        } else {
+            reconnect.deferred += 1;
+            taken = false;
+        }
+    }
+    pthread_mutex_unlock(&reconnect.mtx);
+
+    return taken;
+}
+
+// wait half the doubled back-off plus up to as much again at random, so that
+// the connections failing together drift apart
+static void conn_backoff(neu_conn_t *conn, int64_t now)
+{
+    int64_t ms = NEU_CONN_BACKOFF_MAX_MS;
+
+    if (conn->backoff.fails < 6) {
+        ms = (int64_t) NEU_CONN_BACKOFF_MIN_MS << conn->backoff.fails;
+        ms = ms < NEU_CONN_BACKOFF_MAX_MS ? ms : NEU_CONN_BACKOFF_MAX_MS;
+    }
+    ms = ms / 2 + rand_r(&conn->backoff.seed) % (ms / 2 + 1);
+
+    conn->backoff.fails += 1;
+    conn->backoff.retry_at = now + ms * 1000;
+}
+
+// the modbus rtu t3.5 silent interval, an 11 bits char at the line baud rate,
+// fixed to 1750us above 19200 bauds
+static void conn_tty_frame_gap(neu_conn_t *conn)
+{
+    // in the order of neu_conn_tty_baud_e
+    static const int64_t rates[] = { 115200, 57600, 38400, 19200, 9600,
+                                     4800,   2400,  1800,  1200,  600,
+                                     300,    200,   150 };
+    neu_conn_tty_baud_e baud = conn->param.params.tty_client.baud;
+    int64_t             rate = 9600;
+
+    if ((size_t) baud < sizeof(rates) / sizeof(rates[0])) {
+        rate = rates[baud];
+    }
+
+    conn->tty.char_us = 11 * 1000000 / rate;
+    conn->tty.gap_us  = rate > 19200 ? 1750 : conn->tty.char_us * 7 / 2;
+    conn->tty.end_us  = conn->tty.gap_us > NEU_CONN_TTY_END_SLOW_US
+         ? conn->tty.gap_us
+         : NEU_CONN_TTY_END_SLOW_US;
+    conn->tty.idle_at = 0;
+}
+
+// ask the uart driver to hand each byte over as it arrives, the frame end is
+// then told by the t3.5 silence rather than by the driver latency
+static void conn_tty_low_latency(neu_conn_t *conn, int fd)
+{
+#if defined(TIOCGSERIAL) && defined(ASYNC_LOW_LATENCY)
+    struct serial_struct serial = { 0 };
+
+    if (ioctl(fd, TIOCGSERIAL, &serial) == 0) {
+        serial.flags |= ASYNC_LOW_LATENCY;
+        if (ioctl(fd, TIOCSSERIAL, &serial) == 0) {
+            conn->tty.end_us = conn->tty.gap_us > NEU_CONN_TTY_END_MIN_US
+                ? conn->tty.gap_us
+                : NEU_CONN_TTY_END_MIN_US;
+            return;
+        }
+    }
+    zlog_notice(conn->param.log, "tty %s without low latency mode",
+                conn->param.params.tty_client.device);
+#else
+    (void) fd;
+#endif
+}
+
+// wait up to the timeout for the first byte, then read until len bytes or
+// the line stays silent past the frame end, so that a short frame, as an
+// exception response, is returned as soon as it ended; 0 on timeout
+static ssize_t conn_tty_read(neu_conn_t *conn, uint8_t *buf, ssize_t len)
+{
+    int64_t deadline = conn_now_us() + conn->tty.timeout_us;
+    ssize_t ret      = 0;
+
+    while (ret < len) {
+        struct pollfd   pfd  = { .fd = conn->fd, .events = POLLIN };
+        int64_t         wait = conn->tty.end_us;
+        struct timespec ts   = { 0 };
+        ssize_t         rc   = 0;
+
+        if (ret == 0) {
+            wait = deadline - conn_now_us();
+            wait = wait > 0 ? wait : 0;
+        }
+        ts.tv_sec  = wait / 1000000;
+        ts.tv_nsec = (wait % 1000000) * 1000;
+
+        rc = ppoll(&pfd, 1, &ts, NULL);
+        if (rc < 0 && errno == EINTR) {
+            continue;
+        } else if (rc < 0) {
+            return -1;
+        } else if (rc == 0) {
+            break;
+        }
+
+        rc = read(conn->fd, buf + ret, len - ret);
+        if (rc < 0 && (errno == EINTR || errno == EAGAIN)) {
+            continue;
+        } else if (rc < 0) {
+            return -1;
+        } else if (rc == 0) {
+            // readable without a byte, the device is gone
+            errno = EIO;
+            return -1;
+        }
+        ret += rc;
+    }
+
+    return ret;
+}
+
+// wait for the bus to be silent long enough to start a new frame
+static void conn_tty_wait_idle(neu_conn_t *conn)
+{
+    int64_t wait = conn->tty.idle_at + conn->tty.gap_us - conn_now_us();
+
+    if (conn->tty.idle_at > 0 && wait > 0) {
+        struct timespec t1 = {
+            .tv_sec  = wait / 1000000,
+            .tv_nsec = (wait % 1000000) * 1000,
+        };
+        struct timespec t2 = { 0 };
+        nanosleep(&t1, &t2);
+    }
+}
+
 static void conn_init_param(neu_conn_t *conn, neu_conn_param_t *param)
 {
-    conn->param.type = param->type;
-    conn->param.log  = param->log;
+    conn->param.type    = param->type;
+    conn->param.log     = param->log;
+    conn->param.tcp_opt = param->tcp_opt;
 
     switch (param->type) {
     case NEU_CONN_TCP_SERVER:
@@ -689,6 +1639,7 @@ static void conn_init_param(neu_conn_t *conn, neu_conn_param_t *param)
         conn->param.params.tty_client.timeout =
             param->params.tty_client.timeout;
         conn->block = conn->param.params.tty_client.timeout > 0;
+        conn_tty_frame_gap(conn);
         break;
     }
 }
@@ -697,9 +1648,13 @@ static void conn_tcp_server_listen(neu_conn_t *conn)
 {
     if (conn->param.type == NEU_CONN_TCP_SERVER &&
         conn->tcp_server.is_listen == false) {
-        int fd = -1, ret = 0;
+        int fd = conn_handover_take(conn), ret = 0;
 
-        if (is_ipv4(conn->param.params.tcp_server.ip)) {
+        if (fd >= 0) {
+            zlog_notice(conn->param.log, "tcp server %s:%d taken over, fd: %d",
+                        conn->param.params.tcp_server.ip,
+                        conn->param.params.tcp_server.port, fd);
+        } else if (is_ipv4(conn->param.params.tcp_server.ip)) {
             struct sockaddr_in local = {
                 .sin_family      = AF_INET,
                 .sin_port        = htons(conn->param.params.tcp_server.port),
@@ -733,7 +1688,8 @@ static void conn_tcp_server_listen(neu_conn_t *conn)
             return;
         }
 
-        ret = listen(fd, 1);
+        // listen again on a fd taken over only raises its backlog
+        ret = listen(fd, conn->param.params.tcp_server.max_link);
         if (ret != 0) {
             close(fd);
             zlog_error(conn->param.log, "tcp bind %s:%d fail, errno: %s",
@@ -788,6 +1744,38 @@ static void conn_connect(neu_conn_t *conn)
     case NEU_CONN_TCP_SERVER:
         break;
     case NEU_CONN_TCP_CLIENT: {
+        int64_t now = conn_now_us();
+
+        // the connection of the previous process is still up, use it as is
+        if ((fd = conn_handover_take(conn)) >= 0) {
+            struct timeval tv = {
+                .tv_sec = conn->param.params.tcp_client.timeout / 1000,
+                .tv_usec =
+                    (conn->param.params.tcp_client.timeout % 1000) * 1000,
+            };
+            int flags = fcntl(fd, F_GETFL, 0);
+
+            if (conn->block) {
+                fcntl(fd, F_SETFL, flags & ~O_NONBLOCK);
+                setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+                setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+            } else {
+                fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+            }
+            conn_tcp_opt(conn, fd);
+
+            zlog_notice(conn->param.log, "connect %s:%d taken over, fd: %d",
+                        conn->param.params.tcp_client.ip,
+                        conn->param.params.tcp_client.port, fd);
+            conn->is_connected = true;
+            conn->fd           = fd;
+            break;
+        }
+
+        if (now < conn->backoff.retry_at || !conn_reconnect_take(now)) {
+            return;
+        }
+
         if (conn->block) {
             struct timeval tv = {
                 .tv_sec = conn->param.params.tcp_client.timeout / 1000,
@@ -811,6 +1799,10 @@ static void conn_connect(neu_conn_t *conn)
             }
         }
 
+        // the buffer sizes must be set before connect to take effect on the
+        // window scaling
+        conn_tcp_opt(conn, fd);
+
         if (is_ipv4(conn->param.params.tcp_client.ip)) {
             struct sockaddr_in remote = {
                 .sin_family      = AF_INET,
@@ -849,6 +1841,7 @@ static void conn_connect(neu_conn_t *conn)
                        conn->param.params.tcp_client.port, strerror(errno),
                        errno);
             conn->is_connected = false;
+            conn_backoff(conn, conn_now_us());
             return;
         }
 
@@ -1025,7 +2018,6 @@ static void conn_connect(neu_conn_t *conn)
     case NEU_CONN_TTY_CLIENT: {
         struct termios tty_opt = { 0 };
 #ifdef NEU_SMART_LINK
-#include "connection/neu_smart_link.h"
         ret =
             neu_conn_smart_link_auto_set(conn->param.params.tty_client.device);
         zlog_notice(conn->param.log, "smart link ret: %d", ret);
@@ -1033,7 +2025,10 @@ static void conn_connect(neu_conn_t *conn)
             fd = ret;
         }
 #else
-        fd = open(conn->param.params.tty_client.device, O_RDWR | O_NOCTTY, 0);
+        if ((fd = conn_handover_take(conn)) < 0) {
+            fd = open(conn->param.params.tty_client.device, O_RDWR | O_NOCTTY,
+                      0);
+        }
 #endif
         if (fd <= 0) {
             zlog_error(conn->param.log, "open %s error: %s(%d)",
@@ -1042,8 +2037,9 @@ static void conn_connect(neu_conn_t *conn)
             return;
         }
 
+        // reads never block, conn_tty_read waits for the bytes in ppoll
         tcgetattr(fd, &tty_opt);
-        tty_opt.c_cc[VTIME] = conn->param.params.tty_client.timeout / 100;
+        tty_opt.c_cc[VTIME] = 0;
         tty_opt.c_cc[VMIN]  = 0;
 
         switch (conn->param.params.tty_client.flow) {
@@ -1178,6 +2174,9 @@ static void conn_connect(neu_conn_t *conn)
 
         tcflush(fd, TCIOFLUSH);
         tcsetattr(fd, TCSANOW, &tty_opt);
+        conn_tty_low_latency(conn, fd);
+        conn->tty.timeout_us =
+            (int64_t) conn->param.params.tty_client.timeout * 1000;
 
         conn->fd           = fd;
         conn->is_connected = true;
@@ -1186,10 +2185,64 @@ static void conn_connect(neu_conn_t *conn)
         break;
     }
     }
+
+    if (conn->is_connected && conn->async.events != NULL) {
+        conn_async_watch(conn);
+    }
+}
+
+static void conn_tcp_opt(neu_conn_t *conn, int fd)
+{
+    neu_conn_tcp_opt_t *opt = &conn->param.tcp_opt;
+    int                 on  = 1;
+
+    if (opt->nodelay) {
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    }
+
+    // a half open connection is found by the kernel, instead of waiting for
+    // the application timeout
+    if (opt->keepalive_idle > 0) {
+        int idle = opt->keepalive_idle;
+
+        setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, &on, sizeof(on));
+        setsockopt(fd, IPPROTO_TCP, TCP_KEEPIDLE, &idle, sizeof(idle));
+        if (opt->keepalive_interval > 0) {
+            int interval = opt->keepalive_interval;
+            setsockopt(fd, IPPROTO_TCP, TCP_KEEPINTVL, &interval,
+                       sizeof(interval));
+        }
+        if (opt->keepalive_count > 0) {
+            int count = opt->keepalive_count;
+            setsockopt(fd, IPPROTO_TCP, TCP_KEEPCNT, &count, sizeof(count));
+        }
+    }
+
+    if (opt->user_timeout > 0) {
+        unsigned int timeout = opt->user_timeout;
+        setsockopt(fd, IPPROTO_TCP, TCP_USER_TIMEOUT, &timeout,
+                   sizeof(timeout));
+    }
+
+    if (opt->recv_buf > 0) {
+        setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &opt->recv_buf,
+                   sizeof(opt->recv_buf));
+    }
+
+    if (opt->send_buf > 0) {
+        setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &opt->send_buf,
+                   sizeof(opt->send_buf));
+    }
 }
 
 static void conn_disconnect(neu_conn_t *conn)
 {
+    conn_async_unwatch(conn);
+
+    if (conn->param.type == NEU_CONN_TCP_CLIENT && conn->is_connected) {
+        conn_backoff(conn, conn_now_us());
+    }
+
     conn->is_connected  = false;
     conn->connection_ok = false;
     if (conn->callback_trigger == true) {
@@ -1256,6 +2309,7 @@ static int conn_tcp_server_replace_client(neu_conn_t *conn, int fd,
         if (conn->tcp_server.clients[i].fd > 0) {
             int ret = conn->tcp_server.clients[i].fd;
 
+            conn->disconnected(conn->data, ret);
             close(conn->tcp_server.clients[i].fd);
             conn->tcp_server.clients[i].fd = 0;
 
@@ -1268,6 +2322,150 @@ static int conn_tcp_server_replace_client(neu_conn_t *conn, int fd,
     return 0;
 }
 
+#ifdef NEU_SMART_LINK
+static void conn_tty_hotplug(void *ctx, const char *dev_path, bool add)
+{
+    neu_conn_t *conn = (neu_conn_t *) ctx;
+
+    pthread_mutex_lock(&conn->mtx);
+    zlog_notice(conn->param.log, "tty %s %s", dev_path,
+                add ? "plugged in" : "unplugged");
+    // the fd of an unplugged device is dead, and a replugged one is opened
+    // again at once instead of on the next failed send
+    if (conn->is_connected) {
+        conn_disconnect(conn);
+    }
+    if (add && !conn->stop) {
+        conn_connect(conn);
+    }
+    pthread_mutex_unlock(&conn->mtx);
+}
+
+static void conn_tty_watch(neu_conn_t *conn)
+{
+    if (conn->param.type == NEU_CONN_TTY_CLIENT) {
+        neu_conn_smart_link_watch(conn->param.params.tty_client.device,
+                                  conn_tty_hotplug, conn);
+    }
+}
+#endif
+
+static void conn_async_watch(neu_conn_t *conn)
+{
+    neu_event_io_param_t param = {
+        .fd       = conn->fd,
+        .usr_data = conn,
+        .cb       = conn_async_io,
+    };
+
+    // completions are reported by the events, the fd must never block
+    fcntl(conn->fd, F_SETFL, fcntl(conn->fd, F_GETFL) | O_NONBLOCK);
+    conn->async.io         = neu_event_add_io(conn->async.events, param);
+    conn->async.want_write = false;
+}
+
+static void conn_async_unwatch(neu_conn_t *conn)
+{
+    if (conn->async.io != NULL) {
+        neu_event_del_io(conn->async.events, conn->async.io);
+        conn->async.io = NULL;
+    }
+
+    conn->async.out_len    = 0;
+    conn->async.want_write = false;
+}
+
+static int conn_async_flush(neu_conn_t *conn)
+{
+    while (conn->async.out_len > 0) {
+        struct iovec iov = {
+            .iov_base = conn->async.out,
+            .iov_len  = conn->async.out_len,
+        };
+        ssize_t rc = conn_writev(conn, &iov, 1);
+
+        if (rc < 0) {
+            if (would_block(errno)) {
+                return 0;
+            }
+
+            zlog_error(conn->param.log,
+                       "conn fd: %d, flush len: %zu, errno: %s(%d)", conn->fd,
+                       conn->async.out_len, strerror(errno), errno);
+            return -1;
+        }
+
+        conn_async_sent(conn, rc);
+        conn->async.out_len -= rc;
+        memmove(conn->async.out, conn->async.out + rc, conn->async.out_len);
+    }
+
+    conn_async_want_write(conn, false);
+    return 0;
+}
+
+static int conn_async_io(enum neu_event_io_type type, int fd, void *usr_data)
+{
+    neu_conn_t *      conn    = (neu_conn_t *) usr_data;
+    neu_conn_callback drained = NULL;
+    ssize_t           ret     = 0;
+
+    pthread_mutex_lock(&conn->mtx);
+    // fired for an fd closed in the meantime
+    if (conn->async.io == NULL || conn->fd != fd) {
+        pthread_mutex_unlock(&conn->mtx);
+        return 0;
+    }
+
+    switch (type) {
+    case NEU_EVENT_IO_CLOSED:
+    case NEU_EVENT_IO_HUP:
+        zlog_warn(conn->param.log, "conn fd: %d, closed: %d", fd, type);
+        conn_disconnect(conn);
+        break;
+    case NEU_EVENT_IO_WRITE:
+        if (conn_async_flush(conn) != 0) {
+            conn_disconnect(conn);
+        } else if (conn->async.out_len == 0) {
+            drained = conn->async.drained;
+        }
+        break;
+    case NEU_EVENT_IO_READ:
+        if (conn->offset == conn->buf_size) {
+            zlog_error(conn->param.log, "conn fd: %d, recv buf full: %" PRIu16,
+                       fd, conn->buf_size);
+            conn_disconnect(conn);
+            break;
+        }
+
+        ret = read(fd, conn->buf + conn->offset, conn->buf_size - conn->offset);
+        if (ret > 0) {
+            conn->state.recv_bytes += ret;
+            zlog_recv_protocol(conn->param.log, conn->buf + conn->offset, ret);
+            conn->offset += ret;
+        } else if (ret == 0 || !would_block(errno)) {
+            zlog_error(conn->param.log,
+                       "conn fd: %d, recv ret: %zd, errno: %s(%d)", fd, ret,
+                       strerror(errno), errno);
+            conn_disconnect(conn);
+        }
+        break;
+    }
+    pthread_mutex_unlock(&conn->mtx);
+
+    if (drained != NULL) {
+        drained(conn->async.context, fd);
+    }
+
+    if (ret > 0 &&
+        stream_parse(conn, conn->async.context, conn->async.consume, true) !=
+            0) {
+        neu_conn_disconnect(conn);
+    }
+
+    return 0;
+}
+
 int neu_conn_stream_consume(neu_conn_t *conn, void *context,
                             neu_conn_stream_consume_fn fn)
 {
@@ -1276,26 +2474,8 @@ int neu_conn_stream_consume(neu_conn_t *conn, void *context,
     if (ret > 0) {
         zlog_recv_protocol(conn->param.log, conn->buf + conn->offset, ret);
         conn->offset += ret;
-        neu_protocol_unpack_buf_t protocol_buf = { 0 };
-        neu_protocol_unpack_buf_init(&protocol_buf, conn->buf, conn->offset);
-        while (neu_protocol_unpack_buf_unused_size(&protocol_buf) > 0) {
-            int used = fn(context, &protocol_buf);
-
-            zlog_debug(conn->param.log, "buf used: %d offset: %d", used,
-                       conn->offset);
-            if (used == 0) {
-                break;
-            } else if (used == -1) {
-                neu_conn_disconnect(conn);
-                break;
-            } else {
-                pthread_mutex_lock(&conn->mtx);
-                conn->offset -= used;
-                memmove(conn->buf, conn->buf + used, conn->offset);
-                neu_protocol_unpack_buf_init(&protocol_buf, conn->buf,
-                                             conn->offset);
-                pthread_mutex_unlock(&conn->mtx);
-            }
+        if (stream_parse(conn, context, fn, true) != 0) {
+            neu_conn_disconnect(conn);
         }
     }
 
@@ -1309,22 +2489,8 @@ int neu_conn_stream_tcp_server_consume(neu_conn_t *conn, int fd, void *context,
                                            conn->buf_size - conn->offset);
     if (ret > 0) {
         conn->offset += ret;
-        neu_protocol_unpack_buf_t protocol_buf = { 0 };
-        neu_protocol_unpack_buf_init(&protocol_buf, conn->buf, conn->offset);
-        while (neu_protocol_unpack_buf_unused_size(&protocol_buf) > 0) {
-            int used = fn(context, &protocol_buf);
-
-            if (used == 0) {
-                break;
-            } else if (used == -1) {
-                neu_conn_tcp_server_close_client(conn, fd);
-                break;
-            } else {
-                conn->offset -= used;
-                memmove(conn->buf, conn->buf + used, conn->offset);
-                neu_protocol_unpack_buf_init(&protocol_buf, conn->buf,
-                                             conn->offset);
-            }
+        if (stream_parse(conn, context, fn, false) != 0) {
+            neu_conn_tcp_server_close_client(conn, fd);
         }
     }
     return ret;
@@ -26,10 +26,12 @@
 #include <unistd.h>
 
 #include <arpa/inet.h>
+#include <linux/filter.h>
+#include <linux/if_packet.h>
 #include <net/ethernet.h>
 #include <net/if.h>
-#include <netpacket/packet.h>
 #include <sys/ioctl.h>
+#include <sys/mman.h>
 
 #include "connection/neu_connection_eth.h"
 #include "event/event.h"
@@ -41,12 +43,20 @@
 #define ETH_P_LLDP 0x88CC
 #endif
 
+// rx ring of 16 blocks of 64KiB, a block is handed over at most 1ms after its
+// first frame so cyclic frames are not held back
+#define RING_BLOCK_SIZE (1 << 16)
+#define RING_BLOCK_NR 16
+#define RING_FRAME_SIZE 2048
+#define RING_FRAME_NR (RING_BLOCK_SIZE / RING_FRAME_SIZE * RING_BLOCK_NR)
+#define RING_BLOCK_TIMEOUT 1
+
 struct neu_conn_eth_sub {
     uint8_t mac[6];
 };
 
 typedef struct {
-    char mac[20];
+    uint64_t mac;
 
     neu_conn_eth_msg_callback callback;
 
@@ -71,6 +81,10 @@ typedef struct interface_conn {
     neu_event_io_t *profinet_event;
     neu_event_io_t *vlan_event;
 
+    // mmap'ed rx ring of profinet_fd, NULL when frames are read by recv
+    uint8_t *ring;
+    uint32_t ring_block;
+
     callback_elem_t *callbacks;
     pthread_mutex_t  mtx;
 } interface_conn_t;
@@ -89,6 +103,8 @@ static int get_mac(neu_conn_eth_t *conn, const char *interface);
 static int init_socket(const char *interface, uint16_t protocol,
                        uint8_t mac[6]);
 static int uninit_socket(int fd);
+static int init_ring(interface_conn_t *ic);
+static void uninit_ring(interface_conn_t *ic);
 
 static int     eth_msg_cb(enum neu_event_io_type type, int fd, void *usr_data);
 static uint8_t pf_dcp_broadcast[ETH_ALEN] = {
@@ -144,6 +160,10 @@ neu_conn_eth_t *neu_conn_eth_init(const char *interface, void *ctx)
 
                 in_conns[i].profinet_fd =
                     init_socket(interface, 0x8892, in_conns[i].mac);
+                if (init_ring(&in_conns[i]) != 0) {
+                    nlog_warn("eth %s rx ring unavailable, use recv",
+                              interface);
+                }
                 // in_conns[i].vlan_fd =
                 // init_socket(interface, 0x8100, in_conns[i].mac);
 
@@ -181,6 +201,7 @@ int neu_conn_eth_uninit(neu_conn_eth_t *conn)
 
         neu_event_close(conn->ic->events);
 
+        uninit_ring(conn->ic);
         uninit_socket(conn->ic->profinet_fd);
         // uninit_socket(conn->ic->vlan_fd);
 
@@ -220,29 +241,37 @@ int neu_conn_eth_check_interface(const char *interface)
     return ret;
 }
 
+static inline uint64_t mac_key(const uint8_t mac[ETH_ALEN])
+{
+    uint64_t key = 0;
+
+    for (int i = 0; i < ETH_ALEN; i++) {
+        key = key << 8 | mac[i];
+    }
+
+    return key;
+}
+
 neu_conn_eth_sub_t *neu_conn_eth_register(neu_conn_eth_t *conn, uint8_t xmac[6],
                                           neu_conn_eth_msg_callback callback)
 {
-    char                tmp_mac[20] = { 0 };
-    neu_conn_eth_sub_t *sub         = NULL;
-    callback_elem_t *   elem        = NULL;
-
-    snprintf(tmp_mac, sizeof(tmp_mac), "%X:%X:%X-%X:%X:%X", xmac[0], xmac[1],
-             xmac[2], xmac[3], xmac[4], xmac[5]);
+    uint64_t            key  = mac_key(xmac);
+    neu_conn_eth_sub_t *sub  = NULL;
+    callback_elem_t *   elem = NULL;
 
     pthread_mutex_lock(&conn->ic->mtx);
 
-    HASH_FIND_STR(conn->ic->callbacks, tmp_mac, elem);
+    HASH_FIND(hh, conn->ic->callbacks, &key, sizeof(key), elem);
     if (elem == NULL) {
         elem = calloc(1, sizeof(callback_elem_t));
         sub  = calloc(1, sizeof(neu_conn_eth_sub_t));
 
         elem->callback = callback;
-        memcpy(elem->mac, tmp_mac, sizeof(elem->mac));
+        elem->mac      = key;
 
         memcpy(sub->mac, xmac, ETH_ALEN);
 
-        HASH_ADD_STR(conn->ic->callbacks, mac, elem);
+        HASH_ADD(hh, conn->ic->callbacks, mac, sizeof(elem->mac), elem);
     }
 
     pthread_mutex_unlock(&conn->ic->mtx);
@@ -252,15 +281,12 @@ neu_conn_eth_sub_t *neu_conn_eth_register(neu_conn_eth_t *conn, uint8_t xmac[6],
 
 int neu_conn_eth_unregister(neu_conn_eth_t *conn, neu_conn_eth_sub_t *sub)
 {
-    char             tmp_mac[20] = { 0 };
-    callback_elem_t *elem        = NULL;
-
-    snprintf(tmp_mac, sizeof(tmp_mac), "%X:%X:%X-%X:%X:%X", sub->mac[0],
-             sub->mac[1], sub->mac[2], sub->mac[3], sub->mac[4], sub->mac[5]);
+    uint64_t         key  = mac_key(sub->mac);
+    callback_elem_t *elem = NULL;
 
     pthread_mutex_lock(&conn->ic->mtx);
 
-    HASH_FIND_STR(conn->ic->callbacks, tmp_mac, elem);
+    HASH_FIND(hh, conn->ic->callbacks, &key, sizeof(key), elem);
     if (elem != NULL) {
         HASH_DEL(conn->ic->callbacks, elem);
         free(elem);
@@ -312,6 +338,40 @@ static int get_mac(neu_conn_eth_t *conn, const char *interface)
     return ret;
 }
 
+// keep frames of other protocols, or sent to other hosts, out of user space
+static void attach_filter(int fd, const char *interface, const uint8_t mac[6])
+{
+    uint32_t mac_hi = (uint32_t) mac[0] << 24 | (uint32_t) mac[1] << 16 |
+        (uint32_t) mac[2] << 8 | mac[3];
+    uint32_t mac_lo = (uint32_t) mac[4] << 8 | mac[5];
+
+    struct sock_filter code[] = {
+        BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 12),
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 0x8892, 1, 0),
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 0x8100, 0, 7),
+        // destination is our mac
+        BPF_STMT(BPF_LD | BPF_W | BPF_ABS, 0),
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, mac_hi, 0, 2),
+        BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 4),
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, mac_lo, 4, 3),
+        // or the dcp multicast address 01:0e:cf:00:00:01
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 0x010ecf00, 0, 2),
+        BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 4),
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 0x0001, 1, 0),
+        BPF_STMT(BPF_RET | BPF_K, 0),
+        BPF_STMT(BPF_RET | BPF_K, 0xffff),
+    };
+    struct sock_fprog prog = {
+        .len    = sizeof(code) / sizeof(code[0]),
+        .filter = code,
+    };
+
+    if (setsockopt(fd, SOL_SOCKET, SO_ATTACH_FILTER, &prog, sizeof(prog)) !=
+        0) {
+        nlog_warn("eth %s attach filter fail: %s", interface, strerror(errno));
+    }
+}
+
 static int init_socket(const char *interface, uint16_t protocol, uint8_t mac[6])
 {
     struct ifreq       ifr                     = { 0 };
@@ -325,7 +385,6 @@ static int init_socket(const char *interface, uint16_t protocol, uint8_t mac[6])
     assert(fd > 0);
     setsockopt(fd, SOL_SOCKET, SO_DONTROUTE, &ret, sizeof(ret));
 
-    (void) mac;
     (void) pn_mcast_addr;
 
     strcpy(ifr.ifr_name, interface);
@@ -334,6 +393,12 @@ static int init_socket(const char *interface, uint16_t protocol, uint8_t mac[6])
         return -1;
     }
 
+    attach_filter(fd, interface, mac);
+
+    // frames are sent as is, there is nothing for the qdisc to do
+    ret = 1;
+    setsockopt(fd, SOL_PACKET, PACKET_QDISC_BYPASS, &ret, sizeof(ret));
+
     sll.sll_family   = AF_PACKET;
     sll.sll_ifindex  = ifr.ifr_ifindex;
     sll.sll_protocol = htons(protocol);
@@ -343,6 +408,52 @@ static int init_socket(const char *interface, uint16_t protocol, uint8_t mac[6])
     return fd;
 }
 
+static int init_ring(interface_conn_t *ic)
+{
+    int                 version = TPACKET_V3;
+    struct tpacket_req3 req     = {
+        .tp_block_size       = RING_BLOCK_SIZE,
+        .tp_block_nr         = RING_BLOCK_NR,
+        .tp_frame_size       = RING_FRAME_SIZE,
+        .tp_frame_nr         = RING_FRAME_NR,
+        .tp_retire_blk_tov   = RING_BLOCK_TIMEOUT,
+        .tp_feature_req_word = 0,
+    };
+
+    if (ic->profinet_fd < 0 ||
+        setsockopt(ic->profinet_fd, SOL_PACKET, PACKET_VERSION, &version,
+                   sizeof(version)) != 0 ||
+        setsockopt(ic->profinet_fd, SOL_PACKET, PACKET_RX_RING, &req,
+                   sizeof(req)) != 0) {
+        return -1;
+    }
+
+    ic->ring = mmap(NULL, (size_t) RING_BLOCK_SIZE * RING_BLOCK_NR,
+                    PROT_READ | PROT_WRITE, MAP_SHARED | MAP_LOCKED,
+                    ic->profinet_fd, 0);
+    if (ic->ring == MAP_FAILED) {
+        // MAP_LOCKED needs CAP_IPC_LOCK or enough RLIMIT_MEMLOCK
+        ic->ring = mmap(NULL, (size_t) RING_BLOCK_SIZE * RING_BLOCK_NR,
+                        PROT_READ | PROT_WRITE, MAP_SHARED, ic->profinet_fd,
+                        0);
+    }
+    if (ic->ring == MAP_FAILED) {
+        ic->ring = NULL;
+        return -1;
+    }
+
+    ic->ring_block = 0;
+    return 0;
+}
+
+static void uninit_ring(interface_conn_t *ic)
+{
+    if (ic->ring != NULL) {
+        munmap(ic->ring, (size_t) RING_BLOCK_SIZE * RING_BLOCK_NR);
+        ic->ring = NULL;
+    }
+}
+
 static int uninit_socket(int fd)
 {
     close(fd);
@@ -350,59 +461,94 @@ static int uninit_socket(int fd)
     return 0;
 }
 
-static int eth_msg_cb(enum neu_event_io_type type, int fd, void *usr_data)
+static void dispatch(neu_conn_eth_t *conn, uint8_t *buf, int len)
 {
-    neu_conn_eth_t *conn = (neu_conn_eth_t *) usr_data;
+    callback_elem_t *elem = NULL;
+    uint64_t         key  = 0;
 
-    switch (type) {
-    case NEU_EVENT_IO_READ: {
-        callback_elem_t *elem      = NULL;
-        uint8_t          buf[1500] = { 0 };
-        int              ret       = recv(fd, buf, 1500, 0);
+    if (len < ETH_HLEN) {
+        return;
+    }
+
+    struct ethhdr *ehdr  = (struct ethhdr *) buf;
+    uint16_t       proto = ntohs(ehdr->h_proto);
 
-        if (ret < ETH_HLEN) {
-            return 0;
+    if (proto != 0x8100 && proto != 0x8892) {
+        return;
+    }
+
+    if (memcmp(ehdr->h_dest, pf_dcp_broadcast, ETH_ALEN) == 0) {
+        callback_elem_t *tmp = NULL;
+
+        HASH_ITER(hh, conn->ic->callbacks, elem, tmp)
+        {
+            elem->callback(conn, conn->ctx, proto, len - ETH_HLEN,
+                           buf + ETH_HLEN, ehdr->h_source);
         }
+        return;
+    }
+
+    if (memcmp(ehdr->h_dest, conn->ic->mac, ETH_ALEN) != 0) {
+        return;
+    }
+
+    key = mac_key(ehdr->h_source);
+    HASH_FIND(hh, conn->ic->callbacks, &key, sizeof(key), elem);
+    if (elem == NULL) {
+        // a subscriber of 00:00:00:00:00:00 takes frames of any device
+        key = 0;
+        HASH_FIND(hh, conn->ic->callbacks, &key, sizeof(key), elem);
+    }
+    if (elem != NULL) {
+        elem->callback(conn, conn->ctx, proto, len - ETH_HLEN, buf + ETH_HLEN,
+                       ehdr->h_source);
+    }
+}
+
+// hand every block the kernel has filled to dispatch, then give it back
+static void read_ring(neu_conn_eth_t *conn)
+{
+    interface_conn_t *ic = conn->ic;
 
-        struct ethhdr *ehdr = (struct ethhdr *) buf;
-        ehdr->h_proto       = ntohs(ehdr->h_proto);
+    while (true) {
+        struct tpacket_block_desc *block =
+            (struct tpacket_block_desc *) (ic->ring +
+                                           (size_t) ic->ring_block *
+                                               RING_BLOCK_SIZE);
 
-        if (ehdr->h_proto != 0x8100 && ehdr->h_proto != 0x8892) {
-            return 0;
+        if ((block->hdr.bh1.block_status & TP_STATUS_USER) == 0) {
+            break;
         }
 
-        if (memcmp(ehdr->h_dest, pf_dcp_broadcast, ETH_ALEN) == 0) {
-            callback_elem_t *tmp = NULL;
+        struct tpacket3_hdr *hdr =
+            (struct tpacket3_hdr *) ((uint8_t *) block +
+                                     block->hdr.bh1.offset_to_first_pkt);
 
-            HASH_ITER(hh, conn->ic->callbacks, elem, tmp)
-            {
-                elem->callback(conn, conn->ctx, ehdr->h_proto, ret - ETH_HLEN,
-                               buf + ETH_HLEN, ehdr->h_source);
-            }
+        for (uint32_t i = 0; i < block->hdr.bh1.num_pkts; i++) {
+            dispatch(conn, (uint8_t *) hdr + hdr->tp_mac, hdr->tp_snaplen);
+            hdr = (struct tpacket3_hdr *) ((uint8_t *) hdr +
+                                           hdr->tp_next_offset);
+        }
+
+        __sync_synchronize();
+        block->hdr.bh1.block_status = TP_STATUS_KERNEL;
+        ic->ring_block              = (ic->ring_block + 1) % RING_BLOCK_NR;
+    }
+}
+
+static int eth_msg_cb(enum neu_event_io_type type, int fd, void *usr_data)
+{
+    neu_conn_eth_t *conn = (neu_conn_eth_t *) usr_data;
+
+    switch (type) {
+    case NEU_EVENT_IO_READ: {
+        if (conn->ic->ring != NULL) {
+            read_ring(conn);
         } else {
-            if (memcmp(ehdr->h_dest, conn->ic->mac, ETH_ALEN) != 0) {
-                return 0;
-            }
-            char tmp_mac[20] = { 0 };
-
-            snprintf(tmp_mac, sizeof(tmp_mac), "%X:%X:%X-%X:%X:%X",
-                     ehdr->h_source[0], ehdr->h_source[1], ehdr->h_source[2],
-                     ehdr->h_source[3], ehdr->h_source[4], ehdr->h_source[5]);
-
-            HASH_FIND_STR(conn->ic->callbacks, tmp_mac, elem);
-            if (elem != NULL) {
-                elem->callback(conn, conn->ctx, ehdr->h_proto, ret - ETH_HLEN,
-                               buf + ETH_HLEN, ehdr->h_source);
-            } else {
-                memset(tmp_mac, 0, sizeof(tmp_mac));
-                snprintf(tmp_mac, sizeof(tmp_mac), "0:0:0-0:0:0");
-                HASH_FIND_STR(conn->ic->callbacks, tmp_mac, elem);
-                if (elem != NULL) {
-                    elem->callback(conn, conn->ctx, ehdr->h_proto,
-                                   ret - ETH_HLEN, buf + ETH_HLEN,
-                                   ehdr->h_source);
-                }
-            }
+            uint8_t buf[1500] = { 0 };
+            int     ret       = recv(fd, buf, sizeof(buf), 0);
+
+            dispatch(conn, buf, ret);
         }
 
         break;
@@ -412,6 +558,8 @@ static int eth_msg_cb(enum neu_event_io_type type, int fd, void *usr_data)
         nlog_warn("eth conn eth error type: %d, fd: %d(%s)", type, fd,
                   conn->ic->interface);
         break;
+    case NEU_EVENT_IO_WRITE:
+        break;
     }
 
     return 0;
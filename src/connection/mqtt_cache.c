@@ -0,0 +1,785 @@
+/**
+ * NEURON IIoT System for Industry 4.0
+ * Copyright (C) 2020-2023 EMQ Technologies Co., Ltd All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ **/
+
+#include <dirent.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "utils/utlist.h"
+
+#include "mqtt_cache.h"
+
+#define log(level, ...)                              \
+    do {                                             \
+        if (cache->log) {                            \
+            zlog_##level(cache->log, ##__VA_ARGS__); \
+        }                                            \
+    } while (0)
+
+// the log is split into about SEG_NUM segment files, so that dropping the
+// oldest segment frees a small part of it
+#define SEG_NUM 16
+#define SEG_SIZE_MIN (4 * 1024)
+#define SEG_SIZE_MAX (64 * 1024 * 1024)
+#define SEG_SUFFIX ".seg"
+
+// initial capacity of the memory ring, it grows up to `mem_size` on demand
+#define MEM_CAP_MIN (64 * 1024)
+
+// records in the memory ring end with their size, so that the newest one can
+// be found from the tail
+#define MEM_TRAILER sizeof(uint32_t)
+
+#define REC_MAGIC 0xca
+#define REC_QOS_MASK 0x03
+#define REC_RETAIN 0x80
+
+// every record, in memory and on disk, is this header followed by the topic
+// and the payload. Segments are only read back by the host that wrote them,
+// so the header is in host byte order.
+typedef struct {
+    uint32_t len;
+    uint16_t topic_len;
+    uint8_t  qos; // QoS in REC_QOS_MASK, and REC_RETAIN
+    uint8_t  magic;
+} rec_hdr_t;
+
+static inline size_t rec_size(const rec_hdr_t *hdr)
+{
+    return sizeof(*hdr) + hdr->topic_len + hdr->len;
+}
+
+typedef struct seg {
+    uint32_t    seq;
+    size_t      size;  // bytes of complete records in the file
+    size_t      count; // records not popped yet
+    struct seg *prev;
+    struct seg *next;
+} seg_t;
+
+struct mqtt_cache {
+    char *           dir;
+    zlog_category_t *log;
+    pthread_mutex_t  mtx;
+
+    // memory ring
+    uint8_t *mem;
+    size_t   mem_size;
+    size_t   mem_cap;
+    size_t   mem_head;
+    size_t   mem_used;
+    size_t   mem_count;
+
+    // disk log, oldest segment first, popping from the head and appending to
+    // the tail
+    seg_t *  segs;
+    size_t   disk_size;
+    size_t   disk_used;
+    size_t   disk_count;
+    size_t   seg_size;
+    uint32_t next_seq;
+    FILE *   rfp;   // the head segment once popping started
+    size_t   roff;  // offset of the next record in rfp
+    FILE *   wfp;   // the tail segment, NULL if it is from a previous run
+    bool     dirty; // written to wfp since the last fsync
+
+    // the popped message, topic and payload separated by a nul
+    uint8_t *buf;
+    size_t   buf_cap;
+};
+
+static inline void seg_path(mqtt_cache_t *cache, uint32_t seq,
+                            char path[PATH_MAX])
+{
+    snprintf(path, PATH_MAX, "%s/%08" PRIx32 SEG_SUFFIX, cache->dir, seq);
+}
+
+static int make_dir(const char *dir)
+{
+    char path[PATH_MAX] = { 0 };
+
+    if (strlen(dir) >= sizeof(path)) {
+        return -1;
+    }
+    strcpy(path, dir);
+
+    for (char *p = path + 1; *p; ++p) {
+        if ('/' == *p) {
+            *p = '\0';
+            if (0 != mkdir(path, 0755) && EEXIST != errno) {
+                return -1;
+            }
+            *p = '/';
+        }
+    }
+
+    if (0 != mkdir(path, 0755) && EEXIST != errno) {
+        return -1;
+    }
+
+    return 0;
+}
+
+static inline int buf_reserve(mqtt_cache_t *cache, size_t size)
+{
+    if (size > cache->buf_cap) {
+        uint8_t *buf = realloc(cache->buf, size);
+        if (NULL == buf) {
+            return -1;
+        }
+        cache->buf     = buf;
+        cache->buf_cap = size;
+    }
+    return 0;
+}
+
+// make room for `n` more bytes, the ring is linearized when it grows
+static int ring_reserve(mqtt_cache_t *cache, size_t n)
+{
+    size_t   cap   = cache->mem_cap;
+    size_t   first = 0;
+    uint8_t *mem   = NULL;
+
+    if (cache->mem_used + n <= cap) {
+        return 0;
+    }
+
+    cap = cap ? cap * 2 : MEM_CAP_MIN;
+    if (cap < cache->mem_used + n) {
+        cap = cache->mem_used + n;
+    }
+    if (cap > cache->mem_size) {
+        cap = cache->mem_size;
+    }
+
+    mem = malloc(cap);
+    if (NULL == mem) {
+        log(error, "malloc cache memory ring %zu bytes fail", cap);
+        return -1;
+    }
+
+    if (cache->mem_used > 0) {
+        first = cache->mem_cap - cache->mem_head;
+        if (first > cache->mem_used) {
+            first = cache->mem_used;
+        }
+        memcpy(mem, cache->mem + cache->mem_head, first);
+        memcpy(mem + first, cache->mem, cache->mem_used - first);
+    }
+
+    free(cache->mem);
+    cache->mem      = mem;
+    cache->mem_cap  = cap;
+    cache->mem_head = 0;
+    return 0;
+}
+
+static void ring_write(mqtt_cache_t *cache, const void *data, size_t n)
+{
+    size_t off   = (cache->mem_head + cache->mem_used) % cache->mem_cap;
+    size_t first = cache->mem_cap - off;
+
+    if (first > n) {
+        first = n;
+    }
+    memcpy(cache->mem + off, data, first);
+    memcpy(cache->mem, (const uint8_t *) data + first, n - first);
+    cache->mem_used += n;
+}
+
+// consume `n` bytes from the head, which are returned as up to two pieces
+// valid until the next ring_write
+static void ring_take(mqtt_cache_t *cache, size_t n, const uint8_t **a,
+                      size_t *a_len, const uint8_t **b, size_t *b_len)
+{
+    size_t first = cache->mem_cap - cache->mem_head;
+
+    if (first > n) {
+        first = n;
+    }
+    *a     = cache->mem + cache->mem_head;
+    *a_len = first;
+    *b     = cache->mem;
+    *b_len = n - first;
+
+    cache->mem_head = (cache->mem_head + n) % cache->mem_cap;
+    cache->mem_used -= n;
+}
+
+static void ring_read(mqtt_cache_t *cache, void *data, size_t n)
+{
+    const uint8_t *a = NULL, *b = NULL;
+    size_t         a_len = 0, b_len = 0;
+
+    ring_take(cache, n, &a, &a_len, &b, &b_len);
+    memcpy(data, a, a_len);
+    memcpy((uint8_t *) data + a_len, b, b_len);
+}
+
+// copy `n` bytes at `off` from the head without consuming them
+static void ring_peek(mqtt_cache_t *cache, size_t off, void *data, size_t n)
+{
+    size_t pos   = (cache->mem_head + off) % cache->mem_cap;
+    size_t first = cache->mem_cap - pos;
+
+    if (first > n) {
+        first = n;
+    }
+    memcpy(data, cache->mem + pos, first);
+    memcpy((uint8_t *) data + first, cache->mem, n - first);
+}
+
+static inline void ring_skip(mqtt_cache_t *cache, size_t n)
+{
+    cache->mem_head = (cache->mem_head + n) % cache->mem_cap;
+    cache->mem_used -= n;
+}
+
+static inline void ring_drop(mqtt_cache_t *cache)
+{
+    rec_hdr_t hdr = { 0 };
+
+    ring_read(cache, &hdr, sizeof(hdr));
+    ring_skip(cache, hdr.topic_len + hdr.len + MEM_TRAILER);
+    cache->mem_count -= 1;
+}
+
+// pop the oldest or the newest record of the memory ring into buf
+static int ring_pop(mqtt_cache_t *cache, rec_hdr_t *hdr, bool newest)
+{
+    uint32_t size = 0;
+    size_t   off  = 0;
+
+    if (0 == cache->mem_count) {
+        return -1;
+    }
+
+    if (newest) {
+        ring_peek(cache, cache->mem_used - MEM_TRAILER, &size, sizeof(size));
+        off = cache->mem_used - MEM_TRAILER - size;
+    }
+    ring_peek(cache, off, hdr, sizeof(*hdr));
+    size = rec_size(hdr);
+
+    cache->mem_count -= 1;
+    if (0 != buf_reserve(cache, hdr->topic_len + 1 + hdr->len)) {
+        // the record is dropped either way
+        if (newest) {
+            cache->mem_used -= size + MEM_TRAILER;
+        } else {
+            ring_skip(cache, size + MEM_TRAILER);
+        }
+        log(error, "pop cached message fail, drop it");
+        return -1;
+    }
+
+    ring_peek(cache, off + sizeof(*hdr), cache->buf, hdr->topic_len);
+    ring_peek(cache, off + sizeof(*hdr) + hdr->topic_len,
+              cache->buf + hdr->topic_len + 1, hdr->len);
+    cache->buf[hdr->topic_len] = '\0';
+    if (newest) {
+        cache->mem_used -= size + MEM_TRAILER;
+    } else {
+        ring_skip(cache, size + MEM_TRAILER);
+    }
+    return 0;
+}
+
+static void disk_seal(mqtt_cache_t *cache)
+{
+    if (cache->wfp) {
+        if (0 != fflush(cache->wfp) || 0 != fsync(fileno(cache->wfp))) {
+            log(error, "sync cache segment fail: %s", strerror(errno));
+        }
+        fclose(cache->wfp);
+        cache->wfp   = NULL;
+        cache->dirty = false;
+    }
+}
+
+static void disk_drop_head(mqtt_cache_t *cache)
+{
+    seg_t *seg             = cache->segs;
+    char   path[PATH_MAX] = { 0 };
+
+    if (cache->rfp) {
+        fclose(cache->rfp);
+        cache->rfp  = NULL;
+        cache->roff = 0;
+    }
+
+    if (seg == cache->segs->prev) {
+        // the tail is dropped as well
+        disk_seal(cache);
+    }
+
+    seg_path(cache, seg->seq, path);
+    if (0 != unlink(path) && ENOENT != errno) {
+        log(error, "unlink %s fail: %s", path, strerror(errno));
+    }
+
+    cache->disk_used -= seg->size;
+    cache->disk_count -= seg->count;
+    DL_DELETE(cache->segs, seg);
+    free(seg);
+}
+
+static int disk_new_seg(mqtt_cache_t *cache)
+{
+    char   path[PATH_MAX] = { 0 };
+    seg_t *seg             = calloc(1, sizeof(*seg));
+
+    if (NULL == seg) {
+        return -1;
+    }
+
+    disk_seal(cache);
+
+    seg->seq = cache->next_seq++;
+    seg_path(cache, seg->seq, path);
+    cache->wfp = fopen(path, "wb");
+    if (NULL == cache->wfp) {
+        log(error, "open %s fail: %s", path, strerror(errno));
+        free(seg);
+        return -1;
+    }
+
+    DL_APPEND(cache->segs, seg);
+    return 0;
+}
+
+// append one record whose body is given as up to two pieces
+static int disk_append(mqtt_cache_t *cache, const rec_hdr_t *hdr,
+                       const void *a, size_t a_len, const void *b,
+                       size_t b_len)
+{
+    size_t size = rec_size(hdr);
+    seg_t *tail = NULL;
+
+    if (size > cache->disk_size) {
+        return -1;
+    }
+
+    while (cache->segs && cache->disk_used + size > cache->disk_size) {
+        log(warn, "cache disk full, drop %zu oldest messages",
+            cache->segs->count);
+        disk_drop_head(cache);
+    }
+
+    tail = cache->segs ? cache->segs->prev : NULL;
+    if (NULL == cache->wfp ||
+        (tail->size > 0 && tail->size + size > cache->seg_size)) {
+        if (0 != disk_new_seg(cache)) {
+            return -1;
+        }
+        tail = cache->segs->prev;
+    }
+
+    if (1 != fwrite(hdr, sizeof(*hdr), 1, cache->wfp) ||
+        (a_len > 0 && 1 != fwrite(a, a_len, 1, cache->wfp)) ||
+        (b_len > 0 && 1 != fwrite(b, b_len, 1, cache->wfp))) {
+        log(error, "write cache segment fail: %s", strerror(errno));
+        // the segment may end with a partial record now, stop appending to it
+        disk_seal(cache);
+        return -1;
+    }
+
+    tail->size += size;
+    tail->count += 1;
+    cache->disk_used += size;
+    cache->disk_count += 1;
+    cache->dirty = true;
+    return 0;
+}
+
+static int disk_pop(mqtt_cache_t *cache, rec_hdr_t *hdr)
+{
+    char path[PATH_MAX] = { 0 };
+
+    while (cache->segs) {
+        seg_t *seg = cache->segs;
+
+        if (seg == cache->segs->prev && cache->wfp &&
+            0 != fflush(cache->wfp)) {
+            log(error, "flush cache segment fail: %s", strerror(errno));
+        }
+
+        if (NULL == cache->rfp) {
+            seg_path(cache, seg->seq, path);
+            cache->rfp  = fopen(path, "rb");
+            cache->roff = 0;
+            if (NULL == cache->rfp) {
+                log(error, "open %s fail: %s, drop %zu messages", path,
+                    strerror(errno), seg->count);
+                disk_drop_head(cache);
+                continue;
+            }
+        }
+
+        if (cache->roff + sizeof(*hdr) > seg->size ||
+            1 != fread(hdr, sizeof(*hdr), 1, cache->rfp) ||
+            REC_MAGIC != hdr->magic ||
+            cache->roff + rec_size(hdr) > seg->size ||
+            0 != buf_reserve(cache, hdr->topic_len + 1 + hdr->len) ||
+            (hdr->topic_len > 0 &&
+             1 != fread(cache->buf, hdr->topic_len, 1, cache->rfp)) ||
+            (hdr->len > 0 &&
+             1 !=
+                 fread(cache->buf + hdr->topic_len + 1, hdr->len, 1,
+                       cache->rfp))) {
+            log(error,
+                "read cache segment %08" PRIx32 " fail, drop %zu messages",
+                seg->seq, seg->count);
+            disk_drop_head(cache);
+            continue;
+        }
+
+        cache->buf[hdr->topic_len] = '\0';
+        cache->roff += rec_size(hdr);
+        seg->count -= 1;
+        cache->disk_count -= 1;
+        if (0 == seg->count) {
+            disk_drop_head(cache);
+        }
+        return 0;
+    }
+
+    return -1;
+}
+
+// count the complete records of a segment left by a previous run
+static int disk_scan_seg(mqtt_cache_t *cache, seg_t *seg)
+{
+    char        path[PATH_MAX] = { 0 };
+    struct stat st             = { 0 };
+    rec_hdr_t   hdr            = { 0 };
+    FILE *      fp             = NULL;
+
+    seg_path(cache, seg->seq, path);
+    if (0 != stat(path, &st) || NULL == (fp = fopen(path, "rb"))) {
+        log(error, "open %s fail: %s", path, strerror(errno));
+        return -1;
+    }
+
+    while (seg->size + sizeof(hdr) <= (size_t) st.st_size &&
+           1 == fread(&hdr, sizeof(hdr), 1, fp) && REC_MAGIC == hdr.magic &&
+           seg->size + rec_size(&hdr) <= (size_t) st.st_size &&
+           0 == fseek(fp, hdr.topic_len + hdr.len, SEEK_CUR)) {
+        seg->size += rec_size(&hdr);
+        seg->count += 1;
+    }
+
+    fclose(fp);
+    return 0;
+}
+
+static int seg_cmp(seg_t *a, seg_t *b)
+{
+    return a->seq < b->seq ? -1 : a->seq > b->seq;
+}
+
+static void disk_load(mqtt_cache_t *cache)
+{
+    DIR *          dir = opendir(cache->dir);
+    struct dirent *ent = NULL;
+
+    if (NULL == dir) {
+        log(error, "opendir %s fail: %s", cache->dir, strerror(errno));
+        return;
+    }
+
+    while (NULL != (ent = readdir(dir))) {
+        uint32_t seq = 0;
+        int      n   = 0;
+
+        if (1 != sscanf(ent->d_name, "%8" SCNx32 "%n", &seq, &n) ||
+            0 != strcmp(ent->d_name + n, SEG_SUFFIX)) {
+            continue;
+        }
+
+        seg_t *seg = calloc(1, sizeof(*seg));
+        if (NULL == seg) {
+            break;
+        }
+        seg->seq = seq;
+        DL_INSERT_INORDER(cache->segs, seg, seg_cmp);
+    }
+    closedir(dir);
+
+    seg_t *seg = NULL, *tmp = NULL;
+    DL_FOREACH_SAFE(cache->segs, seg, tmp)
+    {
+        char path[PATH_MAX] = { 0 };
+
+        cache->next_seq = seg->seq + 1;
+        if (0 != disk_scan_seg(cache, seg) || 0 == seg->count) {
+            seg_path(cache, seg->seq, path);
+            unlink(path);
+            DL_DELETE(cache->segs, seg);
+            free(seg);
+            continue;
+        }
+        cache->disk_used += seg->size;
+        cache->disk_count += seg->count;
+    }
+
+    if (cache->disk_count > 0) {
+        log(notice, "load %zu cached messages from %s", cache->disk_count,
+            cache->dir);
+    }
+
+    // the configured size may be smaller than last time
+    while (cache->segs && cache->disk_used > cache->disk_size) {
+        disk_drop_head(cache);
+    }
+}
+
+// move all records of the memory ring to the disk log
+static void mem_spill(mqtt_cache_t *cache)
+{
+    size_t lost = 0;
+
+    while (cache->mem_count > 0) {
+        rec_hdr_t      hdr = { 0 };
+        const uint8_t *a = NULL, *b = NULL;
+        size_t         a_len = 0, b_len = 0;
+
+        ring_read(cache, &hdr, sizeof(hdr));
+        ring_take(cache, hdr.topic_len + hdr.len, &a, &a_len, &b, &b_len);
+        ring_skip(cache, MEM_TRAILER);
+        cache->mem_count -= 1;
+        if (0 != disk_append(cache, &hdr, a, a_len, b, b_len)) {
+            ++lost;
+        }
+    }
+
+    if (lost > 0) {
+        log(error, "spill cache memory to disk fail, drop %zu messages", lost);
+    }
+}
+
+mqtt_cache_t *mqtt_cache_new(const char *dir, size_t mem_size,
+                             size_t disk_size, zlog_category_t *log)
+{
+    mqtt_cache_t *cache = calloc(1, sizeof(*cache));
+    if (NULL == cache) {
+        return NULL;
+    }
+
+    cache->dir = strdup(dir);
+    if (NULL == cache->dir) {
+        free(cache);
+        return NULL;
+    }
+
+    cache->log       = log;
+    cache->mem_size  = mem_size;
+    cache->disk_size = disk_size;
+    cache->seg_size  = disk_size / SEG_NUM;
+    if (cache->seg_size < SEG_SIZE_MIN) {
+        cache->seg_size = SEG_SIZE_MIN;
+    } else if (cache->seg_size > SEG_SIZE_MAX) {
+        cache->seg_size = SEG_SIZE_MAX;
+    }
+
+    if (disk_size > 0) {
+        if (0 != make_dir(dir)) {
+            log(error, "mkdir %s fail: %s", dir, strerror(errno));
+            free(cache->dir);
+            free(cache);
+            return NULL;
+        }
+        disk_load(cache);
+    }
+
+    pthread_mutex_init(&cache->mtx, NULL);
+    return cache;
+}
+
+void mqtt_cache_free(mqtt_cache_t *cache)
+{
+    if (NULL == cache) {
+        return;
+    }
+
+    if (cache->disk_size > 0) {
+        // keep memory messages for the next run
+        mem_spill(cache);
+    } else if (cache->mem_count > 0) {
+        log(warn, "drop %zu cached messages", cache->mem_count);
+    }
+
+    disk_seal(cache);
+    if (cache->rfp) {
+        fclose(cache->rfp);
+    }
+
+    seg_t *seg = NULL, *tmp = NULL;
+    DL_FOREACH_SAFE(cache->segs, seg, tmp)
+    {
+        DL_DELETE(cache->segs, seg);
+        free(seg);
+    }
+
+    pthread_mutex_destroy(&cache->mtx);
+    free(cache->buf);
+    free(cache->mem);
+    free(cache->dir);
+    free(cache);
+}
+
+size_t mqtt_cache_count(mqtt_cache_t *cache)
+{
+    size_t count = 0;
+
+    pthread_mutex_lock(&cache->mtx);
+    count = cache->mem_count + cache->disk_count;
+    pthread_mutex_unlock(&cache->mtx);
+
+    return count;
+}
+
+size_t mqtt_cache_bytes(mqtt_cache_t *cache)
+{
+    size_t bytes = 0;
+
+    pthread_mutex_lock(&cache->mtx);
+    // records already popped from the head segment are no longer counted
+    bytes = cache->mem_used + cache->disk_used - (cache->rfp ? cache->roff : 0);
+    pthread_mutex_unlock(&cache->mtx);
+
+    return bytes;
+}
+
+int mqtt_cache_push(mqtt_cache_t *cache, neu_mqtt_qos_e qos, int flags,
+                    const char *topic, const uint8_t *payload, uint32_t len)
+{
+    int       rv        = 0;
+    bool      evict     = !(flags & NEU_MQTT_PUBLISH_NO_EVICT);
+    size_t    topic_len = strlen(topic);
+    rec_hdr_t hdr       = {
+        .len       = len,
+        .topic_len = (uint16_t) topic_len,
+        .qos       = (uint8_t)(((uint8_t) qos & REC_QOS_MASK) |
+                         (flags & NEU_MQTT_PUBLISH_RETAIN ? REC_RETAIN : 0)),
+        .magic     = REC_MAGIC,
+    };
+    size_t   size  = rec_size(&hdr);
+    size_t   msize = size + MEM_TRAILER; // in the memory ring
+    uint32_t trail = (uint32_t) size;
+
+    if (topic_len > UINT16_MAX) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&cache->mtx);
+
+    if (msize <= cache->mem_size - cache->mem_used &&
+        0 == ring_reserve(cache, msize)) {
+        goto write;
+    }
+
+    if (cache->disk_size > 0) {
+        if (!evict &&
+            cache->disk_used + cache->mem_used + size > cache->disk_size) {
+            rv = -1;
+            goto end;
+        }
+        mem_spill(cache);
+    } else {
+        while (cache->mem_count > 0 &&
+               msize > cache->mem_size - cache->mem_used) {
+            if (!evict) {
+                rv = -1;
+                goto end;
+            }
+            ring_drop(cache);
+            log(warn, "cache memory full, drop oldest message");
+        }
+    }
+
+    if (msize > cache->mem_size || 0 != ring_reserve(cache, msize)) {
+        rv = cache->disk_size > 0
+            ? disk_append(cache, &hdr, topic, topic_len, payload, len)
+            : -1;
+        goto end;
+    }
+
+write:
+    ring_write(cache, &hdr, sizeof(hdr));
+    ring_write(cache, topic, topic_len);
+    ring_write(cache, payload, len);
+    ring_write(cache, &trail, sizeof(trail));
+    cache->mem_count += 1;
+
+end:
+    pthread_mutex_unlock(&cache->mtx);
+    return rv;
+}
+
+int mqtt_cache_pop(mqtt_cache_t *cache, bool newest, neu_mqtt_qos_e *qos,
+                   int *flags, const char **topic, const uint8_t **payload,
+                   uint32_t *len)
+{
+    rec_hdr_t hdr = { 0 };
+    int       rv  = 0;
+
+    pthread_mutex_lock(&cache->mtx);
+
+    // disk records are older than memory records
+    if (newest) {
+        rv = 0 == cache->mem_count ? disk_pop(cache, &hdr)
+                                   : ring_pop(cache, &hdr, true);
+    } else if (0 != disk_pop(cache, &hdr)) {
+        rv = ring_pop(cache, &hdr, false);
+    }
+    if (0 != rv) {
+        pthread_mutex_unlock(&cache->mtx);
+        return -1;
+    }
+
+    *qos     = hdr.qos & REC_QOS_MASK;
+    *flags   = hdr.qos & REC_RETAIN ? NEU_MQTT_PUBLISH_RETAIN : 0;
+    *topic   = (const char *) cache->buf;
+    *payload = cache->buf + hdr.topic_len + 1;
+    *len     = hdr.len;
+
+    pthread_mutex_unlock(&cache->mtx);
+    return 0;
+}
+
+void mqtt_cache_sync(mqtt_cache_t *cache)
+{
+    pthread_mutex_lock(&cache->mtx);
+    if (cache->wfp && cache->dirty) {
+        if (0 != fflush(cache->wfp) || 0 != fsync(fileno(cache->wfp))) {
+            log(error, "sync cache segment fail: %s", strerror(errno));
+        }
+        cache->dirty = false;
+    }
+    pthread_mutex_unlock(&cache->mtx);
+}
@@ -0,0 +1,72 @@
+/**
+ * NEURON IIoT System for Industry 4.0
+ * Copyright (C) 2020-2023 EMQ Technologies Co., Ltd All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ **/
+
+#ifndef CONNECTION_MQTT_CACHE_H
+#define CONNECTION_MQTT_CACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "connection/mqtt_client.h"
+#include "utils/zlog.h"
+
+// Offline message cache of the mqtt client.
+//
+// Messages are kept in a byte ring of `mem_size` bytes first. When the ring
+// is full its content is spilled, oldest first, to an append-only log of
+// segment files in `dir` bounded by `disk_size` bytes, and the oldest
+// segment is dropped when the log is full. Writes to the log are buffered
+// and only fsynced by mqtt_cache_sync, and the ring is spilled on free, so
+// messages survive a restart and segments left in `dir` are loaded by
+// mqtt_cache_new.
+//
+// Messages are popped in the order they were pushed, or newest first from
+// the memory ring and then in order from the log, which is only read forward.
+// Delivery is at least once across restarts: popped messages of a segment
+// still being read are loaded again by the next run. All functions are
+// thread safe.
+typedef struct mqtt_cache mqtt_cache_t;
+
+// `disk_size` may be 0 for a memory only cache, which then drops its oldest
+// messages when full
+mqtt_cache_t *mqtt_cache_new(const char *dir, size_t mem_size,
+                             size_t disk_size, zlog_category_t *log);
+void          mqtt_cache_free(mqtt_cache_t *cache);
+
+size_t mqtt_cache_count(mqtt_cache_t *cache);
+// about the bytes of the messages not popped yet
+size_t mqtt_cache_bytes(mqtt_cache_t *cache);
+
+// `flags` are neu_mqtt_publish_flag_e, the retain flag is kept with the
+// message, and no older message is dropped to make room if the no evict flag
+// is set. Return -1 if the message does not fit or could not be written.
+int mqtt_cache_push(mqtt_cache_t *cache, neu_mqtt_qos_e qos, int flags,
+                    const char *topic, const uint8_t *payload, uint32_t len);
+// pop the oldest message, or the newest one of the memory ring if `newest` is
+// set, `topic` and `payload` point into the cache and are valid until the
+// next call, return -1 if the cache is empty
+int mqtt_cache_pop(mqtt_cache_t *cache, bool newest, neu_mqtt_qos_e *qos,
+                   int *flags, const char **topic, const uint8_t **payload,
+                   uint32_t *len);
+
+// flush and fsync what was written to the log since the last call
+void mqtt_cache_sync(mqtt_cache_t *cache);
+
+#endif
@@ -19,6 +19,7 @@
 
 #include <assert.h>
 #include <inttypes.h>
+#include <pthread.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
@@ -26,7 +27,6 @@
 #include <arpa/inet.h>
 
 #define NNG_SUPP_TLS 1
-#define NNG_SUPP_SQLITE 1
 #include <nng/mqtt/mqtt_client.h>
 #include <nng/nng.h>
 #include <nng/supplemental/tls/tls.h>
@@ -41,6 +41,9 @@
 #include "utils/utlist.h"
 #include "utils/zlog.h"
 
+#include "mqtt_cache.h"
+#include "topic_trie.h"
+
 #define log(level, ...)                               \
     do {                                              \
         if (client->log) {                            \
@@ -58,8 +61,44 @@
         }                                                                  \
     } while (0)
 
+// replay at most REPLAY_BATCH cached messages every cache sync interval, and
+// none while REPLAY_INFLIGHT replayed messages are not delivered yet, so that
+// live messages keep flowing and always find free tasks. The share of the
+// in-flight window and the byte rate of replays bound them further.
+#define REPLAY_BATCH 128
+#define REPLAY_INFLIGHT 256
+
+// topics a handler is passed without an allocation
+#define RECV_TOPIC_BUF 256
+
+// Parsed TLS configs shared by the clients with the same server name, CA and
+// certificates, e.g. the connections of a plugin, and kept across settings
+// updates that leave them unchanged. The key holds the inputs of the config,
+// a config is freed with its last client. NNG takes its own reference for
+// each dialer, so a config outlives the clients dialing with it.
+typedef struct {
+    char *          key;
+    nng_tls_config *cfg;
+    size_t          ref;
+    UT_hash_handle  hh;
+} tls_share_t;
+
+static pthread_mutex_t tls_share_mtx = PTHREAD_MUTEX_INITIALIZER;
+static tls_share_t *   tls_shares    = NULL;
+
+// MQTT 5 topic aliases assigned to the topics published on a connection, at
+// most the Topic Alias Maximum of the broker, forgotten on disconnect. Until
+// the message assigning an alias is delivered, messages on its topic keep
+// carrying the topic, as they may reach the broker before that message.
+typedef struct {
+    char *         topic;
+    uint16_t       alias;
+    bool           known; // the broker has the topic of the alias
+    UT_hash_handle hh;
+} topic_alias_t;
+
 typedef struct {
-    size_t                         ref;
+    size_t                         ref; // atomic, see subscription_ref
     bool                           ack;
     neu_mqtt_qos_e                 qos;
     char *                         topic;
@@ -68,26 +107,41 @@ typedef struct {
     UT_hash_handle                 hh;
 } subscription_t;
 
+// The subscriptions by topic filter. A table is never changed once published,
+// a subscription change publishes a new one, and a received message is matched
+// without a lock holding a reference to the table it was matched in.
+typedef struct {
+    size_t           ref;
+    topic_trie_t *   trie;
+    size_t           n_sub;
+    subscription_t **subs;
+} sub_table_t;
+
+typedef struct {
+    neu_mqtt_client_t *client;
+    nng_aio *          aio;
+    bool               receiving;
+} recv_aio_t;
+
 typedef enum {
     TASK_PUB,
     TASK_SUB,
     TASK_UNSUB,
-    TASK_RECV,
 } task_kind_e;
 
 #define TASK_UNION_FIELDS                     \
     struct {                                  \
         neu_mqtt_client_publish_cb_t cb;      \
         neu_mqtt_qos_e               qos;     \
+        int                          flags;   \
         char *                       topic;   \
         uint8_t *                    payload; \
         uint32_t                     len;     \
         void *                       data;    \
+        int64_t                      ts;      \
+        uint32_t                     alias;   \
     } pub;                                    \
-    subscription_t *sub;                      \
-    struct {                                  \
-        subscription_t *sub;                  \
-    } recv
+    subscription_t *sub
 
 typedef union {
     TASK_UNION_FIELDS;
@@ -113,6 +167,9 @@ struct neu_mqtt_client_s {
     uint16_t                        port;
     char *                          url;
     nng_tls_config *                tls_cfg;
+    tls_share_t *                   tls_share;
+    nng_duration                    reconnect_min; // of the dialer back-off
+    nng_duration                    reconnect_max;
     nng_msg *                       conn_msg;
     nng_duration                    retry;
     bool                            open;
@@ -121,10 +178,36 @@ struct neu_mqtt_client_s {
     void *                          connect_cb_data;
     neu_mqtt_client_connection_cb_t disconnect_cb;
     void *                          disconnect_cb_data;
-    nng_mqtt_sqlite_option *        sqlite_cfg;
-    bool                            receiving;
-    nng_aio *                       recv_aio;
+    neu_mqtt_client_latency_cb_t    latency_cb;
+    void *                          latency_cb_data;
+    neu_mqtt_client_inflight_cb_t   inflight_cb;
+    void *                          inflight_cb_data;
+    size_t                          inflight_msgs; // publishes in flight
+    size_t                          inflight_bytes;
+    size_t                          inflight_max_msgs; // 0 for no bound
+    size_t                          inflight_max_bytes;
+    bool                            congested; // the window is full
+    size_t                          cache_mem_size;
+    size_t                          cache_disk_size;
+    mqtt_cache_t *                  cache;
+    neu_event_timer_t *             cache_timer;
+    size_t                          replaying;
+    size_t                          replay_bytes; // of the replays in flight
+    size_t                          replay_rate;  // bytes per second, 0 off
+    uint8_t                         replay_share; // percent of the window
+    bool                            replay_newest;
+    int64_t                         replay_tokens; // negative once overdrawn
+    int64_t                         replay_ts;     // of the last round
+    size_t                          replay_pace;   // bytes per second lately
+    recv_aio_t *                    recvs;
+    uint16_t                        n_recv;
+    size_t                          dispatching; // handlers running, atomic
+    nng_mtx *                       subs_mtx;    // guards the swap of subs
+    sub_table_t *                   subs;
     subscription_t *                subscriptions;
+    topic_alias_t *                 aliases;
+    uint16_t                        alias_max; // of the broker, 0 if none
+    uint32_t                        alias_gen; // of aliases, one per reset
     size_t                          suback_count;
     size_t                          task_count;
     size_t                          task_limit;
@@ -139,7 +222,6 @@ static void           task_cb(void *arg);
 static void           task_handle_pub(task_t *task, neu_mqtt_client_t *client);
 static void           task_handle_sub(task_t *task, neu_mqtt_client_t *client);
 static void task_handle_unsub(task_t *task, neu_mqtt_client_t *client);
-static void task_handle_recv(task_t *task, neu_mqtt_client_t *client);
 
 static subscription_t *       subscription_new(neu_mqtt_client_t *client,
                                                neu_mqtt_qos_e qos, const char *topic,
@@ -148,9 +230,13 @@ static subscription_t *       subscription_new(neu_mqtt_client_t *client,
 static inline void            subscription_free(subscription_t *subscription);
 static inline subscription_t *subscription_ref(subscription_t *subscription);
 static inline void            subscriptions_free(subscription_t *subscriptions);
+static void                   sub_table_put(sub_table_t *table);
 
 static void recv_cb(void *arg);
 static int  resub_cb(void *data);
+static int  cache_cb(void *data);
+static void replay_cb(int errcode, neu_mqtt_qos_e qos, char *topic,
+                      uint8_t *payload, uint32_t len, void *data);
 static void disconnect_cb(nng_pipe p, nng_pipe_ev ev, void *arg);
 static void connect_cb(nng_pipe p, nng_pipe_ev ev, void *arg);
 
@@ -161,9 +247,25 @@ static inline void    client_add_subscription(neu_mqtt_client_t *client,
                                               subscription_t *   sub);
 static int            client_send_sub_msg(neu_mqtt_client_t *client,
                                           subscription_t *   subscription);
+static int            client_alloc_recv(neu_mqtt_client_t *client);
 static inline void    client_start_recv(neu_mqtt_client_t *client);
+static void           client_reset_aliases(neu_mqtt_client_t *client,
+                                           uint16_t           alias_max);
+static void client_confirm_alias(neu_mqtt_client_t *client, const char *topic,
+                                 uint32_t gen);
+static bool           client_inflight_acquire(neu_mqtt_client_t *client,
+                                              uint32_t len, bool bounded);
+static void           client_inflight_release(neu_mqtt_client_t *client,
+                                              uint32_t           len);
+static void           client_publish_subs(neu_mqtt_client_t *client);
 static inline int     client_start_timer(neu_mqtt_client_t *client);
 static inline int     client_make_url(neu_mqtt_client_t *client);
+static int            client_open_cache(neu_mqtt_client_t *client);
+static int            client_publish(neu_mqtt_client_t *client,
+                                     neu_mqtt_qos_e qos, int flags, char *topic,
+                                     const uint8_t *buf, uint8_t *payload,
+                                     uint32_t len, void *data,
+                                     neu_mqtt_client_publish_cb_t cb);
 
 static inline uint8_t neu_mqtt_version_to_nng_mqtt_version(neu_mqtt_version_e v)
 {
@@ -222,6 +324,7 @@ static void task_cb(void *arg)
     task_t *           task   = arg;
     nng_aio *          aio    = task->aio;
     neu_mqtt_client_t *client = nng_aio_get_input(aio, 0);
+    uint32_t           len    = task->pub.len;
 
     if (TASK_PUB == task->kind) {
         task_handle_pub(task, client);
@@ -229,31 +332,57 @@ static void task_cb(void *arg)
         task_handle_sub(task, client);
     } else if (TASK_UNSUB == task->kind) {
         task_handle_unsub(task, client);
-    } else if (TASK_RECV == task->kind) {
-        task_handle_recv(task, client);
     } else {
         log(error, "unexpected task kind:%d", task->kind);
         assert(!"logic error, task kind not exhausted");
     }
 
     nng_mtx_lock(client->mtx);
+    if (TASK_PUB == task->kind) {
+        client_inflight_release(client, len);
+    }
     client_free_task(client, task);
     nng_mtx_unlock(client->mtx);
 }
 
 static void task_handle_pub(task_t *task, neu_mqtt_client_t *client)
 {
-    nng_aio *aio = task->aio;
+    nng_aio *     aio   = task->aio;
+    mqtt_cache_t *cache = NULL;
 
     int rv = 0;
     if (0 != (rv = nng_aio_result(aio))) {
         nng_msg *msg = nng_aio_get_msg(aio);
-        nng_msg_free(msg);
         log(error, "send PUBLISH error: %s", nng_strerror(rv));
         log(error, "pub [%s, QoS%d] fail", task->pub.topic, task->pub.qos);
+
+        nng_mtx_lock(client->mtx);
+        cache = client->connected ? NULL : client->cache;
+        nng_mtx_unlock(client->mtx);
+
+        // lost the connection in flight, keep the message for replay
+        if (cache && msg) {
+            uint32_t len     = 0;
+            uint8_t *payload = nng_mqtt_msg_get_publish_payload(msg, &len);
+            if (0 ==
+                mqtt_cache_push(cache, task->pub.qos, task->pub.flags,
+                                task->pub.topic, payload, len)) {
+                log(debug, "cache [%s, QoS%d] %" PRIu32 " bytes",
+                    task->pub.topic, task->pub.qos, len);
+                rv = 0;
+            }
+        }
+        nng_msg_free(msg);
     } else {
         log(debug, "pub [%s, QoS%d] %" PRIu32 " bytes", task->pub.topic,
             task->pub.qos, task->pub.len);
+        if (task->pub.alias) {
+            client_confirm_alias(client, task->pub.topic, task->pub.alias);
+        }
+        if (client->latency_cb) {
+            client->latency_cb(neu_time_ms() - task->pub.ts,
+                               client->latency_cb_data);
+        }
     }
 
     if (task->pub.cb) {
@@ -338,20 +467,6 @@ end:
     return;
 }
 
-static void task_handle_recv(task_t *task, neu_mqtt_client_t *client)
-{
-    (void) client;
-
-    nng_msg *msg = nng_aio_get_msg(task->aio);
-    uint32_t payload_len;
-    uint8_t *payload = nng_mqtt_msg_get_publish_payload(msg, &payload_len);
-
-    task->recv.sub->cb(task->recv.sub->qos, task->recv.sub->topic, payload,
-                       payload_len, task->recv.sub->data);
-
-    nng_msg_free(msg);
-}
-
 static subscription_t *subscription_new(neu_mqtt_client_t *client,
                                         neu_mqtt_qos_e qos, const char *topic,
                                         neu_mqtt_client_subscribe_cb_t cb,
@@ -381,9 +496,11 @@ static subscription_t *subscription_new(neu_mqtt_client_t *client,
     return subscription;
 }
 
+// the last reference may be dropped by a receive callback, without the lock
 static inline void subscription_free(subscription_t *subscription)
 {
-    if (subscription && (0 == --subscription->ref)) {
+    if (subscription &&
+        0 == __atomic_sub_fetch(&subscription->ref, 1, __ATOMIC_ACQ_REL)) {
         free(subscription->topic);
         free(subscription);
     }
@@ -391,7 +508,7 @@ static inline void subscription_free(subscription_t *subscription)
 
 static inline subscription_t *subscription_ref(subscription_t *subscription)
 {
-    ++subscription->ref;
+    __atomic_add_fetch(&subscription->ref, 1, __ATOMIC_RELAXED);
     return subscription;
 }
 
@@ -405,6 +522,61 @@ static inline void subscriptions_free(subscription_t *subscriptions)
     }
 }
 
+static sub_table_t *sub_table_new(neu_mqtt_client_t *client)
+{
+    sub_table_t *   table = calloc(1, sizeof(*table));
+    subscription_t *sub   = NULL;
+    size_t          i     = 0;
+
+    if (NULL == table) {
+        return NULL;
+    }
+
+    table->ref  = 1;
+    table->trie = topic_trie_new();
+    table->subs =
+        calloc(HASH_COUNT(client->subscriptions) + 1, sizeof(subscription_t *));
+    if (NULL == table->trie || NULL == table->subs) {
+        sub_table_put(table);
+        return NULL;
+    }
+
+    HASH_LOOP(hh, client->subscriptions, sub)
+    {
+        if (0 != topic_trie_add(table->trie, sub->topic, sub)) {
+            sub_table_put(table);
+            return NULL;
+        }
+        table->subs[i++] = subscription_ref(sub);
+        table->n_sub     = i;
+    }
+
+    return table;
+}
+
+static void sub_table_put(sub_table_t *table)
+{
+    if (table && 0 == __atomic_sub_fetch(&table->ref, 1, __ATOMIC_ACQ_REL)) {
+        for (size_t i = 0; i < table->n_sub; ++i) {
+            subscription_free(table->subs[i]);
+        }
+        free(table->subs);
+        topic_trie_free(table->trie);
+        free(table);
+    }
+}
+
+static sub_table_t *client_get_subs(neu_mqtt_client_t *client)
+{
+    nng_mtx_lock(client->subs_mtx);
+    sub_table_t *table = client->subs;
+    if (table) {
+        __atomic_add_fetch(&table->ref, 1, __ATOMIC_RELAXED);
+    }
+    nng_mtx_unlock(client->subs_mtx);
+    return table;
+}
+
 static int resub_cb(void *data)
 {
     neu_mqtt_client_t *client = data;
@@ -426,17 +598,151 @@ static int resub_cb(void *data)
     return 0;
 }
 
+// the share of a window bound, at least one unit if bounded
+static inline size_t replay_share_of(size_t max, uint8_t share)
+{
+    size_t n = max / 100 * share + max % 100 * share / 100;
+    return 0 == max ? SIZE_MAX : (0 == n ? 1 : n);
+}
+
+// Replays take what live publishes leave: none while the window is full, and
+// at most the replay share of it otherwise. The byte rate is paced with a
+// token bucket holding up to one second or one round of tokens.
+static int cache_cb(void *data)
+{
+    neu_mqtt_client_t *client  = data;
+    mqtt_cache_t *     cache   = NULL;
+    size_t             budget  = 0;
+    size_t             room    = 0;
+    size_t             rate    = 0;
+    size_t             sent    = 0;
+    int64_t            tokens  = 0;
+    int64_t            now     = neu_time_ms();
+    int64_t            elapsed = 0;
+    bool               newest  = false;
+    neu_mqtt_qos_e     qos     = NEU_MQTT_QOS0;
+    int                flags   = 0;
+    const char *       topic   = NULL;
+    const uint8_t *    payload = NULL;
+    uint32_t           len     = 0;
+
+    nng_mtx_lock(client->mtx);
+    cache   = client->cache;
+    rate    = client->replay_rate;
+    newest  = client->replay_newest;
+    elapsed = 0 == client->replay_ts ? 0 : now - client->replay_ts;
+    elapsed = elapsed < 0 ? 0 : elapsed;
+    client->replay_ts = now;
+    if (0 != rate) {
+        int64_t round = client->retry > 1000 ? client->retry : 1000;
+        int64_t burst = (int64_t) rate * round / 1000;
+
+        tokens = client->replay_tokens + (int64_t) rate * elapsed / 1000;
+        tokens = tokens < burst ? tokens : burst;
+    }
+    if (client->connected && !client->congested) {
+        size_t max = replay_share_of(client->inflight_max_msgs,
+                                     client->replay_share);
+        size_t max_bytes = replay_share_of(client->inflight_max_bytes,
+                                           client->replay_share);
+
+        max    = max < REPLAY_INFLIGHT ? max : REPLAY_INFLIGHT;
+        budget = client->replaying < max ? max - client->replaying : 0;
+        budget = budget < REPLAY_BATCH ? budget : REPLAY_BATCH;
+        room   = client->replay_bytes < max_bytes
+            ? max_bytes - client->replay_bytes
+            : 0;
+    }
+    nng_mtx_unlock(client->mtx);
+
+    // writes to the disk log are fsynced in batches here
+    mqtt_cache_sync(cache);
+
+    // a message larger than what is left still goes out, and overdraws it
+    for (; budget > 0 && room > 0 && (0 == rate || tokens > 0); --budget) {
+        if (0 != mqtt_cache_pop(cache, newest, &qos, &flags, &topic, &payload,
+                                &len)) {
+            break;
+        }
+
+        // the topic must outlive the delivery, freed in replay_cb
+        char *t = strdup(topic);
+        if (NULL != t) {
+            nng_mtx_lock(client->mtx);
+            ++client->replaying;
+            client->replay_bytes += len;
+            nng_mtx_unlock(client->mtx);
+
+            if (0 == client_publish(client, qos, flags, t, payload, NULL, len,
+                                    client, replay_cb)) {
+                room = room > len ? room - len : 0;
+                tokens -= len;
+                sent += len;
+                continue;
+            }
+            replay_cb(-1, qos, t, NULL, len, client);
+        }
+
+        // put it back and retry in the next round
+        log(error, "replay cached [%s, QoS%d] fail", topic, qos);
+        mqtt_cache_push(cache, qos, flags, topic, payload, len);
+        break;
+    }
+
+    nng_mtx_lock(client->mtx);
+    client->replay_tokens = tokens;
+    if (elapsed > 0) {
+        // smoothed over a few rounds for the estimate of the replay time
+        client->replay_pace =
+            (client->replay_pace * 3 + sent * 1000 / elapsed) / 4;
+    }
+    nng_mtx_unlock(client->mtx);
+
+    return 0;
+}
+
+static void replay_cb(int errcode, neu_mqtt_qos_e qos, char *topic,
+                      uint8_t *payload, uint32_t len, void *data)
+{
+    (void) errcode;
+    (void) qos;
+    (void) payload;
+    neu_mqtt_client_t *client = data;
+
+    free(topic);
+
+    nng_mtx_lock(client->mtx);
+    --client->replaying;
+    client->replay_bytes -= len;
+    nng_mtx_unlock(client->mtx);
+}
+
 static void connect_cb(nng_pipe p, nng_pipe_ev ev, void *arg)
 {
-    (void) p;
     (void) ev;
     neu_mqtt_client_t *             client = arg;
     neu_mqtt_client_connection_cb_t cb     = NULL;
     void *                          data   = NULL;
+    uint16_t                        alias  = 0;
+
+    if (NEU_MQTT_VERSION_V5 == client->version) {
+        property *     prop = NULL;
+        property_data *max  = NULL;
+        if (0 == nng_pipe_get_ptr(p, NNG_OPT_MQTT_CONNECT_PROPERTY,
+                                  (void **) &prop) &&
+            NULL != prop) {
+            max = mqtt_property_get_value(prop, TOPIC_ALIAS_MAXIMUM);
+        }
+        if (NULL != max) {
+            alias = max->p_value.u16;
+        }
+    }
 
-    log(notice, "mqtt client connected");
+    log(notice, "mqtt client connected, topic alias maximum: %" PRIu16, alias);
 
     nng_mtx_lock(client->mtx);
+    // aliases are per connection
+    client_reset_aliases(client, alias);
     // start receiving
     client_start_recv(client);
 
@@ -465,6 +771,7 @@ static void disconnect_cb(nng_pipe p, nng_pipe_ev ev, void *arg)
     client->connected = false;
     cb                = client->disconnect_cb;
     data              = client->disconnect_cb_data;
+    client_reset_aliases(client, 0);
     HASH_LOOP(hh, client->subscriptions, sub) { sub->ack = false; }
     client->suback_count = 0;
     nng_mtx_unlock(client->mtx);
@@ -474,12 +781,55 @@ static void disconnect_cb(nng_pipe p, nng_pipe_ev ev, void *arg)
     }
 }
 
+// the handler of the subscription matching topic gets the topic of the
+// message, which is that of the subscription unless it has wildcards
+static void recv_dispatch(neu_mqtt_client_t *client, nng_msg *msg)
+{
+    uint32_t    payload_len;
+    uint8_t *   payload = nng_mqtt_msg_get_publish_payload(msg, &payload_len);
+    uint32_t    topic_len;
+    const char *topic = nng_mqtt_msg_get_publish_topic(msg, &topic_len);
+    uint8_t     qos   = nng_mqtt_msg_get_publish_qos(msg);
+    char        buf[RECV_TOPIC_BUF];
+    char *      name = buf;
+
+    log(debug, "recv [%.*s, QoS%d] %" PRIu32 " bytes", (unsigned) topic_len,
+        topic, (int) qos, payload_len);
+
+    sub_table_t *   subs = client_get_subs(client);
+    subscription_t *sub =
+        subs ? topic_trie_match(subs->trie, topic, topic_len) : NULL;
+    if (NULL == sub) {
+        log(warn, "[%.*s] no subscription found", (unsigned) topic_len, topic);
+        sub_table_put(subs);
+        return;
+    }
+
+    if (topic_len >= sizeof(buf) && NULL == (name = malloc(topic_len + 1))) {
+        log(error, "malloc topic fail");
+        sub_table_put(subs);
+        return;
+    }
+    memcpy(name, topic, topic_len);
+    name[topic_len] = '\0';
+
+    sub->cb(sub->qos, name, payload, payload_len, sub->data);
+
+    if (name != buf) {
+        free(name);
+    }
+    sub_table_put(subs);
+}
+
+// Each of the receive aios of the client takes the next message as soon as
+// it handed the last one to its handler, so that handlers of messages run
+// concurrently and messages may be handled out of order.
 static void recv_cb(void *arg)
 {
-    int                rv           = 0;
-    subscription_t *   subscription = arg;
-    neu_mqtt_client_t *client       = arg;
-    nng_aio *          aio          = client->recv_aio;
+    int                rv     = 0;
+    recv_aio_t *       r      = arg;
+    neu_mqtt_client_t *client = r->client;
+    nng_aio *          aio    = r->aio;
 
     if (0 != (rv = nng_aio_result(aio))) {
         log(error, "mqtt client recv error: %s", nng_strerror(rv));
@@ -487,7 +837,7 @@ static void recv_cb(void *arg)
             nng_recv_aio(client->sock, aio);
         } else {
             nng_mtx_lock(client->mtx);
-            client->receiving = false;
+            r->receiving = false;
             nng_mtx_unlock(client->mtx);
         }
         return;
@@ -507,35 +857,9 @@ static void recv_cb(void *arg)
         goto end;
     }
 
-    uint32_t    payload_len;
-    uint8_t *   payload = nng_mqtt_msg_get_publish_payload(msg, &payload_len);
-    uint32_t    topic_len;
-    const char *topic = nng_mqtt_msg_get_publish_topic(msg, &topic_len);
-    uint8_t     qos   = nng_mqtt_msg_get_publish_qos(msg);
-
-    (void) payload;
-    log(debug, "recv [%.*s, QoS%d] %" PRIu32 " bytes", (unsigned) topic_len,
-        topic, (int) qos, payload_len);
-
-    // find matching subscription
-    // NOTE: does not support wildcards
-    nng_mtx_lock(client->mtx);
-    HASH_FIND(hh, client->subscriptions, topic, topic_len, subscription);
-    if (NULL != subscription) {
-        task_t *task = client_alloc_task(client);
-        if (NULL != task) {
-            task->kind     = TASK_RECV;
-            task->recv.sub = subscription_ref(subscription);
-            nng_aio_set_msg(task->aio, msg);
-            msg = NULL;
-            nng_aio_finish(task->aio, 0);
-        } else {
-            log(error, "client_alloc_task fail");
-        }
-    } else {
-        log(warn, "[%.*s] no subscription found", (unsigned) topic_len, topic);
-    }
-    nng_mtx_unlock(client->mtx);
+    __atomic_add_fetch(&client->dispatching, 1, __ATOMIC_ACQ_REL);
+    recv_dispatch(client, msg);
+    __atomic_sub_fetch(&client->dispatching, 1, __ATOMIC_ACQ_REL);
 
 end:
     nng_msg_free(msg);
@@ -580,8 +904,6 @@ static inline void client_free_task(neu_mqtt_client_t *client, task_t *task)
 
     if (TASK_SUB == task->kind || TASK_UNSUB == task->kind) {
         subscription_free(task->sub);
-    } else if (TASK_RECV == task->kind) {
-        subscription_free(task->recv.sub);
     }
 
     memset(&task->pub, 0, sizeof(task_union));
@@ -589,6 +911,62 @@ static inline void client_free_task(neu_mqtt_client_t *client, task_t *task)
     DL_PREPEND(client->task_free_list, task);
 }
 
+static void client_set_congested(neu_mqtt_client_t *client, bool congested)
+{
+    if (client->congested == congested) {
+        return;
+    }
+
+    client->congested = congested;
+    log(notice, "in-flight window %s, %zu msgs %zu bytes",
+        congested ? "full" : "drained", client->inflight_msgs,
+        client->inflight_bytes);
+    if (client->inflight_cb) {
+        client->inflight_cb(congested, client->inflight_cb_data);
+    }
+}
+
+// take room for a publish of len bytes in the in-flight window, return false
+// if the window is full and bounded is set. A message larger than the byte
+// window still goes out once nothing else is in flight. Must be called with
+// mtx held
+static bool client_inflight_acquire(neu_mqtt_client_t *client, uint32_t len,
+                                    bool bounded)
+{
+    size_t max_msgs  = client->inflight_max_msgs;
+    size_t max_bytes = client->inflight_max_bytes;
+
+    if (bounded &&
+        ((0 != max_msgs && client->inflight_msgs >= max_msgs) ||
+         (0 != max_bytes && 0 != client->inflight_msgs &&
+          client->inflight_bytes + len > max_bytes))) {
+        client_set_congested(client, true);
+        return false;
+    }
+
+    client->inflight_msgs += 1;
+    client->inflight_bytes += len;
+    if ((0 != max_msgs && client->inflight_msgs >= max_msgs) ||
+        (0 != max_bytes && client->inflight_bytes >= max_bytes)) {
+        client_set_congested(client, true);
+    }
+    return true;
+}
+
+// must be called with mtx held
+static void client_inflight_release(neu_mqtt_client_t *client, uint32_t len)
+{
+    size_t max_msgs  = client->inflight_max_msgs;
+    size_t max_bytes = client->inflight_max_bytes;
+
+    client->inflight_msgs -= 1;
+    client->inflight_bytes -= len;
+    if ((0 == max_msgs || client->inflight_msgs <= max_msgs / 2) &&
+        (0 == max_bytes || client->inflight_bytes <= max_bytes / 2)) {
+        client_set_congested(client, false);
+    }
+}
+
 static inline size_t client_task_free_list_len(neu_mqtt_client_t *client)
 {
     size_t  count = 0;
@@ -691,18 +1069,140 @@ static int client_send_unsub_msg(neu_mqtt_client_t *client,
     return 0;
 }
 
+// allocate the receive aios on the first subscription change
+static int client_alloc_recv(neu_mqtt_client_t *client)
+{
+    int rv = 0;
+
+    if (NULL != client->recvs) {
+        return 0;
+    }
+
+    client->recvs = calloc(client->n_recv, sizeof(recv_aio_t));
+    if (NULL == client->recvs) {
+        log(error, "calloc recv aios fail");
+        return -1;
+    }
+
+    for (uint16_t i = 0; i < client->n_recv; ++i) {
+        client->recvs[i].client = client;
+        if ((rv = nng_aio_alloc(&client->recvs[i].aio, recv_cb,
+                                &client->recvs[i])) != 0) {
+            log(error, "nng_aio_alloc fail: %s", nng_strerror(rv));
+            for (uint16_t k = 0; k < i; ++k) {
+                nng_aio_free(client->recvs[k].aio);
+            }
+            free(client->recvs);
+            client->recvs = NULL;
+            return -1;
+        }
+    }
+
+    if (client->connected) {
+        // connect_cb already fired, then start receiving
+        client_start_recv(client);
+    }
+
+    return 0;
+}
+
 static inline void client_start_recv(neu_mqtt_client_t *client)
 {
-    if (client->recv_aio && !client->receiving) {
-        nng_recv_aio(client->sock, client->recv_aio);
-        client->receiving = true;
+    for (uint16_t i = 0; client->recvs && i < client->n_recv; ++i) {
+        if (!client->recvs[i].receiving) {
+            nng_recv_aio(client->sock, client->recvs[i].aio);
+            client->recvs[i].receiving = true;
+        }
     }
 }
 
+// must be called with mtx held
+static void client_reset_aliases(neu_mqtt_client_t *client,
+                                 uint16_t           alias_max)
+{
+    topic_alias_t *a = NULL, *tmp = NULL;
+
+    HASH_ITER(hh, client->aliases, a, tmp)
+    {
+        HASH_DEL(client->aliases, a);
+        free(a->topic);
+        free(a);
+    }
+    client->alias_max = alias_max;
+    client->alias_gen += 1;
+}
+
+// The alias of topic on the connection, 0 if there is none. *known is set if
+// the broker has the topic of the alias already, otherwise the message
+// carries the topic, and assigns the alias to it. Must be called with mtx
+// held.
+static uint16_t client_topic_alias(neu_mqtt_client_t *client,
+                                   const char *topic, bool *known)
+{
+    topic_alias_t *a = NULL;
+    uint16_t       n = 0;
+
+    *known = false;
+    if (0 == client->alias_max) {
+        return 0;
+    }
+
+    HASH_FIND_STR(client->aliases, topic, a);
+    if (NULL != a) {
+        *known = a->known;
+        return a->alias;
+    }
+
+    n = HASH_COUNT(client->aliases);
+    if (n >= client->alias_max || NULL == (a = calloc(1, sizeof(*a)))) {
+        return 0;
+    }
+    if (NULL == (a->topic = strdup(topic))) {
+        free(a);
+        return 0;
+    }
+    a->alias = n + 1;
+    HASH_ADD_KEYPTR(hh, client->aliases, a->topic, strlen(a->topic), a);
+    return a->alias;
+}
+
+// a message assigning the alias of topic was delivered, unless the aliases
+// were reset since, gen being the alias_gen the message was sent with
+static void client_confirm_alias(neu_mqtt_client_t *client, const char *topic,
+                                 uint32_t gen)
+{
+    topic_alias_t *a = NULL;
+
+    nng_mtx_lock(client->mtx);
+    HASH_FIND_STR(client->aliases, topic, a);
+    if (NULL != a && gen == client->alias_gen) {
+        a->known = true;
+    }
+    nng_mtx_unlock(client->mtx);
+}
+
+// must be called with mtx held, after a change of the subscriptions
+static void client_publish_subs(neu_mqtt_client_t *client)
+{
+    sub_table_t *table = sub_table_new(client);
+    if (NULL == table) {
+        log(error, "sub_table_new fail, subscriptions unchanged");
+        return;
+    }
+
+    nng_mtx_lock(client->subs_mtx);
+    sub_table_t *old = client->subs;
+    client->subs     = table;
+    nng_mtx_unlock(client->subs_mtx);
+
+    sub_table_put(old);
+}
+
 static inline int client_start_timer(neu_mqtt_client_t *client)
 {
-    neu_events_t *     events = NULL;
-    neu_event_timer_t *timer  = NULL;
+    neu_events_t *     events      = NULL;
+    neu_event_timer_t *timer       = NULL;
+    neu_event_timer_t *cache_timer = NULL;
 
     if (client->events) {
         // timer already started
@@ -727,8 +1227,26 @@ static inline int client_start_timer(neu_mqtt_client_t *client)
         return -1;
     }
 
-    client->events = events;
-    client->timer  = timer;
+    if (client->cache) {
+        // sync and replay the offline cache every cache sync interval
+        neu_event_timer_param_t cache_param = {
+            .second      = client->retry / 1000,
+            .millisecond = client->retry % 1000,
+            .cb          = cache_cb,
+            .usr_data    = client,
+        };
+
+        cache_timer = neu_event_add_timer(events, cache_param);
+        if (NULL == cache_timer) {
+            neu_event_del_timer(events, timer);
+            neu_event_close(events);
+            return -1;
+        }
+    }
+
+    client->events      = events;
+    client->timer       = timer;
+    client->cache_timer = cache_timer;
     return 0;
 }
 
@@ -757,6 +1275,43 @@ static inline int client_make_url(neu_mqtt_client_t *client)
     return 0;
 }
 
+static int client_open_cache(neu_mqtt_client_t *client)
+{
+    char *         dir = NULL;
+    const mqtt_buf client_id =
+        nng_mqtt_msg_get_connect_client_id(client->conn_msg);
+
+    if (NULL != client->cache ||
+        (0 == client->cache_mem_size && 0 == client->cache_disk_size)) {
+        return 0;
+    }
+
+    if (NULL == client_id.buf || 0 == client_id.length) {
+        log(error, "nng_mqtt_msg_get_connect_client_id fail");
+        return -1;
+    }
+
+    neu_asprintf(&dir, "persistence/neuron-mqtt-client-%.*s",
+                 (unsigned) client_id.length, (char *) client_id.buf);
+    if (NULL == dir) {
+        log(error, "neu_asprintf mqtt client cache dir fail");
+        return -1;
+    }
+
+    client->cache = mqtt_cache_new(dir, client->cache_mem_size,
+                                   client->cache_disk_size, client->log);
+    if (NULL == client->cache) {
+        log(error, "mqtt_cache_new %s fail", dir);
+        free(dir);
+        return -1;
+    }
+
+    log(notice, "cache mem:%zu disk:%zu dir:%s", client->cache_mem_size,
+        client->cache_disk_size, dir);
+    free(dir);
+    return 0;
+}
+
 static inline nng_msg *alloc_conn_msg(neu_mqtt_client_t *client,
                                       neu_mqtt_version_e version)
 {
@@ -777,7 +1332,9 @@ static inline nng_msg *alloc_conn_msg(neu_mqtt_client_t *client,
     return msg;
 }
 
-static inline nng_tls_config *alloc_tls_config(neu_mqtt_client_t *client)
+static nng_tls_config *alloc_tls_config(neu_mqtt_client_t *client,
+                                        const char *ca, const char *cert,
+                                        const char *key, const char *keypass)
 {
     int             rv  = 0;
     nng_tls_config *cfg = NULL;
@@ -787,44 +1344,112 @@ static inline nng_tls_config *alloc_tls_config(neu_mqtt_client_t *client)
         return NULL;
     }
 
+    // validate server name and enable SNI only when host is not an IP address
+    struct sockaddr_in sa;
+    if (0 == inet_pton(AF_INET, client->host, &sa.sin_addr) &&
+        0 != (rv = nng_tls_config_server_name(cfg, client->host))) {
+        log(error, "nng_tls_config_server_name fail: %s", nng_strerror(rv));
+        goto error;
+    }
+
+    if (cert != NULL && key != NULL) {
+        if ((rv = nng_tls_config_auth_mode(cfg, NNG_TLS_AUTH_MODE_REQUIRED)) !=
+            0) {
+            log(error, "nng_tls_config_auth_mode fail: %s", nng_strerror(rv));
+            goto error;
+        }
+        if ((rv = nng_tls_config_own_cert(cfg, cert, key, keypass)) != 0) {
+            log(error, "nng_tls_config_own_cert fail: %s", nng_strerror(rv));
+            goto error;
+        }
+    } else {
+        if ((rv = nng_tls_config_auth_mode(cfg, NNG_TLS_AUTH_MODE_NONE)) != 0) {
+            log(error, "nng_tls_config_auth_mode fail: %s", nng_strerror(rv));
+            goto error;
+        }
+    }
+
+    if (ca && (rv = nng_tls_config_ca_chain(cfg, ca, NULL)) != 0) {
+        log(error, "nng_tls_config_ca_chain fail: %s", nng_strerror(rv));
+        goto error;
+    }
+
     return cfg;
+
+error:
+    nng_tls_config_free(cfg);
+    return NULL;
 }
 
-static inline nng_mqtt_sqlite_option *
-alloc_sqlite_config(neu_mqtt_client_t *client)
+// the inputs of a TLS config, each prefixed with whether it is set, as an
+// absent certificate and an empty one are configured differently
+static char *tls_share_key(const char *host, const char *ca, const char *cert,
+                           const char *key, const char *keypass)
 {
-    int                     rv;
-    char *                  db  = NULL;
-    nng_mqtt_sqlite_option *cfg = NULL;
-    const mqtt_buf          client_id =
-        nng_mqtt_msg_get_connect_client_id(client->conn_msg);
+    char *s = NULL;
 
-    if (NULL == client_id.buf || 0 == client_id.length) {
-        log(error, "nng_mqtt_msg_get_connect_client_id fail");
+    if (0 >
+        neu_asprintf(&s, "%s\x1e%c%s\x1e%c%s\x1e%c%s\x1e%c%s", host,
+                     ca ? '+' : '-', ca ? ca : "", cert ? '+' : '-',
+                     cert ? cert : "", key ? '+' : '-', key ? key : "",
+                     keypass ? '+' : '-', keypass ? keypass : "")) {
         return NULL;
     }
+    return s;
+}
 
-    neu_asprintf(&db, "neuron-mqtt-client-%.*s.db", (unsigned) client_id.length,
-                 (char *) client_id.buf);
-    if (NULL == db) {
-        log(error, "neu_asprintf nano-mqtt cilent db fail");
-        return NULL;
+// take the shared config of key, parsing it on first use
+static tls_share_t *tls_share_get(neu_mqtt_client_t *client, char *key,
+                                  const char *ca, const char *cert,
+                                  const char *cert_key, const char *keypass)
+{
+    tls_share_t *share = NULL;
+
+    pthread_mutex_lock(&tls_share_mtx);
+    HASH_FIND_STR(tls_shares, key, share);
+    if (NULL == share) {
+        share = calloc(1, sizeof(*share));
+        if (NULL != share) {
+            share->cfg = alloc_tls_config(client, ca, cert, cert_key, keypass);
+        }
+        if (NULL == share || NULL == share->cfg) {
+            pthread_mutex_unlock(&tls_share_mtx);
+            free(share);
+            free(key);
+            return NULL;
+        }
+        share->key = key;
+        HASH_ADD_KEYPTR(hh, tls_shares, share->key, strlen(share->key), share);
+        log(debug, "new tls config, %u in use", HASH_COUNT(tls_shares));
+    } else {
+        free(key);
+        log(debug, "reuse tls config, %zu clients", share->ref);
     }
+    share->ref += 1;
+    pthread_mutex_unlock(&tls_share_mtx);
 
-    if ((rv = nng_mqtt_alloc_sqlite_opt(&cfg)) != 0) {
-        log(error, "nng_mqtt_alloc_sqlite_opt fail: %s", nng_strerror(rv));
-        free(db);
-        return NULL;
+    return share;
+}
+
+static void tls_share_put(tls_share_t *share)
+{
+    if (NULL == share) {
+        return;
     }
 
-    nng_mqtt_set_sqlite_enable(cfg, true);
-    nng_mqtt_set_sqlite_flush_threshold(cfg, 256);
-    nng_mqtt_set_sqlite_max_rows(cfg, 256);
-    nng_mqtt_set_sqlite_db_dir(cfg, "persistence/");
-    nng_mqtt_sqlite_db_init(cfg, db, client->version);
+    pthread_mutex_lock(&tls_share_mtx);
+    if (0 == --share->ref) {
+        HASH_DEL(tls_shares, share);
+    } else {
+        share = NULL;
+    }
+    pthread_mutex_unlock(&tls_share_mtx);
 
-    free(db);
-    return cfg;
+    if (NULL != share) {
+        nng_tls_config_free(share->cfg);
+        free(share->key);
+        free(share);
+    }
 }
 
 neu_mqtt_client_t *neu_mqtt_client_new(neu_mqtt_version_e version)
@@ -839,8 +1464,15 @@ neu_mqtt_client_t *neu_mqtt_client_new(neu_mqtt_version_e version)
         return NULL;
     }
 
+    if (0 != nng_mtx_alloc(&client->subs_mtx)) {
+        nng_mtx_free(client->mtx);
+        free(client);
+        return NULL;
+    }
+
     client->conn_msg = alloc_conn_msg(client, version);
     if (NULL == client->conn_msg) {
+        nng_mtx_free(client->subs_mtx);
         nng_mtx_free(client->mtx);
         free(client);
         return NULL;
@@ -849,6 +1481,11 @@ neu_mqtt_client_t *neu_mqtt_client_new(neu_mqtt_version_e version)
     client->version    = version;
     client->retry      = NEU_MQTT_CACHE_SYNC_INTERVAL_DEFAULT;
     client->task_limit = 1024;
+    client->n_recv     = NEU_MQTT_RECV_CONCURRENCY_DEFAULT;
+
+    client->reconnect_min = NEU_MQTT_RECONNECT_MIN_DEFAULT;
+    client->reconnect_max = NEU_MQTT_RECONNECT_MAX_DEFAULT;
+    client->replay_share  = NEU_MQTT_REPLAY_SHARE_DEFAULT;
 
     return client;
 }
@@ -872,18 +1509,20 @@ neu_mqtt_client_t *neu_mqtt_client_from_addr(const char *host, uint16_t port,
 void neu_mqtt_client_free(neu_mqtt_client_t *client)
 {
     if (client) {
-        if (client->tls_cfg) {
-            nng_tls_config_free(client->tls_cfg);
-        }
-        if (client->sqlite_cfg) {
-            nng_mqtt_free_sqlite_opt(client->sqlite_cfg);
+        tls_share_put(client->tls_share);
+        mqtt_cache_free(client->cache);
+        client_reset_aliases(client, 0);
+        for (uint16_t i = 0; client->recvs && i < client->n_recv; ++i) {
+            nng_aio_free(client->recvs[i].aio);
         }
-        nng_aio_free(client->recv_aio);
+        free(client->recvs);
+        sub_table_put(client->subs);
         subscriptions_free(client->subscriptions);
         tasks_free(client->task_free_list);
         nng_msg_free(client->conn_msg);
         free(client->url);
         free(client->host);
+        nng_mtx_free(client->subs_mtx);
         nng_mtx_free(client->mtx);
         free(client);
     }
@@ -916,14 +1555,47 @@ size_t neu_mqtt_client_get_cached_msgs_num(neu_mqtt_client_t *client)
     size_t num = 0;
 
     nng_mtx_lock(client->mtx);
-    if (NULL != client->sqlite_cfg) {
-        num = nng_mqtt_sqlite_db_get_cached_size(client->sqlite_cfg);
+    if (NULL != client->cache) {
+        num = mqtt_cache_count(client->cache);
     }
     nng_mtx_unlock(client->mtx);
 
     return num;
 }
 
+void neu_mqtt_client_get_replay(neu_mqtt_client_t *client, size_t *bytes,
+                                size_t *eta)
+{
+    size_t pace = 0;
+
+    nng_mtx_lock(client->mtx);
+    *bytes = NULL != client->cache ? mqtt_cache_bytes(client->cache) : 0;
+    pace   = 0 != client->replay_pace ? client->replay_pace
+                                      : client->replay_rate;
+    *eta   = 0 != pace ? (*bytes + pace - 1) / pace : 0;
+    nng_mtx_unlock(client->mtx);
+}
+
+void neu_mqtt_client_get_inflight(neu_mqtt_client_t *client, size_t *msgs,
+                                  size_t *bytes)
+{
+    nng_mtx_lock(client->mtx);
+    *msgs  = client->inflight_msgs;
+    *bytes = client->inflight_bytes;
+    nng_mtx_unlock(client->mtx);
+}
+
+bool neu_mqtt_client_is_congested(neu_mqtt_client_t *client)
+{
+    bool congested = false;
+
+    nng_mtx_lock(client->mtx);
+    congested = client->congested;
+    nng_mtx_unlock(client->mtx);
+
+    return congested;
+}
+
 int neu_mqtt_client_set_addr(neu_mqtt_client_t *client, const char *host,
                              uint16_t port)
 {
@@ -1029,12 +1701,27 @@ int neu_mqtt_client_set_disconnect_cb(neu_mqtt_client_t *             client,
     return 0;
 }
 
+int neu_mqtt_client_set_latency_cb(neu_mqtt_client_t *          client,
+                                   neu_mqtt_client_latency_cb_t cb,
+                                   void *                       data)
+{
+    nng_mtx_lock(client->mtx);
+    return_failure_if_open();
+
+    client->latency_cb      = cb;
+    client->latency_cb_data = data;
+    nng_mtx_unlock(client->mtx);
+
+    return 0;
+}
+
 int neu_mqtt_client_set_tls(neu_mqtt_client_t *client, bool enabled,
                             const char *ca, const char *cert, const char *key,
                             const char *keypass)
 {
-    int             rv  = 0;
-    nng_tls_config *cfg = NULL;
+    int          rv    = 0;
+    char *       id    = NULL;
+    tls_share_t *share = NULL;
 
     nng_mtx_lock(client->mtx);
     return_failure_if_open();
@@ -1042,11 +1729,7 @@ int neu_mqtt_client_set_tls(neu_mqtt_client_t *client, bool enabled,
     if (!enabled) {
         // disable tls
         log(debug, "tls disabled");
-        if (client->tls_cfg) {
-            nng_tls_config_free(client->tls_cfg);
-            client->tls_cfg = NULL;
-        }
-        goto end;
+        goto swap;
     }
 
     if (NULL == client->host) {
@@ -1055,52 +1738,31 @@ int neu_mqtt_client_set_tls(neu_mqtt_client_t *client, bool enabled,
         goto end;
     }
 
-    if (client->tls_cfg) {
-        cfg = client->tls_cfg;
-    } else {
-        cfg = alloc_tls_config(client);
-        if (NULL == cfg) {
-            log(error, "alloc_tls_config fail");
-            rv = -1;
-            goto end;
-        }
-        client->tls_cfg = cfg;
-    }
-
-    // validate server name and enable SNI only when host is not an IP address
-    struct sockaddr_in sa;
-    if (0 == inet_pton(AF_INET, client->host, &sa.sin_addr) &&
-        0 != (rv = nng_tls_config_server_name(client->tls_cfg, client->host))) {
-        log(error, "nng_tls_config_server_name fail: %s", nng_strerror(rv));
+    id = tls_share_key(client->host, ca, cert, key, keypass);
+    if (NULL == id) {
+        log(error, "tls_share_key fail");
         rv = -1;
         goto end;
     }
 
-    if (cert != NULL && key != NULL) {
-        if ((rv = nng_tls_config_auth_mode(cfg, NNG_TLS_AUTH_MODE_REQUIRED)) !=
-            0) {
-            log(error, "nng_tls_config_auth_mode fail: %s", nng_strerror(rv));
-            rv = -1;
-            goto end;
-        }
-        if ((rv = nng_tls_config_own_cert(cfg, cert, key, keypass)) != 0) {
-            log(error, "nng_tls_config_own_cert fail: %s", nng_strerror(rv));
-            rv = -1;
-            goto end;
-        }
-    } else {
-        if ((rv = nng_tls_config_auth_mode(cfg, NNG_TLS_AUTH_MODE_NONE)) != 0) {
-            log(error, "nng_tls_config_auth_mode fail: %s", nng_strerror(rv));
-            rv = -1;
-            goto end;
-        }
+    if (client->tls_share && 0 == strcmp(id, client->tls_share->key)) {
+        // unchanged, keep the parsed config
+        free(id);
+        goto end;
     }
 
-    if (ca && (rv = nng_tls_config_ca_chain(cfg, ca, NULL)) != 0) {
-        log(error, "nng_tls_config_ca_chain fail: %s", nng_strerror(rv));
+    share = tls_share_get(client, id, ca, cert, key, keypass);
+    if (NULL == share) {
+        log(error, "alloc_tls_config fail");
         rv = -1;
+        goto end;
     }
 
+swap:
+    tls_share_put(client->tls_share);
+    client->tls_share = share;
+    client->tls_cfg   = share ? share->cfg : NULL;
+
 end:
     nng_mtx_unlock(client->mtx);
     return rv;
@@ -1109,47 +1771,15 @@ end:
 int neu_mqtt_client_set_cache_size(neu_mqtt_client_t *client,
                                    size_t mem_size_bytes, size_t db_size_bytes)
 {
-    int rv = 0;
-
     nng_mtx_lock(client->mtx);
     return_failure_if_open();
 
-    if (0 == mem_size_bytes && 0 == db_size_bytes) {
-        // disable cache
-        log(debug, "cache disabled");
-        if (client->sqlite_cfg) {
-            nng_mqtt_free_sqlite_opt(client->sqlite_cfg);
-            client->sqlite_cfg = NULL;
-        }
-        goto end;
-    }
-
-    if (NULL == client->sqlite_cfg) {
-        client->sqlite_cfg = alloc_sqlite_config(client);
-        if (NULL == client->sqlite_cfg) {
-            log(error, "alloc_sqlite_config fail");
-            rv = -1;
-            goto end;
-        }
-    }
-
-    // FIXME: until NanoSDK cache size limit feature out
-    // Assume that,
-    // 1. every upload message follows the below template
-    //    '{"node":"","group":"","timestamp":1669708991767,"values":{"":0},"errors":{}}'
-    // 2. every upload message has 50 tags in average
-    // 3. every tag has 4 bytes data
-    // then, estimated average message size is
-    //    len(tmpl) + 128/2 + 128/2 + 50*(64/2+4) ~= 2000
-    size_t avg_msg_size = 2000;
-    nng_mqtt_set_sqlite_flush_threshold(client->sqlite_cfg,
-                                        mem_size_bytes / avg_msg_size);
-    nng_mqtt_set_sqlite_max_rows(client->sqlite_cfg,
-                                 db_size_bytes / avg_msg_size);
+    // the cache is opened along with the client, disabled if both are zero
+    client->cache_mem_size  = mem_size_bytes;
+    client->cache_disk_size = db_size_bytes;
 
-end:
     nng_mtx_unlock(client->mtx);
-    return rv;
+    return 0;
 }
 
 int neu_mqtt_client_set_cache_sync_interval(neu_mqtt_client_t *client,
@@ -1174,6 +1804,88 @@ int neu_mqtt_client_set_cache_sync_interval(neu_mqtt_client_t *client,
     return rv;
 }
 
+int neu_mqtt_client_set_recv_concurrency(neu_mqtt_client_t *client,
+                                         uint16_t           n)
+{
+    nng_mtx_lock(client->mtx);
+    return_failure_if_open();
+
+    // the receive aios are allocated with the first subscription
+    if (NULL != client->recvs || n < 1 || n > NEU_MQTT_RECV_CONCURRENCY_MAX) {
+        nng_mtx_unlock(client->mtx);
+        return -1;
+    }
+    client->n_recv = n;
+
+    nng_mtx_unlock(client->mtx);
+    return 0;
+}
+
+int neu_mqtt_client_set_reconnect_backoff(neu_mqtt_client_t *client,
+                                          uint32_t min_ms, uint32_t max_ms)
+{
+    nng_mtx_lock(client->mtx);
+    return_failure_if_open();
+
+    if (min_ms < 1 || max_ms < min_ms ||
+        max_ms > NEU_MQTT_RECONNECT_MAX_LIMIT) {
+        nng_mtx_unlock(client->mtx);
+        return -1;
+    }
+    client->reconnect_min = min_ms;
+    client->reconnect_max = max_ms;
+
+    nng_mtx_unlock(client->mtx);
+    return 0;
+}
+
+int neu_mqtt_client_set_inflight_window(neu_mqtt_client_t *client,
+                                        size_t max_msgs, size_t max_bytes)
+{
+    nng_mtx_lock(client->mtx);
+    return_failure_if_open();
+
+    client->inflight_max_msgs  = max_msgs;
+    client->inflight_max_bytes = max_bytes;
+
+    nng_mtx_unlock(client->mtx);
+    return 0;
+}
+
+int neu_mqtt_client_set_replay(neu_mqtt_client_t *client, size_t rate,
+                               uint8_t share, neu_mqtt_replay_order_e order)
+{
+    nng_mtx_lock(client->mtx);
+    return_failure_if_open();
+
+    if (share < 1 || share > 100 ||
+        (NEU_MQTT_REPLAY_OLDEST_FIRST != order &&
+         NEU_MQTT_REPLAY_NEWEST_FIRST != order)) {
+        nng_mtx_unlock(client->mtx);
+        return -1;
+    }
+    client->replay_rate   = rate;
+    client->replay_share  = share;
+    client->replay_newest = NEU_MQTT_REPLAY_NEWEST_FIRST == order;
+
+    nng_mtx_unlock(client->mtx);
+    return 0;
+}
+
+int neu_mqtt_client_set_inflight_cb(neu_mqtt_client_t *           client,
+                                    neu_mqtt_client_inflight_cb_t cb,
+                                    void *                        data)
+{
+    nng_mtx_lock(client->mtx);
+    return_failure_if_open();
+
+    client->inflight_cb      = cb;
+    client->inflight_cb_data = data;
+    nng_mtx_unlock(client->mtx);
+
+    return 0;
+}
+
 int neu_mqtt_client_set_zlog_category(neu_mqtt_client_t *client,
                                       zlog_category_t *  cat)
 {
@@ -1212,6 +1924,11 @@ int neu_mqtt_client_open(neu_mqtt_client_t *client)
         goto error;
     }
 
+    if (0 != client_open_cache(client)) {
+        log(error, "client_open_cache fail");
+        goto error;
+    }
+
     if (0 != client_start_timer(client)) {
         log(error, "client_start_timer fail");
         goto error;
@@ -1224,20 +1941,23 @@ int neu_mqtt_client_open(neu_mqtt_client_t *client)
         goto error;
     }
 
-    if (client->sqlite_cfg &&
-        (rv = nng_socket_set_ptr(client->sock, NNG_OPT_MQTT_SQLITE,
-                                 client->sqlite_cfg))) {
-        log(error, "nng_socket_set_ptr(NNG_OPT_MQTT_SQLITE) fail: %s",
-            nng_strerror(rv));
-        goto error;
-    }
-
     nng_dialer dialer;
     if ((rv = nng_dialer_create(&dialer, client->sock, client->url)) != 0) {
         log(error, "nng_dialer_create fail: %s", nng_strerror(rv));
         goto error;
     }
 
+    // NNG waits a random time below the back-off before each redial, and
+    // doubles the back-off up to the maximum, so that the clients of a
+    // restarted broker do not all come back at once
+    if ((rv = nng_dialer_set_ms(dialer, NNG_OPT_RECONNMINT,
+                                client->reconnect_min)) != 0 ||
+        (rv = nng_dialer_set_ms(dialer, NNG_OPT_RECONNMAXT,
+                                client->reconnect_max)) != 0) {
+        log(error, "nng_dialer_set_ms(reconnect) fail: %s", nng_strerror(rv));
+        goto error;
+    }
+
     if (client->tls_cfg &&
         0 !=
             (rv = nng_dialer_set_ptr(dialer, NNG_OPT_TLS_CONFIG,
@@ -1269,39 +1989,51 @@ int neu_mqtt_client_open(neu_mqtt_client_t *client)
 error:
     nng_mtx_unlock(client->mtx);
     if (client->events) {
+        if (client->cache_timer) {
+            neu_event_del_timer(client->events, client->cache_timer);
+        }
         neu_event_del_timer(client->events, client->timer);
         neu_event_close(client->events);
-        client->events = NULL;
-        client->timer  = NULL;
+        client->events      = NULL;
+        client->timer       = NULL;
+        client->cache_timer = NULL;
     }
     nng_close(client->sock);
+    mqtt_cache_free(client->cache);
+    client->cache = NULL;
     return -1;
 }
 
 int neu_mqtt_client_close(neu_mqtt_client_t *client)
 {
-    int                rv     = 0;
-    neu_events_t *     events = NULL;
-    neu_event_timer_t *timer  = NULL;
+    int                rv          = 0;
+    neu_events_t *     events      = NULL;
+    neu_event_timer_t *timer       = NULL;
+    neu_event_timer_t *cache_timer = NULL;
 
     nng_mtx_lock(client->mtx);
     if (!client->open) {
         nng_mtx_unlock(client->mtx);
         return 0;
     }
-    events         = client->events;
-    timer          = client->timer;
-    client->events = NULL;
-    client->timer  = NULL;
+    events              = client->events;
+    timer               = client->timer;
+    cache_timer         = client->cache_timer;
+    client->events      = NULL;
+    client->timer       = NULL;
+    client->cache_timer = NULL;
     nng_mtx_unlock(client->mtx);
 
     if (events) {
+        if (cache_timer) {
+            neu_event_del_timer(events, cache_timer);
+        }
         neu_event_del_timer(events, timer);
         neu_event_close(events);
     }
 
     // NanoSDK quirks: calling nng_aio_stop will block if the aio is in use
-    // nng_aio_stop(client->recv_aio);
+    // nng_aio_stop(client->recvs[i].aio);
 
     rv = nng_close(client->sock);
     if (0 != rv) {
@@ -1310,8 +2042,9 @@ int neu_mqtt_client_close(neu_mqtt_client_t *client)
     }
 
     nng_mtx_lock(client->mtx);
-    // wait for all tasks
-    while (client_task_free_list_len(client) != client->task_count) {
+    // wait for all tasks, and for the handlers of received messages
+    while (client_task_free_list_len(client) != client->task_count ||
+           0 != __atomic_load_n(&client->dispatching, __ATOMIC_ACQUIRE)) {
         nng_mtx_unlock(client->mtx);
         neu_msleep(100);
         nng_mtx_lock(client->mtx);
@@ -1319,72 +2052,153 @@ int neu_mqtt_client_close(neu_mqtt_client_t *client)
     client->open = false;
     nng_mtx_unlock(client->mtx);
 
+    // cached messages in memory are spilled to disk for the next open
+    mqtt_cache_free(client->cache);
+    client->cache = NULL;
+
     return 0;
 }
 
-int neu_mqtt_client_publish(neu_mqtt_client_t *client, neu_mqtt_qos_e qos,
-                            char *topic, uint8_t *payload, uint32_t len,
-                            void *data, neu_mqtt_client_publish_cb_t cb)
+// `payload` is what the callback gets back, NanoSDK copies `buf` and `topic`
+// into the message before this returns
+static int client_publish(neu_mqtt_client_t *client, neu_mqtt_qos_e qos,
+                          int flags, char *topic, const uint8_t *buf,
+                          uint8_t *payload, uint32_t len, void *data,
+                          neu_mqtt_client_publish_cb_t cb)
 {
-    int      rv      = 0;
-    nng_msg *pub_msg = NULL;
-    task_t * task    = NULL;
+    int           rv      = 0;
+    nng_msg *     pub_msg = NULL;
+    task_t *      task    = NULL;
+    mqtt_cache_t *cache   = NULL;
+    uint16_t      alias   = 0;
+    uint32_t      gen     = 0;
+    bool          known   = false;
+
+    nng_mtx_lock(client->mtx);
+    cache = client->connected ? NULL : client->cache;
+    // replays are bounded by their share of the window in cache_cb, or they
+    // would go back to the end of the cache
+    if (NULL == cache &&
+        !client_inflight_acquire(client, len, replay_cb != cb)) {
+        cache = client->cache;
+        if (NULL == cache) {
+            nng_mtx_unlock(client->mtx);
+            log(warn, "in-flight window full, drop [%s, QoS%d]", topic, qos);
+            return -1;
+        }
+    } else if (NULL == cache) {
+        alias = client_topic_alias(client, topic, &known);
+        gen   = client->alias_gen;
+    }
+    nng_mtx_unlock(client->mtx);
+
+    if (NULL != cache) {
+        // offline or over the window, the message is done once cached
+        if (0 != mqtt_cache_push(cache, qos, flags, topic, buf, len)) {
+            log(error, "cache [%s, QoS%d] %" PRIu32 " bytes fail", topic, qos,
+                len);
+            return -1;
+        }
+        log(debug, "cache [%s, QoS%d] %" PRIu32 " bytes", topic, qos, len);
+        if (cb) {
+            cb(0, qos, topic, payload, len, data);
+        }
+        return 0;
+    }
 
     if (0 != (rv = nng_mqtt_msg_alloc(&pub_msg, 0))) {
         log(error, "nng_mqtt_msg_alloc fail: %s", nng_strerror(rv));
-        return -1;
+        goto error;
     }
 
-    if (0 != (rv = nng_mqtt_msg_set_publish_topic(pub_msg, topic))) {
-        nng_msg_free(pub_msg);
+    // a known alias stands for the topic, which is then left empty
+    if (0 !=
+        (rv = nng_mqtt_msg_set_publish_topic(pub_msg, known ? "" : topic))) {
         log(error, "nng_mqtt_msg_set_publish_topic fail: %s", nng_strerror(rv));
-        return -1;
+        goto error;
+    }
+
+    if (0 != alias) {
+        property *props = mqtt_property_alloc();
+        mqtt_property_append(props,
+                             mqtt_property_set_value_u16(TOPIC_ALIAS, alias));
+        nng_mqtt_msg_set_publish_property(pub_msg, props);
     }
 
     nng_mqtt_msg_set_packet_type(pub_msg, NNG_MQTT_PUBLISH);
-    nng_mqtt_msg_set_publish_payload(pub_msg, (uint8_t *) payload, len);
+    if (0 != (rv = nng_mqtt_msg_set_publish_payload(pub_msg, (uint8_t *) buf,
+                                                    len))) {
+        log(error, "nng_mqtt_msg_set_publish_payload fail: %s",
+            nng_strerror(rv));
+        goto error;
+    }
     nng_mqtt_msg_set_publish_qos(pub_msg, qos);
+    nng_mqtt_msg_set_publish_retain(pub_msg, flags & NEU_MQTT_PUBLISH_RETAIN);
 
     nng_mtx_lock(client->mtx);
     task = client_alloc_task(client);
     nng_mtx_unlock(client->mtx);
 
     if (NULL == task) {
-        nng_msg_free(pub_msg);
         log(error, "client_alloc_task fail");
-        return -1;
+        goto error;
     }
 
     task->kind        = TASK_PUB;
     task->pub.cb      = cb;
     task->pub.qos     = qos;
+    task->pub.flags   = flags;
     task->pub.topic   = topic;
     task->pub.payload = payload;
     task->pub.len     = len;
     task->pub.data    = data;
+    task->pub.ts      = neu_time_ms();
+    task->pub.alias   = 0 != alias && !known ? gen : 0;
     nng_aio_set_msg(task->aio, pub_msg);
     nng_send_aio(client->sock, task->aio);
 
     return 0;
+
+error:
+    if (NULL != pub_msg) {
+        nng_msg_free(pub_msg);
+    }
+    nng_mtx_lock(client->mtx);
+    client_inflight_release(client, len);
+    nng_mtx_unlock(client->mtx);
+    return -1;
+}
+
+int neu_mqtt_client_publish(neu_mqtt_client_t *client, neu_mqtt_qos_e qos,
+                            char *topic, uint8_t *payload, uint32_t len,
+                            void *data, neu_mqtt_client_publish_cb_t cb)
+{
+    return client_publish(client, qos, 0, topic, payload, payload, len, data,
+                          cb);
+}
+
+int neu_mqtt_client_publish_buf(neu_mqtt_client_t *client, neu_mqtt_qos_e qos,
+                                int flags, char *topic, const uint8_t *buf,
+                                uint32_t len, void *data,
+                                neu_mqtt_client_publish_cb_t cb)
+{
+    return client_publish(client, qos, flags, topic, buf, NULL, len, data, cb);
 }
 
 int neu_mqtt_client_subscribe(neu_mqtt_client_t *client, neu_mqtt_qos_e qos,
                               const char *topic, void *data,
                               neu_mqtt_client_subscribe_cb_t cb)
 {
-    int             rv           = 0;
     subscription_t *subscription = NULL;
 
+    if (!topic_filter_valid(topic)) {
+        log(error, "invalid topic filter: %s", topic ? topic : "");
+        return -1;
+    }
+
     nng_mtx_lock(client->mtx);
-    if (NULL == client->recv_aio) {
-        if ((rv = nng_aio_alloc(&client->recv_aio, recv_cb, client)) != 0) {
-            log(error, "nng_aio_alloc fail: %s", nng_strerror(rv));
-            goto error;
-        }
-        if (client->connected) {
-            // connect_cb already fired, then start receiving
-            client_start_recv(client);
-        }
+    if (0 != client_alloc_recv(client)) {
+        goto error;
     }
 
     subscription = subscription_new(client, qos, topic, cb, data);
@@ -1402,6 +2216,7 @@ int neu_mqtt_client_subscribe(neu_mqtt_client_t *client, neu_mqtt_qos_e qos,
     }
 
     client_add_subscription(client, subscription);
+    client_publish_subs(client);
     nng_mtx_unlock(client->mtx);
 
     return 0;
@@ -1414,19 +2229,11 @@ error:
 
 int neu_mqtt_client_unsubscribe(neu_mqtt_client_t *client, const char *topic)
 {
-    int             rv           = 0;
     subscription_t *subscription = NULL;
 
     nng_mtx_lock(client->mtx);
-    if (NULL == client->recv_aio) {
-        if ((rv = nng_aio_alloc(&client->recv_aio, recv_cb, client)) != 0) {
-            log(error, "nng_aio_alloc fail: %s", nng_strerror(rv));
-            goto error;
-        }
-        if (client->connected) {
-            // connect_cb already fired, then start receiving
-            client_start_recv(client);
-        }
+    if (0 != client_alloc_recv(client)) {
+        goto error;
     }
 
     HASH_FIND_STR(client->subscriptions, topic, subscription);
@@ -1441,6 +2248,7 @@ int neu_mqtt_client_unsubscribe(neu_mqtt_client_t *client, const char *topic)
 
     if (subscription) {
         client_del_subscription(client, subscription);
+        client_publish_subs(client);
     }
 
     nng_mtx_unlock(client->mtx);
@@ -1,11 +1,17 @@
 #include <errno.h>
 #include <fcntl.h>
+#include <limits.h>
+#include <linux/netlink.h>
 #include <linux/serial.h>
+#include <poll.h>
 #include <pthread.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/inotify.h>
 #include <sys/ioctl.h>
+#include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <termios.h>
@@ -27,10 +33,57 @@
 
 enum SERIAL_MODE { SM_RS232, SM_RS422, SM_RS485 };
 
-static int get_port(const char *path);
-static int get_port_property(int port, int *mode, int *baudrate);
-static int read_file(const char *path, char **buf);
-static int set_serial_mode(const char *dev_path, int baudrate, int mode);
+struct device_port {
+    char *device;
+    int   port;
+};
+
+struct serial_property {
+    bool valid;
+    int  mode;
+    int  baudrate;
+};
+
+// the parsed config files, the watcher marks them stale when they change
+static struct {
+    pthread_mutex_t         mtx;
+    bool                    stale;
+    bool                    watch_conf;
+    struct device_port *    devices;
+    int                     n_device;
+    struct serial_property *serials;
+    int                     n_serial;
+
+    int inotify_fd;
+    int uevent_fd;
+} cache = {
+    .mtx        = PTHREAD_MUTEX_INITIALIZER,
+    .stale      = true,
+    .inotify_fd = -1,
+    .uevent_fd  = -1,
+};
+
+struct hotplug_watch {
+    char *                      dev_path;
+    neu_conn_smart_link_hotplug cb;
+    void *                      ctx;
+    struct hotplug_watch *      next;
+};
+
+static pthread_once_t        watcher_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t       watch_mtx    = PTHREAD_MUTEX_INITIALIZER;
+static struct hotplug_watch *watches      = NULL;
+
+static int  get_port(const char *path);
+static int  get_port_property(int port, int *mode, int *baudrate);
+static int  read_file(const char *path, char **buf);
+static int  set_serial_mode(const char *dev_path, int baudrate, int mode);
+static void start_watcher(void);
+
+static inline const char *basename_of(const char *path)
+{
+    return strrchr(path, '/') + 1;
+}
 
 int neu_conn_smart_link_auto_set(const char *dev_path)
 {
@@ -84,7 +137,21 @@ static int read_file(const char *path, char **buf)
     return ret;
 }
 
-static int get_port(const char *dev_path)
+static void free_cache(void)
+{
+    for (int i = 0; i < cache.n_device; i++) {
+        free(cache.devices[i].device);
+    }
+    free(cache.devices);
+    free(cache.serials);
+
+    cache.devices  = NULL;
+    cache.n_device = 0;
+    cache.serials  = NULL;
+    cache.n_serial = 0;
+}
+
+static int load_devices(void)
 {
     json_t *     root = NULL;
     json_error_t error;
@@ -95,8 +162,8 @@ static int get_port(const char *dev_path)
     }
 
     root = json_loads(buf, JSON_DECODE_ANY, &error);
+    free(buf);
     if (root == NULL) {
-        free(buf);
         return -1;
     }
 
@@ -107,54 +174,45 @@ static int get_port(const char *dev_path)
 
     ret = neu_json_decode_value(root, &e_tty);
     if (ret != 0 || json_is_array((json_t *) e_tty.v.val_object) == false) {
-        free(buf);
         json_decref(root);
         return -1;
     }
 
+    cache.devices =
+        calloc(json_array_size(e_tty.v.val_object), sizeof(*cache.devices));
+
     int     index = 0;
     json_t *e_dev = NULL;
     json_array_foreach(e_tty.v.val_object, index, e_dev)
     {
-        neu_json_elem_t e_dd = {
-            .name = "device",
-            .t    = NEU_JSON_STR,
+        neu_json_elem_t elems[] = {
+            {
+                .name = "device",
+                .t    = NEU_JSON_STR,
+            },
+            {
+                .name = "port",
+                .t    = NEU_JSON_INT,
+            },
         };
 
-        ret = neu_json_decode_value(e_dev, &e_dd);
+        ret = neu_json_decode_by_json(e_dev, NEU_JSON_ELEM_SIZE(elems), elems);
         if (ret != 0) {
-            free(buf);
+            free(elems[0].v.val_str);
             json_decref(root);
             return -1;
         }
 
-        if (strcmp(e_dd.v.val_str, dev_path) == 0) {
-            neu_json_elem_t e_port = {
-                .name = "port",
-                .t    = NEU_JSON_INT,
-            };
-
-            ret = neu_json_decode_value(e_dev, &e_port);
-            if (ret != 0) {
-                free(buf);
-                json_decref(root);
-                return -1;
-            }
-
-            free(buf);
-            json_decref(root);
-            free(e_dd.v.val_str);
-            return e_port.v.val_int;
-        }
-        free(e_dd.v.val_str);
+        cache.devices[cache.n_device].device = elems[0].v.val_str;
+        cache.devices[cache.n_device].port   = elems[1].v.val_int;
+        cache.n_device += 1;
     }
 
-    free(buf);
     json_decref(root);
-    return -1;
+    return 0;
 }
 
-static int get_port_property(int port, int *mode, int *baudrate)
+static int load_serials(void)
 {
     json_t *     root = NULL;
     json_error_t error;
@@ -165,42 +223,276 @@ static int get_port_property(int port, int *mode, int *baudrate)
     }
 
     root = json_loads(buf, JSON_DECODE_ANY, &error);
+    free(buf);
     if (root == NULL) {
-        free(buf);
         return -1;
     }
 
-    json_t *e_port = json_array_get(root, port - 1);
-    if (e_port == NULL) {
+    if (!json_is_array(root)) {
         json_decref(root);
-        free(buf);
         return -1;
     }
 
-    neu_json_elem_t elems[] = {
-        {
-            .name = "mode",
-            .t    = NEU_JSON_INT,
-        },
-        {
-            .name = "baudrate",
-            .t    = NEU_JSON_INT,
-        },
+    cache.serials = calloc(json_array_size(root), sizeof(*cache.serials));
+
+    int     index  = 0;
+    json_t *e_port = NULL;
+    json_array_foreach(root, index, e_port)
+    {
+        neu_json_elem_t elems[] = {
+            {
+                .name = "mode",
+                .t    = NEU_JSON_INT,
+            },
+            {
+                .name = "baudrate",
+                .t    = NEU_JSON_INT,
+            },
+        };
+
+        // a port without its properties is only an error once it is used
+        cache.serials[index].valid =
+            neu_json_decode_by_json(e_port, NEU_JSON_ELEM_SIZE(elems),
+                                    elems) == 0;
+        cache.serials[index].mode     = elems[0].v.val_int;
+        cache.serials[index].baudrate = elems[1].v.val_int;
+        cache.n_serial += 1;
+    }
+
+    json_decref(root);
+    return 0;
+}
+
+// called with cache.mtx held, parses the files again only after they changed
+static void load_cache(void)
+{
+    pthread_once(&watcher_once, start_watcher);
+
+    if (!cache.stale) {
+        return;
+    }
+
+    free_cache();
+    if (load_devices() != 0 || load_serials() != 0) {
+        fprintf(stderr, "load %s or %s failed\n", DEVICE_CONF_PATH,
+                SERIAL_CONF_PATH);
+    }
+
+    // without inotify every lookup reads the files, as it always did
+    cache.stale = !cache.watch_conf;
+}
+
+static int get_port(const char *dev_path)
+{
+    int port = -1;
+
+    pthread_mutex_lock(&cache.mtx);
+    load_cache();
+    for (int i = 0; i < cache.n_device; i++) {
+        if (strcmp(cache.devices[i].device, dev_path) == 0) {
+            port = cache.devices[i].port;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&cache.mtx);
+
+    return port;
+}
+
+static int get_port_property(int port, int *mode, int *baudrate)
+{
+    int ret = -1;
+
+    pthread_mutex_lock(&cache.mtx);
+    load_cache();
+    if (port >= 1 && port <= cache.n_serial && cache.serials[port - 1].valid) {
+        *mode     = cache.serials[port - 1].mode;
+        *baudrate = cache.serials[port - 1].baudrate;
+        ret       = 0;
+    }
+    pthread_mutex_unlock(&cache.mtx);
+
+    return ret;
+}
+
+static bool is_conf(const char *name)
+{
+    return strcmp(name, basename_of(DEVICE_CONF_PATH)) == 0 ||
+        strcmp(name, basename_of(SERIAL_CONF_PATH)) == 0;
+}
+
+static void read_inotify(int fd)
+{
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    ssize_t len = read(fd, buf, sizeof(buf));
+
+    for (char *p = buf; len > 0 && p < buf + len;) {
+        struct inotify_event *event = (struct inotify_event *) p;
+
+        if (event->len > 0 && is_conf(event->name)) {
+            pthread_mutex_lock(&cache.mtx);
+            cache.stale = true;
+            pthread_mutex_unlock(&cache.mtx);
+        }
+
+        p += sizeof(struct inotify_event) + event->len;
+    }
+}
+
+static void read_uevent(int fd)
+{
+    char        buf[4096] = { 0 };
+    char        path[128] = { 0 };
+    const char *action    = NULL;
+    const char *subsystem = NULL;
+    const char *devname   = NULL;
+    ssize_t     len       = recv(fd, buf, sizeof(buf) - 1, 0);
+
+    // "action@devpath\0KEY=value\0...", from the kernel
+    for (ssize_t i = 0; i < len; i += strlen(buf + i) + 1) {
+        char *kv = buf + i;
+
+        if (strncmp(kv, "ACTION=", 7) == 0) {
+            action = kv + 7;
+        } else if (strncmp(kv, "SUBSYSTEM=", 10) == 0) {
+            subsystem = kv + 10;
+        } else if (strncmp(kv, "DEVNAME=", 8) == 0) {
+            devname = kv + 8;
+        }
+    }
+
+    if (action == NULL || subsystem == NULL || devname == NULL ||
+        strcmp(subsystem, "tty") != 0) {
+        return;
+    }
+
+    bool add = strcmp(action, "add") == 0;
+    if (!add && strcmp(action, "remove") != 0) {
+        return;
+    }
+
+    if (devname[0] == '/') {
+        snprintf(path, sizeof(path), "%s", devname);
+    } else {
+        snprintf(path, sizeof(path), "/dev/%s", devname);
+    }
+
+    pthread_mutex_lock(&watch_mtx);
+    for (struct hotplug_watch *w = watches; w != NULL; w = w->next) {
+        char real[PATH_MAX] = { 0 };
+
+        if (strcmp(w->dev_path, path) == 0 ||
+            (realpath(w->dev_path, real) != NULL && strcmp(real, path) == 0)) {
+            w->cb(w->ctx, w->dev_path, add);
+        }
+    }
+    pthread_mutex_unlock(&watch_mtx);
+}
+
+static void *watcher(void *arg)
+{
+    struct pollfd fds[2] = {
+        { .fd = cache.inotify_fd, .events = POLLIN },
+        { .fd = cache.uevent_fd, .events = POLLIN },
     };
 
-    ret = neu_json_decode_by_json(e_port, NEU_JSON_ELEM_SIZE(elems), elems);
-    if (ret != 0) {
-        free(buf);
-        json_decref(root);
+    (void) arg;
+    while (true) {
+        if (poll(fds, 2, -1) <= 0) {
+            continue;
+        }
+
+        if (fds[0].revents & POLLIN) {
+            read_inotify(fds[0].fd);
+        }
+
+        if (fds[1].revents & POLLIN) {
+            read_uevent(fds[1].fd);
+        }
+    }
+
+    return NULL;
+}
+
+static void start_watcher(void)
+{
+    struct sockaddr_nl addr = {
+        .nl_family = AF_NETLINK,
+        .nl_pid    = 0,
+        .nl_groups = 1, // kernel uevents
+    };
+    char      dir[PATH_MAX] = DEVICE_CONF_PATH;
+    pthread_t tid;
+
+    *strrchr(dir, '/') = '\0';
+
+    // editors replace the files, so the directory is watched
+    cache.inotify_fd = inotify_init1(IN_CLOEXEC);
+    if (cache.inotify_fd >= 0 &&
+        inotify_add_watch(cache.inotify_fd, dir,
+                          IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE) >= 0) {
+        cache.watch_conf = true;
+    } else {
+        fprintf(stderr, "inotify %s failed, strerr: %s\n", dir,
+                strerror(errno));
+    }
+
+    cache.uevent_fd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC,
+                             NETLINK_KOBJECT_UEVENT);
+    if (cache.uevent_fd >= 0 &&
+        bind(cache.uevent_fd, (struct sockaddr *) &addr, sizeof(addr)) != 0) {
+        fprintf(stderr, "bind uevent failed, strerr: %s\n", strerror(errno));
+        close(cache.uevent_fd);
+        cache.uevent_fd = -1;
+    }
+
+    if (pthread_create(&tid, NULL, watcher, NULL) == 0) {
+        pthread_detach(tid);
+    } else {
+        cache.watch_conf = false;
+    }
+}
+
+int neu_conn_smart_link_watch(const char *                dev_path,
+                              neu_conn_smart_link_hotplug cb, void *ctx)
+{
+    struct hotplug_watch *w = calloc(1, sizeof(struct hotplug_watch));
+
+    if (w == NULL) {
         return -1;
     }
 
-    *mode     = elems[0].v.val_int;
-    *baudrate = elems[1].v.val_int;
+    pthread_once(&watcher_once, start_watcher);
 
-    json_decref(root);
-    free(buf);
-    return 0;
+    w->dev_path = strdup(dev_path);
+    w->cb       = cb;
+    w->ctx      = ctx;
+
+    pthread_mutex_lock(&watch_mtx);
+    w->next = watches;
+    watches = w;
+    pthread_mutex_unlock(&watch_mtx);
+
+    return cache.uevent_fd >= 0 ? 0 : -1;
+}
+
+void neu_conn_smart_link_unwatch(void *ctx)
+{
+    struct hotplug_watch **pw = &watches;
+
+    pthread_mutex_lock(&watch_mtx);
+    while (*pw != NULL) {
+        struct hotplug_watch *w = *pw;
+
+        if (w->ctx == ctx) {
+            *pw = w->next;
+            free(w->dev_path);
+            free(w);
+        } else {
+            pw = &w->next;
+        }
+    }
+    pthread_mutex_unlock(&watch_mtx);
 }
 
 static int set_serial_mode(const char *dev_path, int baudrate, int mode)
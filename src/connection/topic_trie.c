@@ -0,0 +1,206 @@
+/**
+ * NEURON IIoT System for Industry 4.0
+ * Copyright (C) 2020-2023 EMQ Technologies Co., Ltd All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ **/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "utils/uthash.h"
+
+#include "topic_trie.h"
+
+typedef struct node {
+    char *         level;
+    void *         data; // of the filter ending at this level
+    struct node *  children;
+    struct node *  plus;
+    struct node *  hash;
+    UT_hash_handle hh;
+} node_t;
+
+struct topic_trie {
+    node_t root;
+};
+
+static void node_fini(node_t *node)
+{
+    node_t *child = NULL, *tmp = NULL;
+
+    HASH_ITER(hh, node->children, child, tmp)
+    {
+        HASH_DEL(node->children, child);
+        node_fini(child);
+        free(child);
+    }
+    if (node->plus != NULL) {
+        node_fini(node->plus);
+        free(node->plus);
+    }
+    if (node->hash != NULL) {
+        node_fini(node->hash);
+        free(node->hash);
+    }
+    free(node->level);
+}
+
+topic_trie_t *topic_trie_new()
+{
+    return calloc(1, sizeof(topic_trie_t));
+}
+
+void topic_trie_free(topic_trie_t *trie)
+{
+    if (trie != NULL) {
+        node_fini(&trie->root);
+        free(trie);
+    }
+}
+
+bool topic_filter_valid(const char *filter)
+{
+    const char *level = filter;
+
+    if (filter == NULL || *filter == '\0') {
+        return false;
+    }
+
+    for (const char *p = filter;; p++) {
+        if (*p == '/' || *p == '\0') {
+            size_t n = p - level;
+            if (n > 1 && memchr(level, '+', n) != NULL) {
+                return false;
+            }
+            if (n > 1 && memchr(level, '#', n) != NULL) {
+                return false;
+            }
+            if (n == 1 && *level == '#' && *p != '\0') {
+                return false;
+            }
+            if (*p == '\0') {
+                return true;
+            }
+            level = p + 1;
+        }
+    }
+}
+
+static node_t *node_child(node_t *node, const char *level, size_t n)
+{
+    node_t **slot  = NULL;
+    node_t * child = NULL;
+
+    if (n == 1 && *level == '+') {
+        slot = &node->plus;
+    } else if (n == 1 && *level == '#') {
+        slot = &node->hash;
+    } else {
+        HASH_FIND(hh, node->children, level, n, child);
+        if (child != NULL) {
+            return child;
+        }
+    }
+
+    if (slot != NULL && *slot != NULL) {
+        return *slot;
+    }
+
+    child = calloc(1, sizeof(node_t));
+    if (child == NULL) {
+        return NULL;
+    }
+    child->level = strndup(level, n);
+    if (child->level == NULL) {
+        free(child);
+        return NULL;
+    }
+
+    if (slot != NULL) {
+        *slot = child;
+    } else {
+        HASH_ADD_KEYPTR(hh, node->children, child->level, n, child);
+    }
+    return child;
+}
+
+int topic_trie_add(topic_trie_t *trie, const char *filter, void *data)
+{
+    node_t *    node  = &trie->root;
+    const char *level = filter;
+
+    if (!topic_filter_valid(filter)) {
+        return -1;
+    }
+
+    for (const char *p = filter;; p++) {
+        if (*p == '/' || *p == '\0') {
+            node = node_child(node, level, p - level);
+            if (node == NULL) {
+                return -1;
+            }
+            if (*p == '\0') {
+                break;
+            }
+            level = p + 1;
+        }
+    }
+
+    node->data = data;
+    return 0;
+}
+
+static void *node_match(const node_t *node, const char *topic, size_t len,
+                        bool first)
+{
+    const char *  end   = memchr(topic, '/', len);
+    size_t        n     = end != NULL ? (size_t)(end - topic) : len;
+    bool          last  = end == NULL;
+    bool          wild  = !(first && n > 0 && *topic == '$');
+    const node_t *child = NULL;
+    void *        data  = NULL;
+
+    HASH_FIND(hh, node->children, topic, n, child);
+    if (child != NULL) {
+        data = last ? child->data
+                    : node_match(child, end + 1, len - n - 1, false);
+        if (data == NULL && last && child->hash != NULL) {
+            // "a/#" matches "a" too
+            data = child->hash->data;
+        }
+    }
+
+    if (data == NULL && wild && node->plus != NULL) {
+        child = node->plus;
+        data  = last ? child->data
+                    : node_match(child, end + 1, len - n - 1, false);
+        if (data == NULL && last && child->hash != NULL) {
+            data = child->hash->data;
+        }
+    }
+
+    if (data == NULL && wild && node->hash != NULL) {
+        data = node->hash->data;
+    }
+
+    return data;
+}
+
+void *topic_trie_match(const topic_trie_t *trie, const char *topic,
+                       size_t len)
+{
+    return node_match(&trie->root, topic, len, true);
+}
@@ -0,0 +1,50 @@
+/**
+ * NEURON IIoT System for Industry 4.0
+ * Copyright (C) 2020-2023 EMQ Technologies Co., Ltd All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ **/
+
+#ifndef CONNECTION_TOPIC_TRIE_H
+#define CONNECTION_TOPIC_TRIE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// MQTT topic filters by level, with the '+' and '#' wildcards.
+//
+// A trie is built once and then only matched against, which takes no lock
+// and may run on any number of threads, changes build a new trie.
+typedef struct topic_trie topic_trie_t;
+
+topic_trie_t *topic_trie_new();
+void          topic_trie_free(topic_trie_t *trie);
+
+// whether filter is a valid topic filter, '+' and '#' take a whole level and
+// '#' is the last one
+bool topic_filter_valid(const char *filter);
+
+// add filter with data, replacing the data of the same filter, return -1 if
+// filter is not valid or on allocation failure
+int topic_trie_add(topic_trie_t *trie, const char *filter, void *data);
+
+// The data of the filter matching the len bytes of topic, NULL if none does.
+// If several do, a level matches an exact filter level before '+' and '+'
+// before '#', from the first level on. Wildcards at the first level do not
+// match topics starting with '$'.
+void *topic_trie_match(const topic_trie_t *trie, const char *topic,
+                       size_t len);
+
+#endif
@@ -17,6 +17,8 @@
  * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
  **/
 #include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
@@ -31,6 +33,7 @@
 #include "utils/base64.h"
 #include "utils/log.h"
 #include "utils/time.h"
+#include "utils/utlist.h"
 
 #include "adapter.h"
 #include "adapter/adapter_internal.h"
@@ -51,7 +54,43 @@
 // definition for adapter names
 #define DEFAULT_DASHBOARD_ADAPTER_NAME DEFAULT_DASHBOARD_PLUGIN_NAME
 
-static int manager_loop(enum neu_event_io_type type, int fd, void *usr_data);
+// threads for the heavy requests of the nodes
+#define MANAGER_WORKERS 4
+// ms between the logs of the nodes a start or stop still waits for
+#define MANAGER_WAIT_LOG_MS 5000
+// ms the start waits for the nodes to bind before it goes on without them
+#define MANAGER_START_WAIT_MS 60000
+// most plugins compiled into neuron
+#define MANAGER_BUILTIN_MAX 8
+
+// seconds a lazy driver may idle, 0 starts every driver at boot
+static uint32_t lazy_drivers_idle = 0;
+// hold the nodes at boot, and start them once takeover is set
+static bool standby  = false;
+static int  takeover = 0;
+// seconds the destroy waits for the nodes to close, 0 for all of them
+static uint32_t shutdown_timeout = 0;
+// added to the plugin manager on create, before the nodes load
+static const neu_plugin_module_t *builtins[MANAGER_BUILTIN_MAX] = { 0 };
+static int                        n_builtin                     = 0;
+
+// a request to a node busy in the workers
+struct manager_deferred {
+    neu_msg_t *              msg;
+    struct sockaddr_un       addr;
+    struct manager_deferred *next;
+};
+
+static int  manager_loop(enum neu_event_io_type type, int fd, void *usr_data);
+static void manager_dispatch(neu_manager_t *manager, neu_msg_t *msg,
+                             struct sockaddr_un src_addr);
+static bool manager_wait_nodes(neu_manager_t *manager, bool stop);
+static void manager_settled(void *usr_data);
+static void manager_submit(neu_manager_t *manager, const char *key,
+                           neu_worker_job_fn job, neu_worker_done_fn done,
+                           void *arg);
+static void manager_publish_state(neu_manager_t *manager);
+static int  publish_state(void *usr_data);
 
 inline static void reply(neu_manager_t *manager, neu_reqresp_head_t *header,
                          void *data);
@@ -63,6 +102,10 @@ inline static void forward_msg_copy(neu_manager_t *     manager,
 
 static void start_static_adapter(neu_manager_t *manager, const char *name);
 static int  update_timestamp(void *usr_data);
+static int  sleep_idle_drivers(void *usr_data);
+static int  check_takeover(void *usr_data);
+static void manager_start_node(neu_manager_t *            manager,
+                               const neu_req_node_init_t *init);
 static void start_single_adapter(neu_manager_t *manager, const char *name,
                                  const char *plugin_name, bool display);
 
@@ -71,10 +114,47 @@ static bool  mv_tmp_library_file(neu_plugin_kind_e kind, const char *tmp_path,
                                  const char *library);
 static bool  mv_tmp_schema_file(const char *tmp_path, const char *schema);
 
+static neu_plugin_instance_t *reload_open(neu_manager_t *manager,
+                                          const char *path, UT_array *nodes);
+static void reload_close(neu_manager_t *manager, UT_array *nodes,
+                         neu_plugin_instance_t *reloads);
+static void reload_send(neu_manager_t *manager, UT_array *nodes,
+                        neu_plugin_instance_t *reloads);
+
+void neu_manager_set_lazy_drivers(uint32_t idle)
+{
+    lazy_drivers_idle = idle;
+}
+
+void neu_manager_set_standby(bool enable)
+{
+    standby = enable;
+}
+
+void neu_manager_takeover()
+{
+    __atomic_store_n(&takeover, 1, __ATOMIC_RELEASE);
+}
+
+void neu_manager_set_shutdown_timeout(uint32_t timeout)
+{
+    shutdown_timeout = timeout;
+}
+
+int neu_manager_add_builtin_plugin(const neu_plugin_module_t *module)
+{
+    if (n_builtin >= MANAGER_BUILTIN_MAX) {
+        return -1;
+    }
+    builtins[n_builtin++] = module;
+    return 0;
+}
+
 uint16_t neu_manager_get_port()
 {
     static uint16_t port = 10000;
-    return port++;
+    // nodes are created from several threads at boot
+    return __atomic_fetch_add(&port, 1, __ATOMIC_RELAXED);
 }
 
 neu_manager_t *neu_manager_create()
@@ -93,11 +173,16 @@ neu_manager_t *neu_manager_create()
         .type        = NEU_EVENT_TIMER_NOBLOCK,
     };
 
+    pthread_mutex_init(&manager->nodes_mtx, NULL);
+    pthread_cond_init(&manager->nodes_cond, NULL);
     manager->events            = neu_event_new();
     manager->plugin_manager    = neu_plugin_manager_create();
     manager->node_manager      = neu_node_manager_create();
     manager->subscribe_manager = neu_subscribe_manager_create();
     manager->log_level         = ZLOG_LEVEL_NOTICE;
+    manager->workers           = neu_worker_pool_create(
+        manager->events, MANAGER_WORKERS, manager_settled, manager);
+    neu_event_label(manager->events, "neuron", "manager");
 
     manager->server_fd = socket(AF_UNIX, SOCK_DGRAM, 0);
     assert(manager->server_fd > 0);
@@ -126,11 +211,29 @@ neu_manager_t *neu_manager_create()
     param.fd      = manager->server_fd;
     manager->loop = neu_event_add_io(manager->events, param);
 
+    param.fd = neu_msg_bus_bind(manager->server_fd, &local);
+    if (param.fd >= 0) {
+        manager->loop_bus = neu_event_add_io(manager->events, param);
+    }
+
     manager->timestamp_lev_manager = 0;
+    if (standby) {
+        static UT_icd init_icd = { sizeof(neu_req_node_init_t), NULL, NULL,
+                                   NULL };
+
+        utarray_new(manager->held, &init_icd);
+    }
 
     neu_metrics_init();
     start_static_adapter(manager, DEFAULT_DASHBOARD_PLUGIN_NAME);
 
+    for (int i = 0; i < n_builtin; ++i) {
+        if (neu_plugin_manager_add_builtin(manager->plugin_manager,
+                                           builtins[i]) != 0) {
+            nlog_warn("add builtin plugin %s fail", builtins[i]->module_name);
+        }
+    }
+
     if (manager_load_plugin(manager) != 0) {
         nlog_warn("load plugin error");
     }
@@ -146,9 +249,7 @@ neu_manager_t *neu_manager_create()
     utarray_free(single_plugins);
 
     manager_load_node(manager);
-    while (neu_node_manager_exist_uninit(manager->node_manager)) {
-        usleep(1000 * 100);
-    }
+    manager_wait_nodes(manager, false);
 
     manager_load_subscribe(manager);
 
@@ -156,17 +257,119 @@ neu_manager_t *neu_manager_create()
     manager->timer_timestamp =
         neu_event_add_timer(manager->events, timestamp_timer_param);
 
-    nlog_notice("manager start");
+    neu_event_timer_param_t state_timer_param = {
+        .second   = 1,
+        .cb       = publish_state,
+        .usr_data = (void *) manager,
+        .type     = NEU_EVENT_TIMER_NOBLOCK,
+    };
+    manager_publish_state(manager);
+    manager->timer_state =
+        neu_event_add_timer(manager->events, state_timer_param);
+
+    if (lazy_drivers_idle > 0) {
+        neu_event_timer_param_t idle_timer_param = {
+            .second   = 1,
+            .cb       = sleep_idle_drivers,
+            .usr_data = (void *) manager,
+            .type     = NEU_EVENT_TIMER_NOBLOCK,
+        };
+
+        manager->timer_idle =
+            neu_event_add_timer(manager->events, idle_timer_param);
+    }
+
+    if (manager->held != NULL) {
+        neu_event_timer_param_t takeover_timer_param = {
+            .second      = 0,
+            .millisecond = 100,
+            .cb          = check_takeover,
+            .usr_data    = (void *) manager,
+            .type        = NEU_EVENT_TIMER_NOBLOCK,
+        };
+
+        manager->timer_takeover =
+            neu_event_add_timer(manager->events, takeover_timer_param);
+    }
+
+    nlog_notice("manager start%s", manager->held != NULL ? ", standby" : "");
     return manager;
 }
 
-void neu_manager_destroy(neu_manager_t *manager)
+static inline int64_t realtime_ms()
+{
+    struct timespec ts = { 0 };
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (int64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// blocks until every node is bound on start, or every node is gone on stop,
+// return false if it gave up. The start gives up after MANAGER_START_WAIT_MS,
+// the stop after the shutdown timeout if there is one
+static bool manager_wait_nodes(neu_manager_t *manager, bool stop)
+{
+    char    names[256] = { 0 };
+    int64_t limit =
+        stop ? (int64_t) shutdown_timeout * 1000 : MANAGER_START_WAIT_MS;
+    int64_t begin    = realtime_ms();
+    int64_t end      = limit > 0 ? begin + limit : INT64_MAX;
+    int64_t next_log = begin + MANAGER_WAIT_LOG_MS;
+    bool    settled  = true;
+
+    pthread_mutex_lock(&manager->nodes_mtx);
+    while (stop ? neu_node_manager_size(manager->node_manager) > 0
+                : neu_node_manager_exist_uninit(manager->node_manager)) {
+        int64_t         until    = next_log < end ? next_log : end;
+        struct timespec deadline = {
+            .tv_sec  = until / 1000,
+            .tv_nsec = (until % 1000) * 1000000,
+        };
+
+        if (pthread_cond_timedwait(&manager->nodes_cond, &manager->nodes_mtx,
+                                   &deadline) != ETIMEDOUT) {
+            continue;
+        }
+
+        int64_t  now = realtime_ms();
+        uint16_t n   = neu_node_manager_names(manager->node_manager, !stop,
+                                            names, sizeof(names));
+        if (now >= end) {
+            nlog_warn("%s without %" PRIu16 " node(s): %s",
+                      stop ? "stop" : "start", n, names);
+            settled = false;
+            break;
+        }
+        if (now >= next_log) {
+            nlog_notice("%s waits %" PRId64 "ms for %" PRIu16 " node(s): %s",
+                        stop ? "stop" : "start", now - begin, n, names);
+            next_log += MANAGER_WAIT_LOG_MS;
+        }
+    }
+    pthread_mutex_unlock(&manager->nodes_mtx);
+
+    return settled;
+}
+
+int neu_manager_destroy(neu_manager_t *manager)
 {
     neu_req_node_init_t uninit = { 0 };
 
     UT_array *addrs = neu_node_manager_get_addrs_all(manager->node_manager);
 
     neu_event_del_timer(manager->events, manager->timer_timestamp);
+    neu_event_del_timer(manager->events, manager->timer_state);
+    neu_node_manager_publish_state(NULL, 0);
+    if (manager->timer_idle != NULL) {
+        neu_event_del_timer(manager->events, manager->timer_idle);
+    }
+    if (manager->timer_takeover != NULL) {
+        neu_event_del_timer(manager->events, manager->timer_takeover);
+    }
+    if (manager->held != NULL) {
+        utarray_free(manager->held);
+        manager->held = NULL;
+    }
 
     utarray_foreach(addrs, struct sockaddr_un *, addr)
     {
@@ -181,23 +384,103 @@ void neu_manager_destroy(neu_manager_t *manager)
     }
     utarray_free(addrs);
 
-    while (1) {
-        usleep(1000 * 100);
-        if (neu_node_manager_size(manager->node_manager) == 0) {
-            break;
-        }
+    // the nodes close in parallel, each in its own thread, those still
+    // closing at the timeout would be freed under, so all is left to the exit
+    if (!manager_wait_nodes(manager, true)) {
+        nlog_warn("manager exit at the shutdown timeout of %" PRIu32 "s",
+                  shutdown_timeout);
+        return -1;
+    }
+
+    // the adapters still being destroyed go before their plugins
+    if (manager->workers != NULL) {
+        neu_worker_pool_destroy(manager->workers);
+    }
+
+    struct manager_deferred *deferred = NULL, *tmp = NULL;
+    LL_FOREACH_SAFE(manager->deferred, deferred, tmp)
+    {
+        LL_DELETE(manager->deferred, deferred);
+        neu_msg_free(deferred->msg);
+        free(deferred);
     }
 
     neu_subscribe_manager_destroy(manager->subscribe_manager);
     neu_node_manager_destroy(manager->node_manager);
     neu_plugin_manager_destroy(manager->plugin_manager);
 
+    neu_event_del_io(manager->events, manager->loop_bus);
+    neu_msg_bus_unbind(manager->server_fd);
     close(manager->server_fd);
     neu_event_del_io(manager->events, manager->loop);
     neu_event_close(manager->events);
 
+    pthread_cond_destroy(&manager->nodes_cond);
+    pthread_mutex_destroy(&manager->nodes_mtx);
     free(manager);
     nlog_notice("manager exit");
+    return 0;
+}
+
+// A node added by the request of an app, created in the workers
+typedef struct {
+    neu_manager_t *       manager;
+    neu_msg_t *           msg;
+    neu_plugin_instance_t instance;
+    neu_adapter_t *       adapter;
+    int                   error;
+} add_node_job_t;
+
+static void add_node_create(void *arg)
+{
+    add_node_job_t *    job    = (add_node_job_t *) arg;
+    neu_reqresp_head_t *header = neu_msg_get_header(job->msg);
+    neu_req_add_node_t *cmd    = (neu_req_add_node_t *) &header[1];
+    neu_adapter_info_t  info   = {
+        .name   = cmd->node,
+        .handle = job->instance.handle,
+        .module = job->instance.module,
+    };
+
+    job->adapter = neu_adapter_create(&info, false);
+    if (job->adapter == NULL) {
+        job->error = neu_adapter_error();
+        return;
+    }
+
+    if (NULL != cmd->setting) {
+        job->error = neu_adapter_set_setting(job->adapter, cmd->setting);
+    }
+
+    if (job->error != NEU_ERR_SUCCESS) {
+        neu_adapter_uninit(job->adapter);
+        neu_adapter_destroy(job->adapter);
+        job->adapter = NULL;
+    }
+}
+
+static void add_node_done(void *arg)
+{
+    add_node_job_t *    job     = (add_node_job_t *) arg;
+    neu_manager_t *     manager = job->manager;
+    neu_reqresp_head_t *header  = neu_msg_get_header(job->msg);
+    neu_req_add_node_t *cmd     = (neu_req_add_node_t *) &header[1];
+    neu_resp_error_t    e       = { .error = job->error };
+
+    if (job->adapter != NULL) {
+        neu_manager_add_adapter(manager, job->adapter, false);
+        manager_storage_add_node(manager, cmd->node);
+        if (cmd->setting) {
+            adapter_storage_setting(cmd->node, cmd->setting);
+        }
+        manager_publish_state(manager);
+    }
+
+    neu_req_add_node_fini(cmd);
+    header->type = NEU_RESP_ERROR;
+    strcpy(header->receiver, header->sender);
+    reply(manager, header, &e);
+    free(job);
 }
 
 static int manager_loop(enum neu_event_io_type type, int fd, void *usr_data)
@@ -223,27 +506,97 @@ static int manager_loop(enum neu_event_io_type type, int fd, void *usr_data)
 
     nlog_info("manager recv msg from: %s to %s, type: %s", header->sender,
               header->receiver, neu_reqresp_type_string(header->type));
+    manager_dispatch(manager, msg, src_addr);
+    return 0;
+}
+
+// whether a request has to wait for the workers, so that the requests of a
+// node are handled in order
+static bool manager_must_wait(neu_manager_t *     manager,
+                              neu_reqresp_head_t *header)
+{
+    neu_worker_pool_t *workers = manager->workers;
+
+    if (workers == NULL) {
+        return false;
+    }
+
+    switch (header->type) {
+    case NEU_REQ_ADD_NODE: {
+        neu_req_add_node_t *cmd = (neu_req_add_node_t *) &header[1];
+        return neu_worker_pool_busy(workers, cmd->node);
+    }
+    case NEU_REQ_UPDATE_NODE: {
+        neu_req_update_node_t *cmd = (neu_req_update_node_t *) &header[1];
+        return neu_worker_pool_busy(workers, cmd->node) ||
+            neu_worker_pool_busy(workers, cmd->new_name);
+    }
+    case NEU_REQ_DEL_NODE: {
+        neu_req_del_node_t *cmd = (neu_req_del_node_t *) &header[1];
+        return neu_worker_pool_busy(workers, cmd->node);
+    }
+    case NEU_REQ_DEL_PLUGIN:
+    case NEU_REQ_UPDATE_PLUGIN:
+    case NEU_REQ_ADD_DRIVERS:
+        // the plugins are in use by the nodes in the workers
+        return !neu_worker_pool_idle(workers);
+    default:
+        return neu_worker_pool_busy(workers, header->receiver);
+    }
+}
+
+static void manager_dispatch(neu_manager_t *manager, neu_msg_t *msg,
+                             struct sockaddr_un src_addr)
+{
+    neu_reqresp_head_t *header = neu_msg_get_header(msg);
+
+    if (manager_must_wait(manager, header)) {
+        struct manager_deferred *deferred =
+            calloc(1, sizeof(struct manager_deferred));
+        if (deferred != NULL) {
+            nlog_info("manager defer %s to %s",
+                      neu_reqresp_type_string(header->type), header->receiver);
+            deferred->msg  = msg;
+            deferred->addr = src_addr;
+            LL_APPEND(manager->deferred, deferred);
+            return;
+        }
+    }
+
     switch (header->type) {
     case NEU_REQ_NODE_INIT: {
         neu_req_node_init_t *init = (neu_req_node_init_t *) &header[1];
+        bool                 hold = manager->held != NULL &&
+            (init->state == NEU_NODE_RUNNING_STATE_RUNNING ||
+             init->state == NEU_NODE_RUNNING_STATE_STOPPED);
+        bool                 lazy = !hold && lazy_drivers_idle > 0 &&
+            init->state == NEU_NODE_RUNNING_STATE_RUNNING &&
+            neu_node_manager_is_driver(manager->node_manager, init->node);
+
+        // dormant before bound, so that the apps never get a route to it
+        if (lazy) {
+            neu_node_manager_set_dormant(manager->node_manager, init->node,
+                                         true);
+        }
 
-        if (0 !=
-            neu_node_manager_update(manager->node_manager, init->node,
-                                    src_addr)) {
+        pthread_mutex_lock(&manager->nodes_mtx);
+        int rv = neu_node_manager_update(manager->node_manager, init->node,
+                                         src_addr);
+        pthread_cond_broadcast(&manager->nodes_cond);
+        pthread_mutex_unlock(&manager->nodes_mtx);
+        if (0 != rv) {
             nlog_warn("bind node %s to src addr(%s) fail", init->node,
                       &src_addr.sun_path[1]);
             neu_msg_free(msg);
             break;
         }
 
-        if (init->state == NEU_NODE_RUNNING_STATE_RUNNING ||
-            init->state == NEU_NODE_RUNNING_STATE_STOPPED) {
-            neu_adapter_t *adapter =
-                neu_node_manager_find(manager->node_manager, init->node);
-            neu_adapter_start(adapter);
-            if (init->state == NEU_NODE_RUNNING_STATE_STOPPED) {
-                neu_adapter_stop(adapter);
-            }
+        if (hold) {
+            // loaded with its groups and settings, only not polling yet
+            utarray_push_back(manager->held, init);
+            nlog_notice("standby holds node %s", init->node);
+        } else {
+            manager_start_node(manager, init);
         }
 
         nlog_notice("bind node %s to src addr(%s)", init->node,
@@ -300,8 +653,9 @@ static int manager_loop(enum neu_event_io_type type, int fd, void *usr_data)
                 manager->plugin_manager, so_tmp_path, &ins, &error)) {
             char module_name[64] = { 0 };
             kind                 = ins.module->kind;
-            strncpy(module_name, ins.module->module_name, sizeof(module_name));
-            strncpy(schema, ins.module->schema, sizeof(schema));
+            strncpy(module_name, ins.module->module_name,
+                    sizeof(module_name) - 1);
+            strncpy(schema, ins.module->schema, sizeof(schema) - 1);
 
             nlog_debug("library %s, module_name %s, schema:%s", cmd->library,
                        module_name, schema);
@@ -498,8 +852,9 @@ static int manager_loop(enum neu_event_io_type type, int fd, void *usr_data)
         if (neu_plugin_manager_create_instance_by_path(
                 manager->plugin_manager, so_tmp_path, &ins, &error)) {
             kind = ins.module->kind;
-            strncpy(module_name, ins.module->module_name, sizeof(module_name));
-            strncpy(schema, ins.module->schema, sizeof(schema));
+            strncpy(module_name, ins.module->module_name,
+                    sizeof(module_name) - 1);
+            strncpy(schema, ins.module->schema, sizeof(schema) - 1);
 
             nlog_debug("library %s, module_name %s, schema:%s", cmd->library,
                        module_name, schema);
@@ -603,24 +958,25 @@ static int manager_loop(enum neu_event_io_type type, int fd, void *usr_data)
             break;
         }
 
+        // the nodes using the plugin swap it in place once the library is
+        // replaced, instead of being restarted
         UT_array *nodes = neu_manager_get_nodes(
             manager, NEU_NA_TYPE_DRIVER | NEU_NA_TYPE_APP, module_name, "");
+        neu_plugin_instance_t *reloads =
+            reload_open(manager, so_tmp_path, nodes);
 
-        if (nodes != NULL) {
-            if (utarray_len(nodes) > 0) {
-                utarray_free(nodes);
-                free(cmd->so_file);
-                free(cmd->schema_file);
-                free(so_tmp_path);
-                free(schema_tmp_path);
-                nlog_warn("library %s is using", cmd->library);
-                header->type = NEU_RESP_ERROR;
-                e.error      = NEU_ERR_LIBRARY_IN_USE;
-                strcpy(header->receiver, header->sender);
-                reply(manager, header, &e);
-                break;
-            }
+        if (nodes != NULL && reloads == NULL) {
             utarray_free(nodes);
+            free(cmd->so_file);
+            free(cmd->schema_file);
+            free(so_tmp_path);
+            free(schema_tmp_path);
+            nlog_warn("library %s reload instances fail", cmd->library);
+            header->type = NEU_RESP_ERROR;
+            e.error      = NEU_ERR_LIBRARY_UPDATE_FAIL;
+            strcpy(header->receiver, header->sender);
+            reply(manager, header, &e);
+            break;
         }
 
         if (!neu_plugin_manager_remove_library(manager->plugin_manager,
@@ -630,6 +986,7 @@ static int manager_loop(enum neu_event_io_type type, int fd, void *usr_data)
             free(cmd->schema_file);
             free(so_tmp_path);
             free(schema_tmp_path);
+            reload_close(manager, nodes, reloads);
             header->type = NEU_RESP_ERROR;
             e.error      = NEU_ERR_LIBRARY_UPDATE_FAIL;
             strcpy(header->receiver, header->sender);
@@ -643,6 +1000,7 @@ static int manager_loop(enum neu_event_io_type type, int fd, void *usr_data)
             free(cmd->schema_file);
             free(so_tmp_path);
             free(schema_tmp_path);
+            reload_close(manager, nodes, reloads);
             header->type = NEU_RESP_ERROR;
             e.error      = NEU_ERR_LIBRARY_UPDATE_FAIL;
             strcpy(header->receiver, header->sender);
@@ -656,6 +1014,7 @@ static int manager_loop(enum neu_event_io_type type, int fd, void *usr_data)
             free(cmd->schema_file);
             free(so_tmp_path);
             free(schema_tmp_path);
+            reload_close(manager, nodes, reloads);
             header->type = NEU_RESP_ERROR;
             e.error      = NEU_ERR_LIBRARY_UPDATE_FAIL;
             strcpy(header->receiver, header->sender);
@@ -670,6 +1029,7 @@ static int manager_loop(enum neu_event_io_type type, int fd, void *usr_data)
             free(cmd->schema_file);
             free(so_tmp_path);
             free(schema_tmp_path);
+            reload_close(manager, nodes, reloads);
             header->type = NEU_RESP_ERROR;
             e.error      = NEU_ERR_LIBRARY_UPDATE_FAIL;
             strcpy(header->receiver, header->sender);
@@ -681,6 +1041,7 @@ static int manager_loop(enum neu_event_io_type type, int fd, void *usr_data)
         free(cmd->schema_file);
         free(so_tmp_path);
         free(schema_tmp_path);
+        reload_send(manager, nodes, reloads);
         header->type = NEU_RESP_ERROR;
         e.error      = NEU_ERR_SUCCESS;
         strcpy(header->receiver, header->sender);
@@ -699,17 +1060,28 @@ static int manager_loop(enum neu_event_io_type type, int fd, void *usr_data)
     }
     case NEU_REQ_ADD_NODE: {
         neu_req_add_node_t *cmd = (neu_req_add_node_t *) &header[1];
-        int error = neu_manager_add_node(manager, cmd->node, cmd->plugin,
-                                         cmd->setting, false, false);
-        neu_resp_error_t e = { .error = error };
+        add_node_job_t *    job = NULL;
+        neu_resp_error_t    e   = { 0 };
 
-        if (error == NEU_ERR_SUCCESS) {
-            manager_storage_add_node(manager, cmd->node);
-            if (cmd->setting) {
-                adapter_storage_setting(cmd->node, cmd->setting);
-            }
+        if (neu_node_manager_find(manager->node_manager, cmd->node) != NULL) {
+            e.error = NEU_ERR_NODE_EXIST;
+        } else if ((job = calloc(1, sizeof(add_node_job_t))) == NULL) {
+            e.error = NEU_ERR_EINTERNAL;
+        } else {
+            e.error =
+                neu_manager_new_instance(manager, cmd->plugin, &job->instance);
         }
 
+        if (e.error == NEU_ERR_SUCCESS) {
+            // replied once the node is created, see add_node_done
+            job->manager = manager;
+            job->msg     = msg;
+            manager_submit(manager, cmd->node, add_node_create, add_node_done,
+                           job);
+            break;
+        }
+
+        free(job);
         neu_req_add_node_fini(cmd);
         header->type = NEU_RESP_ERROR;
         strcpy(header->receiver, header->sender);
@@ -814,7 +1186,11 @@ static int manager_loop(enum neu_event_io_type type, int fd, void *usr_data)
     case NEU_RESP_NODE_UNINIT: {
         neu_resp_node_uninit_t *cmd = (neu_resp_node_uninit_t *) &header[1];
 
+        pthread_mutex_lock(&manager->nodes_mtx);
         neu_manager_del_node(manager, cmd->node);
+        pthread_cond_broadcast(&manager->nodes_cond);
+        pthread_mutex_unlock(&manager->nodes_mtx);
+        manager_publish_state(manager);
         if (strlen(header->receiver) > 0 &&
             strcmp(header->receiver, "manager") != 0) {
             neu_resp_error_t error = { 0 };
@@ -973,22 +1349,15 @@ static int manager_loop(enum neu_event_io_type type, int fd, void *usr_data)
     }
     case NEU_REQ_GET_NODES_STATE: {
         neu_resp_get_nodes_state_t resp = { 0 };
-        UT_array *states = neu_node_manager_get_state(manager->node_manager);
-        neu_nodes_state_t *p_state = NULL;
-        while (
-            (p_state = (neu_nodes_state_t *) utarray_next(states, p_state))) {
-            p_state->sub_group_count = neu_subscribe_manager_group_count(
-                manager->subscribe_manager, p_state->node);
-        }
-        resp.states     = utarray_clone(states);
-        resp.core_level = manager->log_level;
+
+        // refreshes the snapshot for the apps asking without the manager
+        manager_publish_state(manager);
+        neu_node_manager_find_state(&resp.states, &resp.core_level);
 
         strcpy(header->receiver, header->sender);
         strcpy(header->sender, "manager");
         header->type = NEU_RESP_GET_NODES_STATE;
         reply(manager, header, &resp);
-
-        utarray_free(states);
         break;
     }
     case NEU_REQ_GET_DRIVER_GROUP: {
@@ -1011,6 +1380,7 @@ static int manager_loop(enum neu_event_io_type type, int fd, void *usr_data)
     case NEU_REQ_WRITE_TAGS:
     case NEU_REQ_WRITE_GTAGS:
     case NEU_REQ_GET_TAG:
+    case NEU_REQ_GET_TAG_HISTORY:
     case NEU_REQ_NODE_CTL:
     case NEU_REQ_ADD_GROUP: {
         if (neu_node_manager_find(manager->node_manager, header->receiver) ==
@@ -1029,6 +1399,20 @@ static int manager_loop(enum neu_event_io_type type, int fd, void *usr_data)
             neu_msg_exchange(header);
             reply(manager, header, &e);
         } else {
+            if (NEU_REQ_NODE_CTL == header->type) {
+                // the user takes over a lazy driver, a dormant one is started
+                // first to be stopped by the request
+                neu_req_node_ctl_t *cmd = (neu_req_node_ctl_t *) &header[1];
+                if (NEU_ADAPTER_CTL_STOP == cmd->ctl) {
+                    neu_manager_wake_driver(manager, header->receiver);
+                }
+                neu_node_manager_set_lazy(manager->node_manager,
+                                          header->receiver, false);
+            } else if (NEU_REQ_GET_TAG != header->type &&
+                       NEU_REQ_GET_TAG_HISTORY != header->type &&
+                       NEU_REQ_ADD_GROUP != header->type) {
+                neu_manager_wake_driver(manager, header->receiver);
+            }
             forward_msg(manager, header, header->receiver);
         }
 
@@ -1198,6 +1582,7 @@ static int manager_loop(enum neu_event_io_type type, int fd, void *usr_data)
 
         break;
     }
+    case NEU_REQ_APPLY_GTAG:
     case NEU_REQ_ADD_GTAG: {
         neu_req_add_gtag_t *cmd = (neu_req_add_gtag_t *) &header[1];
 
@@ -1238,8 +1623,10 @@ static int manager_loop(enum neu_event_io_type type, int fd, void *usr_data)
 
     case NEU_RESP_ADD_TAG:
     case NEU_RESP_ADD_GTAG:
+    case NEU_RESP_APPLY_GTAG:
     case NEU_RESP_UPDATE_TAG:
     case NEU_RESP_GET_TAG:
+    case NEU_RESP_GET_TAG_HISTORY:
     case NEU_RESP_GET_GROUP:
     case NEU_RESP_GET_NODE_SETTING:
     case NEU_RESP_ERROR:
@@ -1292,6 +1679,18 @@ static int manager_loop(enum neu_event_io_type type, int fd, void *usr_data)
         break;
     }
 
+    case NEU_REQ_UPDATE_LOG_CAPTURE: {
+        if (neu_node_manager_find(manager->node_manager, header->receiver) ==
+            NULL) {
+            neu_resp_error_t e = { .error = NEU_ERR_NODE_NOT_EXIST };
+            header->type       = NEU_RESP_ERROR;
+            neu_msg_exchange(header);
+            reply(manager, header, &e);
+        } else {
+            forward_msg(manager, header, header->receiver);
+        }
+        break;
+    }
     case NEU_REQ_UPDATE_LOG_LEVEL: {
         neu_req_update_log_level_t *cmd =
             (neu_req_update_log_level_t *) &header[1];
@@ -1299,6 +1698,7 @@ static int manager_loop(enum neu_event_io_type type, int fd, void *usr_data)
         if (cmd->core) {
             manager->log_level = cmd->log_level;
             nlog_level_change(manager->log_level);
+            manager_publish_state(manager);
         }
 
         if (strlen(cmd->node) > 0) {
@@ -1331,7 +1731,50 @@ static int manager_loop(enum neu_event_io_type type, int fd, void *usr_data)
         assert(false);
         break;
     }
+}
+
+static void manager_settled(void *usr_data)
+{
+    neu_manager_t *          manager  = (neu_manager_t *) usr_data;
+    struct manager_deferred *deferred = manager->deferred;
+    struct manager_deferred *tmp      = NULL;
+
+    // in order, the requests of a node still busy are deferred again
+    manager->deferred = NULL;
+    LL_FOREACH_SAFE(deferred, deferred, tmp)
+    {
+        manager_dispatch(manager, deferred->msg, deferred->addr);
+        free(deferred);
+    }
+}
+
+static void manager_submit(neu_manager_t *manager, const char *key,
+                           neu_worker_job_fn job, neu_worker_done_fn done,
+                           void *arg)
+{
+    if (manager->workers == NULL ||
+        0 != neu_worker_pool_submit(manager->workers, key, job, done, arg)) {
+        job(arg);
+        done(arg);
+    }
+}
+
+static void manager_publish_state(neu_manager_t *manager)
+{
+    UT_array *states = neu_node_manager_get_state(manager->node_manager);
+
+    utarray_foreach(states, neu_nodes_state_t *, state)
+    {
+        state->sub_group_count = neu_subscribe_manager_group_count(
+            manager->subscribe_manager, state->node);
+    }
+
+    neu_node_manager_publish_state(states, manager->log_level);
+}
 
+static int publish_state(void *usr_data)
+{
+    manager_publish_state((neu_manager_t *) usr_data);
     return 0;
 }
 
@@ -1343,6 +1786,58 @@ inline static void forward_msg_copy(neu_manager_t *     manager,
     forward_msg(manager, neu_msg_get_header(msg), node);
 }
 
+static void manager_start_node(neu_manager_t *            manager,
+                               const neu_req_node_init_t *init)
+{
+    neu_adapter_t *adapter =
+        neu_node_manager_find(manager->node_manager, init->node);
+    bool lazy = lazy_drivers_idle > 0 &&
+        init->state == NEU_NODE_RUNNING_STATE_RUNNING &&
+        neu_node_manager_is_driver(manager->node_manager, init->node);
+
+    // deleted while held
+    if (adapter == NULL) {
+        return;
+    }
+
+    if (lazy) {
+        // a held node is bound already, it gets a route on its first demand
+        neu_node_manager_set_dormant(manager->node_manager, init->node, true);
+        // started on the first demand, the node is still to be running
+        // across restarts
+        adapter_storage_state(init->node, NEU_NODE_RUNNING_STATE_RUNNING);
+    } else if (init->state == NEU_NODE_RUNNING_STATE_RUNNING ||
+               init->state == NEU_NODE_RUNNING_STATE_STOPPED) {
+        neu_adapter_start(adapter);
+        if (init->state == NEU_NODE_RUNNING_STATE_STOPPED) {
+            neu_adapter_stop(adapter);
+        }
+    }
+}
+
+// the nodes held start together, the drivers connect from their own threads
+static int check_takeover(void *usr_data)
+{
+    neu_manager_t *manager = (neu_manager_t *) usr_data;
+    int64_t        start   = neu_time_ms();
+    UT_array *     held    = manager->held;
+
+    if (held == NULL || !__atomic_load_n(&takeover, __ATOMIC_ACQUIRE)) {
+        return 0;
+    }
+
+    manager->held = NULL;
+    utarray_foreach(held, neu_req_node_init_t *, init)
+    {
+        manager_start_node(manager, init);
+    }
+
+    nlog_notice("takeover, %u nodes started in %" PRId64 " ms",
+                utarray_len(held), neu_time_ms() - start);
+    utarray_free(held);
+    return 0;
+}
+
 static void start_static_adapter(neu_manager_t *manager, const char *name)
 {
     neu_adapter_t *       adapter      = NULL;
@@ -1420,6 +1915,114 @@ static int update_timestamp(void *usr_data)
     return 0;
 }
 
+static int sleep_idle_drivers(void *usr_data)
+{
+    neu_manager_t *manager = (neu_manager_t *) usr_data;
+
+    neu_manager_sleep_idle_drivers(manager, (int64_t) lazy_drivers_idle * 1000);
+    return 0;
+}
+
+// one reference to the new library for each node, opened from the tmp path:
+// the library name still maps the build the nodes run, and the tmp file
+// keeps its inode once moved in place
+static neu_plugin_instance_t *reload_open(neu_manager_t *manager,
+                                          const char *path, UT_array *nodes)
+{
+    neu_plugin_instance_t *reloads = NULL;
+    int                    i       = 0;
+    int                    error   = 0;
+
+    if (nodes == NULL) {
+        return NULL;
+    }
+
+    reloads = calloc(utarray_len(nodes) + 1, sizeof(neu_plugin_instance_t));
+    if (reloads == NULL) {
+        return NULL;
+    }
+
+    utarray_foreach(nodes, neu_resp_node_info_t *, info)
+    {
+        if (!neu_plugin_manager_create_instance_by_path(
+                manager->plugin_manager, path, &reloads[i], &error)) {
+            nlog_warn("node %s reload instance error: %d", info->node, error);
+            for (int j = 0; j < i; j++) {
+                neu_plugin_manager_destroy_instance(manager->plugin_manager,
+                                                    &reloads[j]);
+            }
+            free(reloads);
+            return NULL;
+        }
+        i += 1;
+    }
+
+    return reloads;
+}
+
+static void reload_close(neu_manager_t *manager, UT_array *nodes,
+                         neu_plugin_instance_t *reloads)
+{
+    int i = 0;
+
+    if (nodes == NULL) {
+        return;
+    }
+
+    utarray_foreach(nodes, neu_resp_node_info_t *, info)
+    {
+        (void) info;
+        neu_plugin_manager_destroy_instance(manager->plugin_manager,
+                                            &reloads[i++]);
+    }
+    free(reloads);
+    utarray_free(nodes);
+}
+
+static void reload_send(neu_manager_t *manager, UT_array *nodes,
+                        neu_plugin_instance_t *reloads)
+{
+    int i = 0;
+
+    if (nodes == NULL) {
+        return;
+    }
+
+    utarray_foreach(nodes, neu_resp_node_info_t *, info)
+    {
+        neu_req_node_reload_t cmd = {
+            .handle = reloads[i].handle,
+            .module = reloads[i].module,
+        };
+        struct sockaddr_un addr =
+            neu_node_manager_get_addr(manager->node_manager, info->node);
+        neu_msg_t *msg = NULL;
+
+        strcpy(cmd.node, info->node);
+        msg = neu_msg_new(NEU_REQ_NODE_RELOAD, NULL, &cmd);
+        if (msg != NULL) {
+            neu_reqresp_head_t *header = neu_msg_get_header(msg);
+            strcpy(header->sender, "manager");
+            strcpy(header->receiver, info->node);
+        }
+
+        if (msg == NULL ||
+            0 != neu_send_msg_to(manager->server_fd, &addr, msg)) {
+            nlog_warn("manager -> %s reload msg send fail", info->node);
+            if (msg != NULL) {
+                neu_msg_free(msg);
+            }
+            neu_plugin_manager_destroy_instance(manager->plugin_manager,
+                                                &reloads[i]);
+        } else {
+            nlog_notice("node %s reload plugin %s", info->node, info->plugin);
+        }
+        i += 1;
+    }
+    free(reloads);
+    utarray_free(nodes);
+}
+
 static char *file_save_tmp(const char *data, const char *suffix)
 {
     int   d_len = 0;
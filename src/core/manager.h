@@ -27,8 +27,27 @@
 #include "manager_internal.h"
 
 neu_manager_t *neu_manager_create();
-void           neu_manager_destroy(neu_manager_t *manager);
+// return -1 if nodes were still closing at the shutdown timeout, the manager
+// is left to the exit of the process then
+int neu_manager_destroy(neu_manager_t *manager);
 
 uint16_t neu_manager_get_port();
 
+// Start drivers on their first subscription, read or write instead of at
+// boot, and stop them again after `idle` seconds without any, 0 disables.
+void neu_manager_set_lazy_drivers(uint32_t idle);
+
+// A standby loads the nodes and their groups without starting them, until it
+// takes over from the active instance and starts them all at once.
+void neu_manager_set_standby(bool standby);
+// take over as the active instance, safe from a signal handler
+void neu_manager_takeover();
+
+// Seconds the destroy waits for the nodes to close, 0 waits for all of them.
+void neu_manager_set_shutdown_timeout(uint32_t timeout);
+
+// Add a plugin compiled into neuron, before the manager is created. Its nodes
+// are loaded and created like those of any library.
+int neu_manager_add_builtin_plugin(const neu_plugin_module_t *module);
+
 #endif
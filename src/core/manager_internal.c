@@ -19,6 +19,8 @@
 #include <dlfcn.h>
 
 #include "utils/log.h"
+#include "utils/mem_budget.h"
+#include "utils/time.h"
 #include "json/neu_json_param.h"
 
 #include "adapter.h"
@@ -46,15 +48,9 @@ UT_array *neu_manager_get_plugins(neu_manager_t *manager)
     return neu_plugin_manager_get(manager->plugin_manager);
 }
 
-int neu_manager_add_node(neu_manager_t *manager, const char *node_name,
-                         const char *plugin_name, const char *setting,
-                         neu_node_running_state_e state, bool load)
+int neu_manager_new_instance(neu_manager_t *manager, const char *plugin_name,
+                             neu_plugin_instance_t *instance)
 {
-    neu_adapter_t *       adapter      = NULL;
-    neu_plugin_instance_t instance     = { 0 };
-    neu_adapter_info_t    adapter_info = {
-        .name = node_name,
-    };
     neu_resp_plugin_info_t info = { 0 };
     int                    ret =
         neu_plugin_manager_find(manager->plugin_manager, plugin_name, &info);
@@ -67,16 +63,29 @@ int neu_manager_add_node(neu_manager_t *manager, const char *node_name,
         return NEU_ERR_LIBRARY_NOT_ALLOW_CREATE_INSTANCE;
     }
 
-    adapter = neu_node_manager_find(manager->node_manager, node_name);
-    if (adapter != NULL) {
-        return NEU_ERR_NODE_EXIST;
-    }
-
     ret = neu_plugin_manager_create_instance(manager->plugin_manager, info.name,
-                                             &instance);
+                                             instance);
     if (ret != 0) {
         return NEU_ERR_LIBRARY_FAILED_TO_OPEN;
     }
+
+    return NEU_ERR_SUCCESS;
+}
+
+int neu_manager_new_adapter(neu_manager_t *manager, const char *node_name,
+                            const char *plugin_name, bool load,
+                            neu_adapter_t **adapter_p)
+{
+    neu_adapter_t *       adapter      = NULL;
+    neu_plugin_instance_t instance     = { 0 };
+    neu_adapter_info_t    adapter_info = {
+        .name = node_name,
+    };
+    int ret = neu_manager_new_instance(manager, plugin_name, &instance);
+
+    if (ret != NEU_ERR_SUCCESS) {
+        return ret;
+    }
     adapter_info.handle = instance.handle;
     adapter_info.module = instance.module;
 
@@ -84,8 +93,35 @@ int neu_manager_add_node(neu_manager_t *manager, const char *node_name,
     if (adapter == NULL) {
         return neu_adapter_error();
     }
+
+    *adapter_p = adapter;
+    return NEU_ERR_SUCCESS;
+}
+
+void neu_manager_add_adapter(neu_manager_t *manager, neu_adapter_t *adapter,
+                             neu_node_running_state_e state)
+{
     neu_node_manager_add(manager->node_manager, adapter);
     neu_adapter_init(adapter, state);
+}
+
+int neu_manager_add_node(neu_manager_t *manager, const char *node_name,
+                         const char *plugin_name, const char *setting,
+                         neu_node_running_state_e state, bool load)
+{
+    neu_adapter_t *adapter = NULL;
+    int            ret     = 0;
+
+    if (neu_node_manager_find(manager->node_manager, node_name) != NULL) {
+        return NEU_ERR_NODE_EXIST;
+    }
+
+    ret = neu_manager_new_adapter(manager, node_name, plugin_name, load,
+                                  &adapter);
+    if (ret != NEU_ERR_SUCCESS) {
+        return ret;
+    }
+    neu_manager_add_adapter(manager, adapter, state);
 
     if (NULL != setting &&
         0 != (ret = neu_adapter_set_setting(adapter, setting))) {
@@ -98,6 +134,11 @@ int neu_manager_add_node(neu_manager_t *manager, const char *node_name,
     return NEU_ERR_SUCCESS;
 }
 
+static void destroy_adapter(void *arg)
+{
+    neu_adapter_destroy((neu_adapter_t *) arg);
+}
+
 int neu_manager_del_node(neu_manager_t *manager, const char *node_name)
 {
     neu_adapter_t *adapter =
@@ -107,9 +148,18 @@ int neu_manager_del_node(neu_manager_t *manager, const char *node_name)
         return NEU_ERR_NODE_NOT_EXIST;
     }
 
-    neu_adapter_destroy(adapter);
-    neu_subscribe_manager_remove(manager->subscribe_manager, node_name, NULL);
+    // the route goes first, apps must not send to the closed sockets
     neu_node_manager_del(manager->node_manager, node_name);
+    neu_subscribe_manager_remove(manager->subscribe_manager, node_name, NULL);
+
+    // closing the plugin and joining the threads of the adapter may take a
+    // while, the node is busy in the workers until it is destroyed
+    if (manager->workers == NULL ||
+        0 !=
+            neu_worker_pool_submit(manager->workers, node_name,
+                                   destroy_adapter, NULL, adapter)) {
+        neu_adapter_destroy(adapter);
+    }
     return NEU_ERR_SUCCESS;
 }
 
@@ -228,6 +278,89 @@ static inline int manager_subscribe(neu_manager_t *manager, const char *app,
                                      group, params, addr);
 }
 
+// Start dormant driver `driver` on its first demand, and note the demand of
+// a lazy driver for neu_manager_sleep_idle_drivers.
+void neu_manager_wake_driver(neu_manager_t *manager, const char *driver)
+{
+    neu_adapter_t *adapter = NULL;
+    int            ret     = 0;
+
+    neu_node_manager_touch(manager->node_manager, driver, neu_time_ms());
+    if (!neu_node_manager_is_dormant(manager->node_manager, driver)) {
+        return;
+    }
+
+    adapter = neu_node_manager_find(manager->node_manager, driver);
+    ret     = neu_adapter_start(adapter);
+    neu_node_manager_set_dormant(manager->node_manager, driver, false);
+    nlog_notice("wake driver %s on demand, ret: %d", driver, ret);
+}
+
+// Stop lazy drivers without subscription and without demand for `idle_ms`,
+// they are woken again by the next demand.
+void neu_manager_sleep_idle_drivers(neu_manager_t *manager, int64_t idle_ms)
+{
+    UT_array *adapters = neu_node_manager_get_idle(manager->node_manager,
+                                                   neu_time_ms() - idle_ms);
+
+    utarray_foreach(adapters, neu_adapter_t **, adapter)
+    {
+        UT_array *apps = neu_subscribe_manager_find_by_driver(
+            manager->subscribe_manager, (*adapter)->name);
+
+        if (utarray_len(apps) == 0) {
+            int ret = neu_adapter_suspend(*adapter);
+            if (ret == NEU_ERR_SUCCESS) {
+                neu_node_manager_set_dormant(manager->node_manager,
+                                             (*adapter)->name, true);
+            }
+            nlog_notice("sleep idle driver %s, ret: %d", (*adapter)->name,
+                        ret);
+        }
+        utarray_free(apps);
+    }
+
+    utarray_free(adapters);
+}
+
+// put a driver placed automatically on the cpus of the app it reports the
+// most groups to, floating if that app is not pinned
+static void manager_place_driver(neu_manager_t *manager, const char *driver)
+{
+    neu_adapter_t *adapter = NULL;
+    neu_adapter_t *main    = NULL;
+    uint32_t       most    = 0;
+    neu_cpus_t     cpus    = { 0 };
+    UT_array *     apps    = NULL;
+
+    adapter = neu_node_manager_find(manager->node_manager, driver);
+    if (adapter == NULL || !neu_adapter_auto_place(adapter)) {
+        return;
+    }
+
+    apps = neu_subscribe_manager_find_by_driver(manager->subscribe_manager,
+                                                driver);
+    utarray_foreach(apps, neu_app_subscribe_t *, sub)
+    {
+        uint32_t n = 0;
+        utarray_foreach(apps, neu_app_subscribe_t *, other)
+        {
+            n += strcmp(sub->app_name, other->app_name) == 0;
+        }
+        if (n > most) {
+            most = n;
+            main = neu_node_manager_find(manager->node_manager, sub->app_name);
+        }
+    }
+    utarray_free(apps);
+
+    if (main != NULL && neu_adapter_get_cpus(main, &cpus)) {
+        neu_adapter_place(adapter, &cpus);
+    } else {
+        neu_adapter_place(adapter, NULL);
+    }
+}
+
 int neu_manager_subscribe(neu_manager_t *manager, const char *app,
                           const char *driver, const char *group,
                           const char *params, uint16_t *app_port)
@@ -256,7 +389,21 @@ int neu_manager_subscribe(neu_manager_t *manager, const char *app,
         return NEU_ERR_NODE_NOT_ALLOW_SUBSCRIBE;
     }
 
-    return manager_subscribe(manager, app, driver, group, params);
+    if ((neu_mem_budget_policies() & NEU_MEM_REJECT_SUBSCRIBE) &&
+        neu_mem_budget_over()) {
+        nlog_warn("%s subscribe %s:%s rejected, %zu bytes over budget %zu",
+                  app, driver, group, neu_mem_budget_used(),
+                  neu_mem_budget_limit());
+        return NEU_ERR_MEM_BUDGET_EXCEEDED;
+    }
+
+    int ret = manager_subscribe(manager, app, driver, group, params);
+    if (ret == NEU_ERR_SUCCESS) {
+        neu_manager_wake_driver(manager, driver);
+        manager_place_driver(manager, driver);
+    }
+
+    return ret;
 }
 
 int neu_manager_update_subscribe(neu_manager_t *manager, const char *app,
@@ -330,8 +477,12 @@ int neu_manager_send_subscribe(neu_manager_t *manager, const char *app,
 int neu_manager_unsubscribe(neu_manager_t *manager, const char *app,
                             const char *driver, const char *group)
 {
-    return neu_subscribe_manager_unsub(manager->subscribe_manager, driver, app,
-                                       group);
+    int ret = neu_subscribe_manager_unsub(manager->subscribe_manager, driver,
+                                          app, group);
+    if (ret == NEU_ERR_SUCCESS) {
+        manager_place_driver(manager, driver);
+    }
+    return ret;
 }
 
 UT_array *neu_manager_get_sub_group(neu_manager_t *manager, const char *app)
@@ -20,6 +20,8 @@
 #ifndef _NEU_MANAGER_INTERNAL_H_
 #define _NEU_MANAGER_INTERNAL_H_
 
+#include <pthread.h>
+
 #include "event/event.h"
 #include "persist/persist.h"
 
@@ -29,28 +31,57 @@
 #include "plugin_manager.h"
 #include "subscribe.h"
 #include "utils/log.h"
+#include "worker.h"
 
 typedef struct neu_manager {
     int server_fd;
 
     neu_events_t *  events;
     neu_event_io_t *loop;
+    neu_event_io_t *loop_bus;
 
     neu_plugin_manager_t *plugin_manager;
     neu_node_manager_t *  node_manager;
     neu_subscribe_mgr_t * subscribe_manager;
 
     neu_event_timer_t *timer_timestamp;
+    neu_event_timer_t *timer_idle;
 
     int64_t timestamp_lev_manager;
 
     int log_level;
+
+    // heavy requests of nodes run in the workers, the requests to a busy
+    // node wait in deferred, see manager_dispatch
+    neu_worker_pool_t *      workers;
+    struct manager_deferred *deferred;
+    neu_event_timer_t *      timer_state;
+
+    // neu_req_node_init_t of the nodes a standby holds until the takeover,
+    // NULL once the instance is active
+    UT_array *         held;
+    neu_event_timer_t *timer_takeover;
+
+    // guards the node addresses against the waits of start and stop,
+    // signalled by the loop whenever a node binds its address or is gone
+    pthread_mutex_t nodes_mtx;
+    pthread_cond_t  nodes_cond;
 } neu_manager_t;
 
 int       neu_manager_add_plugin(neu_manager_t *manager, const char *library);
 int       neu_manager_del_plugin(neu_manager_t *manager, const char *plugin);
 UT_array *neu_manager_get_plugins(neu_manager_t *manager);
 
+int neu_manager_new_instance(neu_manager_t *manager, const char *plugin_name,
+                             neu_plugin_instance_t *instance);
+// Create the adapter of a node without adding it, which neither reads nor
+// changes the nodes of the manager, so nodes may be created in parallel.
+int  neu_manager_new_adapter(neu_manager_t *manager, const char *node_name,
+                             const char *plugin_name, bool load,
+                             neu_adapter_t **adapter_p);
+void neu_manager_add_adapter(neu_manager_t *manager, neu_adapter_t *adapter,
+                             neu_node_running_state_e state);
+
 int       neu_manager_add_node(neu_manager_t *manager, const char *node_name,
                                const char *plugin_name, const char *setting,
                                neu_node_running_state_e state, bool load);
@@ -87,6 +118,9 @@ int neu_manager_get_node_info(neu_manager_t *manager, const char *name,
 int neu_manager_add_drivers(neu_manager_t *         manager,
                             neu_req_driver_array_t *req);
 
+void neu_manager_wake_driver(neu_manager_t *manager, const char *driver);
+void neu_manager_sleep_idle_drivers(neu_manager_t *manager, int64_t idle_ms);
+
 inline static void forward_msg(neu_manager_t *     manager,
                                neu_reqresp_head_t *header, const char *node)
 {
@@ -17,6 +17,9 @@
  * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
  **/
 
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -32,6 +35,9 @@ typedef struct node_entity {
     bool               is_static;
     bool               display;
     bool               single;
+    bool               lazy;      // started on demand, stopped when idle
+    bool               dormant;   // lazy and not started
+    int64_t            active_ts; // last demand of a lazy node
     struct sockaddr_un addr;
 
     UT_hash_handle hh;
@@ -41,6 +47,71 @@ struct neu_node_manager {
     node_entity_t *nodes;
 };
 
+// the data plane routes published to the apps, read from their threads
+typedef struct node_route {
+    char *             name;
+    struct sockaddr_un addr;
+
+    UT_hash_handle hh;
+} node_route_t;
+
+static pthread_rwlock_t routes_lock = PTHREAD_RWLOCK_INITIALIZER;
+static node_route_t *   routes      = NULL;
+
+static void route_del(const char *name)
+{
+    node_route_t *route = NULL;
+
+    pthread_rwlock_wrlock(&routes_lock);
+    HASH_FIND_STR(routes, name, route);
+    if (route != NULL) {
+        HASH_DEL(routes, route);
+        free(route->name);
+        free(route);
+    }
+    pthread_rwlock_unlock(&routes_lock);
+}
+
+// a started driver, not lazy, is routed to its trans data socket, demand on a
+// lazy one goes through the manager to wake it up
+static void route_sync(node_entity_t *node)
+{
+    node_route_t *route = NULL;
+    uint16_t      port  = neu_adapter_trans_data_port(node->adapter);
+
+    if (node->is_static || node->lazy || node->addr.sun_path[1] == 0 ||
+        node->adapter->module->type != NEU_NA_TYPE_DRIVER || port == 0) {
+        route_del(node->name);
+        return;
+    }
+
+    pthread_rwlock_wrlock(&routes_lock);
+    HASH_FIND_STR(routes, node->name, route);
+    if (route == NULL) {
+        route       = calloc(1, sizeof(node_route_t));
+        route->name = strdup(node->name);
+        HASH_ADD_STR(routes, name, route);
+    }
+    route->addr.sun_family = AF_UNIX;
+    snprintf(route->addr.sun_path, sizeof(route->addr.sun_path),
+             "%cneuron-%" PRIu16, '\0', port);
+    pthread_rwlock_unlock(&routes_lock);
+}
+
+bool neu_node_manager_find_route(const char *name, struct sockaddr_un *addr)
+{
+    node_route_t *route = NULL;
+
+    pthread_rwlock_rdlock(&routes_lock);
+    HASH_FIND_STR(routes, name, route);
+    if (route != NULL) {
+        *addr = route->addr;
+    }
+    pthread_rwlock_unlock(&routes_lock);
+
+    return route != NULL;
+}
+
 neu_node_manager_t *neu_node_manager_create()
 {
     neu_node_manager_t *node_manager = calloc(1, sizeof(neu_node_manager_t));
@@ -53,6 +124,7 @@ void neu_node_manager_destroy(neu_node_manager_t *mgr)
 
     HASH_ITER(hh, mgr->nodes, el, tmp)
     {
+        route_del(el->name);
         HASH_DEL(mgr->nodes, el);
         free(el->name);
         free(el);
@@ -118,10 +190,12 @@ int neu_node_manager_update_name(neu_node_manager_t *mgr, const char *node_name,
         return NEU_ERR_EINTERNAL;
     }
 
+    route_del(node->name);
     HASH_DEL(mgr->nodes, node);
     free(node->name);
     node->name = new_name;
     HASH_ADD_STR(mgr->nodes, name, node);
+    route_sync(node);
 
     return 0;
 }
@@ -136,16 +210,81 @@ int neu_node_manager_update(neu_node_manager_t *mgr, const char *name,
         return -1;
     }
     node->addr = addr;
+    route_sync(node);
 
     return 0;
 }
 
+void neu_node_manager_set_lazy(neu_node_manager_t *mgr, const char *name,
+                               bool lazy)
+{
+    node_entity_t *node = NULL;
+
+    HASH_FIND_STR(mgr->nodes, name, node);
+    if (node != NULL) {
+        node->lazy    = lazy;
+        node->dormant = lazy && node->dormant;
+        route_sync(node);
+    }
+}
+
+void neu_node_manager_set_dormant(neu_node_manager_t *mgr, const char *name,
+                                  bool dormant)
+{
+    node_entity_t *node = NULL;
+
+    HASH_FIND_STR(mgr->nodes, name, node);
+    if (node != NULL) {
+        node->lazy    = node->lazy || dormant;
+        node->dormant = dormant;
+        route_sync(node);
+    }
+}
+
+bool neu_node_manager_is_dormant(neu_node_manager_t *mgr, const char *name)
+{
+    node_entity_t *node = NULL;
+
+    HASH_FIND_STR(mgr->nodes, name, node);
+    return node != NULL && node->dormant;
+}
+
+void neu_node_manager_touch(neu_node_manager_t *mgr, const char *name,
+                            int64_t ts)
+{
+    node_entity_t *node = NULL;
+
+    HASH_FIND_STR(mgr->nodes, name, node);
+    if (node != NULL) {
+        node->active_ts = ts;
+    }
+}
+
+UT_array *neu_node_manager_get_idle(neu_node_manager_t *mgr, int64_t ts)
+{
+    UT_icd         icd   = { sizeof(neu_adapter_t *), NULL, NULL, NULL };
+    UT_array *     array = NULL;
+    node_entity_t *el = NULL, *tmp = NULL;
+
+    utarray_new(array, &icd);
+
+    HASH_ITER(hh, mgr->nodes, el, tmp)
+    {
+        if (el->lazy && !el->dormant && el->active_ts < ts) {
+            utarray_push_back(array, &el->adapter);
+        }
+    }
+
+    return array;
+}
+
 void neu_node_manager_del(neu_node_manager_t *mgr, const char *name)
 {
     node_entity_t *node = NULL;
 
     HASH_FIND_STR(mgr->nodes, name, node);
     if (node != NULL) {
+        route_del(node->name);
         HASH_DEL(mgr->nodes, node);
         free(node->name);
         free(node);
@@ -171,6 +310,34 @@ bool neu_node_manager_exist_uninit(neu_node_manager_t *mgr)
     return false;
 }
 
+uint16_t neu_node_manager_names(neu_node_manager_t *mgr, bool unbound,
+                                char *buf, size_t size)
+{
+    node_entity_t *el = NULL, *tmp = NULL;
+    uint16_t       n   = 0;
+    size_t         off = 0;
+
+    if (size > 0) {
+        buf[0] = '\0';
+    }
+
+    HASH_ITER(hh, mgr->nodes, el, tmp)
+    {
+        if (unbound && el->addr.sun_path[1] != 0) {
+            continue;
+        }
+
+        if (off < size) {
+            int rv = snprintf(buf + off, size - off, "%s%s", n > 0 ? "," : "",
+                              el->name);
+            off += rv > 0 ? (size_t) rv : 0;
+        }
+        n += 1;
+    }
+
+    return n;
+}
+
 UT_array *neu_node_manager_get(neu_node_manager_t *mgr, int type)
 {
     UT_array *     array = NULL;
@@ -382,3 +549,39 @@ UT_array *neu_node_manager_get_state(neu_node_manager_t *mgr)
 
     return states;
 }
+
+// the last nodes state built by the manager, read by the apps from their
+// threads without a round trip through the manager
+static pthread_rwlock_t states_lock       = PTHREAD_RWLOCK_INITIALIZER;
+static UT_array *       states_snapshot   = NULL;
+static int              states_core_level = 0;
+
+void neu_node_manager_publish_state(UT_array *states, int core_level)
+{
+    UT_array *old = NULL;
+
+    pthread_rwlock_wrlock(&states_lock);
+    old               = states_snapshot;
+    states_snapshot   = states;
+    states_core_level = core_level;
+    pthread_rwlock_unlock(&states_lock);
+
+    if (old != NULL) {
+        utarray_free(old);
+    }
+}
+
+bool neu_node_manager_find_state(UT_array **states, int *core_level)
+{
+    bool found = false;
+
+    pthread_rwlock_rdlock(&states_lock);
+    if (states_snapshot != NULL) {
+        *states     = utarray_clone(states_snapshot);
+        *core_level = states_core_level;
+        found       = true;
+    }
+    pthread_rwlock_unlock(&states_lock);
+
+    return found;
+}
@@ -43,6 +43,23 @@ int neu_node_manager_update_name(neu_node_manager_t *mgr, const char *node_name,
 int neu_node_manager_update(neu_node_manager_t *mgr, const char *name,
                             struct sockaddr_un addr);
 bool     neu_node_manager_exist_uninit(neu_node_manager_t *mgr);
+// names of the nodes, or only of those not bound yet, comma separated into
+// buf and truncated to size, returns the count of those nodes
+uint16_t neu_node_manager_names(neu_node_manager_t *mgr, bool unbound,
+                                char *buf, size_t size);
+
+// lazy nodes are started on their first demand and stopped again when idle,
+// a dormant node is a lazy node not started
+void neu_node_manager_set_lazy(neu_node_manager_t *mgr, const char *name,
+                               bool lazy);
+void neu_node_manager_set_dormant(neu_node_manager_t *mgr, const char *name,
+                                  bool dormant);
+bool neu_node_manager_is_dormant(neu_node_manager_t *mgr, const char *name);
+void neu_node_manager_touch(neu_node_manager_t *mgr, const char *name,
+                            int64_t ts);
+// neu_adapter_t array of started lazy nodes without demand since `ts`
+UT_array *neu_node_manager_get_idle(neu_node_manager_t *mgr, int64_t ts);
+
 void     neu_node_manager_del(neu_node_manager_t *mgr, const char *name);
 uint16_t neu_node_manager_size(neu_node_manager_t *mgr);
 
@@ -64,7 +81,18 @@ UT_array *neu_node_manager_get_addrs_all(neu_node_manager_t *mgr);
 struct sockaddr_un neu_node_manager_get_addr(neu_node_manager_t *mgr,
                                              const char *        name);
 
+// The trans data address the apps send reads and writes of a driver to,
+// bypassing the manager. Safe from any thread, the route is gone once the
+// node is deleted, renamed or lazy.
+bool neu_node_manager_find_route(const char *name, struct sockaddr_un *addr);
+
 // neu_nodes_state_t array
 UT_array *neu_node_manager_get_state(neu_node_manager_t *mgr);
 
+// The snapshot of the nodes state answering the apps from their threads.
+// Publishing takes the ownership of `states`, NULL withdraws the snapshot.
+// A found snapshot is a copy to be freed by the caller.
+void neu_node_manager_publish_state(UT_array *states, int core_level);
+bool neu_node_manager_find_state(UT_array **states, int *core_level);
+
 #endif
@@ -49,6 +49,9 @@ typedef struct plugin_entity {
     bool  single;
     char *single_name;
 
+    // compiled into neuron, NULL for a library
+    const neu_plugin_module_t *builtin;
+
     UT_hash_handle hh;
 } plugin_entity_t;
 
@@ -172,6 +175,35 @@ int neu_plugin_manager_add(neu_plugin_manager_t *mgr,
     return NEU_ERR_SUCCESS;
 }
 
+int neu_plugin_manager_add_builtin(neu_plugin_manager_t *     mgr,
+                                   const neu_plugin_module_t *pm)
+{
+    plugin_entity_t *plugin = NULL;
+
+    HASH_FIND_STR(mgr->plugins, pm->module_name, plugin);
+    if (plugin != NULL) {
+        return NEU_ERR_LIBRARY_NAME_CONFLICT;
+    }
+    plugin = calloc(1, sizeof(plugin_entity_t));
+
+    plugin->version        = pm->version;
+    plugin->display        = pm->display;
+    plugin->type           = pm->type;
+    plugin->kind           = pm->kind;
+    plugin->schema         = strdup(pm->schema);
+    plugin->name           = strdup(pm->module_name);
+    plugin->lib_name       = strdup(pm->module_name);
+    plugin->description    = strdup(pm->module_descr);
+    plugin->description_zh = strdup(pm->module_descr_zh);
+    plugin->builtin        = pm;
+
+    HASH_ADD_STR(mgr->plugins, name, plugin);
+
+    nlog_notice("add builtin plugin, name: %s, kind: %d, type: %d",
+                plugin->name, plugin->kind, plugin->type);
+    return NEU_ERR_SUCCESS;
+}
+
 int neu_plugin_manager_update(neu_plugin_manager_t *mgr,
                               const char *          plugin_lib_name)
 {
@@ -280,12 +312,13 @@ UT_array *neu_plugin_manager_get(neu_plugin_manager_t *mgr)
         };
 
         info.display = el->display;
-        strncpy(info.schema, el->schema, sizeof(info.schema));
-        strncpy(info.name, el->name, sizeof(info.name));
-        strncpy(info.library, el->lib_name, sizeof(info.library));
-        strncpy(info.description, el->description, sizeof(info.description));
+        strncpy(info.schema, el->schema, sizeof(info.schema) - 1);
+        strncpy(info.name, el->name, sizeof(info.name) - 1);
+        strncpy(info.library, el->lib_name, sizeof(info.library) - 1);
+        strncpy(info.description, el->description,
+                sizeof(info.description) - 1);
         strncpy(info.description_zh, el->description_zh,
-                sizeof(info.description_zh));
+                sizeof(info.description_zh) - 1);
 
         utarray_push_back(plugins, &info);
     }
@@ -311,15 +344,15 @@ UT_array *neu_plugin_manager_get_single(neu_plugin_manager_t *mgr)
             info.display = el->display;
             info.single  = el->single;
 
-            strncpy(info.schema, el->schema, sizeof(info.schema));
+            strncpy(info.schema, el->schema, sizeof(info.schema) - 1);
             strncpy(info.single_name, el->single_name,
-                    sizeof(info.single_name));
-            strncpy(info.name, el->name, sizeof(info.name));
-            strncpy(info.library, el->lib_name, sizeof(info.library));
+                    sizeof(info.single_name) - 1);
+            strncpy(info.name, el->name, sizeof(info.name) - 1);
+            strncpy(info.library, el->lib_name, sizeof(info.library) - 1);
             strncpy(info.description, el->description,
-                    sizeof(info.description));
+                    sizeof(info.description) - 1);
             strncpy(info.description_zh, el->description_zh,
-                    sizeof(info.description_zh));
+                    sizeof(info.description_zh) - 1);
 
             utarray_push_back(plugins, &info);
         }
@@ -345,10 +378,10 @@ int neu_plugin_manager_find(neu_plugin_manager_t *mgr, const char *plugin_name,
         if (plugin->single_name != NULL) {
             strcpy(info->single_name, plugin->single_name);
         }
-        strncpy(info->name, plugin->name, sizeof(info->name));
-        strncpy(info->library, plugin->lib_name, sizeof(info->library));
+        strncpy(info->name, plugin->name, sizeof(info->name) - 1);
+        strncpy(info->library, plugin->lib_name, sizeof(info->library) - 1);
         strncpy(info->description, plugin->description,
-                sizeof(info->description));
+                sizeof(info->description) - 1);
     }
 
     return ret;
@@ -386,6 +419,11 @@ int neu_plugin_manager_create_instance(neu_plugin_manager_t * mgr,
     snprintf(lib_paths[2], sizeof(lib_paths[2]), "%s/custom", g_plugin_dir);
 
     HASH_FIND_STR(mgr->plugins, plugin_name, plugin);
+    if (plugin != NULL && plugin->builtin != NULL) {
+        instance->handle = NULL;
+        instance->module = (neu_plugin_module_t *) plugin->builtin;
+        return 0;
+    }
     if (plugin != NULL) {
 
         for (size_t i = 0; i < sizeof(lib_paths) / sizeof(lib_paths[0]); i++) {
@@ -40,6 +40,9 @@ void                  neu_plugin_manager_destroy(neu_plugin_manager_t *mgr);
 
 int neu_plugin_manager_add(neu_plugin_manager_t *mgr,
                            const char *          plugin_lib_name);
+// a plugin compiled into neuron, its instances have no library handle
+int neu_plugin_manager_add_builtin(neu_plugin_manager_t *     mgr,
+                                   const neu_plugin_module_t *module);
 int neu_plugin_manager_del(neu_plugin_manager_t *mgr, const char *plugin_name);
 
 // neu_resp_plugin_info_t array
@@ -16,6 +16,8 @@
  * along with this program; if not, write to the Free Software Foundation,
  * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
  **/
+#include <pthread.h>
+
 #include "errcodes.h"
 #include "utils/log.h"
 
@@ -61,12 +63,14 @@ void manager_storage_update_node(neu_manager_t *manager, const char *node,
 {
     (void) manager;
     neu_persister_update_node(node, new_name);
+    adapter_storage_update_lkv(node, new_name);
 }
 
 void manager_storage_del_node(neu_manager_t *manager, const char *node)
 {
     (void) manager;
     neu_persister_delete_node(node);
+    adapter_storage_del_lkv(node);
 }
 
 void manager_storage_subscribe(neu_manager_t *manager, const char *app,
@@ -126,10 +130,66 @@ int manager_load_plugin(neu_manager_t *manager)
     return rv;
 }
 
+// Nodes are created by a pool of threads, most of the time of a node goes
+// to loading its plugin, settings, groups and tags. The loading thread adds
+// each node to the manager as soon as it is created, so the state of every
+// node is reported while the others are still loading.
+#define NODE_LOAD_WORKERS 8
+
+typedef struct {
+    neu_persist_node_info_t *info;
+    neu_adapter_t *          adapter;
+    int                      rv;
+} node_load_t;
+
+typedef struct {
+    neu_manager_t * manager;
+    node_load_t *   loads;
+    size_t          n_load;
+    size_t          next;   // next node to create
+    size_t *        done;   // indexes of the created nodes, in order
+    size_t          n_done;
+    pthread_mutex_t mtx;
+    pthread_cond_t  cond;
+} node_loader_t;
+
+static void *node_load_worker(void *arg)
+{
+    node_loader_t *loader = arg;
+
+    while (true) {
+        node_load_t *load = NULL;
+
+        pthread_mutex_lock(&loader->mtx);
+        if (loader->next < loader->n_load) {
+            load = &loader->loads[loader->next++];
+        }
+        pthread_mutex_unlock(&loader->mtx);
+
+        if (load == NULL) {
+            break;
+        }
+
+        load->rv = neu_manager_new_adapter(loader->manager, load->info->name,
+                                           load->info->plugin_name, true,
+                                           &load->adapter);
+
+        pthread_mutex_lock(&loader->mtx);
+        loader->done[loader->n_done++] = load - loader->loads;
+        pthread_cond_signal(&loader->cond);
+        pthread_mutex_unlock(&loader->mtx);
+    }
+
+    return NULL;
+}
+
 int manager_load_node(neu_manager_t *manager)
 {
-    UT_array *node_infos = NULL;
-    int       rv         = 0;
+    UT_array *    node_infos                 = NULL;
+    int           rv                         = 0;
+    node_loader_t loader                     = { .manager = manager };
+    pthread_t     workers[NODE_LOAD_WORKERS] = { 0 };
+    int           n_worker                   = 0;
 
     rv = neu_persister_load_nodes(&node_infos);
     if (0 != rv) {
@@ -137,16 +197,64 @@ int manager_load_node(neu_manager_t *manager)
         return -1;
     }
 
+    loader.n_load = utarray_len(node_infos);
+    loader.loads  = calloc(loader.n_load, sizeof(node_load_t));
+    loader.done   = calloc(loader.n_load, sizeof(size_t));
+    if (loader.n_load > 0 && (loader.loads == NULL || loader.done == NULL)) {
+        nlog_error("failed to alloc adapter loads");
+        free(loader.loads);
+        free(loader.done);
+        utarray_free(node_infos);
+        return -1;
+    }
+
     utarray_foreach(node_infos, neu_persist_node_info_t *, node_info)
     {
-        rv                    = neu_manager_add_node(manager, node_info->name,
-                                  node_info->plugin_name, NULL,
-                                  node_info->state, true);
+        loader.loads[utarray_eltidx(node_infos, node_info)].info = node_info;
+    }
+
+    pthread_mutex_init(&loader.mtx, NULL);
+    pthread_cond_init(&loader.cond, NULL);
+    while (n_worker < NODE_LOAD_WORKERS && (size_t) n_worker < loader.n_load) {
+        if (0 !=
+            pthread_create(&workers[n_worker], NULL, node_load_worker,
+                           &loader)) {
+            break;
+        }
+        ++n_worker;
+    }
+    if (0 == n_worker) {
+        node_load_worker(&loader);
+    }
+
+    for (size_t i = 0; i < loader.n_load; ++i) {
+        node_load_t *load = NULL;
+
+        pthread_mutex_lock(&loader.mtx);
+        while (loader.n_done <= i) {
+            pthread_cond_wait(&loader.cond, &loader.mtx);
+        }
+        load = &loader.loads[loader.done[i]];
+        pthread_mutex_unlock(&loader.mtx);
+
+        rv = load->rv;
+        if (0 == rv) {
+            neu_manager_add_adapter(manager, load->adapter, load->info->state);
+        }
+
         const char *ok_or_err = (0 == rv) ? "success" : "fail";
         nlog_notice("load adapter %s type:%d, name:%s plugin:%s state:%d",
-                    ok_or_err, node_info->type, node_info->name,
-                    node_info->plugin_name, node_info->state);
+                    ok_or_err, load->info->type, load->info->name,
+                    load->info->plugin_name, load->info->state);
+    }
+
+    for (int i = 0; i < n_worker; ++i) {
+        pthread_join(workers[i], NULL);
     }
+    pthread_cond_destroy(&loader.cond);
+    pthread_mutex_destroy(&loader.mtx);
+    free(loader.loads);
+    free(loader.done);
 
     utarray_free(node_infos);
     return rv;
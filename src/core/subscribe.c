@@ -20,30 +20,197 @@
 
 #include "adapter.h"
 #include "errcodes.h"
+#include "utils/hash.h"
 #include "utils/log.h"
+#include "utils/utlist.h"
 
 #include "subscribe.h"
 
-typedef struct sub_elem_key {
-    char driver[NEU_NODE_NAME_LEN];
-    char group[NEU_GROUP_NAME_LEN];
-} sub_elem_key_t;
-
 typedef struct sub_elem {
-    sub_elem_key_t key;
+    // "driver\0group", hashed on the names only
+    char key[NEU_NODE_NAME_LEN + NEU_GROUP_NAME_LEN];
 
     UT_array *apps;
 
-    UT_hash_handle hh;
+    UT_hash_handle   hh;
+    struct sub_elem *prev; // the groups of the same driver
+    struct sub_elem *next;
 } sub_elem_t;
 
+// the groups of a driver, whether subscribed or not
+typedef struct sub_driver {
+    char        name[NEU_NODE_NAME_LEN];
+    sub_elem_t *elems;
+
+    UT_hash_handle hh;
+} sub_driver_t;
+
+// a group subscribed by an app
+typedef struct sub_ref {
+    sub_elem_t *elem;
+
+    UT_hash_handle hh;
+} sub_ref_t;
+
+// the groups subscribed by an app
+typedef struct sub_app {
+    char       name[NEU_NODE_NAME_LEN];
+    sub_ref_t *refs;
+
+    UT_hash_handle hh;
+} sub_app_t;
+
 static const UT_icd app_sub_icd = { sizeof(neu_app_subscribe_t), NULL, NULL,
                                     NULL };
 
+// Subscriptions are indexed by group, by driver and by app, so that no
+// request scans all the subscriptions.
 struct neu_subscribe_mgr {
-    sub_elem_t *ss;
+    sub_elem_t *  ss;
+    sub_driver_t *drivers;
+    sub_app_t *   apps;
 };
 
+static inline size_t elem_key(char *key, const char *driver,
+                              const char *group)
+{
+    return neu_hash_key_pair(key, driver, NEU_NODE_NAME_LEN, group,
+                             NEU_GROUP_NAME_LEN);
+}
+
+static inline const char *elem_driver(const sub_elem_t *elem)
+{
+    return elem->key;
+}
+
+static inline const char *elem_group(const sub_elem_t *elem)
+{
+    return elem->key + strlen(elem->key) + 1;
+}
+
+static inline sub_elem_t *elem_find(const neu_subscribe_mgr_t *mgr,
+                                    const char *driver, const char *group)
+{
+    sub_elem_t *find = NULL;
+    char        key[NEU_NODE_NAME_LEN + NEU_GROUP_NAME_LEN];
+    size_t      len = elem_key(key, driver, group);
+
+    HASH_FIND(hh, mgr->ss, key, len, find);
+    return find;
+}
+
+static inline sub_driver_t *driver_find(const neu_subscribe_mgr_t *mgr,
+                                        const char *               driver)
+{
+    sub_driver_t *find = NULL;
+
+    HASH_FIND_STR(mgr->drivers, driver, find);
+    return find;
+}
+
+static inline sub_app_t *app_find(const neu_subscribe_mgr_t *mgr,
+                                  const char *               app)
+{
+    sub_app_t *find = NULL;
+
+    HASH_FIND_STR(mgr->apps, app, find);
+    return find;
+}
+
+static int app_ref(neu_subscribe_mgr_t *mgr, const char *app, sub_elem_t *elem)
+{
+    sub_app_t *sa  = app_find(mgr, app);
+    sub_ref_t *ref = NULL;
+
+    if (sa == NULL) {
+        sa = calloc(1, sizeof(sub_app_t));
+        if (sa == NULL) {
+            return NEU_ERR_EINTERNAL;
+        }
+        strncpy(sa->name, app, sizeof(sa->name) - 1);
+        HASH_ADD_STR(mgr->apps, name, sa);
+    }
+
+    ref = calloc(1, sizeof(sub_ref_t));
+    if (ref == NULL) {
+        return NEU_ERR_EINTERNAL;
+    }
+    ref->elem = elem;
+    HASH_ADD_PTR(sa->refs, elem, ref);
+    return NEU_ERR_SUCCESS;
+}
+
+static void app_unref(neu_subscribe_mgr_t *mgr, const char *app,
+                      sub_elem_t *elem)
+{
+    sub_app_t *sa  = app_find(mgr, app);
+    sub_ref_t *ref = NULL;
+
+    if (sa == NULL) {
+        return;
+    }
+
+    HASH_FIND_PTR(sa->refs, &elem, ref);
+    if (ref != NULL) {
+        HASH_DEL(sa->refs, ref);
+        free(ref);
+    }
+
+    if (sa->refs == NULL) {
+        HASH_DEL(mgr->apps, sa);
+        free(sa);
+    }
+}
+
+static sub_elem_t *elem_new(neu_subscribe_mgr_t *mgr, const char *driver,
+                            const char *group)
+{
+    sub_driver_t *sd   = driver_find(mgr, driver);
+    sub_elem_t *  elem = NULL;
+    size_t        len  = 0;
+
+    if (sd == NULL) {
+        sd = calloc(1, sizeof(sub_driver_t));
+        if (sd == NULL) {
+            return NULL;
+        }
+        strncpy(sd->name, driver, sizeof(sd->name) - 1);
+        HASH_ADD_STR(mgr->drivers, name, sd);
+    }
+
+    elem = calloc(1, sizeof(sub_elem_t));
+    if (elem == NULL) {
+        return NULL;
+    }
+    utarray_new(elem->apps, &app_sub_icd);
+    len = elem_key(elem->key, driver, group);
+    HASH_ADD(hh, mgr->ss, key, len, elem);
+    DL_APPEND(sd->elems, elem);
+    return elem;
+}
+
+static void elem_free(neu_subscribe_mgr_t *mgr, sub_elem_t *elem)
+{
+    sub_driver_t *sd = driver_find(mgr, elem_driver(elem));
+
+    HASH_DEL(mgr->ss, elem);
+    if (sd != NULL) {
+        DL_DELETE(sd->elems, elem);
+        if (sd->elems == NULL) {
+            HASH_DEL(mgr->drivers, sd);
+            free(sd);
+        }
+    }
+
+    utarray_foreach(elem->apps, neu_app_subscribe_t *, sub_app)
+    {
+        app_unref(mgr, sub_app->app_name, elem);
+        neu_app_subscribe_fini(sub_app);
+    }
+    utarray_free(elem->apps);
+    free(elem);
+}
+
 neu_subscribe_mgr_t *neu_subscribe_manager_create()
 {
     neu_subscribe_mgr_t *mgr = calloc(1, sizeof(neu_subscribe_mgr_t));
@@ -57,13 +224,7 @@ void neu_subscribe_manager_destroy(neu_subscribe_mgr_t *mgr)
 
     HASH_ITER(hh, mgr->ss, el, tmp)
     {
-        HASH_DEL(mgr->ss, el);
-        utarray_foreach(el->apps, neu_app_subscribe_t *, sub_app)
-        {
-            neu_app_subscribe_fini(sub_app);
-        }
-        utarray_free(el->apps);
-        free(el);
+        elem_free(mgr, el);
     }
 
     free(mgr);
@@ -72,13 +233,7 @@ void neu_subscribe_manager_destroy(neu_subscribe_mgr_t *mgr)
 UT_array *neu_subscribe_manager_find(neu_subscribe_mgr_t *mgr,
                                      const char *driver, const char *group)
 {
-    sub_elem_t *   find = NULL;
-    sub_elem_key_t key  = { 0 };
-
-    strncpy(key.driver, driver, sizeof(key.driver));
-    strncpy(key.group, group, sizeof(key.group));
-
-    HASH_FIND(hh, mgr->ss, &key, sizeof(sub_elem_key_t), find);
+    sub_elem_t *find = elem_find(mgr, driver, group);
 
     if (find) {
         return utarray_clone(find->apps);
@@ -90,14 +245,15 @@ UT_array *neu_subscribe_manager_find(neu_subscribe_mgr_t *mgr,
 UT_array *neu_subscribe_manager_find_by_driver(neu_subscribe_mgr_t *mgr,
                                                const char *         driver)
 {
-    sub_elem_t *el = NULL, *tmp = NULL;
-    UT_array *  apps = NULL;
+    sub_driver_t *sd   = driver_find(mgr, driver);
+    sub_elem_t *  el   = NULL;
+    UT_array *    apps = NULL;
 
     utarray_new(apps, &app_sub_icd);
 
-    HASH_ITER(hh, mgr->ss, el, tmp)
-    {
-        if (strcmp(driver, el->key.driver) == 0) {
+    if (sd != NULL) {
+        DL_FOREACH(sd->elems, el)
+        {
             utarray_concat(apps, el->apps);
         }
     }
@@ -105,30 +261,46 @@ UT_array *neu_subscribe_manager_find_by_driver(neu_subscribe_mgr_t *mgr,
     return apps;
 }
 
+static neu_app_subscribe_t *elem_find_app(sub_elem_t *elem, const char *app)
+{
+    utarray_foreach(elem->apps, neu_app_subscribe_t *, sub)
+    {
+        if (strcmp(sub->app_name, app) == 0) {
+            return sub;
+        }
+    }
+
+    return NULL;
+}
+
 UT_array *neu_subscribe_manager_get(neu_subscribe_mgr_t *mgr, const char *app,
                                     const char *driver, const char *group)
 {
-    sub_elem_t *el = NULL, *tmp = NULL;
-    UT_array *  groups = NULL;
-    UT_icd      icd = { sizeof(neu_resp_subscribe_info_t), NULL, NULL, NULL };
+    sub_app_t *sa  = app_find(mgr, app);
+    sub_ref_t *ref = NULL, *tmp = NULL;
+    UT_array * groups = NULL;
+    UT_icd     icd = { sizeof(neu_resp_subscribe_info_t), NULL, NULL, NULL };
 
     utarray_new(groups, &icd);
-    HASH_ITER(hh, mgr->ss, el, tmp)
+    if (sa == NULL) {
+        return groups;
+    }
+
+    HASH_ITER(hh, sa->refs, ref, tmp)
     {
-        utarray_foreach(el->apps, neu_app_subscribe_t *, sub_app)
-        {
-            if (strcmp(sub_app->app_name, app) == 0 &&
-                (!driver || strstr(el->key.driver, driver)) &&
-                (!group || strstr(el->key.group, group))) {
-                neu_resp_subscribe_info_t info = { 0 };
-
-                strncpy(info.driver, el->key.driver, sizeof(info.driver));
-                strncpy(info.app, app, sizeof(info.app));
-                strncpy(info.group, el->key.group, sizeof(info.group));
-                info.params = sub_app->params; // borrowed reference
-
-                utarray_push_back(groups, &info);
-            }
+        sub_elem_t *         el      = ref->elem;
+        neu_app_subscribe_t *sub_app = elem_find_app(el, app);
+
+        if (sub_app != NULL && (!driver || strstr(elem_driver(el), driver)) &&
+            (!group || strstr(elem_group(el), group))) {
+            neu_resp_subscribe_info_t info = { 0 };
+
+            snprintf(info.driver, sizeof(info.driver), "%s", elem_driver(el));
+            snprintf(info.app, sizeof(info.app), "%s", app);
+            snprintf(info.group, sizeof(info.group), "%s", elem_group(el));
+            info.params = sub_app->params; // borrowed reference
+
+            utarray_push_back(groups, &info);
         }
     }
 
@@ -138,36 +310,25 @@ UT_array *neu_subscribe_manager_get(neu_subscribe_mgr_t *mgr, const char *app,
 size_t neu_subscribe_manager_group_count(const neu_subscribe_mgr_t *mgr,
                                          const char *               app)
 {
-    size_t      group_count = 0;
-    sub_elem_t *current_element, *tmp;
-
-    HASH_ITER(hh, mgr->ss, current_element, tmp)
-    {
-        utarray_foreach(current_element->apps, neu_app_subscribe_t *, sub_app)
-        {
-            if (strcmp(sub_app->app_name, app) == 0) {
-                group_count++;
-            }
-        }
-    }
+    sub_app_t *sa = app_find(mgr, app);
 
-    return group_count;
+    return sa != NULL ? HASH_COUNT(sa->refs) : 0;
 }
 
 void neu_subscribe_manager_unsub_all(neu_subscribe_mgr_t *mgr, const char *app)
 {
-    sub_elem_t *el = NULL, *tmp = NULL;
+    sub_app_t *sa  = app_find(mgr, app);
+    sub_ref_t *ref = NULL, *tmp = NULL;
 
-    HASH_ITER(hh, mgr->ss, el, tmp)
+    if (sa == NULL) {
+        return;
+    }
+
+    // the app entry goes with its last reference, never read again here
+    HASH_ITER(hh, sa->refs, ref, tmp)
     {
-        utarray_foreach(el->apps, neu_app_subscribe_t *, sub_app)
-        {
-            if (strcmp(sub_app->app_name, app) == 0) {
-                neu_subscribe_manager_unsub(mgr, el->key.driver, app,
-                                            el->key.group);
-                break;
-            }
-        }
+        sub_elem_t *el = ref->elem;
+        neu_subscribe_manager_unsub(mgr, elem_driver(el), app, elem_group(el));
     }
 }
 
@@ -176,33 +337,30 @@ int neu_subscribe_manager_sub(neu_subscribe_mgr_t *mgr, const char *driver,
                               const char *params, struct sockaddr_un addr)
 {
     sub_elem_t *        find    = NULL;
-    sub_elem_key_t      key     = { 0 };
     neu_app_subscribe_t app_sub = { 0 };
 
-    strncpy(key.driver, driver, sizeof(key.driver));
-    strncpy(key.group, group, sizeof(key.group));
-    strncpy(app_sub.app_name, app, sizeof(app_sub.app_name));
+    strncpy(app_sub.app_name, app, sizeof(app_sub.app_name) - 1);
     app_sub.addr = addr;
 
     if (params && NULL == (app_sub.params = strdup(params))) {
         return NEU_ERR_EINTERNAL;
     }
 
-    HASH_FIND(hh, mgr->ss, &key, sizeof(sub_elem_key_t), find);
+    find = elem_find(mgr, driver, group);
 
     if (find) {
-        utarray_foreach(find->apps, neu_app_subscribe_t *, sub)
-        {
-            if (strcmp(sub->app_name, app) == 0) {
-                neu_app_subscribe_fini(&app_sub);
-                return NEU_ERR_GROUP_ALREADY_SUBSCRIBED;
-            }
+        if (elem_find_app(find, app) != NULL) {
+            neu_app_subscribe_fini(&app_sub);
+            return NEU_ERR_GROUP_ALREADY_SUBSCRIBED;
         }
-    } else {
-        find = calloc(1, sizeof(sub_elem_t));
-        utarray_new(find->apps, &app_sub_icd);
-        find->key = key;
-        HASH_ADD(hh, mgr->ss, key, sizeof(sub_elem_key_t), find);
+    } else if (NULL == (find = elem_new(mgr, driver, group))) {
+        neu_app_subscribe_fini(&app_sub);
+        return NEU_ERR_EINTERNAL;
+    }
+
+    if (0 != app_ref(mgr, app, find)) {
+        neu_app_subscribe_fini(&app_sub);
+        return NEU_ERR_EINTERNAL;
     }
 
     utarray_push_back(find->apps, &app_sub);
@@ -213,25 +371,13 @@ int neu_subscribe_manager_update_params(neu_subscribe_mgr_t *mgr,
                                         const char *app, const char *driver,
                                         const char *group, const char *params)
 {
-    sub_elem_key_t key = { 0 };
-    strncpy(key.driver, driver, sizeof(key.driver));
-    strncpy(key.group, group, sizeof(key.group));
-
-    sub_elem_t *find = NULL;
-    HASH_FIND(hh, mgr->ss, &key, sizeof(sub_elem_key_t), find);
+    sub_elem_t *find = elem_find(mgr, driver, group);
 
     if (NULL == find) {
         return NEU_ERR_GROUP_NOT_SUBSCRIBE;
     }
 
-    neu_app_subscribe_t *app_sub = NULL;
-    utarray_foreach(find->apps, neu_app_subscribe_t *, sub)
-    {
-        if (strcmp(sub->app_name, app) == 0) {
-            app_sub = sub;
-            break;
-        }
-    }
+    neu_app_subscribe_t *app_sub = elem_find_app(find, app);
 
     if (NULL == app_sub) {
         return NEU_ERR_GROUP_NOT_SUBSCRIBE;
@@ -250,22 +396,15 @@ int neu_subscribe_manager_update_params(neu_subscribe_mgr_t *mgr,
 int neu_subscribe_manager_unsub(neu_subscribe_mgr_t *mgr, const char *driver,
                                 const char *app, const char *group)
 {
-    sub_elem_t *   find = NULL;
-    sub_elem_key_t key  = { 0 };
-
-    strncpy(key.driver, driver, sizeof(key.driver));
-    strncpy(key.group, group, sizeof(key.group));
-
-    HASH_FIND(hh, mgr->ss, &key, sizeof(sub_elem_key_t), find);
+    sub_elem_t *find = elem_find(mgr, driver, group);
 
     if (find) {
-        utarray_foreach(find->apps, neu_app_subscribe_t *, sub)
-        {
-            if (strcmp(sub->app_name, app) == 0) {
-                neu_app_subscribe_fini(sub);
-                utarray_erase(find->apps, utarray_eltidx(find->apps, sub), 1);
-                return NEU_ERR_SUCCESS;
-            }
+        neu_app_subscribe_t *sub = elem_find_app(find, app);
+        if (sub != NULL) {
+            neu_app_subscribe_fini(sub);
+            utarray_erase(find->apps, utarray_eltidx(find->apps, sub), 1);
+            app_unref(mgr, app, find);
+            return NEU_ERR_SUCCESS;
         }
     }
 
@@ -275,38 +414,51 @@ int neu_subscribe_manager_unsub(neu_subscribe_mgr_t *mgr, const char *driver,
 void neu_subscribe_manager_remove(neu_subscribe_mgr_t *mgr, const char *driver,
                                   const char *group)
 {
-    sub_elem_t *el = NULL, *tmp = NULL;
+    sub_driver_t *sd = driver_find(mgr, driver);
+    sub_elem_t *  el = NULL, *tmp = NULL;
 
-    HASH_ITER(hh, mgr->ss, el, tmp)
-    {
-        if (strcmp(driver, el->key.driver) == 0 &&
-            (group == NULL || strcmp(group, el->key.group) == 0)) {
-            HASH_DEL(mgr->ss, el);
-            utarray_foreach(el->apps, neu_app_subscribe_t *, sub_app)
-            {
-                neu_app_subscribe_fini(sub_app);
-            }
-            utarray_free(el->apps);
-            free(el);
+    if (sd == NULL) {
+        return;
+    }
+
+    if (group != NULL) {
+        el = elem_find(mgr, driver, group);
+        if (el != NULL) {
+            elem_free(mgr, el);
         }
+        return;
+    }
+
+    // the driver entry goes with its last group, never read again here
+    DL_FOREACH_SAFE(sd->elems, el, tmp)
+    {
+        elem_free(mgr, el);
     }
 }
 
 int neu_subscribe_manager_update_app_name(neu_subscribe_mgr_t *mgr,
                                           const char *app, const char *new_name)
 {
-    sub_elem_t *el = NULL, *tmp = NULL;
+    sub_app_t *sa  = app_find(mgr, app);
+    sub_ref_t *ref = NULL, *tmp = NULL;
 
-    HASH_ITER(hh, mgr->ss, el, tmp)
+    if (sa == NULL) {
+        return 0;
+    }
+
+    HASH_ITER(hh, sa->refs, ref, tmp)
     {
-        utarray_foreach(el->apps, neu_app_subscribe_t *, sub_app)
-        {
-            if (strcmp(app, sub_app->app_name) == 0) {
-                strncpy(sub_app->app_name, new_name, sizeof(sub_app->app_name));
-            }
+        neu_app_subscribe_t *sub_app = elem_find_app(ref->elem, app);
+        if (sub_app != NULL) {
+            strncpy(sub_app->app_name, new_name, sizeof(sub_app->app_name) - 1);
         }
     }
 
+    HASH_DEL(mgr->apps, sa);
+    memset(sa->name, 0, sizeof(sa->name));
+    strncpy(sa->name, new_name, sizeof(sa->name) - 1);
+    HASH_ADD_STR(mgr->apps, name, sa);
+
     return 0;
 }
 
@@ -314,17 +466,29 @@ int neu_subscribe_manager_update_driver_name(neu_subscribe_mgr_t *mgr,
                                              const char *         driver,
                                              const char *         new_name)
 {
-    sub_elem_t *el = NULL, *tmp = NULL;
+    sub_driver_t *sd = driver_find(mgr, driver);
+    sub_elem_t *  el = NULL;
 
-    HASH_ITER(hh, mgr->ss, el, tmp)
+    if (sd == NULL) {
+        return 0;
+    }
+
+    DL_FOREACH(sd->elems, el)
     {
-        if (strcmp(driver, el->key.driver) == 0) {
-            HASH_DEL(mgr->ss, el);
-            strncpy(el->key.driver, new_name, sizeof(el->key.driver));
-            HASH_ADD(hh, mgr->ss, key, sizeof(sub_elem_key_t), el);
-        }
+        char   group[NEU_GROUP_NAME_LEN];
+        size_t len = 0;
+
+        strcpy(group, elem_group(el));
+        len = elem_key(el->key, new_name, group);
+        HASH_DEL(mgr->ss, el);
+        HASH_ADD(hh, mgr->ss, key, len, el);
     }
 
+    HASH_DEL(mgr->drivers, sd);
+    memset(sd->name, 0, sizeof(sd->name));
+    strncpy(sd->name, new_name, sizeof(sd->name) - 1);
+    HASH_ADD_STR(mgr->drivers, name, sd);
+
     return 0;
 }
 
@@ -333,21 +497,16 @@ int neu_subscribe_manager_update_group_name(neu_subscribe_mgr_t *mgr,
                                             const char *         group,
                                             const char *         new_name)
 {
-    sub_elem_t *   find = NULL;
-    sub_elem_key_t key  = { 0 };
-
-    strncpy(key.driver, driver, sizeof(key.driver));
-    strncpy(key.group, group, sizeof(key.group));
-
-    HASH_FIND(hh, mgr->ss, &key, sizeof(sub_elem_key_t), find);
+    sub_elem_t *find = elem_find(mgr, driver, group);
+    size_t      len  = 0;
 
     if (NULL == find) {
         return NEU_ERR_GROUP_NOT_SUBSCRIBE;
     }
 
     HASH_DEL(mgr->ss, find);
-    strncpy(find->key.group, new_name, sizeof(find->key.group));
-    HASH_ADD(hh, mgr->ss, key, sizeof(sub_elem_key_t), find);
+    len = elem_key(find->key, driver, new_name);
+    HASH_ADD(hh, mgr->ss, key, len, find);
 
     return 0;
 }
@@ -0,0 +1,317 @@
+/**
+ * NEURON IIoT System for Industry 4.0
+ * Copyright (C) 2020-2023 EMQ Technologies Co., Ltd All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ **/
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include "define.h"
+#include "errcodes.h"
+#include "utils/log.h"
+#include "utils/profile.h"
+#include "utils/utlist.h"
+
+#include "worker.h"
+
+typedef struct worker_job {
+    char               key[NEU_NODE_NAME_LEN];
+    neu_worker_job_fn  job;
+    neu_worker_done_fn done;
+    void *             arg;
+    bool               running;
+
+    struct worker_job *prev;
+    struct worker_job *next;
+    struct worker_job *done_next;
+} worker_job_t;
+
+struct neu_worker_pool {
+    neu_events_t *  events;
+    neu_event_io_t *io;
+    int             efd;
+
+    void (*settled)(void *usr_data);
+    void *usr_data;
+
+    pthread_mutex_t mtx;
+    pthread_cond_t  cond;
+    worker_job_t *  jobs;     // in the order of submission, until done
+    worker_job_t *  finished; // ran, waiting for the done callback
+    bool            quit;
+
+    int        n_thread;
+    pthread_t *threads;
+};
+
+// the first job that is not running and has no earlier job of the same key
+static worker_job_t *next_runnable(neu_worker_pool_t *pool)
+{
+    worker_job_t *job = NULL;
+
+    DL_FOREACH(pool->jobs, job)
+    {
+        if (job->running) {
+            continue;
+        }
+
+        bool          blocked = false;
+        worker_job_t *prior   = NULL;
+        for (prior = pool->jobs; prior != job; prior = prior->next) {
+            if (strcmp(prior->key, job->key) == 0) {
+                blocked = true;
+                break;
+            }
+        }
+
+        if (!blocked) {
+            return job;
+        }
+    }
+
+    return NULL;
+}
+
+static void *worker_run(void *arg)
+{
+    neu_worker_pool_t *pool = arg;
+    uint64_t           one  = 1;
+
+    pthread_mutex_lock(&pool->mtx);
+    while (!pool->quit) {
+        worker_job_t *job = next_runnable(pool);
+        if (job == NULL) {
+            pthread_cond_wait(&pool->cond, &pool->mtx);
+            continue;
+        }
+
+        job->running = true;
+        pthread_mutex_unlock(&pool->mtx);
+
+        job->job(job->arg);
+
+        pthread_mutex_lock(&pool->mtx);
+        job->done_next = pool->finished;
+        pool->finished = job;
+        if (write(pool->efd, &one, sizeof(one)) != sizeof(one)) {
+            nlog_warn("worker pool wake fail, %s(%d)", strerror(errno), errno);
+        }
+    }
+    pthread_mutex_unlock(&pool->mtx);
+
+    return NULL;
+}
+
+// `finished` is a stack, so the done callbacks are called in reverse order,
+// this does not matter as the jobs of a key never finish together
+static void finish_jobs(neu_worker_pool_t *pool, worker_job_t *finished)
+{
+    while (finished != NULL) {
+        worker_job_t *job = finished;
+        finished          = job->done_next;
+
+        if (job->done != NULL) {
+            job->done(job->arg);
+        }
+
+        pthread_mutex_lock(&pool->mtx);
+        DL_DELETE(pool->jobs, job);
+        pthread_cond_broadcast(&pool->cond);
+        pthread_mutex_unlock(&pool->mtx);
+        free(job);
+    }
+}
+
+static int worker_done(enum neu_event_io_type type, int fd, void *usr_data)
+{
+    neu_worker_pool_t *pool = usr_data;
+    uint64_t           n    = 0;
+
+    if (type != NEU_EVENT_IO_READ) {
+        nlog_warn("worker pool eventfd(%d) closed or hup %d", fd, type);
+        return 0;
+    }
+
+    if (read(fd, &n, sizeof(n)) != sizeof(n)) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&pool->mtx);
+    worker_job_t *finished = pool->finished;
+    pool->finished         = NULL;
+    pthread_mutex_unlock(&pool->mtx);
+
+    finish_jobs(pool, finished);
+
+    if (pool->settled != NULL) {
+        pool->settled(pool->usr_data);
+    }
+    return 0;
+}
+
+neu_worker_pool_t *neu_worker_pool_create(neu_events_t *events, int n_thread,
+                                          void (*settled)(void *usr_data),
+                                          void *usr_data)
+{
+    neu_worker_pool_t *pool = calloc(1, sizeof(neu_worker_pool_t));
+    if (pool == NULL) {
+        return NULL;
+    }
+
+    pool->events   = events;
+    pool->settled  = settled;
+    pool->usr_data = usr_data;
+    pthread_mutex_init(&pool->mtx, NULL);
+    pthread_cond_init(&pool->cond, NULL);
+
+    pool->efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (pool->efd < 0) {
+        nlog_error("worker pool eventfd fail, %s(%d)", strerror(errno), errno);
+        goto error;
+    }
+
+    neu_event_io_param_t param = {
+        .fd       = pool->efd,
+        .usr_data = pool,
+        .cb       = worker_done,
+    };
+    pool->io = neu_event_add_io(events, param);
+
+    pool->threads = calloc(n_thread, sizeof(pthread_t));
+    if (pool->threads == NULL) {
+        goto error;
+    }
+
+    for (; pool->n_thread < n_thread; ++pool->n_thread) {
+        if (0 !=
+            pthread_create(&pool->threads[pool->n_thread], NULL, worker_run,
+                           pool)) {
+            nlog_error("worker pool create thread fail");
+            break;
+        }
+
+        char role[32] = { 0 };
+        snprintf(role, sizeof(role), "manager worker %d", pool->n_thread);
+        neu_profile_label_thread(pool->threads[pool->n_thread], "neuron", role);
+    }
+
+    if (pool->n_thread == 0) {
+        goto error;
+    }
+
+    nlog_notice("worker pool start, %d threads", pool->n_thread);
+    return pool;
+
+error:
+    if (pool->io != NULL) {
+        neu_event_del_io(events, pool->io);
+    }
+    if (pool->efd >= 0) {
+        close(pool->efd);
+    }
+    free(pool->threads);
+    pthread_cond_destroy(&pool->cond);
+    pthread_mutex_destroy(&pool->mtx);
+    free(pool);
+    return NULL;
+}
+
+void neu_worker_pool_destroy(neu_worker_pool_t *pool)
+{
+    pthread_mutex_lock(&pool->mtx);
+    pool->quit = true;
+    pthread_cond_broadcast(&pool->cond);
+    pthread_mutex_unlock(&pool->mtx);
+
+    for (int i = 0; i < pool->n_thread; ++i) {
+        neu_profile_unlabel_thread(pool->threads[i]);
+        pthread_join(pool->threads[i], NULL);
+    }
+
+    neu_event_del_io(pool->events, pool->io);
+    close(pool->efd);
+
+    // no thread is left, the rest of the jobs run here in order
+    finish_jobs(pool, pool->finished);
+    pool->finished = NULL;
+    while (pool->jobs != NULL) {
+        worker_job_t *job = pool->jobs;
+        job->job(job->arg);
+        job->done_next = NULL;
+        finish_jobs(pool, job);
+    }
+
+    free(pool->threads);
+    pthread_cond_destroy(&pool->cond);
+    pthread_mutex_destroy(&pool->mtx);
+    free(pool);
+}
+
+int neu_worker_pool_submit(neu_worker_pool_t *pool, const char *key,
+                           neu_worker_job_fn job, neu_worker_done_fn done,
+                           void *arg)
+{
+    worker_job_t *wj = calloc(1, sizeof(worker_job_t));
+    if (wj == NULL) {
+        return NEU_ERR_EINTERNAL;
+    }
+
+    strncpy(wj->key, key, sizeof(wj->key) - 1);
+    wj->job  = job;
+    wj->done = done;
+    wj->arg  = arg;
+
+    pthread_mutex_lock(&pool->mtx);
+    DL_APPEND(pool->jobs, wj);
+    pthread_cond_signal(&pool->cond);
+    pthread_mutex_unlock(&pool->mtx);
+
+    return NEU_ERR_SUCCESS;
+}
+
+bool neu_worker_pool_busy(neu_worker_pool_t *pool, const char *key)
+{
+    worker_job_t *job  = NULL;
+    bool          busy = false;
+
+    pthread_mutex_lock(&pool->mtx);
+    DL_FOREACH(pool->jobs, job)
+    {
+        if (strcmp(job->key, key) == 0) {
+            busy = true;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&pool->mtx);
+
+    return busy;
+}
+
+bool neu_worker_pool_idle(neu_worker_pool_t *pool)
+{
+    pthread_mutex_lock(&pool->mtx);
+    bool idle = pool->jobs == NULL;
+    pthread_mutex_unlock(&pool->mtx);
+
+    return idle;
+}
@@ -0,0 +1,54 @@
+/**
+ * NEURON IIoT System for Industry 4.0
+ * Copyright (C) 2020-2023 EMQ Technologies Co., Ltd All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ **/
+
+#ifndef _NEU_MANAGER_WORKER_H_
+#define _NEU_MANAGER_WORKER_H_
+
+#include <stdbool.h>
+
+#include "event/event.h"
+
+// A pool of threads for the heavy requests of the manager.
+//
+// Jobs are keyed, usually by node name. Jobs of the same key run one after
+// another in the order of submission, jobs of different keys run in parallel.
+// The done callback of a job runs on the thread of the events the pool is
+// created with, and the key stays busy until the done callback returns.
+typedef struct neu_worker_pool neu_worker_pool_t;
+
+// runs on a thread of the pool
+typedef void (*neu_worker_job_fn)(void *arg);
+// runs on the thread of the events
+typedef void (*neu_worker_done_fn)(void *arg);
+
+// `settled` is called on the thread of the events after each batch of done
+// callbacks, when some keys may have become idle
+neu_worker_pool_t *neu_worker_pool_create(neu_events_t *events, int n_thread,
+                                          void (*settled)(void *usr_data),
+                                          void *usr_data);
+// Waits for the running jobs, then runs the queued jobs on the calling thread.
+void neu_worker_pool_destroy(neu_worker_pool_t *pool);
+
+int  neu_worker_pool_submit(neu_worker_pool_t *pool, const char *key,
+                            neu_worker_job_fn job, neu_worker_done_fn done,
+                            void *arg);
+bool neu_worker_pool_busy(neu_worker_pool_t *pool, const char *key);
+bool neu_worker_pool_idle(neu_worker_pool_t *pool);
+
+#endif
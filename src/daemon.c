@@ -184,15 +184,16 @@ int neuron_already_running()
     return 0;
 }
 
-int neuron_stop()
+// the process group of the running neuron, -1 if it cannot be told
+static pid_t neuron_group()
 {
-    int ret = -1;
+    pid_t gid = -1;
 
     FILE *fp = fopen(NEURON_DAEMON_LOCK_FNAME, "r");
     if (NULL == fp) {
         nlog_error("cannot open %s reason: %s\n", NEURON_DAEMON_LOCK_FNAME,
                    strerror(errno));
-        return ret;
+        return gid;
     }
 
     long pid = -1;
@@ -201,10 +202,23 @@ int neuron_stop()
         goto end;
     }
 
-    pid_t gid = getpgid((pid_t) pid);
+    gid = getpgid((pid_t) pid);
     if (-1 == gid) {
         nlog_error("cannot get gpid reason: %s\n", strerror(errno));
-        goto end;
+    }
+
+end:
+    fclose(fp);
+    return gid;
+}
+
+int neuron_stop()
+{
+    int   ret = -1;
+    pid_t gid = neuron_group();
+
+    if (-1 == gid) {
+        return ret;
     }
 
     if (0 == kill((pid_t)(-gid), SIGINT)) {
@@ -220,7 +234,23 @@ int neuron_stop()
                    strerror(errno));
     }
 
-end:
-    fclose(fp);
     return ret;
+}
+
+int neuron_takeover()
+{
+    pid_t gid = neuron_group();
+
+    if (-1 == gid) {
+        return -1;
+    }
+
+    // the restart loop ignores it, the neuron it runs takes over
+    if (0 != kill((pid_t)(-gid), SIGUSR2)) {
+        nlog_error("cannot signal gpid:%ld reason: %s\n", (long) gid,
+                   strerror(errno));
+        return -1;
+    }
+
+    return 0;
 }
\ No newline at end of file
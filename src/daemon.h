@@ -36,6 +36,10 @@ int neuron_already_running();
 
 int neuron_stop();
 
+/** Make a running neuron in standby take over.
+ */
+int neuron_takeover();
+
 #ifdef __cplusplus
 }
 #endif
@@ -24,19 +24,40 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 
 #include "event/event.h"
+#include "utils/affinity.h"
 #include "utils/log.h"
+#include "utils/profile.h"
+#include "utils/utlist.h"
 
 #ifdef NEU_PLATFORM_LINUX
 #include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <sys/timerfd.h>
 
+#ifdef NEU_EVENT_IO_URING
+#include "event_uring.h"
+#define poll_create() neu_uring_create()
+#define poll_close(fd) neu_uring_close(fd)
+#define poll_ctl(fd, op, target, event) neu_uring_ctl(fd, op, target, event)
+#define poll_wait(fd, events, n, timeout) neu_uring_wait(fd, events, n, timeout)
+#else
+#define poll_create() epoll_create(1)
+#define poll_close(fd) close(fd)
+#define poll_ctl(fd, op, target, event) epoll_ctl(fd, op, target, event)
+#define poll_wait(fd, events, n, timeout) epoll_wait(fd, events, n, timeout)
+#endif
+
 struct neu_event_timer {
-    int                    fd;
+    int                    fd; // the tick timerfd of the events
     struct event_data *    event_data;
-    struct itimerspec      value;
+    int64_t                period;   // in ns
+    int64_t                deadline; // CLOCK_MONOTONIC, in ns
+    int                    heap_idx; // -1 when not armed
+    int64_t                lateness; // of the last expiry, in ns
     neu_event_timer_type_e type;
     pthread_mutex_t        mtx;
     bool                   stop;
@@ -50,6 +71,7 @@ struct event_data {
     enum {
         TIMER = 0,
         IO    = 1,
+        TICK  = 2,
     } type;
     union {
         neu_event_io_callback    io;
@@ -64,55 +86,336 @@ struct event_data {
     int   fd;
     int   index;
     bool  use;
+
+    neu_events_t *     events;
+    struct event_data *prev;
+    struct event_data *next;
 };
 
-#define EVENT_SIZE 1400
+#ifndef NEU_EVENT_BATCH_SIZE
+// max ready events handled per epoll_wait
+#define NEU_EVENT_BATCH_SIZE 32
+#endif
+
+// a thread of the shared engine, serving the events of every node pinned to it
+struct event_worker {
+    int       epoll_fd;
+    int       wake_fd;
+    pthread_t thread;
+    bool      stop;
+    int       n_events;
+
+    pthread_mutex_t mtx;
+    pthread_cond_t  cond;
+    // bumped each time the worker is between two dispatches, once it moves no
+    // event fetched before can still be dispatched
+    uint64_t           round;
+    neu_events_t *     closing;
+    struct event_data *retired;
+};
 
 struct neu_events {
     int       epoll_fd;
     pthread_t thread;
     bool      stop;
 
-    pthread_mutex_t   mtx;
-    int               n_event;
-    struct event_data event_datas[EVENT_SIZE];
+    struct event_worker *worker;
+    neu_events_t *       next_closing;
+
+    pthread_mutex_t    mtx;
+    int                n_event;
+    struct event_data *datas;
+    // deleted while the loop may still hold them in a fetched batch, only the
+    // loop thread frees them, between two batches
+    struct event_data *retired;
+
+    // a single timerfd drives every timer of the events, armed at the
+    // earliest deadline of a min heap
+    struct event_data * tick;
+    neu_event_timer_t **heap;
+    int                 n_heap;
+    int                 heap_cap;
 };
 
-static int get_free_event(neu_events_t *events)
+static struct {
+    int                  n_worker;
+    struct event_worker *workers;
+} engine = { 0 };
+
+static struct event_data *new_event(neu_events_t *events)
 {
-    int ret = -1;
+    struct event_data *data = calloc(1, sizeof(struct event_data));
+
+    if (data == NULL) {
+        return NULL;
+    }
+
     pthread_mutex_lock(&events->mtx);
-    for (int i = 0; i < EVENT_SIZE; i++) {
-        if (events->event_datas[i].use == false) {
-            events->event_datas[i].use   = true;
-            events->event_datas[i].index = i;
-            ret                          = i;
-            break;
+    data->use    = true;
+    data->events = events;
+    data->index  = events->n_event++;
+    DL_APPEND(events->datas, data);
+    pthread_mutex_unlock(&events->mtx);
+
+    return data;
+}
+
+static void free_event(neu_events_t *events, struct event_data *data)
+{
+    __atomic_store_n(&data->use, false, __ATOMIC_RELEASE);
+
+    pthread_mutex_lock(&events->mtx);
+    DL_DELETE(events->datas, data);
+    if (events->worker == NULL) {
+        LL_PREPEND(events->retired, data);
+    }
+    pthread_mutex_unlock(&events->mtx);
+
+    if (events->worker != NULL) {
+        pthread_mutex_lock(&events->worker->mtx);
+        LL_PREPEND(events->worker->retired, data);
+        pthread_mutex_unlock(&events->worker->mtx);
+    }
+}
+
+static void release_events(struct event_data *list)
+{
+    struct event_data *data = NULL;
+    struct event_data *tmp  = NULL;
+
+    LL_FOREACH_SAFE(list, data, tmp)
+    {
+        if (data->type == TIMER) {
+            pthread_mutex_destroy(&data->ctx.timer.mtx);
+        } else if (data->type == TICK) {
+            close(data->fd);
         }
+        free(data);
     }
+}
 
+static void release_retired(neu_events_t *events)
+{
+    struct event_data *retired = NULL;
+
+    pthread_mutex_lock(&events->mtx);
+    retired         = events->retired;
+    events->retired = NULL;
     pthread_mutex_unlock(&events->mtx);
-    return ret;
+
+    release_events(retired);
+}
+
+static inline int64_t monotonic_ns(void)
+{
+    struct timespec ts = { 0 };
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t) ts.tv_sec * 1000 * 1000 * 1000 + ts.tv_nsec;
+}
+
+// heap helpers, called with events->mtx held
+static inline void heap_set(neu_events_t *events, int i, neu_event_timer_t *t)
+{
+    events->heap[i] = t;
+    t->heap_idx     = i;
+}
+
+static void heap_sift_up(neu_events_t *events, int i)
+{
+    neu_event_timer_t *timer = events->heap[i];
+
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (events->heap[parent]->deadline <= timer->deadline) {
+            break;
+        }
+        heap_set(events, i, events->heap[parent]);
+        i = parent;
+    }
+    heap_set(events, i, timer);
+}
+
+static void heap_sift_down(neu_events_t *events, int i)
+{
+    neu_event_timer_t *timer = events->heap[i];
+
+    while (true) {
+        int child = 2 * i + 1;
+        if (child >= events->n_heap) {
+            break;
+        }
+        if (child + 1 < events->n_heap &&
+            events->heap[child + 1]->deadline < events->heap[child]->deadline) {
+            child += 1;
+        }
+        if (timer->deadline <= events->heap[child]->deadline) {
+            break;
+        }
+        heap_set(events, i, events->heap[child]);
+        i = child;
+    }
+    heap_set(events, i, timer);
+}
+
+static int heap_push(neu_events_t *events, neu_event_timer_t *timer)
+{
+    if (events->n_heap == events->heap_cap) {
+        int cap = events->heap_cap > 0 ? events->heap_cap * 2 : 16;
+        neu_event_timer_t **heap = realloc(events->heap, cap * sizeof(*heap));
+        if (heap == NULL) {
+            return -1;
+        }
+        events->heap     = heap;
+        events->heap_cap = cap;
+    }
+
+    events->n_heap += 1;
+    heap_set(events, events->n_heap - 1, timer);
+    heap_sift_up(events, events->n_heap - 1);
+    return 0;
+}
+
+static void heap_remove(neu_events_t *events, neu_event_timer_t *timer)
+{
+    int i = timer->heap_idx;
+
+    timer->heap_idx = -1;
+    events->n_heap -= 1;
+    if (i == events->n_heap) {
+        return;
+    }
+
+    heap_set(events, i, events->heap[events->n_heap]);
+    heap_sift_down(events, i);
+    heap_sift_up(events, events->heap[i]->heap_idx);
+}
+
+// called with events->mtx held
+static void arm_tick(neu_events_t *events)
+{
+    struct itimerspec value = { 0 };
+
+    if (events->n_heap > 0) {
+        int64_t deadline = events->heap[0]->deadline;
+
+        value.it_value.tv_sec  = deadline / (1000 * 1000 * 1000);
+        value.it_value.tv_nsec = deadline % (1000 * 1000 * 1000);
+    }
+
+    timerfd_settime(events->tick->fd, TFD_TIMER_ABSTIME, &value, NULL);
 }
 
-static void free_event(neu_events_t *events, int index)
+static void run_timers(neu_events_t *events)
 {
+    int64_t now = monotonic_ns();
+
+    while (true) {
+        neu_event_timer_t *timer = NULL;
+
+        pthread_mutex_lock(&events->mtx);
+        if (events->n_heap > 0 && events->heap[0]->deadline <= now) {
+            timer           = events->heap[0];
+            timer->lateness = now - timer->deadline;
+            if (timer->type == NEU_EVENT_TIMER_BLOCK) {
+                // rearmed one period after the callback returns
+                heap_remove(events, timer);
+            } else {
+                // missed periods are skipped, as with a plain timerfd
+                while (timer->deadline <= now) {
+                    timer->deadline += timer->period;
+                }
+                heap_sift_down(events, 0);
+            }
+        }
+        pthread_mutex_unlock(&events->mtx);
+
+        if (timer == NULL) {
+            break;
+        }
+
+        pthread_mutex_lock(&timer->mtx);
+        if (!timer->stop) {
+            timer->event_data->callback.timer(timer->event_data->usr_data);
+        }
+        pthread_mutex_unlock(&timer->mtx);
+
+        if (timer->type == NEU_EVENT_TIMER_BLOCK) {
+            pthread_mutex_lock(&events->mtx);
+            if (!timer->stop) {
+                timer->deadline = monotonic_ns() + timer->period;
+                heap_push(events, timer);
+            }
+            pthread_mutex_unlock(&events->mtx);
+        }
+    }
+
     pthread_mutex_lock(&events->mtx);
-    events->event_datas[index].use   = false;
-    events->event_datas[index].index = 0;
+    arm_tick(events);
     pthread_mutex_unlock(&events->mtx);
 }
 
+static void dispatch(struct epoll_event *event)
+{
+    struct event_data *data = (struct event_data *) event->data.ptr;
+
+    // deleted by a callback earlier in the same batch, or its events closed
+    if (!__atomic_load_n(&data->use, __ATOMIC_ACQUIRE)) {
+        return;
+    }
+
+    switch (data->type) {
+    case TICK:
+        if ((event->events & EPOLLIN) == EPOLLIN) {
+            uint64_t t;
+
+            ssize_t size = read(data->fd, &t, sizeof(t));
+            (void) size;
+
+            run_timers(data->events);
+        }
+        break;
+    case TIMER:
+        // timers are not in the epoll set, they run from the tick
+        break;
+    case IO:
+        if ((event->events & EPOLLHUP) == EPOLLHUP) {
+            data->callback.io(NEU_EVENT_IO_HUP, data->fd, data->usr_data);
+            break;
+        }
+
+        if ((event->events & EPOLLRDHUP) == EPOLLRDHUP) {
+            data->callback.io(NEU_EVENT_IO_CLOSED, data->fd, data->usr_data);
+            break;
+        }
+
+        if ((event->events & EPOLLOUT) == EPOLLOUT) {
+            data->callback.io(NEU_EVENT_IO_WRITE, data->fd, data->usr_data);
+            // deleted by the write callback
+            if (!__atomic_load_n(&data->use, __ATOMIC_ACQUIRE)) {
+                break;
+            }
+        }
+
+        if ((event->events & EPOLLIN) == EPOLLIN) {
+            data->callback.io(NEU_EVENT_IO_READ, data->fd, data->usr_data);
+            break;
+        }
+
+        break;
+    }
+}
+
 static void *event_loop(void *arg)
 {
-    neu_events_t *events   = (neu_events_t *) arg;
-    int           epoll_fd = events->epoll_fd;
+    neu_events_t *     events   = (neu_events_t *) arg;
+    int                epoll_fd = events->epoll_fd;
+    struct epoll_event batch[NEU_EVENT_BATCH_SIZE];
 
     while (true) {
-        struct epoll_event event = { 0 };
-        struct event_data *data  = NULL;
+        release_retired(events);
 
-        int ret = epoll_wait(epoll_fd, &event, 1, 1000);
+        int ret = poll_wait(epoll_fd, batch, NEU_EVENT_BATCH_SIZE, 1000);
         if (ret == 0) {
             continue;
         }
@@ -127,61 +430,226 @@ static void *event_loop(void *arg)
             break;
         }
 
-        data = (struct event_data *) event.data.ptr;
+        for (int i = 0; i < ret; i++) {
+            dispatch(&batch[i]);
+        }
+    }
 
-        switch (data->type) {
-        case TIMER:
-            pthread_mutex_lock(&data->ctx.timer.mtx);
-            if ((event.events & EPOLLIN) == EPOLLIN) {
-                uint64_t t;
+    return NULL;
+};
 
-                ssize_t size = read(data->fd, &t, sizeof(t));
-                (void) size;
+static void release_closing(struct event_worker *worker)
+{
+    neu_events_t *     events  = NULL;
+    struct event_data *retired = NULL;
+
+    pthread_mutex_lock(&worker->mtx);
+    worker->round += 1;
+    events          = worker->closing;
+    retired         = worker->retired;
+    worker->closing = NULL;
+    worker->retired = NULL;
+    pthread_cond_broadcast(&worker->cond);
+    pthread_mutex_unlock(&worker->mtx);
+
+    release_events(retired);
+    while (events != NULL) {
+        neu_events_t *next = events->next_closing;
+
+        release_events(events->datas);
+        pthread_mutex_destroy(&events->mtx);
+        free(events->heap);
+        free(events);
+        events = next;
+    }
+}
 
-                if (!data->ctx.timer.stop) {
-                    if (data->ctx.timer.type == NEU_EVENT_TIMER_BLOCK) {
-                        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, data->fd, NULL);
-                        ret = data->callback.timer(data->usr_data);
-                        timerfd_settime(data->fd, 0, &data->ctx.timer.value,
-                                        NULL);
-                        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, data->fd, &event);
-                    } else {
-                        ret = data->callback.timer(data->usr_data);
-                    }
-                }
-            }
+static void *worker_loop(void *arg)
+{
+    struct event_worker *worker   = (struct event_worker *) arg;
+    int                  epoll_fd = worker->epoll_fd;
+    struct epoll_event   batch[NEU_EVENT_BATCH_SIZE];
 
-            pthread_mutex_unlock(&data->ctx.timer.mtx);
-            break;
-        case IO:
-            if ((event.events & EPOLLHUP) == EPOLLHUP) {
-                data->callback.io(NEU_EVENT_IO_HUP, data->fd, data->usr_data);
-                break;
-            }
+    while (true) {
+        release_closing(worker);
 
-            if ((event.events & EPOLLRDHUP) == EPOLLRDHUP) {
-                data->callback.io(NEU_EVENT_IO_CLOSED, data->fd,
-                                  data->usr_data);
-                break;
-            }
+        int ret = poll_wait(epoll_fd, batch, NEU_EVENT_BATCH_SIZE, 1000);
+        if (ret == 0) {
+            continue;
+        }
 
-            if ((event.events & EPOLLIN) == EPOLLIN) {
-                data->callback.io(NEU_EVENT_IO_READ, data->fd, data->usr_data);
-                break;
-            }
+        if (ret == -1 && errno == EINTR) {
+            continue;
+        }
 
+        if (ret == -1 || worker->stop) {
+            zlog_warn(neuron, "event worker exit, errno: %s(%d), stop: %d",
+                      strerror(errno), errno, worker->stop);
             break;
         }
+
+        for (int i = 0; i < ret; i++) {
+            if (batch[i].data.ptr == NULL) {
+                uint64_t t    = 0;
+                ssize_t  size = read(worker->wake_fd, &t, sizeof(t));
+                (void) size;
+                continue;
+            }
+
+            dispatch(&batch[i]);
+        }
     }
 
+    release_closing(worker);
     return NULL;
-};
+}
+
+int neu_event_engine_init(int n_worker)
+{
+    if (n_worker <= 0) {
+        n_worker = (int) sysconf(_SC_NPROCESSORS_ONLN);
+        if (n_worker <= 0) {
+            n_worker = 1;
+        }
+    }
+
+    engine.workers = calloc(n_worker, sizeof(struct event_worker));
+    if (engine.workers == NULL) {
+        return -1;
+    }
+
+    for (int i = 0; i < n_worker; i++) {
+        struct event_worker *worker = &engine.workers[i];
+        struct epoll_event   event  = {
+            .events   = EPOLLIN,
+            .data.ptr = NULL,
+        };
+
+        worker->epoll_fd = poll_create();
+        worker->wake_fd  = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        assert(worker->epoll_fd > 0 && worker->wake_fd > 0);
+        poll_ctl(worker->epoll_fd, EPOLL_CTL_ADD, worker->wake_fd, &event);
+
+        pthread_mutex_init(&worker->mtx, NULL);
+        pthread_cond_init(&worker->cond, NULL);
+        pthread_create(&worker->thread, NULL, worker_loop, worker);
+
+        char role[32] = { 0 };
+        snprintf(role, sizeof(role), "event worker %d", i);
+        neu_profile_label_thread(worker->thread, "neuron", role);
+    }
+
+    engine.n_worker = n_worker;
+    nlog_notice("event engine start, workers: %d", n_worker);
+    return 0;
+}
+
+void neu_event_engine_fini(void)
+{
+    for (int i = 0; i < engine.n_worker; i++) {
+        struct event_worker *worker = &engine.workers[i];
+        uint64_t             t      = 1;
+
+        worker->stop = true;
+        if (write(worker->wake_fd, &t, sizeof(t)) != sizeof(t)) {
+            nlog_warn("wake event worker %d fail, %s", i, strerror(errno));
+        }
+        neu_profile_unlabel_thread(worker->thread);
+        pthread_join(worker->thread, NULL);
+
+        close(worker->wake_fd);
+        poll_close(worker->epoll_fd);
+        pthread_cond_destroy(&worker->cond);
+        pthread_mutex_destroy(&worker->mtx);
+    }
+
+    free(engine.workers);
+    engine.workers  = NULL;
+    engine.n_worker = 0;
+}
+
+static struct event_worker *pick_worker(void)
+{
+    struct event_worker *worker = &engine.workers[0];
+
+    for (int i = 1; i < engine.n_worker; i++) {
+        if (__atomic_load_n(&engine.workers[i].n_events, __ATOMIC_RELAXED) <
+            __atomic_load_n(&worker->n_events, __ATOMIC_RELAXED)) {
+            worker = &engine.workers[i];
+        }
+    }
+
+    __atomic_add_fetch(&worker->n_events, 1, __ATOMIC_RELAXED);
+    return worker;
+}
+
+static void close_on_worker(neu_events_t *events)
+{
+    struct event_worker *worker = events->worker;
+    uint64_t             round  = 0;
+    uint64_t             t      = 1;
+    struct event_data *  data   = NULL;
+
+    // a batch the worker already polled can still hold these datas
+    pthread_mutex_lock(&events->mtx);
+    DL_FOREACH(events->datas, data)
+    {
+        __atomic_store_n(&data->use, false, __ATOMIC_RELEASE);
+        poll_ctl(worker->epoll_fd, EPOLL_CTL_DEL, data->fd, NULL);
+    }
+    pthread_mutex_unlock(&events->mtx);
+    __atomic_sub_fetch(&worker->n_events, 1, __ATOMIC_RELAXED);
+
+    pthread_mutex_lock(&worker->mtx);
+    events->next_closing = worker->closing;
+    worker->closing      = events;
+
+    // from a callback of the same worker, it frees the events once the
+    // callback returns
+    if (!pthread_equal(pthread_self(), worker->thread)) {
+        round = worker->round;
+        if (write(worker->wake_fd, &t, sizeof(t)) != sizeof(t)) {
+            nlog_warn("wake event worker fail, %s", strerror(errno));
+        }
+        while (worker->round == round) {
+            pthread_cond_wait(&worker->cond, &worker->mtx);
+        }
+    }
+    pthread_mutex_unlock(&worker->mtx);
+}
+
+static void add_tick(neu_events_t *events)
+{
+    struct event_data *data  = new_event(events);
+    struct epoll_event event = {
+        .events   = EPOLLIN,
+        .data.ptr = data,
+    };
+
+    assert(data != NULL);
+    data->type = TICK;
+    data->fd   = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    assert(data->fd > 0);
+
+    poll_ctl(events->epoll_fd, EPOLL_CTL_ADD, data->fd, &event);
+    events->tick = data;
+}
 
 neu_events_t *neu_event_new(void)
 {
     neu_events_t *events = calloc(1, sizeof(struct neu_events));
 
-    events->epoll_fd = epoll_create(1);
+    if (engine.n_worker > 0) {
+        events->worker   = pick_worker();
+        events->epoll_fd = events->worker->epoll_fd;
+        pthread_mutex_init(&events->mtx, NULL);
+        add_tick(events);
+
+        nlog_notice("create events on worker epoll: %d", events->epoll_fd);
+        return events;
+    }
+
+    events->epoll_fd = poll_create();
 
     nlog_notice("create epoll: %d(%d)", events->epoll_fd, errno);
     assert(events->epoll_fd > 0);
@@ -189,19 +657,61 @@ neu_events_t *neu_event_new(void)
     events->stop    = false;
     events->n_event = 0;
     pthread_mutex_init(&events->mtx, NULL);
+    add_tick(events);
 
     pthread_create(&events->thread, NULL, event_loop, events);
 
     return events;
 };
 
+void neu_event_label(neu_events_t *events, const char *node,
+                     const char *role)
+{
+    if (events->worker == NULL) {
+        neu_profile_label_thread(events->thread, node, role);
+    }
+}
+
+int neu_event_set_affinity(neu_events_t *events, const neu_cpus_t *cpus)
+{
+    if (events->worker != NULL) {
+        return -1;
+    }
+    return neu_thread_set_affinity(events->thread, cpus);
+}
+
+int neu_event_set_sched(neu_events_t *events, int policy, int priority)
+{
+    if (events->worker != NULL) {
+        return -1;
+    }
+    return neu_thread_set_sched(events->thread, policy, priority);
+}
+
+int64_t neu_event_cputime(neu_events_t *events)
+{
+    if (events->worker != NULL) {
+        return -1;
+    }
+    return neu_thread_cputime(events->thread);
+}
+
 int neu_event_close(neu_events_t *events)
 {
+    if (events->worker != NULL) {
+        close_on_worker(events);
+        return 0;
+    }
+
     events->stop = true;
-    close(events->epoll_fd);
+    poll_close(events->epoll_fd);
 
+    neu_profile_unlabel_thread(events->thread);
     pthread_join(events->thread, NULL);
+    release_events(events->retired);
+    release_events(events->datas);
     pthread_mutex_destroy(&events->mtx);
+    free(events->heap);
 
     free(events);
     return 0;
@@ -210,51 +720,49 @@ int neu_event_close(neu_events_t *events)
 neu_event_timer_t *neu_event_add_timer(neu_events_t *          events,
                                        neu_event_timer_param_t timer)
 {
-    int               ret      = 0;
-    int               timer_fd = timerfd_create(CLOCK_MONOTONIC, 0);
-    struct itimerspec value    = {
-        .it_value.tv_sec     = timer.second,
-        .it_value.tv_nsec    = timer.millisecond * 1000 * 1000,
-        .it_interval.tv_sec  = timer.second,
-        .it_interval.tv_nsec = timer.millisecond * 1000 * 1000,
-    };
-    int index = get_free_event(events);
-    if (index < 0) {
+    int                ret    = 0;
+    int64_t            period = (timer.second * 1000 + timer.millisecond) *
+        1000 * 1000;
+    struct event_data *data = new_event(events);
+    if (data == NULL) {
         zlog_fatal(neuron, "no free event: %d", events->epoll_fd);
     }
-    assert(index >= 0);
+    assert(data != NULL);
 
-    neu_event_timer_t *timer_ctx = &events->event_datas[index].ctx.timer;
-    timer_ctx->event_data        = &events->event_datas[index];
-
-    struct epoll_event event = {
-        .events   = EPOLLIN,
-        .data.ptr = timer_ctx->event_data,
-    };
-
-    timerfd_settime(timer_fd, 0, &value, NULL);
+    neu_event_timer_t *timer_ctx = &data->ctx.timer;
+    timer_ctx->event_data        = data;
 
     timer_ctx->event_data->type           = TIMER;
-    timer_ctx->event_data->fd             = timer_fd;
+    timer_ctx->event_data->fd             = events->tick->fd;
     timer_ctx->event_data->usr_data       = timer.usr_data;
     timer_ctx->event_data->callback.timer = timer.cb;
-    timer_ctx->event_data->ctx.timer = events->event_datas[index].ctx.timer;
-    timer_ctx->event_data->index     = index;
 
-    timer_ctx->value = value;
-    timer_ctx->fd    = timer_fd;
-    timer_ctx->type  = timer.type;
-    timer_ctx->stop  = false;
+    timer_ctx->fd       = events->tick->fd;
+    timer_ctx->period   = period;
+    timer_ctx->type     = timer.type;
+    timer_ctx->stop     = false;
+    timer_ctx->heap_idx = -1;
+    timer_ctx->lateness = 0;
     pthread_mutex_init(&timer_ctx->mtx, NULL);
 
-    ret = epoll_ctl(events->epoll_fd, EPOLL_CTL_ADD, timer_fd, &event);
+    // like a disarmed timerfd, a zero period never fires
+    if (period > 0) {
+        pthread_mutex_lock(&events->mtx);
+        timer_ctx->deadline =
+            monotonic_ns() + period + timer.delay * 1000 * 1000;
+        ret = heap_push(events, timer_ctx);
+        if (ret == 0 && events->heap[0] == timer_ctx) {
+            arm_tick(events);
+        }
+        pthread_mutex_unlock(&events->mtx);
+    }
 
     zlog_notice(neuron,
                 "add timer, second: %" PRId64 ", millisecond: %" PRId64
-                ", timer: %d in epoll %d, "
+                ", delay: %" PRId64 ", timer: %d in epoll %d, "
                 "ret: %d, index: %d",
-                timer.second, timer.millisecond, timer_fd, events->epoll_fd,
-                ret, index);
+                timer.second, timer.millisecond, timer.delay, timer_ctx->fd,
+                events->epoll_fd, ret, data->index);
 
     return timer_ctx;
 }
@@ -264,29 +772,39 @@ int neu_event_del_timer(neu_events_t *events, neu_event_timer_t *timer)
     zlog_notice(neuron, "del timer: %d from epoll: %d, index: %d", timer->fd,
                 events->epoll_fd, timer->event_data->index);
 
+    pthread_mutex_lock(&events->mtx);
     timer->stop = true;
-    epoll_ctl(events->epoll_fd, EPOLL_CTL_DEL, timer->fd, NULL);
+    if (timer->heap_idx >= 0) {
+        heap_remove(events, timer);
+        arm_tick(events);
+    }
+    pthread_mutex_unlock(&events->mtx);
 
+    // wait for a running callback
     pthread_mutex_lock(&timer->mtx);
-    close(timer->fd);
     pthread_mutex_unlock(&timer->mtx);
 
-    pthread_mutex_destroy(&timer->mtx);
-    free_event(events, timer->event_data->index);
+    // the mutex goes with the event data once the loop releases it
+    free_event(events, timer->event_data);
     return 0;
 }
 
+int64_t neu_event_timer_lateness(neu_event_timer_t *timer)
+{
+    return timer->lateness;
+}
+
 neu_event_io_t *neu_event_add_io(neu_events_t *events, neu_event_io_param_t io)
 {
-    int ret   = 0;
-    int index = get_free_event(events);
+    int                ret  = 0;
+    struct event_data *data = new_event(events);
 
+    assert(data != NULL);
     nlog_notice("add io, fd: %d, epoll: %d, index: %d", io.fd, events->epoll_fd,
-                index);
-    assert(index >= 0);
+                data->index);
 
-    neu_event_io_t *io_ctx   = &events->event_datas[index].ctx.io;
-    io_ctx->event_data       = &events->event_datas[index];
+    neu_event_io_t *io_ctx   = &data->ctx.io;
+    io_ctx->event_data       = data;
     struct epoll_event event = {
         .events   = EPOLLIN | EPOLLERR | EPOLLHUP | EPOLLRDHUP,
         .data.ptr = io_ctx->event_data,
@@ -296,15 +814,13 @@ neu_event_io_t *neu_event_add_io(neu_events_t *events, neu_event_io_param_t io)
     io_ctx->event_data->fd          = io.fd;
     io_ctx->event_data->usr_data    = io.usr_data;
     io_ctx->event_data->callback.io = io.cb;
-    io_ctx->event_data->ctx.io      = events->event_datas[index].ctx.io;
-    io_ctx->event_data->index       = index;
 
     io_ctx->fd = io.fd;
 
-    ret = epoll_ctl(events->epoll_fd, EPOLL_CTL_ADD, io.fd, &event);
+    ret = poll_ctl(events->epoll_fd, EPOLL_CTL_ADD, io.fd, &event);
 
     nlog_notice("add io, fd: %d, epoll: %d, ret: %d(%d), index: %d", io.fd,
-                events->epoll_fd, ret, errno, index);
+                events->epoll_fd, ret, errno, data->index);
     assert(ret == 0);
 
     return io_ctx;
@@ -319,10 +835,24 @@ int neu_event_del_io(neu_events_t *events, neu_event_io_t *io)
     zlog_notice(neuron, "del io: %d from epoll: %d, index: %d", io->fd,
                 events->epoll_fd, io->event_data->index);
 
-    epoll_ctl(events->epoll_fd, EPOLL_CTL_DEL, io->fd, NULL);
-    free_event(events, io->event_data->index);
+    poll_ctl(events->epoll_fd, EPOLL_CTL_DEL, io->fd, NULL);
+    free_event(events, io->event_data);
 
     return 0;
 }
 
+int neu_event_io_write(neu_events_t *events, neu_event_io_t *io, bool enable)
+{
+    struct epoll_event event = {
+        .events   = EPOLLIN | EPOLLERR | EPOLLHUP | EPOLLRDHUP,
+        .data.ptr = io->event_data,
+    };
+
+    if (enable) {
+        event.events |= EPOLLOUT;
+    }
+
+    return poll_ctl(events->epoll_fd, EPOLL_CTL_MOD, io->fd, &event);
+}
+
 #endif
\ No newline at end of file
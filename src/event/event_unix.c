@@ -25,6 +25,8 @@
 #include <sys/queue.h>
 
 #include "event/event.h"
+#include "utils/affinity.h"
+#include "utils/profile.h"
 
 #ifdef NEU_PLATFORM_DARWIN
 
@@ -82,6 +84,15 @@ static void *event_loop(void *arg)
     return NULL;
 }
 
+// the shared engine is only implemented on top of epoll
+int neu_event_engine_init(int n_worker)
+{
+    (void) n_worker;
+    return -1;
+}
+
+void neu_event_engine_fini(void) {}
+
 neu_events_t *neu_event_new(void)
 {
     neu_events_t *events = calloc(1, sizeof(neu_events_t));
@@ -97,12 +108,34 @@ neu_events_t *neu_event_new(void)
     return events;
 };
 
+void neu_event_label(neu_events_t *events, const char *node,
+                     const char *role)
+{
+    neu_profile_label_thread(events->thread, node, role);
+}
+
+int neu_event_set_affinity(neu_events_t *events, const neu_cpus_t *cpus)
+{
+    return neu_thread_set_affinity(events->thread, cpus);
+}
+
+int neu_event_set_sched(neu_events_t *events, int policy, int priority)
+{
+    return neu_thread_set_sched(events->thread, policy, priority);
+}
+
+int64_t neu_event_cputime(neu_events_t *events)
+{
+    return neu_thread_cputime(events->thread);
+}
+
 int neu_event_close(neu_events_t *events)
 {
     pthread_mutex_lock(&events->mtx);
     events->running = false;
     pthread_mutex_unlock(&events->mtx);
 
+    neu_profile_unlabel_thread(events->thread);
     pthread_join(events->thread, NULL);
     pthread_mutex_destroy(&events->mtx);
 
@@ -144,6 +177,12 @@ int neu_event_del_timer(neu_events_t *events, neu_event_timer_t *timer)
     return 0;
 }
 
+int64_t neu_event_timer_lateness(neu_event_timer_t *timer)
+{
+    (void) timer;
+    return 0;
+}
+
 neu_event_io_t *neu_event_add_io(neu_events_t *events, neu_event_io_param_t io)
 {
     (void) events;
@@ -158,4 +197,12 @@ int neu_event_del_io(neu_events_t *events, neu_event_io_t *io)
     return 0;
 }
 
+int neu_event_io_write(neu_events_t *events, neu_event_io_t *io, bool enable)
+{
+    (void) events;
+    (void) io;
+    (void) enable;
+    return -1;
+}
+
 #endif
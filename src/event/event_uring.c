@@ -0,0 +1,558 @@
+/**
+ * NEURON IIoT System for Industry 4.0
+ * Copyright (C) 2020-2023 EMQ Technologies Co., Ltd All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ **/
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <linux/io_uring.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#include "utils/log.h"
+#include "utils/uthash.h"
+
+#include "event_uring.h"
+
+#define URING_ENTRIES 1024
+// user_data of the sqes whose completion carries no event
+#define URING_IGNORE UINT64_MAX
+
+struct slot {
+    void *   ptr;
+    int      fd;
+    uint32_t events;
+    uint32_t gen; // bumped on reuse, completions of a former use are dropped
+    bool     live;
+    bool     armed; // a poll is in flight
+    int      next;  // in the free list or in the rearm list
+};
+
+struct uring {
+    int  fd;
+    bool closed;
+    bool in_wait;
+
+    // the sq and the slots, the cq is only read by the waiting thread
+    pthread_mutex_t mtx;
+
+    unsigned *           sq_head;
+    unsigned *           sq_tail;
+    unsigned *           sq_array;
+    unsigned             sq_mask;
+    unsigned             pending; // queued, not submitted yet
+    struct io_uring_sqe *sqes;
+
+    unsigned *           cq_head;
+    unsigned *           cq_tail;
+    unsigned             cq_mask;
+    struct io_uring_cqe *cqes;
+
+    void * sq_ring;
+    size_t sq_ring_len;
+    void * cq_ring;
+    size_t cq_ring_len;
+    size_t sqes_len;
+
+    struct slot *slots;
+    int          n_slot;
+    int          free_slot; // -1 when empty
+    int          rearm;     // fired in the last batch, -1 when empty
+    int *        fd_slot;   // slot of each fd, -1 when not polled
+    int          n_fd;
+
+    struct __kernel_timespec timeout;
+
+    UT_hash_handle hh;
+};
+
+static pthread_mutex_t rings_mtx = PTHREAD_MUTEX_INITIALIZER;
+static struct uring *  rings     = NULL;
+
+static inline int uring_setup(unsigned entries, struct io_uring_params *p)
+{
+    return (int) syscall(__NR_io_uring_setup, entries, p);
+}
+
+static inline int uring_enter(int fd, unsigned to_submit,
+                              unsigned min_complete, unsigned flags)
+{
+    return (int) syscall(__NR_io_uring_enter, fd, to_submit, min_complete,
+                         flags, NULL, 0);
+}
+
+static inline uint64_t slot_key(struct uring *ring, int idx)
+{
+    return (uint64_t) ring->slots[idx].gen << 32 | (uint32_t) idx;
+}
+
+static void submit(struct uring *ring)
+{
+    unsigned n = ring->pending;
+
+    ring->pending = 0;
+    if (n > 0 && uring_enter(ring->fd, n, 0, 0) < 0) {
+        nlog_warn("uring: %d submit %u, errno: %s(%d)", ring->fd, n,
+                  strerror(errno), errno);
+    }
+}
+
+static int push_sqe(struct uring *ring, uint8_t opcode, int fd,
+                    uint32_t poll_events, uint64_t addr, uint64_t user_data)
+{
+    unsigned tail = *ring->sq_tail;
+
+    if (tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE) >
+        ring->sq_mask) {
+        submit(ring);
+        if (tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE) >
+            ring->sq_mask) {
+            errno = EBUSY;
+            return -1;
+        }
+    }
+
+    unsigned             idx = tail & ring->sq_mask;
+    struct io_uring_sqe *sqe = &ring->sqes[idx];
+
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode        = opcode;
+    sqe->fd            = fd;
+    sqe->poll32_events = poll_events;
+    sqe->addr          = addr;
+    sqe->user_data     = user_data;
+    if (opcode == IORING_OP_TIMEOUT) {
+        sqe->len = 1;
+        sqe->off = 1; // also completes with the first other completion
+    }
+
+    ring->sq_array[idx] = idx;
+    __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    ring->pending += 1;
+    return 0;
+}
+
+static int arm(struct uring *ring, int idx)
+{
+    struct slot *slot = &ring->slots[idx];
+
+    slot->armed = push_sqe(ring, IORING_OP_POLL_ADD, slot->fd, slot->events,
+                           0, slot_key(ring, idx)) == 0;
+    if (!slot->armed) {
+        // the sq is full, tried again with the next wait
+        slot->next  = ring->rearm;
+        ring->rearm = idx;
+        return -1;
+    }
+
+    return 0;
+}
+
+static void free_slot(struct uring *ring, int idx)
+{
+    struct slot *slot = &ring->slots[idx];
+
+    slot->gen += 1;
+    slot->live      = false;
+    slot->armed     = false;
+    slot->ptr       = NULL;
+    slot->next      = ring->free_slot;
+    ring->free_slot = idx;
+}
+
+static int new_slot(struct uring *ring)
+{
+    if (ring->free_slot < 0) {
+        int          n     = ring->n_slot > 0 ? ring->n_slot * 2 : 64;
+        struct slot *slots = realloc(ring->slots, n * sizeof(struct slot));
+
+        if (slots == NULL) {
+            return -1;
+        }
+
+        memset(&slots[ring->n_slot], 0,
+               (n - ring->n_slot) * sizeof(struct slot));
+        ring->slots = slots;
+        for (int i = n - 1; i >= ring->n_slot; i--) {
+            slots[i].next   = ring->free_slot;
+            ring->free_slot = i;
+        }
+        ring->n_slot = n;
+    }
+
+    int idx         = ring->free_slot;
+    ring->free_slot = ring->slots[idx].next;
+    return idx;
+}
+
+static int poll_add(struct uring *ring, int fd, struct epoll_event *event)
+{
+    if (fd >= ring->n_fd) {
+        int  n       = fd + 64;
+        int *fd_slot = realloc(ring->fd_slot, n * sizeof(int));
+
+        if (fd_slot == NULL) {
+            errno = ENOMEM;
+            return -1;
+        }
+
+        for (int i = ring->n_fd; i < n; i++) {
+            fd_slot[i] = -1;
+        }
+        ring->fd_slot = fd_slot;
+        ring->n_fd    = n;
+    }
+
+    if (ring->fd_slot[fd] >= 0) {
+        errno = EEXIST;
+        return -1;
+    }
+
+    int idx = new_slot(ring);
+    if (idx < 0) {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    // the EPOLL* bits used by the events are the POLL* ones
+    ring->slots[idx].ptr    = event->data.ptr;
+    ring->slots[idx].fd     = fd;
+    ring->slots[idx].events = event->events;
+    ring->slots[idx].live   = true;
+    ring->fd_slot[fd]       = idx;
+
+    arm(ring, idx);
+    return 0;
+}
+
+static int poll_del(struct uring *ring, int fd)
+{
+    if (fd >= ring->n_fd || ring->fd_slot[fd] < 0) {
+        errno = ENOENT;
+        return -1;
+    }
+
+    int          idx  = ring->fd_slot[fd];
+    struct slot *slot = &ring->slots[idx];
+
+    ring->fd_slot[fd] = -1;
+    slot->live        = false;
+    // freed by the completion of the poll, or when the rearm is skipped
+    if (slot->armed) {
+        push_sqe(ring, IORING_OP_POLL_REMOVE, -1, 0, slot_key(ring, idx),
+                 URING_IGNORE);
+    }
+
+    return 0;
+}
+
+static void rearm(struct uring *ring)
+{
+    int list = ring->rearm;
+
+    ring->rearm = -1;
+    while (list >= 0) {
+        int idx = list;
+        list    = ring->slots[idx].next;
+
+        if (ring->slots[idx].live) {
+            arm(ring, idx);
+        } else {
+            free_slot(ring, idx);
+        }
+    }
+}
+
+static int reap(struct uring *ring, struct epoll_event *events, int max_events)
+{
+    unsigned head = *ring->cq_head;
+    unsigned tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+    int      n    = 0;
+
+    for (; head != tail && n < max_events; head++) {
+        struct io_uring_cqe *cqe = &ring->cqes[head & ring->cq_mask];
+        uint32_t             idx = (uint32_t) cqe->user_data;
+
+        if (cqe->user_data == URING_IGNORE || idx >= (uint32_t) ring->n_slot) {
+            continue;
+        }
+
+        struct slot *slot = &ring->slots[idx];
+        if (slot->gen != (uint32_t)(cqe->user_data >> 32) || !slot->armed) {
+            continue;
+        }
+
+        slot->armed = false;
+        if (!slot->live) {
+            free_slot(ring, idx);
+            continue;
+        }
+
+        if (cqe->res < 0) {
+            nlog_warn("uring: %d poll fd: %d, error: %s(%d)", ring->fd,
+                      slot->fd, strerror(-cqe->res), -cqe->res);
+            events[n].events = EPOLLERR | EPOLLHUP;
+        } else {
+            events[n].events = cqe->res;
+        }
+        events[n].data.ptr = slot->ptr;
+        n += 1;
+
+        slot->next  = ring->rearm;
+        ring->rearm = idx;
+    }
+
+    __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+    return n;
+}
+
+static void free_ring(struct uring *ring)
+{
+    munmap(ring->sqes, ring->sqes_len);
+    if (ring->cq_ring != ring->sq_ring) {
+        munmap(ring->cq_ring, ring->cq_ring_len);
+    }
+    munmap(ring->sq_ring, ring->sq_ring_len);
+    close(ring->fd);
+
+    pthread_mutex_destroy(&ring->mtx);
+    free(ring->slots);
+    free(ring->fd_slot);
+    free(ring);
+}
+
+static int map_ring(struct uring *ring, struct io_uring_params *p)
+{
+    int prot  = PROT_READ | PROT_WRITE;
+    int flags = MAP_SHARED | MAP_POPULATE;
+
+    ring->sq_ring_len = p->sq_off.array + p->sq_entries * sizeof(unsigned);
+    ring->cq_ring_len =
+        p->cq_off.cqes + p->cq_entries * sizeof(struct io_uring_cqe);
+    ring->sqes_len = p->sq_entries * sizeof(struct io_uring_sqe);
+
+    if (p->features & IORING_FEAT_SINGLE_MMAP) {
+        if (ring->cq_ring_len > ring->sq_ring_len) {
+            ring->sq_ring_len = ring->cq_ring_len;
+        }
+        ring->cq_ring_len = ring->sq_ring_len;
+    }
+
+    ring->sq_ring = mmap(NULL, ring->sq_ring_len, prot, flags, ring->fd,
+                         IORING_OFF_SQ_RING);
+    if (ring->sq_ring == MAP_FAILED) {
+        return -1;
+    }
+
+    if (p->features & IORING_FEAT_SINGLE_MMAP) {
+        ring->cq_ring = ring->sq_ring;
+    } else {
+        ring->cq_ring = mmap(NULL, ring->cq_ring_len, prot, flags, ring->fd,
+                             IORING_OFF_CQ_RING);
+        if (ring->cq_ring == MAP_FAILED) {
+            munmap(ring->sq_ring, ring->sq_ring_len);
+            return -1;
+        }
+    }
+
+    ring->sqes = mmap(NULL, ring->sqes_len, prot, flags, ring->fd,
+                      IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED) {
+        if (ring->cq_ring != ring->sq_ring) {
+            munmap(ring->cq_ring, ring->cq_ring_len);
+        }
+        munmap(ring->sq_ring, ring->sq_ring_len);
+        return -1;
+    }
+
+    uint8_t *sq = (uint8_t *) ring->sq_ring;
+    uint8_t *cq = (uint8_t *) ring->cq_ring;
+
+    ring->sq_head  = (unsigned *) (sq + p->sq_off.head);
+    ring->sq_tail  = (unsigned *) (sq + p->sq_off.tail);
+    ring->sq_array = (unsigned *) (sq + p->sq_off.array);
+    ring->sq_mask  = *(unsigned *) (sq + p->sq_off.ring_mask);
+    ring->cq_head  = (unsigned *) (cq + p->cq_off.head);
+    ring->cq_tail  = (unsigned *) (cq + p->cq_off.tail);
+    ring->cq_mask  = *(unsigned *) (cq + p->cq_off.ring_mask);
+    ring->cqes     = (struct io_uring_cqe *) (cq + p->cq_off.cqes);
+
+    return 0;
+}
+
+int neu_uring_create(void)
+{
+    struct io_uring_params p    = { 0 };
+    struct uring *         ring = NULL;
+    int                    fd   = uring_setup(URING_ENTRIES, &p);
+
+    if (fd < 0) {
+        nlog_warn("io_uring setup fail, errno: %s(%d), use epoll",
+                  strerror(errno), errno);
+        return epoll_create(1);
+    }
+
+    ring     = calloc(1, sizeof(struct uring));
+    ring->fd = fd;
+    if (map_ring(ring, &p) != 0) {
+        nlog_warn("io_uring mmap fail, errno: %s(%d), use epoll",
+                  strerror(errno), errno);
+        close(fd);
+        free(ring);
+        return epoll_create(1);
+    }
+
+    ring->free_slot = -1;
+    ring->rearm     = -1;
+    pthread_mutex_init(&ring->mtx, NULL);
+
+    pthread_mutex_lock(&rings_mtx);
+    HASH_ADD_INT(rings, fd, ring);
+    pthread_mutex_unlock(&rings_mtx);
+
+    return fd;
+}
+
+int neu_uring_close(int fd)
+{
+    struct uring *ring = NULL;
+
+    pthread_mutex_lock(&rings_mtx);
+    HASH_FIND_INT(rings, &fd, ring);
+    if (ring == NULL) {
+        pthread_mutex_unlock(&rings_mtx);
+        return close(fd);
+    }
+
+    ring->closed = true;
+    if (ring->in_wait) {
+        // wake the waiting thread, which frees the ring
+        pthread_mutex_lock(&ring->mtx);
+        push_sqe(ring, IORING_OP_NOP, -1, 0, 0, URING_IGNORE);
+        submit(ring);
+        pthread_mutex_unlock(&ring->mtx);
+    } else {
+        HASH_DEL(rings, ring);
+        free_ring(ring);
+    }
+    pthread_mutex_unlock(&rings_mtx);
+
+    return 0;
+}
+
+int neu_uring_ctl(int fd, int op, int target, struct epoll_event *event)
+{
+    struct uring *ring = NULL;
+    int           ret  = -1;
+
+    pthread_mutex_lock(&rings_mtx);
+    HASH_FIND_INT(rings, &fd, ring);
+    pthread_mutex_unlock(&rings_mtx);
+    if (ring == NULL) {
+        return epoll_ctl(fd, op, target, event);
+    }
+
+    pthread_mutex_lock(&ring->mtx);
+    switch (op) {
+    case EPOLL_CTL_ADD:
+        ret = poll_add(ring, target, event);
+        break;
+    case EPOLL_CTL_DEL:
+        ret = poll_del(ring, target);
+        break;
+    case EPOLL_CTL_MOD:
+        ret = poll_del(ring, target);
+        if (ret == 0) {
+            ret = poll_add(ring, target, event);
+        }
+        break;
+    default:
+        errno = EINVAL;
+        break;
+    }
+    submit(ring);
+    pthread_mutex_unlock(&ring->mtx);
+
+    return ret;
+}
+
+int neu_uring_wait(int fd, struct epoll_event *events, int max_events,
+                   int timeout)
+{
+    struct uring *ring     = NULL;
+    unsigned      n_submit = 0;
+    int           ret      = 0;
+    bool          closed   = false;
+
+    pthread_mutex_lock(&rings_mtx);
+    HASH_FIND_INT(rings, &fd, ring);
+    if (ring != NULL) {
+        ring->in_wait = true;
+    }
+    pthread_mutex_unlock(&rings_mtx);
+    if (ring == NULL) {
+        return epoll_wait(fd, events, max_events, timeout);
+    }
+
+    pthread_mutex_lock(&ring->mtx);
+    // the polls of the last batch go with the wait, in one syscall
+    rearm(ring);
+
+    bool ready = *ring->cq_head !=
+        __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+    if (!ready && timeout > 0) {
+        ring->timeout.tv_sec  = timeout / 1000;
+        ring->timeout.tv_nsec = (timeout % 1000) * 1000 * 1000;
+        push_sqe(ring, IORING_OP_TIMEOUT, -1, 0, (uint64_t) &ring->timeout,
+                 URING_IGNORE);
+    }
+    n_submit      = ring->pending;
+    ring->pending = 0;
+    pthread_mutex_unlock(&ring->mtx);
+
+    ret = uring_enter(ring->fd, n_submit, ready || timeout == 0 ? 0 : 1,
+                      IORING_ENTER_GETEVENTS);
+
+    if (ret >= 0 || errno == EINTR) {
+        pthread_mutex_lock(&ring->mtx);
+        ret = reap(ring, events, max_events);
+        pthread_mutex_unlock(&ring->mtx);
+    }
+
+    pthread_mutex_lock(&rings_mtx);
+    ring->in_wait = false;
+    closed        = ring->closed;
+    if (closed) {
+        HASH_DEL(rings, ring);
+        free_ring(ring);
+    }
+    pthread_mutex_unlock(&rings_mtx);
+
+    if (closed) {
+        errno = EBADF;
+        return -1;
+    }
+
+    return ret;
+}
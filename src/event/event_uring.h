@@ -0,0 +1,37 @@
+/**
+ * NEURON IIoT System for Industry 4.0
+ * Copyright (C) 2020-2023 EMQ Technologies Co., Ltd All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ **/
+
+#ifndef NEURON_EVENT_URING_H
+#define NEURON_EVENT_URING_H
+
+#include <sys/epoll.h>
+
+/*
+ * io_uring behind the epoll calls of event_linux.c. The fds are polled by
+ * oneshot IORING_OP_POLL_ADD, rearmed after each batch and submitted by the
+ * same io_uring_enter that waits for the next one. A kernel without io_uring
+ * gets a plain epoll fd, the calls below pass it through to epoll.
+ */
+int neu_uring_create(void);
+int neu_uring_close(int ring);
+int neu_uring_ctl(int ring, int op, int fd, struct epoll_event *event);
+int neu_uring_wait(int ring, struct epoll_event *events, int max_events,
+                   int timeout);
+
+#endif
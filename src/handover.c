@@ -0,0 +1,215 @@
+/**
+ * NEURON IIoT System for Industry 4.0
+ * Copyright (C) 2020-2022 EMQ Technologies Co., Ltd All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ **/
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "utils/log.h"
+
+#include "adapter/driver/driver_internal.h"
+#include "connection/neu_connection.h"
+
+#include "handover.h"
+
+// most fds handed over at once
+#define HANDOVER_MAX 1024
+
+static int handover_send_fd(int sock, const neu_conn_handover_t *item)
+{
+    char            ctrl[CMSG_SPACE(sizeof(int))] = { 0 };
+    struct iovec    iov                           = { 0 };
+    struct msghdr   msg                           = { 0 };
+    struct cmsghdr *cmsg                          = NULL;
+
+    iov.iov_base       = (void *) item->key;
+    iov.iov_len        = strlen(item->key) + 1;
+    msg.msg_iov        = &iov;
+    msg.msg_iovlen     = 1;
+    msg.msg_control    = ctrl;
+    msg.msg_controllen = sizeof(ctrl);
+
+    cmsg             = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type  = SCM_RIGHTS;
+    cmsg->cmsg_len   = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &item->fd, sizeof(int));
+
+    return sendmsg(sock, &msg, MSG_NOSIGNAL) < 0 ? -1 : 0;
+}
+
+static void handover_to(int sock)
+{
+    struct ucred         cred  = { 0 };
+    socklen_t            len   = sizeof(cred);
+    neu_conn_handover_t *items = NULL;
+    uint32_t             n     = 0;
+
+    if (0 != getsockopt(sock, SOL_SOCKET, SO_PEERCRED, &cred, &len) ||
+        (cred.uid != getuid() && cred.uid != 0)) {
+        nlog_warn("handover refused to pid: %d, uid: %d", cred.pid, cred.uid);
+        return;
+    }
+
+    // from now on a stop saves the values for the new process to load
+    neu_adapter_driver_set_handover(true);
+
+    items = calloc(HANDOVER_MAX, sizeof(neu_conn_handover_t));
+    n     = neu_conn_handover_export(items, HANDOVER_MAX);
+
+    if (send(sock, &n, sizeof(n), MSG_NOSIGNAL) != sizeof(n)) {
+        nlog_error("handover to pid: %d fail, errno: %d", cred.pid, errno);
+    } else {
+        for (uint32_t i = 0; i < n; ++i) {
+            if (0 != handover_send_fd(sock, &items[i])) {
+                nlog_error("handover %s fail, errno: %d", items[i].key, errno);
+                break;
+            }
+        }
+        nlog_notice("handover %u connections to pid: %d", n, cred.pid);
+    }
+
+    // the new process holds its own copies
+    for (uint32_t i = 0; i < n; ++i) {
+        close(items[i].fd);
+    }
+    free(items);
+}
+
+static void *handover_serve(void *arg)
+{
+    int sock = (int) (intptr_t) arg;
+
+    while (1) {
+        int peer = accept4(sock, NULL, NULL, SOCK_CLOEXEC);
+        if (peer < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            nlog_error("handover accept fail, errno: %d", errno);
+            break;
+        }
+
+        handover_to(peer);
+        close(peer);
+    }
+
+    close(sock);
+    return NULL;
+}
+
+int neuron_handover_serve()
+{
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    pthread_t          tid;
+    int                sock = -1;
+
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", NEURON_HANDOVER_SOCK);
+
+    sock = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (sock < 0) {
+        nlog_error("handover socket fail, errno: %d", errno);
+        return -1;
+    }
+
+    // left by a neuron killed before it could remove it
+    unlink(addr.sun_path);
+    if (0 != bind(sock, (struct sockaddr *) &addr, sizeof(addr)) ||
+        0 != listen(sock, 1)) {
+        nlog_error("handover listen %s fail, errno: %d", addr.sun_path, errno);
+        close(sock);
+        return -1;
+    }
+
+    if (0 != pthread_create(&tid, NULL, handover_serve,
+                            (void *) (intptr_t) sock)) {
+        close(sock);
+        return -1;
+    }
+    pthread_detach(tid);
+
+    return 0;
+}
+
+int neuron_handover_recv()
+{
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    uint32_t           n    = 0;
+    int                sock = -1;
+    int                got  = 0;
+
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", NEURON_HANDOVER_SOCK);
+
+    sock = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (sock < 0) {
+        return -1;
+    }
+
+    if (0 != connect(sock, (struct sockaddr *) &addr, sizeof(addr)) ||
+        recv(sock, &n, sizeof(n), 0) != sizeof(n)) {
+        nlog_error("handover from %s fail, errno: %d", addr.sun_path, errno);
+        close(sock);
+        return -1;
+    }
+
+    for (uint32_t i = 0; i < n; ++i) {
+        char            key[NEU_CONN_HANDOVER_KEY_LEN] = { 0 };
+        char            ctrl[CMSG_SPACE(sizeof(int))]  = { 0 };
+        struct iovec    iov                            = { 0 };
+        struct msghdr   msg                            = { 0 };
+        struct cmsghdr *cmsg                           = NULL;
+        int             fd                             = -1;
+
+        iov.iov_base       = key;
+        iov.iov_len        = sizeof(key) - 1;
+        msg.msg_iov        = &iov;
+        msg.msg_iovlen     = 1;
+        msg.msg_control    = ctrl;
+        msg.msg_controllen = sizeof(ctrl);
+
+        if (recvmsg(sock, &msg, MSG_CMSG_CLOEXEC) <= 0) {
+            nlog_error("handover recv fail, errno: %d", errno);
+            break;
+        }
+
+        cmsg = CMSG_FIRSTHDR(&msg);
+        if (cmsg == NULL || cmsg->cmsg_level != SOL_SOCKET ||
+            cmsg->cmsg_type != SCM_RIGHTS) {
+            continue;
+        }
+
+        memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+        neu_conn_handover_import(key, fd);
+        nlog_notice("handover %s, fd: %d", key, fd);
+        got += 1;
+    }
+
+    close(sock);
+    return got;
+}
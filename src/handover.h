@@ -0,0 +1,46 @@
+/**
+ * NEURON IIoT System for Industry 4.0
+ * Copyright (C) 2020-2022 EMQ Technologies Co., Ltd All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ **/
+
+#ifndef NEURON_HANDOVER_H
+#define NEURON_HANDOVER_H
+
+#define NEURON_HANDOVER_SOCK "/tmp/neuron-handover.sock"
+// seconds the nodes have to take the fds over, the rest are closed after
+#define NEURON_HANDOVER_GRACE 60
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Hand the device connections over to a new neuron asking for them, and
+ * keep the last known values of the drivers when stopped for it.
+ */
+int neuron_handover_serve();
+
+/** Take the device connections over from the running neuron.
+ *
+ * @return number of fds received, -1 on error.
+ */
+int neuron_handover_recv();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
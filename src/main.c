@@ -17,22 +17,32 @@
  * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
  **/
 
-#include <arpa/inet.h>
-#include <netdb.h>
-#include <netinet/in.h>
+#include <errno.h>
 #include <signal.h>
+#include <sys/mman.h>
 #include <sys/resource.h>
-#include <sys/socket.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <unistd.h>
 
+#include "adapter/adapter_internal.h"
+#include "adapter/driver/driver_internal.h"
+#include "base/msg_bus.h"
+#include "connection/neu_connection.h"
 #include "core/manager.h"
+#include "event/event.h"
+#include "metrics.h"
+#include "utils/http_handler.h"
 #include "utils/log.h"
+#include "utils/log_async.h"
+#include "utils/mem_budget.h"
 #include "utils/time.h"
 
 #include "argparse.h"
+#include "bench.h"
 #include "daemon.h"
+#include "handover.h"
+#include "remote_syslog.h"
 #include "version.h"
 
 static bool           exit_flag         = false;
@@ -44,90 +54,70 @@ char                  host_port[32]     = { 0 };
 
 int64_t global_timestamp = 0;
 
-struct {
-    struct sockaddr_in addr;
-    int                fd;
-} g_remote_syslog_ctx;
-
 static void sig_handler(int sig)
 {
     nlog_warn("recv sig: %d", sig);
 
-    if (sig == SIGINT || sig == SIGTERM) {
-        neu_manager_destroy(g_manager);
+    neu_metrics_push_stop();
+
+    // past the shutdown timeout the nodes still closing run on, and the
+    // event engine, persister and log they use go with the process
+    if ((sig == SIGINT || sig == SIGTERM) &&
+        neu_manager_destroy(g_manager) == 0) {
+        neu_event_engine_fini();
         neu_persister_destroy();
+        neu_log_async_fini();
         zlog_fini();
+    } else {
+        // the lines logged so far still go to the files
+        neu_log_async_fini();
     }
     exit_flag = true;
     exit(-1);
 }
 
-static inline char syslog_priority(const char *level)
+static void takeover_handler(int sig)
 {
-    switch (level[0]) {
-    case 'D': // DEBUG
-        return '7';
-    case 'I': // INFO
-        return '6';
-    case 'N': // NOTICE
-        return '5';
-    case 'W': // WARN
-        return '4';
-    case 'E': // ERROR
-        return '3';
-    case 'F': // FATAL
-        return '2';
-    default: // UNKNOWN
-        return '1';
-    }
+    (void) sig;
+    neu_manager_takeover();
 }
 
-static int remote_syslog(zlog_msg_t *msg)
+// take the connections over from the running neuron, then stop it
+static int handover_from_running()
 {
-    // fix priority
-    msg->buf[1] = syslog_priority(msg->path);
-
-    sendto(g_remote_syslog_ctx.fd, msg->buf, msg->len, 0,
-           (const struct sockaddr *) &g_remote_syslog_ctx.addr,
-           sizeof(g_remote_syslog_ctx.addr));
-    return 0;
-}
+    int n = neuron_handover_recv();
 
-static int config_remote_syslog(const char *host, uint16_t port)
-{
-    g_remote_syslog_ctx.fd = socket(AF_INET, SOCK_DGRAM, 0);
-    if (g_remote_syslog_ctx.fd < 0) {
+    if (n < 0) {
         return -1;
     }
 
-    g_remote_syslog_ctx.addr.sin_family      = AF_INET;
-    g_remote_syslog_ctx.addr.sin_port        = htons(port);
-    g_remote_syslog_ctx.addr.sin_addr.s_addr = inet_addr(host);
-
-    if (0 == inet_pton(AF_INET, host, &g_remote_syslog_ctx.addr.sin_addr)) {
-        // not an valid ip address, try resolve as host name
-        struct hostent *he = gethostbyname(host);
-        if (NULL == he) {
-            return -1;
-        }
-
-        memcpy(&g_remote_syslog_ctx.addr.sin_addr, he->h_addr_list[0],
-               he->h_length);
+    // it saves the last known values as it stops, for the nodes to load
+    if (0 != neuron_stop() || neuron_already_running()) {
+        neu_conn_handover_drop();
+        return -1;
     }
 
-    zlog_set_record("remote_syslog", remote_syslog);
+    nlog_notice("neuron handover, connections: %d", n);
+    neu_adapter_driver_set_handover(true);
     return 0;
 }
 
 static int neuron_run(const neu_cli_args_t *args)
 {
-    struct rlimit rl = { 0 };
-    int           rv = 0;
+    struct rlimit    rl    = { 0 };
+    int              rv    = 0;
+    int64_t          start = 0;
+    neu_bench_conf_t bench = { 0 };
+
+    // the sender and writer do not survive the fork of the restart loop
+    remote_syslog_start();
+    neu_log_async_start();
 
     signal(SIGINT, sig_handler);
     signal(SIGABRT, sig_handler);
     signal(SIGTERM, sig_handler);
     signal(SIGKILL, sig_handler);
+    signal(SIGUSR2, takeover_handler);
 
     // try to enable core dump
     rl.rlim_cur = rl.rlim_max = RLIM_INFINITY;
@@ -135,9 +125,49 @@ static int neuron_run(const neu_cli_args_t *args)
         nlog_warn("neuron process failed enable core dump, ignore");
     }
 
-    rv = neu_persister_create(args->config_dir);
+    // before the nodes start, so that their threads fault their stacks in
+    if (args->mlock && mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+        nlog_warn("neuron process failed to lock memory, errno: %d, ignore",
+                  errno);
+    }
+
+    if (args->bench != NULL) {
+        neu_bench_parse(args->bench, &bench);
+        rv = neu_bench_setup(&bench, args->config_dir);
+    } else {
+        rv = neu_persister_create(args->config_dir);
+    }
     assert(rv == 0);
 
+    if (args->msg_bus) {
+        neu_msg_bus_enable();
+    }
+    neu_adapter_driver_set_batch_report(args->batch_report);
+    neu_adapter_set_app_consumers(args->app_consumers);
+    // the bench measures the latency of every report
+    neu_trace_set_sample(args->bench != NULL ? 1 : args->trace_sample);
+    neu_manager_set_lazy_drivers(args->lazy_drivers);
+    neu_adapter_driver_set_lkv_interval(args->lkv_interval);
+    neu_adapter_driver_set_overrun(args->overrun);
+    neu_adapter_driver_set_shed_max(args->shed_max);
+    neu_adapter_driver_set_stretch_max(args->stretch_max);
+    neu_adapter_driver_set_cold_groups(args->cold_groups);
+    neu_adapter_driver_set_profile_interval(args->profile_interval);
+    neu_adapter_driver_set_write_through(args->write_through);
+    neu_adapter_driver_set_history(args->history_size);
+    neu_manager_set_standby(args->standby);
+    neu_manager_set_shutdown_timeout(args->shutdown_timeout);
+    neu_conn_set_reconnect_rate(args->reconnect_rate);
+    neu_http_set_workers(args->http_workers);
+    neu_metrics_set_off(args->metrics_off);
+    neu_metrics_set_windows(args->metrics_windows, args->n_metrics_windows);
+    neu_mem_budget_set((size_t) args->mem_budget * 1024 * 1024,
+                       args->mem_policy);
+    if (args->event_workers != NEU_EVENT_WORKERS_PER_NODE &&
+        neu_event_engine_init(args->event_workers) != 0) {
+        nlog_warn("event engine start fail, use event threads per node");
+    }
+
     zlog_notice(neuron, "neuron start, daemon: %d, version: %s (%s %s)",
                 args->daemonized, NEURON_VERSION,
                 NEURON_GIT_REV NEURON_GIT_DIFF, NEURON_BUILD_DATE);
@@ -147,8 +177,34 @@ static int neuron_run(const neu_cli_args_t *args)
         return -1;
     }
 
+    if (args->bench != NULL) {
+        rv = neu_bench_run(&bench);
+        if (neu_manager_destroy(g_manager) == 0) {
+            neu_event_engine_fini();
+            neu_persister_destroy();
+        }
+        return rv;
+    }
+
+    if (args->metrics_push != NULL &&
+        neu_metrics_push_start(args->metrics_push,
+                               args->metrics_push_interval) != 0) {
+        nlog_warn("neuron metrics push start fail, ignore");
+    }
+
+    if (0 != neuron_handover_serve()) {
+        nlog_warn("neuron handover serve fail, ignore");
+    }
+
+    start = neu_time_ms();
     while (!exit_flag) {
         sleep(1);
+        // the fds of the nodes gone or changed since the handover
+        if (start > 0 &&
+            neu_time_ms() - start > NEURON_HANDOVER_GRACE * 1000) {
+            neu_conn_handover_drop();
+            start = 0;
+        }
     }
 
     return 0;
@@ -174,9 +230,13 @@ int main(int argc, char *argv[])
     }
 
     zlog_init(args.log_init_file);
+    if (0 != neu_log_async_init(args.log_overflow)) {
+        fprintf(stderr, "neuron log writer start fail, exit.\n");
+        goto main_end;
+    }
 
     if (args.syslog_host && strlen(args.syslog_host) > 0 &&
-        0 != config_remote_syslog(args.syslog_host, args.syslog_port)) {
+        0 != remote_syslog_init(args.syslog_host, args.syslog_port)) {
         nlog_fatal("neuron setup remote syslog fail, exit.");
         goto main_end;
     }
@@ -184,7 +244,19 @@ int main(int argc, char *argv[])
     neuron = zlog_get_category("neuron");
     zlog_level_switch(neuron, default_log_level);
 
+    if (args.handover && neuron_already_running() &&
+        0 != handover_from_running()) {
+        printf("neuron handover failed.\n");
+        rv = -1;
+        goto main_end;
+    }
+
     if (neuron_already_running()) {
+        if (args.takeover) {
+            rv = neuron_takeover();
+            printf("neuron takeover %s.\n", rv == 0 ? "sent" : "failed");
+            goto main_end;
+        }
         if (args.stop) {
             rv = neuron_stop();
             nlog_notice("neuron stop ret=%d", rv);
@@ -199,13 +271,16 @@ int main(int argc, char *argv[])
         }
         goto main_end;
     } else {
-        if (args.stop) {
-            rv = 0;
+        if (args.stop || args.takeover) {
+            rv = args.stop ? 0 : -1;
             printf("neuron no running.\n");
             goto main_end;
         }
     }
 
+    // a takeover signals the whole group, only neuron_run handles it
+    signal(SIGUSR2, SIG_IGN);
+
     for (size_t i = 0; i < args.restart; ++i) {
         if ((pid = fork()) < 0) {
             nlog_error("cannot fork neuron daemon");
@@ -214,6 +289,9 @@ int main(int argc, char *argv[])
             break;
         }
 
+        // the child takes over the fds, a restarted one connects anew
+        neu_conn_handover_drop();
+
         // block waiting for child
         if (pid != waitpid(pid, &status, 0)) {
             nlog_error("cannot wait for neuron daemon");
@@ -235,6 +313,8 @@ int main(int argc, char *argv[])
     rv = neuron_run(&args);
 
 main_end:
+    remote_syslog_fini();
+    neu_log_async_fini();
     neu_cli_args_fini(&args);
     zlog_fini();
     return rv;
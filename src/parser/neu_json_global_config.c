@@ -359,14 +359,27 @@ void neu_json_decode_global_config_req_settings_free(
 int neu_json_decode_global_config_req(char *                         buf,
                                       neu_json_global_config_req_t **result)
 {
-    neu_json_global_config_req_t *req = calloc(1, sizeof(*req));
-    if (NULL == req) {
+    return neu_json_decode_global_config_reqb(buf, strlen(buf), result);
+}
+
+int neu_json_decode_global_config_reqb(const char *buf, size_t len,
+                                       neu_json_global_config_req_t **result)
+{
+    void *json_obj = neu_json_decode_newb((char *) buf, len);
+    if (NULL == json_obj) {
         return -1;
     }
 
-    void *json_obj = neu_json_decode_new(buf);
-    if (NULL == json_obj) {
-        free(req);
+    int ret = neu_json_decode_global_config_req_json(json_obj, result);
+    neu_json_decode_free(json_obj);
+    return ret;
+}
+
+int neu_json_decode_global_config_req_json(
+    void *json_obj, neu_json_global_config_req_t **result)
+{
+    neu_json_global_config_req_t *req = calloc(1, sizeof(*req));
+    if (NULL == req) {
         return -1;
     }
 
@@ -388,7 +401,6 @@ int neu_json_decode_global_config_req(char *                         buf,
         neu_json_decode_global_config_req_free(req);
     }
 
-    neu_json_decode_free(json_obj);
     return ret;
 }
 
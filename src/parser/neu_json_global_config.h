@@ -70,6 +70,10 @@ typedef struct {
 
 int  neu_json_decode_global_config_req(char *                         buf,
                                        neu_json_global_config_req_t **result);
+int  neu_json_decode_global_config_reqb(const char *buf, size_t len,
+                                        neu_json_global_config_req_t **result);
+int  neu_json_decode_global_config_req_json(
+    void *json_obj, neu_json_global_config_req_t **result);
 void neu_json_decode_global_config_req_free(neu_json_global_config_req_t *req);
 
 typedef struct {
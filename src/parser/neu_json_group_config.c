@@ -234,6 +234,120 @@ int neu_json_encode_get_driver_group_resp(void *json_object, void *param)
     return ret;
 }
 
+static void *encode_group_profile_advices(neu_json_group_profile_t *group)
+{
+    void *advice_array = neu_json_array();
+
+    for (int i = 0; i < group->n_advice; i++) {
+        neu_json_group_profile_advice_t *advice    = &group->advices[i];
+        void *                           tag_array = neu_json_array();
+
+        for (int k = 0; k < advice->n_tag; k++) {
+            neu_json_elem_t tag_elem = {
+                .t         = NEU_JSON_STR,
+                .v.val_str = (char *) advice->tags[k],
+            };
+            tag_array = neu_json_encode_array_value(tag_array, &tag_elem, 1);
+        }
+
+        neu_json_elem_t advice_elems[] = {
+            {
+                .name      = "kind",
+                .t         = NEU_JSON_STR,
+                .v.val_str = (char *) advice->kind,
+            },
+            {
+                .name      = "value",
+                .t         = NEU_JSON_INT,
+                .v.val_int = advice->value,
+            },
+            {
+                .name         = "tags",
+                .t            = NEU_JSON_OBJECT,
+                .v.val_object = tag_array,
+            },
+        };
+        advice_array = neu_json_encode_array(advice_array, advice_elems,
+                                             NEU_JSON_ELEM_SIZE(advice_elems));
+    }
+
+    return advice_array;
+}
+
+int neu_json_encode_get_group_profile_resp(void *json_object, void *param)
+{
+    neu_json_get_group_profile_resp_t *resp =
+        (neu_json_get_group_profile_resp_t *) param;
+
+    void *group_array = neu_json_array();
+    for (int i = 0; i < resp->n_group; i++) {
+        neu_json_group_profile_t *p_group = &resp->groups[i];
+
+        neu_json_elem_t group_elems[] = {
+            {
+                .name      = "group",
+                .t         = NEU_JSON_STR,
+                .v.val_str = p_group->group,
+            },
+            {
+                .name      = "interval",
+                .t         = NEU_JSON_INT,
+                .v.val_int = p_group->interval,
+            },
+            {
+                .name      = "reads",
+                .t         = NEU_JSON_INT,
+                .v.val_int = p_group->reads,
+            },
+            {
+                .name         = "read_ms",
+                .t            = NEU_JSON_DOUBLE,
+                .v.val_double = p_group->read_ms,
+            },
+            {
+                .name      = "p50_ms",
+                .t         = NEU_JSON_INT,
+                .v.val_int = p_group->p50_ms,
+            },
+            {
+                .name      = "p90_ms",
+                .t         = NEU_JSON_INT,
+                .v.val_int = p_group->p90_ms,
+            },
+            {
+                .name         = "overruns",
+                .t            = NEU_JSON_DOUBLE,
+                .v.val_double = p_group->overruns,
+            },
+            {
+                .name         = "blocks",
+                .t            = NEU_JSON_DOUBLE,
+                .v.val_double = p_group->blocks,
+            },
+            {
+                .name         = "block_ms",
+                .t            = NEU_JSON_DOUBLE,
+                .v.val_double = p_group->block_ms,
+            },
+            {
+                .name         = "advices",
+                .t            = NEU_JSON_OBJECT,
+                .v.val_object = encode_group_profile_advices(p_group),
+            },
+        };
+        group_array = neu_json_encode_array(group_array, group_elems,
+                                            NEU_JSON_ELEM_SIZE(group_elems));
+    }
+
+    neu_json_elem_t resp_elems[] = { {
+        .name         = "groups",
+        .t            = NEU_JSON_OBJECT,
+        .v.val_object = group_array,
+    } };
+    return neu_json_encode_field(json_object, resp_elems,
+                                 NEU_JSON_ELEM_SIZE(resp_elems));
+}
+
 int neu_json_decode_get_driver_group_resp(
     char *buf, neu_json_get_driver_group_resp_t **result)
 {
@@ -98,6 +98,34 @@ int neu_json_decode_get_driver_group_resp_json(
 void neu_json_decode_get_driver_group_resp_free(
     neu_json_get_driver_group_resp_t *resp);
 
+typedef struct {
+    const char * kind;
+    int64_t      value;
+    int          n_tag;
+    const char **tags;
+} neu_json_group_profile_advice_t;
+
+typedef struct {
+    char *                           group;
+    int64_t                          interval;
+    int64_t                          reads;
+    double                           read_ms;  // mean
+    int64_t                          p50_ms;   // upper bound of the bucket
+    int64_t                          p90_ms;   // upper bound of the bucket
+    double                           overruns; // share of the reads
+    double                           blocks;   // device requests per read
+    double                           block_ms; // mean per device request
+    int                              n_advice;
+    neu_json_group_profile_advice_t *advices;
+} neu_json_group_profile_t;
+
+typedef struct {
+    int                       n_group;
+    neu_json_group_profile_t *groups;
+} neu_json_get_group_profile_resp_t;
+
+int neu_json_encode_get_group_profile_resp(void *json_object, void *param);
+
 typedef struct {
     char *group;
     char *driver;
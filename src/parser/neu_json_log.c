@@ -99,4 +99,113 @@ void neu_json_decode_update_log_level_req_free(
     if (req != NULL) {
         free(req);
     }
-}
\ No newline at end of file
+}
+
+int neu_json_decode_update_log_capture_req(
+    char *buf, neu_json_update_log_capture_req_t **result)
+{
+    int   ret      = 0;
+    void *json_obj = neu_json_decode_new(buf);
+
+    neu_json_update_log_capture_req_t *req =
+        calloc(1, sizeof(neu_json_update_log_capture_req_t));
+    if (req == NULL) {
+        return -1;
+    }
+
+    neu_json_elem_t req_elems[] = {
+        {
+            .name = "node",
+            .t    = NEU_JSON_STR,
+        },
+        {
+            .name = "enable",
+            .t    = NEU_JSON_BOOL,
+        },
+        {
+            .name      = "packets",
+            .t         = NEU_JSON_INT,
+            .attribute = NEU_JSON_ATTRIBUTE_OPTIONAL,
+        }
+    };
+
+    ret = neu_json_decode_by_json(json_obj, NEU_JSON_ELEM_SIZE(req_elems),
+                                  req_elems);
+    if (ret != 0) {
+        goto decode_fail;
+    }
+
+    req->node_name = req_elems[0].v.val_str;
+    req->enable    = req_elems[1].v.val_bool;
+    req->packets   = req_elems[2].v.val_int;
+    *result        = req;
+    goto decode_exit;
+
+decode_fail:
+    free(req_elems[0].v.val_str);
+    free(req);
+    ret = -1;
+decode_exit:
+    if (json_obj != NULL) {
+        neu_json_decode_free(json_obj);
+    }
+    return ret;
+}
+
+void neu_json_decode_update_log_capture_req_free(
+    neu_json_update_log_capture_req_t *req)
+{
+    if (req != NULL) {
+        free(req->node_name);
+        free(req);
+    }
+}
+
+int neu_json_encode_get_profile_threads_resp(void *json_object, void *param)
+{
+    int                                  ret = 0;
+    neu_json_get_profile_threads_resp_t *resp =
+        (neu_json_get_profile_threads_resp_t *) param;
+
+    void *                                      thread_array = neu_json_array();
+    neu_json_get_profile_threads_resp_thread_t *p_thread     = resp->threads;
+    for (int i = 0; i < resp->n_thread; i++) {
+        neu_json_elem_t thread_elems[] = {
+            {
+                .name      = "node",
+                .t         = NEU_JSON_STR,
+                .v.val_str = p_thread->node,
+            },
+            {
+                .name      = "role",
+                .t         = NEU_JSON_STR,
+                .v.val_str = p_thread->role,
+            },
+            {
+                .name      = "cpu_ms",
+                .t         = NEU_JSON_INT,
+                .v.val_int = p_thread->cpu_ms,
+            },
+        };
+        thread_array = neu_json_encode_array(
+            thread_array, thread_elems, NEU_JSON_ELEM_SIZE(thread_elems));
+        p_thread++;
+    }
+
+    neu_json_elem_t resp_elems[] = {
+        {
+            .name      = "cpu_ms",
+            .t         = NEU_JSON_INT,
+            .v.val_int = resp->cpu_ms,
+        },
+        {
+            .name         = "threads",
+            .t            = NEU_JSON_OBJECT,
+            .v.val_object = thread_array,
+        },
+    };
+    ret = neu_json_encode_field(json_object, resp_elems,
+                                NEU_JSON_ELEM_SIZE(resp_elems));
+
+    return ret;
+}
@@ -51,6 +51,31 @@ void neu_json_decode_update_log_level_req_free(
 int neu_json_decode_update_log_level_req(
     char *buf, neu_json_update_log_level_req_t **result);
 
+typedef struct {
+    char *  node_name;
+    bool    enable;
+    int64_t packets;
+} neu_json_update_log_capture_req_t;
+
+void neu_json_decode_update_log_capture_req_free(
+    neu_json_update_log_capture_req_t *req);
+int neu_json_decode_update_log_capture_req(
+    char *buf, neu_json_update_log_capture_req_t **result);
+
+typedef struct {
+    char *  node;
+    char *  role;
+    int64_t cpu_ms;
+} neu_json_get_profile_threads_resp_thread_t;
+
+typedef struct {
+    int64_t                                     cpu_ms;
+    int                                         n_thread;
+    neu_json_get_profile_threads_resp_thread_t *threads;
+} neu_json_get_profile_threads_resp_t;
+
+int neu_json_encode_get_profile_threads_resp(void *json_object, void *param);
+
 #ifdef __cplusplus
 }
 #endif
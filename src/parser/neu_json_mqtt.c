@@ -29,11 +29,55 @@
 #include "json/json.h"
 
 #include "json/neu_json_mqtt.h"
+#include "json/neu_json_scan.h"
+
+// the uuid shares the payload with a write or read request, pick it out
+// without a tree and leave anything unusual to jansson
+static int scan_mqtt_req(const char *buf, size_t len, char **uuid)
+{
+    neu_json_scan_t scan  = { 0 };
+    int             index = 0;
+    int             rv    = 0;
+    const char *    key   = NULL;
+    size_t          n     = 0;
+
+    neu_json_scan_init(&scan, buf, len);
+    if (neu_json_scan_object(&scan) != 0) {
+        return -1;
+    }
+    while ((rv = neu_json_scan_key(&scan, &index, &key, &n)) > 0) {
+        if (neu_json_scan_key_is(key, n, "uuid") && *uuid == NULL) {
+            rv = neu_json_scan_str(&scan, uuid);
+        } else if (neu_json_scan_key_is(key, n, "uuid")) {
+            rv = -1;
+        } else {
+            rv = neu_json_scan_skip(&scan);
+        }
+        if (rv != 0) {
+            break;
+        }
+    }
+
+    if (rv != 0 || neu_json_scan_end(&scan) != 0 || *uuid == NULL) {
+        free(*uuid);
+        *uuid = NULL;
+        return -1;
+    }
+    return 0;
+}
 
 int neu_json_decode_mqtt_req(char *buf, neu_json_mqtt_t **result)
 {
     int              ret = 0;
     neu_json_mqtt_t *req = calloc(1, sizeof(neu_json_mqtt_t));
+    if (req == NULL) {
+        return -1;
+    }
+
+    if (0 == scan_mqtt_req(buf, strlen(buf), &req->uuid)) {
+        *result = req;
+        return 0;
+    }
 
     neu_json_elem_t elems_uuid[] = { {
         .name = "uuid",
@@ -589,3 +589,123 @@ int neu_json_encode_get_node_setting_resp(void *json_object, void *param)
 
     return ret;
 }
+
+static int decode_retention(json_t *type, json_t *ttl,
+                            neu_json_cache_retention_t *retention)
+{
+    static const struct {
+        const char *         name;
+        neu_tag_cache_type_e type;
+    } types[] = {
+        { "interval", NEU_TAG_CACHE_TYPE_INTERVAL },
+        { "never", NEU_TAG_CACHE_TYPE_NEVER },
+        { "lkv", NEU_TAG_CACHE_TYPE_LKV },
+        { "ttl", NEU_TAG_CACHE_TYPE_TTL },
+        { "subscribed", NEU_TAG_CACHE_TYPE_SUBSCRIBED },
+    };
+    size_t i = 0;
+
+    if (!json_is_string(type) || (NULL != ttl && !json_is_integer(ttl))) {
+        return -1;
+    }
+
+    for (i = 0; i < sizeof(types) / sizeof(types[0]); ++i) {
+        if (0 == strcmp(types[i].name, json_string_value(type))) {
+            break;
+        }
+    }
+    if (i == sizeof(types) / sizeof(types[0])) {
+        return -1;
+    }
+
+    retention->type = types[i].type;
+    retention->ttl  = NULL != ttl ? json_integer_value(ttl) : 0;
+    if (NEU_TAG_CACHE_TYPE_TTL == retention->type && retention->ttl <= 0) {
+        return -1;
+    }
+    return 0;
+}
+
+static int push_retention(neu_json_cache_retentions_t *retentions,
+                          const char *group, json_t *type, json_t *ttl)
+{
+    neu_json_cache_retention_t  retention = { 0 };
+    neu_json_cache_retention_t *grown     = NULL;
+
+    if (0 != decode_retention(type, ttl, &retention)) {
+        return -1;
+    }
+    if (NULL != group && NULL == (retention.group = strdup(group))) {
+        return -1;
+    }
+
+    grown = realloc(retentions->retentions,
+                    (retentions->n_retention + 1) * sizeof(retention));
+    if (NULL == grown) {
+        free(retention.group);
+        return -1;
+    }
+    grown[retentions->n_retention++] = retention;
+    retentions->retentions           = grown;
+    return 0;
+}
+
+int neu_json_decode_cache_retentions(const char *                 setting,
+                                     neu_json_cache_retentions_t *result)
+{
+    json_t *    root   = NULL;
+    json_t *    params = NULL;
+    json_t *    groups = NULL;
+    json_t *    group  = NULL;
+    const char *name   = NULL;
+    int         ret    = 0;
+
+    memset(result, 0, sizeof(*result));
+    if (NULL == setting || NULL == (root = json_loads(setting, 0, NULL))) {
+        return 0;
+    }
+
+    params = json_object_get(root, "params");
+    if (!json_is_object(params)) {
+        goto end;
+    }
+
+    if (NULL != json_object_get(params, "cache_retention")) {
+        ret = push_retention(result, NULL,
+                             json_object_get(params, "cache_retention"),
+                             json_object_get(params, "cache_ttl"));
+    }
+
+    groups = json_object_get(params, "cache_groups");
+    if (0 == ret && NULL != groups) {
+        if (!json_is_object(groups)) {
+            ret = -1;
+        }
+        json_object_foreach(groups, name, group)
+        {
+            if (0 != ret) {
+                break;
+            }
+            ret = push_retention(result, name,
+                                 json_object_get(group, "retention"),
+                                 json_object_get(group, "ttl"));
+        }
+    }
+
+end:
+    json_decref(root);
+    if (0 != ret) {
+        neu_json_decode_cache_retentions_fini(result);
+    }
+    return ret;
+}
+
+void neu_json_decode_cache_retentions_fini(
+    neu_json_cache_retentions_t *retentions)
+{
+    for (int i = 0; i < retentions->n_retention; ++i) {
+        free(retentions->retentions[i].group);
+    }
+    free(retentions->retentions);
+    memset(retentions, 0, sizeof(*retentions));
+}
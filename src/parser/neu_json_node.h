@@ -132,6 +132,29 @@ typedef struct {
 
 int neu_json_encode_get_node_setting_resp(void *json_object, void *param);
 
+// how long the cached values of a driver group are kept, group is NULL for
+// the default of the node
+typedef struct {
+    char *               group;
+    neu_tag_cache_type_e type;
+    int64_t              ttl; // ms, NEU_TAG_CACHE_TYPE_TTL only
+} neu_json_cache_retention_t;
+
+typedef struct {
+    int                         n_retention;
+    neu_json_cache_retention_t *retentions;
+} neu_json_cache_retentions_t;
+
+// the cache retention in the params of a node setting, none if it has none.
+//   `"cache_retention": "lkv", "cache_ttl": 30000,
+//    "cache_groups": {"group": {"retention": "ttl", "ttl": 5000}}`
+// the retention is one of interval, never, lkv, ttl and subscribed, a ttl
+// retention needs a positive ttl. Returns -1 if the params are malformed
+int  neu_json_decode_cache_retentions(const char *                 setting,
+                                      neu_json_cache_retentions_t *result);
+void neu_json_decode_cache_retentions_fini(
+    neu_json_cache_retentions_t *retentions);
+
 #ifdef __cplusplus
 }
 #endif
@@ -33,6 +33,460 @@
 #include "tag.h"
 
 #include "json/neu_json_rw.h"
+#include "json/neu_json_scan.h"
+
+/*
+ * Single pass decoders for the requests on the hot write and read paths.
+ * They return -1 for anything unusual and the public decoders then fall back
+ * to the generic jansson ones below, which keep the reference semantics and
+ * the error logs.
+ */
+enum {
+    SCAN_NODE    = 1 << 0,
+    SCAN_GROUP   = 1 << 1,
+    SCAN_TAG     = 1 << 2,
+    SCAN_VALUE   = 1 << 3,
+    SCAN_TAGS    = 1 << 4,
+    SCAN_PREEMPT = 1 << 5,
+    SCAN_GROUPS  = 1 << 6,
+    SCAN_SYNC    = 1 << 7,
+    SCAN_QUERY   = 1 << 8,
+    SCAN_MAX_AGE = 1 << 9,
+    SCAN_NAME    = 1 << 10,
+    SCAN_DESC    = 1 << 11,
+    SCAN_VERIFY  = 1 << 12,
+};
+
+// each member is decoded at most once, duplicates go to jansson
+#define SCAN_ONCE(seen, bit) \
+    if ((seen) & (bit)) {    \
+        return -1;           \
+    }                        \
+    (seen) |= (bit)
+
+typedef struct {
+    unsigned                    seen;
+    char *                      node;
+    char *                      group;
+    char *                      tag;
+    enum neu_json_type          t;
+    union neu_json_value        value;
+    int                         n_tag;
+    neu_json_write_tags_elem_t *tags;
+    bool                        preempt;
+    bool                        verify;
+} write_scan_t;
+
+static void free_json_value(enum neu_json_type t, union neu_json_value *value)
+{
+    if (t == NEU_JSON_STR) {
+        free(value->val_str);
+    }
+    if (t == NEU_JSON_BYTES && value->val_bytes.length > 0) {
+        free(value->val_bytes.bytes);
+    }
+}
+
+static void free_write_tags(neu_json_write_tags_elem_t *tags, int n_tag)
+{
+    for (int i = 0; i < n_tag; i++) {
+        free(tags[i].tag);
+        free_json_value(tags[i].t, &tags[i].value);
+    }
+    free(tags);
+}
+
+static int scan_write_tag(neu_json_scan_t *           scan,
+                          neu_json_write_tags_elem_t *tag)
+{
+    unsigned    seen  = 0;
+    int         index = 0;
+    int         rv    = 0;
+    const char *key   = NULL;
+    size_t      len   = 0;
+
+    if (neu_json_scan_object(scan) != 0) {
+        return -1;
+    }
+    while ((rv = neu_json_scan_key(scan, &index, &key, &len)) > 0) {
+        if (neu_json_scan_key_is(key, len, "tag")) {
+            SCAN_ONCE(seen, SCAN_TAG);
+            rv = neu_json_scan_str(scan, &tag->tag);
+        } else if (neu_json_scan_key_is(key, len, "value")) {
+            SCAN_ONCE(seen, SCAN_VALUE);
+            rv = neu_json_scan_value(scan, &tag->t, &tag->value);
+        } else {
+            rv = neu_json_scan_skip(scan);
+        }
+        if (rv != 0) {
+            return -1;
+        }
+    }
+
+    return rv == 0 && seen == (SCAN_TAG | SCAN_VALUE) ? 0 : -1;
+}
+
+/*
+ * Decode a tag array into `*tags`. On failure `*n_tag` still counts the
+ * elements that need freeing.
+ */
+static int scan_write_tags(neu_json_scan_t *scan,
+                           neu_json_write_tags_elem_t **tags, int *n_tag)
+{
+    int cap   = 0;
+    int index = 0;
+    int rv    = 0;
+
+    if (neu_json_scan_array(scan) != 0) {
+        return -1;
+    }
+    while ((rv = neu_json_scan_elem(scan, &index)) > 0) {
+        if (*n_tag == cap) {
+            neu_json_write_tags_elem_t *grow = NULL;
+
+            cap  = cap > 0 ? cap * 2 : 8;
+            grow = realloc(*tags, cap * sizeof(neu_json_write_tags_elem_t));
+            if (grow == NULL) {
+                return -1;
+            }
+            *tags = grow;
+        }
+
+        neu_json_write_tags_elem_t *tag = &(*tags)[(*n_tag)++];
+        memset(tag, 0, sizeof(*tag));
+        if (scan_write_tag(scan, tag) != 0) {
+            return -1;
+        }
+    }
+
+    return rv;
+}
+
+static int scan_write_members(neu_json_scan_t *scan, write_scan_t *ws)
+{
+    int         index = 0;
+    int         rv    = 0;
+    const char *key   = NULL;
+    size_t      len   = 0;
+
+    if (neu_json_scan_object(scan) != 0) {
+        return -1;
+    }
+    while ((rv = neu_json_scan_key(scan, &index, &key, &len)) > 0) {
+        if (neu_json_scan_key_is(key, len, "node")) {
+            SCAN_ONCE(ws->seen, SCAN_NODE);
+            rv = neu_json_scan_str(scan, &ws->node);
+        } else if (neu_json_scan_key_is(key, len, "group")) {
+            SCAN_ONCE(ws->seen, SCAN_GROUP);
+            rv = neu_json_scan_str(scan, &ws->group);
+        } else if (neu_json_scan_key_is(key, len, "tag")) {
+            SCAN_ONCE(ws->seen, SCAN_TAG);
+            rv = neu_json_scan_str(scan, &ws->tag);
+        } else if (neu_json_scan_key_is(key, len, "value")) {
+            SCAN_ONCE(ws->seen, SCAN_VALUE);
+            rv = neu_json_scan_value(scan, &ws->t, &ws->value);
+        } else if (neu_json_scan_key_is(key, len, "tags")) {
+            SCAN_ONCE(ws->seen, SCAN_TAGS);
+            rv = scan_write_tags(scan, &ws->tags, &ws->n_tag);
+        } else if (neu_json_scan_key_is(key, len, "preempt")) {
+            SCAN_ONCE(ws->seen, SCAN_PREEMPT);
+            rv = neu_json_scan_bool(scan, &ws->preempt);
+        } else if (neu_json_scan_key_is(key, len, "verify")) {
+            SCAN_ONCE(ws->seen, SCAN_VERIFY);
+            rv = neu_json_scan_bool(scan, &ws->verify);
+        } else {
+            rv = neu_json_scan_skip(scan);
+        }
+        if (rv != 0) {
+            return -1;
+        }
+    }
+
+    return rv == 0 ? neu_json_scan_end(scan) : -1;
+}
+
+/*
+ * Decode a write request of either form, singular unless it has "tags" like
+ * neu_json_decode_write. The result is freed with neu_json_decode_write_free,
+ * and since the union sits at the start of neu_json_write_t, `&req->single`
+ * and `&req->plural` also go with their own free functions.
+ */
+static int scan_write(const char *buf, size_t len, neu_json_write_t **result)
+{
+    neu_json_scan_t scan = { 0 };
+    write_scan_t    ws   = { 0 };
+    int             rv   = -1;
+    unsigned        need = 0;
+
+    neu_json_scan_init(&scan, buf, len);
+    if (scan_write_members(&scan, &ws) == 0) {
+        need = SCAN_NODE | SCAN_GROUP |
+            (ws.seen & SCAN_TAGS ? SCAN_TAGS : SCAN_TAG | SCAN_VALUE);
+        if ((ws.seen & need) == need &&
+            (!(ws.seen & SCAN_TAGS) || ws.n_tag > 0)) {
+            rv = 0;
+        }
+    }
+
+    neu_json_write_t *req = rv == 0 ? calloc(1, sizeof(*req)) : NULL;
+    if (req != NULL && ws.seen & SCAN_TAGS) {
+        req->singular       = false;
+        req->plural.node    = ws.node;
+        req->plural.group   = ws.group;
+        req->plural.n_tag   = ws.n_tag;
+        req->plural.tags    = ws.tags;
+        req->plural.preempt = ws.preempt;
+        req->plural.verify  = ws.verify;
+        ws.node             = NULL;
+        ws.group            = NULL;
+        ws.n_tag            = 0;
+        ws.tags             = NULL;
+    } else if (req != NULL) {
+        req->singular       = true;
+        req->single.node    = ws.node;
+        req->single.group   = ws.group;
+        req->single.tag     = ws.tag;
+        req->single.t       = ws.t;
+        req->single.value   = ws.value;
+        req->single.preempt = ws.preempt;
+        req->single.verify  = ws.verify;
+        ws.node             = NULL;
+        ws.group            = NULL;
+        ws.tag              = NULL;
+        ws.t                = NEU_JSON_UNDEFINE;
+    }
+
+    free(ws.node);
+    free(ws.group);
+    free(ws.tag);
+    free_json_value(ws.t, &ws.value);
+    free_write_tags(ws.tags, ws.n_tag);
+
+    if (req == NULL) {
+        return -1;
+    }
+    *result = req;
+    return 0;
+}
+
+static int scan_write_gtags_group(neu_json_scan_t *            scan,
+                                  neu_json_write_gtags_elem_t *group)
+{
+    unsigned    seen  = 0;
+    int         index = 0;
+    int         rv    = 0;
+    const char *key   = NULL;
+    size_t      len   = 0;
+
+    if (neu_json_scan_object(scan) != 0) {
+        return -1;
+    }
+    while ((rv = neu_json_scan_key(scan, &index, &key, &len)) > 0) {
+        if (neu_json_scan_key_is(key, len, "group")) {
+            SCAN_ONCE(seen, SCAN_GROUP);
+            rv = neu_json_scan_str(scan, &group->group);
+        } else if (neu_json_scan_key_is(key, len, "tags")) {
+            SCAN_ONCE(seen, SCAN_TAGS);
+            rv = scan_write_tags(scan, &group->tags, &group->n_tag);
+        } else {
+            rv = neu_json_scan_skip(scan);
+        }
+        if (rv != 0) {
+            return -1;
+        }
+    }
+
+    return rv == 0 && seen == (SCAN_GROUP | SCAN_TAGS) ? 0 : -1;
+}
+
+static int scan_write_gtags_groups(neu_json_scan_t *           scan,
+                                   neu_json_write_gtags_req_t *req)
+{
+    int cap   = 0;
+    int index = 0;
+    int rv    = 0;
+
+    if (neu_json_scan_array(scan) != 0) {
+        return -1;
+    }
+    while ((rv = neu_json_scan_elem(scan, &index)) > 0) {
+        if (req->n_group == cap) {
+            neu_json_write_gtags_elem_t *grow = NULL;
+
+            cap  = cap > 0 ? cap * 2 : 4;
+            grow = realloc(req->groups,
+                           cap * sizeof(neu_json_write_gtags_elem_t));
+            if (grow == NULL) {
+                return -1;
+            }
+            req->groups = grow;
+        }
+
+        neu_json_write_gtags_elem_t *group = &req->groups[req->n_group++];
+        memset(group, 0, sizeof(*group));
+        if (scan_write_gtags_group(scan, group) != 0) {
+            return -1;
+        }
+    }
+
+    return rv;
+}
+
+static int scan_write_gtags_members(neu_json_scan_t *           scan,
+                                    neu_json_write_gtags_req_t *req)
+{
+    unsigned    seen  = 0;
+    int         index = 0;
+    int         rv    = 0;
+    const char *key   = NULL;
+    size_t      len   = 0;
+
+    if (neu_json_scan_object(scan) != 0) {
+        return -1;
+    }
+    while ((rv = neu_json_scan_key(scan, &index, &key, &len)) > 0) {
+        if (neu_json_scan_key_is(key, len, "node")) {
+            SCAN_ONCE(seen, SCAN_NODE);
+            rv = neu_json_scan_str(scan, &req->node);
+        } else if (neu_json_scan_key_is(key, len, "groups")) {
+            SCAN_ONCE(seen, SCAN_GROUPS);
+            rv = scan_write_gtags_groups(scan, req);
+        } else if (neu_json_scan_key_is(key, len, "preempt")) {
+            SCAN_ONCE(seen, SCAN_PREEMPT);
+            rv = neu_json_scan_bool(scan, &req->preempt);
+        } else {
+            rv = neu_json_scan_skip(scan);
+        }
+        if (rv != 0) {
+            return -1;
+        }
+    }
+
+    if (rv != 0 || neu_json_scan_end(scan) != 0 ||
+        (seen & (SCAN_NODE | SCAN_GROUPS)) != (SCAN_NODE | SCAN_GROUPS)) {
+        return -1;
+    }
+    return req->n_group > 0 ? 0 : -1;
+}
+
+static int scan_write_gtags(const char *buf, size_t len,
+                            neu_json_write_gtags_req_t **result)
+{
+    neu_json_scan_t scan = { 0 };
+
+    neu_json_write_gtags_req_t *req = calloc(1, sizeof(*req));
+    if (req == NULL) {
+        return -1;
+    }
+
+    neu_json_scan_init(&scan, buf, len);
+    if (scan_write_gtags_members(&scan, req) != 0) {
+        neu_json_decode_write_gtags_req_free(req);
+        return -1;
+    }
+
+    *result = req;
+    return 0;
+}
+
+static int scan_read_query(neu_json_scan_t *scan, neu_json_read_req_t *req)
+{
+    unsigned    seen  = 0;
+    int         index = 0;
+    int         rv    = 0;
+    const char *key   = NULL;
+    size_t      len   = 0;
+
+    if (neu_json_scan_object(scan) != 0) {
+        return -1;
+    }
+    while ((rv = neu_json_scan_key(scan, &index, &key, &len)) > 0) {
+        if (neu_json_scan_key_is(key, len, "name")) {
+            SCAN_ONCE(seen, SCAN_NAME);
+            rv = neu_json_scan_str(scan, &req->name);
+        } else if (neu_json_scan_key_is(key, len, "description")) {
+            SCAN_ONCE(seen, SCAN_DESC);
+            rv = neu_json_scan_str(scan, &req->desc);
+        } else {
+            rv = neu_json_scan_skip(scan);
+        }
+        if (rv != 0) {
+            return -1;
+        }
+    }
+
+    return rv;
+}
+
+static int scan_read_members(neu_json_scan_t *scan, neu_json_read_req_t *req)
+{
+    unsigned    seen    = 0;
+    int         index   = 0;
+    int         rv      = 0;
+    int64_t     max_age = 0;
+    const char *key     = NULL;
+    size_t      len     = 0;
+
+    if (neu_json_scan_object(scan) != 0) {
+        return -1;
+    }
+    while ((rv = neu_json_scan_key(scan, &index, &key, &len)) > 0) {
+        if (neu_json_scan_key_is(key, len, "node")) {
+            SCAN_ONCE(seen, SCAN_NODE);
+            rv = neu_json_scan_str(scan, &req->node);
+        } else if (neu_json_scan_key_is(key, len, "group")) {
+            SCAN_ONCE(seen, SCAN_GROUP);
+            rv = neu_json_scan_str(scan, &req->group);
+        } else if (neu_json_scan_key_is(key, len, "sync")) {
+            SCAN_ONCE(seen, SCAN_SYNC);
+            rv = neu_json_scan_bool(scan, &req->sync);
+        } else if (neu_json_scan_key_is(key, len, "query")) {
+            SCAN_ONCE(seen, SCAN_QUERY);
+            rv = scan_read_query(scan, req);
+        } else if (neu_json_scan_key_is(key, len, "max_age")) {
+            SCAN_ONCE(seen, SCAN_MAX_AGE);
+            rv = neu_json_scan_int(scan, &max_age);
+        } else {
+            rv = neu_json_scan_skip(scan);
+        }
+        if (rv != 0) {
+            return -1;
+        }
+    }
+
+    if (rv != 0 || neu_json_scan_end(scan) != 0 ||
+        (seen & (SCAN_NODE | SCAN_GROUP)) != (SCAN_NODE | SCAN_GROUP) ||
+        max_age < 0 || max_age > UINT32_MAX) {
+        return -1;
+    }
+
+    req->max_age = max_age;
+    return 0;
+}
+
+static int scan_read_req(const char *buf, size_t len,
+                         neu_json_read_req_t **result)
+{
+    neu_json_scan_t scan = { 0 };
+
+    neu_json_read_req_t *req = calloc(1, sizeof(*req));
+    if (req == NULL) {
+        return -1;
+    }
+
+    neu_json_scan_init(&scan, buf, len);
+    if (scan_read_members(&scan, req) != 0) {
+        free(req->node);
+        free(req->group);
+        free(req->name);
+        free(req->desc);
+        free(req);
+        return -1;
+    }
+
+    *result = req;
+    return 0;
+}
 
 int neu_json_encode_read_resp(void *json_object, void *param)
 {
@@ -154,7 +608,23 @@ int neu_json_encode_read_resp1(void *json_object, void *param)
 
 int neu_json_decode_write_req(char *buf, neu_json_write_req_t **result)
 {
-    void *json_obj = neu_json_decode_new(buf);
+    return neu_json_decode_write_reqb(buf, strlen(buf), result);
+}
+
+int neu_json_decode_write_reqb(const char *buf, size_t len,
+                               neu_json_write_req_t **result)
+{
+    neu_json_write_t *req = NULL;
+
+    if (0 == scan_write(buf, len, &req)) {
+        if (req->singular) {
+            *result = &req->single;
+            return 0;
+        }
+        neu_json_decode_write_free(req);
+    }
+
+    void *json_obj = neu_json_decode_newb((char *) buf, len);
     if (NULL == json_obj) {
         return -1;
     }
@@ -185,6 +655,16 @@ int decode_write_req_json(void *json_obj, neu_json_write_req_t *req)
             .name = "value",
             .t    = NEU_JSON_VALUE,
         },
+        {
+            .name      = "preempt",
+            .t         = NEU_JSON_BOOL,
+            .attribute = NEU_JSON_ATTRIBUTE_OPTIONAL,
+        },
+        {
+            .name      = "verify",
+            .t         = NEU_JSON_BOOL,
+            .attribute = NEU_JSON_ATTRIBUTE_OPTIONAL,
+        },
     };
     ret = neu_json_decode_by_json(json_obj, NEU_JSON_ELEM_SIZE(req_elems),
                                   req_elems);
@@ -192,11 +672,13 @@ int decode_write_req_json(void *json_obj, neu_json_write_req_t *req)
         goto error;
     }
 
-    req->node  = req_elems[0].v.val_str;
-    req->group = req_elems[1].v.val_str;
-    req->tag   = req_elems[2].v.val_str;
-    req->t     = req_elems[3].t;
-    req->value = req_elems[3].v;
+    req->node    = req_elems[0].v.val_str;
+    req->group   = req_elems[1].v.val_str;
+    req->tag     = req_elems[2].v.val_str;
+    req->t       = req_elems[3].t;
+    req->value   = req_elems[3].v;
+    req->preempt = req_elems[4].v.val_bool;
+    req->verify  = req_elems[5].v.val_bool;
 
     return ret;
 
@@ -243,7 +725,23 @@ void neu_json_decode_write_req_free(neu_json_write_req_t *req)
 int neu_json_decode_write_tags_req(char *                      buf,
                                    neu_json_write_tags_req_t **result)
 {
-    void *json_obj = neu_json_decode_new(buf);
+    return neu_json_decode_write_tags_reqb(buf, strlen(buf), result);
+}
+
+int neu_json_decode_write_tags_reqb(const char *buf, size_t len,
+                                    neu_json_write_tags_req_t **result)
+{
+    neu_json_write_t *req = NULL;
+
+    if (0 == scan_write(buf, len, &req)) {
+        if (!req->singular) {
+            *result = &req->plural;
+            return 0;
+        }
+        neu_json_decode_write_free(req);
+    }
+
+    void *json_obj = neu_json_decode_newb((char *) buf, len);
     if (NULL == json_obj) {
         return -1;
     }
@@ -271,6 +769,16 @@ static int decode_write_tags_req_json(void *                     json_obj,
             .name = "tags",
             .t    = NEU_JSON_OBJECT,
         },
+        {
+            .name      = "preempt",
+            .t         = NEU_JSON_BOOL,
+            .attribute = NEU_JSON_ATTRIBUTE_OPTIONAL,
+        },
+        {
+            .name      = "verify",
+            .t         = NEU_JSON_BOOL,
+            .attribute = NEU_JSON_ATTRIBUTE_OPTIONAL,
+        },
     };
     ret = neu_json_decode_by_json(json_obj, NEU_JSON_ELEM_SIZE(req_elems),
                                   req_elems);
@@ -278,11 +786,15 @@ static int decode_write_tags_req_json(void *                     json_obj,
         return -1;
     }
 
-    req->node  = req_elems[0].v.val_str;
-    req->group = req_elems[1].v.val_str;
+    req->node    = req_elems[0].v.val_str;
+    req->group   = req_elems[1].v.val_str;
+    req->preempt = req_elems[3].v.val_bool;
+    req->verify  = req_elems[4].v.val_bool;
 
     req->n_tag = neu_json_decode_array_size_by_json(json_obj, "tags");
     if (req->n_tag <= 0) {
+        free(req->node);
+        free(req->group);
         return -1;
     }
 
@@ -363,6 +875,10 @@ void neu_json_decode_write_tags_req_free(neu_json_write_tags_req_t *req)
 
 int neu_json_decode_write(char *buf, neu_json_write_t **result)
 {
+    if (0 == scan_write(buf, strlen(buf), result)) {
+        return 0;
+    }
+
     neu_json_write_t *req = calloc(1, sizeof(*req));
     if (NULL == req) {
         return -1;
@@ -407,6 +923,10 @@ void neu_json_decode_write_free(neu_json_write_t *req)
 
 int neu_json_decode_read_req(char *buf, neu_json_read_req_t **result)
 {
+    if (0 == scan_read_req(buf, strlen(buf), result)) {
+        return 0;
+    }
+
     int                  ret      = 0;
     void *               json_obj = NULL;
     neu_json_read_req_t *req      = calloc(1, sizeof(neu_json_read_req_t));
@@ -435,17 +955,12 @@ int neu_json_decode_read_req(char *buf, neu_json_read_req_t **result)
             .t         = NEU_JSON_OBJECT,
             .attribute = NEU_JSON_ATTRIBUTE_OPTIONAL,
         },
+        {
+            .name      = "max_age",
+            .t         = NEU_JSON_INT,
+            .attribute = NEU_JSON_ATTRIBUTE_OPTIONAL,
+        },
     };
-    ret = neu_json_decode_by_json(json_obj, NEU_JSON_ELEM_SIZE(req_elems),
-                                  req_elems);
-    if (ret != 0) {
-        goto error;
-    }
-
-    req->node  = req_elems[0].v.val_str;
-    req->group = req_elems[1].v.val_str;
-    req->sync  = req_elems[2].v.val_bool;
-
     neu_json_elem_t query_elems[] = {
         {
             .name      = "name",
@@ -458,6 +973,22 @@ int neu_json_decode_read_req(char *buf, neu_json_read_req_t **result)
             .attribute = NEU_JSON_ATTRIBUTE_OPTIONAL,
         },
     };
+    ret = neu_json_decode_by_json(json_obj, NEU_JSON_ELEM_SIZE(req_elems),
+                                  req_elems);
+    if (ret != 0) {
+        goto error;
+    }
+
+    req->node  = req_elems[0].v.val_str;
+    req->group = req_elems[1].v.val_str;
+    req->sync  = req_elems[2].v.val_bool;
+
+    if (req_elems[4].v.val_int < 0 || req_elems[4].v.val_int > UINT32_MAX) {
+        ret = -1;
+        goto error;
+    }
+    req->max_age = req_elems[4].v.val_int;
+
     if (req_elems[3].v.val_object) {
         ret = neu_json_decode_by_json(req_elems[3].v.val_object,
                                       NEU_JSON_ELEM_SIZE(query_elems),
@@ -493,6 +1024,185 @@ void neu_json_decode_read_req_free(neu_json_read_req_t *req)
     free(req);
 }
 
+static int decode_read_batch_elem(void *json_obj, int index,
+                                  neu_json_read_req_t *req)
+{
+    int ret = 0;
+
+    neu_json_elem_t req_elems[] = {
+        {
+            .name = "node",
+            .t    = NEU_JSON_STR,
+        },
+        {
+            .name = "group",
+            .t    = NEU_JSON_STR,
+        },
+        {
+            .name      = "query",
+            .t         = NEU_JSON_OBJECT,
+            .attribute = NEU_JSON_ATTRIBUTE_OPTIONAL,
+        },
+    };
+    ret = neu_json_decode_array_by_json(json_obj, "groups", index,
+                                        NEU_JSON_ELEM_SIZE(req_elems),
+                                        req_elems);
+    req->node  = req_elems[0].v.val_str;
+    req->group = req_elems[1].v.val_str;
+    if (ret != 0 || req_elems[2].v.val_object == NULL) {
+        return ret;
+    }
+
+    neu_json_elem_t query_elems[] = {
+        {
+            .name      = "name",
+            .t         = NEU_JSON_STR,
+            .attribute = NEU_JSON_ATTRIBUTE_OPTIONAL,
+        },
+        {
+            .name      = "description",
+            .t         = NEU_JSON_STR,
+            .attribute = NEU_JSON_ATTRIBUTE_OPTIONAL,
+        },
+    };
+    ret = neu_json_decode_by_json(req_elems[2].v.val_object,
+                                  NEU_JSON_ELEM_SIZE(query_elems),
+                                  query_elems);
+    req->name = query_elems[0].v.val_str;
+    req->desc = query_elems[1].v.val_str;
+
+    return ret;
+}
+
+int neu_json_decode_read_batch_req(char *                      buf,
+                                   neu_json_read_batch_req_t **result)
+{
+    int                        ret      = 0;
+    void *                     json_obj = NULL;
+    neu_json_read_batch_req_t *req =
+        calloc(1, sizeof(neu_json_read_batch_req_t));
+    if (req == NULL) {
+        return -1;
+    }
+
+    json_obj = neu_json_decode_new(buf);
+    if (json_obj == NULL) {
+        free(req);
+        return -1;
+    }
+
+    neu_json_elem_t req_elems[] = {
+        {
+            .name      = "sync",
+            .t         = NEU_JSON_BOOL,
+            .attribute = NEU_JSON_ATTRIBUTE_OPTIONAL,
+        },
+        {
+            .name = "groups",
+            .t    = NEU_JSON_OBJECT,
+        },
+        {
+            .name      = "max_age",
+            .t         = NEU_JSON_INT,
+            .attribute = NEU_JSON_ATTRIBUTE_OPTIONAL,
+        },
+    };
+    ret = neu_json_decode_by_json(json_obj, NEU_JSON_ELEM_SIZE(req_elems),
+                                  req_elems);
+    if (ret != 0) {
+        goto error;
+    }
+
+    req->sync = req_elems[0].v.val_bool;
+
+    if (req_elems[2].v.val_int < 0 || req_elems[2].v.val_int > UINT32_MAX) {
+        ret = -1;
+        goto error;
+    }
+    req->max_age = req_elems[2].v.val_int;
+
+    int n_group = neu_json_decode_array_size_by_json(json_obj, "groups");
+    if (n_group <= 0) {
+        ret = -1;
+        goto error;
+    }
+
+    req->groups = calloc(n_group, sizeof(neu_json_read_req_t));
+    if (req->groups == NULL) {
+        ret = -1;
+        goto error;
+    }
+
+    for (int i = 0; i < n_group; i++) {
+        req->n_group += 1;
+        req->groups[i].sync    = req->sync;
+        req->groups[i].max_age = req->max_age;
+
+        ret = decode_read_batch_elem(json_obj, i, &req->groups[i]);
+        if (ret != 0) {
+            goto error;
+        }
+    }
+
+    *result = req;
+    neu_json_decode_free(json_obj);
+    return ret;
+
+error:
+    neu_json_decode_read_batch_req_free(req);
+    neu_json_decode_free(json_obj);
+    return ret;
+}
+
+void neu_json_decode_read_batch_req_free(neu_json_read_batch_req_t *req)
+{
+    for (int i = 0; i < req->n_group; i++) {
+        free(req->groups[i].node);
+        free(req->groups[i].group);
+        free(req->groups[i].name);
+        free(req->groups[i].desc);
+    }
+    free(req->groups);
+
+    free(req);
+}
+
+int neu_json_encode_read_batch_group(void *json_object, void *param)
+{
+    int                          ret   = 0;
+    neu_json_read_batch_group_t *group = (neu_json_read_batch_group_t *) param;
+
+    neu_json_elem_t group_elems[] = {
+        {
+            .name      = "node",
+            .t         = NEU_JSON_STR,
+            .v.val_str = group->node,
+        },
+        {
+            .name      = "group",
+            .t         = NEU_JSON_STR,
+            .v.val_str = group->group,
+        },
+        {
+            .name      = "error",
+            .t         = NEU_JSON_INT,
+            .v.val_int = group->error,
+        },
+    };
+
+    if (group->resp != NULL) {
+        ret = neu_json_encode_field(json_object, group_elems, 2);
+        if (ret == 0) {
+            ret = neu_json_encode_read_resp(json_object, group->resp);
+        }
+    } else {
+        ret = neu_json_encode_field(json_object, group_elems,
+                                    NEU_JSON_ELEM_SIZE(group_elems));
+    }
+
+    return ret;
+}
+
 int neu_json_encode_read_periodic_resp(void *json_object, void *param)
 {
     int                       ret  = 0;
@@ -594,7 +1304,17 @@ void neu_json_metas_to_json(neu_tag_meta_t *metas, int n_meta,
 int neu_json_decode_write_gtags_req(char *                       buf,
                                     neu_json_write_gtags_req_t **result)
 {
-    void *json_obj = neu_json_decode_new(buf);
+    return neu_json_decode_write_gtags_reqb(buf, strlen(buf), result);
+}
+
+int neu_json_decode_write_gtags_reqb(const char *buf, size_t len,
+                                     neu_json_write_gtags_req_t **result)
+{
+    if (0 == scan_write_gtags(buf, len, result)) {
+        return 0;
+    }
+
+    void *json_obj = neu_json_decode_newb((char *) buf, len);
     if (NULL == json_obj) {
         return -1;
     }
@@ -620,6 +1340,11 @@ static int decode_write_gtags_req_json(void *                      json_obj,
             .name = "groups",
             .t    = NEU_JSON_OBJECT,
         },
+        {
+            .name      = "preempt",
+            .t         = NEU_JSON_BOOL,
+            .attribute = NEU_JSON_ATTRIBUTE_OPTIONAL,
+        },
     };
     ret = neu_json_decode_by_json(json_obj, NEU_JSON_ELEM_SIZE(req_elems),
                                   req_elems);
@@ -627,7 +1352,8 @@ static int decode_write_gtags_req_json(void *                      json_obj,
         return -1;
     }
 
-    req->node = req_elems[0].v.val_str;
+    req->node    = req_elems[0].v.val_str;
+    req->preempt = req_elems[2].v.val_bool;
 
     req->n_group = neu_json_decode_array_size_by_json(json_obj, "groups");
     if (req->n_group <= 0) {
@@ -709,7 +1435,7 @@ int neu_json_decode_write_gtags_req_json(void *                       json_obj,
     return ret;
 }
 
-void neu_json_decode_write_gtags_req_free(neu_json_write_gtags_req_t *req)
+static void write_gtags_req_fini(neu_json_write_gtags_req_t *req)
 {
     free(req->node);
 
@@ -733,5 +1459,225 @@ void neu_json_decode_write_gtags_req_free(neu_json_write_gtags_req_t *req)
     }
 
     free(req->groups);
+}
+
+void neu_json_decode_write_gtags_req_free(neu_json_write_gtags_req_t *req)
+{
+    write_gtags_req_fini(req);
     free(req);
 }
+
+int neu_json_decode_write_batch_req(char *                       buf,
+                                    neu_json_write_batch_req_t **result)
+{
+    int                         ret      = 0;
+    void *                      json_obj = NULL;
+    void *                      nodes    = NULL;
+    neu_json_write_batch_req_t *req =
+        calloc(1, sizeof(neu_json_write_batch_req_t));
+    if (req == NULL) {
+        return -1;
+    }
+
+    json_obj = neu_json_decode_new(buf);
+    if (json_obj == NULL) {
+        free(req);
+        return -1;
+    }
+
+    neu_json_elem_t req_elems[] = {
+        {
+            .name = "nodes",
+            .t    = NEU_JSON_OBJECT,
+        },
+        {
+            .name      = "preempt",
+            .t         = NEU_JSON_BOOL,
+            .attribute = NEU_JSON_ATTRIBUTE_OPTIONAL,
+        },
+    };
+    ret = neu_json_decode_by_json(json_obj, NEU_JSON_ELEM_SIZE(req_elems),
+                                  req_elems);
+    if (ret != 0) {
+        goto error;
+    }
+
+    nodes        = req_elems[0].v.val_object;
+    req->preempt = req_elems[1].v.val_bool;
+
+    int n_node = json_array_size(nodes);
+    if (n_node <= 0) {
+        ret = -1;
+        goto error;
+    }
+
+    req->nodes = calloc(n_node, sizeof(neu_json_write_gtags_req_t));
+    if (req->nodes == NULL) {
+        ret = -1;
+        goto error;
+    }
+
+    for (int i = 0; i < n_node; i++) {
+        ret = decode_write_gtags_req_json(json_array_get(nodes, i),
+                                          &req->nodes[i]);
+        if (ret != 0) {
+            // the groups of a failed node are released by the decoder
+            free(req->nodes[i].node);
+            goto error;
+        }
+
+        req->nodes[i].preempt |= req->preempt;
+        req->n_node += 1;
+    }
+
+    *result = req;
+    neu_json_decode_free(json_obj);
+    return ret;
+
+error:
+    neu_json_decode_write_batch_req_free(req);
+    neu_json_decode_free(json_obj);
+    return ret;
+}
+
+void neu_json_decode_write_batch_req_free(neu_json_write_batch_req_t *req)
+{
+    for (int i = 0; i < req->n_node; i++) {
+        write_gtags_req_fini(&req->nodes[i]);
+    }
+    free(req->nodes);
+
+    free(req);
+}
+
+int neu_json_encode_write_batch_resp(void *json_object, void *param)
+{
+    int                          ret  = 0;
+    neu_json_write_batch_resp_t *resp = (neu_json_write_batch_resp_t *) param;
+
+    void *node_array = neu_json_array();
+    if (NULL == node_array) {
+        return -1;
+    }
+
+    for (int i = 0; i < resp->n_node; i++) {
+        neu_json_elem_t node_elems[] = {
+            {
+                .name      = "node",
+                .t         = NEU_JSON_STR,
+                .v.val_str = resp->nodes[i].node,
+            },
+            {
+                .name      = "error",
+                .t         = NEU_JSON_INT,
+                .v.val_int = resp->nodes[i].error,
+            },
+        };
+
+        node_array = neu_json_encode_array(node_array, node_elems,
+                                           NEU_JSON_ELEM_SIZE(node_elems));
+    }
+
+    neu_json_elem_t resp_elems[] = {
+        {
+            .name      = "error",
+            .t         = NEU_JSON_INT,
+            .v.val_int = resp->error,
+        },
+        {
+            .name         = "nodes",
+            .t            = NEU_JSON_OBJECT,
+            .v.val_object = node_array,
+        },
+    };
+    ret = neu_json_encode_field(json_object, resp_elems,
+                                NEU_JSON_ELEM_SIZE(resp_elems));
+
+    return ret;
+}
+
+int neu_json_encode_tag_history_resp(void *json_object, void *param)
+{
+    int                          ret  = 0;
+    neu_json_tag_history_resp_t *resp = (neu_json_tag_history_resp_t *) param;
+
+    void *point_array = neu_json_array();
+    if (NULL == point_array) {
+        return -1;
+    }
+
+    for (int i = 0; i < resp->n_point; i++) {
+        neu_json_tag_history_point_t *p = &resp->points[i];
+
+        if (resp->downsampled) {
+            neu_json_elem_t point_elems[] = {
+                {
+                    .name      = "timestamp",
+                    .t         = NEU_JSON_INT,
+                    .v.val_int = p->timestamp,
+                },
+                {
+                    .name      = "count",
+                    .t         = NEU_JSON_INT,
+                    .v.val_int = p->count,
+                },
+                {
+                    .name         = "min",
+                    .t            = NEU_JSON_DOUBLE,
+                    .v.val_double = p->min,
+                },
+                {
+                    .name         = "max",
+                    .t            = NEU_JSON_DOUBLE,
+                    .v.val_double = p->max,
+                },
+                {
+                    .name         = "avg",
+                    .t            = NEU_JSON_DOUBLE,
+                    .v.val_double = p->avg,
+                },
+                {
+                    .name         = "last",
+                    .t            = NEU_JSON_DOUBLE,
+                    .v.val_double = p->last,
+                },
+            };
+
+            point_array = neu_json_encode_array(
+                point_array, point_elems, NEU_JSON_ELEM_SIZE(point_elems));
+        } else {
+            neu_json_elem_t point_elems[] = {
+                {
+                    .name      = "timestamp",
+                    .t         = NEU_JSON_INT,
+                    .v.val_int = p->timestamp,
+                },
+                {
+                    .name         = "value",
+                    .t            = NEU_JSON_DOUBLE,
+                    .v.val_double = p->last,
+                },
+            };
+
+            point_array = neu_json_encode_array(
+                point_array, point_elems, NEU_JSON_ELEM_SIZE(point_elems));
+        }
+    }
+
+    neu_json_elem_t resp_elems[] = {
+        {
+            .name         = "points",
+            .t            = NEU_JSON_OBJECT,
+            .v.val_object = point_array,
+        },
+        {
+            .name       = "truncated",
+            .t          = NEU_JSON_BOOL,
+            .v.val_bool = resp->truncated,
+        },
+    };
+    ret = neu_json_encode_field(json_object, resp_elems,
+                                NEU_JSON_ELEM_SIZE(resp_elems));
+
+    return ret;
+}
@@ -0,0 +1,583 @@
+/**
+ * NEURON IIoT System for Industry 4.0
+ * Copyright (C) 2020-2023 EMQ Technologies Co., Ltd All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ **/
+
+#include <errno.h>
+#include <math.h>
+#include <stdlib.h>
+
+#include "json/neu_json_scan.h"
+
+// deeper documents are left to jansson
+#define SCAN_MAX_DEPTH 32
+// longest number literal handled here
+#define SCAN_MAX_NUMBER 64
+// neu_json_value_bytes_t keeps the length in a uint8_t
+#define SCAN_MAX_BYTES UINT8_MAX
+
+static inline void skip_ws(neu_json_scan_t *scan)
+{
+    while (scan->cur < scan->end &&
+           (*scan->cur == ' ' || *scan->cur == '\t' || *scan->cur == '\n' ||
+            *scan->cur == '\r')) {
+        scan->cur++;
+    }
+}
+
+static inline bool is_digit(const char *p, const char *end)
+{
+    return p < end && *p >= '0' && *p <= '9';
+}
+
+static int hex4(const unsigned char *p)
+{
+    int val = 0;
+
+    for (int i = 0; i < 4; i++) {
+        int c = p[i];
+
+        if (c >= '0' && c <= '9') {
+            c -= '0';
+        } else if (c >= 'a' && c <= 'f') {
+            c -= 'a' - 10;
+        } else if (c >= 'A' && c <= 'F') {
+            c -= 'A' - 10;
+        } else {
+            return -1;
+        }
+        val = val << 4 | c;
+    }
+
+    return val;
+}
+
+// length of the well formed UTF-8 sequence at p, 0 if there is none
+static size_t utf8_len(const unsigned char *p, const unsigned char *end)
+{
+    size_t   len = 0;
+    uint32_t cp  = 0;
+
+    if (p[0] >= 0xc2 && p[0] <= 0xdf) {
+        len = 2;
+        cp  = p[0] & 0x1f;
+    } else if (p[0] >= 0xe0 && p[0] <= 0xef) {
+        len = 3;
+        cp  = p[0] & 0x0f;
+    } else if (p[0] >= 0xf0 && p[0] <= 0xf4) {
+        len = 4;
+        cp  = p[0] & 0x07;
+    } else {
+        return 0;
+    }
+
+    if ((size_t)(end - p) < len) {
+        return 0;
+    }
+    for (size_t i = 1; i < len; i++) {
+        if ((p[i] & 0xc0) != 0x80) {
+            return 0;
+        }
+        cp = cp << 6 | (p[i] & 0x3f);
+    }
+
+    // overlong forms, surrogates and code points past U+10FFFF
+    if ((len == 3 && cp < 0x800) || (len == 4 && cp < 0x10000) ||
+        (cp >= 0xd800 && cp <= 0xdfff) || cp > 0x10ffff) {
+        return 0;
+    }
+
+    return len;
+}
+
+static size_t utf8_put(char *dst, uint32_t cp)
+{
+    if (cp < 0x80) {
+        dst[0] = (char) cp;
+        return 1;
+    } else if (cp < 0x800) {
+        dst[0] = (char) (0xc0 | cp >> 6);
+        dst[1] = (char) (0x80 | (cp & 0x3f));
+        return 2;
+    } else if (cp < 0x10000) {
+        dst[0] = (char) (0xe0 | cp >> 12);
+        dst[1] = (char) (0x80 | (cp >> 6 & 0x3f));
+        dst[2] = (char) (0x80 | (cp & 0x3f));
+        return 3;
+    } else {
+        dst[0] = (char) (0xf0 | cp >> 18);
+        dst[1] = (char) (0x80 | (cp >> 12 & 0x3f));
+        dst[2] = (char) (0x80 | (cp >> 6 & 0x3f));
+        dst[3] = (char) (0x80 | (cp & 0x3f));
+        return 4;
+    }
+}
+
+/*
+ * Scan a string literal. The decoded string is never longer than the raw
+ * one, so a single allocation of the raw length is enough. With a NULL `out`
+ * the string is only validated.
+ */
+static int scan_string(neu_json_scan_t *scan, char **out)
+{
+    const unsigned char *p   = (const unsigned char *) scan->cur;
+    const unsigned char *end = (const unsigned char *) scan->end;
+    const unsigned char *start;
+    char *               dst = NULL;
+    size_t               n   = 0;
+
+    if (p >= end || *p != '"') {
+        return -1;
+    }
+
+    start = ++p;
+    while (p < end && *p != '"') {
+        if (*p == '\\' && ++p == end) {
+            return -1;
+        }
+        p++;
+    }
+    if (p == end) {
+        return -1;
+    }
+    end = p;
+
+    if (out != NULL) {
+        dst = malloc(end - start + 1);
+        if (dst == NULL) {
+            return -1;
+        }
+    }
+
+    for (p = start; p < end;) {
+        char     buf[4];
+        size_t   len = 0;
+        uint32_t cp  = 0;
+
+        if (*p >= 0x80) {
+            len = utf8_len(p, end);
+            if (len == 0) {
+                goto error;
+            }
+            if (dst != NULL) {
+                memcpy(dst + n, p, len);
+            }
+            p += len;
+            n += len;
+            continue;
+        }
+
+        if (*p < 0x20) {
+            goto error;
+        }
+        if (*p != '\\') {
+            if (dst != NULL) {
+                dst[n] = *p;
+            }
+            p++;
+            n++;
+            continue;
+        }
+
+        switch (p[1]) {
+        case '"':
+        case '\\':
+        case '/':
+            cp = p[1];
+            break;
+        case 'b':
+            cp = '\b';
+            break;
+        case 'f':
+            cp = '\f';
+            break;
+        case 'n':
+            cp = '\n';
+            break;
+        case 'r':
+            cp = '\r';
+            break;
+        case 't':
+            cp = '\t';
+            break;
+        case 'u': {
+            int hi = end - p >= 6 ? hex4(p + 2) : -1;
+
+            if (hi <= 0 || (hi >= 0xdc00 && hi <= 0xdfff)) {
+                goto error;
+            }
+            if (hi >= 0xd800 && hi <= 0xdbff) {
+                int lo = end - p >= 12 && p[6] == '\\' && p[7] == 'u'
+                    ? hex4(p + 8)
+                    : -1;
+
+                if (lo < 0xdc00 || lo > 0xdfff) {
+                    goto error;
+                }
+                cp = 0x10000 + ((hi - 0xd800) << 10) + (lo - 0xdc00);
+                p += 6;
+            } else {
+                cp = hi;
+            }
+            p += 4;
+            break;
+        }
+        default:
+            goto error;
+        }
+        p += 2;
+
+        len = utf8_put(buf, cp);
+        if (dst != NULL) {
+            memcpy(dst + n, buf, len);
+        }
+        n += len;
+    }
+
+    if (dst != NULL) {
+        dst[n] = '\0';
+        *out   = dst;
+    }
+    scan->cur = (const char *) end + 1;
+    return 0;
+
+error:
+    free(dst);
+    return -1;
+}
+
+static int scan_number(neu_json_scan_t *scan, bool *real, int64_t *i,
+                       double *d)
+{
+    const char *p = scan->cur;
+    char        buf[SCAN_MAX_NUMBER];
+    size_t      len = 0;
+
+    *real = false;
+    if (p < scan->end && *p == '-') {
+        p++;
+    }
+    if (!is_digit(p, scan->end)) {
+        return -1;
+    }
+    if (*p++ != '0') {
+        while (is_digit(p, scan->end)) {
+            p++;
+        }
+    }
+    if (p < scan->end && *p == '.') {
+        *real = true;
+        if (!is_digit(++p, scan->end)) {
+            return -1;
+        }
+        while (is_digit(p, scan->end)) {
+            p++;
+        }
+    }
+    if (p < scan->end && (*p == 'e' || *p == 'E')) {
+        *real = true;
+        p++;
+        if (p < scan->end && (*p == '+' || *p == '-')) {
+            p++;
+        }
+        if (!is_digit(p, scan->end)) {
+            return -1;
+        }
+        while (is_digit(p, scan->end)) {
+            p++;
+        }
+    }
+
+    len = p - scan->cur;
+    if (len >= sizeof(buf)) {
+        return -1;
+    }
+    memcpy(buf, scan->cur, len);
+    buf[len] = '\0';
+
+    // out of range numbers are errors in jansson, let it report them
+    errno = 0;
+    if (*real) {
+        *d = strtod(buf, NULL);
+        if (errno == ERANGE && (*d == HUGE_VAL || *d == -HUGE_VAL)) {
+            return -1;
+        }
+    } else {
+        *i = strtoll(buf, NULL, 10);
+        if (errno == ERANGE) {
+            return -1;
+        }
+    }
+
+    scan->cur = p;
+    return 0;
+}
+
+static int scan_literal(neu_json_scan_t *scan, const char *literal)
+{
+    size_t len = strlen(literal);
+
+    if ((size_t)(scan->end - scan->cur) < len ||
+        memcmp(scan->cur, literal, len) != 0) {
+        return -1;
+    }
+
+    scan->cur += len;
+    return 0;
+}
+
+void neu_json_scan_init(neu_json_scan_t *scan, const char *buf, size_t len)
+{
+    scan->cur   = buf;
+    scan->end   = buf + len;
+    scan->depth = 0;
+}
+
+static int scan_open(neu_json_scan_t *scan, char c)
+{
+    skip_ws(scan);
+    if (scan->cur >= scan->end || *scan->cur != c ||
+        scan->depth >= SCAN_MAX_DEPTH) {
+        return -1;
+    }
+
+    scan->cur++;
+    scan->depth++;
+    return 0;
+}
+
+// 1 if another member follows, 0 after the closing character
+static int scan_next(neu_json_scan_t *scan, int *index, char close)
+{
+    skip_ws(scan);
+    if (scan->cur >= scan->end) {
+        return -1;
+    }
+
+    if (*scan->cur == close) {
+        scan->cur++;
+        scan->depth--;
+        return 0;
+    }
+
+    if (*index > 0) {
+        if (*scan->cur != ',') {
+            return -1;
+        }
+        scan->cur++;
+        skip_ws(scan);
+    }
+
+    *index += 1;
+    return 1;
+}
+
+int neu_json_scan_object(neu_json_scan_t *scan)
+{
+    return scan_open(scan, '{');
+}
+
+int neu_json_scan_key(neu_json_scan_t *scan, int *index, const char **key,
+                      size_t *len)
+{
+    int rv = scan_next(scan, index, '}');
+    if (rv <= 0) {
+        return rv;
+    }
+
+    const char *start = scan->cur + 1;
+    if (scan_string(scan, NULL) != 0) {
+        return -1;
+    }
+
+    // escaped keys would need decoding to compare
+    *key = start;
+    *len = scan->cur - 1 - start;
+    if (memchr(*key, '\\', *len) != NULL) {
+        return -1;
+    }
+
+    skip_ws(scan);
+    if (scan->cur >= scan->end || *scan->cur != ':') {
+        return -1;
+    }
+    scan->cur++;
+    skip_ws(scan);
+    return 1;
+}
+
+int neu_json_scan_array(neu_json_scan_t *scan)
+{
+    return scan_open(scan, '[');
+}
+
+int neu_json_scan_elem(neu_json_scan_t *scan, int *index)
+{
+    return scan_next(scan, index, ']');
+}
+
+int neu_json_scan_str(neu_json_scan_t *scan, char **str)
+{
+    skip_ws(scan);
+    return scan_string(scan, str);
+}
+
+int neu_json_scan_bool(neu_json_scan_t *scan, bool *val)
+{
+    skip_ws(scan);
+    if (scan_literal(scan, "true") == 0) {
+        *val = true;
+        return 0;
+    }
+    if (scan_literal(scan, "false") == 0) {
+        *val = false;
+        return 0;
+    }
+    return -1;
+}
+
+int neu_json_scan_int(neu_json_scan_t *scan, int64_t *val)
+{
+    bool   real = false;
+    double d    = 0;
+
+    skip_ws(scan);
+    if (scan_number(scan, &real, val, &d) != 0 || real) {
+        return -1;
+    }
+    return 0;
+}
+
+static int scan_bytes(neu_json_scan_t *scan, neu_json_value_bytes_t *bytes)
+{
+    uint8_t buf[SCAN_MAX_BYTES];
+    int     index = 0;
+    int     rv    = 0;
+
+    if (neu_json_scan_array(scan) != 0) {
+        return -1;
+    }
+    while ((rv = neu_json_scan_elem(scan, &index)) > 0) {
+        int64_t val = 0;
+
+        if (index > SCAN_MAX_BYTES || neu_json_scan_int(scan, &val) != 0) {
+            return -1;
+        }
+        buf[index - 1] = (uint8_t) val;
+    }
+    if (rv < 0) {
+        return -1;
+    }
+
+    bytes->length = index;
+    bytes->bytes  = NULL;
+    if (index > 0) {
+        bytes->bytes = malloc(index);
+        if (bytes->bytes == NULL) {
+            return -1;
+        }
+        memcpy(bytes->bytes, buf, index);
+    }
+    return 0;
+}
+
+int neu_json_scan_value(neu_json_scan_t *scan, enum neu_json_type *t,
+                        union neu_json_value *val)
+{
+    bool real = false;
+
+    skip_ws(scan);
+    if (scan->cur >= scan->end) {
+        return -1;
+    }
+
+    switch (*scan->cur) {
+    case '"':
+        *t = NEU_JSON_STR;
+        return scan_string(scan, &val->val_str);
+    case 't':
+    case 'f':
+        *t = NEU_JSON_BOOL;
+        return neu_json_scan_bool(scan, &val->val_bool);
+    case '[':
+        *t = NEU_JSON_BYTES;
+        return scan_bytes(scan, &val->val_bytes);
+    default:
+        if (scan_number(scan, &real, &val->val_int, &val->val_double) != 0) {
+            return -1;
+        }
+        *t = real ? NEU_JSON_DOUBLE : NEU_JSON_INT;
+        return 0;
+    }
+}
+
+int neu_json_scan_skip(neu_json_scan_t *scan)
+{
+    int     index = 0;
+    int     rv    = 0;
+    bool    real  = false;
+    int64_t i     = 0;
+    double  d     = 0;
+
+    skip_ws(scan);
+    if (scan->cur >= scan->end) {
+        return -1;
+    }
+
+    switch (*scan->cur) {
+    case '"':
+        return scan_string(scan, NULL);
+    case 't':
+        return scan_literal(scan, "true");
+    case 'f':
+        return scan_literal(scan, "false");
+    case 'n':
+        return scan_literal(scan, "null");
+    case '[':
+        if (neu_json_scan_array(scan) != 0) {
+            return -1;
+        }
+        while ((rv = neu_json_scan_elem(scan, &index)) > 0) {
+            if (neu_json_scan_skip(scan) != 0) {
+                return -1;
+            }
+        }
+        return rv;
+    case '{': {
+        const char *key = NULL;
+        size_t      len = 0;
+
+        if (neu_json_scan_object(scan) != 0) {
+            return -1;
+        }
+        while ((rv = neu_json_scan_key(scan, &index, &key, &len)) > 0) {
+            if (neu_json_scan_skip(scan) != 0) {
+                return -1;
+            }
+        }
+        return rv;
+    }
+    default:
+        return scan_number(scan, &real, &i, &d);
+    }
+}
+
+int neu_json_scan_end(neu_json_scan_t *scan)
+{
+    skip_ws(scan);
+    return scan->cur == scan->end ? 0 : -1;
+}
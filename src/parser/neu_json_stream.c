@@ -0,0 +1,512 @@
+/**
+ * NEURON IIoT System for Industry 4.0
+ * Copyright (C) 2020-2023 EMQ Technologies Co., Ltd All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ **/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "msg.h"
+#include "utils/utextend.h"
+
+#include "json/neu_json_stream.h"
+
+// a member is written in place and cut off again if its key or value turns
+// out to be something jansson refuses to hold, an invalid UTF-8 string or a
+// non finite real, so that such members are left out just like json_dumps
+// leaves them out
+#define STREAM_INVALID 1
+
+static const char digits[] = "00010203040506070809"
+                             "10111213141516171819"
+                             "20212223242526272829"
+                             "30313233343536373839"
+                             "40414243444546474849"
+                             "50515253545556575859"
+                             "60616263646566676869"
+                             "70717273747576777879"
+                             "80818283848586878889"
+                             "90919293949596979899";
+
+static int reserve(neu_json_stream_t *stream, size_t n)
+{
+    if (stream->len + n + 1 <= stream->cap) {
+        return 0;
+    }
+
+    size_t cap = stream->cap > 0 ? stream->cap : 1024;
+    while (cap < stream->len + n + 1) {
+        cap *= 2;
+    }
+
+    char *buf = realloc(stream->buf, cap);
+    if (NULL == buf) {
+        return -1;
+    }
+    stream->buf = buf;
+    stream->cap = cap;
+    return 0;
+}
+
+static inline int put(neu_json_stream_t *stream, const char *s, size_t n)
+{
+    if (reserve(stream, n) != 0) {
+        return -1;
+    }
+    memcpy(stream->buf + stream->len, s, n);
+    stream->len += n;
+    stream->buf[stream->len] = '\0';
+    return 0;
+}
+
+#define PUT_LITERAL(stream, s) put(stream, s, sizeof(s) - 1)
+
+static int put_int(neu_json_stream_t *stream, int64_t value)
+{
+    char     tmp[24];
+    char *   p = tmp + sizeof(tmp);
+    uint64_t u = value < 0 ? -(uint64_t) value : (uint64_t) value;
+
+    while (u >= 100) {
+        p -= 2;
+        memcpy(p, &digits[(u % 100) * 2], 2);
+        u /= 100;
+    }
+    if (u >= 10) {
+        p -= 2;
+        memcpy(p, &digits[u * 2], 2);
+    } else {
+        *--p = '0' + u;
+    }
+    if (value < 0) {
+        *--p = '-';
+    }
+
+    return put(stream, p, tmp + sizeof(tmp) - p);
+}
+
+// a precision prints that many decimals, otherwise 16 significant digits
+// are printed and tidied up the way jansson's jsonp_dtostr does
+static int put_real(neu_json_stream_t *stream, double value, uint8_t precision)
+{
+    char   tmp[640];
+    int    n     = 0;
+    char * e     = NULL;
+    char * start = NULL;
+    char * end   = NULL;
+    size_t len   = 0;
+
+    if (!isfinite(value)) {
+        return STREAM_INVALID;
+    }
+
+    if (precision > 0) {
+        n = snprintf(tmp, sizeof(tmp), "%.*f", precision, value);
+        return n > 0 && (size_t) n < sizeof(tmp) ? put(stream, tmp, n) : -1;
+    }
+
+    n = snprintf(tmp, sizeof(tmp), "%.16g", value);
+    if (n <= 0 || (size_t) n >= sizeof(tmp) - 2) {
+        return -1;
+    }
+    len = n;
+
+    if (strchr(tmp, '.') == NULL && strchr(tmp, 'e') == NULL) {
+        tmp[len++] = '.';
+        tmp[len++] = '0';
+        tmp[len]   = '\0';
+    }
+
+    // drop the '+' and the leading zeros of the exponent
+    e = strchr(tmp, 'e');
+    if (e != NULL) {
+        start = e + 1;
+        end   = start + 1;
+        if (*start == '-') {
+            start++;
+        }
+        while (*end == '0') {
+            end++;
+        }
+        if (end != start) {
+            memmove(start, end, len - (end - tmp) + 1);
+            len -= end - start;
+        }
+    }
+
+    return put(stream, tmp, len);
+}
+
+// escape as json_dumps without flags does, UTF-8 is validated and kept as is
+static int put_str(neu_json_stream_t *stream, const char *str)
+{
+    const uint8_t *p   = (const uint8_t *) str;
+    const uint8_t *run = p;
+    char           esc[8];
+
+    if (NULL == str) {
+        return STREAM_INVALID;
+    }
+
+    if (PUT_LITERAL(stream, "\"") != 0) {
+        return -1;
+    }
+
+    while (*p != '\0') {
+        if (*p >= 0x80) {
+            uint32_t cp = 0;
+            int      n  = 0;
+
+            if (*p >= 0xc2 && *p <= 0xdf) {
+                n  = 1;
+                cp = *p & 0x1f;
+            } else if ((*p & 0xf0) == 0xe0) {
+                n  = 2;
+                cp = *p & 0x0f;
+            } else if (*p >= 0xf0 && *p <= 0xf4) {
+                n  = 3;
+                cp = *p & 0x07;
+            } else {
+                return STREAM_INVALID;
+            }
+            for (int i = 1; i <= n; i++) {
+                if ((p[i] & 0xc0) != 0x80) {
+                    return STREAM_INVALID;
+                }
+                cp = (cp << 6) | (p[i] & 0x3f);
+            }
+            if ((n == 2 && (cp < 0x800 || (cp >= 0xd800 && cp <= 0xdfff))) ||
+                (n == 3 && (cp < 0x10000 || cp > 0x10ffff))) {
+                return STREAM_INVALID;
+            }
+            p += n + 1;
+            continue;
+        }
+
+        if (*p >= 0x20 && *p != '"' && *p != '\\') {
+            p++;
+            continue;
+        }
+
+        if (put(stream, (const char *) run, p - run) != 0) {
+            return -1;
+        }
+        switch (*p) {
+        case '"':
+            memcpy(esc, "\\\"", 3);
+            break;
+        case '\\':
+            memcpy(esc, "\\\\", 3);
+            break;
+        case '\b':
+            memcpy(esc, "\\b", 3);
+            break;
+        case '\f':
+            memcpy(esc, "\\f", 3);
+            break;
+        case '\n':
+            memcpy(esc, "\\n", 3);
+            break;
+        case '\r':
+            memcpy(esc, "\\r", 3);
+            break;
+        case '\t':
+            memcpy(esc, "\\t", 3);
+            break;
+        default:
+            snprintf(esc, sizeof(esc), "\\u%04X", *p);
+            break;
+        }
+        if (put(stream, esc, strlen(esc)) != 0) {
+            return -1;
+        }
+        run = ++p;
+    }
+
+    if (put(stream, (const char *) run, p - run) != 0) {
+        return -1;
+    }
+    return PUT_LITERAL(stream, "\"");
+}
+
+static int put_bytes(neu_json_stream_t *stream, const neu_value_bytes_t *bytes)
+{
+    if (PUT_LITERAL(stream, "[") != 0) {
+        return -1;
+    }
+    for (int i = 0; i < bytes->length; i++) {
+        if ((i > 0 && PUT_LITERAL(stream, ", ") != 0) ||
+            put_int(stream, bytes->bytes[i]) != 0) {
+            return -1;
+        }
+    }
+    return PUT_LITERAL(stream, "]");
+}
+
+// the value as neu_tag_value_to_json maps it, or as neu_json_metas_to_json
+// does for a meta, which knows fewer types and has no precision
+static int put_value(neu_json_stream_t *stream, const neu_dvalue_t *value,
+                     bool meta)
+{
+    switch (value->type) {
+    case NEU_TYPE_ERROR:
+        return meta ? STREAM_INVALID : put_int(stream, value->value.i32);
+    case NEU_TYPE_UINT8:
+        return put_int(stream, value->value.u8);
+    case NEU_TYPE_INT8:
+        return put_int(stream, value->value.i8);
+    case NEU_TYPE_INT16:
+        return put_int(stream, value->value.i16);
+    case NEU_TYPE_INT32:
+        return put_int(stream, value->value.i32);
+    case NEU_TYPE_INT64:
+        return put_int(stream, value->value.i64);
+    case NEU_TYPE_WORD:
+    case NEU_TYPE_UINT16:
+        return put_int(stream, value->value.u16);
+    case NEU_TYPE_DWORD:
+    case NEU_TYPE_UINT32:
+        return put_int(stream, value->value.u32);
+    case NEU_TYPE_LWORD:
+    case NEU_TYPE_UINT64:
+        return put_int(stream, (int64_t) value->value.u64);
+    case NEU_TYPE_FLOAT:
+        return put_real(stream, value->value.f32, meta ? 0 : value->precision);
+    case NEU_TYPE_DOUBLE:
+        return put_real(stream, value->value.d64, meta ? 0 : value->precision);
+    case NEU_TYPE_BOOL:
+        return value->value.boolean ? PUT_LITERAL(stream, "true")
+                                    : PUT_LITERAL(stream, "false");
+    case NEU_TYPE_BIT:
+        return put_int(stream, value->value.u8);
+    case NEU_TYPE_STRING:
+        return put_str(stream, value->value.str);
+    case NEU_TYPE_PTR:
+        return meta ? STREAM_INVALID
+                    : put_str(stream, (char *) value->value.ptr.ptr);
+    case NEU_TYPE_BYTES:
+        return meta ? STREAM_INVALID : put_bytes(stream, &value->value.bytes);
+    default:
+        return STREAM_INVALID;
+    }
+}
+
+// start a member of an object, the separator is only kept along with a
+// member that is actually written
+static int put_key(neu_json_stream_t *stream, bool first, const char *name)
+{
+    int ret = 0;
+
+    if (!first && PUT_LITERAL(stream, ", ") != 0) {
+        return -1;
+    }
+    ret = put_str(stream, name);
+    if (ret != 0) {
+        return ret;
+    }
+    return PUT_LITERAL(stream, ": ");
+}
+
+// write one member, the return value tells whether it was kept
+static int put_member(neu_json_stream_t *stream, bool *first, const char *name,
+                      const neu_dvalue_t *value, bool meta)
+{
+    size_t mark = stream->len;
+    int    ret  = put_key(stream, *first, name);
+
+    if (ret == 0) {
+        ret = put_value(stream, value, meta);
+    }
+    if (ret == STREAM_INVALID) {
+        stream->len              = mark;
+        stream->buf[stream->len] = '\0';
+        return 0;
+    }
+    if (ret == 0) {
+        *first = false;
+    }
+    return ret;
+}
+
+static int put_int_member(neu_json_stream_t *stream, bool *first,
+                          const char *name, int64_t value)
+{
+    neu_dvalue_t v = { .type = NEU_TYPE_INT64, .value.i64 = value };
+    return put_member(stream, first, name, &v, false);
+}
+
+static int put_metas(neu_json_stream_t *stream, bool *first,
+                     neu_resp_tag_value_meta_t *tag)
+{
+    for (int k = 0; k < NEU_TAG_META_SIZE && tag->metas[k].name[0] != '\0';
+         k++) {
+        if (put_member(stream, first, tag->metas[k].name, &tag->metas[k].value,
+                       true) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static inline bool tag_error(neu_resp_tag_value_meta_t *tag)
+{
+    return tag->value.type == NEU_TYPE_ERROR && tag->value.value.i32 != 0;
+}
+
+static int put_header(neu_json_stream_t *       stream,
+                      neu_json_read_periodic_t *header, const char *node_key,
+                      const char *group_key, bool *first)
+{
+    neu_dvalue_t node  = { .type = NEU_TYPE_PTR };
+    neu_dvalue_t group = { .type = NEU_TYPE_PTR };
+
+    node.value.ptr.ptr  = (uint8_t *) header->node;
+    group.value.ptr.ptr = (uint8_t *) header->group;
+
+    if (PUT_LITERAL(stream, "{") != 0 ||
+        put_member(stream, first, node_key, &node, false) != 0 ||
+        put_member(stream, first, group_key, &group, false) != 0 ||
+        put_int_member(stream, first, "timestamp", header->timestamp) != 0) {
+        return -1;
+    }
+    return 0;
+}
+
+void neu_json_stream_fini(neu_json_stream_t *stream)
+{
+    free(stream->buf);
+    stream->buf = NULL;
+    stream->len = 0;
+    stream->cap = 0;
+}
+
+int neu_json_stream_read_periodic_resp(neu_json_stream_t *       stream,
+                                       neu_json_read_periodic_t *header,
+                                       UT_array *                tags)
+{
+    bool first     = true;
+    bool first_tag = true;
+
+    if (put_header(stream, header, "node", "group", &first) != 0 ||
+        put_key(stream, first, "tags") != 0 || PUT_LITERAL(stream, "[") != 0) {
+        return -1;
+    }
+
+    utarray_foreach(tags, neu_resp_tag_value_meta_t *, tag)
+    {
+        bool f = true;
+
+        if ((!first_tag && PUT_LITERAL(stream, ", ") != 0) ||
+            PUT_LITERAL(stream, "{") != 0) {
+            return -1;
+        }
+        first_tag = false;
+
+        neu_dvalue_t name = { .type = NEU_TYPE_PTR };
+        name.value.ptr.ptr = (uint8_t *) tag->tag;
+        if (put_member(stream, &f, "name", &name, false) != 0) {
+            return -1;
+        }
+        if (tag_error(tag)) {
+            if (put_int_member(stream, &f, "error", tag->value.value.i32) !=
+                0) {
+                return -1;
+            }
+        } else if (put_member(stream, &f, "value", &tag->value, false) != 0) {
+            return -1;
+        }
+        if (put_metas(stream, &f, tag) != 0 || PUT_LITERAL(stream, "}") != 0) {
+            return -1;
+        }
+    }
+
+    return PUT_LITERAL(stream, "]}");
+}
+
+int neu_json_stream_read_periodic_resp1(neu_json_stream_t *       stream,
+                                        neu_json_read_periodic_t *header,
+                                        UT_array *                tags)
+{
+    return neu_json_stream_read_periodic_resp1_keys(stream, "node", "group",
+                                                    header, tags);
+}
+
+int neu_json_stream_read_periodic_resp1_keys(
+    neu_json_stream_t *stream, const char *node_key, const char *group_key,
+    neu_json_read_periodic_t *header, UT_array *tags)
+{
+    bool first = true;
+    bool f     = true;
+
+    if (put_header(stream, header, node_key, group_key, &first) != 0 ||
+        put_key(stream, first, "values") != 0 ||
+        PUT_LITERAL(stream, "{") != 0) {
+        return -1;
+    }
+    utarray_foreach(tags, neu_resp_tag_value_meta_t *, tag)
+    {
+        if (!tag_error(tag) &&
+            put_member(stream, &f, tag->tag, &tag->value, false) != 0) {
+            return -1;
+        }
+    }
+
+    f = true;
+    if (PUT_LITERAL(stream, "}, ") != 0 ||
+        put_key(stream, true, "errors") != 0 ||
+        PUT_LITERAL(stream, "{") != 0) {
+        return -1;
+    }
+    utarray_foreach(tags, neu_resp_tag_value_meta_t *, tag)
+    {
+        if (tag_error(tag) &&
+            put_int_member(stream, &f, tag->tag, tag->value.value.i32) != 0) {
+            return -1;
+        }
+    }
+
+    f = true;
+    if (PUT_LITERAL(stream, "}, ") != 0 ||
+        put_key(stream, true, "metas") != 0 || PUT_LITERAL(stream, "{") != 0) {
+        return -1;
+    }
+    utarray_foreach(tags, neu_resp_tag_value_meta_t *, tag)
+    {
+        bool   m    = true;
+        size_t mark = stream->len;
+        int    ret  = 0;
+
+        if (tag->metas[0].name[0] == '\0') {
+            continue;
+        }
+        ret = put_key(stream, f, tag->tag);
+        if (ret == STREAM_INVALID) {
+            stream->len              = mark;
+            stream->buf[stream->len] = '\0';
+            continue;
+        }
+        if (ret != 0 || PUT_LITERAL(stream, "{") != 0 ||
+            put_metas(stream, &m, tag) != 0 || PUT_LITERAL(stream, "}") != 0) {
+            return -1;
+        }
+        f = false;
+    }
+
+    return PUT_LITERAL(stream, "}}");
+}
@@ -83,8 +83,65 @@ int neu_json_encode_tag(void *json_obj, void *param)
 
     ret = neu_json_encode_field(json_obj, tag_elems,
                                 NEU_JSON_ELEM_SIZE(tag_elems));
+    if (0 == ret && tag->poll_divisor > 1) {
+        neu_json_elem_t divisor_elem = {
+            .name      = "poll_divisor",
+            .t         = NEU_JSON_INT,
+            .v.val_int = tag->poll_divisor,
+        };
 
-    return ret;
+        ret = neu_json_encode_field(json_obj, &divisor_elem, 1);
+    }
+    if (0 != ret || !neu_tag_deadband_is_set(&tag->deadband)) {
+        return ret;
+    }
+
+    neu_json_elem_t band_elems[] = {
+        {
+            .name         = "deadband",
+            .t            = NEU_JSON_DOUBLE,
+            .v.val_double = tag->deadband.absolute,
+        },
+        {
+            .name         = "deadband_percent",
+            .t            = NEU_JSON_DOUBLE,
+            .v.val_double = tag->deadband.percent,
+        },
+        {
+            .name      = "report_min_interval",
+            .t         = NEU_JSON_INT,
+            .v.val_int = tag->deadband.min_interval,
+        },
+        {
+            .name      = "report_max_interval",
+            .t         = NEU_JSON_INT,
+            .v.val_int = tag->deadband.max_interval,
+        },
+    };
+
+    return neu_json_encode_field(json_obj, band_elems,
+                                 NEU_JSON_ELEM_SIZE(band_elems));
+}
+
+// a deadband filters the changes reported for a subscribed tag
+static bool check_deadband(const neu_json_tag_t *tag, int64_t min_interval,
+                           int64_t max_interval)
+{
+    if (!neu_tag_deadband_is_set(&tag->deadband)) {
+        return true;
+    }
+
+    if (tag->deadband.absolute < 0 || tag->deadband.percent < 0 ||
+        min_interval < 0 || min_interval > UINT32_MAX || max_interval < 0 ||
+        max_interval > UINT32_MAX) {
+        return false;
+    }
+
+    if (max_interval > 0 && min_interval > max_interval) {
+        return false;
+    }
+
+    return NEU_ATTRIBUTE_SUBSCRIBE & tag->attribute;
 }
 
 int neu_json_decode_tag_json(void *json_obj, neu_json_tag_t *tag_p)
@@ -130,6 +187,31 @@ int neu_json_decode_tag_json(void *json_obj, neu_json_tag_t *tag_p)
             .t         = NEU_JSON_VALUE,
             .attribute = NEU_JSON_ATTRIBUTE_OPTIONAL,
         },
+        {
+            .name      = "deadband",
+            .t         = NEU_JSON_DOUBLE,
+            .attribute = NEU_JSON_ATTRIBUTE_OPTIONAL,
+        },
+        {
+            .name      = "deadband_percent",
+            .t         = NEU_JSON_DOUBLE,
+            .attribute = NEU_JSON_ATTRIBUTE_OPTIONAL,
+        },
+        {
+            .name      = "report_min_interval",
+            .t         = NEU_JSON_INT,
+            .attribute = NEU_JSON_ATTRIBUTE_OPTIONAL,
+        },
+        {
+            .name      = "report_max_interval",
+            .t         = NEU_JSON_INT,
+            .attribute = NEU_JSON_ATTRIBUTE_OPTIONAL,
+        },
+        {
+            .name      = "poll_divisor",
+            .t         = NEU_JSON_INT,
+            .attribute = NEU_JSON_ATTRIBUTE_OPTIONAL,
+        },
     };
 
     int ret = neu_json_decode_by_json(json_obj, NEU_JSON_ELEM_SIZE(tag_elems),
@@ -137,21 +219,35 @@ int neu_json_decode_tag_json(void *json_obj, neu_json_tag_t *tag_p)
 
     // set the fields before check for easy clean up on error
     neu_json_tag_t tag = {
-        .type        = tag_elems[0].v.val_int,
-        .name        = tag_elems[1].v.val_str,
-        .attribute   = tag_elems[2].v.val_int,
-        .address     = tag_elems[3].v.val_str,
-        .decimal     = tag_elems[4].v.val_double,
-        .precision   = tag_elems[5].v.val_int,
-        .description = tag_elems[6].v.val_str,
-        .t           = tag_elems[7].t,
-        .value       = tag_elems[7].v,
+        .type         = tag_elems[0].v.val_int,
+        .name         = tag_elems[1].v.val_str,
+        .attribute    = tag_elems[2].v.val_int,
+        .address      = tag_elems[3].v.val_str,
+        .decimal      = tag_elems[4].v.val_double,
+        .precision    = tag_elems[5].v.val_int,
+        .description  = tag_elems[6].v.val_str,
+        .t            = tag_elems[7].t,
+        .value        = tag_elems[7].v,
+        .poll_divisor = tag_elems[12].v.val_int,
     };
+    tag.deadband.absolute     = tag_elems[8].v.val_double;
+    tag.deadband.percent      = tag_elems[9].v.val_double;
+    tag.deadband.min_interval = tag_elems[10].v.val_int;
+    tag.deadband.max_interval = tag_elems[11].v.val_int;
 
     if (0 != ret) {
         goto decode_fail;
     }
 
+    if (!check_deadband(&tag, tag_elems[10].v.val_int,
+                        tag_elems[11].v.val_int)) {
+        goto decode_fail;
+    }
+
+    if (tag.poll_divisor < 0 || tag.poll_divisor > UINT16_MAX) {
+        goto decode_fail;
+    }
+
     if (!neu_json_tag_check_type(&tag)) {
         goto decode_fail;
     }
@@ -283,16 +379,29 @@ void neu_json_decode_tag_array_fini(neu_json_tag_array_t *arr)
 
 int neu_json_decode_add_tags_req(char *buf, neu_json_add_tags_req_t **result)
 {
-    int                      ret      = 0;
-    void *                   json_obj = NULL;
-    neu_json_add_tags_req_t *req = calloc(1, sizeof(neu_json_add_tags_req_t));
-    if (req == NULL) {
+    return neu_json_decode_add_tags_reqb(buf, strlen(buf), result);
+}
+
+int neu_json_decode_add_tags_reqb(const char *buf, size_t len,
+                                  neu_json_add_tags_req_t **result)
+{
+    void *json_obj = neu_json_decode_newb((char *) buf, len);
+    if (NULL == json_obj) {
         return -1;
     }
 
-    json_obj = neu_json_decode_new(buf);
-    if (NULL == json_obj) {
-        goto decode_fail;
+    int ret = neu_json_decode_add_tags_req_json(json_obj, result);
+    neu_json_decode_free(json_obj);
+    return ret;
+}
+
+int neu_json_decode_add_tags_req_json(void *                    json_obj,
+                                      neu_json_add_tags_req_t **result)
+{
+    int                      ret = 0;
+    neu_json_add_tags_req_t *req = calloc(1, sizeof(neu_json_add_tags_req_t));
+    if (req == NULL) {
+        return -1;
     }
 
     neu_json_elem_t req_elems[] = {
@@ -329,19 +438,13 @@ int neu_json_decode_add_tags_req(char *buf, neu_json_add_tags_req_t **result)
     req->n_tag = arr.len;
     req->tags  = arr.tags;
     *result    = req;
-    goto decode_exit;
+    return 0;
 
 decode_fail:
     free(req);
     free(req_elems[0].v.val_str);
     free(req_elems[1].v.val_str);
-    ret = -1;
-
-decode_exit:
-    if (json_obj != NULL) {
-        neu_json_decode_free(json_obj);
-    }
-    return ret;
+    return -1;
 }
 
 void neu_json_decode_add_tags_req_free(neu_json_add_tags_req_t *req)
@@ -554,16 +657,29 @@ void neu_json_decode_gtag_array_fini(neu_json_gtag_array_t *arr)
 
 int neu_json_decode_add_gtags_req(char *buf, neu_json_add_gtags_req_t **result)
 {
-    int                       ret      = 0;
-    void *                    json_obj = NULL;
-    neu_json_add_gtags_req_t *req = calloc(1, sizeof(neu_json_add_gtags_req_t));
-    if (req == NULL) {
+    return neu_json_decode_add_gtags_reqb(buf, strlen(buf), result);
+}
+
+int neu_json_decode_add_gtags_reqb(const char *buf, size_t len,
+                                   neu_json_add_gtags_req_t **result)
+{
+    void *json_obj = neu_json_decode_newb((char *) buf, len);
+    if (NULL == json_obj) {
         return -1;
     }
 
-    json_obj = neu_json_decode_new(buf);
-    if (NULL == json_obj) {
-        goto decode_fail;
+    int ret = neu_json_decode_add_gtags_req_json(json_obj, result);
+    neu_json_decode_free(json_obj);
+    return ret;
+}
+
+int neu_json_decode_add_gtags_req_json(void *                     json_obj,
+                                       neu_json_add_gtags_req_t **result)
+{
+    int                       ret = 0;
+    neu_json_add_gtags_req_t *req = calloc(1, sizeof(neu_json_add_gtags_req_t));
+    if (req == NULL) {
+        return -1;
     }
 
     neu_json_elem_t req_elems[] = {
@@ -595,18 +711,12 @@ int neu_json_decode_add_gtags_req(char *buf, neu_json_add_gtags_req_t **result)
     req->n_group = arr.len;
     req->groups  = arr.gtags;
     *result      = req;
-    goto decode_exit;
+    return 0;
 
 decode_fail:
     free(req);
     free(req_elems[0].v.val_str);
-    ret = -1;
-
-decode_exit:
-    if (json_obj != NULL) {
-        neu_json_decode_free(json_obj);
-    }
-    return ret;
+    return -1;
 }
 
 void neu_json_decode_add_gtags_req_free(neu_json_add_gtags_req_t *req)
@@ -750,10 +860,15 @@ int neu_json_encode_get_tags_resp(void *json_object, void *param)
     }
 
     neu_json_elem_t resp_elems[] = { {
-        .name         = "tags",
-        .t            = NEU_JSON_OBJECT,
-        .v.val_object = tag_array,
-    } };
+                                         .name         = "tags",
+                                         .t            = NEU_JSON_OBJECT,
+                                         .v.val_object = tag_array,
+                                     },
+                                     {
+                                         .name      = "total",
+                                         .t         = NEU_JSON_INT,
+                                         .v.val_int = resp->total,
+                                     } };
     ret = neu_json_encode_field(json_object, resp_elems,
                                 NEU_JSON_ELEM_SIZE(resp_elems));
 
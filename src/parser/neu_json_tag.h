@@ -27,20 +27,24 @@
 
 #include "json/json.h"
 
+#include "tag.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 typedef struct {
-    char *           address;
-    char *           name;
-    char *           description;
-    int64_t          type;
-    int64_t          attribute;
-    int64_t          precision;
-    double           decimal;
-    neu_json_type_e  t;
-    neu_json_value_u value;
+    char *             address;
+    char *             name;
+    char *             description;
+    int64_t            type;
+    int64_t            attribute;
+    int64_t            precision;
+    double             decimal;
+    neu_tag_deadband_t deadband;
+    int64_t            poll_divisor;
+    neu_json_type_e    t;
+    neu_json_value_u   value;
 } neu_json_tag_t;
 
 int  neu_json_encode_tag(void *json_obj, void *param);
@@ -65,6 +69,10 @@ typedef struct {
 } neu_json_add_tags_req_t;
 
 int  neu_json_decode_add_tags_req(char *buf, neu_json_add_tags_req_t **result);
+int  neu_json_decode_add_tags_reqb(const char *buf, size_t len,
+                                   neu_json_add_tags_req_t **result);
+int  neu_json_decode_add_tags_req_json(void *                    json_obj,
+                                       neu_json_add_tags_req_t **result);
 void neu_json_decode_add_tags_req_free(neu_json_add_tags_req_t *req);
 
 typedef struct {
@@ -101,6 +109,10 @@ typedef struct {
 } neu_json_add_gtags_req_t;
 
 int neu_json_decode_add_gtags_req(char *buf, neu_json_add_gtags_req_t **result);
+int neu_json_decode_add_gtags_reqb(const char *buf, size_t len,
+                                   neu_json_add_gtags_req_t **result);
+int neu_json_decode_add_gtags_req_json(void *                     json_obj,
+                                       neu_json_add_gtags_req_t **result);
 void neu_json_decode_add_gtags_req_free(neu_json_add_gtags_req_t *req);
 
 typedef struct {
@@ -125,6 +137,7 @@ void neu_json_decode_del_tags_req_free(neu_json_del_tags_req_t *req);
 typedef struct {
     int             n_tag;
     neu_json_tag_t *tags;
+    int64_t         total; // tags matching the query, of every page
 } neu_json_get_tags_resp_t;
 
 int neu_json_encode_get_tags_resp(void *json_object, void *param);
@@ -39,7 +39,9 @@
 #include "persist/json/persist_json_plugin.h"
 #include "persist/persist.h"
 #include "persist/persist_impl.h"
+#include "persist/snapshot.h"
 #include "persist/sqlite.h"
+#include "persist/write_behind.h"
 
 #include "json/neu_json_fn.h"
 
@@ -309,13 +311,49 @@ bool neu_persister_library_exists(const char *library)
 
 int neu_persister_create(const char *schema_dir)
 {
-    g_impl = neu_sqlite_persister_create(schema_dir);
+    neu_persister_t *impl = neu_sqlite_persister_create(schema_dir);
+    if (NULL == impl) {
+        return -1;
+    }
+
+    neu_persister_t *wb = neu_write_behind_persister_create(impl);
+    if (NULL == wb) {
+        impl->vtbl->destroy(impl);
+        return -1;
+    }
+
+    g_impl = neu_snapshot_persister_create(wb);
+    if (NULL == g_impl) {
+        wb->vtbl->destroy(wb);
+        return -1;
+    }
+    return 0;
+}
+
+int neu_persister_create_memory(const char *schema_dir)
+{
+    neu_persister_t *impl = neu_sqlite_persister_create_memory(schema_dir);
+    if (NULL == impl) {
+        return -1;
+    }
+
+    // no snapshot, there is no file to snapshot
+    g_impl = neu_write_behind_persister_create(impl);
     if (NULL == g_impl) {
+        impl->vtbl->destroy(impl);
         return -1;
     }
     return 0;
 }
 
+int neu_persister_flush()
+{
+    if (NULL == g_impl->vtbl->flush) {
+        return 0;
+    }
+    return g_impl->vtbl->flush(g_impl);
+}
+
 sqlite3 *neu_persister_get_db()
 {
     return g_impl->vtbl->native_handle(g_impl);
@@ -382,6 +420,14 @@ int neu_persister_update_tag_value(const char *         driver_name,
     return g_impl->vtbl->update_tag_value(g_impl, driver_name, group_name, tag);
 }
 
+int neu_persister_update_tag_values(const char *         driver_name,
+                                    const char *         group_name,
+                                    const neu_datatag_t *tags, size_t n)
+{
+    return g_impl->vtbl->update_tag_values(g_impl, driver_name, group_name,
+                                           tags, n);
+}
+
 int neu_persister_delete_tag(const char *driver_name, const char *group_name,
                              const char *tag_name)
 {
@@ -438,11 +484,28 @@ int neu_persister_load_groups(const char *driver_name, UT_array **group_infos)
     return g_impl->vtbl->load_groups(g_impl, driver_name, group_infos);
 }
 
+int neu_persister_load_group_tags(const char *driver_name, UT_array **groups)
+{
+    return g_impl->vtbl->load_group_tags(g_impl, driver_name, groups);
+}
+
 int neu_persister_delete_group(const char *driver_name, const char *group_name)
 {
     return g_impl->vtbl->delete_group(g_impl, driver_name, group_name);
 }
 
+int neu_persister_store_group_profile(
+    const char *driver_name, const neu_persist_group_profile_t *profile)
+{
+    return g_impl->vtbl->store_group_profile(g_impl, driver_name, profile);
+}
+
+int neu_persister_load_group_profiles(const char *driver_name,
+                                      UT_array ** profiles)
+{
+    return g_impl->vtbl->load_group_profiles(g_impl, driver_name, profiles);
+}
+
 int neu_persister_store_node_setting(const char *node_name, const char *setting)
 {
     return g_impl->vtbl->store_node_setting(g_impl, node_name, setting);
@@ -43,6 +43,13 @@ struct neu_persister_vtbl_s {
      */
     void *(*native_handle)(neu_persister_t *self);
 
+    /**
+     * Wait until every write accepted so far is persisted, may be NULL if
+     * writes are synchronous.
+     * @return 0 on success, non-zero on failure
+     */
+    int (*flush)(neu_persister_t *self);
+
     /**
      * Persist nodes.
      * @param node_info                 neu_persist_node_info_t.
@@ -162,6 +169,18 @@ struct neu_persister_vtbl_s {
     int (*update_tag_value)(neu_persister_t *self, const char *driver_name,
                             const char *group_name, const neu_datatag_t *tag);
 
+    /**
+     * Update the values of several node tags of one group.
+     * @param driver_name               name of the driver who owns the tags
+     * @param group_name                name of the group
+     * @param tags                      the tags to update
+     * @param n                         number of tags
+     * @return 0 on success, non-zero otherwise
+     */
+    int (*update_tag_values)(neu_persister_t *self, const char *driver_name,
+                             const char *group_name, const neu_datatag_t *tags,
+                             size_t n);
+
     /**
      * Delete node tags.
      * @param driver_name               name of the driver who owns the tags
@@ -245,6 +264,16 @@ struct neu_persister_vtbl_s {
      */
     int (*load_groups)(neu_persister_t *self, const char *driver_name,
                        UT_array **group_infos);
+    /**
+     * Load all groups under an adapter together with their tags.
+     * @param driver_name               name of the driver who owns the group
+     * @param[out] groups               used to return pointer to heap
+     *                                  allocated vector of
+     *                                  neu_persist_group_tags_t.
+     * @return 0 on success, non-zero otherwise
+     */
+    int (*load_group_tags)(neu_persister_t *self, const char *driver_name,
+                           UT_array **groups);
     /**
      * Delete group config.
      * @param driver_name               name of the driver who owns the group
@@ -254,6 +283,26 @@ struct neu_persister_vtbl_s {
     int (*delete_group)(neu_persister_t *self, const char *driver_name,
                         const char *group_name);
 
+    /**
+     * Add the read statistics of a group to the halved persisted ones.
+     * @param driver_name               name of the driver who owns the group
+     * @param profile                   statistics since the last store.
+     * @return 0 on success, none-zero on failure
+     */
+    int (*store_group_profile)(neu_persister_t *                  self,
+                               const char *                       driver_name,
+                               const neu_persist_group_profile_t *profile);
+    /**
+     * Load the read statistics of the groups under an adapter.
+     * @param driver_name               name of the driver who owns the groups
+     * @param[out] profiles             used to return pointer to heap
+     *                                  allocated vector of
+     *                                  neu_persist_group_profile_t.
+     * @return 0 on success, non-zero otherwise
+     */
+    int (*load_group_profiles)(neu_persister_t *self, const char *driver_name,
+                               UT_array **profiles);
+
     /**
      * Save user info.
      * @param user                      user info
@@ -0,0 +1,1147 @@
+/**
+ * NEURON IIoT System for Industry 4.0
+ * Copyright (C) 2020-2023 EMQ Technologies Co., Ltd All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ **/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <sqlite3.h>
+
+#include "errcodes.h"
+#include "utils/log.h"
+#include "utils/time.h"
+
+#include "snapshot.h"
+#include "sqlite.h"
+
+#define SNAPSHOT_FILE "persistence/sqlite.snapshot"
+#define SNAPSHOT_TMP_FILE "persistence/sqlite.snapshot.tmp"
+#define SNAPSHOT_MAGIC "NEUSNAP"
+// 3: tags carry their deadband
+// 4: and their poll divisor
+#define SNAPSHOT_FORMAT 4
+// quiet period after the last write before the snapshot is rewritten
+#define SNAPSHOT_SETTLE_MS (10 * 1000)
+
+// marks a NULL string
+#define STR_NULL UINT32_MAX
+
+typedef struct {
+    char     magic[8];
+    uint32_t format;
+    uint32_t crc; // of the payload
+    char     schema[32];
+    int64_t  db_size;
+    int64_t  db_mtime_sec;
+    int64_t  db_mtime_nsec;
+    uint64_t len; // of the payload following the header
+} snapshot_header_t;
+
+// what the snapshot still serves, a write clears what it changes
+enum {
+    SERVE_NODES         = 1 << 0,
+    SERVE_SETTINGS      = 1 << 1,
+    SERVE_TAGS          = 1 << 2,
+    SERVE_SUBSCRIPTIONS = 1 << 3,
+    SERVE_ALL           = 0xf,
+};
+
+typedef struct {
+    const char *name;
+    int32_t     type;
+    int32_t     state;
+    const char *plugin;
+    const char *setting;
+    size_t      groups; // payload offset of the groups
+    size_t      subs;   // payload offset of the subscriptions
+} snapshot_node_t;
+
+typedef struct {
+    struct neu_persister_vtbl_s *vtbl;
+    neu_persister_t *            impl;
+
+    pthread_mutex_t mtx;
+    pthread_cond_t  cond;
+    pthread_t       thread;
+    bool            quit;
+
+    // mapped snapshot file, valid while `serve` is not 0
+    int              serve;
+    void *           map;
+    size_t           map_len;
+    const uint8_t *  payload;
+    size_t           payload_len;
+    snapshot_node_t *nodes;
+    uint32_t         n_node;
+
+    uint64_t gen;        // bumped by every write
+    int64_t  last_write; // in ms
+    bool     dirty;      // the snapshot file is missing or stale
+} snapshot_t;
+
+typedef struct {
+    uint8_t *data;
+    size_t   len;
+    size_t   cap;
+    bool     err;
+} buf_t;
+
+typedef struct {
+    const uint8_t *p;
+    const uint8_t *end;
+    bool           err;
+} reader_t;
+
+static uint32_t       crc_table[256];
+static pthread_once_t crc_once = PTHREAD_ONCE_INIT;
+
+static void crc_init()
+{
+    for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; ++k) {
+            c = (c & 1) ? 0xedb88320 ^ (c >> 1) : c >> 1;
+        }
+        crc_table[i] = c;
+    }
+}
+
+static uint32_t crc32(const uint8_t *p, size_t n)
+{
+    uint32_t c = 0xffffffff;
+
+    pthread_once(&crc_once, crc_init);
+    for (size_t i = 0; i < n; ++i) {
+        c = crc_table[(c ^ p[i]) & 0xff] ^ (c >> 8);
+    }
+
+    return c ^ 0xffffffff;
+}
+
+static void put(buf_t *b, const void *p, size_t n)
+{
+    if (b->err) {
+        return;
+    }
+
+    if (b->len + n > b->cap) {
+        size_t cap = b->cap ? b->cap : 4096;
+        while (cap < b->len + n) {
+            cap *= 2;
+        }
+        uint8_t *data = realloc(b->data, cap);
+        if (NULL == data) {
+            b->err = true;
+            return;
+        }
+        b->data = data;
+        b->cap  = cap;
+    }
+
+    memcpy(b->data + b->len, p, n);
+    b->len += n;
+}
+
+static inline void put_u32(buf_t *b, uint32_t v)
+{
+    put(b, &v, sizeof(v));
+}
+
+static inline void put_i32(buf_t *b, int32_t v)
+{
+    put(b, &v, sizeof(v));
+}
+
+static inline void put_f64(buf_t *b, double v)
+{
+    put(b, &v, sizeof(v));
+}
+
+static inline void put_str(buf_t *b, const char *s)
+{
+    if (NULL == s) {
+        put_u32(b, STR_NULL);
+        return;
+    }
+
+    uint32_t n = strlen(s);
+    put_u32(b, n);
+    put(b, s, n + 1);
+}
+
+static void get(reader_t *r, void *p, size_t n)
+{
+    if (r->err || (size_t)(r->end - r->p) < n) {
+        r->err = true;
+        memset(p, 0, n);
+        return;
+    }
+
+    memcpy(p, r->p, n);
+    r->p += n;
+}
+
+static inline uint32_t get_u32(reader_t *r)
+{
+    uint32_t v;
+    get(r, &v, sizeof(v));
+    return v;
+}
+
+static inline int32_t get_i32(reader_t *r)
+{
+    int32_t v;
+    get(r, &v, sizeof(v));
+    return v;
+}
+
+static inline double get_f64(reader_t *r)
+{
+    double v;
+    get(r, &v, sizeof(v));
+    return v;
+}
+
+// strings point into the mapped snapshot
+static const char *get_str(reader_t *r)
+{
+    uint32_t n = get_u32(r);
+    if (r->err || STR_NULL == n) {
+        return NULL;
+    }
+
+    if ((size_t)(r->end - r->p) <= n || '\0' != r->p[n]) {
+        r->err = true;
+        return NULL;
+    }
+
+    const char *s = (const char *) r->p;
+    r->p += n + 1;
+    return s;
+}
+
+static void put_tags(buf_t *b, UT_array *tags)
+{
+    put_u32(b, utarray_len(tags));
+    utarray_foreach(tags, neu_datatag_t *, tag)
+    {
+        uint8_t value[NEU_TAG_STATIC_VALUE_BIN_SIZE];
+        size_t  len = neu_tag_pack_static_value(tag, value);
+
+        put_str(b, tag->name);
+        put_str(b, tag->address);
+        put_str(b, tag->description);
+        put_i32(b, tag->attribute);
+        put_i32(b, tag->type);
+        put_i32(b, tag->precision);
+        put_f64(b, tag->decimal);
+        put_f64(b, tag->deadband.absolute);
+        put_f64(b, tag->deadband.percent);
+        put_u32(b, tag->deadband.min_interval);
+        put_u32(b, tag->deadband.max_interval);
+        put_u32(b, tag->poll_divisor);
+        put_u32(b, len);
+        put(b, value, len);
+    }
+}
+
+// the static value points into the mapped snapshot
+static void get_tag(reader_t *r, neu_datatag_t *tag, const uint8_t **value,
+                    uint32_t *len)
+{
+    tag->name                  = (char *) get_str(r);
+    tag->address               = (char *) get_str(r);
+    tag->description           = (char *) get_str(r);
+    tag->attribute             = get_i32(r);
+    tag->type                  = get_i32(r);
+    tag->precision             = get_i32(r);
+    tag->decimal               = get_f64(r);
+    tag->deadband.absolute     = get_f64(r);
+    tag->deadband.percent      = get_f64(r);
+    tag->deadband.min_interval = get_u32(r);
+    tag->deadband.max_interval = get_u32(r);
+    tag->poll_divisor          = get_u32(r);
+    *len                       = get_u32(r);
+    *value                     = r->p;
+    if (r->err || (size_t)(r->end - r->p) < *len) {
+        r->err = true;
+        *len   = 0;
+        return;
+    }
+    r->p += *len;
+}
+
+static int put_node(buf_t *b, neu_persister_t *impl,
+                    neu_persist_node_info_t *node)
+{
+    char *    setting = NULL;
+    UT_array *groups  = NULL;
+    UT_array *subs    = NULL;
+
+    if (0 != impl->vtbl->load_node_setting(impl, node->name,
+                                           (const char **) &setting)) {
+        setting = NULL;
+    }
+    if (0 != impl->vtbl->load_group_tags(impl, node->name, &groups) ||
+        0 != impl->vtbl->load_subscriptions(impl, node->name, &subs)) {
+        free(setting);
+        if (NULL != groups) {
+            utarray_free(groups);
+        }
+        return -1;
+    }
+
+    put_str(b, node->name);
+    put_i32(b, node->type);
+    put_i32(b, node->state);
+    put_str(b, node->plugin_name);
+    put_str(b, setting);
+
+    put_u32(b, utarray_len(groups));
+    utarray_foreach(groups, neu_persist_group_tags_t *, group)
+    {
+        put_str(b, group->name);
+        put_u32(b, group->interval);
+        put_tags(b, group->tags);
+    }
+
+    put_u32(b, utarray_len(subs));
+    utarray_foreach(subs, neu_persist_subscription_info_t *, sub)
+    {
+        put_str(b, sub->driver_name);
+        put_str(b, sub->group_name);
+        put_str(b, sub->params);
+    }
+
+    free(setting);
+    utarray_free(groups);
+    utarray_free(subs);
+    return 0;
+}
+
+static int build_payload(neu_persister_t *impl, buf_t *b)
+{
+    UT_array *nodes = NULL;
+    int       rv    = 0;
+
+    if (0 != impl->vtbl->load_nodes(impl, &nodes)) {
+        return -1;
+    }
+
+    put_u32(b, utarray_len(nodes));
+    utarray_foreach(nodes, neu_persist_node_info_t *, node)
+    {
+        if (0 != (rv = put_node(b, impl, node))) {
+            break;
+        }
+    }
+
+    utarray_free(nodes);
+    return rv == 0 && !b->err ? 0 : -1;
+}
+
+static int get_schema(sqlite3 *db, char *schema, size_t size)
+{
+    sqlite3_stmt *stmt  = NULL;
+    int           rv    = -1;
+    const char *  query = "SELECT version, dirty FROM migrations ORDER BY "
+                        "version DESC LIMIT 1";
+
+    if (SQLITE_OK != sqlite3_prepare_v2(db, query, -1, &stmt, NULL)) {
+        nlog_error("prepare `%s` fail: %s", query, sqlite3_errmsg(db));
+        return -1;
+    }
+
+    memset(schema, 0, size);
+    if (SQLITE_ROW == sqlite3_step(stmt) && 0 == sqlite3_column_int(stmt, 1)) {
+        const char *version = (const char *) sqlite3_column_text(stmt, 0);
+        if (NULL != version && strlen(version) < size) {
+            strcpy(schema, version);
+            rv = 0;
+        }
+    }
+
+    sqlite3_finalize(stmt);
+    return rv;
+}
+
+static int write_snapshot(snapshot_header_t *hdr, buf_t *b)
+{
+    struct stat st = { 0 };
+
+    if (0 != stat(DB_FILE, &st)) {
+        nlog_error("snapshot stat `%s` fail: %s", DB_FILE, strerror(errno));
+        return -1;
+    }
+
+    memcpy(hdr->magic, SNAPSHOT_MAGIC, sizeof(hdr->magic));
+    hdr->format        = SNAPSHOT_FORMAT;
+    hdr->crc           = crc32(b->data, b->len);
+    hdr->db_size       = st.st_size;
+    hdr->db_mtime_sec  = st.st_mtim.tv_sec;
+    hdr->db_mtime_nsec = st.st_mtim.tv_nsec;
+    hdr->len           = b->len;
+
+    FILE *f = fopen(SNAPSHOT_TMP_FILE, "wb");
+    if (NULL == f) {
+        nlog_error("snapshot open `%s` fail: %s", SNAPSHOT_TMP_FILE,
+                   strerror(errno));
+        return -1;
+    }
+
+    if (1 != fwrite(hdr, sizeof(*hdr), 1, f) ||
+        b->len != fwrite(b->data, 1, b->len, f) || 0 != fflush(f) ||
+        0 != fsync(fileno(f))) {
+        nlog_error("snapshot write `%s` fail: %s", SNAPSHOT_TMP_FILE,
+                   strerror(errno));
+        fclose(f);
+        unlink(SNAPSHOT_TMP_FILE);
+        return -1;
+    }
+
+    fclose(f);
+    return 0;
+}
+
+// called on the worker thread, the snapshot is only replaced if no write
+// happened since generation `gen`
+static int snapshot_dump(snapshot_t *s, uint64_t gen)
+{
+    snapshot_header_t hdr = { 0 };
+    buf_t             b   = { 0 };
+    sqlite3 *         db  = s->impl->vtbl->native_handle(s->impl);
+    int               rv  = -1;
+
+    if (0 != get_schema(db, hdr.schema, sizeof(hdr.schema)) ||
+        0 != build_payload(s->impl, &b)) {
+        goto end;
+    }
+
+    // move the changes into the database file, so that its size and mtime
+    // stay the same until the next write
+    if (SQLITE_OK !=
+        sqlite3_wal_checkpoint_v2(db, NULL, SQLITE_CHECKPOINT_TRUNCATE, NULL,
+                                  NULL)) {
+        nlog_warn("snapshot checkpoint fail: %s", sqlite3_errmsg(db));
+        goto end;
+    }
+
+    if (0 != write_snapshot(&hdr, &b)) {
+        goto end;
+    }
+
+    pthread_mutex_lock(&s->mtx);
+    if (s->gen == gen) {
+        rv = rename(SNAPSHOT_TMP_FILE, SNAPSHOT_FILE);
+        if (0 == rv) {
+            s->dirty = false;
+        }
+    } else {
+        unlink(SNAPSHOT_TMP_FILE);
+        rv = 0;
+    }
+    pthread_mutex_unlock(&s->mtx);
+
+    if (0 == rv) {
+        nlog_notice("snapshot `%s` written, %zu bytes", SNAPSHOT_FILE, b.len);
+    }
+
+end:
+    free(b.data);
+    return rv;
+}
+
+static void *snapshot_worker(void *arg)
+{
+    snapshot_t *s = (snapshot_t *) arg;
+
+    pthread_mutex_lock(&s->mtx);
+    while (!s->quit) {
+        if (!s->dirty) {
+            pthread_cond_wait(&s->cond, &s->mtx);
+            continue;
+        }
+
+        int64_t due = s->last_write + SNAPSHOT_SETTLE_MS;
+        if (neu_time_ms() < due) {
+            struct timespec ts = {
+                .tv_sec  = due / 1000,
+                .tv_nsec = (due % 1000) * 1000 * 1000,
+            };
+            pthread_cond_timedwait(&s->cond, &s->mtx, &ts);
+            continue;
+        }
+
+        uint64_t gen = s->gen;
+        pthread_mutex_unlock(&s->mtx);
+        int rv = snapshot_dump(s, gen);
+        pthread_mutex_lock(&s->mtx);
+
+        if (0 != rv) {
+            // retry after another quiet period
+            s->last_write = neu_time_ms();
+        }
+    }
+    pthread_mutex_unlock(&s->mtx);
+
+    return NULL;
+}
+
+// walk the payload once to check it and index the nodes
+static int snapshot_index(snapshot_t *s)
+{
+    reader_t r = { .p = s->payload, .end = s->payload + s->payload_len };
+
+    s->n_node = get_u32(&r);
+    if (r.err || s->n_node > s->payload_len) {
+        return -1;
+    }
+
+    s->nodes = calloc(s->n_node ? s->n_node : 1, sizeof(snapshot_node_t));
+    if (NULL == s->nodes) {
+        return -1;
+    }
+
+    for (uint32_t i = 0; i < s->n_node && !r.err; ++i) {
+        snapshot_node_t *node = &s->nodes[i];
+        node->name            = get_str(&r);
+        node->type            = get_i32(&r);
+        node->state           = get_i32(&r);
+        node->plugin          = get_str(&r);
+        node->setting         = get_str(&r);
+
+        node->groups     = r.p - s->payload;
+        uint32_t n_group = get_u32(&r);
+        for (uint32_t j = 0; j < n_group && !r.err; ++j) {
+            neu_datatag_t  tag   = { 0 };
+            const uint8_t *value = NULL;
+            uint32_t       len   = 0;
+            r.err |= NULL == get_str(&r);
+            get_u32(&r);
+            uint32_t n_tag = get_u32(&r);
+            for (uint32_t k = 0; k < n_tag && !r.err; ++k) {
+                get_tag(&r, &tag, &value, &len);
+                r.err |= NULL == tag.name || NULL == tag.address ||
+                    NULL == tag.description;
+            }
+        }
+
+        node->subs     = r.p - s->payload;
+        uint32_t n_sub = get_u32(&r);
+        for (uint32_t j = 0; j < n_sub && !r.err; ++j) {
+            r.err |= NULL == get_str(&r);
+            r.err |= NULL == get_str(&r);
+            get_str(&r);
+        }
+
+        if (NULL == node->name || NULL == node->plugin) {
+            r.err = true;
+        }
+    }
+
+    return r.err || r.p != r.end ? -1 : 0;
+}
+
+static void snapshot_unmap(snapshot_t *s)
+{
+    if (NULL != s->map) {
+        munmap(s->map, s->map_len);
+    }
+    free(s->nodes);
+    s->map     = NULL;
+    s->nodes   = NULL;
+    s->n_node  = 0;
+    s->payload = NULL;
+    s->serve   = 0;
+}
+
+static int snapshot_open(snapshot_t *s)
+{
+    snapshot_header_t hdr        = { 0 };
+    struct stat       st         = { 0 };
+    char              schema[32] = { 0 };
+    const char *      reason     = NULL;
+    sqlite3 *         db         = s->impl->vtbl->native_handle(s->impl);
+    int               fd         = open(SNAPSHOT_FILE, O_RDONLY);
+
+    if (fd < 0) {
+        nlog_notice("no snapshot `%s`, load from database", SNAPSHOT_FILE);
+        return -1;
+    }
+
+    if (0 != fstat(fd, &st) || (size_t) st.st_size < sizeof(hdr)) {
+        close(fd);
+        reason = "truncated";
+        goto error;
+    }
+
+    s->map_len = st.st_size;
+    s->map     = mmap(NULL, s->map_len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (MAP_FAILED == s->map) {
+        s->map = NULL;
+        reason = strerror(errno);
+        goto error;
+    }
+
+    memcpy(&hdr, s->map, sizeof(hdr));
+    s->payload     = (const uint8_t *) s->map + sizeof(hdr);
+    s->payload_len = s->map_len - sizeof(hdr);
+
+    if (0 != memcmp(hdr.magic, SNAPSHOT_MAGIC, sizeof(hdr.magic)) ||
+        SNAPSHOT_FORMAT != hdr.format || hdr.len != s->payload_len) {
+        reason = "unknown format";
+        goto error;
+    }
+
+    if (0 != get_schema(db, schema, sizeof(schema)) ||
+        0 != strcmp(schema, hdr.schema)) {
+        reason = "schema version changed";
+        goto error;
+    }
+
+    if (0 != stat(DB_FILE, &st) || st.st_size != hdr.db_size ||
+        st.st_mtim.tv_sec != hdr.db_mtime_sec ||
+        st.st_mtim.tv_nsec != hdr.db_mtime_nsec) {
+        reason = "database changed";
+        goto error;
+    }
+
+    if (crc32(s->payload, s->payload_len) != hdr.crc) {
+        reason = "checksum mismatch";
+        goto error;
+    }
+
+    if (0 != snapshot_index(s)) {
+        reason = "corrupted";
+        goto error;
+    }
+
+    s->serve = SERVE_ALL;
+    nlog_notice("load from snapshot `%s`, %u nodes", SNAPSHOT_FILE, s->n_node);
+    return 0;
+
+error:
+    nlog_notice("skip snapshot `%s`: %s", SNAPSHOT_FILE, reason);
+    snapshot_unmap(s);
+    return -1;
+}
+
+static snapshot_node_t *find_node(snapshot_t *s, const char *name)
+{
+    for (uint32_t i = 0; i < s->n_node; ++i) {
+        if (0 == strcmp(s->nodes[i].name, name)) {
+            return &s->nodes[i];
+        }
+    }
+    return NULL;
+}
+
+// a write stops serving what it changes, and invalidates the snapshot file
+static void snapshot_touch(snapshot_t *s, int serve)
+{
+    pthread_mutex_lock(&s->mtx);
+    s->serve &= ~serve;
+    if (0 == s->serve && NULL != s->map) {
+        snapshot_unmap(s);
+    }
+
+    ++s->gen;
+    s->last_write = neu_time_ms();
+    if (!s->dirty) {
+        s->dirty = true;
+        unlink(SNAPSHOT_FILE);
+    }
+    pthread_cond_signal(&s->cond);
+    pthread_mutex_unlock(&s->mtx);
+}
+
+// lock the snapshot if it still serves `serve`, returns false otherwise
+static bool snapshot_serve(snapshot_t *s, int serve)
+{
+    pthread_mutex_lock(&s->mtx);
+    if (s->serve & serve) {
+        return true;
+    }
+    pthread_mutex_unlock(&s->mtx);
+    return false;
+}
+
+static UT_icd node_info_icd = {
+    sizeof(neu_persist_node_info_t),
+    NULL,
+    NULL,
+    (dtor_f *) neu_persist_node_info_fini,
+};
+
+static UT_icd group_tags_icd = {
+    sizeof(neu_persist_group_tags_t),
+    NULL,
+    NULL,
+    (dtor_f *) neu_persist_group_tags_fini,
+};
+
+static UT_icd subscription_info_icd = {
+    sizeof(neu_persist_subscription_info_t),
+    NULL,
+    NULL,
+    (dtor_f *) neu_persist_subscription_info_fini,
+};
+
+static void snapshot_destroy(neu_persister_t *self)
+{
+    snapshot_t *      s   = (snapshot_t *) self;
+    snapshot_header_t hdr = { 0 };
+    buf_t             b   = { 0 };
+
+    pthread_mutex_lock(&s->mtx);
+    s->quit = true;
+    pthread_cond_signal(&s->cond);
+    pthread_mutex_unlock(&s->mtx);
+    pthread_join(s->thread, NULL);
+
+    // the database file only settles once closed, so stat it afterwards
+    int rv = get_schema(s->impl->vtbl->native_handle(s->impl), hdr.schema,
+                        sizeof(hdr.schema));
+    if (0 == rv) {
+        rv = build_payload(s->impl, &b);
+    }
+    s->impl->vtbl->destroy(s->impl);
+
+    snapshot_unmap(s);
+    if (0 == rv && 0 == write_snapshot(&hdr, &b) &&
+        0 == rename(SNAPSHOT_TMP_FILE, SNAPSHOT_FILE)) {
+        nlog_notice("snapshot `%s` written, %zu bytes", SNAPSHOT_FILE, b.len);
+    }
+    free(b.data);
+
+    pthread_cond_destroy(&s->cond);
+    pthread_mutex_destroy(&s->mtx);
+    free(s);
+}
+
+static void *snapshot_native_handle(neu_persister_t *self)
+{
+    snapshot_t *s = (snapshot_t *) self;
+    return s->impl->vtbl->native_handle(s->impl);
+}
+
+static int snapshot_flush(neu_persister_t *self)
+{
+    snapshot_t *s = (snapshot_t *) self;
+    return s->impl->vtbl->flush ? s->impl->vtbl->flush(s->impl) : 0;
+}
+
+static int snapshot_store_node(neu_persister_t *        self,
+                               neu_persist_node_info_t *info)
+{
+    snapshot_t *s = (snapshot_t *) self;
+    snapshot_touch(s, SERVE_ALL);
+    return s->impl->vtbl->store_node(s->impl, info);
+}
+
+static int snapshot_load_nodes(neu_persister_t *self, UT_array **infos)
+{
+    snapshot_t *s = (snapshot_t *) self;
+
+    if (!snapshot_serve(s, SERVE_NODES)) {
+        return s->impl->vtbl->load_nodes(s->impl, infos);
+    }
+
+    utarray_new(*infos, &node_info_icd);
+    for (uint32_t i = 0; i < s->n_node; ++i) {
+        neu_persist_node_info_t info = {
+            .name        = strdup(s->nodes[i].name),
+            .type        = s->nodes[i].type,
+            .plugin_name = strdup(s->nodes[i].plugin),
+            .state       = s->nodes[i].state,
+        };
+        utarray_push_back(*infos, &info);
+    }
+    pthread_mutex_unlock(&s->mtx);
+
+    return 0;
+}
+
+static int snapshot_delete_node(neu_persister_t *self, const char *name)
+{
+    snapshot_t *s = (snapshot_t *) self;
+    snapshot_touch(s, SERVE_ALL);
+    return s->impl->vtbl->delete_node(s->impl, name);
+}
+
+static int snapshot_update_node(neu_persister_t *self, const char *name,
+                                const char *new_name)
+{
+    snapshot_t *s = (snapshot_t *) self;
+    snapshot_touch(s, SERVE_ALL);
+    return s->impl->vtbl->update_node(s->impl, name, new_name);
+}
+
+static int snapshot_update_node_state(neu_persister_t *self, const char *name,
+                                      int state)
+{
+    snapshot_t *s = (snapshot_t *) self;
+    snapshot_touch(s, SERVE_NODES);
+    return s->impl->vtbl->update_node_state(s->impl, name, state);
+}
+
+static int snapshot_store_node_setting(neu_persister_t *self, const char *name,
+                                       const char *setting)
+{
+    snapshot_t *s = (snapshot_t *) self;
+    snapshot_touch(s, SERVE_SETTINGS);
+    return s->impl->vtbl->store_node_setting(s->impl, name, setting);
+}
+
+static int snapshot_load_node_setting(neu_persister_t *  self,
+                                      const char *       name,
+                                      const char **const setting)
+{
+    snapshot_t *s = (snapshot_t *) self;
+
+    if (!snapshot_serve(s, SERVE_SETTINGS)) {
+        return s->impl->vtbl->load_node_setting(s->impl, name, setting);
+    }
+
+    int              rv   = NEU_ERR_EINTERNAL;
+    snapshot_node_t *node = find_node(s, name);
+    if (NULL != node && NULL != node->setting) {
+        *setting = strdup(node->setting);
+        rv       = NULL != *setting ? 0 : NEU_ERR_EINTERNAL;
+    }
+    pthread_mutex_unlock(&s->mtx);
+
+    return rv;
+}
+
+static int snapshot_delete_node_setting(neu_persister_t *self,
+                                        const char *     name)
+{
+    snapshot_t *s = (snapshot_t *) self;
+    snapshot_touch(s, SERVE_SETTINGS);
+    return s->impl->vtbl->delete_node_setting(s->impl, name);
+}
+
+static int snapshot_store_tag(neu_persister_t *self, const char *driver,
+                              const char *group, const neu_datatag_t *tag)
+{
+    snapshot_t *s = (snapshot_t *) self;
+    snapshot_touch(s, SERVE_TAGS);
+    return s->impl->vtbl->store_tag(s->impl, driver, group, tag);
+}
+
+static int snapshot_store_tags(neu_persister_t *self, const char *driver,
+                               const char *group, const neu_datatag_t *tags,
+                               size_t n)
+{
+    snapshot_t *s = (snapshot_t *) self;
+    snapshot_touch(s, SERVE_TAGS);
+    return s->impl->vtbl->store_tags(s->impl, driver, group, tags, n);
+}
+
+static int snapshot_load_tags(neu_persister_t *self, const char *driver,
+                              const char *group, UT_array **tags)
+{
+    snapshot_t *s = (snapshot_t *) self;
+    return s->impl->vtbl->load_tags(s->impl, driver, group, tags);
+}
+
+static int snapshot_update_tag(neu_persister_t *self, const char *driver,
+                               const char *group, const neu_datatag_t *tag)
+{
+    snapshot_t *s = (snapshot_t *) self;
+    snapshot_touch(s, SERVE_TAGS);
+    return s->impl->vtbl->update_tag(s->impl, driver, group, tag);
+}
+
+static int snapshot_update_tag_value(neu_persister_t *self, const char *driver,
+                                     const char *         group,
+                                     const neu_datatag_t *tag)
+{
+    snapshot_t *s = (snapshot_t *) self;
+    snapshot_touch(s, SERVE_TAGS);
+    return s->impl->vtbl->update_tag_value(s->impl, driver, group, tag);
+}
+
+static int snapshot_update_tag_values(neu_persister_t *self, const char *driver,
+                                      const char *         group,
+                                      const neu_datatag_t *tags, size_t n)
+{
+    snapshot_t *s = (snapshot_t *) self;
+    snapshot_touch(s, SERVE_TAGS);
+    return s->impl->vtbl->update_tag_values(s->impl, driver, group, tags, n);
+}
+
+static int snapshot_delete_tag(neu_persister_t *self, const char *driver,
+                               const char *group, const char *name)
+{
+    snapshot_t *s = (snapshot_t *) self;
+    snapshot_touch(s, SERVE_TAGS);
+    return s->impl->vtbl->delete_tag(s->impl, driver, group, name);
+}
+
+static int snapshot_store_subscription(neu_persister_t *self, const char *app,
+                                       const char *driver, const char *group,
+                                       const char *params)
+{
+    snapshot_t *s = (snapshot_t *) self;
+    snapshot_touch(s, SERVE_SUBSCRIPTIONS);
+    return s->impl->vtbl->store_subscription(s->impl, app, driver, group,
+                                             params);
+}
+
+static int snapshot_update_subscription(neu_persister_t *self, const char *app,
+                                        const char *driver, const char *group,
+                                        const char *params)
+{
+    snapshot_t *s = (snapshot_t *) self;
+    snapshot_touch(s, SERVE_SUBSCRIPTIONS);
+    return s->impl->vtbl->update_subscription(s->impl, app, driver, group,
+                                              params);
+}
+
+static int snapshot_load_subscriptions(neu_persister_t *self, const char *app,
+                                       UT_array **infos)
+{
+    snapshot_t *s = (snapshot_t *) self;
+
+    if (!snapshot_serve(s, SERVE_SUBSCRIPTIONS)) {
+        return s->impl->vtbl->load_subscriptions(s->impl, app, infos);
+    }
+
+    utarray_new(*infos, &subscription_info_icd);
+    snapshot_node_t *node = find_node(s, app);
+    if (NULL != node) {
+        reader_t r = { .p   = s->payload + node->subs,
+                       .end = s->payload + s->payload_len };
+        uint32_t n = get_u32(&r);
+        for (uint32_t i = 0; i < n; ++i) {
+            neu_persist_subscription_info_t info   = { 0 };
+            const char *                    params = NULL;
+
+            info.driver_name = strdup(get_str(&r));
+            info.group_name  = strdup(get_str(&r));
+            params           = get_str(&r);
+            info.params      = params ? strdup(params) : NULL;
+            utarray_push_back(*infos, &info);
+        }
+    }
+    pthread_mutex_unlock(&s->mtx);
+
+    return 0;
+}
+
+static int snapshot_delete_subscription(neu_persister_t *self, const char *app,
+                                        const char *driver, const char *group)
+{
+    snapshot_t *s = (snapshot_t *) self;
+    snapshot_touch(s, SERVE_SUBSCRIPTIONS);
+    return s->impl->vtbl->delete_subscription(s->impl, app, driver, group);
+}
+
+static int snapshot_store_group(neu_persister_t *self, const char *driver,
+                                neu_persist_group_info_t *info)
+{
+    snapshot_t *s = (snapshot_t *) self;
+    snapshot_touch(s, SERVE_TAGS);
+    return s->impl->vtbl->store_group(s->impl, driver, info);
+}
+
+static int snapshot_update_group(neu_persister_t *self, const char *driver,
+                                 const char *              group,
+                                 neu_persist_group_info_t *info)
+{
+    // a rename cascades to the subscriptions
+    snapshot_t *s = (snapshot_t *) self;
+    snapshot_touch(s, SERVE_TAGS | SERVE_SUBSCRIPTIONS);
+    return s->impl->vtbl->update_group(s->impl, driver, group, info);
+}
+
+static int snapshot_load_groups(neu_persister_t *self, const char *driver,
+                                UT_array **infos)
+{
+    snapshot_t *s = (snapshot_t *) self;
+    return s->impl->vtbl->load_groups(s->impl, driver, infos);
+}
+
+static int snapshot_load_group_tags(neu_persister_t *self, const char *driver,
+                                    UT_array **groups)
+{
+    snapshot_t *s = (snapshot_t *) self;
+
+    if (!snapshot_serve(s, SERVE_TAGS)) {
+        return s->impl->vtbl->load_group_tags(s->impl, driver, groups);
+    }
+
+    utarray_new(*groups, &group_tags_icd);
+    snapshot_node_t *node = find_node(s, driver);
+    if (NULL != node) {
+        reader_t r = { .p   = s->payload + node->groups,
+                       .end = s->payload + s->payload_len };
+        uint32_t n_group = get_u32(&r);
+        for (uint32_t i = 0; i < n_group; ++i) {
+            neu_persist_group_tags_t info = { 0 };
+            info.name                     = strdup(get_str(&r));
+            info.interval                 = get_u32(&r);
+            utarray_new(info.tags, neu_tag_get_icd());
+            utarray_push_back(*groups, &info);
+
+            neu_persist_group_tags_t *group = utarray_back(*groups);
+            uint32_t                  n_tag = get_u32(&r);
+            utarray_reserve(group->tags, n_tag);
+            for (uint32_t j = 0; j < n_tag; ++j) {
+                neu_datatag_t  tag   = { 0 };
+                const uint8_t *value = NULL;
+                uint32_t       len   = 0;
+                get_tag(&r, &tag, &value, &len);
+                utarray_push_back(group->tags, &tag);
+                if (neu_tag_attribute_test(&tag, NEU_ATTRIBUTE_STATIC)) {
+                    neu_tag_unpack_static_value(utarray_back(group->tags),
+                                                value, len);
+                }
+            }
+        }
+    }
+    pthread_mutex_unlock(&s->mtx);
+
+    return 0;
+}
+
+static int snapshot_delete_group(neu_persister_t *self, const char *driver,
+                                 const char *group)
+{
+    // the tags and subscriptions of the group are deleted on cascade
+    snapshot_t *s = (snapshot_t *) self;
+    snapshot_touch(s, SERVE_TAGS | SERVE_SUBSCRIPTIONS);
+    return s->impl->vtbl->delete_group(s->impl, driver, group);
+}
+
+// the profiles are not part of the snapshot
+static int
+snapshot_store_group_profile(neu_persister_t *self, const char *driver,
+                             const neu_persist_group_profile_t *profile)
+{
+    snapshot_t *s = (snapshot_t *) self;
+    return s->impl->vtbl->store_group_profile(s->impl, driver, profile);
+}
+
+static int snapshot_load_group_profiles(neu_persister_t *self,
+                                        const char *driver, UT_array **profiles)
+{
+    snapshot_t *s = (snapshot_t *) self;
+    return s->impl->vtbl->load_group_profiles(s->impl, driver, profiles);
+}
+
+static int snapshot_store_user(neu_persister_t *              self,
+                               const neu_persist_user_info_t *user)
+{
+    snapshot_t *s = (snapshot_t *) self;
+    return s->impl->vtbl->store_user(s->impl, user);
+}
+
+static int snapshot_update_user(neu_persister_t *              self,
+                                const neu_persist_user_info_t *user)
+{
+    snapshot_t *s = (snapshot_t *) self;
+    return s->impl->vtbl->update_user(s->impl, user);
+}
+
+static int snapshot_load_user(neu_persister_t *self, const char *name,
+                              neu_persist_user_info_t **user_p)
+{
+    snapshot_t *s = (snapshot_t *) self;
+    return s->impl->vtbl->load_user(s->impl, name, user_p);
+}
+
+static int snapshot_delete_user(neu_persister_t *self, const char *name)
+{
+    snapshot_t *s = (snapshot_t *) self;
+    return s->impl->vtbl->delete_user(s->impl, name);
+}
+
+static struct neu_persister_vtbl_s g_snapshot_persister_vtbl = {
+    .destroy             = snapshot_destroy,
+    .native_handle       = snapshot_native_handle,
+    .flush               = snapshot_flush,
+    .store_node          = snapshot_store_node,
+    .load_nodes          = snapshot_load_nodes,
+    .delete_node         = snapshot_delete_node,
+    .update_node         = snapshot_update_node,
+    .update_node_state   = snapshot_update_node_state,
+    .store_tag           = snapshot_store_tag,
+    .store_tags          = snapshot_store_tags,
+    .load_tags           = snapshot_load_tags,
+    .update_tag          = snapshot_update_tag,
+    .update_tag_value    = snapshot_update_tag_value,
+    .update_tag_values   = snapshot_update_tag_values,
+    .delete_tag          = snapshot_delete_tag,
+    .store_subscription  = snapshot_store_subscription,
+    .update_subscription = snapshot_update_subscription,
+    .load_subscriptions  = snapshot_load_subscriptions,
+    .delete_subscription = snapshot_delete_subscription,
+    .store_group         = snapshot_store_group,
+    .update_group        = snapshot_update_group,
+    .load_groups         = snapshot_load_groups,
+    .load_group_tags     = snapshot_load_group_tags,
+    .delete_group        = snapshot_delete_group,
+    .store_group_profile = snapshot_store_group_profile,
+    .load_group_profiles = snapshot_load_group_profiles,
+    .store_node_setting  = snapshot_store_node_setting,
+    .load_node_setting   = snapshot_load_node_setting,
+    .delete_node_setting = snapshot_delete_node_setting,
+    .store_user          = snapshot_store_user,
+    .update_user         = snapshot_update_user,
+    .load_user           = snapshot_load_user,
+    .delete_user         = snapshot_delete_user,
+};
+
+neu_persister_t *neu_snapshot_persister_create(neu_persister_t *impl)
+{
+    snapshot_t *s = calloc(1, sizeof(snapshot_t));
+    if (NULL == s) {
+        return NULL;
+    }
+
+    s->vtbl = &g_snapshot_persister_vtbl;
+    s->impl = impl;
+    pthread_mutex_init(&s->mtx, NULL);
+    pthread_cond_init(&s->cond, NULL);
+
+    // without a usable snapshot, write one once the startup writes settle
+    s->dirty      = 0 != snapshot_open(s);
+    s->last_write = neu_time_ms();
+
+    if (0 != pthread_create(&s->thread, NULL, snapshot_worker, s)) {
+        nlog_error("persister create snapshot thread fail");
+        snapshot_unmap(s);
+        pthread_cond_destroy(&s->cond);
+        pthread_mutex_destroy(&s->mtx);
+        free(s);
+        return NULL;
+    }
+
+    return (neu_persister_t *) s;
+}
@@ -40,8 +40,6 @@
 
 #define PATH_MAX_SIZE 128
 
-#define DB_FILE "persistence/sqlite.db"
-
 static inline bool ends_with(const char *str, const char *suffix)
 {
     size_t m = strlen(str);
@@ -111,6 +109,110 @@ static inline int execute_sql(sqlite3 *db, const char *sql, ...)
     return rv;
 }
 
+// get the cached statement `id`, preparing `sql` on first use
+static int prepare_stmt(neu_sqlite_persister_t *persister, neu_sqlite_stmt_e id,
+                        const char *sql, sqlite3_stmt **stmt_p)
+{
+    sqlite3_stmt *stmt = persister->stmts[id];
+
+    if (NULL == stmt) {
+        int rv = sqlite3_prepare_v3(persister->db, sql, -1,
+                                    SQLITE_PREPARE_PERSISTENT, &stmt, NULL);
+        if (SQLITE_OK != rv) {
+            return rv;
+        }
+        persister->stmts[id] = stmt;
+    } else {
+        sqlite3_reset(stmt);
+        sqlite3_clear_bindings(stmt);
+    }
+
+    *stmt_p = stmt;
+    return SQLITE_OK;
+}
+
+// reset a cached statement once done, which also ends its read transaction
+static inline void release_stmt(sqlite3_stmt *stmt)
+{
+    if (NULL != stmt) {
+        sqlite3_reset(stmt);
+        sqlite3_clear_bindings(stmt);
+    }
+}
+
+// bind the arguments after `types` in order, `s` for a string, `i` for an int,
+// `l` for an int64_t, `d` for a double and `b` for a blob given as a pointer
+// and an int length, NULL when the length is 0
+static int bind_args(sqlite3_stmt *stmt, const char *types, va_list args)
+{
+    int rv = SQLITE_OK;
+
+    for (int i = 1; SQLITE_OK == rv && '\0' != *types; ++types, ++i) {
+        switch (*types) {
+        case 's':
+            rv = sqlite3_bind_text(stmt, i, va_arg(args, const char *), -1,
+                                   SQLITE_STATIC);
+            break;
+        case 'b': {
+            const void *blob = va_arg(args, const void *);
+            int         len  = va_arg(args, int);
+            if (0 == len) {
+                rv = sqlite3_bind_null(stmt, i);
+            } else {
+                rv = sqlite3_bind_blob(stmt, i, blob, len, SQLITE_STATIC);
+            }
+            break;
+        }
+        case 'i':
+            rv = sqlite3_bind_int(stmt, i, va_arg(args, int));
+            break;
+        case 'l':
+            rv = sqlite3_bind_int64(stmt, i, va_arg(args, int64_t));
+            break;
+        case 'd':
+            rv = sqlite3_bind_double(stmt, i, va_arg(args, double));
+            break;
+        default:
+            rv = SQLITE_MISUSE;
+            break;
+        }
+    }
+
+    return rv;
+}
+
+// execute the cached statement `id` of `sql` with the arguments after `types`
+static int execute_stmt(neu_sqlite_persister_t *persister, neu_sqlite_stmt_e id,
+                        const char *sql, const char *types, ...)
+{
+    sqlite3_stmt *stmt = NULL;
+    int           rv   = 0;
+
+    if (SQLITE_OK != prepare_stmt(persister, id, sql, &stmt)) {
+        nlog_error("prepare `%s` fail: %s", sql, sqlite3_errmsg(persister->db));
+        return NEU_ERR_EINTERNAL;
+    }
+
+    va_list args;
+    va_start(args, types);
+    rv = bind_args(stmt, types, args);
+    va_end(args);
+
+    if (SQLITE_OK != rv) {
+        nlog_error("bind `%s` fail: %s", sql, sqlite3_errmsg(persister->db));
+        rv = NEU_ERR_EINTERNAL;
+    } else if (SQLITE_DONE != sqlite3_step(stmt)) {
+        nlog_error("query `%s` fail: %s", sql, sqlite3_errmsg(persister->db));
+        rv = NEU_ERR_EINTERNAL;
+    } else {
+        nlog_debug("query `%s` success", sql);
+        rv = 0;
+    }
+
+    release_stmt(stmt);
+    return rv;
+}
+
 static int get_schema_version(sqlite3 *db, char **version_p, bool *dirty_p)
 {
     sqlite3_stmt *stmt  = NULL;
@@ -172,7 +274,7 @@ static int extract_schema_info(const char *file, char **version_p,
     if (NULL == version) {
         return NEU_ERR_EINTERNAL;
     }
-    strncat(version, file, n);
+    memcpy(version, file, n);
 
     n                 = strlen(sep) - 4;
     char *description = calloc(n + 1, sizeof(char));
@@ -180,7 +282,7 @@ static int extract_schema_info(const char *file, char **version_p,
         free(version);
         return NEU_ERR_EINTERNAL;
     }
-    strncat(description, sep, n);
+    memcpy(description, sep, n);
 
     *version_p     = version;
     *description_p = description;
@@ -373,12 +475,13 @@ static int apply_schemas(sqlite3 *db, const char *dir)
     return rv;
 }
 
-static inline int open_db(const char *schema_dir, sqlite3 **db_p)
+static inline int open_db(const char *file, const char *schema_dir,
+                          sqlite3 **db_p)
 {
     sqlite3 *db = NULL;
-    int      rv = sqlite3_open(DB_FILE, &db);
+    int      rv = sqlite3_open(file, &db);
     if (SQLITE_OK != rv) {
-        nlog_fatal("db `%s` fail: %s", DB_FILE, sqlite3_errstr(rv));
+        nlog_fatal("db `%s` fail: %s", file, sqlite3_errstr(rv));
         return -1;
     }
     sqlite3_busy_timeout(db, 100 * 1000);
@@ -397,6 +500,18 @@ static inline int open_db(const char *schema_dir, sqlite3 **db_p)
         return -1;
     }
 
+    // durable across a process crash, only a power loss may lose the last
+    // commits, which WAL keeps consistent
+    rv = sqlite3_exec(db, "PRAGMA synchronous=NORMAL", NULL, NULL, NULL);
+    if (rv != SQLITE_OK) {
+        nlog_warn("db synchronous NORMAL fail: %s", sqlite3_errmsg(db));
+    }
+
+    rv = sqlite3_exec(db, "PRAGMA mmap_size=67108864", NULL, NULL, NULL);
+    if (rv != SQLITE_OK) {
+        nlog_warn("db mmap_size fail: %s", sqlite3_errmsg(db));
+    }
+
     rv = apply_schemas(db, schema_dir);
     if (rv != 0) {
         nlog_fatal("db apply schemas fail");
@@ -421,6 +536,7 @@ static struct neu_persister_vtbl_s g_sqlite_persister_vtbl = {
     .load_tags           = neu_sqlite_persister_load_tags,
     .update_tag          = neu_sqlite_persister_update_tag,
     .update_tag_value    = neu_sqlite_persister_update_tag_value,
+    .update_tag_values   = neu_sqlite_persister_update_tag_values,
     .delete_tag          = neu_sqlite_persister_delete_tag,
     .store_subscription  = neu_sqlite_persister_store_subscription,
     .update_subscription = neu_sqlite_persister_update_subscription,
@@ -429,7 +545,10 @@ static struct neu_persister_vtbl_s g_sqlite_persister_vtbl = {
     .store_group         = neu_sqlite_persister_store_group,
     .update_group        = neu_sqlite_persister_update_group,
     .load_groups         = neu_sqlite_persister_load_groups,
+    .load_group_tags     = neu_sqlite_persister_load_group_tags,
     .delete_group        = neu_sqlite_persister_delete_group,
+    .store_group_profile = neu_sqlite_persister_store_group_profile,
+    .load_group_profiles = neu_sqlite_persister_load_group_profiles,
     .store_node_setting  = neu_sqlite_persister_store_node_setting,
     .load_node_setting   = neu_sqlite_persister_load_node_setting,
     .delete_node_setting = neu_sqlite_persister_delete_node_setting,
@@ -439,7 +558,8 @@ static struct neu_persister_vtbl_s g_sqlite_persister_vtbl = {
     .delete_user         = neu_sqlite_persister_delete_user,
 };
 
-neu_persister_t *neu_sqlite_persister_create(const char *schema_dir)
+static neu_persister_t *sqlite_persister_create(const char *file,
+                                                const char *schema_dir)
 {
     neu_sqlite_persister_t *persister = calloc(1, sizeof(*persister));
     if (NULL == persister) {
@@ -448,7 +568,7 @@ neu_persister_t *neu_sqlite_persister_create(const char *schema_dir)
 
     persister->vtbl = &g_sqlite_persister_vtbl;
 
-    if (0 != open_db(schema_dir, &persister->db)) {
+    if (0 != open_db(file, schema_dir, &persister->db)) {
         free(persister);
         return NULL;
     }
@@ -456,6 +576,16 @@ neu_persister_t *neu_sqlite_persister_create(const char *schema_dir)
     return (neu_persister_t *) persister;
 }
 
+neu_persister_t *neu_sqlite_persister_create(const char *schema_dir)
+{
+    return sqlite_persister_create(DB_FILE, schema_dir);
+}
+
+neu_persister_t *neu_sqlite_persister_create_memory(const char *schema_dir)
+{
+    return sqlite_persister_create(":memory:", schema_dir);
+}
+
 void *neu_sqlite_persister_native_handle(neu_persister_t *self)
 {
     return ((neu_sqlite_persister_t *) self)->db;
@@ -465,6 +595,9 @@ void neu_sqlite_persister_destroy(neu_persister_t *self)
 {
     neu_sqlite_persister_t *persister = (neu_sqlite_persister_t *) self;
     if (persister) {
+        for (int i = 0; i < NEU_SQLITE_STMT_MAX; ++i) {
+            sqlite3_finalize(persister->stmts[i]);
+        }
         sqlite3_close(persister->db);
         free(persister);
     }
@@ -473,12 +606,12 @@ void neu_sqlite_persister_destroy(neu_persister_t *self)
 int neu_sqlite_persister_store_node(neu_persister_t *        self,
                                     neu_persist_node_info_t *info)
 {
-    int rv = 0;
-    rv     = execute_sql(((neu_sqlite_persister_t *) self)->db,
-                     "INSERT INTO nodes (name, type, state, plugin_name) "
-                     "VALUES (%Q, %i, %i, %Q)",
-                     info->name, info->type, info->state, info->plugin_name);
-    return rv;
+    return execute_stmt((neu_sqlite_persister_t *) self,
+                        NEU_SQLITE_STMT_STORE_NODE,
+                        "INSERT INTO nodes (name, type, state, plugin_name) "
+                        "VALUES (?, ?, ?, ?)",
+                        "siis", info->name, info->type, info->state,
+                        info->plugin_name);
 }
 
 static UT_icd node_info_icd = {
@@ -500,7 +633,7 @@ int neu_sqlite_persister_load_nodes(neu_persister_t *self,
     utarray_new(*node_infos, &node_info_icd);
 
     if (SQLITE_OK !=
-        sqlite3_prepare_v2(persister->db, query, -1, &stmt, NULL)) {
+        prepare_stmt(persister, NEU_SQLITE_STMT_LOAD_NODES, query, &stmt)) {
         nlog_error("prepare `%s` fail: %s", query,
                    sqlite3_errmsg(persister->db));
         utarray_free(*node_infos);
@@ -536,7 +669,7 @@ int neu_sqlite_persister_load_nodes(neu_persister_t *self,
         // do not set return code, return partial or empty result
     }
 
-    sqlite3_finalize(stmt);
+    release_stmt(stmt);
     return rv;
 }
 
@@ -545,8 +678,9 @@ int neu_sqlite_persister_delete_node(neu_persister_t *self,
 {
     // rely on foreign key constraints to remove settings, groups, tags and
     // subscriptions
-    int rv = execute_sql(((neu_sqlite_persister_t *) self)->db,
-                         "DELETE FROM nodes WHERE name=%Q;", node_name);
+    int rv = execute_stmt((neu_sqlite_persister_t *) self,
+                          NEU_SQLITE_STMT_DELETE_NODE,
+                          "DELETE FROM nodes WHERE name=?", "s", node_name);
     return rv;
 }
 
@@ -554,107 +688,128 @@ int neu_sqlite_persister_update_node(neu_persister_t *self,
                                      const char *     node_name,
                                      const char *     new_name)
 {
-    return execute_sql(((neu_sqlite_persister_t *) self)->db,
-                       "UPDATE nodes SET name=%Q WHERE name=%Q;", new_name,
-                       node_name);
+    return execute_stmt((neu_sqlite_persister_t *) self,
+                        NEU_SQLITE_STMT_UPDATE_NODE,
+                        "UPDATE nodes SET name=? WHERE name=?", "ss", new_name,
+                        node_name);
 }
 
 int neu_sqlite_persister_update_node_state(neu_persister_t *self,
                                            const char *node_name, int state)
 {
-    return execute_sql(((neu_sqlite_persister_t *) self)->db,
-                       "UPDATE nodes SET state=%i WHERE name=%Q;", state,
-                       node_name);
+    return execute_stmt((neu_sqlite_persister_t *) self,
+                        NEU_SQLITE_STMT_UPDATE_NODE_STATE,
+                        "UPDATE nodes SET state=? WHERE name=?", "is", state,
+                        node_name);
 }
 
-int neu_sqlite_persister_store_tag(neu_persister_t *    self,
-                                   const char *         driver_name,
-                                   const char *         group_name,
-                                   const neu_datatag_t *tag)
+#define STORE_TAG_SQL_HEAD                                \
+    "INSERT INTO tags ("                                  \
+    " driver_name, group_name, name, address, attribute," \
+    " precision, type, decimal, description, value,"      \
+    " deadband, poll_divisor"                             \
+    ") VALUES "
+// the driver and group are shared by all rows of a statement
+#define STORE_TAG_SQL_ROW "(?1, ?2, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)"
+#define STORE_TAG_SQL_ROWS_2 STORE_TAG_SQL_ROW "," STORE_TAG_SQL_ROW
+#define STORE_TAG_SQL_ROWS_4 STORE_TAG_SQL_ROWS_2 "," STORE_TAG_SQL_ROWS_2
+#define STORE_TAG_SQL_ROWS_8 STORE_TAG_SQL_ROWS_4 "," STORE_TAG_SQL_ROWS_4
+#define STORE_TAG_SQL_ROWS_16 STORE_TAG_SQL_ROWS_8 "," STORE_TAG_SQL_ROWS_8
+#define STORE_TAG_SQL_ROWS_32 STORE_TAG_SQL_ROWS_16 "," STORE_TAG_SQL_ROWS_16
+#define STORE_TAG_SQL_ROWS_64 STORE_TAG_SQL_ROWS_32 "," STORE_TAG_SQL_ROWS_32
+
+// rows inserted by one statement, 2 + 10 * 64 parameters stay below the
+// historical SQLITE_MAX_VARIABLE_NUMBER of 999
+#define STORE_TAGS_CHUNK 64
+
+static const char *store_tag_sql  = STORE_TAG_SQL_HEAD STORE_TAG_SQL_ROW;
+static const char *store_tags_sql = STORE_TAG_SQL_HEAD STORE_TAG_SQL_ROWS_64;
+
+// bind the tag columns of row `row`, `val` should live until the step
+static int bind_tag(sqlite3_stmt *stmt, int row, const neu_datatag_t *tag,
+                    const uint8_t *val, size_t val_len)
 {
-    char *val_str = neu_tag_dump_static_value(tag);
-    int   rv      = execute_sql(((neu_sqlite_persister_t *) self)->db,
-                         "INSERT INTO tags ("
-                         " driver_name, group_name, name, address, attribute,"
-                         " precision, type, decimal, description, value"
-                         ") VALUES (%Q, %Q, %Q, %Q, %i, %i, %i, %lf, %Q, %Q)",
-                         driver_name, group_name, tag->name, tag->address,
-                         tag->attribute, tag->precision, tag->type,
-                         tag->decimal, tag->description, val_str);
-
-    free(val_str);
+    int   col      = 3 + row * 10;
+    char *deadband = neu_tag_dump_deadband(&tag->deadband);
+    int   rv       = 0;
+
+    if (SQLITE_OK != sqlite3_bind_text(stmt, col, tag->name, -1, NULL) ||
+        SQLITE_OK != sqlite3_bind_text(stmt, col + 1, tag->address, -1, NULL) ||
+        SQLITE_OK != sqlite3_bind_int(stmt, col + 2, tag->attribute) ||
+        SQLITE_OK != sqlite3_bind_int(stmt, col + 3, tag->precision) ||
+        SQLITE_OK != sqlite3_bind_int(stmt, col + 4, tag->type) ||
+        SQLITE_OK != sqlite3_bind_double(stmt, col + 5, tag->decimal) ||
+        SQLITE_OK !=
+            sqlite3_bind_text(stmt, col + 6, tag->description, -1, NULL) ||
+        SQLITE_OK !=
+            (0 == val_len
+                 ? sqlite3_bind_null(stmt, col + 7)
+                 : sqlite3_bind_blob(stmt, col + 7, val, val_len, NULL)) ||
+        SQLITE_OK !=
+            sqlite3_bind_text(stmt, col + 8, deadband, -1, SQLITE_TRANSIENT) ||
+        SQLITE_OK != sqlite3_bind_int(stmt, col + 9, tag->poll_divisor)) {
+        rv = -1;
+    }
+
+    free(deadband);
     return rv;
 }
 
-static int put_tags(sqlite3 *db, const char *query, sqlite3_stmt *stmt,
-                    const neu_datatag_t *tags, size_t n)
+// insert `n` tags, at most STORE_TAGS_CHUNK, with the cached statement `id`
+static int put_tags(neu_sqlite_persister_t *persister, neu_sqlite_stmt_e id,
+                    const char *query, const char *driver_name,
+                    const char *group_name, const neu_datatag_t *tags,
+                    size_t n)
 {
-    for (size_t i = 0; i < n; ++i) {
-        const neu_datatag_t *tag = &tags[i];
-
-        sqlite3_reset(stmt);
-
-        if (SQLITE_OK != sqlite3_bind_text(stmt, 3, tag->name, -1, NULL)) {
-            nlog_error("bind `%s` with name=`%s` fail: %s", query, tag->name,
-                       sqlite3_errmsg(db));
-            return -1;
-        }
-
-        if (SQLITE_OK != sqlite3_bind_text(stmt, 4, tag->address, -1, NULL)) {
-            nlog_error("bind `%s` with address=`%s` fail: %s", query,
-                       tag->address, sqlite3_errmsg(db));
-            return -1;
-        }
-
-        if (SQLITE_OK != sqlite3_bind_int(stmt, 5, tag->attribute)) {
-            nlog_error("bind `%s` with attribute=`%i` fail: %s", query,
-                       tag->attribute, sqlite3_errmsg(db));
-            return -1;
-        }
-
-        if (SQLITE_OK != sqlite3_bind_int(stmt, 6, tag->precision)) {
-            nlog_error("bind `%s` with precision=`%i` fail: %s", query,
-                       tag->precision, sqlite3_errmsg(db));
-            return -1;
-        }
+    sqlite3_stmt *stmt = NULL;
+    int           rv   = -1;
+    // static values, bound as blobs in place until the statement is stepped
+    uint8_t vals[STORE_TAGS_CHUNK][NEU_TAG_STATIC_VALUE_BIN_SIZE];
 
-        if (SQLITE_OK != sqlite3_bind_int(stmt, 7, tag->type)) {
-            nlog_error("bind `%s` with type=`%i` fail: %s", query, tag->type,
-                       sqlite3_errmsg(db));
-            return -1;
-        }
+    if (SQLITE_OK != prepare_stmt(persister, id, query, &stmt)) {
+        nlog_error("prepare `%s` fail: %s", query,
+                   sqlite3_errmsg(persister->db));
+        return -1;
+    }
 
-        if (SQLITE_OK != sqlite3_bind_double(stmt, 8, tag->decimal)) {
-            nlog_error("bind `%s` with decimal=`%f` fail: %s", query,
-                       tag->decimal, sqlite3_errmsg(db));
-            return -1;
-        }
+    if (SQLITE_OK != sqlite3_bind_text(stmt, 1, driver_name, -1, NULL) ||
+        SQLITE_OK != sqlite3_bind_text(stmt, 2, group_name, -1, NULL)) {
+        nlog_error("bind `%s` with driver_name=`%s` group_name=`%s` fail: %s",
+                   query, driver_name, group_name,
+                   sqlite3_errmsg(persister->db));
+        goto end;
+    }
 
-        if (SQLITE_OK !=
-            sqlite3_bind_text(stmt, 9, tag->description, -1, NULL)) {
-            nlog_error("bind `%s` with description=`%s` fail: %s", query,
-                       tag->description, sqlite3_errmsg(db));
-            return -1;
+    for (size_t i = 0; i < n; ++i) {
+        size_t len = neu_tag_pack_static_value(&tags[i], vals[i]);
+        if (0 != bind_tag(stmt, i, &tags[i], vals[i], len)) {
+            nlog_error("bind `%s` with name=`%s` fail: %s", query,
+                       tags[i].name, sqlite3_errmsg(persister->db));
+            goto end;
         }
+    }
 
-        char *val_str = neu_tag_dump_static_value(tag);
-        if (SQLITE_OK != sqlite3_bind_text(stmt, 10, val_str, -1, NULL)) {
-            nlog_error("bind `%s` with value=`%s` fail: %s", query, val_str,
-                       sqlite3_errmsg(db));
-            free(val_str);
-            return -1;
-        }
+    if (SQLITE_DONE != sqlite3_step(stmt)) {
+        nlog_error("sqlite3_step fail: %s", sqlite3_errmsg(persister->db));
+        goto end;
+    }
 
-        if (SQLITE_DONE != sqlite3_step(stmt)) {
-            nlog_error("sqlite3_step fail: %s", sqlite3_errmsg(db));
-            free(val_str);
-            return -1;
-        }
+    rv = 0;
 
-        free(val_str);
-    }
+end:
+    release_stmt(stmt);
+    return rv;
+}
 
-    return 0;
+int neu_sqlite_persister_store_tag(neu_persister_t *    self,
+                                   const char *         driver_name,
+                                   const char *         group_name,
+                                   const neu_datatag_t *tag)
+{
+    int rv =
+        put_tags((neu_sqlite_persister_t *) self, NEU_SQLITE_STMT_STORE_TAG,
+                 store_tag_sql, driver_name, group_name, tag, 1);
+    return 0 == rv ? 0 : NEU_ERR_EINTERNAL;
 }
 
 int neu_sqlite_persister_store_tags(neu_persister_t *    self,
@@ -664,75 +819,83 @@ int neu_sqlite_persister_store_tags(neu_persister_t *    self,
 {
     neu_sqlite_persister_t *persister = (neu_sqlite_persister_t *) self;
 
-    sqlite3_stmt *stmt  = NULL;
-    const char *  query = "INSERT INTO tags ("
-                        " driver_name, group_name, name, address, attribute,"
-                        " precision, type, decimal, description, value"
-                        ") VALUES (?1, ?2, ?3, ?4, ?5, ?6, ?7, ?8, ?9, ?10)";
-
-    if (SQLITE_OK != sqlite3_exec(persister->db, "BEGIN", NULL, NULL, NULL)) {
+    // a savepoint, so that it also nests in a transaction of the caller
+    if (SQLITE_OK !=
+        sqlite3_exec(persister->db, "SAVEPOINT store_tags", NULL, NULL,
+                     NULL)) {
         nlog_error("begin transaction fail: %s", sqlite3_errmsg(persister->db));
         return NEU_ERR_EINTERNAL;
     }
 
-    if (SQLITE_OK !=
-        sqlite3_prepare_v2(persister->db, query, -1, &stmt, NULL)) {
-        nlog_error("prepare `%s` fail: %s", query,
-                   sqlite3_errmsg(persister->db));
-        goto error;
-    }
-
-    if (SQLITE_OK != sqlite3_bind_text(stmt, 1, driver_name, -1, NULL)) {
-        nlog_error("bind `%s` with driver_name=`%s` fail: %s", query,
-                   driver_name, sqlite3_errmsg(persister->db));
-        goto error;
-    }
-
-    if (SQLITE_OK != sqlite3_bind_text(stmt, 2, group_name, -1, NULL)) {
-        nlog_error("bind `%s` with group_name=`%s` fail: %s", query, group_name,
-                   sqlite3_errmsg(persister->db));
-        goto error;
+    // full chunks in multi-row inserts, the rest row by row
+    size_t i = 0;
+    for (; i + STORE_TAGS_CHUNK <= n; i += STORE_TAGS_CHUNK) {
+        if (0 !=
+            put_tags(persister, NEU_SQLITE_STMT_STORE_TAGS, store_tags_sql,
+                     driver_name, group_name, &tags[i], STORE_TAGS_CHUNK)) {
+            goto error;
+        }
     }
-
-    if (0 != put_tags(persister->db, query, stmt, tags, n)) {
-        goto error;
+    for (; i < n; ++i) {
+        if (0 !=
+            put_tags(persister, NEU_SQLITE_STMT_STORE_TAG, store_tag_sql,
+                     driver_name, group_name, &tags[i], 1)) {
+            goto error;
+        }
     }
 
-    if (SQLITE_OK != sqlite3_exec(persister->db, "COMMIT", NULL, NULL, NULL)) {
+    if (SQLITE_OK !=
+        sqlite3_exec(persister->db, "RELEASE store_tags", NULL, NULL, NULL)) {
         nlog_error("commit transaction fail: %s",
                    sqlite3_errmsg(persister->db));
         goto error;
     }
 
-    sqlite3_finalize(stmt);
     return 0;
 
 error:
     nlog_warn("rollback transaction");
-    sqlite3_exec(persister->db, "ROLLBACK", NULL, NULL, NULL);
-    sqlite3_finalize(stmt);
+    sqlite3_exec(persister->db, "ROLLBACK TO store_tags", NULL, NULL, NULL);
+    sqlite3_exec(persister->db, "RELEASE store_tags", NULL, NULL, NULL);
     return NEU_ERR_EINTERNAL;
 }
 
+// push the tag in the columns starting at `col` of the current row
+static void push_tag_info(sqlite3_stmt *stmt, int col, UT_array *tags)
+{
+    neu_datatag_t tag = {
+        .name         = (char *) sqlite3_column_text(stmt, col),
+        .address      = (char *) sqlite3_column_text(stmt, col + 1),
+        .attribute    = sqlite3_column_int(stmt, col + 2),
+        .precision    = sqlite3_column_int64(stmt, col + 3),
+        .type         = sqlite3_column_int(stmt, col + 4),
+        .decimal      = sqlite3_column_double(stmt, col + 5),
+        .description  = (char *) sqlite3_column_text(stmt, col + 6),
+        .poll_divisor = sqlite3_column_int(stmt, col + 9),
+    };
+    neu_tag_load_deadband(&tag.deadband,
+                          (char *) sqlite3_column_text(stmt, col + 8));
+    utarray_push_back(tags, &tag);
+    if (!neu_tag_attribute_test(&tag, NEU_ATTRIBUTE_STATIC)) {
+        return;
+    }
+
+    // values stored before the binary encoding are json text
+    if (SQLITE_BLOB == sqlite3_column_type(stmt, col + 7)) {
+        neu_tag_unpack_static_value(utarray_back(tags),
+                                    sqlite3_column_blob(stmt, col + 7),
+                                    sqlite3_column_bytes(stmt, col + 7));
+    } else {
+        neu_tag_load_static_value(utarray_back(tags),
+                                  (char *) sqlite3_column_text(stmt, col + 7));
+    }
+}
+
 static int collect_tag_info(sqlite3_stmt *stmt, UT_array **tags)
 {
     int step = sqlite3_step(stmt);
     while (SQLITE_ROW == step) {
-        neu_datatag_t tag = {
-            .name        = (char *) sqlite3_column_text(stmt, 0),
-            .address     = (char *) sqlite3_column_text(stmt, 1),
-            .attribute   = sqlite3_column_int(stmt, 2),
-            .precision   = sqlite3_column_int64(stmt, 3),
-            .type        = sqlite3_column_int(stmt, 4),
-            .decimal     = sqlite3_column_double(stmt, 5),
-            .description = (char *) sqlite3_column_text(stmt, 6),
-        };
-        utarray_push_back(*tags, &tag);
-        if (neu_tag_attribute_test(&tag, NEU_ATTRIBUTE_STATIC)) {
-            neu_tag_load_static_value(utarray_back(*tags),
-                                      (char *) sqlite3_column_text(stmt, 7));
-        }
-
+        push_tag_info(stmt, 0, *tags);
         step = sqlite3_step(stmt);
     }
 
@@ -751,14 +914,15 @@ int neu_sqlite_persister_load_tags(neu_persister_t *self,
 
     sqlite3_stmt *stmt  = NULL;
     const char *  query = "SELECT name, address, attribute, precision, type, "
-                        "decimal, description, value "
+                        "decimal, description, value, deadband, "
+                        "poll_divisor "
                         "FROM tags WHERE driver_name=? AND group_name=? "
                         "ORDER BY rowid ASC";
 
     utarray_new(*tags, neu_tag_get_icd());
 
     if (SQLITE_OK !=
-        sqlite3_prepare_v2(persister->db, query, -1, &stmt, NULL)) {
+        prepare_stmt(persister, NEU_SQLITE_STMT_LOAD_TAGS, query, &stmt)) {
         nlog_error("prepare `%s` fail: %s", query,
                    sqlite3_errmsg(persister->db));
         goto error;
@@ -781,7 +945,7 @@ int neu_sqlite_persister_load_tags(neu_persister_t *self,
         // do not set return code, return partial or empty result
     }
 
-    sqlite3_finalize(stmt);
+    release_stmt(stmt);
     return 0;
 
 error:
@@ -795,16 +959,20 @@ int neu_sqlite_persister_update_tag(neu_persister_t *    self,
                                     const char *         group_name,
                                     const neu_datatag_t *tag)
 {
-    char *val_str = neu_tag_dump_static_value(tag);
-    int   rv      = execute_sql(((neu_sqlite_persister_t *) self)->db,
-                         "UPDATE tags SET"
-                         " address=%Q, attribute=%i, precision=%i, type=%i,"
-                         " decimal=%lf, description=%Q, value=%Q "
-                         "WHERE driver_name=%Q AND group_name=%Q AND name=%Q",
-                         tag->address, tag->attribute, tag->precision,
-                         tag->type, tag->decimal, tag->description, val_str,
-                         driver_name, group_name, tag->name);
-    free(val_str);
+    uint8_t val[NEU_TAG_STATIC_VALUE_BIN_SIZE];
+    int     len      = neu_tag_pack_static_value(tag, val);
+    char *  deadband = neu_tag_dump_deadband(&tag->deadband);
+
+    int rv = execute_stmt(
+        (neu_sqlite_persister_t *) self, NEU_SQLITE_STMT_UPDATE_TAG,
+        "UPDATE tags SET"
+        " address=?, attribute=?, precision=?, type=?,"
+        " decimal=?, description=?, value=?, deadband=?, poll_divisor=? "
+        "WHERE driver_name=? AND group_name=? AND name=?",
+        "siiidsbsisss", tag->address, tag->attribute, tag->precision,
+        tag->type, tag->decimal, tag->description, val, len, deadband,
+        tag->poll_divisor, driver_name, group_name, tag->name);
+    free(deadband);
     return rv;
 }
 
@@ -813,13 +981,55 @@ int neu_sqlite_persister_update_tag_value(neu_persister_t *    self,
                                           const char *         group_name,
                                           const neu_datatag_t *tag)
 {
-    char *val_str = neu_tag_dump_static_value(tag);
-    int   rv      = execute_sql(((neu_sqlite_persister_t *) self)->db,
-                         "UPDATE tags SET value=%Q "
-                         "WHERE driver_name=%Q AND group_name=%Q AND name=%Q",
-                         val_str, driver_name, group_name, tag->name);
-    free(val_str);
-    return rv;
+    uint8_t val[NEU_TAG_STATIC_VALUE_BIN_SIZE];
+    int     len = neu_tag_pack_static_value(tag, val);
+
+    return execute_stmt(
+        (neu_sqlite_persister_t *) self, NEU_SQLITE_STMT_UPDATE_TAG_VALUE,
+        "UPDATE tags SET value=? "
+        "WHERE driver_name=? AND group_name=? AND name=?",
+        "bsss", val, len, driver_name, group_name, tag->name);
+}
+
+int neu_sqlite_persister_update_tag_values(neu_persister_t *    self,
+                                           const char *         driver_name,
+                                           const char *         group_name,
+                                           const neu_datatag_t *tags, size_t n)
+{
+    neu_sqlite_persister_t *persister = (neu_sqlite_persister_t *) self;
+
+    // a savepoint, so that it also nests in a transaction of the caller
+    if (SQLITE_OK !=
+        sqlite3_exec(persister->db, "SAVEPOINT update_tag_values", NULL, NULL,
+                     NULL)) {
+        nlog_error("begin transaction fail: %s", sqlite3_errmsg(persister->db));
+        return NEU_ERR_EINTERNAL;
+    }
+
+    for (size_t i = 0; i < n; ++i) {
+        if (0 !=
+            neu_sqlite_persister_update_tag_value(self, driver_name,
+                                                  group_name, &tags[i])) {
+            goto error;
+        }
+    }
+
+    if (SQLITE_OK !=
+        sqlite3_exec(persister->db, "RELEASE update_tag_values", NULL, NULL,
+                     NULL)) {
+        nlog_error("commit transaction fail: %s",
+                   sqlite3_errmsg(persister->db));
+        goto error;
+    }
+
+    return 0;
+
+error:
+    nlog_warn("rollback transaction");
+    sqlite3_exec(persister->db, "ROLLBACK TO update_tag_values", NULL, NULL,
+                 NULL);
+    sqlite3_exec(persister->db, "RELEASE update_tag_values", NULL, NULL, NULL);
+    return NEU_ERR_EINTERNAL;
 }
 
 int neu_sqlite_persister_delete_tag(neu_persister_t *self,
@@ -827,10 +1037,10 @@ int neu_sqlite_persister_delete_tag(neu_persister_t *self,
                                     const char *     group_name,
                                     const char *     tag_name)
 {
-    int rv = execute_sql(
-        ((neu_sqlite_persister_t *) self)->db,
-        "DELETE FROM tags WHERE driver_name=%Q AND group_name=%Q AND name=%Q",
-        driver_name, group_name, tag_name);
+    int rv = execute_stmt(
+        (neu_sqlite_persister_t *) self, NEU_SQLITE_STMT_DELETE_TAG,
+        "DELETE FROM tags WHERE driver_name=? AND group_name=? AND name=?",
+        "sss", driver_name, group_name, tag_name);
     return rv;
 }
 
@@ -840,11 +1050,11 @@ int neu_sqlite_persister_store_subscription(neu_persister_t *self,
                                             const char *     group_name,
                                             const char *     params)
 {
-    return execute_sql(
-        ((neu_sqlite_persister_t *) self)->db,
+    return execute_stmt(
+        (neu_sqlite_persister_t *) self, NEU_SQLITE_STMT_STORE_SUBSCRIPTION,
         "INSERT INTO subscriptions (app_name, driver_name, group_name, params) "
-        "VALUES (%Q, %Q, %Q, %Q)",
-        app_name, driver_name, group_name, params);
+        "VALUES (?, ?, ?, ?)",
+        "ssss", app_name, driver_name, group_name, params);
 }
 
 int neu_sqlite_persister_update_subscription(neu_persister_t *self,
@@ -853,10 +1063,11 @@ int neu_sqlite_persister_update_subscription(neu_persister_t *self,
                                              const char *     group_name,
                                              const char *     params)
 {
-    return execute_sql(((neu_sqlite_persister_t *) self)->db,
-                       "UPDATE subscriptions SET params=%Q "
-                       "WHERE app_name=%Q AND driver_name=%Q AND group_name=%Q",
-                       params, app_name, driver_name, group_name);
+    return execute_stmt((neu_sqlite_persister_t *) self,
+                        NEU_SQLITE_STMT_UPDATE_SUBSCRIPTION,
+                        "UPDATE subscriptions SET params=? "
+                        "WHERE app_name=? AND driver_name=? AND group_name=?",
+                        "ssss", params, app_name, driver_name, group_name);
 }
 
 static UT_icd subscription_info_icd = {
@@ -879,7 +1090,8 @@ int neu_sqlite_persister_load_subscriptions(neu_persister_t *self,
     utarray_new(*subscription_infos, &subscription_info_icd);
 
     if (SQLITE_OK !=
-        sqlite3_prepare_v2(persister->db, query, -1, &stmt, NULL)) {
+        prepare_stmt(persister, NEU_SQLITE_STMT_LOAD_SUBSCRIPTIONS, query,
+                     &stmt)) {
         nlog_error("prepare `%s` fail: %s", query,
                    sqlite3_errmsg(persister->db));
         goto error;
@@ -927,7 +1139,7 @@ int neu_sqlite_persister_load_subscriptions(neu_persister_t *self,
         // do not set return code, return partial or empty result
     }
 
-    sqlite3_finalize(stmt);
+    release_stmt(stmt);
     return 0;
 
 error:
@@ -941,20 +1153,21 @@ int neu_sqlite_persister_delete_subscription(neu_persister_t *self,
                                              const char *     driver_name,
                                              const char *     group_name)
 {
-    return execute_sql(((neu_sqlite_persister_t *) self)->db,
-                       "DELETE FROM subscriptions WHERE app_name=%Q AND "
-                       "driver_name=%Q AND group_name=%Q",
-                       app_name, driver_name, group_name);
+    return execute_stmt((neu_sqlite_persister_t *) self,
+                        NEU_SQLITE_STMT_DELETE_SUBSCRIPTION,
+                        "DELETE FROM subscriptions WHERE app_name=? AND "
+                        "driver_name=? AND group_name=?", "sss", app_name,
+                        driver_name, group_name);
 }
 
 int neu_sqlite_persister_store_group(neu_persister_t *         self,
                                      const char *              driver_name,
                                      neu_persist_group_info_t *group_info)
 {
-    return execute_sql(
-        ((neu_sqlite_persister_t *) self)->db,
-        "INSERT INTO groups (driver_name, name, interval) VALUES (%Q, %Q, %u)",
-        driver_name, group_info->name, (unsigned) group_info->interval);
+    return execute_stmt(
+        (neu_sqlite_persister_t *) self, NEU_SQLITE_STMT_STORE_GROUP,
+        "INSERT INTO groups (driver_name, name, interval) VALUES (?, ?, ?)",
+        "ssi", driver_name, group_info->name, (int) group_info->interval);
 }
 
 int neu_sqlite_persister_update_group(neu_persister_t *         self,
@@ -969,21 +1182,21 @@ int neu_sqlite_persister_update_group(neu_persister_t *         self,
     bool update_interval = (NEU_GROUP_INTERVAL_LIMIT <= group_info->interval);
 
     if (update_name && update_interval) {
-        ret = execute_sql(persister->db,
-                          "UPDATE groups SET name=%Q, interval=%i "
-                          "WHERE driver_name=%Q AND name=%Q",
-                          group_info->name, group_info->interval, driver_name,
-                          group_name);
+        ret = execute_stmt(persister, NEU_SQLITE_STMT_UPDATE_GROUP,
+                           "UPDATE groups SET name=?, interval=? "
+                           "WHERE driver_name=? AND name=?", "siss",
+                           group_info->name, group_info->interval, driver_name,
+                           group_name);
     } else if (update_name) {
-        ret = execute_sql(persister->db,
-                          "UPDATE groups SET name=%Q "
-                          "WHERE driver_name=%Q AND name=%Q",
-                          group_info->name, driver_name, group_name);
+        ret = execute_stmt(persister, NEU_SQLITE_STMT_UPDATE_GROUP_NAME,
+                           "UPDATE groups SET name=? "
+                           "WHERE driver_name=? AND name=?", "sss",
+                           group_info->name, driver_name, group_name);
     } else if (update_interval) {
-        ret = execute_sql(persister->db,
-                          "UPDATE groups SET interval=%i "
-                          "WHERE driver_name=%Q AND name=%Q",
-                          group_info->interval, driver_name, group_name);
+        ret = execute_stmt(persister, NEU_SQLITE_STMT_UPDATE_GROUP_INTERVAL,
+                           "UPDATE groups SET interval=? "
+                           "WHERE driver_name=? AND name=?", "iss",
+                           group_info->interval, driver_name, group_name);
     }
 
     return ret;
@@ -1032,7 +1245,7 @@ int neu_sqlite_persister_load_groups(neu_persister_t *self,
     utarray_new(*group_infos, &group_info_icd);
 
     if (SQLITE_OK !=
-        sqlite3_prepare_v2(persister->db, query, -1, &stmt, NULL)) {
+        prepare_stmt(persister, NEU_SQLITE_STMT_LOAD_GROUPS, query, &stmt)) {
         nlog_error("prepare `%s` fail: %s", query,
                    sqlite3_errmsg(persister->db));
         goto error;
@@ -1049,7 +1262,7 @@ int neu_sqlite_persister_load_groups(neu_persister_t *self,
         // do not set return code, return partial or empty result
     }
 
-    sqlite3_finalize(stmt);
+    release_stmt(stmt);
     return 0;
 
 error:
@@ -1058,25 +1271,314 @@ error:
     return NEU_ERR_EINTERNAL;
 }
 
+static UT_icd group_tags_icd = {
+    sizeof(neu_persist_group_tags_t),
+    NULL,
+    NULL,
+    (dtor_f *) neu_persist_group_tags_fini,
+};
+
+static int collect_group_tags(sqlite3_stmt *stmt, UT_array **groups)
+{
+    neu_persist_group_tags_t *group = NULL;
+
+    int step = sqlite3_step(stmt);
+    while (SQLITE_ROW == step) {
+        // rows come ordered by group, a group starts with its first row
+        const char *name = (const char *) sqlite3_column_text(stmt, 0);
+        if (NULL == group || 0 != strcmp(group->name, name)) {
+            neu_persist_group_tags_t info = {
+                .name     = strdup(name),
+                .interval = sqlite3_column_int(stmt, 1),
+            };
+            if (NULL == info.name) {
+                break;
+            }
+            utarray_new(info.tags, neu_tag_get_icd());
+            utarray_push_back(*groups, &info);
+            group = utarray_back(*groups);
+        }
+
+        // a group without tags has a single row of NULL tag columns
+        if (SQLITE_NULL != sqlite3_column_type(stmt, 2)) {
+            push_tag_info(stmt, 2, group->tags);
+        }
+
+        step = sqlite3_step(stmt);
+    }
+
+    if (SQLITE_DONE != step) {
+        return -1;
+    }
+
+    return 0;
+}
+
+int neu_sqlite_persister_load_group_tags(neu_persister_t *self,
+                                         const char *     driver_name,
+                                         UT_array **      groups)
+{
+    neu_sqlite_persister_t *persister = (neu_sqlite_persister_t *) self;
+
+    sqlite3_stmt *stmt  = NULL;
+    const char *  query = "SELECT g.name, g.interval, t.name, t.address, "
+                        "t.attribute, t.precision, t.type, t.decimal, "
+                        "t.description, t.value, t.deadband, "
+                        "t.poll_divisor "
+                        "FROM groups AS g LEFT JOIN tags AS t "
+                        "ON t.driver_name=g.driver_name "
+                        "AND t.group_name=g.name "
+                        "WHERE g.driver_name=? "
+                        "ORDER BY g.rowid ASC, t.rowid ASC";
+
+    utarray_new(*groups, &group_tags_icd);
+
+    if (SQLITE_OK !=
+        prepare_stmt(persister, NEU_SQLITE_STMT_LOAD_GROUP_TAGS, query,
+                     &stmt)) {
+        nlog_error("prepare `%s` fail: %s", query,
+                   sqlite3_errmsg(persister->db));
+        goto error;
+    }
+
+    if (SQLITE_OK != sqlite3_bind_text(stmt, 1, driver_name, -1, NULL)) {
+        nlog_error("bind `%s` with `%s` fail: %s", query, driver_name,
+                   sqlite3_errmsg(persister->db));
+        goto error;
+    }
+
+    if (0 != collect_group_tags(stmt, groups)) {
+        nlog_warn("query `%s` fail: %s", query, sqlite3_errmsg(persister->db));
+        // do not set return code, return partial or empty result
+    }
+
+    release_stmt(stmt);
+    return 0;
+
+error:
+    release_stmt(stmt);
+    utarray_free(*groups);
+    *groups = NULL;
+    return NEU_ERR_EINTERNAL;
+}
+
 int neu_sqlite_persister_delete_group(neu_persister_t *self,
                                       const char *     driver_name,
                                       const char *     group_name)
 {
     // rely on foreign key constraints to delete tags and subscriptions
-    int rv = execute_sql(((neu_sqlite_persister_t *) self)->db,
-                         "DELETE FROM groups WHERE driver_name=%Q AND name=%Q",
-                         driver_name, group_name);
+    int rv = execute_stmt((neu_sqlite_persister_t *) self,
+                          NEU_SQLITE_STMT_DELETE_GROUP,
+                          "DELETE FROM groups WHERE driver_name=? AND name=?",
+                          "ss", driver_name, group_name);
     return rv;
 }
 
+static const char *store_group_profile_sql =
+    "INSERT INTO group_profiles (driver_name, group_name, reads, read_ms, "
+    "overruns, blocks, le_1_ms, le_4_ms, le_16_ms, le_64_ms, le_256_ms, "
+    "le_1024_ms, gt_1024_ms) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?) "
+    "ON CONFLICT (driver_name, group_name) DO UPDATE SET "
+    "reads=reads/2+excluded.reads, read_ms=read_ms/2+excluded.read_ms, "
+    "overruns=overruns/2+excluded.overruns, blocks=blocks/2+excluded.blocks, "
+    "le_1_ms=le_1_ms/2+excluded.le_1_ms, le_4_ms=le_4_ms/2+excluded.le_4_ms, "
+    "le_16_ms=le_16_ms/2+excluded.le_16_ms, "
+    "le_64_ms=le_64_ms/2+excluded.le_64_ms, "
+    "le_256_ms=le_256_ms/2+excluded.le_256_ms, "
+    "le_1024_ms=le_1024_ms/2+excluded.le_1024_ms, "
+    "gt_1024_ms=gt_1024_ms/2+excluded.gt_1024_ms";
+
+static const char *store_tag_profile_sql =
+    "INSERT INTO tag_profiles (driver_name, group_name, tag_name, changes) "
+    "VALUES (?, ?, ?, ?) "
+    "ON CONFLICT (driver_name, group_name, tag_name) DO UPDATE SET "
+    "changes=changes+excluded.changes";
+
+int neu_sqlite_persister_store_group_profile(
+    neu_persister_t *self, const char *driver_name,
+    const neu_persist_group_profile_t *profile)
+{
+    neu_sqlite_persister_t *persister = (neu_sqlite_persister_t *) self;
+    const char *            group     = profile->group_name;
+    const uint64_t *        latency   = profile->latency;
+
+    if (SQLITE_OK !=
+        sqlite3_exec(persister->db, "SAVEPOINT store_group_profile", NULL,
+                     NULL, NULL)) {
+        nlog_error("begin transaction fail: %s", sqlite3_errmsg(persister->db));
+        return NEU_ERR_EINTERNAL;
+    }
+
+    if (0 !=
+        execute_stmt(persister, NEU_SQLITE_STMT_STORE_GROUP_PROFILE,
+                     store_group_profile_sql, "sslllllllllll", driver_name,
+                     group, (int64_t) profile->reads,
+                     (int64_t) profile->read_ms, (int64_t) profile->overruns,
+                     (int64_t) profile->blocks,
+                     (int64_t) latency[0], (int64_t) latency[1],
+                     (int64_t) latency[2], (int64_t) latency[3],
+                     (int64_t) latency[4], (int64_t) latency[5],
+                     (int64_t) latency[6])) {
+        goto error;
+    }
+
+    // the tags that stopped changing decay out of the table
+    if (0 !=
+            execute_stmt(persister, NEU_SQLITE_STMT_DECAY_TAG_PROFILES,
+                         "UPDATE tag_profiles SET changes=changes/2 "
+                         "WHERE driver_name=? AND group_name=?",
+                         "ss", driver_name, group) ||
+        0 !=
+            execute_stmt(persister, NEU_SQLITE_STMT_PRUNE_TAG_PROFILES,
+                         "DELETE FROM tag_profiles WHERE driver_name=? AND "
+                         "group_name=? AND changes=0",
+                         "ss", driver_name, group)) {
+        goto error;
+    }
+
+    neu_persist_tag_profile_t *tag = NULL;
+    while (NULL != profile->tags &&
+           NULL != (tag = utarray_next(profile->tags, tag))) {
+        if (0 !=
+            execute_stmt(persister, NEU_SQLITE_STMT_STORE_TAG_PROFILE,
+                         store_tag_profile_sql, "sssl", driver_name, group,
+                         tag->name, (int64_t) tag->changes)) {
+            goto error;
+        }
+    }
+
+    if (SQLITE_OK !=
+        sqlite3_exec(persister->db, "RELEASE store_group_profile", NULL, NULL,
+                     NULL)) {
+        nlog_error("commit transaction fail: %s",
+                   sqlite3_errmsg(persister->db));
+        goto error;
+    }
+
+    return 0;
+
+error:
+    nlog_warn("rollback transaction");
+    sqlite3_exec(persister->db, "ROLLBACK TO store_group_profile", NULL, NULL,
+                 NULL);
+    sqlite3_exec(persister->db, "RELEASE store_group_profile", NULL, NULL,
+                 NULL);
+    return NEU_ERR_EINTERNAL;
+}
+
+static UT_icd group_profile_icd = {
+    sizeof(neu_persist_group_profile_t),
+    NULL,
+    NULL,
+    (dtor_f *) neu_persist_group_profile_fini,
+};
+
+static int collect_group_profiles(sqlite3_stmt *stmt, UT_array **profiles)
+{
+    neu_persist_group_profile_t *profile = NULL;
+
+    int step = sqlite3_step(stmt);
+    while (SQLITE_ROW == step) {
+        // rows come ordered by group, a group starts with its first row
+        const char *name = (const char *) sqlite3_column_text(stmt, 0);
+        if (NULL == profile || 0 != strcmp(profile->group_name, name)) {
+            neu_persist_group_profile_t info = {
+                .group_name = strdup(name),
+                .reads      = sqlite3_column_int64(stmt, 1),
+                .read_ms    = sqlite3_column_int64(stmt, 2),
+                .overruns   = sqlite3_column_int64(stmt, 3),
+                .blocks     = sqlite3_column_int64(stmt, 4),
+            };
+            if (NULL == info.group_name) {
+                break;
+            }
+            for (int i = 0; i < NEU_TUNING_LATENCY_N; ++i) {
+                info.latency[i] = sqlite3_column_int64(stmt, 5 + i);
+            }
+            utarray_new(info.tags, neu_persist_tag_profile_icd());
+            utarray_push_back(*profiles, &info);
+            profile = utarray_back(*profiles);
+        }
+
+        // a group without tag changes has a single row of NULL tag columns
+        int col = 5 + NEU_TUNING_LATENCY_N;
+        if (SQLITE_NULL != sqlite3_column_type(stmt, col)) {
+            neu_persist_tag_profile_t tag = {
+                .name    = strdup((char *) sqlite3_column_text(stmt, col)),
+                .changes = sqlite3_column_int64(stmt, col + 1),
+            };
+            if (NULL == tag.name) {
+                break;
+            }
+            utarray_push_back(profile->tags, &tag);
+        }
+
+        step = sqlite3_step(stmt);
+    }
+
+    if (SQLITE_DONE != step) {
+        return -1;
+    }
+
+    return 0;
+}
+
+int neu_sqlite_persister_load_group_profiles(neu_persister_t *self,
+                                             const char *     driver_name,
+                                             UT_array **      profiles)
+{
+    neu_sqlite_persister_t *persister = (neu_sqlite_persister_t *) self;
+
+    sqlite3_stmt *stmt  = NULL;
+    const char *  query = "SELECT g.group_name, g.reads, g.read_ms, "
+                        "g.overruns, g.blocks, g.le_1_ms, g.le_4_ms, "
+                        "g.le_16_ms, g.le_64_ms, g.le_256_ms, g.le_1024_ms, "
+                        "g.gt_1024_ms, t.tag_name, t.changes "
+                        "FROM group_profiles AS g LEFT JOIN tag_profiles AS t "
+                        "ON t.driver_name=g.driver_name "
+                        "AND t.group_name=g.group_name "
+                        "WHERE g.driver_name=? "
+                        "ORDER BY g.rowid ASC, t.rowid ASC";
+
+    utarray_new(*profiles, &group_profile_icd);
+
+    if (SQLITE_OK !=
+        prepare_stmt(persister, NEU_SQLITE_STMT_LOAD_GROUP_PROFILES, query,
+                     &stmt)) {
+        nlog_error("prepare `%s` fail: %s", query,
+                   sqlite3_errmsg(persister->db));
+        goto error;
+    }
+
+    if (SQLITE_OK != sqlite3_bind_text(stmt, 1, driver_name, -1, NULL)) {
+        nlog_error("bind `%s` with `%s` fail: %s", query, driver_name,
+                   sqlite3_errmsg(persister->db));
+        goto error;
+    }
+
+    if (0 != collect_group_profiles(stmt, profiles)) {
+        nlog_warn("query `%s` fail: %s", query, sqlite3_errmsg(persister->db));
+        // do not set return code, return partial or empty result
+    }
+
+    release_stmt(stmt);
+    return 0;
+
+error:
+    release_stmt(stmt);
+    utarray_free(*profiles);
+    *profiles = NULL;
+    return NEU_ERR_EINTERNAL;
+}
+
 int neu_sqlite_persister_store_node_setting(neu_persister_t *self,
                                             const char *     node_name,
                                             const char *     setting)
 {
-    return execute_sql(
-        ((neu_sqlite_persister_t *) self)->db,
-        "INSERT OR REPLACE INTO settings (node_name, setting) VALUES (%Q, %Q)",
-        node_name, setting);
+    return execute_stmt(
+        (neu_sqlite_persister_t *) self, NEU_SQLITE_STMT_STORE_NODE_SETTING,
+        "INSERT OR REPLACE INTO settings (node_name, setting) VALUES (?, ?)",
+        "ss", node_name, setting);
 }
 
 int neu_sqlite_persister_load_node_setting(neu_persister_t *  self,
@@ -1090,7 +1592,8 @@ int neu_sqlite_persister_load_node_setting(neu_persister_t *  self,
     const char *  query = "SELECT setting FROM settings WHERE node_name=?";
 
     if (SQLITE_OK !=
-        sqlite3_prepare_v2(persister->db, query, -1, &stmt, NULL)) {
+        prepare_stmt(persister, NEU_SQLITE_STMT_LOAD_NODE_SETTING, query,
+                     &stmt)) {
         nlog_error("prepare `%s` with `%s` fail: %s", query, node_name,
                    sqlite3_errmsg(persister->db));
         return NEU_ERR_EINTERNAL;
@@ -1120,31 +1623,35 @@ int neu_sqlite_persister_load_node_setting(neu_persister_t *  self,
     *setting = s;
 
 end:
-    sqlite3_finalize(stmt);
+    release_stmt(stmt);
     return rv;
 }
 
 int neu_sqlite_persister_delete_node_setting(neu_persister_t *self,
                                              const char *     node_name)
 {
-    return execute_sql(((neu_sqlite_persister_t *) self)->db,
-                       "DELETE FROM settings WHERE node_name=%Q", node_name);
+    return execute_stmt((neu_sqlite_persister_t *) self,
+                        NEU_SQLITE_STMT_DELETE_NODE_SETTING,
+                        "DELETE FROM settings WHERE node_name=?", "s",
+                        node_name);
 }
 
 int neu_sqlite_persister_store_user(neu_persister_t *              self,
                                     const neu_persist_user_info_t *user)
 {
-    return execute_sql(((neu_sqlite_persister_t *) self)->db,
-                       "INSERT INTO users (name, password) VALUES (%Q, %Q)",
-                       user->name, user->hash);
+    return execute_stmt((neu_sqlite_persister_t *) self,
+                        NEU_SQLITE_STMT_STORE_USER,
+                        "INSERT INTO users (name, password) VALUES (?, ?)",
+                        "ss", user->name, user->hash);
 }
 
 int neu_sqlite_persister_update_user(neu_persister_t *              self,
                                      const neu_persist_user_info_t *user)
 {
-    return execute_sql(((neu_sqlite_persister_t *) self)->db,
-                       "UPDATE users SET password=%Q WHERE name=%Q", user->hash,
-                       user->name);
+    return execute_stmt((neu_sqlite_persister_t *) self,
+                        NEU_SQLITE_STMT_UPDATE_USER,
+                        "UPDATE users SET password=? WHERE name=?", "ss",
+                        user->hash, user->name);
 }
 
 int neu_sqlite_persister_load_user(neu_persister_t *self, const char *user_name,
@@ -1157,7 +1664,7 @@ int neu_sqlite_persister_load_user(neu_persister_t *self, const char *user_name,
     const char *             query = "SELECT password FROM users WHERE name=?";
 
     if (SQLITE_OK !=
-        sqlite3_prepare_v2(persister->db, query, -1, &stmt, NULL)) {
+        prepare_stmt(persister, NEU_SQLITE_STMT_LOAD_USER, query, &stmt)) {
         nlog_error("prepare `%s` with `%s` fail: %s", query, user_name,
                    sqlite3_errmsg(persister->db));
         return NEU_ERR_EINTERNAL;
@@ -1193,7 +1700,7 @@ int neu_sqlite_persister_load_user(neu_persister_t *self, const char *user_name,
     }
 
     *user_p = user;
-    sqlite3_finalize(stmt);
+    release_stmt(stmt);
     return 0;
 
 error:
@@ -1201,13 +1708,14 @@ error:
         neu_persist_user_info_fini(user);
         free(user);
     }
-    sqlite3_finalize(stmt);
+    release_stmt(stmt);
     return NEU_ERR_EINTERNAL;
 }
 
 int neu_sqlite_persister_delete_user(neu_persister_t *self,
                                      const char *     user_name)
 {
-    return execute_sql(((neu_sqlite_persister_t *) self)->db,
-                       "DELETE FROM users WHERE name=%Q", user_name);
+    return execute_stmt((neu_sqlite_persister_t *) self,
+                        NEU_SQLITE_STMT_DELETE_USER,
+                        "DELETE FROM users WHERE name=?", "s", user_name);
 }
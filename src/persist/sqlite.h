@@ -26,12 +26,56 @@ extern "C" {
 
 #include "persist/persist_impl.h"
 
+#define DB_FILE "persistence/sqlite.db"
+
+// statements prepared once and cached per persister
+typedef enum {
+    NEU_SQLITE_STMT_STORE_NODE,
+    NEU_SQLITE_STMT_LOAD_NODES,
+    NEU_SQLITE_STMT_DELETE_NODE,
+    NEU_SQLITE_STMT_UPDATE_NODE,
+    NEU_SQLITE_STMT_UPDATE_NODE_STATE,
+    NEU_SQLITE_STMT_STORE_TAG,
+    NEU_SQLITE_STMT_STORE_TAGS,
+    NEU_SQLITE_STMT_LOAD_TAGS,
+    NEU_SQLITE_STMT_UPDATE_TAG,
+    NEU_SQLITE_STMT_UPDATE_TAG_VALUE,
+    NEU_SQLITE_STMT_DELETE_TAG,
+    NEU_SQLITE_STMT_STORE_SUBSCRIPTION,
+    NEU_SQLITE_STMT_UPDATE_SUBSCRIPTION,
+    NEU_SQLITE_STMT_LOAD_SUBSCRIPTIONS,
+    NEU_SQLITE_STMT_DELETE_SUBSCRIPTION,
+    NEU_SQLITE_STMT_STORE_GROUP,
+    NEU_SQLITE_STMT_UPDATE_GROUP,
+    NEU_SQLITE_STMT_UPDATE_GROUP_NAME,
+    NEU_SQLITE_STMT_UPDATE_GROUP_INTERVAL,
+    NEU_SQLITE_STMT_LOAD_GROUPS,
+    NEU_SQLITE_STMT_LOAD_GROUP_TAGS,
+    NEU_SQLITE_STMT_DELETE_GROUP,
+    NEU_SQLITE_STMT_STORE_GROUP_PROFILE,
+    NEU_SQLITE_STMT_DECAY_TAG_PROFILES,
+    NEU_SQLITE_STMT_PRUNE_TAG_PROFILES,
+    NEU_SQLITE_STMT_STORE_TAG_PROFILE,
+    NEU_SQLITE_STMT_LOAD_GROUP_PROFILES,
+    NEU_SQLITE_STMT_STORE_NODE_SETTING,
+    NEU_SQLITE_STMT_LOAD_NODE_SETTING,
+    NEU_SQLITE_STMT_DELETE_NODE_SETTING,
+    NEU_SQLITE_STMT_STORE_USER,
+    NEU_SQLITE_STMT_UPDATE_USER,
+    NEU_SQLITE_STMT_LOAD_USER,
+    NEU_SQLITE_STMT_DELETE_USER,
+    NEU_SQLITE_STMT_MAX,
+} neu_sqlite_stmt_e;
+
 typedef struct {
     struct neu_persister_vtbl_s *vtbl;
     sqlite3 *                    db;
+    sqlite3_stmt *               stmts[NEU_SQLITE_STMT_MAX];
 } neu_sqlite_persister_t;
 
 neu_persister_t *neu_sqlite_persister_create(const char *schema_dir);
+// a database in memory, gone with the persister
+neu_persister_t *neu_sqlite_persister_create_memory(const char *schema_dir);
 
 void  neu_sqlite_persister_destroy(neu_persister_t *self);
 void *neu_sqlite_persister_native_handle(neu_persister_t *self);
@@ -67,6 +111,11 @@ int neu_sqlite_persister_update_tag_value(neu_persister_t *    self,
                                           const char *         driver_name,
                                           const char *         group_name,
                                           const neu_datatag_t *tag);
+int neu_sqlite_persister_update_tag_values(neu_persister_t *    self,
+                                           const char *         driver_name,
+                                           const char *         group_name,
+                                           const neu_datatag_t *tags,
+                                           size_t               n);
 int neu_sqlite_persister_delete_tag(neu_persister_t *self,
                                     const char *     driver_name,
                                     const char *     group_name,
@@ -98,9 +147,18 @@ int neu_sqlite_persister_update_group(neu_persister_t *         self,
 int neu_sqlite_persister_load_groups(neu_persister_t *self,
                                      const char *     driver_name,
                                      UT_array **      group_infos);
+int neu_sqlite_persister_load_group_tags(neu_persister_t *self,
+                                         const char *     driver_name,
+                                         UT_array **      groups);
 int neu_sqlite_persister_delete_group(neu_persister_t *self,
                                       const char *     driver_name,
                                       const char *     group_name);
+int neu_sqlite_persister_store_group_profile(
+    neu_persister_t *self, const char *driver_name,
+    const neu_persist_group_profile_t *profile);
+int neu_sqlite_persister_load_group_profiles(neu_persister_t *self,
+                                             const char *     driver_name,
+                                             UT_array **      profiles);
 int neu_sqlite_persister_store_node_setting(neu_persister_t *self,
                                             const char *     node_name,
                                             const char *     setting);
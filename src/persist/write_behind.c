@@ -0,0 +1,764 @@
+/**
+ * NEURON IIoT System for Industry 4.0
+ * Copyright (C) 2020-2023 EMQ Technologies Co., Ltd All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ **/
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sqlite3.h>
+
+#include "errcodes.h"
+#include "utils/log.h"
+#include "utils/utlist.h"
+
+#include "write_behind.h"
+
+// writes applied in one transaction at most
+#define WRITE_BEHIND_BATCH 256
+// how far back a write looks for a queued write of the same row to merge into
+#define WRITE_BEHIND_MERGE_DEPTH 1024
+
+typedef enum {
+    OP_STORE_NODE,
+    OP_DELETE_NODE,
+    OP_UPDATE_NODE,
+    OP_UPDATE_NODE_STATE,
+    OP_STORE_NODE_SETTING,
+    OP_DELETE_NODE_SETTING,
+    OP_STORE_TAGS,
+    OP_UPDATE_TAG,
+    OP_UPDATE_TAG_VALUE,
+    OP_DELETE_TAG,
+    OP_STORE_SUBSCRIPTION,
+    OP_UPDATE_SUBSCRIPTION,
+    OP_DELETE_SUBSCRIPTION,
+    OP_STORE_GROUP,
+    OP_UPDATE_GROUP,
+    OP_DELETE_GROUP,
+} op_type_e;
+
+typedef struct op {
+    op_type_e      type;
+    uint64_t       seq;
+    char *         node;   // node, driver or app
+    char *         driver; // driver of a subscription
+    char *         group;
+    char *         str; // new name, setting, params, tag or plugin name
+    int            ival[2];
+    neu_datatag_t *tags;
+    size_t         n_tag;
+
+    struct op *prev;
+    struct op *next;
+} op_t;
+
+typedef struct {
+    struct neu_persister_vtbl_s *vtbl;
+    neu_persister_t *            impl;
+
+    pthread_t       thread;
+    pthread_mutex_t mtx;
+    pthread_cond_t  cond;      // signals new writes and quit
+    pthread_cond_t  done_cond; // signals committed writes
+    op_t *          ops;
+    uint64_t        seq;  // of the last queued write
+    uint64_t        done; // of the last applied write
+    bool            quit;
+
+    // serializes the transactions of the worker with the reads and the
+    // synchronous writes of other threads on the same connection
+    pthread_mutex_t db_mtx;
+} write_behind_t;
+
+static char *dup_str(const char *str)
+{
+    return str != NULL ? strdup(str) : NULL;
+}
+
+static void op_free(op_t *op)
+{
+    free(op->node);
+    free(op->driver);
+    free(op->group);
+    free(op->str);
+    for (size_t i = 0; i < op->n_tag; ++i) {
+        neu_tag_fini(&op->tags[i]);
+    }
+    free(op->tags);
+    free(op);
+}
+
+static op_t *op_new(op_type_e type, const char *node, const char *driver,
+                    const char *group, const char *str)
+{
+    op_t *op = calloc(1, sizeof(op_t));
+    if (op == NULL) {
+        return NULL;
+    }
+
+    op->type   = type;
+    op->node   = dup_str(node);
+    op->driver = dup_str(driver);
+    op->group  = dup_str(group);
+    op->str    = dup_str(str);
+    if ((node != NULL && op->node == NULL) ||
+        (driver != NULL && op->driver == NULL) ||
+        (group != NULL && op->group == NULL) ||
+        (str != NULL && op->str == NULL)) {
+        op_free(op);
+        return NULL;
+    }
+
+    return op;
+}
+
+static int op_set_tags(op_t *op, const neu_datatag_t *tags, size_t n)
+{
+    op->tags = calloc(n, sizeof(neu_datatag_t));
+    if (op->tags == NULL) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < n; ++i) {
+        neu_tag_copy(&op->tags[i], &tags[i]);
+    }
+    op->n_tag = n;
+    return 0;
+}
+
+static inline bool str_eq(const char *a, const char *b)
+{
+    return a != NULL && b != NULL && strcmp(a, b) == 0;
+}
+
+static inline const char *op_tag_name(const op_t *op)
+{
+    switch (op->type) {
+    case OP_UPDATE_TAG:
+    case OP_UPDATE_TAG_VALUE:
+        return op->tags[0].name;
+    case OP_DELETE_TAG:
+        return op->str;
+    default:
+        return NULL;
+    }
+}
+
+// whether the write `op` of the same row as `key` may be merged into
+static bool op_same_row(const op_t *op, const op_t *key)
+{
+    if (op->type != key->type || !str_eq(op->node, key->node)) {
+        return false;
+    }
+
+    switch (key->type) {
+    case OP_UPDATE_NODE_STATE:
+    case OP_STORE_NODE_SETTING:
+        return true;
+    case OP_UPDATE_TAG_VALUE:
+        return str_eq(op->group, key->group) &&
+            str_eq(op_tag_name(op), op_tag_name(key));
+    case OP_UPDATE_SUBSCRIPTION:
+        return str_eq(op->driver, key->driver) &&
+            str_eq(op->group, key->group);
+    default:
+        return false;
+    }
+}
+
+// whether the queued `op`, which is not of the same row, may still change
+// the row of `key`, so that merging `key` across it would reorder them
+static bool op_touches(const op_t *op, const op_t *key)
+{
+    const char *name = NULL;
+
+    if (op->type == OP_STORE_NODE || op->type == OP_DELETE_NODE ||
+        op->type == OP_UPDATE_NODE) {
+        return true;
+    }
+
+    if (!str_eq(op->node, key->node) && !str_eq(op->node, key->driver) &&
+        !str_eq(op->driver, key->node)) {
+        return false;
+    }
+
+    if (key->type == OP_UPDATE_TAG_VALUE) {
+        if (op->group != NULL && !str_eq(op->group, key->group)) {
+            return false;
+        }
+        name = op_tag_name(op);
+        if (name != NULL && !str_eq(name, op_tag_name(key))) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool op_mergeable(op_type_e type)
+{
+    return type == OP_UPDATE_NODE_STATE || type == OP_STORE_NODE_SETTING ||
+        type == OP_UPDATE_TAG_VALUE || type == OP_UPDATE_SUBSCRIPTION;
+}
+
+// find the latest queued write of the same row as `key`, as long as no write
+// in between may change that row
+static op_t *find_merge(write_behind_t *wb, const op_t *key)
+{
+    int depth = 0;
+
+    if (wb->ops == NULL || !op_mergeable(key->type)) {
+        return NULL;
+    }
+
+    for (op_t *op = wb->ops->prev; depth < WRITE_BEHIND_MERGE_DEPTH;
+         op = op->prev, ++depth) {
+        if (op_same_row(op, key)) {
+            return op;
+        }
+        if (op_touches(op, key) || op == wb->ops) {
+            break;
+        }
+    }
+
+    return NULL;
+}
+
+static int enqueue(write_behind_t *wb, op_t *op)
+{
+    if (op == NULL) {
+        return NEU_ERR_EINTERNAL;
+    }
+
+    pthread_mutex_lock(&wb->mtx);
+    op_t *old = find_merge(wb, op);
+    if (old != NULL) {
+        // keep the place, and so the order, of the queued write, the stale
+        // payload is freed along with `op`
+        op_t tmp     = *old;
+        old->str     = op->str;
+        old->tags    = op->tags;
+        old->n_tag   = op->n_tag;
+        old->ival[0] = op->ival[0];
+        old->ival[1] = op->ival[1];
+        op->str      = tmp.str;
+        op->tags     = tmp.tags;
+        op->n_tag    = tmp.n_tag;
+    } else {
+        op->seq = ++wb->seq;
+        DL_APPEND(wb->ops, op);
+        pthread_cond_signal(&wb->cond);
+        op = NULL;
+    }
+    pthread_mutex_unlock(&wb->mtx);
+
+    if (op != NULL) {
+        op_free(op);
+    }
+    return 0;
+}
+
+static int apply(neu_persister_t *impl, op_t *op)
+{
+    neu_persist_node_info_t  node  = { 0 };
+    neu_persist_group_info_t group = { 0 };
+
+    switch (op->type) {
+    case OP_STORE_NODE:
+        node.name        = op->node;
+        node.plugin_name = op->str;
+        node.type        = op->ival[0];
+        node.state       = op->ival[1];
+        return impl->vtbl->store_node(impl, &node);
+    case OP_DELETE_NODE:
+        return impl->vtbl->delete_node(impl, op->node);
+    case OP_UPDATE_NODE:
+        return impl->vtbl->update_node(impl, op->node, op->str);
+    case OP_UPDATE_NODE_STATE:
+        return impl->vtbl->update_node_state(impl, op->node, op->ival[0]);
+    case OP_STORE_NODE_SETTING:
+        return impl->vtbl->store_node_setting(impl, op->node, op->str);
+    case OP_DELETE_NODE_SETTING:
+        return impl->vtbl->delete_node_setting(impl, op->node);
+    case OP_STORE_TAGS:
+        if (op->n_tag == 1) {
+            return impl->vtbl->store_tag(impl, op->node, op->group, op->tags);
+        }
+        return impl->vtbl->store_tags(impl, op->node, op->group, op->tags,
+                                      op->n_tag);
+    case OP_UPDATE_TAG:
+        return impl->vtbl->update_tag(impl, op->node, op->group, op->tags);
+    case OP_UPDATE_TAG_VALUE:
+        return impl->vtbl->update_tag_value(impl, op->node, op->group,
+                                            op->tags);
+    case OP_DELETE_TAG:
+        return impl->vtbl->delete_tag(impl, op->node, op->group, op->str);
+    case OP_STORE_SUBSCRIPTION:
+        return impl->vtbl->store_subscription(impl, op->node, op->driver,
+                                              op->group, op->str);
+    case OP_UPDATE_SUBSCRIPTION:
+        return impl->vtbl->update_subscription(impl, op->node, op->driver,
+                                               op->group, op->str);
+    case OP_DELETE_SUBSCRIPTION:
+        return impl->vtbl->delete_subscription(impl, op->node, op->driver,
+                                               op->group);
+    case OP_STORE_GROUP:
+        group.name     = op->group;
+        group.interval = (uint32_t) op->ival[0];
+        return impl->vtbl->store_group(impl, op->node, &group);
+    case OP_UPDATE_GROUP:
+        group.name     = op->str;
+        group.interval = (uint32_t) op->ival[0];
+        return impl->vtbl->update_group(impl, op->node, op->group, &group);
+    case OP_DELETE_GROUP:
+        return impl->vtbl->delete_group(impl, op->node, op->group);
+    }
+
+    return NEU_ERR_EINTERNAL;
+}
+
+static void apply_batch(write_behind_t *wb, op_t *ops)
+{
+    sqlite3 *db = wb->impl->vtbl->native_handle(wb->impl);
+    op_t *   op = NULL;
+    int      n  = 0;
+
+    pthread_mutex_lock(&wb->db_mtx);
+    if (SQLITE_OK != sqlite3_exec(db, "BEGIN", NULL, NULL, NULL)) {
+        nlog_error("begin transaction fail: %s", sqlite3_errmsg(db));
+    }
+
+    DL_FOREACH(ops, op)
+    {
+        if (0 != apply(wb->impl, op)) {
+            nlog_error("persist write %d of %s fail", op->type, op->node);
+        }
+        ++n;
+    }
+
+    if (sqlite3_get_autocommit(db) == 0 &&
+        SQLITE_OK != sqlite3_exec(db, "COMMIT", NULL, NULL, NULL)) {
+        nlog_error("commit %d writes fail: %s", n, sqlite3_errmsg(db));
+        sqlite3_exec(db, "ROLLBACK", NULL, NULL, NULL);
+    }
+    pthread_mutex_unlock(&wb->db_mtx);
+}
+
+static void *write_behind_worker(void *arg)
+{
+    write_behind_t *wb = (write_behind_t *) arg;
+
+    pthread_mutex_lock(&wb->mtx);
+    while (true) {
+        while (wb->ops == NULL && !wb->quit) {
+            pthread_cond_wait(&wb->cond, &wb->mtx);
+        }
+        if (wb->ops == NULL) {
+            break;
+        }
+
+        // detach the oldest writes, later ones keep queueing and merging
+        op_t *batch = NULL;
+        for (int i = 0; i < WRITE_BEHIND_BATCH && wb->ops != NULL; ++i) {
+            op_t *op = wb->ops;
+            DL_DELETE(wb->ops, op);
+            DL_APPEND(batch, op);
+        }
+        uint64_t seq = batch->prev->seq;
+        pthread_mutex_unlock(&wb->mtx);
+
+        apply_batch(wb, batch);
+
+        op_t *op  = NULL;
+        op_t *tmp = NULL;
+        DL_FOREACH_SAFE(batch, op, tmp)
+        {
+            DL_DELETE(batch, op);
+            op_free(op);
+        }
+
+        pthread_mutex_lock(&wb->mtx);
+        wb->done = seq;
+        pthread_cond_broadcast(&wb->done_cond);
+    }
+    pthread_mutex_unlock(&wb->mtx);
+
+    return NULL;
+}
+
+static int write_behind_flush(neu_persister_t *self)
+{
+    write_behind_t *wb = (write_behind_t *) self;
+
+    pthread_mutex_lock(&wb->mtx);
+    uint64_t seq = wb->seq;
+    while (wb->done < seq) {
+        pthread_cond_wait(&wb->done_cond, &wb->mtx);
+    }
+    pthread_mutex_unlock(&wb->mtx);
+
+    return 0;
+}
+
+static void write_behind_destroy(neu_persister_t *self)
+{
+    write_behind_t *wb = (write_behind_t *) self;
+
+    // queued writes are still applied before the worker quits
+    pthread_mutex_lock(&wb->mtx);
+    wb->quit = true;
+    pthread_cond_signal(&wb->cond);
+    pthread_mutex_unlock(&wb->mtx);
+    pthread_join(wb->thread, NULL);
+
+    wb->impl->vtbl->destroy(wb->impl);
+    pthread_cond_destroy(&wb->done_cond);
+    pthread_cond_destroy(&wb->cond);
+    pthread_mutex_destroy(&wb->mtx);
+    pthread_mutex_destroy(&wb->db_mtx);
+    free(wb);
+}
+
+static void *write_behind_native_handle(neu_persister_t *self)
+{
+    write_behind_t *wb = (write_behind_t *) self;
+    write_behind_flush(self);
+    return wb->impl->vtbl->native_handle(wb->impl);
+}
+
+// reads see every write queued before them
+#define READ(self, call)                                      \
+    write_behind_t *wb = (write_behind_t *) (self);           \
+    write_behind_flush(self);                                 \
+    pthread_mutex_lock(&wb->db_mtx);                          \
+    int rv = wb->impl->vtbl->call;                            \
+    pthread_mutex_unlock(&wb->db_mtx);                        \
+    return rv
+
+// user writes report their result to the caller, so they stay synchronous
+#define SYNC(self, call)                                      \
+    write_behind_t *wb = (write_behind_t *) (self);           \
+    pthread_mutex_lock(&wb->db_mtx);                          \
+    int rv = wb->impl->vtbl->call;                            \
+    pthread_mutex_unlock(&wb->db_mtx);                        \
+    return rv
+
+static int write_behind_store_node(neu_persister_t *        self,
+                                   neu_persist_node_info_t *info)
+{
+    op_t *op = op_new(OP_STORE_NODE, info->name, NULL, NULL, info->plugin_name);
+    if (op != NULL) {
+        op->ival[0] = info->type;
+        op->ival[1] = info->state;
+    }
+    return enqueue((write_behind_t *) self, op);
+}
+
+static int write_behind_load_nodes(neu_persister_t *self, UT_array **infos)
+{
+    READ(self, load_nodes(wb->impl, infos));
+}
+
+static int write_behind_delete_node(neu_persister_t *self, const char *name)
+{
+    return enqueue((write_behind_t *) self,
+                   op_new(OP_DELETE_NODE, name, NULL, NULL, NULL));
+}
+
+static int write_behind_update_node(neu_persister_t *self, const char *name,
+                                    const char *new_name)
+{
+    return enqueue((write_behind_t *) self,
+                   op_new(OP_UPDATE_NODE, name, NULL, NULL, new_name));
+}
+
+static int write_behind_update_node_state(neu_persister_t *self,
+                                          const char *name, int state)
+{
+    op_t *op = op_new(OP_UPDATE_NODE_STATE, name, NULL, NULL, NULL);
+    if (op != NULL) {
+        op->ival[0] = state;
+    }
+    return enqueue((write_behind_t *) self, op);
+}
+
+static int write_behind_store_node_setting(neu_persister_t *self,
+                                           const char *     name,
+                                           const char *     setting)
+{
+    return enqueue((write_behind_t *) self,
+                   op_new(OP_STORE_NODE_SETTING, name, NULL, NULL, setting));
+}
+
+static int write_behind_load_node_setting(neu_persister_t *  self,
+                                          const char *       name,
+                                          const char **const setting)
+{
+    READ(self, load_node_setting(wb->impl, name, setting));
+}
+
+static int write_behind_delete_node_setting(neu_persister_t *self,
+                                            const char *     name)
+{
+    return enqueue((write_behind_t *) self,
+                   op_new(OP_DELETE_NODE_SETTING, name, NULL, NULL, NULL));
+}
+
+static int enqueue_tags(neu_persister_t *self, op_type_e type,
+                        const char *driver, const char *group,
+                        const neu_datatag_t *tags, size_t n)
+{
+    op_t *op = op_new(type, driver, NULL, group, NULL);
+    if (op != NULL && 0 != op_set_tags(op, tags, n)) {
+        op_free(op);
+        op = NULL;
+    }
+    return enqueue((write_behind_t *) self, op);
+}
+
+static int write_behind_store_tag(neu_persister_t *self, const char *driver,
+                                  const char *group, const neu_datatag_t *tag)
+{
+    return enqueue_tags(self, OP_STORE_TAGS, driver, group, tag, 1);
+}
+
+static int write_behind_store_tags(neu_persister_t *self, const char *driver,
+                                   const char *         group,
+                                   const neu_datatag_t *tags, size_t n)
+{
+    return enqueue_tags(self, OP_STORE_TAGS, driver, group, tags, n);
+}
+
+static int write_behind_load_tags(neu_persister_t *self, const char *driver,
+                                  const char *group, UT_array **tags)
+{
+    READ(self, load_tags(wb->impl, driver, group, tags));
+}
+
+static int write_behind_update_tag(neu_persister_t *self, const char *driver,
+                                   const char *group, const neu_datatag_t *tag)
+{
+    return enqueue_tags(self, OP_UPDATE_TAG, driver, group, tag, 1);
+}
+
+static int write_behind_update_tag_value(neu_persister_t *    self,
+                                         const char *         driver,
+                                         const char *         group,
+                                         const neu_datatag_t *tag)
+{
+    return enqueue_tags(self, OP_UPDATE_TAG_VALUE, driver, group, tag, 1);
+}
+
+// one write per tag, so that a later update of the same tag merges into it
+static int write_behind_update_tag_values(neu_persister_t *    self,
+                                          const char *         driver,
+                                          const char *         group,
+                                          const neu_datatag_t *tags, size_t n)
+{
+    int rv = 0;
+
+    for (size_t i = 0; i < n && 0 == rv; ++i) {
+        rv = enqueue_tags(self, OP_UPDATE_TAG_VALUE, driver, group, &tags[i],
+                          1);
+    }
+
+    return rv;
+}
+
+static int write_behind_delete_tag(neu_persister_t *self, const char *driver,
+                                   const char *group, const char *name)
+{
+    return enqueue((write_behind_t *) self,
+                   op_new(OP_DELETE_TAG, driver, NULL, group, name));
+}
+
+static int write_behind_store_subscription(neu_persister_t *self,
+                                           const char *app, const char *driver,
+                                           const char *group,
+                                           const char *params)
+{
+    return enqueue((write_behind_t *) self,
+                   op_new(OP_STORE_SUBSCRIPTION, app, driver, group, params));
+}
+
+static int write_behind_update_subscription(neu_persister_t *self,
+                                            const char *app, const char *driver,
+                                            const char *group,
+                                            const char *params)
+{
+    return enqueue((write_behind_t *) self,
+                   op_new(OP_UPDATE_SUBSCRIPTION, app, driver, group, params));
+}
+
+static int write_behind_load_subscriptions(neu_persister_t *self,
+                                           const char *app, UT_array **infos)
+{
+    READ(self, load_subscriptions(wb->impl, app, infos));
+}
+
+static int write_behind_delete_subscription(neu_persister_t *self,
+                                            const char *app, const char *driver,
+                                            const char *group)
+{
+    return enqueue((write_behind_t *) self,
+                   op_new(OP_DELETE_SUBSCRIPTION, app, driver, group, NULL));
+}
+
+static int write_behind_store_group(neu_persister_t *         self,
+                                    const char *              driver,
+                                    neu_persist_group_info_t *info)
+{
+    op_t *op = op_new(OP_STORE_GROUP, driver, NULL, info->name, NULL);
+    if (op != NULL) {
+        op->ival[0] = (int) info->interval;
+    }
+    return enqueue((write_behind_t *) self, op);
+}
+
+static int write_behind_update_group(neu_persister_t *self, const char *driver,
+                                     const char *              group,
+                                     neu_persist_group_info_t *info)
+{
+    op_t *op = op_new(OP_UPDATE_GROUP, driver, NULL, group, info->name);
+    if (op != NULL) {
+        op->ival[0] = (int) info->interval;
+    }
+    return enqueue((write_behind_t *) self, op);
+}
+
+static int write_behind_load_groups(neu_persister_t *self, const char *driver,
+                                    UT_array **infos)
+{
+    READ(self, load_groups(wb->impl, driver, infos));
+}
+
+static int write_behind_load_group_tags(neu_persister_t *self,
+                                        const char *driver, UT_array **groups)
+{
+    READ(self, load_group_tags(wb->impl, driver, groups));
+}
+
+static int write_behind_delete_group(neu_persister_t *self, const char *driver,
+                                     const char *group)
+{
+    return enqueue((write_behind_t *) self,
+                   op_new(OP_DELETE_GROUP, driver, NULL, group, NULL));
+}
+
+// once in a profile interval per group, not worth a copy of the tags, and
+// after the queued writes, which may add the group
+static int
+write_behind_store_group_profile(neu_persister_t *self, const char *driver,
+                                 const neu_persist_group_profile_t *profile)
+{
+    READ(self, store_group_profile(wb->impl, driver, profile));
+}
+
+static int write_behind_load_group_profiles(neu_persister_t *self,
+                                            const char *     driver,
+                                            UT_array **      profiles)
+{
+    READ(self, load_group_profiles(wb->impl, driver, profiles));
+}
+
+static int write_behind_store_user(neu_persister_t *              self,
+                                   const neu_persist_user_info_t *user)
+{
+    SYNC(self, store_user(wb->impl, user));
+}
+
+static int write_behind_update_user(neu_persister_t *              self,
+                                    const neu_persist_user_info_t *user)
+{
+    SYNC(self, update_user(wb->impl, user));
+}
+
+static int write_behind_load_user(neu_persister_t *self, const char *name,
+                                  neu_persist_user_info_t **user_p)
+{
+    SYNC(self, load_user(wb->impl, name, user_p));
+}
+
+static int write_behind_delete_user(neu_persister_t *self, const char *name)
+{
+    SYNC(self, delete_user(wb->impl, name));
+}
+
+static struct neu_persister_vtbl_s g_write_behind_persister_vtbl = {
+    .destroy             = write_behind_destroy,
+    .native_handle       = write_behind_native_handle,
+    .flush               = write_behind_flush,
+    .store_node          = write_behind_store_node,
+    .load_nodes          = write_behind_load_nodes,
+    .delete_node         = write_behind_delete_node,
+    .update_node         = write_behind_update_node,
+    .update_node_state   = write_behind_update_node_state,
+    .store_tag           = write_behind_store_tag,
+    .store_tags          = write_behind_store_tags,
+    .load_tags           = write_behind_load_tags,
+    .update_tag          = write_behind_update_tag,
+    .update_tag_value    = write_behind_update_tag_value,
+    .update_tag_values   = write_behind_update_tag_values,
+    .delete_tag          = write_behind_delete_tag,
+    .store_subscription  = write_behind_store_subscription,
+    .update_subscription = write_behind_update_subscription,
+    .load_subscriptions  = write_behind_load_subscriptions,
+    .delete_subscription = write_behind_delete_subscription,
+    .store_group         = write_behind_store_group,
+    .update_group        = write_behind_update_group,
+    .load_groups         = write_behind_load_groups,
+    .load_group_tags     = write_behind_load_group_tags,
+    .delete_group        = write_behind_delete_group,
+    .store_group_profile = write_behind_store_group_profile,
+    .load_group_profiles = write_behind_load_group_profiles,
+    .store_node_setting  = write_behind_store_node_setting,
+    .load_node_setting   = write_behind_load_node_setting,
+    .delete_node_setting = write_behind_delete_node_setting,
+    .store_user          = write_behind_store_user,
+    .update_user         = write_behind_update_user,
+    .load_user           = write_behind_load_user,
+    .delete_user         = write_behind_delete_user,
+};
+
+neu_persister_t *neu_write_behind_persister_create(neu_persister_t *impl)
+{
+    write_behind_t *wb = calloc(1, sizeof(write_behind_t));
+    if (NULL == wb) {
+        return NULL;
+    }
+
+    wb->vtbl = &g_write_behind_persister_vtbl;
+    wb->impl = impl;
+    pthread_mutex_init(&wb->mtx, NULL);
+    pthread_mutex_init(&wb->db_mtx, NULL);
+    pthread_cond_init(&wb->cond, NULL);
+    pthread_cond_init(&wb->done_cond, NULL);
+
+    if (0 != pthread_create(&wb->thread, NULL, write_behind_worker, wb)) {
+        nlog_error("persister create write behind thread fail");
+        pthread_cond_destroy(&wb->done_cond);
+        pthread_cond_destroy(&wb->cond);
+        pthread_mutex_destroy(&wb->mtx);
+        pthread_mutex_destroy(&wb->db_mtx);
+        free(wb);
+        return NULL;
+    }
+
+    return (neu_persister_t *) wb;
+}
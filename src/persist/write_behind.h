@@ -0,0 +1,42 @@
+/**
+ * NEURON IIoT System for Industry 4.0
+ * Copyright (C) 2020-2023 EMQ Technologies Co., Ltd All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ **/
+
+#ifndef NEU_PERSIST_WRITE_BEHIND_PERSISTER
+#define NEU_PERSIST_WRITE_BEHIND_PERSISTER
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "persist/persist_impl.h"
+
+/**
+ * Create a persister that queues the writes for `impl` and applies them on
+ * its own thread, many at a time in one transaction of the sqlite `impl`.
+ * Writes return once queued, reads wait for the queued writes first.
+ * Takes ownership of `impl`, which is destroyed along with the persister.
+ * @return NULL on failure, `impl` is then left to the caller.
+ */
+neu_persister_t *neu_write_behind_persister_create(neu_persister_t *impl);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
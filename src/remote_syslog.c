@@ -0,0 +1,244 @@
+/**
+ * NEURON IIoT System for Industry 4.0
+ * Copyright (C) 2020-2023 EMQ Technologies Co., Ltd All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ **/
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "utils/log.h"
+
+#include "remote_syslog.h"
+
+// a power of two, records longer than SYSLOG_MSG_MAX are truncated
+#define SYSLOG_RING_SIZE 2048
+#define SYSLOG_MSG_MAX 1024
+#define SYSLOG_BATCH 64
+#define SYSLOG_IDLE_MS 5
+
+typedef struct {
+    uint32_t seq;
+    uint16_t len;
+    char     buf[SYSLOG_MSG_MAX];
+} slot_t;
+
+static slot_t ring[SYSLOG_RING_SIZE];
+
+static struct {
+    struct sockaddr_in addr;
+    int                fd;
+
+    uint32_t head; // next slot to fill, shared by the logging threads
+    uint32_t tail; // next slot to send, owned by the sender
+
+    pthread_t tid;
+    pid_t     owner;
+    bool      running;
+
+    uint64_t dropped;
+    uint64_t failed;
+} ctx = { .fd = -1 };
+
+static inline char syslog_priority(const char *level)
+{
+    switch (level[0]) {
+    case 'D': // DEBUG
+        return '7';
+    case 'I': // INFO
+        return '6';
+    case 'N': // NOTICE
+        return '5';
+    case 'W': // WARN
+        return '4';
+    case 'E': // ERROR
+        return '3';
+    case 'F': // FATAL
+        return '2';
+    default: // UNKNOWN
+        return '1';
+    }
+}
+
+// bounded multi producer queue, a slot is free to fill at position pos when
+// its seq is pos, and ready to send when its seq is pos + 1
+static int remote_syslog(zlog_msg_t *msg)
+{
+    uint32_t pos  = __atomic_load_n(&ctx.head, __ATOMIC_RELAXED);
+    slot_t * slot = NULL;
+
+    while (true) {
+        slot         = &ring[pos & (SYSLOG_RING_SIZE - 1)];
+        uint32_t seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+        int32_t  dif = (int32_t)(seq - pos);
+
+        if (dif == 0) {
+            if (__atomic_compare_exchange_n(&ctx.head, &pos, pos + 1, true,
+                                            __ATOMIC_RELAXED,
+                                            __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (dif < 0) {
+            __atomic_add_fetch(&ctx.dropped, 1, __ATOMIC_RELAXED);
+            return 0;
+        } else {
+            pos = __atomic_load_n(&ctx.head, __ATOMIC_RELAXED);
+        }
+    }
+
+    slot->len = msg->len < SYSLOG_MSG_MAX ? msg->len : SYSLOG_MSG_MAX;
+    memcpy(slot->buf, msg->buf, slot->len);
+    // fix priority
+    if (slot->len > 1) {
+        slot->buf[1] = syslog_priority(msg->path);
+    }
+    __atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE);
+
+    return 0;
+}
+
+static void *sender(void *arg)
+{
+    struct mmsghdr msgs[SYSLOG_BATCH] = { 0 };
+    struct iovec   iovs[SYSLOG_BATCH] = { 0 };
+    uint64_t       reported           = 0;
+    (void) arg;
+
+    for (int i = 0; i < SYSLOG_BATCH; i++) {
+        msgs[i].msg_hdr.msg_name    = &ctx.addr;
+        msgs[i].msg_hdr.msg_namelen = sizeof(ctx.addr);
+        msgs[i].msg_hdr.msg_iov     = &iovs[i];
+        msgs[i].msg_hdr.msg_iovlen  = 1;
+    }
+
+    while (__atomic_load_n(&ctx.running, __ATOMIC_RELAXED)) {
+        int n = 0;
+
+        while (n < SYSLOG_BATCH) {
+            uint32_t pos  = ctx.tail + n;
+            slot_t * slot = &ring[pos & (SYSLOG_RING_SIZE - 1)];
+
+            if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != pos + 1) {
+                break;
+            }
+            iovs[n].iov_base = slot->buf;
+            iovs[n].iov_len  = slot->len;
+            n += 1;
+        }
+
+        if (n == 0) {
+            struct timespec ts = { .tv_nsec = SYSLOG_IDLE_MS * 1000000 };
+            nanosleep(&ts, NULL);
+            continue;
+        }
+
+        int sent = sendmmsg(ctx.fd, msgs, n, MSG_DONTWAIT);
+        if (sent < n) {
+            __atomic_add_fetch(&ctx.failed, n - (sent > 0 ? sent : 0),
+                               __ATOMIC_RELAXED);
+        }
+
+        for (int i = 0; i < n; i++) {
+            slot_t *slot = &ring[ctx.tail & (SYSLOG_RING_SIZE - 1)];
+            __atomic_store_n(&slot->seq, ctx.tail + SYSLOG_RING_SIZE,
+                             __ATOMIC_RELEASE);
+            ctx.tail += 1;
+        }
+
+        uint64_t dropped = __atomic_load_n(&ctx.dropped, __ATOMIC_RELAXED);
+        uint64_t failed  = __atomic_load_n(&ctx.failed, __ATOMIC_RELAXED);
+        if (dropped + failed != reported) {
+            nlog_ratelimit(ZLOG_LEVEL_WARN, NEU_LOG_RATELIMIT_INTERVAL,
+                           "remote syslog dropped %" PRIu64
+                           " records, failed to send %" PRIu64,
+                           dropped, failed);
+            reported = dropped + failed;
+        }
+    }
+
+    return NULL;
+}
+
+void remote_syslog_start()
+{
+    if (ctx.fd < 0 || ctx.owner == getpid()) {
+        return;
+    }
+
+    ctx.running = true;
+    if (0 != pthread_create(&ctx.tid, NULL, sender, NULL)) {
+        ctx.running = false;
+        return;
+    }
+    ctx.owner = getpid();
+}
+
+int remote_syslog_init(const char *host, uint16_t port)
+{
+    ctx.fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+    if (ctx.fd < 0) {
+        return -1;
+    }
+
+    ctx.addr.sin_family      = AF_INET;
+    ctx.addr.sin_port        = htons(port);
+    ctx.addr.sin_addr.s_addr = inet_addr(host);
+
+    if (0 == inet_pton(AF_INET, host, &ctx.addr.sin_addr)) {
+        // not an valid ip address, try resolve as host name
+        struct hostent *he = gethostbyname(host);
+        if (NULL == he) {
+            close(ctx.fd);
+            ctx.fd = -1;
+            return -1;
+        }
+
+        memcpy(&ctx.addr.sin_addr, he->h_addr_list[0], he->h_length);
+    }
+
+    for (uint32_t i = 0; i < SYSLOG_RING_SIZE; i++) {
+        ring[i].seq = i;
+    }
+
+    remote_syslog_start();
+    zlog_set_record("remote_syslog", remote_syslog);
+    return 0;
+}
+
+void remote_syslog_fini()
+{
+    if (ctx.fd < 0) {
+        return;
+    }
+
+    if (ctx.owner == getpid()) {
+        __atomic_store_n(&ctx.running, false, __ATOMIC_RELAXED);
+        pthread_join(ctx.tid, NULL);
+        ctx.owner = 0;
+    }
+}
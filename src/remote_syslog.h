@@ -0,0 +1,47 @@
+/**
+ * NEURON IIoT System for Industry 4.0
+ * Copyright (C) 2020-2023 EMQ Technologies Co., Ltd All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ **/
+
+#ifndef NEURON_REMOTE_SYSLOG_H
+#define NEURON_REMOTE_SYSLOG_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Ship log records to a syslog collector over UDP.
+ *
+ * Log calls only copy the record into a lock free ring, a sender thread
+ * drains it in batches. Records are dropped, and counted, when the ring is
+ * full, a logging thread never waits for the network.
+ */
+int remote_syslog_init(const char *host, uint16_t port);
+
+/** Start the sender of this process again after a fork.
+ */
+void remote_syslog_start();
+
+void remote_syslog_fini();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,194 @@
+/**
+ * NEURON IIoT System for Industry 4.0
+ * Copyright (C) 2020-2023 EMQ Technologies Co., Ltd All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ **/
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <ctype.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "utils/affinity.h"
+
+static void cpus_add(neu_cpus_t *cpus, long first, long last)
+{
+    for (long cpu = first; cpu <= last; cpu++) {
+        cpus->bits[cpu / 64] |= 1ULL << (cpu % 64);
+    }
+}
+
+static const char *skip_space(const char *p)
+{
+    while (isspace((unsigned char) *p)) {
+        p++;
+    }
+    return p;
+}
+
+int neu_cpus_parse(const char *list, neu_cpus_t *cpus)
+{
+    const char *p = skip_space(list);
+
+    memset(cpus, 0, sizeof(*cpus));
+    while (*p != '\0') {
+        char *end   = NULL;
+        long  first = strtol(p, &end, 10);
+        long  last  = first;
+
+        if (end == p || first < 0 || first >= NEU_CPUS_MAX) {
+            return -1;
+        }
+        p = skip_space(end);
+        if (*p == '-') {
+            p    = skip_space(p + 1);
+            last = strtol(p, &end, 10);
+            if (end == p || last < first || last >= NEU_CPUS_MAX) {
+                return -1;
+            }
+            p = skip_space(end);
+        }
+        cpus_add(cpus, first, last);
+
+        if (*p == ',') {
+            p = skip_space(p + 1);
+        } else if (*p != '\0') {
+            return -1;
+        }
+    }
+
+    return neu_cpus_empty(cpus) ? -1 : 0;
+}
+
+int neu_cpus_numa(int node, neu_cpus_t *cpus)
+{
+    char  path[64]   = { 0 };
+    char  list[4096] = { 0 };
+    FILE *fp         = NULL;
+    int   ret        = -1;
+
+    if (node < 0) {
+        return -1;
+    }
+
+    snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist",
+             node);
+    fp = fopen(path, "r");
+    if (fp == NULL) {
+        return -1;
+    }
+    if (fgets(list, sizeof(list), fp) != NULL) {
+        ret = neu_cpus_parse(list, cpus);
+    }
+    fclose(fp);
+
+    return ret;
+}
+
+bool neu_cpus_empty(const neu_cpus_t *cpus)
+{
+    for (size_t i = 0; i < sizeof(cpus->bits) / sizeof(cpus->bits[0]); i++) {
+        if (cpus->bits[i] != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int neu_thread_set_affinity(pthread_t thread, const neu_cpus_t *cpus)
+{
+#ifdef NEU_PLATFORM_LINUX
+    cpu_set_t set;
+
+    CPU_ZERO(&set);
+    if (cpus == NULL) {
+        // the main thread keeps what neuron was started with
+        if (sched_getaffinity(getpid(), sizeof(set), &set) != 0) {
+            return -1;
+        }
+    } else {
+        for (int cpu = 0; cpu < NEU_CPUS_MAX && cpu < CPU_SETSIZE; cpu++) {
+            if (cpus->bits[cpu / 64] & (1ULL << (cpu % 64))) {
+                CPU_SET(cpu, &set);
+            }
+        }
+    }
+
+    return pthread_setaffinity_np(thread, sizeof(set), &set) == 0 ? 0 : -1;
+#else
+    (void) thread;
+    (void) cpus;
+    return -1;
+#endif
+}
+
+int neu_sched_policy(const char *name)
+{
+    if (strcmp(name, "fifo") == 0) {
+        return SCHED_FIFO;
+    } else if (strcmp(name, "rr") == 0) {
+        return SCHED_RR;
+    } else if (strcmp(name, "other") == 0) {
+        return SCHED_OTHER;
+    }
+    return -1;
+}
+
+bool neu_sched_priority_valid(int policy, int priority)
+{
+    int min = sched_get_priority_min(policy);
+    int max = sched_get_priority_max(policy);
+
+    if (policy == SCHED_OTHER) {
+        return priority == 0;
+    }
+    return min >= 0 && priority >= min && priority <= max;
+}
+
+int neu_thread_set_sched(pthread_t thread, int policy, int priority)
+{
+    struct sched_param param = { .sched_priority = priority };
+
+    if (policy == SCHED_OTHER) {
+        param.sched_priority = 0;
+    }
+    return pthread_setschedparam(thread, policy, &param) == 0 ? 0 : -1;
+}
+
+int64_t neu_thread_cputime(pthread_t thread)
+{
+#ifdef NEU_PLATFORM_LINUX
+    clockid_t       clock = 0;
+    struct timespec ts    = { 0 };
+
+    if (pthread_getcpuclockid(thread, &clock) != 0 ||
+        clock_gettime(clock, &ts) != 0) {
+        return -1;
+    }
+    return (int64_t) ts.tv_sec * 1000 * 1000 * 1000 + ts.tv_nsec;
+#else
+    (void) thread;
+    return -1;
+#endif
+}
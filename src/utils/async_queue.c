@@ -16,13 +16,15 @@
  * along with this program; if not, write to the Free Software Foundation,
  * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 config_ **/
-
 #include <pthread.h>
 #include <stdlib.h>
 
 #include "utils/async_queue.h"
 #include "utils/utextend.h"
 
+// The elements are linked in the order they were pushed, and the first one
+// of each key is hashed. The others of the same key hang off it, oldest
+// first, so that a pop takes the element pushed first as a walk would.
 typedef struct element {
     uint64_t key;
 
@@ -30,6 +32,10 @@ typedef struct element {
 
     struct element *prev;
     struct element *next;
+
+    struct element *kprev; // of the same key
+    struct element *knext;
+    UT_hash_handle  hh;
 } element, element_list;
 
 struct neu_async_queue {
@@ -40,8 +46,10 @@ struct neu_async_queue {
     pthread_mutex_t mtx;
 
     uint16_t max;
+    uint16_t count;
 
     element_list *list;
+    element *     keys;
 };
 
 neu_async_queue_t *neu_async_queue_new(neu_async_queue_key    key_fn,
@@ -62,36 +70,50 @@ neu_async_queue_t *neu_async_queue_new(neu_async_queue_key    key_fn,
     return q;
 }
 
-void neu_async_queue_destroy(neu_async_queue_t *q)
+// must be called with the queue locked
+static void unlink_elem(neu_async_queue_t *q, element *elt)
 {
-    element *elt = NULL, *tmp = NULL;
-
-    pthread_mutex_lock(&q->mtx);
-    DL_FOREACH_SAFE(q->list, elt, tmp)
-    {
-        q->free_fn(elt->data);
-        DL_DELETE(q->list, elt);
-        free(elt);
+    element *head  = NULL;
+    element *chain = NULL;
+
+    DL_DELETE(q->list, elt);
+
+    HASH_FIND(hh, q->keys, &elt->key, sizeof(elt->key), head);
+    chain = head;
+    DL_DELETE2(chain, elt, kprev, knext);
+    if (head == elt) {
+        HASH_DEL(q->keys, elt);
+        if (chain != NULL) {
+            HASH_ADD(hh, q->keys, key, sizeof(chain->key), chain);
+        }
     }
-    pthread_mutex_unlock(&q->mtx);
 
+    q->count -= 1;
+}
+
+// must be called with the queue locked
+static void free_elem(neu_async_queue_t *q, element *elt)
+{
+    unlink_elem(q, elt);
+    q->free_fn(elt->data);
+    free(elt);
+}
+
+void neu_async_queue_destroy(neu_async_queue_t *q)
+{
+    neu_async_queue_clean(q);
     pthread_mutex_destroy(&q->mtx);
     free(q);
 }
 
 void neu_async_queue_push(neu_async_queue_t *q, void *elem)
 {
-    element *elt   = NULL;
-    int      count = 0;
+    element *elt  = NULL;
+    element *head = NULL;
 
     pthread_mutex_lock(&q->mtx);
-    DL_COUNT(q->list, elt, count);
-
-    if (count == q->max && count > 0) {
-        elt = q->list;
-        DL_DELETE(q->list, elt);
-        q->free_fn(elt->data);
-        free(elt);
+    if (q->count == q->max && q->count > 0) {
+        free_elem(q, q->list);
     }
 
     elt       = calloc(1, sizeof(element));
@@ -99,37 +121,61 @@ void neu_async_queue_push(neu_async_queue_t *q, void *elem)
     elt->key  = q->key_fn(elem);
 
     DL_APPEND(q->list, elt);
+    HASH_FIND(hh, q->keys, &elt->key, sizeof(elt->key), head);
+    if (head != NULL) {
+        DL_APPEND2(head, elt, kprev, knext);
+    } else {
+        DL_APPEND2(head, elt, kprev, knext);
+        HASH_ADD(hh, q->keys, key, sizeof(elt->key), elt);
+    }
+    q->count += 1;
 
     pthread_mutex_unlock(&q->mtx);
 }
 
 int neu_async_queue_pop(neu_async_queue_t *q, uint64_t key, void **elem)
 {
-    element *elt = NULL, *tmp = NULL;
+    element *elt = NULL;
     int      ret = -1;
 
     pthread_mutex_lock(&q->mtx);
-    DL_FOREACH_SAFE(q->list, elt, tmp)
-    {
-        if (elt->key == key) {
-            DL_DELETE(q->list, elt);
-            *elem = elt->data;
-            free(elt);
-            ret = 0;
-            break;
-        } else {
-            if (q->expire_fn(elt->data)) {
-                DL_DELETE(q->list, elt);
-                q->free_fn(elt->data);
-                free(elt);
-            }
-        }
+    HASH_FIND(hh, q->keys, &key, sizeof(key), elt);
+    if (elt != NULL) {
+        unlink_elem(q, elt);
+        *elem = elt->data;
+        free(elt);
+        ret = 0;
     }
     pthread_mutex_unlock(&q->mtx);
 
     return ret;
 }
 
+int neu_async_queue_sweep(neu_async_queue_t *q)
+{
+    int n = 0;
+
+    pthread_mutex_lock(&q->mtx);
+    while (q->list != NULL && q->expire_fn(q->list->data)) {
+        free_elem(q, q->list);
+        n += 1;
+    }
+    pthread_mutex_unlock(&q->mtx);
+
+    return n;
+}
+
+uint16_t neu_async_queue_count(neu_async_queue_t *q)
+{
+    uint16_t count = 0;
+
+    pthread_mutex_lock(&q->mtx);
+    count = q->count;
+    pthread_mutex_unlock(&q->mtx);
+
+    return count;
+}
+
 void neu_async_queue_remove(neu_async_queue_t *q, neu_async_queue_filter filter,
                             void *filter_elem)
 {
@@ -139,9 +185,7 @@ void neu_async_queue_remove(neu_async_queue_t *q, neu_async_queue_filter filter,
     DL_FOREACH_SAFE(q->list, el, tmp)
     {
         if (filter(filter_elem, el->data)) {
-            DL_DELETE(q->list, el);
-            q->free_fn(el->data);
-            free(el);
+            free_elem(q, el);
         }
     }
     pthread_mutex_unlock(&q->mtx);
@@ -152,11 +196,13 @@ void neu_async_queue_clean(neu_async_queue_t *q)
     element *el = NULL, *tmp = NULL;
 
     pthread_mutex_lock(&q->mtx);
+    HASH_CLEAR(hh, q->keys);
     DL_FOREACH_SAFE(q->list, el, tmp)
     {
         DL_DELETE(q->list, el);
         q->free_fn(el->data);
         free(el);
     }
+    q->count = 0;
     pthread_mutex_unlock(&q->mtx);
-}
\ No newline at end of file
+}
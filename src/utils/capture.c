@@ -0,0 +1,234 @@
+/**
+ * NEURON IIoT System for Industry 4.0
+ * Copyright (C) 2020-2023 EMQ Technologies Co., Ltd All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ **/
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "define.h"
+#include "errcodes.h"
+#include "utils/capture.h"
+#include "utils/log.h"
+#include "utils/uthash.h"
+
+#define PCAP_MAGIC 0xa1b2c3d4
+#define PCAP_LINKTYPE_USER0 147
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version_major;
+    uint16_t version_minor;
+    int32_t  thiszone;
+    uint32_t sigfigs;
+    uint32_t snaplen;
+    uint32_t linktype;
+} pcap_header_t;
+
+typedef struct {
+    uint32_t ts_sec;
+    uint32_t ts_usec;
+    uint32_t incl_len;
+    uint32_t orig_len;
+} pcap_record_t;
+
+typedef struct {
+    pcap_record_t record;
+    uint8_t       data[1 + NEU_CAPTURE_SNAPLEN];
+} packet_t;
+
+typedef struct {
+    char             node[NEU_NODE_NAME_LEN];
+    zlog_category_t *log;
+
+    pthread_mutex_t mtx;
+    packet_t *      packets;
+    uint32_t        n_packet;
+    uint32_t        next;
+    bool            full;
+
+    UT_hash_handle hh;
+} capture_t;
+
+int neu_capture_count = 0;
+
+static pthread_rwlock_t rwlock   = PTHREAD_RWLOCK_INITIALIZER;
+static capture_t *      captures = NULL;
+
+static void capture_free(capture_t *capture)
+{
+    pthread_mutex_destroy(&capture->mtx);
+    free(capture->packets);
+    free(capture);
+}
+
+int neu_capture_start(const char *node, zlog_category_t *log,
+                      uint32_t n_packet)
+{
+    capture_t *capture = NULL;
+
+    if (strlen(node) >= NEU_NODE_NAME_LEN) {
+        return NEU_ERR_NODE_NAME_TOO_LONG;
+    }
+
+    if (n_packet == 0) {
+        n_packet = NEU_CAPTURE_PACKETS_DEFAULT;
+    } else if (n_packet > NEU_CAPTURE_PACKETS_MAX) {
+        n_packet = NEU_CAPTURE_PACKETS_MAX;
+    }
+
+    capture = calloc(1, sizeof(capture_t));
+    if (NULL == capture) {
+        return NEU_ERR_EINTERNAL;
+    }
+    capture->packets = calloc(n_packet, sizeof(packet_t));
+    if (NULL == capture->packets) {
+        free(capture);
+        return NEU_ERR_EINTERNAL;
+    }
+    strcpy(capture->node, node);
+    capture->log      = log;
+    capture->n_packet = n_packet;
+    pthread_mutex_init(&capture->mtx, NULL);
+
+    // starting again drops what was captured so far
+    neu_capture_stop(node);
+
+    pthread_rwlock_wrlock(&rwlock);
+    HASH_ADD_STR(captures, node, capture);
+    __atomic_add_fetch(&neu_capture_count, 1, __ATOMIC_RELAXED);
+    pthread_rwlock_unlock(&rwlock);
+
+    nlog_notice("node %s start capture of %" PRIu32 " packets", node,
+                n_packet);
+    return NEU_ERR_SUCCESS;
+}
+
+void neu_capture_stop(const char *node)
+{
+    capture_t *capture = NULL;
+
+    pthread_rwlock_wrlock(&rwlock);
+    HASH_FIND_STR(captures, node, capture);
+    if (NULL != capture) {
+        HASH_DEL(captures, capture);
+        __atomic_sub_fetch(&neu_capture_count, 1, __ATOMIC_RELAXED);
+    }
+    pthread_rwlock_unlock(&rwlock);
+
+    if (NULL != capture) {
+        nlog_notice("node %s stop capture", node);
+        capture_free(capture);
+    }
+}
+
+void neu_capture_packet(zlog_category_t *log, bool send, const uint8_t *bytes,
+                        uint16_t n_byte)
+{
+    capture_t *    capture = NULL, *tmp = NULL;
+    struct timeval tv      = { 0 };
+    uint16_t       n       = n_byte;
+
+    if (n > NEU_CAPTURE_SNAPLEN) {
+        n = NEU_CAPTURE_SNAPLEN;
+    }
+
+    gettimeofday(&tv, NULL);
+
+    pthread_rwlock_rdlock(&rwlock);
+    HASH_ITER(hh, captures, capture, tmp)
+    {
+        if (capture->log != log) {
+            continue;
+        }
+
+        pthread_mutex_lock(&capture->mtx);
+        packet_t *packet        = &capture->packets[capture->next];
+        packet->record.ts_sec   = (uint32_t) tv.tv_sec;
+        packet->record.ts_usec  = (uint32_t) tv.tv_usec;
+        packet->record.incl_len = 1 + n;
+        packet->record.orig_len = 1 + n_byte;
+        packet->data[0]         = send ? 1 : 0;
+        memcpy(packet->data + 1, bytes, n);
+
+        capture->next += 1;
+        if (capture->next == capture->n_packet) {
+            capture->next = 0;
+            capture->full = true;
+        }
+        pthread_mutex_unlock(&capture->mtx);
+        break;
+    }
+    pthread_rwlock_unlock(&rwlock);
+}
+
+int neu_capture_dump(const char *node, uint8_t **data, size_t *len)
+{
+    capture_t *   capture = NULL;
+    pcap_header_t header  = {
+        .magic         = PCAP_MAGIC,
+        .version_major = 2,
+        .version_minor = 4,
+        .snaplen       = 1 + NEU_CAPTURE_SNAPLEN,
+        .linktype      = PCAP_LINKTYPE_USER0,
+    };
+    size_t   size = sizeof(header);
+    uint8_t *buf  = NULL;
+
+    pthread_rwlock_rdlock(&rwlock);
+    HASH_FIND_STR(captures, node, capture);
+    if (NULL != capture) {
+        pthread_mutex_lock(&capture->mtx);
+        size += (size_t) capture->n_packet * sizeof(packet_t);
+    }
+
+    buf = malloc(size);
+    if (NULL == buf) {
+        if (NULL != capture) {
+            pthread_mutex_unlock(&capture->mtx);
+        }
+        pthread_rwlock_unlock(&rwlock);
+        return NEU_ERR_EINTERNAL;
+    }
+
+    memcpy(buf, &header, sizeof(header));
+    size = sizeof(header);
+
+    if (NULL != capture) {
+        // oldest first, that is from next on once the ring has wrapped
+        uint32_t start = capture->full ? capture->next : 0;
+        uint32_t count = capture->full ? capture->n_packet : capture->next;
+
+        for (uint32_t i = 0; i < count; i++) {
+            uint32_t  index  = (start + i) % capture->n_packet;
+            packet_t *packet = &capture->packets[index];
+
+            memcpy(buf + size, &packet->record, sizeof(packet->record));
+            size += sizeof(packet->record);
+            memcpy(buf + size, packet->data, packet->record.incl_len);
+            size += packet->record.incl_len;
+        }
+        pthread_mutex_unlock(&capture->mtx);
+    }
+    pthread_rwlock_unlock(&rwlock);
+
+    *data = buf;
+    *len  = size;
+    return NEU_ERR_SUCCESS;
+}
@@ -0,0 +1,476 @@
+/**
+ * NEURON IIoT System for Industry 4.0
+ * Copyright (C) 2020-2023 EMQ Technologies Co., Ltd All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ **/
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "utils/history.h"
+
+// the most bits one sample after the first takes: a 4 bit timestamp prefix
+// with 64 bits of delta of delta, and a 2 bit value prefix with 5 bits of
+// leading zeros, 6 bits of length and 64 meaningful bits
+#define SAMPLE_BITS_MAX (4 + 64 + 2 + 5 + 6 + 64)
+#define BLOCK_BITS (NEU_HISTORY_BLOCK_SIZE * 8)
+
+typedef struct {
+    int64_t  first; // timestamp of the first sample
+    int64_t  last;  // timestamp of the last sample
+    uint32_t count;
+    uint32_t bits; // written to data
+    uint8_t  data[NEU_HISTORY_BLOCK_SIZE];
+} block_t;
+
+// what the next sample is encoded or decoded against
+typedef struct {
+    int64_t  ts;
+    int64_t  delta;
+    uint64_t value;
+    uint8_t  leading;
+    uint8_t  trailing;
+} codec_t;
+
+struct neu_history {
+    uint32_t  n_block; // most blocks kept
+    uint32_t  head;    // ring index of the oldest block
+    uint32_t  used;    // blocks in the ring
+    block_t **blocks;  // n_block slots, allocated on first use
+    codec_t   codec;   // of the newest block
+};
+
+typedef struct {
+    const block_t *block;
+    uint32_t       pos;
+} reader_t;
+
+static void put_bits(block_t *block, uint64_t v, uint8_t n)
+{
+    while (n > 0) {
+        uint8_t room = 8 - block->bits % 8;
+        uint8_t take = n < room ? n : room;
+        uint8_t part = (v >> (n - take)) & ((1u << take) - 1);
+
+        block->data[block->bits / 8] |= part << (room - take);
+        block->bits += take;
+        n -= take;
+    }
+}
+
+static uint64_t get_bits(reader_t *reader, uint8_t n)
+{
+    uint64_t v = 0;
+
+    while (n > 0) {
+        uint8_t room = 8 - reader->pos % 8;
+        uint8_t take = n < room ? n : room;
+        uint8_t part = reader->block->data[reader->pos / 8] >> (room - take);
+
+        v = (v << take) | (part & ((1u << take) - 1));
+        reader->pos += take;
+        n -= take;
+    }
+
+    return v;
+}
+
+static inline uint64_t double_bits(double value)
+{
+    uint64_t bits = 0;
+
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+static inline double bits_double(uint64_t bits)
+{
+    double value = 0;
+
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+static void encode_ts(block_t *block, codec_t *codec, int64_t ts)
+{
+    int64_t delta = ts - codec->ts;
+    int64_t dod   = delta - codec->delta;
+
+    if (dod == 0) {
+        put_bits(block, 0, 1);
+    } else if (dod >= -63 && dod <= 64) {
+        put_bits(block, 0x2, 2);
+        put_bits(block, dod + 63, 7);
+    } else if (dod >= -255 && dod <= 256) {
+        put_bits(block, 0x6, 3);
+        put_bits(block, dod + 255, 9);
+    } else if (dod >= -2047 && dod <= 2048) {
+        put_bits(block, 0xe, 4);
+        put_bits(block, dod + 2047, 12);
+    } else {
+        put_bits(block, 0xf, 4);
+        put_bits(block, (uint64_t) dod, 64);
+    }
+
+    codec->ts    = ts;
+    codec->delta = delta;
+}
+
+static int64_t decode_ts(reader_t *reader, codec_t *codec)
+{
+    int64_t dod = 0;
+
+    if (get_bits(reader, 1) == 0) {
+        dod = 0;
+    } else if (get_bits(reader, 1) == 0) {
+        dod = (int64_t) get_bits(reader, 7) - 63;
+    } else if (get_bits(reader, 1) == 0) {
+        dod = (int64_t) get_bits(reader, 9) - 255;
+    } else if (get_bits(reader, 1) == 0) {
+        dod = (int64_t) get_bits(reader, 12) - 2047;
+    } else {
+        dod = (int64_t) get_bits(reader, 64);
+    }
+
+    codec->delta += dod;
+    codec->ts += codec->delta;
+    return codec->ts;
+}
+
+static void encode_value(block_t *block, codec_t *codec, uint64_t value)
+{
+    uint64_t x        = value ^ codec->value;
+    uint8_t  leading  = 0;
+    uint8_t  trailing = 0;
+
+    codec->value = value;
+    if (x == 0) {
+        put_bits(block, 0, 1);
+        return;
+    }
+
+    leading  = __builtin_clzll(x);
+    trailing = __builtin_ctzll(x);
+    // leading zeros are written in 5 bits
+    if (leading > 31) {
+        leading = 31;
+    }
+
+    if (codec->leading <= leading && codec->trailing <= trailing) {
+        // the meaningful bits fit the window of the previous value
+        put_bits(block, 0x2, 2);
+        put_bits(block, x >> codec->trailing,
+                 64 - codec->leading - codec->trailing);
+    } else {
+        uint8_t length = 64 - leading - trailing;
+
+        put_bits(block, 0x3, 2);
+        put_bits(block, leading, 5);
+        // a length of 64 does not fit 6 bits and is written as 0
+        put_bits(block, length & 0x3f, 6);
+        put_bits(block, x >> trailing, length);
+        codec->leading  = leading;
+        codec->trailing = trailing;
+    }
+}
+
+static uint64_t decode_value(reader_t *reader, codec_t *codec)
+{
+    if (get_bits(reader, 1) == 0) {
+        return codec->value;
+    }
+
+    if (get_bits(reader, 1) == 1) {
+        uint8_t length = 0;
+
+        codec->leading = get_bits(reader, 5);
+        length         = get_bits(reader, 6);
+        if (length == 0) {
+            length = 64;
+        }
+        codec->trailing = 64 - codec->leading - length;
+    }
+
+    codec->value ^= get_bits(reader, 64 - codec->leading - codec->trailing)
+        << codec->trailing;
+    return codec->value;
+}
+
+// the first sample of a block is written as is
+static void codec_start(block_t *block, codec_t *codec, int64_t ts,
+                        uint64_t value)
+{
+    put_bits(block, (uint64_t) ts, 64);
+    put_bits(block, value, 64);
+
+    codec->ts    = ts;
+    codec->delta = 0;
+    codec->value = value;
+    // no window yet, the first xor writes its own
+    codec->leading  = UINT8_MAX;
+    codec->trailing = UINT8_MAX;
+}
+
+static void codec_read_first(reader_t *reader, codec_t *codec)
+{
+    codec->ts       = (int64_t) get_bits(reader, 64);
+    codec->delta    = 0;
+    codec->value    = get_bits(reader, 64);
+    codec->leading  = UINT8_MAX;
+    codec->trailing = UINT8_MAX;
+}
+
+neu_history_t *neu_history_new(size_t size)
+{
+    neu_history_t *history = calloc(1, sizeof(neu_history_t));
+
+    history->n_block = size / sizeof(block_t);
+    if (history->n_block < 2) {
+        history->n_block = 2;
+    }
+    history->blocks = calloc(history->n_block, sizeof(block_t *));
+
+    return history;
+}
+
+void neu_history_free(neu_history_t *history)
+{
+    if (history == NULL) {
+        return;
+    }
+
+    for (uint32_t i = 0; i < history->n_block; i++) {
+        free(history->blocks[i]);
+    }
+    free(history->blocks);
+    free(history);
+}
+
+static inline block_t *history_block(const neu_history_t *history, uint32_t i)
+{
+    return history->blocks[(history->head + i) % history->n_block];
+}
+
+// the block the next sample goes to, the oldest one is reused once the ring
+// is full
+static block_t *history_next_block(neu_history_t *history)
+{
+    uint32_t slot = 0;
+
+    if (history->used == history->n_block) {
+        slot          = history->head;
+        history->head = (history->head + 1) % history->n_block;
+    } else {
+        slot = (history->head + history->used) % history->n_block;
+        history->used += 1;
+    }
+
+    if (history->blocks[slot] == NULL) {
+        history->blocks[slot] = malloc(sizeof(block_t));
+    }
+    memset(history->blocks[slot], 0, sizeof(block_t));
+
+    return history->blocks[slot];
+}
+
+int neu_history_append(neu_history_t *history, int64_t timestamp, double value)
+{
+    block_t *block = NULL;
+
+    if (!isfinite(value)) {
+        return -1;
+    }
+
+    if (history->used > 0) {
+        block = history_block(history, history->used - 1);
+        if (timestamp < block->last) {
+            return -1;
+        }
+        if (block->bits + SAMPLE_BITS_MAX > BLOCK_BITS) {
+            block = NULL;
+        }
+    }
+
+    if (block == NULL) {
+        block = history_next_block(history);
+        codec_start(block, &history->codec, timestamp, double_bits(value));
+        block->first = timestamp;
+    } else {
+        encode_ts(block, &history->codec, timestamp);
+        encode_value(block, &history->codec, double_bits(value));
+    }
+
+    block->last = timestamp;
+    block->count += 1;
+    return 0;
+}
+
+size_t neu_history_size(const neu_history_t *history)
+{
+    size_t size = 0;
+
+    for (uint32_t i = 0; i < history->n_block; i++) {
+        if (history->blocks[i] != NULL) {
+            size += sizeof(block_t);
+        }
+    }
+
+    return size;
+}
+
+size_t neu_history_shrink(neu_history_t *history, size_t size)
+{
+    uint32_t  n      = size / sizeof(block_t);
+    uint32_t  keep   = 0;
+    size_t    before = neu_history_size(history);
+    block_t **blocks = NULL;
+
+    if (n < 2) {
+        n = 2;
+    }
+    if (n >= history->n_block) {
+        return 0;
+    }
+
+    blocks = calloc(n, sizeof(block_t *));
+    if (blocks == NULL) {
+        return 0;
+    }
+
+    // the newest blocks move to the front of the new ring, the codec goes
+    // on from the last of them
+    keep = history->used < n ? history->used : n;
+    for (uint32_t i = 0; i < history->used; i++) {
+        block_t *block = history_block(history, i);
+
+        if (i < history->used - keep) {
+            free(block);
+        } else {
+            blocks[i - (history->used - keep)] = block;
+        }
+    }
+
+    free(history->blocks);
+    history->blocks  = blocks;
+    history->n_block = n;
+    history->head    = 0;
+    history->used    = keep;
+
+    return before - neu_history_size(history);
+}
+
+typedef struct {
+    int64_t             step;
+    uint32_t            max;
+    UT_array *          points;
+    neu_history_point_t bucket; // count 0 while none is open
+} query_t;
+
+static bool query_flush(query_t *query)
+{
+    if (query->bucket.count == 0) {
+        return true;
+    }
+    if (utarray_len(query->points) >= query->max) {
+        return false;
+    }
+
+    query->bucket.avg /= query->bucket.count;
+    utarray_push_back(query->points, &query->bucket);
+    query->bucket.count = 0;
+    return true;
+}
+
+// false once max points are taken
+static bool query_add(query_t *query, int64_t ts, double value)
+{
+    int64_t              start  = ts;
+    neu_history_point_t *bucket = &query->bucket;
+
+    if (query->step > 0) {
+        start = ts - ts % query->step;
+        if (ts < 0 && start != ts) {
+            start -= query->step;
+        }
+    }
+
+    if (bucket->count > 0 && bucket->timestamp != start &&
+        !query_flush(query)) {
+        return false;
+    }
+
+    if (bucket->count == 0) {
+        bucket->timestamp = start;
+        bucket->min       = value;
+        bucket->max       = value;
+        bucket->avg       = 0;
+    }
+
+    bucket->count += 1;
+    bucket->min = value < bucket->min ? value : bucket->min;
+    bucket->max = value > bucket->max ? value : bucket->max;
+    bucket->avg += value;
+    bucket->last = value;
+
+    // a sample is a point of its own
+    return query->step > 0 || query_flush(query);
+}
+
+int neu_history_query(const neu_history_t *history, int64_t since,
+                      int64_t until, int64_t step, uint32_t max,
+                      UT_array *points)
+{
+    query_t query = {
+        .step   = step,
+        .max    = max,
+        .points = points,
+    };
+
+    for (uint32_t i = 0; i < history->used; i++) {
+        const block_t *block  = history_block(history, i);
+        reader_t       reader = { .block = block };
+        codec_t        codec  = { 0 };
+
+        if (block->last < since) {
+            continue;
+        }
+        if (block->first >= until) {
+            break;
+        }
+
+        codec_read_first(&reader, &codec);
+        for (uint32_t j = 0; j < block->count; j++) {
+            int64_t  ts    = codec.ts;
+            uint64_t value = codec.value;
+
+            if (j > 0) {
+                ts    = decode_ts(&reader, &codec);
+                value = decode_value(&reader, &codec);
+            }
+
+            if (ts >= until) {
+                break;
+            }
+            if (ts >= since && !query_add(&query, ts, bits_double(value))) {
+                return 1;
+            }
+        }
+    }
+
+    return query_flush(&query) ? 0 : 1;
+}
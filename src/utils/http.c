@@ -28,13 +28,118 @@
 #include <nng/nng.h>
 #include <nng/supplemental/http/http.h>
 
+#ifdef NEU_HTTP_GZIP
+#include <zlib.h>
+#endif
+
 #include "errcodes.h"
 #include "utils/http.h"
+#include "utils/http_handler.h"
 #include "utils/log.h"
 
+// W/"<16 hex digits>"
+#define HTTP_ETAG_SIZE 21
+// smaller bodies are not worth the deflate
+#define HTTP_GZIP_MIN_SIZE 1024
+
+// A weak validator over the body, so that a client polling a list that did
+// not change gets a 304 instead of the whole document again. It is weak as
+// the gzip and identity forms of the body share it.
+static void http_etag(const char *content, size_t len, char *etag)
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (unsigned char) content[i];
+        hash *= 0x100000001b3ULL;
+    }
+
+    snprintf(etag, HTTP_ETAG_SIZE, "W/\"%016" PRIx64 "\"", hash);
+}
+
+// If-None-Match is `*` or a list of entity tags, compared weakly
+static bool http_etag_match(const char *header, const char *etag)
+{
+    // skip the W/ in both
+    const char *opaque = etag + 2;
+    size_t      len    = strlen(opaque);
+
+    while (*header != '\0') {
+        header += strspn(header, " \t,");
+        if (*header == '*') {
+            return true;
+        }
+        if (strncmp(header, "W/", 2) == 0) {
+            header += 2;
+        }
+        if (strncmp(header, opaque, len) == 0 &&
+            strchr(" \t,", header[len]) != NULL) {
+            return true;
+        }
+        header += strcspn(header, ",");
+    }
+
+    return false;
+}
+
+#ifdef NEU_HTTP_GZIP
+static bool http_accept_gzip(nng_http_req *req)
+{
+    const char *accept = nng_http_req_get_header(req, "Accept-Encoding");
+
+    while (accept != NULL && *accept != '\0') {
+        accept += strspn(accept, " \t,");
+        size_t len = strcspn(accept, ",");
+
+        if (strncmp(accept, "gzip", 4) == 0 &&
+            (len == 4 || strchr(" \t;", accept[4]) != NULL)) {
+            const char *q = memchr(accept, ';', len);
+            // a zero weight (q=0, q=0.0...) refuses gzip
+            return q == NULL || strtod(q + strcspn(q, "=") + 1, NULL) > 0;
+        }
+        accept += len;
+    }
+
+    return false;
+}
+
+// gzip `content` into a new buffer, returns NULL if it does not shrink
+static void *http_gzip(const char *content, size_t len, size_t *gz_len)
+{
+    z_stream zs  = { 0 };
+    void *   out = NULL;
+
+    if (deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8,
+                     Z_DEFAULT_STRATEGY) != Z_OK) {
+        return NULL;
+    }
+
+    *gz_len = deflateBound(&zs, len);
+    out     = malloc(*gz_len);
+    if (out != NULL) {
+        zs.next_in   = (Bytef *) content;
+        zs.avail_in  = len;
+        zs.next_out  = out;
+        zs.avail_out = *gz_len;
+        if (deflate(&zs, Z_FINISH) == Z_STREAM_END && zs.total_out < len) {
+            *gz_len = zs.total_out;
+        } else {
+            free(out);
+            out = NULL;
+        }
+    }
+
+    deflateEnd(&zs);
+    return out;
+}
+#endif
+
 static int response(nng_aio *aio, char *content, enum nng_http_status status)
 {
-    nng_http_res *res = NULL;
+    nng_http_res *res     = NULL;
+    nng_http_req *nng_req = nng_aio_get_input(aio, 0);
+    size_t        len     = content != NULL ? strlen(content) : 0;
+    char          etag[HTTP_ETAG_SIZE];
 
     nng_http_res_alloc(&res);
 
@@ -44,16 +149,43 @@ static int response(nng_aio *aio, char *content, enum nng_http_status status)
                             "POST,GET,PUT,DELETE,OPTIONS");
     nng_http_res_set_header(res, "Access-Control-Allow-Headers", "*");
 
-    if (content != NULL && strlen(content) > 0) {
-        nng_http_res_copy_data(res, content, strlen(content));
+    if (status == NNG_HTTP_STATUS_OK && len > 0 &&
+        strcmp(nng_http_req_get_method(nng_req), "GET") == 0) {
+        const char *match = nng_http_req_get_header(nng_req, "If-None-Match");
+
+        http_etag(content, len, etag);
+        nng_http_res_set_header(res, "ETag", etag);
+        if (match != NULL && http_etag_match(match, etag)) {
+            status = NNG_HTTP_STATUS_NOT_MODIFIED;
+            len    = 0;
+        }
+    }
+
+#ifdef NEU_HTTP_GZIP
+    nng_http_res_set_header(res, "Vary", "Accept-Encoding");
+    if (len >= HTTP_GZIP_MIN_SIZE && http_accept_gzip(nng_req)) {
+        size_t gz_len = 0;
+        void * gz     = http_gzip(content, len, &gz_len);
+
+        if (gz != NULL) {
+            nng_http_res_set_header(res, "Content-Encoding", "gzip");
+            nng_http_res_copy_data(res, gz, gz_len);
+            free(gz);
+            len = 0;
+        }
+    }
+#endif
+
+    if (len > 0) {
+        nng_http_res_copy_data(res, content, len);
     }
 
     nng_http_res_set_status(res, status);
 
-    nng_http_req *nng_req = nng_aio_get_input(aio, 0);
     nlog_notice("<%p> %s %s [%d]", aio, nng_http_req_get_method(nng_req),
                 nng_http_req_get_uri(nng_req), status);
 
+    neu_http_handler_done(aio);
     nng_aio_set_output(aio, 0, res);
     nng_aio_finish(aio, 0);
 
@@ -103,6 +235,16 @@ int neu_http_get_body(nng_aio *aio, void **data, size_t *data_size)
     }
 }
 
+int neu_http_get_body_ref(nng_aio *aio, const char **data, size_t *data_size)
+{
+    nng_http_req *req  = nng_aio_get_input(aio, 0);
+    void *        body = NULL;
+
+    nng_http_req_get_data(req, &body, data_size);
+    *data = body;
+    return *data_size == 0 ? -1 : 0;
+}
+
 // Find query parameter value of the given name.
 //
 // On failure, returns NULL.
@@ -246,6 +388,8 @@ int neu_http_response(nng_aio *aio, neu_err_code_e code, char *content)
     case NEU_ERR_NODE_SETTING_NOT_FOUND:
     case NEU_ERR_PLUGIN_READ_FAILURE:
     case NEU_ERR_PLUGIN_WRITE_FAILURE:
+    case NEU_ERR_PLUGIN_WRITE_VERIFY_FAILURE:
+    case NEU_ERR_PLUGIN_WRITE_SUPERSEDED:
     case NEU_ERR_PLUGIN_DISCONNECTED:
     case NEU_ERR_PLUGIN_TAG_NOT_ALLOW_READ:
     case NEU_ERR_PLUGIN_TAG_NOT_ALLOW_WRITE:
@@ -271,6 +415,7 @@ int neu_http_response(nng_aio *aio, neu_err_code_e code, char *content)
         break;
     case NEU_ERR_EINTERNAL:
     case NEU_ERR_IS_BUSY:
+    case NEU_ERR_MEM_BUDGET_EXCEEDED:
         status = NNG_HTTP_STATUS_INTERNAL_SERVER_ERROR;
         break;
     case NEU_ERR_EXPIRED_TOKEN:
@@ -352,6 +497,7 @@ int neu_http_response(nng_aio *aio, neu_err_code_e code, char *content)
     case NEU_ERR_LIBRARY_NAME_CONFLICT:
     case NEU_ERR_GROUP_EXIST:
     case NEU_ERR_GROUP_NOT_ALLOW:
+    case NEU_ERR_TAG_HISTORY_DISABLED:
     case NEU_ERR_LIBRARY_NOT_ALLOW_CREATE_INSTANCE:
     case NEU_ERR_NODE_NOT_ALLOW_DELETE:
     case NEU_ERR_TEMPLATE_EXIST:
@@ -413,3 +559,31 @@ int neu_http_internal_error(nng_aio *aio, char *content)
 {
     return response(aio, content, NNG_HTTP_STATUS_INTERNAL_SERVER_ERROR);
 }
+
+int neu_http_response_file(nng_aio *aio, void *data, size_t len,
+                           const char *disposition)
+{
+    nng_http_res *res = NULL;
+
+    nng_http_res_alloc(&res);
+
+    nng_http_res_set_header(res, "Content-Type", "application/octet-stream");
+    nng_http_res_set_header(res, "Content-Disposition", disposition);
+    nng_http_res_set_header(res, "Access-Control-Allow-Origin", "*");
+    nng_http_res_set_header(res, "Access-Control-Allow-Methods",
+                            "POST,GET,PUT,DELETE,OPTIONS");
+    nng_http_res_set_header(res, "Access-Control-Allow-Headers", "*");
+
+    nng_http_res_copy_data(res, data, len);
+    nng_http_res_set_status(res, NNG_HTTP_STATUS_OK);
+
+    nng_http_req *nng_req = nng_aio_get_input(aio, 0);
+    nlog_notice("<%p> %s %s [%d]", aio, nng_http_req_get_method(nng_req),
+                nng_http_req_get_uri(nng_req), NNG_HTTP_STATUS_OK);
+
+    neu_http_handler_done(aio);
+    nng_aio_set_output(aio, 0, res);
+    nng_aio_finish(aio, 0);
+
+    return 0;
+}
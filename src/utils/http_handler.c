@@ -17,27 +17,300 @@
  * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
  **/
 #include <assert.h>
+#include <inttypes.h>
+#include <pthread.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 #include <nng/nng.h>
 #include <nng/supplemental/http/http.h>
 
+#include "errcodes.h"
 #include "utils/http_handler.h"
 #include "utils/log.h"
 
+// A function handler wrapped for the in flight limit and the timings. The
+// start of an admitted request is kept in output 1 of its aio, which nng
+// leaves to the handler, until neu_http_handler_done.
+typedef struct http_endpoint {
+    void (*handler)(nng_aio *aio);
+    char                     method[16];
+    char *                   url;
+    uint32_t                 max_inflight;
+    enum neu_http_queue      queue;
+    neu_http_handler_stats_t stats;
+    struct http_endpoint *   next;
+} http_endpoint_t;
+
+typedef struct http_job {
+    http_endpoint_t *ep;
+    nng_aio *        aio;
+    uintptr_t        stamp; // of the admission
+    struct http_job *next;
+} http_job_t;
+
+// the requests of one queue, served in order by workers of its own
+typedef struct {
+    const char *   name;
+    pthread_cond_t cond;
+    bool           started;
+    http_job_t *   head;
+    http_job_t *   tail;
+} http_queue_t;
+
+static struct {
+    pthread_mutex_t  mtx;
+    http_endpoint_t *endpoints;
+    uint32_t         workers; // of each queue
+    http_queue_t     queues[NEU_HTTP_QUEUE_HEAVY + 1];
+} http_ctx = {
+    .mtx     = PTHREAD_MUTEX_INITIALIZER,
+    .workers = NEU_HTTP_WORKERS_DEFAULT,
+    .queues  = {
+        [NEU_HTTP_QUEUE_LIGHT] = { .name = "light",
+                                   .cond = PTHREAD_COND_INITIALIZER },
+        [NEU_HTTP_QUEUE_HEAVY] = { .name = "heavy",
+                                   .cond = PTHREAD_COND_INITIALIZER },
+    },
+};
+
+// a monotonic millisecond stamp with the low bit set, never NULL as a pointer
+static uintptr_t http_stamp(void)
+{
+    struct timespec ts = { 0 };
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uintptr_t)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000) << 1 | 1;
+}
+
+static void *http_queue_worker(void *arg)
+{
+    http_queue_t *queue = arg;
+
+    for (;;) {
+        pthread_mutex_lock(&http_ctx.mtx);
+        while (queue->head == NULL) {
+            pthread_cond_wait(&queue->cond, &http_ctx.mtx);
+        }
+        http_job_t *job = queue->head;
+        queue->head     = job->next;
+        if (queue->head == NULL) {
+            queue->tail = NULL;
+        }
+        job->ep->stats.queue_ms += (http_stamp() - job->stamp) >> 1;
+        pthread_mutex_unlock(&http_ctx.mtx);
+
+        job->ep->handler(job->aio);
+        free(job);
+    }
+
+    return NULL;
+}
+
+// with http_ctx.mtx held
+static void http_queue_start(http_queue_t *queue)
+{
+    if (queue->started) {
+        return;
+    }
+    queue->started = true;
+
+    for (uint32_t i = 0; i < http_ctx.workers; i++) {
+        pthread_t tid;
+
+        if (pthread_create(&tid, NULL, http_queue_worker, queue) == 0) {
+            pthread_detach(tid);
+        } else {
+            nlog_error("http %s worker create fail", queue->name);
+        }
+    }
+}
+
+static int http_enqueue(http_endpoint_t *ep, nng_aio *aio, uintptr_t stamp)
+{
+    http_queue_t *queue = &http_ctx.queues[ep->queue];
+    http_job_t *  job   = calloc(1, sizeof(*job));
+    if (job == NULL) {
+        return -1;
+    }
+
+    job->ep    = ep;
+    job->aio   = aio;
+    job->stamp = stamp;
+
+    pthread_mutex_lock(&http_ctx.mtx);
+    if (queue->tail != NULL) {
+        queue->tail->next = job;
+    } else {
+        queue->head = job;
+    }
+    queue->tail = job;
+    pthread_cond_signal(&queue->cond);
+    pthread_mutex_unlock(&http_ctx.mtx);
+    return 0;
+}
+
+static void http_busy(nng_aio *aio)
+{
+    nng_http_res *res = NULL;
+    char          body[32];
+
+    snprintf(body, sizeof(body), "{\"error\": %d}", NEU_ERR_IS_BUSY);
+    nng_http_res_alloc(&res);
+    nng_http_res_set_header(res, "Content-Type", "application/json");
+    nng_http_res_set_header(res, "Access-Control-Allow-Origin", "*");
+    nng_http_res_set_header(res, "Access-Control-Allow-Methods",
+                            "POST,GET,PUT,DELETE,OPTIONS");
+    nng_http_res_set_header(res, "Access-Control-Allow-Headers", "*");
+    nng_http_res_copy_data(res, body, strlen(body));
+    nng_http_res_set_status(res, NNG_HTTP_STATUS_TOO_MANY_REQUESTS);
+
+    nng_aio_set_output(aio, 0, res);
+    nng_aio_finish(aio, 0);
+}
+
+static void http_endpoint_cb(nng_aio *aio)
+{
+    http_endpoint_t *ep = nng_http_handler_get_data(nng_aio_get_input(aio, 1));
+    bool             admit = false;
+
+    pthread_mutex_lock(&http_ctx.mtx);
+    admit = ep->stats.inflight < ep->max_inflight;
+    if (admit) {
+        ep->stats.inflight += 1;
+        ep->stats.requests += 1;
+    } else {
+        ep->stats.rejected += 1;
+    }
+    pthread_mutex_unlock(&http_ctx.mtx);
+
+    if (!admit) {
+        nlog_warn("<%p> %s %s rejected, %" PRIu32 " in flight", aio,
+                  ep->method, ep->url, ep->max_inflight);
+        nng_aio_set_output(aio, 1, NULL);
+        http_busy(aio);
+        return;
+    }
+
+    uintptr_t stamp = http_stamp();
+    nng_aio_set_output(aio, 1, (void *) stamp);
+    if (ep->queue != NEU_HTTP_QUEUE_NNG && http_enqueue(ep, aio, stamp) == 0) {
+        return;
+    }
+    ep->handler(aio);
+}
+
+static void http_endpoint_free(void *data)
+{
+    http_endpoint_t *ep = data;
+
+    pthread_mutex_lock(&http_ctx.mtx);
+    for (http_endpoint_t **p = &http_ctx.endpoints; *p != NULL;
+         p                   = &(*p)->next) {
+        if (*p == ep) {
+            *p = ep->next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&http_ctx.mtx);
+
+    free(ep->url);
+    free(ep);
+}
+
+void neu_http_handler_done(nng_aio *aio)
+{
+    uintptr_t stamp = (uintptr_t) nng_aio_get_output(aio, 1);
+    if (stamp == 0) {
+        return;
+    }
+
+    http_endpoint_t *ep = nng_http_handler_get_data(nng_aio_get_input(aio, 1));
+    uint64_t         ms = (http_stamp() - stamp) >> 1;
+
+    nng_aio_set_output(aio, 1, NULL);
+
+    pthread_mutex_lock(&http_ctx.mtx);
+    ep->stats.inflight -= 1;
+    ep->stats.duration_ms += ms;
+    if (ms > ep->stats.max_duration_ms) {
+        ep->stats.max_duration_ms = ms;
+    }
+    pthread_mutex_unlock(&http_ctx.mtx);
+}
+
+void neu_http_handler_visit_stats(neu_http_handler_stats_cb_t cb, void *data)
+{
+    pthread_mutex_lock(&http_ctx.mtx);
+    for (http_endpoint_t *ep = http_ctx.endpoints; ep != NULL; ep = ep->next) {
+        cb(&ep->stats, data);
+    }
+    pthread_mutex_unlock(&http_ctx.mtx);
+}
+
+void neu_http_set_workers(uint32_t n)
+{
+    if (n < 1) {
+        n = 1;
+    } else if (n > NEU_HTTP_WORKERS_MAX) {
+        n = NEU_HTTP_WORKERS_MAX;
+    }
+
+    pthread_mutex_lock(&http_ctx.mtx);
+    http_ctx.workers = n;
+    pthread_mutex_unlock(&http_ctx.mtx);
+}
+
+static http_endpoint_t *
+http_endpoint_new(const struct neu_http_handler *http_handler)
+{
+    http_endpoint_t *ep = calloc(1, sizeof(*ep));
+    if (ep == NULL || (ep->url = strdup(http_handler->url)) == NULL) {
+        free(ep);
+        return NULL;
+    }
+
+    ep->handler      = http_handler->value.handler;
+    ep->max_inflight = http_handler->max_inflight > 0
+        ? http_handler->max_inflight
+        : NEU_HTTP_DEFAULT_MAX_INFLIGHT;
+    ep->queue        = http_handler->queue;
+    ep->stats.method = ep->method;
+    ep->stats.url    = ep->url;
+    if (ep->queue != NEU_HTTP_QUEUE_NNG) {
+        pthread_mutex_lock(&http_ctx.mtx);
+        http_queue_start(&http_ctx.queues[ep->queue]);
+        pthread_mutex_unlock(&http_ctx.mtx);
+    }
+
+    return ep;
+}
+
 int neu_http_add_handler(nng_http_server *              server,
                          const struct neu_http_handler *http_handler)
 {
     nng_http_handler *handler;
     int               ret        = -1;
     char              method[16] = { 0 };
+    http_endpoint_t * ep         = NULL;
 
     switch (http_handler->type) {
     case NEU_HTTP_HANDLER_FUNCTION:
+        ep = http_endpoint_new(http_handler);
+        if (ep == NULL) {
+            return -1;
+        }
         ret = nng_http_handler_alloc(&handler, http_handler->url,
-                                     http_handler->value.handler);
+                                     http_endpoint_cb);
+        if (ret == 0) {
+            nng_http_handler_set_data(handler, ep, http_endpoint_free);
+        } else {
+            free(ep->url);
+            free(ep);
+            ep = NULL;
+        }
         break;
     case NEU_HTTP_HANDLER_DIRECTORY:
         ret = nng_http_handler_alloc_directory(&handler, http_handler->url,
@@ -79,6 +352,14 @@ int neu_http_add_handler(nng_http_server *              server,
     }
     assert(ret == 0);
 
+    if (ep != NULL) {
+        strcpy(ep->method, method);
+        pthread_mutex_lock(&http_ctx.mtx);
+        ep->next           = http_ctx.endpoints;
+        http_ctx.endpoints = ep;
+        pthread_mutex_unlock(&http_ctx.mtx);
+    }
+
     ret = nng_http_server_add_handler(server, handler);
     nlog_info("http add handler, method: %s, url: %s, ret: %d", method,
               http_handler->url, ret);
@@ -100,6 +381,7 @@ void neu_http_handle_cors(nng_aio *aio)
     nng_http_res_copy_data(res, " ", strlen(" "));
     nng_http_res_set_status(res, NNG_HTTP_STATUS_OK);
 
+    neu_http_handler_done(aio);
     nng_aio_set_output(aio, 0, res);
     nng_aio_finish(aio, 0);
 }
@@ -0,0 +1,224 @@
+/**
+ * NEURON IIoT System for Industry 4.0
+ * Copyright (C) 2020-2023 EMQ Technologies Co., Ltd All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ **/
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "utils/hash.h"
+#include "utils/intern.h"
+
+#define INTERN_CHUNK_BITS 10
+#define INTERN_CHUNK_SIZE (1u << INTERN_CHUNK_BITS)
+// at most INTERN_CHUNKS * INTERN_CHUNK_SIZE names
+#define INTERN_CHUNKS 4096
+#define INTERN_INIT_SLOTS 1024
+
+typedef struct intern_entry {
+    uint32_t id;
+    uint32_t hash;
+    char     str[];
+} intern_entry_t;
+
+// open addressing, slots are only ever filled, a table is never changed after
+// a bigger one replaces it, so readers of a replaced table stay safe
+typedef struct intern_table {
+    uint32_t             mask;
+    intern_entry_t **    slots;
+    struct intern_table *retired;
+} intern_table_t;
+
+static pthread_mutex_t  intern_mtx   = PTHREAD_MUTEX_INITIALIZER;
+static intern_table_t * intern_table = NULL;
+static uint32_t         n_entry      = 0;
+static intern_entry_t **chunks[INTERN_CHUNKS];
+
+static inline uint32_t intern_hash(const char *str)
+{
+    return neu_hash(str, strlen(str));
+}
+
+static intern_entry_t *table_find(intern_table_t *table, const char *str,
+                                  uint32_t hash)
+{
+    if (table == NULL) {
+        return NULL;
+    }
+
+    for (uint32_t i = hash & table->mask;; i = (i + 1) & table->mask) {
+        intern_entry_t *entry =
+            __atomic_load_n(&table->slots[i], __ATOMIC_ACQUIRE);
+        if (entry == NULL) {
+            return NULL;
+        }
+        if (entry->hash == hash && strcmp(entry->str, str) == 0) {
+            return entry;
+        }
+    }
+}
+
+static void table_put(intern_table_t *table, intern_entry_t *entry)
+{
+    uint32_t i = entry->hash & table->mask;
+
+    while (table->slots[i] != NULL) {
+        i = (i + 1) & table->mask;
+    }
+    __atomic_store_n(&table->slots[i], entry, __ATOMIC_RELEASE);
+}
+
+// with the mutex held, keeps the load under a half
+static bool table_reserve(void)
+{
+    intern_table_t *old      = intern_table;
+    uint32_t        n_slot   = old != NULL ? (old->mask + 1) * 2 : 0;
+    intern_table_t *table    = NULL;
+    uint32_t        required = (n_entry + 1) * 2;
+
+    if (old != NULL && old->mask + 1 >= required) {
+        return true;
+    }
+
+    if (n_slot < INTERN_INIT_SLOTS) {
+        n_slot = INTERN_INIT_SLOTS;
+    }
+
+    table = calloc(1, sizeof(intern_table_t));
+    if (table == NULL) {
+        return false;
+    }
+    table->slots = calloc(n_slot, sizeof(intern_entry_t *));
+    if (table->slots == NULL) {
+        free(table);
+        return false;
+    }
+    table->mask = n_slot - 1;
+
+    if (old != NULL) {
+        for (uint32_t i = 0; i <= old->mask; ++i) {
+            if (old->slots[i] != NULL) {
+                table_put(table, old->slots[i]);
+            }
+        }
+    }
+
+    // readers may still probe the old table
+    table->retired = old;
+    __atomic_store_n(&intern_table, table, __ATOMIC_RELEASE);
+    return true;
+}
+
+static intern_entry_t *intern_entry(const char *str)
+{
+    uint32_t        hash  = intern_hash(str);
+    intern_entry_t *entry = NULL;
+    size_t          len   = 0;
+    uint32_t        id    = 0;
+
+    entry = table_find(__atomic_load_n(&intern_table, __ATOMIC_ACQUIRE), str,
+                       hash);
+    if (entry != NULL) {
+        return entry;
+    }
+
+    pthread_mutex_lock(&intern_mtx);
+    entry = table_find(intern_table, str, hash);
+    if (entry != NULL) {
+        goto end;
+    }
+
+    id = n_entry + 1;
+    if (id >= INTERN_CHUNKS * INTERN_CHUNK_SIZE || !table_reserve()) {
+        goto end;
+    }
+
+    if (chunks[id >> INTERN_CHUNK_BITS] == NULL) {
+        intern_entry_t **chunk =
+            calloc(INTERN_CHUNK_SIZE, sizeof(intern_entry_t *));
+        if (chunk == NULL) {
+            goto end;
+        }
+        __atomic_store_n(&chunks[id >> INTERN_CHUNK_BITS], chunk,
+                         __ATOMIC_RELEASE);
+    }
+
+    len   = strlen(str);
+    entry = malloc(sizeof(intern_entry_t) + len + 1);
+    if (entry == NULL) {
+        goto end;
+    }
+    entry->id   = id;
+    entry->hash = hash;
+    memcpy(entry->str, str, len + 1);
+
+    __atomic_store_n(
+        &chunks[id >> INTERN_CHUNK_BITS][id & (INTERN_CHUNK_SIZE - 1)], entry,
+        __ATOMIC_RELEASE);
+    table_put(intern_table, entry);
+    n_entry = id;
+
+end:
+    pthread_mutex_unlock(&intern_mtx);
+    return entry;
+}
+
+uint32_t neu_intern(const char *str)
+{
+    intern_entry_t *entry = NULL;
+
+    if (str == NULL) {
+        return 0;
+    }
+
+    entry = intern_entry(str);
+    return entry != NULL ? entry->id : 0;
+}
+
+const char *neu_intern_str(uint32_t id)
+{
+    intern_entry_t **chunk   = NULL;
+    intern_entry_t * entry   = NULL;
+    uint32_t         n_chunk = id >> INTERN_CHUNK_BITS;
+
+    if (id == 0 || n_chunk >= INTERN_CHUNKS) {
+        return NULL;
+    }
+
+    chunk = __atomic_load_n(&chunks[n_chunk], __ATOMIC_ACQUIRE);
+    if (chunk == NULL) {
+        return NULL;
+    }
+
+    entry = __atomic_load_n(&chunk[id & (INTERN_CHUNK_SIZE - 1)],
+                            __ATOMIC_ACQUIRE);
+    return entry != NULL ? entry->str : NULL;
+}
+
+const char *neu_intern_name(const char *str)
+{
+    intern_entry_t *entry = NULL;
+
+    if (str == NULL) {
+        return NULL;
+    }
+
+    entry = intern_entry(str);
+    return entry != NULL ? entry->str : NULL;
+}
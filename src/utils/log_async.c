@@ -0,0 +1,414 @@
+/**
+ * NEURON IIoT System for Industry 4.0
+ * Copyright (C) 2020-2023 EMQ Technologies Co., Ltd All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ **/
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "utils/log.h"
+#include "utils/log_async.h"
+#include "utils/uthash.h"
+
+// a power of two, the path and line of a record longer than LOG_SLOT_SIZE
+// are truncated
+#define LOG_RING_SIZE 2048
+#define LOG_SLOT_SIZE 1024
+#define LOG_BATCH 64
+#define LOG_IDLE_MS 5
+// checks of the files against being removed or left idle
+#define LOG_CHECK_MS 1000
+#define LOG_IDLE_CLOSE_MS 60000
+
+#define LOG_FILE_SIZE (25 * 1024 * 1024)
+#define LOG_FILE_KEEP 1
+
+typedef struct {
+    uint32_t seq;
+    uint16_t path_len;
+    uint16_t len; // of the path and the line
+    char     buf[LOG_SLOT_SIZE];
+} slot_t;
+
+typedef struct {
+    char *         path;
+    int            fd;
+    size_t         size;
+    dev_t          dev;
+    ino_t          ino;
+    int64_t        used; // ms
+    UT_hash_handle hh;
+} log_file_t;
+
+static slot_t ring[LOG_RING_SIZE];
+
+static struct {
+    neu_log_overflow_e overflow;
+    bool               inited;
+
+    uint32_t head; // next slot to fill, shared by the logging threads
+    uint32_t tail; // next slot to write, advanced by the writer
+
+    pthread_t tid;
+    pid_t     owner;
+    bool      running;
+
+    log_file_t *files;
+
+    uint64_t dropped;
+    uint64_t failed;
+} ctx;
+
+static inline int64_t now_ms()
+{
+    struct timespec ts = { 0 };
+
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+    return (int64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+int neu_log_overflow_parse(const char *s, neu_log_overflow_e *overflow)
+{
+    if (strcmp(s, "drop_debug") == 0) {
+        *overflow = NEU_LOG_OVERFLOW_DROP_DEBUG;
+    } else if (strcmp(s, "drop_new") == 0) {
+        *overflow = NEU_LOG_OVERFLOW_DROP_NEW;
+    } else {
+        return -1;
+    }
+
+    return 0;
+}
+
+// bounded multi producer queue as the one of remote syslog, a slot is free to
+// fill at position pos when its seq is pos, and ready to write when its seq
+// is pos + 1
+int neu_log_async_record(zlog_msg_t *msg)
+{
+    const char *path     = strchr(msg->path, ' ');
+    size_t      path_len = 0;
+    uint32_t    pos      = __atomic_load_n(&ctx.head, __ATOMIC_RELAXED);
+    slot_t *    slot     = NULL;
+
+    if (path == NULL) {
+        return -1;
+    }
+    path += 1;
+    path_len = strlen(path);
+    if (path_len == 0 || path_len >= LOG_SLOT_SIZE / 2) {
+        return -1;
+    }
+
+    // DEBUG and INFO
+    if (ctx.overflow == NEU_LOG_OVERFLOW_DROP_DEBUG &&
+        (msg->path[0] == 'D' || msg->path[0] == 'I') &&
+        pos - __atomic_load_n(&ctx.tail, __ATOMIC_RELAXED) >=
+            LOG_RING_SIZE / 4 * 3) {
+        __atomic_add_fetch(&ctx.dropped, 1, __ATOMIC_RELAXED);
+        return 0;
+    }
+
+    while (true) {
+        slot         = &ring[pos & (LOG_RING_SIZE - 1)];
+        uint32_t seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+        int32_t  dif = (int32_t)(seq - pos);
+
+        if (dif == 0) {
+            if (__atomic_compare_exchange_n(&ctx.head, &pos, pos + 1, true,
+                                            __ATOMIC_RELAXED,
+                                            __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (dif < 0) {
+            __atomic_add_fetch(&ctx.dropped, 1, __ATOMIC_RELAXED);
+            return 0;
+        } else {
+            pos = __atomic_load_n(&ctx.head, __ATOMIC_RELAXED);
+        }
+    }
+
+    size_t len = msg->len < LOG_SLOT_SIZE - path_len ? msg->len
+                                                     : LOG_SLOT_SIZE - path_len;
+    memcpy(slot->buf, path, path_len);
+    memcpy(slot->buf + path_len, msg->buf, len);
+    // a truncated line still ends its line
+    if (len > 0 && len < msg->len) {
+        slot->buf[path_len + len - 1] = '\n';
+    }
+    slot->path_len = path_len;
+    slot->len      = path_len + len;
+    __atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE);
+
+    return 0;
+}
+
+static int file_open(log_file_t *file)
+{
+    struct stat st = { 0 };
+
+    file->fd = open(file->path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC,
+                    0666);
+    if (file->fd < 0) {
+        return -1;
+    }
+
+    fstat(file->fd, &st);
+    file->size = st.st_size;
+    file->dev  = st.st_dev;
+    file->ino  = st.st_ino;
+    return 0;
+}
+
+static void file_close(log_file_t *file)
+{
+    if (file->fd >= 0) {
+        close(file->fd);
+        file->fd = -1;
+    }
+}
+
+// "<name>.log" to "<name>.00.log", the older ones shift up to LOG_FILE_KEEP
+static void file_rotate(log_file_t *file)
+{
+    char   from[LOG_SLOT_SIZE + 8] = { 0 };
+    char   to[LOG_SLOT_SIZE + 8]   = { 0 };
+    size_t len                     = strlen(file->path);
+
+    file_close(file);
+    if (len > 4 && strcmp(file->path + len - 4, ".log") == 0) {
+        len -= 4;
+    }
+
+    for (int i = LOG_FILE_KEEP - 1; i > 0; --i) {
+        snprintf(from, sizeof(from), "%.*s.%02d.log", (int) len, file->path,
+                 i - 1);
+        snprintf(to, sizeof(to), "%.*s.%02d.log", (int) len, file->path, i);
+        rename(from, to);
+    }
+    snprintf(to, sizeof(to), "%.*s.00.log", (int) len, file->path);
+    rename(file->path, to);
+
+    file_open(file);
+}
+
+static log_file_t *file_get(const char *path, size_t len)
+{
+    log_file_t *file = NULL;
+
+    HASH_FIND(hh, ctx.files, path, len, file);
+    if (file == NULL) {
+        file = calloc(1, sizeof(*file));
+        if (file == NULL || (file->path = strndup(path, len)) == NULL) {
+            free(file);
+            return NULL;
+        }
+        file->fd = -1;
+        HASH_ADD_KEYPTR(hh, ctx.files, file->path, len, file);
+    }
+
+    if (file->fd < 0 && file_open(file) != 0) {
+        return NULL;
+    }
+
+    return file;
+}
+
+// reopen the files removed or rotated by others, and close the idle ones,
+// such as those of deleted nodes
+static void files_check(int64_t now)
+{
+    log_file_t *file = NULL, *tmp = NULL;
+
+    HASH_ITER(hh, ctx.files, file, tmp)
+    {
+        struct stat st = { 0 };
+
+        if (now - file->used >= LOG_IDLE_CLOSE_MS) {
+            file_close(file);
+            HASH_DEL(ctx.files, file);
+            free(file->path);
+            free(file);
+        } else if (file->fd >= 0 &&
+                   (stat(file->path, &st) != 0 || st.st_dev != file->dev ||
+                    st.st_ino != file->ino)) {
+            file_close(file);
+        }
+    }
+}
+
+static void files_free()
+{
+    log_file_t *file = NULL, *tmp = NULL;
+
+    HASH_ITER(hh, ctx.files, file, tmp)
+    {
+        file_close(file);
+        HASH_DEL(ctx.files, file);
+        free(file->path);
+        free(file);
+    }
+}
+
+// write the records of the slots from tail on, consecutive ones of a file at
+// once, return how many
+static int drain(int64_t now)
+{
+    struct iovec iovs[LOG_BATCH] = { 0 };
+    int          n               = 0;
+
+    while (n < LOG_BATCH) {
+        uint32_t pos  = ctx.tail + n;
+        slot_t * slot = &ring[pos & (LOG_RING_SIZE - 1)];
+
+        if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != pos + 1) {
+            break;
+        }
+        n += 1;
+    }
+
+    for (int i = 0; i < n;) {
+        slot_t *    first = &ring[(ctx.tail + i) & (LOG_RING_SIZE - 1)];
+        log_file_t *file  = file_get(first->buf, first->path_len);
+        int         k     = 0;
+        ssize_t     want  = 0;
+
+        for (; i + k < n; ++k) {
+            slot_t *slot = &ring[(ctx.tail + i + k) & (LOG_RING_SIZE - 1)];
+            if (slot->path_len != first->path_len ||
+                memcmp(slot->buf, first->buf, first->path_len) != 0) {
+                break;
+            }
+            iovs[k].iov_base = slot->buf + slot->path_len;
+            iovs[k].iov_len  = slot->len - slot->path_len;
+            want += iovs[k].iov_len;
+        }
+
+        ssize_t rv = file != NULL ? writev(file->fd, iovs, k) : -1;
+        if (rv < want) {
+            __atomic_add_fetch(&ctx.failed, k, __ATOMIC_RELAXED);
+        }
+        if (file != NULL) {
+            file->used = now;
+            file->size += rv > 0 ? rv : 0;
+            if (file->size >= LOG_FILE_SIZE) {
+                file_rotate(file);
+            }
+        }
+        i += k;
+    }
+
+    for (int i = 0; i < n; i++) {
+        slot_t *slot = &ring[ctx.tail & (LOG_RING_SIZE - 1)];
+        __atomic_store_n(&slot->seq, ctx.tail + LOG_RING_SIZE,
+                         __ATOMIC_RELEASE);
+        __atomic_store_n(&ctx.tail, ctx.tail + 1, __ATOMIC_RELAXED);
+    }
+
+    return n;
+}
+
+static void *writer(void *arg)
+{
+    uint64_t reported = 0;
+    int64_t  checked  = now_ms();
+    (void) arg;
+
+    while (true) {
+        int64_t now = now_ms();
+        bool    run = __atomic_load_n(&ctx.running, __ATOMIC_RELAXED);
+
+        if (now - checked >= LOG_CHECK_MS) {
+            files_check(now);
+            checked = now;
+        }
+
+        if (drain(now) == 0) {
+            // what was queued before the stop is written
+            if (!run) {
+                break;
+            }
+            struct timespec ts = { .tv_nsec = LOG_IDLE_MS * 1000000 };
+            nanosleep(&ts, NULL);
+            continue;
+        }
+
+        uint64_t dropped = __atomic_load_n(&ctx.dropped, __ATOMIC_RELAXED);
+        uint64_t failed  = __atomic_load_n(&ctx.failed, __ATOMIC_RELAXED);
+        if (dropped + failed != reported) {
+            nlog_ratelimit(ZLOG_LEVEL_WARN, NEU_LOG_RATELIMIT_INTERVAL,
+                           "log dropped %" PRIu64
+                           " lines, failed to write %" PRIu64,
+                           dropped, failed);
+            reported = dropped + failed;
+        }
+    }
+
+    files_free();
+    return NULL;
+}
+
+void neu_log_async_start()
+{
+    if (!ctx.inited || ctx.owner == getpid()) {
+        return;
+    }
+
+    // the files of the parent are not shared with its writer
+    ctx.files   = NULL;
+    ctx.running = true;
+    if (0 != pthread_create(&ctx.tid, NULL, writer, NULL)) {
+        ctx.running = false;
+        return;
+    }
+    ctx.owner = getpid();
+}
+
+int neu_log_async_init(neu_log_overflow_e overflow)
+{
+    for (uint32_t i = 0; !ctx.inited && i < LOG_RING_SIZE; i++) {
+        ring[i].seq = i;
+    }
+    ctx.overflow = overflow;
+    ctx.inited   = true;
+
+    neu_log_async_start();
+    if (ctx.owner != getpid()) {
+        return -1;
+    }
+    return zlog_set_record("async_file", neu_log_async_record);
+}
+
+void neu_log_async_fini()
+{
+    if (ctx.owner == getpid()) {
+        __atomic_store_n(&ctx.running, false, __ATOMIC_RELAXED);
+        pthread_join(ctx.tid, NULL);
+        ctx.owner = 0;
+    }
+}
+
+uint64_t neu_log_async_dropped()
+{
+    return __atomic_load_n(&ctx.dropped, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,280 @@
+/**
+ * NEURON IIoT System for Industry 4.0
+ * Copyright (C) 2020-2023 EMQ Technologies Co., Ltd All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ **/
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "define.h"
+#include "utils/zlog.h"
+
+#include "utils/log_filter.h"
+
+static void format_stamp(char *buf, int64_t ms)
+{
+    time_t    sec = ms / 1000;
+    struct tm tm  = { 0 };
+    char      day[NEU_LOG_STAMP_LEN + 1] = { 0 };
+
+    localtime_r(&sec, &tm);
+    strftime(day, sizeof(day), "%Y-%m-%d %H:%M:%S", &tm);
+    snprintf(buf, NEU_LOG_STAMP_LEN + 1, "%s:%03d", day, (int) (ms % 1000));
+}
+
+void neu_log_filter_init(neu_log_filter_t *filter, int level, int64_t since,
+                         int64_t until, const char *match)
+{
+    memset(filter, 0, sizeof(*filter));
+    filter->level   = level;
+    filter->match   = match != NULL && match[0] != '\0' ? match : NULL;
+    filter->matched = true;
+    if (since > 0) {
+        format_stamp(filter->since, since);
+    }
+    if (until > 0) {
+        format_stamp(filter->until, until);
+    }
+}
+
+static inline bool is_stamped(const char *line, size_t len)
+{
+    return len >= NEU_LOG_STAMP_LEN && line[4] == '-' && line[7] == '-' &&
+        line[10] == ' ' && line[13] == ':' && line[16] == ':' &&
+        line[19] == ':' && line[0] >= '0' && line[0] <= '9';
+}
+
+// "%V" follows the stamp, a line of an unknown level is always kept
+static int line_level(const char *line, size_t len)
+{
+    static const struct {
+        const char *name;
+        size_t      len;
+        int         level;
+    } levels[] = {
+        { "DEBUG]", 6, ZLOG_LEVEL_DEBUG }, { "INFO]", 5, ZLOG_LEVEL_INFO },
+        { "NOTICE]", 7, ZLOG_LEVEL_NOTICE }, { "WARN]", 5, ZLOG_LEVEL_WARN },
+        { "ERROR]", 6, ZLOG_LEVEL_ERROR }, { "FATAL]", 6, ZLOG_LEVEL_FATAL },
+    };
+    const char *p = line + NEU_LOG_STAMP_LEN + 2;
+
+    if (len < NEU_LOG_STAMP_LEN + 2 || line[NEU_LOG_STAMP_LEN + 1] != '[') {
+        return ZLOG_LEVEL_FATAL;
+    }
+
+    len -= NEU_LOG_STAMP_LEN + 2;
+    for (size_t i = 0; i < sizeof(levels) / sizeof(levels[0]); ++i) {
+        if (len >= levels[i].len &&
+            memcmp(p, levels[i].name, levels[i].len) == 0) {
+            return levels[i].level;
+        }
+    }
+
+    return ZLOG_LEVEL_FATAL;
+}
+
+static inline size_t line_end(const char *data, size_t len, size_t pos)
+{
+    const char *nl = memchr(data + pos, '\n', len - pos);
+    return nl != NULL ? (size_t)(nl - data) + 1 : len;
+}
+
+// the first stamped line starting at or after pos
+static size_t stamped_from(const char *data, size_t len, size_t pos)
+{
+    if (pos > 0 && data[pos - 1] != '\n') {
+        pos = line_end(data, len, pos);
+    }
+    while (pos < len && !is_stamped(data + pos, len - pos)) {
+        pos = line_end(data, len, pos);
+    }
+    return pos;
+}
+
+// lines are written in time order, the ones before since are skipped by a
+// binary search instead of being scanned
+static size_t seek_since(const char *data, size_t len, const char *since)
+{
+    size_t lo = 0, hi = len;
+
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        size_t pos = stamped_from(data, len, mid);
+
+        if (pos == len || memcmp(data + pos, since, NEU_LOG_STAMP_LEN) >= 0) {
+            hi = mid;
+        } else {
+            lo = pos + 1;
+        }
+    }
+
+    return stamped_from(data, len, lo);
+}
+
+ssize_t neu_log_filter(neu_log_filter_t *filter, const char *data, size_t len,
+                       neu_log_filter_cb_t cb, void *arg)
+{
+    size_t complete = len;
+    size_t pos      = 0;
+    size_t run      = 0;
+
+    while (complete > 0 && data[complete - 1] != '\n') {
+        --complete;
+    }
+
+    if (filter->since[0] != '\0') {
+        pos = seek_since(data, complete, filter->since);
+        if (pos == complete) {
+            return (ssize_t) complete;
+        }
+        // every later line is past since as well
+        filter->since[0] = '\0';
+    }
+    run = pos;
+
+    while (pos < complete && !filter->done) {
+        const char *line = data + pos;
+        size_t      end  = line_end(data, complete, pos);
+        size_t      n    = end - pos;
+        bool        keep = false;
+
+        if (is_stamped(line, n)) {
+            if (filter->until[0] != '\0' &&
+                memcmp(line, filter->until, NEU_LOG_STAMP_LEN) >= 0) {
+                filter->done = true;
+                break;
+            }
+            filter->matched = line_level(line, n) >= filter->level;
+        }
+
+        keep = filter->matched &&
+            (filter->match == NULL ||
+             memmem(line, n, filter->match, strlen(filter->match)) != NULL);
+        if (!keep) {
+            if (pos > run && cb(arg, data + run, pos - run) != 0) {
+                return -1;
+            }
+            run = end;
+        }
+        pos = end;
+    }
+
+    if (pos > run && cb(arg, data + run, pos - run) != 0) {
+        return -1;
+    }
+
+    return filter->done ? (ssize_t) len : (ssize_t) complete;
+}
+
+// "<node>.log" or a rotated "<node>.<index>.log", the index is returned
+static bool log_file_index(const char *file, const char *node, long *index)
+{
+    size_t      len = strlen(node);
+    const char *p   = file + len;
+    char *      end = NULL;
+
+    if (strncmp(file, node, len) != 0 || *p != '.') {
+        return false;
+    }
+
+    if (strcmp(p, ".log") == 0) {
+        *index = -1;
+        return true;
+    }
+
+    if (p[1] < '0' || p[1] > '9') {
+        return false;
+    }
+    *index = strtol(p + 1, &end, 10);
+    return strcmp(end, ".log") == 0;
+}
+
+typedef struct {
+    long index;
+    char path[NEU_NODE_NAME_LEN + 64];
+} log_file_t;
+
+// zlog rotates "#r" files by shifting, the highest index is the oldest, the
+// live file has index -1 and comes last
+static int log_file_cmp(const void *a, const void *b)
+{
+    long ia = ((const log_file_t *) a)->index;
+    long ib = ((const log_file_t *) b)->index;
+
+    return ia < ib ? 1 : ia > ib ? -1 : 0;
+}
+
+UT_array *neu_log_files(const char *dir, const char *node)
+{
+    char           name[NEU_NODE_NAME_LEN] = { 0 };
+    DIR *          dirp                    = NULL;
+    struct dirent *dent                    = NULL;
+    log_file_t *   files                   = NULL;
+    size_t         n_file = 0, cap = 0;
+    UT_array *     paths  = NULL;
+
+    // as the category of the node is named, see get_log_category
+    for (int i = 0; node[i] && i < NEU_NODE_NAME_LEN - 1; ++i) {
+        name[i] = ('/' == node[i] || '\\' == node[i]) ? '_' : node[i];
+    }
+
+    utarray_new(paths, &ut_str_icd);
+    if ((dirp = opendir(dir)) == NULL) {
+        return paths;
+    }
+
+    while (NULL != (dent = readdir(dirp))) {
+        long index = 0;
+
+        if (!log_file_index(dent->d_name, name, &index)) {
+            continue;
+        }
+        if (n_file == cap) {
+            cap             = cap > 0 ? cap * 2 : 4;
+            log_file_t *tmp = realloc(files, cap * sizeof(log_file_t));
+            if (tmp == NULL) {
+                break;
+            }
+            files = tmp;
+        }
+        // skip a path that does not fit rather than hand out a cut one
+        int n = snprintf(files[n_file].path, sizeof(files[n_file].path),
+                         "%s/%s", dir, dent->d_name);
+        if (n < 0 || (size_t) n >= sizeof(files[n_file].path)) {
+            continue;
+        }
+        files[n_file].index = index;
+        ++n_file;
+    }
+    closedir(dirp);
+
+    qsort(files, n_file, sizeof(log_file_t), log_file_cmp);
+    for (size_t i = 0; i < n_file; ++i) {
+        char *path = files[i].path;
+        utarray_push_back(paths, &path);
+    }
+
+    free(files);
+    return paths;
+}
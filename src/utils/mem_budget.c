@@ -0,0 +1,119 @@
+/**
+ * NEURON IIoT System for Industry 4.0
+ * Copyright (C) 2020-2023 EMQ Technologies Co., Ltd All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ **/
+#include <string.h>
+
+#include "utils/mem_budget.h"
+
+static size_t   budget_limit    = 0;
+static uint32_t budget_policies = NEU_MEM_POLICY_ALL;
+static size_t   budget_used     = 0;
+
+static const struct {
+    const char *name;
+    uint32_t    policy;
+} policy_names[] = {
+    { "drop_oldest", NEU_MEM_DROP_OLDEST },
+    { "reject_subscribe", NEU_MEM_REJECT_SUBSCRIBE },
+    { "shrink_history", NEU_MEM_SHRINK_HISTORY },
+};
+
+static int policy_parse(const char *s, size_t len, uint32_t *policy)
+{
+    for (size_t i = 0; i < sizeof(policy_names) / sizeof(policy_names[0]);
+         ++i) {
+        if (strlen(policy_names[i].name) == len &&
+            strncmp(s, policy_names[i].name, len) == 0) {
+            *policy = policy_names[i].policy;
+            return 0;
+        }
+    }
+
+    return -1;
+}
+
+int neu_mem_policy_parse(const char *s, uint32_t *policies)
+{
+    uint32_t all = 0;
+
+    if (strcmp(s, "none") == 0) {
+        *policies = 0;
+        return 0;
+    }
+
+    while (true) {
+        const char *end    = strchr(s, ',');
+        size_t      len    = end != NULL ? (size_t)(end - s) : strlen(s);
+        uint32_t    policy = 0;
+
+        if (policy_parse(s, len, &policy) != 0) {
+            return -1;
+        }
+        all |= policy;
+
+        if (end == NULL) {
+            break;
+        }
+        s = end + 1;
+    }
+
+    *policies = all;
+    return 0;
+}
+
+void neu_mem_budget_set(size_t limit, uint32_t policies)
+{
+    __atomic_store_n(&budget_policies, policies, __ATOMIC_RELAXED);
+    __atomic_store_n(&budget_limit, limit, __ATOMIC_RELAXED);
+}
+
+size_t neu_mem_budget_limit()
+{
+    return __atomic_load_n(&budget_limit, __ATOMIC_RELAXED);
+}
+
+uint32_t neu_mem_budget_policies()
+{
+    return __atomic_load_n(&budget_policies, __ATOMIC_RELAXED);
+}
+
+size_t neu_mem_budget_used()
+{
+    return __atomic_load_n(&budget_used, __ATOMIC_RELAXED);
+}
+
+// a node accounts on its own thread only, so accounted has one writer, it is
+// stored atomically for those reading it elsewhere
+void neu_mem_budget_account(size_t *accounted, size_t bytes)
+{
+    size_t prev = __atomic_load_n(accounted, __ATOMIC_RELAXED);
+
+    if (bytes >= prev) {
+        __atomic_add_fetch(&budget_used, bytes - prev, __ATOMIC_RELAXED);
+    } else {
+        __atomic_sub_fetch(&budget_used, prev - bytes, __ATOMIC_RELAXED);
+    }
+    __atomic_store_n(accounted, bytes, __ATOMIC_RELAXED);
+}
+
+bool neu_mem_budget_over()
+{
+    size_t limit = neu_mem_budget_limit();
+
+    return limit > 0 && neu_mem_budget_used() > limit;
+}
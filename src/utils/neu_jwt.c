@@ -20,12 +20,15 @@
 #include <assert.h>
 #include <dirent.h>
 #include <errno.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
 #include <sys/time.h>
 
 #include <jwt.h>
+#include <openssl/evp.h>
 
 #include "errcodes.h"
 #include "utils/log.h"
@@ -43,6 +46,27 @@ static struct public_key_store key_store;
 static char                    neuron_private_key[2048] = { 0 };
 static char                    neuron_public_key[2048]  = { 0 };
 
+// the certs directory is checked for changed keys at most once a second,
+// key_store is only rewritten under the write lock
+#define KEYS_CHECK_INTERVAL 1
+
+static pthread_rwlock_t keys_lock  = PTHREAD_RWLOCK_INITIALIZER;
+static time_t           keys_check = 0;
+static uint64_t         keys_stamp = 0;
+static uint64_t         keys_gen   = 0; // bumped whenever keys are reloaded
+
+// tokens that passed the RS256 verification, direct mapped by their digest,
+// an entry is used until the token expires, it is evicted or keys change
+#define TOKEN_CACHE_SIZE 64
+
+typedef struct {
+    unsigned char digest[32];
+    time_t        exp; // 0 for an empty entry
+} token_cache_entry_t;
+
+static pthread_mutex_t     token_cache_mtx = PTHREAD_MUTEX_INITIALIZER;
+static token_cache_entry_t token_cache[TOKEN_CACHE_SIZE];
+
 static int find_key(const char *name)
 {
     for (int i = 0; i < key_store.size; i++) {
@@ -138,10 +162,142 @@ static void scanf_key(const char *dir_path)
     closedir(dir);
 }
 
+// changes with the names, sizes and modification times of the key files
+static uint64_t stamp_keys(const char *dir_path)
+{
+    DIR *          dir   = NULL;
+    struct dirent *ptr   = NULL;
+    struct stat    st    = { 0 };
+    uint64_t       stamp = 0;
+    char           path[512];
+
+    dir = opendir(dir_path);
+    if (dir == NULL) {
+        return 0;
+    }
+
+    while (NULL != (ptr = readdir(dir))) {
+        if (strstr(ptr->d_name, ".pem") == NULL &&
+            strstr(ptr->d_name, ".pub") == NULL) {
+            continue;
+        }
+
+        snprintf(path, sizeof(path), "%s/%s", dir_path, ptr->d_name);
+        if (0 != stat(path, &st)) {
+            continue;
+        }
+        // order independent, readdir does not sort
+        uint64_t h = 1469598103934665603ULL;
+        for (const char *c = ptr->d_name; *c; ++c) {
+            h = (h ^ (unsigned char) *c) * 1099511628211ULL;
+        }
+        h = (h ^ (uint64_t) st.st_mtime) * 1099511628211ULL;
+        h = (h ^ (uint64_t) st.st_size) * 1099511628211ULL;
+        stamp += h;
+    }
+
+    closedir(dir);
+    return stamp;
+}
+
+static void token_cache_clear()
+{
+    pthread_mutex_lock(&token_cache_mtx);
+    memset(token_cache, 0, sizeof(token_cache));
+    pthread_mutex_unlock(&token_cache_mtx);
+}
+
+// reload the certs whenever a key file is added, removed or replaced
+static inline bool keys_checked(time_t now)
+{
+    time_t check = __atomic_load_n(&keys_check, __ATOMIC_RELAXED);
+    return now >= check && now - check < KEYS_CHECK_INTERVAL;
+}
+
+static void refresh_keys(time_t now)
+{
+    uint64_t stamp = 0;
+
+    if (keys_checked(now)) {
+        return;
+    }
+
+    pthread_rwlock_wrlock(&keys_lock);
+    if (keys_checked(now)) {
+        pthread_rwlock_unlock(&keys_lock);
+        return;
+    }
+    __atomic_store_n(&keys_check, now, __ATOMIC_RELAXED);
+
+    stamp = stamp_keys("certs");
+    if (stamp != keys_stamp) {
+        zlog_notice(neuron, "certs changed, reload public keys");
+        scanf_key("certs");
+        keys_stamp = stamp;
+        // tokens of removed keys must not pass anymore
+        __atomic_add_fetch(&keys_gen, 1, __ATOMIC_RELAXED);
+        token_cache_clear();
+    }
+    pthread_rwlock_unlock(&keys_lock);
+}
+
+static int token_digest(const char *token, unsigned char *digest)
+{
+    unsigned int len = 0;
+
+    int rv = EVP_Digest(token, strlen(token), digest, &len, EVP_sha256(), NULL);
+    return 1 == rv && 32 == len ? 0 : -1;
+}
+
+static bool token_cache_find(const unsigned char *digest, time_t now)
+{
+    bool                 found = false;
+    token_cache_entry_t *e     = NULL;
+    uint32_t             index = 0;
+
+    memcpy(&index, digest, sizeof(index));
+    e = &token_cache[index % TOKEN_CACHE_SIZE];
+
+    pthread_mutex_lock(&token_cache_mtx);
+    if (e->exp > now && 0 == memcmp(e->digest, digest, sizeof(e->digest))) {
+        found = true;
+    }
+    pthread_mutex_unlock(&token_cache_mtx);
+
+    return found;
+}
+
+// `gen` is keys_gen when the token was verified, the token is not added if
+// keys were reloaded since
+static void token_cache_add(const unsigned char *digest, time_t exp,
+                            uint64_t gen)
+{
+    token_cache_entry_t *e     = NULL;
+    uint32_t             index = 0;
+
+    memcpy(&index, digest, sizeof(index));
+    e = &token_cache[index % TOKEN_CACHE_SIZE];
+
+    pthread_mutex_lock(&token_cache_mtx);
+    if (gen == __atomic_load_n(&keys_gen, __ATOMIC_RELAXED)) {
+        memcpy(e->digest, digest, sizeof(e->digest));
+        e->exp = exp;
+    }
+    pthread_mutex_unlock(&token_cache_mtx);
+}
+
 int neu_jwt_init(const char *dir_path)
 {
     load_neuron_key(dir_path);
+
+    pthread_rwlock_wrlock(&keys_lock);
     scanf_key("certs");
+    keys_stamp = stamp_keys("certs");
+    keys_check = time(NULL);
+    __atomic_add_fetch(&keys_gen, 1, __ATOMIC_RELAXED);
+    pthread_rwlock_unlock(&keys_lock);
+
+    token_cache_clear();
     return 0;
 }
 
@@ -255,10 +411,10 @@ static void *neu_jwt_decode(char *token)
             return NULL;
         }
     } else {
+        // new key files are picked up by refresh_keys
         zlog_error(neuron, "Don't find public key file: %s", name);
         jwt_free(jwt_test);
         jwt_free(jwt);
-        scanf_key("certs");
         return NULL;
     }
 
@@ -275,9 +431,13 @@ static void *neu_jwt_decode(char *token)
 
 int neu_jwt_validate(char *b_token)
 {
-    jwt_valid_t *jwt_valid = NULL;
-    jwt_alg_t    opt_alg   = JWT_ALG_RS256;
-    char *       token     = NULL;
+    jwt_valid_t * jwt_valid  = NULL;
+    jwt_alg_t     opt_alg    = JWT_ALG_RS256;
+    char *        token      = NULL;
+    time_t        now        = time(NULL);
+    unsigned char digest[32] = { 0 };
+    bool          cacheable  = false;
+    uint64_t      gen        = 0;
 
     if (b_token == NULL || strlen(b_token) <= strlen("Bearar ")) {
         return NEU_ERR_NEED_TOKEN;
@@ -285,7 +445,16 @@ int neu_jwt_validate(char *b_token)
 
     token = &b_token[strlen("Bearar ")];
 
+    refresh_keys(now);
+    cacheable = 0 == token_digest(token, digest);
+    if (cacheable && token_cache_find(digest, now)) {
+        return NEU_ERR_SUCCESS;
+    }
+
+    pthread_rwlock_rdlock(&keys_lock);
+    gen        = __atomic_load_n(&keys_gen, __ATOMIC_RELAXED);
     jwt_t *jwt = (jwt_t *) neu_jwt_decode(token);
+    pthread_rwlock_unlock(&keys_lock);
 
     if (jwt == NULL) {
         return NEU_ERR_DECODE_TOKEN;
@@ -307,7 +476,7 @@ int neu_jwt_validate(char *b_token)
         return NEU_ERR_EINTERNAL;
     }
 
-    ret = jwt_valid_set_now(jwt_valid, time(NULL));
+    ret = jwt_valid_set_now(jwt_valid, now);
     if (ret != 0 || jwt_valid == NULL) {
         zlog_error(neuron, "Failed to set time: %d", ret);
         jwt_valid_free(jwt_valid);
@@ -327,6 +496,12 @@ int neu_jwt_validate(char *b_token)
         }
     }
 
+    // tokens without an expiry are verified every time
+    long exp = jwt_get_grant_int(jwt, "exp");
+    if (cacheable && exp > now) {
+        token_cache_add(digest, (time_t) exp, gen);
+    }
+
     jwt_valid_free(jwt_valid);
     jwt_free(jwt);
 
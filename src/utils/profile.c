@@ -0,0 +1,457 @@
+/**
+ * NEURON IIoT System for Industry 4.0
+ * Copyright (C) 2020-2023 EMQ Technologies Co., Ltd All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ **/
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+
+#if defined(NEU_PLATFORM_LINUX) && !defined(NEU_CLIB)
+#define PROFILE_SAMPLER 1
+#include <dlfcn.h>
+#include <execinfo.h>
+#endif
+
+#include "errcodes.h"
+#include "utils/log.h"
+#include "utils/profile.h"
+#include "utils/uthash.h"
+
+#define PROFILE_DEPTH 32
+#define PROFILE_SAMPLES_MAX 16384
+// the signal handler and the signal trampoline
+#define PROFILE_SKIP 2
+
+typedef struct {
+    pthread_t thread;
+    char      node[NEU_NODE_NAME_LEN];
+    char      role[32];
+} label_t;
+
+typedef struct {
+    int       done;
+    pthread_t thread;
+    pid_t     tid;
+    int       depth;
+    void *    pc[PROFILE_DEPTH];
+} sample_t;
+
+static struct {
+    pthread_mutex_t mtx;
+    label_t *       labels;
+    int             n_label;
+    int             cap;
+
+    int       running;
+    bool      installed;
+    int       active;
+    int       inflight;
+    sample_t *samples;
+    uint32_t  max;
+    uint32_t  n;
+} profile = {
+    .mtx = PTHREAD_MUTEX_INITIALIZER,
+};
+
+static void label_copy(label_t *label, const char *node, const char *role)
+{
+    snprintf(label->node, sizeof(label->node), "%s", node);
+    snprintf(label->role, sizeof(label->role), "%s", role);
+}
+
+void neu_profile_label_thread(pthread_t thread, const char *node,
+                              const char *role)
+{
+    pthread_mutex_lock(&profile.mtx);
+    for (int i = 0; i < profile.n_label; i++) {
+        if (pthread_equal(profile.labels[i].thread, thread)) {
+            label_copy(&profile.labels[i], node, role);
+            pthread_mutex_unlock(&profile.mtx);
+            return;
+        }
+    }
+
+    if (profile.n_label == profile.cap) {
+        int      cap    = profile.cap == 0 ? 16 : profile.cap * 2;
+        label_t *labels = realloc(profile.labels, cap * sizeof(label_t));
+        if (labels == NULL) {
+            pthread_mutex_unlock(&profile.mtx);
+            return;
+        }
+        profile.labels = labels;
+        profile.cap    = cap;
+    }
+
+    profile.labels[profile.n_label].thread = thread;
+    label_copy(&profile.labels[profile.n_label], node, role);
+    profile.n_label += 1;
+    pthread_mutex_unlock(&profile.mtx);
+}
+
+void neu_profile_unlabel_thread(pthread_t thread)
+{
+    pthread_mutex_lock(&profile.mtx);
+    for (int i = 0; i < profile.n_label; i++) {
+        if (pthread_equal(profile.labels[i].thread, thread)) {
+            profile.labels[i] = profile.labels[profile.n_label - 1];
+            profile.n_label -= 1;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&profile.mtx);
+}
+
+static uint64_t clock_ms(clockid_t clock)
+{
+    struct timespec ts = { 0 };
+
+    if (clock_gettime(clock, &ts) != 0) {
+        return 0;
+    }
+
+    return (uint64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+int neu_profile_threads(neu_profile_thread_t **threads, int *n_thread,
+                        uint64_t *cpu_ms)
+{
+    pthread_mutex_lock(&profile.mtx);
+    *n_thread = profile.n_label;
+    *threads  = calloc(profile.n_label > 0 ? profile.n_label : 1,
+                      sizeof(neu_profile_thread_t));
+    if (*threads == NULL) {
+        pthread_mutex_unlock(&profile.mtx);
+        return NEU_ERR_EINTERNAL;
+    }
+
+    for (int i = 0; i < profile.n_label; i++) {
+        neu_profile_thread_t *t = &(*threads)[i];
+
+        strcpy(t->node, profile.labels[i].node);
+        strcpy(t->role, profile.labels[i].role);
+#ifdef NEU_PLATFORM_LINUX
+        clockid_t clock = 0;
+        if (pthread_getcpuclockid(profile.labels[i].thread, &clock) == 0) {
+            t->cpu_ms = clock_ms(clock);
+        }
+#endif
+    }
+    pthread_mutex_unlock(&profile.mtx);
+
+    *cpu_ms = clock_ms(CLOCK_PROCESS_CPUTIME_ID);
+    return NEU_ERR_SUCCESS;
+}
+
+uint64_t neu_profile_node_cpu_ms(const char *node)
+{
+    uint64_t cpu_ms = 0;
+
+    pthread_mutex_lock(&profile.mtx);
+    for (int i = 0; i < profile.n_label; i++) {
+        if (strcmp(profile.labels[i].node, node) != 0) {
+            continue;
+        }
+#ifdef NEU_PLATFORM_LINUX
+        clockid_t clock = 0;
+        if (pthread_getcpuclockid(profile.labels[i].thread, &clock) == 0) {
+            cpu_ms += clock_ms(clock);
+        }
+#endif
+    }
+    pthread_mutex_unlock(&profile.mtx);
+
+    return cpu_ms;
+}
+
+#ifdef PROFILE_SAMPLER
+
+typedef struct {
+    void *         pc;
+    char *         name;
+    UT_hash_handle hh;
+} symbol_t;
+
+typedef struct {
+    char *         stack;
+    uint64_t       count;
+    UT_hash_handle hh;
+} folded_t;
+
+static void on_sigprof(int sig, siginfo_t *info, void *context)
+{
+    (void) sig;
+    (void) info;
+    (void) context;
+
+    // inflight goes up before active is looked at, so the sampler knows no
+    // handler touches the samples once active is cleared and inflight is 0
+    __atomic_add_fetch(&profile.inflight, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&profile.active, __ATOMIC_SEQ_CST)) {
+        int      saved = errno;
+        uint32_t i = __atomic_fetch_add(&profile.n, 1, __ATOMIC_RELAXED);
+
+        if (i < profile.max) {
+            sample_t *s = &profile.samples[i];
+
+            s->thread = pthread_self();
+            s->tid    = (pid_t) syscall(SYS_gettid);
+            s->depth  = backtrace(s->pc, PROFILE_DEPTH);
+            __atomic_store_n(&s->done, 1, __ATOMIC_RELEASE);
+        }
+        errno = saved;
+    }
+    __atomic_sub_fetch(&profile.inflight, 1, __ATOMIC_SEQ_CST);
+}
+
+static const char *symbolize(symbol_t **symbols, void *pc)
+{
+    symbol_t *sym  = NULL;
+    Dl_info   info = { 0 };
+    char      buf[256];
+
+    HASH_FIND_PTR(*symbols, &pc, sym);
+    if (sym != NULL) {
+        return sym->name;
+    }
+
+    // return addresses point after the call, look up the call itself
+    if (dladdr((char *) pc - 1, &info) != 0 && info.dli_sname != NULL) {
+        snprintf(buf, sizeof(buf), "%s", info.dli_sname);
+    } else if (info.dli_fname != NULL) {
+        const char *base = strrchr(info.dli_fname, '/');
+
+        snprintf(buf, sizeof(buf), "%s+0x%lx",
+                 base != NULL ? base + 1 : info.dli_fname,
+                 (unsigned long) ((char *) pc - (char *) info.dli_fbase));
+    } else {
+        snprintf(buf, sizeof(buf), "0x%lx", (unsigned long) pc);
+    }
+
+    sym       = calloc(1, sizeof(symbol_t));
+    sym->pc   = pc;
+    sym->name = strdup(buf);
+    HASH_ADD_PTR(*symbols, pc, sym);
+
+    return sym->name;
+}
+
+static void thread_name(const sample_t *s, char *buf, size_t size)
+{
+    FILE *fp = NULL;
+    char  path[64];
+
+    for (int i = 0; i < profile.n_label; i++) {
+        if (pthread_equal(profile.labels[i].thread, s->thread)) {
+            snprintf(buf, size, "%s/%s", profile.labels[i].node,
+                     profile.labels[i].role);
+            return;
+        }
+    }
+
+    snprintf(buf, size, "tid %d", s->tid);
+    snprintf(path, sizeof(path), "/proc/self/task/%d/comm", s->tid);
+    fp = fopen(path, "r");
+    if (fp != NULL) {
+        if (fgets(buf, size, fp) != NULL) {
+            buf[strcspn(buf, "\n")] = '\0';
+        }
+        fclose(fp);
+    }
+}
+
+static int stack_cmp(folded_t *a, folded_t *b)
+{
+    return a->count < b->count ? 1 : a->count > b->count ? -1 : 0;
+}
+
+static int fold(char **folded, size_t *len)
+{
+    symbol_t *symbols = NULL, *sym = NULL, *sym_tmp = NULL;
+    folded_t *stacks  = NULL, *st = NULL, *st_tmp = NULL;
+    uint32_t  n       = profile.n < profile.max ? profile.n : profile.max;
+    FILE *    fp      = NULL;
+    char *    line    = NULL;
+    size_t    size    = 0;
+
+    pthread_mutex_lock(&profile.mtx);
+    for (uint32_t i = 0; i < n; i++) {
+        sample_t *s = &profile.samples[i];
+        char      name[NEU_NODE_NAME_LEN + 40];
+
+        if (!__atomic_load_n(&s->done, __ATOMIC_ACQUIRE)) {
+            continue;
+        }
+
+        fp = open_memstream(&line, &size);
+        if (fp == NULL) {
+            break;
+        }
+        thread_name(s, name, sizeof(name));
+        // ';' separates frames, keep it out of the thread name
+        for (char *c = name; *c != '\0'; c++) {
+            *c = *c == ';' ? ':' : *c;
+        }
+        fputs(name, fp);
+        for (int k = s->depth - 1; k >= PROFILE_SKIP; k--) {
+            fprintf(fp, ";%s", symbolize(&symbols, s->pc[k]));
+        }
+        fclose(fp);
+
+        HASH_FIND_STR(stacks, line, st);
+        if (st != NULL) {
+            st->count += 1;
+            free(line);
+        } else {
+            st        = calloc(1, sizeof(folded_t));
+            st->stack = line;
+            st->count = 1;
+            HASH_ADD_KEYPTR(hh, stacks, st->stack, strlen(st->stack), st);
+        }
+        line = NULL;
+    }
+    pthread_mutex_unlock(&profile.mtx);
+
+    fp = open_memstream(folded, len);
+    HASH_SORT(stacks, stack_cmp);
+    HASH_ITER(hh, stacks, st, st_tmp)
+    {
+        if (fp != NULL) {
+            fprintf(fp, "%s %" PRIu64 "\n", st->stack, st->count);
+        }
+        HASH_DEL(stacks, st);
+        free(st->stack);
+        free(st);
+    }
+    if (fp != NULL && profile.n > profile.max) {
+        fprintf(fp, "[dropped] %u\n", profile.n - profile.max);
+    }
+    HASH_ITER(hh, symbols, sym, sym_tmp)
+    {
+        HASH_DEL(symbols, sym);
+        free(sym->name);
+        free(sym);
+    }
+
+    if (fp == NULL) {
+        return NEU_ERR_EINTERNAL;
+    }
+    fclose(fp);
+    return NEU_ERR_SUCCESS;
+}
+
+int neu_profile_sample(unsigned seconds, unsigned hz, char **folded,
+                       size_t *len)
+{
+    struct itimerval timer = { 0 };
+    struct timespec  ts    = { .tv_sec = seconds };
+    long             n_cpu = sysconf(_SC_NPROCESSORS_ONLN);
+    void *           pc[1];
+    int              ret = 0;
+
+    if (seconds == 0 || seconds > NEU_PROFILE_SECONDS_MAX || hz == 0 ||
+        hz > NEU_PROFILE_HZ_MAX) {
+        return NEU_ERR_PARAM_IS_WRONG;
+    }
+
+    if (__atomic_exchange_n(&profile.running, 1, __ATOMIC_ACQ_REL)) {
+        return NEU_ERR_IS_BUSY;
+    }
+
+    profile.max = seconds * hz * (n_cpu > 0 ? n_cpu : 1);
+    profile.max = profile.max > PROFILE_SAMPLES_MAX ? PROFILE_SAMPLES_MAX
+                                                    : profile.max;
+    profile.n       = 0;
+    profile.samples = calloc(profile.max, sizeof(sample_t));
+    if (profile.samples == NULL) {
+        __atomic_store_n(&profile.running, 0, __ATOMIC_RELEASE);
+        return NEU_ERR_EINTERNAL;
+    }
+
+    // the handler stays installed, a SIGPROF arriving after the timer is
+    // stopped must not take the default action and end the process
+    if (!profile.installed) {
+        struct sigaction sa = { 0 };
+
+        // the first backtrace loads the unwinder, not safe in the handler
+        backtrace(pc, 1);
+        sa.sa_sigaction = on_sigprof;
+        sa.sa_flags     = SA_SIGINFO | SA_RESTART;
+        sigemptyset(&sa.sa_mask);
+        if (sigaction(SIGPROF, &sa, NULL) != 0) {
+            nlog_error("install SIGPROF handler fail, %s", strerror(errno));
+            free(profile.samples);
+            profile.samples = NULL;
+            __atomic_store_n(&profile.running, 0, __ATOMIC_RELEASE);
+            return NEU_ERR_EINTERNAL;
+        }
+        profile.installed = true;
+    }
+
+    nlog_notice("profile start, %u seconds at %u hz", seconds, hz);
+    __atomic_store_n(&profile.active, 1, __ATOMIC_SEQ_CST);
+    timer.it_interval.tv_usec = 1000000 / hz;
+    timer.it_value            = timer.it_interval;
+    setitimer(ITIMER_PROF, &timer, NULL);
+
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {
+    }
+
+    memset(&timer, 0, sizeof(timer));
+    setitimer(ITIMER_PROF, &timer, NULL);
+    __atomic_store_n(&profile.active, 0, __ATOMIC_SEQ_CST);
+    while (__atomic_load_n(&profile.inflight, __ATOMIC_SEQ_CST) > 0) {
+        sched_yield();
+    }
+
+    ret = fold(folded, len);
+    nlog_notice("profile done, %u samples", profile.n);
+
+    free(profile.samples);
+    profile.samples = NULL;
+    __atomic_store_n(&profile.running, 0, __ATOMIC_RELEASE);
+    return ret;
+}
+
+#else
+
+int neu_profile_sample(unsigned seconds, unsigned hz, char **folded,
+                       size_t *len)
+{
+    (void) seconds;
+    (void) hz;
+    (void) folded;
+    (void) len;
+
+    nlog_warn("stack sampling is not supported on this platform");
+    return NEU_ERR_EINTERNAL;
+}
+
+#endif
@@ -0,0 +1,133 @@
+/**
+ * NEURON IIoT System for Industry 4.0
+ * Copyright (C) 2020-2021 EMQ Technologies Co., Ltd All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ **/
+
+#include <string.h>
+
+#include "utils/snappy.h"
+
+// the input is compressed in independent blocks, positions in a block fit
+// the 16 bits of the hash table and of the copy offsets
+#define SNAPPY_BLOCK (1 << 16)
+#define SNAPPY_HASH_BITS 14
+
+enum {
+    TAG_LITERAL = 0,
+    TAG_COPY2   = 2,
+};
+
+static uint8_t *put_varint(uint8_t *out, uint64_t v)
+{
+    do {
+        *out++ = (v & 0x7f) | (v > 0x7f ? 0x80 : 0);
+        v >>= 7;
+    } while (v);
+    return out;
+}
+
+// n is at most SNAPPY_BLOCK, so its length fits two bytes
+static uint8_t *put_literal(uint8_t *out, const uint8_t *literal, size_t n)
+{
+    size_t m = n - 1;
+
+    if (m < 60) {
+        *out++ = m << 2 | TAG_LITERAL;
+    } else if (m < 256) {
+        *out++ = 60 << 2 | TAG_LITERAL;
+        *out++ = m;
+    } else {
+        *out++ = 61 << 2 | TAG_LITERAL;
+        *out++ = m & 0xff;
+        *out++ = m >> 8;
+    }
+    memcpy(out, literal, n);
+    return out + n;
+}
+
+static uint8_t *put_copy(uint8_t *out, size_t offset, size_t len)
+{
+    while (len > 0) {
+        size_t n = len > 64 ? 64 : len;
+
+        *out++ = (n - 1) << 2 | TAG_COPY2;
+        *out++ = offset & 0xff;
+        *out++ = offset >> 8;
+        len -= n;
+    }
+    return out;
+}
+
+static inline uint32_t load32(const uint8_t *p)
+{
+    uint32_t v = 0;
+
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint32_t hash32(uint32_t v)
+{
+    return (v * 0x1e35a7bd) >> (32 - SNAPPY_HASH_BITS);
+}
+
+// greedy, each 4 bytes seen last at the same hash are tried for a match
+static uint8_t *compress_block(const uint8_t *in, size_t n, uint8_t *out)
+{
+    uint16_t       table[1 << SNAPPY_HASH_BITS] = { 0 };
+    const uint8_t *literal                      = in;
+    size_t         i                            = 0;
+
+    while (i + 4 <= n) {
+        uint32_t v    = load32(in + i);
+        uint32_t h    = hash32(v);
+        size_t   cand = table[h];
+
+        table[h] = i;
+        if (cand >= i || load32(in + cand) != v) {
+            ++i;
+            continue;
+        }
+
+        size_t len = 4;
+        while (i + len < n && in[cand + len] == in[i + len]) {
+            ++len;
+        }
+        if (in + i > literal) {
+            out = put_literal(out, literal, in + i - literal);
+        }
+        out = put_copy(out, i - cand, len);
+        i += len;
+        literal = in + i;
+    }
+
+    if (literal < in + n) {
+        out = put_literal(out, literal, in + n - literal);
+    }
+    return out;
+}
+
+size_t neu_snappy_compress(const uint8_t *in, size_t n, uint8_t *out)
+{
+    uint8_t *p = put_varint(out, n);
+
+    for (size_t off = 0; off < n; off += SNAPPY_BLOCK) {
+        size_t len = n - off < SNAPPY_BLOCK ? n - off : SNAPPY_BLOCK;
+        p          = compress_block(in + off, len, p);
+    }
+    return p - out;
+}
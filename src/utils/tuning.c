@@ -0,0 +1,194 @@
+/**
+ * NEURON IIoT System for Industry 4.0
+ * Copyright (C) 2020-2021 EMQ Technologies Co., Ltd All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ **/
+
+#include <stdlib.h>
+
+#include "utils/tuning.h"
+
+// a group overruns once one in so many reads takes longer than the interval
+#define TUNING_OVERRUN_RATIO 10
+// percent of the interval the reads of a split group are meant to take
+#define TUNING_READ_SHARE 50
+// a tag changing in fewer than one in so many of its reads is slow
+#define TUNING_SLOW_RATIO 100
+// slow tags are read so many times less often
+#define TUNING_SLOW_FACTOR 10
+// device requests reading fewer tags than this on average are merged
+#define TUNING_TAGS_PER_BLOCK 4
+// the intervals recommended are a multiple of it
+#define TUNING_INTERVAL_STEP 100
+
+static uint32_t round_interval(uint64_t ms)
+{
+    ms = (ms + TUNING_INTERVAL_STEP - 1) / TUNING_INTERVAL_STEP *
+        TUNING_INTERVAL_STEP;
+    if (ms < TUNING_INTERVAL_STEP) {
+        return TUNING_INTERVAL_STEP;
+    }
+    return ms > UINT32_MAX ? UINT32_MAX : (uint32_t) ms;
+}
+
+uint32_t neu_tuning_latency_ms(const neu_tuning_group_t *group,
+                               uint32_t                  percent)
+{
+    uint64_t total = 0;
+    uint64_t n     = 0;
+    uint64_t bound = 1;
+
+    // the buckets decay apart from the reads, they are their own total
+    for (int i = 0; i < NEU_TUNING_LATENCY_N; i++) {
+        total += group->latency[i];
+    }
+    if (0 == total) {
+        return 0;
+    }
+
+    for (int i = 0; i < NEU_TUNING_LATENCY_N - 1; i++, bound *= 4) {
+        n += group->latency[i];
+        if (n * 100 >= total * percent) {
+            return (uint32_t) bound;
+        }
+    }
+
+    uint64_t mean = group->reads > 0 ? group->read_ms / group->reads : 0;
+    return (uint32_t) (2 * mean > bound ? 2 * mean : bound);
+}
+
+static neu_tuning_advice_t *advice_put(neu_tuning_advice_t *advices, int *n,
+                                       neu_tuning_kind_e kind, uint32_t value)
+{
+    neu_tuning_advice_t *advice = &advices[(*n)++];
+
+    advice->kind  = kind;
+    advice->value = value;
+    advice->n_tag = 0;
+    advice->tags  = NULL;
+    return advice;
+}
+
+static neu_tuning_advice_t *advice_find(neu_tuning_advice_t *advices, int n,
+                                        neu_tuning_kind_e kind)
+{
+    for (int i = 0; i < n; i++) {
+        if (advices[i].kind == kind) {
+            return &advices[i];
+        }
+    }
+    return NULL;
+}
+
+// the tags changing in fewer than one in TUNING_SLOW_RATIO of their reads,
+// those read too few times to tell are not
+static uint32_t slow_tags(const neu_tuning_group_t *group, uint32_t *tags)
+{
+    uint32_t n = 0;
+
+    for (uint32_t i = 0; group->changes != NULL && i < group->n_tag; i++) {
+        uint16_t divisor = group->poll_divisors != NULL &&
+                group->poll_divisors[i] > 1
+            ? group->poll_divisors[i]
+            : 1;
+        uint64_t reads = group->reads / divisor;
+
+        if (reads >= NEU_TUNING_READS_MIN &&
+            group->changes[i] * TUNING_SLOW_RATIO < reads) {
+            tags[n++] = i;
+        }
+    }
+    return n;
+}
+
+int neu_tuning_recommend(const neu_tuning_group_t *group,
+                         neu_tuning_advice_t *     advices)
+{
+    int                  n        = 0;
+    uint64_t             mean     = 0;
+    uint64_t             per_read = 0;
+    uint32_t             p90      = 0;
+    bool                 overrun  = false;
+    uint32_t *           tags     = NULL;
+    uint32_t             n_slow   = 0;
+    neu_tuning_advice_t *advice   = NULL;
+
+    if (group->reads < NEU_TUNING_READS_MIN || 0 == group->interval) {
+        return 0;
+    }
+
+    mean     = group->read_ms / group->reads;
+    per_read = (group->blocks + group->reads / 2) / group->reads;
+    p90      = neu_tuning_latency_ms(group, 90);
+    overrun  = group->overruns * TUNING_OVERRUN_RATIO >= group->reads ||
+        p90 > group->interval;
+
+    if (overrun && per_read >= 2) {
+        // spread the device requests so that each group reads in a share
+        // of the interval
+        uint64_t share = (uint64_t) group->interval * TUNING_READ_SHARE;
+        uint64_t split = (mean * 100 + share - 1) / share;
+
+        split = split < 2 ? 2 : split > per_read ? per_read : split;
+        advice_put(advices, &n, NEU_TUNING_SPLIT, (uint32_t) split);
+    } else if (overrun) {
+        uint32_t interval = round_interval((uint64_t) p90 * 5 / 4);
+
+        if (interval <= group->interval) {
+            interval = round_interval((uint64_t) group->interval + 1);
+        }
+        advice_put(advices, &n, NEU_TUNING_INTERVAL, interval);
+    }
+
+    if (per_read >= 2 && group->n_tag < per_read * TUNING_TAGS_PER_BLOCK) {
+        advice_put(advices, &n, NEU_TUNING_MERGE_BLOCKS, (uint32_t) per_read);
+    }
+
+    if (group->n_tag > 0) {
+        tags   = calloc(group->n_tag, sizeof(uint32_t));
+        n_slow = tags != NULL ? slow_tags(group, tags) : 0;
+    }
+
+    if (n_slow > 0 && n_slow == group->n_tag) {
+        // then the whole group is slow
+        uint32_t interval =
+            round_interval((uint64_t) group->interval * TUNING_SLOW_FACTOR);
+
+        advice = advice_find(advices, n, NEU_TUNING_INTERVAL);
+        if (NULL != advice) {
+            advice->value = advice->value > interval ? advice->value : interval;
+        } else if (NULL == advice_find(advices, n, NEU_TUNING_SPLIT)) {
+            advice_put(advices, &n, NEU_TUNING_INTERVAL, interval);
+        }
+    } else if (n_slow > 0) {
+        advice = advice_put(
+            advices, &n, NEU_TUNING_SLOW_TAGS,
+            round_interval((uint64_t) group->interval * TUNING_SLOW_FACTOR));
+        advice->n_tag = n_slow;
+        advice->tags  = tags;
+        tags          = NULL;
+    }
+
+    free(tags);
+    return n;
+}
+
+void neu_tuning_advice_fini(neu_tuning_advice_t *advice)
+{
+    free(advice->tags);
+    advice->tags  = NULL;
+    advice->n_tag = 0;
+}
@@ -395,3 +395,31 @@ class TesteKuiper:
                 assert compare_float(req_tags[tag["name"]], tag["value"])
             else:
                 assert req_tags[tag["name"]] == tag["value"]
+
+    @description(
+        given="eKuiper node",
+        when="write driver tags in a burst",
+        then="should keep the last value of each tag",
+    )
+    def test_ekuiper_write_tag_burst(self, mocker, ekuiper_node, conf_base):
+        api.node_setting_check(ekuiper_node, conf_base)
+        api.node_ctl(ekuiper_node, config.NEU_CTL_START)
+
+        req = {
+            "node_name": DRIVER,
+            "group_name": GROUP,
+        }
+
+        mocker.connect(**conf_base)
+        for i in range(200):
+            mocker.send({**req, "tag_name": TAGS[0]["name"], "value": i})
+            mocker.send({**req, "tag_name": TAGS[1]["name"], "value": i % 2 == 0})
+            mocker.send({**req, "tag_name": TAGS[2]["name"], "value": i + 0.5})
+
+        time.sleep(INTERVAL * 10 / 1000)
+        resp = api.read_tags(DRIVER, GROUP)
+        assert 200 == resp.status_code
+        values = {tag["name"]: tag["value"] for tag in resp.json()["tags"]}
+        assert 199 == values[TAGS[0]["name"]]
+        assert False == values[TAGS[1]["name"]]
+        assert compare_float(199.5, values[TAGS[2]["name"]])
@@ -287,6 +287,24 @@ def conf_cache_bad_sync(conf_cache):
     }
 
 
+@pytest.fixture(scope="function")
+def conf_cache_bad_replay_share(conf_cache):
+    return {
+        **conf_cache,
+        "offline-cache": True,
+        "replay-share": 0,
+    }
+
+
+@pytest.fixture(scope="function")
+def conf_cache_bad_replay_order(conf_cache):
+    return {
+        **conf_cache,
+        "offline-cache": True,
+        "replay-order": 2,
+    }
+
+
 @pytest.fixture(scope="function")
 def conf_cache_mem_exceeds_disk(conf_cache):
     return {
@@ -347,6 +365,8 @@ class TestMQTT:
             "conf_cache_bad_mem",
             "conf_cache_bad_disk",
             "conf_cache_bad_sync",
+            "conf_cache_bad_replay_share",
+            "conf_cache_bad_replay_order",
             "conf_cache_mem_exceeds_disk",
             "conf_cache_zero_mem",
             "conf_cache_no_mem",
@@ -536,6 +556,29 @@ class TestMQTT:
         else:
             assert False, "no cached message upload"
 
+    @description(
+        given="MQTT node and conf_cache replaying newest first",
+        when="broken network connection restored",
+        then="broker should receive the newest cache data first",
+    )
+    def test_mqtt_cache_newest_first(self, mocker, conf_cache):
+        conf = {**conf_cache, "replay-order": 1, "replay-rate": 64}
+        api.node_setting_check(NODE, conf)
+        api.node_ctl(NODE, config.NEU_CTL_START)
+        mocker.assert_client_connected()
+
+        mocker.offline(seconds=1.5)
+        ts = (time.time_ns() // 1_000_000) - INTERVAL
+
+        # live messages are interleaved with cached ones
+        cached = [
+            msg["timestamp"]
+            for msg in mocker.get(UPLOAD_TOPIC, num=10, timeout=1.5)
+            if msg["timestamp"] < ts
+        ]
+        assert len(cached) > 1, "no cached message upload"
+        assert cached == sorted(cached, reverse=True)
+
     @description(
         given="MQTT node",
         when="send bad read req",
@@ -0,0 +1,113 @@
+import base64
+import os
+import time
+
+import neuron.api as api
+import neuron.config as config
+from neuron.common import case_time, class_setup_and_teardown, description
+from prometheus_client.parser import text_string_to_metric_families
+
+# synthetic driver -> core -> null app, the load can be sized by hand through
+# the environment, the defaults keep a CI run short
+GROUPS = int(os.environ.get("NEU_BENCH_GROUPS", "10"))
+TAGS = int(os.environ.get("NEU_BENCH_TAGS", "500"))
+INTERVAL = int(os.environ.get("NEU_BENCH_INTERVAL", "100"))
+DURATION = int(os.environ.get("NEU_BENCH_DURATION", "30"))
+WARMUP = int(os.environ.get("NEU_BENCH_WARMUP", "5"))
+# share of the offered tags/s a run has to sustain
+MIN_RATIO = float(os.environ.get("NEU_BENCH_MIN_RATIO", "0.9"))
+# p99 latency from sample to app a run must stay under, in ms
+MAX_P99_MS = int(os.environ.get("NEU_BENCH_MAX_P99_MS", str(INTERVAL * 5)))
+
+DRIVER = "bench-driver"
+APP = "bench-app"
+
+
+def load(library, schema):
+    with open('build/tests/plugins/' + library, 'rb') as f:
+        so_file = str(base64.b64encode(f.read()), encoding='utf-8')
+    with open('build/tests/plugins/schema/' + schema, 'rb') as f:
+        schema_file = str(base64.b64encode(f.read()), encoding='utf-8')
+    response = api.add_plugin(library, so_file, schema_file)
+    assert 200 == response.status_code
+
+
+def app_metrics():
+    values = {}
+    response = api.get_metrics("app", APP)
+    assert 200 == response.status_code
+    for family in text_string_to_metric_families(response.text):
+        for sample in family.samples:
+            if sample.name.startswith("bench_"):
+                values[sample.name] = sample.value
+    return values
+
+
+def cpu_seconds(pid):
+    with open(f'/proc/{pid}/stat') as f:
+        fields = f.read().rsplit(')', 1)[1].split()
+    # utime and stime, fields 14 and 15 of proc(5)
+    return (int(fields[11]) + int(fields[12])) / os.sysconf('SC_CLK_TCK')
+
+
+def rss_bytes(pid):
+    with open(f'/proc/{pid}/status') as f:
+        for line in f:
+            if line.startswith('VmRSS:'):
+                return int(line.split()[1]) * 1024
+    return 0
+
+
+class TestBench:
+
+    @description(given="bench plugins", when="add nodes, groups and tags", then="success")
+    def test_01_setup(self):
+        load('libplugin-bench-driver.so', 'bench-driver.json')
+        load('libplugin-bench-app.so', 'bench-app.json')
+
+        api.add_node_check(DRIVER, 'bench-driver')
+        api.add_node_check(APP, 'bench-app')
+        for g in range(GROUPS):
+            group = f'group{g}'
+            tags = [{"name": f"tag{t}", "address": f"{t}",
+                     "attribute": config.NEU_TAG_ATTRIBUTE_READ,
+                     "type": config.NEU_TYPE_INT64} for t in range(TAGS)]
+            api.add_group_check(DRIVER, group, INTERVAL)
+            api.add_tags_check(DRIVER, group, tags)
+            api.subscribe_group_check(APP, DRIVER, group)
+
+        api.node_setting_check(DRIVER, {})
+        api.node_setting_check(APP, {})
+        api.node_ctl(DRIVER, config.NEU_CTL_START)
+        api.node_ctl(APP, config.NEU_CTL_START)
+
+    @description(given="running bench nodes", when="sustained load", then="report throughput, latency, cpu and rss")
+    def test_02_throughput(self, class_setup_and_teardown):
+        pid = class_setup_and_teardown.p.pid
+        offered = GROUPS * TAGS * 1000 / INTERVAL
+
+        time.sleep(WARMUP)
+        start, cpu_start = time.time(), cpu_seconds(pid)
+        tags_start = app_metrics().get("bench_tags_total", 0)
+
+        time.sleep(DURATION)
+        end, cpu_end = time.time(), cpu_seconds(pid)
+        metrics = app_metrics()
+
+        rate = (metrics.get("bench_tags_total", 0) - tags_start) / \
+            (end - start)
+        cpu = (cpu_end - cpu_start) / (end - start) * 100
+        cpu_per_10k = cpu / (rate / 10000) if rate > 0 else float('inf')
+
+        print(f'\n groups: {GROUPS} tags: {TAGS} interval: {INTERVAL}ms')
+        print(f' offered: {offered:.0f} tags/s sustained: {rate:.0f} tags/s')
+        print(' latency p50: {:.0f}ms p99: {:.0f}ms p999: {:.0f}ms max: {:.0f}ms'
+              .format(metrics.get("bench_latency_p50_ms", 0),
+                      metrics.get("bench_latency_p99_ms", 0),
+                      metrics.get("bench_latency_p999_ms", 0),
+                      metrics.get("bench_latency_max_ms", 0)))
+        print(f' cpu: {cpu:.1f}% per 10k tags/s: {cpu_per_10k:.2f}%')
+        print(f' rss: {rss_bytes(pid) / 1024 / 1024:.1f}MiB')
+
+        assert rate >= offered * MIN_RATIO
+        assert metrics.get("bench_latency_p99_ms", 0) <= MAX_P99_MS
@@ -0,0 +1,165 @@
+import base64
+import json
+import os
+import threading
+import time
+
+import neuron.api as api
+import neuron.config as config
+from neuron.common import case_time, class_setup_and_teardown, description
+from neuron.mqtt import Mock
+from prometheus_client.parser import text_string_to_metric_families
+
+# synthetic driver -> core -> mqtt app -> local mosquitto, sized through the
+# environment like the synthetic bench
+GROUPS = int(os.environ.get("NEU_MQTT_BENCH_GROUPS", "10"))
+TAGS = int(os.environ.get("NEU_MQTT_BENCH_TAGS", "100"))
+INTERVAL = int(os.environ.get("NEU_MQTT_BENCH_INTERVAL", "100"))
+QOS = int(os.environ.get("NEU_MQTT_BENCH_QOS", "0"))
+DURATION = int(os.environ.get("NEU_MQTT_BENCH_DURATION", "10"))
+OFFLINE = int(os.environ.get("NEU_MQTT_BENCH_OFFLINE", "5"))
+
+DRIVER = "mqtt-bench-driver"
+APP = "mqtt-bench"
+TOPIC = f"/neuron/{APP}/upload"
+
+
+def load(library, schema):
+    with open('build/tests/plugins/' + library, 'rb') as f:
+        so_file = str(base64.b64encode(f.read()), encoding='utf-8')
+    with open('build/tests/plugins/schema/' + schema, 'rb') as f:
+        schema_file = str(base64.b64encode(f.read()), encoding='utf-8')
+    response = api.add_plugin(library, so_file, schema_file)
+    assert 200 == response.status_code
+
+
+def app_metrics():
+    values = {}
+    response = api.get_metrics("app", APP)
+    assert 200 == response.status_code
+    for family in text_string_to_metric_families(response.text):
+        for sample in family.samples:
+            values[sample.name] = values.get(sample.name, 0) + sample.value
+    return values
+
+
+class Receiver:
+    """Count the uploads and their latency from the sample time in tag0."""
+
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.n = 0
+        self.latencies = []
+
+    def handler(self, payload):
+        now = time.time() * 1000
+        sample = json.loads(payload)["values"].get("tag0")
+        with self.lock:
+            self.n += 1
+            if sample is not None:
+                self.latencies.append(now - sample)
+
+    def take(self):
+        with self.lock:
+            n, latencies = self.n, sorted(self.latencies)
+            self.n, self.latencies = 0, []
+        return n, latencies
+
+
+def percentile(values, p):
+    return values[min(len(values) - 1, int(len(values) * p))] if values \
+        else 0
+
+
+def wait_cached(pred, timeout):
+    start = time.time()
+    while time.time() - start < timeout:
+        cached = app_metrics().get("cached_msgs", 0)
+        if pred(cached):
+            return cached, time.time() - start
+        time.sleep(0.1)
+    return app_metrics().get("cached_msgs", 0), time.time() - start
+
+
+class TestMqttBench:
+
+    @description(given="bench driver and mqtt app", when="add nodes, groups and tags", then="success")
+    def test_01_setup(self, class_setup_and_teardown):
+        TestMqttBench.mocker = Mock()
+        TestMqttBench.receiver = Receiver()
+        self.mocker.sub(TOPIC, self.receiver.handler)
+
+        load('libplugin-bench-driver.so', 'bench-driver.json')
+        api.add_node_check(DRIVER, 'bench-driver')
+        api.add_node_check(APP, 'MQTT')
+        for g in range(GROUPS):
+            group = f'group{g}'
+            tags = [{"name": f"tag{t}", "address": f"{t}",
+                     "attribute": config.NEU_TAG_ATTRIBUTE_READ,
+                     "type": config.NEU_TYPE_INT64} for t in range(TAGS)]
+            api.add_group_check(DRIVER, group, INTERVAL)
+            api.add_tags_check(DRIVER, group, tags)
+            api.subscribe_group_check(APP, DRIVER, group, {"topic": TOPIC})
+
+        api.node_setting_check(DRIVER, {})
+        api.node_setting_check(APP, {
+            "client-id": self.mocker.rand_id(), "qos": QOS, "format": 0,
+            "write-req-topic": f"/neuron/{APP}/write/req",
+            "write-resp-topic": f"/neuron/{APP}/write/resp",
+            "offline-cache": True, "cache-mem-size": 64,
+            "cache-disk-size": 256, "cache-sync-interval": 100,
+            "host": "127.0.0.1", "port": self.mocker.port, "ssl": False})
+        api.node_ctl(DRIVER, config.NEU_CTL_START)
+        api.node_ctl(APP, config.NEU_CTL_START)
+
+    @description(given="running bench driver and mqtt app", when="sustained load", then="report publishes/s, bytes/s and end to end latency")
+    def test_02_throughput(self, class_setup_and_teardown):
+        offered = GROUPS * 1000 / INTERVAL
+
+        time.sleep(2)
+        self.receiver.take()
+        start, metrics = time.time(), app_metrics()
+        time.sleep(DURATION)
+        end, after = time.time(), app_metrics()
+        received, latencies = self.receiver.take()
+
+        def rate(name):
+            return (after.get(name, 0) - metrics.get(name, 0)) / (end - start)
+
+        print(f'\n groups: {GROUPS} tags: {TAGS} interval: {INTERVAL}ms '
+              f'qos: {QOS}')
+        print(f' offered: {offered:.0f} publishes/s '
+              f'sent: {rate("send_msgs_total"):.0f} publishes/s '
+              f'{rate("send_bytes") / 1024:.0f} KiB/s '
+              f'received: {received / (end - start):.0f} publishes/s')
+        print(' latency p50: {:.0f}ms p99: {:.0f}ms max: {:.0f}ms'.format(
+            percentile(latencies, 0.5), percentile(latencies, 0.99),
+            latencies[-1] if latencies else 0))
+
+        assert rate("send_msgs_total") > 0
+        assert received > 0
+
+    @description(given="running mqtt app with offline cache", when="the broker goes away and comes back", then="report spill and replay rates")
+    def test_03_offline_replay(self, class_setup_and_teardown):
+        self.mocker.client.disconnect()
+        self.mocker.broker.stop()
+        time.sleep(OFFLINE)
+        spilled = app_metrics().get("cached_msgs", 0)
+        self.mocker.broker.start()
+        self.mocker.client.connect("127.0.0.1")
+
+        cached, replay = wait_cached(lambda n: n == 0, 60)
+
+        print(f'\n offline: {OFFLINE}s cached: {spilled:.0f} msgs '
+              f'spill: {spilled / OFFLINE:.0f} msgs/s')
+        print(f' replayed in {replay:.1f}s: '
+              f'{spilled / replay if replay > 0 else 0:.0f} msgs/s')
+
+        assert spilled > 0
+        assert cached == 0
+
+    @description(given="bench nodes", when="delete them", then="success")
+    def test_04_teardown(self, class_setup_and_teardown):
+        api.del_node(APP)
+        api.del_node(DRIVER)
+        self.mocker.done()
@@ -0,0 +1,131 @@
+import os
+import re
+import subprocess
+import time
+
+import neuron.api as api
+import neuron.config as config
+from neuron.common import case_time, class_setup_and_teardown, description
+from prometheus_client.parser import text_string_to_metric_families
+
+# modbus rtu over a pty bus of modbus_scale_simulator --pty, sized through
+# the environment like the synthetic bench
+SLAVES = int(os.environ.get("NEU_RTU_BENCH_SLAVES", "4"))
+TAGS = int(os.environ.get("NEU_RTU_BENCH_TAGS", "20"))
+BAUD = int(os.environ.get("NEU_RTU_BENCH_BAUD", "19200"))
+INTERVAL = int(os.environ.get("NEU_RTU_BENCH_INTERVAL", "100"))
+RTT = int(os.environ.get("NEU_RTU_BENCH_RTT", "2"))
+DURATION = int(os.environ.get("NEU_RTU_BENCH_DURATION", "10"))
+
+# the baud map of the modbus rtu node setting
+BAUD_SETTING = {115200: 0, 57600: 1, 38400: 2, 19200: 3, 9600: 4,
+                4800: 5, 2400: 6, 1200: 7}
+
+DRIVER = "rtu-bench"
+
+
+def start_bus(*faults):
+    p = subprocess.Popen(['./modbus_scale_simulator', '--pty',
+                          f'--baud={BAUD}', f'--slaves={SLAVES}',
+                          f'--rtt={RTT}', '--threads=1', *faults],
+                         stdout=subprocess.PIPE, text=True,
+                         cwd='build/simulator')
+    line = p.stdout.readline()
+    match = re.match(r'pty: (\S+)', line)
+    assert match is not None, line
+    return p, match.group(1)
+
+
+def stop_bus(p):
+    p.terminate()
+    out = p.communicate(timeout=10)[0]
+    print(out)
+
+    summary = {'slaves': {}}
+    for line in out.splitlines():
+        m = re.match(r'cycles: (\d+), ([\d.]+)/s', line)
+        if m:
+            summary['cycles'] = float(m.group(2))
+        m = re.match(r'port 0 bus utilization: ([\d.]+)%', line)
+        if m:
+            summary['utilization'] = float(m.group(1))
+        m = re.match(
+            r'port 0 slave (\d+) latency: answers (\d+), avg ([\d.]+) ms, max (\d+) ms', line)
+        if m:
+            summary['slaves'][int(m.group(1))] = (
+                int(m.group(2)), float(m.group(3)), int(m.group(4)))
+        m = re.match(r'conn: .*crc: (\d+), partial: (\d+), error: (\d+)', line)
+        if m:
+            summary['crc'], summary['partial'] = int(m.group(1)), \
+                int(m.group(2))
+    return summary
+
+
+def setup_driver(device):
+    api.add_node_check(DRIVER, config.PLUGIN_MODBUS_RTU)
+    for s in range(1, SLAVES + 1):
+        group = f'slave{s}'
+        tags = [{"name": f"tag{t}", "address": f"{s}!4{t + 1:05d}",
+                 "attribute": config.NEU_TAG_ATTRIBUTE_READ,
+                 "type": config.NEU_TYPE_INT16} for t in range(TAGS)]
+        api.add_group_check(DRIVER, group, INTERVAL)
+        api.add_tags_check(DRIVER, group, tags)
+    response = api.modbus_rtu_node_setting(
+        node=DRIVER, link=0, device=device, baud=BAUD_SETTING[BAUD],
+        interval=0, timeout=200, max_retries=0)
+    assert 200 == response.status_code
+
+
+def tag_reads():
+    response = api.get_metrics("driver", DRIVER)
+    assert 200 == response.status_code
+    total = 0
+    for family in text_string_to_metric_families(response.text):
+        for sample in family.samples:
+            if sample.name.startswith("tag_reads_total"):
+                total += sample.value
+    return total
+
+
+class TestRtuBench:
+
+    @description(given="a pty rtu bus of {SLAVES} slaves", when="poll every slave", then="report bus utilization, cycles/s and latency per slave")
+    def test_rtu_bus(self, class_setup_and_teardown):
+        p, device = start_bus()
+        setup_driver(device)
+
+        time.sleep(2)
+        reads = tag_reads()
+        time.sleep(DURATION)
+        rate = (tag_reads() - reads) / DURATION
+        api.del_node(DRIVER)
+        summary = stop_bus(p)
+
+        print(f'\n slaves: {SLAVES} tags: {TAGS} baud: {BAUD} '
+              f'interval: {INTERVAL}ms')
+        print(f' cycles: {summary["cycles"]:.1f}/s '
+              f'bus utilization: {summary["utilization"]:.1f}% '
+              f'tag reads: {rate:.0f}/s')
+        for s, (n, avg, peak) in sorted(summary['slaves'].items()):
+            print(f' slave {s}: answers {n} avg {avg:.1f}ms max {peak}ms')
+
+        assert summary['cycles'] > 0
+        assert 0 < summary['utilization'] <= 100
+        assert len(summary['slaves']) == SLAVES
+        assert all(n > 0 for n, _, _ in summary['slaves'].values())
+
+    @description(given="a pty rtu bus with crc errors, silence and partial frames", when="poll every slave", then="the driver keeps reading")
+    def test_rtu_bus_faults(self, class_setup_and_teardown):
+        p, device = start_bus('--crc-rate=5', '--partial-rate=5',
+                              '--timeout-rate=5')
+        setup_driver(device)
+
+        time.sleep(DURATION)
+        response = api.read_tags(DRIVER, 'slave1')
+        api.del_node(DRIVER)
+        summary = stop_bus(p)
+
+        assert 200 == response.status_code
+        assert summary['crc'] > 0
+        assert summary['partial'] > 0
+        assert summary['cycles'] > 0
@@ -0,0 +1,75 @@
+import re
+import subprocess
+
+from neuron.common import description
+
+
+def run_bench(spec, *options, timeout=60):
+    return subprocess.run(['./neuron', '--bench=' + spec, *options],
+                          cwd='build/', capture_output=True, text=True,
+                          timeout=timeout)
+
+
+class TestSelfBench:
+
+    @description(given="no running neuron", when="run --bench", then="report throughput, latency and cpu per stage")
+    def test_bench_report(self):
+        result = run_bench('groups=2,tags=100,interval=50,apps=2,seconds=2')
+        assert 0 == result.returncode, result.stderr
+
+        out = result.stdout
+        print(out)
+        rate = re.search(r'throughput: (\d+) tag values/s', out)
+        assert rate is not None
+        assert int(rate.group(1)) > 0
+        for stage in ['read', 'cache', 'transfer', 'queue', 'deliver',
+                      'total', 'driver read', 'app consumer', 'process']:
+            assert re.search(r'^  ' + stage + r' ', out, re.M), stage
+
+    @description(given="apps on several consumers", when="run --bench", then="every group is delivered and consumers share the cpu")
+    def test_bench_app_consumers(self):
+        result = run_bench('groups=8,tags=100,interval=50,apps=1,seconds=2',
+                           '--app_consumers=4')
+        assert 0 == result.returncode, result.stderr
+
+        out = result.stdout
+        print(out)
+        rate = re.search(r'throughput: (\d+) tag values/s', out)
+        assert rate is not None
+        # 8 groups x 100 tags every 50 ms, some reads fall outside the window
+        assert int(rate.group(1)) > 8 * 100 * 20 / 2
+        assert re.search(r'^  app consumer ', out, re.M)
+
+    @description(given="a bad app consumer count", when="run neuron", then="exit with an error")
+    def test_app_consumers_invalid(self):
+        for n in ['0', '9', 'x']:
+            result = run_bench('seconds=1', '--app_consumers=' + n)
+            assert 0 != result.returncode
+            assert "option '--app_consumers' invalid value" in result.stderr
+
+    @description(given="a bad bench spec", when="run --bench", then="exit with an error")
+    def test_bench_invalid(self):
+        for spec in ['tags=0', 'apps=x', 'unknown=1', 'seconds']:
+            result = run_bench(spec)
+            assert 0 != result.returncode
+            assert "option '--bench' invalid value" in result.stderr
+
+    @description(given="metrics turned off", when="run --bench", then="the tag values still flow")
+    def test_bench_metrics_off(self):
+        result = run_bench('groups=2,tags=100,interval=50,apps=1,seconds=2',
+                           '--metrics_off=rolling,histogram,group',
+                           '--metrics_windows=5')
+        assert 0 == result.returncode, result.stderr
+        rate = re.search(r'throughput: (\d+) tag values/s', result.stdout)
+        assert rate is not None
+        assert int(rate.group(1)) > 0
+
+    @description(given="a bad metrics option", when="run neuron", then="exit with an error")
+    def test_metrics_off_invalid(self):
+        for option in ['--metrics_off=tags', '--metrics_off=rolling,',
+                       '--metrics_windows=0', '--metrics_windows=5,x',
+                       '--metrics_windows=1,2,3,4,5,6,7,8,9']:
+            result = run_bench('seconds=1', option)
+            assert 0 != result.returncode
+            name = option.split('=')[0]
+            assert "option '" + name + "' invalid value" in result.stderr
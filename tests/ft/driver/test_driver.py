@@ -157,3 +157,26 @@ class TestDriver:
     def test_del_node(self, node):
         response = api.del_node(node=node)
         assert 200 == response.status_code
+
+    @description(given="running neuron", when="add and delete many nodes in parallel", then="every request of a node is handled in order")
+    def test_parallel_add_del_nodes(self):
+        from concurrent.futures import ThreadPoolExecutor
+
+        nodes = ['parallel-%d' % i for i in range(16)]
+
+        def add_del_add(node):
+            r1 = api.add_node(node=node, plugin=config.PLUGIN_MODBUS_TCP)
+            r2 = api.del_node(node=node)
+            r3 = api.add_node(node=node, plugin=config.PLUGIN_MODBUS_TCP)
+            return [r.json()['error'] for r in (r1, r2, r3)]
+
+        with ThreadPoolExecutor(max_workers=8) as executor:
+            for errors in executor.map(add_del_add, nodes):
+                assert [error.NEU_ERR_SUCCESS] * 3 == errors
+
+        response = api.get_nodes(type=1)
+        assert 200 == response.status_code
+        names = [n['name'] for n in response.json()['nodes']]
+        for node in nodes:
+            assert node in names
+            assert 200 == api.del_node(node=node).status_code
@@ -1,8 +1,10 @@
+import concurrent.futures
 import subprocess
 import select
 import fcntl
 import re
 import os
+import json
 import neuron.api as api
 import neuron.error as error
 import neuron.config as config
@@ -674,6 +676,17 @@ class TestModbus:
         assert error.NEU_ERR_PLUGIN_NOT_SUPPORT_READ_SYNC == api.read_tag_error(
             node=param[0], group='group', tag=input_bit_5[0]['name'], sync=True)
 
+    @description(given="created modbus node and tags", when="read tags synchronously with a max age", then="a negative max age is rejected")
+    def test_read_tags_sync_max_age(self, param):
+        response = api.read_tags(
+            node=param[0], group='group', sync=True, max_age=-1)
+        assert 400 == response.status_code
+        assert error.NEU_ERR_BODY_IS_WRONG == response.json()['error']
+
+        response = api.read_tags(
+            node=param[0], group='group', sync=True, max_age=1000)
+        assert 200 == response.status_code
+
     @description(given="created modbus node, a tag with same name/address that in different groups", when="read tags", then="read success")
     def test_read_tag_in_diff_group(self, param):
         response = api.add_group(node=param[0], group='group1')
@@ -704,6 +717,65 @@ class TestModbus:
         assert 444 == api.read_tag(
             node=param[0], group='group1', tag=t_tag[0]['name'])
 
+    @description(given="created modbus node with two groups", when="batch read groups", then="every group is returned")
+    def test_read_tags_batch(self, param):
+        response = api.read_tags_batch([
+            {"node": param[0], "group": "group",
+                "query": {"name": hold_int16[0]['name']}},
+            {"node": param[0], "group": "group1"},
+            {"node": param[0], "group": "no_group"},
+            {"node": "no_node", "group": "group"}])
+        assert 200 == response.status_code
+        groups = {(g["node"], g["group"]): g for g in response.json()["groups"]}
+        assert 4 == len(groups)
+        assert 333 in [tag.get('value')
+                       for tag in groups[(param[0], "group")]["tags"]]
+        assert 444 in [tag.get('value')
+                       for tag in groups[(param[0], "group1")]["tags"]]
+        assert error.NEU_ERR_GROUP_NOT_EXIST == groups[(
+            param[0], "no_group")]["error"]
+        assert error.NEU_ERR_NODE_NOT_EXIST == groups[(
+            "no_node", "group")]["error"]
+
+    @description(given="created modbus node and tags", when="subscribe group over sse", then="receive group values")
+    def test_sse_subscribe(self, param):
+        response = api.sse_subscribe(node=param[0], group='group')
+        assert 200 == response.status_code
+        assert response.headers['Content-Type'] == 'text/event-stream'
+        for line in response.iter_lines():
+            if line.startswith(b'data: '):
+                event = json.loads(line[len(b'data: '):])
+                break
+        response.close()
+        assert param[0] == event['node']
+        assert 'group' == event['group']
+        assert 333 == event['values'][hold_int16[0]['name']]
+
+    @description(given="created modbus node and tags", when="import and export tags as ndjson", then="exported lines contain the imported tags")
+    def test_import_export_gtags(self, param):
+        lines = [json.dumps({"group": "import", "interval": 1000, "name": "import%d" % i, "address": "1!4%05d" % (200 + i),
+                             "attribute": config.NEU_TAG_ATTRIBUTE_RW, "type": config.NEU_TYPE_INT16}) for i in range(3)]
+        response = api.import_gtags(node=param[0], lines=lines)
+        assert 200 == response.status_code
+        result = [json.loads(line) for line in response.text.splitlines()]
+        assert error.NEU_ERR_SUCCESS == result[-1]['error']
+        assert 3 == result[-1]['tags']
+
+        response = api.export_gtags(node=param[0])
+        assert 200 == response.status_code
+        tags = [json.loads(line) for line in response.iter_lines() if line]
+        assert ['import0', 'import1', 'import2'] == [
+            tag['name'] for tag in tags if tag['group'] == 'import']
+        assert hold_int16[0]['name'] in [tag['name']
+                                         for tag in tags if tag['group'] == 'group']
+
+        response = api.import_gtags(
+            node=param[0], lines=[lines[0].replace('import0', 'import3'), "{"])
+        result = [json.loads(line) for line in response.text.splitlines()]
+        assert error.NEU_ERR_BODY_IS_WRONG == result[-1]['error']
+        assert 2 == result[-1]['line']
+        assert 0 == result[-1]['tags']
+
     @description(given="created modbus node/tags", when="update tags", then="update success")
     def test_update_tag(self, param):
         up_tag = [{"name": "up_tag", "address": "1!400031",
@@ -1119,6 +1191,26 @@ class TestModbus:
         assert 1 == api.read_tag(
             node=param[0], group='group1', tag=hold_int16[0]['name'])
 
+    @description(given="created modbus node ,groups and tags", when="write a batch spanning nodes", then="every node is answered")
+    def test_write_batch(self, param):
+        batch = {"nodes": [{"node": param[0], "groups": [{"group": "group", "tags": [{"tag": "hold_uint16", "value": 7}]}]},
+                           {"node": param[0], "groups": [{"group": "group1", "tags": [{"tag": "hold_int16", "value": 8}]}]}]}
+        response = api.write_batch(json=batch)
+        assert 200 == response.status_code
+        assert error.NEU_ERR_SUCCESS == response.json()['error']
+        assert [{"node": param[0], "error": 0}] * 2 == response.json()['nodes']
+        time.sleep(0.3)
+        assert 7 == api.read_tag(
+            node=param[0], group='group', tag=hold_uint16[0]['name'])
+        assert 8 == api.read_tag(
+            node=param[0], group='group1', tag=hold_int16[0]['name'])
+
+        batch["nodes"].append({"node": "no-such-node", "groups": [{"group": "group", "tags": [{"tag": "t", "value": 1}]}]})
+        response = api.write_batch(json=batch)
+        assert 404 == response.status_code
+        assert error.NEU_ERR_NODE_NOT_EXIST == response.json()['error']
+        assert [0, 0, error.NEU_ERR_NODE_NOT_EXIST] == [node['error'] for node in response.json()['nodes']]
+
     @description(given="created modbus device_error_test node/tag", when="read tag", then="read failed")
     def test_read_modbus_device_err(self, param):
         if param[0] == 'modbus-rtu-tty':
@@ -1145,6 +1237,119 @@ class TestModbus:
         assert 222 == api.read_tag(
             node=param[0], group='group', tag=hold_int16_retry_2[0]['name'])
 
+    @description(given="two modbus nodes sharing the connection to the simulator", when="write tag on one node", then="both nodes read the value")
+    def test_write_read_shared_connection(self, param):
+        if param[0] == 'modbus-rtu-tty':
+            pytest.skip("modbus rtu tty pass")
+        nodes = [param[0] + "_share1", param[0] + "_share2"]
+        for node in nodes:
+            api.add_node_check(node=node, plugin=param[1])
+            if param[0] == 'modbus-tcp':
+                response = api.modbus_tcp_node_setting(
+                    node=node, interval=1, port=tcp_port, connection_share=True)
+            else:
+                response = api.modbus_rtu_node_setting(
+                    node=node, interval=1, port=rtu_port, connection_share=True)
+            assert 200 == response.status_code
+            api.add_group_check(node=node, group='group', interval=100)
+            api.add_tags_check(node=node, group='group', tags=hold_int16)
+
+        api.write_tag_check(
+            node=nodes[0], group='group', tag=hold_int16[0]['name'], value=321)
+        time.sleep(0.5)
+        for node in nodes:
+            assert 321 == api.read_tag(
+                node=node, group='group', tag=hold_int16[0]['name'])
+
+        for node in nodes:
+            api.del_node(node=node)
+
+    @description(given="modbus tcp node with tcp socket options", when="write and read tag", then="write/read success")
+    def test_write_read_tcp_options(self, param):
+        if param[0] != 'modbus-tcp':
+            pytest.skip("modbus tcp client only")
+        node = param[0] + "_tcp_opt"
+        api.add_node_check(node=node, plugin=param[1])
+        api.node_setting_check(node=node, json={"connection_mode": 0, "transport_mode": 0, "interval": 1,
+                                                "host": "127.0.0.1", "port": tcp_port, "timeout": 3000,
+                                                "tcp_nodelay": True, "keepalive_idle": 10, "keepalive_interval": 2,
+                                                "keepalive_count": 3, "tcp_user_timeout": 5000,
+                                                "recv_buffer_size": 65536, "send_buffer_size": 65536})
+        api.add_group_check(node=node, group='group', interval=100)
+        api.add_tags_check(node=node, group='group', tags=hold_int16)
+
+        api.write_tag_check(
+            node=node, group='group', tag=hold_int16[0]['name'], value=123)
+        time.sleep(0.5)
+        assert 123 == api.read_tag(
+            node=node, group='group', tag=hold_int16[0]['name'])
+        api.del_node(node=node)
+
+    @description(given="modbus node polling a group of many tags", when="write a tag preempting the poll", then="write/read success")
+    def test_write_read_preempt(self, param):
+        if param[0] != 'modbus-tcp':
+            pytest.skip("modbus tcp client only")
+        node = param[0] + "_preempt"
+        api.add_node_check(node=node, plugin=param[1])
+        api.node_setting_check(node=node, json={"connection_mode": 0, "transport_mode": 0, "interval": 1,
+                                                "host": "127.0.0.1", "port": tcp_port, "timeout": 3000})
+        api.add_group_check(node=node, group='group', interval=100)
+        api.add_tags_check(node=node, group='group', tags=hold_int16 + hold_uint16 + hold_int32)
+
+        api.write_tag_check(
+            node=node, group='group', tag=hold_int16[0]['name'], value=321, preempt=True)
+        time.sleep(0.5)
+        assert 321 == api.read_tag(
+            node=node, group='group', tag=hold_int16[0]['name'])
+        api.del_node(node=node)
+
+    @description(given="modbus node polling a group", when="write a tag asking for verification", then="write answered after the read back")
+    def test_write_read_verify(self, param):
+        if param[0] != 'modbus-tcp':
+            pytest.skip("modbus tcp client only")
+        node = param[0] + "_verify"
+        api.add_node_check(node=node, plugin=param[1])
+        api.node_setting_check(node=node, json={"connection_mode": 0, "transport_mode": 0, "interval": 1,
+                                                "host": "127.0.0.1", "port": tcp_port, "timeout": 3000})
+        api.add_group_check(node=node, group='group', interval=100)
+        api.add_tags_check(node=node, group='group', tags=hold_int16)
+
+        api.write_tag_check(
+            node=node, group='group', tag=hold_int16[0]['name'], value=456, verify=True)
+        assert 456 == api.read_tag(
+            node=node, group='group', tag=hold_int16[0]['name'])
+        api.del_node(node=node)
+
+    @description(given="modbus node with a coalescing tag", when="write the tag in a burst", then="queued writes are superseded by the newer ones")
+    def test_write_coalesce(self, param):
+        if param[0] != 'modbus-tcp':
+            pytest.skip("modbus tcp client only")
+        node = param[0] + "_coalesce"
+        tag = {**hold_int16[0],
+               "attribute": config.NEU_TAG_ATTRIBUTE_RW | config.NEU_TAG_ATTRIBUTE_COALESCE}
+        api.add_node_check(node=node, plugin=param[1])
+        api.node_setting_check(node=node, json={"connection_mode": 0, "transport_mode": 0, "interval": 1,
+                                                "host": "127.0.0.1", "port": tcp_port, "timeout": 3000})
+        api.add_group_check(node=node, group='group', interval=1000)
+        api.add_tags_check(node=node, group='group', tags=[tag])
+
+        def write(value):
+            response = api.write_tag(
+                node=node, group='group', tag=tag['name'], value=value)
+            return value, response.json()['error']
+
+        with concurrent.futures.ThreadPoolExecutor(max_workers=20) as pool:
+            results = list(pool.map(write, range(100, 120)))
+
+        written = [v for v, e in results if e == error.NEU_ERR_SUCCESS]
+        assert all(e in (error.NEU_ERR_SUCCESS, error.NEU_ERR_PLUGIN_WRITE_SUPERSEDED)
+                   for _, e in results)
+        assert len(written) > 0
+        time.sleep(1.5)
+        assert api.read_tag(node=node, group='group',
+                            tag=tag['name']) in written
+        api.del_node(node=node)
+
     @description(given="close modbus simulator", when="create modbus node/tag, write and read tag", then="write/read failed")
     def test_write_read_modbus_disconnected(self, param):
         response = api.add_node(node=param[0]+"_3002", plugin=param[1])
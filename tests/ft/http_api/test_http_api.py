@@ -1,4 +1,5 @@
 import copy
+import requests
 
 import neuron.api as api
 import neuron.error as error
@@ -281,6 +282,32 @@ class TestHttp:
             api.del_node(node['name'])
 
 
+    @description(given="running neuron", when="put global config with a group of an unknown driver", then="should fail before touching any node")
+    def test_put_global_config_check(self):
+        response = api.add_node(node='keep', plugin=config.PLUGIN_MODBUS_TCP)
+        assert 200 == response.status_code
+
+        bad_config = {
+            "nodes": [],
+            "groups": [{"driver": "modbus", "group": "group", "interval": 100}],
+            "tags": [],
+            "subscriptions": [],
+            "settings": []
+        }
+        response = api.put_global_config(json=bad_config)
+        assert 404 == response.status_code
+        assert error.NEU_ERR_NODE_NOT_EXIST == response.json()['error']
+        failures = response.json()['failures']
+        assert 1 == len(failures)
+        assert 'group' == failures[0]['type']
+        assert 'modbus' == failures[0]['node']
+        assert error.NEU_ERR_NODE_NOT_EXIST == failures[0]['error']
+
+        response = api.get_nodes(type=config.NEU_NODE_DRIVER)
+        assert 'keep' in [node['name'] for node in response.json()['nodes']]
+        api.del_node('keep')
+
+
     @description(given="running neuron", when="put drivers with too long node name", then="should fail")
     def test_put_drivers_with_long_node_name(self):
         response = api.put_driver(name='long'*100, plugin=driver_1['plugin'], params=driver_1['params'])
@@ -602,6 +629,44 @@ class TestHttp:
         response = api.get_version()
         assert 200 == response.status_code
 
+    @description(given="running neuron", when="get plugin again with the etag", then="not modified")
+    def test_get_plugin_etag(self):
+        response = api.get_plugin()
+        assert 200 == response.status_code
+        etag = response.headers['ETag']
+        assert etag.startswith('W/"')
+
+        response = requests.get(url=config.BASE_URL + '/api/v2/plugin', headers={
+                                "Authorization": config.default_jwt, "If-None-Match": etag})
+        assert 304 == response.status_code
+        assert 0 == len(response.content)
+
+        response = requests.get(url=config.BASE_URL + '/api/v2/plugin', headers={
+                                "Authorization": config.default_jwt, "If-None-Match": 'W/"0"'})
+        assert 200 == response.status_code
+
+    @description(given="running neuron", when="get global metrics after rest requests", then="per endpoint rest stats are reported")
+    def test_get_metrics_rest_stats(self):
+        response = api.get_plugin()
+        assert 200 == response.status_code
+
+        response = api.get_metrics(category="global")
+        assert 200 == response.status_code
+        assert '# TYPE rest_requests_total counter' in response.text
+        assert 'rest_requests_total{method="GET",url="/api/v2/plugin"}' in response.text
+        assert 'rest_inflight_requests{method="GET",url="/api/v2/plugin"} 0' in response.text
+
+    @description(given="running neuron", when="get version on the light queue while the metrics render on the heavy one", then="both answered and the queue wait is reported")
+    def test_get_metrics_rest_queues(self):
+        response = api.get_version()
+        assert 200 == response.status_code
+
+        response = api.get_metrics(category="global")
+        assert 200 == response.status_code
+        assert '# TYPE rest_request_queue_ms_total counter' in response.text
+        assert 'rest_request_queue_ms_total{method="GET",url="/api/v2/version"}' in response.text
+        assert 'rest_inflight_requests{method="GET",url="/api/v2/version"} 0' in response.text
+
     @description(given="running neuron", when="test jwt error", then="failed")
     def test_jwt_err(self):
         response = api.change_password(new_password='123456', jwt='invalid')
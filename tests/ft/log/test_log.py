@@ -4,6 +4,7 @@ import sys
 import neuron.api as api
 from neuron.config import *
 from neuron.common import *
+from neuron.error import *
 
 
 class TestLog:
@@ -125,4 +126,88 @@ class TestLog:
 
         response = api.get_nodes_state(node='')
         assert 200 == response.status_code
-        assert "notice" == response.json()['neuron_core']
\ No newline at end of file
+        assert "notice" == response.json()['neuron_core']
+
+    @description(given="node", when="switch protocol capture on and off", then="a pcap file is returned")
+    def test_log_capture(self):
+        response = api.change_log_capture(json={"node": 'modbus-tcp-1', "enable": True, "packets": 16})
+        assert 0 == response.json()['error']
+
+        response = api.get_log_capture('modbus-tcp-1')
+        assert 200 == response.status_code
+        assert 'application/octet-stream' == response.headers['Content-Type']
+        assert b'\xd4\xc3\xb2\xa1' == response.content[:4]
+
+        response = api.change_log_capture(json={"node": 'modbus-tcp-1', "enable": False})
+        assert 0 == response.json()['error']
+
+        response = api.get_log_capture('modbus-tcp-1')
+        assert 200 == response.status_code
+        assert 24 == len(response.content)
+
+    @description(given="node not exist", when="switch protocol capture on", then="change failed")
+    def test_log_capture_node_not_exist(self):
+        response = api.change_log_capture(json={"node": 'no-such-node', "enable": True})
+        assert 404 == response.status_code
+        assert NEU_ERR_NODE_NOT_EXIST == response.json()['error']
+
+    @description(given="running nodes", when="get thread cpu times", then="threads are labelled with their nodes")
+    def test_profile_threads(self):
+        response = api.get_profile_threads()
+        assert 200 == response.status_code
+        assert response.json()['cpu_ms'] >= 0
+        threads = response.json()['threads']
+        assert any(t['node'] == 'neuron' and t['role'] == 'manager' for t in threads)
+        assert any(t['node'] == 'modbus-tcp-1' and t['role'] == 'adapter' for t in threads)
+
+    @description(given="running nodes", when="sample a profile", then="folded stacks are returned")
+    def test_profile(self):
+        response = api.get_profile(params={"seconds": 1, "hz": 199})
+        assert 200 == response.status_code
+        assert 'application/octet-stream' == response.headers['Content-Type']
+        for line in response.text.splitlines():
+            stack, count = line.rsplit(' ', 1)
+            assert len(stack) > 0
+            assert int(count) > 0
+
+    @description(given="profile params out of range", when="sample a profile", then="sampling failed")
+    def test_profile_invalid(self):
+        response = api.get_profile(params={"seconds": 0})
+        assert 400 == response.status_code
+        assert NEU_ERR_PARAM_IS_WRONG == response.json()['error']
+
+        response = api.get_profile(params={"hz": 100000})
+        assert 400 == response.status_code
+        assert NEU_ERR_PARAM_IS_WRONG == response.json()['error']
+
+    @description(given="core log files", when="stream them with filters", then="only matching lines are returned")
+    def test_log_stream(self):
+        response = api.get_log_stream()
+        assert 200 == response.status_code
+        assert response.headers['Content-Type'].startswith('text/plain')
+        assert len(response.text) > 0
+
+        response = api.get_log_stream(params={"level": "notice", "match": "req"})
+        assert 200 == response.status_code
+        for line in response.text.splitlines():
+            if line[:4].isdigit():
+                assert 'req' in line
+                assert line.split(' ')[2] not in ('[DEBUG]', '[INFO]')
+
+        response = api.get_log_stream(params={"since": 1, "until": 2})
+        assert 200 == response.status_code
+        assert 0 == len(response.content)
+
+    @description(given="log stream params out of range", when="stream logs", then="streaming failed")
+    def test_log_stream_invalid(self):
+        response = api.get_log_stream(params={"level": "verbose"})
+        assert 400 == response.status_code
+        assert NEU_ERR_PARAM_IS_WRONG == response.json()['error']
+
+        response = api.get_log_stream(params={"follow": 100000})
+        assert 400 == response.status_code
+        assert NEU_ERR_PARAM_IS_WRONG == response.json()['error']
+
+        response = api.get_log_stream(params={"node": "no-such-node"})
+        assert 404 == response.status_code
+        assert NEU_ERR_FILE_NOT_EXIST == response.json()['error']
@@ -77,7 +77,11 @@ class TestMetrics:
             "north_disconnected_nodes_total": [],
             "south_nodes_total": [],
             "south_running_nodes_total": [],
-            "south_disconnected_nodes_total": []
+            "south_disconnected_nodes_total": [],
+            "mem_budget_bytes": [],
+            "mem_accounted_bytes": [],
+            "reconnects_deferred": [],
+            "log_dropped_lines": []
         }
 
         assert_global_metrics(resp.content.decode('utf-8'), expected_metrics)
@@ -148,7 +152,49 @@ class TestMetrics:
             "group_last_error_code": (0, {"group": "group", "node": "modbus"}),
             "group_last_error_timestamp_ms": (0, {"group": "group", "node": "modbus"}),
             "group_last_send_msgs": (0, {"group": "group", "node": "modbus"}),
-            "group_last_timer_ms": (0, {"group": "group", "node": "modbus"})
+            "group_last_timer_ms": (0, {"group": "group", "node": "modbus"}),
+            "group_devices_offline": (0, {"group": "group", "node": "modbus"}),
+            "group_overruns_total": (0, {"group": "group", "node": "modbus"}),
+            "group_last_lag_ms": (0, {"group": "group", "node": "modbus"}),
+            "group_skipped_total": (0, {"group": "group", "node": "modbus"}),
+            "group_load_percent": (0, {"group": "group", "node": "modbus"}),
+            "group_effective_interval_ms": (100, {"group": "group", "node": "modbus"})
         }
 
-        assert_metrics(resp.content.decode('utf-8'), expected_metrics)
\ No newline at end of file
+        assert_metrics(resp.content.decode('utf-8'), expected_metrics)
+
+    @description(given="a driver node with tags and an app node",
+                 when="get the metrics of the nodes",
+                 then="each node reports its cpu time and memory estimate")
+    def test_node_cpu_mem(self):
+        response = api.add_node(node='modbus-res', plugin=PLUGIN_MODBUS_TCP)
+        assert 200 == response.status_code
+        response = api.add_node(node='mqtt-res', plugin=PLUGIN_MQTT)
+        assert 200 == response.status_code
+
+        resp = api.get_metrics(category="driver", node='modbus-res')
+        assert 200 == resp.status_code
+        content = resp.content.decode('utf-8')
+        assert get_metric_value(content, "cpu_ms_total") >= 0
+        mem_bytes = get_metric_value(content, "mem_bytes")
+        assert mem_bytes > 0
+
+        response = api.add_group(node='modbus-res', group='group')
+        assert 200 == response.status_code
+        tags = [{"name": f"tag{i}", "address": f"1!400{i:02d}",
+                 "attribute": NEU_TAG_ATTRIBUTE_READ,
+                 "type": NEU_TYPE_INT16} for i in range(1, 11)]
+        response = api.add_tags(node='modbus-res', group='group', tags=tags)
+        assert 200 == response.status_code
+
+        resp = api.get_metrics(category="driver", node='modbus-res')
+        assert 200 == resp.status_code
+        content = resp.content.decode('utf-8')
+        assert get_metric_value(content, "tags_total") == 10
+        assert get_metric_value(content, "mem_bytes") > mem_bytes
+
+        resp = api.get_metrics(category="app", node='mqtt-res')
+        assert 200 == resp.status_code
+        content = resp.content.decode('utf-8')
+        assert get_metric_value(content, "cpu_ms_total") >= 0
+        assert get_metric_value(content, "mem_bytes") > 0
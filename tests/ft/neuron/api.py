@@ -57,6 +57,27 @@ def change_log_level(json, jwt=config.default_jwt):
     return requests.put(url=config.BASE_URL + '/api/v2/log/level', headers={"Authorization": jwt}, json=json)
 
 
+@gen_check
+def change_log_capture(json, jwt=config.default_jwt):
+    return requests.put(url=config.BASE_URL + '/api/v2/log/capture', headers={"Authorization": jwt}, json=json)
+
+
+def get_log_capture(node, jwt=config.default_jwt):
+    return requests.get(url=config.BASE_URL + '/api/v2/log/capture', headers={"Authorization": jwt}, params={"node": node})
+
+
+def get_profile(params=None, jwt=config.default_jwt):
+    return requests.get(url=config.BASE_URL + '/api/v2/profile', headers={"Authorization": jwt}, params=params)
+
+
+def get_log_stream(params=None, jwt=config.default_jwt):
+    return requests.get(url=config.BASE_URL + '/api/v2/log/stream', headers={"Authorization": jwt}, params=params)
+
+
+def get_profile_threads(jwt=config.default_jwt):
+    return requests.get(url=config.BASE_URL + '/api/v2/profile/threads', headers={"Authorization": jwt})
+
+
 @gen_check
 def add_node(node, plugin, params=None, jwt=config.default_jwt):
     body = {"name": node, "plugin": plugin}
@@ -134,6 +155,11 @@ def add_gtags(node, groups):
     return requests.post(url=config.BASE_URL + '/api/v2/gtags', headers={"Authorization": config.default_jwt}, json={"node": node, "groups": groups})
 
 
+@gen_check
+def apply_gtags(node, groups):
+    return requests.put(url=config.BASE_URL + '/api/v2/gtags', headers={"Authorization": config.default_jwt}, json={"node": node, "groups": groups})
+
+
 @gen_check
 def del_tags(node, group, tags):
     return requests.delete(url=config.BASE_URL + '/api/v2/tags', headers={"Authorization": config.default_jwt}, json={"node": node, "group": group, "tags": tags})
@@ -144,17 +170,44 @@ def update_tags(node, group, tags):
     return requests.put(url=config.BASE_URL + '/api/v2/tags', headers={"Authorization": config.default_jwt}, json={"node": node, "group": group, "tags": tags})
 
 
-def get_tags(node, group):
-    return requests.get(url=config.BASE_URL + "/api/v2/tags", headers={"Authorization": config.default_jwt}, params={"node": node, "group": group})
+def export_gtags(node):
+    return requests.get(url=config.BASE_URL + "/api/v2/gtags/export", headers={"Authorization": config.default_jwt}, params={"node": node}, stream=True)
 
 
-def read_tags(node, group, sync=False, query=None):
+def import_gtags(node, lines):
+    return requests.post(url=config.BASE_URL + "/api/v2/gtags/import", headers={"Authorization": config.default_jwt}, params={"node": node}, data="\n".join(lines))
+
+
+def get_tags(node, group, **query):
+    return requests.get(url=config.BASE_URL + "/api/v2/tags", headers={"Authorization": config.default_jwt}, params={"node": node, "group": group, **query})
+
+
+def get_tag_history(node, group, tag, **query):
+    return requests.get(url=config.BASE_URL + "/api/v2/tags/history", headers={"Authorization": config.default_jwt}, params={"node": node, "group": group, "tag": tag, **query})
+
+
+def get_group_profile(node, group=None):
+    params = {"node": node} if group is None else {"node": node, "group": group}
+    return requests.get(url=config.BASE_URL + "/api/v2/group/profile", headers={"Authorization": config.default_jwt}, params=params)
+
+
+def read_tags(node, group, sync=False, query=None, max_age=None):
     body = {"node": node, "group": group, "sync": sync}
     if query:
         body["query"] = query
+    if max_age is not None:
+        body["max_age"] = max_age
     return requests.post(url=config.BASE_URL + "/api/v2/read", headers={"Authorization": config.default_jwt}, json=body)
 
 
+def read_tags_batch(groups, sync=False):
+    return requests.post(url=config.BASE_URL + "/api/v2/read/batch", headers={"Authorization": config.default_jwt}, json={"groups": groups, "sync": sync})
+
+
+def sse_subscribe(node, group):
+    return requests.get(url=config.BASE_URL + "/api/v2/sse/subscribe", headers={"Authorization": config.default_jwt}, params={"node": node, "group": group}, stream=True, timeout=5)
+
+
 def read_tag(node, group, tag, sync=False):
     response = read_tags(node, group, sync, query={"name": tag})
     assert 200 == response.status_code
@@ -198,8 +251,13 @@ def read_tag_err(node, group, tag, sync=False):
 
 
 @gen_check
-def write_tag(node, group, tag, value):
-    return requests.post(url=config.BASE_URL + "/api/v2/write", headers={"Authorization": config.default_jwt}, json={"node": node, "group": group, "tag": tag, "value": value})
+def write_tag(node, group, tag, value, preempt=None, verify=None):
+    body = {"node": node, "group": group, "tag": tag, "value": value}
+    if preempt is not None:
+        body["preempt"] = preempt
+    if verify is not None:
+        body["verify"] = verify
+    return requests.post(url=config.BASE_URL + "/api/v2/write", headers={"Authorization": config.default_jwt}, json=body)
 
 
 @gen_check
@@ -211,6 +269,10 @@ def write_gtags(json):
     return requests.post(url=config.BASE_URL + "/api/v2/write/gtags", headers={"Authorization": config.default_jwt}, json=json)
 
 
+def write_batch(json):
+    return requests.post(url=config.BASE_URL + "/api/v2/write/batch", headers={"Authorization": config.default_jwt}, json=json)
+
+
 def add_plugin(library_name, so_file, schema_file):
     return requests.post(url=config.BASE_URL + "/api/v2/plugin", json={"library": library_name, "so_file": so_file, "schema_file": schema_file}, headers={"Authorization": config.default_jwt})
 
@@ -306,16 +368,22 @@ def prgfile_process(driver):
 # plugin setting
 
 
-def modbus_tcp_node_setting(node, port, connection_mode=0, transport_mode=0, interval=0, host='127.0.0.1', timeout=3000, max_retries=2):
-    return node_setting(node, json={"connection_mode": connection_mode, "transport_mode": transport_mode, "interval": interval,
-                                    "host": host, "port": port, "timeout": timeout, "max_retries": max_retries})
+def modbus_tcp_node_setting(node, port, connection_mode=0, transport_mode=0, interval=0, host='127.0.0.1', timeout=3000, max_retries=2, connection_share=None):
+    params = {"connection_mode": connection_mode, "transport_mode": transport_mode, "interval": interval,
+              "host": host, "port": port, "timeout": timeout, "max_retries": max_retries}
+    if connection_share is not None:
+        params["connection_share"] = connection_share
+    return node_setting(node, json=params)
 
 
-def modbus_rtu_node_setting(node, port=502, connection_mode=0, transport_mode=0, interval=0, host='127.0.0.1', timeout=3000, max_retries=2, link=1, device="", stop=0, parity=0, baud=4, data=3):
-    return node_setting(node, json={"connection_mode": connection_mode, "transport_mode": transport_mode,
-                                    "interval": interval, "host": host, "port": port, "timeout": timeout,
-                                    "max_retries": max_retries, "link": link, "device": device, "stop": stop,
-                                    "parity": parity, "baud": baud, "data": data})
+def modbus_rtu_node_setting(node, port=502, connection_mode=0, transport_mode=0, interval=0, host='127.0.0.1', timeout=3000, max_retries=2, link=1, device="", stop=0, parity=0, baud=4, data=3, connection_share=None):
+    params = {"connection_mode": connection_mode, "transport_mode": transport_mode,
+              "interval": interval, "host": host, "port": port, "timeout": timeout,
+              "max_retries": max_retries, "link": link, "device": device, "stop": stop,
+              "parity": parity, "baud": baud, "data": data}
+    if connection_share is not None:
+        params["connection_share"] = connection_share
+    return node_setting(node, json=params)
 
 
 def mqtt_node_setting(node):
@@ -19,6 +19,7 @@ NEU_TAG_ATTRIBUTE_READ = 1
 NEU_TAG_ATTRIBUTE_WRITE = 2
 NEU_TAG_ATTRIBUTE_SUBSCRIBE = 4
 NEU_TAG_ATTRIBUTE_STATIC = 8
+NEU_TAG_ATTRIBUTE_COALESCE = 16
 NEU_TAG_ATTRIBUTE_RW = NEU_TAG_ATTRIBUTE_READ | NEU_TAG_ATTRIBUTE_WRITE
 NEU_TAG_ATTRIBUTE_RW_STATIC = NEU_TAG_ATTRIBUTE_RW | NEU_TAG_ATTRIBUTE_STATIC
 NEU_TAG_ATTRIBUTE_RW_SUBSCRIBE = NEU_TAG_ATTRIBUTE_RW | NEU_TAG_ATTRIBUTE_SUBSCRIBE
@@ -304,7 +304,7 @@ class TestPlugin:
         assert 200 == response.status_code
         assert NEU_ERR_SUCCESS == response.json().get("error")
 
-    @description(given="correct configuration", when="update plugin", then="success")
+    @description(given="plugin in use", when="update plugin", then="success")
     def test_14_update_plugin_success1(self):
         test_data = TestPlugin.test_data
         plugin_data = {}
@@ -314,8 +314,12 @@ class TestPlugin:
 
         response = api.updata_plugin(
             library_name=plugin_data['library'], so_file=plugin_data['so_file'], schema_file=plugin_data['schema_file'])
-        assert 409 == response.status_code
-        assert NEU_ERR_LIBRARY_IN_USE == response.json().get("error")
+        assert 200 == response.status_code
+        assert NEU_ERR_SUCCESS == response.json().get("error")
+
+        # the node keeps running on the new build instead of being restarted
+        response = api.get_nodes_state('c1-a')
+        assert 200 == response.status_code
 
     @description(given="correct configuration", when="del plugin", then="fail")
     def test_15_del_plugin_fail0(self):
@@ -486,4 +486,145 @@ class TestLog:
                             "type": 3,
                             "decimal": 0.01}]}])
         assert 400 == response.status_code
-        assert NEU_ERR_TAG_NAME_TOO_LONG == response.json()['error']
\ No newline at end of file
+        assert NEU_ERR_TAG_NAME_TOO_LONG == response.json()['error']
+
+    @description(given="a group with tags", when="applying a changed tag list", then="only the difference is applied")
+    def test_applying_gtags(self):
+        response = api.add_gtags(
+            node='modbus-tcp-tag-test',
+            groups=[{"group": "apply", "interval": 3000,
+                     "tags": [{"name": "a", "address": "1!400001", "attribute": 3, "type": 3},
+                              {"name": "b", "address": "1!400002", "attribute": 3, "type": 3},
+                              {"name": "c", "address": "1!400003", "attribute": 3, "type": 3}]}])
+        assert 200 == response.status_code
+        assert NEU_ERR_SUCCESS == response.json()['error']
+
+        response = api.apply_gtags(
+            node='modbus-tcp-tag-test',
+            groups=[{"group": "apply", "interval": 2000,
+                     "tags": [{"name": "a", "address": "1!400001", "attribute": 3, "type": 3},
+                              {"name": "b", "address": "1!400012", "attribute": 3, "type": 3},
+                              {"name": "d", "address": "1!400004", "attribute": 3, "type": 3}]}])
+        assert 200 == response.status_code
+        assert NEU_ERR_SUCCESS == response.json()['error']
+
+        response = api.get_tags(node='modbus-tcp-tag-test', group='apply')
+        assert 200 == response.status_code
+        tags = {tag['name']: tag['address'] for tag in response.json()['tags']}
+        assert {"a": "1!400001", "b": "1!400012", "d": "1!400004"} == tags
+
+        response = api.get_group()
+        assert 200 == response.status_code
+        groups = [group for group in response.json()['groups']
+                  if group['driver'] == 'modbus-tcp-tag-test' and group['group'] == 'apply']
+        assert 1 == len(groups)
+        assert 2000 == groups[0]['interval']
+
+    @description(given="an applied request with duplicate tags", when="applying", then="nothing is changed")
+    def test_applying_gtags_conflict(self):
+        response = api.apply_gtags(
+            node='modbus-tcp-tag-test',
+            groups=[{"group": "apply", "interval": 2000,
+                     "tags": [{"name": "e", "address": "1!400005", "attribute": 3, "type": 3},
+                              {"name": "e", "address": "1!400006", "attribute": 3, "type": 3}]}])
+        assert 409 == response.status_code
+        assert NEU_ERR_TAG_NAME_CONFLICT == response.json()['error']
+
+        response = api.get_tags(node='modbus-tcp-tag-test', group='apply')
+        assert 200 == response.status_code
+        assert ["a", "b", "d"] == sorted(tag['name'] for tag in response.json()['tags'])
+
+    @description(given="a group with many tags", when="listing pages with filters", then="only the page is returned with the total")
+    def test_get_tags_page(self):
+        tags = [{"name": "p%02d" % i, "address": "1!4%05d" % (i + 1), "attribute": 1 if i % 2 else 3,
+                 "type": 3} for i in range(20)]
+        response = api.add_gtags(node='modbus-tcp-tag-test',
+                                 groups=[{"group": "page", "interval": 3000, "tags": tags}])
+        assert 200 == response.status_code
+        assert NEU_ERR_SUCCESS == response.json()['error']
+
+        response = api.get_tags(node='modbus-tcp-tag-test', group='page')
+        assert 200 == response.status_code
+        names = [tag['name'] for tag in response.json()['tags']]
+        assert 20 == len(names)
+        assert 20 == response.json()['total']
+
+        response = api.get_tags(node='modbus-tcp-tag-test', group='page', offset=5, limit=5)
+        assert 200 == response.status_code
+        assert names[5:10] == [tag['name'] for tag in response.json()['tags']]
+        assert 20 == response.json()['total']
+
+        response = api.get_tags(node='modbus-tcp-tag-test', group='page', after=names[9], limit=5)
+        assert 200 == response.status_code
+        assert names[10:15] == [tag['name'] for tag in response.json()['tags']]
+
+        response = api.get_tags(node='modbus-tcp-tag-test', group='page', attribute=2, limit=3)
+        assert 200 == response.status_code
+        assert 3 == len(response.json()['tags'])
+        assert 10 == response.json()['total']
+
+        response = api.get_tags(node='modbus-tcp-tag-test', group='page', after='missing')
+        assert 404 == response.status_code
+        assert NEU_ERR_TAG_NOT_EXIST == response.json()['error']
+
+        response = api.get_tags(node='modbus-tcp-tag-test', group='page', limit='x')
+        assert 400 == response.status_code
+        assert NEU_ERR_PARAM_IS_WRONG == response.json()['error']
+
+    @description(given="neuron started without a history size", when="querying the history of a tag", then="the query is refused")
+    def test_get_tag_history_disabled(self):
+        response = api.get_tag_history(node='modbus-tcp-tag-test', group='page', tag='p00')
+        assert 409 == response.status_code
+        assert NEU_ERR_TAG_HISTORY_DISABLED == response.json()['error']
+
+        response = api.get_tag_history(node='modbus-tcp-tag-test', group='page', tag='p00', since=2000, until=1000)
+        assert 400 == response.status_code
+        assert NEU_ERR_PARAM_IS_WRONG == response.json()['error']
+
+        response = api.get_tag_history(node='modbus-tcp-tag-test', group='page', tag='p00', limit=100000)
+        assert 400 == response.status_code
+        assert NEU_ERR_PARAM_IS_WRONG == response.json()['error']
+
+    @description(given="neuron started without a profile interval", when="querying the profile of a group", then="the group has no reads nor advices")
+    def test_get_group_profile_empty(self):
+        response = api.get_group_profile(node='modbus-tcp-tag-test', group='page')
+        assert 200 == response.status_code
+        groups = response.json()['groups']
+        assert 1 == len(groups)
+        assert 'page' == groups[0]['group']
+        assert 0 == groups[0]['reads']
+        assert [] == groups[0]['advices']
+
+        response = api.get_group_profile(node='modbus-tcp-tag-test')
+        assert 200 == response.status_code
+        assert 'page' in [g['group'] for g in response.json()['groups']]
+
+        response = api.get_group_profile(node='modbus-tcp-tag-test', group='missing')
+        assert 404 == response.status_code
+        assert NEU_ERR_GROUP_NOT_EXIST == response.json()['error']
+
+    @description(given="tags computed from other tags of the group", when="adding", then="only readable numbers with a valid expression are added")
+    def test_adding_computed_tags(self):
+        tags = [{"name": "c_hi", "address": "1!400020", "attribute": 1, "type": 4},
+                {"name": "c_lo", "address": "1!400021", "attribute": 1, "type": 4},
+                {"name": "c_sum", "address": "=c_hi << 16 | c_lo", "attribute": 1, "type": 6},
+                {"name": "c_flag", "address": "=bit(c_lo, 3)", "attribute": 1, "type": 11}]
+        response = api.add_gtags(node='modbus-tcp-tag-test',
+                                 groups=[{"group": "computed", "interval": 1000, "tags": tags}])
+        assert 200 == response.status_code
+        assert NEU_ERR_SUCCESS == response.json()['error']
+
+        response = api.add_tags(node='modbus-tcp-tag-test', group='computed',
+                                tags=[{"name": "c_bad", "address": "=c_hi +", "attribute": 1, "type": 6}])
+        assert 400 == response.status_code
+        assert NEU_ERR_TAG_ADDRESS_FORMAT_INVALID == response.json()['error']
+
+        response = api.add_tags(node='modbus-tcp-tag-test', group='computed',
+                                tags=[{"name": "c_rw", "address": "=c_hi * 2", "attribute": 3, "type": 6}])
+        assert 400 == response.status_code
+        assert NEU_ERR_TAG_ATTRIBUTE_NOT_SUPPORT == response.json()['error']
+
+        response = api.add_tags(node='modbus-tcp-tag-test', group='computed',
+                                tags=[{"name": "c_str", "address": "=c_hi", "attribute": 1, "type": 13}])
+        assert 400 == response.status_code
+        assert NEU_ERR_TAG_TYPE_NOT_SUPPORT == response.json()['error']
@@ -0,0 +1,233 @@
+/**
+ * NEURON IIoT System for Industry 4.0
+ * Copyright (C) 2020-2023 EMQ Technologies Co., Ltd All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ **/
+
+/*
+ * Null north app of the throughput benchmark, see tests/ft/bench. Counts the
+ * tags it receives and the latency from the sample time of the int64 and
+ * uint64 tags of bench-driver, exported as node metrics.
+ */
+
+#include <stdlib.h>
+
+#include <neuron.h>
+
+#include "errcodes.h"
+
+#define BENCH_METRIC_TAGS_TOTAL "bench_tags_total"
+#define BENCH_METRIC_TAGS_TOTAL_TYPE NEU_METRIC_TYPE_COUNTER
+#define BENCH_METRIC_TAGS_TOTAL_HELP "Number of tag values received"
+
+#define BENCH_METRIC_LATENCY_P50_MS "bench_latency_p50_ms"
+#define BENCH_METRIC_LATENCY_P50_MS_TYPE NEU_METRIC_TYPE_GAUAGE
+#define BENCH_METRIC_LATENCY_P50_MS_HELP \
+    "Median latency in milliseconds from sample to app"
+
+#define BENCH_METRIC_LATENCY_P99_MS "bench_latency_p99_ms"
+#define BENCH_METRIC_LATENCY_P99_MS_TYPE NEU_METRIC_TYPE_GAUAGE
+#define BENCH_METRIC_LATENCY_P99_MS_HELP \
+    "99th percentile latency in milliseconds from sample to app"
+
+#define BENCH_METRIC_LATENCY_P999_MS "bench_latency_p999_ms"
+#define BENCH_METRIC_LATENCY_P999_MS_TYPE NEU_METRIC_TYPE_GAUAGE
+#define BENCH_METRIC_LATENCY_P999_MS_HELP \
+    "99.9th percentile latency in milliseconds from sample to app"
+
+#define BENCH_METRIC_LATENCY_MAX_MS "bench_latency_max_ms"
+#define BENCH_METRIC_LATENCY_MAX_MS_TYPE NEU_METRIC_TYPE_GAUAGE
+#define BENCH_METRIC_LATENCY_MAX_MS_HELP \
+    "Maximum latency in milliseconds from sample to app"
+
+// one bucket per ms, the last one takes everything slower
+#define BENCH_LATENCY_BUCKETS 10001
+// how often the percentiles are worked out of the buckets
+#define BENCH_PUBLISH_MS 1000
+
+struct neu_plugin {
+    neu_plugin_common_t common;
+
+    uint64_t n_sample;
+    uint64_t max;
+    int64_t  published;
+    uint32_t buckets[BENCH_LATENCY_BUCKETS];
+};
+
+static neu_plugin_t *app_open(void)
+{
+    neu_plugin_t *plugin = calloc(1, sizeof(neu_plugin_t));
+
+    neu_plugin_common_init(&plugin->common);
+
+    return plugin;
+}
+
+static int app_close(neu_plugin_t *plugin)
+{
+    free(plugin);
+
+    return 0;
+}
+
+static int app_init(neu_plugin_t *plugin, bool load)
+{
+    (void) load;
+
+    NEU_PLUGIN_REGISTER_METRIC(plugin, BENCH_METRIC_TAGS_TOTAL, 0);
+    NEU_PLUGIN_REGISTER_METRIC(plugin, BENCH_METRIC_LATENCY_P50_MS, 0);
+    NEU_PLUGIN_REGISTER_METRIC(plugin, BENCH_METRIC_LATENCY_P99_MS, 0);
+    NEU_PLUGIN_REGISTER_METRIC(plugin, BENCH_METRIC_LATENCY_P999_MS, 0);
+    NEU_PLUGIN_REGISTER_METRIC(plugin, BENCH_METRIC_LATENCY_MAX_MS, 0);
+
+    return 0;
+}
+
+static int app_uninit(neu_plugin_t *plugin)
+{
+    (void) plugin;
+    return 0;
+}
+
+static int app_start(neu_plugin_t *plugin)
+{
+    plugin->common.link_state = NEU_NODE_LINK_STATE_CONNECTED;
+    return 0;
+}
+
+static int app_stop(neu_plugin_t *plugin)
+{
+    plugin->common.link_state = NEU_NODE_LINK_STATE_DISCONNECTED;
+    return 0;
+}
+
+static int app_config(neu_plugin_t *plugin, const char *config)
+{
+    (void) plugin;
+    (void) config;
+    return 0;
+}
+
+static uint64_t percentile(neu_plugin_t *plugin, uint64_t per_mille)
+{
+    uint64_t rank = plugin->n_sample * per_mille / 1000;
+    uint64_t seen = 0;
+
+    for (uint32_t i = 0; i < BENCH_LATENCY_BUCKETS; i++) {
+        seen += plugin->buckets[i];
+        if (seen > rank) {
+            return i;
+        }
+    }
+
+    return BENCH_LATENCY_BUCKETS - 1;
+}
+
+static void publish(neu_plugin_t *plugin, int64_t now)
+{
+    plugin->published = now;
+    if (plugin->n_sample == 0) {
+        return;
+    }
+
+    NEU_PLUGIN_UPDATE_METRIC(plugin, BENCH_METRIC_LATENCY_P50_MS,
+                             percentile(plugin, 500), NULL);
+    NEU_PLUGIN_UPDATE_METRIC(plugin, BENCH_METRIC_LATENCY_P99_MS,
+                             percentile(plugin, 990), NULL);
+    NEU_PLUGIN_UPDATE_METRIC(plugin, BENCH_METRIC_LATENCY_P999_MS,
+                             percentile(plugin, 999), NULL);
+    NEU_PLUGIN_UPDATE_METRIC(plugin, BENCH_METRIC_LATENCY_MAX_MS, plugin->max,
+                             NULL);
+}
+
+static void trans_data(neu_plugin_t *plugin, neu_reqresp_trans_data_t *data)
+{
+    int64_t now = neu_time_ms();
+
+    utarray_foreach(data->tags, neu_resp_tag_value_meta_t *, tag)
+    {
+        int64_t sampled = 0;
+
+        if (tag->value.type == NEU_TYPE_INT64) {
+            sampled = tag->value.value.i64;
+        } else if (tag->value.type == NEU_TYPE_UINT64) {
+            sampled = (int64_t) tag->value.value.u64;
+        } else {
+            continue;
+        }
+
+        uint64_t latency = now > sampled ? now - sampled : 0;
+        if (latency > plugin->max) {
+            plugin->max = latency;
+        }
+        if (latency >= BENCH_LATENCY_BUCKETS) {
+            latency = BENCH_LATENCY_BUCKETS - 1;
+        }
+        plugin->buckets[latency] += 1;
+        plugin->n_sample += 1;
+    }
+
+    NEU_PLUGIN_UPDATE_METRIC(plugin, BENCH_METRIC_TAGS_TOTAL,
+                             utarray_len(data->tags), NULL);
+
+    if (now - plugin->published >= BENCH_PUBLISH_MS) {
+        publish(plugin, now);
+    }
+}
+
+static int app_request(neu_plugin_t *plugin, neu_reqresp_head_t *head,
+                       void *data)
+{
+    switch (head->type) {
+    case NEU_REQRESP_TRANS_DATA:
+        trans_data(plugin, (neu_reqresp_trans_data_t *) data);
+        break;
+    case NEU_REQ_SUBSCRIBE_GROUP:
+    case NEU_REQ_UPDATE_SUBSCRIBE_GROUP: {
+        neu_req_subscribe_t *sub_info = data;
+        free(sub_info->params);
+        break;
+    }
+    default:
+        break;
+    }
+
+    return 0;
+}
+
+static const neu_plugin_intf_funs_t plugin_intf_funs = {
+    .open    = app_open,
+    .close   = app_close,
+    .init    = app_init,
+    .uninit  = app_uninit,
+    .start   = app_start,
+    .stop    = app_stop,
+    .setting = app_config,
+    .request = app_request,
+};
+
+const neu_plugin_module_t neu_plugin_module = {
+    .version         = NEURON_PLUGIN_VER_1_0,
+    .schema          = "bench-app",
+    .module_name     = "bench-app",
+    .module_descr    = "null app of the throughput benchmark",
+    .module_descr_zh = "null app of the throughput benchmark",
+    .intf_funs       = &plugin_intf_funs,
+    .kind            = NEU_PLUGIN_KIND_CUSTOM,
+    .type            = NEU_NA_TYPE_APP,
+    .display         = true,
+    .single          = false,
+};
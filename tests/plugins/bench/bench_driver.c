@@ -0,0 +1,256 @@
+/**
+ * NEURON IIoT System for Industry 4.0
+ * Copyright (C) 2020-2023 EMQ Technologies Co., Ltd All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ **/
+
+/*
+ * Synthetic driver of the throughput benchmark, see tests/ft/bench. Every
+ * group read produces a value for each of its tags without any device:
+ * int64 and uint64 tags carry the time in ms they were sampled at, the others
+ * a counter, so the bench app can tell end to end latency.
+ */
+
+#include <stdlib.h>
+
+#include <neuron.h>
+
+#include "errcodes.h"
+
+struct neu_plugin {
+    neu_plugin_common_t common;
+    uint64_t            seq;
+};
+
+// the tag names and values of a group, reused by every read
+typedef struct {
+    uint32_t      n_tag;
+    const char ** names;
+    neu_dvalue_t *values;
+} bench_group_t;
+
+static neu_plugin_t *driver_open(void)
+{
+    neu_plugin_t *plugin = calloc(1, sizeof(neu_plugin_t));
+
+    neu_plugin_common_init(&plugin->common);
+
+    return plugin;
+}
+
+static int driver_close(neu_plugin_t *plugin)
+{
+    free(plugin);
+
+    return 0;
+}
+
+static int driver_init(neu_plugin_t *plugin, bool load)
+{
+    (void) load;
+    (void) plugin;
+
+    return 0;
+}
+
+static int driver_uninit(neu_plugin_t *plugin)
+{
+    (void) plugin;
+    return 0;
+}
+
+static int driver_start(neu_plugin_t *plugin)
+{
+    plugin->common.link_state = NEU_NODE_LINK_STATE_CONNECTED;
+    return 0;
+}
+
+static int driver_stop(neu_plugin_t *plugin)
+{
+    plugin->common.link_state = NEU_NODE_LINK_STATE_DISCONNECTED;
+    return 0;
+}
+
+static int driver_config(neu_plugin_t *plugin, const char *config)
+{
+    (void) plugin;
+    (void) config;
+    return 0;
+}
+
+static int driver_request(neu_plugin_t *plugin, neu_reqresp_head_t *head,
+                          void *data)
+{
+    (void) plugin;
+    (void) head;
+    (void) data;
+    return 0;
+}
+
+static int driver_tag_validator(const neu_datatag_t *tag)
+{
+    (void) tag;
+    return 0;
+}
+
+static int driver_validate_tag(neu_plugin_t *plugin, neu_datatag_t *tag)
+{
+    (void) plugin;
+    (void) tag;
+    return 0;
+}
+
+static void bench_group_free(neu_plugin_group_t *pgp)
+{
+    bench_group_t *bg = (bench_group_t *) pgp->user_data;
+
+    free(bg->names);
+    free(bg->values);
+    free(bg);
+    pgp->user_data = NULL;
+}
+
+static bench_group_t *bench_group_new(neu_plugin_group_t *group)
+{
+    bench_group_t *bg = calloc(1, sizeof(bench_group_t));
+    uint32_t       i  = 0;
+
+    bg->n_tag  = utarray_len(group->tags);
+    bg->names  = calloc(bg->n_tag, sizeof(char *));
+    bg->values = calloc(bg->n_tag, sizeof(neu_dvalue_t));
+
+    utarray_foreach(group->tags, neu_datatag_t *, tag)
+    {
+        bg->names[i]            = tag->name;
+        bg->values[i].type      = tag->type;
+        bg->values[i].precision = tag->precision;
+        i += 1;
+    }
+
+    return bg;
+}
+
+static void bench_value(neu_dvalue_t *value, int64_t now, uint64_t seq)
+{
+    switch (value->type) {
+    case NEU_TYPE_INT64:
+        value->value.i64 = now;
+        break;
+    case NEU_TYPE_UINT64:
+        value->value.u64 = now;
+        break;
+    case NEU_TYPE_INT8:
+    case NEU_TYPE_UINT8:
+        value->value.u8 = (uint8_t) seq;
+        break;
+    case NEU_TYPE_INT16:
+    case NEU_TYPE_UINT16:
+        value->value.u16 = (uint16_t) seq;
+        break;
+    case NEU_TYPE_INT32:
+    case NEU_TYPE_UINT32:
+        value->value.u32 = (uint32_t) seq;
+        break;
+    case NEU_TYPE_FLOAT:
+        value->value.f32 = (float) (seq % 100000);
+        break;
+    case NEU_TYPE_DOUBLE:
+        value->value.d64 = (double) seq;
+        break;
+    case NEU_TYPE_BIT:
+    case NEU_TYPE_BOOL:
+        value->value.u8 = seq & 1;
+        break;
+    default:
+        value->type      = NEU_TYPE_ERROR;
+        value->value.i32 = NEU_ERR_PLUGIN_TAG_TYPE_MISMATCH;
+        break;
+    }
+}
+
+static int driver_group_timer(neu_plugin_t *plugin, neu_plugin_group_t *group)
+{
+    bench_group_t *bg  = (bench_group_t *) group->user_data;
+    int64_t        now = neu_time_ms();
+
+    if (bg == NULL) {
+        bg                = bench_group_new(group);
+        group->user_data  = bg;
+        group->group_free = bench_group_free;
+    }
+
+    plugin->seq += 1;
+    for (uint32_t i = 0; i < bg->n_tag; i++) {
+        bench_value(&bg->values[i], now, plugin->seq);
+    }
+
+    plugin->common.adapter_callbacks->driver.update_batch(
+        plugin->common.adapter, group->group_name, bg->n_tag, bg->names,
+        bg->values);
+
+    return 0;
+}
+
+static int driver_write(neu_plugin_t *plugin, void *req, neu_datatag_t *tag,
+                        neu_value_u value)
+{
+    (void) tag;
+    (void) value;
+    plugin->common.adapter_callbacks->driver.write_response(
+        plugin->common.adapter, req, NEU_ERR_SUCCESS);
+    return 0;
+}
+
+static int driver_write_tags(neu_plugin_t *plugin, void *req, UT_array *tags)
+{
+    (void) tags;
+    plugin->common.adapter_callbacks->driver.write_response(
+        plugin->common.adapter, req, NEU_ERR_SUCCESS);
+    return 0;
+}
+
+static const neu_plugin_intf_funs_t plugin_intf_funs = {
+    .open    = driver_open,
+    .close   = driver_close,
+    .init    = driver_init,
+    .uninit  = driver_uninit,
+    .start   = driver_start,
+    .stop    = driver_stop,
+    .setting = driver_config,
+    .request = driver_request,
+
+    .driver.validate_tag  = driver_validate_tag,
+    .driver.group_timer   = driver_group_timer,
+    .driver.write_tag     = driver_write,
+    .driver.tag_validator = driver_tag_validator,
+    .driver.write_tags    = driver_write_tags,
+    .driver.add_tags      = NULL,
+    .driver.load_tags     = NULL,
+    .driver.del_tags      = NULL,
+};
+
+const neu_plugin_module_t neu_plugin_module = {
+    .version         = NEURON_PLUGIN_VER_1_0,
+    .schema          = "bench-driver",
+    .module_name     = "bench-driver",
+    .module_descr    = "synthetic driver of the throughput benchmark",
+    .module_descr_zh = "synthetic driver of the throughput benchmark",
+    .intf_funs       = &plugin_intf_funs,
+    .kind            = NEU_PLUGIN_KIND_CUSTOM,
+    .type            = NEU_NA_TYPE_DRIVER,
+    .display         = true,
+    .single          = false,
+};
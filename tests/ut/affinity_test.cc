@@ -0,0 +1,114 @@
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+
+#include "utils/affinity.h"
+#include "utils/log.h"
+
+zlog_category_t *neuron = NULL;
+
+static bool has(const neu_cpus_t *cpus, int cpu)
+{
+    return (cpus->bits[cpu / 64] >> (cpu % 64)) & 1;
+}
+
+TEST(AffinityTest, parse)
+{
+    neu_cpus_t cpus = {};
+
+    EXPECT_EQ(0, neu_cpus_parse("0-3, 8,70-71\n", &cpus));
+    for (int cpu = 0; cpu < NEU_CPUS_MAX; cpu++) {
+        bool in = cpu <= 3 || cpu == 8 || cpu == 70 || cpu == 71;
+        EXPECT_EQ(in, has(&cpus, cpu)) << cpu;
+    }
+
+    EXPECT_EQ(0, neu_cpus_parse("1023", &cpus));
+    EXPECT_TRUE(has(&cpus, 1023));
+    EXPECT_FALSE(has(&cpus, 0));
+
+    EXPECT_EQ(-1, neu_cpus_parse("", &cpus));
+    EXPECT_EQ(-1, neu_cpus_parse("1024", &cpus));
+    EXPECT_EQ(-1, neu_cpus_parse("3-1", &cpus));
+    EXPECT_EQ(-1, neu_cpus_parse("1,,2", &cpus));
+    EXPECT_EQ(-1, neu_cpus_parse("a", &cpus));
+    EXPECT_EQ(-1, neu_cpus_parse("-1", &cpus));
+    EXPECT_TRUE(neu_cpus_empty(&cpus));
+}
+
+TEST(AffinityTest, numa)
+{
+    neu_cpus_t cpus = {};
+
+    EXPECT_EQ(-1, neu_cpus_numa(-1, &cpus));
+    EXPECT_EQ(-1, neu_cpus_numa(100000, &cpus));
+    // a machine without NUMA support has no node at all
+    if (neu_cpus_numa(0, &cpus) == 0) {
+        EXPECT_FALSE(neu_cpus_empty(&cpus));
+    }
+}
+
+static void *wait_cancel(void *arg)
+{
+    (void) arg;
+    while (true) {
+        pthread_testcancel();
+        usleep(1000);
+    }
+    return NULL;
+}
+
+TEST(AffinityTest, pin)
+{
+    neu_cpus_t cpus   = {};
+    pthread_t  thread = {};
+    cpu_set_t  set;
+    cpu_set_t  process;
+
+    ASSERT_EQ(0, pthread_create(&thread, NULL, wait_cancel, NULL));
+    ASSERT_EQ(0, neu_cpus_parse("0", &cpus));
+    EXPECT_EQ(0, neu_thread_set_affinity(thread, &cpus));
+    ASSERT_EQ(0, pthread_getaffinity_np(thread, sizeof(set), &set));
+    EXPECT_EQ(1, CPU_COUNT(&set));
+    EXPECT_TRUE(CPU_ISSET(0, &set));
+
+    // back to where the process may run
+    EXPECT_EQ(0, neu_thread_set_affinity(thread, NULL));
+    ASSERT_EQ(0, pthread_getaffinity_np(thread, sizeof(set), &set));
+    ASSERT_EQ(0, sched_getaffinity(getpid(), sizeof(process), &process));
+    EXPECT_TRUE(CPU_EQUAL(&process, &set));
+
+    pthread_cancel(thread);
+    pthread_join(thread, NULL);
+}
+
+TEST(AffinityTest, sched)
+{
+    EXPECT_EQ(SCHED_FIFO, neu_sched_policy("fifo"));
+    EXPECT_EQ(SCHED_RR, neu_sched_policy("rr"));
+    EXPECT_EQ(SCHED_OTHER, neu_sched_policy("other"));
+    EXPECT_EQ(-1, neu_sched_policy("deadline"));
+
+    EXPECT_TRUE(neu_sched_priority_valid(SCHED_OTHER, 0));
+    EXPECT_FALSE(neu_sched_priority_valid(SCHED_OTHER, 1));
+    EXPECT_TRUE(neu_sched_priority_valid(SCHED_FIFO, 1));
+    EXPECT_TRUE(neu_sched_priority_valid(SCHED_RR, 99));
+    EXPECT_FALSE(neu_sched_priority_valid(SCHED_FIFO, 0));
+    EXPECT_FALSE(neu_sched_priority_valid(SCHED_RR, 100));
+
+    // SCHED_OTHER needs no privilege
+    EXPECT_EQ(0, neu_thread_set_sched(pthread_self(), SCHED_OTHER, 0));
+}
+
+TEST(AffinityTest, cputime)
+{
+    int64_t           start = neu_thread_cputime(pthread_self());
+    volatile uint64_t n     = 0;
+
+    ASSERT_GE(start, 0);
+    while (neu_thread_cputime(pthread_self()) - start < 1000 * 1000) {
+        n += 1;
+    }
+    EXPECT_GT(n, 0U);
+}
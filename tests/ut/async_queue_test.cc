@@ -108,6 +108,77 @@ TEST(neu_async_queue_test, clean)
     neu_async_queue_destroy(q);
 }
 
+static uint64_t expire_below = 0;
+
+bool below_expire_fn(void *data)
+{
+    return *reinterpret_cast<uint64_t *>(data) < expire_below;
+}
+
+TEST(neu_async_queue_test, pop_same_key_in_order)
+{
+    auto q = neu_async_queue_new(mock_key_fn, mock_expire_fn, mock_free_fn, 10);
+
+    auto first  = create_test_data(7);
+    auto second = create_test_data(7);
+    neu_async_queue_push(q, first);
+    neu_async_queue_push(q, create_test_data(8));
+    neu_async_queue_push(q, second);
+    ASSERT_EQ(3, neu_async_queue_count(q));
+
+    void *popped_data = nullptr;
+    ASSERT_EQ(0, neu_async_queue_pop(q, 7, &popped_data));
+    ASSERT_EQ(first, popped_data);
+    ASSERT_EQ(0, neu_async_queue_pop(q, 7, &popped_data));
+    ASSERT_EQ(second, popped_data);
+    ASSERT_EQ(-1, neu_async_queue_pop(q, 7, &popped_data));
+    ASSERT_EQ(1, neu_async_queue_count(q));
+
+    mock_free_fn(first);
+    mock_free_fn(second);
+    neu_async_queue_destroy(q);
+}
+
+TEST(neu_async_queue_test, evict_oldest_when_full)
+{
+    auto q = neu_async_queue_new(mock_key_fn, mock_expire_fn, mock_free_fn, 3);
+
+    for (int i = 0; i < 5; ++i) {
+        neu_async_queue_push(q, create_test_data(i));
+    }
+    ASSERT_EQ(3, neu_async_queue_count(q));
+
+    void *popped_data = nullptr;
+    ASSERT_EQ(-1, neu_async_queue_pop(q, 1, &popped_data));
+    ASSERT_EQ(0, neu_async_queue_pop(q, 2, &popped_data));
+    mock_free_fn(popped_data);
+
+    neu_async_queue_destroy(q);
+}
+
+TEST(neu_async_queue_test, expire)
+{
+    auto q =
+        neu_async_queue_new(mock_key_fn, below_expire_fn, mock_free_fn, 10);
+
+    for (int i = 0; i < 5; ++i) {
+        neu_async_queue_push(q, create_test_data(i));
+    }
+
+    // a pop leaves the expired ones to the sweep
+    expire_below      = 3;
+    void *popped_data = nullptr;
+    ASSERT_EQ(0, neu_async_queue_pop(q, 4, &popped_data));
+    mock_free_fn(popped_data);
+    ASSERT_EQ(4, neu_async_queue_count(q));
+
+    ASSERT_EQ(3, neu_async_queue_sweep(q));
+    ASSERT_EQ(1, neu_async_queue_count(q));
+    ASSERT_EQ(0, neu_async_queue_sweep(q));
+
+    neu_async_queue_destroy(q);
+}
+
 int main(int argc, char **argv)
 {
     zlog_init("./config/dev.conf");
@@ -0,0 +1,357 @@
+#include <atomic>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <sys/un.h>
+#include <thread>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "define.h"
+#include "tag_sort.h"
+#include "json/neu_json_fn.h"
+#include "json/neu_json_rw.h"
+#include "utils/hash.h"
+#include "utils/log.h"
+#include "utils/rolling_counter.h"
+
+extern "C" {
+#include "adapter/driver/cache.h"
+#include "base/group.h"
+#include "core/subscribe.h"
+
+// msg_q.h pulls in the C only message helpers, the queue only needs the
+// opaque message pointer
+typedef struct neu_msg_s     neu_msg_t;
+typedef struct adapter_msg_q adapter_msg_q_t;
+
+adapter_msg_q_t *adapter_msg_q_new(const char *name, uint32_t size);
+void             adapter_msg_q_free(adapter_msg_q_t *q);
+int              adapter_msg_q_push(adapter_msg_q_t *q, neu_msg_t *msg);
+uint32_t adapter_msg_q_pop_batch(adapter_msg_q_t *q, neu_msg_t **msgs,
+                                 int64_t *pushed, uint32_t n);
+}
+
+zlog_category_t *neuron = NULL;
+
+static std::vector<std::string> tag_names(int n)
+{
+    std::vector<std::string> names;
+    char                     name[NEU_TAG_NAME_LEN] = { 0 };
+
+    names.reserve(n);
+    for (int i = 0; i < n; ++i) {
+        snprintf(name, sizeof(name), "tag%d", i);
+        names.emplace_back(name);
+    }
+
+    return names;
+}
+
+static neu_driver_cache_t *fill_cache(const std::vector<std::string> &names)
+{
+    neu_driver_cache_t *cache = neu_driver_cache_new();
+    neu_dvalue_t        value = {};
+
+    value.type = NEU_TYPE_INT32;
+    for (const std::string &name : names) {
+        neu_driver_cache_add(cache, "group", name.c_str(), NULL, value);
+    }
+
+    return cache;
+}
+
+// one iteration updates every tag of the group once, every other value
+// changed
+static void cache_update_change(benchmark::State &state)
+{
+    std::vector<std::string> names = tag_names(state.range(0));
+    neu_driver_cache_t *     cache = fill_cache(names);
+    neu_dvalue_t             value = {};
+    int64_t                  ts    = 0;
+
+    value.type = NEU_TYPE_INT32;
+    for (auto _ : state) {
+        ts += 1;
+        for (size_t i = 0; i < names.size(); ++i) {
+            value.value.i32 = (int32_t)(ts + (i & 1));
+            neu_driver_cache_update_change(cache, "group", names[i].c_str(),
+                                           ts, value, NULL, 0, i & 1);
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * names.size());
+    neu_driver_cache_destroy(cache);
+}
+BENCHMARK(cache_update_change)->RangeMultiplier(10)->Range(1000, 1000000);
+
+// one iteration reads every tag of the group once, the changed flag of half
+// of them set again in between
+static void cache_meta_get_changed(benchmark::State &state)
+{
+    std::vector<std::string> names = tag_names(state.range(0));
+    neu_driver_cache_t *     cache = fill_cache(names);
+    neu_driver_cache_value_t value = {};
+    neu_tag_meta_t           metas[NEU_TAG_META_SIZE];
+    int64_t                  ts = 0;
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        ts += 1;
+        for (size_t i = 0; i < names.size(); i += 2) {
+            neu_driver_cache_update_change(cache, "group", names[i].c_str(),
+                                           ts, value.value, NULL, 0, true);
+        }
+        state.ResumeTiming();
+
+        for (const std::string &name : names) {
+            int ret = neu_driver_cache_meta_get_changed(
+                cache, "group", name.c_str(), &value, metas, NEU_TAG_META_SIZE);
+            benchmark::DoNotOptimize(ret);
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * names.size());
+    neu_driver_cache_destroy(cache);
+}
+BENCHMARK(cache_meta_get_changed)->RangeMultiplier(10)->Range(1000, 1000000);
+
+struct sort_tag {
+    uint8_t  station;
+    uint8_t  area;
+    uint16_t address;
+};
+
+static int sort_tag_cmp(neu_tag_sort_elem_t *tag1, neu_tag_sort_elem_t *tag2)
+{
+    return memcmp(tag1->tag, tag2->tag, sizeof(struct sort_tag));
+}
+
+// merge tags of the same station and area at most 8 addresses apart, as the
+// modbus plugin does with its registers
+static bool sort_tag_fn(neu_tag_sort_t *sort, void *tag, void *tag_to_be_sorted)
+{
+    struct sort_tag *t1 = (struct sort_tag *) tag;
+    struct sort_tag *t2 = (struct sort_tag *) tag_to_be_sorted;
+
+    (void) sort;
+    return t1->station == t2->station && t1->area == t2->area &&
+        t1->address + 8 >= t2->address;
+}
+
+static void tag_sort(benchmark::State &state)
+{
+    int                          n = state.range(0);
+    std::vector<struct sort_tag> tags(n);
+    UT_array *                   arr = NULL;
+
+    srand(n);
+    utarray_new(arr, &ut_ptr_icd);
+    for (int i = 0; i < n; ++i) {
+        struct sort_tag *tag = &tags[i];
+
+        tag->station = rand() % 4;
+        tag->area    = rand() % 4;
+        tag->address = rand() % 65536;
+        utarray_push_back(arr, &tag);
+    }
+
+    for (auto _ : state) {
+        neu_tag_sort_result_t *result =
+            neu_tag_sort(arr, sort_tag_fn, sort_tag_cmp);
+        benchmark::DoNotOptimize(result->n_sort);
+        neu_tag_sort_free(result);
+    }
+
+    state.SetItemsProcessed(state.iterations() * n);
+    utarray_free(arr);
+}
+BENCHMARK(tag_sort)->RangeMultiplier(10)->Range(100, 100000);
+
+static void group_get_read_tag(benchmark::State &state)
+{
+    std::vector<std::string> names = tag_names(state.range(0));
+    neu_group_t *            group = neu_group_new("group", 1000);
+    neu_datatag_t            tag   = {};
+
+    tag.address = (char *) "1!400001";
+    tag.type    = NEU_TYPE_INT16;
+    for (size_t i = 0; i < names.size(); ++i) {
+        tag.name      = (char *) names[i].c_str();
+        tag.attribute = i % 4 == 0 ? NEU_ATTRIBUTE_WRITE : NEU_ATTRIBUTE_READ;
+        neu_group_add_tag(group, &tag);
+    }
+
+    for (auto _ : state) {
+        UT_array *tags = neu_group_get_read_tag(group);
+        benchmark::DoNotOptimize(utarray_len(tags));
+        utarray_free(tags);
+    }
+
+    state.SetItemsProcessed(state.iterations() * names.size());
+    neu_group_destroy(group);
+}
+BENCHMARK(group_get_read_tag)->RangeMultiplier(10)->Range(100, 100000);
+
+static void json_encode_read_resp(benchmark::State &state)
+{
+    std::vector<std::string>              names = tag_names(state.range(0));
+    std::vector<neu_json_read_resp_tag_t> tags(names.size());
+    neu_json_read_resp_t                  resp = {};
+
+    for (size_t i = 0; i < names.size(); ++i) {
+        tags[i].name = (char *) names[i].c_str();
+        if (i % 2 == 0) {
+            tags[i].t             = NEU_JSON_INT;
+            tags[i].value.val_int = i;
+        } else {
+            tags[i].t                = NEU_JSON_DOUBLE;
+            tags[i].value.val_double = i / 3.0;
+            tags[i].precision        = 3;
+        }
+    }
+    resp.n_tag = tags.size();
+    resp.tags  = tags.data();
+
+    for (auto _ : state) {
+        char *result = NULL;
+        neu_json_encode_by_fn(&resp, neu_json_encode_read_resp, &result);
+        benchmark::DoNotOptimize(result);
+        free(result);
+    }
+
+    state.SetItemsProcessed(state.iterations() * names.size());
+}
+BENCHMARK(json_encode_read_resp)->RangeMultiplier(10)->Range(10, 10000);
+
+static void rolling_counter_add(benchmark::State &state)
+{
+    neu_rolling_counter_t *counter = neu_rolling_counter_new(state.range(0));
+    uint64_t               ts      = 0;
+
+    for (auto _ : state) {
+        // a sample every 10ms, several bins rolled per span
+        ts += 10;
+        neu_rolling_counter_add(counter, ts, 1);
+    }
+    benchmark::DoNotOptimize(neu_rolling_counter_value_at(counter, ts));
+
+    neu_rolling_counter_free(counter);
+}
+BENCHMARK(rolling_counter_add)->Arg(5000)->Arg(60000)->Arg(600000);
+
+// the uthash default against the Jenkins hash it replaced, by key length
+static void hash_key(benchmark::State &state)
+{
+    std::string key(state.range(0), 'k');
+    unsigned    hashv = 0;
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(key.data());
+        hashv = neu_hash(key.data(), key.size());
+        benchmark::DoNotOptimize(hashv);
+    }
+}
+BENCHMARK(hash_key)->Arg(8)->Arg(24)->Arg(64)->Arg(256);
+
+static void hash_key_jen(benchmark::State &state)
+{
+    std::string key(state.range(0), 'k');
+    unsigned    hashv = 0;
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(key.data());
+        HASH_JEN(key.data(), key.size(), hashv);
+        benchmark::DoNotOptimize(hashv);
+    }
+}
+BENCHMARK(hash_key_jen)->Arg(8)->Arg(24)->Arg(64)->Arg(256);
+
+// state.range(0) producers push, the benchmark thread pops in batches, one
+// iteration moves 64k messages through the queue
+static void msg_q_push_pop(benchmark::State &state)
+{
+    const uint32_t   per_iter  = 65536;
+    int              producers = state.range(0);
+    adapter_msg_q_t *q         = adapter_msg_q_new("bench", 1024);
+    neu_msg_t *      msgs[64];
+    int              token = 0;
+
+    for (auto _ : state) {
+        std::vector<std::thread> threads;
+        uint32_t                 popped = 0;
+
+        for (int i = 0; i < producers; ++i) {
+            uint32_t n = per_iter / producers +
+                (i < (int) (per_iter % producers) ? 1 : 0);
+            threads.emplace_back([q, n, &token]() {
+                for (uint32_t k = 0; k < n; ++k) {
+                    while (adapter_msg_q_push(q, (neu_msg_t *) &token) != 0) {
+                        sched_yield();
+                    }
+                }
+            });
+        }
+
+        while (popped < per_iter) {
+            popped += adapter_msg_q_pop_batch(q, msgs, NULL, 64);
+        }
+
+        for (std::thread &t : threads) {
+            t.join();
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * per_iter);
+    adapter_msg_q_free(q);
+}
+BENCHMARK(msg_q_push_pop)->Arg(1)->Arg(2)->Arg(4)->Arg(8)->UseRealTime();
+
+static struct sockaddr_un app_addr(int port)
+{
+    struct sockaddr_un addr = {};
+
+    addr.sun_family = AF_UNIX;
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%cneuron-%d", '\0', port);
+    return addr;
+}
+
+// state.range(0) drivers of 10 groups each, every group subscribed by 4 apps
+static void subscribe_manager_find(benchmark::State &state)
+{
+    int                  n_driver = state.range(0);
+    neu_subscribe_mgr_t *mgr      = neu_subscribe_manager_create();
+    char                 driver[NEU_NODE_NAME_LEN] = { 0 };
+    char                 group[NEU_GROUP_NAME_LEN] = { 0 };
+    char                 app[NEU_NODE_NAME_LEN]    = { 0 };
+
+    for (int d = 0; d < n_driver; ++d) {
+        snprintf(driver, sizeof(driver), "driver%d", d);
+        for (int g = 0; g < 10; ++g) {
+            snprintf(group, sizeof(group), "group%d", g);
+            for (int a = 0; a < 4; ++a) {
+                snprintf(app, sizeof(app), "app%d", a);
+                neu_subscribe_manager_sub(mgr, driver, app, group, NULL,
+                                          app_addr(a));
+            }
+        }
+    }
+
+    int i = 0;
+    for (auto _ : state) {
+        snprintf(driver, sizeof(driver), "driver%d", i % n_driver);
+        snprintf(group, sizeof(group), "group%d", i % 10);
+        UT_array *apps = neu_subscribe_manager_find(mgr, driver, group);
+        benchmark::DoNotOptimize(apps);
+        utarray_free(apps);
+        i += 1;
+    }
+
+    neu_subscribe_manager_destroy(mgr);
+}
+BENCHMARK(subscribe_manager_find)->RangeMultiplier(10)->Range(1, 1000);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,641 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "errcodes.h"
+#include "tag.h"
+#include "utils/history.h"
+#include "utils/log.h"
+
+extern "C" {
+#include "adapter/driver/cache.h"
+}
+
+zlog_category_t *neuron = NULL;
+
+// what the driver adds a tag with until the plugin reads it
+static neu_dvalue_t not_ready(uint8_t precision)
+{
+    neu_dvalue_t value = { .type = NEU_TYPE_ERROR };
+    value.precision    = precision;
+    value.value.i32    = -1;
+    return value;
+}
+
+static neu_dvalue_t string_value(const char *str)
+{
+    neu_dvalue_t value = { .type = NEU_TYPE_STRING };
+    strncpy(value.value.str, str, sizeof(value.value.str) - 1);
+    return value;
+}
+
+static bool get_changed(neu_driver_cache_t *cache, neu_driver_cache_value_t *v)
+{
+    neu_tag_meta_t metas[NEU_TAG_META_SIZE] = { 0 };
+
+    memset(v, 0, sizeof(*v));
+    return 0 ==
+        neu_driver_cache_meta_get_changed(cache, "group", "tag", v, metas,
+                                          NEU_TAG_META_SIZE);
+}
+
+TEST(DriverCacheTest, cvalue_round_trip)
+{
+    neu_dvalue_t in  = { .type = NEU_TYPE_INT16 };
+    neu_dvalue_t out = { .type = NEU_TYPE_INT8 };
+    neu_cvalue_t cv  = { 0 };
+
+    EXPECT_EQ(16, sizeof(neu_cvalue_t));
+
+    in.value.i16 = -2;
+    EXPECT_EQ(0, neu_cvalue_set(&cv, &in));
+    neu_cvalue_get(&cv, &out);
+    EXPECT_EQ(NEU_TYPE_INT16, out.type);
+    EXPECT_EQ(-2, out.value.i16);
+
+    in = string_value("hello");
+    EXPECT_EQ(0, neu_cvalue_set(&cv, &in));
+    EXPECT_EQ(5, cv.length);
+    neu_cvalue_get(&cv, &out);
+    EXPECT_STREQ("hello", out.value.str);
+
+    in.type                 = NEU_TYPE_BYTES;
+    in.value.bytes.length   = 3;
+    in.value.bytes.bytes[0] = 1;
+    in.value.bytes.bytes[1] = 2;
+    in.value.bytes.bytes[2] = 3;
+    EXPECT_EQ(0, neu_cvalue_set(&cv, &in));
+    neu_cvalue_get(&cv, &out);
+    EXPECT_EQ(3, out.value.bytes.length);
+    EXPECT_EQ(0, memcmp(in.value.bytes.bytes, out.value.bytes.bytes, 3));
+
+    uint8_t data[4]      = { 9, 8, 7, 6 };
+    in.type              = NEU_TYPE_PTR;
+    in.value.ptr.type    = NEU_TYPE_BYTES;
+    in.value.ptr.length  = sizeof(data);
+    in.value.ptr.ptr     = data;
+    EXPECT_EQ(0, neu_cvalue_set(&cv, &in));
+    neu_cvalue_get(&cv, &out);
+    EXPECT_EQ(NEU_TYPE_BYTES, out.value.ptr.type);
+    EXPECT_EQ(sizeof(data), out.value.ptr.length);
+    EXPECT_NE(data, out.value.ptr.ptr);
+    EXPECT_EQ(0, memcmp(data, out.value.ptr.ptr, sizeof(data)));
+
+    // readers share the data of the store, which a held value keeps alive
+    neu_dvalue_t out2 = { .type = NEU_TYPE_INT8 };
+    neu_cvalue_get(&cv, &out2);
+    EXPECT_EQ(out.value.ptr.ptr, out2.value.ptr.ptr);
+    neu_value_ptr_put(out2.value.ptr.ptr);
+
+    data[0] = 1;
+    EXPECT_EQ(0, neu_cvalue_set(&cv, &in));
+    EXPECT_NE(out.value.ptr.ptr, cv.value.ext);
+    EXPECT_EQ(9, out.value.ptr.ptr[0]);
+    neu_value_ptr_put(out.value.ptr.ptr);
+
+    // with no holder left, the data is overwritten in place
+    uint8_t *ext = cv.value.ext;
+    data[0]      = 2;
+    EXPECT_EQ(0, neu_cvalue_set(&cv, &in));
+    EXPECT_EQ(ext, cv.value.ext);
+    EXPECT_EQ(2, cv.value.ext[0]);
+
+    neu_cvalue_fini(&cv);
+}
+
+TEST(DriverCacheTest, change_detection)
+{
+    neu_driver_cache_t *     cache = neu_driver_cache_new();
+    neu_driver_cache_value_t v     = {};
+    neu_dvalue_t             value = string_value("a");
+
+    neu_driver_cache_add(cache, "group", "tag", NULL, not_ready(0));
+    neu_driver_cache_update(cache, "group", "tag", 1, value, NULL, 0);
+    ASSERT_TRUE(get_changed(cache, &v));
+    EXPECT_STREQ("a", v.value.value.str);
+    EXPECT_EQ(1, v.timestamp);
+
+    neu_driver_cache_update(cache, "group", "tag", 2, value, NULL, 0);
+    EXPECT_FALSE(get_changed(cache, &v));
+
+    // a value that changes back before it is read is still reported
+    neu_driver_cache_update(cache, "group", "tag", 3, string_value("b"),
+                            NULL, 0);
+    neu_driver_cache_update(cache, "group", "tag", 4, string_value("b"),
+                            NULL, 0);
+    ASSERT_TRUE(get_changed(cache, &v));
+    EXPECT_STREQ("b", v.value.value.str);
+
+    neu_dvalue_t f = { .type = NEU_TYPE_FLOAT };
+    f.value.f32    = 1.0;
+    neu_driver_cache_del(cache, "group", "tag");
+    neu_driver_cache_add(cache, "group", "tag", NULL, not_ready(1));
+    neu_driver_cache_update(cache, "group", "tag", 5, f, NULL, 0);
+    ASSERT_TRUE(get_changed(cache, &v));
+
+    f.value.f32 = 1.01;
+    neu_driver_cache_update(cache, "group", "tag", 6, f, NULL, 0);
+    EXPECT_FALSE(get_changed(cache, &v));
+    f.value.f32 = 1.5;
+    neu_driver_cache_update(cache, "group", "tag", 7, f, NULL, 0);
+    ASSERT_TRUE(get_changed(cache, &v));
+    EXPECT_FLOAT_EQ(1.5, v.value.value.f32);
+    EXPECT_EQ(1, v.value.precision);
+
+    neu_driver_cache_destroy(cache);
+}
+
+TEST(DriverCacheTest, metas)
+{
+    neu_driver_cache_t *     cache                    = neu_driver_cache_new();
+    neu_driver_cache_value_t v                        = {};
+    neu_tag_meta_t           metas[NEU_TAG_META_SIZE] = {};
+    neu_tag_meta_t           meta                     = {};
+    neu_dvalue_t             value = { .type = NEU_TYPE_INT32 };
+
+    strcpy(meta.name, "quality");
+    meta.value.type      = NEU_TYPE_INT32;
+    meta.value.value.i32 = 192;
+
+    neu_driver_cache_add(cache, "group", "tag", NULL, not_ready(0));
+    neu_driver_cache_update(cache, "group", "tag", 1, value, &meta, 1);
+    ASSERT_EQ(0,
+              neu_driver_cache_meta_get(cache, "group", "tag", &v, metas,
+                                        NEU_TAG_META_SIZE));
+    EXPECT_STREQ("quality", metas[0].name);
+    EXPECT_EQ(192, v.metas[0].value.value.i32);
+
+    neu_driver_cache_update(cache, "group", "tag", 2, value, NULL, 0);
+    ASSERT_EQ(0,
+              neu_driver_cache_meta_get(cache, "group", "tag", &v, metas,
+                                        NEU_TAG_META_SIZE));
+    EXPECT_STREQ("", metas[0].name);
+
+    neu_driver_cache_destroy(cache);
+}
+
+TEST(DriverCacheTest, normalize_on_write)
+{
+    neu_driver_cache_t *     cache = neu_driver_cache_new();
+    neu_driver_cache_value_t v     = {};
+    neu_datatag_t            def   = {};
+    neu_dvalue_t             value = { .type = NEU_TYPE_UINT16 };
+
+    def.type                  = NEU_TYPE_UINT16;
+    def.decimal               = 0.5;
+    def.option.value16.endian = NEU_DATATAG_ENDIAN_B16;
+
+    neu_driver_cache_add(cache, "group", "tag", &def, not_ready(0));
+    value.value.u16 = 0x0201;
+    neu_driver_cache_update(cache, "group", "tag", 1, value, NULL, 0);
+    ASSERT_TRUE(get_changed(cache, &v));
+    EXPECT_EQ(NEU_TYPE_DOUBLE, v.value.type);
+    EXPECT_DOUBLE_EQ(0x0102 * 0.5, v.value.value.d64);
+
+    // restored values are normalized already
+    value.type      = NEU_TYPE_DOUBLE;
+    value.value.d64 = 7.5;
+    neu_driver_cache_restore(cache, "group", "tag", 2, value, NULL, 0);
+    ASSERT_TRUE(get_changed(cache, &v));
+    EXPECT_DOUBLE_EQ(7.5, v.value.value.d64);
+
+    neu_driver_cache_destroy(cache);
+}
+
+TEST(DriverCacheTest, touch_written)
+{
+    neu_driver_cache_t *     cache                    = neu_driver_cache_new();
+    neu_driver_cache_value_t v                        = {};
+    neu_tag_meta_t           metas[NEU_TAG_META_SIZE] = {};
+    neu_tag_meta_t           written                  = {};
+    neu_dvalue_t             value = { .type = NEU_TYPE_INT32 };
+    const char *             tag   = "tag";
+
+    strcpy(written.name, NEU_DRIVER_CACHE_META_WRITTEN);
+    written.value.type      = NEU_TYPE_INT64;
+    written.value.value.i64 = 1;
+
+    neu_driver_cache_add(cache, "group", "tag", NULL, not_ready(0));
+    neu_driver_cache_update(cache, "group", "tag", 1, value, NULL, 0);
+    neu_driver_cache_touch_batch(cache, "group", 2, 1, &tag);
+    ASSERT_EQ(0,
+              neu_driver_cache_meta_get(cache, "group", "tag", &v, metas,
+                                        NEU_TAG_META_SIZE));
+    EXPECT_EQ(2, v.timestamp);
+
+    // an unchanged read does not confirm a written value
+    value.value.i32 = 5;
+    neu_driver_cache_update_change(cache, "group", "tag", 3, value, &written,
+                                   1, true);
+    neu_driver_cache_touch_batch(cache, "group", 4, 1, &tag);
+    ASSERT_EQ(0,
+              neu_driver_cache_meta_get(cache, "group", "tag", &v, metas,
+                                        NEU_TAG_META_SIZE));
+    EXPECT_EQ(3, v.timestamp);
+    EXPECT_STREQ(NEU_DRIVER_CACHE_META_WRITTEN, metas[0].name);
+
+    // a read confirms it
+    neu_driver_cache_update(cache, "group", "tag", 5, value, NULL, 0);
+    ASSERT_EQ(0,
+              neu_driver_cache_meta_get(cache, "group", "tag", &v, metas,
+                                        NEU_TAG_META_SIZE));
+    EXPECT_EQ(5, v.timestamp);
+    EXPECT_STREQ("", metas[0].name);
+
+    neu_driver_cache_destroy(cache);
+}
+
+static void update_double(neu_driver_cache_t *cache, int64_t ts, double d)
+{
+    neu_dvalue_t value = { .type = NEU_TYPE_DOUBLE };
+
+    value.value.d64 = d;
+    neu_driver_cache_update(cache, "group", "tag", ts, value, NULL, 0);
+}
+
+TEST(DriverCacheTest, deadband)
+{
+    neu_driver_cache_t *     cache = neu_driver_cache_new();
+    neu_driver_cache_value_t v     = {};
+    neu_datatag_t            def   = {};
+
+    def.type              = NEU_TYPE_DOUBLE;
+    def.deadband.absolute = 1;
+    def.deadband.percent  = 10;
+
+    neu_driver_cache_add(cache, "group", "tag", &def, not_ready(0));
+    update_double(cache, 1, 100);
+    ASSERT_TRUE(get_changed(cache, &v));
+    EXPECT_DOUBLE_EQ(100, v.value.value.d64);
+
+    // measured against the last value let through, not the last one read
+    update_double(cache, 2, 100.6);
+    EXPECT_FALSE(get_changed(cache, &v));
+    update_double(cache, 3, 100.9);
+    EXPECT_FALSE(get_changed(cache, &v));
+    update_double(cache, 4, 101);
+    ASSERT_TRUE(get_changed(cache, &v));
+    EXPECT_DOUBLE_EQ(101, v.value.value.d64);
+
+    // the percent band alone
+    def.deadband.absolute = 0;
+    neu_driver_cache_set_deadband(cache, "group", "tag", &def.deadband);
+    update_double(cache, 5, 110);
+    EXPECT_FALSE(get_changed(cache, &v));
+    update_double(cache, 6, 112);
+    ASSERT_TRUE(get_changed(cache, &v));
+
+    // no band reports every change
+    neu_driver_cache_set_deadband(cache, "group", "tag", NULL);
+    update_double(cache, 7, 112.1);
+    EXPECT_TRUE(get_changed(cache, &v));
+
+    neu_driver_cache_destroy(cache);
+}
+
+TEST(DriverCacheTest, report_interval)
+{
+    neu_driver_cache_t *     cache = neu_driver_cache_new();
+    neu_driver_cache_value_t v     = {};
+    neu_datatag_t            def   = {};
+
+    def.type                  = NEU_TYPE_DOUBLE;
+    def.deadband.min_interval = 100;
+    def.deadband.max_interval = 1000;
+
+    neu_driver_cache_add(cache, "group", "tag", &def, not_ready(0));
+    update_double(cache, 1000, 1);
+    ASSERT_TRUE(get_changed(cache, &v));
+
+    // a change is held back until min_interval passed, then the latest value
+    // is reported
+    update_double(cache, 1050, 2);
+    EXPECT_FALSE(get_changed(cache, &v));
+    update_double(cache, 1080, 3);
+    EXPECT_FALSE(get_changed(cache, &v));
+    update_double(cache, 1100, 3);
+    ASSERT_TRUE(get_changed(cache, &v));
+    EXPECT_DOUBLE_EQ(3, v.value.value.d64);
+
+    // an unchanged value is reported again after max_interval
+    update_double(cache, 1500, 3);
+    EXPECT_FALSE(get_changed(cache, &v));
+    update_double(cache, 2100, 3);
+    ASSERT_TRUE(get_changed(cache, &v));
+    EXPECT_DOUBLE_EQ(3, v.value.value.d64);
+    EXPECT_FALSE(get_changed(cache, &v));
+
+    neu_driver_cache_destroy(cache);
+}
+
+static UT_icd point_icd = { sizeof(neu_history_point_t), NULL, NULL, NULL };
+
+TEST(DriverCacheTest, history)
+{
+    neu_driver_cache_t *cache  = neu_driver_cache_new();
+    UT_array *          points = NULL;
+    neu_datatag_t       def    = {};
+
+    def.type    = NEU_TYPE_DOUBLE;
+    def.decimal = 0.5;
+
+    utarray_new(points, &point_icd);
+    neu_driver_cache_add(cache, "group", "plain", NULL, not_ready(0));
+    EXPECT_EQ(-1,
+              neu_driver_cache_history(cache, "group", "plain", 0, INT64_MAX,
+                                       0, 10, points));
+
+    neu_driver_cache_set_history(cache, 4096);
+    neu_driver_cache_add(cache, "group", "tag", &def, not_ready(0));
+    EXPECT_EQ(-1,
+              neu_driver_cache_history(cache, "group", "none", 0, INT64_MAX,
+                                       0, 10, points));
+
+    // values are kept as reported, errors are left out
+    update_double(cache, 1000, 10);
+    neu_driver_cache_update(cache, "group", "tag", 2000, not_ready(0), NULL,
+                            0);
+    update_double(cache, 3000, 12);
+    update_double(cache, 4000, 12);
+    EXPECT_EQ(0,
+              neu_driver_cache_history(cache, "group", "tag", 0, INT64_MAX, 0,
+                                       10, points));
+    ASSERT_EQ(3U, utarray_len(points));
+    EXPECT_EQ(1000, ((neu_history_point_t *) utarray_front(points))->timestamp);
+    EXPECT_DOUBLE_EQ(5, ((neu_history_point_t *) utarray_front(points))->last);
+    EXPECT_EQ(4000, ((neu_history_point_t *) utarray_back(points))->timestamp);
+    EXPECT_DOUBLE_EQ(6, ((neu_history_point_t *) utarray_back(points))->last);
+
+    utarray_free(points);
+    neu_driver_cache_destroy(cache);
+}
+
+static void collect_change(void *arg, neu_driver_cache_change_t *change)
+{
+    ((std::vector<std::string> *) arg)->push_back(change->tag);
+}
+
+static std::vector<std::string> changes(neu_driver_cache_t *cache,
+                                        uint64_t *cursor, bool timed = false)
+{
+    std::vector<std::string> tags;
+
+    neu_driver_cache_changes(cache, "group", NEU_ATTRIBUTE_SUBSCRIBE, timed,
+                             cursor, collect_change, &tags);
+    return tags;
+}
+
+static void update_tag(neu_driver_cache_t *cache, const char *tag, int64_t ts,
+                       double d)
+{
+    neu_dvalue_t value = { .type = NEU_TYPE_DOUBLE };
+
+    value.value.d64 = d;
+    neu_driver_cache_update(cache, "group", tag, ts, value, NULL, 0);
+}
+
+TEST(DriverCacheTest, change_cursors)
+{
+    neu_driver_cache_t *cache = neu_driver_cache_new();
+    neu_datatag_t       def   = {};
+    uint64_t            a     = 0;
+    uint64_t            b     = 0;
+
+    def.type      = NEU_TYPE_DOUBLE;
+    def.attribute =
+        (neu_attribute_e) (NEU_ATTRIBUTE_READ | NEU_ATTRIBUTE_SUBSCRIBE);
+    neu_driver_cache_add(cache, "group", "x", &def, not_ready(0));
+    neu_driver_cache_add(cache, "group", "y", &def, not_ready(0));
+    neu_driver_cache_add(cache, "group", "z", &def, not_ready(0));
+    def.attribute = NEU_ATTRIBUTE_READ;
+    neu_driver_cache_add(cache, "group", "polled", &def, not_ready(0));
+
+    EXPECT_EQ(-1,
+              neu_driver_cache_changes(cache, "none", 0, false, &a,
+                                       collect_change, NULL));
+    EXPECT_TRUE(changes(cache, &a).empty());
+
+    update_tag(cache, "x", 1, 1);
+    update_tag(cache, "y", 1, 1);
+    update_tag(cache, "polled", 1, 1);
+    update_tag(cache, "x", 2, 2);
+    // unchanged
+    update_tag(cache, "y", 2, 1);
+
+    // in the order of the last change, each consumer sees each change
+    EXPECT_EQ((std::vector<std::string> { "y", "x" }), changes(cache, &a));
+    EXPECT_TRUE(changes(cache, &a).empty());
+    update_tag(cache, "z", 3, 1);
+    EXPECT_EQ((std::vector<std::string> { "z" }), changes(cache, &a));
+    EXPECT_EQ((std::vector<std::string> { "y", "x", "z" }),
+              changes(cache, &b));
+
+    // a removed tag leaves the list, a group added again counts on
+    neu_driver_cache_del(cache, "group", "z");
+    update_tag(cache, "x", 4, 3);
+    EXPECT_EQ((std::vector<std::string> { "x" }), changes(cache, &a));
+    neu_driver_cache_del_group(cache, "group");
+    def.attribute = NEU_ATTRIBUTE_SUBSCRIBE;
+    neu_driver_cache_add(cache, "group", "x", &def, not_ready(0));
+    update_tag(cache, "x", 5, 1);
+    EXPECT_EQ((std::vector<std::string> { "x" }), changes(cache, &a));
+    EXPECT_EQ((std::vector<std::string> { "x" }), changes(cache, &b));
+
+    neu_driver_cache_destroy(cache);
+}
+
+TEST(DriverCacheTest, change_cursor_timed)
+{
+    neu_driver_cache_t *cache  = neu_driver_cache_new();
+    neu_datatag_t       def    = {};
+    uint64_t            cursor = 0;
+
+    def.type                  = NEU_TYPE_DOUBLE;
+    def.attribute             = NEU_ATTRIBUTE_SUBSCRIBE;
+    def.deadband.min_interval = 100;
+    neu_driver_cache_add(cache, "group", "timed", &def, not_ready(0));
+
+    update_tag(cache, "timed", 1000, 1);
+    EXPECT_TRUE(changes(cache, &cursor).empty());
+    EXPECT_EQ((std::vector<std::string> { "timed" }),
+              changes(cache, &cursor, true));
+
+    // held back until min_interval passed, whatever the cursor
+    update_tag(cache, "timed", 1050, 2);
+    EXPECT_TRUE(changes(cache, &cursor, true).empty());
+    update_tag(cache, "timed", 1100, 2);
+    EXPECT_EQ((std::vector<std::string> { "timed" }),
+              changes(cache, &cursor, true));
+
+    // without interval timing the tag is tracked by the cursor again
+    neu_driver_cache_set_deadband(cache, "group", "timed", NULL);
+    update_tag(cache, "timed", 1200, 3);
+    EXPECT_EQ((std::vector<std::string> { "timed" }), changes(cache, &cursor));
+
+    neu_driver_cache_destroy(cache);
+}
+
+TEST(DriverCacheTest, expire)
+{
+    neu_driver_cache_t *     cache  = neu_driver_cache_new();
+    neu_datatag_t            def    = {};
+    neu_driver_cache_value_t v      = {};
+    neu_tag_meta_t           metas[NEU_TAG_META_SIZE];
+    uint64_t                 cursor = 0;
+
+    def.type      = NEU_TYPE_DOUBLE;
+    def.attribute = NEU_ATTRIBUTE_SUBSCRIBE;
+    neu_driver_cache_add(cache, "group", "never", &def, not_ready(0));
+    neu_driver_cache_add(cache, "group", "x", &def, not_ready(0));
+    def.poll_divisor = 3;
+    neu_driver_cache_add(cache, "group", "slow", &def, not_ready(0));
+    def.poll_divisor = 0;
+    def.attribute    = (neu_attribute_e) (NEU_ATTRIBUTE_SUBSCRIBE |
+                                       NEU_ATTRIBUTE_STATIC);
+    neu_driver_cache_add(cache, "group", "static", &def, not_ready(0));
+
+    EXPECT_EQ(-1, neu_driver_cache_expire(cache, "none", 0, 1000));
+    update_tag(cache, "slow", 1000, 1);
+    update_tag(cache, "static", 1000, 1);
+    update_tag(cache, "x", 1000, 1);
+    EXPECT_EQ(0, neu_driver_cache_expire(cache, "group", 1500, 1000));
+    update_tag(cache, "x", 1800, 1);
+    changes(cache, &cursor);
+
+    // a slow tag is given as many timeouts as its poll divisor
+    EXPECT_EQ(0, neu_driver_cache_expire(cache, "group", 2100, 1000));
+    EXPECT_EQ(2, neu_driver_cache_expire(cache, "group", 4100, 1000));
+    EXPECT_EQ(0, neu_driver_cache_expire(cache, "group", 9000, 1000));
+
+    // each goes stale once, with a change
+    EXPECT_EQ((std::vector<std::string> { "slow", "x" }),
+              changes(cache, &cursor));
+    EXPECT_EQ(0,
+              neu_driver_cache_meta_get(cache, "group", "x", &v, metas,
+                                        NEU_TAG_META_SIZE));
+    EXPECT_EQ(NEU_TYPE_ERROR, v.value.type);
+    EXPECT_EQ(NEU_ERR_PLUGIN_TAG_VALUE_EXPIRED, v.value.value.i32);
+    EXPECT_EQ(0,
+              neu_driver_cache_meta_get(cache, "group", "static", &v, metas,
+                                        NEU_TAG_META_SIZE));
+    EXPECT_EQ(NEU_TYPE_DOUBLE, v.value.type);
+    EXPECT_EQ(0,
+              neu_driver_cache_meta_get(cache, "group", "never", &v, metas,
+                                        NEU_TAG_META_SIZE));
+    EXPECT_EQ(-1, v.value.value.i32);
+
+    // the same value read again is a change back
+    update_tag(cache, "x", 9100, 1);
+    EXPECT_EQ((std::vector<std::string> { "x" }), changes(cache, &cursor));
+    EXPECT_EQ(0,
+              neu_driver_cache_meta_get(cache, "group", "x", &v, metas,
+                                        NEU_TAG_META_SIZE));
+    EXPECT_DOUBLE_EQ(1, v.value.value.d64);
+
+    neu_driver_cache_destroy(cache);
+}
+
+TEST(DriverCacheTest, hold)
+{
+    neu_driver_cache_t *     cache  = neu_driver_cache_new();
+    neu_datatag_t            def    = {};
+    neu_driver_cache_value_t v      = {};
+    neu_tag_meta_t           metas[NEU_TAG_META_SIZE];
+    uint64_t                 cursor = 0;
+
+    def.type      = NEU_TYPE_DOUBLE;
+    def.attribute = NEU_ATTRIBUTE_SUBSCRIBE;
+    neu_driver_cache_add(cache, "group", "x", &def, not_ready(0));
+    update_tag(cache, "x", 1000, 5);
+    changes(cache, &cursor);
+
+    // aged out, the value stays with the time it was read at
+    EXPECT_EQ(1, neu_driver_cache_hold(cache, "group", 2500, 1000));
+    EXPECT_EQ((std::vector<std::string> { "x" }), changes(cache, &cursor));
+    EXPECT_EQ(0,
+              neu_driver_cache_meta_get(cache, "group", "x", &v, metas,
+                                        NEU_TAG_META_SIZE));
+    EXPECT_EQ(NEU_TYPE_DOUBLE, v.value.type);
+    EXPECT_DOUBLE_EQ(5, v.value.value.d64);
+    EXPECT_STREQ(NEU_DRIVER_CACHE_META_STALE, metas[0].name);
+    EXPECT_EQ(1000, metas[0].value.value.i64);
+
+    // read again, the stale meta is gone
+    update_tag(cache, "x", 2600, 5);
+    EXPECT_EQ((std::vector<std::string> { "x" }), changes(cache, &cursor));
+    EXPECT_EQ(0,
+              neu_driver_cache_meta_get(cache, "group", "x", &v, metas,
+                                        NEU_TAG_META_SIZE));
+    EXPECT_STREQ("", metas[0].name);
+
+    neu_driver_cache_destroy(cache);
+}
+
+TEST(DriverCacheTest, evict)
+{
+    neu_driver_cache_t *     cache = neu_driver_cache_new();
+    neu_datatag_t            def   = {};
+    neu_driver_cache_value_t v     = {};
+    neu_tag_meta_t           metas[NEU_TAG_META_SIZE];
+
+    def.type      = NEU_TYPE_DOUBLE;
+    def.attribute = NEU_ATTRIBUTE_READ;
+    neu_driver_cache_add(cache, "group", "x", &def, not_ready(0));
+    def.attribute = (neu_attribute_e) (NEU_ATTRIBUTE_READ |
+                                       NEU_ATTRIBUTE_STATIC);
+    neu_driver_cache_add(cache, "group", "static", &def, not_ready(0));
+    update_tag(cache, "x", 1000, 5);
+    update_tag(cache, "static", 1000, 6);
+
+    // as if never read, but for the static tag
+    neu_driver_cache_evict(cache, "group");
+    EXPECT_EQ(0,
+              neu_driver_cache_meta_get(cache, "group", "x", &v, metas,
+                                        NEU_TAG_META_SIZE));
+    EXPECT_EQ(NEU_TYPE_ERROR, v.value.type);
+    EXPECT_EQ(NEU_ERR_PLUGIN_TAG_NOT_READY, v.value.value.i32);
+    EXPECT_EQ(0, v.timestamp);
+    EXPECT_EQ(0,
+              neu_driver_cache_meta_get(cache, "group", "static", &v, metas,
+                                        NEU_TAG_META_SIZE));
+    EXPECT_DOUBLE_EQ(6, v.value.value.d64);
+
+    update_tag(cache, "x", 2000, 7);
+    EXPECT_EQ(0,
+              neu_driver_cache_meta_get(cache, "group", "x", &v, metas,
+                                        NEU_TAG_META_SIZE));
+    EXPECT_DOUBLE_EQ(7, v.value.value.d64);
+
+    neu_driver_cache_destroy(cache);
+}
+
+TEST(DriverCacheTest, rename_group)
+{
+    neu_driver_cache_t *     cache = neu_driver_cache_new();
+    neu_datatag_t            def   = {};
+    neu_driver_cache_value_t v     = {};
+    neu_tag_meta_t           metas[NEU_TAG_META_SIZE];
+
+    def.type      = NEU_TYPE_DOUBLE;
+    def.attribute = NEU_ATTRIBUTE_READ;
+    neu_driver_cache_add(cache, "group", "x", &def, not_ready(0));
+    neu_driver_cache_add(cache, "stale", "y", &def, not_ready(0));
+    update_tag(cache, "x", 1000, 7);
+
+    EXPECT_EQ(-1, neu_driver_cache_rename_group(cache, "none", "other"));
+    EXPECT_EQ(0, neu_driver_cache_rename_group(cache, "group", "stale"));
+
+    // the value carries over, what was left under the new name is gone
+    EXPECT_EQ(0,
+              neu_driver_cache_meta_get(cache, "stale", "x", &v, metas,
+                                        NEU_TAG_META_SIZE));
+    EXPECT_DOUBLE_EQ(7, v.value.value.d64);
+    EXPECT_FALSE(neu_driver_cache_exist(cache, "stale", "y"));
+    EXPECT_FALSE(neu_driver_cache_exist(cache, "group", "x"));
+
+    neu_driver_cache_destroy(cache);
+}
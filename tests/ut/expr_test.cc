@@ -0,0 +1,91 @@
+#include <math.h>
+
+#include <gtest/gtest.h>
+
+extern "C" {
+#include "adapter/driver/expr.h"
+}
+
+static double eval(const char *src, const double *operands = NULL)
+{
+    double      result = 0;
+    neu_expr_t *expr   = neu_expr_compile(src);
+
+    EXPECT_NE(nullptr, expr) << src;
+    if (expr == NULL) {
+        return NAN;
+    }
+    EXPECT_EQ(0, neu_expr_eval(expr, operands, &result)) << src;
+    neu_expr_free(expr);
+    return result;
+}
+
+TEST(ExprTest, arithmetic)
+{
+    EXPECT_DOUBLE_EQ(7, eval("1 + 2 * 3"));
+    EXPECT_DOUBLE_EQ(9, eval("(1 + 2) * 3"));
+    EXPECT_DOUBLE_EQ(-1, eval("-(3 - 2)"));
+    EXPECT_DOUBLE_EQ(2.5, eval("5 / 2"));
+    EXPECT_DOUBLE_EQ(1, eval("7 % 3"));
+    EXPECT_DOUBLE_EQ(0.001, eval("1e-3"));
+    EXPECT_DOUBLE_EQ(3, eval("abs(-3)"));
+    EXPECT_DOUBLE_EQ(2, eval("min(2, max(1, 5))"));
+}
+
+TEST(ExprTest, bitwise)
+{
+    EXPECT_DOUBLE_EQ(0x12340000, eval("0x1234 << 16"));
+    EXPECT_DOUBLE_EQ(0x12, eval("0x1234 >> 8"));
+    EXPECT_DOUBLE_EQ(0x34, eval("0x1234 & 0xff"));
+    EXPECT_DOUBLE_EQ(7, eval("1 | 2 ^ 4"));
+    EXPECT_DOUBLE_EQ(1, eval("bit(4, 2)"));
+    EXPECT_DOUBLE_EQ(-1, eval("~0"));
+    EXPECT_DOUBLE_EQ(7, eval("1 + 2 << 1 | 1"));
+}
+
+TEST(ExprTest, operands)
+{
+    neu_expr_t *expr = neu_expr_compile("hi << 16 | lo + 'the lo' * lo");
+    double      v[3] = { 1, 2, 3 };
+    double      r    = 0;
+
+    ASSERT_NE(nullptr, expr);
+    EXPECT_EQ(3, neu_expr_n_operand(expr));
+    EXPECT_STREQ("hi", neu_expr_operand(expr, 0));
+    EXPECT_STREQ("lo", neu_expr_operand(expr, 1));
+    EXPECT_STREQ("the lo", neu_expr_operand(expr, 2));
+    EXPECT_EQ(nullptr, neu_expr_operand(expr, 3));
+    EXPECT_EQ(0, neu_expr_eval(expr, v, &r));
+    EXPECT_DOUBLE_EQ((1 << 16) | 8, r);
+    neu_expr_free(expr);
+
+    EXPECT_DOUBLE_EQ(6, eval("\"group.tag\" * 2", v + 2));
+}
+
+TEST(ExprTest, syntax)
+{
+    const char *bad[] = {
+        "", "1 +", "(1", "1)", "min(1)", "max(1, 2, 3)", "foo(1)",
+        "'a", "1 < 2", "a b", "1 || 2", "''",
+    };
+
+    for (const char *src : bad) {
+        EXPECT_EQ(nullptr, neu_expr_compile(src)) << src;
+    }
+}
+
+TEST(ExprTest, undefined)
+{
+    const char *bad[] = {
+        "1 / 0", "1 % 0", "1 << 64", "1 >> -1", "bit(1, 64)", "1e300 * 1e300",
+        "1e300 & 1",
+    };
+    double      r     = 0;
+
+    for (const char *src : bad) {
+        neu_expr_t *expr = neu_expr_compile(src);
+        ASSERT_NE(nullptr, expr) << src;
+        EXPECT_EQ(-1, neu_expr_eval(expr, NULL, &r)) << src;
+        neu_expr_free(expr);
+    }
+}
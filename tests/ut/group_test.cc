@@ -0,0 +1,263 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "errcodes.h"
+#include "utils/log.h"
+
+extern "C" {
+#include "base/group.h"
+}
+
+zlog_category_t *neuron = NULL;
+
+static void add_tag(neu_group_t *group, const char *name, const char *desc,
+                    neu_attribute_e attribute)
+{
+    neu_datatag_t tag = { 0 };
+
+    tag.name        = (char *) name;
+    tag.address     = (char *) "1!400001";
+    tag.description = (char *) desc;
+    tag.attribute   = attribute;
+    tag.type        = NEU_TYPE_INT16;
+    ASSERT_EQ(0, neu_group_add_tag(group, &tag));
+}
+
+static std::set<std::string> names(UT_array *tags)
+{
+    std::set<std::string> set;
+
+    utarray_foreach(tags, neu_datatag_t *, tag) { set.insert(tag->name); }
+    utarray_free(tags);
+    return set;
+}
+
+TEST(GroupTest, query_tag)
+{
+    neu_group_t *group = neu_group_new("group", 1000);
+
+    add_tag(group, "temperature1", "boiler inlet", NEU_ATTRIBUTE_READ);
+    add_tag(group, "temperature2", "boiler outlet", NEU_ATTRIBUTE_WRITE);
+    add_tag(group, "pressure", "inlet pump", NEU_ATTRIBUTE_SUBSCRIBE);
+
+    EXPECT_EQ(std::set<std::string>({ "temperature1", "temperature2" }),
+              names(neu_group_query_tag(group, "temp")));
+    EXPECT_EQ(std::set<std::string>({ "temperature1", "pressure" }),
+              names(neu_group_query_tag(group, "inlet")));
+    // too short for the index
+    EXPECT_EQ(std::set<std::string>({ "temperature1" }),
+              names(neu_group_query_tag(group, "e1")));
+    EXPECT_EQ(3, names(neu_group_query_tag(group, "")).size());
+    EXPECT_EQ(0, names(neu_group_query_tag(group, "missing")).size());
+
+    // readable only, the name matches the description as well
+    EXPECT_EQ(std::set<std::string>({ "temperature1", "pressure" }),
+              names(neu_group_query_read_tag(group, "inlet", NULL)));
+    EXPECT_EQ(std::set<std::string>({ "pressure" }),
+              names(neu_group_query_read_tag(group, "re", "pump")));
+
+    // the index follows the changes of the group
+    add_tag(group, "temperature3", "", NEU_ATTRIBUTE_READ);
+    EXPECT_EQ(3, names(neu_group_query_tag(group, "temp")).size());
+    EXPECT_EQ(0, neu_group_del_tag(group, "temperature1"));
+    EXPECT_EQ(std::set<std::string>({ "temperature2", "temperature3" }),
+              names(neu_group_query_tag(group, "temp")));
+
+    neu_group_destroy(group);
+}
+
+static std::vector<std::string> page(neu_group_t *group, const char *name,
+                                     const char *after, uint32_t offset,
+                                     uint32_t limit, uint32_t *total)
+{
+    std::vector<std::string> list;
+    UT_array *               tags = NULL;
+    neu_group_tag_page_t     p    = { 0 };
+
+    p.name   = name;
+    p.after  = after;
+    p.offset = offset;
+    p.limit  = limit;
+    EXPECT_EQ(0, neu_group_query_tag_page(group, &p, &tags, total));
+    utarray_foreach(tags, neu_datatag_t *, tag) { list.push_back(tag->name); }
+    utarray_free(tags);
+    return list;
+}
+
+TEST(GroupTest, query_tag_page)
+{
+    neu_group_t *        group = neu_group_new("group", 1000);
+    uint32_t             total = 0;
+    UT_array *           tags  = NULL;
+    neu_group_tag_page_t p     = { 0 };
+
+    for (int i = 0; i < 10; ++i) {
+        std::string name = "tag" + std::to_string(i);
+        add_tag(group, name.c_str(), i % 2 ? "odd" : "even",
+                i % 2 ? NEU_ATTRIBUTE_READ : NEU_ATTRIBUTE_WRITE);
+    }
+
+    std::vector<std::string> all = page(group, NULL, NULL, 0, 0, &total);
+    EXPECT_EQ(10, all.size());
+    EXPECT_EQ(10, total);
+
+    // offset and limit give consecutive slices of the full listing
+    std::vector<std::string> first = page(group, NULL, NULL, 0, 4, &total);
+    EXPECT_EQ(std::vector<std::string>(all.begin(), all.begin() + 4), first);
+    EXPECT_EQ(10, total);
+    EXPECT_EQ(std::vector<std::string>(all.begin() + 8, all.end()),
+              page(group, NULL, NULL, 8, 4, &total));
+
+    // the cursor continues after the last tag of the previous page
+    EXPECT_EQ(std::vector<std::string>(all.begin() + 4, all.begin() + 8),
+              page(group, NULL, first.back().c_str(), 0, 4, &total));
+    EXPECT_EQ(10, total);
+
+    // filters narrow the total as well as the page
+    EXPECT_EQ(2, page(group, "odd", NULL, 0, 2, &total).size());
+    EXPECT_EQ(5, total);
+    p.attribute = NEU_ATTRIBUTE_WRITE;
+    EXPECT_EQ(0, neu_group_query_tag_page(group, &p, &tags, &total));
+    EXPECT_EQ(5, total);
+    EXPECT_EQ(5, utarray_len(tags));
+    utarray_free(tags);
+    p.attribute = 0;
+    p.type      = NEU_TYPE_FLOAT;
+    EXPECT_EQ(0, neu_group_query_tag_page(group, &p, &tags, &total));
+    EXPECT_EQ(0, total);
+    utarray_free(tags);
+
+    p.type  = 0;
+    p.after = "missing";
+    EXPECT_EQ(NEU_ERR_TAG_NOT_EXIST,
+              neu_group_query_tag_page(group, &p, &tags, &total));
+    utarray_free(tags);
+
+    neu_group_destroy(group);
+}
+
+TEST(GroupTest, read_view)
+{
+    neu_group_t *group = neu_group_new("group", 1000);
+
+    add_tag(group, "a", "", NEU_ATTRIBUTE_READ);
+    add_tag(group, "w", "", NEU_ATTRIBUTE_WRITE);
+
+    neu_group_tag_view_t *v1 = neu_group_get_read_view(group);
+    neu_group_tag_view_t *v2 = neu_group_get_read_view(group);
+    EXPECT_EQ(v1, v2);
+    EXPECT_EQ(1, utarray_len(v1->tags));
+    EXPECT_STREQ("a", v1->names[0]);
+    EXPECT_EQ(NEU_ATTRIBUTE_READ, v1->attributes[0]);
+    neu_group_put_read_view(v2);
+
+    add_tag(group, "b", "", NEU_ATTRIBUTE_SUBSCRIBE);
+    EXPECT_TRUE(neu_group_is_change(group, v1->timestamp));
+
+    // the old snapshot stays as it was for its holder
+    v2 = neu_group_get_read_view(group);
+    EXPECT_NE(v1, v2);
+    EXPECT_EQ(1, utarray_len(v1->tags));
+    EXPECT_EQ(2, utarray_len(v2->tags));
+    EXPECT_FALSE(neu_group_is_change(group, v2->timestamp));
+    for (size_t i = 0; i < utarray_len(v2->tags); i++) {
+        neu_datatag_t *tag = (neu_datatag_t *) utarray_eltptr(v2->tags, i);
+        EXPECT_STREQ(tag->name, v2->names[i]);
+        EXPECT_EQ(tag->attribute, v2->attributes[i]);
+    }
+    neu_group_put_read_view(v1);
+    neu_group_put_read_view(v2);
+
+    neu_group_destroy(group);
+}
+
+TEST(GroupTest, read_view_during_edits)
+{
+    neu_group_t *group = neu_group_new("group", 1000);
+    bool         done  = false;
+
+    std::thread editor([&]() {
+        for (int i = 0; i < 500; ++i) {
+            std::string name = "tag" + std::to_string(i);
+            add_tag(group, name.c_str(), "", NEU_ATTRIBUTE_READ);
+        }
+        __atomic_store_n(&done, true, __ATOMIC_RELEASE);
+    });
+
+    size_t last = 0;
+    while (!__atomic_load_n(&done, __ATOMIC_ACQUIRE)) {
+        neu_group_tag_view_t *view = neu_group_get_read_view(group);
+        // views only ever grow here, a stale one is never older than the last
+        EXPECT_GE(utarray_len(view->tags), last);
+        last = utarray_len(view->tags);
+        neu_group_put_read_view(view);
+    }
+    editor.join();
+
+    neu_group_tag_view_t *view = neu_group_get_read_view(group);
+    EXPECT_EQ(500, utarray_len(view->tags));
+    neu_group_put_read_view(view);
+
+    neu_group_destroy(group);
+}
+
+TEST(GroupTest, shared_tag_definitions)
+{
+    neu_group_t *g1 = neu_group_new("g1", 1000);
+    neu_group_t *g2 = neu_group_new("g2", 1000);
+
+    add_tag(g1, "a", "same", NEU_ATTRIBUTE_READ);
+    add_tag(g2, "a", "same", NEU_ATTRIBUTE_READ);
+    add_tag(g2, "s", "", NEU_ATTRIBUTE_READ);
+
+    // an update of one group leaves the same definition of the other alone
+    neu_datatag_t tag = { 0 };
+    tag.name          = (char *) "a";
+    tag.address       = (char *) "1!400002";
+    tag.description   = (char *) "changed";
+    tag.attribute     = NEU_ATTRIBUTE_READ;
+    tag.type          = NEU_TYPE_INT16;
+    EXPECT_EQ(0, neu_group_update_tag(g1, &tag));
+
+    neu_datatag_t *t1 = neu_group_find_tag(g1, "a");
+    neu_datatag_t *t2 = neu_group_find_tag(g2, "a");
+    EXPECT_STREQ("1!400002", t1->address);
+    EXPECT_STREQ("1!400001", t2->address);
+    EXPECT_STREQ("same", t2->description);
+    neu_tag_free(t1);
+    neu_tag_free(t2);
+
+    // moved tags matching a definition in use are released into it
+    neu_datatag_t moved[2] = { 0 };
+    moved[0].name          = strdup("s");
+    moved[0].address       = strdup("1!400001");
+    moved[0].description   = strdup("");
+    moved[0].attribute     = NEU_ATTRIBUTE_READ;
+    moved[0].type          = NEU_TYPE_INT16;
+    moved[1].name          = strdup("b");
+    moved[1].address       = strdup("1!400003");
+    moved[1].description   = strdup("");
+    moved[1].attribute     = NEU_ATTRIBUTE_READ;
+    moved[1].type          = NEU_TYPE_INT16;
+    EXPECT_EQ(2, neu_group_move_tags(g1, moved, 2));
+    EXPECT_EQ(NULL, moved[0].name);
+    EXPECT_EQ(NULL, moved[1].name);
+
+    neu_group_destroy(g2);
+
+    t1 = neu_group_find_tag(g1, "s");
+    EXPECT_STREQ("1!400001", t1->address);
+    neu_tag_free(t1);
+    EXPECT_EQ(3, neu_group_tag_size(g1));
+    EXPECT_EQ(0, neu_group_del_tag(g1, "s"));
+    EXPECT_EQ(2, neu_group_tag_size(g1));
+
+    neu_group_destroy(g1);
+}
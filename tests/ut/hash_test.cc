@@ -0,0 +1,93 @@
+#include <set>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "define.h"
+#include "utils/hash.h"
+#include "utils/uthash.h"
+
+typedef struct {
+    char           name[NEU_TAG_NAME_LEN];
+    UT_hash_handle hh;
+} entry_t;
+
+TEST(hash_test, every_byte_counts)
+{
+    std::string key(100, 'a');
+
+    for (size_t len = 0; len <= key.size(); ++len) {
+        uint32_t h = neu_hash(key.data(), len);
+
+        EXPECT_EQ(h, neu_hash(std::string(key, 0, len).data(), len));
+        for (size_t i = 0; i < len; ++i) {
+            std::string other(key, 0, len);
+
+            other[i] = 'b';
+            EXPECT_NE(h, neu_hash(other.data(), len)) << len << " " << i;
+        }
+    }
+}
+
+TEST(hash_test, low_bits_spread)
+{
+    std::set<uint32_t> buckets;
+
+    // uthash takes the bucket from the low bits
+    for (int i = 0; i < 1024; ++i) {
+        std::string key = "tag" + std::to_string(i);
+
+        buckets.insert(neu_hash(key.data(), key.size()) & 1023);
+    }
+    EXPECT_GT(buckets.size(), 600);
+}
+
+TEST(hash_test, key_pair)
+{
+    char   key[NEU_NODE_NAME_LEN + NEU_GROUP_NAME_LEN];
+    char   other[NEU_NODE_NAME_LEN + NEU_GROUP_NAME_LEN];
+    size_t len = neu_hash_key_pair(key, "modbus", NEU_NODE_NAME_LEN, "grp",
+                                   NEU_GROUP_NAME_LEN);
+
+    EXPECT_EQ(11, len);
+    EXPECT_EQ(0, memcmp(key, "modbus\0grp", len));
+
+    // names that concatenate alike stay apart
+    size_t n = neu_hash_key_pair(other, "modbu", NEU_NODE_NAME_LEN, "sgrp",
+                                 NEU_GROUP_NAME_LEN);
+    EXPECT_EQ(len, n);
+    EXPECT_NE(0, memcmp(key, other, len));
+
+    std::string long_name(2 * NEU_NODE_NAME_LEN, 'n');
+    len = neu_hash_key_pair(key, long_name.c_str(), NEU_NODE_NAME_LEN, "",
+                            NEU_GROUP_NAME_LEN);
+    EXPECT_EQ(NEU_NODE_NAME_LEN + 1, len);
+}
+
+TEST(hash_test, uthash_table)
+{
+    entry_t *table = NULL, *e = NULL, *tmp = NULL;
+
+    for (int i = 0; i < 10000; ++i) {
+        e = (entry_t *) calloc(1, sizeof(entry_t));
+        snprintf(e->name, sizeof(e->name), "tag-%d", i);
+        HASH_ADD_STR(table, name, e);
+    }
+
+    for (int i = 0; i < 10000; ++i) {
+        std::string name = "tag-" + std::to_string(i);
+
+        HASH_FIND_STR(table, name.c_str(), e);
+        ASSERT_NE(nullptr, e);
+        EXPECT_EQ(name, e->name);
+    }
+    HASH_FIND_STR(table, "tag-10000", e);
+    EXPECT_EQ(nullptr, e);
+    EXPECT_EQ(0, table->hh.tbl->noexpand);
+
+    HASH_ITER(hh, table, e, tmp)
+    {
+        HASH_DEL(table, e);
+        free(e);
+    }
+}
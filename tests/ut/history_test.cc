@@ -0,0 +1,174 @@
+#include <math.h>
+#include <stdlib.h>
+
+#include <gtest/gtest.h>
+
+#include "utils/history.h"
+#include "utils/log.h"
+
+zlog_category_t *neuron = NULL;
+
+static UT_icd point_icd = { sizeof(neu_history_point_t), NULL, NULL, NULL };
+
+TEST(HistoryTest, round_trip)
+{
+    neu_history_t *history = neu_history_new(64 * 1024);
+    UT_array *     points  = NULL;
+    int64_t        ts      = 1700000000000;
+    double         values[1000];
+
+    srand(7);
+    for (int i = 0; i < 1000; i++) {
+        // steady, jittered and jumping intervals, repeated and random values
+        ts += i % 100 == 0 ? 86400000 : 500 + rand() % 3000;
+        values[i] = i % 3 == 0 ? values[i > 0 ? i - 1 : 0]
+                               : (double) rand() / 7 - (i % 7) * 1e9;
+        if (i == 0) {
+            values[i] = -0.0;
+        }
+        EXPECT_EQ(0, neu_history_append(history, ts, values[i]));
+    }
+    EXPECT_EQ(-1, neu_history_append(history, ts - 1, 1));
+    EXPECT_EQ(-1, neu_history_append(history, ts, NAN));
+
+    utarray_new(points, &point_icd);
+    EXPECT_EQ(0, neu_history_query(history, 0, INT64_MAX, 0, 2000, points));
+    ASSERT_EQ(1000U, utarray_len(points));
+    for (int i = 0; i < 1000; i++) {
+        neu_history_point_t *p =
+            (neu_history_point_t *) utarray_eltptr(points, i);
+        EXPECT_EQ(1U, p->count);
+        EXPECT_EQ(0, memcmp(&values[i], &p->last, sizeof(double)));
+    }
+    EXPECT_EQ(ts,
+              ((neu_history_point_t *) utarray_back(points))->timestamp);
+
+    utarray_clear(points);
+    EXPECT_EQ(1, neu_history_query(history, 0, INT64_MAX, 0, 10, points));
+    EXPECT_EQ(10U, utarray_len(points));
+
+    utarray_free(points);
+    neu_history_free(history);
+}
+
+TEST(HistoryTest, compression)
+{
+    neu_history_t *history = neu_history_new(4096);
+
+    // a tag read every second that changes now and then
+    for (int i = 0; i < 10000; i++) {
+        neu_history_append(history, 1700000000000 + i * 1000, i / 100);
+    }
+    // 10000 samples of 16 bytes each fit into 4 KiB
+    EXPECT_LE(neu_history_size(history), 4096U + 1024U);
+
+    UT_array *points = NULL;
+    utarray_new(points, &point_icd);
+    EXPECT_EQ(0, neu_history_query(history, 0, INT64_MAX, 0, 20000, points));
+    EXPECT_EQ(10000U, utarray_len(points));
+    utarray_free(points);
+
+    neu_history_free(history);
+}
+
+TEST(HistoryTest, ring)
+{
+    neu_history_t *history = neu_history_new(0);
+    UT_array *     points  = NULL;
+
+    for (int i = 0; i < 100000; i++) {
+        neu_history_append(history, i, rand());
+    }
+    neu_history_append(history, 100000, 42);
+
+    // only the newest two blocks are kept
+    utarray_new(points, &point_icd);
+    EXPECT_EQ(0, neu_history_query(history, 0, INT64_MAX, 0, 100000, points));
+    EXPECT_GT(utarray_len(points), 0U);
+    EXPECT_LT(utarray_len(points), 1000U);
+    EXPECT_EQ(42, ((neu_history_point_t *) utarray_back(points))->last);
+    EXPECT_EQ(100000,
+              ((neu_history_point_t *) utarray_back(points))->timestamp);
+
+    utarray_free(points);
+    neu_history_free(history);
+}
+
+TEST(HistoryTest, shrink)
+{
+    neu_history_t *history = neu_history_new(64 * 1024);
+    UT_array *     points  = NULL;
+
+    for (int i = 0; i < 100000; i++) {
+        neu_history_append(history, i, rand());
+    }
+    neu_history_append(history, 100000, 42);
+
+    size_t size = neu_history_size(history);
+    EXPECT_GT(size, 32U * 1024U);
+    EXPECT_EQ(0U, neu_history_shrink(history, 128 * 1024));
+    EXPECT_EQ(size - neu_history_size(history),
+              neu_history_shrink(history, 8 * 1024));
+    EXPECT_LE(neu_history_size(history), 8U * 1024U);
+
+    // the newest samples are kept and appends go on from them
+    EXPECT_EQ(0, neu_history_append(history, 100001, 43));
+    utarray_new(points, &point_icd);
+    EXPECT_EQ(0, neu_history_query(history, 0, INT64_MAX, 0, 100000, points));
+    EXPECT_GT(utarray_len(points), 0U);
+    EXPECT_EQ(43, ((neu_history_point_t *) utarray_back(points))->last);
+    EXPECT_EQ(100001,
+              ((neu_history_point_t *) utarray_back(points))->timestamp);
+    int64_t ts = -1;
+    for (unsigned i = 0; i < utarray_len(points); i++) {
+        neu_history_point_t *p =
+            (neu_history_point_t *) utarray_eltptr(points, i);
+        EXPECT_GT(p->timestamp, ts);
+        ts = p->timestamp;
+    }
+
+    utarray_free(points);
+    neu_history_free(history);
+}
+
+TEST(HistoryTest, downsample)
+{
+    neu_history_t *history = neu_history_new(64 * 1024);
+    UT_array *     points  = NULL;
+
+    // 0..59 once a second over two minutes
+    for (int i = 0; i < 120; i++) {
+        neu_history_append(history, 60000 + i * 1000, i % 60);
+    }
+
+    utarray_new(points, &point_icd);
+    EXPECT_EQ(0,
+              neu_history_query(history, 90000, 180000, 60000, 10, points));
+    ASSERT_EQ(2U, utarray_len(points));
+
+    neu_history_point_t *p = (neu_history_point_t *) utarray_eltptr(points, 0);
+    EXPECT_EQ(60000, p->timestamp);
+    EXPECT_EQ(30U, p->count);
+    EXPECT_EQ(30, p->min);
+    EXPECT_EQ(59, p->max);
+    EXPECT_DOUBLE_EQ(44.5, p->avg);
+    EXPECT_EQ(59, p->last);
+
+    p = (neu_history_point_t *) utarray_eltptr(points, 1);
+    EXPECT_EQ(120000, p->timestamp);
+    EXPECT_EQ(60U, p->count);
+    EXPECT_EQ(0, p->min);
+    EXPECT_EQ(59, p->max);
+
+    utarray_clear(points);
+    EXPECT_EQ(1,
+              neu_history_query(history, 90000, 180000, 60000, 1, points));
+    EXPECT_EQ(1U, utarray_len(points));
+
+    utarray_clear(points);
+    EXPECT_EQ(0, neu_history_query(history, 0, 60000, 1000, 10, points));
+    EXPECT_EQ(0U, utarray_len(points));
+
+    utarray_free(points);
+    neu_history_free(history);
+}
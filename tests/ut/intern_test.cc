@@ -0,0 +1,61 @@
+#include <stdio.h>
+#include <string.h>
+
+#include <gtest/gtest.h>
+
+#include "utils/intern.h"
+#include "utils/log.h"
+
+zlog_category_t *neuron = NULL;
+
+TEST(intern_test, same_name)
+{
+    char     name[] = "intern-same";
+    uint32_t id     = neu_intern("intern-same");
+
+    EXPECT_NE(0, id);
+    EXPECT_EQ(id, neu_intern(name));
+    EXPECT_EQ(neu_intern_name("intern-same"), neu_intern_name(name));
+    EXPECT_EQ(neu_intern_str(id), neu_intern_name(name));
+    EXPECT_STREQ("intern-same", neu_intern_str(id));
+}
+
+TEST(intern_test, distinct_name)
+{
+    uint32_t id1 = neu_intern("intern-a");
+    uint32_t id2 = neu_intern("intern-b");
+
+    EXPECT_NE(0, id1);
+    EXPECT_NE(0, id2);
+    EXPECT_NE(id1, id2);
+    EXPECT_STREQ("intern-a", neu_intern_str(id1));
+    EXPECT_STREQ("intern-b", neu_intern_str(id2));
+    EXPECT_NE(neu_intern_name("intern-a"), neu_intern_name("intern-b"));
+}
+
+TEST(intern_test, invalid)
+{
+    EXPECT_EQ(0, neu_intern(NULL));
+    EXPECT_EQ(NULL, neu_intern_name(NULL));
+    EXPECT_EQ(NULL, neu_intern_str(0));
+    EXPECT_EQ(NULL, neu_intern_str(UINT32_MAX));
+    EXPECT_STREQ("", neu_intern_name(""));
+}
+
+TEST(intern_test, grow)
+{
+    static uint32_t ids[5000] = { 0 };
+    char            name[32]  = { 0 };
+
+    for (int i = 0; i < 5000; ++i) {
+        snprintf(name, sizeof(name), "intern-grow-%d", i);
+        ids[i] = neu_intern(name);
+        ASSERT_NE(0, ids[i]);
+    }
+
+    for (int i = 0; i < 5000; ++i) {
+        snprintf(name, sizeof(name), "intern-grow-%d", i);
+        EXPECT_EQ(ids[i], neu_intern(name));
+        EXPECT_STREQ(name, neu_intern_str(ids[i]));
+    }
+}
@@ -1,6 +1,11 @@
 #include <gtest/gtest.h>
 
 #include "json/json.h"
+#include "json/neu_json_fn.h"
+#include "json/neu_json_rw.h"
+#include "json/neu_json_stream.h"
+#include "msg.h"
+#include "utils/utextend.h"
 
 #include "utils/log.h"
 
@@ -245,6 +250,234 @@ TEST(JsonTest, EncodeArray)
     neu_json_decode_free(ob);
 }
 
+static char *encode_upload_tree(neu_json_read_periodic_t *header,
+                                UT_array *tags, bool values)
+{
+    neu_json_read_resp_t json   = { 0 };
+    char *               result = NULL;
+    int                  i      = 0;
+
+    json.n_tag = utarray_len(tags);
+    json.tags  = (neu_json_read_resp_tag_t *) calloc(
+        json.n_tag, sizeof(neu_json_read_resp_tag_t));
+    utarray_foreach(tags, neu_resp_tag_value_meta_t *, tag)
+    {
+        neu_tag_value_to_json(tag, &json.tags[i++]);
+    }
+
+    neu_json_encode_with_mqtt(
+        &json, values ? neu_json_encode_read_resp1 : neu_json_encode_read_resp,
+        header, neu_json_encode_read_periodic_resp, &result);
+
+    for (i = 0; i < json.n_tag; i++) {
+        free(json.tags[i].metas);
+    }
+    free(json.tags);
+    return result;
+}
+
+TEST(JsonTest, StreamUploadMatchesTree)
+{
+    UT_icd    icd  = { sizeof(neu_resp_tag_value_meta_t), NULL, NULL, NULL };
+    UT_array *tags = NULL;
+    neu_resp_tag_value_meta_t tag    = { 0 };
+    neu_json_stream_t         stream = { 0 };
+    neu_json_read_periodic_t  header = {
+        .group     = (char *) "group",
+        .node      = (char *) "node",
+        .timestamp = 1700000000000,
+    };
+
+    utarray_new(tags, &icd);
+    tag.tag             = "int";
+    tag.value.type      = NEU_TYPE_INT32;
+    tag.value.value.i32 = -123456;
+    utarray_push_back(tags, &tag);
+
+    memset(&tag, 0, sizeof(tag));
+    tag.tag             = "float";
+    tag.value.type      = NEU_TYPE_FLOAT;
+    tag.value.value.f32 = 1.1f;
+    utarray_push_back(tags, &tag);
+
+    memset(&tag, 0, sizeof(tag));
+    tag.tag             = "double";
+    tag.value.type      = NEU_TYPE_DOUBLE;
+    tag.value.value.d64 = 1e20;
+    utarray_push_back(tags, &tag);
+
+    memset(&tag, 0, sizeof(tag));
+    tag.tag             = "error";
+    tag.value.type      = NEU_TYPE_ERROR;
+    tag.value.value.i32 = 3002;
+    utarray_push_back(tags, &tag);
+
+    memset(&tag, 0, sizeof(tag));
+    tag.tag        = "str\"ing";
+    tag.value.type = NEU_TYPE_STRING;
+    strcpy(tag.value.value.str, "line\n\ttab");
+    strcpy(tag.metas[0].name, "unit");
+    tag.metas[0].value.type = NEU_TYPE_STRING;
+    strcpy(tag.metas[0].value.value.str, "m/s");
+    strcpy(tag.metas[1].name, "on");
+    tag.metas[1].value.type          = NEU_TYPE_BOOL;
+    tag.metas[1].value.value.boolean = true;
+    utarray_push_back(tags, &tag);
+
+    memset(&tag, 0, sizeof(tag));
+    tag.tag                        = "bytes";
+    tag.value.type                 = NEU_TYPE_BYTES;
+    tag.value.value.bytes.length   = 3;
+    tag.value.value.bytes.bytes[0] = 1;
+    tag.value.value.bytes.bytes[2] = 255;
+    utarray_push_back(tags, &tag);
+
+    for (int values = 0; values < 2; values++) {
+        char *expect = encode_upload_tree(&header, tags, values);
+
+        neu_json_stream_reset(&stream);
+        if (values) {
+            EXPECT_EQ(0,
+                      neu_json_stream_read_periodic_resp1(&stream, &header,
+                                                          tags));
+        } else {
+            EXPECT_EQ(0,
+                      neu_json_stream_read_periodic_resp(&stream, &header,
+                                                         tags));
+        }
+        EXPECT_STREQ(expect, stream.buf);
+        free(expect);
+    }
+
+    neu_json_stream_fini(&stream);
+    utarray_free(tags);
+}
+
+TEST(JsonTest, DecodeWriteScan)
+{
+    neu_json_write_t *req = NULL;
+    char *            buf =
+        (char *) " {\"node\": \"n\\u00e9\", \"group\": \"g\","
+                 " \"x\": [{}, null], \"tag\": \"t\\ud83d\\ude00\","
+                 " \"value\": [1, 2, 255], \"preempt\": true} ";
+
+    ASSERT_EQ(0, neu_json_decode_write(buf, &req));
+    EXPECT_TRUE(req->singular);
+    EXPECT_STREQ("n\xc3\xa9", req->single.node);
+    EXPECT_STREQ("g", req->single.group);
+    EXPECT_STREQ("t\xf0\x9f\x98\x80", req->single.tag);
+    EXPECT_EQ(NEU_JSON_BYTES, req->single.t);
+    EXPECT_EQ(3, req->single.value.val_bytes.length);
+    EXPECT_EQ(255, req->single.value.val_bytes.bytes[2]);
+    EXPECT_TRUE(req->single.preempt);
+    neu_json_decode_write_free(req);
+
+    buf = (char *) "{\"node\": \"n\", \"group\": \"g\", \"tags\": ["
+                   "{\"tag\": \"a\", \"value\": -12}, "
+                   "{\"value\": 1.5e2, \"tag\": \"b\"}, "
+                   "{\"tag\": \"c\", \"value\": \"s\\\"\\n\"}, "
+                   "{\"tag\": \"d\", \"value\": false}]}";
+    ASSERT_EQ(0, neu_json_decode_write(buf, &req));
+    EXPECT_FALSE(req->singular);
+    ASSERT_EQ(4, req->plural.n_tag);
+    EXPECT_EQ(NEU_JSON_INT, req->plural.tags[0].t);
+    EXPECT_EQ(-12, req->plural.tags[0].value.val_int);
+    EXPECT_EQ(NEU_JSON_DOUBLE, req->plural.tags[1].t);
+    EXPECT_EQ(150.0, req->plural.tags[1].value.val_double);
+    EXPECT_EQ(NEU_JSON_STR, req->plural.tags[2].t);
+    EXPECT_STREQ("s\"\n", req->plural.tags[2].value.val_str);
+    EXPECT_EQ(NEU_JSON_BOOL, req->plural.tags[3].t);
+    EXPECT_FALSE(req->plural.tags[3].value.val_bool);
+    EXPECT_FALSE(req->plural.preempt);
+    neu_json_decode_write_free(req);
+}
+
+TEST(JsonTest, DecodeWriteScanFallback)
+{
+    neu_json_write_t *    req    = NULL;
+    neu_json_write_req_t *single = NULL;
+    neu_json_read_req_t * read   = NULL;
+
+    // duplicate members keep the last value, as jansson does
+    char *buf = (char *) "{\"node\": \"a\", \"node\": \"b\", \"group\": \"g\","
+                         " \"tag\": \"t\", \"value\": 1}";
+    ASSERT_EQ(0, neu_json_decode_write(buf, &req));
+    EXPECT_STREQ("b", req->single.node);
+    neu_json_decode_write_free(req);
+
+    // escaped keys
+    buf = (char *) "{\"no\\u0064e\": \"n\", \"group\": \"g\", \"tag\": \"t\","
+                   " \"value\": 1}";
+    ASSERT_EQ(0, neu_json_decode_write_req(buf, &single));
+    EXPECT_STREQ("n", single->node);
+    neu_json_decode_write_req_free(single);
+
+    // "tags" wins over "tag" and "value" for the plural request only
+    buf = (char *) "{\"node\": \"n\", \"group\": \"g\", \"tag\": \"t\","
+                   " \"value\": 1, \"tags\": [{\"tag\": \"a\", \"value\": 2}]}";
+    ASSERT_EQ(0, neu_json_decode_write_req(buf, &single));
+    EXPECT_STREQ("t", single->tag);
+    EXPECT_EQ(1, single->value.val_int);
+    neu_json_decode_write_req_free(single);
+
+    buf = (char *) "{\"node\": \"n\", \"group\": \"g\", \"tag\": \"t\","
+                   " \"value\": \"a\\u0000b\"}";
+    EXPECT_NE(0, neu_json_decode_write(buf, &req));
+    buf = (char *) "{\"node\": \"n\", \"group\": \"g\", \"tag\": \"t\","
+                   " \"value\": 1} x";
+    EXPECT_NE(0, neu_json_decode_write(buf, &req));
+    buf = (char *) "{\"node\": \"n\", \"group\": \"g\", \"tags\": []}";
+    EXPECT_NE(0, neu_json_decode_write(buf, &req));
+
+    buf = (char *) "{\"node\": \"n\", \"group\": \"g\", \"sync\": true,"
+                   " \"max_age\": 100}";
+    ASSERT_EQ(0, neu_json_decode_read_req(buf, &read));
+    EXPECT_TRUE(read->sync);
+    EXPECT_EQ(100, read->max_age);
+    neu_json_decode_read_req_free(read);
+
+    buf = (char *) "{\"node\": \"n\", \"group\": \"g\", \"max_age\": -1}";
+    EXPECT_NE(0, neu_json_decode_read_req(buf, &read));
+}
+
+TEST(JsonTest, DecodeWriteBatch)
+{
+    neu_json_write_batch_req_t *req = NULL;
+
+    char *buf = (char *) "{\"preempt\": true, \"nodes\": ["
+                         "{\"node\": \"a\", \"groups\": [{\"group\": \"g\","
+                         " \"tags\": [{\"tag\": \"t\", \"value\": 1}]}]},"
+                         "{\"node\": \"b\", \"groups\": [{\"group\": \"h\","
+                         " \"tags\": [{\"tag\": \"u\", \"value\": \"s\"}]}]}]}";
+    ASSERT_EQ(0, neu_json_decode_write_batch_req(buf, &req));
+    ASSERT_EQ(2, req->n_node);
+    EXPECT_STREQ("a", req->nodes[0].node);
+    EXPECT_STREQ("b", req->nodes[1].node);
+    EXPECT_TRUE(req->nodes[1].preempt);
+    EXPECT_STREQ("s", req->nodes[1].groups[0].tags[0].value.val_str);
+    neu_json_decode_write_batch_req_free(req);
+
+    // a broken node fails the whole batch
+    buf = (char *) "{\"nodes\": [{\"node\": \"a\", \"groups\": [{\"group\":"
+                   " \"g\", \"tags\": [{\"tag\": \"t\", \"value\": 1}]}]},"
+                   " {\"node\": \"b\", \"groups\": []}]}";
+    EXPECT_NE(0, neu_json_decode_write_batch_req(buf, &req));
+    buf = (char *) "{\"nodes\": []}";
+    EXPECT_NE(0, neu_json_decode_write_batch_req(buf, &req));
+
+    neu_json_write_batch_node_t nodes[] = { { (char *) "a", 0 },
+                                            { (char *) "b", 2003 } };
+    neu_json_write_batch_resp_t resp    = { 2003, 2, nodes };
+    char *                      result  = NULL;
+    ASSERT_EQ(0,
+              neu_json_encode_by_fn(&resp, neu_json_encode_write_batch_resp,
+                                    &result));
+    EXPECT_STREQ("{\"error\": 2003, \"nodes\": [{\"node\": \"a\","
+                 " \"error\": 0}, {\"node\": \"b\", \"error\": 2003}]}",
+                 result);
+    free(result);
+}
+
 int main(int argc, char **argv)
 {
     zlog_init("./config/dev.conf");
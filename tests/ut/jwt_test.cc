@@ -34,6 +34,28 @@ TEST(JwtTest, JwtValidate)
 
     jwt_free_str(token);
 }
+
+TEST(JwtTest, JwtValidateCached)
+{
+    char *token         = NULL;
+    char  b_token[1024] = { 0 };
+
+    EXPECT_EQ(0, neu_jwt_init((char *) "./config"));
+    EXPECT_EQ(0, neu_jwt_new(&token));
+
+    snprintf(b_token, sizeof(b_token), "Bearer %s", token);
+
+    EXPECT_EQ(0, neu_jwt_validate(b_token));
+    EXPECT_EQ(0, neu_jwt_validate(b_token));
+
+    // a cached token does not let a tampered signature pass
+    size_t len       = strlen(b_token);
+    b_token[len - 2] = b_token[len - 2] == 'A' ? 'B' : 'A';
+    EXPECT_NE(0, neu_jwt_validate(b_token));
+
+    jwt_free_str(token);
+}
+
 int main(int argc, char **argv)
 {
     zlog_init("./config/dev.conf");
@@ -0,0 +1,134 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "utils/log.h"
+#include "utils/log_async.h"
+
+zlog_category_t *neuron = NULL;
+
+static void record(const std::string &level, const std::string &path,
+                   const char *line)
+{
+    std::string spec = level + " " + path;
+    zlog_msg_t  msg  = {
+        .buf  = (char *) line,
+        .len  = strlen(line),
+        .path = (char *) spec.c_str(),
+    };
+
+    EXPECT_EQ(0, neu_log_async_record(&msg));
+}
+
+static std::string slurp(const std::string &path)
+{
+    std::string data;
+    char        buf[4096];
+    FILE *      fp = fopen(path.c_str(), "r");
+    size_t      n  = 0;
+
+    if (fp == NULL) {
+        return data;
+    }
+    while ((n = fread(buf, 1, sizeof(buf), fp)) > 0) {
+        data.append(buf, n);
+    }
+    fclose(fp);
+    return data;
+}
+
+static size_t count_lines(const std::string &data)
+{
+    size_t n = 0;
+    for (char c : data) {
+        n += c == '\n';
+    }
+    return n;
+}
+
+static std::string temp_dir()
+{
+    char tmpl[] = "/tmp/log_async_XXXXXX";
+    EXPECT_NE(nullptr, mkdtemp(tmpl));
+    return tmpl;
+}
+
+TEST(log_async, write_lines_to_their_files)
+{
+    std::string dir = temp_dir();
+
+    // zlog is not initialized, only the record is not registered
+    neu_log_async_init(NEU_LOG_OVERFLOW_DROP_DEBUG);
+    record("NOTICE", dir + "/neuron.log", "a\n");
+    record("DEBUG", dir + "/modbus.log", "b\n");
+    record("WARN", dir + "/neuron.log", "c\n");
+    neu_log_async_fini();
+
+    EXPECT_EQ("a\nc\n", slurp(dir + "/neuron.log"));
+    EXPECT_EQ("b\n", slurp(dir + "/modbus.log"));
+}
+
+TEST(log_async, reject_records_without_a_path)
+{
+    zlog_msg_t msg = { .buf = (char *) "a\n", .len = 2, .path = (char *) "" };
+
+    EXPECT_EQ(-1, neu_log_async_record(&msg));
+}
+
+TEST(log_async, drop_debug_first_when_the_ring_fills)
+{
+    std::string dir     = temp_dir();
+    uint64_t    dropped = 0;
+
+    // with the writer stopped nothing leaves the ring of 2048 lines
+    neu_log_async_init(NEU_LOG_OVERFLOW_DROP_DEBUG);
+    neu_log_async_fini();
+
+    dropped = neu_log_async_dropped();
+    for (int i = 0; i < 4096; ++i) {
+        record("DEBUG", dir + "/neuron.log", "debug\n");
+    }
+    // the last quarter of the ring is kept for the more severe lines
+    EXPECT_EQ(dropped + 4096 - 1536, neu_log_async_dropped());
+
+    dropped = neu_log_async_dropped();
+    for (int i = 0; i < 1000; ++i) {
+        record("ERROR", dir + "/neuron.log", "error\n");
+    }
+    EXPECT_EQ(dropped + 1000 - 512, neu_log_async_dropped());
+
+    neu_log_async_start();
+    neu_log_async_fini();
+    EXPECT_EQ(2048u, count_lines(slurp(dir + "/neuron.log")));
+}
+
+TEST(log_async, truncate_long_lines)
+{
+    std::string dir = temp_dir();
+    std::string line(4000, 'x');
+
+    line += "\n";
+    neu_log_async_init(NEU_LOG_OVERFLOW_DROP_NEW);
+    record("INFO", dir + "/neuron.log", line.c_str());
+    neu_log_async_fini();
+
+    std::string data = slurp(dir + "/neuron.log");
+    EXPECT_GT(data.size(), 0u);
+    EXPECT_LT(data.size(), line.size());
+    EXPECT_EQ('\n', data.back());
+}
+
+TEST(log_async, parse_overflow)
+{
+    neu_log_overflow_e overflow = NEU_LOG_OVERFLOW_DROP_DEBUG;
+
+    EXPECT_EQ(0, neu_log_overflow_parse("drop_new", &overflow));
+    EXPECT_EQ(NEU_LOG_OVERFLOW_DROP_NEW, overflow);
+    EXPECT_EQ(0, neu_log_overflow_parse("drop_debug", &overflow));
+    EXPECT_EQ(NEU_LOG_OVERFLOW_DROP_DEBUG, overflow);
+    EXPECT_EQ(-1, neu_log_overflow_parse("block", &overflow));
+}
@@ -0,0 +1,134 @@
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "utils/log.h"
+#include "utils/log_filter.h"
+
+zlog_category_t *neuron = NULL;
+
+static const char *lines =
+    "2024-01-31 08:00:00:100 [DEBUG] a.c:1 poll\n"
+    "2024-01-31 08:00:01:200 [WARN] a.c:2 slow device\n"
+    "  continued detail\n"
+    "2024-01-31 08:00:02:300 [INFO] a.c:3 poll done\n"
+    "2024-01-31 08:00:03:400 [ERROR] a.c:4 device lost\n";
+
+// local time, as zlog stamps the lines
+static int64_t stamp(int sec, int ms)
+{
+    struct tm tm = { 0 };
+
+    tm.tm_year  = 2024 - 1900;
+    tm.tm_mon   = 0;
+    tm.tm_mday  = 31;
+    tm.tm_hour  = 8;
+    tm.tm_sec   = sec;
+    tm.tm_isdst = -1;
+    return (int64_t) mktime(&tm) * 1000 + ms;
+}
+
+static int collect(void *arg, const char *data, size_t len)
+{
+    ((std::string *) arg)->append(data, len);
+    return 0;
+}
+
+static std::string filter(neu_log_filter_t *f, const char *data)
+{
+    std::string out;
+
+    EXPECT_EQ((ssize_t) strlen(data),
+              neu_log_filter(f, data, strlen(data), collect, &out));
+    return out;
+}
+
+TEST(LogFilterTest, level_and_match)
+{
+    neu_log_filter_t f;
+
+    neu_log_filter_init(&f, 0, 0, 0, NULL);
+    EXPECT_EQ(lines, filter(&f, lines));
+
+    // the continuation line follows its message
+    neu_log_filter_init(&f, ZLOG_LEVEL_WARN, 0, 0, NULL);
+    EXPECT_EQ("2024-01-31 08:00:01:200 [WARN] a.c:2 slow device\n"
+              "  continued detail\n"
+              "2024-01-31 08:00:03:400 [ERROR] a.c:4 device lost\n",
+              filter(&f, lines));
+
+    neu_log_filter_init(&f, 0, 0, 0, "poll");
+    EXPECT_EQ("2024-01-31 08:00:00:100 [DEBUG] a.c:1 poll\n"
+              "2024-01-31 08:00:02:300 [INFO] a.c:3 poll done\n",
+              filter(&f, lines));
+}
+
+TEST(LogFilterTest, time_range)
+{
+    neu_log_filter_t f;
+
+    neu_log_filter_init(&f, 0, stamp(1, 0), stamp(3, 0), NULL);
+    EXPECT_EQ("2024-01-31 08:00:01:200 [WARN] a.c:2 slow device\n"
+              "  continued detail\n"
+              "2024-01-31 08:00:02:300 [INFO] a.c:3 poll done\n",
+              filter(&f, lines));
+    EXPECT_TRUE(f.done);
+
+    neu_log_filter_init(&f, 0, stamp(3, 400), 0, NULL);
+    EXPECT_EQ("2024-01-31 08:00:03:400 [ERROR] a.c:4 device lost\n",
+              filter(&f, lines));
+
+    neu_log_filter_init(&f, 0, stamp(9, 0), 0, NULL);
+    EXPECT_EQ("", filter(&f, lines));
+}
+
+TEST(LogFilterTest, partial_line)
+{
+    neu_log_filter_t f;
+    std::string      out;
+    const char *     data = "2024-01-31 08:00:00:100 [INFO] a.c:1 x\n"
+                       "2024-01-31 08:00:00:200 [IN";
+
+    neu_log_filter_init(&f, 0, 0, 0, NULL);
+    EXPECT_EQ(39, neu_log_filter(&f, data, strlen(data), collect, &out));
+    EXPECT_EQ("2024-01-31 08:00:00:100 [INFO] a.c:1 x\n", out);
+}
+
+TEST(LogFilterTest, files)
+{
+    mkdir("log_filter_test.d", 0755);
+    const char *names[] = { "log_filter_test.d/n.log",
+                            "log_filter_test.d/n.01.log",
+                            "log_filter_test.d/n.00.log",
+                            "log_filter_test.d/nn.log",
+                            "log_filter_test.d/n.x.log" };
+    for (const char *name : names) {
+        FILE *fp = fopen(name, "w");
+        ASSERT_NE(nullptr, fp);
+        fclose(fp);
+    }
+
+    UT_array *files = neu_log_files("log_filter_test.d", "n");
+    ASSERT_EQ(3, utarray_len(files));
+    EXPECT_STREQ("log_filter_test.d/n.01.log",
+                 *(char **) utarray_eltptr(files, 0));
+    EXPECT_STREQ("log_filter_test.d/n.00.log",
+                 *(char **) utarray_eltptr(files, 1));
+    EXPECT_STREQ("log_filter_test.d/n.log",
+                 *(char **) utarray_eltptr(files, 2));
+    utarray_free(files);
+
+    files = neu_log_files("log_filter_test.d", "missing");
+    EXPECT_EQ(0, utarray_len(files));
+    utarray_free(files);
+
+    for (const char *name : names) {
+        remove(name);
+    }
+    rmdir("log_filter_test.d");
+}
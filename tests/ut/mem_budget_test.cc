@@ -0,0 +1,57 @@
+#include <gtest/gtest.h>
+
+#include "utils/log.h"
+#include "utils/mem_budget.h"
+
+zlog_category_t *neuron = NULL;
+
+TEST(MemBudgetTest, policy_parse)
+{
+    uint32_t policies = 0;
+
+    EXPECT_EQ(0, neu_mem_policy_parse("drop_oldest", &policies));
+    EXPECT_EQ((uint32_t) NEU_MEM_DROP_OLDEST, policies);
+    EXPECT_EQ(0, neu_mem_policy_parse("shrink_history,reject_subscribe",
+                                      &policies));
+    EXPECT_EQ((uint32_t)(NEU_MEM_SHRINK_HISTORY | NEU_MEM_REJECT_SUBSCRIBE),
+              policies);
+    EXPECT_EQ(0, neu_mem_policy_parse("none", &policies));
+    EXPECT_EQ(0U, policies);
+
+    policies = NEU_MEM_DROP_OLDEST;
+    EXPECT_EQ(-1, neu_mem_policy_parse("", &policies));
+    EXPECT_EQ(-1, neu_mem_policy_parse("drop_oldest,", &policies));
+    EXPECT_EQ(-1, neu_mem_policy_parse("drop", &policies));
+    EXPECT_EQ(-1, neu_mem_policy_parse("drop_oldest,none", &policies));
+    EXPECT_EQ((uint32_t) NEU_MEM_DROP_OLDEST, policies);
+}
+
+TEST(MemBudgetTest, account)
+{
+    size_t a = 0;
+    size_t b = 0;
+
+    neu_mem_budget_set(0, NEU_MEM_POLICY_ALL);
+    neu_mem_budget_account(&a, 600);
+    neu_mem_budget_account(&b, 300);
+    EXPECT_EQ(900U, neu_mem_budget_used());
+    // no budget, never over
+    EXPECT_FALSE(neu_mem_budget_over());
+
+    neu_mem_budget_set(1000, NEU_MEM_DROP_OLDEST);
+    EXPECT_EQ(1000U, neu_mem_budget_limit());
+    EXPECT_EQ((uint32_t) NEU_MEM_DROP_OLDEST, neu_mem_budget_policies());
+    EXPECT_FALSE(neu_mem_budget_over());
+
+    neu_mem_budget_account(&a, 800);
+    EXPECT_EQ(800U, a);
+    EXPECT_EQ(1100U, neu_mem_budget_used());
+    EXPECT_TRUE(neu_mem_budget_over());
+
+    neu_mem_budget_account(&b, 0);
+    EXPECT_EQ(800U, neu_mem_budget_used());
+    EXPECT_FALSE(neu_mem_budget_over());
+
+    neu_mem_budget_account(&a, 0);
+    EXPECT_EQ(0U, neu_mem_budget_used());
+}
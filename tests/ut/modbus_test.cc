@@ -4,6 +4,7 @@
 extern "C" {
 #include "modbus.h"
 #include "modbus_point.h"
+#include "modbus_rtt.h"
 }
 
 zlog_category_t *neuron           = NULL;
@@ -154,10 +155,293 @@ TEST(test_modbus_data_unwrap, should_return_right_data_value)
     EXPECT_EQ(0x44, *(bytes + 3));
 }
 
+static UT_array *hold_points(modbus_point_t *points, int n)
+{
+    UT_array *tags = NULL;
+
+    utarray_new(tags, &ut_ptr_icd);
+    for (int i = 0; i < n; i++) {
+        modbus_point_t *p = &points[i];
+        utarray_push_back(tags, &p);
+    }
+    return tags;
+}
+
+TEST(test_modbus_tag_sort, should_read_gaps_up_to_max_gap)
+{
+    modbus_point_t points[3] = { 0 };
+    for (int i = 0; i < 3; i++) {
+        points[i].slave_id   = 1;
+        points[i].area       = MODBUS_AREA_HOLD_REGISTER;
+        points[i].n_register = 1;
+    }
+    points[1].start_address = 5;
+    points[2].start_address = 20;
+    UT_array *tags          = hold_points(points, 3);
+
+    modbus_read_cmd_sort_t *cs = modbus_tag_sort(tags, 0xfa, 0);
+    EXPECT_EQ(3, cs->n_cmd);
+    modbus_tag_sort_free(cs);
+
+    cs = modbus_tag_sort(tags, 0xfa, 4);
+    EXPECT_EQ(2, cs->n_cmd);
+    EXPECT_EQ(0, cs->cmd[0].start_address);
+    EXPECT_EQ(6, cs->cmd[0].n_register);
+    modbus_tag_sort_free(cs);
+
+    cs = modbus_tag_sort(tags, 0xfa, 20);
+    EXPECT_EQ(1, cs->n_cmd);
+    EXPECT_EQ(21, cs->cmd[0].n_register);
+
+    cs->cmd[0].rejected = true;
+    modbus_tag_sort_split(cs);
+    EXPECT_EQ(3, cs->n_cmd);
+    EXPECT_EQ(5, cs->cmd[1].start_address);
+    EXPECT_EQ(1, cs->cmd[1].n_register);
+    EXPECT_EQ(1U, utarray_len(cs->cmd[2].tags));
+    modbus_tag_sort_free(cs);
+
+    utarray_free(tags);
+}
+
+TEST(test_modbus_tag_sort, should_halve_rejected_contiguous_reads)
+{
+    modbus_point_t points[4] = { 0 };
+    for (int i = 0; i < 4; i++) {
+        points[i].slave_id      = 1;
+        points[i].area          = MODBUS_AREA_HOLD_REGISTER;
+        points[i].start_address = i * 2;
+        points[i].n_register    = 2;
+    }
+    UT_array *tags = hold_points(points, 4);
+
+    modbus_read_cmd_sort_t *cs = modbus_tag_sort(tags, 0xfa, 0);
+    ASSERT_EQ(1, cs->n_cmd);
+    EXPECT_EQ(8, cs->cmd[0].n_register);
+
+    cs->cmd[0].rejected = true;
+    modbus_tag_sort_split(cs);
+    ASSERT_EQ(2, cs->n_cmd);
+    EXPECT_EQ(0, cs->cmd[0].start_address);
+    EXPECT_EQ(4, cs->cmd[0].n_register);
+    EXPECT_EQ(4, cs->cmd[1].start_address);
+    EXPECT_EQ(4, cs->cmd[1].n_register);
+
+    cs->cmd[1].rejected = true;
+    modbus_tag_sort_split(cs);
+    ASSERT_EQ(3, cs->n_cmd);
+    EXPECT_EQ(6, cs->cmd[2].start_address);
+    EXPECT_EQ(2, cs->cmd[2].n_register);
+
+    // a single point is as small as a read gets
+    cs->cmd[2].rejected = true;
+    modbus_tag_sort_split(cs);
+    EXPECT_EQ(3, cs->n_cmd);
+    EXPECT_FALSE(cs->cmd[2].rejected);
+    modbus_tag_sort_free(cs);
+
+    utarray_free(tags);
+}
+
+TEST(test_modbus_tag_sort, should_plan_point_decode)
+{
+    modbus_point_t points[3] = { 0 };
+    for (int i = 0; i < 3; i++) {
+        points[i].slave_id   = 1;
+        points[i].area       = MODBUS_AREA_HOLD_REGISTER;
+        points[i].n_register = 1;
+        points[i].type       = NEU_TYPE_UINT16;
+    }
+    points[1].start_address  = 1;
+    points[1].n_register     = 2;
+    points[1].type           = NEU_TYPE_FLOAT;
+    points[2].start_address  = 3;
+    points[2].type           = NEU_TYPE_BIT;
+    points[2].option.bit.bit = 4;
+    UT_array *tags           = hold_points(points, 3);
+
+    modbus_read_cmd_sort_t *cs = modbus_tag_sort(tags, 0xfa, 0);
+    EXPECT_EQ(1, cs->n_cmd);
+    EXPECT_EQ(MODBUS_DECODE_SWAP16, cs->cmd[0].plan[0].kernel);
+    EXPECT_EQ(MODBUS_DECODE_SWAP32, cs->cmd[0].plan[1].kernel);
+    EXPECT_EQ(2, cs->cmd[0].plan[1].offset);
+    EXPECT_EQ(6, cs->cmd[0].plan[1].end);
+    EXPECT_EQ(MODBUS_DECODE_REGISTER_BIT, cs->cmd[0].plan[2].kernel);
+    EXPECT_EQ(4, cs->cmd[0].plan[2].bit);
+    modbus_tag_sort_free(cs);
+
+    utarray_free(tags);
+}
+
+TEST(test_modbus_tag_sort, should_plan_register_bits_together)
+{
+    modbus_point_t points[4] = { 0 };
+    for (int i = 0; i < 4; i++) {
+        points[i].slave_id   = 1;
+        points[i].area       = MODBUS_AREA_HOLD_REGISTER;
+        points[i].n_register = 1;
+        points[i].type       = NEU_TYPE_BIT;
+    }
+    points[0].option.bit.bit = 7;
+    points[1].type           = NEU_TYPE_UINT16;
+    points[2].option.bit.bit = 3;
+    points[3].start_address  = 1;
+    points[3].option.bit.bit = 1;
+    UT_array *tags           = hold_points(points, 4);
+
+    modbus_read_cmd_sort_t *cs = modbus_tag_sort(tags, 0xfa, 0);
+    ASSERT_EQ(1, cs->n_cmd);
+    const modbus_decode_t *plan = cs->cmd[0].plan;
+    EXPECT_EQ(MODBUS_DECODE_SWAP16, plan[0].kernel);
+    EXPECT_EQ(MODBUS_DECODE_REGISTER_BIT, plan[1].kernel);
+    EXPECT_EQ(3, plan[1].bit);
+    EXPECT_EQ(2, plan[1].n_bit);
+    EXPECT_EQ(7, plan[2].bit);
+    EXPECT_EQ(0, plan[2].n_bit);
+    EXPECT_EQ(2, plan[3].offset);
+    EXPECT_EQ(1, plan[3].n_bit);
+    modbus_tag_sort_free(cs);
+
+    utarray_free(tags);
+}
+
+TEST(test_modbus_tag_sort, should_plan_per_poll_divisor)
+{
+    modbus_point_t points[4] = { 0 };
+    for (int i = 0; i < 4; i++) {
+        points[i].slave_id      = 1;
+        points[i].area          = MODBUS_AREA_HOLD_REGISTER;
+        points[i].start_address = i;
+        points[i].n_register    = 1;
+        points[i].poll_divisor  = 1;
+    }
+    points[1].poll_divisor = 10;
+    points[3].poll_divisor = 10;
+    UT_array *tags         = hold_points(points, 4);
+
+    // adjacent registers are not merged across rates
+    modbus_read_cmd_sort_t *cs = modbus_tag_sort(tags, 0xfa, 1);
+    ASSERT_EQ(2, cs->n_cmd);
+    EXPECT_EQ(1, cs->cmd[0].poll_divisor);
+    EXPECT_EQ(0, cs->cmd[0].start_address);
+    EXPECT_EQ(3, cs->cmd[0].n_register);
+    EXPECT_EQ(10, cs->cmd[1].poll_divisor);
+    EXPECT_EQ(1, cs->cmd[1].start_address);
+    EXPECT_EQ(3, cs->cmd[1].n_register);
+
+    cs->cmd[1].rejected = true;
+    modbus_tag_sort_split(cs);
+    ASSERT_EQ(3, cs->n_cmd);
+    EXPECT_EQ(10, cs->cmd[2].poll_divisor);
+    modbus_tag_sort_free(cs);
+
+    utarray_free(tags);
+}
+
+TEST(test_modbus_tag_sort, should_replan_changed_commands_only)
+{
+    modbus_point_t points[4] = { 0 };
+    for (int i = 0; i < 4; i++) {
+        points[i].slave_id     = 1;
+        points[i].area         = MODBUS_AREA_HOLD_REGISTER;
+        points[i].n_register   = 1;
+        points[i].poll_divisor = 1;
+    }
+    points[1].start_address = 100;
+    points[2].start_address = 200;
+    points[3].start_address = 1;
+    UT_array *tags          = hold_points(points, 3);
+
+    modbus_read_cmd_sort_t *cs = modbus_tag_sort(tags, 0xfa, 0);
+    ASSERT_EQ(3, cs->n_cmd);
+    uint8_t *last      = (uint8_t *) calloc(1, 2);
+    cs->cmd[2].last    = last;
+    cs->cmd[2].n_last  = 2;
+    UT_array *stale    = hold_points(&points[1], 1);
+    UT_array *fresh    = hold_points(&points[3], 1);
+
+    // the point at 1 joins the command at 0, the one at 200 is untouched
+    modbus_tag_sort_update(cs, stale, fresh, 0xfa, 0);
+    ASSERT_EQ(2, cs->n_cmd);
+    EXPECT_EQ(0, cs->cmd[0].start_address);
+    EXPECT_EQ(2, cs->cmd[0].n_register);
+    EXPECT_EQ(2U, utarray_len(cs->cmd[0].tags));
+    EXPECT_EQ(200, cs->cmd[1].start_address);
+    EXPECT_EQ(last, cs->cmd[1].last);
+    modbus_tag_sort_free(cs);
+
+    utarray_free(stale);
+    utarray_free(fresh);
+    utarray_free(tags);
+}
+
+TEST(test_modbus_rtt, should_adapt_timeout_to_response_time)
+{
+    modbus_rtt_t rtt = { 0 };
+
+    for (int i = 0; i < MODBUS_RTT_MIN_SAMPLES - 1; i++) {
+        modbus_rtt_sample(&rtt, 5);
+    }
+    EXPECT_EQ(3000, modbus_rtt_timeout(&rtt, 10, 3000));
+
+    for (int i = MODBUS_RTT_MIN_SAMPLES - 1; i < 99; i++) {
+        modbus_rtt_sample(&rtt, 5);
+    }
+    EXPECT_EQ(6, modbus_rtt_p99(&rtt));
+    uint16_t timeout = modbus_rtt_timeout(&rtt, 10, 3000);
+    EXPECT_GE(timeout, 12);
+    EXPECT_LT(timeout, 50);
+    EXPECT_EQ(50, modbus_rtt_timeout(&rtt, 50, 3000));
+
+    modbus_rtt_miss(&rtt);
+    EXPECT_EQ(timeout * 2, modbus_rtt_timeout(&rtt, 10, 3000));
+    modbus_rtt_sample(&rtt, 5);
+    EXPECT_EQ(timeout, modbus_rtt_timeout(&rtt, 10, 3000));
+
+    modbus_rtt_sample(&rtt, 500);
+    modbus_rtt_sample(&rtt, 500);
+    EXPECT_EQ(512, modbus_rtt_p99(&rtt));
+    EXPECT_GE(modbus_rtt_timeout(&rtt, 10, 3000), 1024);
+}
+
 int main(int argc, char **argv)
 {
     zlog_init("./config/dev.conf");
     neuron = zlog_get_category("neuron");
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
-}
\ No newline at end of file
+}
+TEST(test_modbus_tag_compile, should_keep_parsed_address_in_tag)
+{
+    neu_datatag_t  tag   = { 0 };
+    modbus_point_t point = { 0 };
+
+    tag.name      = (char *) "tag";
+    tag.address   = (char *) "2!400010.10H";
+    tag.type      = NEU_TYPE_STRING;
+    tag.attribute = NEU_ATTRIBUTE_READ;
+
+    EXPECT_FALSE(neu_tag_get_compiled(&tag, &point, 1));
+    EXPECT_EQ(0, modbus_tag_compile(&tag, &point));
+    EXPECT_TRUE(neu_tag_get_compiled(&tag, &point, 1));
+
+    modbus_point_t compiled = { 0 };
+    EXPECT_EQ(0, modbus_tag_to_point(&tag, &compiled));
+    EXPECT_EQ(2, compiled.slave_id);
+    EXPECT_EQ(MODBUS_AREA_HOLD_REGISTER, compiled.area);
+    EXPECT_EQ(9, compiled.start_address);
+    EXPECT_EQ(5, compiled.n_register);
+    EXPECT_EQ(10, compiled.option.string.length);
+    EXPECT_EQ(NEU_DATATAG_STRING_TYPE_H, compiled.option.string.type);
+    EXPECT_STREQ("tag", compiled.name);
+
+    // a changed tag is parsed again
+    tag.address = (char *) "2!400011.10H";
+    EXPECT_FALSE(neu_tag_get_compiled(&tag, &point, 1));
+    EXPECT_EQ(0, modbus_tag_to_point(&tag, &compiled));
+    EXPECT_EQ(10, compiled.start_address);
+
+    tag.address   = (char *) "2!400010.10H";
+    tag.attribute = (neu_attribute_e)(NEU_ATTRIBUTE_READ | NEU_ATTRIBUTE_WRITE);
+    EXPECT_FALSE(neu_tag_get_compiled(&tag, &point, 1));
+}
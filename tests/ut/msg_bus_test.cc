@@ -0,0 +1,154 @@
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+extern "C" {
+#include "base/msg_bus.h"
+#include "utils/log.h"
+}
+
+zlog_category_t *neuron = NULL;
+
+static struct sockaddr_un make_addr(const char *name)
+{
+    struct sockaddr_un addr = {};
+    addr.sun_family         = AF_UNIX;
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%c%s", '\0', name);
+    return addr;
+}
+
+static struct neu_msg_s *fake_msg(uintptr_t v)
+{
+    return reinterpret_cast<struct neu_msg_s *>(v);
+}
+
+TEST(msg_bus_test, disabled)
+{
+    struct sockaddr_un addr = make_addr("bus-disabled");
+    struct neu_msg_s * msg  = NULL;
+
+    EXPECT_FALSE(neu_msg_bus_enabled());
+    EXPECT_EQ(-1, neu_msg_bus_bind(1000, &addr));
+    EXPECT_EQ(NEU_MSG_BUS_NO_ROUTE, neu_msg_bus_send_to(1000, &addr, NULL));
+    EXPECT_EQ(-1, neu_msg_bus_recv_from(1000, NULL, &msg));
+}
+
+TEST(msg_bus_test, send_recv)
+{
+    struct sockaddr_un server = make_addr("bus-server");
+    struct sockaddr_un client = make_addr("bus-client");
+    struct sockaddr_un other  = make_addr("bus-other");
+    struct sockaddr_un src    = {};
+    struct neu_msg_s * msg    = NULL;
+
+    neu_msg_bus_enable();
+
+    int sefd = neu_msg_bus_bind(1001, &server);
+    int cefd = neu_msg_bus_bind(1002, &client);
+    ASSERT_GE(sefd, 0);
+    ASSERT_GE(cefd, 0);
+    neu_msg_bus_connect(1002, &server);
+
+    EXPECT_EQ(-1, neu_msg_bus_recv_from(1001, &src, &msg));
+    EXPECT_EQ(NEU_MSG_BUS_NO_ROUTE, neu_msg_bus_send_to(1002, &other, NULL));
+    EXPECT_EQ(NEU_MSG_BUS_NO_ROUTE, neu_msg_bus_send(1001, fake_msg(1)));
+
+    EXPECT_EQ(0, neu_msg_bus_send(1002, fake_msg(1)));
+    EXPECT_EQ(0, neu_msg_bus_send_to(1002, &server, fake_msg(2)));
+
+    struct pollfd pfd = { sefd, POLLIN, 0 };
+    EXPECT_EQ(1, poll(&pfd, 1, 0));
+
+    EXPECT_EQ(0, neu_msg_bus_recv_from(1001, &src, &msg));
+    EXPECT_EQ(fake_msg(1), msg);
+    EXPECT_EQ(0, memcmp(&client, &src, sizeof(src)));
+    EXPECT_EQ(0, neu_msg_bus_recv_from(1001, &src, &msg));
+    EXPECT_EQ(fake_msg(2), msg);
+    EXPECT_EQ(-1, neu_msg_bus_recv_from(1001, &src, &msg));
+    EXPECT_EQ(0, poll(&pfd, 1, 0));
+
+    neu_msg_bus_unbind(1001);
+    EXPECT_EQ(NEU_MSG_BUS_NO_ROUTE, neu_msg_bus_send(1002, fake_msg(3)));
+    neu_msg_bus_unbind(1002);
+}
+
+TEST(msg_bus_test, full)
+{
+    struct sockaddr_un server = make_addr("bus-full-server");
+    struct sockaddr_un client = make_addr("bus-full-client");
+    struct neu_msg_s * msg    = NULL;
+
+    neu_msg_bus_enable();
+    ASSERT_GE(neu_msg_bus_bind(1003, &server), 0);
+    ASSERT_GE(neu_msg_bus_bind(1004, &client), 0);
+
+    for (uintptr_t i = 1; i <= NEU_MSG_BUS_RING_SIZE; ++i) {
+        EXPECT_EQ(0, neu_msg_bus_send_to(1004, &server, fake_msg(i)));
+    }
+    EXPECT_EQ(-1, neu_msg_bus_send_to(1004, &server, fake_msg(0)));
+    EXPECT_EQ(ENOBUFS, errno);
+
+    for (uintptr_t i = 1; i <= NEU_MSG_BUS_RING_SIZE; ++i) {
+        EXPECT_EQ(0, neu_msg_bus_recv_from(1003, NULL, &msg));
+        EXPECT_EQ(fake_msg(i), msg);
+    }
+
+    neu_msg_bus_unbind(1003);
+    neu_msg_bus_unbind(1004);
+}
+
+TEST(msg_bus_test, multi_producer)
+{
+    const int                n_producer = 4;
+    const uintptr_t          n_msg      = 20000;
+    struct sockaddr_un       server     = make_addr("bus-mp-server");
+    std::vector<std::thread> producers;
+
+    neu_msg_bus_enable();
+    ASSERT_GE(neu_msg_bus_bind(1010, &server), 0);
+    for (int i = 0; i < n_producer; ++i) {
+        char name[32] = { 0 };
+        snprintf(name, sizeof(name), "bus-mp-%d", i);
+        struct sockaddr_un client = make_addr(name);
+        ASSERT_GE(neu_msg_bus_bind(1011 + i, &client), 0);
+        neu_msg_bus_connect(1011 + i, &server);
+    }
+
+    for (int i = 0; i < n_producer; ++i) {
+        producers.emplace_back([i, n_msg]() {
+            for (uintptr_t k = 1; k <= n_msg; ++k) {
+                while (neu_msg_bus_send(1011 + i, fake_msg(k)) != 0) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    // messages of each producer arrive in order
+    uintptr_t last[n_producer] = { 0 };
+    for (uintptr_t got = 0; got < n_producer * n_msg;) {
+        struct sockaddr_un src = {};
+        struct neu_msg_s * msg = NULL;
+        if (neu_msg_bus_recv_from(1010, &src, &msg) != 0) {
+            std::this_thread::yield();
+            continue;
+        }
+        int i = src.sun_path[strlen("_bus-mp-")] - '0';
+        ASSERT_EQ(last[i] + 1, reinterpret_cast<uintptr_t>(msg));
+        last[i] += 1;
+        got += 1;
+    }
+
+    for (auto &t : producers) {
+        t.join();
+    }
+    for (int i = 0; i < n_producer; ++i) {
+        neu_msg_bus_unbind(1011 + i);
+    }
+    neu_msg_bus_unbind(1010);
+}
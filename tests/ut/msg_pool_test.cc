@@ -0,0 +1,78 @@
+#include <stdint.h>
+#include <string.h>
+
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "utils/log.h"
+
+extern "C" {
+// msg_internal.h is C only, the pool itself only deals in sizes
+void *neu_msg_alloc(size_t size);
+void  neu_msg_dealloc(void *p);
+}
+
+zlog_category_t *neuron = NULL;
+
+static bool all_zero(const uint8_t *p, size_t size)
+{
+    for (size_t i = 0; i < size; ++i) {
+        if (p[i] != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+TEST(msg_pool_test, reuse_is_zeroed)
+{
+    size_t sizes[] = { 1, 300, 384, 385, 512, 800, 4096 };
+
+    for (size_t size : sizes) {
+        for (int i = 0; i < 3; ++i) {
+            uint8_t *p = (uint8_t *) neu_msg_alloc(size);
+            ASSERT_NE(nullptr, p);
+            EXPECT_TRUE(all_zero(p, size));
+            EXPECT_EQ(0, (uintptr_t) p % sizeof(void *));
+            memset(p, 0xff, size);
+            neu_msg_dealloc(p);
+        }
+    }
+}
+
+TEST(msg_pool_test, free_on_other_thread)
+{
+    const int n_round = 50;
+    const int n_msg   = 200;
+
+    for (int r = 0; r < n_round; ++r) {
+        std::vector<void *> msgs;
+
+        std::thread producer([&]() {
+            for (int i = 0; i < n_msg; ++i) {
+                void *p = neu_msg_alloc(300 + i % 3 * 200);
+                ASSERT_NE(nullptr, p);
+                memset(p, 0xff, 300);
+                msgs.push_back(p);
+            }
+        });
+        producer.join();
+
+        std::thread consumer([&]() {
+            for (void *p : msgs) {
+                neu_msg_dealloc(p);
+            }
+        });
+        consumer.join();
+    }
+
+    // the consumers left their caches in the depot for this thread
+    for (int i = 0; i < n_msg; ++i) {
+        uint8_t *p = (uint8_t *) neu_msg_alloc(300);
+        ASSERT_NE(nullptr, p);
+        EXPECT_TRUE(all_zero(p, 300));
+        neu_msg_dealloc(p);
+    }
+}
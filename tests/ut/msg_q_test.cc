@@ -0,0 +1,112 @@
+#include <stdint.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include "utils/log.h"
+
+extern "C" {
+// msg_q.h pulls in the C only message helpers, the queue only needs the
+// opaque message pointer
+typedef struct neu_msg_s     neu_msg_t;
+typedef struct adapter_msg_q adapter_msg_q_t;
+
+typedef struct {
+    uint32_t depth;
+    uint32_t high_water;
+    uint64_t enqueued;
+    uint64_t dequeued;
+    uint64_t dropped;
+    uint64_t evicted;
+} adapter_msg_q_stats_t;
+
+adapter_msg_q_t *adapter_msg_q_new(const char *name, uint32_t size);
+void             adapter_msg_q_free(adapter_msg_q_t *q);
+int              adapter_msg_q_push(adapter_msg_q_t *q, neu_msg_t *msg);
+uint32_t adapter_msg_q_pop_batch(adapter_msg_q_t *q, neu_msg_t **msgs,
+                                 int64_t *pushed, uint32_t n);
+void     adapter_msg_q_stats(adapter_msg_q_t *q, adapter_msg_q_stats_t *stats);
+void     adapter_msg_q_pause(adapter_msg_q_t *q, bool paused);
+}
+
+zlog_category_t *neuron = NULL;
+
+TEST(msg_q_test, stats)
+{
+    adapter_msg_q_t *     q     = adapter_msg_q_new("test", 4);
+    adapter_msg_q_stats_t stats = { 0 };
+    neu_msg_t *           msgs[4];
+    int                   token = 0;
+
+    adapter_msg_q_stats(q, &stats);
+    EXPECT_EQ(0, stats.depth);
+    EXPECT_EQ(0, stats.high_water);
+    EXPECT_EQ(0, stats.enqueued);
+
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_EQ(0, adapter_msg_q_push(q, (neu_msg_t *) &token));
+    }
+    EXPECT_EQ(-1, adapter_msg_q_push(q, (neu_msg_t *) &token));
+    EXPECT_EQ(-1, adapter_msg_q_push(q, (neu_msg_t *) &token));
+
+    adapter_msg_q_stats(q, &stats);
+    EXPECT_EQ(4, stats.depth);
+    EXPECT_EQ(4, stats.high_water);
+    EXPECT_EQ(4, stats.enqueued);
+    EXPECT_EQ(0, stats.dequeued);
+    EXPECT_EQ(2, stats.dropped);
+
+    EXPECT_EQ(3, adapter_msg_q_pop_batch(q, msgs, NULL, 3));
+    EXPECT_EQ(0, adapter_msg_q_push(q, (neu_msg_t *) &token));
+
+    adapter_msg_q_stats(q, &stats);
+    EXPECT_EQ(2, stats.depth);
+    EXPECT_EQ(4, stats.high_water);
+    EXPECT_EQ(5, stats.enqueued);
+    EXPECT_EQ(3, stats.dequeued);
+    EXPECT_EQ(2, stats.dropped);
+
+    EXPECT_EQ(2, adapter_msg_q_pop_batch(q, msgs, NULL, 4));
+    adapter_msg_q_stats(q, &stats);
+    EXPECT_EQ(0, stats.depth);
+    EXPECT_EQ(5, stats.dequeued);
+
+    adapter_msg_q_free(q);
+}
+
+TEST(msg_q_test, pause)
+{
+    adapter_msg_q_t * q     = adapter_msg_q_new("test", 4);
+    int               token = 0;
+    std::atomic<long> popped(0);
+
+    adapter_msg_q_pause(q, true);
+    adapter_msg_q_pause(q, true);
+    EXPECT_EQ(0, adapter_msg_q_push(q, (neu_msg_t *) &token));
+    EXPECT_EQ(0, adapter_msg_q_push(q, (neu_msg_t *) &token));
+
+    std::thread consumer([&]() {
+        neu_msg_t *msgs[4];
+        popped = adapter_msg_q_pop_batch(q, msgs, NULL, 4);
+    });
+
+    usleep(50 * 1000);
+    EXPECT_EQ(0, popped);
+    adapter_msg_q_pause(q, false);
+    usleep(50 * 1000);
+    EXPECT_EQ(0, popped);
+    adapter_msg_q_pause(q, false);
+    consumer.join();
+    EXPECT_EQ(2, popped);
+
+    // resuming an unpaused queue is ignored
+    adapter_msg_q_pause(q, false);
+    EXPECT_EQ(0, adapter_msg_q_push(q, (neu_msg_t *) &token));
+    neu_msg_t *msgs[4];
+    EXPECT_EQ(1, adapter_msg_q_pop_batch(q, msgs, NULL, 4));
+
+    adapter_msg_q_free(q);
+}
@@ -0,0 +1,105 @@
+#include <atomic>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include "errcodes.h"
+#include "utils/log.h"
+#include "utils/profile.h"
+
+zlog_category_t *neuron = NULL;
+
+static std::atomic<bool> stop;
+
+static void burn()
+{
+    volatile double x = 0;
+
+    while (!stop) {
+        x = x * 1.0000001 + 0.1;
+    }
+}
+
+// a thread that burns cpu until the test returns, fatal assertions included,
+// with its label dropped before it is joined
+class burner {
+  public:
+    burner()
+    {
+        stop   = false;
+        thread = std::thread(burn);
+    }
+
+    ~burner()
+    {
+        neu_profile_unlabel_thread(thread.native_handle());
+        stop = true;
+        thread.join();
+    }
+
+    std::thread thread;
+};
+
+static const neu_profile_thread_t *find(const neu_profile_thread_t *threads,
+                                        int n, const char *node)
+{
+    for (int i = 0; i < n; ++i) {
+        if (strcmp(threads[i].node, node) == 0) {
+            return &threads[i];
+        }
+    }
+
+    return NULL;
+}
+
+TEST(profile_test, label_threads)
+{
+    neu_profile_thread_t *threads  = NULL;
+    int                   n_thread = 0;
+    uint64_t              cpu_ms   = 0;
+
+    burner t;
+    neu_profile_label_thread(t.thread.native_handle(), "node-1", "adapter");
+    neu_profile_label_thread(t.thread.native_handle(), "node-2", "adapter");
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    ASSERT_EQ(NEU_ERR_SUCCESS,
+              neu_profile_threads(&threads, &n_thread, &cpu_ms));
+    EXPECT_EQ(nullptr, find(threads, n_thread, "node-1"));
+    const neu_profile_thread_t *label = find(threads, n_thread, "node-2");
+    ASSERT_NE(nullptr, label);
+    EXPECT_STREQ("adapter", label->role);
+    EXPECT_GT(label->cpu_ms, 50);
+    EXPECT_GE(cpu_ms, label->cpu_ms);
+    free(threads);
+
+    neu_profile_unlabel_thread(t.thread.native_handle());
+    ASSERT_EQ(NEU_ERR_SUCCESS,
+              neu_profile_threads(&threads, &n_thread, &cpu_ms));
+    EXPECT_EQ(nullptr, find(threads, n_thread, "node-2"));
+    free(threads);
+}
+
+TEST(profile_test, sample)
+{
+    char * folded = NULL;
+    size_t len    = 0;
+
+    int ret = neu_profile_sample(0, 99, &folded, &len);
+    if (NEU_ERR_EINTERNAL == ret) {
+        GTEST_SKIP() << "stack sampling is not supported on this platform";
+    }
+    EXPECT_EQ(NEU_ERR_PARAM_IS_WRONG, ret);
+    EXPECT_EQ(NEU_ERR_PARAM_IS_WRONG,
+              neu_profile_sample(1, NEU_PROFILE_HZ_MAX + 1, &folded, &len));
+
+    burner t;
+    neu_profile_label_thread(t.thread.native_handle(), "node-1", "burn");
+
+    ASSERT_EQ(NEU_ERR_SUCCESS, neu_profile_sample(1, 199, &folded, &len));
+    ASSERT_NE(nullptr, folded);
+    EXPECT_NE(nullptr, strstr(folded, "node-1/burn;"));
+    free(folded);
+}
@@ -1,3 +1,6 @@
+#include <thread>
+#include <vector>
+
 #include <gtest/gtest.h>
 
 #include "utils/log.h"
@@ -36,6 +39,68 @@ TEST(RollingCounterTest, neu_rolling_counter_inc)
     neu_rolling_counter_free(counter);
 }
 
+TEST(RollingCounterTest, neu_rolling_counter_new_res)
+{
+    neu_rolling_counter_t *counter = neu_rolling_counter_new_res(600000, 60000);
+    EXPECT_EQ(60000, counter->res);
+    EXPECT_EQ(10, counter->n);
+    neu_rolling_counter_free(counter);
+
+    // no more than NEU_ROLLING_COUNTER_BINS_MAX bins
+    counter = neu_rolling_counter_new_res(60000, 10);
+    EXPECT_EQ(NEU_ROLLING_COUNTER_BINS_MAX, counter->n);
+    EXPECT_GE(counter->res * counter->n, 60000);
+    neu_rolling_counter_free(counter);
+
+    counter = neu_rolling_counter_new(5000);
+    EXPECT_EQ(1250, counter->res);
+    EXPECT_EQ(4, counter->n);
+    neu_rolling_counter_free(counter);
+}
+
+TEST(RollingCounterTest, neu_rolling_counter_value_at)
+{
+    neu_rolling_counter_t *counter = neu_rolling_counter_new_res(3000, 1000);
+
+    neu_rolling_counter_add(counter, 100, 1);
+    neu_rolling_counter_add(counter, 1100, 2);
+    neu_rolling_counter_add(counter, 2100, 4);
+    EXPECT_EQ(7, neu_rolling_counter_value_at(counter, 2500));
+    EXPECT_EQ(6, neu_rolling_counter_value_at(counter, 3000));
+    EXPECT_EQ(4, neu_rolling_counter_value_at(counter, 4000));
+    EXPECT_EQ(0, neu_rolling_counter_value_at(counter, 5000));
+    // the latest update is still the last one
+    EXPECT_EQ(7, neu_rolling_counter_value(counter));
+
+    // a bin of an older epoch is cleared on reuse
+    neu_rolling_counter_add(counter, 3100, 8);
+    EXPECT_EQ(14, neu_rolling_counter_value_at(counter, 3100));
+
+    neu_rolling_counter_reset(counter);
+    EXPECT_EQ(0, neu_rolling_counter_value_at(counter, 3100));
+    neu_rolling_counter_free(counter);
+}
+
+TEST(RollingCounterTest, neu_rolling_counter_add_threads)
+{
+    neu_rolling_counter_t *  counter = neu_rolling_counter_new(60000);
+    std::vector<std::thread> threads;
+
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([counter]() {
+            for (int i = 0; i < 100000; ++i) {
+                neu_rolling_counter_add(counter, 1000, 1);
+            }
+        });
+    }
+    for (auto &t : threads) {
+        t.join();
+    }
+
+    EXPECT_EQ(400000, neu_rolling_counter_value_at(counter, 1000));
+    neu_rolling_counter_free(counter);
+}
+
 int main(int argc, char **argv)
 {
     zlog_init("./config/dev.conf");
@@ -0,0 +1,138 @@
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "utils/snappy.h"
+
+// a plain decoder of the snappy block format, false if out is malformed
+static bool decompress(const std::vector<uint8_t> &in, std::string &out)
+{
+    size_t   i     = 0;
+    uint64_t n     = 0;
+    int      shift = 0;
+
+    do {
+        if (i >= in.size()) {
+            return false;
+        }
+        n |= (uint64_t)(in[i] & 0x7f) << shift;
+        shift += 7;
+    } while (in[i++] & 0x80);
+
+    out.clear();
+    while (i < in.size()) {
+        uint8_t tag = in[i++];
+        size_t  len = 0;
+
+        switch (tag & 3) {
+        case 0:
+            len = (tag >> 2) + 1;
+            if (len > 60) {
+                int bytes = len - 60;
+                len       = 0;
+                for (int b = 0; b < bytes; ++b) {
+                    len |= (size_t) in[i++] << (8 * b);
+                }
+                len += 1;
+            }
+            if (i + len > in.size()) {
+                return false;
+            }
+            out.append((const char *) &in[i], len);
+            i += len;
+            break;
+        case 2: {
+            len           = (tag >> 2) + 1;
+            size_t offset = in[i] | in[i + 1] << 8;
+            i += 2;
+            if (0 == offset || offset > out.size()) {
+                return false;
+            }
+            for (size_t k = 0; k < len; ++k) {
+                out.push_back(out[out.size() - offset]);
+            }
+            break;
+        }
+        default:
+            return false;
+        }
+    }
+
+    return out.size() == n;
+}
+
+static std::vector<uint8_t> compress(const std::string &in)
+{
+    std::vector<uint8_t> out(neu_snappy_max_len(in.size()));
+
+    size_t n =
+        neu_snappy_compress((const uint8_t *) in.data(), in.size(), &out[0]);
+    EXPECT_LE(n, out.size());
+    out.resize(n);
+    return out;
+}
+
+TEST(snappy_test, empty)
+{
+    std::string          back;
+    std::vector<uint8_t> out = compress("");
+
+    ASSERT_EQ(1, out.size());
+    EXPECT_EQ(0, out[0]);
+    EXPECT_TRUE(decompress(out, back));
+    EXPECT_EQ("", back);
+}
+
+TEST(snappy_test, round_trip)
+{
+    std::string samples[] = {
+        "a",
+        "abc",
+        "abcdabcdabcdabcdabcdabcd",
+        std::string(1000, 'x'),
+        std::string(70000, 'y') + "tail",
+    };
+
+    for (const std::string &in : samples) {
+        std::string back;
+
+        EXPECT_TRUE(decompress(compress(in), back));
+        EXPECT_EQ(in, back);
+    }
+}
+
+TEST(snappy_test, repetitive_shrinks)
+{
+    std::string in;
+    std::string back;
+
+    for (int i = 0; i < 2000; ++i) {
+        in += "tag_reads_total{node=\"modbus-" + std::to_string(i % 10) +
+            "\"}";
+    }
+
+    std::vector<uint8_t> out = compress(in);
+    EXPECT_LT(out.size(), in.size() / 4);
+    EXPECT_TRUE(decompress(out, back));
+    EXPECT_EQ(in, back);
+}
+
+TEST(snappy_test, random_bytes)
+{
+    std::string in(200000, '\0');
+    std::string back;
+
+    srand(1);
+    for (size_t i = 0; i < in.size(); ++i) {
+        in[i] = rand() % (i % 3 ? 256 : 4);
+    }
+
+    std::vector<uint8_t> out = compress(in);
+    EXPECT_LE(out.size(), neu_snappy_max_len(in.size()));
+    EXPECT_TRUE(decompress(out, back));
+    EXPECT_EQ(in, back);
+}
@@ -0,0 +1,110 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include <gtest/gtest.h>
+
+#include "errcodes.h"
+#include "msg.h"
+#include "utils/log.h"
+
+extern "C" {
+#include "core/subscribe.h"
+}
+
+zlog_category_t *neuron = NULL;
+
+static struct sockaddr_un app_addr(uint16_t port)
+{
+    struct sockaddr_un addr = {};
+
+    addr.sun_family = AF_UNIX;
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%cneuron-%u", '\0', port);
+    return addr;
+}
+
+TEST(subscribe_test, sub_unsub)
+{
+    neu_subscribe_mgr_t *mgr = neu_subscribe_manager_create();
+
+    EXPECT_EQ(NEU_ERR_SUCCESS,
+              neu_subscribe_manager_sub(mgr, "d1", "a1", "g1", NULL,
+                                        app_addr(1)));
+    EXPECT_EQ(NEU_ERR_GROUP_ALREADY_SUBSCRIBED,
+              neu_subscribe_manager_sub(mgr, "d1", "a1", "g1", NULL,
+                                        app_addr(1)));
+    EXPECT_EQ(NEU_ERR_SUCCESS,
+              neu_subscribe_manager_sub(mgr, "d1", "a2", "g1", "{}",
+                                        app_addr(2)));
+    EXPECT_EQ(NEU_ERR_SUCCESS,
+              neu_subscribe_manager_sub(mgr, "d1", "a1", "g2", NULL,
+                                        app_addr(1)));
+
+    UT_array *apps = neu_subscribe_manager_find(mgr, "d1", "g1");
+    ASSERT_NE(nullptr, apps);
+    EXPECT_EQ(2, utarray_len(apps));
+    utarray_free(apps);
+
+    apps = neu_subscribe_manager_find_by_driver(mgr, "d1");
+    EXPECT_EQ(3, utarray_len(apps));
+    utarray_free(apps);
+
+    EXPECT_EQ(2, neu_subscribe_manager_group_count(mgr, "a1"));
+    EXPECT_EQ(1, neu_subscribe_manager_group_count(mgr, "a2"));
+
+    UT_array *groups = neu_subscribe_manager_get(mgr, "a2", NULL, NULL);
+    ASSERT_EQ(1, utarray_len(groups));
+    neu_resp_subscribe_info_t *info =
+        (neu_resp_subscribe_info_t *) utarray_front(groups);
+    EXPECT_STREQ("d1", info->driver);
+    EXPECT_STREQ("g1", info->group);
+    EXPECT_STREQ("{}", info->params);
+    utarray_free(groups);
+
+    EXPECT_EQ(NEU_ERR_SUCCESS,
+              neu_subscribe_manager_unsub(mgr, "d1", "a1", "g1"));
+    EXPECT_EQ(NEU_ERR_GROUP_NOT_SUBSCRIBE,
+              neu_subscribe_manager_unsub(mgr, "d1", "a1", "g1"));
+    EXPECT_EQ(1, neu_subscribe_manager_group_count(mgr, "a1"));
+
+    neu_subscribe_manager_unsub_all(mgr, "a1");
+    EXPECT_EQ(0, neu_subscribe_manager_group_count(mgr, "a1"));
+    EXPECT_EQ(1, neu_subscribe_manager_group_count(mgr, "a2"));
+
+    neu_subscribe_manager_destroy(mgr);
+}
+
+TEST(subscribe_test, rename_remove)
+{
+    neu_subscribe_mgr_t *mgr = neu_subscribe_manager_create();
+
+    neu_subscribe_manager_sub(mgr, "d1", "a1", "g1", NULL, app_addr(1));
+    neu_subscribe_manager_sub(mgr, "d1", "a1", "g2", NULL, app_addr(1));
+    neu_subscribe_manager_sub(mgr, "d2", "a1", "g1", NULL, app_addr(1));
+
+    neu_subscribe_manager_update_driver_name(mgr, "d1", "d3");
+    EXPECT_EQ(nullptr, neu_subscribe_manager_find(mgr, "d1", "g1"));
+    UT_array *apps = neu_subscribe_manager_find(mgr, "d3", "g1");
+    ASSERT_NE(nullptr, apps);
+    EXPECT_EQ(1, utarray_len(apps));
+    utarray_free(apps);
+
+    neu_subscribe_manager_update_app_name(mgr, "a1", "a9");
+    EXPECT_EQ(0, neu_subscribe_manager_group_count(mgr, "a1"));
+    EXPECT_EQ(3, neu_subscribe_manager_group_count(mgr, "a9"));
+
+    EXPECT_EQ(0, neu_subscribe_manager_update_group_name(mgr, "d3", "g2", "g5"));
+    UT_array *groups = neu_subscribe_manager_get(mgr, "a9", "d3", "g5");
+    EXPECT_EQ(1, utarray_len(groups));
+    utarray_free(groups);
+
+    neu_subscribe_manager_remove(mgr, "d3", NULL);
+    EXPECT_EQ(1, neu_subscribe_manager_group_count(mgr, "a9"));
+    apps = neu_subscribe_manager_find_by_driver(mgr, "d3");
+    EXPECT_EQ(0, utarray_len(apps));
+    utarray_free(apps);
+
+    neu_subscribe_manager_remove(mgr, "d2", "g1");
+    EXPECT_EQ(0, neu_subscribe_manager_group_count(mgr, "a9"));
+
+    neu_subscribe_manager_destroy(mgr);
+}
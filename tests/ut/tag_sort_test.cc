@@ -1,3 +1,4 @@
+#include <chrono>
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -220,6 +221,64 @@ TEST(TagSortTest, SortDiff)
     free(tag4);
 }
 
+static int tag_cmp_addr(neu_tag_sort_elem_t *tag1, neu_tag_sort_elem_t *tag2)
+{
+    struct tag *p_tag1 = (struct tag *) tag1->tag;
+    struct tag *p_tag2 = (struct tag *) tag2->tag;
+
+    if (p_tag1->station != p_tag2->station) {
+        return p_tag1->station - p_tag2->station;
+    }
+    if (p_tag1->area != p_tag2->area) {
+        return p_tag1->area - p_tag2->area;
+    }
+    return p_tag1->address - p_tag2->address;
+}
+
+TEST(TagSortTest, SortLarge)
+{
+    const int              n_tag  = 100000;
+    UT_array *             tags   = NULL;
+    neu_tag_sort_result_t *result = NULL;
+    struct tag *           all =
+        (struct tag *) calloc(n_tag, sizeof(struct tag));
+
+    // 50 stations, 2 areas, 1000 addresses each, with a gap every 10 addresses
+    utarray_new(tags, &ut_ptr_icd);
+    for (int i = n_tag - 1; i >= 0; i--) {
+        int k = i % 1000;
+
+        all[i].type    = 1;
+        all[i].station = i / 2000;
+        all[i].area    = i / 1000 % 2;
+        all[i].address = k + k / 10 * 2;
+
+        struct tag *p_tag = &all[i];
+        utarray_push_back(tags, &p_tag);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    result     = neu_tag_sort(tags, tag_sort_fn, tag_cmp_addr);
+    auto cost  = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start);
+    printf("sort %d tags into %d sorts, cost %lld ms\n", n_tag, result->n_sort,
+           (long long) cost.count());
+
+    EXPECT_EQ(10000, result->n_sort);
+    EXPECT_EQ(10, result->sorts[0].info.size);
+    EXPECT_LT(cost.count(), 1000);
+
+    struct tag **p_tag =
+        (struct tag **) utarray_eltptr(result->sorts[9999].tags, 9);
+    EXPECT_EQ(49, (*p_tag)->station);
+    EXPECT_EQ(1, (*p_tag)->area);
+    EXPECT_EQ(999 + 99 * 2, (*p_tag)->address);
+
+    neu_tag_sort_free(result);
+    utarray_free(tags);
+    free(all);
+}
+
 int main(int argc, char **argv)
 {
     zlog_init("./config/dev.conf");
@@ -0,0 +1,99 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include <gtest/gtest.h>
+
+#include "tag.h"
+#include "utils/log.h"
+
+zlog_category_t *neuron = NULL;
+
+static neu_datatag_t static_tag(neu_type_e type)
+{
+    neu_datatag_t tag = { 0 };
+
+    tag.name      = strdup("tag");
+    tag.address   = strdup("");
+    tag.attribute =
+        (neu_attribute_e) (NEU_ATTRIBUTE_READ | NEU_ATTRIBUTE_STATIC);
+    tag.type      = type;
+    return tag;
+}
+
+TEST(TagStaticValueTest, pack_unpack_int)
+{
+    neu_datatag_t tag   = static_tag(NEU_TYPE_INT32);
+    neu_value_u   value = { 0 };
+    uint8_t       buf[NEU_TAG_STATIC_VALUE_BIN_SIZE];
+
+    value.i32 = -123456;
+    EXPECT_EQ(0, neu_tag_set_static_value(&tag, &value));
+    EXPECT_EQ(5u, neu_tag_pack_static_value(&tag, buf));
+    EXPECT_EQ(NEU_TYPE_INT32, buf[0]);
+
+    neu_datatag_t loaded = static_tag(NEU_TYPE_INT32);
+    EXPECT_EQ(0, neu_tag_unpack_static_value(&loaded, buf, 5));
+    EXPECT_EQ(0, neu_tag_get_static_value(&loaded, &value));
+    EXPECT_EQ(-123456, value.i32);
+
+    neu_tag_fini(&tag);
+    neu_tag_fini(&loaded);
+}
+
+TEST(TagStaticValueTest, pack_unpack_double)
+{
+    neu_datatag_t tag   = static_tag(NEU_TYPE_DOUBLE);
+    neu_value_u   value = { 0 };
+    uint8_t       buf[NEU_TAG_STATIC_VALUE_BIN_SIZE];
+
+    value.d64 = 3.25;
+    EXPECT_EQ(0, neu_tag_set_static_value(&tag, &value));
+    EXPECT_EQ(9u, neu_tag_pack_static_value(&tag, buf));
+
+    neu_datatag_t loaded = static_tag(NEU_TYPE_DOUBLE);
+    EXPECT_EQ(0, neu_tag_unpack_static_value(&loaded, buf, 9));
+    EXPECT_EQ(0, neu_tag_get_static_value(&loaded, &value));
+    EXPECT_EQ(3.25, value.d64);
+
+    neu_tag_fini(&tag);
+    neu_tag_fini(&loaded);
+}
+
+TEST(TagStaticValueTest, pack_unpack_string)
+{
+    neu_datatag_t tag   = static_tag(NEU_TYPE_STRING);
+    neu_value_u   value = { 0 };
+    uint8_t       buf[NEU_TAG_STATIC_VALUE_BIN_SIZE];
+
+    strcpy(value.str, "recipe");
+    EXPECT_EQ(0, neu_tag_set_static_value(&tag, &value));
+    EXPECT_EQ(7u, neu_tag_pack_static_value(&tag, buf));
+
+    neu_datatag_t loaded = static_tag(NEU_TYPE_STRING);
+    EXPECT_EQ(0, neu_tag_unpack_static_value(&loaded, buf, 7));
+    EXPECT_EQ(0, neu_tag_get_static_value(&loaded, &value));
+    EXPECT_STREQ("recipe", value.str);
+
+    neu_tag_fini(&tag);
+    neu_tag_fini(&loaded);
+}
+
+TEST(TagStaticValueTest, unpack_mismatch)
+{
+    neu_datatag_t tag   = static_tag(NEU_TYPE_INT16);
+    neu_value_u   value = { 0 };
+    uint8_t       buf[NEU_TAG_STATIC_VALUE_BIN_SIZE];
+
+    value.i16 = 7;
+    EXPECT_EQ(0, neu_tag_set_static_value(&tag, &value));
+    EXPECT_EQ(3u, neu_tag_pack_static_value(&tag, buf));
+
+    // the type changed, or the value is truncated
+    neu_datatag_t loaded = static_tag(NEU_TYPE_INT32);
+    EXPECT_NE(0, neu_tag_unpack_static_value(&loaded, buf, 3));
+    loaded.type = NEU_TYPE_INT16;
+    EXPECT_NE(0, neu_tag_unpack_static_value(&loaded, buf, 2));
+
+    neu_tag_fini(&tag);
+    neu_tag_fini(&loaded);
+}
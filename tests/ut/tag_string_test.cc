@@ -0,0 +1,91 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "utils/log.h"
+
+extern "C" {
+#include "tag.h"
+}
+
+zlog_category_t *neuron = NULL;
+
+// the byte at a time transforms, to check the word at a time ones against
+static void swap_pairs(char *str, int len)
+{
+    for (int i = 0; i < len; i += 2) {
+        char t     = str[i];
+        str[i]     = str[i + 1];
+        str[i + 1] = t;
+    }
+}
+
+static std::string pattern(int len)
+{
+    std::string s;
+
+    for (int i = 0; i < len; i++) {
+        s.push_back((char) ('a' + i % 26));
+    }
+    return s;
+}
+
+TEST(TagStringTest, is_utf8)
+{
+    char ascii[] = "a long run of plain ascii bytes, words at a time";
+    EXPECT_TRUE(neu_datatag_string_is_utf8(ascii, strlen(ascii)));
+
+    // three byte sequences after and between ascii words
+    char cjk[] = "barcode 0123456789 \xe4\xb8\xad\xe6\x96\x87 recipe";
+    EXPECT_TRUE(neu_datatag_string_is_utf8(cjk, strlen(cjk)));
+
+    char bad[] = "0123456789abcdef\xe4\x41\x41";
+    EXPECT_FALSE(neu_datatag_string_is_utf8(bad, strlen(bad)));
+
+    // a sequence cut by the end of the string
+    char cut[] = "0123456789\xe4\xb8";
+    EXPECT_FALSE(neu_datatag_string_is_utf8(cut, strlen(cut)));
+
+    char lone[] = "01234567\x80";
+    EXPECT_FALSE(neu_datatag_string_is_utf8(lone, strlen(lone)));
+}
+
+TEST(TagStringTest, htol)
+{
+    for (int len = 0; len <= 40; len += 2) {
+        std::string s = pattern(len);
+        std::string e = s;
+
+        neu_datatag_string_htol(&s[0], len);
+        swap_pairs(&e[0], len);
+        EXPECT_EQ(e, s) << len;
+
+        neu_datatag_string_ltoh(&s[0], len);
+        EXPECT_EQ(pattern(len), s) << len;
+    }
+}
+
+TEST(TagStringTest, etod_dtoe)
+{
+    for (int len = 0; len <= 40; len += 2) {
+        std::string s = pattern(len);
+        std::string e = s;
+
+        for (int i = 0; i < len; i += 2) {
+            e[i + 1] = e[i];
+            e[i]     = 0;
+        }
+        neu_datatag_string_etod(&s[0], len);
+        EXPECT_EQ(e, s) << len;
+
+        for (int i = 0; i < len; i += 2) {
+            e[i]     = e[i + 1];
+            e[i + 1] = 0;
+        }
+        neu_datatag_string_dtoe(&s[0], len);
+        EXPECT_EQ(e, s) << len;
+    }
+}
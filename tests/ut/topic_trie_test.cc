@@ -0,0 +1,89 @@
+#include <string.h>
+
+#include <gtest/gtest.h>
+
+extern "C" {
+#include "connection/topic_trie.h"
+}
+
+static void *match(topic_trie_t *trie, const char *topic)
+{
+    return topic_trie_match(trie, topic, strlen(topic));
+}
+
+TEST(TopicTrieTest, filter_valid)
+{
+    EXPECT_TRUE(topic_filter_valid("a/b/c"));
+    EXPECT_TRUE(topic_filter_valid("a/+/c"));
+    EXPECT_TRUE(topic_filter_valid("/a/#"));
+    EXPECT_TRUE(topic_filter_valid("#"));
+    EXPECT_TRUE(topic_filter_valid("+"));
+    EXPECT_TRUE(topic_filter_valid("a//b"));
+
+    EXPECT_FALSE(topic_filter_valid(""));
+    EXPECT_FALSE(topic_filter_valid(NULL));
+    EXPECT_FALSE(topic_filter_valid("a/#/c"));
+    EXPECT_FALSE(topic_filter_valid("a/b#"));
+    EXPECT_FALSE(topic_filter_valid("a/+b/c"));
+}
+
+TEST(TopicTrieTest, exact)
+{
+    topic_trie_t *trie = topic_trie_new();
+    int           a = 0, b = 0;
+
+    EXPECT_EQ(0, topic_trie_add(trie, "/neuron/a/write/req", &a));
+    EXPECT_EQ(0, topic_trie_add(trie, "/neuron/b/write/req", &b));
+    EXPECT_EQ(-1, topic_trie_add(trie, "a/#/b", &a));
+
+    EXPECT_EQ(&a, match(trie, "/neuron/a/write/req"));
+    EXPECT_EQ(&b, match(trie, "/neuron/b/write/req"));
+    EXPECT_EQ(nullptr, match(trie, "/neuron/c/write/req"));
+    EXPECT_EQ(nullptr, match(trie, "/neuron/a/write"));
+    EXPECT_EQ(nullptr, match(trie, "/neuron/a/write/req/x"));
+
+    // the length bounds the topic
+    EXPECT_EQ(&a, topic_trie_match(trie, "/neuron/a/write/reqxyz", 19));
+
+    EXPECT_EQ(0, topic_trie_add(trie, "/neuron/a/write/req", &b));
+    EXPECT_EQ(&b, match(trie, "/neuron/a/write/req"));
+    topic_trie_free(trie);
+}
+
+TEST(TopicTrieTest, wildcards)
+{
+    topic_trie_t *trie = topic_trie_new();
+    int           exact = 0, plus = 0, hash = 0, all = 0;
+
+    EXPECT_EQ(0, topic_trie_add(trie, "cmd/dev1/write", &exact));
+    EXPECT_EQ(0, topic_trie_add(trie, "cmd/+/write", &plus));
+    EXPECT_EQ(0, topic_trie_add(trie, "cmd/#", &hash));
+
+    EXPECT_EQ(&exact, match(trie, "cmd/dev1/write"));
+    EXPECT_EQ(&plus, match(trie, "cmd/dev2/write"));
+    EXPECT_EQ(&plus, match(trie, "cmd//write"));
+    EXPECT_EQ(&hash, match(trie, "cmd/dev2/read"));
+    EXPECT_EQ(&hash, match(trie, "cmd/dev1/write/x"));
+    EXPECT_EQ(&hash, match(trie, "cmd"));
+    EXPECT_EQ(nullptr, match(trie, "other/dev1/write"));
+
+    EXPECT_EQ(0, topic_trie_add(trie, "#", &all));
+    EXPECT_EQ(&all, match(trie, "other/dev1/write"));
+    EXPECT_EQ(nullptr, match(trie, "$SYS/broker"));
+    topic_trie_free(trie);
+}
+
+TEST(TopicTrieTest, backtrack)
+{
+    topic_trie_t *trie = topic_trie_new();
+    int           a = 0, b = 0;
+
+    // the exact first level leads nowhere for a/x/c, '+' does
+    EXPECT_EQ(0, topic_trie_add(trie, "a/b/c", &a));
+    EXPECT_EQ(0, topic_trie_add(trie, "+/x/c", &b));
+
+    EXPECT_EQ(&a, match(trie, "a/b/c"));
+    EXPECT_EQ(&b, match(trie, "a/x/c"));
+    EXPECT_EQ(nullptr, match(trie, "$a/x/c"));
+    topic_trie_free(trie);
+}
@@ -0,0 +1,80 @@
+#include <string.h>
+
+#include <gtest/gtest.h>
+
+extern "C" {
+#include "msg.h"
+#include "utils/log.h"
+}
+
+zlog_category_t *neuron = NULL;
+
+static neu_reqresp_trans_data_t make_data(uint16_t holders)
+{
+    neu_reqresp_trans_data_t data = {};
+
+    data.driver = (char *) "modbus";
+    data.group  = (char *) "grp";
+    data.ctx    = neu_trans_data_ctx_new(1);
+    data.tags   = &data.ctx->tags;
+    neu_trans_data_ctx_init(data.ctx, holders);
+    return data;
+}
+
+TEST(trans_encoded_test, shared_with_other_holders)
+{
+    neu_reqresp_trans_data_t data   = make_data(2);
+    const char               json[] = "{\"values\":{}}";
+    size_t                   len    = 0;
+
+    EXPECT_EQ(NULL,
+              neu_trans_data_encoded(&data, NEU_TRANS_ENCODED_JSON_VALUES,
+                                     &len));
+    neu_trans_data_encoded_share(&data, NEU_TRANS_ENCODED_JSON_VALUES, json,
+                                 strlen(json));
+
+    const char *buf =
+        neu_trans_data_encoded(&data, NEU_TRANS_ENCODED_JSON_VALUES, &len);
+    ASSERT_NE(nullptr, buf);
+    EXPECT_NE(json, buf);
+    EXPECT_EQ(strlen(json), len);
+    EXPECT_EQ(0, memcmp(json, buf, len));
+    EXPECT_EQ(NULL,
+              neu_trans_data_encoded(&data, NEU_TRANS_ENCODED_JSON_TAGS, &len));
+
+    // one copy per format
+    neu_trans_data_encoded_share(&data, NEU_TRANS_ENCODED_JSON_VALUES, "x", 1);
+    EXPECT_EQ(buf,
+              neu_trans_data_encoded(&data, NEU_TRANS_ENCODED_JSON_VALUES,
+                                     &len));
+
+    neu_trans_data_free(&data);
+    neu_trans_data_free(&data);
+}
+
+TEST(trans_encoded_test, not_shared)
+{
+    neu_reqresp_trans_data_t data  = make_data(1);
+    neu_reqresp_trans_data_t other = make_data(2);
+    UT_array *               tags  = NULL;
+    size_t                   len   = 0;
+
+    // no other holder
+    neu_trans_data_encoded_share(&data, NEU_TRANS_ENCODED_JSON_TAGS, "{}", 2);
+    EXPECT_EQ(NULL,
+              neu_trans_data_encoded(&data, NEU_TRANS_ENCODED_JSON_TAGS, &len));
+
+    // a subset of the snapshot
+    utarray_new(tags, neu_resp_tag_value_meta_icd());
+    other.tags = tags;
+    neu_trans_data_encoded_share(&other, NEU_TRANS_ENCODED_JSON_TAGS, "{}", 2);
+    other.tags = &other.ctx->tags;
+    EXPECT_EQ(NULL,
+              neu_trans_data_encoded(&other, NEU_TRANS_ENCODED_JSON_TAGS,
+                                     &len));
+    utarray_free(tags);
+
+    neu_trans_data_free(&data);
+    neu_trans_data_free(&other);
+    neu_trans_data_free(&other);
+}
@@ -0,0 +1,136 @@
+#include <gtest/gtest.h>
+
+#include "utils/tuning.h"
+
+// reads of the group all in the latency bucket of ms
+static neu_tuning_group_t group(uint32_t interval, uint64_t reads,
+                                uint64_t ms, uint64_t blocks)
+{
+    neu_tuning_group_t g = {};
+
+    g.interval = interval;
+    g.reads    = reads;
+    g.read_ms  = reads * ms;
+    g.blocks   = reads * blocks;
+    g.overruns = ms > interval ? reads : 0;
+    g.latency[neu_tuning_latency_bucket(ms)] = reads;
+    return g;
+}
+
+static void fini(neu_tuning_advice_t *advices, int n)
+{
+    for (int i = 0; i < n; i++) {
+        neu_tuning_advice_fini(&advices[i]);
+    }
+}
+
+TEST(tuning_test, latency_bucket)
+{
+    EXPECT_EQ(0, neu_tuning_latency_bucket(0));
+    EXPECT_EQ(0, neu_tuning_latency_bucket(1));
+    EXPECT_EQ(1, neu_tuning_latency_bucket(2));
+    EXPECT_EQ(2, neu_tuning_latency_bucket(16));
+    EXPECT_EQ(5, neu_tuning_latency_bucket(1024));
+    EXPECT_EQ(6, neu_tuning_latency_bucket(1025));
+}
+
+TEST(tuning_test, latency_percentile)
+{
+    neu_tuning_group_t g = group(1000, 100, 10, 1);
+
+    g.latency[2] = 80;
+    g.latency[4] = 20;
+    EXPECT_EQ(16, neu_tuning_latency_ms(&g, 50));
+    EXPECT_EQ(16, neu_tuning_latency_ms(&g, 80));
+    EXPECT_EQ(256, neu_tuning_latency_ms(&g, 90));
+
+    g = group(1000, 100, 5000, 1);
+    EXPECT_EQ(10000, neu_tuning_latency_ms(&g, 90));
+}
+
+TEST(tuning_test, few_reads)
+{
+    neu_tuning_advice_t advices[NEU_TUNING_ADVICES_MAX];
+    neu_tuning_group_t  g = group(100, NEU_TUNING_READS_MIN - 1, 500, 1);
+
+    EXPECT_EQ(0, neu_tuning_recommend(&g, advices));
+}
+
+TEST(tuning_test, healthy_group)
+{
+    neu_tuning_advice_t advices[NEU_TUNING_ADVICES_MAX];
+    neu_tuning_group_t  g = group(1000, 1000, 10, 1);
+
+    EXPECT_EQ(0, neu_tuning_recommend(&g, advices));
+}
+
+TEST(tuning_test, overrun_interval)
+{
+    neu_tuning_advice_t advices[NEU_TUNING_ADVICES_MAX];
+    neu_tuning_group_t  g = group(100, 1000, 200, 1);
+
+    ASSERT_EQ(1, neu_tuning_recommend(&g, advices));
+    EXPECT_EQ(NEU_TUNING_INTERVAL, advices[0].kind);
+    // p90 of 256 ms and a margin
+    EXPECT_EQ(400, advices[0].value);
+    fini(advices, 1);
+}
+
+TEST(tuning_test, overrun_split)
+{
+    neu_tuning_advice_t advices[NEU_TUNING_ADVICES_MAX];
+    neu_tuning_group_t  g = group(100, 1000, 200, 8);
+
+    g.n_tag = 800;
+    ASSERT_EQ(1, neu_tuning_recommend(&g, advices));
+    EXPECT_EQ(NEU_TUNING_SPLIT, advices[0].kind);
+    // 200 ms of reads in half of 100 ms
+    EXPECT_EQ(4, advices[0].value);
+    fini(advices, 1);
+}
+
+TEST(tuning_test, merge_blocks)
+{
+    neu_tuning_advice_t advices[NEU_TUNING_ADVICES_MAX];
+    neu_tuning_group_t  g = group(1000, 1000, 40, 10);
+
+    g.n_tag = 20;
+    ASSERT_EQ(1, neu_tuning_recommend(&g, advices));
+    EXPECT_EQ(NEU_TUNING_MERGE_BLOCKS, advices[0].kind);
+    EXPECT_EQ(10, advices[0].value);
+    fini(advices, 1);
+}
+
+TEST(tuning_test, slow_tags)
+{
+    neu_tuning_advice_t advices[NEU_TUNING_ADVICES_MAX];
+    neu_tuning_group_t  g          = group(1000, 1000, 10, 1);
+    uint64_t            changes[]  = { 500, 2, 0, 300 };
+    uint16_t            divisors[] = { 1, 1, 20, 1 };
+
+    g.n_tag         = 4;
+    g.changes       = changes;
+    g.poll_divisors = divisors;
+    // the third is read 50 times, too few to tell
+    ASSERT_EQ(1, neu_tuning_recommend(&g, advices));
+    EXPECT_EQ(NEU_TUNING_SLOW_TAGS, advices[0].kind);
+    EXPECT_EQ(10000, advices[0].value);
+    ASSERT_EQ(1, advices[0].n_tag);
+    EXPECT_EQ(1, advices[0].tags[0]);
+    fini(advices, 1);
+}
+
+TEST(tuning_test, slow_group)
+{
+    neu_tuning_advice_t advices[NEU_TUNING_ADVICES_MAX];
+    neu_tuning_group_t  g         = group(1000, 1000, 10, 1);
+    uint64_t            changes[] = { 1, 0 };
+
+    g.n_tag   = 2;
+    g.changes = changes;
+    ASSERT_EQ(1, neu_tuning_recommend(&g, advices));
+    EXPECT_EQ(NEU_TUNING_INTERVAL, advices[0].kind);
+    EXPECT_EQ(10000, advices[0].value);
+    EXPECT_EQ(0, advices[0].n_tag);
+    fini(advices, 1);
+}